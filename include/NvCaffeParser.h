@@ -74,6 +74,33 @@ protected:
     virtual ~IBinaryProtoBlob() {}
 };
 
+//!
+//! \class ICaffeWeightStore
+//!
+//! \brief Object holding the weights of layers parsed by one or more ICaffeParser objects.
+//!
+//! A store attached to several parsers keeps one copy of each weight blob, keyed by layer name and content. Parsing
+//! the same caffemodel into several networks then shares their weights, including the converted FP16 copies.
+//!
+//! \note The store must outlive every network built from parsers using it. Parsers sharing a store must not parse
+//! concurrently.
+//!
+//! \see nvcaffeparser1::ICaffeParser::setWeightStore()
+//!
+//! \warning Do not inherit from this class, as doing so will break forward-compatibility of the API and ABI.
+//!
+class ICaffeWeightStore
+{
+public:
+    //!
+    //! \brief Destroy this ICaffeWeightStore object and the weights it holds.
+    //!
+    virtual void destroy() TRTNOEXCEPT = 0;
+
+protected:
+    virtual ~ICaffeWeightStore() {}
+};
+
 //!
 //! \class IPluginFactory
 //!
@@ -284,6 +311,56 @@ public:
     //! \see setErrorRecorder
     //!
     virtual nvinfer1::IErrorRecorder* getErrorRecorder() const TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Fold BatchNorm and Scale layers into the preceding Convolution, or into a single Scale, while parsing.
+    //!
+    //! The folded parameters are computed from the model weights before the network is built, so this only takes
+    //! effect when a model is given. Blobs in the middle of a folded chain are not added to the IBlobNameToTensor
+    //! when the layers are not in-place. Folding is disabled by default.
+    //!
+    //! \param enable Whether to fold the layers.
+    //!
+    virtual void setBatchNormFolding(bool enable) TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Set the ICaffeWeightStore holding the weights handed to the network.
+    //!
+    //! The weights of a parse using a store are owned by the store rather than by the parser, and the model is
+    //! released once the parse completes. Setting the store to nullptr restores the default behavior.
+    //!
+    //! \param store Pointer to a store created with createCaffeWeightStore().
+    //!
+    virtual void setWeightStore(ICaffeWeightStore* store) TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Only parse the layers that the given output blobs depend on.
+    //!
+    //! The layers the outputs do not depend on, such as auxiliary training heads or unused branches, are removed
+    //! before the network is built, and their weights are neither converted nor kept. Their blobs are not in the
+    //! IBlobNameToTensor. The network inputs are added regardless. Parsing fails if an output is not a blob of the
+    //! deploy file. Setting no outputs, the default, parses every layer.
+    //!
+    //! \param blobNames The names of the blobs to be marked as outputs of the network.
+    //! \param nbBlobNames The number of names.
+    //!
+    virtual void setRequiredOutputs(const char* const* blobNames, int nbBlobNames) TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Subtract a mean from a network input and scale it, as part of the network.
+    //!
+    //! The network computes (input - mean) * scale for the input, so that raw data, such as unnormalized pixels, can
+    //! be fed directly. When the mean is constant over each channel and the only consumer of the input is a
+    //! Convolution without padding, the normalization is folded into its weights and bias while parsing a model.
+    //! Otherwise a Scale layer follows the input, and the input blob name maps to its output in the
+    //! IBlobNameToTensor. Setting the input name to nullptr disables the normalization, the default.
+    //!
+    //! \param inputName The name of the network input.
+    //! \param mean The mean, as returned by parseBinaryProto(), of the dimensions of the input or with one value per
+    //!        channel. The values are copied. May be nullptr to only scale the input.
+    //! \param scale The factor applied after the mean subtraction.
+    //!
+    virtual void setInputNormalization(const char* inputName, IBinaryProtoBlob* mean, float scale) TRTNOEXCEPT = 0;
 };
 
 //!
@@ -295,6 +372,15 @@ public:
 //!
 TENSORRTAPI ICaffeParser* createCaffeParser() TRTNOEXCEPT;
 
+//!
+//! \brief Creates a ICaffeWeightStore object.
+//!
+//! \return A pointer to the ICaffeWeightStore object is returned.
+//!
+//! \see nvcaffeparser1::ICaffeWeightStore
+//!
+TENSORRTAPI ICaffeWeightStore* createCaffeWeightStore() TRTNOEXCEPT;
+
 //!
 //! \brief Shuts down protocol buffers library.
 //!
@@ -35,6 +35,37 @@ extern "C"
 //! \param libNamespace Namespace used to register all the plugins in this library
 //!
 TENSORRTAPI bool initLibNvInferPlugins(void* logger, const char* libNamespace);
+
+//!
+//! \brief Set the allocator for the device memory owned by the TensorRT plugins, such as their weights.
+//! This function should be called before any plugin is initialized, and the allocator must outlive the plugins.
+//! \param allocator Allocator to use, or nullptr to allocate with cudaMalloc and cudaFree
+//!
+TENSORRTAPI void setLibNvInferPluginsGpuAllocator(nvinfer1::IGpuAllocator* allocator);
+
+//!
+//! \brief Load the GEMM algorithms selected by the FC plugins from a file written by saveLibNvInferPluginsGemmAlgoCache.
+//! Plugins built afterwards with a cached GPU and GEMM shape reuse the algorithm instead of searching it again.
+//! \param path File to read
+//! \return False if the file cannot be read or is not a GEMM algorithm cache
+//!
+TENSORRTAPI bool loadLibNvInferPluginsGemmAlgoCache(const char* path);
+
+//!
+//! \brief Save the GEMM algorithms selected by the FC plugins of this process, including the loaded ones.
+//! \param path File to write
+//! \return False if the file cannot be written
+//!
+TENSORRTAPI bool saveLibNvInferPluginsGemmAlgoCache(const char* path);
+
+//!
+//! \brief Time the host side of the enqueues of the TensorRT plugins.
+//! The timer is called at the end of each enqueue, from the enqueuing thread, with the plugin type, the name of the
+//! layer, empty for the plugins that do not keep it, and the wall-clock time spent in the enqueue.
+//! \param timer Function to report the times to, which must be thread-safe, or nullptr to stop timing
+//!
+TENSORRTAPI void setLibNvInferPluginsEnqueueTimer(
+    void (*timer)(const char* pluginType, const char* layerName, float microseconds));
 } // extern "C"
 
 #endif // NV_INFER_PLUGIN_H
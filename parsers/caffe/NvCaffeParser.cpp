@@ -16,6 +16,7 @@
 
 #include "NvCaffeParser.h"
 #include "caffeParser.h"
+#include "caffeWeightStore.h"
 
 using namespace nvcaffeparser1;
 
@@ -32,4 +33,9 @@ extern "C" void* createNvCaffeParser_INTERNAL()
 ICaffeParser* nvcaffeparser1::createCaffeParser()
 {
     return new CaffeParser;
-}
\ No newline at end of file
+}
+
+ICaffeWeightStore* nvcaffeparser1::createCaffeWeightStore()
+{
+    return new CaffeWeightStore;
+}
@@ -14,10 +14,13 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <iostream>
 
 #include "caffeMacros.h"
 #include "caffeParser.h"
+#include "layerFolding.h"
+#include "outputPruning.h"
 #include "opParsers.h"
 #include "parserUtils.h"
 #include "readProto.h"
@@ -366,7 +369,32 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
                                             bool hasModel)
 {
     bool ok = true;
-    CaffeWeightFactory weights(*mModel.get(), weightType, mTmpAllocs, hasModel);
+    if (!mRequiredOutputs.empty() && pruneToOutputs(*mDeploy, *mModel, mRequiredOutputs) < 0)
+    {
+        return nullptr;
+    }
+    // The folded parameters come from the model, random weights have nothing worth folding
+    if (mFoldBatchNorm && hasModel)
+    {
+        auto isPluginLayer = [this](const std::string& name) {
+            return (mPluginFactory && mPluginFactory->isPlugin(name.c_str()))
+                || (mPluginFactoryV2 && mPluginFactoryV2->isPluginV2(name.c_str()));
+        };
+        foldBatchNormalization(*mDeploy, *mModel, isPluginLayer);
+    }
+    // A mean varying over the image or a padded first convolution still take a Scale layer after the input
+    bool inputFolded = false;
+    if (!mNormalizedInput.empty() && hasModel)
+    {
+        const std::vector<float> mean = channelInputMean();
+        auto isPluginLayer = [this](const std::string& name) {
+            return (mPluginFactory && mPluginFactory->isPlugin(name.c_str()))
+                || (mPluginFactoryV2 && mPluginFactoryV2->isPluginV2(name.c_str()));
+        };
+        inputFolded = (mInputMean.empty() || !mean.empty())
+            && foldInputNormalization(*mDeploy, *mModel, mNormalizedInput, mean, mInputScale, isPluginLayer);
+    }
+    CaffeWeightFactory weights(*mModel.get(), weightType, mTmpAllocs, hasModel, mWeightStore);
 
     mBlobNameToTensor = new (BlobNameToTensor);
 
@@ -413,6 +441,14 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
             }
         }
         ITensor* tensor = network.addInput(mDeploy->input().Get(i).c_str(), DataType::kFLOAT, dims);
+        if (!inputFolded && mDeploy->input().Get(i) == mNormalizedInput)
+        {
+            tensor = addInputNormalization(network, *tensor);
+            if (tensor == nullptr)
+            {
+                return nullptr;
+            }
+        }
         (*mBlobNameToTensor)[mDeploy->input().Get(i)] = tensor;
     }
 
@@ -606,6 +642,14 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
                         d = DimsNCHW{1, (int) shape.dim().Get(1), (int) shape.dim().Get(2), (int) shape.dim().Get(3)};
                     }
                     ITensor* tensor = network.addInput(layerMsg.top(i).c_str(), DataType::kFLOAT, d);
+                    if (!inputFolded && layerMsg.top(i) == mNormalizedInput)
+                    {
+                        tensor = addInputNormalization(network, *tensor);
+                        if (tensor == nullptr)
+                        {
+                            return nullptr;
+                        }
+                    }
                     (*mBlobNameToTensor)[layerMsg.top().Get(i)] = tensor;
                 }
             }
@@ -648,7 +692,96 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
 
     mBlobNameToTensor->setTensorNames();
 
-    return ok && weights.isOK() && mBlobNameToTensor->isOK() ? mBlobNameToTensor : nullptr;
+    ok = ok && weights.isOK();
+    if (mWeightStore && hasModel)
+    {
+        // Every model weight handed to the network now lives in the store
+        mModel.reset();
+    }
+    return ok && mBlobNameToTensor->isOK() ? mBlobNameToTensor : nullptr;
+}
+
+void CaffeParser::setInputNormalization(const char* inputName, IBinaryProtoBlob* mean, float scale)
+{
+    mNormalizedInput = inputName ? inputName : "";
+    mInputScale = scale;
+    mInputMean.clear();
+    if (mean == nullptr)
+    {
+        return;
+    }
+    // Only the first image of the blob is the mean
+    mInputMeanDims = mean->getDimensions();
+    const int volume = mInputMeanDims.c() * mInputMeanDims.h() * mInputMeanDims.w();
+    if (mean->getDataType() == DataType::kHALF)
+    {
+        const auto* src = static_cast<const float16*>(mean->getData());
+        mInputMean.assign(src, src + volume);
+    }
+    else
+    {
+        const auto* src = static_cast<const float*>(mean->getData());
+        mInputMean.assign(src, src + volume);
+    }
+}
+
+// The mean of each channel if the mean is constant over the image, empty otherwise
+std::vector<float> CaffeParser::channelInputMean() const
+{
+    const int C = mInputMeanDims.c();
+    const int area = mInputMeanDims.h() * mInputMeanDims.w();
+    std::vector<float> mean;
+    for (int c = 0; c < C && !mInputMean.empty(); ++c)
+    {
+        const auto first = mInputMean.begin() + c * area;
+        if (std::find_if(first, first + area, [first](float m) { return m != *first; }) != first + area)
+        {
+            return {};
+        }
+        mean.push_back(*first);
+    }
+    return mean;
+}
+
+ITensor* CaffeParser::addInputNormalization(INetworkDefinition& network, ITensor& input)
+{
+    const Dims dims = input.getDimensions();
+    const int C = dims.d[dims.nbDims - 3];
+    const int volume = C * dims.d[dims.nbDims - 2] * dims.d[dims.nbDims - 1];
+    const std::vector<float> channelMean = channelInputMean();
+
+    ScaleMode mode = ScaleMode::kUNIFORM;
+    const std::vector<float>* mean = nullptr;
+    if (!channelMean.empty())
+    {
+        mode = ScaleMode::kCHANNEL;
+        mean = &channelMean;
+    }
+    else if (!mInputMean.empty())
+    {
+        mode = ScaleMode::kELEMENTWISE;
+        mean = &mInputMean;
+    }
+    const int count = mode == ScaleMode::kUNIFORM ? 1 : mode == ScaleMode::kCHANNEL ? C : volume;
+    if (mean != nullptr && static_cast<int>(mean->size()) != count)
+    {
+        std::cout << "The mean of input " << mNormalizedInput << " does not match its dimensions." << std::endl;
+        return nullptr;
+    }
+
+    // y = (x - mean) * scale
+    float* shift = allocMemory<float>(count);
+    float* scale = allocMemory<float>(count);
+    for (int i = 0; i < count; ++i)
+    {
+        shift[i] = mean != nullptr ? -(*mean)[i] * mInputScale : 0.0f;
+        scale[i] = mInputScale;
+    }
+    const Weights power{DataType::kFLOAT, nullptr, 0};
+    IScaleLayer* layer = network.addScale(
+        input, mode, Weights{DataType::kFLOAT, shift, count}, Weights{DataType::kFLOAT, scale, count}, power);
+    layer->setName((mNormalizedInput + "_normalization").c_str());
+    return layer->getOutput(0);
 }
 
 IBinaryProtoBlob* CaffeParser::parseBinaryProto(const char* fileName)
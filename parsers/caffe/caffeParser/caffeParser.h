@@ -58,6 +58,13 @@ public:
     void destroy() override { delete this; }
     void setErrorRecorder(nvinfer1::IErrorRecorder* recorder) override { (void)recorder; assert(!"TRT- Not implemented."); }
     nvinfer1::IErrorRecorder* getErrorRecorder() const override { assert(!"TRT- Not implemented."); return nullptr; }
+    void setBatchNormFolding(bool enable) override { mFoldBatchNorm = enable; }
+    void setWeightStore(ICaffeWeightStore* store) override { mWeightStore = static_cast<CaffeWeightStore*>(store); }
+    void setRequiredOutputs(const char* const* blobNames, int nbBlobNames) override
+    {
+        mRequiredOutputs.assign(blobNames, blobNames + (blobNames ? nbBlobNames : 0));
+    }
+    void setInputNormalization(const char* inputName, IBinaryProtoBlob* mean, float scale) override;
 
 private:
     ~CaffeParser() override;
@@ -77,6 +84,8 @@ private:
     const IBlobNameToTensor* parse(nvinfer1::INetworkDefinition& network,
                                    nvinfer1::DataType weightType,
                                    bool hasModel);
+    nvinfer1::ITensor* addInputNormalization(nvinfer1::INetworkDefinition& network, nvinfer1::ITensor& input);
+    std::vector<float> channelInputMean() const;
 
 private:
     std::shared_ptr<trtcaffe::NetParameter> mDeploy;
@@ -90,6 +99,13 @@ private:
     std::vector<nvinfer1::IPluginV2*> mNewPlugins;
     std::unordered_map<std::string, nvinfer1::IPluginCreator*> mPluginRegistry;
     std::string mPluginNamespace = "";
+    bool mFoldBatchNorm{false};
+    CaffeWeightStore* mWeightStore{nullptr};
+    std::vector<std::string> mRequiredOutputs;
+    std::string mNormalizedInput;
+    std::vector<float> mInputMean;
+    nvinfer1::DimsNCHW mInputMeanDims;
+    float mInputScale{1.0f};
 };
 } //namespace nvcaffeparser1
 #endif //TRT_CAFFE_PARSER_CAFFE_PARSER_H
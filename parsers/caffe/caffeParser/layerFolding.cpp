@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+#include "caffeWeightFactory.h"
+#include "layerFolding.h"
+
+using namespace nvcaffeparser1;
+
+namespace
+{
+// y = x * scale[c] + shift[c]
+struct ChannelAffine
+{
+    std::vector<float> scale;
+    std::vector<float> shift;
+};
+
+// CaffeParser::parse skips these layers, so the folding does as well
+bool isActive(const trtcaffe::LayerParameter& layer)
+{
+    return !(layer.has_phase() && layer.phase() == trtcaffe::TEST);
+}
+
+bool contains(const google::protobuf::RepeatedPtrField<std::string>& blobs, const std::string& name)
+{
+    return std::find(blobs.begin(), blobs.end(), name) != blobs.end();
+}
+
+bool isFoldable(const trtcaffe::LayerParameter& layer, const std::function<bool(const std::string&)>& isPluginLayer)
+{
+    return layer.bottom_size() == 1 && layer.top_size() == 1 && !isPluginLayer(layer.name());
+}
+
+// Index of the only layer reading the blob written by layer producer, -1 if no layer or several layers read it
+int soleConsumer(const trtcaffe::NetParameter& deploy, int producer, const std::string& blob)
+{
+    int consumer = -1;
+    for (int k = producer + 1, n = deploy.layer_size(); k < n; ++k)
+    {
+        const trtcaffe::LayerParameter& layer = deploy.layer(k);
+        if (!isActive(layer))
+        {
+            continue;
+        }
+        if (contains(layer.bottom(), blob))
+        {
+            if (consumer != -1)
+            {
+                return -1;
+            }
+            consumer = k;
+        }
+        // Any later reader sees the blob written here
+        if (contains(layer.top(), blob))
+        {
+            break;
+        }
+    }
+    return consumer;
+}
+
+// Index of the first layer writing the blob, -1 for a network input of the deploy file
+int producerOf(const trtcaffe::NetParameter& deploy, const std::string& blob)
+{
+    for (int k = 0, n = deploy.layer_size(); k < n; ++k)
+    {
+        if (isActive(deploy.layer(k)) && contains(deploy.layer(k).top(), blob))
+        {
+            return k;
+        }
+    }
+    return -1;
+}
+
+bool hasPadding(const trtcaffe::ConvolutionParameter& p)
+{
+    bool padded = p.pad_h() != 0 || p.pad_w() != 0;
+    for (int k = 0; k < p.pad_size(); ++k)
+    {
+        padded = padded || p.pad(k) != 0;
+    }
+    return padded;
+}
+
+// Same lookup as CaffeWeightFactory::getBlob, the first layer with the name wins
+trtcaffe::LayerParameter* findModelLayer(trtcaffe::NetParameter& model, const std::string& name)
+{
+    for (int i = 0, n = model.layer_size(); i < n; ++i)
+    {
+        if (model.layer(i).name() == name)
+        {
+            return model.mutable_layer(i);
+        }
+    }
+    return nullptr;
+}
+
+bool readBlob(const trtcaffe::BlobProto& blob, std::vector<float>& values)
+{
+    std::vector<void*> tmpAllocs;
+    const auto data = CaffeWeightFactory::getBlobProtoData(blob, trtcaffe::FLOAT, tmpAllocs);
+    if (data.first != nullptr)
+    {
+        const auto* src = static_cast<const float*>(data.first);
+        values.assign(src, src + data.second);
+    }
+    for (auto p : tmpAllocs)
+    {
+        free(p);
+    }
+    return data.first != nullptr && !values.empty();
+}
+
+// Replaces the blob contents with FP32 values, the shape is left alone
+void writeBlob(trtcaffe::BlobProto& blob, const std::vector<float>& values)
+{
+    blob.clear_raw_data();
+    blob.clear_raw_data_type();
+    blob.clear_double_data();
+    blob.clear_diff();
+    blob.clear_double_diff();
+    blob.clear_raw_diff();
+    blob.clear_raw_diff_type();
+    blob.mutable_data()->Resize(static_cast<int>(values.size()), 0.F);
+    std::copy(values.begin(), values.end(), blob.mutable_data()->begin());
+}
+
+void writeChannelBlob(trtcaffe::BlobProto& blob, const std::vector<float>& values)
+{
+    writeBlob(blob, values);
+    blob.clear_num();
+    blob.clear_channels();
+    blob.clear_height();
+    blob.clear_width();
+    blob.mutable_shape()->clear_dim();
+    blob.mutable_shape()->add_dim(values.size());
+}
+
+// Mirrors parseBatchNormalization, for both the BLVC and the nvCaffe layouts of the blobs
+bool batchNormAffine(const trtcaffe::LayerParameter& layer, const trtcaffe::LayerParameter& modelLayer, ChannelAffine& affine)
+{
+    const bool nvCaffe = modelLayer.blobs_size() == 5;
+    if (!nvCaffe && modelLayer.blobs_size() != 3)
+    {
+        return false;
+    }
+
+    std::vector<float> mean, variance;
+    if (!readBlob(modelLayer.blobs(0), mean) || !readBlob(modelLayer.blobs(1), variance)
+        || mean.size() != variance.size())
+    {
+        return false;
+    }
+
+    float scaleFactor{1.0f};
+    std::vector<float> scaleBlob, biasBlob;
+    if (nvCaffe)
+    {
+        if (!readBlob(modelLayer.blobs(3), scaleBlob) || !readBlob(modelLayer.blobs(4), biasBlob)
+            || scaleBlob.size() != mean.size() || biasBlob.size() != mean.size())
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // A zero moving average is reported by parseBatchNormalization, keep the layer for it
+        std::vector<float> average;
+        if (!readBlob(modelLayer.blobs(2), average) || average.size() != 1 || average[0] == 0.0f)
+        {
+            return false;
+        }
+        scaleFactor /= average[0];
+    }
+
+    const float eps = layer.batch_norm_param().eps();
+    affine.scale.resize(mean.size());
+    affine.shift.resize(mean.size());
+    for (size_t i = 0; i < mean.size(); ++i)
+    {
+        affine.scale[i] = 1.0f / std::sqrt(variance[i] * scaleFactor + eps);
+        affine.shift[i] = -(mean[i] * scaleFactor * affine.scale[i]);
+        if (nvCaffe)
+        {
+            affine.shift[i] = affine.shift[i] * scaleBlob[i] + biasBlob[i];
+            affine.scale[i] *= scaleBlob[i];
+        }
+    }
+    return true;
+}
+
+// Mirrors parseScale, only the per-channel form that it supports is folded
+bool scaleAffine(const trtcaffe::LayerParameter& layer, const trtcaffe::LayerParameter& modelLayer, ChannelAffine& affine)
+{
+    const trtcaffe::ScaleParameter& p = layer.scale_param();
+    const bool hasBias = !p.has_bias_term() || p.bias_term();
+    if (p.axis() != 1 || p.num_axes() != 1 || modelLayer.blobs_size() < (hasBias ? 2 : 1))
+    {
+        return false;
+    }
+
+    if (!readBlob(modelLayer.blobs(0), affine.scale))
+    {
+        return false;
+    }
+    if (hasBias)
+    {
+        return readBlob(modelLayer.blobs(1), affine.shift) && affine.shift.size() == affine.scale.size();
+    }
+    affine.shift.assign(affine.scale.size(), 0.0f);
+    return true;
+}
+
+// Applies next after affine
+bool compose(ChannelAffine& affine, const ChannelAffine& next)
+{
+    if (affine.scale.size() != next.scale.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < affine.scale.size(); ++i)
+    {
+        affine.scale[i] *= next.scale[i];
+        affine.shift[i] = affine.shift[i] * next.scale[i] + next.shift[i];
+    }
+    return true;
+}
+
+// The kernel is [K, C / G, kH, kW], every output channel is scaled on its own
+bool foldIntoConvolution(trtcaffe::LayerParameter& layer, trtcaffe::LayerParameter& modelLayer, const ChannelAffine& affine)
+{
+    trtcaffe::ConvolutionParameter& p = *layer.mutable_convolution_param();
+    const bool hasBias = !p.has_bias_term() || p.bias_term();
+    const size_t K = p.num_output();
+    if (affine.scale.size() != K || modelLayer.blobs_size() < (hasBias ? 2 : 1))
+    {
+        return false;
+    }
+
+    std::vector<float> kernel;
+    std::vector<float> bias(K, 0.0f);
+    if (!readBlob(modelLayer.blobs(0), kernel) || kernel.size() % K != 0)
+    {
+        return false;
+    }
+    if (hasBias && (!readBlob(modelLayer.blobs(1), bias) || bias.size() != K))
+    {
+        return false;
+    }
+
+    const size_t kernelVolume = kernel.size() / K;
+    for (size_t k = 0; k < K; ++k)
+    {
+        for (size_t i = 0; i < kernelVolume; ++i)
+        {
+            kernel[k * kernelVolume + i] *= affine.scale[k];
+        }
+        bias[k] = bias[k] * affine.scale[k] + affine.shift[k];
+    }
+
+    writeBlob(*modelLayer.mutable_blobs(0), kernel);
+    if (modelLayer.blobs_size() < 2)
+    {
+        modelLayer.add_blobs();
+    }
+    writeChannelBlob(*modelLayer.mutable_blobs(1), bias);
+    p.set_bias_term(true);
+    return true;
+}
+
+// The BatchNorm at the start of the chain becomes the Scale producing the output of the chain
+void rewriteAsScale(trtcaffe::LayerParameter& layer, trtcaffe::LayerParameter& modelLayer, const ChannelAffine& affine)
+{
+    layer.set_type("Scale");
+    layer.clear_batch_norm_param();
+    layer.mutable_scale_param()->set_bias_term(true);
+
+    modelLayer.clear_blobs();
+    writeChannelBlob(*modelLayer.add_blobs(), affine.scale);
+    writeChannelBlob(*modelLayer.add_blobs(), affine.shift);
+}
+} // namespace
+
+namespace nvcaffeparser1
+{
+int foldBatchNormalization(trtcaffe::NetParameter& deploy, trtcaffe::NetParameter& model,
+                           const std::function<bool(const std::string&)>& isPluginLayer)
+{
+    std::vector<bool> removed(deploy.layer_size(), false);
+    int nbRemoved = 0;
+    for (int i = 0, n = deploy.layer_size(); i < n; ++i)
+    {
+        trtcaffe::LayerParameter& first = *deploy.mutable_layer(i);
+        const bool isConv = first.type() == "Convolution";
+        if (removed[i] || !isActive(first) || (!isConv && first.type() != "BatchNorm")
+            || !isFoldable(first, isPluginLayer))
+        {
+            continue;
+        }
+        trtcaffe::LayerParameter* firstModel = findModelLayer(model, first.name());
+        ChannelAffine affine;
+        if (firstModel == nullptr || (!isConv && !batchNormAffine(first, *firstModel, affine)))
+        {
+            continue;
+        }
+
+        // Follow the chain of BatchNorm and Scale layers, each consuming the only use of the previous output
+        std::vector<int> chain;
+        for (int last = i;;)
+        {
+            const int next = soleConsumer(deploy, last, deploy.layer(last).top(0));
+            if (next < 0)
+            {
+                break;
+            }
+            const trtcaffe::LayerParameter& layer = deploy.layer(next);
+            trtcaffe::LayerParameter* modelLayer = findModelLayer(model, layer.name());
+            if (modelLayer == nullptr || !isFoldable(layer, isPluginLayer))
+            {
+                break;
+            }
+            ChannelAffine layerAffine;
+            bool ok = false;
+            if (layer.type() == "BatchNorm")
+            {
+                ok = batchNormAffine(layer, *modelLayer, layerAffine);
+            }
+            else if (layer.type() == "Scale")
+            {
+                ok = scaleAffine(layer, *modelLayer, layerAffine);
+            }
+            if (!ok)
+            {
+                break;
+            }
+            if (isConv && chain.empty())
+            {
+                affine = std::move(layerAffine);
+            }
+            else if (!compose(affine, layerAffine))
+            {
+                break;
+            }
+            chain.push_back(next);
+            last = next;
+        }
+        if (chain.empty())
+        {
+            continue;
+        }
+
+        // The output of the chain is now written by its first layer, nothing in between may touch it
+        const std::string& top = deploy.layer(chain.back()).top(0);
+        bool clobbered = false;
+        for (int k = i + 1; k < chain.back() && !clobbered; ++k)
+        {
+            const trtcaffe::LayerParameter& layer = deploy.layer(k);
+            clobbered = isActive(layer) && std::find(chain.begin(), chain.end(), k) == chain.end()
+                && (contains(layer.bottom(), top) || contains(layer.top(), top));
+        }
+        if (clobbered)
+        {
+            continue;
+        }
+
+        if (isConv)
+        {
+            if (!foldIntoConvolution(first, *firstModel, affine))
+            {
+                continue;
+            }
+        }
+        else
+        {
+            rewriteAsScale(first, *firstModel, affine);
+        }
+        first.set_top(0, top);
+        for (int k : chain)
+        {
+            removed[k] = true;
+        }
+        nbRemoved += static_cast<int>(chain.size());
+    }
+
+    // Compact the remaining layers, keeping their order
+    auto* layers = deploy.mutable_layer();
+    int kept = 0;
+    for (int i = 0, n = layers->size(); i < n; ++i)
+    {
+        if (!removed[i])
+        {
+            layers->SwapElements(kept++, i);
+        }
+    }
+    while (layers->size() > kept)
+    {
+        layers->RemoveLast();
+    }
+    return nbRemoved;
+}
+
+bool foldInputNormalization(trtcaffe::NetParameter& deploy, trtcaffe::NetParameter& model, const std::string& input,
+                            const std::vector<float>& mean, float scale,
+                            const std::function<bool(const std::string&)>& isPluginLayer)
+{
+    const int i = soleConsumer(deploy, producerOf(deploy, input), input);
+    if (i < 0 || deploy.layer(i).type() != "Convolution" || !isFoldable(deploy.layer(i), isPluginLayer))
+    {
+        return false;
+    }
+    trtcaffe::LayerParameter& layer = *deploy.mutable_layer(i);
+    trtcaffe::LayerParameter* modelLayer = findModelLayer(model, layer.name());
+    trtcaffe::ConvolutionParameter& p = *layer.mutable_convolution_param();
+    const bool hasBias = !p.has_bias_term() || p.bias_term();
+    // The convolution pads the shifted input with zeros, which the raw input cannot reproduce
+    const bool hasMean = std::any_of(mean.begin(), mean.end(), [](float m) { return m != 0.0f; });
+    if (modelLayer == nullptr || modelLayer->blobs_size() < (hasBias ? 2 : 1) || (hasMean && hasPadding(p)))
+    {
+        return false;
+    }
+
+    // The kernel is [K, C / G, kH, kW], the output channels of group g read the input channels of group g
+    const size_t K = p.num_output();
+    const size_t G = p.has_group() ? p.group() : 1;
+    const size_t C = mean.size();
+    std::vector<float> kernel;
+    std::vector<float> bias(K, 0.0f);
+    if (!readBlob(modelLayer->blobs(0), kernel) || K % G != 0
+        || (hasMean && (C % G != 0 || kernel.size() % (K * (C / G)) != 0)))
+    {
+        return false;
+    }
+    if (hasBias && (!readBlob(modelLayer->blobs(1), bias) || bias.size() != K))
+    {
+        return false;
+    }
+
+    if (hasMean)
+    {
+        const size_t groupChannels = C / G;
+        const size_t kernelArea = kernel.size() / (K * groupChannels);
+        for (size_t k = 0; k < K; ++k)
+        {
+            const size_t group = k / (K / G);
+            for (size_t c = 0; c < groupChannels; ++c)
+            {
+                const float* w = &kernel[(k * groupChannels + c) * kernelArea];
+                bias[k] -= scale * mean[group * groupChannels + c] * std::accumulate(w, w + kernelArea, 0.0f);
+            }
+        }
+    }
+    for (auto& w : kernel)
+    {
+        w *= scale;
+    }
+
+    writeBlob(*modelLayer->mutable_blobs(0), kernel);
+    if (modelLayer->blobs_size() < 2)
+    {
+        modelLayer->add_blobs();
+    }
+    writeChannelBlob(*modelLayer->mutable_blobs(1), bias);
+    p.set_bias_term(true);
+    return true;
+}
+} //namespace nvcaffeparser1
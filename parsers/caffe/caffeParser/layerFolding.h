@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_LAYER_FOLDING_H
+#define TRT_CAFFE_PARSER_LAYER_FOLDING_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "trtcaffe.pb.h"
+
+namespace nvcaffeparser1
+{
+// Rewrites chains of per-channel affine layers before the network is built. A Convolution followed by BatchNorm and
+// Scale layers absorbs them into its weights and bias, a BatchNorm followed by Scale layers becomes a single Scale.
+// Layers are only folded when each intermediate blob has no other consumer. The folded weights are stored as FP32 in
+// the model, the weight factory converts them like any other blob. Layers for which isPluginLayer returns true are
+// left untouched. Returns the number of layers removed from the deploy file.
+int foldBatchNormalization(trtcaffe::NetParameter& deploy, trtcaffe::NetParameter& model,
+                           const std::function<bool(const std::string&)>& isPluginLayer);
+
+// Folds y = (x - mean[c]) * scale on the network input into the Convolution that is its only consumer, when the
+// result is exact: the mean is empty or per-channel, and the convolution has no padding unless the mean is empty.
+// Returns false, leaving the deploy file and the model untouched, when the input cannot be folded.
+bool foldInputNormalization(trtcaffe::NetParameter& deploy, trtcaffe::NetParameter& model, const std::string& input,
+                            const std::vector<float>& mean, float scale,
+                            const std::function<bool(const std::string&)>& isPluginLayer);
+} //namespace nvcaffeparser1
+#endif //TRT_CAFFE_PARSER_LAYER_FOLDING_H
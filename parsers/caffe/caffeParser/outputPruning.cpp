@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <unordered_set>
+
+#include "outputPruning.h"
+
+namespace
+{
+// CaffeParser::parse skips these layers, so the pruning does as well
+bool isActive(const trtcaffe::LayerParameter& layer)
+{
+    return !(layer.has_phase() && layer.phase() == trtcaffe::TEST);
+}
+
+template <typename Layers>
+void clearUnusedBlobs(Layers& layers, const std::unordered_set<std::string>& usedNames)
+{
+    for (auto& layer : layers)
+    {
+        if (usedNames.find(layer.name()) == usedNames.end())
+        {
+            layer.clear_blobs();
+        }
+    }
+}
+} // namespace
+
+namespace nvcaffeparser1
+{
+int pruneToOutputs(trtcaffe::NetParameter& deploy, trtcaffe::NetParameter& model,
+                   const std::vector<std::string>& outputs)
+{
+    // Blobs whose value is still needed by a later layer or as an output, going backwards
+    std::unordered_set<std::string> live(outputs.begin(), outputs.end());
+    std::vector<bool> needed(deploy.layer_size(), false);
+    for (int i = deploy.layer_size() - 1; i >= 0; --i)
+    {
+        const trtcaffe::LayerParameter& layer = deploy.layer(i);
+        if (!isActive(layer))
+        {
+            continue;
+        }
+        for (const auto& top : layer.top())
+        {
+            needed[i] = needed[i] || live.count(top) != 0;
+        }
+        if (!needed[i])
+        {
+            continue;
+        }
+        // Earlier writers of the tops are hidden by this layer, unless it reads them in place
+        for (const auto& top : layer.top())
+        {
+            live.erase(top);
+        }
+        live.insert(layer.bottom().begin(), layer.bottom().end());
+    }
+
+    for (const auto& input : deploy.input())
+    {
+        live.erase(input);
+    }
+    for (const auto& output : outputs)
+    {
+        if (live.count(output))
+        {
+            std::cout << "Requested output " << output << " is not a blob of the deploy file." << std::endl;
+            return -1;
+        }
+    }
+    // Whatever else is left is read before any layer writes it, which the parse itself reports
+
+    std::unordered_set<std::string> usedNames;
+    auto* layers = deploy.mutable_layer();
+    int kept = 0;
+    for (int i = 0, n = layers->size(); i < n; ++i)
+    {
+        if (needed[i])
+        {
+            usedNames.insert(layers->Get(i).name());
+            layers->SwapElements(kept++, i);
+        }
+    }
+    const int nbRemoved = layers->size() - kept;
+    while (layers->size() > kept)
+    {
+        layers->RemoveLast();
+    }
+
+    // The weight factory looks blobs up by layer name in both the current and the V1 layers of the model
+    clearUnusedBlobs(*model.mutable_layer(), usedNames);
+    clearUnusedBlobs(*model.mutable_layers(), usedNames);
+    return nbRemoved;
+}
+} //namespace nvcaffeparser1
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_OUTPUT_PRUNING_H
+#define TRT_CAFFE_PARSER_OUTPUT_PRUNING_H
+
+#include <string>
+#include <vector>
+
+#include "trtcaffe.pb.h"
+
+namespace nvcaffeparser1
+{
+// Removes the layers of the deploy file that the given output blobs do not depend on, walking the layers backwards
+// from the last writer of each output. The blobs of the removed layers are cleared from the model, so they are neither
+// converted nor kept in host memory. Network inputs are left alone. Returns the number of layers removed, or -1 if an
+// output is neither written by a layer nor a network input, in which case nothing is changed.
+int pruneToOutputs(trtcaffe::NetParameter& deploy, trtcaffe::NetParameter& model,
+                   const std::vector<std::string>& outputs);
+} //namespace nvcaffeparser1
+#endif //TRT_CAFFE_PARSER_OUTPUT_PRUNING_H
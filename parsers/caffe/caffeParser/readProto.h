@@ -17,8 +17,17 @@
 #ifndef TRT_CAFFE_PARSER_READ_PROTO_H
 #define TRT_CAFFE_PARSER_READ_PROTO_H
 
+#include <algorithm>
+#include <climits>
 #include <fstream>
 
+#if !defined _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/text_format.h"
@@ -40,6 +49,48 @@ bool readBinaryProto(trtcaffe::NetParameter* net, const char* file, size_t bufSi
     CHECK_NULL_RET_VAL(file, false)
     using namespace google::protobuf::io;
 
+#if !defined _MSC_VER
+    // Parse straight from a read-only mapping of the file. This skips the buffered copy done by IstreamInputStream,
+    // and the pages of the mapping can be dropped by the kernel once they have been parsed, so the peak resident size
+    // stays close to the size of the parsed model. The weights are still materialized once in the message, since the
+    // protobuf runtime cannot alias packed floats or bytes fields into the input buffer.
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+    {
+        RETURN_AND_LOG_ERROR(false, "Could not open file " + std::string(file));
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        const size_t size = static_cast<size_t>(fileStat.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping != MAP_FAILED)
+        {
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            bool ok = false;
+            {
+                ArrayInputStream rawInput(mapping, static_cast<int>(std::min(size, size_t(INT_MAX))));
+                CodedInputStream codedInput(&rawInput);
+                codedInput.SetTotalBytesLimit(int(bufSize), -1);
+                ok = net->ParseFromCodedStream(&codedInput);
+            }
+            munmap(mapping, size);
+
+            if (!ok)
+            {
+                RETURN_AND_LOG_ERROR(false, "Could not parse binary model file");
+            }
+            return ok;
+        }
+    }
+    else
+    {
+        close(fd);
+    }
+    // Fall back to streaming when the file cannot be mapped
+#endif
+
     std::ifstream stream(file, std::ios::in | std::ios::binary);
     if (!stream)
     {
@@ -17,10 +17,82 @@
 #include "caffeMacros.h"
 #include "caffeWeightFactory.h"
 #include "half.h"
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CAFFE_PARSER_F16C 1
+#endif
 
 using namespace nvinfer1;
 using namespace nvcaffeparser1;
 
+namespace
+{
+// Below this many values a conversion is cheaper than handing it to a worker thread
+constexpr int64_t kAsyncConversionThreshold = 1 << 16;
+
+#if CAFFE_PARSER_F16C
+// Converts 8 values per instruction and tracks the largest magnitude for the range check. The target attribute keeps
+// the rest of the parser buildable without -mf16c, the caller checks that the CPU supports the instructions.
+__attribute__((target("avx,f16c"))) float floatToHalfF16C(const float* src, float16* dst, int64_t count)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 maxAbs = _mm256_setzero_ps();
+    int64_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256 v = _mm256_loadu_ps(src + i);
+        maxAbs = _mm256_max_ps(maxAbs, _mm256_and_ps(v, absMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, maxAbs);
+    float result = 0.F;
+    for (float lane : lanes)
+    {
+        result = std::max(result, lane);
+    }
+    for (; i < count; ++i)
+    {
+        result = std::max(result, std::fabs(src[i]));
+        dst[i] = float16(src[i]);
+    }
+    return result;
+}
+#endif
+
+// Returns false when a value does not fit in FP16, like convertInternal
+bool floatToHalf(const float* src, float16* dst, int64_t count)
+{
+#if CAFFE_PARSER_F16C
+    static const bool hasF16C = __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    if (hasF16C)
+    {
+        if (!(floatToHalfF16C(src, dst, count) > static_cast<float>(std::numeric_limits<float16>::max())))
+        {
+            return true;
+        }
+        // Fall through to report the offending value
+    }
+#endif
+    for (int64_t i = 0; i < count; ++i)
+    {
+        if (static_cast<float16>(src[i]) > std::numeric_limits<float16>::max()
+            || static_cast<float16>(src[i]) < std::numeric_limits<float16>::lowest())
+        {
+            std::cout << "Error: Weight " << src[i] << " is outside of [" << std::numeric_limits<float16>::max()
+                      << ", " << std::numeric_limits<float16>::lowest() << "]." << std::endl;
+            return false;
+        }
+        dst[i] = src[i];
+    }
+    return true;
+}
+} // namespace
+
 template <typename INPUT, typename OUTPUT>
 void* convertInternal(void** ptr, int64_t count, bool* mOK)
 {
@@ -56,11 +128,12 @@ void* convertInternal(void** ptr, int64_t count, bool* mOK)
 
 
 
-CaffeWeightFactory::CaffeWeightFactory(const trtcaffe::NetParameter& msg, DataType dataType, std::vector<void*>& tmpAllocs, bool isInitialized)
+CaffeWeightFactory::CaffeWeightFactory(const trtcaffe::NetParameter& msg, DataType dataType, std::vector<void*>& tmpAllocs, bool isInitialized, CaffeWeightStore* weightStore)
     : mMsg(msg)
     , mTmpAllocs(tmpAllocs)
     , mDataType(dataType)
     , mInitialized(isInitialized)
+    , mWeightStore(weightStore)
 {
     mRef = std::unique_ptr<trtcaffe::NetParameter>(new trtcaffe::NetParameter);
 }
@@ -162,7 +235,42 @@ void CaffeWeightFactory::convert(Weights& weights, DataType targetType)
     void* tmpAlloc{nullptr};
     if (weights.type == DataType::kFLOAT && targetType == DataType::kHALF)
     {
-        tmpAlloc = convertInternal<float, float16>(const_cast<void**>(&weights.values), weights.count, &mOK);
+        const bool shared = mWeightStore && mWeightStore->isShared(weights.values);
+        const void* converted = shared ? mWeightStore->findConverted(weights.values, targetType) : nullptr;
+        if (converted)
+        {
+            weights.values = converted;
+        }
+        else if (weights.values != nullptr && weights.count > 0)
+        {
+            const auto* src = static_cast<const float*>(weights.values);
+            auto* dst = static_cast<float16*>(malloc(weights.count * sizeof(float16)));
+            const int64_t count = weights.count;
+            if (count < kAsyncConversionThreshold)
+            {
+                mOK &= floatToHalf(src, dst, count);
+            }
+            else
+            {
+                // Bound the number of conversions in flight to the number of hardware threads
+                const size_t maxPending = std::max(1U, std::thread::hardware_concurrency());
+                while (mPendingConversions.size() >= maxPending)
+                {
+                    mOK &= mPendingConversions.front().get();
+                    mPendingConversions.pop_front();
+                }
+                mPendingConversions.push_back(std::async(std::launch::async, floatToHalf, src, dst, count));
+            }
+            if (shared)
+            {
+                mWeightStore->addConverted(weights.values, targetType, dst);
+            }
+            else
+            {
+                tmpAlloc = dst;
+            }
+            weights.values = dst;
+        }
         weights.type = targetType;
     }
     if (weights.type == DataType::kHALF && targetType == DataType::kFLOAT)
@@ -183,6 +291,11 @@ void CaffeWeightFactory::convert(Weights& weights)
 
 bool CaffeWeightFactory::isOK()
 {
+    while (!mPendingConversions.empty())
+    {
+        mOK &= mPendingConversions.front().get();
+        mPendingConversions.pop_front();
+    }
     return mOK;
 }
 
@@ -407,5 +520,6 @@ Weights CaffeWeightFactory::getWeights(const trtcaffe::BlobProto& blobMsg, const
     }
 
     mOK &= checkForNans<float>(blobProtoData.first, int(blobProtoData.second), layerName);
-    return Weights{DataType::kFLOAT, blobProtoData.first, int(blobProtoData.second)};
+    const Weights weights{DataType::kFLOAT, blobProtoData.first, int(blobProtoData.second)};
+    return mWeightStore ? mWeightStore->share(layerName, weights) : weights;
 }
@@ -17,11 +17,14 @@
 #ifndef TRT_CAFFE_PARSER_CAFFE_WEIGHT_FACTORY_H
 #define TRT_CAFFE_PARSER_CAFFE_WEIGHT_FACTORY_H
 
+#include <deque>
+#include <future>
 #include <vector>
 #include <string>
 #include <random>
 #include <memory>
 #include "NvInfer.h"
+#include "caffeWeightStore.h"
 #include "weightType.h"
 #include "trtcaffe.pb.h"
 
@@ -30,7 +33,7 @@ namespace nvcaffeparser1
 class CaffeWeightFactory
 {
 public:
-    CaffeWeightFactory(const trtcaffe::NetParameter& msg, nvinfer1::DataType dataType, std::vector<void*>& tmpAllocs, bool isInitialized);
+    CaffeWeightFactory(const trtcaffe::NetParameter& msg, nvinfer1::DataType dataType, std::vector<void*>& tmpAllocs, bool isInitialized, CaffeWeightStore* weightStore = nullptr);
     nvinfer1::DataType getDataType() const;
     size_t getDataTypeSize() const;
     std::vector<void*>& getTmpAllocs();
@@ -40,6 +43,7 @@ public:
     virtual nvinfer1::Weights operator()(const std::string& layerName, WeightType weightType);
     void convert(nvinfer1::Weights& weights, nvinfer1::DataType targetType);
     void convert(nvinfer1::Weights& weights);
+    // Waits for the pending FP16 conversions, the converted values are only valid after this returns
     bool isOK();
     bool isInitialized();
     nvinfer1::Weights getNullWeights();
@@ -63,6 +67,11 @@ private:
     bool mInitialized;
     std::default_random_engine generator;
     bool mOK{true};
+    // Large FP32 to FP16 conversions run on worker threads while the parser walks the following layers. The output
+    // buffers are allocated up front, so the Weights handed to the network already point at their final storage.
+    std::deque<std::future<bool>> mPendingConversions;
+    // When set, the model weights and their conversions are owned by the store rather than by mTmpAllocs
+    CaffeWeightStore* mWeightStore{nullptr};
 };
 } //namespace nvcaffeparser1
 #endif //TRT_CAFFE_PARSER_CAFFE_WEIGHT_FACTORY_H
\ No newline at end of file
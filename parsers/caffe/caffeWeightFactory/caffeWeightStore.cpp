@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "caffeWeightStore.h"
+
+using namespace nvinfer1;
+using namespace nvcaffeparser1;
+
+namespace
+{
+inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Hashes 8 bytes at a time, it runs once per blob and per parse, so it has to stay well below a copy of the blob
+uint64_t hashValues(const void* values, size_t bytes)
+{
+    const auto* src = static_cast<const unsigned char*>(values);
+    uint64_t h = bytes;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, src + i, sizeof(word));
+        h = (h ^ mix(word)) * 0x9E3779B97F4A7C15ULL;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, src + i, bytes - i);
+    return mix(h ^ tail);
+}
+} // namespace
+
+CaffeWeightStore::~CaffeWeightStore()
+{
+    for (auto& v : mShared)
+    {
+        free(v.second);
+    }
+    for (auto& v : mConverted)
+    {
+        free(v.second);
+    }
+}
+
+Weights CaffeWeightStore::share(const std::string& layerName, const Weights& weights)
+{
+    if (weights.values == nullptr || weights.count <= 0 || weights.type != DataType::kFLOAT)
+    {
+        return weights;
+    }
+
+    const size_t bytes = weights.count * sizeof(float);
+    std::string key = layerName;
+    key.push_back('\0');
+    key += std::to_string(weights.count) + ":" + std::to_string(hashValues(weights.values, bytes));
+
+    auto it = mShared.find(key);
+    if (it == mShared.end())
+    {
+        void* values = malloc(bytes);
+        std::memcpy(values, weights.values, bytes);
+        it = mShared.emplace(std::move(key), values).first;
+        mSharedValues.insert(values);
+    }
+    return Weights{DataType::kFLOAT, it->second, weights.count};
+}
+
+bool CaffeWeightStore::isShared(const void* values) const
+{
+    return mSharedValues.count(values) != 0;
+}
+
+const void* CaffeWeightStore::findConverted(const void* values, DataType type) const
+{
+    auto it = mConverted.find(std::make_pair(values, type));
+    return it == mConverted.end() ? nullptr : it->second;
+}
+
+void CaffeWeightStore::addConverted(const void* values, DataType type, void* converted)
+{
+    const bool added = mConverted.emplace(std::make_pair(values, type), converted).second;
+    assert(added && "Converted weights are only added after findConverted misses");
+    (void) added;
+}
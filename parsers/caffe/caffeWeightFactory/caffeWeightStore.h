@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_CAFFE_WEIGHT_STORE_H
+#define TRT_CAFFE_PARSER_CAFFE_WEIGHT_STORE_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "NvCaffeParser.h"
+#include "NvInfer.h"
+
+namespace nvcaffeparser1
+{
+class CaffeWeightStore : public ICaffeWeightStore
+{
+public:
+    CaffeWeightStore() = default;
+    CaffeWeightStore(const CaffeWeightStore&) = delete;
+    CaffeWeightStore& operator=(const CaffeWeightStore&) = delete;
+
+    void destroy() override { delete this; }
+
+    // Returns the stored FP32 copy of the layer weights, copying them on the first request
+    nvinfer1::Weights share(const std::string& layerName, const nvinfer1::Weights& weights);
+
+    // Whether values points at FP32 weights returned by share
+    bool isShared(const void* values) const;
+
+    // Converted copies of shared weights, keyed by the shared FP32 values they were converted from
+    const void* findConverted(const void* values, nvinfer1::DataType type) const;
+    // The store takes ownership of the malloc'd converted values
+    void addConverted(const void* values, nvinfer1::DataType type, void* converted);
+
+private:
+    ~CaffeWeightStore();
+
+    std::unordered_map<std::string, void*> mShared;
+    std::unordered_set<const void*> mSharedValues;
+    std::map<std::pair<const void*, nvinfer1::DataType>, void*> mConverted;
+};
+} //namespace nvcaffeparser1
+#endif //TRT_CAFFE_PARSER_CAFFE_WEIGHT_STORE_H
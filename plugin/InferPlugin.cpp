@@ -15,6 +15,9 @@
  */
 #include "NvInfer.h"
 #include "NvInferPlugin.h"
+#include "common/pluginAllocator.h"
+#include "common/gemmAlgoCache.h"
+#include "common/enqueueTiming.h"
 #include <algorithm>
 #include <array>
 #include <iostream>
@@ -25,27 +28,51 @@
 using namespace nvinfer1;
 using namespace nvinfer1::plugin;
 
+// The library of a plugin family, built with PLUGIN_FAMILY_LIBRARIES, registers only the plugins of the family. The
+// BERT plugins register themselves when their library is loaded.
+#if !defined(PLUGIN_FAMILY_DETECTION) && !defined(PLUGIN_FAMILY_MASKRCNN) && !defined(PLUGIN_FAMILY_MISC)             \
+    && !defined(PLUGIN_FAMILY_BERT)
+#define PLUGIN_FAMILY_DETECTION
+#define PLUGIN_FAMILY_MASKRCNN
+#define PLUGIN_FAMILY_MISC
+#endif
+
+#ifdef PLUGIN_FAMILY_DETECTION
 #include "batchedNMSPlugin/batchedNMSPlugin.h"
 #include "cropAndResizePlugin/cropAndResizePlugin.h"
 #include "flattenConcat/flattenConcat.h"
 #include "gridAnchorPlugin/gridAnchorPlugin.h"
 #include "nmsPlugin/nmsPlugin.h"
 #include "normalizePlugin/normalizePlugin.h"
+#include "nvFasterRCNN/fasterRCNNDetectionOutputPlugin.h"
 #include "nvFasterRCNN/nvFasterRCNNPlugin.h"
 #include "priorBoxPlugin/priorBoxPlugin.h"
 #include "proposalPlugin/proposalPlugin.h"
 #include "regionPlugin/regionPlugin.h"
 #include "reorgPlugin/reorgPlugin.h"
+#include "yoloDetectionPlugin/yoloDetectionPlugin.h"
+#endif
 
+#ifdef PLUGIN_FAMILY_MASKRCNN
 #include "batchTilePlugin/batchTilePlugin.h"
 #include "detectionLayerPlugin/detectionLayerPlugin.h"
 #include "proposalLayerPlugin/proposalLayerPlugin.h"
 #include "pyramidROIAlignPlugin/pyramidROIAlignPlugin.h"
 #include "resizeNearestPlugin/resizeNearestPlugin.h"
 #include "specialSlicePlugin/specialSlicePlugin.h"
+#endif
+
+#ifdef PLUGIN_FAMILY_MISC
 #include "instanceNormalizationPlugin/instanceNormalizationPlugin.h"
+#include "embeddingBagPlugin/embeddingBagPlugin.h"
+#include "embeddingBagPlugin/dotProductTopKPlugin.h"
+#include "ctcDecoderPlugin/ctcDecoderPlugin.h"
+#include "softmaxTopKPlugin/softmaxTopKPlugin.h"
+#endif
 
+#ifdef PLUGIN_FAMILY_DETECTION
 using nvinfer1::plugin::RPROIParams;
+#endif
 
 namespace nvinfer1
 {
@@ -149,6 +176,7 @@ void initializePlugin(void* logger, const char* libNamespace)
 extern "C" {
 bool initLibNvInferPlugins(void* logger, const char* libNamespace)
 {
+#ifdef PLUGIN_FAMILY_DETECTION
     initializePlugin<nvinfer1::plugin::GridAnchorPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::NMSPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::ReorgPluginCreator>(logger, libNamespace);
@@ -156,17 +184,65 @@ bool initLibNvInferPlugins(void* logger, const char* libNamespace)
     initializePlugin<nvinfer1::plugin::PriorBoxPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::NormalizePluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::RPROIPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::FasterRCNNDetectionOutputPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::BatchedNMSPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::FlattenConcatPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::CropAndResizePluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::ProposalPluginCreator>(logger, libNamespace);
+#endif
+#ifdef PLUGIN_FAMILY_MASKRCNN
     initializePlugin<nvinfer1::plugin::BatchTilePluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::DetectionLayerPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::ProposalLayerPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::PyramidROIAlignPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::ResizeNearestPluginCreator>(logger, libNamespace);
     initializePlugin<nvinfer1::plugin::SpecialSlicePluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::DetectionLayerDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::ProposalLayerDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::PyramidROIAlignDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::ResizeNearestDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::SpecialSliceDynamicPluginCreator>(logger, libNamespace);
+#endif
+#ifdef PLUGIN_FAMILY_MISC
     initializePlugin<nvinfer1::plugin::InstanceNormalizationPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::EmbeddingBagPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::DotProductTopKPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::CTCDecoderPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::SoftmaxTopKPluginCreator>(logger, libNamespace);
+#endif
+#ifdef PLUGIN_FAMILY_DETECTION
+    initializePlugin<nvinfer1::plugin::YoloDetectionPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::NMSDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::BatchedNMSDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::PriorBoxDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::GridAnchorDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::NormalizeDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::RegionDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::RPROIDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::FasterRCNNDetectionOutputDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::CropAndResizeDynamicPluginCreator>(logger, libNamespace);
+    initializePlugin<nvinfer1::plugin::ProposalDynamicPluginCreator>(logger, libNamespace);
+#endif
     return true;
 }
+
+void setLibNvInferPluginsGpuAllocator(nvinfer1::IGpuAllocator* allocator)
+{
+    nvinfer1::plugin::setPluginGpuAllocator(allocator);
+}
+
+bool loadLibNvInferPluginsGemmAlgoCache(const char* path)
+{
+    return nvinfer1::plugin::loadGemmAlgoCache(path);
+}
+
+bool saveLibNvInferPluginsGemmAlgoCache(const char* path)
+{
+    return nvinfer1::plugin::saveGemmAlgoCache(path);
+}
+
+void setLibNvInferPluginsEnqueueTimer(void (*timer)(const char* pluginType, const char* layerName, float microseconds))
+{
+    nvinfer1::plugin::gEnqueueTimer.store(timer);
+}
 } // extern "C"
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "batchTilePlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <cassert>
 #include <cuda_runtime.h>
 #include <iostream>
@@ -95,6 +98,9 @@ DataType BatchTilePlugin::getOutputDataType(int index, const nvinfer1::DataType*
 
 int BatchTilePlugin::enqueue(int batchSize, const void* const* inputs, void** outputs, void*, cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
     float* output = reinterpret_cast<float*>(outputs[0]);
     // expand to batch size
     for (int i = 0; i < batchSize; i++)
@@ -15,6 +15,7 @@
  */
 #include "bboxUtils.h"
 #include "cuda_runtime_api.h"
+#include "fusedNMS.h"
 #include "gatherNMSOutputs.h"
 #include "kernel.h"
 #include "nmsUtils.h"
@@ -25,6 +26,14 @@ pluginStatus_t nmsInference(cudaStream_t stream, const int N, const int perBatch
     const void* locData, const DataType DT_SCORE, const void* confData, void* keepCount, void* nmsedBoxes,
     void* nmsedScores, void* nmsedClasses, void* workspace, bool isNormalized, bool confSigmoid, bool clipBoxes)
 {
+    // Small configurations select, suppress and gather in two kernels straight from the inputs
+    if (fusedNMSSupported(shareLocation, numClasses, topK, keepTopK, confSigmoid))
+    {
+        return fusedNMS(stream, N, numPredsPerClass, numClasses, topK, keepTopK, backgroundLabelId, scoreThreshold,
+            iouThreshold, isNormalized, clipBoxes, DT_BBOX, locData, DT_SCORE, confData, keepCount, nmsedBoxes,
+            nmsedScores, nmsedClasses, workspace);
+    }
+
     // locCount = batch_size * number_boxes_per_sample * 4
     const int locCount = N * perBatchBoxesSize;
     /*
@@ -36,20 +45,38 @@ pluginStatus_t nmsInference(cudaStream_t stream, const int N, const int perBatch
      */
     const int numLocClasses = shareLocation ? 1 : numClasses;
 
+    /*
+     * The boxes, scores and indices are live until the outputs are gathered, see detectionInferenceWorkspaceSize.
+     * The region after them is reused by the buffers with shorter lifetimes.
+     */
     size_t bboxDataSize = detectionForwardBBoxDataSize(N, perBatchBoxesSize, DataType::kFLOAT);
-    void* bboxDataRaw = workspace;
-    cudaMemcpyAsync(bboxDataRaw, locData, bboxDataSize, cudaMemcpyDeviceToDevice, stream);
+    size_t totalScoresSize = detectionForwardPreNMSSize(N, perBatchScoresSize);
+    size_t indicesSize = detectionForwardPreNMSSize(N, perBatchScoresSize);
+    void* bboxData = workspace;
+    void* scores = nextWorkspacePtr((int8_t*) bboxData, bboxDataSize);
+    void* indices = nextWorkspacePtr((int8_t*) scores, totalScoresSize);
+    void* transient = nextWorkspacePtr((int8_t*) indices, indicesSize);
+
+    // Boxes that are not shared are brought into the transient region, then permuted into bboxData
+    void* bboxDataRaw = shareLocation ? bboxData : transient;
     pluginStatus_t status;
+    if (DT_BBOX == DataType::kFLOAT)
+    {
+        cudaMemcpyAsync(bboxDataRaw, locData, bboxDataSize, cudaMemcpyDeviceToDevice, stream);
+    }
+    else
+    {
+        // The rest of the pipeline works on FP32 boxes: widen them with an identity permutation
+        status = permuteData(
+            stream, locCount, 1, perBatchBoxesSize / 4, 4, DT_BBOX, false, locData, bboxDataRaw);
+        ASSERT_FAILURE(status == STATUS_SUCCESS);
+    }
 
     /*
      * bboxDataRaw format:
      * [batch size, numPriors (per sample), numLocClasses, 4]
      */
     // float for now
-    void* bboxData;
-    size_t bboxPermuteSize = detectionForwardBBoxPermuteSize(shareLocation, N, perBatchBoxesSize, DataType::kFLOAT);
-    void* bboxPermute = nextWorkspacePtr((int8_t*) bboxDataRaw, bboxDataSize);
-
     /*
      * After permutation, bboxData format:
      * [batch_size, numLocClasses, numPriors (per sample) (numPredsPerClass), 4]
@@ -58,26 +85,19 @@ pluginStatus_t nmsInference(cudaStream_t stream, const int N, const int perBatch
     if (!shareLocation)
     {
         status = permuteData(
-            stream, locCount, numLocClasses, numPredsPerClass, 4, DataType::kFLOAT, false, bboxDataRaw, bboxPermute);
+            stream, locCount, numLocClasses, numPredsPerClass, 4, DataType::kFLOAT, false, bboxDataRaw, bboxData);
         ASSERT_FAILURE(status == STATUS_SUCCESS);
-        bboxData = bboxPermute;
     }
     /*
      * If shareLocation, numLocClasses = 1
      * No need to permute data on linear memory
      */
-    else
-    {
-        bboxData = bboxDataRaw;
-    }
 
     /*
      * Conf data format
      * [batch size, numPriors * param.numClasses, 1, 1]
      */
     const int numScores = N * perBatchScoresSize;
-    size_t totalScoresSize = detectionForwardPreNMSSize(N, perBatchScoresSize);
-    void* scores = nextWorkspacePtr((int8_t*) bboxPermute, bboxPermuteSize);
 
     // need a conf_scores
     /*
@@ -85,21 +105,19 @@ pluginStatus_t nmsInference(cudaStream_t stream, const int N, const int perBatch
      * [batch_size, numClasses, numPredsPerClass, 1]
      */
     status = permuteData(
-        stream, numScores, numClasses, numPredsPerClass, 1, DataType::kFLOAT, confSigmoid, confData, scores);
+        stream, numScores, numClasses, numPredsPerClass, 1, DT_SCORE, confSigmoid, confData, scores);
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
-    size_t indicesSize = detectionForwardPreNMSSize(N, perBatchScoresSize);
-    void* indices = nextWorkspacePtr((int8_t*) scores, totalScoresSize);
-
+    // The per-class sort workspace is dead once the NMS starts writing its outputs over it
     size_t postNMSScoresSize = detectionForwardPostNMSSize(N, numClasses, topK);
     size_t postNMSIndicesSize = detectionForwardPostNMSSize(N, numClasses, topK);
-    void* postNMSScores = nextWorkspacePtr((int8_t*) indices, indicesSize);
+    void* sortingWorkspace = transient;
+    void* postNMSScores = transient;
     void* postNMSIndices = nextWorkspacePtr((int8_t*) postNMSScores, postNMSScoresSize);
-
-    void* sortingWorkspace = nextWorkspacePtr((int8_t*) postNMSIndices, postNMSIndicesSize);
-    // Sort the scores so that the following NMS could be applied.
-    status = sortScoresPerClass(stream, N, numClasses, numPredsPerClass, backgroundLabelId, scoreThreshold,
-        DataType::kFLOAT, scores, indices, sortingWorkspace);
+    void* nmsWorkspace = nextWorkspacePtr((int8_t*) postNMSIndices, postNMSIndicesSize);
+    // Sort the scores so that the following NMS could be applied, only the candidates above the threshold are sorted
+    status = sortScoresPerClass(stream, N, numClasses, numPredsPerClass, topK, backgroundLabelId, scoreThreshold,
+        DataType::kFLOAT, scores, indices, sortingWorkspace, true);
 
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
@@ -108,17 +126,18 @@ pluginStatus_t nmsInference(cudaStream_t stream, const int N, const int perBatch
     bool flipXY = true;
     // NMS
     status = allClassNMS(stream, N, numClasses, numPredsPerClass, topK, iouThreshold, shareLocation, isNormalized,
-        DataType::kFLOAT, DataType::kFLOAT, bboxData, scores, indices, postNMSScores, postNMSIndices, flipXY);
+        DataType::kFLOAT, DataType::kFLOAT, bboxData, scores, indices, postNMSScores, postNMSIndices, nmsWorkspace,
+        flipXY);
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
     // Sort the bounding boxes after NMS using scores
-    status = sortScoresPerImage(stream, N, numClasses * topK, DataType::kFLOAT, postNMSScores, postNMSIndices, scores,
-        indices, sortingWorkspace);
+    status = sortScoresPerImage(stream, N, numClasses * topK, keepTopK, DataType::kFLOAT, postNMSScores,
+        postNMSIndices, scores, indices, nmsWorkspace);
 
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
-    // Gather data from the sorted bounding boxes after NMS
-    status = gatherNMSOutputs(stream, shareLocation, N, numPredsPerClass, numClasses, topK, keepTopK, DataType::kFLOAT,
+    // Gather data from the sorted bounding boxes after NMS, the outputs have the type of the input boxes
+    status = gatherNMSOutputs(stream, shareLocation, N, numPredsPerClass, numClasses, topK, keepTopK, DT_BBOX,
         DataType::kFLOAT, indices, scores, bboxData, keepCount, nmsedBoxes, nmsedScores, nmsedClasses, clipBoxes);
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
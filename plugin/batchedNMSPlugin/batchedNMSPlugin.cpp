@@ -15,6 +15,10 @@
  */
 
 #include "batchedNMSPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include "batchedNMSPlugin/fusedNMS.h"
 #include <algorithm>
 #include <cstring>
 #include <iostream>
@@ -22,6 +26,8 @@
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::BatchedNMSDynamicPlugin;
+using nvinfer1::plugin::BatchedNMSDynamicPluginCreator;
 using nvinfer1::plugin::BatchedNMSPlugin;
 using nvinfer1::plugin::BatchedNMSPluginCreator;
 using nvinfer1::plugin::NMSParameters;
@@ -30,10 +36,81 @@ namespace
 {
 const char* NMS_PLUGIN_VERSION{"1"};
 const char* NMS_PLUGIN_NAME{"BatchedNMS_TRT"};
+const char* NMS_DYNAMIC_PLUGIN_VERSION{"1"};
+const char* NMS_DYNAMIC_PLUGIN_NAME{"BatchedNMSDynamic_TRT"};
+
+// Fields shared by BatchedNMS_TRT and BatchedNMSDynamic_TRT
+void addNMSPluginFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("shareLocation", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("backgroundLabelId", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("numClasses", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("topK", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("keepTopK", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("scoreThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("iouThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("isNormalized", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("clipBoxes", nullptr, PluginFieldType::kINT32, 1));
+}
+
+void parseNMSPluginFields(const PluginFieldCollection* fc, NMSParameters& params, bool& clipBoxes)
+{
+    const PluginField* fields = fc->fields;
+    clipBoxes = true;
+
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "shareLocation"))
+        {
+            params.shareLocation = *(static_cast<const bool*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "backgroundLabelId"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.backgroundLabelId = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "numClasses"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.numClasses = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "topK"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.topK = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "keepTopK"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.keepTopK = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "scoreThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.scoreThreshold = *(static_cast<const float*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "iouThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.iouThreshold = *(static_cast<const float*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "isNormalized"))
+        {
+            params.isNormalized = *(static_cast<const bool*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "clipBoxes"))
+        {
+            clipBoxes = *(static_cast<const bool*>(fields[i].data));
+        }
+    }
+}
 } // namespace
 
 PluginFieldCollection BatchedNMSPluginCreator::mFC{};
 std::vector<PluginField> BatchedNMSPluginCreator::mPluginAttributes;
+PluginFieldCollection BatchedNMSDynamicPluginCreator::mFC{};
+std::vector<PluginField> BatchedNMSDynamicPluginCreator::mPluginAttributes;
 
 BatchedNMSPlugin::BatchedNMSPlugin(NMSParameters params)
     : param(params)
@@ -48,6 +125,11 @@ BatchedNMSPlugin::BatchedNMSPlugin(const void* data, size_t length)
     scoresSize = read<int>(d);
     numPriors = read<int>(d);
     mClipBoxes = read<bool>(d);
+    // Precision of the inputs, absent from engines serialized before FP16 support
+    if (d < a + length)
+    {
+        mPrecision = read<DataType>(d);
+    }
     ASSERT(d == a + length);
 }
 
@@ -94,13 +176,20 @@ Dims BatchedNMSPlugin::getOutputDimensions(int index, const Dims* inputs, int nb
 
 size_t BatchedNMSPlugin::getWorkspaceSize(int maxBatchSize) const
 {
+    if (fusedNMSSupported(param.shareLocation, param.numClasses, param.topK, param.keepTopK, false))
+    {
+        return fusedNMSWorkspaceSize(maxBatchSize, param.numClasses, param.topK);
+    }
     return detectionInferenceWorkspaceSize(param.shareLocation, maxBatchSize, boxesSize, scoresSize, param.numClasses,
-        numPriors, param.topK, DataType::kFLOAT, DataType::kFLOAT);
+        numPriors, param.topK, DataType::kFLOAT, DataType::kFLOAT, true);
 }
 
 int BatchedNMSPlugin::enqueue(
     int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     const void* const locData = inputs[0];
     const void* const confData = inputs[1];
 
@@ -111,16 +200,16 @@ int BatchedNMSPlugin::enqueue(
 
     pluginStatus_t status = nmsInference(stream, batchSize, boxesSize, scoresSize, param.shareLocation,
         param.backgroundLabelId, numPriors, param.numClasses, param.topK, param.keepTopK, param.scoreThreshold,
-        param.iouThreshold, DataType::kFLOAT, locData, DataType::kFLOAT, confData, keepCount, nmsedBoxes, nmsedScores,
-        nmsedClasses, workspace, param.isNormalized, false, mClipBoxes);
+        param.iouThreshold, mPrecision, locData, mPrecision, confData, keepCount, nmsedBoxes, nmsedScores, nmsedClasses,
+        workspace, param.isNormalized, false, mClipBoxes);
     ASSERT(status == STATUS_SUCCESS);
     return 0;
 }
 
 size_t BatchedNMSPlugin::getSerializationSize() const
 {
-    // NMSParameters, boxesSize,scoresSize,numPriors
-    return sizeof(NMSParameters) + sizeof(int) * 3 + sizeof(bool);
+    // NMSParameters, boxesSize,scoresSize,numPriors,mClipBoxes,mPrecision
+    return sizeof(NMSParameters) + sizeof(int) * 3 + sizeof(bool) + sizeof(DataType);
 }
 
 void BatchedNMSPlugin::serialize(void* buffer) const
@@ -131,6 +220,7 @@ void BatchedNMSPlugin::serialize(void* buffer) const
     write(d, scoresSize);
     write(d, numPriors);
     write(d, mClipBoxes);
+    write(d, mPrecision);
     ASSERT(d == a + getSerializationSize());
 }
 
@@ -153,11 +243,15 @@ void BatchedNMSPlugin::configurePlugin(const Dims* inputDims, int nbInputs, cons
     // Third dimension of boxes must be either 1 or num_classes
     ASSERT(inputDims[0].d[1] == numLocClasses);
     ASSERT(inputDims[0].d[2] == 4);
+    // Boxes and scores share the same precision, the outputs other than num_detections follow it
+    ASSERT(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF);
+    mPrecision = inputTypes[0];
 }
 
 bool BatchedNMSPlugin::supportsFormat(DataType type, PluginFormat format) const
 {
-    return ((type == DataType::kFLOAT || type == DataType::kINT32) && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF || type == DataType::kINT32)
+        && format == PluginFormat::kNCHW);
 }
 const char* BatchedNMSPlugin::getPluginType() const
 {
@@ -180,6 +274,7 @@ IPluginV2Ext* BatchedNMSPlugin::clone() const
     plugin->boxesSize = boxesSize;
     plugin->scoresSize = scoresSize;
     plugin->numPriors = numPriors;
+    plugin->mPrecision = mPrecision;
     plugin->setPluginNamespace(mNamespace.c_str());
     plugin->setClipParam(mClipBoxes);
     return plugin;
@@ -220,18 +315,211 @@ bool BatchedNMSPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
     return false;
 }
 
+BatchedNMSDynamicPlugin::BatchedNMSDynamicPlugin(NMSParameters params)
+    : param(params)
+{
+}
+
+BatchedNMSDynamicPlugin::BatchedNMSDynamicPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    param = read<NMSParameters>(d);
+    mClipBoxes = read<bool>(d);
+    mPrecision = read<DataType>(d);
+    ASSERT(d == a + length);
+}
+
+int BatchedNMSDynamicPlugin::getNbOutputs() const
+{
+    return 4;
+}
+
+int BatchedNMSDynamicPlugin::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void BatchedNMSDynamicPlugin::terminate() {}
+
+DimsExprs BatchedNMSDynamicPlugin::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(outputIndex >= 0 && outputIndex < this->getNbOutputs());
+    ASSERT(inputs[0].nbDims == 4);
+    ASSERT(inputs[1].nbDims == 3 || inputs[1].nbDims == 4);
+
+    // Inputs: boxes [batch_size, number_boxes, number_classes, 4], scores [batch_size, number_boxes, number_classes]
+    DimsExprs out;
+    out.d[0] = inputs[0].d[0];
+    // num_detections
+    if (outputIndex == 0)
+    {
+        out.nbDims = 2;
+        out.d[1] = exprBuilder.constant(1);
+    }
+    // nmsed_boxes
+    else if (outputIndex == 1)
+    {
+        out.nbDims = 3;
+        out.d[1] = exprBuilder.constant(param.keepTopK);
+        out.d[2] = exprBuilder.constant(4);
+    }
+    // nmsed_scores or nmsed_classes
+    else
+    {
+        out.nbDims = 2;
+        out.d[1] = exprBuilder.constant(param.keepTopK);
+    }
+    return out;
+}
+
+size_t BatchedNMSDynamicPlugin::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const int batchSize = inputs[0].dims.d[0];
+    const int boxesSize = inputs[0].dims.d[1] * inputs[0].dims.d[2] * inputs[0].dims.d[3];
+    const int scoresSize = inputs[1].dims.d[1] * inputs[1].dims.d[2];
+    const int numPriors = inputs[0].dims.d[1];
+    if (fusedNMSSupported(param.shareLocation, param.numClasses, param.topK, param.keepTopK, false))
+    {
+        return fusedNMSWorkspaceSize(batchSize, param.numClasses, param.topK);
+    }
+    return detectionInferenceWorkspaceSize(param.shareLocation, batchSize, boxesSize, scoresSize, param.numClasses,
+        numPriors, param.topK, DataType::kFLOAT, DataType::kFLOAT, true);
+}
+
+int BatchedNMSDynamicPlugin::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    const int batchSize = inputDesc[0].dims.d[0];
+    const int boxesSize = inputDesc[0].dims.d[1] * inputDesc[0].dims.d[2] * inputDesc[0].dims.d[3];
+    const int scoresSize = inputDesc[1].dims.d[1] * inputDesc[1].dims.d[2];
+    const int numPriors = inputDesc[0].dims.d[1];
+
+    const void* const locData = inputs[0];
+    const void* const confData = inputs[1];
+
+    void* keepCount = outputs[0];
+    void* nmsedBoxes = outputs[1];
+    void* nmsedScores = outputs[2];
+    void* nmsedClasses = outputs[3];
+
+    pluginStatus_t status = nmsInference(stream, batchSize, boxesSize, scoresSize, param.shareLocation,
+        param.backgroundLabelId, numPriors, param.numClasses, param.topK, param.keepTopK, param.scoreThreshold,
+        param.iouThreshold, mPrecision, locData, mPrecision, confData, keepCount, nmsedBoxes, nmsedScores, nmsedClasses,
+        workspace, param.isNormalized, false, mClipBoxes);
+    ASSERT(status == STATUS_SUCCESS);
+    return 0;
+}
+
+size_t BatchedNMSDynamicPlugin::getSerializationSize() const
+{
+    // NMSParameters, mClipBoxes, mPrecision
+    return sizeof(NMSParameters) + sizeof(bool) + sizeof(DataType);
+}
+
+void BatchedNMSDynamicPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, param);
+    write(d, mClipBoxes);
+    write(d, mPrecision);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void BatchedNMSDynamicPlugin::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(nbOutputs == 4);
+    ASSERT(in[0].desc.dims.nbDims == 4);
+    ASSERT(in[1].desc.dims.nbDims == 3 || (in[1].desc.dims.nbDims == 4 && in[1].desc.dims.d[3] == 1));
+
+    const int numLocClasses = param.shareLocation ? 1 : param.numClasses;
+    // Third dimension of boxes must be either 1 or num_classes, -1 until the dimensions are known
+    ASSERT(in[0].desc.dims.d[2] == numLocClasses || in[0].desc.dims.d[2] == -1);
+    ASSERT(in[0].desc.dims.d[3] == 4 || in[0].desc.dims.d[3] == -1);
+    mPrecision = in[0].desc.type;
+}
+
+bool BatchedNMSDynamicPlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 2 && nbOutputs == 4 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    // num_detections
+    if (pos == nbInputs)
+    {
+        return inOut[pos].type == DataType::kINT32;
+    }
+    // Boxes decide the precision, the scores and the other outputs follow it
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* BatchedNMSDynamicPlugin::getPluginType() const
+{
+    return NMS_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* BatchedNMSDynamicPlugin::getPluginVersion() const
+{
+    return NMS_DYNAMIC_PLUGIN_VERSION;
+}
+
+void BatchedNMSDynamicPlugin::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* BatchedNMSDynamicPlugin::clone() const
+{
+    auto* plugin = new BatchedNMSDynamicPlugin(param);
+    plugin->mPrecision = mPrecision;
+    plugin->setClipParam(mClipBoxes);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+void BatchedNMSDynamicPlugin::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* BatchedNMSDynamicPlugin::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+nvinfer1::DataType BatchedNMSDynamicPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    if (index == 0)
+    {
+        return nvinfer1::DataType::kINT32;
+    }
+    return inputTypes[0];
+}
+
+void BatchedNMSDynamicPlugin::setClipParam(bool clip)
+{
+    mClipBoxes = clip;
+}
+
 BatchedNMSPluginCreator::BatchedNMSPluginCreator()
     : params{}
 {
-    mPluginAttributes.emplace_back(PluginField("shareLocation", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("backgroundLabelId", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("numClasses", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("topK", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("keepTopK", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("scoreThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("iouThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("isNormalized", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("clipBoxes", nullptr, PluginFieldType::kINT32, 1));
+    addNMSPluginFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -254,55 +542,7 @@ const PluginFieldCollection* BatchedNMSPluginCreator::getFieldNames()
 
 IPluginV2Ext* BatchedNMSPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    mClipBoxes = true;
-
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "shareLocation"))
-        {
-            params.shareLocation = *(static_cast<const bool*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "backgroundLabelId"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.backgroundLabelId = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "numClasses"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.numClasses = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "topK"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.topK = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "keepTopK"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.keepTopK = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "scoreThreshold"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.scoreThreshold = *(static_cast<const float*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "iouThreshold"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.iouThreshold = *(static_cast<const float*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "isNormalized"))
-        {
-            params.isNormalized = *(static_cast<const bool*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "clipBoxes"))
-        {
-            mClipBoxes = *(static_cast<const bool*>(fields[i].data));
-        }
-    }
+    parseNMSPluginFields(fc, params, mClipBoxes);
 
     BatchedNMSPlugin* plugin = new BatchedNMSPlugin(params);
     plugin->setClipParam(mClipBoxes);
@@ -318,3 +558,46 @@ IPluginV2Ext* BatchedNMSPluginCreator::deserializePlugin(const char* name, const
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
+
+BatchedNMSDynamicPluginCreator::BatchedNMSDynamicPluginCreator()
+{
+    addNMSPluginFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* BatchedNMSDynamicPluginCreator::getPluginName() const
+{
+    return NMS_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* BatchedNMSDynamicPluginCreator::getPluginVersion() const
+{
+    return NMS_DYNAMIC_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* BatchedNMSDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* BatchedNMSDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    NMSParameters params{};
+    bool clipBoxes;
+    parseNMSPluginFields(fc, params, clipBoxes);
+
+    BatchedNMSDynamicPlugin* plugin = new BatchedNMSDynamicPlugin(params);
+    plugin->setClipParam(clipBoxes);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* BatchedNMSDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    BatchedNMSDynamicPlugin* plugin = new BatchedNMSDynamicPlugin(serialData, serialLength);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
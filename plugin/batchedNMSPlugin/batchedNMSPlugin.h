@@ -88,9 +88,68 @@ private:
     int numPriors{};
     std::string mNamespace;
     bool mClipBoxes{};
+    DataType mPrecision{DataType::kFLOAT};
     const char* mPluginNamespace;
 };
 
+// Explicit batch version of BatchedNMSPlugin. The batch is the first dimension of all the tensors and the number of
+// boxes may change between optimization profiles, so that one engine covers several input resolutions.
+class BatchedNMSDynamicPlugin : public IPluginV2DynamicExt
+{
+public:
+    BatchedNMSDynamicPlugin(NMSParameters param);
+
+    BatchedNMSDynamicPlugin(const void* data, size_t length);
+
+    ~BatchedNMSDynamicPlugin() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    nvinfer1::DataType getOutputDataType(int index, const nvinfer1::DataType* inputType, int nbInputs) const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    void setClipParam(bool clip);
+
+private:
+    NMSParameters param{};
+    bool mClipBoxes{};
+    DataType mPrecision{DataType::kFLOAT};
+    std::string mNamespace;
+};
+
 class BatchedNMSPluginCreator : public BaseCreator
 {
 public:
@@ -114,6 +173,28 @@ private:
     static std::vector<PluginField> mPluginAttributes;
     bool mClipBoxes;
 };
+
+class BatchedNMSDynamicPluginCreator : public BaseCreator
+{
+public:
+    BatchedNMSDynamicPluginCreator();
+
+    ~BatchedNMSDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
 } // namespace plugin
 } // namespace nvinfer1
 
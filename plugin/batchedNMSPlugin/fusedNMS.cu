@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "bboxUtils.h"
+#include "bitmaskNMS.h"
+#include "fusedNMS.h"
+#include "kernel.h"
+#include <cfloat>
+#include <climits>
+#include <cuda_fp16.h>
+#include <vector>
+
+namespace
+{
+const int kFusedMaxClasses = 100;
+const int kFusedMaxTopK = 512;
+const int kFusedMaxKeepTopK = 200;
+// Capacity of the per-image selection, a power of two >= kFusedMaxKeepTopK
+const int kFusedKeepCapacity = 256;
+const int kFusedThreads = 256;
+} // namespace
+
+// Maps a float to an unsigned key with the same ordering, so that it can be selected digit by digit
+__device__ inline unsigned orderedKey(float f)
+{
+    const unsigned u = __float_as_uint(f);
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+// Candidate a comes before candidate b: higher score first, lower index first among equal scores as the stable
+// segmented sorts of the unfused path do
+__device__ inline bool precedes(float sa, int ia, float sb, int ib)
+{
+    return sa > sb || (sa == sb && ia < ib);
+}
+
+/*
+ * Selects the (at most) k best of the n candidates exposed by load, and stores them sorted into sScores/sIdx.
+ * load(i, score) returns false for the candidates to ignore. The k-th best key is found with a 4 pass radix select
+ * over a 256 bin shared histogram, which stops as soon as all the valid candidates fit. The selected candidates are
+ * then bitonic sorted in shared memory. Returns the number of selected candidates, identical for all threads.
+ */
+template <int TPB, int CAP, typename Loader>
+__device__ int blockSelectTopK(const Loader& load, const int n, const int k, float* sScores, int* sIdx)
+{
+    __shared__ unsigned sHist[256];
+    __shared__ unsigned sPrefix;
+    __shared__ int sRemaining;
+    __shared__ int sNumValid;
+    __shared__ int sNumAbove;
+    __shared__ int sNumTied;
+
+    unsigned prefix = 0;
+    unsigned mask = 0;
+    int remaining = k;
+    bool selectAll = false;
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        for (int i = threadIdx.x; i < 256; i += TPB)
+        {
+            sHist[i] = 0;
+        }
+        __syncthreads();
+        for (int i = threadIdx.x; i < n; i += TPB)
+        {
+            float score;
+            if (load(i, score))
+            {
+                const unsigned key = orderedKey(score);
+                if ((key & mask) == prefix)
+                {
+                    atomicAdd(&sHist[(key >> shift) & 0xFF], 1u);
+                }
+            }
+        }
+        __syncthreads();
+        if (threadIdx.x == 0)
+        {
+            if (shift == 24)
+            {
+                int total = 0;
+                for (int d = 0; d < 256; ++d)
+                {
+                    total += sHist[d];
+                }
+                sNumValid = total;
+            }
+            // Find the digit of the k-th best key, counting the candidates with a higher digit
+            int above = 0;
+            int d = 255;
+            for (; d > 0; --d)
+            {
+                if (above + static_cast<int>(sHist[d]) >= remaining)
+                {
+                    break;
+                }
+                above += sHist[d];
+            }
+            sRemaining = remaining - above;
+            sPrefix = prefix | (static_cast<unsigned>(d) << shift);
+        }
+        __syncthreads();
+        if (sNumValid <= k)
+        {
+            selectAll = true;
+            break;
+        }
+        remaining = sRemaining;
+        prefix = sPrefix;
+        mask |= 0xFFu << shift;
+    }
+
+    // prefix is now the k-th best key: keep the keys above it and fill the remaining slots with the ties
+    const int count = min(sNumValid, k);
+    for (int i = threadIdx.x; i < CAP; i += TPB)
+    {
+        if (i >= count)
+        {
+            sScores[i] = -FLT_MAX;
+            sIdx[i] = INT_MAX;
+        }
+    }
+    if (threadIdx.x == 0)
+    {
+        sNumAbove = 0;
+        sNumTied = 0;
+    }
+    __syncthreads();
+    for (int i = threadIdx.x; i < n; i += TPB)
+    {
+        float score;
+        if (load(i, score))
+        {
+            const unsigned key = orderedKey(score);
+            int slot = -1;
+            if (selectAll || key > prefix)
+            {
+                slot = atomicAdd(&sNumAbove, 1);
+            }
+            else if (key == prefix)
+            {
+                const int tie = atomicAdd(&sNumTied, 1);
+                slot = tie < remaining ? k - remaining + tie : -1;
+            }
+            if (slot >= 0)
+            {
+                sScores[slot] = score;
+                sIdx[slot] = i;
+            }
+        }
+    }
+    __syncthreads();
+
+    // Bitonic sort of the CAP slots, padding slots sort last
+    for (int size = 2; size <= CAP; size <<= 1)
+    {
+        for (int stride = size / 2; stride > 0; stride >>= 1)
+        {
+            for (int i = threadIdx.x; i < CAP / 2; i += TPB)
+            {
+                const int lo = 2 * i - (i & (stride - 1));
+                const int hi = lo + stride;
+                const bool forward = (lo & size) == 0;
+                if (precedes(sScores[hi], sIdx[hi], sScores[lo], sIdx[lo]) == forward)
+                {
+                    const float s = sScores[lo];
+                    sScores[lo] = sScores[hi];
+                    sScores[hi] = s;
+                    const int idx = sIdx[lo];
+                    sIdx[lo] = sIdx[hi];
+                    sIdx[hi] = idx;
+                }
+            }
+            __syncthreads();
+        }
+    }
+    return count;
+}
+
+template <typename T_BBOX>
+__device__ inline float4 loadBox(const T_BBOX* boxes, const int idx)
+{
+    return make_float4(static_cast<float>(boxes[idx * 4]), static_cast<float>(boxes[idx * 4 + 1]),
+        static_cast<float>(boxes[idx * 4 + 2]), static_cast<float>(boxes[idx * 4 + 3]));
+}
+
+// Scores of one class of one image, read in place from the [N, numPredsPerClass, numClasses] input
+template <typename T_SCORE>
+struct ClassScoreLoader
+{
+    const T_SCORE* scores;
+    int numClasses;
+    float threshold;
+
+    __device__ bool operator()(const int i, float& score) const
+    {
+        score = static_cast<float>(scores[i * numClasses]);
+        return score > threshold;
+    }
+};
+
+// Kept candidates of all the classes of one image, candidate i is the i % topK-th of class i / topK
+struct ImageScoreLoader
+{
+    const float* scores;
+    const int* keptCount;
+    int topK;
+
+    __device__ bool operator()(const int i, float& score) const
+    {
+        const int rank = i % topK;
+        if (rank >= keptCount[i / topK])
+        {
+            return false;
+        }
+        score = scores[i];
+        return true;
+    }
+};
+
+// One block per (class, image): top-K selection followed by a bitmask NMS. Writes the kept candidates in score order
+// to the [N, numClasses, topK] keptScores/keptIndices arrays and their number to keptCount.
+template <typename T_BBOX, typename T_SCORE, int TPB, int CAP>
+__launch_bounds__(TPB) __global__ void fusedClassNMS_kernel(const int numPredsPerClass, const int numClasses,
+    const int topK, const int backgroundLabelId, const float scoreThreshold, const float iouThreshold,
+    const bool isNormalized, const T_BBOX* locData, const T_SCORE* confData, float* keptScores, int* keptIndices,
+    int* keptCount)
+{
+    const int kWords = CAP / 32;
+    __shared__ float sScores[CAP];
+    __shared__ int sIdx[CAP];
+    __shared__ NMSBox sBoxes[CAP];
+    __shared__ unsigned sSuppressed[CAP * kWords];
+
+    const int classId = blockIdx.x;
+    const int imageId = blockIdx.y;
+    const int segment = imageId * numClasses + classId;
+    if (classId == backgroundLabelId)
+    {
+        if (threadIdx.x == 0)
+        {
+            keptCount[segment] = 0;
+        }
+        return;
+    }
+
+    ClassScoreLoader<T_SCORE> load;
+    load.scores = confData + imageId * numPredsPerClass * numClasses + classId;
+    load.numClasses = numClasses;
+    load.threshold = scoreThreshold;
+    const int count = blockSelectTopK<TPB, CAP>(load, numPredsPerClass, topK, sScores, sIdx);
+
+    const T_BBOX* boxes = locData + imageId * numPredsPerClass * 4;
+    // The overlap is symmetric in x and y, so the [ymin, xmin, ymax, xmax] boxes of BatchedNMS need no flip
+    for (int i = threadIdx.x; i < count; i += TPB)
+    {
+        sBoxes[i] = decodeNMSBox<NMSBoxEncoding::kCornerXY>(boxes + sIdx[i] * 4);
+    }
+    __syncthreads();
+
+    // Bit j of row i: candidate j (after i) overlaps candidate i above the threshold
+    const int numWords = (count + 31) / 32;
+    const float pad = isNormalized ? 0.f : 1.f;
+    for (int t = threadIdx.x; t < count * numWords; t += TPB)
+    {
+        const int i = t / numWords;
+        const int word = t - i * numWords;
+        unsigned bits = 0;
+        for (int b = 0; b < 32; ++b)
+        {
+            const int j = word * 32 + b;
+            if (j > i && j < count && nmsIoU(sBoxes[i], sBoxes[j], pad) > iouThreshold)
+            {
+                bits |= 1u << b;
+            }
+        }
+        sSuppressed[i * kWords + word] = bits;
+    }
+    __syncthreads();
+
+    // Greedy sweep in score order by a single warp, lane w holds word w of the suppressed set
+    if (threadIdx.x < 32)
+    {
+        const int lane = threadIdx.x;
+        float* outScores = keptScores + segment * topK;
+        int* outIndices = keptIndices + segment * topK;
+        unsigned suppressed = 0;
+        int kept = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            const unsigned word = __shfl_sync(0xFFFFFFFF, suppressed, i / 32);
+            if (!(word & (1u << (i % 32))))
+            {
+                if (lane == 0)
+                {
+                    outScores[kept] = sScores[i];
+                    outIndices[kept] = sIdx[i];
+                }
+                if (lane < numWords)
+                {
+                    suppressed |= sSuppressed[i * kWords + lane];
+                }
+                ++kept;
+            }
+        }
+        if (lane == 0)
+        {
+            keptCount[segment] = kept;
+        }
+    }
+}
+
+// One block per image: selects the keepTopK best kept candidates over all the classes and writes the outputs
+template <typename T_BBOX, int TPB, int CAP>
+__launch_bounds__(TPB) __global__ void fusedGatherNMS_kernel(const int numPredsPerClass, const int numClasses,
+    const int topK, const int keepTopK, const bool clipBoxes, const T_BBOX* locData, const float* keptScores,
+    const int* keptIndices, const int* keptCount, int* numDetections, T_BBOX* nmsedBoxes, T_BBOX* nmsedScores,
+    T_BBOX* nmsedClasses)
+{
+    __shared__ float sScores[CAP];
+    __shared__ int sIdx[CAP];
+    __shared__ int sKeptCount[kFusedMaxClasses];
+
+    const int imageId = blockIdx.x;
+    for (int c = threadIdx.x; c < numClasses; c += TPB)
+    {
+        sKeptCount[c] = keptCount[imageId * numClasses + c];
+    }
+    __syncthreads();
+
+    const int offset = imageId * numClasses * topK;
+    ImageScoreLoader load;
+    load.scores = keptScores + offset;
+    load.keptCount = sKeptCount;
+    load.topK = topK;
+    const int count = blockSelectTopK<TPB, CAP>(load, numClasses * topK, keepTopK, sScores, sIdx);
+
+    const T_BBOX* boxes = locData + imageId * numPredsPerClass * 4;
+    for (int det = threadIdx.x; det < keepTopK; det += TPB)
+    {
+        const int i = imageId * keepTopK + det;
+        if (det < count)
+        {
+            const int candidate = sIdx[det];
+            float4 box = loadBox(boxes, keptIndices[offset + candidate]);
+            if (clipBoxes)
+            {
+                box.x = max(min(box.x, 1.f), 0.f);
+                box.y = max(min(box.y, 1.f), 0.f);
+                box.z = max(min(box.z, 1.f), 0.f);
+                box.w = max(min(box.w, 1.f), 0.f);
+            }
+            nmsedClasses[i] = T_BBOX(float(candidate / topK));
+            nmsedScores[i] = T_BBOX(sScores[det]);
+            nmsedBoxes[i * 4] = T_BBOX(box.x);
+            nmsedBoxes[i * 4 + 1] = T_BBOX(box.y);
+            nmsedBoxes[i * 4 + 2] = T_BBOX(box.z);
+            nmsedBoxes[i * 4 + 3] = T_BBOX(box.w);
+        }
+        else
+        {
+            nmsedClasses[i] = T_BBOX(-1.f);
+            nmsedScores[i] = T_BBOX(0.f);
+            nmsedBoxes[i * 4] = T_BBOX(0.f);
+            nmsedBoxes[i * 4 + 1] = T_BBOX(0.f);
+            nmsedBoxes[i * 4 + 2] = T_BBOX(0.f);
+            nmsedBoxes[i * 4 + 3] = T_BBOX(0.f);
+        }
+    }
+    if (threadIdx.x == 0)
+    {
+        numDetections[imageId] = count;
+    }
+}
+
+template <typename T_BBOX, typename T_SCORE>
+pluginStatus_t fusedNMS_gpu(cudaStream_t stream, const int N, const int numPredsPerClass, const int numClasses,
+    const int topK, const int keepTopK, const int backgroundLabelId, const float scoreThreshold,
+    const float iouThreshold, const bool isNormalized, const bool clipBoxes, const void* locData,
+    const void* confData, void* keepCount, void* nmsedBoxes, void* nmsedScores, void* nmsedClasses, void* workspace)
+{
+    const size_t keptSize = detectionForwardPostNMSSize(N, numClasses, topK);
+    void* keptScores = workspace;
+    void* keptIndices = nextWorkspacePtr((int8_t*) keptScores, keptSize);
+    void* keptCount = nextWorkspacePtr((int8_t*) keptIndices, keptSize);
+
+#define P(cap) fusedClassNMS_kernel<T_BBOX, T_SCORE, kFusedThreads, (cap)>
+    void (*kernel[3])(const int, const int, const int, const int, const float, const float, const bool,
+        const T_BBOX*, const T_SCORE*, float*, int*, int*)
+        = {P(128), P(256), P(512)};
+#undef P
+    const int capIdx = topK <= 128 ? 0 : (topK <= 256 ? 1 : 2);
+    const dim3 classGrid(numClasses, N);
+    kernel[capIdx]<<<classGrid, kFusedThreads, 0, stream>>>(numPredsPerClass, numClasses, topK, backgroundLabelId,
+        scoreThreshold, iouThreshold, isNormalized, (const T_BBOX*) locData, (const T_SCORE*) confData,
+        (float*) keptScores, (int*) keptIndices, (int*) keptCount);
+
+    fusedGatherNMS_kernel<T_BBOX, kFusedThreads, kFusedKeepCapacity><<<N, kFusedThreads, 0, stream>>>(
+        numPredsPerClass, numClasses, topK, keepTopK, clipBoxes, (const T_BBOX*) locData,
+        (const float*) keptScores, (const int*) keptIndices, (const int*) keptCount, (int*) keepCount,
+        (T_BBOX*) nmsedBoxes, (T_BBOX*) nmsedScores, (T_BBOX*) nmsedClasses);
+
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
+}
+
+// fusedNMS LAUNCH CONFIG {{{
+typedef pluginStatus_t (*fusedNMSFunc)(cudaStream_t, const int, const int, const int, const int, const int,
+    const int, const float, const float, const bool, const bool, const void*, const void*, void*, void*, void*,
+    void*, void*);
+
+struct fusedNMSLaunchConfig
+{
+    DataType t_bbox;
+    DataType t_score;
+    fusedNMSFunc function;
+
+    fusedNMSLaunchConfig(DataType t_bbox, DataType t_score)
+        : t_bbox(t_bbox)
+        , t_score(t_score)
+    {
+    }
+    fusedNMSLaunchConfig(DataType t_bbox, DataType t_score, fusedNMSFunc function)
+        : t_bbox(t_bbox)
+        , t_score(t_score)
+        , function(function)
+    {
+    }
+    bool operator==(const fusedNMSLaunchConfig& other)
+    {
+        return t_bbox == other.t_bbox && t_score == other.t_score;
+    }
+};
+
+static std::vector<fusedNMSLaunchConfig> fusedNMSFuncVec;
+bool fusedNMSInit()
+{
+    fusedNMSFuncVec.push_back(
+        fusedNMSLaunchConfig(DataType::kFLOAT, DataType::kFLOAT, fusedNMS_gpu<float, float>));
+    fusedNMSFuncVec.push_back(
+        fusedNMSLaunchConfig(DataType::kHALF, DataType::kHALF, fusedNMS_gpu<__half, __half>));
+    return true;
+}
+
+static bool initialized = fusedNMSInit();
+//}}}
+
+bool fusedNMSSupported(bool shareLocation, int numClasses, int topK, int keepTopK, bool confSigmoid)
+{
+    return shareLocation && !confSigmoid && numClasses <= kFusedMaxClasses && topK <= kFusedMaxTopK
+        && keepTopK <= kFusedMaxKeepTopK && keepTopK <= topK;
+}
+
+size_t fusedNMSWorkspaceSize(int N, int numClasses, int topK)
+{
+    size_t wss[3];
+    wss[0] = detectionForwardPostNMSSize(N, numClasses, topK);
+    wss[1] = detectionForwardPostNMSSize(N, numClasses, topK);
+    wss[2] = N * numClasses * sizeof(int);
+    return calculateTotalWorkspaceSize(wss, 3);
+}
+
+pluginStatus_t fusedNMS(cudaStream_t stream, const int N, const int numPredsPerClass, const int numClasses,
+    const int topK, const int keepTopK, const int backgroundLabelId, const float scoreThreshold,
+    const float iouThreshold, const bool isNormalized, const bool clipBoxes, const DataType DT_BBOX,
+    const void* locData, const DataType DT_SCORE, const void* confData, void* keepCount, void* nmsedBoxes,
+    void* nmsedScores, void* nmsedClasses, void* workspace)
+{
+    fusedNMSLaunchConfig lc(DT_BBOX, DT_SCORE);
+    for (unsigned i = 0; i < fusedNMSFuncVec.size(); ++i)
+    {
+        if (lc == fusedNMSFuncVec[i])
+        {
+            DEBUG_PRINTF("fusedNMS kernel %d\n", i);
+            return fusedNMSFuncVec[i].function(stream, N, numPredsPerClass, numClasses, topK, keepTopK,
+                backgroundLabelId, scoreThreshold, iouThreshold, isNormalized, clipBoxes, locData, confData, keepCount,
+                nmsedBoxes, nmsedScores, nmsedClasses, workspace);
+        }
+    }
+    return STATUS_BAD_PARAM;
+}
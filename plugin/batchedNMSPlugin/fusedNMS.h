@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_BATCHED_NMS_FUSED_H
+#define TRT_BATCHED_NMS_FUSED_H
+#include "plugin.h"
+using namespace nvinfer1;
+using namespace nvinfer1::plugin;
+
+// Whether the fused top-K + NMS path handles this configuration. It covers shared boxes, up to 100 classes,
+// topK <= 512 and keepTopK <= min(topK, 200), without sigmoid on the scores.
+bool fusedNMSSupported(bool shareLocation, int numClasses, int topK, int keepTopK, bool confSigmoid);
+
+size_t fusedNMSWorkspaceSize(int N, int numClasses, int topK);
+
+// Selects the topK best candidates of every class in shared memory, suppresses them with a bitmask IoU NMS, then
+// selects and gathers the keepTopK best detections of every image. Boxes and scores are read directly from the plugin
+// inputs, the outputs have the type of the boxes.
+pluginStatus_t fusedNMS(cudaStream_t stream, int N, int numPredsPerClass, int numClasses, int topK, int keepTopK,
+    int backgroundLabelId, float scoreThreshold, float iouThreshold, bool isNormalized, bool clipBoxes,
+    DataType DT_BBOX, const void* locData, DataType DT_SCORE, const void* confData, void* keepCount,
+    void* nmsedBoxes, void* nmsedScores, void* nmsedClasses, void* workspace);
+
+#endif
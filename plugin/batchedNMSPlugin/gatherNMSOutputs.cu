@@ -16,9 +16,10 @@
 #include "kernel.h"
 #include "plugin.h"
 #include "gatherNMSOutputs.h"
+#include <cuda_fp16.h>
 #include <vector>
 
-template <typename T_BBOX, typename T_SCORE, unsigned nthds_per_cta>
+template <typename T_BBOX, typename T_SCORE, typename T_OUT, unsigned nthds_per_cta>
 __launch_bounds__(nthds_per_cta)
     __global__ void gatherNMSOutputs_kernel(
         const bool shareLocation,
@@ -31,9 +32,9 @@ __launch_bounds__(nthds_per_cta)
         const T_SCORE* scores,
         const T_BBOX* bboxData,
         int* numDetections,
-        T_BBOX* nmsedBoxes,
-        T_BBOX* nmsedScores,
-        T_BBOX* nmsedClasses,
+        T_OUT* nmsedBoxes,
+        T_OUT* nmsedScores,
+        T_OUT* nmsedClasses,
         bool clipBoxes
         )
 {
@@ -50,38 +51,38 @@ __launch_bounds__(nthds_per_cta)
         const T_SCORE score = scores[offset + detId];
         if (index == -1)
         {
-            nmsedClasses[i] = -1;
-            nmsedScores[i] = 0;
-            nmsedBoxes[i * 4] = 0;
-            nmsedBoxes[i * 4 + 1] = 0;
-            nmsedBoxes[i * 4 + 2] = 0;
-            nmsedBoxes[i * 4 + 3] = 0;
+            nmsedClasses[i] = T_OUT(-1.f);
+            nmsedScores[i] = T_OUT(0.f);
+            nmsedBoxes[i * 4] = T_OUT(0.f);
+            nmsedBoxes[i * 4 + 1] = T_OUT(0.f);
+            nmsedBoxes[i * 4 + 2] = T_OUT(0.f);
+            nmsedBoxes[i * 4 + 3] = T_OUT(0.f);
         }
         else
         {
             const int bboxOffset = imgId * (shareLocation ? numPredsPerClass : (numClasses * numPredsPerClass));
             const int bboxId = ((shareLocation ? (index % numPredsPerClass)
                         : index % (numClasses * numPredsPerClass)) + bboxOffset) * 4;
-            nmsedClasses[i] = (index % (numClasses * numPredsPerClass)) / numPredsPerClass; // label
-            nmsedScores[i] = score;                                                        // confidence score
+            nmsedClasses[i] = T_OUT(float((index % (numClasses * numPredsPerClass)) / numPredsPerClass)); // label
+            nmsedScores[i] = T_OUT(float(score));                                                        // confidence score
             // clipped bbox xmin
-            nmsedBoxes[i * 4] = clipBoxes ? max(min(bboxData[bboxId],
-                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId];
+            nmsedBoxes[i * 4] = T_OUT(float(clipBoxes ? max(min(bboxData[bboxId],
+                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId]));
             // clipped bbox ymin
-            nmsedBoxes[i * 4 + 1] = clipBoxes ? max(min(bboxData[bboxId + 1],
-                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId + 1];
+            nmsedBoxes[i * 4 + 1] = T_OUT(float(clipBoxes ? max(min(bboxData[bboxId + 1],
+                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId + 1]));
             // clipped bbox xmax
-            nmsedBoxes[i * 4 + 2] = clipBoxes ? max(min(bboxData[bboxId + 2],
-                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId + 2];
+            nmsedBoxes[i * 4 + 2] = T_OUT(float(clipBoxes ? max(min(bboxData[bboxId + 2],
+                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId + 2]));
             // clipped bbox ymax
-            nmsedBoxes[i * 4 + 3] = clipBoxes ? max(min(bboxData[bboxId + 3],
-                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId + 3];
+            nmsedBoxes[i * 4 + 3] = T_OUT(float(clipBoxes ? max(min(bboxData[bboxId + 3],
+                        T_BBOX(1.)), T_BBOX(0.)) : bboxData[bboxId + 3]));
             atomicAdd(&numDetections[i / keepTopK], 1);
         }
     }
 }
 
-template <typename T_BBOX, typename T_SCORE>
+template <typename T_BBOX, typename T_SCORE, typename T_OUT>
 pluginStatus_t gatherNMSOutputs_gpu(
     cudaStream_t stream,
     const bool shareLocation,
@@ -103,13 +104,13 @@ pluginStatus_t gatherNMSOutputs_gpu(
     cudaMemsetAsync(numDetections, 0, numImages * sizeof(int), stream);
     const int BS = 32;
     const int GS = 32;
-    gatherNMSOutputs_kernel<T_BBOX, T_SCORE, BS><<<GS, BS, 0, stream>>>(shareLocation, numImages, numPredsPerClass,
+    gatherNMSOutputs_kernel<T_BBOX, T_SCORE, T_OUT, BS><<<GS, BS, 0, stream>>>(shareLocation, numImages, numPredsPerClass,
                                                                            numClasses, topK, keepTopK,
                                                                            (int*) indices, (T_SCORE*) scores, (T_BBOX*) bboxData,
                                                                            (int*) numDetections,
-                                                                           (T_BBOX*) nmsedBoxes, 
-                                                                           (T_BBOX*) nmsedScores, 
-                                                                           (T_BBOX*) nmsedClasses,
+                                                                           (T_OUT*) nmsedBoxes,
+                                                                           (T_OUT*) nmsedScores,
+                                                                           (T_OUT*) nmsedClasses,
                                                                            clipBoxes
                                                                             );
 
@@ -163,7 +164,10 @@ static std::vector<nmsOutLaunchConfig> nmsOutFuncVec;
 bool nmsOutputInit()
 {
     nmsOutFuncVec.push_back(nmsOutLaunchConfig(DataType::kFLOAT, DataType::kFLOAT,
-                                         gatherNMSOutputs_gpu<float, float>));
+                                         gatherNMSOutputs_gpu<float, float, float>));
+    // FP16 outputs, gathered from the FP32 boxes and scores of the workspace
+    nmsOutFuncVec.push_back(nmsOutLaunchConfig(DataType::kHALF, DataType::kFLOAT,
+                                         gatherNMSOutputs_gpu<float, float, __half>));
     return true;
 }
 
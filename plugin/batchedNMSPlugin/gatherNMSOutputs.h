@@ -19,6 +19,8 @@
 using namespace nvinfer1;
 using namespace nvinfer1::plugin;
 
+// DT_BBOX is the type of the outputs, DT_SCORE the type of the scores in the workspace. Half outputs are gathered from
+// FP32 boxes and scores.
 pluginStatus_t gatherNMSOutputs(cudaStream_t stream, bool shareLocation, int numImages, int numPredsPerClass,
     int numClasses, int topK, int keepTopK, DataType DT_BBOX, DataType DT_SCORE, const void* indices,
     const void* scores, const void* bboxData, void* keepCount, void* nmsedBoxes, void* nmsedScores, void* nmsedClasses,
@@ -0,0 +1,1116 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Micro-benchmark of the plugins of libnvinfer_plugin, without a network.
+//
+// Each benchmark of the parameter file creates a plugin from its registered creator, and calls configurePlugin,
+// initialize and enqueue directly on synthetic device tensors, for every point of a grid of input shapes, precisions
+// and formats. The median enqueue time of each point is reported with the bandwidth of its input and output tensors,
+// and the FLOP rate when the benchmark gives the FLOPs per output element, against the peaks of the device. Results
+// can be exported to CSV and compared against an earlier export to catch regressions.
+//
+//     nvinfer_plugin_benchmark --params=plugins.txt --export=results.csv
+//     nvinfer_plugin_benchmark --params=plugins.txt --baseline=results.csv --tolerance=5
+//
+// See plugins.txt, next to this file, for the parameter file syntax.
+
+#include "NvInfer.h"
+#include "NvInferPlugin.h"
+#include "common.h"
+#include "half.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cuda_runtime_api.h>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace nvinfer1;
+
+namespace
+{
+
+std::vector<std::string> split(const std::string& s, char separator)
+{
+    std::vector<std::string> splitted;
+    std::istringstream is(s);
+    std::string item;
+    while (std::getline(is, item, separator))
+    {
+        splitted.push_back(item);
+    }
+    return splitted;
+}
+
+Dims parseShape(const std::string& s)
+{
+    Dims dims{};
+    for (const auto& d : split(s, 'x'))
+    {
+        if (dims.nbDims == Dims::MAX_DIMS)
+        {
+            throw std::invalid_argument("Too many dimensions in shape " + s);
+        }
+        dims.d[dims.nbDims++] = std::stoi(d);
+    }
+    return dims;
+}
+
+std::string shapeToString(const Dims& dims)
+{
+    std::string s;
+    for (int i = 0; i < dims.nbDims; ++i)
+    {
+        s += (i ? "x" : "") + std::to_string(dims.d[i]);
+    }
+    return s;
+}
+
+DataType parseDataType(const std::string& s)
+{
+    if (s == "fp32")
+    {
+        return DataType::kFLOAT;
+    }
+    if (s == "fp16")
+    {
+        return DataType::kHALF;
+    }
+    if (s == "int8")
+    {
+        return DataType::kINT8;
+    }
+    if (s == "int32")
+    {
+        return DataType::kINT32;
+    }
+    throw std::invalid_argument("Invalid precision " + s);
+}
+
+const char* dataTypeToString(DataType type)
+{
+    switch (type)
+    {
+    case DataType::kFLOAT: return "fp32";
+    case DataType::kHALF: return "fp16";
+    case DataType::kINT8: return "int8";
+    case DataType::kINT32: return "int32";
+    case DataType::kBOOL: return "bool";
+    }
+    return "unknown";
+}
+
+const std::map<std::string, TensorFormat> kFormats{{"linear", TensorFormat::kLINEAR}, {"chw2", TensorFormat::kCHW2},
+    {"hwc8", TensorFormat::kHWC8}, {"chw4", TensorFormat::kCHW4}, {"chw16", TensorFormat::kCHW16},
+    {"chw32", TensorFormat::kCHW32}};
+
+TensorFormat parseFormat(const std::string& s)
+{
+    const auto format = kFormats.find(s);
+    if (format == kFormats.end())
+    {
+        throw std::invalid_argument("Invalid format " + s);
+    }
+    return format->second;
+}
+
+const char* formatToString(TensorFormat format)
+{
+    for (const auto& f : kFormats)
+    {
+        if (f.second == format)
+        {
+            return f.first.c_str();
+        }
+    }
+    return "unknown";
+}
+
+//! Channels a vectorized format pads the channel dimension to
+int formatVector(TensorFormat format)
+{
+    switch (format)
+    {
+    case TensorFormat::kLINEAR: return 1;
+    case TensorFormat::kCHW2: return 2;
+    case TensorFormat::kCHW4: return 4;
+    case TensorFormat::kHWC8: return 8;
+    case TensorFormat::kCHW16: return 16;
+    case TensorFormat::kCHW32: return 32;
+    }
+    return 1;
+}
+
+//! Bytes of a tensor, the channel dimension of a CHW tensor is padded to the vector of its format
+size_t tensorBytes(const Dims& dims, DataType type, TensorFormat format)
+{
+    Dims padded = dims;
+    if (padded.nbDims >= 3)
+    {
+        const int c = padded.nbDims - 3;
+        padded.d[c] = samplesCommon::divUp(padded.d[c], formatVector(format)) * formatVector(format);
+    }
+    return samplesCommon::volume(padded) * samplesCommon::getElementSize(type);
+}
+
+struct FieldSpec
+{
+    std::string name;
+    PluginFieldType type;
+    std::vector<std::string> values;
+};
+
+struct InputSpec
+{
+    //! Floating point inputs take the precision of the grid point
+    bool floating{true};
+    DataType type{DataType::kFLOAT};
+    std::vector<Dims> shapes;
+    float min{-1};
+    float max{1};
+};
+
+struct BenchmarkSpec
+{
+    std::string plugin;
+    std::string version;
+    int line{0};
+    std::vector<FieldSpec> fields;
+    std::vector<InputSpec> inputs;
+    std::vector<DataType> precisions{DataType::kFLOAT};
+    std::vector<TensorFormat> formats{TensorFormat::kLINEAR};
+    float flops{0};
+};
+
+PluginFieldType parseFieldType(const std::string& s)
+{
+    const std::map<std::string, PluginFieldType> types{{"float16", PluginFieldType::kFLOAT16},
+        {"float32", PluginFieldType::kFLOAT32}, {"float64", PluginFieldType::kFLOAT64},
+        {"int8", PluginFieldType::kINT8}, {"int16", PluginFieldType::kINT16}, {"int32", PluginFieldType::kINT32},
+        {"char", PluginFieldType::kCHAR}};
+    const auto type = types.find(s);
+    if (type == types.end())
+    {
+        throw std::invalid_argument("Invalid field type " + s);
+    }
+    return type->second;
+}
+
+//! Parses "field=name:type:values", the values are comma separated and "N*v" repeats v N times
+FieldSpec parseField(const std::string& s)
+{
+    const auto parts = split(s, ':');
+    if (parts.size() != 3)
+    {
+        throw std::invalid_argument("Invalid field " + s);
+    }
+    FieldSpec field{parts[0], parseFieldType(parts[1]), {}};
+    if (field.type == PluginFieldType::kCHAR)
+    {
+        field.values.push_back(parts[2]);
+        return field;
+    }
+    for (const auto& v : split(parts[2], ','))
+    {
+        const auto repeat = v.find('*');
+        const int count = repeat == std::string::npos ? 1 : std::stoi(v.substr(0, repeat));
+        field.values.insert(
+            field.values.end(), count, repeat == std::string::npos ? v : v.substr(repeat + 1));
+    }
+    return field;
+}
+
+//! Parses "input=type:shape[,shape...][:min:max]", type "float" follows the precisions of the grid
+InputSpec parseInput(const std::string& s)
+{
+    const auto parts = split(s, ':');
+    if (parts.size() != 2 && parts.size() != 4)
+    {
+        throw std::invalid_argument("Invalid input " + s);
+    }
+    InputSpec input;
+    input.floating = parts[0] == "float";
+    if (!input.floating)
+    {
+        input.type = parseDataType(parts[0]);
+        input.min = 0;
+    }
+    for (const auto& shape : split(parts[1], ','))
+    {
+        input.shapes.push_back(parseShape(shape));
+    }
+    if (parts.size() == 4)
+    {
+        input.min = std::stof(parts[2]);
+        input.max = std::stof(parts[3]);
+    }
+    return input;
+}
+
+std::vector<BenchmarkSpec> parseBenchmarks(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        throw std::invalid_argument("Could not open parameter file " + fileName);
+    }
+    std::vector<BenchmarkSpec> benchmarks;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find('#'));
+        line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
+        if (line.empty())
+        {
+            continue;
+        }
+        const auto equal = line.find('=');
+        const std::string key = line.substr(0, equal);
+        const std::string value = equal == std::string::npos ? "" : line.substr(equal + 1);
+        const std::string where = fileName + ":" + std::to_string(lineNumber) + ": ";
+        try
+        {
+            if (key == "plugin")
+            {
+                const auto colon = value.find(':');
+                BenchmarkSpec benchmark;
+                benchmark.plugin = value.substr(0, colon);
+                benchmark.version = colon == std::string::npos ? "1" : value.substr(colon + 1);
+                benchmark.line = lineNumber;
+                benchmarks.push_back(benchmark);
+                continue;
+            }
+            if (benchmarks.empty())
+            {
+                throw std::invalid_argument("Benchmarks start with plugin=");
+            }
+            auto& benchmark = benchmarks.back();
+            if (key == "field")
+            {
+                benchmark.fields.push_back(parseField(value));
+            }
+            else if (key == "input")
+            {
+                benchmark.inputs.push_back(parseInput(value));
+            }
+            else if (key == "precisions")
+            {
+                benchmark.precisions.clear();
+                for (const auto& p : split(value, ','))
+                {
+                    benchmark.precisions.push_back(parseDataType(p));
+                }
+            }
+            else if (key == "formats")
+            {
+                benchmark.formats.clear();
+                for (const auto& f : split(value, ','))
+                {
+                    benchmark.formats.push_back(parseFormat(f));
+                }
+            }
+            else if (key == "flops")
+            {
+                benchmark.flops = std::stof(value);
+            }
+            else
+            {
+                throw std::invalid_argument("Unknown key " + key);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            throw std::invalid_argument(where + e.what());
+        }
+    }
+    return benchmarks;
+}
+
+//! Field data of a plugin, "$type" values are replaced by the precision of the grid point
+class PluginFields
+{
+public:
+    PluginFields(const std::vector<FieldSpec>& specs, DataType precision)
+    {
+        for (const auto& spec : specs)
+        {
+            std::vector<double> values;
+            for (const auto& v : spec.values)
+            {
+                values.push_back(v == "$type" ? static_cast<int>(precision) : std::stod(v));
+            }
+            mData.emplace_back();
+            auto& data = mData.back();
+            int length = static_cast<int>(values.size());
+            switch (spec.type)
+            {
+            case PluginFieldType::kFLOAT16: store<half_float::half>(values, data); break;
+            case PluginFieldType::kFLOAT32: store<float>(values, data); break;
+            case PluginFieldType::kFLOAT64: store<double>(values, data); break;
+            case PluginFieldType::kINT8: store<int8_t>(values, data); break;
+            case PluginFieldType::kINT16: store<int16_t>(values, data); break;
+            case PluginFieldType::kINT32: store<int32_t>(values, data); break;
+            case PluginFieldType::kCHAR:
+                data.assign(spec.values[0].begin(), spec.values[0].end());
+                data.push_back('\0');
+                length = static_cast<int>(spec.values[0].size());
+                break;
+            case PluginFieldType::kDIMS:
+            case PluginFieldType::kUNKNOWN: break;
+            }
+            mFields.emplace_back(spec.name.c_str(), data.data(), spec.type, length);
+        }
+        mCollection.nbFields = static_cast<int>(mFields.size());
+        mCollection.fields = mFields.data();
+    }
+
+    const PluginFieldCollection* collection() const
+    {
+        return &mCollection;
+    }
+
+private:
+    template <typename T>
+    static void store(const std::vector<double>& values, std::vector<char>& data)
+    {
+        data.resize(values.size() * sizeof(T));
+        T* typed = reinterpret_cast<T*>(data.data());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            typed[i] = static_cast<T>(static_cast<float>(values[i]));
+        }
+    }
+
+    std::deque<std::vector<char>> mData;
+    std::vector<PluginField> mFields;
+    PluginFieldCollection mCollection{};
+};
+
+class ConstantExpr : public IDimensionExpr
+{
+public:
+    explicit ConstantExpr(int value)
+        : mValue(value)
+    {
+    }
+
+    bool isConstant() const override
+    {
+        return true;
+    }
+
+    int getConstantValue() const override
+    {
+        return mValue;
+    }
+
+private:
+    int mValue;
+};
+
+//! The shapes of a benchmark are all known, so every expression of the plugin folds to a constant
+class ConstantExprBuilder : public IExprBuilder
+{
+public:
+    const IDimensionExpr* constant(int value) override
+    {
+        mExprs.emplace_back(value);
+        return &mExprs.back();
+    }
+
+    const IDimensionExpr* operation(DimensionOperation op, const IDimensionExpr& first,
+        const IDimensionExpr& second) override
+    {
+        const int a = first.getConstantValue();
+        const int b = second.getConstantValue();
+        switch (op)
+        {
+        case DimensionOperation::kSUM: return constant(a + b);
+        case DimensionOperation::kPROD: return constant(a * b);
+        case DimensionOperation::kMAX: return constant(std::max(a, b));
+        case DimensionOperation::kMIN: return constant(std::min(a, b));
+        case DimensionOperation::kSUB: return constant(a - b);
+        case DimensionOperation::kEQUAL: return constant(a == b);
+        case DimensionOperation::kLESS: return constant(a < b);
+        case DimensionOperation::kFLOOR_DIV: return constant(a / b - (a % b != 0 && (a < 0) != (b < 0)));
+        case DimensionOperation::kCEIL_DIV: return constant(samplesCommon::divUp(a, b));
+        }
+        return nullptr;
+    }
+
+    DimsExprs exprs(const Dims& dims)
+    {
+        DimsExprs exprs{};
+        exprs.nbDims = dims.nbDims;
+        for (int i = 0; i < dims.nbDims; ++i)
+        {
+            exprs.d[i] = constant(dims.d[i]);
+        }
+        return exprs;
+    }
+
+    static Dims dims(const DimsExprs& exprs)
+    {
+        Dims dims{};
+        dims.nbDims = exprs.nbDims;
+        for (int i = 0; i < exprs.nbDims; ++i)
+        {
+            dims.d[i] = exprs.d[i]->getConstantValue();
+        }
+        return dims;
+    }
+
+private:
+    std::deque<ConstantExpr> mExprs;
+};
+
+struct DeviceBuffer
+{
+    explicit DeviceBuffer(size_t size)
+    {
+        CHECK(cudaMalloc(&data, std::max(size, size_t(1))));
+    }
+
+    ~DeviceBuffer()
+    {
+        cudaFree(data);
+    }
+
+    DeviceBuffer(const DeviceBuffer&) = delete;
+    DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+
+    void* data{nullptr};
+};
+
+//! Fills a tensor with uniform values, the generator is seeded per benchmark for repeatable runs
+void fillInput(DeviceBuffer& buffer, size_t bytes, DataType type, float min, float max, std::mt19937& generator)
+{
+    std::uniform_real_distribution<float> distribution(min, max);
+    std::vector<char> host(bytes);
+    const size_t count = bytes / samplesCommon::getElementSize(type);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float v = distribution(generator);
+        switch (type)
+        {
+        case DataType::kFLOAT: reinterpret_cast<float*>(host.data())[i] = v; break;
+        case DataType::kHALF: reinterpret_cast<half_float::half*>(host.data())[i] = half_float::half(v); break;
+        case DataType::kINT8:
+            reinterpret_cast<int8_t*>(host.data())[i] = static_cast<int8_t>(std::max(-128.F, std::min(127.F, v)));
+            break;
+        case DataType::kINT32: reinterpret_cast<int32_t*>(host.data())[i] = static_cast<int32_t>(v); break;
+        case DataType::kBOOL: reinterpret_cast<bool*>(host.data())[i] = v > (min + max) / 2; break;
+        }
+    }
+    CHECK(cudaMemcpy(buffer.data, host.data(), bytes, cudaMemcpyHostToDevice));
+}
+
+struct DevicePeaks
+{
+    float bandwidth{0}; // GB/s
+    float fp32{0};      // GFLOP/s
+    float fp16{0};      // GFLOP/s, without tensor cores
+};
+
+DevicePeaks devicePeaks(int device)
+{
+    cudaDeviceProp properties;
+    CHECK(cudaGetDeviceProperties(&properties, device));
+    // FP32 lanes per SM, and whether half2 instructions double the FP16 rate
+    int lanes{64};
+    bool half2{true};
+    switch (properties.major)
+    {
+    case 3: lanes = 192; half2 = false; break;
+    case 5: lanes = 128; half2 = properties.minor == 3; break;
+    case 6: lanes = properties.minor == 0 ? 64 : 128; half2 = properties.minor != 1; break;
+    default: break;
+    }
+    DevicePeaks peaks;
+    peaks.bandwidth = 2.F * properties.memoryClockRate * (properties.memoryBusWidth / 8) / 1e6F;
+    peaks.fp32 = 2.F * lanes * properties.multiProcessorCount * properties.clockRate / 1e6F;
+    peaks.fp16 = half2 ? 2 * peaks.fp32 : peaks.fp32;
+    return peaks;
+}
+
+struct Result
+{
+    std::string plugin;
+    std::string point;
+    float ms{0};
+    float bandwidth{0};
+    float bandwidthPeak{0};
+    float flops{0};
+    float flopsPeak{0};
+
+    std::string key() const
+    {
+        return plugin + " " + point;
+    }
+};
+
+struct Options
+{
+    std::string params;
+    std::vector<std::string> plugins;
+    int iterations{100};
+    int warmup{10};
+    int device{0};
+    std::string exportFile;
+    std::string baseline;
+    float tolerance{10};
+};
+
+//! Tensors and plugin calls of one grid point, dispatched on the plugin interface
+class PluginRunner
+{
+public:
+    PluginRunner(IPluginV2& plugin, const std::vector<Dims>& inputDims, const std::vector<DataType>& inputTypes,
+        TensorFormat format)
+        : mPlugin(plugin)
+        , mVersion(static_cast<PluginVersion>(plugin.getTensorRTVersion() >> 24 & 0xFF))
+        , mFormat(format)
+    {
+        if (mVersion == PluginVersion::kV2)
+        {
+            throw std::invalid_argument("IPluginV2 plugins are not supported, their output types are not known");
+        }
+        auto& ext = static_cast<IPluginV2Ext&>(plugin);
+        // Implicit batch plugins take the first dimension of the shapes as batch size
+        mBatch = mVersion == PluginVersion::kV2_DYNAMICEXT ? 1 : inputDims[0].d[0];
+        for (size_t i = 0; i < inputDims.size(); ++i)
+        {
+            mInputs.push_back(desc(stripBatch(inputDims[i]), inputTypes[i]));
+        }
+
+        std::vector<Dims> dims;
+        for (const auto& in : mInputs)
+        {
+            dims.push_back(in.dims);
+        }
+        std::vector<DataType> types(inputTypes);
+        ConstantExprBuilder builder;
+        std::vector<DimsExprs> exprs;
+        for (const auto& d : dims)
+        {
+            exprs.push_back(builder.exprs(d));
+        }
+        for (int o = 0; o < plugin.getNbOutputs(); ++o)
+        {
+            const DataType type = ext.getOutputDataType(o, types.data(), static_cast<int>(types.size()));
+            const Dims outDims = mVersion == PluginVersion::kV2_DYNAMICEXT
+                ? ConstantExprBuilder::dims(static_cast<IPluginV2DynamicExt&>(plugin).getOutputDimensions(
+                    o, exprs.data(), static_cast<int>(exprs.size()), builder))
+                : plugin.getOutputDimensions(o, dims.data(), static_cast<int>(dims.size()));
+            mOutputs.push_back(desc(outDims, type));
+        }
+    }
+
+    //! \return The reason the plugin does not take the tensors, or an empty string
+    std::string configure()
+    {
+        std::vector<PluginTensorDesc> inOut(mInputs);
+        inOut.insert(inOut.end(), mOutputs.begin(), mOutputs.end());
+        const int nbInputs = static_cast<int>(mInputs.size());
+        const int nbOutputs = static_cast<int>(mOutputs.size());
+        for (int pos = 0; pos < nbInputs + nbOutputs; ++pos)
+        {
+            const auto& d = inOut[pos];
+            bool supported{false};
+            switch (mVersion)
+            {
+            case PluginVersion::kV2_DYNAMICEXT:
+                supported = static_cast<IPluginV2DynamicExt&>(mPlugin).supportsFormatCombination(
+                    pos, inOut.data(), nbInputs, nbOutputs);
+                break;
+            case PluginVersion::kV2_IOEXT:
+                supported = static_cast<IPluginV2IOExt&>(mPlugin).supportsFormatCombination(
+                    pos, inOut.data(), nbInputs, nbOutputs);
+                break;
+            default: supported = mPlugin.supportsFormat(d.type, d.format); break;
+            }
+            if (!supported)
+            {
+                return std::string(pos < nbInputs ? "input " : "output ")
+                    + std::to_string(pos < nbInputs ? pos : pos - nbInputs) + " " + dataTypeToString(d.type) + " "
+                    + formatToString(d.format) + " not supported";
+            }
+        }
+
+        switch (mVersion)
+        {
+        case PluginVersion::kV2_DYNAMICEXT:
+        {
+            const auto dynamic = [](const std::vector<PluginTensorDesc>& descs)
+            {
+                std::vector<DynamicPluginTensorDesc> dynamicDescs;
+                for (const auto& d : descs)
+                {
+                    dynamicDescs.push_back(DynamicPluginTensorDesc{d, d.dims, d.dims});
+                }
+                return dynamicDescs;
+            };
+            const auto in = dynamic(mInputs);
+            const auto out = dynamic(mOutputs);
+            auto& plugin = static_cast<IPluginV2DynamicExt&>(mPlugin);
+            plugin.configurePlugin(in.data(), nbInputs, out.data(), nbOutputs);
+            mWorkspace = plugin.getWorkspaceSize(mInputs.data(), nbInputs, mOutputs.data(), nbOutputs);
+            break;
+        }
+        case PluginVersion::kV2_IOEXT:
+            static_cast<IPluginV2IOExt&>(mPlugin).configurePlugin(
+                mInputs.data(), nbInputs, mOutputs.data(), nbOutputs);
+            mWorkspace = mPlugin.getWorkspaceSize(mBatch);
+            break;
+        default:
+        {
+            std::vector<Dims> inDims;
+            std::vector<Dims> outDims;
+            std::vector<DataType> inTypes;
+            std::vector<DataType> outTypes;
+            for (const auto& d : mInputs)
+            {
+                inDims.push_back(d.dims);
+                inTypes.push_back(d.type);
+            }
+            for (const auto& d : mOutputs)
+            {
+                outDims.push_back(d.dims);
+                outTypes.push_back(d.type);
+            }
+            std::unique_ptr<bool[]> inBroadcast(new bool[nbInputs]());
+            std::unique_ptr<bool[]> outBroadcast(new bool[nbOutputs]());
+            static_cast<IPluginV2Ext&>(mPlugin).configurePlugin(inDims.data(), nbInputs, outDims.data(), nbOutputs,
+                inTypes.data(), outTypes.data(), inBroadcast.get(), outBroadcast.get(), mFormat, mBatch);
+            mWorkspace = mPlugin.getWorkspaceSize(mBatch);
+            break;
+        }
+        }
+        return "";
+    }
+
+    int enqueue(const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+    {
+        if (mVersion == PluginVersion::kV2_DYNAMICEXT)
+        {
+            return static_cast<IPluginV2DynamicExt&>(mPlugin).enqueue(
+                mInputs.data(), mOutputs.data(), inputs, outputs, workspace, stream);
+        }
+        return mPlugin.enqueue(mBatch, inputs, const_cast<void**>(outputs), workspace, stream);
+    }
+
+    //! Bytes of a tensor for the whole batch
+    size_t bytes(const PluginTensorDesc& d) const
+    {
+        return tensorBytes(d.dims, d.type, d.format) * mBatch;
+    }
+
+    size_t elements(const PluginTensorDesc& d) const
+    {
+        return samplesCommon::volume(d.dims) * mBatch;
+    }
+
+    const std::vector<PluginTensorDesc>& inputs() const
+    {
+        return mInputs;
+    }
+
+    const std::vector<PluginTensorDesc>& outputs() const
+    {
+        return mOutputs;
+    }
+
+    size_t workspace() const
+    {
+        return mWorkspace;
+    }
+
+private:
+    Dims stripBatch(const Dims& dims) const
+    {
+        if (mVersion == PluginVersion::kV2_DYNAMICEXT)
+        {
+            return dims;
+        }
+        Dims item{};
+        item.nbDims = dims.nbDims - 1;
+        std::copy(dims.d + 1, dims.d + dims.nbDims, item.d);
+        return item;
+    }
+
+    PluginTensorDesc desc(const Dims& dims, DataType type) const
+    {
+        const bool floating = type == DataType::kFLOAT || type == DataType::kHALF || type == DataType::kINT8;
+        return PluginTensorDesc{dims, type, floating ? mFormat : TensorFormat::kLINEAR, 1.F};
+    }
+
+    IPluginV2& mPlugin;
+    PluginVersion mVersion;
+    TensorFormat mFormat;
+    int mBatch{1};
+    size_t mWorkspace{0};
+    std::vector<PluginTensorDesc> mInputs;
+    std::vector<PluginTensorDesc> mOutputs;
+};
+
+//! Times one grid point, returns false with the reason if the plugin does not run it
+bool runPoint(IPluginCreator& creator, const BenchmarkSpec& benchmark, size_t shape, DataType precision,
+    TensorFormat format, const Options& options, const DevicePeaks& peaks, Result& result, std::string& reason)
+{
+    const PluginFields fields(benchmark.fields, precision);
+    IPluginV2* plugin = creator.createPlugin(benchmark.plugin.c_str(), fields.collection());
+    if (!plugin)
+    {
+        reason = "creator returned no plugin";
+        return false;
+    }
+    std::unique_ptr<IPluginV2, void (*)(IPluginV2*)> holder(plugin, [](IPluginV2* p) { p->destroy(); });
+
+    std::vector<Dims> dims;
+    std::vector<DataType> types;
+    for (const auto& input : benchmark.inputs)
+    {
+        dims.push_back(input.shapes[std::min(shape, input.shapes.size() - 1)]);
+        types.push_back(input.floating ? precision : input.type);
+    }
+    PluginRunner runner(*plugin, dims, types, format);
+    reason = runner.configure();
+    if (!reason.empty())
+    {
+        return false;
+    }
+    if (plugin->initialize() != 0)
+    {
+        reason = "initialize failed";
+        return false;
+    }
+
+    std::mt19937 generator(benchmark.line);
+    std::vector<std::unique_ptr<DeviceBuffer>> buffers;
+    std::vector<const void*> inputs;
+    std::vector<void*> outputs;
+    size_t bytes{0};
+    for (size_t i = 0; i < runner.inputs().size(); ++i)
+    {
+        const auto& d = runner.inputs()[i];
+        buffers.emplace_back(new DeviceBuffer(runner.bytes(d)));
+        fillInput(*buffers.back(), runner.bytes(d), d.type, benchmark.inputs[i].min, benchmark.inputs[i].max,
+            generator);
+        inputs.push_back(buffers.back()->data);
+        bytes += runner.bytes(d);
+    }
+    size_t outputElements{0};
+    for (const auto& d : runner.outputs())
+    {
+        buffers.emplace_back(new DeviceBuffer(runner.bytes(d)));
+        outputs.push_back(buffers.back()->data);
+        bytes += runner.bytes(d);
+        outputElements += runner.elements(d);
+    }
+    DeviceBuffer workspace(runner.workspace());
+
+    cudaStream_t stream;
+    CHECK(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+    std::vector<cudaEvent_t> events(options.iterations + 1);
+    for (auto& e : events)
+    {
+        CHECK(cudaEventCreate(&e));
+    }
+    int status{0};
+    for (int w = 0; w < options.warmup && status == 0; ++w)
+    {
+        status = runner.enqueue(inputs.data(), outputs.data(), workspace.data, stream);
+    }
+    CHECK(cudaEventRecord(events[0], stream));
+    for (int i = 0; i < options.iterations && status == 0; ++i)
+    {
+        status = runner.enqueue(inputs.data(), outputs.data(), workspace.data, stream);
+        CHECK(cudaEventRecord(events[i + 1], stream));
+    }
+    CHECK(cudaStreamSynchronize(stream));
+    std::vector<float> times;
+    for (int i = 0; i < options.iterations && status == 0; ++i)
+    {
+        float ms{0};
+        CHECK(cudaEventElapsedTime(&ms, events[i], events[i + 1]));
+        times.push_back(ms);
+    }
+    for (auto& e : events)
+    {
+        cudaEventDestroy(e);
+    }
+    cudaStreamDestroy(stream);
+    plugin->terminate();
+    if (status != 0 || cudaGetLastError() != cudaSuccess)
+    {
+        reason = "enqueue failed";
+        return false;
+    }
+
+    std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+    const float ms = times[times.size() / 2];
+    const float flopsPeak = precision == DataType::kHALF ? peaks.fp16 : peaks.fp32;
+    result.plugin = benchmark.plugin + ":" + benchmark.version;
+    result.point.clear();
+    for (const auto& d : dims)
+    {
+        result.point += (result.point.empty() ? "" : ",") + shapeToString(d);
+    }
+    result.point += std::string(" ") + dataTypeToString(precision) + " " + formatToString(format);
+    result.ms = ms;
+    result.bandwidth = bytes / ms / 1e6F;
+    result.bandwidthPeak = 100 * result.bandwidth / peaks.bandwidth;
+    result.flops = benchmark.flops * outputElements / ms / 1e6F;
+    result.flopsPeak = 100 * result.flops / flopsPeak;
+    return true;
+}
+
+std::map<std::string, float> readBaseline(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        throw std::invalid_argument("Could not open baseline " + fileName);
+    }
+    std::map<std::string, float> baseline;
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line))
+    {
+        const auto columns = split(line, ';');
+        if (columns.size() >= 3)
+        {
+            baseline[columns[0] + " " + columns[1]] = std::stof(columns[2]);
+        }
+    }
+    return baseline;
+}
+
+void exportResults(const std::vector<Result>& results, const std::string& fileName)
+{
+    std::ofstream file(fileName);
+    file << "plugin;point;ms;GB/s;bandwidth%;GFLOP/s;flops%" << std::endl;
+    for (const auto& r : results)
+    {
+        file << r.plugin << ";" << r.point << ";" << r.ms << ";" << r.bandwidth << ";" << r.bandwidthPeak << ";"
+             << r.flops << ";" << r.flopsPeak << std::endl;
+    }
+    gLogInfo << "Results exported to " << fileName << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg(argv[i]);
+        const auto equal = arg.find('=');
+        const std::string key = arg.substr(0, equal);
+        const std::string value = equal == std::string::npos ? "" : arg.substr(equal + 1);
+        if (key == "--params")
+        {
+            options.params = value;
+        }
+        else if (key == "--plugins")
+        {
+            options.plugins = split(value, ',');
+        }
+        else if (key == "--iterations")
+        {
+            options.iterations = std::stoi(value);
+        }
+        else if (key == "--warmUp")
+        {
+            options.warmup = std::stoi(value);
+        }
+        else if (key == "--device")
+        {
+            options.device = std::stoi(value);
+        }
+        else if (key == "--export")
+        {
+            options.exportFile = value;
+        }
+        else if (key == "--baseline")
+        {
+            options.baseline = value;
+        }
+        else if (key == "--tolerance")
+        {
+            options.tolerance = std::stof(value);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return !options.params.empty() && options.iterations > 0 && options.warmup >= 0;
+}
+
+void printHelp()
+{
+    // clang-format off
+    std::cout << "Usage: nvinfer_plugin_benchmark --params=<file> [options]"                                          << std::endl <<
+                 "  --params=<file>        Benchmarks to run, see plugins.txt for the syntax"                          << std::endl <<
+                 "  --plugins=<names>      Run the benchmarks of the comma separated plugin names only"                << std::endl <<
+                 "  --iterations=N         Enqueues timed per grid point (default = 100)"                              << std::endl <<
+                 "  --warmUp=N             Enqueues before timing (default = 10)"                                      << std::endl <<
+                 "  --device=N             Device to run on (default = 0)"                                             << std::endl <<
+                 "  --export=<file>        Export the results to a CSV file"                                           << std::endl <<
+                 "  --baseline=<file>      Compare the times against an earlier export, fail on regressions"           << std::endl <<
+                 "  --tolerance=P          Percentage of slowdown over the baseline reported as regression (default = 10)" << std::endl;
+    // clang-format on
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    bool parsed{false};
+    try
+    {
+        parsed = parseOptions(argc, argv, options);
+    }
+    catch (const std::exception& e)
+    {
+        gLogError << e.what() << std::endl;
+    }
+    if (!parsed)
+    {
+        printHelp();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<BenchmarkSpec> benchmarks;
+    std::map<std::string, float> baseline;
+    try
+    {
+        benchmarks = parseBenchmarks(options.params);
+        if (!options.baseline.empty())
+        {
+            baseline = readBaseline(options.baseline);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        gLogError << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    CHECK(cudaSetDevice(options.device));
+    initLibNvInferPlugins(&gLogger.getTRTLogger(), "");
+    const DevicePeaks peaks = devicePeaks(options.device);
+    gLogInfo << "Device peaks: " << peaks.bandwidth << " GB/s, " << peaks.fp32 << " GFLOP/s FP32, " << peaks.fp16
+             << " GFLOP/s FP16" << std::endl;
+
+    std::vector<Result> results;
+    bool failed{false};
+    int regressions{0};
+    for (const auto& benchmark : benchmarks)
+    {
+        if (!options.plugins.empty()
+            && std::find(options.plugins.begin(), options.plugins.end(), benchmark.plugin) == options.plugins.end())
+        {
+            continue;
+        }
+        IPluginCreator* creator = getPluginRegistry()->getPluginCreator(benchmark.plugin.c_str(),
+            benchmark.version.c_str());
+        if (!creator || benchmark.inputs.empty())
+        {
+            gLogError << options.params << ":" << benchmark.line << ": "
+                      << (creator ? "no input" : "no creator registered") << " for " << benchmark.plugin << ":"
+                      << benchmark.version << std::endl;
+            failed = true;
+            continue;
+        }
+
+        size_t shapes{0};
+        for (const auto& input : benchmark.inputs)
+        {
+            shapes = std::max(shapes, input.shapes.size());
+        }
+        for (size_t s = 0; s < shapes; ++s)
+        {
+            for (const auto precision : benchmark.precisions)
+            {
+                for (const auto format : benchmark.formats)
+                {
+                    Result r;
+                    std::string reason;
+                    bool ran{false};
+                    try
+                    {
+                        ran = runPoint(*creator, benchmark, s, precision, format, options, peaks, r, reason);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        reason = e.what();
+                    }
+                    if (!ran)
+                    {
+                        gLogWarning << benchmark.plugin << ":" << benchmark.version << " shape " << s << " "
+                                    << dataTypeToString(precision) << " " << formatToString(format)
+                                    << " skipped: " << reason << std::endl;
+                        continue;
+                    }
+
+                    std::ostringstream line;
+                    line << std::fixed << std::setprecision(4) << r.plugin << " [" << r.point << "] " << r.ms
+                         << " ms, " << std::setprecision(1) << r.bandwidth << " GB/s (" << r.bandwidthPeak
+                         << "% of peak)";
+                    if (benchmark.flops)
+                    {
+                        line << ", " << r.flops << " GFLOP/s (" << r.flopsPeak << "% of peak)";
+                    }
+                    const auto base = baseline.find(r.key());
+                    if (base != baseline.end())
+                    {
+                        const float change = 100 * (r.ms / base->second - 1);
+                        line << ", " << std::showpos << change << std::noshowpos << "% over baseline";
+                        if (change > options.tolerance)
+                        {
+                            line << " REGRESSION";
+                            ++regressions;
+                        }
+                    }
+                    gLogInfo << line.str() << std::endl;
+                    results.push_back(r);
+                }
+            }
+        }
+    }
+
+    if (!options.exportFile.empty())
+    {
+        exportResults(results, options.exportFile);
+    }
+    if (regressions)
+    {
+        gLogError << regressions << " grid points regressed by more than " << options.tolerance
+                  << "% over the baseline" << std::endl;
+    }
+    return failed || regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
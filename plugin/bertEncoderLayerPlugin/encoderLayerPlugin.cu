@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NvInfer.h"
+#include "bertCommon.h"
+#include "encoderLayerPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "geluPlugin.h"
+#include "libraryHandles.h"
+#include "nvtxRange.h"
+#include "skipLayerNormPlugin.h"
+#include "common.h"
+#include "serialize.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+using namespace nvinfer1;
+using nvinfer1::plugin::pluginMalloc;
+
+namespace bert
+{
+
+namespace
+{
+static const char* ENCODER_LAYER_VERSION{"1"};
+static const char* ENCODER_LAYER_NAME{"CustomEncoderLayerPluginDynamic"};
+
+// Weights of the layer, in the order of serialization
+enum EncoderWeight
+{
+    kQKV_KERNEL = 0,
+    kQKV_BIAS,
+    kATTENTION_OUTPUT_KERNEL,
+    kATTENTION_OUTPUT_BIAS,
+    kATTENTION_LN_BETA,
+    kATTENTION_LN_GAMMA,
+    kINTERMEDIATE_KERNEL,
+    kINTERMEDIATE_BIAS,
+    kOUTPUT_KERNEL,
+    kOUTPUT_BIAS,
+    kOUTPUT_LN_BETA,
+    kOUTPUT_LN_GAMMA,
+    kNB_ENCODER_WEIGHTS
+};
+
+// Creator field of each weight
+const char* const kEncoderWeightNames[kNB_ENCODER_WEIGHTS] = {"qkv_kernel", "qkv_bias", "attention_output_kernel",
+    "attention_output_bias", "attention_output_layernorm_beta", "attention_output_layernorm_gamma",
+    "intermediate_kernel", "intermediate_bias", "output_kernel", "output_bias", "output_layernorm_beta",
+    "output_layernorm_gamma"};
+
+// Number of elements of each weight
+size_t encoderWeightCount(const int index, const size_t hiddenSize, const size_t intermediateSize)
+{
+    switch (index)
+    {
+    case kQKV_KERNEL: return 3 * hiddenSize * hiddenSize;
+    case kQKV_BIAS: return 3 * hiddenSize;
+    case kATTENTION_OUTPUT_KERNEL: return hiddenSize * hiddenSize;
+    case kINTERMEDIATE_KERNEL:
+    case kOUTPUT_KERNEL: return intermediateSize * hiddenSize;
+    case kINTERMEDIATE_BIAS: return intermediateSize;
+    default: return hiddenSize;
+    }
+}
+} // namespace
+
+constexpr size_t kAlignment = 256;
+constexpr uint32_t IIDX = 0; // index of the input tensor
+constexpr uint32_t MIDX = 1; // index of the mask
+
+//!
+//! Intermediates of the layer in the workspace. The attention output only lives once the attention is done, so it
+//! shares its region with the scratch of the attention.
+//!
+struct EncoderScratch
+{
+    size_t qkv;       //!< SxBx3E QKV, then the SxBxI intermediate of the feed forward network
+    size_t context;   //!< SxBxE attention context
+    size_t attention; //!< attention workspace, then the SxBxE normalized attention output
+    size_t total;
+
+    EncoderScratch(const DataType type, const int B, const int S, const int hiddenSize, const int numHeads,
+        const int intermediateSize)
+    {
+        const size_t wordSize = samplesCommon::getElementSize(type);
+        const size_t tokens = static_cast<size_t>(B) * S;
+        qkv = 0;
+        context = qkv + alignTo<size_t>(wordSize * tokens * std::max(3 * hiddenSize, intermediateSize), kAlignment);
+        attention = context + alignTo<size_t>(wordSize * tokens * hiddenSize, kAlignment);
+        const size_t attentionWs = attentionWorkspaceSize(type, B, S, numHeads, hiddenSize / numHeads);
+        total = attention + std::max(alignTo<size_t>(wordSize * tokens * hiddenSize, kAlignment), attentionWs);
+    }
+};
+
+//!
+//! Bias in place on rows of ld elements, for the QKV projection whose bias no following kernel takes
+//!
+template <typename T, int TPB>
+__global__ void addBiasKernel(const int ld, const T* bias, T* output)
+{
+    const int offset = blockIdx.x * ld;
+
+    for (int it = threadIdx.x; it < ld; it += TPB)
+    {
+        const int idx = offset + it;
+        output[idx] = output[idx] + bias[it];
+    }
+}
+
+//!
+//! output = W * input for n tokens, with the m x k kernel W column-major as in FCPluginDynamic
+//!
+template <typename T>
+inline void encoderGemm(
+    cublasHandle_t cublas, const int m, const int n, const int k, const T* W, const T* input, T* output)
+{
+    CHECK(cublasGemm<T>(cublas, CUBLAS_OP_N, CUBLAS_OP_N, m, n, k, T(1.f), W, m, input, k, T(0.f), output, m));
+}
+
+// Static class fields initialization
+PluginFieldCollection EncoderLayerPluginDynamicCreator::mFC{};
+std::vector<PluginField> EncoderLayerPluginDynamicCreator::mPluginAttributes;
+
+REGISTER_TENSORRT_PLUGIN(EncoderLayerPluginDynamicCreator);
+
+EncoderLayerPluginDynamic::EncoderLayerPluginDynamic(const std::string name, const DataType type,
+    const int hiddenSize, const int numHeads, const int intermediateSize, const bool hasMask,
+    const std::vector<Weights>& weights)
+    : mLayerName(name)
+    , mHiddenSize(hiddenSize)
+    , mNumHeads(numHeads)
+    , mIntermediateSize(intermediateSize)
+    , mHasMask(hasMask)
+    , mType(type)
+    , mWeights(weights)
+    , mWeightsDev(kNB_ENCODER_WEIGHTS)
+{
+    assert(hiddenSize % numHeads == 0);
+    assert(weights.size() == kNB_ENCODER_WEIGHTS);
+    mHeadSize = hiddenSize / numHeads;
+    mRsqrtHeadSize = 1.f / sqrt(float(mHeadSize));
+}
+
+EncoderLayerPluginDynamic::EncoderLayerPluginDynamic(const std::string name, const void* data, size_t length)
+    : mLayerName(name)
+    , mWeightsDev(kNB_ENCODER_WEIGHTS)
+{
+    gLogVerbose << "Encoder layer Deser start" << std::endl;
+    // Deserialize in the same order as serialization
+    deserialize_value(&data, &length, &mType);
+    deserialize_value(&data, &length, &mHiddenSize);
+    deserialize_value(&data, &length, &mNumHeads);
+    deserialize_value(&data, &length, &mIntermediateSize);
+    deserialize_value(&data, &length, &mHasMask);
+    deserialize_value(&data, &length, &mGemmAlgos);
+    mGemmAlgosSearched = true;
+    mHeadSize = mHiddenSize / mNumHeads;
+    mRsqrtHeadSize = 1.f / sqrt(float(mHeadSize));
+
+    // this signals init not to allocate/copy
+    const char* d = static_cast<const char*>(data);
+    for (int i = 0; i < kNB_ENCODER_WEIGHTS; i++)
+    {
+        mStaged.stage<char>(d, weightBytes(i));
+        mWeights.push_back(Weights{weightType(i), nullptr, static_cast<int64_t>(weightCount(i))});
+    }
+    gLogVerbose << "Encoder layer Deser done" << std::endl;
+}
+
+size_t EncoderLayerPluginDynamic::weightCount(int index) const
+{
+    return encoderWeightCount(index, mHiddenSize, mIntermediateSize);
+}
+
+DataType EncoderLayerPluginDynamic::weightType(int index) const
+{
+    const bool layerNorm = index == kATTENTION_LN_BETA || index == kATTENTION_LN_GAMMA || index == kOUTPUT_LN_BETA
+        || index == kOUTPUT_LN_GAMMA;
+    return layerNorm ? DataType::kFLOAT : mType;
+}
+
+size_t EncoderLayerPluginDynamic::weightBytes(int index) const
+{
+    return weightCount(index) * samplesCommon::getElementSize(weightType(index));
+}
+
+// IPluginV2DynamicExt Methods
+IPluginV2DynamicExt* EncoderLayerPluginDynamic::clone() const
+{
+    gLogVerbose << "Encoder layer clone" << std::endl;
+    auto ret = new EncoderLayerPluginDynamic(
+        mLayerName, mType, mHiddenSize, mNumHeads, mIntermediateSize, mHasMask, mWeights);
+    ret->mGemmAlgos = mGemmAlgos;
+    ret->mGemmAlgosSearched = mGemmAlgosSearched;
+    // Clones share the device weights instead of uploading their own copy in initialize()
+    ret->mWeightsDev = mWeightsDev;
+    ret->mStaged = mStaged;
+    return ret;
+}
+
+DimsExprs EncoderLayerPluginDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    assert(outputIndex == 0);
+    assert(nbInputs == 1 + mHasMask);
+    return inputs[IIDX];
+}
+
+bool EncoderLayerPluginDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    assert(nbInputs == 1 + mHasMask);
+    assert(nbOutputs == 1);
+
+    const PluginTensorDesc& desc = inOut[pos];
+    const PluginTensorDesc& in = inOut[IIDX];
+    if (desc.format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    if (pos == IIDX)
+    {
+        return desc.type == mType && desc.dims.nbDims == 5 && desc.dims.d[HDIM] == mHiddenSize && desc.dims.d[3] == 1
+            && desc.dims.d[4] == 1;
+    }
+    if (mHasMask && pos == MIDX)
+    {
+        return desc.type == DataType::kINT32 && desc.dims.nbDims == 1 && desc.dims.d[0] == in.dims.d[BDIM];
+    }
+    // output
+    return desc.type == in.type && desc.dims.nbDims == in.dims.nbDims
+        && std::equal(in.dims.d, in.dims.d + in.dims.nbDims, desc.dims.d);
+}
+
+void EncoderLayerPluginDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    assert(nbInputs == 1 + mHasMask);
+    assert(nbOutputs == 1);
+    assert(in[IIDX].desc.type == mType);
+    assert(out->desc.type == mType);
+    assert(in[IIDX].desc.dims.d[HDIM] == mHiddenSize);
+
+    // The batched GEMMs of the attention are tuned for the largest shape of the profile, as in
+    // QKVToContextPluginDynamic
+    if (!mGemmAlgosSearched)
+    {
+        const int B = in[IIDX].max.d[BDIM];
+        const int S = in[IIDX].max.d[SDIM];
+        mGemmAlgos = selectAttentionGemmAlgos(mType, B, S, mNumHeads, mHeadSize);
+        mGemmAlgosSearched = true;
+    }
+}
+
+size_t EncoderLayerPluginDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const int B = inputs[IIDX].dims.d[BDIM];
+    const int S = inputs[IIDX].dims.d[SDIM];
+    return EncoderScratch(mType, B, S, mHiddenSize, mNumHeads, mIntermediateSize).total;
+}
+
+template <typename T>
+int EncoderLayerPluginDynamic::enqueueLayer(const int B, const int S, const T* input, const int* maskIdx, T* output,
+    void* workspace, cudaStream_t stream) const
+{
+    const EncoderScratch scratch(mType, B, S, mHiddenSize, mNumHeads, mIntermediateSize);
+    char* ws = static_cast<char*>(workspace);
+    T* qkv = reinterpret_cast<T*>(ws + scratch.qkv);
+    T* intermediate = qkv;
+    T* context = reinterpret_cast<T*>(ws + scratch.context);
+    void* attentionWs = ws + scratch.attention;
+    T* attention = reinterpret_cast<T*>(ws + scratch.attention);
+
+    const int n = B * S;
+    const int E = mHiddenSize;
+    const auto weight = [this](int index) { return static_cast<const T*>(mWeightsDev[index].get()); };
+
+    cublasHandle_t cublas = nvinfer1::plugin::getCublasHandle();
+    cublasSetStream(cublas, stream);
+    CublasConfigHelper helper(cublas);
+
+    // 1. QKV projection and its bias
+    constexpr int blockSize = 256;
+    encoderGemm<T>(cublas, 3 * E, n, E, weight(kQKV_KERNEL), input, qkv);
+    addBiasKernel<T, blockSize><<<n, blockSize, 0, stream>>>(3 * E, weight(kQKV_BIAS), qkv);
+    CHECK(cudaPeekAtLastError());
+
+    // 2. self-attention, the computeAttention scratch is released once the context is written
+    int status = computeAttention<T>(
+        B, S, mNumHeads, mHeadSize, mRsqrtHeadSize, qkv, context, attentionWs, stream, mGemmAlgos, maskIdx);
+    if (status != 0)
+    {
+        return status;
+    }
+
+    // 3. attention output projection, its bias added by the skip layer norm with the input of the layer
+    encoderGemm<T>(cublas, E, n, E, weight(kATTENTION_OUTPUT_KERNEL), context, attention);
+    status = computeSkipLayerNorm<T, true>(stream, E, n * E, attention, input,
+        static_cast<const float*>(mWeightsDev[kATTENTION_LN_BETA].get()),
+        static_cast<const float*>(mWeightsDev[kATTENTION_LN_GAMMA].get()), attention, weight(kATTENTION_OUTPUT_BIAS));
+    if (status != 0)
+    {
+        return status;
+    }
+
+    // 4. feed forward network, in place over the QKV
+    encoderGemm<T>(cublas, mIntermediateSize, n, E, weight(kINTERMEDIATE_KERNEL), attention, intermediate);
+    computeGeluBias(intermediate, intermediate, weight(kINTERMEDIATE_BIAS), mIntermediateSize, n, stream);
+
+    // 5. output projection, its bias added by the skip layer norm with the attention output
+    encoderGemm<T>(cublas, E, n, mIntermediateSize, weight(kOUTPUT_KERNEL), intermediate, output);
+    return computeSkipLayerNorm<T, true>(stream, E, n * E, output, attention,
+        static_cast<const float*>(mWeightsDev[kOUTPUT_LN_BETA].get()),
+        static_cast<const float*>(mWeightsDev[kOUTPUT_LN_GAMMA].get()), output, weight(kOUTPUT_BIAS));
+}
+
+int EncoderLayerPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    mStaged.wait();
+
+    const int B = inputDesc[IIDX].dims.d[BDIM];
+    const int S = inputDesc[IIDX].dims.d[SDIM];
+    const int* maskIdx = mHasMask ? static_cast<const int*>(inputs[MIDX]) : nullptr;
+
+    int status = -1;
+    if (mType == DataType::kFLOAT)
+    {
+        status = enqueueLayer(B, S, static_cast<const float*>(inputs[IIDX]), maskIdx, static_cast<float*>(outputs[0]),
+            workspace, stream);
+    }
+    else if (mType == DataType::kHALF)
+    {
+        status = enqueueLayer(B, S, static_cast<const half*>(inputs[IIDX]), maskIdx, static_cast<half*>(outputs[0]),
+            workspace, stream);
+    }
+    else
+    {
+        assert(false);
+    }
+    return status;
+}
+
+// IPluginV2Ext Methods
+DataType EncoderLayerPluginDynamic::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    assert(index == 0);
+    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF);
+    return inputTypes[0];
+}
+
+// IPluginV2 Methods
+const char* EncoderLayerPluginDynamic::getPluginType() const
+{
+    return ENCODER_LAYER_NAME;
+}
+
+const char* EncoderLayerPluginDynamic::getPluginVersion() const
+{
+    return ENCODER_LAYER_VERSION;
+}
+
+int EncoderLayerPluginDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+int EncoderLayerPluginDynamic::initialize()
+{
+    nvinfer1::plugin::acquireLibraryHandles();
+
+    // The weights staged at deserialization are uploaded together with those of the other plugins
+    if (!mStaged.empty() && !mWeightsDev[0])
+    {
+        for (int i = 0; i < kNB_ENCODER_WEIGHTS; i++)
+        {
+            mStaged.resolve(i, mWeightsDev[i]);
+        }
+    }
+    // Clones were handed the device weights of the plugin they were cloned from, only the first one uploads them
+    for (int i = 0; i < kNB_ENCODER_WEIGHTS; i++)
+    {
+        if (!mWeights[i].values || mWeightsDev[i])
+        {
+            continue;
+        }
+        void* dev{nullptr};
+        CHECK(pluginMalloc(&dev, weightBytes(i)));
+        make_cuda_shared(mWeightsDev[i], dev);
+        if (weightType(i) == DataType::kFLOAT)
+        {
+            convertAndCopyToDevice(mWeights[i], static_cast<float*>(dev));
+        }
+        else
+        {
+            convertAndCopyToDevice(mWeights[i], static_cast<half*>(dev));
+        }
+    }
+    return 0;
+}
+
+void EncoderLayerPluginDynamic::terminate()
+{
+    // The device weights are shared with the clones and released with the last plugin holding them
+    nvinfer1::plugin::releaseLibraryHandles();
+}
+
+size_t EncoderLayerPluginDynamic::getSerializationSize() const
+{
+    size_t weightsSize = 0;
+    for (int i = 0; i < kNB_ENCODER_WEIGHTS; i++)
+    {
+        weightsSize += weightBytes(i);
+    }
+    return sizeof(mType) + sizeof(mHiddenSize) + sizeof(mNumHeads) + sizeof(mIntermediateSize) + sizeof(mHasMask)
+        + sizeof(mGemmAlgos) + weightsSize;
+}
+
+void EncoderLayerPluginDynamic::serialize(void* buffer) const
+{
+    serialize_value(&buffer, mType);
+    serialize_value(&buffer, mHiddenSize);
+    serialize_value(&buffer, mNumHeads);
+    serialize_value(&buffer, mIntermediateSize);
+    serialize_value(&buffer, mHasMask);
+    serialize_value(&buffer, mGemmAlgos);
+
+    char* d = static_cast<char*>(buffer);
+    for (int i = 0; i < kNB_ENCODER_WEIGHTS; i++)
+    {
+        serFromDev(d, static_cast<const char*>(mWeightsDev[i].get()), weightBytes(i));
+    }
+}
+
+void EncoderLayerPluginDynamic::destroy()
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+void EncoderLayerPluginDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* EncoderLayerPluginDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+/////////////////////////////////////////////////////////
+
+EncoderLayerPluginDynamicCreator::EncoderLayerPluginDynamicCreator()
+{
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* EncoderLayerPluginDynamicCreator::getPluginName() const
+{
+    return ENCODER_LAYER_NAME;
+}
+
+const char* EncoderLayerPluginDynamicCreator::getPluginVersion() const
+{
+    return ENCODER_LAYER_VERSION;
+}
+
+const PluginFieldCollection* EncoderLayerPluginDynamicCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2* EncoderLayerPluginDynamicCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    gLogVerbose << "Creating EncoderLayerPlugin...\n";
+
+    int hiddenSize = 0;
+    int numHeads = 0;
+    int typeId = -1;
+    bool hasMask = false;
+    std::vector<Weights> weights(kNB_ENCODER_WEIGHTS, Weights{DataType::kFLOAT, nullptr, 0});
+
+    for (int i = 0; i < fc->nbFields; i++)
+    {
+        std::string field_name(fc->fields[i].name);
+
+        if (field_name.compare("type_id") == 0)
+        {
+            typeId = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building typeId: " << typeId << std::endl;
+        }
+        if (field_name.compare("hidden_size") == 0)
+        {
+            hiddenSize = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building hiddenSize: " << hiddenSize << std::endl;
+        }
+        if (field_name.compare("num_heads") == 0)
+        {
+            numHeads = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building numHeads: " << numHeads << std::endl;
+        }
+        if (field_name.compare("has_mask") == 0)
+        {
+            hasMask = *static_cast<const int*>(fc->fields[i].data) != 0;
+            gLogVerbose << "Building hasMask: " << hasMask << std::endl;
+        }
+        for (int w = 0; w < kNB_ENCODER_WEIGHTS; w++)
+        {
+            if (field_name.compare(kEncoderWeightNames[w]) == 0)
+            {
+                gLogVerbose << "Building " << kEncoderWeightNames[w] << "...\n";
+                weights[w].values = fc->fields[i].data;
+                weights[w].count = fc->fields[i].length;
+                weights[w].type = fieldTypeToDataType(fc->fields[i].type);
+            }
+        }
+    }
+    if (typeId != static_cast<int>(DataType::kFLOAT) && typeId != static_cast<int>(DataType::kHALF))
+    {
+        gLogError << "Encoder layer: Invalid TypeId " << typeId << std::endl;
+        return nullptr;
+    }
+
+    if (hiddenSize <= 0 || numHeads <= 0 || hiddenSize % numHeads != 0)
+    {
+        gLogError << "Encoder layer: Invalid hiddenSize " << hiddenSize << " or numHeads " << numHeads << std::endl;
+        return nullptr;
+    }
+
+    // The intermediate size of the feed forward network is given by its bias
+    const int intermediateSize = weights[kINTERMEDIATE_BIAS].count;
+    for (int w = 0; w < kNB_ENCODER_WEIGHTS; w++)
+    {
+        const size_t expected = encoderWeightCount(w, hiddenSize, intermediateSize);
+        if (!weights[w].values || static_cast<size_t>(weights[w].count) != expected)
+        {
+            gLogError << "Encoder layer: Invalid " << kEncoderWeightNames[w] << ", expected " << expected << " values"
+                      << std::endl;
+            return nullptr;
+        }
+    }
+
+    gLogVerbose << "Building the Plugin...\n";
+    DataType type = static_cast<DataType>(typeId);
+    return new EncoderLayerPluginDynamic(name, type, hiddenSize, numHeads, intermediateSize, hasMask, weights);
+}
+
+IPluginV2* EncoderLayerPluginDynamicCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call EncoderLayerPluginDynamic::destroy()
+    return new EncoderLayerPluginDynamic(name, serialData, serialLength);
+}
+
+void EncoderLayerPluginDynamicCreator::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* EncoderLayerPluginDynamicCreator::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+}
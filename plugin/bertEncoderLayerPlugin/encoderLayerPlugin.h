@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_ENCODER_LAYER_PLUGIN_H
+#define TRT_ENCODER_LAYER_PLUGIN_H
+
+#include "NvInferPlugin.h"
+#include "bertCommon.h"
+#include "qkvToContextPlugin.h"
+#include <string>
+#include <vector>
+
+namespace bert
+{
+
+//!
+//! A whole BERT encoder layer: the QKV projection, the self-attention, the attention output projection and its skip
+//! layer norm, then the feed forward network with Gelu and its skip layer norm.
+//!
+//! The plugin owns the weights of the layer and runs its sub-layers back to back on the enqueue stream. Their
+//! intermediates live in the workspace of the plugin, reused from one sub-layer to the next, instead of tensors of the
+//! network between six plugins.
+//!
+//! Inputs:
+//!  - input: SxBxE, as the output of EmbLayerNormPluginDynamic or of the previous layer
+//!  - maskIdx: [B] kINT32, the number of valid tokens of each sequence, only with hasMask
+//!
+//! The output is SxBxE.
+//!
+class EncoderLayerPluginDynamic : public nvinfer1::IPluginV2DynamicExt
+{
+public:
+    //!
+    //! \param weights The twelve weights of the layer in the order of the fields of the creator, the kernels laid out
+    //!        as for FCPluginDynamic and the layer norm parameters in FP32
+    //!
+    EncoderLayerPluginDynamic(const std::string name, const nvinfer1::DataType type, const int hiddenSize,
+        const int numHeads, const int intermediateSize, const bool hasMask,
+        const std::vector<nvinfer1::Weights>& weights);
+
+    EncoderLayerPluginDynamic(const std::string name, const void* data, size_t length);
+
+    EncoderLayerPluginDynamic() = delete;
+
+    // IPluginV2DynamicExt Methods
+    nvinfer1::IPluginV2DynamicExt* clone() const override;
+    nvinfer1::DimsExprs getOutputDimensions(
+        int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) override;
+    bool supportsFormatCombination(
+        int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+    void configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+        const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) override;
+    size_t getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+        const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const override;
+    int enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+        const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    // IPluginV2Ext Methods
+    nvinfer1::DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    // IPluginV2 Methods
+    const char* getPluginType() const override;
+    const char* getPluginVersion() const override;
+    int getNbOutputs() const override;
+    int initialize() override;
+    void terminate() override;
+    size_t getSerializationSize() const override;
+    void serialize(void* buffer) const override;
+    void destroy() override;
+    void setPluginNamespace(const char* pluginNamespace) override;
+    const char* getPluginNamespace() const override;
+
+private:
+    size_t weightCount(int index) const;
+    nvinfer1::DataType weightType(int index) const;
+    size_t weightBytes(int index) const;
+
+    template <typename T>
+    int enqueueLayer(const int B, const int S, const T* input, const int* maskIdx, T* output, void* workspace,
+        cudaStream_t stream) const;
+
+    const std::string mLayerName;
+    std::string mNamespace;
+
+    float mRsqrtHeadSize;
+    int mHeadSize;
+    int mHiddenSize;
+    int mNumHeads;
+    int mIntermediateSize;
+    bool mHasMask;
+    nvinfer1::DataType mType;
+
+    AttentionGemmAlgos mGemmAlgos{CUBLAS_GEMM_DEFAULT_TENSOR_OP, CUBLAS_GEMM_DEFAULT_TENSOR_OP};
+    bool mGemmAlgosSearched{false};
+
+    std::vector<nvinfer1::Weights> mWeights;
+    std::vector<bert::cuda_shared_ptr<void>> mWeightsDev;
+    // Weights of a deserialized plugin, staged in the order of the creator fields
+    bert::StagedWeights mStaged;
+
+protected:
+    // To prevent compiler warnings.
+    using nvinfer1::IPluginV2DynamicExt::getOutputDimensions;
+    using nvinfer1::IPluginV2DynamicExt::isOutputBroadcastAcrossBatch;
+    using nvinfer1::IPluginV2DynamicExt::canBroadcastInputAcrossBatch;
+    using nvinfer1::IPluginV2DynamicExt::supportsFormat;
+    using nvinfer1::IPluginV2DynamicExt::configurePlugin;
+    using nvinfer1::IPluginV2DynamicExt::getWorkspaceSize;
+    using nvinfer1::IPluginV2DynamicExt::enqueue;
+};
+
+class EncoderLayerPluginDynamicCreator : public nvinfer1::IPluginCreator
+{
+public:
+    EncoderLayerPluginDynamicCreator();
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const nvinfer1::PluginFieldCollection* getFieldNames() override;
+
+    nvinfer1::IPluginV2* createPlugin(const char* name, const nvinfer1::PluginFieldCollection* fc) override;
+
+    nvinfer1::IPluginV2* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+private:
+    static nvinfer1::PluginFieldCollection mFC;
+    static std::vector<nvinfer1::PluginField> mPluginAttributes;
+    std::string mNamespace;
+};
+}
+#endif // TRT_ENCODER_LAYER_PLUGIN_H
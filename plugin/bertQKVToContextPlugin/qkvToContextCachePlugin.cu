@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NvInfer.h"
+#include "bertCommon.h"
+#include "qkvToContextCachePlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include "common.h"
+#include "serialize.hpp"
+
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <vector>
+
+using namespace nvinfer1;
+using nvinfer1::plugin::pluginMalloc;
+
+namespace bert
+{
+
+constexpr int kCacheThreads = 128;
+constexpr size_t kCacheMaxSmem = 48 << 10; // the query and the scores of the row, without opting in to more
+
+//!
+//! The pool holds numPages pages of [2, numHeads, pageSize, headSize], the keys then the values of pageSize tokens
+//!
+struct KVCacheLayout
+{
+    int numHeads;
+    int headSize;
+    int pageSize;
+    int numPages;
+    int maxPages; //!< pages in the table of a sequence
+
+    //! \return The offset of the key (kv = 0) or value (kv = 1) of a token of a head, -1 if its page is not in the pool
+    __device__ inline int64_t offset(const int* pages, const int pos, const int kv, const int head) const
+    {
+        const int logical = pos / pageSize;
+        const int page = logical < maxPages ? pages[logical] : -1;
+        if (page < 0 || page >= numPages)
+        {
+            return -1;
+        }
+        return ((static_cast<int64_t>(page) * 2 + kv) * numHeads + head) * pageSize * headSize
+            + static_cast<int64_t>(pos % pageSize) * headSize;
+    }
+};
+
+//!
+//! Copy the keys and values of the new tokens to the cache
+//!
+template <typename T>
+__global__ void appendKVKernel(const int B, const KVCacheLayout layout, const int* pastLengths, const int* pageTable,
+    const T* input, T* cache)
+{
+    // Grid: (S * B, numHeads), row blockIdx.x of the input is token s = blockIdx.x / B of sequence blockIdx.x % B
+    const int b = blockIdx.x % B;
+    const int head = blockIdx.y;
+    const int pos = pastLengths[b] + static_cast<int>(blockIdx.x) / B;
+    const int64_t key = layout.offset(pageTable + b * layout.maxPages, pos, 0, head);
+    const int64_t value = layout.offset(pageTable + b * layout.maxPages, pos, 1, head);
+    if (key < 0)
+    {
+        return;
+    }
+
+    const T* qkv = input + (static_cast<int64_t>(blockIdx.x) * layout.numHeads + head) * 3 * layout.headSize;
+    for (int h = threadIdx.x; h < layout.headSize; h += blockDim.x)
+    {
+        cache[key + h] = qkv[layout.headSize + h];
+        cache[value + h] = qkv[2 * layout.headSize + h];
+    }
+}
+
+//!
+//! Attention of one new token of one head over the cache, the keys and values of the token included
+//!
+template <typename T, unsigned TPB>
+__global__ void __launch_bounds__(TPB) cachedAttentionKernel(const int B, const KVCacheLayout layout,
+    const float rsqrtHeadSize, const int* pastLengths, const int* pageTable, const T* input, const T* cache, T* output)
+{
+    // Grid: (B * numHeads, S)
+    extern __shared__ float smem[];
+    using BlockReduce = cub::BlockReduce<float, TPB>;
+    __shared__ typename BlockReduce::TempStorage tmpStorage;
+    __shared__ float rowMax;
+    __shared__ float rowScale;
+
+    const int headSize = layout.headSize;
+    const int b = blockIdx.x / layout.numHeads;
+    const int head = blockIdx.x % layout.numHeads;
+    const int row = blockIdx.y * B + b;
+    const int* pages = pageTable + b * layout.maxPages;
+    const int length = min(pastLengths[b] + static_cast<int>(blockIdx.y) + 1, layout.maxPages * layout.pageSize);
+
+    float* q = smem;
+    float* scores = smem + headSize;
+
+    const T* qkv = input + (static_cast<int64_t>(row) * layout.numHeads + head) * 3 * headSize;
+    for (int h = threadIdx.x; h < headSize; h += TPB)
+    {
+        q[h] = weightToFloat(qkv[h]) * rsqrtHeadSize;
+    }
+    __syncthreads();
+
+    // One warp per key, the lanes split the dot product
+    const int warp = threadIdx.x / 32;
+    const int lane = threadIdx.x % 32;
+    for (int k = warp; k < length; k += TPB / 32)
+    {
+        const int64_t key = layout.offset(pages, k, 0, head);
+        float score = 0.f;
+        if (key >= 0)
+        {
+            for (int h = lane; h < headSize; h += 32)
+            {
+                score += q[h] * weightToFloat(cache[key + h]);
+            }
+        }
+        for (int offset = 16; offset > 0; offset /= 2)
+        {
+            score += __shfl_xor_sync(0xffffffff, score, offset);
+        }
+        if (lane == 0)
+        {
+            // The keys of the pages missing from the table are left out of the softmax
+            scores[k] = key >= 0 ? score : -FLT_MAX;
+        }
+    }
+    __syncthreads();
+
+    float threadMax = -FLT_MAX;
+    for (int k = threadIdx.x; k < length; k += TPB)
+    {
+        threadMax = max(threadMax, scores[k]);
+    }
+    const float blockMax = BlockReduce(tmpStorage).Reduce(threadMax, cub::Max());
+    if (threadIdx.x == 0)
+    {
+        rowMax = blockMax;
+    }
+    __syncthreads();
+
+    float threadSum = 0.f;
+    for (int k = threadIdx.x; k < length; k += TPB)
+    {
+        const float e = scores[k] == -FLT_MAX ? 0.f : __expf(scores[k] - rowMax);
+        scores[k] = e;
+        threadSum += e;
+    }
+    const float blockSum = BlockReduce(tmpStorage).Sum(threadSum);
+    if (threadIdx.x == 0)
+    {
+        rowScale = blockSum > 0.f ? 1.f / blockSum : 0.f;
+    }
+    __syncthreads();
+
+    // Probabilities times values, consecutive threads read consecutive elements of each value row
+    T* out = output + (static_cast<int64_t>(row) * layout.numHeads + head) * headSize;
+    for (int h = threadIdx.x; h < headSize; h += TPB)
+    {
+        float acc = 0.f;
+        for (int k = 0; k < length; ++k)
+        {
+            const int64_t value = layout.offset(pages, k, 1, head);
+            if (value >= 0)
+            {
+                acc += scores[k] * weightToFloat(cache[value + h]);
+            }
+        }
+        out[h] = convertWeight<T>(acc * rowScale);
+    }
+}
+
+template <typename T>
+int cachedQkvToCtx(const int S, const int B, const KVCacheLayout& layout, const float rsqrtHeadSize,
+    const int* pastLengths, const int* pageTable, const T* input, T* cache, T* output, cudaStream_t stream)
+{
+    const size_t smem = sizeof(float) * (layout.headSize + static_cast<size_t>(layout.maxPages) * layout.pageSize);
+    if (smem > kCacheMaxSmem)
+    {
+        gLogError << "QKV cache: the scores of " << layout.maxPages << " pages of " << layout.pageSize
+                  << " tokens exceed the shared memory" << std::endl;
+        return -1;
+    }
+
+    appendKVKernel<T><<<dim3(S * B, layout.numHeads), kCacheThreads, 0, stream>>>(
+        B, layout, pastLengths, pageTable, input, cache);
+    cachedAttentionKernel<T, kCacheThreads><<<dim3(B * layout.numHeads, S), kCacheThreads, smem, stream>>>(
+        B, layout, rsqrtHeadSize, pastLengths, pageTable, input, cache, output);
+    CHECK(cudaPeekAtLastError());
+    return 0;
+}
+
+namespace
+{
+static const char* QKV_TO_CONTEXT_CACHE_PLUGIN_VERSION{"1"};
+static const char* QKV_TO_CONTEXT_CACHE_PLUGIN_NAME{"CustomQKVToContextCachePluginDynamic"};
+} // namespace
+
+// Static class fields initialization
+PluginFieldCollection QKVToContextCachePluginDynamicCreator::mFC{};
+std::vector<PluginField> QKVToContextCachePluginDynamicCreator::mPluginAttributes;
+
+REGISTER_TENSORRT_PLUGIN(QKVToContextCachePluginDynamicCreator);
+
+constexpr uint32_t IIDX = 0; // index of the input tensor
+constexpr uint32_t LIDX = 1; // index of the past lengths
+constexpr uint32_t PIDX = 2; // index of the page table
+
+QKVToContextCachePluginDynamic::QKVToContextCachePluginDynamic(const std::string name, const DataType type,
+    const int hiddenSize, const int numHeads, const int numPages, const int pageSize)
+    : mLayerName(name)
+    , mHiddenSize(hiddenSize)
+    , mNumHeads(numHeads)
+    , mNumPages(numPages)
+    , mPageSize(pageSize)
+    , mType(type)
+{
+    assert(hiddenSize % numHeads == 0);
+    mHeadSize = hiddenSize / numHeads;
+    mRsqrtHeadSize = 1.f / sqrt(float(mHeadSize));
+}
+
+QKVToContextCachePluginDynamic::QKVToContextCachePluginDynamic(const std::string name, const void* data, size_t length)
+    : mLayerName(name)
+{
+    gLogVerbose << "QKV cache Deser Start" << std::endl;
+    deserialize_value(&data, &length, &mType);
+    deserialize_value(&data, &length, &mNumHeads);
+    deserialize_value(&data, &length, &mHeadSize);
+    deserialize_value(&data, &length, &mRsqrtHeadSize);
+    deserialize_value(&data, &length, &mHiddenSize);
+    deserialize_value(&data, &length, &mNumPages);
+    deserialize_value(&data, &length, &mPageSize);
+    gLogVerbose << "QKV cache Deser done" << std::endl;
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* QKVToContextCachePluginDynamic::clone() const
+{
+    gLogVerbose << "QKV cache Clone" << std::endl;
+    auto ret = new QKVToContextCachePluginDynamic(mLayerName, mType, mHiddenSize, mNumHeads, mNumPages, mPageSize);
+    // Clones share the pool, the keys and values cached by one enqueue are read by the next
+    ret->mCacheDev = mCacheDev;
+    ret->initialize();
+    return ret;
+}
+
+DimsExprs QKVToContextCachePluginDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    // Input is SxBx3*N*H, output should be SxBxN*H
+    assert(outputIndex == 0);
+    DimsExprs output(inputs[IIDX]);
+    auto three = exprBuilder.constant(3);
+    output.d[HDIM] = exprBuilder.operation(DimensionOperation::kFLOOR_DIV, *inputs[IIDX].d[HDIM], *three);
+    return output;
+}
+
+bool QKVToContextCachePluginDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    assert(pos >= 0 && pos < 4);
+    assert(nbInputs == 3 && nbOutputs == 1);
+    const auto* in = inOut;
+    const auto& desc = inOut[pos];
+    if (desc.format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    switch (pos)
+    {
+    case IIDX:
+        return desc.type == mType && desc.dims.nbDims == 5 && desc.dims.d[HDIM] == 3 * mHiddenSize
+            && desc.dims.d[3] == 1 && desc.dims.d[4] == 1;
+    case LIDX: return desc.type == DataType::kINT32 && desc.dims.nbDims == 1 && desc.dims.d[0] == in->dims.d[BDIM];
+    case PIDX: return desc.type == DataType::kINT32 && desc.dims.nbDims == 2 && desc.dims.d[0] == in->dims.d[BDIM];
+    default:
+        return desc.type == in->type && desc.dims.nbDims == 5 && desc.dims.d[HDIM] == mHiddenSize
+            && desc.dims.d[SDIM] == in->dims.d[SDIM] && desc.dims.d[BDIM] == in->dims.d[BDIM];
+    }
+}
+
+void QKVToContextCachePluginDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    assert(nbInputs == 3);
+    assert(nbOutputs == 1);
+    assert(mType == in[IIDX].desc.type);
+    assert(mType == out->desc.type);
+    assert(in[LIDX].desc.type == DataType::kINT32);
+    assert(in[PIDX].desc.type == DataType::kINT32);
+}
+
+size_t QKVToContextCachePluginDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    // The scores of a row stay in shared memory
+    return 0;
+}
+
+// IPluginV2Ext Methods
+DataType QKVToContextCachePluginDynamic::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    assert(index == 0);
+    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF);
+    return inputTypes[0];
+}
+
+// IPluginV2 Methods
+const char* QKVToContextCachePluginDynamic::getPluginType() const
+{
+    return QKV_TO_CONTEXT_CACHE_PLUGIN_NAME;
+}
+
+const char* QKVToContextCachePluginDynamic::getPluginVersion() const
+{
+    return QKV_TO_CONTEXT_CACHE_PLUGIN_VERSION;
+}
+
+int QKVToContextCachePluginDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+size_t QKVToContextCachePluginDynamic::cacheSize() const
+{
+    return static_cast<size_t>(mNumPages) * 2 * mNumHeads * mPageSize * mHeadSize
+        * samplesCommon::getElementSize(mType);
+}
+
+int QKVToContextCachePluginDynamic::initialize()
+{
+    if (!mCacheDev)
+    {
+        char* cache{nullptr};
+        CHECK(pluginMalloc(&cache, cacheSize()));
+        make_cuda_shared(mCacheDev, cache);
+    }
+    return 0;
+}
+
+void QKVToContextCachePluginDynamic::terminate()
+{
+    // The pool is shared with the clones and released with the last plugin holding it
+}
+
+size_t QKVToContextCachePluginDynamic::getSerializationSize() const
+{
+    return sizeof(DataType) + sizeof(mNumHeads) + sizeof(mHeadSize) + sizeof(mRsqrtHeadSize) + sizeof(mHiddenSize)
+        + sizeof(mNumPages) + sizeof(mPageSize);
+}
+
+void QKVToContextCachePluginDynamic::serialize(void* buffer) const
+{
+    serialize_value(&buffer, mType);
+    serialize_value(&buffer, mNumHeads);
+    serialize_value(&buffer, mHeadSize);
+    serialize_value(&buffer, mRsqrtHeadSize);
+    serialize_value(&buffer, mHiddenSize);
+    serialize_value(&buffer, mNumPages);
+    serialize_value(&buffer, mPageSize);
+}
+
+void QKVToContextCachePluginDynamic::destroy()
+{
+    delete this;
+}
+
+void QKVToContextCachePluginDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* QKVToContextCachePluginDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+int QKVToContextCachePluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+
+    const int S = inputDesc[IIDX].dims.d[SDIM];
+    const int B = inputDesc[IIDX].dims.d[BDIM];
+    const KVCacheLayout layout{mNumHeads, mHeadSize, mPageSize, mNumPages, inputDesc[PIDX].dims.d[1]};
+    const int* pastLengths = static_cast<const int*>(inputs[LIDX]);
+    const int* pageTable = static_cast<const int*>(inputs[PIDX]);
+
+    int status = -1;
+    if (mType == DataType::kFLOAT)
+    {
+        status = cachedQkvToCtx(S, B, layout, mRsqrtHeadSize, pastLengths, pageTable,
+            static_cast<const float*>(inputs[IIDX]), reinterpret_cast<float*>(mCacheDev.get()),
+            static_cast<float*>(outputs[0]), stream);
+    }
+    else if (mType == DataType::kHALF)
+    {
+        status = cachedQkvToCtx(S, B, layout, mRsqrtHeadSize, pastLengths, pageTable,
+            static_cast<const half*>(inputs[IIDX]), reinterpret_cast<half*>(mCacheDev.get()),
+            static_cast<half*>(outputs[0]), stream);
+    }
+    else
+    {
+        assert(false);
+    }
+    return status;
+}
+
+QKVToContextCachePluginDynamicCreator::QKVToContextCachePluginDynamicCreator()
+{
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* QKVToContextCachePluginDynamicCreator::getPluginName() const
+{
+    return QKV_TO_CONTEXT_CACHE_PLUGIN_NAME;
+}
+
+const char* QKVToContextCachePluginDynamicCreator::getPluginVersion() const
+{
+    return QKV_TO_CONTEXT_CACHE_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* QKVToContextCachePluginDynamicCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2* QKVToContextCachePluginDynamicCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    gLogVerbose << "Creating QKV2ContextCachePlugin...\n";
+
+    int hiddenSize = 0;
+    int numHeads = 0;
+    int numPages = 0;
+    int pageSize = 16;
+    int typeId = -1;
+
+    for (int i = 0; i < fc->nbFields; i++)
+    {
+        std::string field_name(fc->fields[i].name);
+
+        if (field_name.compare("type_id") == 0)
+        {
+            typeId = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building typeId: " << typeId << std::endl;
+        }
+        if (field_name.compare("hidden_size") == 0)
+        {
+            hiddenSize = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building hiddenSize: " << hiddenSize << std::endl;
+        }
+        if (field_name.compare("num_heads") == 0)
+        {
+            numHeads = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building numHeads: " << numHeads << std::endl;
+        }
+        if (field_name.compare("num_pages") == 0)
+        {
+            numPages = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building numPages: " << numPages << std::endl;
+        }
+        if (field_name.compare("page_size") == 0)
+        {
+            pageSize = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building pageSize: " << pageSize << std::endl;
+        }
+    }
+    if (typeId != static_cast<int>(DataType::kFLOAT) && typeId != static_cast<int>(DataType::kHALF))
+    {
+        gLogError << "QKV cache: Invalid TypeId " << typeId << std::endl;
+        return nullptr;
+    }
+
+    if (hiddenSize <= 0 || numHeads <= 0 || hiddenSize % numHeads != 0)
+    {
+        gLogError << "QKV cache: Invalid hiddenSize " << hiddenSize << " or numHeads " << numHeads << std::endl;
+        return nullptr;
+    }
+
+    if (numPages <= 0 || pageSize <= 0)
+    {
+        gLogError << "QKV cache: Invalid numPages " << numPages << " or pageSize " << pageSize << std::endl;
+        return nullptr;
+    }
+
+    gLogVerbose << "Building the Plugin...\n";
+    DataType type = static_cast<DataType>(typeId);
+    return new QKVToContextCachePluginDynamic(name, type, hiddenSize, numHeads, numPages, pageSize);
+}
+
+IPluginV2* QKVToContextCachePluginDynamicCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    return new QKVToContextCachePluginDynamic(name, serialData, serialLength);
+}
+
+void QKVToContextCachePluginDynamicCreator::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* QKVToContextCachePluginDynamicCreator::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+}
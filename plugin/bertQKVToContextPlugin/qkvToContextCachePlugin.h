@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_QKV_TO_CONTEXT_CACHE_PLUGIN_H
+#define TRT_QKV_TO_CONTEXT_CACHE_PLUGIN_H
+
+#include "NvInferPlugin.h"
+#include "bertCommon.h"
+#include <string>
+#include <vector>
+
+namespace bert
+{
+
+//!
+//! Incremental self-attention for autoregressive decoding. The keys and values of the past tokens are kept in a pool of
+//! pages in device memory, so that each step only computes the attention of its new tokens.
+//!
+//! Inputs:
+//!  - qkv: SxBx3E, the Q, K, V of the S new tokens of each of the B sequences, as for QKVToContextPluginDynamic
+//!  - pastLengths: [B] kINT32, the number of tokens of each sequence already in the cache
+//!  - pageTable: [B, P] kINT32, the pool page holding each run of pageSize tokens of each sequence
+//!
+//! The output is SxBxE. The keys and values of the new tokens are appended to the cache, and each new token attends to
+//! the past tokens, the new tokens before it and itself. The application hands out the pages to its sessions and
+//! passes their lengths, a session is started over by passing a length of 0. The pool is shared by the clones of the
+//! plugin, so the execution contexts of an engine must use distinct pages.
+//!
+class QKVToContextCachePluginDynamic : public nvinfer1::IPluginV2DynamicExt
+{
+public:
+    //!
+    //! \param numPages Number of pages of the pool
+    //! \param pageSize Number of tokens of a page
+    //!
+    QKVToContextCachePluginDynamic(const std::string name, const nvinfer1::DataType type, const int hiddenSize,
+        const int numHeads, const int numPages, const int pageSize);
+
+    QKVToContextCachePluginDynamic(const std::string name, const void* data, size_t length);
+
+    QKVToContextCachePluginDynamic() = delete;
+
+    // IPluginV2DynamicExt Methods
+    nvinfer1::IPluginV2DynamicExt* clone() const override;
+    nvinfer1::DimsExprs getOutputDimensions(
+        int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) override;
+    bool supportsFormatCombination(
+        int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+    void configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+        const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) override;
+    size_t getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+        const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const override;
+    int enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+        const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    // IPluginV2Ext Methods
+    nvinfer1::DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    // IPluginV2 Methods
+    const char* getPluginType() const override;
+    const char* getPluginVersion() const override;
+    int getNbOutputs() const override;
+    int initialize() override;
+    void terminate() override;
+    size_t getSerializationSize() const override;
+    void serialize(void* buffer) const override;
+    void destroy() override;
+    void setPluginNamespace(const char* pluginNamespace) override;
+    const char* getPluginNamespace() const override;
+
+private:
+    size_t cacheSize() const;
+
+    float mRsqrtHeadSize;
+    int mHeadSize;
+    int mHiddenSize;
+    int mNumHeads;
+    int mNumPages;
+    int mPageSize;
+    const std::string mLayerName;
+    std::string mNamespace;
+
+    nvinfer1::DataType mType;
+    // [numPages, 2, numHeads, pageSize, headSize] of mType, the keys then the values of each page
+    bert::cuda_shared_ptr<char> mCacheDev;
+
+protected:
+    // To prevent compiler warnings.
+    using nvinfer1::IPluginV2DynamicExt::getOutputDimensions;
+    using nvinfer1::IPluginV2DynamicExt::isOutputBroadcastAcrossBatch;
+    using nvinfer1::IPluginV2DynamicExt::canBroadcastInputAcrossBatch;
+    using nvinfer1::IPluginV2DynamicExt::supportsFormat;
+    using nvinfer1::IPluginV2DynamicExt::configurePlugin;
+    using nvinfer1::IPluginV2DynamicExt::getWorkspaceSize;
+    using nvinfer1::IPluginV2DynamicExt::enqueue;
+};
+
+class QKVToContextCachePluginDynamicCreator : public nvinfer1::IPluginCreator
+{
+public:
+    QKVToContextCachePluginDynamicCreator();
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const nvinfer1::PluginFieldCollection* getFieldNames() override;
+
+    nvinfer1::IPluginV2* createPlugin(const char* name, const nvinfer1::PluginFieldCollection* fc) override;
+
+    nvinfer1::IPluginV2* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+private:
+    static nvinfer1::PluginFieldCollection mFC;
+    static std::vector<nvinfer1::PluginField> mPluginAttributes;
+    std::string mNamespace;
+};
+}
+#endif // TRT_QKV_TO_CONTEXT_CACHE_PLUGIN_H
@@ -17,15 +17,27 @@
 #include "NvInfer.h"
 #include "bertCommon.h"
 #include "qkvToContextPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "gemmAlgoCache.h"
+#include "libraryHandles.h"
+#include "nvtxRange.h"
 #include "common.h"
 #include "serialize.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cfloat>
 #include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::pluginFree;
+using nvinfer1::plugin::pluginMalloc;
 
 namespace bert
 {
@@ -144,17 +156,550 @@ int computeMaskedScaledSoftmax(cudaStream_t stream, const int ld, const int B, c
     return 0;
 }
 
+// Fused attention: one warp computes the context of one query row, scores never leave shared memory
+constexpr int kFusedMaxSeqLen = 384;
+constexpr int kFusedMaxHeadSize = 128;
+constexpr int kFusedWarps = 8;    // query rows per block
+constexpr int kFusedKeyTile = 32; // keys or values staged in shared memory at a time, one per lane
+
+__device__ inline float toFloat(const float x)
+{
+    return x;
+}
+
+__device__ inline float toFloat(const half x)
+{
+    return __half2float(x);
+}
+
 template <typename T>
-inline int qkvToCtx(cublasHandle_t& cublas, const int B, const int S, const int numHeads, const int headSize,
-    const float rsqrtHeadSize, const T* input, T* output, T* qkptr, T* pptr, cudaStream_t stream,
-    const int* maskIdx = nullptr)
+__device__ inline T fromFloat(const float x);
+
+template <>
+__device__ inline float fromFloat<float>(const float x)
+{
+    return x;
+}
+
+template <>
+__device__ inline half fromFloat<half>(const float x)
+{
+    return __float2half(x);
+}
+
+inline bool canUseFusedAttention(const int S, const int headSize)
+{
+    return S <= kFusedMaxSeqLen && headSize % 32 == 0 && headSize <= kFusedMaxHeadSize;
+}
+
+inline size_t fusedAttentionSmemSize(const int S, const int headSize)
+{
+    // Scaled query rows, one padded tile of keys or values, and the scores of each row
+    return sizeof(float) * (kFusedWarps * headSize + kFusedKeyTile * (headSize + 1) + kFusedWarps * S);
+}
+
+//!
+//! Padded sequences are laid out SxBx3E as in qkvToCtx, with an optional number of valid keys per sequence in maskIdx.
+//! Packed sequences are laid out Tx1x3E, with sequence i in rows [cuSeqlens[i], cuSeqlens[i + 1]) and S the maximum
+//! sequence length.
+//!
+template <typename T>
+__global__ void __launch_bounds__(kFusedWarps * 32) fusedAttentionKernel(const int B, const int S,
+    const int numHeads, const int headSize, const float rsqrtHeadSize, const int* maskIdx, const int* cuSeqlens,
+    const T* input, T* output)
+{
+    // Grid: (B * numHeads, ceil(S / kFusedWarps))
+    extern __shared__ float smem[];
+    const int warp = threadIdx.x / 32;
+    const int lane = threadIdx.x % 32;
+    const int mat = blockIdx.x;
+    const int seq = mat / numHeads;
+
+    int rows = S;
+    int lastValid = S;
+    int ldQKV = 3 * B * numHeads * headSize;
+    int ldOut = B * numHeads * headSize;
+    const T* qkv = input + mat * 3 * headSize;
+    T* out = output + mat * headSize;
+    if (cuSeqlens)
+    {
+        const int start = cuSeqlens[seq];
+        rows = min(S, cuSeqlens[seq + 1] - start);
+        lastValid = rows;
+        ldQKV = 3 * numHeads * headSize;
+        ldOut = numHeads * headSize;
+        qkv = input + start * ldQKV + (mat % numHeads) * 3 * headSize;
+        out = output + start * ldOut + (mat % numHeads) * headSize;
+    }
+    else if (maskIdx)
+    {
+        lastValid = min(S, maskIdx[seq]);
+    }
+    if (blockIdx.y * kFusedWarps >= rows)
+    {
+        // Beyond the end of a packed sequence
+        return;
+    }
+
+    const int q = blockIdx.y * kFusedWarps + warp;
+    const bool active = q < rows;
+    const int ldTile = headSize + 1; // padding avoids bank conflicts between the lanes reading one key each
+
+    float* qRow = smem + warp * headSize;
+    float* tile = smem + kFusedWarps * headSize;
+    float* scores = tile + kFusedKeyTile * ldTile + warp * S;
+
+    if (active)
+    {
+        for (int h = lane; h < headSize; h += 32)
+        {
+            qRow[h] = toFloat(qkv[q * ldQKV + h]) * rsqrtHeadSize;
+        }
+    }
+
+    // Scores of the valid keys, each lane computes the dot product of the query with one key of the tile
+    for (int k0 = 0; k0 < lastValid; k0 += kFusedKeyTile)
+    {
+        const int keys = min(kFusedKeyTile, lastValid - k0);
+        __syncthreads();
+        for (int e = threadIdx.x; e < keys * headSize; e += blockDim.x)
+        {
+            const int k = e / headSize;
+            const int h = e % headSize;
+            tile[k * ldTile + h] = toFloat(qkv[(k0 + k) * ldQKV + headSize + h]);
+        }
+        __syncthreads();
+        if (active && lane < keys)
+        {
+            const float* key = tile + lane * ldTile;
+            float score = 0.f;
+            for (int h = 0; h < headSize; ++h)
+            {
+                score += qRow[h] * key[h];
+            }
+            scores[k0 + lane] = score;
+        }
+    }
+    __syncwarp();
+
+    // Softmax of the row within the warp
+    float rowMax = -FLT_MAX;
+    for (int k = lane; k < lastValid; k += 32)
+    {
+        rowMax = max(rowMax, scores[k]);
+    }
+    for (int offset = 16; offset > 0; offset /= 2)
+    {
+        rowMax = max(rowMax, __shfl_xor_sync(0xffffffff, rowMax, offset));
+    }
+    float rowSum = 0.f;
+    for (int k = lane; k < lastValid; k += 32)
+    {
+        const float e = __expf(scores[k] - rowMax);
+        scores[k] = e;
+        rowSum += e;
+    }
+    for (int offset = 16; offset > 0; offset /= 2)
+    {
+        rowSum += __shfl_xor_sync(0xffffffff, rowSum, offset);
+    }
+    const float rowScale = rowSum > 0.f ? 1.f / rowSum : 0.f;
+    __syncwarp();
+
+    // Probabilities times values, each lane accumulates headSize / 32 outputs
+    float acc[kFusedMaxHeadSize / 32] = {};
+    for (int k0 = 0; k0 < lastValid; k0 += kFusedKeyTile)
+    {
+        const int values = min(kFusedKeyTile, lastValid - k0);
+        __syncthreads();
+        for (int e = threadIdx.x; e < values * headSize; e += blockDim.x)
+        {
+            const int k = e / headSize;
+            const int h = e % headSize;
+            tile[k * ldTile + h] = toFloat(qkv[(k0 + k) * ldQKV + 2 * headSize + h]);
+        }
+        __syncthreads();
+        if (active)
+        {
+            for (int k = 0; k < values; ++k)
+            {
+                const float p = scores[k0 + k];
+                const float* value = tile + k * ldTile;
+#pragma unroll
+                for (int j = 0; j < kFusedMaxHeadSize / 32; ++j)
+                {
+                    if (lane + 32 * j < headSize)
+                    {
+                        acc[j] += p * value[lane + 32 * j];
+                    }
+                }
+            }
+        }
+    }
+
+    if (active)
+    {
+#pragma unroll
+        for (int j = 0; j < kFusedMaxHeadSize / 32; ++j)
+        {
+            const int h = lane + 32 * j;
+            if (h < headSize)
+            {
+                out[q * ldOut + h] = fromFloat<T>(acc[j] * rowScale);
+            }
+        }
+    }
+}
+
+//!
+//! \param cuSeqlens Offsets of the B packed sequences and total number of tokens, nullptr for padded sequences of
+//!        length S
+//!
+template <typename T>
+int fusedQkvToCtx(const int B, const int S, const int numHeads, const int headSize, const float rsqrtHeadSize,
+    const T* input, T* output, cudaStream_t stream, const int* maskIdx = nullptr, const int* cuSeqlens = nullptr)
+{
+    const dim3 grid(B * numHeads, (S + kFusedWarps - 1) / kFusedWarps, 1);
+    const size_t smem = fusedAttentionSmemSize(S, headSize);
+    fusedAttentionKernel<T><<<grid, kFusedWarps * 32, smem, stream>>>(
+        B, S, numHeads, headSize, rsqrtHeadSize, maskIdx, cuSeqlens, input, output);
+    CHECK(cudaPeekAtLastError());
+    return 0;
+}
+
+constexpr int kWindowThreads = 128;
+constexpr size_t kWindowMaxSmem = 48 << 10; // the query and the scores of the row, without opting in to more
+
+//!
+//! Keys attended by query i of a sequence of length len: all of them for the global queries, otherwise the global keys
+//! then the keys of the band [lo, hi] around the query. Returns the number of keys, key k being
+//! windowKey(k, global, lo).
+//!
+__device__ inline int windowKeys(const AttentionWindow& window, const int i, const int len, int& global, int& lo)
+{
+    global = min(window.numGlobal, len);
+    if (i < window.numGlobal)
+    {
+        lo = global;
+        return len;
+    }
+    lo = max(i - window.window, global);
+    const int hi = min(i + window.window, len - 1);
+    return global + max(hi - lo + 1, 0);
+}
+
+__device__ inline int windowKey(const int k, const int global, const int lo)
+{
+    return k < global ? k : lo + k - global;
+}
+
+inline size_t windowedAttentionSmemSize(const AttentionWindow& window, const int S, const int headSize)
+{
+    const int maxKeys = window.numGlobal > 0 ? S : std::min(S, 2 * window.window + 1);
+    return sizeof(float) * (headSize + maxKeys);
+}
+
+//!
+//! Attention of one query of one head over its window and the global tokens, the work and memory of a row are linear
+//! in the window instead of S
+//!
+template <typename T, unsigned TPB>
+__global__ void __launch_bounds__(TPB) windowedAttentionKernel(const int B, const int S, const int numHeads,
+    const int headSize, const float rsqrtHeadSize, const AttentionWindow window, const int* maskIdx, const T* input,
+    T* output)
+{
+    // Grid: (B * numHeads, S), row s * B + b of the input holds the Q, K, V of the heads of token s of sequence b
+    extern __shared__ float smem[];
+    using BlockReduce = cub::BlockReduce<float, TPB>;
+    __shared__ typename BlockReduce::TempStorage tmpStorage;
+    __shared__ float rowMax;
+    __shared__ float rowScale;
+
+    const int b = blockIdx.x / numHeads;
+    const int head = blockIdx.x % numHeads;
+    const int i = blockIdx.y;
+    const int len = maskIdx ? min(maskIdx[b], S) : S;
+    int global;
+    int lo;
+    const int nbKeys = windowKeys(window, i, len, global, lo);
+
+    float* q = smem;
+    float* scores = smem + headSize;
+
+    const int64_t rowStride = static_cast<int64_t>(B) * numHeads * 3 * headSize;
+    const T* qkv = input + (static_cast<int64_t>(b) * numHeads + head) * 3 * headSize;
+    for (int h = threadIdx.x; h < headSize; h += TPB)
+    {
+        q[h] = weightToFloat(qkv[i * rowStride + h]) * rsqrtHeadSize;
+    }
+    __syncthreads();
+
+    // One warp per key, the lanes split the dot product
+    const int warp = threadIdx.x / 32;
+    const int lane = threadIdx.x % 32;
+    for (int k = warp; k < nbKeys; k += TPB / 32)
+    {
+        const T* key = qkv + windowKey(k, global, lo) * rowStride + headSize;
+        float score = 0.f;
+        for (int h = lane; h < headSize; h += 32)
+        {
+            score += q[h] * weightToFloat(key[h]);
+        }
+        for (int offset = 16; offset > 0; offset /= 2)
+        {
+            score += __shfl_xor_sync(0xffffffff, score, offset);
+        }
+        if (lane == 0)
+        {
+            scores[k] = score;
+        }
+    }
+    __syncthreads();
+
+    float threadMax = -FLT_MAX;
+    for (int k = threadIdx.x; k < nbKeys; k += TPB)
+    {
+        threadMax = max(threadMax, scores[k]);
+    }
+    const float blockMax = BlockReduce(tmpStorage).Reduce(threadMax, cub::Max());
+    if (threadIdx.x == 0)
+    {
+        rowMax = blockMax;
+    }
+    __syncthreads();
+
+    float threadSum = 0.f;
+    for (int k = threadIdx.x; k < nbKeys; k += TPB)
+    {
+        const float e = __expf(scores[k] - rowMax);
+        scores[k] = e;
+        threadSum += e;
+    }
+    const float blockSum = BlockReduce(tmpStorage).Sum(threadSum);
+    if (threadIdx.x == 0)
+    {
+        rowScale = blockSum > 0.f ? 1.f / blockSum : 0.f;
+    }
+    __syncthreads();
+
+    // Probabilities times values, consecutive threads read consecutive elements of each value row
+    T* out = output + ((static_cast<int64_t>(i) * B + b) * numHeads + head) * headSize;
+    for (int h = threadIdx.x; h < headSize; h += TPB)
+    {
+        float acc = 0.f;
+        for (int k = 0; k < nbKeys; ++k)
+        {
+            acc += scores[k] * weightToFloat(qkv[windowKey(k, global, lo) * rowStride + 2 * headSize + h]);
+        }
+        out[h] = convertWeight<T>(acc * rowScale);
+    }
+}
+
+template <typename T>
+int windowedQkvToCtx(const int B, const int S, const int numHeads, const int headSize, const float rsqrtHeadSize,
+    const AttentionWindow& window, const T* input, T* output, cudaStream_t stream, const int* maskIdx)
+{
+    const size_t smem = windowedAttentionSmemSize(window, S, headSize);
+    if (smem > kWindowMaxSmem)
+    {
+        gLogError << "QKV: the scores of a row of " << S << " tokens exceed the shared memory" << std::endl;
+        return -1;
+    }
+    windowedAttentionKernel<T, kWindowThreads><<<dim3(B * numHeads, S), kWindowThreads, smem, stream>>>(
+        B, S, numHeads, headSize, rsqrtHeadSize, window, maskIdx, input, output);
+    CHECK(cudaPeekAtLastError());
+    return 0;
+}
+
+template <typename T>
+struct GemmExType;
+
+template <>
+struct GemmExType<float>
+{
+    static constexpr cudaDataType_t value = CUDA_R_32F;
+};
+
+template <>
+struct GemmExType<half>
 {
+    static constexpr cudaDataType_t value = CUDA_R_16F;
+};
 
-    const int omatSize = S * S;
-    const int numMats = B * numHeads;
+//!
+//! cublasGemmStridedBatched with a given algorithm, computing in the type of the operands as Sgemm and Hgemm do
+//!
+template <typename T>
+cublasStatus_t inline cublasGemmStridedBatchedAlgo(cublasHandle_t handle, cublasOperation_t transa,
+    cublasOperation_t transb, int m, int n, int k, const T alpha, const T* A, int lda, long long int strideA,
+    const T* B, int ldb, long long int strideB, const T beta, T* C, int ldc, long long int strideC, int batchCount,
+    int algo)
+{
+    const cudaDataType_t type = GemmExType<T>::value;
+    return cublasGemmStridedBatchedEx(handle, transa, transb, m, n, k, &alpha, A, type, lda, strideA, B, type, ldb,
+        strideB, &beta, C, type, ldc, strideC, batchCount, type, static_cast<cublasGemmAlgo_t>(algo));
+}
+
+//!
+//! Q * K' of the attention: BxN matrices of SxS scores
+//!
+template <typename T>
+cublasStatus_t inline attentionGemmQK(cublasHandle_t cublas, const int B, const int S, const int numHeads,
+    const int headSize, const T* input, T* qkptr, const int algo)
+{
     const T* qptr = input;
     const T* kptr = qptr + headSize;
-    const T* vptr = kptr + headSize;
+    const int ldQKV = 3 * B * numHeads * headSize;
+    const int strideQKV = 3 * headSize;
+    return cublasGemmStridedBatchedAlgo<T>(cublas, CUBLAS_OP_T, CUBLAS_OP_N, S, S, headSize, 1.f, kptr, ldQKV,
+        strideQKV, qptr, ldQKV, strideQKV, 0.f, qkptr, S, S * S, B * numHeads, algo);
+}
+
+//!
+//! P * V of the attention, computed as V * P: BxN matrices of SxH contexts
+//!
+template <typename T>
+cublasStatus_t inline attentionGemmPV(cublasHandle_t cublas, const int B, const int S, const int numHeads,
+    const int headSize, const T* input, const T* pptr, T* output, const int algo)
+{
+    const T* vptr = input + 2 * headSize;
+    const int ldQKV = 3 * B * numHeads * headSize;
+    const int strideQKV = 3 * headSize;
+    const int ldOut = B * numHeads * headSize;
+    const int strideOut = headSize;
+    return cublasGemmStridedBatchedAlgo<T>(cublas, CUBLAS_OP_N, CUBLAS_OP_N, headSize, S, S, 1.f, vptr, ldQKV,
+        strideQKV, pptr, S, S * S, 0.f, output, ldOut, strideOut, B * numHeads, algo);
+}
+
+//!
+//! \return The time of the fastest of the candidate algorithms of a GEMM, and the algorithm in algo
+//!
+template <typename Gemm>
+float timeGemmAlgos(const Gemm& gemm, const std::vector<int>& candidates, cudaStream_t stream, int& algo)
+{
+    constexpr int kIterations = 10;
+    cudaEvent_t start;
+    cudaEvent_t stop;
+    CHECK(cudaEventCreate(&start));
+    CHECK(cudaEventCreate(&stop));
+    float best = FLT_MAX;
+    for (const int candidate : candidates)
+    {
+        // Warm up, the algorithms that do not support the shape fail right away
+        if (gemm(candidate) != CUBLAS_STATUS_SUCCESS)
+        {
+            continue;
+        }
+        CHECK(cudaEventRecord(start, stream));
+        for (int i = 0; i < kIterations; ++i)
+        {
+            gemm(candidate);
+        }
+        CHECK(cudaEventRecord(stop, stream));
+        CHECK(cudaEventSynchronize(stop));
+        float time = 0.f;
+        CHECK(cudaEventElapsedTime(&time, start, stop));
+        if (time < best)
+        {
+            best = time;
+            algo = candidate;
+        }
+    }
+    CHECK(cudaEventDestroy(start));
+    CHECK(cudaEventDestroy(stop));
+    return best;
+}
+
+//!
+//! Time the cublasGemmAlgo_t algorithms of the two attention GEMMs for the largest shape of the profile
+//!
+template <typename T>
+AttentionGemmAlgos searchAttentionGemms(const int B, const int S, const int numHeads, const int headSize)
+{
+    std::vector<int> candidates{CUBLAS_GEMM_DEFAULT_TENSOR_OP};
+    for (int algo = CUBLAS_GEMM_ALGO0_TENSOR_OP; algo <= CUBLAS_GEMM_ALGO15_TENSOR_OP; ++algo)
+    {
+        candidates.push_back(algo);
+    }
+    candidates.push_back(CUBLAS_GEMM_DEFAULT);
+    for (int algo = CUBLAS_GEMM_ALGO0; algo <= CUBLAS_GEMM_ALGO23; ++algo)
+    {
+        candidates.push_back(algo);
+    }
+
+    const size_t inputSize = sizeof(T) * 3 * S * B * numHeads * headSize;
+    const size_t scoresSize = sizeof(T) * B * numHeads * S * S;
+    const size_t outputSize = sizeof(T) * S * B * numHeads * headSize;
+    T* input{nullptr};
+    T* scores{nullptr};
+    T* output{nullptr};
+    CHECK(pluginMalloc(&input, inputSize));
+    CHECK(pluginMalloc(&scores, scoresSize));
+    CHECK(pluginMalloc(&output, outputSize));
+    CHECK(cudaMemset(input, 0, inputSize));
+    CHECK(cudaMemset(scores, 0, scoresSize));
+
+    cudaStream_t stream;
+    CHECK(cudaStreamCreate(&stream));
+    nvinfer1::plugin::acquireLibraryHandles();
+    cublasHandle_t cublas = nvinfer1::plugin::getCublasHandle();
+    cublasSetStream(cublas, stream);
+
+    AttentionGemmAlgos algos{CUBLAS_GEMM_DEFAULT_TENSOR_OP, CUBLAS_GEMM_DEFAULT_TENSOR_OP};
+    {
+        CublasConfigHelper helper(cublas);
+        timeGemmAlgos(
+            [&](int algo) { return attentionGemmQK<T>(cublas, B, S, numHeads, headSize, input, scores, algo); },
+            candidates, stream, algos.qk);
+        timeGemmAlgos(
+            [&](int algo) { return attentionGemmPV<T>(cublas, B, S, numHeads, headSize, input, scores, output, algo); },
+            candidates, stream, algos.pv);
+    }
+
+    nvinfer1::plugin::releaseLibraryHandles();
+    CHECK(cudaStreamDestroy(stream));
+    CHECK(pluginFree(input));
+    CHECK(pluginFree(scores));
+    CHECK(pluginFree(output));
+    return algos;
+}
+
+//!
+//! Search the attention GEMMs once per GPU and shape, the layers of a network share the result
+//!
+template <typename T>
+AttentionGemmAlgos cachedAttentionGemmSearch(const int B, const int S, const int numHeads, const int headSize)
+{
+    using Key = std::tuple<int, int, int, int, int, int, int>;
+    static std::mutex searchMutex;
+    static std::map<Key, AttentionGemmAlgos> searched;
+
+    nvinfer1::plugin::GemmAlgoKey device{};
+    if (!nvinfer1::plugin::setGemmAlgoKeyDevice(device))
+    {
+        return searchAttentionGemms<T>(B, S, numHeads, headSize);
+    }
+    const Key key{device.computeCapability, device.multiProcessors, static_cast<int>(GemmExType<T>::value), B, S,
+        numHeads, headSize};
+    std::lock_guard<std::mutex> lock(searchMutex);
+    const auto found = searched.find(key);
+    if (found != searched.end())
+    {
+        gLogVerbose << "Reusing the attention GEMM algorithms" << std::endl;
+        return found->second;
+    }
+    gLogVerbose << "Start attention GEMM search" << std::endl;
+    const AttentionGemmAlgos algos = searchAttentionGemms<T>(B, S, numHeads, headSize);
+    gLogVerbose << "Done attention GEMM search: " << algos.qk << ", " << algos.pv << std::endl;
+    searched[key] = algos;
+    return algos;
+}
+
+template <typename T>
+inline int qkvToCtx(cublasHandle_t& cublas, const int B, const int S, const int numHeads, const int headSize,
+    const float rsqrtHeadSize, const T* input, T* output, T* qkptr, T* pptr, cudaStream_t stream,
+    const AttentionGemmAlgos& algos, const int* maskIdx = nullptr)
+{
 
     cublasSetStream(cublas, stream);
     CublasConfigHelper helper(cublas);
@@ -164,10 +709,11 @@ inline int qkvToCtx(cublasHandle_t& cublas, const int B, const int S, const int
     // P: BxNxSxS (-> scratch2)
     // P * V: BxNxSxH (output)
 
-    const int ldQKV = 3 * B * numHeads * headSize;
-    const int strideQKV = 3 * headSize;
-    CHECK(cublasGemmStridedBatched<T>(cublas, CUBLAS_OP_T, CUBLAS_OP_N, S, S, headSize, 1.f, kptr, ldQKV, strideQKV,
-        qptr, ldQKV, strideQKV, 0.f, qkptr, S, omatSize, numMats));
+    // The algorithms are tuned for the largest shape, the default ones take the shapes they do not support
+    if (attentionGemmQK<T>(cublas, B, S, numHeads, headSize, input, qkptr, algos.qk) != CUBLAS_STATUS_SUCCESS)
+    {
+        CHECK(attentionGemmQK<T>(cublas, B, S, numHeads, headSize, input, qkptr, CUBLAS_GEMM_DEFAULT_TENSOR_OP));
+    }
 
     // apply softmax
     if (maskIdx)
@@ -180,11 +726,10 @@ inline int qkvToCtx(cublasHandle_t& cublas, const int B, const int S, const int
     }
 
     // compute P*V (as V*P)
-
-    const int ldOut = B * numHeads * headSize;
-    const int strideOut = headSize;
-    CHECK(cublasGemmStridedBatched<T>(cublas, CUBLAS_OP_N, CUBLAS_OP_N, headSize, S, S, 1.f, vptr, ldQKV, strideQKV,
-        pptr, S, omatSize, 0.f, output, ldOut, strideOut, numMats));
+    if (attentionGemmPV<T>(cublas, B, S, numHeads, headSize, input, pptr, output, algos.pv) != CUBLAS_STATUS_SUCCESS)
+    {
+        CHECK(attentionGemmPV<T>(cublas, B, S, numHeads, headSize, input, pptr, output, CUBLAS_GEMM_DEFAULT_TENSOR_OP));
+    }
     return 0;
 }
 
@@ -204,12 +749,65 @@ constexpr size_t kAlignment = 256;
 constexpr uint32_t IIDX = 0; // index of the input tensor
 constexpr uint32_t MIDX = 1; // index of the mask
 
-QKVToContextPluginDynamic::QKVToContextPluginDynamic(
-    const std::string name, const DataType type, const int hiddenSize, const int numHeads, bool hasImask)
+size_t attentionWorkspaceSize(const DataType type, const int B, const int S, const int numHeads, const int headSize)
+{
+    if (canUseFusedAttention(S, headSize))
+    {
+        // Shorter sequences at runtime also take the fused path, which needs no scratch space
+        return 0;
+    }
+    const size_t scratchSize = samplesCommon::getElementSize(type) * B * numHeads * S * S;
+    return 2UL * alignTo<size_t>(scratchSize, kAlignment);
+}
+
+AttentionGemmAlgos selectAttentionGemmAlgos(
+    const DataType type, const int B, const int S, const int numHeads, const int headSize)
+{
+    if (canUseFusedAttention(S, headSize))
+    {
+        return AttentionGemmAlgos{CUBLAS_GEMM_DEFAULT_TENSOR_OP, CUBLAS_GEMM_DEFAULT_TENSOR_OP};
+    }
+    if (type == DataType::kFLOAT)
+    {
+        return cachedAttentionGemmSearch<float>(B, S, numHeads, headSize);
+    }
+    return cachedAttentionGemmSearch<half>(B, S, numHeads, headSize);
+}
+
+template <typename T>
+int computeAttention(const int B, const int S, const int numHeads, const int headSize, const float rsqrtHeadSize,
+    const T* input, T* output, void* workspace, cudaStream_t stream, const AttentionGemmAlgos& algos,
+    const int* maskIdx)
+{
+    if (canUseFusedAttention(S, headSize))
+    {
+        return fusedQkvToCtx(B, S, numHeads, headSize, rsqrtHeadSize, input, output, stream, maskIdx);
+    }
+
+    const size_t bytesAligned = alignTo<size_t>(sizeof(T) * B * numHeads * S * S, kAlignment);
+    T* scr1 = static_cast<T*>(workspace);
+    T* scr2 = reinterpret_cast<T*>(static_cast<char*>(workspace) + bytesAligned);
+
+    // The unfused path runs its batched GEMMs with the handle of the enqueuing thread
+    cublasHandle_t cublas = nvinfer1::plugin::getCublasHandle();
+    return qkvToCtx(cublas, B, S, numHeads, headSize, rsqrtHeadSize, input, output, scr1, scr2, stream, algos, maskIdx);
+}
+
+template int computeAttention<float>(const int B, const int S, const int numHeads, const int headSize,
+    const float rsqrtHeadSize, const float* input, float* output, void* workspace, cudaStream_t stream,
+    const AttentionGemmAlgos& algos, const int* maskIdx);
+template int computeAttention<half>(const int B, const int S, const int numHeads, const int headSize,
+    const float rsqrtHeadSize, const half* input, half* output, void* workspace, cudaStream_t stream,
+    const AttentionGemmAlgos& algos, const int* maskIdx);
+
+QKVToContextPluginDynamic::QKVToContextPluginDynamic(const std::string name, const DataType type,
+    const int hiddenSize, const int numHeads, bool hasImask, const int maxSeqLen, const AttentionWindow& window)
     : mLayerName(name)
     , mHiddenSize(hiddenSize)
     , mNumHeads(numHeads)
     , mHasImask(hasImask)
+    , mMaxSeqLen(maxSeqLen)
+    , mWindow(window)
     , mType(type)
 {
     assert(hiddenSize % numHeads == 0);
@@ -227,6 +825,25 @@ QKVToContextPluginDynamic::QKVToContextPluginDynamic(const std::string name, con
     deserialize_value(&data, &length, &mRsqrtHeadSize);
     deserialize_value(&data, &length, &mHasImask);
     deserialize_value(&data, &length, &mHiddenSize);
+    // Engines serialized before packed sequences were supported end here
+    mMaxSeqLen = 0;
+    if (length >= sizeof(mMaxSeqLen))
+    {
+        deserialize_value(&data, &length, &mMaxSeqLen);
+    }
+    // Engines serialized before the attention GEMMs were tuned run the default algorithms, deserialized plugins do not
+    // search again
+    if (length >= sizeof(mGemmAlgos))
+    {
+        deserialize_value(&data, &length, &mGemmAlgos);
+    }
+    mGemmAlgosSearched = true;
+    // Engines serialized before windowed attention was supported compute the dense attention
+    mWindow = AttentionWindow{0, 0};
+    if (length >= sizeof(mWindow))
+    {
+        deserialize_value(&data, &length, &mWindow);
+    }
     gLogVerbose << "QKV Deser done" << std::endl;
 }
 
@@ -234,7 +851,10 @@ QKVToContextPluginDynamic::QKVToContextPluginDynamic(const std::string name, con
 nvinfer1::IPluginV2DynamicExt* QKVToContextPluginDynamic::clone() const
 {
     gLogVerbose << "QKV Clone" << std::endl;
-    auto ret = new QKVToContextPluginDynamic(mLayerName, mType, mHiddenSize, mNumHeads, mHasImask);
+    auto ret
+        = new QKVToContextPluginDynamic(mLayerName, mType, mHiddenSize, mNumHeads, mHasImask, mMaxSeqLen, mWindow);
+    ret->mGemmAlgos = mGemmAlgos;
+    ret->mGemmAlgosSearched = mGemmAlgosSearched;
     ret->initialize();
     gLogVerbose << "QKV Clone done" << std::endl;
     return ret;
@@ -279,7 +899,7 @@ bool QKVToContextPluginDynamic::supportsFormatCombination(
             return (inMask->type == DataType::kINT32) &&     // precision
                 (inMask->format == TensorFormat::kLINEAR) && // format
                 (inMask->dims.nbDims == 1) &&                // num dims
-                ((inMask->dims.d[0]) == in->dims.d[BDIM])    // check B
+                (isPacked() || (inMask->dims.d[0]) == in->dims.d[BDIM]) // check B, packed: cumulative lengths
                 ;
         }
         if (!mHasImask || (pos == 2))
@@ -316,17 +936,18 @@ void QKVToContextPluginDynamic::configurePlugin(
         const PluginTensorDesc& maskDesc = in[MIDX].desc;
         TRT_UNUSED maskDesc;
         assert(maskDesc.type == DataType::kINT32);
-        assert(maskDesc.dims.d[0] == inDesc.dims.d[BDIM]);
+        assert(isPacked() || maskDesc.dims.d[0] == inDesc.dims.d[BDIM]);
     }
-}
-
-size_t QKVToContextPluginDynamic::scratchSize(const int B, const int S) const
-{
-    const size_t wordSize = samplesCommon::getElementSize(mType);
-    const size_t len = B * mNumHeads * S * S;
-    const size_t bytes = len * wordSize;
 
-    return bytes;
+    // The batched GEMMs only run for the sequences too long for the fused kernel, they are tuned for the largest
+    // shape of the profile
+    const int B = in[IIDX].max.d[BDIM];
+    const int S = in[IIDX].max.d[SDIM];
+    if (!mGemmAlgosSearched && !isPacked() && !isWindowed())
+    {
+        mGemmAlgos = selectAttentionGemmAlgos(mType, B, S, mNumHeads, mHeadSize);
+        mGemmAlgosSearched = true;
+    }
 }
 
 size_t QKVToContextPluginDynamic::getWorkspaceSize(
@@ -335,10 +956,11 @@ size_t QKVToContextPluginDynamic::getWorkspaceSize(
     const int B = inputs->dims.d[BDIM];
     const int S = inputs->dims.d[SDIM];
 
-    const size_t bytesAligned = alignTo<size_t>(scratchSize(B, S), kAlignment);
-    const size_t ws = 2UL * bytesAligned;
-
-    return ws;
+    if (isPacked() || isWindowed())
+    {
+        return 0;
+    }
+    return attentionWorkspaceSize(mType, B, S, mNumHeads, mHeadSize);
 }
 
 // IPluginV2Ext Methods
@@ -368,19 +990,19 @@ int QKVToContextPluginDynamic::getNbOutputs() const
 
 int QKVToContextPluginDynamic::initialize()
 {
-    cublasCreate(&cublas);
+    nvinfer1::plugin::acquireLibraryHandles();
     return 0;
 }
 
 void QKVToContextPluginDynamic::terminate()
 {
-    CHECK(cublasDestroy(cublas));
+    nvinfer1::plugin::releaseLibraryHandles();
 }
 
 size_t QKVToContextPluginDynamic::getSerializationSize() const
 {
     return sizeof(mNumHeads) + sizeof(mHeadSize) + sizeof(DataType) + sizeof(mRsqrtHeadSize) + sizeof(mHasImask)
-        + sizeof(mHiddenSize);
+        + sizeof(mHiddenSize) + sizeof(mMaxSeqLen) + sizeof(mGemmAlgos) + sizeof(mWindow);
 }
 
 void QKVToContextPluginDynamic::serialize(void* buffer) const
@@ -391,6 +1013,9 @@ void QKVToContextPluginDynamic::serialize(void* buffer) const
     serialize_value(&buffer, mRsqrtHeadSize);
     serialize_value(&buffer, mHasImask);
     serialize_value(&buffer, mHiddenSize);
+    serialize_value(&buffer, mMaxSeqLen);
+    serialize_value(&buffer, mGemmAlgos);
+    serialize_value(&buffer, mWindow);
 }
 
 void QKVToContextPluginDynamic::destroy()
@@ -411,36 +1036,67 @@ const char* QKVToContextPluginDynamic::getPluginNamespace() const
 int QKVToContextPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
     const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
 
     const int batchSize = inputDesc->dims.d[BDIM];
     const int S = inputDesc->dims.d[SDIM];
 
-    const size_t bytesAligned = alignTo<size_t>(scratchSize(batchSize, S), kAlignment);
-    char* scratch1 = static_cast<char*>(workspace);
-    char* scratch2 = scratch1 + bytesAligned;
-
     const int* maskIdx = mHasImask ? static_cast<const int*>(inputs[1]) : nullptr;
 
     int status = -1;
-    if (mType == DataType::kFLOAT)
+    if (isPacked())
     {
-        const float* input = static_cast<const float*>(inputs[0]);
-        float* output = static_cast<float*>(outputs[0]);
-        float* scr1 = reinterpret_cast<float*>(scratch1);
-        float* scr2 = reinterpret_cast<float*>(scratch2);
+        // T tokens of all the sequences in the S dimension, the mask input holds the B + 1 cumulative lengths
+        const int nbSeqs = inputDesc[MIDX].dims.d[0] - 1;
+        if (mType == DataType::kFLOAT)
+        {
+            status = fusedQkvToCtx(nbSeqs, mMaxSeqLen, mNumHeads, mHeadSize, mRsqrtHeadSize,
+                static_cast<const float*>(inputs[0]), static_cast<float*>(outputs[0]), stream, nullptr, maskIdx);
+        }
+        else if (mType == DataType::kHALF)
+        {
+            status = fusedQkvToCtx(nbSeqs, mMaxSeqLen, mNumHeads, mHeadSize, mRsqrtHeadSize,
+                static_cast<const half*>(inputs[0]), static_cast<half*>(outputs[0]), stream, nullptr, maskIdx);
+        }
+        else
+        {
+            assert(false);
+        }
+        return status;
+    }
 
-        status = qkvToCtx(
-            cublas, batchSize, S, mNumHeads, mHeadSize, mRsqrtHeadSize, input, output, scr1, scr2, stream, maskIdx);
+    if (isWindowed())
+    {
+        if (mType == DataType::kFLOAT)
+        {
+            status = windowedQkvToCtx(batchSize, S, mNumHeads, mHeadSize, mRsqrtHeadSize, mWindow,
+                static_cast<const float*>(inputs[0]), static_cast<float*>(outputs[0]), stream, maskIdx);
+        }
+        else if (mType == DataType::kHALF)
+        {
+            status = windowedQkvToCtx(batchSize, S, mNumHeads, mHeadSize, mRsqrtHeadSize, mWindow,
+                static_cast<const half*>(inputs[0]), static_cast<half*>(outputs[0]), stream, maskIdx);
+        }
+        else
+        {
+            assert(false);
+        }
+        return status;
+    }
+
+    if (mType == DataType::kFLOAT)
+    {
+        status = computeAttention(batchSize, S, mNumHeads, mHeadSize, mRsqrtHeadSize,
+            static_cast<const float*>(inputs[0]), static_cast<float*>(outputs[0]), workspace, stream, mGemmAlgos,
+            maskIdx);
     }
     else if (mType == DataType::kHALF)
     {
-        const half* input = static_cast<const half*>(inputs[0]);
-        half* output = static_cast<half*>(outputs[0]);
-        half* scr1 = reinterpret_cast<half*>(scratch1);
-        half* scr2 = reinterpret_cast<half*>(scratch2);
-
-        status = qkvToCtx(
-            cublas, batchSize, S, mNumHeads, mHeadSize, mRsqrtHeadSize, input, output, scr1, scr2, stream, maskIdx);
+        status = computeAttention(batchSize, S, mNumHeads, mHeadSize, mRsqrtHeadSize,
+            static_cast<const half*>(inputs[0]), static_cast<half*>(outputs[0]), workspace, stream, mGemmAlgos,
+            maskIdx);
     }
     else
     {
@@ -478,7 +1134,9 @@ IPluginV2* QKVToContextPluginDynamicCreator::createPlugin(const char* name, cons
     int hiddenSize = 0;
     int numHeads = 0;
     bool hasMask = false;
+    int maxSeqLen = 0;
     int typeId = -1;
+    AttentionWindow window{0, 0};
 
     for (int i = 0; i < fc->nbFields; i++)
     {
@@ -504,6 +1162,21 @@ IPluginV2* QKVToContextPluginDynamicCreator::createPlugin(const char* name, cons
             hasMask = *static_cast<const bool*>(fc->fields[i].data);
             gLogVerbose << "Building hasMask: " << hasMask << std::endl;
         }
+        if (field_name.compare("max_seq_len") == 0)
+        {
+            maxSeqLen = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building maxSeqLen: " << maxSeqLen << std::endl;
+        }
+        if (field_name.compare("window_size") == 0)
+        {
+            window.window = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building windowSize: " << window.window << std::endl;
+        }
+        if (field_name.compare("num_global_tokens") == 0)
+        {
+            window.numGlobal = *static_cast<const int*>(fc->fields[i].data);
+            gLogVerbose << "Building numGlobalTokens: " << window.numGlobal << std::endl;
+        }
     }
     if (typeId < 0 || typeId > 3)
     {
@@ -520,9 +1193,25 @@ IPluginV2* QKVToContextPluginDynamicCreator::createPlugin(const char* name, cons
         gLogError << "QKV: Invalid numHeads " << numHeads << std::endl;
     }
 
+    if (maxSeqLen && (!hasMask || !canUseFusedAttention(maxSeqLen, hiddenSize / std::max(numHeads, 1))))
+    {
+        gLogError << "QKV: Packed sequences require the cumulative lengths as mask, and a max_seq_len of at most "
+                  << kFusedMaxSeqLen << " with a head size multiple of 32 up to " << kFusedMaxHeadSize << std::endl;
+        return nullptr;
+    }
+
+    if (window.window < 0 || window.numGlobal < 0 || (window.numGlobal > 0 && window.window == 0)
+        || (window.window > 0 && maxSeqLen))
+    {
+        gLogError << "QKV: Invalid window_size " << window.window << " or num_global_tokens " << window.numGlobal
+                  << ", windowed attention takes a positive window and padded sequences" << std::endl;
+        return nullptr;
+    }
+
     gLogVerbose << "Building the Plugin...\n";
     DataType type = static_cast<DataType>(typeId);
-    QKVToContextPluginDynamic* p = new QKVToContextPluginDynamic(name, type, hiddenSize, numHeads, hasMask);
+    QKVToContextPluginDynamic* p
+        = new QKVToContextPluginDynamic(name, type, hiddenSize, numHeads, hasMask, maxSeqLen, window);
     return p;
 }
 
@@ -25,6 +25,45 @@
 namespace bert
 {
 
+//!
+//! cublasGemmAlgo_t of the Q * K' and P * V batched GEMMs of the unfused attention, serialized with the plugin
+//!
+struct AttentionGemmAlgos
+{
+    int qk;
+    int pv;
+};
+
+//!
+//! Local attention for long sequences: each token attends to the tokens at most window positions away and to the
+//! numGlobal leading tokens, which attend to all the tokens. A window of 0 is the dense attention.
+//!
+struct AttentionWindow
+{
+    int window;
+    int numGlobal;
+};
+
+//!
+//! Workspace of computeAttention for B padded sequences of length S
+//!
+size_t attentionWorkspaceSize(nvinfer1::DataType type, int B, int S, int numHeads, int headSize);
+
+//!
+//! Algorithms of the batched GEMMs of computeAttention tuned for B sequences of length S, the default ones when the
+//! fused kernel takes the sequences
+//!
+AttentionGemmAlgos selectAttentionGemmAlgos(nvinfer1::DataType type, int B, int S, int numHeads, int headSize);
+
+//!
+//! Attention of the SxBx3E QKV of B padded sequences into their SxBxE context, with the fused kernel for short
+//! sequences and the batched GEMMs in the workspace otherwise. maskIdx holds the number of valid tokens of each
+//! sequence, or is nullptr.
+//!
+template <typename T>
+int computeAttention(int B, int S, int numHeads, int headSize, float rsqrtHeadSize, const T* input, T* output,
+    void* workspace, cudaStream_t stream, const AttentionGemmAlgos& algos, const int* maskIdx);
+
 // One of the preferred ways of making TensorRT to be able to see
 // our custom layer requires extending IPluginV2 and IPluginCreator classes.
 // For requirements for overriden functions, check TensorRT API docs.
@@ -32,8 +71,13 @@ namespace bert
 class QKVToContextPluginDynamic : public nvinfer1::IPluginV2DynamicExt
 {
 public:
+    //!
+    //! \param maxSeqLen Maximum length of packed sequences, 0 for padded sequences. With packed sequences the input is
+    //!        Tx1x3E for a total of T tokens and the mask holds the B + 1 cumulative sequence lengths.
+    //! \param window Window of the attention of padded sequences, the dense attention by default
+    //!
     QKVToContextPluginDynamic(const std::string name, const nvinfer1::DataType type, const int hiddenSize, const int numHeads,
-        bool hasImask = false);
+        bool hasImask = false, const int maxSeqLen = 0, const AttentionWindow& window = AttentionWindow{0, 0});
 
     QKVToContextPluginDynamic(const std::string name, const void* data, size_t length);
 
@@ -70,7 +114,16 @@ public:
     const char* getPluginNamespace() const override;
 
 private:
-    size_t scratchSize(const int B, const int S) const;
+    bool isPacked() const
+    {
+        return mMaxSeqLen > 0;
+    }
+
+    bool isWindowed() const
+    {
+        return mWindow.window > 0;
+    }
+
     float mRsqrtHeadSize;
     int mHeadSize;
     int mB;
@@ -78,11 +131,14 @@ private:
     int mHiddenSize;
     int mNumHeads;
     bool mHasImask;
+    int mMaxSeqLen;
+    AttentionGemmAlgos mGemmAlgos{CUBLAS_GEMM_DEFAULT_TENSOR_OP, CUBLAS_GEMM_DEFAULT_TENSOR_OP};
+    bool mGemmAlgosSearched{false};
+    AttentionWindow mWindow;
     const std::string mLayerName;
     std::string mNamespace;
 
     nvinfer1::DataType mType;
-    cublasHandle_t cublas;
 
 protected:
     // To prevent compiler warnings.
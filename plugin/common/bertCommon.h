@@ -25,6 +25,7 @@
 #include "logging.h"
 #include "common.h"
 #include "half.h"
+#include "pluginAllocator.h"
 
 extern Logger gLogger;
 extern LogStreamConsumer gLogVerbose;
@@ -37,7 +38,13 @@ void setReportableSeverity(Logger::Severity severity);
 
 #define TRT_UNUSED (void)
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <utility>
 #include <vector>
 
 typedef __half half;
@@ -50,17 +57,224 @@ constexpr uint32_t HDIM = 2; // hidden dimension
 #define HDI inline __host__ __device__
 
 template <typename T>
-inline T* deserToDev(const char*& buffer, size_t nbElem)
+struct CudaDeleter
 {
-    T* dev = nullptr;
-    const size_t len = sizeof(T) * nbElem;
-    CHECK(cudaMalloc(&dev, len));
-    CHECK(cudaMemcpy(dev, buffer, len, cudaMemcpyHostToDevice));
+    void operator()(T* buf)
+    {
+        CHECK(nvinfer1::plugin::pluginFree(buf));
+    }
+};
 
-    buffer += len;
-    return dev;
+//!
+//! Immutable device weights shared by a plugin and its clones, released with the last of them
+//!
+template <typename T>
+using cuda_shared_ptr = std::shared_ptr<T>;
+
+template <typename T>
+void make_cuda_shared(cuda_shared_ptr<T>& ptr, void* cudaMem)
+{
+    ptr.reset(static_cast<T*>(cudaMem), bert::CudaDeleter<T>());
 }
 
+//!
+//! Weights of the plugins deserialized together, uploaded to one device arena with a single copy
+//!
+//! The weights are gathered in pinned host memory as the plugins are deserialized. The first plugin initialized
+//! closes the batch, allocates the arena and issues the copy on a stream of its own, which leaves the host free to
+//! initialize the other plugins. The first enqueue waits for the copy.
+//!
+class WeightBatch
+{
+public:
+    WeightBatch() = default;
+
+    WeightBatch(const WeightBatch&) = delete;
+    WeightBatch& operator=(const WeightBatch&) = delete;
+
+    ~WeightBatch()
+    {
+        if (mArena)
+        {
+            cudaEventSynchronize(mDone);
+            cudaEventDestroy(mDone);
+            cudaStreamDestroy(mStream);
+            nvinfer1::plugin::pluginFree(mArena);
+        }
+        if (mHost)
+        {
+            cudaFreeHost(mHost);
+        }
+    }
+
+    //!
+    //! \brief Append a weight to the open batch of the current device
+    //!
+    //! \return The batch and the offset of the weight in its arena
+    //!
+    static std::pair<std::shared_ptr<WeightBatch>, size_t> stage(const char* data, size_t len)
+    {
+        int device{0};
+        CHECK(cudaGetDevice(&device));
+        std::lock_guard<std::mutex> lock(mutex());
+        auto& batch = open();
+        if (!batch || batch->mDevice != device)
+        {
+            batch.reset(new WeightBatch);
+            batch->mDevice = device;
+        }
+        const size_t offset = (batch->mSize + kAlignment - 1) / kAlignment * kAlignment;
+        batch->reserve(offset + len);
+        std::memcpy(batch->mHost + offset, data, len);
+        batch->mSize = offset + len;
+        return std::make_pair(batch, offset);
+    }
+
+    //!
+    //! \brief The device address of the weight at offset, the first call uploads the batch
+    //!
+    char* device(size_t offset)
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (!mArena)
+        {
+            upload();
+        }
+        return mArena + offset;
+    }
+
+    //!
+    //! \brief Block until the upload completed, a single flag check once it did
+    //!
+    void wait()
+    {
+        if (mReady.load())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex());
+        if (!mArena)
+        {
+            upload();
+        }
+        CHECK(cudaEventSynchronize(mDone));
+        if (mHost)
+        {
+            CHECK(cudaFreeHost(mHost));
+            mHost = nullptr;
+        }
+        mReady.store(true);
+    }
+
+private:
+    // Alignment of the weights in the arena, enough for vectorized loads of any type
+    static constexpr size_t kAlignment = 256;
+    static constexpr size_t kMinCapacity = 1 << 20;
+
+    static std::mutex& mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+
+    static std::shared_ptr<WeightBatch>& open()
+    {
+        static std::shared_ptr<WeightBatch> batch;
+        return batch;
+    }
+
+    void reserve(size_t size)
+    {
+        if (size <= mCapacity)
+        {
+            return;
+        }
+        const size_t capacity = std::max({size, 2 * mCapacity, kMinCapacity});
+        char* host{nullptr};
+        CHECK(cudaMallocHost(reinterpret_cast<void**>(&host), capacity));
+        if (mHost)
+        {
+            std::memcpy(host, mHost, mSize);
+            CHECK(cudaFreeHost(mHost));
+        }
+        mHost = host;
+        mCapacity = capacity;
+    }
+
+    void upload()
+    {
+        // Plugins deserialized from now on go to a new batch
+        if (open().get() == this)
+        {
+            open().reset();
+        }
+        CHECK(nvinfer1::plugin::pluginMalloc(&mArena, std::max(mSize, size_t{kAlignment})));
+        CHECK(cudaStreamCreateWithFlags(&mStream, cudaStreamNonBlocking));
+        CHECK(cudaEventCreateWithFlags(&mDone, cudaEventDisableTiming));
+        CHECK(cudaMemcpyAsync(mArena, mHost, mSize, cudaMemcpyHostToDevice, mStream));
+        CHECK(cudaEventRecord(mDone, mStream));
+    }
+
+    int mDevice{0};
+    char* mHost{nullptr}; // Pinned, released once the upload completed
+    size_t mSize{0};
+    size_t mCapacity{0};
+    char* mArena{nullptr};
+    cudaStream_t mStream{nullptr};
+    cudaEvent_t mDone{nullptr};
+    std::atomic<bool> mReady{false};
+};
+
+//!
+//! Device weights of a plugin staged at deserialization, in batch with those of the other plugins of the engine
+//!
+//! Copies share the staged weights, so that clones resolve them to the same device memory.
+//!
+class StagedWeights
+{
+public:
+    //!
+    //! \brief Stage the next weight of a serialized plugin, in place of a synchronous upload
+    //!
+    template <typename T>
+    void stage(const char*& buffer, size_t nbElem)
+    {
+        const size_t len = sizeof(T) * nbElem;
+        mWeights.push_back(WeightBatch::stage(buffer, len));
+        buffer += len;
+    }
+
+    //!
+    //! \brief Point ptr at the device copy of the index-th weight staged, the memory lives as long as ptr
+    //!
+    template <typename T>
+    void resolve(size_t index, cuda_shared_ptr<T>& ptr) const
+    {
+        const auto& weight = mWeights[index];
+        void* dev = weight.first->device(weight.second);
+        ptr = cuda_shared_ptr<T>(weight.first, static_cast<T*>(dev));
+    }
+
+    //!
+    //! \brief Block until the staged weights are on the device, called before each enqueue
+    //!
+    void wait() const
+    {
+        for (const auto& weight : mWeights)
+        {
+            weight.first->wait();
+        }
+    }
+
+    bool empty() const
+    {
+        return mWeights.empty();
+    }
+
+private:
+    std::vector<std::pair<std::shared_ptr<WeightBatch>, size_t>> mWeights;
+};
+
 template <typename T>
 inline void serFromDev(char*& buffer, const T* data, size_t nbElem)
 {
@@ -125,6 +339,21 @@ __device__ inline half exp(const half x)
     return hexp(x);
 }
 
+//!
+//! INT8 tensors hold x / scale rounded and saturated to [-127, 127], with the per-tensor scale TensorRT passes in the
+//! plugin tensor descriptions. Kernels dequantize their inputs and accumulate in FP32.
+//!
+__device__ inline float dequantize(const int8_t q, const float scale)
+{
+    return static_cast<float>(q) * scale;
+}
+
+__device__ inline int8_t quantize(const float x, const float rScale)
+{
+    const int q = __float2int_rn(x * rScale);
+    return static_cast<int8_t>(max(-127, min(127, q)));
+}
+
 using kv_float = cub::KeyValuePair<float, float>;
 using kv_half = cub::KeyValuePair<half, half>;
 using kv_half2 = cub::KeyValuePair<half2, half2>;
@@ -180,6 +409,35 @@ __device__ inline void layerNorm(
     }
 }
 
+//!
+//! Layer norm of a row staged in FP32 in shared memory, quantized on output with the reciprocal output scale
+//!
+template <int TPB>
+__device__ inline void layerNormInt8(const kvp<float>& threadData, const int ld, const int offset, const float* row,
+    const float* beta, const float* gamma, const float outRScale, int8_t* output)
+{
+    // Assuming threadData is already divided by ld
+
+    using BlockReduce = cub::BlockReduce<kvp<float>, TPB>;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    __shared__ float mu;     // mean
+    __shared__ float rsigma; // 1 / std.dev.
+
+    const auto sumKV = BlockReduce(temp_storage).Reduce(threadData, cub::Sum());
+
+    if (threadIdx.x == 0)
+    {
+        mu = sumKV.key;
+        rsigma = rsqrt(sumKV.value - mu * mu);
+    }
+    __syncthreads();
+
+    for (int i = threadIdx.x; i < ld; i += TPB)
+    {
+        output[offset + i] = quantize(gamma[i] * (row[i] - mu) * rsigma + beta[i], outRScale);
+    }
+}
+
 template <typename T, int TPB>
 __device__ inline void layerNormSmall(const T val, const kvp<T>& threadData, const int ld, const int idx,
     const float* beta, const float* gamma, T* output)
@@ -365,6 +623,72 @@ struct CublasConfigHelper
     }
 };
 
+template <typename TDst>
+__device__ inline TDst convertWeight(float x);
+
+template <>
+__device__ inline float convertWeight<float>(float x)
+{
+    return x;
+}
+
+template <>
+__device__ inline half convertWeight<half>(float x)
+{
+    return __float2half(x);
+}
+
+__device__ inline float weightToFloat(float x)
+{
+    return x;
+}
+
+__device__ inline float weightToFloat(half x)
+{
+    return __half2float(x);
+}
+
+template <typename TSrc, typename TDst>
+__global__ void convertWeightsKernel(const TSrc* src, TDst* dst, size_t count)
+{
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < count;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        dst[i] = convertWeight<TDst>(weightToFloat(src[i]));
+    }
+}
+
+//!
+//! Uploads host weights of type TSrc and converts them to TDst on the device, in chunks through a staging buffer
+//!
+//! The host only copies, so that embedding tables upload at the bandwidth of the bus instead of the speed of a
+//! conversion loop on one core. The copies and the kernels run in order on the default stream, the staging buffer is
+//! reused from one chunk to the next and released once the last conversion is done.
+//!
+template <typename TSrc, typename TDst>
+void convertOnDevice(const TSrc* src, TDst* destDev, size_t count)
+{
+    constexpr size_t kChunk{size_t(1) << 22};
+    constexpr int kThreads{256};
+    const size_t chunk = std::min(count, kChunk);
+    if (!chunk)
+    {
+        return;
+    }
+    TSrc* staging{nullptr};
+    CHECK(nvinfer1::plugin::pluginMalloc(&staging, chunk * sizeof(TSrc)));
+    for (size_t offset = 0; offset < count; offset += chunk)
+    {
+        const size_t n = std::min(chunk, count - offset);
+        CHECK(cudaMemcpy(staging, src + offset, n * sizeof(TSrc), cudaMemcpyHostToDevice));
+        const int blocks = static_cast<int>(std::min<size_t>((n + kThreads - 1) / kThreads, 1024));
+        convertWeightsKernel<<<blocks, kThreads>>>(staging, destDev + offset, n);
+        CHECK(cudaGetLastError());
+    }
+    CHECK(cudaStreamSynchronize(nullptr));
+    CHECK(nvinfer1::plugin::pluginFree(staging));
+}
+
 inline void convertAndCopyToDevice(const nvinfer1::Weights& src, float* destDev)
 {
 
@@ -378,15 +702,7 @@ inline void convertAndCopyToDevice(const nvinfer1::Weights& src, float* destDev)
     else
     {
         gLogVerbose << "Half Weights(Host) => Float Array(Device)" << std::endl;
-        std::vector<float> tmp(src.count);
-        const half* values = reinterpret_cast<const half*>(src.values);
-
-        for (int it = 0; it < tmp.size(); it++)
-        {
-            tmp[it] = __half2float(values[it]);
-        }
-
-        CHECK(cudaMemcpy(destDev, &tmp[0], nbBytes, cudaMemcpyHostToDevice));
+        convertOnDevice(reinterpret_cast<const half*>(src.values), destDev, src.count);
     }
 }
 
@@ -402,14 +718,7 @@ inline void convertAndCopyToDevice(const nvinfer1::Weights& src, half* destDev)
     else
     {
         gLogVerbose << "Float Weights(Host) => Half Array(Device)" << std::endl;
-        std::vector<half> tmp(src.count);
-        const float* values = reinterpret_cast<const float*>(src.values);
-
-        for (int it = 0; it < tmp.size(); it++)
-        {
-            tmp[it] = __float2half(values[it]);
-        }
-        CHECK(cudaMemcpy(destDev, &tmp[0], nbBytes, cudaMemcpyHostToDevice));
+        convertOnDevice(reinterpret_cast<const float*>(src.values), destDev, src.count);
     }
 }
 
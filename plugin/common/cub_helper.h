@@ -25,3 +25,18 @@ size_t cubSortPairsWorkspaceSize(int num_items, int num_segments)
         (const int*) NULL, (const int*) NULL);
     return temp_storage_bytes;
 }
+
+// Workspace of the DoubleBuffer flavour of the segmented sort, which ping-pongs between caller provided buffers and
+// only needs a few bytes of temporary storage
+template <typename KeyT, typename ValueT>
+size_t cubSortPairsDoubleBufferWorkspaceSize(int num_items, int num_segments)
+{
+    size_t temp_storage_bytes = 0;
+    cub::DoubleBuffer<KeyT> keys(NULL, NULL);
+    cub::DoubleBuffer<ValueT> values(NULL, NULL);
+    cub::DeviceSegmentedRadixSort::SortPairsDescending((void*) NULL, temp_storage_bytes, keys, values,
+        num_items,    // # items
+        num_segments, // # segments
+        (const int*) NULL, (const int*) NULL);
+    return temp_storage_bytes;
+}
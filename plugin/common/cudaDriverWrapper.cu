@@ -46,6 +46,7 @@ CUDADriverWrapper::CUDADriverWrapper()
     *(void**)(&_cuLinkAddFile) = load_sym(handle, "cuLinkAddFile_v2");
     *(void**)(&_cuLinkAddData) = load_sym(handle, "cuLinkAddData_v2");
     *(void**)(&_cuLaunchCooperativeKernel) = load_sym(handle, "cuLaunchCooperativeKernel");
+    *(void**)(&_cuLaunchKernel) = load_sym(handle, "cuLaunchKernel");
 }
 
 CUDADriverWrapper::~CUDADriverWrapper()
@@ -110,5 +111,13 @@ CUresult CUDADriverWrapper::cuLaunchCooperativeKernel (CUfunction f, unsigned in
         blockDimX, blockDimY, blockDimZ, sharedMemBytes, hStream, kernelParams);
 }
 
+CUresult CUDADriverWrapper::cuLaunchKernel(CUfunction f, unsigned int gridDimX, unsigned int gridDimY,
+    unsigned int gridDimZ, unsigned int blockDimX, unsigned int blockDimY, unsigned int blockDimZ,
+    unsigned int sharedMemBytes, CUstream hStream, void** kernelParams, void** extra) const
+{
+    return (*_cuLaunchKernel)(
+        f, gridDimX, gridDimY, gridDimZ, blockDimX, blockDimY, blockDimZ, sharedMemBytes, hStream, kernelParams, extra);
+}
+
 #endif // __x86_64__
 #endif //__linux__
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_PLUGIN_ENQUEUE_AUDIT_H
+#define TRT_PLUGIN_ENQUEUE_AUDIT_H
+
+// Marks plugin enqueues for the enqueue audit library, libnvinfer_plugin_audit.so.
+//
+// The marks are compiled in with the PLUGIN_ENQUEUE_AUDIT CMake option, which defines ENABLE_ENQUEUE_AUDIT. The audit
+// library is preloaded into the application and interposes the CUDA runtime calls that allocate, free, synchronize or
+// copy synchronously, counting the ones issued from within a marked enqueue per plugin type. Without the preloaded
+// library the marks do nothing, and without ENABLE_ENQUEUE_AUDIT ENQUEUE_AUDIT expands to nothing.
+
+#ifdef ENABLE_ENQUEUE_AUDIT
+
+// Defined by the audit library, null when it is not loaded
+extern "C" void trtEnqueueAuditBegin(const char* pluginType) __attribute__((weak));
+extern "C" void trtEnqueueAuditEnd() __attribute__((weak));
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+class EnqueueAuditScope
+{
+public:
+    explicit EnqueueAuditScope(const char* pluginType)
+    {
+        if (trtEnqueueAuditBegin)
+        {
+            trtEnqueueAuditBegin(pluginType);
+        }
+    }
+
+    EnqueueAuditScope(const EnqueueAuditScope&) = delete;
+    EnqueueAuditScope& operator=(const EnqueueAuditScope&) = delete;
+
+    ~EnqueueAuditScope()
+    {
+        if (trtEnqueueAuditEnd)
+        {
+            trtEnqueueAuditEnd();
+        }
+    }
+};
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#define ENQUEUE_AUDIT(pluginType) nvinfer1::plugin::EnqueueAuditScope enqueueAuditScope_(pluginType)
+
+#else
+
+#define ENQUEUE_AUDIT(pluginType)
+
+#endif // ENABLE_ENQUEUE_AUDIT
+
+#endif // TRT_PLUGIN_ENQUEUE_AUDIT_H
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_PLUGIN_ENQUEUE_TIMING_H
+#define TRT_PLUGIN_ENQUEUE_TIMING_H
+#include <atomic>
+#include <chrono>
+
+// Measures the host time of plugin enqueues, for the timer set with setLibNvInferPluginsEnqueueTimer.
+//
+// Unlike the enqueue audit marks, the timing scopes are always compiled in: without a timer they only load it, and
+// the clock is read only while a timer is set.
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+using EnqueueTimer = void (*)(const char* pluginType, const char* layerName, float microseconds);
+
+//! The timer of the process, null when enqueues are not timed
+extern std::atomic<EnqueueTimer> gEnqueueTimer;
+
+class EnqueueTimingScope
+{
+public:
+    EnqueueTimingScope(const char* pluginType, const char* layerName)
+        : mTimer(gEnqueueTimer.load(std::memory_order_relaxed))
+        , mPluginType(pluginType)
+        , mLayerName(layerName)
+    {
+        if (mTimer)
+        {
+            mStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    EnqueueTimingScope(const EnqueueTimingScope&) = delete;
+    EnqueueTimingScope& operator=(const EnqueueTimingScope&) = delete;
+
+    ~EnqueueTimingScope()
+    {
+        if (mTimer)
+        {
+            const std::chrono::duration<float, std::micro> time = std::chrono::steady_clock::now() - mStart;
+            mTimer(mPluginType, mLayerName, time.count());
+        }
+    }
+
+private:
+    EnqueueTimer mTimer;
+    const char* mPluginType;
+    const char* mLayerName;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+} // namespace plugin
+} // namespace nvinfer1
+
+//! Plugins that do not keep the name of their layer pass an empty one
+#define ENQUEUE_TIMING(pluginType, layerName)                                                                          \
+    nvinfer1::plugin::EnqueueTimingScope enqueueTimingScope_(pluginType, layerName)
+
+#endif // TRT_PLUGIN_ENQUEUE_TIMING_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gemmAlgoCache.h"
+#include <cuda_runtime.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+namespace
+{
+const char* const kGemmAlgoCacheHeader{"gemmAlgoCache"};
+constexpr int kGemmAlgoCacheVersion{1};
+
+std::mutex gGemmAlgoMutex;
+std::map<GemmAlgoKey, GemmAlgoEntry> gGemmAlgos;
+} // namespace
+
+bool GemmAlgoKey::operator<(const GemmAlgoKey& other) const
+{
+    return std::tie(computeCapability, multiProcessors, m, n, k, dataType, transA, transB)
+        < std::tie(other.computeCapability, other.multiProcessors, other.m, other.n, other.k, other.dataType,
+            other.transA, other.transB);
+}
+
+bool setGemmAlgoKeyDevice(GemmAlgoKey& key)
+{
+    int device{0};
+    cudaDeviceProp properties;
+    if (cudaGetDevice(&device) != cudaSuccess || cudaGetDeviceProperties(&properties, device) != cudaSuccess)
+    {
+        return false;
+    }
+    key.computeCapability = properties.major * 10 + properties.minor;
+    key.multiProcessors = properties.multiProcessorCount;
+    return true;
+}
+
+bool findGemmAlgo(const GemmAlgoKey& key, GemmAlgoEntry& entry)
+{
+    std::lock_guard<std::mutex> lock(gGemmAlgoMutex);
+    const auto algo = gGemmAlgos.find(key);
+    if (algo == gGemmAlgos.end())
+    {
+        return false;
+    }
+    entry = algo->second;
+    return true;
+}
+
+void insertGemmAlgo(const GemmAlgoKey& key, const GemmAlgoEntry& entry)
+{
+    std::lock_guard<std::mutex> lock(gGemmAlgoMutex);
+    gGemmAlgos[key] = entry;
+}
+
+bool loadGemmAlgoCache(const char* path)
+{
+    std::ifstream file(path);
+    std::string header;
+    int version{0};
+    if (!(file >> header >> version) || header != kGemmAlgoCacheHeader || version != kGemmAlgoCacheVersion)
+    {
+        return false;
+    }
+
+    std::map<GemmAlgoKey, GemmAlgoEntry> algos;
+    GemmAlgoKey key;
+    GemmAlgoEntry entry;
+    while (file >> key.computeCapability >> key.multiProcessors >> key.m >> key.n >> key.k >> key.dataType
+        >> key.transA >> key.transB >> entry.workspaceSize)
+    {
+        for (auto& a : entry.algo)
+        {
+            file >> a;
+        }
+        if (!file)
+        {
+            return false;
+        }
+        algos[key] = entry;
+    }
+    if (!file.eof())
+    {
+        return false;
+    }
+
+    // Searches already done by this process take precedence
+    std::lock_guard<std::mutex> lock(gGemmAlgoMutex);
+    gGemmAlgos.insert(algos.begin(), algos.end());
+    return true;
+}
+
+bool saveGemmAlgoCache(const char* path)
+{
+    std::ofstream file(path);
+    file << kGemmAlgoCacheHeader << " " << kGemmAlgoCacheVersion << std::endl;
+
+    std::lock_guard<std::mutex> lock(gGemmAlgoMutex);
+    for (const auto& a : gGemmAlgos)
+    {
+        const GemmAlgoKey& key = a.first;
+        const GemmAlgoEntry& entry = a.second;
+        file << key.computeCapability << " " << key.multiProcessors << " " << key.m << " " << key.n << " " << key.k
+             << " " << key.dataType << " " << key.transA << " " << key.transB << " " << entry.workspaceSize;
+        for (const auto d : entry.algo)
+        {
+            file << " " << d;
+        }
+        file << std::endl;
+    }
+    return static_cast<bool>(file);
+}
+
+} // namespace plugin
+} // namespace nvinfer1
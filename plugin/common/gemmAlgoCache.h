@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_GEMM_ALGO_CACHE_H
+#define TRT_GEMM_ALGO_CACHE_H
+#include <cstddef>
+#include <cstdint>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+//!
+//! \brief Identifies a GEMM problem on a given GPU, so that plugins with the same shape share one algorithm search
+//!
+struct GemmAlgoKey
+{
+    int computeCapability; //!< major * 10 + minor
+    int multiProcessors;
+    int m;
+    int n;
+    int k;
+    int dataType; //!< cudaDataType_t of the operands
+    bool transA;
+    bool transB;
+
+    bool operator<(const GemmAlgoKey& other) const;
+};
+
+//!
+//! \brief Opaque algorithm selected by the search, with the workspace it needs
+//!
+//! The algorithm keeps the layout of cublasLtMatmulAlgo_t so that the cache does not depend on cuBLASLt.
+//!
+struct GemmAlgoEntry
+{
+    uint64_t algo[8];
+    size_t workspaceSize;
+};
+
+//!
+//! \brief Fill the key fields describing the current device
+//!
+bool setGemmAlgoKeyDevice(GemmAlgoKey& key);
+
+//!
+//! \brief Look up a GEMM algorithm in the process-wide cache
+//!
+bool findGemmAlgo(const GemmAlgoKey& key, GemmAlgoEntry& entry);
+
+//!
+//! \brief Record the result of a GEMM algorithm search in the process-wide cache
+//!
+void insertGemmAlgo(const GemmAlgoKey& key, const GemmAlgoEntry& entry);
+
+//!
+//! \brief Merge the entries of a file written by saveGemmAlgoCache into the cache
+//!
+//! \return False if the file cannot be read or is not a GEMM algorithm cache
+//!
+bool loadGemmAlgoCache(const char* path);
+
+//!
+//! \brief Write all the cached entries to a text file
+//!
+bool saveGemmAlgoCache(const char* path);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_GEMM_ALGO_CACHE_H
@@ -0,0 +1,551 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "jitKernels.h"
+#include "logger.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#if defined(__linux__) && defined(__x86_64__)
+#define PLUGIN_JIT 1
+#include "cudaDriverWrapper.h"
+#include <dlfcn.h>
+#include <nvrtc.h>
+#include <unistd.h>
+#endif
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+namespace
+{
+
+// Reads size bytes to value if they end before end
+bool readBytes(const char*& buffer, const char* end, void* value, size_t size)
+{
+    if (static_cast<size_t>(end - buffer) < size)
+    {
+        return false;
+    }
+    std::memcpy(value, buffer, size);
+    buffer += size;
+    return true;
+}
+
+// Reads what JitKernel::serialize wrote. A record that runs past end leaves buffer at end, so that the plugin reading
+// it still reaches the end of its data, and compiles the kernel again.
+bool readSerialized(const char*& buffer, const char* end, int& sm, std::string& name, std::vector<char>& cubin)
+{
+    int nameSize{0};
+    size_t cubinSize{0};
+    if (!readBytes(buffer, end, &sm, sizeof(sm)) || !readBytes(buffer, end, &nameSize, sizeof(nameSize))
+        || nameSize < 0 || static_cast<size_t>(end - buffer) < static_cast<size_t>(nameSize))
+    {
+        buffer = end;
+        return false;
+    }
+    name.assign(buffer, nameSize);
+    buffer += nameSize;
+    if (!readBytes(buffer, end, &cubinSize, sizeof(cubinSize)) || static_cast<size_t>(end - buffer) < cubinSize)
+    {
+        buffer = end;
+        return false;
+    }
+    cubin.assign(buffer, buffer + cubinSize);
+    buffer += cubinSize;
+    return true;
+}
+
+} // namespace
+
+#ifdef PLUGIN_JIT
+namespace
+{
+
+// The plugin library runs without libnvrtc, which is only loaded once a plugin compiles a kernel
+class NvrtcLibrary
+{
+public:
+    NvrtcLibrary()
+    {
+        // The versioned name is the one installed with the runtime libraries of the toolkit
+        const std::string versioned = "libnvrtc.so." + std::to_string(CUDART_VERSION / 1000) + "."
+            + std::to_string(CUDART_VERSION % 1000 / 10);
+        for (const auto& name : {std::string("libnvrtc.so"), versioned})
+        {
+            mHandle = dlopen(name.c_str(), RTLD_LAZY);
+            if (mHandle)
+            {
+                break;
+            }
+        }
+        if (!mHandle)
+        {
+            return;
+        }
+        const bool found = loadSymbol(getErrorString, "nvrtcGetErrorString") && loadSymbol(version, "nvrtcVersion")
+            && loadSymbol(createProgram, "nvrtcCreateProgram") && loadSymbol(destroyProgram, "nvrtcDestroyProgram")
+            && loadSymbol(compileProgram, "nvrtcCompileProgram") && loadSymbol(getPTXSize, "nvrtcGetPTXSize")
+            && loadSymbol(getPTX, "nvrtcGetPTX") && loadSymbol(getProgramLogSize, "nvrtcGetProgramLogSize")
+            && loadSymbol(getProgramLog, "nvrtcGetProgramLog")
+            && loadSymbol(addNameExpression, "nvrtcAddNameExpression")
+            && loadSymbol(getLoweredName, "nvrtcGetLoweredName");
+        if (!found)
+        {
+            dlclose(mHandle);
+            mHandle = nullptr;
+        }
+    }
+
+    ~NvrtcLibrary()
+    {
+        if (mHandle)
+        {
+            dlclose(mHandle);
+        }
+    }
+
+    bool isLoaded() const
+    {
+        return mHandle != nullptr;
+    }
+
+    const char* (*getErrorString)(nvrtcResult);
+    nvrtcResult (*version)(int*, int*);
+    nvrtcResult (*createProgram)(nvrtcProgram*, const char*, const char*, int, const char* const*, const char* const*);
+    nvrtcResult (*destroyProgram)(nvrtcProgram*);
+    nvrtcResult (*compileProgram)(nvrtcProgram, int, const char* const*);
+    nvrtcResult (*getPTXSize)(nvrtcProgram, size_t*);
+    nvrtcResult (*getPTX)(nvrtcProgram, char*);
+    nvrtcResult (*getProgramLogSize)(nvrtcProgram, size_t*);
+    nvrtcResult (*getProgramLog)(nvrtcProgram, char*);
+    nvrtcResult (*addNameExpression)(nvrtcProgram, const char*);
+    nvrtcResult (*getLoweredName)(nvrtcProgram, const char*, const char**);
+
+private:
+    template <typename F>
+    bool loadSymbol(F& f, const char* name)
+    {
+        *reinterpret_cast<void**>(&f) = dlsym(mHandle, name);
+        return f != nullptr;
+    }
+
+    void* mHandle{nullptr};
+};
+
+const NvrtcLibrary& nvrtc()
+{
+    static const NvrtcLibrary library;
+    return library;
+}
+
+const CUDADriverWrapper& driver()
+{
+    static const CUDADriverWrapper wrapper;
+    return wrapper;
+}
+
+struct CompiledKernel
+{
+    std::string loweredName;
+    std::vector<char> cubin;
+};
+
+std::mutex gJitMutex;
+std::map<uint64_t, CompiledKernel> gJitKernels;
+
+// Followed by the lowered name, the hash of the cubin and the cubin
+constexpr char kCacheMagic[] = "TRTJIT2";
+
+int currentSM()
+{
+    int device{0};
+    int major{0};
+    int minor{0};
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device);
+    cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, device);
+    return major * 10 + minor;
+}
+
+// FNV-1a, the key only has to tell the kernels apart, and the cache files only have to detect a damaged cubin
+uint64_t hashBytes(uint64_t h, const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t hashString(uint64_t h, const std::string& s)
+{
+    h = hashBytes(h, s.data(), s.size());
+    // Ends each string, so that moving characters between strings changes the key
+    return (h ^ 0xff) * 0x100000001b3ULL;
+}
+
+uint64_t hashCubin(const std::vector<char>& cubin)
+{
+    return hashBytes(0xcbf29ce484222325ULL, cubin.data(), cubin.size());
+}
+
+std::string cachePath(uint64_t key, int sm)
+{
+    const char* dir = std::getenv("TRT_PLUGIN_JIT_CACHE");
+    if (!dir || !*dir)
+    {
+        return "";
+    }
+    std::ostringstream path;
+    path << dir << "/" << std::hex << key << std::dec << "_sm" << sm << ".cubin";
+    return path.str();
+}
+
+// A cubin whose hash does not match, written by an older plugin or damaged, is not read
+bool readCached(const std::string& path, CompiledKernel& kernel)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    std::string hash;
+    if (!file || !std::getline(file, magic) || magic != kCacheMagic || !std::getline(file, kernel.loweredName)
+        || !std::getline(file, hash))
+    {
+        return false;
+    }
+    kernel.cubin.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    std::ostringstream expected;
+    expected << std::hex << hashCubin(kernel.cubin);
+    return !kernel.cubin.empty() && hash == expected.str();
+}
+
+// Written to a unique file first, so that the threads and the processes sharing the cache never read a partial cubin
+// nor write the same file
+void writeCached(const std::string& path, const CompiledKernel& kernel)
+{
+    std::string temporary = path + ".XXXXXX";
+    const int fd = mkstemp(&temporary[0]);
+    if (fd < 0)
+    {
+        gLogWarning << "Cannot create a JIT cache file beside " << path << std::endl;
+        return;
+    }
+    close(fd);
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file << kCacheMagic << '\n' << kernel.loweredName << '\n' << std::hex << hashCubin(kernel.cubin) << '\n';
+        file.write(kernel.cubin.data(), kernel.cubin.size());
+        if (!file)
+        {
+            gLogWarning << "Cannot write the JIT cache file " << temporary << std::endl;
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()))
+    {
+        std::remove(temporary.c_str());
+    }
+}
+
+// Compiles the source to PTX for the virtual architecture of the SM, and links it into a cubin for the SM
+bool compileCubin(const char* source, const std::string& name, const std::vector<std::string>& options, int sm,
+    CompiledKernel& kernel)
+{
+    const auto& rtc = nvrtc();
+    nvrtcProgram program;
+    nvrtcResult status = rtc.createProgram(&program, source, "jit.cu", 0, nullptr, nullptr);
+    if (status != NVRTC_SUCCESS)
+    {
+        gLogWarning << "NVRTC cannot create the program of " << name << ": " << rtc.getErrorString(status)
+                    << std::endl;
+        return false;
+    }
+    std::vector<std::string> allOptions{"--gpu-architecture=compute_" + std::to_string(sm), "--std=c++11"};
+    allOptions.insert(allOptions.end(), options.begin(), options.end());
+    std::vector<const char*> optionPointers;
+    for (const auto& o : allOptions)
+    {
+        optionPointers.push_back(o.c_str());
+    }
+    rtc.addNameExpression(program, name.c_str());
+    status = rtc.compileProgram(program, static_cast<int>(optionPointers.size()), optionPointers.data());
+    if (status != NVRTC_SUCCESS)
+    {
+        size_t logSize{0};
+        rtc.getProgramLogSize(program, &logSize);
+        std::string log(logSize, '\0');
+        rtc.getProgramLog(program, &log[0]);
+        gLogWarning << "NVRTC cannot compile " << name << ": " << rtc.getErrorString(status) << std::endl << log;
+        rtc.destroyProgram(&program);
+        return false;
+    }
+    const char* lowered{nullptr};
+    rtc.getLoweredName(program, name.c_str(), &lowered);
+    kernel.loweredName = lowered ? lowered : "";
+    size_t ptxSize{0};
+    rtc.getPTXSize(program, &ptxSize);
+    std::vector<char> ptx(ptxSize);
+    rtc.getPTX(program, ptx.data());
+    rtc.destroyProgram(&program);
+    if (kernel.loweredName.empty())
+    {
+        gLogWarning << "The JIT source does not instantiate " << name << std::endl;
+        return false;
+    }
+
+    const auto& cu = driver();
+    CUlinkState link;
+    void* cubin{nullptr};
+    size_t cubinSize{0};
+    CUresult result = cu.cuLinkCreate(0, nullptr, nullptr, &link);
+    if (result != CUDA_SUCCESS)
+    {
+        gLogWarning << "Cannot link " << name << ", error " << result << std::endl;
+        return false;
+    }
+    result = cu.cuLinkAddData(link, CU_JIT_INPUT_PTX, ptx.data(), ptx.size(), "jit.ptx", 0, nullptr, nullptr);
+    if (result == CUDA_SUCCESS)
+    {
+        result = cu.cuLinkComplete(link, &cubin, &cubinSize);
+    }
+    if (result == CUDA_SUCCESS)
+    {
+        // The cubin belongs to the link state
+        kernel.cubin.assign(static_cast<const char*>(cubin), static_cast<const char*>(cubin) + cubinSize);
+    }
+    cu.cuLinkDestroy(link);
+    if (result != CUDA_SUCCESS)
+    {
+        gLogWarning << "Cannot link " << name << ", error " << result << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Compiles the kernel and writes it to the cache file at path, unless path is empty
+bool compileAndCache(const char* source, const std::string& name, const std::vector<std::string>& options, int sm,
+    const std::string& path, CompiledKernel& kernel)
+{
+    if (!compileCubin(source, name, options, sm, kernel))
+    {
+        return false;
+    }
+    gLogVerbose << "Compiled " << name << " for sm_" << sm << std::endl;
+    if (!path.empty())
+    {
+        writeCached(path, kernel);
+    }
+    return true;
+}
+
+} // namespace
+
+bool isJitAvailable()
+{
+    const char* jit = std::getenv("TRT_PLUGIN_JIT");
+    return !(jit && !std::strcmp(jit, "0")) && nvrtc().isLoaded();
+}
+
+JitKernel::~JitKernel()
+{
+    unload();
+}
+
+bool JitKernel::compile(const char* source, const std::string& name, const std::vector<std::string>& options)
+{
+    unload();
+    if (!isJitAvailable())
+    {
+        return false;
+    }
+    const int sm = currentSM();
+    int major{0};
+    int minor{0};
+    nvrtc().version(&major, &minor);
+    uint64_t key{0xcbf29ce484222325ULL};
+    key = hashString(key, source);
+    key = hashString(key, name);
+    for (const auto& o : options)
+    {
+        key = hashString(key, o);
+    }
+    key = hashString(key, std::to_string(major) + "." + std::to_string(minor) + ":" + std::to_string(sm));
+
+    CompiledKernel kernel;
+    {
+        std::lock_guard<std::mutex> lock(gJitMutex);
+        const auto found = gJitKernels.find(key);
+        if (found != gJitKernels.end())
+        {
+            kernel = found->second;
+        }
+    }
+    const std::string path = cachePath(key, sm);
+    bool fromFile{false};
+    if (kernel.cubin.empty())
+    {
+        fromFile = !path.empty() && readCached(path, kernel);
+        if (fromFile)
+        {
+            gLogVerbose << "Loaded " << name << " from the JIT cache " << path << std::endl;
+        }
+        else if (!compileAndCache(source, name, options, sm, path, kernel))
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(gJitMutex);
+        gJitKernels[key] = kernel;
+    }
+    mSM = sm;
+    mLoweredName = kernel.loweredName;
+    mCubin = kernel.cubin;
+    if (load())
+    {
+        return true;
+    }
+    if (!fromFile)
+    {
+        return false;
+    }
+
+    // The driver rejects the cached cubin, the file is replaced by a new compilation
+    gLogWarning << "Removing the JIT cache file " << path << std::endl;
+    std::remove(path.c_str());
+    kernel = CompiledKernel{};
+    if (!compileAndCache(source, name, options, sm, path, kernel))
+    {
+        std::lock_guard<std::mutex> lock(gJitMutex);
+        gJitKernels.erase(key);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(gJitMutex);
+        gJitKernels[key] = kernel;
+    }
+    mLoweredName = kernel.loweredName;
+    mCubin = kernel.cubin;
+    return load();
+}
+
+bool JitKernel::load()
+{
+    const auto& cu = driver();
+    CUresult result = cu.cuModuleLoadData(&mModule, mCubin.data());
+    if (result == CUDA_SUCCESS)
+    {
+        result = cu.cuModuleGetFunction(&mFunction, mModule, mLoweredName.c_str());
+    }
+    if (result != CUDA_SUCCESS)
+    {
+        gLogWarning << "Cannot load the JIT kernel " << mLoweredName << ", error " << result << std::endl;
+        unload();
+        return false;
+    }
+    return true;
+}
+
+void JitKernel::unload()
+{
+    if (mModule)
+    {
+        driver().cuModuleUnload(mModule);
+    }
+    mModule = nullptr;
+    mFunction = nullptr;
+}
+
+bool JitKernel::launch(dim3 grid, dim3 block, unsigned int sharedBytes, cudaStream_t stream, void** args) const
+{
+    return mFunction
+        && driver().cuLaunchKernel(mFunction, grid.x, grid.y, grid.z, block.x, block.y, block.z, sharedBytes, stream,
+               args, nullptr)
+        == CUDA_SUCCESS;
+}
+
+bool JitKernel::deserialize(const char*& buffer, const char* end)
+{
+    unload();
+    if (!readSerialized(buffer, end, mSM, mLoweredName, mCubin))
+    {
+        mCubin.clear();
+        return false;
+    }
+    // The driver loads a cubin on the SM it was compiled for only
+    return !mCubin.empty() && mSM == currentSM() && load();
+}
+
+#else // PLUGIN_JIT
+
+bool isJitAvailable()
+{
+    return false;
+}
+
+JitKernel::~JitKernel() {}
+
+bool JitKernel::compile(const char* source, const std::string& name, const std::vector<std::string>& options)
+{
+    return false;
+}
+
+bool JitKernel::launch(dim3 grid, dim3 block, unsigned int sharedBytes, cudaStream_t stream, void** args) const
+{
+    return false;
+}
+
+bool JitKernel::deserialize(const char*& buffer, const char* end)
+{
+    int sm{0};
+    std::string name;
+    std::vector<char> cubin;
+    readSerialized(buffer, end, sm, name, cubin);
+    return false;
+}
+
+#endif // PLUGIN_JIT
+
+size_t JitKernel::getSerializationSize() const
+{
+    return sizeof(mSM) + sizeof(int) + mLoweredName.size() + sizeof(size_t) + mCubin.size();
+}
+
+void JitKernel::serialize(char*& buffer) const
+{
+    const int nameSize = static_cast<int>(mLoweredName.size());
+    const size_t cubinSize = mCubin.size();
+    std::memcpy(buffer, &mSM, sizeof(mSM));
+    buffer += sizeof(mSM);
+    std::memcpy(buffer, &nameSize, sizeof(nameSize));
+    buffer += sizeof(nameSize);
+    std::memcpy(buffer, mLoweredName.data(), nameSize);
+    buffer += nameSize;
+    std::memcpy(buffer, &cubinSize, sizeof(cubinSize));
+    buffer += sizeof(cubinSize);
+    std::memcpy(buffer, mCubin.data(), cubinSize);
+    buffer += cubinSize;
+}
+
+} // namespace plugin
+} // namespace nvinfer1
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_JIT_KERNELS_H
+#define TRT_JIT_KERNELS_H
+#include <cstddef>
+#include <cuda.h>
+#include <cuda_runtime.h>
+#include <string>
+#include <vector>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+//!
+//! \brief Whether plugins can compile kernels at runtime
+//!
+//! Kernels are compiled with NVRTC, loaded from libnvrtc when it is first needed, and linked with the CUDA driver.
+//! Setting TRT_PLUGIN_JIT=0 in the environment disables the compilation, the plugins then run their precompiled
+//! kernels.
+//!
+bool isJitAvailable();
+
+//!
+//! \brief A kernel compiled at runtime for the shapes of a plugin, and the cubin it was loaded from
+//!
+//! A plugin whose shapes are fixed once it is configured compiles a kernel with its shapes as template arguments,
+//! so that its loops have constant trip counts, instead of shipping an instantiation for every shape. The cubin is
+//! serialized with the plugin, so that engines do not compile again on the device they were built for. Compiled
+//! cubins are kept for the process, and in the directory named by TRT_PLUGIN_JIT_CACHE when it is set, as files
+//! named by a hash of the source, the kernel, the options, the NVRTC version and the SM of the device. A cache file
+//! is checked against the hash of its cubin when it is read, and removed if the driver cannot load it.
+//!
+//! A kernel is loaded in the CUDA context of the device current when it was compiled or deserialized, and is
+//! launched on streams of that device.
+//!
+class JitKernel
+{
+public:
+    JitKernel() = default;
+
+    ~JitKernel();
+
+    JitKernel(const JitKernel&) = delete;
+
+    JitKernel& operator=(const JitKernel&) = delete;
+
+    //!
+    //! \brief Compile a kernel for the current device, or find it in the caches, and load it
+    //!
+    //! \param source CUDA source of the kernel, compiled without the toolkit headers
+    //! \param name Name expression of the kernel, such as "ns::kernel<8, 1000>", which the source must instantiate
+    //! \param options NVRTC options added to the architecture of the device, such as macro definitions
+    //!
+    //! \return False if the kernel can be neither compiled nor loaded, the reason is logged as a warning
+    //!
+    bool compile(const char* source, const std::string& name, const std::vector<std::string>& options);
+
+    //!
+    //! \brief Size of the SM, name and cubin written by serialize, those of an empty kernel if none was compiled
+    //!
+    size_t getSerializationSize() const;
+
+    void serialize(char*& buffer) const;
+
+    //!
+    //! \brief Read what serialize wrote, before end, and load the cubin if it was compiled for the SM of the current
+    //! device
+    //!
+    //! A record that does not fit before end is not read, and buffer is left at end.
+    //!
+    //! \return False if there is no cubin for the current device, the plugin then compiles the kernel again
+    //!
+    bool deserialize(const char*& buffer, const char* end);
+
+    bool isLoaded() const
+    {
+        return mFunction != nullptr;
+    }
+
+    //!
+    //! \brief Launch the kernel, args points to each of its arguments in order
+    //!
+    //! \return False if the kernel is not loaded or the launch failed
+    //!
+    bool launch(dim3 grid, dim3 block, unsigned int sharedBytes, cudaStream_t stream, void** args) const;
+
+private:
+    bool load();
+
+    void unload();
+
+    int mSM{0}; //!< major * 10 + minor of the device the cubin was compiled for
+    std::string mLoweredName;
+    std::vector<char> mCubin;
+    CUmodule mModule{nullptr};
+    CUfunction mFunction{nullptr};
+};
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_JIT_KERNELS_H
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "kernelTactics.h"
+#include <cuda_runtime.h>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+namespace
+{
+std::mutex gKernelTacticMutex;
+std::map<KernelTacticKey, int> gKernelTactics;
+
+//! Time iterations launches of a tactic after a warm up one, in milliseconds, negative if it does not apply
+float timeTactic(const KernelTactic& tactic, int iterations, cudaStream_t stream, cudaEvent_t start, cudaEvent_t stop)
+{
+    if (tactic.launch(stream) != 0 || cudaStreamSynchronize(stream) != cudaSuccess)
+    {
+        // A failed launch leaves its error to the next runtime call, it is cleared here
+        cudaGetLastError();
+        return -1.F;
+    }
+    cudaEventRecord(start, stream);
+    for (int i = 0; i < iterations; ++i)
+    {
+        tactic.launch(stream);
+    }
+    cudaEventRecord(stop, stream);
+    float ms{0};
+    if (cudaEventSynchronize(stop) != cudaSuccess || cudaEventElapsedTime(&ms, start, stop) != cudaSuccess)
+    {
+        cudaGetLastError();
+        return -1.F;
+    }
+    return ms;
+}
+} // namespace
+
+bool KernelTacticKey::operator<(const KernelTacticKey& other) const
+{
+    return std::tie(plugin, computeCapability, multiProcessors, dataType, shape)
+        < std::tie(other.plugin, other.computeCapability, other.multiProcessors, other.dataType, other.shape);
+}
+
+bool setKernelTacticKeyDevice(KernelTacticKey& key)
+{
+    int device{0};
+    cudaDeviceProp properties;
+    if (cudaGetDevice(&device) != cudaSuccess || cudaGetDeviceProperties(&properties, device) != cudaSuccess)
+    {
+        return false;
+    }
+    key.computeCapability = properties.major * 10 + properties.minor;
+    key.multiProcessors = properties.multiProcessorCount;
+    return true;
+}
+
+int timeKernelTactics(const std::vector<KernelTactic>& tactics, int iterations)
+{
+    cudaStream_t stream{nullptr};
+    cudaEvent_t start{nullptr};
+    cudaEvent_t stop{nullptr};
+    if (cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking) != cudaSuccess
+        || cudaEventCreate(&start) != cudaSuccess || cudaEventCreate(&stop) != cudaSuccess)
+    {
+        cudaEventDestroy(start);
+        cudaStreamDestroy(stream);
+        return -1;
+    }
+
+    int best{-1};
+    float bestMs{0};
+    for (const auto& tactic : tactics)
+    {
+        const float ms = timeTactic(tactic, iterations, stream, start, stop);
+        if (ms >= 0 && (best < 0 || ms < bestMs))
+        {
+            best = tactic.id;
+            bestMs = ms;
+        }
+    }
+
+    cudaEventDestroy(stop);
+    cudaEventDestroy(start);
+    cudaStreamDestroy(stream);
+    return best;
+}
+
+int selectKernelTactic(KernelTacticKey key, const std::vector<KernelTactic>& tactics)
+{
+    const bool cacheable = setKernelTacticKeyDevice(key);
+    if (cacheable)
+    {
+        std::lock_guard<std::mutex> lock(gKernelTacticMutex);
+        const auto cached = gKernelTactics.find(key);
+        if (cached != gKernelTactics.end())
+        {
+            return cached->second;
+        }
+    }
+
+    const int tactic = timeKernelTactics(tactics);
+    if (cacheable && tactic >= 0)
+    {
+        std::lock_guard<std::mutex> lock(gKernelTacticMutex);
+        gKernelTactics[key] = tactic;
+    }
+    return tactic;
+}
+
+} // namespace plugin
+} // namespace nvinfer1
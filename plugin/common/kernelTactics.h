@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_KERNEL_TACTICS_H
+#define TRT_KERNEL_TACTICS_H
+#include <cuda_runtime_api.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+//!
+//! \brief Identifies the problem a plugin selects a kernel variant for on a given GPU, so that plugins with the same
+//!        shape share one timing
+//!
+struct KernelTacticKey
+{
+    std::string plugin; //!< Plugin type, and the kernel if it has several
+    int computeCapability; //!< major * 10 + minor
+    int multiProcessors;
+    int dataType; //!< nvinfer1::DataType of the kernel
+    std::vector<int> shape; //!< Sizes the variants depend on, such as the hidden size and the rows
+
+    bool operator<(const KernelTacticKey& other) const;
+};
+
+//!
+//! \brief Fill the key fields describing the current device
+//!
+bool setKernelTacticKeyDevice(KernelTacticKey& key);
+
+//!
+//! \brief A kernel variant of a plugin: its block size, vectorization or algorithm
+//!
+//! The launch enqueues the variant on the stream over buffers of the problem shape, and returns non-zero if the
+//! variant does not apply to it.
+//!
+struct KernelTactic
+{
+    int id; //!< Serialized with the plugin, and passed back to its kernels at enqueue
+    std::function<int(cudaStream_t)> launch;
+};
+
+//!
+//! \brief Time the tactics on the current device, in turn, and return the id of the fastest
+//!
+//! Each tactic runs once to warm up, then iterations times between two events.
+//!
+//! \return The id of the fastest tactic, or -1 if none applies or a CUDA error occurred
+//!
+int timeKernelTactics(const std::vector<KernelTactic>& tactics, int iterations = 10);
+
+//!
+//! \brief Fill the device fields of key and return the tactic this process cached for it, or time the tactics and
+//!        cache the fastest
+//!
+int selectKernelTactic(KernelTacticKey key, const std::vector<KernelTactic>& tactics);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_KERNEL_TACTICS_H
@@ -15,102 +15,85 @@
  */
 #include "kernel.h"
 #include "bboxUtils.h"
+#include "bitmaskNMS.h"
+#include <algorithm>
+#include <climits>
+#include <cuda_fp16.h>
 #include <vector>
 
-template <typename T_BBOX>
-__device__ T_BBOX bboxSize(
-    const Bbox<T_BBOX>& bbox,
-    const bool normalized)
+// Candidates of one class of one image, in the order of the per class sort. Candidate i of segment
+// image * num_classes + class is the candidate with index beforeNMS_index_array[segment * num_preds_per_class + i].
+template <typename T_BBOX, NMSBoxEncoding ENCODING>
+struct ClassSegments
 {
-    if (bbox.xmax < bbox.xmin || bbox.ymax < bbox.ymin)
+    const T_BBOX* bboxData;
+    const int* indices;
+    int numClasses;
+    int numPredsPerClass;
+    int candidates;
+    bool shareLocation;
+
+    __device__ int count(int /*segment*/) const
     {
-        // If bbox is invalid (e.g. xmax < xmin or ymax < ymin), return 0.
-        return 0;
+        return candidates;
     }
-    else
+
+    __device__ int load(int segment, int i, NMSBox& box) const
     {
-        T_BBOX width = bbox.xmax - bbox.xmin;
-        T_BBOX height = bbox.ymax - bbox.ymin;
-        if (normalized)
-        {
-            return width * height;
-        }
-        else
+        const int index = indices[segment * numPredsPerClass + i];
+        if (index == -1)
         {
-            // If bbox is not within range [0, 1].
-            return (width + 1) * (height + 1);
+            return -1;
         }
+        const int image = segment / numClasses;
+        const int bboxIdx = shareLocation ? (index % numPredsPerClass + image * numPredsPerClass) : index;
+        box = decodeNMSBox<ENCODING>(bboxData + bboxIdx * 4);
+        return 0;
     }
-}
+};
 
-template <typename T_BBOX>
-__device__ void intersectBbox(
-    const Bbox<T_BBOX>& bbox1,
-    const Bbox<T_BBOX>& bbox2,
-    Bbox<T_BBOX>* intersect_bbox)
+/*
+ * Keeps the candidates in place in the [num, num_classes, top_k] outputs.
+ * If not keeping the bbox
+ * Set the score to 0
+ * Set the bounding box index to -1
+ */
+template <typename T_SCORE>
+struct ClassOutput
 {
-    if (bbox2.xmin > bbox1.xmax || bbox2.xmax < bbox1.xmin || bbox2.ymin > bbox1.ymax || bbox2.ymax < bbox1.ymin)
-    {
-        // Return [0, 0, 0, 0] if there is no intersection.
-        intersect_bbox->xmin = T_BBOX(0);
-        intersect_bbox->ymin = T_BBOX(0);
-        intersect_bbox->xmax = T_BBOX(0);
-        intersect_bbox->ymax = T_BBOX(0);
-    }
-    else
+    const T_SCORE* scores;
+    const int* indices;
+    T_SCORE* keptScores;
+    int* keptIndices;
+    int numPredsPerClass;
+    int candidates;
+    int topK;
+
+    __device__ void keep(int segment, int i, int /*rank*/) const
     {
-        intersect_bbox->xmin = max(bbox1.xmin, bbox2.xmin);
-        intersect_bbox->ymin = max(bbox1.ymin, bbox2.ymin);
-        intersect_bbox->xmax = min(bbox1.xmax, bbox2.xmax);
-        intersect_bbox->ymax = min(bbox1.ymax, bbox2.ymax);
+        keptScores[segment * topK + i] = scores[segment * numPredsPerClass + i];
+        keptIndices[segment * topK + i] = indices[segment * numPredsPerClass + i];
     }
-}
 
-template <typename T_BBOX>
-__device__ float jaccardOverlap(
-    const Bbox<T_BBOX>& bbox1,
-    const Bbox<T_BBOX>& bbox2,
-    const bool normalized)
-{
-    Bbox<T_BBOX> intersect_bbox;
-    intersectBbox(bbox1, bbox2, &intersect_bbox);
-    float intersect_width, intersect_height;
-    if (normalized)
-    {
-        intersect_width = intersect_bbox.xmax - intersect_bbox.xmin;
-        intersect_height = intersect_bbox.ymax - intersect_bbox.ymin;
-    }
-    else
+    __device__ void discard(int segment, int i) const
     {
-        intersect_width = intersect_bbox.xmax - intersect_bbox.xmin + 1;
-        intersect_height = intersect_bbox.ymax - intersect_bbox.ymin + 1;
+        keptScores[segment * topK + i] = T_SCORE(0.f);
+        keptIndices[segment * topK + i] = -1;
     }
-    if (intersect_width > 0 && intersect_height > 0)
-    {
-        float intersect_size = intersect_width * intersect_height;
-        float bbox1_size = bboxSize(bbox1, normalized);
-        float bbox2_size = bboxSize(bbox2, normalized);
-        return intersect_size / (bbox1_size + bbox2_size - intersect_size);
-    }
-    else
+
+    __device__ void finish(int segment, int /*kept*/, int lane) const
     {
-        return 0.;
+        // Classes with fewer than top_k predictions
+        for (int i = candidates + lane; i < topK; i += 32)
+        {
+            discard(segment, i);
+        }
     }
-}
-
-template <typename T_BBOX>
-__device__ void emptyBboxInfo(
-    BboxInfo<T_BBOX>* bbox_info)
-{
-    bbox_info->conf_score = T_BBOX(0);
-    bbox_info->label = -2; // -1 is used for all labels when shared_location is ture
-    bbox_info->bbox_idx = -1;
-    bbox_info->kept = false;
-}
-/********** new NMS for only score and index array **********/
+};
 
-template <typename T_SCORE, typename T_BBOX, int TSIZE>
-__global__ void allClassNMS_kernel(
+template <typename T_SCORE, typename T_BBOX, NMSBoxEncoding ENCODING>
+pluginStatus_t allClassNMSEncoded(
+    cudaStream_t stream,
     const int num,
     const int num_classes,
     const int num_preds_per_class,
@@ -118,121 +101,37 @@ __global__ void allClassNMS_kernel(
     const float nms_threshold,
     const bool share_location,
     const bool isNormalized,
-    T_BBOX* bbox_data, // bbox_data should be float to preserve location information
-    T_SCORE* beforeNMS_scores,
-    int* beforeNMS_index_array,
-    T_SCORE* afterNMS_scores,
-    int* afterNMS_index_array,
-    bool flipXY = false)
+    const void* bbox_data,
+    const void* beforeNMS_scores,
+    const void* beforeNMS_index_array,
+    void* afterNMS_scores,
+    void* afterNMS_index_array,
+    void* workspace)
 {
-    //__shared__ bool kept_bboxinfo_flag[CAFFE_CUDA_NUM_THREADS * TSIZE];
-    extern __shared__ bool kept_bboxinfo_flag[];
-
-    for (int i = 0; i < num; i++)
-    {
-        const int offset = i * num_classes * num_preds_per_class + blockIdx.x * num_preds_per_class;
-        const int max_idx = offset + top_k; // put top_k bboxes into NMS calculation
-        const int bbox_idx_offset = share_location ? (i * num_preds_per_class) : (i * num_classes * num_preds_per_class);
-
-        // local thread data
-        int loc_bboxIndex[TSIZE];
-        Bbox<T_BBOX> loc_bbox[TSIZE];
-
-// initialize Bbox, Bboxinfo, kept_bboxinfo_flag
-        // Eliminate shared memory RAW hazard  
-        __syncthreads();
-#pragma unroll
-        for (int t = 0; t < TSIZE; t++)
-        {
-            const int cur_idx = threadIdx.x + blockDim.x * t;
-            const int item_idx = offset + cur_idx;
-
-            if (item_idx < max_idx)
-            {
-                loc_bboxIndex[t] = beforeNMS_index_array[item_idx];
-
-                if (loc_bboxIndex[t] != -1)
-                {
-                    const int bbox_data_idx = share_location ? (loc_bboxIndex[t] % num_preds_per_class + bbox_idx_offset) : loc_bboxIndex[t];
-
-                    loc_bbox[t].xmin = flipXY ? bbox_data[bbox_data_idx * 4 + 1] 
-                      : bbox_data[bbox_data_idx * 4 + 0];
-                    loc_bbox[t].ymin = flipXY ? bbox_data[bbox_data_idx * 4 + 0] 
-                      : bbox_data[bbox_data_idx * 4 + 1];
-                    loc_bbox[t].xmax = flipXY ? bbox_data[bbox_data_idx * 4 + 3] 
-                      : bbox_data[bbox_data_idx * 4 + 2];
-                    loc_bbox[t].ymax = flipXY ? bbox_data[bbox_data_idx * 4 + 2]
-                      : bbox_data[bbox_data_idx * 4 + 3];
-                    kept_bboxinfo_flag[cur_idx] = true;
-                }
-                else
-                {
-                    kept_bboxinfo_flag[cur_idx] = false;
-                }
-            }
-            else
-            {
-                kept_bboxinfo_flag[cur_idx] = false;
-            }
-        }
-
-        // filter out overlapped boxes with lower scores
-        int ref_item_idx = offset;
-        int ref_bbox_idx = share_location ? (beforeNMS_index_array[ref_item_idx] % num_preds_per_class + bbox_idx_offset) : beforeNMS_index_array[ref_item_idx];
-
-        while ((ref_bbox_idx != -1) && ref_item_idx < max_idx)
-        {
-            Bbox<T_BBOX> ref_bbox;
-            ref_bbox.xmin = flipXY ? bbox_data[ref_bbox_idx * 4 + 1] : bbox_data[ref_bbox_idx * 4 + 0];
-            ref_bbox.ymin = flipXY ? bbox_data[ref_bbox_idx * 4 + 0] : bbox_data[ref_bbox_idx * 4 + 1];
-            ref_bbox.xmax = flipXY ? bbox_data[ref_bbox_idx * 4 + 3] : bbox_data[ref_bbox_idx * 4 + 2];
-            ref_bbox.ymax = flipXY ? bbox_data[ref_bbox_idx * 4 + 2] : bbox_data[ref_bbox_idx * 4 + 3];
-
-            // Eliminate shared memory RAW hazard  
-            __syncthreads();
-
-            for (int t = 0; t < TSIZE; t++)
-            {
-                const int cur_idx = threadIdx.x + blockDim.x * t;
-                const int item_idx = offset + cur_idx;
-
-                if ((kept_bboxinfo_flag[cur_idx]) && (item_idx > ref_item_idx))
-                {
-                    // TODO: may need to add bool normalized as argument, HERE true means normalized
-                    if (jaccardOverlap(ref_bbox, loc_bbox[t], isNormalized) > nms_threshold)
-                    {
-                        kept_bboxinfo_flag[cur_idx] = false;
-                    }
-                }
-            }
-            __syncthreads();
-
-            do
-            {
-                ref_item_idx++;
-            } while (ref_item_idx < max_idx && !kept_bboxinfo_flag[ref_item_idx - offset]);
-
-            ref_bbox_idx = share_location ? (beforeNMS_index_array[ref_item_idx] % num_preds_per_class + bbox_idx_offset) : beforeNMS_index_array[ref_item_idx];
-        }
-
-        // store data
-        for (int t = 0; t < TSIZE; t++)
-        {
-            const int cur_idx = threadIdx.x + blockDim.x * t;
-            const int read_item_idx = offset + cur_idx;
-            const int write_item_idx = (i * num_classes * top_k + blockIdx.x * top_k) + cur_idx;
-            /*
-             * If not not keeping the bbox
-             * Set the score to 0
-             * Set the bounding box index to -1
-             */
-            if (read_item_idx < max_idx)
-            {
-                afterNMS_scores[write_item_idx] = kept_bboxinfo_flag[cur_idx] ? beforeNMS_scores[read_item_idx] : 0.0f;
-                afterNMS_index_array[write_item_idx] = kept_bboxinfo_flag[cur_idx] ? loc_bboxIndex[t] : -1;
-            }
-        }
-    }
+    // put top_k bboxes into NMS calculation
+    const int candidates = std::min(top_k, num_preds_per_class);
+
+    ClassSegments<T_BBOX, ENCODING> segments;
+    segments.bboxData = static_cast<const T_BBOX*>(bbox_data);
+    segments.indices = static_cast<const int*>(beforeNMS_index_array);
+    segments.numClasses = num_classes;
+    segments.numPredsPerClass = num_preds_per_class;
+    segments.candidates = candidates;
+    segments.shareLocation = share_location;
+
+    ClassOutput<T_SCORE> output;
+    output.scores = static_cast<const T_SCORE*>(beforeNMS_scores);
+    output.indices = segments.indices;
+    output.keptScores = static_cast<T_SCORE*>(afterNMS_scores);
+    output.keptIndices = static_cast<int*>(afterNMS_index_array);
+    output.numPredsPerClass = num_preds_per_class;
+    output.candidates = candidates;
+    output.topK = top_k;
+
+    const int numSegments = num * num_classes;
+    return isNormalized
+        ? bitmaskNMS<true>(stream, numSegments, candidates, nms_threshold, INT_MAX, segments, output, workspace)
+        : bitmaskNMS<false>(stream, numSegments, candidates, nms_threshold, INT_MAX, segments, output, workspace);
 }
 
 template <typename T_SCORE, typename T_BBOX>
@@ -250,32 +149,18 @@ pluginStatus_t allClassNMS_gpu(
     void* beforeNMS_index_array,
     void* afterNMS_scores,
     void* afterNMS_index_array,
+    void* workspace,
     bool flipXY = false)
 {
-#define P(tsize) allClassNMS_kernel<T_SCORE, T_BBOX, (tsize)>
-
-    void (*kernel[8])(const int, const int, const int, const int, const float,
-                      const bool, const bool, float*, T_SCORE*, int*, T_SCORE*,
-                      int*, bool)
-        = {
-            P(1), P(2), P(3), P(4), P(5), P(6), P(7), P(8),
-        };
-
-    const int BS = 512;
-    const int GS = num_classes;
-    const int t_size = (top_k + BS - 1) / BS;
-
-    kernel[t_size - 1]<<<GS, BS, BS * t_size * sizeof(bool), stream>>>(num, num_classes, num_preds_per_class,
-                                                                       top_k, nms_threshold, share_location, isNormalized,
-                                                                       (T_BBOX*) bbox_data,
-                                                                       (T_SCORE*) beforeNMS_scores, 
-                                                                       (int*) beforeNMS_index_array,
-                                                                       (T_SCORE*) afterNMS_scores,
-                                                                       (int*) afterNMS_index_array,
-                                                                       flipXY);
-
-    CSC(cudaGetLastError(), STATUS_FAILURE);
-    return STATUS_SUCCESS;
+    if (flipXY)
+    {
+        return allClassNMSEncoded<T_SCORE, T_BBOX, NMSBoxEncoding::kCornerYX>(stream, num, num_classes,
+            num_preds_per_class, top_k, nms_threshold, share_location, isNormalized, bbox_data, beforeNMS_scores,
+            beforeNMS_index_array, afterNMS_scores, afterNMS_index_array, workspace);
+    }
+    return allClassNMSEncoded<T_SCORE, T_BBOX, NMSBoxEncoding::kCornerXY>(stream, num, num_classes,
+        num_preds_per_class, top_k, nms_threshold, share_location, isNormalized, bbox_data, beforeNMS_scores,
+        beforeNMS_index_array, afterNMS_scores, afterNMS_index_array, workspace);
 }
 
 // allClassNMS LAUNCH CONFIG 
@@ -292,6 +177,7 @@ typedef pluginStatus_t (*nmsFunc)(cudaStream_t,
                                void*,
                                void*,
                                void*,
+                               void*,
                                bool);
 
 struct nmsLaunchConfigSSD
@@ -323,6 +209,8 @@ bool nmsInit()
 {
     nmsFuncVec.push_back(nmsLaunchConfigSSD(DataType::kFLOAT, DataType::kFLOAT,
                                             allClassNMS_gpu<float, float>));
+    nmsFuncVec.push_back(nmsLaunchConfigSSD(DataType::kHALF, DataType::kHALF,
+                                            allClassNMS_gpu<__half, __half>));
     return true;
 }
 
@@ -344,6 +232,7 @@ pluginStatus_t allClassNMS(cudaStream_t stream,
                         void* beforeNMS_index_array,
                         void* afterNMS_scores,
                         void* afterNMS_index_array,
+                        void* workspace,
                         bool flipXY)
 {
     nmsLaunchConfigSSD lc = nmsLaunchConfigSSD(DT_SCORE, DT_BBOX, allClassNMS_gpu<float, float>);
@@ -365,6 +254,7 @@ pluginStatus_t allClassNMS(cudaStream_t stream,
                                           beforeNMS_index_array,
                                           afterNMS_scores,
                                           afterNMS_index_array,
+                                          workspace,
                                           flipXY);
         }
     }
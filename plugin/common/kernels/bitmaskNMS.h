@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_BITMASK_NMS_H
+#define TRT_BITMASK_NMS_H
+
+#include "plugin.h"
+#include <cuda_fp16.h>
+#include <stdint.h>
+
+/*
+ * Bitmask NMS shared by the detection plugins, include from .cu files only.
+ *
+ * The candidates are split into segments, an image or a class of an image, each sorted by decreasing score. The IoU
+ * matrices of all the segments are built in one launch as 64 bit masks, bit j of word c of row i telling whether
+ * candidate i suppresses candidate 64 * c + j. One warp per segment then walks the candidates in order.
+ *
+ * The candidates are read through a Segments policy:
+ *     __device__ int count(int segment) const;                   number of candidates of the segment
+ *     __device__ int load(int segment, int i, NMSBox& box) const; label of candidate i, negative to skip it
+ * A candidate only suppresses the candidates with the same label. The results go to an Output policy, whose keep and
+ * discard are called by lane 0 for the candidates in order until maxKept of them are kept, and whose finish is called
+ * by the 32 lanes once the segment is done:
+ *     __device__ void keep(int segment, int i, int rank) const;
+ *     __device__ void discard(int segment, int i) const;
+ *     __device__ void finish(int segment, int kept, int lane) const;
+ */
+
+const int kNMSBoxesPerWord = 64;
+// The warp walking a segment keeps its suppressed set in shared memory
+const int kNMSMaxCandidates = 64 * 1024;
+
+// Corners of a candidate, in float whatever the type of the input boxes
+struct NMSBox
+{
+    float xmin, ymin, xmax, ymax;
+};
+
+// Layout of the four coordinates of an input box
+enum class NMSBoxEncoding
+{
+    kCornerXY, // [xmin, ymin, xmax, ymax]
+    kCornerYX, // [ymin, xmin, ymax, xmax]
+    kCenterXY  // [xcenter, ycenter, width, height]
+};
+
+template <NMSBoxEncoding ENCODING>
+struct NMSBoxDecoder;
+
+template <>
+struct NMSBoxDecoder<NMSBoxEncoding::kCornerXY>
+{
+    template <typename T>
+    __device__ static NMSBox decode(const T* box)
+    {
+        return {float(box[0]), float(box[1]), float(box[2]), float(box[3])};
+    }
+};
+
+template <>
+struct NMSBoxDecoder<NMSBoxEncoding::kCornerYX>
+{
+    template <typename T>
+    __device__ static NMSBox decode(const T* box)
+    {
+        return {float(box[1]), float(box[0]), float(box[3]), float(box[2])};
+    }
+};
+
+template <>
+struct NMSBoxDecoder<NMSBoxEncoding::kCenterXY>
+{
+    template <typename T>
+    __device__ static NMSBox decode(const T* box)
+    {
+        const float halfWidth = float(box[2]) * 0.5f;
+        const float halfHeight = float(box[3]) * 0.5f;
+        return {float(box[0]) - halfWidth, float(box[1]) - halfHeight, float(box[0]) + halfWidth,
+            float(box[1]) + halfHeight};
+    }
+};
+
+template <NMSBoxEncoding ENCODING, typename T>
+__device__ inline NMSBox decodeNMSBox(const T* box)
+{
+    return NMSBoxDecoder<ENCODING>::decode(box);
+}
+
+// Same overlap as jaccardOverlap, pad is 1 for boxes in pixels, whose sizes count the boundary pixels, 0 otherwise.
+// Invalid boxes (xmax < xmin or ymax < ymin) have no area.
+__device__ inline float nmsIoU(const NMSBox& a, const NMSBox& b, const float pad)
+{
+    if (b.xmin > a.xmax || b.xmax < a.xmin || b.ymin > a.ymax || b.ymax < a.ymin)
+    {
+        return 0.f;
+    }
+    const float width = min(a.xmax, b.xmax) - max(a.xmin, b.xmin) + pad;
+    const float height = min(a.ymax, b.ymax) - max(a.ymin, b.ymin) + pad;
+    if (width <= 0.f || height <= 0.f)
+    {
+        return 0.f;
+    }
+    const float intersection = width * height;
+    const float sizeA = (a.xmax < a.xmin || a.ymax < a.ymin) ? 0.f : (a.xmax - a.xmin + pad) * (a.ymax - a.ymin + pad);
+    const float sizeB = (b.xmax < b.xmin || b.ymax < b.ymin) ? 0.f : (b.xmax - b.xmin + pad) * (b.ymax - b.ymin + pad);
+    return intersection / (sizeA + sizeB - intersection);
+}
+
+template <bool NORMALIZED>
+__device__ inline float nmsIoU(const NMSBox& a, const NMSBox& b)
+{
+    return nmsIoU(a, b, NORMALIZED ? 0.f : 1.f);
+}
+
+__host__ __device__ inline int nmsMaskWords(int count)
+{
+    return (count + kNMSBoxesPerWord - 1) / kNMSBoxesPerWord;
+}
+
+// Mask of numSegments segments of up to maxCount candidates
+size_t bitmaskNMSWorkspaceSize(int numSegments, int maxCount);
+
+// One block per (column, row, segment) tile of the masks. The diagonal bit of a skipped candidate is set, which no
+// other candidate sets, so that the walk does not need to load it again.
+template <bool NORMALIZED, typename Segments>
+__global__ __launch_bounds__(kNMSBoxesPerWord) void bitmaskNMSMask_kernel(
+    const Segments segments, const int maxCount, const float iouThreshold, uint64_t* __restrict__ mask)
+{
+    const int colBlock = blockIdx.x;
+    const int rowBlock = blockIdx.y;
+    const int segment = blockIdx.z;
+    const int count = segments.count(segment);
+    // Only the candidates after a candidate can be suppressed by it
+    if (rowBlock > colBlock || colBlock * kNMSBoxesPerWord >= count)
+    {
+        return;
+    }
+
+    __shared__ NMSBox colBoxes[kNMSBoxesPerWord];
+    __shared__ int colLabels[kNMSBoxesPerWord];
+    const int colStart = colBlock * kNMSBoxesPerWord;
+    const int colSize = min(count - colStart, kNMSBoxesPerWord);
+    if (threadIdx.x < colSize)
+    {
+        colLabels[threadIdx.x] = segments.load(segment, colStart + threadIdx.x, colBoxes[threadIdx.x]);
+    }
+    __syncthreads();
+
+    const int rowSize = min(count - rowBlock * kNMSBoxesPerWord, kNMSBoxesPerWord);
+    if (threadIdx.x < rowSize)
+    {
+        const int i = rowBlock * kNMSBoxesPerWord + threadIdx.x;
+        NMSBox rowBox;
+        const int rowLabel = segments.load(segment, i, rowBox);
+        uint64_t bits = 0;
+        if (rowLabel < 0)
+        {
+            bits = rowBlock == colBlock ? (uint64_t) 1 << threadIdx.x : 0;
+        }
+        else
+        {
+            for (int j = rowBlock == colBlock ? threadIdx.x + 1 : 0; j < colSize; j++)
+            {
+                if (colLabels[j] == rowLabel && nmsIoU<NORMALIZED>(rowBox, colBoxes[j]) > iouThreshold)
+                {
+                    bits |= (uint64_t) 1 << j;
+                }
+            }
+        }
+        mask[((size_t) segment * maxCount + i) * nmsMaskWords(maxCount) + colBlock] = bits;
+    }
+}
+
+// One warp per segment, each lane owns every 32nd word of the suppressed set
+template <typename Segments, typename Output>
+__global__ __launch_bounds__(32) void bitmaskNMSReduce_kernel(const Segments segments, const int maxCount,
+    const uint64_t* __restrict__ mask, const Output output, const int maxKept)
+{
+    __shared__ uint64_t removed[kNMSMaxCandidates / kNMSBoxesPerWord];
+
+    const int segment = blockIdx.x;
+    const int lane = threadIdx.x;
+    const int count = segments.count(segment);
+    const int words = nmsMaskWords(count);
+    const int rowWords = nmsMaskWords(maxCount);
+    const uint64_t* segmentMask = mask + (size_t) segment * maxCount * rowWords;
+
+    for (int w = lane; w < words; w += 32)
+    {
+        removed[w] = 0;
+    }
+    __syncwarp();
+
+    int kept = 0;
+    for (int w = 0; w < words && kept < maxKept; w++)
+    {
+        uint64_t current = removed[w];
+        const int wordSize = min(count - w * kNMSBoxesPerWord, kNMSBoxesPerWord);
+        for (int j = 0; j < wordSize && kept < maxKept; j++)
+        {
+            const int i = w * kNMSBoxesPerWord + j;
+            const uint64_t* row = segmentMask + (size_t) i * rowWords;
+            const uint64_t bit = (uint64_t) 1 << j;
+            if ((current | row[w]) & bit)
+            {
+                if (lane == 0)
+                {
+                    output.discard(segment, i);
+                }
+                continue;
+            }
+
+            if (lane == 0)
+            {
+                output.keep(segment, i, kept);
+            }
+            kept++;
+            current |= row[w];
+            for (int c = w + 1 + lane; c < words; c += 32)
+            {
+                removed[c] |= row[c];
+            }
+        }
+        __syncwarp();
+    }
+
+    output.finish(segment, kept, lane);
+}
+
+// Same walk as bitmaskNMSReduce_kernel for segments of up to MAX_WORDS <= 32 words, the kept top_k of the detection
+// plugins. Lane c keeps word c of the suppressed set in a register, the warp reads word w from lane w, and the loop
+// over the words unrolls.
+template <int MAX_WORDS, typename Segments, typename Output>
+__global__ __launch_bounds__(32) void bitmaskNMSReduceRegisters_kernel(const Segments segments, const int maxCount,
+    const uint64_t* __restrict__ mask, const Output output, const int maxKept)
+{
+    const int segment = blockIdx.x;
+    const int lane = threadIdx.x;
+    const int count = segments.count(segment);
+    const int words = nmsMaskWords(count);
+    const int rowWords = nmsMaskWords(maxCount);
+    const uint64_t* segmentMask = mask + (size_t) segment * maxCount * rowWords;
+
+    uint64_t removed = 0;
+    int kept = 0;
+#pragma unroll
+    for (int w = 0; w < MAX_WORDS; w++)
+    {
+        if (w >= words || kept >= maxKept)
+        {
+            break;
+        }
+        uint64_t current = __shfl_sync(0xffffffff, removed, w);
+        const int wordSize = min(count - w * kNMSBoxesPerWord, kNMSBoxesPerWord);
+        for (int j = 0; j < wordSize && kept < maxKept; j++)
+        {
+            const int i = w * kNMSBoxesPerWord + j;
+            const uint64_t* row = segmentMask + (size_t) i * rowWords;
+            const uint64_t bit = (uint64_t) 1 << j;
+            if ((current | row[w]) & bit)
+            {
+                if (lane == 0)
+                {
+                    output.discard(segment, i);
+                }
+                continue;
+            }
+
+            if (lane == 0)
+            {
+                output.keep(segment, i, kept);
+            }
+            kept++;
+            current |= row[w];
+            if (lane > w && lane < words)
+            {
+                removed |= row[lane];
+            }
+        }
+    }
+
+    output.finish(segment, kept, lane);
+}
+
+// Reduces the mask of segments of up to maxCount candidates, in registers up to 2048 candidates, which covers the
+// top_k of 100, 200 and 400 of the detection plugins, and in shared memory above
+template <typename Segments, typename Output>
+pluginStatus_t bitmaskNMSReduce(cudaStream_t stream, const int numSegments, const int maxCount, const uint64_t* mask,
+    const int maxKept, const Segments& segments, const Output& output)
+{
+    const int words = nmsMaskWords(maxCount);
+    if (words <= 2)
+    {
+        bitmaskNMSReduceRegisters_kernel<2, Segments, Output>
+            <<<numSegments, 32, 0, stream>>>(segments, maxCount, mask, output, maxKept);
+    }
+    else if (words <= 4)
+    {
+        bitmaskNMSReduceRegisters_kernel<4, Segments, Output>
+            <<<numSegments, 32, 0, stream>>>(segments, maxCount, mask, output, maxKept);
+    }
+    else if (words <= 8)
+    {
+        bitmaskNMSReduceRegisters_kernel<8, Segments, Output>
+            <<<numSegments, 32, 0, stream>>>(segments, maxCount, mask, output, maxKept);
+    }
+    else if (words <= 32)
+    {
+        bitmaskNMSReduceRegisters_kernel<32, Segments, Output>
+            <<<numSegments, 32, 0, stream>>>(segments, maxCount, mask, output, maxKept);
+    }
+    else
+    {
+        bitmaskNMSReduce_kernel<Segments, Output>
+            <<<numSegments, 32, 0, stream>>>(segments, maxCount, mask, output, maxKept);
+    }
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
+}
+
+// Suppresses the candidates of numSegments segments of up to maxCount candidates each, using the
+// bitmaskNMSWorkspaceSize(numSegments, maxCount) bytes of workspace
+template <bool NORMALIZED, typename Segments, typename Output>
+pluginStatus_t bitmaskNMS(cudaStream_t stream, const int numSegments, const int maxCount, const float iouThreshold,
+    const int maxKept, const Segments& segments, const Output& output, void* workspace)
+{
+    ASSERT_PARAM(maxCount <= kNMSMaxCandidates);
+    ASSERT_PARAM(numSegments <= 65535);
+    if (numSegments == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    uint64_t* mask = static_cast<uint64_t*>(workspace);
+    const int words = nmsMaskWords(maxCount);
+    if (words > 0)
+    {
+        const dim3 maskGrid(words, words, numSegments);
+        bitmaskNMSMask_kernel<NORMALIZED, Segments>
+            <<<maskGrid, kNMSBoxesPerWord, 0, stream>>>(segments, maxCount, iouThreshold, mask);
+        CSC(cudaGetLastError(), STATUS_FAILURE);
+    }
+
+    return bitmaskNMSReduce(stream, numSegments, maxCount, mask, maxKept, segments, output);
+}
+
+#endif // TRT_BITMASK_NMS_H
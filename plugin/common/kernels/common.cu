@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include "kernel.h"
 #include "bboxUtils.h"
+#include "bitmaskNMS.h"
 
 #define CUDA_MEM_ALIGN 256
 
@@ -82,6 +83,12 @@ size_t calculateTotalWorkspaceSize(size_t* workspaces, int count)
     return total;
 }
 
+// BITMASK NMS WORKSPACE SIZE 
+size_t bitmaskNMSWorkspaceSize(int numSegments, int maxCount)
+{
+    return static_cast<size_t>(numSegments) * maxCount * nmsMaskWords(maxCount) * sizeof(uint64_t);
+}
+
 using nvinfer1::DataType;
 
 // DATA TYPE SIZE 
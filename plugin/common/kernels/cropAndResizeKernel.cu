@@ -16,24 +16,91 @@
 
 
 #include <cuda.h>
+#include <cuda_fp16.h>
 #include <cuda_runtime.h>
 
+#include "kernel.h"
+
+// Offset of element (n, c, y, x) of a [N, C, H, W] tensor in one of the layouts supported by the plugin
+__device__ inline int layoutOffset(TensorFormat format, int n, int c, int y, int x, int C, int H, int W)
+{
+    switch (format)
+    {
+    case TensorFormat::kHWC8: return ((n * H + y) * W + x) * ((C + 7) / 8 * 8) + c;
+    case TensorFormat::kCHW16: return (((n * ((C + 15) / 16) + c / 16) * H + y) * W + x) * 16 + c % 16;
+    case TensorFormat::kCHW32: return (((n * ((C + 31) / 32) + c / 32) * H + y) * W + x) * 32 + c % 32;
+    default: return ((n * C + c) * H + y) * W + x;
+    }
+}
+
+__device__ inline float loadValue(const float* p, float /*scale*/)
+{
+    return *p;
+}
+
+__device__ inline float loadValue(const __half* p, float /*scale*/)
+{
+    return __half2float(*p);
+}
+
+__device__ inline float loadValue(const int8_t* p, float scale)
+{
+    return *p * scale;
+}
+
+__device__ inline void storeValue(float* p, float v, float /*scale*/)
+{
+    *p = v;
+}
+
+__device__ inline void storeValue(__half* p, float v, float /*scale*/)
+{
+    *p = __float2half(v);
+}
+
+__device__ inline void storeValue(int8_t* p, float v, float scale)
+{
+    *p = static_cast<int8_t>(fmaxf(-127.f, fminf(127.f, rintf(v / scale))));
+}
+
+// Each thread computes one output element. The linear layout is walked x first as before, the vectorized layouts are
+// walked channel first so that a warp writes contiguous vectors, including the padding channels which are zeroed.
 template <typename T>
 __global__ void cropAndResizeKernel(const int nthreads, const T* image_ptr, const float* boxes_ptr,
                                     int num_boxes, int batch, int image_height, int image_width,
-                                    int crop_height, int crop_width, int depth,
-                                    float extrapolation_value, float* crops_ptr)
+                                    int crop_height, int crop_width, int depth, int padded_depth,
+                                    TensorFormat format, float input_scale, float output_scale,
+                                    float extrapolation_value, T* crops_ptr)
 {
     for (int out_idx = threadIdx.x + blockIdx.x * blockDim.x ; out_idx < nthreads;
             out_idx += blockDim.x * gridDim.x)
     {
         int idx =  out_idx;
-        const int x = idx % crop_width;
-        idx /= crop_width;
-        const int y = idx % crop_height;
-        idx /= crop_height;
-        const int d = idx % depth;
-        const int b = idx / depth;
+        int x, y, d, b;
+        if (format == TensorFormat::kLINEAR)
+        {
+            x = idx % crop_width;
+            idx /= crop_width;
+            y = idx % crop_height;
+            idx /= crop_height;
+            d = idx % depth;
+            b = idx / depth;
+        }
+        else
+        {
+            d = idx % padded_depth;
+            idx /= padded_depth;
+            x = idx % crop_width;
+            idx /= crop_width;
+            y = idx % crop_height;
+            b = idx / crop_height;
+        }
+        T* crop = crops_ptr + layoutOffset(format, b, d, y, x, depth, crop_height, crop_width);
+        if (d >= depth)
+        {
+            storeValue(crop, 0.f, output_scale);
+            continue;
+        }
         const float y1 = boxes_ptr[b * 4];
         const float x1 = boxes_ptr[b * 4 + 1];
         const float y2 = boxes_ptr[b * 4 + 2];
@@ -57,7 +124,7 @@ __global__ void cropAndResizeKernel(const int nthreads, const T* image_ptr, cons
 
         if (in_y < 0 || in_y > image_height - 1)
         {
-            crops_ptr[out_idx] = extrapolation_value;
+            storeValue(crop, extrapolation_value, output_scale);
             continue;
         }
 
@@ -67,7 +134,7 @@ __global__ void cropAndResizeKernel(const int nthreads, const T* image_ptr, cons
 
         if (in_x < 0 || in_x > image_width - 1)
         {
-            crops_ptr[out_idx] = extrapolation_value;
+            storeValue(crop, extrapolation_value, output_scale);
             continue;
         }
 
@@ -77,35 +144,62 @@ __global__ void cropAndResizeKernel(const int nthreads, const T* image_ptr, cons
         const int left_x_index = floorf(in_x);
         const int right_x_index = ceilf(in_x);
         const float x_lerp = in_x - left_x_index;
-        const float top_left(static_cast<float>(
-                                     image_ptr[((b_in * depth + d) * image_height +
-                                               top_y_index) *
-                                               image_width +
-                                               left_x_index]));
-        const float top_right(static_cast<float>(
-                                     image_ptr[((b_in * depth + d) * image_height +
-                                                top_y_index) *
-                                                image_width +
-                                                right_x_index]));
-        const float bottom_left(static_cast<float>(
-                                     image_ptr[((b_in * depth + d) * image_height +
-                                               bottom_y_index) *
-                                               image_width +
-                                               left_x_index]));
-        const float bottom_right(static_cast<float>(
-                                     image_ptr[((b_in * depth + d) * image_height +
-                                               bottom_y_index) *
-                                               image_width +
-                                               right_x_index]));
+        const float top_left = loadValue(image_ptr
+                + layoutOffset(format, b_in, d, top_y_index, left_x_index, depth, image_height, image_width),
+            input_scale);
+        const float top_right = loadValue(image_ptr
+                + layoutOffset(format, b_in, d, top_y_index, right_x_index, depth, image_height, image_width),
+            input_scale);
+        const float bottom_left = loadValue(image_ptr
+                + layoutOffset(format, b_in, d, bottom_y_index, left_x_index, depth, image_height, image_width),
+            input_scale);
+        const float bottom_right = loadValue(image_ptr
+                + layoutOffset(format, b_in, d, bottom_y_index, right_x_index, depth, image_height, image_width),
+            input_scale);
         const float top = top_left + (top_right - top_left) * x_lerp;
         const float bottom = bottom_left + (bottom_right - bottom_left) * x_lerp;
-        crops_ptr[out_idx] = top + (bottom - top) * y_lerp;
+        storeValue(crop, top + (bottom - top) * y_lerp, output_scale);
     }
 }
 
-
-
-
+template <typename T>
+void cropAndResizeLaunch(cudaStream_t stream, const void* image, const void* rois, int batch_size,
+    int input_height, int input_width, int num_boxes, int crop_height, int crop_width, int depth,
+    TensorFormat format, float input_scale, float output_scale, void* output)
+{
+    int padded_depth = depth;
+    if (format == TensorFormat::kHWC8)
+    {
+        padded_depth = (depth + 7) / 8 * 8;
+    }
+    else if (format == TensorFormat::kCHW16)
+    {
+        padded_depth = (depth + 15) / 16 * 16;
+    }
+    else if (format == TensorFormat::kCHW32)
+    {
+        padded_depth = (depth + 31) / 32 * 32;
+    }
+    int output_volume = batch_size * num_boxes * crop_height * crop_width * padded_depth;
+    int block_size = 1024;
+    int grid_size = (output_volume + block_size - 1 ) / block_size;
+    cropAndResizeKernel<T> <<< grid_size, block_size, 0, stream>>>(output_volume,
+            static_cast<const T*>(image),
+            static_cast<const float*>(rois),
+            num_boxes,
+            batch_size,
+            input_height,
+            input_width,
+            crop_height,
+            crop_width,
+            depth,
+            padded_depth,
+            format,
+            input_scale,
+            output_scale,
+            0.0f,
+            static_cast<T*>(output));
+}
 
 int cropAndResizeInference(
     cudaStream_t stream,
@@ -119,22 +213,27 @@ int cropAndResizeInference(
     int crop_height,
     int crop_width,
     int depth,
+    DataType dtype,
+    TensorFormat format,
+    float input_scale,
+    float output_scale,
     void* output)
 {
-    int output_volume = batch_size * num_boxes * crop_height * crop_width * depth;
-    int block_size = 1024;
-    int grid_size = (output_volume + block_size - 1 ) / block_size;
-    cropAndResizeKernel<float> <<< grid_size, block_size, 0, stream>>>(output_volume,
-            static_cast<const float*>(image),
-            static_cast<const float*>(rois),
-            num_boxes,
-            batch_size,
-            input_height,
-            input_width,
-            crop_height,
-            crop_width,
-            depth,
-            0.0f,
-            static_cast<float*>(output));
-    return 0;
+    switch (dtype)
+    {
+    case DataType::kFLOAT:
+        cropAndResizeLaunch<float>(stream, image, rois, batch_size, input_height, input_width, num_boxes,
+            crop_height, crop_width, depth, format, input_scale, output_scale, output);
+        break;
+    case DataType::kHALF:
+        cropAndResizeLaunch<__half>(stream, image, rois, batch_size, input_height, input_width, num_boxes,
+            crop_height, crop_width, depth, format, input_scale, output_scale, output);
+        break;
+    case DataType::kINT8:
+        cropAndResizeLaunch<int8_t>(stream, image, rois, batch_size, input_height, input_width, num_boxes,
+            crop_height, crop_width, depth, format, input_scale, output_scale, output);
+        break;
+    default: return 1;
+    }
+    return cudaGetLastError() != cudaSuccess;
 }
@@ -13,24 +13,27 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <cuda_fp16.h>
 #include <vector>
 #include "kernel.h"
+#include "detectionDispatch.h"
 
-template <typename T_BBOX, unsigned nthds_per_cta>
+// The code type and whether the boxes are shared are known at compile time, see detectionDispatch.h
+template <typename T_BBOX, typename T_IN, CodeTypeSSD CODE_TYPE, bool SHARE_LOCATION, unsigned nthds_per_cta>
 __launch_bounds__(nthds_per_cta)
     __global__ void decodeBBoxes_kernel(
         const int nthreads,
-        const CodeTypeSSD code_type,
         const bool variance_encoded_in_target,
         const int num_priors,
-        const bool share_location,
-        const int num_loc_classes,
+        const int runtime_num_loc_classes,
         const int background_label_id,
         const bool clip_bbox,
-        const T_BBOX* loc_data,
-        const T_BBOX* prior_data,
+        const bool class_major,
+        const T_IN* loc_data,
+        const T_IN* prior_data,
         T_BBOX* bbox_data)
 {
+    const int num_loc_classes = SHARE_LOCATION ? 1 : runtime_num_loc_classes;
     for (int index = blockIdx.x * nthds_per_cta + threadIdx.x;
          index < nthreads;
          index += nthds_per_cta * gridDim.x)
@@ -41,8 +44,13 @@ __launch_bounds__(nthds_per_cta)
         const int c = (index / 4) % num_loc_classes;
         // Prior box id corresponding to the bounding box
         const int d = (index / 4 / num_loc_classes) % num_priors;
+        // The boxes are read in the [N, num_priors, num_loc_classes, 4] layout of the location head. They are written
+        // in the same layout, or class-major, [N, num_loc_classes, num_priors, 4], as the NMS reads them.
+        const int out_index = class_major
+            ? ((index / 4 / num_loc_classes / num_priors * num_loc_classes + c) * num_priors + d) * 4 + i
+            : index;
         // If bounding box was not shared among all the classes and the bounding box is corresponding to the background class
-        if (!share_location && c == background_label_id)
+        if (!SHARE_LOCATION && c == background_label_id)
         {
             // Ignore background class if not share_location.
             return;
@@ -53,7 +61,7 @@ __launch_bounds__(nthds_per_cta)
         const int vi = pi + num_priors * 4;
         // Encoding method: CodeTypeSSD::CORNER
         //if (code_type == PriorBoxParameter_CodeType_CORNER){
-        if (code_type == CodeTypeSSD::CORNER)
+        if (CODE_TYPE == CodeTypeSSD::CORNER)
         {
             // Do not want to use variances to adjust the bounding box decoding
             if (variance_encoded_in_target)
@@ -61,24 +69,24 @@ __launch_bounds__(nthds_per_cta)
                 // variance is encoded in target, we simply need to add the offset
                 // predictions.
                 // prior_data[pi + i]: prior box coordinates corresponding to the current bounding box coordinate
-                bbox_data[index] = prior_data[pi + i] + loc_data[index];
+                bbox_data[out_index] = T_BBOX(prior_data[pi + i]) + T_BBOX(loc_data[index]);
             }
             else
             {
                 // variance is encoded in bbox, we need to scale the offset accordingly.
                 // prior_data[vi + i]: variance corresponding to the current bounding box coordinate
-                bbox_data[index] = prior_data[pi + i] + loc_data[index] * prior_data[vi + i];
+                bbox_data[out_index] = T_BBOX(prior_data[pi + i]) + T_BBOX(loc_data[index]) * T_BBOX(prior_data[vi + i]);
             }
             //} else if (code_type == PriorBoxParameter_CodeType_CENTER_SIZE) {
         }
         // Encoding method: CodeTypeSSD::CENTER_SIZE
-        else if (code_type == CodeTypeSSD::CENTER_SIZE)
+        else if (CODE_TYPE == CodeTypeSSD::CENTER_SIZE)
         {
             // Get prior box coordinates
-            const T_BBOX p_xmin = prior_data[pi];
-            const T_BBOX p_ymin = prior_data[pi + 1];
-            const T_BBOX p_xmax = prior_data[pi + 2];
-            const T_BBOX p_ymax = prior_data[pi + 3];
+            const T_BBOX p_xmin = T_BBOX(prior_data[pi]);
+            const T_BBOX p_ymin = T_BBOX(prior_data[pi + 1]);
+            const T_BBOX p_xmax = T_BBOX(prior_data[pi + 2]);
+            const T_BBOX p_ymax = T_BBOX(prior_data[pi + 3]);
             // Calculate prior box center, height, and width
             const T_BBOX prior_width = p_xmax - p_xmin;
             const T_BBOX prior_height = p_ymax - p_ymin;
@@ -86,10 +94,10 @@ __launch_bounds__(nthds_per_cta)
             const T_BBOX prior_center_y = (p_ymin + p_ymax) / 2.;
 
             // Get the current bounding box coordinates
-            const T_BBOX xmin = loc_data[index - i];
-            const T_BBOX ymin = loc_data[index - i + 1];
-            const T_BBOX xmax = loc_data[index - i + 2];
-            const T_BBOX ymax = loc_data[index - i + 3];
+            const T_BBOX xmin = T_BBOX(loc_data[index - i]);
+            const T_BBOX ymin = T_BBOX(loc_data[index - i + 1]);
+            const T_BBOX xmax = T_BBOX(loc_data[index - i + 2]);
+            const T_BBOX ymax = T_BBOX(loc_data[index - i + 3]);
 
             // Declare decoded bounding box coordinates
             T_BBOX decode_bbox_center_x, decode_bbox_center_y;
@@ -107,38 +115,38 @@ __launch_bounds__(nthds_per_cta)
             else
             {
                 // variance is encoded in bbox, we need to scale the offset accordingly.
-                decode_bbox_center_x = prior_data[vi] * xmin * prior_width + prior_center_x;
-                decode_bbox_center_y = prior_data[vi + 1] * ymin * prior_height + prior_center_y;
-                decode_bbox_width = exp(prior_data[vi + 2] * xmax) * prior_width;
-                decode_bbox_height = exp(prior_data[vi + 3] * ymax) * prior_height;
+                decode_bbox_center_x = T_BBOX(prior_data[vi]) * xmin * prior_width + prior_center_x;
+                decode_bbox_center_y = T_BBOX(prior_data[vi + 1]) * ymin * prior_height + prior_center_y;
+                decode_bbox_width = exp(T_BBOX(prior_data[vi + 2]) * xmax) * prior_width;
+                decode_bbox_height = exp(T_BBOX(prior_data[vi + 3]) * ymax) * prior_height;
             }
 
             // Use [x_topleft, y_topleft, x_bottomright, y_bottomright] as coordinates for final decoded bounding box output
             switch (i)
             {
             case 0:
-                bbox_data[index] = decode_bbox_center_x - decode_bbox_width / 2.;
+                bbox_data[out_index] = decode_bbox_center_x - decode_bbox_width / 2.;
                 break;
             case 1:
-                bbox_data[index] = decode_bbox_center_y - decode_bbox_height / 2.;
+                bbox_data[out_index] = decode_bbox_center_y - decode_bbox_height / 2.;
                 break;
             case 2:
-                bbox_data[index] = decode_bbox_center_x + decode_bbox_width / 2.;
+                bbox_data[out_index] = decode_bbox_center_x + decode_bbox_width / 2.;
                 break;
             case 3:
-                bbox_data[index] = decode_bbox_center_y + decode_bbox_height / 2.;
+                bbox_data[out_index] = decode_bbox_center_y + decode_bbox_height / 2.;
                 break;
             }
             //} else if (code_type == PriorBoxParameter_CodeType_CORNER_SIZE) {
         }
         // Encoding method: CodeTypeSSD::CORNER_SIZE
-        else if (code_type == CodeTypeSSD::CORNER_SIZE)
+        else if (CODE_TYPE == CodeTypeSSD::CORNER_SIZE)
         {
             // Get prior box coordinates
-            const T_BBOX p_xmin = prior_data[pi];
-            const T_BBOX p_ymin = prior_data[pi + 1];
-            const T_BBOX p_xmax = prior_data[pi + 2];
-            const T_BBOX p_ymax = prior_data[pi + 3];
+            const T_BBOX p_xmin = T_BBOX(prior_data[pi]);
+            const T_BBOX p_ymin = T_BBOX(prior_data[pi + 1]);
+            const T_BBOX p_xmax = T_BBOX(prior_data[pi + 2]);
+            const T_BBOX p_ymax = T_BBOX(prior_data[pi + 3]);
             // Get prior box width and height
             const T_BBOX prior_width = p_xmax - p_xmin;
             const T_BBOX prior_height = p_ymax - p_ymin;
@@ -156,52 +164,52 @@ __launch_bounds__(nthds_per_cta)
             {
                 // variance is encoded in target, we simply need to add the offset
                 // predictions.
-                bbox_data[index] = prior_data[pi + i] + loc_data[index] * p_size;
+                bbox_data[out_index] = T_BBOX(prior_data[pi + i]) + T_BBOX(loc_data[index]) * p_size;
             }
             else
             {
                 // variance is encoded in bbox, we need to scale the offset accordingly.
-                bbox_data[index] = prior_data[pi + i] + loc_data[index] * prior_data[vi + i] * p_size;
+                bbox_data[out_index] = T_BBOX(prior_data[pi + i]) + T_BBOX(loc_data[index]) * T_BBOX(prior_data[vi + i]) * p_size;
             }
         }
         // Exactly the same to CodeTypeSSD::CENTER_SIZE with using variance to adjust the bounding box decoding 
-        else if (code_type == CodeTypeSSD::TF_CENTER)
+        else if (CODE_TYPE == CodeTypeSSD::TF_CENTER)
         {
-            const T_BBOX pXmin = prior_data[pi];
-            const T_BBOX pYmin = prior_data[pi + 1];
-            const T_BBOX pXmax = prior_data[pi + 2];
-            const T_BBOX pYmax = prior_data[pi + 3];
+            const T_BBOX pXmin = T_BBOX(prior_data[pi]);
+            const T_BBOX pYmin = T_BBOX(prior_data[pi + 1]);
+            const T_BBOX pXmax = T_BBOX(prior_data[pi + 2]);
+            const T_BBOX pYmax = T_BBOX(prior_data[pi + 3]);
             const T_BBOX priorWidth = pXmax - pXmin;
             const T_BBOX priorHeight = pYmax - pYmin;
             const T_BBOX priorCenterX = (pXmin + pXmax) / 2.;
             const T_BBOX priorCenterY = (pYmin + pYmax) / 2.;
 
-            const T_BBOX ymin = loc_data[index - i];
-            const T_BBOX xmin = loc_data[index - i + 1];
-            const T_BBOX ymax = loc_data[index - i + 2];
-            const T_BBOX xmax = loc_data[index - i + 3];
+            const T_BBOX ymin = T_BBOX(loc_data[index - i]);
+            const T_BBOX xmin = T_BBOX(loc_data[index - i + 1]);
+            const T_BBOX ymax = T_BBOX(loc_data[index - i + 2]);
+            const T_BBOX xmax = T_BBOX(loc_data[index - i + 3]);
 
             T_BBOX bboxCenterX, bboxCenterY;
             T_BBOX bboxWidth, bboxHeight;
 
-            bboxCenterX = prior_data[vi] * xmin * priorWidth + priorCenterX;
-            bboxCenterY = prior_data[vi + 1] * ymin * priorHeight + priorCenterY;
-            bboxWidth = exp(prior_data[vi + 2] * xmax) * priorWidth;
-            bboxHeight = exp(prior_data[vi + 3] * ymax) * priorHeight;
+            bboxCenterX = T_BBOX(prior_data[vi]) * xmin * priorWidth + priorCenterX;
+            bboxCenterY = T_BBOX(prior_data[vi + 1]) * ymin * priorHeight + priorCenterY;
+            bboxWidth = exp(T_BBOX(prior_data[vi + 2]) * xmax) * priorWidth;
+            bboxHeight = exp(T_BBOX(prior_data[vi + 3]) * ymax) * priorHeight;
 
             switch (i)
             {
             case 0:
-                bbox_data[index] = bboxCenterX - bboxWidth / 2.;
+                bbox_data[out_index] = bboxCenterX - bboxWidth / 2.;
                 break;
             case 1:
-                bbox_data[index] = bboxCenterY - bboxHeight / 2.;
+                bbox_data[out_index] = bboxCenterY - bboxHeight / 2.;
                 break;
             case 2:
-                bbox_data[index] = bboxCenterX + bboxWidth / 2.;
+                bbox_data[out_index] = bboxCenterX + bboxWidth / 2.;
                 break;
             case 3:
-                bbox_data[index] = bboxCenterY + bboxHeight / 2.;
+                bbox_data[out_index] = bboxCenterY + bboxHeight / 2.;
                 break;
             }
         }
@@ -213,12 +221,47 @@ __launch_bounds__(nthds_per_cta)
         // Clip bounding box or not
         if (clip_bbox)
         {
-            bbox_data[index] = max(min(bbox_data[index], T_BBOX(1.)), T_BBOX(0.));
+            bbox_data[out_index] = max(min(bbox_data[out_index], T_BBOX(1.)), T_BBOX(0.));
         }
     }
 }
 
-template <typename T_BBOX>
+template <typename T_BBOX, typename T_IN>
+struct DecodeBBoxesLaunch
+{
+    cudaStream_t stream;
+    int nthreads;
+    bool variance_encoded_in_target;
+    int num_priors;
+    bool share_location;
+    int num_loc_classes;
+    int background_label_id;
+    bool clip_bbox;
+    bool class_major;
+    const void* loc_data;
+    const void* prior_data;
+    void* bbox_data;
+
+    template <CodeTypeSSD CODE_TYPE>
+    pluginStatus_t run() const
+    {
+        return share_location ? launch<CODE_TYPE, true>() : launch<CODE_TYPE, false>();
+    }
+
+    template <CodeTypeSSD CODE_TYPE, bool SHARE_LOCATION>
+    pluginStatus_t launch() const
+    {
+        const int BS = 512;
+        const int GS = (nthreads + BS - 1) / BS;
+        decodeBBoxes_kernel<T_BBOX, T_IN, CODE_TYPE, SHARE_LOCATION, BS><<<GS, BS, 0, stream>>>(nthreads,
+            variance_encoded_in_target, num_priors, num_loc_classes, background_label_id, clip_bbox, class_major,
+            (const T_IN*) loc_data, (const T_IN*) prior_data, (T_BBOX*) bbox_data);
+        CSC(cudaGetLastError(), STATUS_FAILURE);
+        return STATUS_SUCCESS;
+    }
+};
+
+template <typename T_BBOX, typename T_IN>
 pluginStatus_t decodeBBoxes_gpu(
     cudaStream_t stream,
     const int nthreads,
@@ -229,19 +272,14 @@ pluginStatus_t decodeBBoxes_gpu(
     const int num_loc_classes,
     const int background_label_id,
     const bool clip_bbox,
+    const bool class_major,
     const void* loc_data,
     const void* prior_data,
     void* bbox_data)
 {
-    const int BS = 512;
-    const int GS = (nthreads + BS - 1) / BS;
-    decodeBBoxes_kernel<T_BBOX, BS><<<GS, BS, 0, stream>>>(nthreads, code_type, variance_encoded_in_target,
-                                                           num_priors, share_location, num_loc_classes,
-                                                           background_label_id, clip_bbox,
-                                                           (const T_BBOX*) loc_data, (const T_BBOX*) prior_data,
-                                                           (T_BBOX*) bbox_data);
-    CSC(cudaGetLastError(), STATUS_FAILURE);
-    return STATUS_SUCCESS;
+    const DecodeBBoxesLaunch<T_BBOX, T_IN> launch{stream, nthreads, variance_encoded_in_target, num_priors,
+        share_location, num_loc_classes, background_label_id, clip_bbox, class_major, loc_data, prior_data, bbox_data};
+    return dispatchCodeType(code_type, launch);
 }
 
 // decodeBBoxes LAUNCH CONFIG
@@ -254,6 +292,7 @@ typedef pluginStatus_t (*dbbFunc)(cudaStream_t,
                                const int,
                                const int,
                                const bool,
+                               const bool,
                                const void*,
                                const void*,
                                void*);
@@ -283,7 +322,10 @@ static std::vector<dbbLaunchConfig> dbbFuncVec;
 bool decodeBBoxesInit()
 {
     dbbFuncVec.push_back(dbbLaunchConfig(DataType::kFLOAT,
-                                         decodeBBoxes_gpu<float>));
+                                         decodeBBoxes_gpu<float, float>));
+    // FP16 locations and priors are decoded to FP32 boxes
+    dbbFuncVec.push_back(dbbLaunchConfig(DataType::kHALF,
+                                         decodeBBoxes_gpu<float, __half>));
     return true;
 }
 
@@ -302,7 +344,8 @@ pluginStatus_t decodeBBoxes(
     const DataType DT_BBOX,
     const void* loc_data,
     const void* prior_data,
-    void* bbox_data)
+    void* bbox_data,
+    const bool class_major)
 {
     dbbLaunchConfig lc = dbbLaunchConfig(DT_BBOX);
     for (unsigned i = 0; i < dbbFuncVec.size(); ++i)
@@ -319,6 +362,7 @@ pluginStatus_t decodeBBoxes(
                                           num_loc_classes,
                                           background_label_id,
                                           clip_bbox,
+                                          class_major,
                                           loc_data,
                                           prior_data,
                                           bbox_data);
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_DETECTION_DISPATCH_H
+#define TRT_DETECTION_DISPATCH_H
+
+#include "plugin.h"
+
+/*
+ * Compile-time specialization of the detection kernels, include from .cu files only.
+ *
+ * A kernel templated on an int N reads its runtime argument through staticOr<N>. N is the value of the argument for
+ * the configurations deployed the most, so that the divisions by it become multiplications and the loops it bounds
+ * unroll, or kDynamic, the generic fallback, which uses the runtime value.
+ *
+ * The dispatch functions call f.template run<N>() with the specialization matching a runtime value, kDynamic if none
+ * does. The functors are structs with a member template run, C++11 lambdas cannot be templates.
+ */
+
+const int kDynamic = 0;
+
+template <int N>
+__host__ __device__ __forceinline__ int staticOr(int value)
+{
+    return N == kDynamic ? value : N;
+}
+
+// Classes with the background: COCO, 91 in the TensorFlow models and 81 in the Caffe ones, and VOC
+template <typename F>
+pluginStatus_t dispatchNumClasses(int numClasses, const F& f)
+{
+    switch (numClasses)
+    {
+    case 91: return f.template run<91>();
+    case 81: return f.template run<81>();
+    case 21: return f.template run<21>();
+    default: return f.template run<kDynamic>();
+    }
+}
+
+// Candidates or detections kept per image
+template <typename F>
+pluginStatus_t dispatchTopK(int topK, const F& f)
+{
+    switch (topK)
+    {
+    case 100: return f.template run<100>();
+    case 200: return f.template run<200>();
+    case 400: return f.template run<400>();
+    default: return f.template run<kDynamic>();
+    }
+}
+
+// Every code type is specialized, there is no fallback
+template <typename F>
+pluginStatus_t dispatchCodeType(CodeTypeSSD codeType, const F& f)
+{
+    switch (codeType)
+    {
+    case CodeTypeSSD::CORNER: return f.template run<CodeTypeSSD::CORNER>();
+    case CodeTypeSSD::CENTER_SIZE: return f.template run<CodeTypeSSD::CENTER_SIZE>();
+    case CodeTypeSSD::CORNER_SIZE: return f.template run<CodeTypeSSD::CORNER_SIZE>();
+    case CodeTypeSSD::TF_CENTER: return f.template run<CodeTypeSSD::TF_CENTER>();
+    }
+    return STATUS_BAD_PARAM;
+}
+
+#endif // TRT_DETECTION_DISPATCH_H
@@ -40,7 +40,8 @@ pluginStatus_t detectionInference(
     void* topDetections,
     void* workspace,
     bool isNormalized,
-    bool confSigmoid)
+    bool confSigmoid,
+    bool permuteInputs)
 {
     // Batch size * number bbox per sample * 4 = total number of bounding boxes * 4
     const int locCount = N * C1;
@@ -54,8 +55,24 @@ pluginStatus_t detectionInference(
      */
     const int numLocClasses = shareLocation ? 1 : numClasses;
 
+    /*
+     * The boxes, scores and indices are live until the detections are gathered, see detectionInferenceWorkspaceSize.
+     * The region after them is reused by the buffers with shorter lifetimes.
+     */
     size_t bboxDataSize = detectionForwardBBoxDataSize(N, C1, DataType::kFLOAT);
-    void* bboxDataRaw = workspace;
+    size_t scoresSize = detectionForwardPreNMSSize(N, C2);
+    size_t indicesSize = detectionForwardPreNMSSize(N, C2);
+    void* bboxData = workspace;
+    void* scores = nextWorkspacePtr((int8_t*) bboxData, bboxDataSize);
+    void* indices = nextWorkspacePtr((int8_t*) scores, scoresSize);
+    void* transient = nextWorkspacePtr((int8_t*) indices, indicesSize);
+
+    /*
+     * Boxes that are not shared are decoded into the transient region, then permuted into bboxData, unless the
+     * inputs are read in place: the decoding then writes them class-major into bboxData itself.
+     */
+    const bool permuteBBoxes = !shareLocation && permuteInputs;
+    void* bboxDataRaw = permuteBBoxes ? transient : bboxData;
 
     pluginStatus_t status = decodeBBoxes(stream,
                                       locCount,
@@ -66,10 +83,11 @@ pluginStatus_t detectionInference(
                                       numLocClasses,
                                       backgroundLabelId,
                                       clipBBox,
-                                      DataType::kFLOAT,
+                                      DT_BBOX,
                                       locData,
                                       priorData,
-                                      bboxDataRaw);
+                                      bboxDataRaw,
+                                      !shareLocation && !permuteInputs);
 
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
@@ -78,16 +96,12 @@ pluginStatus_t detectionInference(
      * [batch size, numPriors (per sample), numLocClasses, 4]
      */
     // float for now
-    void* bboxData;
-    size_t bboxPermuteSize = detectionForwardBBoxPermuteSize(shareLocation, N, C1, DataType::kFLOAT);
-    void* bboxPermute = nextWorkspacePtr((int8_t*) bboxDataRaw, bboxDataSize);
-
     /*
      * After permutation, bboxData format:
      * [batch_size, numLocClasses, numPriors (per sample) (numPredsPerClass), 4]
      * This is equivalent to swapping axis
      */
-    if (!shareLocation)
+    if (permuteBBoxes)
     {
         status = permuteData(stream,
                              locCount,
@@ -97,62 +111,76 @@ pluginStatus_t detectionInference(
                              DataType::kFLOAT,
                              false,
                              bboxDataRaw,
-                             bboxPermute);
+                             bboxData);
         ASSERT_FAILURE(status == STATUS_SUCCESS);
-        bboxData = bboxPermute;
     }
     /*
      * If shareLocation, numLocClasses = 1
      * No need to permute data on linear memory
      */
-    else
-    {
-        bboxData = bboxDataRaw;
-    }
     /*
      * Conf data format
      * [batch size, numPriors * param.numClasses, 1, 1]
      */
     const int numScores = N * C2;
-    size_t scoresSize = detectionForwardPreNMSSize(N, C2);
-    void* scores = nextWorkspacePtr((int8_t*) bboxPermute, bboxPermuteSize);
-    // need a conf_scores
-    /*
-     * After permutation, bboxData format:
-     * [batch_size, numClasses, numPredsPerClass, 1]
-     */
-    status = permuteData(stream,
-                         numScores,
-                         numClasses,
-                         numPredsPerClass,
-                         1,
-                         DataType::kFLOAT,
-                         confSigmoid,
-                         confData,
-                         scores);
-    ASSERT_FAILURE(status == STATUS_SUCCESS);
-
-    size_t indicesSize = detectionForwardPreNMSSize(N, C2);
-    void* indices = nextWorkspacePtr((int8_t*) scores, scoresSize);
 
+    // The per-class sort workspace is dead once the NMS starts writing its outputs over it
     size_t postNMSScoresSize = detectionForwardPostNMSSize(N, numClasses, topK);
     size_t postNMSIndicesSize = detectionForwardPostNMSSize(N, numClasses, topK);
-    void* postNMSScores = nextWorkspacePtr((int8_t*) indices, indicesSize);
+    void* sortingWorkspace = transient;
+    void* postNMSScores = transient;
     void* postNMSIndices = nextWorkspacePtr((int8_t*) postNMSScores, postNMSScoresSize);
+    void* nmsWorkspace = nextWorkspacePtr((int8_t*) postNMSIndices, postNMSIndicesSize);
+    if (permuteInputs)
+    {
+        // need a conf_scores
+        /*
+         * After permutation, bboxData format:
+         * [batch_size, numClasses, numPredsPerClass, 1]
+         */
+        status = permuteData(stream,
+                             numScores,
+                             numClasses,
+                             numPredsPerClass,
+                             1,
+                             DT_SCORE,
+                             confSigmoid,
+                             confData,
+                             scores);
+        ASSERT_FAILURE(status == STATUS_SUCCESS);
 
-    //size_t sortingWorkspaceSize = sortScoresPerClassWorkspaceSize(N, numClasses, numPredsPerClass, FLOAT32);
-    void* sortingWorkspace = nextWorkspacePtr((int8_t*) postNMSIndices, postNMSIndicesSize);
-    // Sort the scores so that the following NMS could be applied.
-    status = sortScoresPerClass(stream,
-                                N,
-                                numClasses,
-                                numPredsPerClass,
-                                backgroundLabelId,
-                                confidenceThreshold,
-                                DataType::kFLOAT,
-                                scores,
-                                indices,
-                                sortingWorkspace);
+        // Sort the scores so that the following NMS could be applied, only the candidates above the threshold are
+        // sorted
+        status = sortScoresPerClass(stream,
+                                    N,
+                                    numClasses,
+                                    numPredsPerClass,
+                                    topK,
+                                    backgroundLabelId,
+                                    confidenceThreshold,
+                                    DataType::kFLOAT,
+                                    scores,
+                                    indices,
+                                    sortingWorkspace,
+                                    true);
+    }
+    else
+    {
+        // The same sort, reading the candidates above the threshold from the confidences in place
+        status = sortScoresPerClassPriorMajor(stream,
+                                              N,
+                                              numClasses,
+                                              numPredsPerClass,
+                                              topK,
+                                              backgroundLabelId,
+                                              confidenceThreshold,
+                                              DT_SCORE,
+                                              confSigmoid,
+                                              confData,
+                                              scores,
+                                              indices,
+                                              sortingWorkspace);
+    }
     ASSERT_FAILURE(status == STATUS_SUCCESS);
     
     // NMS
@@ -171,6 +199,7 @@ pluginStatus_t detectionInference(
                          indices,
                          postNMSScores,
                          postNMSIndices,
+                         nmsWorkspace,
                          false);
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
@@ -178,12 +207,13 @@ pluginStatus_t detectionInference(
     status = sortScoresPerImage(stream,
                                 N,
                                 numClasses * topK,
+                                keepTopK,
                                 DataType::kFLOAT,
                                 postNMSScores,
                                 postNMSIndices,
                                 scores,
                                 indices,
-                                sortingWorkspace);
+                                nmsWorkspace);
     ASSERT_FAILURE(status == STATUS_SUCCESS);
 
     // Gather data from the sorted bounding boxes after NMS
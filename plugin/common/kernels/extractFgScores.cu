@@ -24,16 +24,10 @@ pluginStatus_t extractFgScores_gpu(cudaStream_t stream,
                                   const void* scores,
                                   void* fgScores)
 {
-    // Copy all the objectness scores for one batch
+    // Copy the objectness scores of all the images at once, they are the second half of each image's scores
     size_t size = A * H * W * sizeof(T);
-    for (int n = 0; n < N; n++)
-    {
-        // Find out the starting pointer of the objectness scores in the input
-        size_t offset_ld = (n * 2 + 1) * A * H * W;
-        // Find out the starting pointer of the objectness scores in the output
-        size_t offset_st = n * A * H * W;
-        CSC(cudaMemcpyAsync(((T*) fgScores) + offset_st, ((T*) scores) + offset_ld, size, cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
-    }
+    CSC(cudaMemcpy2DAsync(fgScores, size, ((const T*) scores) + A * H * W, 2 * size, size, N,
+            cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
 
     return STATUS_SUCCESS;
 }
@@ -16,22 +16,26 @@
 #include <vector>
 #include "plugin.h"
 #include "kernel.h"
+#include "detectionDispatch.h"
 
-template <typename T_BBOX, typename T_SCORE, unsigned nthds_per_cta>
+// NUM_CLASSES and KEEP_TOP_K, if not kDynamic, are numClasses and keepTopK, see detectionDispatch.h
+template <typename T_BBOX, typename T_SCORE, int NUM_CLASSES, int KEEP_TOP_K, unsigned nthds_per_cta>
 __launch_bounds__(nthds_per_cta)
     __global__ void gatherTopDetections_kernel(
         const bool shareLocation,
         const int numImages,
         const int numPredsPerClass,
-        const int numClasses,
+        const int runtimeNumClasses,
         const int topK,
-        const int keepTopK,
+        const int runtimeKeepTopK,
         const int* indices,
         const T_SCORE* scores,
         const T_BBOX* bboxData,
         int* keepCount,
         T_BBOX* topDetections)
 {
+    const int numClasses = staticOr<NUM_CLASSES>(runtimeNumClasses);
+    const int keepTopK = staticOr<KEEP_TOP_K>(runtimeKeepTopK);
     if (keepTopK > topK)
         return;
     for (int i = blockIdx.x * nthds_per_cta + threadIdx.x;
@@ -84,6 +88,61 @@ __launch_bounds__(nthds_per_cta)
     }
 }
 
+template <typename T_BBOX, typename T_SCORE>
+struct GatherTopDetectionsLaunch
+{
+    cudaStream_t stream;
+    bool shareLocation;
+    int numImages;
+    int numPredsPerClass;
+    int numClasses;
+    int topK;
+    int keepTopK;
+    const void* indices;
+    const void* scores;
+    const void* bboxData;
+    void* keepCount;
+    void* topDetections;
+
+    template <int NUM_CLASSES, int KEEP_TOP_K>
+    pluginStatus_t launch() const
+    {
+        const int BS = 32;
+        const int GS = 32;
+        gatherTopDetections_kernel<T_BBOX, T_SCORE, NUM_CLASSES, KEEP_TOP_K, BS><<<GS, BS, 0, stream>>>(
+            shareLocation, numImages, numPredsPerClass, numClasses, topK, keepTopK, (const int*) indices,
+            (const T_SCORE*) scores, (const T_BBOX*) bboxData, (int*) keepCount, (T_BBOX*) topDetections);
+        CSC(cudaGetLastError(), STATUS_FAILURE);
+        return STATUS_SUCCESS;
+    }
+};
+
+// Specialization of keepTopK once the one of numClasses is chosen
+template <typename T_BBOX, typename T_SCORE, int NUM_CLASSES>
+struct GatherTopDetectionsKeepTopK
+{
+    const GatherTopDetectionsLaunch<T_BBOX, T_SCORE>& args;
+
+    template <int KEEP_TOP_K>
+    pluginStatus_t run() const
+    {
+        return args.template launch<NUM_CLASSES, KEEP_TOP_K>();
+    }
+};
+
+template <typename T_BBOX, typename T_SCORE>
+struct GatherTopDetectionsNumClasses
+{
+    const GatherTopDetectionsLaunch<T_BBOX, T_SCORE>& args;
+
+    template <int NUM_CLASSES>
+    pluginStatus_t run() const
+    {
+        const GatherTopDetectionsKeepTopK<T_BBOX, T_SCORE, NUM_CLASSES> keepTopK{args};
+        return dispatchTopK(args.keepTopK, keepTopK);
+    }
+};
+
 template <typename T_BBOX, typename T_SCORE>
 pluginStatus_t gatherTopDetections_gpu(
     cudaStream_t stream,
@@ -100,15 +159,10 @@ pluginStatus_t gatherTopDetections_gpu(
     void* topDetections)
 {
     cudaMemsetAsync(keepCount, 0, numImages * sizeof(int), stream);
-    const int BS = 32;
-    const int GS = 32;
-    gatherTopDetections_kernel<T_BBOX, T_SCORE, BS><<<GS, BS, 0, stream>>>(shareLocation, numImages, numPredsPerClass,
-                                                                           numClasses, topK, keepTopK,
-                                                                           (int*) indices, (T_SCORE*) scores, (T_BBOX*) bboxData,
-                                                                           (int*) keepCount, (T_BBOX*) topDetections);
-
-    CSC(cudaGetLastError(), STATUS_FAILURE);
-    return STATUS_SUCCESS;
+    const GatherTopDetectionsLaunch<T_BBOX, T_SCORE> args{stream, shareLocation, numImages, numPredsPerClass,
+        numClasses, topK, keepTopK, indices, scores, bboxData, keepCount, topDetections};
+    const GatherTopDetectionsNumClasses<T_BBOX, T_SCORE> classes{args};
+    return dispatchNumClasses(numClasses, classes);
 }
 
 // gatherTopDetections LAUNCH CONFIG 
@@ -17,16 +17,22 @@
 #include "plugin.h"
 
 size_t detectionInferenceWorkspaceSize(bool shareLocation, int N, int C1, int C2, int numClasses, int numPredsPerClass,
-    int topK, DataType DT_BBOX, DataType DT_SCORE)
+    int topK, DataType DT_BBOX, DataType DT_SCORE, bool compactScores)
 {
-    size_t wss[7];
+    size_t wss[4];
+    // Live until the detections are gathered: the boxes, permuted when not shared, and the scores with their indices
     wss[0] = detectionForwardBBoxDataSize(N, C1, DT_BBOX);
-    wss[1] = detectionForwardBBoxPermuteSize(shareLocation, N, C1, DT_BBOX);
+    wss[1] = detectionForwardPreNMSSize(N, C2);
     wss[2] = detectionForwardPreNMSSize(N, C2);
-    wss[3] = detectionForwardPreNMSSize(N, C2);
-    wss[4] = detectionForwardPostNMSSize(N, numClasses, topK);
-    wss[5] = detectionForwardPostNMSSize(N, numClasses, topK);
-    wss[6] = std::max(sortScoresPerClassWorkspaceSize(N, numClasses, numPredsPerClass, DT_SCORE),
-        sortScoresPerImageWorkspaceSize(N, numClasses * topK, DT_SCORE));
-    return calculateTotalWorkspaceSize(wss, 7);
+    // The buffers with shorter lifetimes share the last region: the boxes before their permutation, then the per-class
+    // sort workspace, then the NMS outputs followed by the workspace of the NMS and of the per-image sort
+    size_t postNMS[3];
+    postNMS[0] = detectionForwardPostNMSSize(N, numClasses, topK);
+    postNMS[1] = detectionForwardPostNMSSize(N, numClasses, topK);
+    postNMS[2] = std::max(sortScoresPerImageWorkspaceSize(N, numClasses * topK, DT_SCORE),
+        bitmaskNMSWorkspaceSize(N * numClasses, std::min(topK, numPredsPerClass)));
+    wss[3] = std::max(detectionForwardBBoxPermuteSize(shareLocation, N, C1, DT_BBOX),
+        sortScoresPerClassWorkspaceSize(N, numClasses, numPredsPerClass, DT_SCORE, compactScores));
+    wss[3] = std::max(wss[3], calculateTotalWorkspaceSize(postNMS, 3));
+    return calculateTotalWorkspaceSize(wss, 4);
 }
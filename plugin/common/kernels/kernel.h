@@ -28,21 +28,20 @@ using namespace nvinfer1::plugin;
 typedef enum
 {
     NCHW = 0,
-    NC4HW = 1
+    NC4HW = 1,
+    NHWC8 = 2 // Channels innermost, padded to a multiple of 8, as TensorFormat::kHWC8
 } DLayout_t;
 
 pluginStatus_t allClassNMS(cudaStream_t stream, int num, int num_classes, int num_preds_per_class, int top_k,
     float nms_threshold, bool share_location, bool isNormalized, DataType DT_SCORE, DataType DT_BBOX, void* bbox_data,
     void* beforeNMS_scores, void* beforeNMS_index_array, void* afterNMS_scores, void* afterNMS_index_array,
-    bool flipXY = false);
+    void* workspace, bool flipXY = false);
 
 pluginStatus_t detectionInference(cudaStream_t stream, int N, int C1, int C2, bool shareLocation,
     bool varianceEncodedInTarget, int backgroundLabelId, int numPredsPerClass, int numClasses, int topK, int keepTopK,
     float confidenceThreshold, float nmsThreshold, CodeTypeSSD codeType, DataType DT_BBOX, const void* locData,
     const void* priorData, DataType DT_SCORE, const void* confData, void* keepCount, void* topDetections,
-    void* workspace, bool isNormalized = true, bool confSigmoid = false
-
-);
+    void* workspace, bool isNormalized = true, bool confSigmoid = false, bool permuteInputs = true);
 
 pluginStatus_t gatherTopDetections(cudaStream_t stream, bool shareLocation, int numImages, int numPredsPerClass,
     int numClasses, int topK, int keepTopK, DataType DT_BBOX, DataType DT_SCORE, const void* indices,
@@ -52,17 +51,31 @@ size_t detectionForwardBBoxDataSize(int N, int C1, DataType DT_BBOX);
 
 size_t detectionForwardBBoxPermuteSize(bool shareLocation, int N, int C1, DataType DT_BBOX);
 
-size_t sortScoresPerClassWorkspaceSize(int num, int num_classes, int num_preds_per_class, DataType DT_CONF);
+// compact: only sort the candidates above the confidence threshold, see sortScoresPerClass
+size_t sortScoresPerClassWorkspaceSize(
+    int num, int num_classes, int num_preds_per_class, DataType DT_CONF, bool compact = false);
 
 size_t sortScoresPerImageWorkspaceSize(int num_images, int num_items_per_image, DataType DT_SCORE);
 
-pluginStatus_t sortScoresPerImage(cudaStream_t stream, int num_images, int num_items_per_image, DataType DT_SCORE,
-    void* unsorted_scores, void* unsorted_bbox_indices, void* sorted_scores, void* sorted_bbox_indices,
-    void* workspace);
+// Only the top_k first scores of each image are sorted, in segmentedTopK.h, the rest of the outputs is undefined. A
+// top_k of 0 or less sorts them all.
+pluginStatus_t sortScoresPerImage(cudaStream_t stream, int num_images, int num_items_per_image, int top_k,
+    DataType DT_SCORE, void* unsorted_scores, void* unsorted_bbox_indices, void* sorted_scores,
+    void* sorted_bbox_indices, void* workspace);
 
-pluginStatus_t sortScoresPerClass(cudaStream_t stream, int num, int num_classes, int num_preds_per_class,
+// With compact, the candidates above confidence_threshold are first compacted at the front of their segment and only
+// those are sorted, which is much cheaper when most candidates are below the threshold. As for sortScoresPerImage,
+// only the top_k first candidates of each class are sorted.
+pluginStatus_t sortScoresPerClass(cudaStream_t stream, int num, int num_classes, int num_preds_per_class, int top_k,
     int background_label_id, float confidence_threshold, DataType DT_SCORE, void* conf_scores_gpu,
-    void* index_array_gpu, void* workspace);
+    void* index_array_gpu, void* workspace, bool compact = false);
+
+// Compacting sortScoresPerClass reading the scores in the [num, num_preds_per_class, num_classes] layout of the
+// confidence head, instead of a class-major copy. The scores are converted to FP32, passed through a sigmoid if
+// conf_sigmoid, and sorted class-major into conf_scores_gpu. The workspace is the one of the compacting FP32 sort.
+pluginStatus_t sortScoresPerClassPriorMajor(cudaStream_t stream, int num, int num_classes, int num_preds_per_class,
+    int top_k, int background_label_id, float confidence_threshold, DataType DT_CONF, bool conf_sigmoid,
+    const void* conf_data, void* conf_scores_gpu, void* index_array_gpu, void* workspace);
 
 size_t calculateTotalWorkspaceSize(size_t* workspaces, int count);
 
@@ -77,24 +90,26 @@ size_t detectionForwardPostNMSSize(int N, int numClasses, int topK);
 
 pluginStatus_t decodeBBoxes(cudaStream_t stream, int nthreads, CodeTypeSSD code_type, bool variance_encoded_in_target,
     int num_priors, bool share_location, int num_loc_classes, int background_label_id, bool clip_bbox, DataType DT_BBOX,
-    const void* loc_data, const void* prior_data, void* bbox_data);
+    const void* loc_data, const void* prior_data, void* bbox_data, bool class_major = false);
 
 size_t normalizePluginWorkspaceSize(bool acrossSpatial, int C, int H, int W);
 
+// FP16 and the NHWC8 layout, the kHWC8 format of TensorRT, are only supported with !acrossSpatial. The scale is FP32.
 pluginStatus_t normalizeInference(cudaStream_t stream, cublasHandle_t handle, bool acrossSpatial, bool channelShared,
-    int N, int C, int H, int W, float eps, const void* scale, const void* inputData, void* outputData, void* workspace);
+    int N, int C, int H, int W, float eps, const void* scale, const void* inputData, void* outputData, void* workspace,
+    DataType DT_DATA = DataType::kFLOAT, DLayout_t layout = NCHW);
 
 pluginStatus_t priorBoxInference(cudaStream_t stream, PriorBoxParameters param, int H, int W, int numPriors,
     int numAspectRatios, const void* minSize, const void* maxSize, const void* aspectRatios, void* outputData);
 
-pluginStatus_t reorgInference(
-    cudaStream_t stream, int batch, int C, int H, int W, int stride, const void* input, void* output);
+pluginStatus_t reorgInference(cudaStream_t stream, int batch, int C, int H, int W, int stride, DataType type,
+    const void* input, void* output);
 
 pluginStatus_t anchorGridInference(cudaStream_t stream, GridAnchorParameters param, int numAspectRatios,
     const void* aspectRatios, const void* scales, void* outputData);
 
 pluginStatus_t regionInference(cudaStream_t stream, int batch, int C, int H, int W, int num, int coords, int classes,
-    bool hasSoftmaxTree, const nvinfer1::plugin::softmaxTree* smTree, const void* input, void* output);
+    bool hasSoftmaxTree, const nvinfer1::plugin::softmaxTree* smTree, DataType type, const void* input, void* output);
 
 // GENERATE ANCHORS
 // For now it takes host pointers - ratios and scales but
@@ -144,16 +159,22 @@ pluginStatus_t nms(cudaStream_t stream,
     DataType tRois,        // type of ROIs
     void* rois);           // ROIs
 
+// Workspace of nms for N images of R proposals
+size_t nmsWorkspaceSize(int N, int R, int preNmsTop);
+
+// Bitmask NMS of numSegments segments of up to maxCount candidates, see bitmaskNMS.h
+size_t bitmaskNMSWorkspaceSize(int numSegments, int maxCount);
+
 // WORKSPACE SIZES
-size_t proposalsForwardNMSWorkspaceSize(int N, int A, int H, int W, int nmsMaxOut);
+size_t proposalsForwardNMSWorkspaceSize(int N, int A, int H, int W, int preNmsTop, int nmsMaxOut);
 
 size_t proposalsForwardBboxWorkspaceSize(int N, int A, int H, int W);
 
 size_t proposalForwardFgScoresWorkspaceSize(int N, int A, int H, int W);
 
-size_t proposalsInferenceWorkspaceSize(int N, int A, int H, int W, int nmsMaxOut);
+size_t proposalsInferenceWorkspaceSize(int N, int A, int H, int W, int preNmsTop, int nmsMaxOut);
 
-size_t RPROIInferenceFusedWorkspaceSize(int N, int A, int H, int W, int nmsMaxOut);
+size_t RPROIInferenceFusedWorkspaceSize(int N, int A, int H, int W, int preNmsTop, int nmsMaxOut);
 
 // PROPOSALS INFERENCE
 pluginStatus_t proposalsInference(cudaStream_t stream, int N, int A, int H, int W, int featureStride, int preNmsTop,
@@ -200,14 +221,19 @@ pluginStatus_t RPROIInferenceFused(cudaStream_t stream, int N, int A, int C, int
 pluginStatus_t generateAnchors_cpu(
     int numRatios, float* ratios, int numScales, float* scales, int baseSize, float* anchors);
 
+// Bilinear crops of an FP32 or FP16 linear, FP16 kHWC8 or kCHW16, or INT8 kCHW32 image. The output has the type and
+// format of the image, the INT8 scales are only used for kINT8.
 int cropAndResizeInference(cudaStream_t stream, int n, const void* image, const void* rois, int batch_size,
-    int input_height, int input_width, int num_boxes, int crop_height, int crop_width, int depth, void* output);
+    int input_height, int input_width, int num_boxes, int crop_height, int crop_width, int depth, DataType dtype,
+    TensorFormat format, float inputScale, float outputScale, void* output);
 
+// ANCHOR_SIZES and ANCHOR_RATIOS are device pointers
 int proposalInference_gpu(cudaStream_t stream, const void* rpn_prob, const void* rpn_regr, int batch_size,
     int input_height, int input_width, int rpn_height, int rpn_width, int MAX_BOX_NUM, int RPN_PRE_NMS_TOP_N,
     float* ANCHOR_SIZES, int anc_size_num, float* ANCHOR_RATIOS, int anc_ratio_num, float rpn_std_scaling,
     int rpn_stride, float bbox_min_size, float nms_iou_threshold, void* workspace, void* output);
 
-size_t _get_workspace_size(int N, int anc_size_num, int anc_ratio_num, int H, int W, int nmsMaxOut);
+size_t _get_workspace_size(
+    int N, int anc_size_num, int anc_ratio_num, int H, int W, int preNmsTop, int nmsMaxOut);
 
 #endif
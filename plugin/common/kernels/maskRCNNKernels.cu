@@ -19,12 +19,18 @@
 #include <cuda_fp16.h>
 #include <cuda_runtime.h>
 
+#include "bitmaskNMS.h"
 #include "maskRCNNKernels.h"
 #include "plugin.h"
+#include "segmentedTopK.h"
 #include <NvInfer.h>
+#include <algorithm>
 #include <assert.h>
+#include <climits>
+#include <cmath>
 #include <cub/cub.cuh>
 #include <iostream>
+#include <limits>
 #include <stdio.h>
 #include <thrust/device_ptr.h>
 #include <thrust/fill.h>
@@ -43,6 +49,53 @@ struct BBoxT
     BoxType y1, x1, y2, x2;
 };
 
+// Moves an anchor or a ROI by its deltas (dy, dx, log(dh), log(dw)), scaled by the standard deviations of the box
+// refinement, and clips it to the normalized image
+__device__ __forceinline__ BBoxT<float> applyBoxDelta(
+    const BBoxT<float>& anchor, float dy, float dx, float logdh, float logdw)
+{
+    float h = anchor.y2 - anchor.y1;
+    float w = anchor.x2 - anchor.x1;
+    const float cy = (anchor.y1 + anchor.y2) / 2 + dy * 0.1f * h;
+    const float cx = (anchor.x1 + anchor.x2) / 2 + dx * 0.1f * w;
+    h *= expf(logdh * 0.2f);
+    w *= expf(logdw * 0.2f);
+
+    BBoxT<float> box;
+    box.y1 = cy - 0.5f * h;
+    box.x1 = cx - 0.5f * w;
+    box.y2 = box.y1 + h;
+    box.x2 = box.x1 + w;
+
+    // clip bbox: a more precision clip method based on real window could be implemented
+    box.y1 = dMAX(dMIN(box.y1, 1.0f), 0.0f);
+    box.x1 = dMAX(dMIN(box.x1, 1.0f), 0.0f);
+    box.y2 = dMAX(dMIN(box.y2, 1.0f), 0.0f);
+    box.x2 = dMAX(dMIN(box.x2, 1.0f), 0.0f);
+    return box;
+}
+
+// anchors : float [N, samples, 4], read with a batch stride of anchorStride, 0 when the images share the anchors
+// delta : T [N, samples, 4]
+// outputBbox : float [N, samples, 4], may be the deltas when T is float
+template <typename T>
+__global__ void apply_delta_kernel(
+    int samples, int anchorStride, const void* anchors, const void* delta, void* outputBbox)
+{
+    const BBoxT<float>* anchors_in = static_cast<const BBoxT<float>*>(anchors);
+    const T* delta_in = static_cast<const T*>(delta);
+    BBoxT<float>* bbox_out = static_cast<BBoxT<float>*>(outputBbox);
+
+    int blockOffset = blockIdx.x * samples;
+    int anchorOffset = blockIdx.x * anchorStride;
+    for (int cur_id = threadIdx.x; cur_id < samples; cur_id += blockDim.x)
+    {
+        const T* cur_delta = delta_in + (blockOffset + cur_id) * 4;
+        bbox_out[blockOffset + cur_id] = applyBoxDelta(anchors_in[anchorOffset + cur_id], (float) cur_delta[0],
+            (float) cur_delta[1], (float) cur_delta[2], (float) cur_delta[3]);
+    }
+}
+
 template <typename DType>
 __global__ void argMaxReset_kernel(
     int samples, int NClass, const DType* in_scores, const int* maxIdx, DType* out_scores)
@@ -60,23 +113,6 @@ __global__ void argMaxReset_kernel(
         out_scores[idx] = in_scores[idx];
 }
 
-template <typename DType>
-struct ScanItem
-{
-    DType data;
-    int idx;
-};
-
-template <typename DType>
-struct GreaterItem
-{
-    __host__ __device__ __forceinline__ ScanItem<DType> operator()(
-        const ScanItem<DType>& a, const ScanItem<DType>& b) const
-    {
-        return (a.data > b.data ? a : b);
-    }
-};
-
 template <typename DType>
 __global__ void resetMemValue_kernel(void* outPtr, int samples, float val)
 {
@@ -88,70 +124,64 @@ __global__ void resetMemValue_kernel(void* outPtr, int samples, float val)
     }
 }
 
-// blockDim.x : NClass
-// GroupDim.x : sample count
-// GroupDim.y : batch N
-// outScore : DType[ N * sample * 1 ]
-// outLabel : int[ N * sample * 1 ]
-// outBbox : int[ N * sample * 4 ]
-template <typename DType, typename BoxType, int Threads = 32>
-__global__ void argMaxGroup_kernel(int samples, int NClass, const void* inScorePtr, const void* inBboxPtr,
-    const void* validSampleCountPtr, void* outScorePtr, void* outLabelPtr, void* outBboxPtr)
+// Fused refinement of the detections: one warp per sample picks the best class, moves the ROI by the deltas of that
+// class and clips it. The samples whose best class is the background or whose score is under the threshold get the
+// label -1, their box is not decoded.
+// gridDim.x : samples / warps per block
+// gridDim.y : batch N
+// inScore : T [N, samples, NClass]
+// inDelta : T [N, samples, NClass * 4]
+// inROI : T [N, samples, 4]
+// outScore, outLabel : float [N, samples]
+// outBbox : float [N, samples, 4]
+template <typename T, int Threads>
+__global__ void __launch_bounds__(Threads) refineDetection_kernel(int samples, int NClass, int background,
+    float scoreThreshold, const int* validSampleCount, const T* inScore, const T* inDelta, const T* inROI,
+    float* outScore, float* outLabel, BBoxT<float>* outBbox)
 {
-    const DType* inScore = static_cast<const DType*>(inScorePtr);
-    const BoxType* inBbox = static_cast<const BoxType*>(inBboxPtr);
-    const int* validSampleCount = static_cast<const int*>(validSampleCountPtr);
-    DType* outScore = static_cast<DType*>(outScorePtr);
-    BoxType* outLabel = static_cast<BoxType*>(outLabelPtr);
-    BoxType* outBbox = static_cast<BoxType*>(outBboxPtr);
-
     const int N = blockIdx.y;
-    const int validSamples = validSampleCount[N];
-
-    typedef ScanItem<DType> ScanItemD;
-    typedef cub::BlockReduce<ScanItemD, Threads> BlockReduce;
-
-    __shared__ typename BlockReduce::TempStorage temp_storage;
+    const int lane = threadIdx.x % 32;
+    const int iSample = blockIdx.x * (Threads / 32) + threadIdx.x / 32;
+    // Uniform across the warp
+    if (iSample >= validSampleCount[N])
+        return;
 
-    for (int iSample = blockIdx.x; iSample < validSamples; iSample += gridDim.x)
+    const int offset = N * samples + iSample;
+    float maxScore = 0.0f;
+    int maxIdx = -1;
+    for (int c = lane; c < NClass; c += 32)
     {
-        int classOffset = (N * samples + iSample) * NClass; // start from [batch, count, class0]
-        // total IPerThread * blockDim
-        ScanItemD maxItem = {0.0f, -1};
-        for (int i = 0; i < NClass; i += Threads)
+        const float score = (float) inScore[offset * NClass + c];
+        if (score > maxScore)
         {
-            int curIdx = i + threadIdx.x;
-            ScanItemD item = {0.0f, -1};
-            if (curIdx < NClass)
-            {
-                item.data = inScore[classOffset + curIdx];
-                item.idx = curIdx;
-            }
-            const int validNum = (NClass - i > Threads ? Threads : NClass - i);
-            ScanItemD aggregate = BlockReduce(temp_storage).Reduce(item, GreaterItem<DType>(), validNum);
-            __syncthreads();
-            if (aggregate.data > maxItem.data)
-            {
-                maxItem = aggregate;
-            }
-#if DUBUG_KERNEL
-            if (N == DUBUG_BATCH && threadIdx.x == 0 && iSample < 15 /*&& maxItem.idx >= 32*/)
-            {
-                printf("argMaxGroup N:%d, iSample:%d, maxItem(score:%.3f, idx:%d)validReduceNum:%d\n", N, iSample,
-                    (float) maxItem.data, maxItem.idx, validNum);
-            }
-#endif
+            maxScore = score;
+            maxIdx = c;
+        }
+    }
+    // The lowest class wins the ties, -1 loses to any class
+    for (int delta = 16; delta > 0; delta /= 2)
+    {
+        const float score = __shfl_xor_sync(0xffffffff, maxScore, delta);
+        const int idx = __shfl_xor_sync(0xffffffff, maxIdx, delta);
+        if (score > maxScore || (score == maxScore && (unsigned) idx < (unsigned) maxIdx))
+        {
+            maxScore = score;
+            maxIdx = idx;
         }
+    }
 
-        const int dstOffset = N * samples + iSample;
-        if (threadIdx.x == 0)
+    if (lane == 0)
+    {
+        const bool valid = maxIdx >= 0 && maxIdx != background && maxScore >= scoreThreshold;
+        outScore[offset] = maxScore;
+        outLabel[offset] = valid ? (float) maxIdx : -1.0f;
+        if (valid)
         {
-            outScore[dstOffset] = maxItem.data;
-            outLabel[dstOffset] = (BoxType) maxItem.idx;
-            outBbox[dstOffset * 4] = inBbox[(classOffset + maxItem.idx) * 4];
-            outBbox[dstOffset * 4 + 1] = inBbox[(classOffset + maxItem.idx) * 4 + 1];
-            outBbox[dstOffset * 4 + 2] = inBbox[(classOffset + maxItem.idx) * 4 + 2];
-            outBbox[dstOffset * 4 + 3] = inBbox[(classOffset + maxItem.idx) * 4 + 3];
+            const T* roi = inROI + offset * 4;
+            const T* delta = inDelta + (offset * NClass + maxIdx) * 4;
+            const BBoxT<float> anchor = {(float) roi[0], (float) roi[1], (float) roi[2], (float) roi[3]};
+            outBbox[offset]
+                = applyBoxDelta(anchor, (float) delta[0], (float) delta[1], (float) delta[2], (float) delta[3]);
         }
     }
 }
@@ -333,190 +363,49 @@ __global__ void sortPerClass_kernel(
     }
 }
 
-template <typename DType>
-__device__ __forceinline__ BBoxT<DType> readBbox(const BBoxT<DType>* inBbox, int idx)
-{
-    BBoxT<DType> ret = ((BBoxT<DType>*) (inBbox))[idx];
-    return ret;
-}
-
-template <typename DType>
-__device__ __forceinline__ DType boxIoU(const BBoxT<DType>& a, const BBoxT<DType>& b)
-{
-    BBoxT<DType> overlap = {
-        dMAX(a.y1, b.y1), dMAX(a.x1, b.x1), dMIN(a.y2, b.y2), dMIN(a.x2, b.x2),
-    };
-    DType oW = overlap.x2 - overlap.x1;
-    DType oH = overlap.y2 - overlap.y1;
-    if (oW < (DType) 0 || oH < (DType) 0)
-        return (DType) 0;
-    DType oA = oW * oH;
-    return (oA / ((a.y2 - a.y1) * (a.x2 - a.x1) + (b.y2 - b.y1) * (b.x2 - b.x1) - oA));
-}
-
 // PerClassNMS
-// gridDim.x : batch-N
-// blockDim.x : Threads
-// ItemsPerThreads : = divUp(samples, Threads)
-// outFlagSamples OUT: int [N * samples]
-template <typename DType, typename BoxType, int Threads = 256, int ItemsPerThreads = 4>
-__global__ void PerClassNMS_kernel(
-    // int N,
-    int samples, int NClass, const float nmsThreshold, const void* validSampleCountPtr,
-    // const void *inScorePtr,
-    const void* inLabelPtr, const void* inBboxPtr, const void* inBboxRefIdxPtr, const void* classStartsPtr,
-    void* outFlagSamplesPtr)
+// One segment per image, the valid samples are sorted by class and by score within a class, and only suppress the
+// samples of their class.
+template <typename BoxType>
+struct PerClassNMSSegments
 {
-    typedef BBoxT<BoxType> BBox;
-    __shared__ struct
-    {
-        BBox refBox[MaxClassNum];
-        int endIdx[MaxClassNum];
-        int refIdx[MaxClassNum + 1];
-        bool markSamples[Threads * ItemsPerThreads];
-        int done;
-    } smemClasses;
-    assert(NClass + 1 < MaxClassNum);
-    assert(samples <= Threads * ItemsPerThreads);
-
-    const int* validSampleCount = static_cast<const int*>(validSampleCountPtr);
-    // const DType *inScore = static_cast<const DType *>(inScorePtr);
-    const BoxType* inLabel = static_cast<const BoxType*>(inLabelPtr);
-    const BBox* inBbox = static_cast<const BBox*>(inBboxPtr);
-    const int* inBboxRefIdx = static_cast<const int*>(inBboxRefIdxPtr);
-    const int* classStarts = static_cast<const int*>(classStartsPtr);
-    int* outFlagSamples = static_cast<int*>(outFlagSamplesPtr);
+    int samples;
+    const int* validSampleCount;
+    const BoxType* inLabel;
+    const BBoxT<BoxType>* inBbox;
+    const int* inBboxRefIdx;
 
-    int N = blockIdx.x;
-    int blockOffset = N * samples;
-    int validSamples = validSampleCount[N];
-
-    if (threadIdx.x == 0)
-    {
-        smemClasses.done = 0;
-    }
-
-    BBox curBox[ItemsPerThreads];
-    int label[ItemsPerThreads];
-#pragma unroll
-    for (int ite = 0; ite * blockDim.x < validSamples; ++ite)
+    __device__ int count(int segment) const
     {
-        int curIdx = ite * blockDim.x + threadIdx.x;
-        if (curIdx < validSamples)
-        {
-            label[ite] = (int) inLabel[blockOffset + curIdx];
-            curBox[ite] = readBbox(inBbox, blockOffset + inBboxRefIdx[blockOffset + curIdx]);
-        }
-        else
-        {
-            label[ite] = -1;
-        }
-        smemClasses.markSamples[curIdx] = (label[ite] < 0 ? false : true);
+        return validSampleCount[segment];
     }
 
-    int classBlockOffset = N * (NClass + 1);
-    for (int i = threadIdx.x; i < NClass + 1; i += blockDim.x)
+    __device__ int load(int segment, int i, NMSBox& box) const
     {
-        int refIdx = classStarts[classBlockOffset + i];
-        smemClasses.refIdx[i] = refIdx;
-        smemClasses.refBox[i] = readBbox(inBbox, blockOffset + inBboxRefIdx[blockOffset + refIdx]);
+        const int blockOffset = segment * samples;
+        box = decodeNMSBox<NMSBoxEncoding::kCornerYX>(&inBbox[blockOffset + inBboxRefIdx[blockOffset + i]].y1);
+        return (int) inLabel[blockOffset + i];
     }
-    __syncthreads();
+};
 
-    for (int i = threadIdx.x; i < NClass; i += blockDim.x)
-    {
-        int endIdx = smemClasses.refIdx[i + 1];
-        smemClasses.endIdx[i] = endIdx;
-        if (endIdx == smemClasses.refIdx[i])
-        {
-            atomicAdd(&smemClasses.done, 1);
-        }
-    }
-    __syncthreads();
+// outFlagSamples OUT: int [N * samples], only the valid samples are written
+struct PerClassNMSFlags
+{
+    int samples;
+    int* outFlagSamples;
 
-#if DUBUG_KERNEL
-    // print info
-    if (N == DUBUG_BATCH && threadIdx.x == 0)
+    __device__ void keep(int segment, int i, int /*rank*/) const
     {
-        printf("batch:%d, before starting NMS, done count:%d\n", N, smemClasses.done);
-        printf("batch:%d, Total num:%d, startPos:\n", N, validSamples);
-        for (int k = 0; k < NClass; ++k)
-        {
-            if (smemClasses.refIdx[k] != smemClasses.endIdx[k])
-            {
-                printf("Batch:%d, label:%d [%d : %d], check ref-label:%d\n", N, k, smemClasses.refIdx[k],
-                    smemClasses.endIdx[k], (int) inLabel[blockOffset + smemClasses.refIdx[k]]);
-            }
-        }
-        printf("\n");
+        outFlagSamples[segment * samples + i] = 1;
     }
-    __syncthreads();
-#endif
 
-    // class done to check stop point
-    while (smemClasses.done < NClass)
+    __device__ void discard(int segment, int i) const
     {
-
-        for (int ite = 0; ite * blockDim.x < validSamples; ++ite)
-        {
-            int curIdx = ite * blockDim.x + threadIdx.x;
-            int refIdx = -1;
-            int endIdx = -1;
-            if (curIdx < validSamples && smemClasses.markSamples[curIdx])
-            {
-                if (label[ite] >= 0)
-                {
-                    refIdx = smemClasses.refIdx[label[ite]];
-                    endIdx = smemClasses.endIdx[label[ite]];
-                    if (curIdx > refIdx && curIdx < endIdx)
-                    {
-                        BBox refBox = smemClasses.refBox[label[ite]];
-                        if (boxIoU(refBox, curBox[ite]) >= (DType) nmsThreshold)
-                        {
-                            smemClasses.markSamples[curIdx] = false;
-                        }
-                    }
-                }
-            }
-        }
-        __syncthreads();
-
-        // push refIdx/refBox forward to next mark
-        // only the refIdx thread to push itself. other threads idle
-        for (int i = threadIdx.x; i < NClass; i += blockDim.x)
-        {
-            int refIdx = smemClasses.refIdx[i];
-            int endIdx = smemClasses.endIdx[i];
-            if (refIdx < endIdx)
-            {
-                do
-                {
-                    ++refIdx;
-                } while (refIdx < endIdx && smemClasses.markSamples[refIdx] == false);
-                smemClasses.refIdx[i] = refIdx;
-                if (refIdx < endIdx)
-                {
-                    smemClasses.refBox[i] = readBbox(inBbox, blockOffset + inBboxRefIdx[blockOffset + refIdx]);
-                }
-                else
-                {
-                    atomicAdd(&smemClasses.done, 1);
-                }
-            }
-        }
-        __syncthreads();
+        outFlagSamples[segment * samples + i] = 0;
     }
 
-    // no need to write all data out
-    for (int segment = 0; segment < validSamples; segment += blockDim.x)
-    {
-        int curIdx = segment + threadIdx.x;
-        if (curIdx < validSamples)
-        {
-            outFlagSamples[blockOffset + curIdx] = (smemClasses.markSamples[curIdx] ? 1 : 0);
-        }
-    }
-}
+    __device__ void finish(int /*segment*/, int /*kept*/, int /*lane*/) const {}
+};
 
 // TopKGather
 // gridDim.x : batch-N
@@ -524,7 +413,8 @@ __global__ void PerClassNMS_kernel(
 // ItemsPerThreads : = divUp(samples, Threads)
 // outDetectionCount : int [N], must be set 0 before kernel
 #define MaxItemsPerThreads 8
-template <typename DType, typename BoxType, int Threads = 256>
+// outBbox : OutType [N, keepTopK, 4]
+template <typename DType, typename BoxType, int Threads = 256, typename OutType = BoxType>
 __global__ void TopKGatherProposal_kernel(int samples, int keepTopK, const void* validSampleCountPtr,
     const void* inScorePtr, const void* inLabelPtr, const void* inBboxPtr, const void* inBboxRefIdxPtr,
     const void* inFlagSamplesPtr, void* outBboxPtr)
@@ -556,7 +446,7 @@ __global__ void TopKGatherProposal_kernel(int samples, int keepTopK, const void*
     const BBox* inBbox = static_cast<const BBox*>(inBboxPtr);
     const int* inBboxRefIdx = static_cast<const int*>(inBboxRefIdxPtr);
     const int* inFlagSamples = static_cast<const int*>(inFlagSamplesPtr);
-    BBox* outBbox = static_cast<BBox*>(outBboxPtr);
+    BBoxT<OutType>* outBbox = static_cast<BBoxT<OutType>*>(outBboxPtr);
 
     int N = blockIdx.x;
     int blockOffset = N * samples;
@@ -625,13 +515,15 @@ __global__ void TopKGatherProposal_kernel(int samples, int keepTopK, const void*
             {
                 oB = ((BBox*) inBbox)[blockOffset + inBboxRefIdx[blockOffset + idx[i]]];
             }
-            ((BBox*) outBbox)[outBlockOffset + curI] = oB;
+            const BBoxT<OutType> oBOut = {(OutType) oB.y1, (OutType) oB.x1, (OutType) oB.y2, (OutType) oB.x2};
+            outBbox[outBlockOffset + curI] = oBOut;
         }
     }
 }
 
 #define MaxItemsPerThreads 8
-template <typename DType, typename BoxType, int Threads = 256>
+// outDetectionPtr : OutType [N, keepTopK, 6]
+template <typename DType, typename BoxType, int Threads = 256, typename OutType = DType>
 __global__ void TopKGather_kernel(int samples, int keepTopK, const void* validSampleCountPtr, const void* inScorePtr,
     const void* inLabelPtr, const void* inBboxPtr, const void* inBboxRefIdxPtr, const void* inFlagSamplesPtr,
     void* outDetectionPtr)
@@ -664,7 +556,7 @@ __global__ void TopKGather_kernel(int samples, int keepTopK, const void* validSa
     const BBox* inBbox = static_cast<const BBox*>(inBboxPtr);
     const int* inBboxRefIdx = static_cast<const int*>(inBboxRefIdxPtr);
     const int* inFlagSamples = static_cast<const int*>(inFlagSamplesPtr);
-    DType* outDetections = static_cast<DType*>(outDetectionPtr);
+    OutType* outDetections = static_cast<OutType*>(outDetectionPtr);
 
     int N = blockIdx.x;
     int blockOffset = N * samples;
@@ -737,12 +629,12 @@ __global__ void TopKGather_kernel(int samples, int keepTopK, const void* validSa
                 oS = score[i];
                 oL = (BoxType) inLabel[blockOffset + idx[i]];
             }
-            outDetections[(outBlockOffset + curI) * 6] = oB.y1;
-            outDetections[(outBlockOffset + curI) * 6 + 1] = oB.x1;
-            outDetections[(outBlockOffset + curI) * 6 + 2] = oB.y2;
-            outDetections[(outBlockOffset + curI) * 6 + 3] = oB.x2;
-            outDetections[(outBlockOffset + curI) * 6 + 4] = oL;
-            outDetections[(outBlockOffset + curI) * 6 + 5] = oS;
+            outDetections[(outBlockOffset + curI) * 6] = (OutType) oB.y1;
+            outDetections[(outBlockOffset + curI) * 6 + 1] = (OutType) oB.x1;
+            outDetections[(outBlockOffset + curI) * 6 + 2] = (OutType) oB.y2;
+            outDetections[(outBlockOffset + curI) * 6 + 3] = (OutType) oB.x2;
+            outDetections[(outBlockOffset + curI) * 6 + 4] = (OutType) oL;
+            outDetections[(outBlockOffset + curI) * 6 + 5] = (OutType) oS;
         }
     }
 }
@@ -799,6 +691,10 @@ RefineDetectionWorkSpace::RefineDetectionWorkSpace(
     // sortNMSMark : [N, samples] : kINT32
     sumSize += AlignMem(dimVolume(sortNMSMarkDims) * typeSize(nvinfer1::DataType::kINT32) * batchSize);
 
+    nmsMaskOffset = sumSize;
+    // nmsMask : [N, samples, samples / 64] : uint64_t
+    sumSize += AlignMem(bitmaskNMSWorkspaceSize(batchSize, sampleCount));
+
     totalSize = sumSize;
 }
 
@@ -820,10 +716,19 @@ ProposalWorkSpace::ProposalWorkSpace(const int batchSize, const int inputCnt, co
 
     const nvinfer1::DataType type = nvinfer1::DataType::kFLOAT;
 
+    // The score sort is done before the NMS starts, the nmsMask reuses its temp storage
+    size_t sortStorageBytes = 0;
+    cub::DeviceSegmentedRadixSort::SortPairsDescending(NULL, sortStorageBytes, (const float*) NULL, (float*) NULL,
+        (const BBoxT<float>*) NULL, (BBoxT<float>*) NULL, batchSize * inputCnt, batchSize, (const int*) NULL,
+        (const int*) NULL);
+
     // resource
-    // temp storage size for sorting scores
+    // tempStorage : offsets [N + 1] : kINT32, then the temp storage for sorting scores
+    // nmsMask : [N, samples, samples / 64] : uint64_t
     tempStorageOffset = sumSize;
-    sumSize += (1 << 23) * batchSize;
+    nmsMaskOffset = sumSize;
+    sumSize += AlignMem(std::max((batchSize + 1) * sizeof(int) + sortStorageBytes,
+        bitmaskNMSWorkspaceSize(batchSize, sampleCount)));
 
     // preRefineScore : [N, inputcnt, 1] // extracted foreground score from inputs[0]
     preRefineScoreOffset = sumSize;
@@ -837,6 +742,10 @@ ProposalWorkSpace::ProposalWorkSpace(const int batchSize, const int inputCnt, co
     preRefineBboxOffset = sumSize;
     sumSize += AlignMem(dimVolume(preRefineBboxDims) * typeSize(type) * batchSize);
 
+    // decodedBbox: [N, inputcnt, 4] // anchors moved by the deltas, the bbox to sort
+    decodedBboxOffset = sumSize;
+    sumSize += AlignMem(dimVolume(preRefineBboxDims) * typeSize(type) * batchSize);
+
     // arMaxScore : [N, samples] : m_Type
     argMaxScoreOffset = sumSize;
     sumSize += AlignMem(dimVolume(argMaxScoreDims) * typeSize(type) * batchSize);
@@ -873,26 +782,25 @@ ProposalWorkSpace::ProposalWorkSpace(const int batchSize, const int inputCnt, co
     // sortNMSMark : [N, samples] : kINT32
     sumSize += AlignMem(dimVolume(sortNMSMarkDims) * typeSize(nvinfer1::DataType::kINT32) * batchSize);
 
+    validCountOffset = sumSize;
+    // validCount : [N] : kINT32, samples for every image
+    sumSize += AlignMem(typeSize(nvinfer1::DataType::kINT32) * batchSize);
+
     totalSize = sumSize;
 }
 
-template <int Threads>
-cudaError_t argMaxGroup(cudaStream_t stream, int N, nvinfer1::DataType dtype, int samples, int NClass,
-    const void* inScore, const void* inBbox, const void* validSamples, void* outScore, void* outLabel, void* outBbox)
+template <typename T>
+cudaError_t refineDetection(cudaStream_t stream, int N, int samples, int NClass, int background, float scoreThreshold,
+    const void* validSampleCount, const void* inScore, const void* inDelta, const void* inROI, void* outScore,
+    void* outLabel, void* outBbox)
 {
-    int maxGridX = dMIN(samples, 512 / N);
-    dim3 gridDim = {(unsigned int) nAlignDown(maxGridX, 32), (unsigned int) N, 1};
-    dim3 threads = {Threads, 1, 1};
-    switch (dtype)
-    {
-    case nvinfer1::DataType::kFLOAT:
-        argMaxGroup_kernel<float, float, Threads><<<gridDim, threads, 0, stream>>>(
-            samples, NClass, inScore, inBbox, validSamples, outScore, outLabel, outBbox);
-        break;
-    case nvinfer1::DataType::kHALF: break;
-    default: assert(false);
-    }
-
+    const int Threads = 256;
+    const int warps = Threads / 32;
+    dim3 gridDim = {(unsigned int) ((samples + warps - 1) / warps), (unsigned int) N, 1};
+    refineDetection_kernel<T, Threads><<<gridDim, Threads, 0, stream>>>(samples, NClass, background, scoreThreshold,
+        static_cast<const int*>(validSampleCount), static_cast<const T*>(inScore), static_cast<const T*>(inDelta),
+        static_cast<const T*>(inROI), static_cast<float*>(outScore), static_cast<float*>(outLabel),
+        static_cast<BBoxT<float>*>(outBbox));
     return cudaGetLastError();
 }
 
@@ -919,53 +827,71 @@ cudaError_t sortPerClass(cudaStream_t stream, int N, nvinfer1::DataType dtype, i
     return cudaGetLastError();
 };
 
-template <int Threads>
 cudaError_t PerClassNMS(cudaStream_t stream, int N, nvinfer1::DataType dtype, int samples, int NClass,
     const float nmsThreshold, const void* validSampleCount,
     // const void *inScore,
-    const void* inLabel, const void* inBbox, const void* inBboxRefIdx, const void* classStarts, void* outFlagSamples)
+    const void* inLabel, const void* inBbox, const void* inBboxRefIdx, void* nmsMask, void* outFlagSamples)
 {
-    int blocks = N;
-    int threads = Threads;
+    // The samples overlapping a kept sample by nmsThreshold or more are suppressed
+    const float iouThreshold = std::nextafter(nmsThreshold, -std::numeric_limits<float>::infinity());
+    PerClassNMSFlags output;
+    output.samples = samples;
+    output.outFlagSamples = static_cast<int*>(outFlagSamples);
 
+    pluginStatus_t status = STATUS_SUCCESS;
     switch (dtype)
     {
     case nvinfer1::DataType::kFLOAT:
-        PerClassNMS_kernel<float, float, Threads><<<blocks, threads, 0, stream>>>(samples, NClass, nmsThreshold,
-            validSampleCount, inLabel, inBbox, inBboxRefIdx, classStarts, outFlagSamples);
+    {
+        PerClassNMSSegments<float> segments;
+        segments.samples = samples;
+        segments.validSampleCount = static_cast<const int*>(validSampleCount);
+        segments.inLabel = static_cast<const float*>(inLabel);
+        segments.inBbox = static_cast<const BBoxT<float>*>(inBbox);
+        segments.inBboxRefIdx = static_cast<const int*>(inBboxRefIdx);
+        status = bitmaskNMS<true>(stream, N, samples, iouThreshold, INT_MAX, segments, output, nmsMask);
         break;
+    }
     case nvinfer1::DataType::kHALF: break;
     default: assert(false);
     }
 
-    return cudaGetLastError();
+    return status == STATUS_SUCCESS ? cudaGetLastError() : cudaErrorLaunchFailure;
 }
 
+template <int Threads, typename OutType>
+void KeepTopKGatherLaunch(cudaStream_t stream, int N, int samples, int keepTopK, const void* validSampleCountPtr,
+    const void* inScorePtr, const void* inLabelPtr, const void* inBboxPtr, const void* inBboxRefIdxPtr,
+    const void* inFlagSamplesPtr, void* outDetections, int proposal)
+{
+    if (proposal)
+    {
+        TopKGatherProposal_kernel<float, float, Threads, OutType><<<N, Threads, 0, stream>>>(samples, keepTopK,
+            validSampleCountPtr, inScorePtr, inLabelPtr, inBboxPtr, inBboxRefIdxPtr, inFlagSamplesPtr, outDetections);
+    }
+    else
+    {
+        TopKGather_kernel<float, float, Threads, OutType><<<N, Threads, 0, stream>>>(samples, keepTopK,
+            validSampleCountPtr, inScorePtr, inLabelPtr, inBboxPtr, inBboxRefIdxPtr, inFlagSamplesPtr, outDetections);
+    }
+}
+
+// The samples are FP32, the gathered detections or proposals are of type outType
 template <int Threads>
-cudaError_t KeepTopKGather(cudaStream_t stream, int N, nvinfer1::DataType dtype, int samples, int keepTopK,
+cudaError_t KeepTopKGather(cudaStream_t stream, int N, nvinfer1::DataType outType, int samples, int keepTopK,
     const void* validSampleCountPtr, const void* inScorePtr, const void* inLabelPtr, const void* inBboxPtr,
     const void* inBboxRefIdxPtr, const void* inFlagSamplesPtr, void* outDetections, int proposal)
 {
-    int blocks = N;
-    int threads = Threads;
-
-    switch (dtype)
+    switch (outType)
     {
     case nvinfer1::DataType::kFLOAT:
-        if (proposal)
-        {
-            TopKGatherProposal_kernel<float, float, Threads><<<blocks, threads, 0, stream>>>(samples, keepTopK,
-                validSampleCountPtr, inScorePtr, inLabelPtr, inBboxPtr, inBboxRefIdxPtr, inFlagSamplesPtr,
-                outDetections);
-        }
-        else
-        {
-            TopKGather_kernel<float, float, Threads><<<blocks, threads, 0, stream>>>(samples, keepTopK,
-                validSampleCountPtr, inScorePtr, inLabelPtr, inBboxPtr, inBboxRefIdxPtr, inFlagSamplesPtr,
-                outDetections);
-        }
+        KeepTopKGatherLaunch<Threads, float>(stream, N, samples, keepTopK, validSampleCountPtr, inScorePtr,
+            inLabelPtr, inBboxPtr, inBboxRefIdxPtr, inFlagSamplesPtr, outDetections, proposal);
+        break;
+    case nvinfer1::DataType::kHALF:
+        KeepTopKGatherLaunch<Threads, __half>(stream, N, samples, keepTopK, validSampleCountPtr, inScorePtr,
+            inLabelPtr, inBboxPtr, inBboxRefIdxPtr, inFlagSamplesPtr, outDetections, proposal);
         break;
-    case nvinfer1::DataType::kHALF: break;
     default: assert(false);
     }
 
@@ -988,57 +914,44 @@ cudaError_t RefineBatchClassNMS(cudaStream_t stream, int N, int samples, nvinfer
     void* sortClassValidCountPtr = wsPtr + refineOffset.sortClassValidCountOffset;
     void* sortClassPosPtr = wsPtr + refineOffset.sortClassPosOffset;
     void* sortNMSMarkPtr = wsPtr + refineOffset.sortNMSMarkOffset;
+    void* nmsMaskPtr = wsPtr + refineOffset.nmsMaskOffset;
 
     cudaError_t status = cudaSuccess;
     CUASSERT(cudaMemsetAsync(sortClassValidCountPtr, 0, N * sizeof(int), stream));
 
-    if (NClass > 1)
-    { // multiple classes
-        status = argMaxGroup<32>(stream, N, dtype, samples, NClass, inScores, inDelta, inCountValid, argMaxScorePtr,
-            argMaxLabelPtr, argMaxBBoxPtr); // argMaxBBoxPtr means delta of bboxes
-        assert(status == cudaSuccess);
-        CUASSERT(status);
-    }
-    else
-    { // Only one class
-        argMaxScorePtr = const_cast<void*>(inScores);
-        argMaxBBoxPtr = const_cast<void*>(inDelta);
-        int threads = 512;
-        int blocks = (N * samples + threads - 1) / threads;
-        blocks = dMIN(blocks, 8);
-        switch (dtype)
-        {
-        case nvinfer1::DataType::kFLOAT:
-        {
-            resetMemValue_kernel<float><<<blocks, threads, 0, stream>>>(argMaxLabelPtr, N * samples, 0);
-            break;
-        }
-        case nvinfer1::DataType::kHALF: { break;
-        }
-        default: assert(false);
-        }
+    // The inputs are of type dtype, the samples are refined into FP32 and stay so until the detections are gathered
+    switch (dtype)
+    {
+    case nvinfer1::DataType::kFLOAT:
+        status = refineDetection<float>(stream, N, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
+            inCountValid, inScores, inDelta, inROI, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr);
+        break;
+    case nvinfer1::DataType::kHALF:
+        status = refineDetection<__half>(stream, N, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
+            inCountValid, inScores, inDelta, inROI, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr);
+        break;
+    default: assert(false);
     }
-
-    status = ApplyDelta2Bboxes(stream, N, samples, inROI, argMaxBBoxPtr, argMaxBBoxPtr);
     assert(status == cudaSuccess);
+    CUASSERT(status);
 
     if (samples <= 1024)
     {
-        status = sortPerClass<256, 4>(stream, N, dtype, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
-            inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr, sortClassScorePtr,
-            sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
+        status = sortPerClass<256, 4>(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.backgroundLabelId,
+            param.scoreThreshold, inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr,
+            sortClassScorePtr, sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
     }
     else if (samples <= 2048)
     {
-        status = sortPerClass<256, 8>(stream, N, dtype, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
-            inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr, sortClassScorePtr,
-            sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
+        status = sortPerClass<256, 8>(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.backgroundLabelId,
+            param.scoreThreshold, inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr,
+            sortClassScorePtr, sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
     }
     else if (samples <= 4096)
     {
-        status = sortPerClass<256, 16>(stream, N, dtype, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
-            inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr, sortClassScorePtr,
-            sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
+        status = sortPerClass<256, 16>(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.backgroundLabelId,
+            param.scoreThreshold, inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr,
+            sortClassScorePtr, sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
     }
     else
     {
@@ -1048,9 +961,10 @@ cudaError_t RefineBatchClassNMS(cudaStream_t stream, int N, int samples, nvinfer
     assert(status == cudaSuccess);
     CUASSERT(status);
 
-    status = PerClassNMS<256>(stream, N, dtype, samples, NClass, param.iouThreshold, sortClassValidCountPtr,
+    status = PerClassNMS(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.iouThreshold,
+        sortClassValidCountPtr,
         // sortClassScorePtr,
-        sortClassLabelPtr, argMaxBBoxPtr, sortClassSampleIdxPtr, sortClassPosPtr, sortNMSMarkPtr);
+        sortClassLabelPtr, argMaxBBoxPtr, sortClassSampleIdxPtr, nmsMaskPtr, sortNMSMarkPtr);
     assert(status == cudaSuccess);
     CUASSERT(status);
 
@@ -1061,25 +975,18 @@ cudaError_t RefineBatchClassNMS(cudaStream_t stream, int N, int samples, nvinfer
     return status;
 }
 
-struct BF_SCORE
-{
-    float bg, fg;
-};
-// in_scores : [N, samples, 2]
-// output_score : [N, samples, 1]
+// in_scores : T [N, samples, 2] background and foreground scores
+// output_score : float [N, samples, 1]
+template <typename T>
 __global__ void extract_fg_kernel(int samples, const void* in_scores, void* output_score)
 {
-    const BF_SCORE* in = static_cast<const BF_SCORE*>(in_scores);
+    const T* in = static_cast<const T*>(in_scores);
     float* out = static_cast<float*>(output_score);
 
-    int N = blockIdx.x;
-    int blockOffset = N * samples;
-    int totalItems = (samples + (blockDim.x - 1)) / blockDim.x;
-
-    for (int i = 0; i < totalItems; i++)
+    int blockOffset = blockIdx.x * samples;
+    for (int cur_id = threadIdx.x; cur_id < samples; cur_id += blockDim.x)
     {
-        int cur_id = i * blockDim.x + threadIdx.x;
-        out[blockOffset + cur_id] = in[blockOffset + cur_id].fg;
+        out[blockOffset + cur_id] = (float) in[(blockOffset + cur_id) * 2 + 1];
     }
 }
 __global__ void set_offset_kernel(int stride, int size, int* output)
@@ -1115,9 +1022,8 @@ __global__ void resample_kernel(int orig_size, int sample_size, const void* orig
 cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt, int samples, nvinfer1::DataType dtype,
     const RefineNMSParameters& param, const ProposalWorkSpace& proposalOffset, void* workspace,
     const void* inScores, //[N, inputcnt, 2]
-    const void* inDelta,  //[N, inputcnt, 4]
-    const void* inCountValid,
-    const void* inAnchors, //[N, inputcnt, 4]
+    const void* inDelta,   //[N, inputcnt, 4]
+    const void* inAnchors, //[inputcnt, 4], the same for every image
     void* outProposals)
 {
     int8_t* wsPtr = static_cast<int8_t*>(workspace);
@@ -1125,6 +1031,7 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt
     void* preRefineScorePtr = wsPtr + proposalOffset.preRefineScoreOffset;
     void* preRefineSortedScorePtr = wsPtr + proposalOffset.preRefineSortedScoreOffset;
     void* preRefineBboxPtr = wsPtr + proposalOffset.preRefineBboxOffset;
+    void* decodedBboxPtr = wsPtr + proposalOffset.decodedBboxOffset;
 
     void* argMaxScorePtr = wsPtr + proposalOffset.argMaxScoreOffset;
     void* argMaxLabelPtr = wsPtr + proposalOffset.argMaxLabelOffset;
@@ -1136,22 +1043,36 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt
     void* sortClassValidCountPtr = wsPtr + proposalOffset.sortClassValidCountOffset;
     void* sortClassPosPtr = wsPtr + proposalOffset.sortClassPosOffset;
     void* sortNMSMarkPtr = wsPtr + proposalOffset.sortNMSMarkOffset;
+    void* nmsMaskPtr = wsPtr + proposalOffset.nmsMaskOffset;
+    void* inCountValid = wsPtr + proposalOffset.validCountOffset;
 
     cudaError_t status = cudaSuccess;
     CUASSERT(cudaMemsetAsync(sortClassValidCountPtr, 0, N * sizeof(int), stream));
+    // All the samples of every image are valid
+    resetMemValue_kernel<int><<<1, dMIN(N, 1024), 0, stream>>>(inCountValid, N, samples);
 
-    // extract foreground score
-    extract_fg_kernel<<<N, dMIN(inputCnt, 1024), 0, stream>>>(inputCnt, inScores, preRefineScorePtr);
+    // Extract the foreground scores and move the anchors by inDelta, both into FP32 from the inputs of type dtype. The
+    // inputs are left untouched.
+    switch (dtype)
+    {
+    case nvinfer1::DataType::kFLOAT:
+        extract_fg_kernel<float><<<N, dMIN(inputCnt, 1024), 0, stream>>>(inputCnt, inScores, preRefineScorePtr);
+        apply_delta_kernel<float><<<N, dMIN(inputCnt, 1024), 0, stream>>>(
+            inputCnt, 0, inAnchors, inDelta, decodedBboxPtr);
+        break;
+    case nvinfer1::DataType::kHALF:
+        extract_fg_kernel<__half><<<N, dMIN(inputCnt, 1024), 0, stream>>>(inputCnt, inScores, preRefineScorePtr);
+        apply_delta_kernel<__half><<<N, dMIN(inputCnt, 1024), 0, stream>>>(
+            inputCnt, 0, inAnchors, inDelta, decodedBboxPtr);
+        break;
+    default: assert(false);
+    }
     CUASSERT(cudaGetLastError());
 
-    // Here, inDelta are converted to normalize coordinates based on anchors
-    status = ApplyDelta2Bboxes(stream, N, inputCnt, inAnchors, inDelta, const_cast<void*>(inDelta));
-    CUASSERT(status);
-
     // sort the score
     // d_key_in: preRefineScorePtr [N, inputCnt, 1]
     // d_key_out: preRefineSortedScorePtr
-    // d_values_in: inDelta [N, inputCnt, 4]
+    // d_values_in: decodedBboxPtr [N, inputCnt, 4]
     // d_values_out: preRefineBboxPtr
     // num_items: inputCnt*N
     // num_segments: N
@@ -1163,14 +1084,20 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt
 
     size_t temp_storage_bytes = 0;
     cub::DeviceSegmentedRadixSort::SortPairsDescending(NULL, temp_storage_bytes, (float*) preRefineScorePtr,
-        (float*) preRefineSortedScorePtr, (BBoxT<float>*) inDelta, (BBoxT<float>*) preRefineBboxPtr, N * inputCnt, N,
-        offsets, offsets + 1, 0, 8 * sizeof(float), stream);
+        (float*) preRefineSortedScorePtr, (BBoxT<float>*) decodedBboxPtr, (BBoxT<float>*) preRefineBboxPtr,
+        N * inputCnt, N, offsets, offsets + 1, 0, 8 * sizeof(float), stream);
 
-    assert((1 << 23) * N > temp_storage_bytes);
+    assert(proposalOffset.preRefineScoreOffset - proposalOffset.tempStorageOffset
+        >= (N + 1) * sizeof(int) + temp_storage_bytes);
 
-    cub::DeviceSegmentedRadixSort::SortPairsDescending(tempStoragePtr, temp_storage_bytes, (float*) preRefineScorePtr,
-        (float*) preRefineSortedScorePtr, (BBoxT<float>*) inDelta, (BBoxT<float>*) preRefineBboxPtr, N * inputCnt, N,
-        offsets, offsets + 1, 0, 8 * sizeof(float), stream);
+    // Only the first samples are resampled, their selection is cheaper than the sort of the inputCnt anchors
+    if (segmentedTopK(stream, N * inputCnt, N, samples, (const float*) preRefineScorePtr,
+            (float*) preRefineSortedScorePtr, (const BBoxT<float>*) decodedBboxPtr, (BBoxT<float>*) preRefineBboxPtr,
+            offsets, offsets + 1, tempStoragePtr, temp_storage_bytes)
+        != STATUS_SUCCESS)
+    {
+        return cudaErrorLaunchFailure;
+    }
 
     int NClass = param.numClasses;
     assert(NClass == 1);
@@ -1185,36 +1112,26 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt
         int threads = 512;
         int blocks = (N * samples + threads - 1) / threads;
         blocks = dMIN(blocks, 8);
-        switch (dtype)
-        {
-        case nvinfer1::DataType::kFLOAT:
-        {
-            resetMemValue_kernel<float><<<blocks, threads, 0, stream>>>(argMaxLabelPtr, N * samples, 0);
-            break;
-        }
-        case nvinfer1::DataType::kHALF: { break;
-        }
-        default: assert(false);
-        }
+        resetMemValue_kernel<float><<<blocks, threads, 0, stream>>>(argMaxLabelPtr, N * samples, 0);
     }
 
     if (samples <= 1024)
     {
-        status = sortPerClass<256, 4>(stream, N, dtype, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
-            inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr, sortClassScorePtr,
-            sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
+        status = sortPerClass<256, 4>(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.backgroundLabelId,
+            param.scoreThreshold, inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr,
+            sortClassScorePtr, sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
     }
     else if (samples <= 2048)
     {
-        status = sortPerClass<256, 8>(stream, N, dtype, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
-            inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr, sortClassScorePtr,
-            sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
+        status = sortPerClass<256, 8>(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.backgroundLabelId,
+            param.scoreThreshold, inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr,
+            sortClassScorePtr, sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
     }
     else if (samples <= 4096)
     {
-        status = sortPerClass<256, 16>(stream, N, dtype, samples, NClass, param.backgroundLabelId, param.scoreThreshold,
-            inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr, sortClassScorePtr,
-            sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
+        status = sortPerClass<256, 16>(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.backgroundLabelId,
+            param.scoreThreshold, inCountValid, argMaxScorePtr, argMaxLabelPtr, argMaxBBoxPtr, sortClassPosPtr,
+            sortClassScorePtr, sortClassLabelPtr, sortClassSampleIdxPtr, sortClassValidCountPtr);
     }
     else
     {
@@ -1224,9 +1141,10 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt
     assert(status == cudaSuccess);
     CUASSERT(status);
 
-    status = PerClassNMS<256>(stream, N, dtype, samples, NClass, param.iouThreshold, sortClassValidCountPtr,
+    status = PerClassNMS(stream, N, nvinfer1::DataType::kFLOAT, samples, NClass, param.iouThreshold,
+        sortClassValidCountPtr,
         // sortClassScorePtr,
-        sortClassLabelPtr, argMaxBBoxPtr, sortClassSampleIdxPtr, sortClassPosPtr, sortNMSMarkPtr);
+        sortClassLabelPtr, argMaxBBoxPtr, sortClassSampleIdxPtr, nmsMaskPtr, sortNMSMarkPtr);
     assert(status == cudaSuccess);
     CUASSERT(status);
 
@@ -1238,73 +1156,6 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N, int inputCnt
     return status;
 }
 
-struct BBOX
-{
-    float y1, x1, y2, x2;
-};
-
-struct DELTA
-{
-    float dy, dx, logdh, logdw;
-};
-
-__global__ void apply_delta_kernel(int samples, const void* anchors, const void* delta, void* outputBbox)
-{
-
-    const BBOX* anchors_in = static_cast<const BBOX*>(anchors);
-    const DELTA* delta_in = static_cast<const DELTA*>(delta);
-    BBOX* bbox_out = static_cast<BBOX*>(outputBbox);
-
-    int N = blockIdx.x;
-    int blockOffset = N * samples;
-    int totalItems = (samples + (blockDim.x - 1)) / blockDim.x;
-
-    for (int i = 0; i < totalItems; i++)
-    {
-        int cur_id = i * blockDim.x + threadIdx.x;
-
-        BBOX cur_anchor_yxyx = anchors_in[blockOffset + cur_id];
-        // convert yxyx -> cyxhw
-        // cy, cx, h, w
-        BBOX cur_anchor_cyxhw;
-
-        cur_anchor_cyxhw.y1 = (cur_anchor_yxyx.y1 + cur_anchor_yxyx.y2) / 2;
-        cur_anchor_cyxhw.x1 = (cur_anchor_yxyx.x1 + cur_anchor_yxyx.x2) / 2;
-        cur_anchor_cyxhw.y2 = (cur_anchor_yxyx.y2 - cur_anchor_yxyx.y1);
-        cur_anchor_cyxhw.x2 = (cur_anchor_yxyx.x2 - cur_anchor_yxyx.x1);
-
-        DELTA cur_delta = delta_in[blockOffset + cur_id];
-
-        // multiply std_dev
-        cur_delta.dy *= 0.1;
-        cur_delta.dx *= 0.1;
-        cur_delta.logdh *= 0.2;
-        cur_delta.logdw *= 0.2;
-
-        // apply delta
-        cur_anchor_cyxhw.y1 += cur_delta.dy * cur_anchor_cyxhw.y2;
-        cur_anchor_cyxhw.x1 += cur_delta.dx * cur_anchor_cyxhw.x2;
-        cur_anchor_cyxhw.y2 *= expf(cur_delta.logdh);
-        cur_anchor_cyxhw.x2 *= expf(cur_delta.logdw);
-
-        cur_anchor_yxyx.y1 = cur_anchor_cyxhw.y1 - 0.5 * cur_anchor_cyxhw.y2;
-        cur_anchor_yxyx.x1 = cur_anchor_cyxhw.x1 - 0.5 * cur_anchor_cyxhw.x2;
-        cur_anchor_yxyx.y2 = cur_anchor_yxyx.y1 + cur_anchor_cyxhw.y2;
-        cur_anchor_yxyx.x2 = cur_anchor_yxyx.x1 + cur_anchor_cyxhw.x2;
-
-        // clip bbox: a more precision clip method based on real window could be implemented
-        cur_anchor_yxyx.y1 = dMAX(dMIN(cur_anchor_yxyx.y1, 1.0), 0.0);
-        cur_anchor_yxyx.x1 = dMAX(dMIN(cur_anchor_yxyx.x1, 1.0), 0.0);
-        cur_anchor_yxyx.y2 = dMAX(dMIN(cur_anchor_yxyx.y2, 1.0), 0.0);
-        cur_anchor_yxyx.x2 = dMAX(dMIN(cur_anchor_yxyx.x2, 1.0), 0.0);
-
-        bbox_out[blockOffset + cur_id].y1 = cur_anchor_yxyx.y1;
-        bbox_out[blockOffset + cur_id].x1 = cur_anchor_yxyx.x1;
-        bbox_out[blockOffset + cur_id].y2 = cur_anchor_yxyx.y2;
-        bbox_out[blockOffset + cur_id].x2 = cur_anchor_yxyx.x2;
-    }
-}
-
 cudaError_t ApplyDelta2Bboxes(cudaStream_t stream, int N,
     int samples,         // number of anchors per image
     const void* anchors, // [N, anchors, (y1, x1, y2, x2)]
@@ -1324,7 +1175,7 @@ cudaError_t ApplyDelta2Bboxes(cudaStream_t stream, int N,
     //  w = exp(dw)*anchor_w
     // clip the bbox
 
-    apply_delta_kernel<<<blocks, threads, 0, stream>>>(samples, anchors, delta, outputBbox);
+    apply_delta_kernel<float><<<blocks, threads, 0, stream>>>(samples, samples, anchors, delta, outputBbox);
 
     return cudaGetLastError();
 }
@@ -1469,6 +1320,147 @@ cudaError_t roiAlign(cudaStream_t stream, int batchSize, int featureCount, int r
     return cudaGetLastError();
 }
 
+struct PyramidLevels
+{
+    const void* data[4];
+    xy_t dims[4];
+};
+
+// One block per image, each valid ROI is appended to the list of its pyramid level. The order inside a list does not matter since every ROI keeps its own output slot.
+template <typename Trois>
+__global__ void roiAlignBucket_kernel(int roiCount, float firstThreshold, const Trois* rois, int* levelRois,
+    int* levelCounts)
+{
+    __shared__ int counts[4];
+    const int batch = blockIdx.x;
+    if (threadIdx.x < 4)
+    {
+        counts[threadIdx.x] = 0;
+    }
+    __syncthreads();
+
+    for (int roiIdx = threadIdx.x; roiIdx < roiCount; roiIdx += blockDim.x)
+    {
+        const Trois* roi = rois + 4 * (batch * roiCount + roiIdx);
+        const float y1 = roi[0];
+        const float x1 = roi[1];
+        const float y2 = roi[2];
+        const float x2 = roi[3];
+
+        if (!(0 <= y1 && y1 <= 1 && 0 <= x1 && x1 <= 1 && 0 <= y2 && y2 <= 1 && 0 <= x2 && x2 <= 1 && y1 < y2
+                && x1 < x2))
+        {
+            continue;
+        }
+
+        const float hw = (y2 - y1) * (x2 - x1);
+        float threshold = firstThreshold;
+        int level = 0;
+        for (; level < 3 && hw > threshold; ++level)
+        {
+            threshold *= 4;
+        }
+        const int slot = atomicAdd(&counts[level], 1);
+        levelRois[(batch * 4 + level) * roiCount + slot] = roiIdx;
+    }
+    __syncthreads();
+
+    if (threadIdx.x < 4)
+    {
+        levelCounts[batch * 4 + threadIdx.x] = counts[threadIdx.x];
+    }
+}
+
+// Grid of (roiCount, batch, level), every block pools one ROI of one level over all the features
+template <typename Trois, typename Tfeat>
+__global__ void roiAlignLevel_kernel(int featureCount, int roiCount, const Trois* rois, PyramidLevels levels,
+    const int* levelRois, const int* levelCounts, Tfeat* pooled, const xy_t poolDims)
+{
+    const int batch = blockIdx.y;
+    const int level = blockIdx.z;
+    if (blockIdx.x >= levelCounts[batch * 4 + level])
+    {
+        return;
+    }
+    const int roiIdx = levelRois[(batch * 4 + level) * roiCount + blockIdx.x];
+
+    const Trois* roi = rois + 4 * (batch * roiCount + roiIdx);
+    const float y1 = roi[0];
+    const float x1 = roi[1];
+    const float y2 = roi[2];
+    const float x2 = roi[3];
+
+    const xy_t srcDims = levels.dims[level];
+    const Tfeat* src = static_cast<const Tfeat*>(levels.data[level])
+        + srcDims.x * srcDims.y * batch * featureCount;
+    Tfeat* dst = pooled + poolDims.x * poolDims.y * (batch * roiCount + roiIdx) * featureCount;
+
+    const float yStart = y1 * (srcDims.y - 1);
+    const float xStart = x1 * (srcDims.x - 1);
+
+    const float yEnd = y2 * (srcDims.y - 1);
+    const float xEnd = x2 * (srcDims.x - 1);
+
+    const float yDelta = (yEnd - yStart) / (poolDims.y - 1);
+    const float xDelta = (xEnd - xStart) / (poolDims.x - 1);
+
+    const int poolSize = poolDims.x * poolDims.y;
+    for (int i = threadIdx.x; i < featureCount * poolSize; i += blockDim.x)
+    {
+        const int feature = i / poolSize;
+        const int yy = (i % poolSize) / poolDims.x;
+        const int xx = i % poolDims.x;
+
+        const float ySample = min(yStart + yDelta * yy, yEnd);
+        const float xSample = min(xStart + xDelta * xx, xEnd);
+
+        dst[i] = interpolateBilinear(src + srcDims.x * srcDims.y * feature, srcDims, ySample, xSample);
+    }
+}
+
+size_t roiAlignBucketedWorkspaceSize(int batchSize, int roiCount)
+{
+    // ROI indices and ROI count of every level of every image
+    return sizeof(int) * batchSize * 4 * (roiCount + 1);
+}
+
+template <typename T>
+cudaError_t roiAlignBucketedLaunch(cudaStream_t stream, int batchSize, int featureCount, int roiCount,
+    float firstThreshold, const void* rois, const void* const layers[], const xy_t* layerDims, void* pooled,
+    const xy_t poolDims, void* workspace)
+{
+    int* levelRois = static_cast<int*>(workspace);
+    int* levelCounts = levelRois + batchSize * 4 * roiCount;
+
+    PyramidLevels levels;
+    for (int level = 0; level < 4; ++level)
+    {
+        levels.data[level] = layers[level];
+        levels.dims[level] = layerDims[level];
+    }
+
+    roiAlignBucket_kernel<<<batchSize, 1024, 0, stream>>>(
+        roiCount, firstThreshold, static_cast<const T*>(rois), levelRois, levelCounts);
+
+    const dim3 blocks(roiCount, batchSize, 4);
+    roiAlignLevel_kernel<<<blocks, 256, 0, stream>>>(featureCount, roiCount, static_cast<const T*>(rois), levels,
+        levelRois, levelCounts, static_cast<T*>(pooled), poolDims);
+    return cudaGetLastError();
+}
+
+cudaError_t roiAlignBucketed(cudaStream_t stream, int batchSize, int featureCount, int roiCount, float firstThreshold,
+    DataType dtype, const void* rois, const void* const layers[], const xy_t* layerDims, void* pooled,
+    const xy_t poolDims, void* workspace)
+{
+    if (dtype == DataType::kHALF)
+    {
+        return roiAlignBucketedLaunch<__half>(stream, batchSize, featureCount, roiCount, firstThreshold, rois,
+            layers, layerDims, pooled, poolDims, workspace);
+    }
+    return roiAlignBucketedLaunch<float>(stream, batchSize, featureCount, roiCount, firstThreshold, rois, layers,
+        layerDims, pooled, poolDims, workspace);
+}
+
 __global__ void resize_nearest_kernel_2d(int nbatch, float scale, int2 osize, float const* idata, int istride,
     int ibatchstride, float* odata, int ostride, int obatchstride)
 {
@@ -1498,40 +1490,122 @@ void resizeNearest(dim3 grid, dim3 block, cudaStream_t stream, int nbatch, float
         nbatch, scale, osize, idata, istride, ibatchstride, odata, ostride, obatchstride);
 }
 
-struct BOX
+// Each pixel is vec consecutive elements of type V, threadIdx.x walks the elements of a row so that the loads and
+// stores of a warp stay contiguous whatever the pixel width.
+template <typename V>
+__global__ void resize_nearest_pixels_kernel(
+    int nplanes, int vec, float scale, int2 isize, int2 osize, const V* idata, V* odata)
 {
-    float y1, x1, y2, x2;
-};
+    const int orow = osize.x * vec;
+    const int x0 = threadIdx.x + blockIdx.x * blockDim.x;
+    const int y0 = threadIdx.y + blockIdx.y * blockDim.y;
+    for (int plane = blockIdx.z; plane < nplanes; plane += gridDim.z)
+    {
+        const V* iplane = idata + static_cast<size_t>(plane) * isize.y * isize.x * vec;
+        V* oplane = odata + static_cast<size_t>(plane) * osize.y * orow;
+        for (int oy = y0; oy < osize.y; oy += blockDim.y * gridDim.y)
+        {
+            const int iy = int(oy / scale);
+            for (int ox = x0; ox < orow; ox += blockDim.x * gridDim.x)
+            {
+                const int ix = int((ox / vec) / scale);
+                oplane[oy * orow + ox] = iplane[(iy * isize.x + ix) * vec + ox % vec];
+            }
+        }
+    }
+}
 
-struct DETECTION
+__global__ void resize_nearest_int8_kernel(int nplanes, int vec, float scale, int2 isize, int2 osize, float requant,
+    const int8_t* idata, int8_t* odata)
 {
-    float y1, x1, y2, x2, class_id, score;
-};
+    const int orow = osize.x * vec;
+    const int x0 = threadIdx.x + blockIdx.x * blockDim.x;
+    const int y0 = threadIdx.y + blockIdx.y * blockDim.y;
+    for (int plane = blockIdx.z; plane < nplanes; plane += gridDim.z)
+    {
+        const int8_t* iplane = idata + static_cast<size_t>(plane) * isize.y * isize.x * vec;
+        int8_t* oplane = odata + static_cast<size_t>(plane) * osize.y * orow;
+        for (int oy = y0; oy < osize.y; oy += blockDim.y * gridDim.y)
+        {
+            const int iy = int(oy / scale);
+            for (int ox = x0; ox < orow; ox += blockDim.x * gridDim.x)
+            {
+                const int ix = int((ox / vec) / scale);
+                const float v = rintf(iplane[(iy * isize.x + ix) * vec + ox % vec] * requant);
+                oplane[oy * orow + ox] = static_cast<int8_t>(dCLAMP(v, -127.f, 127.f));
+            }
+        }
+    }
+}
 
-__global__ void specialslice_kernel(int samples, const void* idata, void* odata)
+template <typename V>
+cudaError_t resizeNearestPixelsLaunch(cudaStream_t stream, int nplanes, int vec, float scale, int2 isize, int2 osize,
+    const void* idata, void* odata)
 {
+    const dim3 block(32, 16);
+    const dim3 grid((osize.x * vec - 1) / block.x + 1, (osize.y - 1) / block.y + 1, dMIN(nplanes, 65535));
+    resize_nearest_pixels_kernel<V><<<grid, block, 0, stream>>>(
+        nplanes, vec, scale, isize, osize, static_cast<const V*>(idata), static_cast<V*>(odata));
+    return cudaGetLastError();
+}
 
-    int N = blockIdx.x;
-    int blockOffset = N * samples;
-    int totalItems = (samples + (blockDim.x - 1)) / blockDim.x;
-    const DETECTION* in_detections = static_cast<const DETECTION*>(idata);
-    BOX* out_bboxes = static_cast<BOX*>(odata);
-
-    for (int i = 0; i < totalItems; i++)
+cudaError_t resizeNearestPixels(cudaStream_t stream, int nplanes, int pixelBytes, float scale, int2 isize, int2 osize,
+    const void* idata, void* odata)
+{
+    if (pixelBytes % sizeof(uint4) == 0)
     {
-        int cur_id = i * blockDim.x + threadIdx.x;
+        return resizeNearestPixelsLaunch<uint4>(
+            stream, nplanes, pixelBytes / sizeof(uint4), scale, isize, osize, idata, odata);
+    }
+    if (pixelBytes == sizeof(uint32_t))
+    {
+        return resizeNearestPixelsLaunch<uint32_t>(stream, nplanes, 1, scale, isize, osize, idata, odata);
+    }
+    assert(pixelBytes == sizeof(uint16_t));
+    return resizeNearestPixelsLaunch<uint16_t>(stream, nplanes, 1, scale, isize, osize, idata, odata);
+}
+
+cudaError_t resizeNearestInt8(cudaStream_t stream, int nplanes, int vec, float scale, int2 isize, int2 osize,
+    float inputScale, float outputScale, const int8_t* idata, int8_t* odata)
+{
+    const dim3 block(32, 16);
+    const dim3 grid((osize.x * vec - 1) / block.x + 1, (osize.y - 1) / block.y + 1, dMIN(nplanes, 65535));
+    resize_nearest_int8_kernel<<<grid, block, 0, stream>>>(
+        nplanes, vec, scale, isize, osize, inputScale / outputScale, idata, odata);
+    return cudaGetLastError();
+}
 
-        out_bboxes[blockOffset + cur_id].y1 = in_detections[blockOffset + cur_id].y1;
-        out_bboxes[blockOffset + cur_id].x1 = in_detections[blockOffset + cur_id].x1;
-        out_bboxes[blockOffset + cur_id].y2 = in_detections[blockOffset + cur_id].y2;
-        out_bboxes[blockOffset + cur_id].x2 = in_detections[blockOffset + cur_id].x2;
+// idata : T [N, samples, (y1, x1, y2, x2, class_id, score)]
+// odata : T [N, samples, (y1, x1, y2, x2)]
+template <typename T>
+__global__ void specialslice_kernel(int samples, const void* idata, void* odata)
+{
+    const T* in_detections = static_cast<const T*>(idata);
+    T* out_bboxes = static_cast<T*>(odata);
+
+    int blockOffset = blockIdx.x * samples;
+    for (int cur_id = threadIdx.x; cur_id < samples; cur_id += blockDim.x)
+    {
+        const T* detection = in_detections + (blockOffset + cur_id) * 6;
+        T* bbox = out_bboxes + (blockOffset + cur_id) * 4;
+        bbox[0] = detection[0];
+        bbox[1] = detection[1];
+        bbox[2] = detection[2];
+        bbox[3] = detection[3];
     }
 }
 
-void specialSlice(cudaStream_t stream, int batch_size, int boxes_cnt, const void* idata, void* odata)
+void specialSlice(cudaStream_t stream, int batch_size, int boxes_cnt, DataType dtype, const void* idata, void* odata)
 {
     int blocks = batch_size;
-    int threads = dMIN(boxes_cnt, 2048);
+    int threads = dMIN(boxes_cnt, 1024);
 
-    specialslice_kernel<<<blocks, threads, 0, stream>>>(boxes_cnt, idata, odata);
+    if (dtype == DataType::kHALF)
+    {
+        specialslice_kernel<__half><<<blocks, threads, 0, stream>>>(boxes_cnt, idata, odata);
+    }
+    else
+    {
+        specialslice_kernel<float><<<blocks, threads, 0, stream>>>(boxes_cnt, idata, odata);
+    }
 }
@@ -113,6 +113,7 @@ struct RefineDetectionWorkSpace
     size_t sortClassValidCountOffset = 0;
     size_t sortClassPosOffset = 0;
     size_t sortNMSMarkOffset = 0;
+    size_t nmsMaskOffset = 0;
     size_t totalSize = 0;
 };
 
@@ -140,6 +141,7 @@ struct ProposalWorkSpace
     size_t preRefineScoreOffset = 0;
     size_t preRefineSortedScoreOffset = 0;
     size_t preRefineBboxOffset = 0;
+    size_t decodedBboxOffset = 0;
     size_t argMaxScoreOffset = 0;
     size_t argMaxBboxOffset = 0;
     size_t argMaxLabelOffset = 0;
@@ -149,9 +151,14 @@ struct ProposalWorkSpace
     size_t sortClassValidCountOffset = 0;
     size_t sortClassPosOffset = 0;
     size_t sortNMSMarkOffset = 0;
+    size_t nmsMaskOffset = 0;
+    size_t validCountOffset = 0;
     size_t totalSize = 0;
 };
 
+// The inputs and the outputs of RefineBatchClassNMS and proposalRefineBatchClassNMS are of type dtype (kFLOAT or kHALF),
+// the samples in the workspace are FP32. The detection refinement picks the best class, applies its deltas, clips and
+// filters the samples in a single kernel.
 cudaError_t RefineBatchClassNMS(cudaStream_t stream, int N, int samples, nvinfer1::DataType dtype,
     const RefineNMSParameters& param, const RefineDetectionWorkSpace& refineOffset, void* workspace,
     const void* inScores, const void* inDelta, const void* inCountValid, const void* inROI, void* outDetections);
@@ -160,7 +167,8 @@ cudaError_t proposalRefineBatchClassNMS(cudaStream_t stream, int N,
     int inputCnt, // candidate anchors
     int samples,  // preNMS_topK
     nvinfer1::DataType dtype, const RefineNMSParameters& param, const ProposalWorkSpace& proposalOffset,
-    void* workspace, const void* inScores, const void* inDelta, const void* inCountValid, const void* inAnchors,
+    void* workspace, const void* inScores, const void* inDelta,
+    const void* inAnchors, // [inputCnt, 4], shared by the images of the batch
     void* outProposals);
 
 cudaError_t ApplyDelta2Bboxes(cudaStream_t stream, int N,
@@ -192,10 +200,31 @@ cudaError_t roiAlign(cudaStream_t stream, int batchSize, int featureCount, int r
 
     void* pooled, const xy_t poolDims);
 
+size_t roiAlignBucketedWorkspaceSize(int batchSize, int roiCount);
+
+// Pyramid ROI align where the ROIs are first bucketed by pyramid level, then each level is pooled by blocks of threads
+// sharing one ROI, so the reads of a block hit a single level and the writes of a ROI are contiguous. Unlike roiAlign,
+// whose threads keep scaling the level threshold across the ROIs they visit, the level of every ROI is selected from
+// firstThreshold.
+// The pooled output keeps the original ROI order. rois, layers and pooled are all of type dtype (kFLOAT or kHALF).
+cudaError_t roiAlignBucketed(cudaStream_t stream, int batchSize, int featureCount, int roiCount, float firstThreshold,
+    DataType dtype, const void* rois, const void* const layers[], const xy_t* layerDims, void* pooled,
+    const xy_t poolDims, void* workspace);
+
 // RESIZE NEAREST
 void resizeNearest(dim3 grid, dim3 block, cudaStream_t stream, int nbatch, float scale, int2 osize, float const* idata,
     int istride, int ibatchstride, float* odata, int ostride, int obatchstride);
+
+// Nearest resize of nplanes planes whose pixels are pixelBytes wide, covering the FP16 linear and vectorized formats
+// as well as INT8 kCHW32 when the input and output scales match. pixelBytes must be 2, 4 or a multiple of 16.
+cudaError_t resizeNearestPixels(cudaStream_t stream, int nplanes, int pixelBytes, float scale, int2 isize, int2 osize,
+    const void* idata, void* odata);
+
+// INT8 nearest resize of planes whose pixels hold vec channels, requantizing from the input to the output scale
+cudaError_t resizeNearestInt8(cudaStream_t stream, int nplanes, int vec, float scale, int2 isize, int2 osize,
+    float inputScale, float outputScale, const int8_t* idata, int8_t* odata);
 // SPECIAL SLICE
-void specialSlice(cudaStream_t stream, int batch_size, int boxes_cnt, const void* idata, void* odata);
+// idata and odata are of type dtype (kFLOAT or kHALF)
+void specialSlice(cudaStream_t stream, int batch_size, int boxes_cnt, DataType dtype, const void* idata, void* odata);
 
 #endif // TRT_MASKRCNN_UTILS_H
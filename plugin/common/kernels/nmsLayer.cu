@@ -22,180 +22,67 @@
 #include <vector>
 #include "kernel.h"
 #include "bboxUtils.h"
+#include "bitmaskNMS.h"
+#include "cub_helper.h"
+#include "segmentedTopK.h"
 
 // CUB's bug workaround:
 // To work properly for large batch size CUB segmented sort needs ridiculous
 // workspace alignment.
 const uintptr_t ALIGNMENT = 1 << 20;
 
-// IOU 
-template <typename TFloat>
-__device__ __host__ inline float IoU(const Bbox<TFloat>& a, const Bbox<TFloat>& b)
+// NMS SEGMENTS 
+// The preNmsTopN best proposals of each image
+template <typename T_PROPOSALS>
+struct ProposalSegments
 {
-    TFloat left = max(a.xmin, b.xmin), right = min(a.xmax, b.xmax);
-    TFloat top = max(a.ymin, b.ymin), bottom = min(a.ymax, b.ymax);
-    TFloat width = max((TFloat)(right - left + (TFloat) 1.0), (TFloat) 0.0);
-    TFloat height = max((TFloat)(bottom - top + (TFloat) 1.0), (TFloat) 0.0);
-    TFloat interS = width * height;
-    TFloat Sa = (a.xmax - a.xmin + (TFloat) 1) * (a.ymax - a.ymin + (TFloat) 1);
-    TFloat Sb = (b.xmax - b.xmin + (TFloat) 1) * (b.ymax - b.ymin + (TFloat) 1);
-    return (float) interS / (float) (Sa + Sb - interS);
-}
+    Bbox<T_PROPOSALS> const* proposals;
+    int propSize;
+    int boxCount;
 
-// NMS KERNEL FOR SMALL BATCH SIZE 
-template <typename T_PROPOSALS, typename T_ROIS, int DIM, int TSIZE>
-__global__ __launch_bounds__(DIM) void nmsKernel1(const int propSize,
-                                                  Bbox<T_PROPOSALS> const* __restrict__ preNmsProposals,
-                                                  T_ROIS* __restrict__ afterNmsProposals,
-                                                  const int preNmsTopN,
-                                                  const float nmsThres,
-                                                  const int afterNmsTopN)
-{
-    __shared__ bool kept_boxes[TSIZE * DIM];
-    int kept = 0;
-    int batch_offset = blockIdx.x * propSize;
-    int max_box_idx = batch_offset + preNmsTopN;
-    int batch_offset_out = blockIdx.x * afterNmsTopN;
-
-    int flag_idx[TSIZE];
-    int boxes_idx[TSIZE];
-    Bbox<T_PROPOSALS> cur_boxes[TSIZE];
-
-// initialize kept_boxes
-#pragma unroll
-    for (int i = 0; i < TSIZE; i++)
+    __device__ int count(int /*segment*/) const
     {
-        boxes_idx[i] = threadIdx.x + batch_offset + DIM * i;
-        flag_idx[i] = threadIdx.x + DIM * i;
-
-        if (boxes_idx[i] < max_box_idx)
-        {
-            cur_boxes[i] = preNmsProposals[boxes_idx[i]];
-            kept_boxes[flag_idx[i]] = true;
-        }
-        else
-        {
-            kept_boxes[flag_idx[i]] = false;
-            boxes_idx[i] = -1.0f;
-            flag_idx[i] = -1.0f;
-        }
+        return boxCount;
     }
 
-    int ref_box_idx = 0 + batch_offset;
-
-    // remove the overlapped boxes
-    while ((kept < afterNmsTopN) && (ref_box_idx < max_box_idx))
+    __device__ int load(int segment, int i, NMSBox& box) const
     {
-        Bbox<T_PROPOSALS> ref_box;
-        ref_box = preNmsProposals[ref_box_idx];
-
-#pragma unroll
-        for (int i = 0; i < TSIZE; i++)
-        {
-            if (boxes_idx[i] > ref_box_idx)
-            {
-                if (IoU(ref_box, cur_boxes[i]) > nmsThres)
-                {
-                    kept_boxes[flag_idx[i]] = false;
-                }
-            }
-            else if (boxes_idx[i] == ref_box_idx)
-            {
-                afterNmsProposals[(batch_offset_out + kept) * 4 + 0] = ref_box.xmin;
-                afterNmsProposals[(batch_offset_out + kept) * 4 + 1] = ref_box.ymin;
-                afterNmsProposals[(batch_offset_out + kept) * 4 + 2] = ref_box.xmax;
-                afterNmsProposals[(batch_offset_out + kept) * 4 + 3] = ref_box.ymax;
-            }
-        }
-        __syncthreads();
-
-        do
-        {
-            ref_box_idx++;
-        } while (!kept_boxes[ref_box_idx - batch_offset] && ref_box_idx < max_box_idx);
-
-        kept++;
+        box = decodeNMSBox<NMSBoxEncoding::kCornerXY>(&proposals[segment * propSize + i].xmin);
+        return 0;
     }
-}
+};
 
-// NMS KERNEL FOR LARGE BATCH SIZE 
-template <typename T_PROPOSALS, typename T_ROIS, int DIM, int TSIZE>
-__global__ __launch_bounds__(DIM) void nmsKernel2(const int propSize,
-                                                  Bbox<T_PROPOSALS> const* __restrict__ proposals,
-                                                  T_ROIS* __restrict__ filtered,
-                                                  const int preNmsTopN,
-                                                  const float nmsThres,
-                                                  const int afterNmsTopN)
+// NMS OUTPUT 
+// Writes the kept proposals of each image in order, padding with empty boxes up to afterNmsTopN
+template <typename T_PROPOSALS, typename T_ROIS>
+struct RoiOutput
 {
-    Bbox<T_PROPOSALS> const* cProposals = proposals + blockIdx.x * propSize;
+    Bbox<T_PROPOSALS> const* proposals;
+    int propSize;
+    T_ROIS* filtered;
+    int afterNmsTopN;
 
-    Bbox<T_PROPOSALS> t[TSIZE];
-    uint64_t del = 0;
-
-    for (int i = 0; i < TSIZE; i++)
+    __device__ void keep(int segment, int i, int rank) const
     {
-        if (i < TSIZE - 1 || i * DIM + threadIdx.x < preNmsTopN)
-        {
-            t[i] = cProposals[i * DIM + threadIdx.x];
-        }
+        const Bbox<T_PROPOSALS> b = proposals[segment * propSize + i];
+        T_ROIS* roi = filtered + (segment * afterNmsTopN + rank) * 4;
+        roi[0] = b.xmin;
+        roi[1] = b.ymin;
+        roi[2] = b.xmax;
+        roi[3] = b.ymax;
     }
 
-    __shared__ Bbox<T_PROPOSALS> last;
-    __shared__ bool kept;
-    __shared__ int foundBatch;
-    if (threadIdx.x == 0)
-        foundBatch = 0;
+    __device__ void discard(int /*segment*/, int /*i*/) const {}
 
-    for (int i = 0; i < TSIZE; i++)
+    __device__ void finish(int segment, int kept, int lane) const
     {
-        for (int j = 0; j < DIM; j++)
+        T_ROIS* rois = filtered + segment * afterNmsTopN * 4;
+        for (int i = kept * 4 + lane; i < afterNmsTopN * 4; i += 32)
         {
-            int offset = i * DIM;
-            int index = offset + j;
-            if (index >= preNmsTopN)
-                break;
-
-            __syncthreads();
-
-            if (threadIdx.x == j)
-            {
-                kept = 0 == (del & ((uint64_t) 1 << i));
-                last = t[i];
-
-                if (kept)
-                {
-                    int cnt = blockIdx.x * afterNmsTopN + foundBatch;
-                    filtered[cnt * 4 + 0] = t[i].xmin;
-                    filtered[cnt * 4 + 1] = t[i].ymin;
-                    filtered[cnt * 4 + 2] = t[i].xmax;
-                    filtered[cnt * 4 + 3] = t[i].ymax;
-                    foundBatch++;
-                }
-            }
-
-            __syncthreads();
-
-            if (foundBatch == afterNmsTopN)
-            {
-                return;
-            }
-
-            if (kept)
-            {
-                Bbox<T_PROPOSALS> test = last;
-
-                for (int k = 0; k < TSIZE; k++)
-                {
-                    if (index < k * DIM + threadIdx.x
-                        && IoU<T_PROPOSALS>(test, t[k]) > nmsThres)
-                    {
-                        del |= (uint64_t) 1 << k;
-                    }
-                }
-            }
+            rois[i] = 0;
         }
     }
-}
+};
 
 // NMS LAUNCH 
 template <typename T_PROPOSALS, DLayout_t L_PROPOSALS, typename T_ROIS>
@@ -203,36 +90,25 @@ pluginStatus_t nmsLaunch(cudaStream_t stream,
                         const int batch,
                         const int propSize,
                         void* proposals,
+                        void* mask,
                         void* filtered,
                         const int preNmsTopN,
                         const float nmsThres,
                         const int afterNmsTopN)
 {
-    const int blockSize = 1024;
-
-#define P1(tsize) nmsKernel1<T_PROPOSALS, T_ROIS, blockSize, (tsize)>
-#define P2(tsize) nmsKernel2<T_PROPOSALS, T_ROIS, blockSize, (tsize)>
-
-    void (*kernel[64])(int, Bbox<T_PROPOSALS> const*, T_ROIS*, int, float, int) = {
-        P1(1), P1(2), P1(3), P1(4), P1(5), P1(6), P1(7), P1(8), P1(9), P1(10), P1(11), P1(12), P2(13), P2(14), P2(15), P2(16),
-        P2(17), P2(18), P2(19), P2(20), P2(21), P2(22), P2(23), P2(24), P2(25), P2(26), P2(27), P2(28), P2(29), P2(30), P2(31), P2(32),
-        P2(33), P2(34), P2(35), P2(36), P2(37), P2(38), P2(39), P2(40), P2(41), P2(42), P2(43), P2(44), P2(45), P2(46), P2(47), P2(48),
-        P2(49), P2(50), P2(51), P2(52), P2(53), P2(54), P2(55), P2(56), P2(57), P2(58), P2(59), P2(60), P2(61), P2(62), P2(63), P2(64)};
-
-    ASSERT_PARAM(preNmsTopN < 64 * blockSize);
-
-    CSC(cudaMemsetAsync(filtered, 0, batch * afterNmsTopN * 4 * sizeof(T_ROIS), stream), STATUS_FAILURE);
-
-    kernel[(preNmsTopN + blockSize - 1) / blockSize - 1]<<<batch, blockSize, 0, stream>>>(propSize,
-                                                                                          (Bbox<T_PROPOSALS>*) proposals,
-                                                                                          (T_ROIS*) filtered,
-                                                                                          preNmsTopN,
-                                                                                          nmsThres,
-                                                                                          afterNmsTopN);
-
-    CSC(cudaGetLastError(), STATUS_FAILURE);
-
-    return STATUS_SUCCESS;
+    ProposalSegments<T_PROPOSALS> segments;
+    segments.proposals = (Bbox<T_PROPOSALS>*) proposals;
+    segments.propSize = propSize;
+    segments.boxCount = std::min(preNmsTopN, propSize);
+
+    RoiOutput<T_PROPOSALS, T_ROIS> output;
+    output.proposals = segments.proposals;
+    output.propSize = propSize;
+    output.filtered = (T_ROIS*) filtered;
+    output.afterNmsTopN = afterNmsTopN;
+
+    // The proposals are in pixels
+    return bitmaskNMS<false>(stream, batch, segments.boxCount, nmsThres, afterNmsTopN, segments, output, mask);
 }
 
 // SET OFFSET 
@@ -277,7 +153,7 @@ pluginStatus_t nmsGpu(cudaStream_t stream,
     setOffset<<<1, 1024, 0, stream>>>(R, N + 1, offsets);
     CSC(cudaGetLastError(), STATUS_FAILURE);
 
-    vworkspace = vworkspace + N + 1;
+    vworkspace = (int8_t*) (offsets + N + 1);
     vworkspace = alignPtr(vworkspace, ALIGNMENT);
 
     // Sort (batched)
@@ -299,15 +175,18 @@ pluginStatus_t nmsGpu(cudaStream_t stream,
     vworkspace = (int8_t*) (proposalsOut + N * R);
     vworkspace = alignPtr(vworkspace, ALIGNMENT);
 
-    cub::DeviceSegmentedRadixSort::SortPairsDescending(
-        vworkspace, tempStorageBytes,
-        (T_SCORES*) fgScores, (T_SCORES*) scoresOut,
-        (Bbox<T_ROIS>*) proposals, (Bbox<T_ROIS>*) proposalsOut,
-        N * R, N,
-        offsets, offsets + 1,
-        0, 8 * sizeof(T_SCORES), stream);
+    // The NMS only reads the first preNmsTop proposals
+    error = segmentedTopK(stream, N * R, N, preNmsTop,
+                          (const T_SCORES*) fgScores, scoresOut,
+                          (const Bbox<T_ROIS>*) proposals, proposalsOut,
+                          offsets, offsets + 1, vworkspace, tempStorageBytes);
+    if (error != STATUS_SUCCESS)
+    {
+        return error;
+    }
 
-    CSC(cudaGetLastError(), STATUS_FAILURE);
+    vworkspace = alignPtr(vworkspace + tempStorageBytes, ALIGNMENT);
+    uint64_t* mask = (uint64_t*) vworkspace;
 
     DEBUG_PRINTF("&&&& [NMS] POST CUB\n");
     DEBUG_PRINTF("&&&& [NMS] PROPOSALS %u\n", hash(proposalsOut, N * R * 4 * sizeof(float)));
@@ -317,6 +196,7 @@ pluginStatus_t nmsGpu(cudaStream_t stream,
                                              N,
                                              R,
                                              proposalsOut,
+                                             mask,
                                              rois,
                                              preNmsTop,
                                              iouThreshold,
@@ -333,6 +213,25 @@ pluginStatus_t nmsGpu(cudaStream_t stream,
     return STATUS_SUCCESS;
 }
 
+// NMS WORKSPACE SIZE
+// Exactly what nmsGpu carves out: the offsets, the sorted scores and proposals, the temporary storage of the sort and
+// the mask, each buffer starting on an ALIGNMENT boundary
+size_t nmsWorkspaceSize(int N, int R, int preNmsTop)
+{
+    size_t wss[4];
+    wss[0] = (N + 1) * sizeof(int);
+    wss[1] = static_cast<size_t>(N) * R * sizeof(float);
+    wss[2] = static_cast<size_t>(N) * R * sizeof(Bbox<float>);
+    wss[3] = cubSortPairsWorkspaceSize<float, Bbox<float>>(N * R, N);
+    // Slack for aligning the workspace itself
+    size_t total = ALIGNMENT;
+    for (int i = 0; i < 4; i++)
+    {
+        total += (wss[i] + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+    return total + bitmaskNMSWorkspaceSize(N, preNmsTop);
+}
+
 // NMS LAUNCH CONFIG 
 typedef pluginStatus_t (*nmsFun)(cudaStream_t,
                                 const int,   // N
@@ -13,28 +13,18 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <cuda_fp16.h>
 #include "kernel.h"
 #include "bboxUtils.h"
 
-#define CUBLAS_CHECK(condition)                                                                 \
-    do                                                                                          \
-    {                                                                                           \
-        cublasStatus_t status = condition;                                                      \
-        if (status != CUBLAS_STATUS_SUCCESS)                                                    \
-        {                                                                                       \
-            printf("%s %d CUBLAS FAIL %s\n", __FILE__, __LINE__, cublasGetErrorString(status)); \
-        }                                                                                       \
-    } while (0)
-
 size_t normalizePluginWorkspaceSize(bool acrossSpatial, int C, int H, int W)
 {
-    if (acrossSpatial)
-        return sizeof(float) * C * H * W;
-    else
-        return (size_t) 0;
+    // Both cases reduce in shared memory
+    return (size_t) 0;
 }
 
-template <unsigned nthds_per_cta>
+template <typename T, unsigned nthds_per_cta>
 __launch_bounds__(nthds_per_cta)
     __global__ void normalizeNotAcrossSpatialKernel(
         const bool channelShared,
@@ -44,8 +34,8 @@ __launch_bounds__(nthds_per_cta)
         const int W,
         const float eps,
         const float* scale,
-        float* inputData,
-        float* outputData)
+        const T* inputData,
+        T* outputData)
 {
     const int dim = C * H * W;
     const int spatialDim = H * W;
@@ -53,8 +43,8 @@ __launch_bounds__(nthds_per_cta)
     const int numTile = (spatialDim + tile - 1) / tile;
     for (int n = blockIdx.x; n < N * numTile; n += gridDim.x)
     {
-        float* input = inputData + (n / numTile) * dim;
-        float* output = outputData + (n / numTile) * dim;
+        const T* input = inputData + (n / numTile) * dim;
+        T* output = outputData + (n / numTile) * dim;
         __shared__ float sum[tile];
         float localsum = 0.0F;
         for (int i = threadIdx.x; i < tile; i += nthds_per_cta)
@@ -68,11 +58,12 @@ __launch_bounds__(nthds_per_cta)
             int col = (n % numTile) * tile + i % tile;
             float data = 0.0F;
             if (col < spatialDim)
-                data = input[row * spatialDim + col];
+                data = float(input[row * spatialDim + col]);
             localsum += data * data;
         }
         atomicAdd(&sum[threadIdx.x & 31], localsum);
         __syncthreads();
+        // scale factors are either shared or independent across different channels
         for (int i = threadIdx.x; i < C * tile; i += nthds_per_cta)
         {
             int row = i / tile;
@@ -80,28 +71,65 @@ __launch_bounds__(nthds_per_cta)
             if (col < spatialDim)
             {
                 int offset = row * spatialDim + col;
-                output[offset] = input[offset] / sqrt(sum[threadIdx.x & 31] + eps);
+                output[offset] = T(float(input[offset]) / sqrt(sum[threadIdx.x & 31] + eps)
+                    * (channelShared ? scale[0] : scale[row]));
             }
         }
-        if (channelShared)
+        // sum is reused by the next tile
+        __syncthreads();
+    }
+}
+
+// One warp per pixel of a [N, H, W, C] FP16 tensor with C padded to a multiple of 8, each lane loading 8 channels at
+// once. The padding channels are left out of the norm and written as 0.
+template <unsigned nthds_per_cta>
+__launch_bounds__(nthds_per_cta)
+    __global__ void normalizeNotAcrossSpatialHWC8Kernel(
+        const bool channelShared,
+        const int pixels,
+        const int C,
+        const float eps,
+        const float* scale,
+        const __half* inputData,
+        __half* outputData)
+{
+    const int vectors = (C + 7) / 8;
+    const int lane = threadIdx.x & 31;
+    const int warps = nthds_per_cta / 32;
+    for (int pixel = blockIdx.x * warps + threadIdx.x / 32; pixel < pixels; pixel += gridDim.x * warps)
+    {
+        const uint4* input = reinterpret_cast<const uint4*>(inputData) + (size_t) pixel * vectors;
+        uint4* output = reinterpret_cast<uint4*>(outputData) + (size_t) pixel * vectors;
+        float localsum = 0.0F;
+        for (int v = lane; v < vectors; v += 32)
         {
-            for (int i = threadIdx.x; i < C * tile; i += nthds_per_cta)
+            uint4 data = input[v];
+            const __half2* h = reinterpret_cast<const __half2*>(&data);
+            for (int k = 0; k < 4; k++)
             {
-                int row = i / tile;
-                int col = (n % numTile) * tile + i % tile;
-                if (col < spatialDim)
-                    output[row * spatialDim + col] *= scale[0];
+                const int c = v * 8 + k * 2;
+                const float2 f = __half22float2(h[k]);
+                localsum += (c < C ? f.x * f.x : 0.0F) + (c + 1 < C ? f.y * f.y : 0.0F);
             }
         }
-        else
+        for (int offset = 16; offset > 0; offset /= 2)
+        {
+            localsum += __shfl_xor_sync(0xffffffff, localsum, offset);
+        }
+        const float norm = sqrt(localsum + eps);
+        for (int v = lane; v < vectors; v += 32)
         {
-            for (int i = threadIdx.x; i < C * tile; i += nthds_per_cta)
+            uint4 data = input[v];
+            __half2* h = reinterpret_cast<__half2*>(&data);
+            for (int k = 0; k < 4; k++)
             {
-                int row = i / tile;
-                int col = (n % numTile) * tile + i % tile;
-                if (col < spatialDim)
-                    output[row * spatialDim + col] *= scale[row];
+                const int c = v * 8 + k * 2;
+                const float2 f = __half22float2(h[k]);
+                const float x = c < C ? f.x / norm * (channelShared ? scale[0] : scale[c]) : 0.0F;
+                const float y = c + 1 < C ? f.y / norm * (channelShared ? scale[0] : scale[c + 1]) : 0.0F;
+                h[k] = __floats2half2_rn(x, y);
             }
+            output[v] = data;
         }
     }
 }
@@ -116,46 +144,109 @@ pluginStatus_t normalizeNotAcrossSpatialGpu(
     const float eps,
     const void* scale,
     const void* inputData,
-    void* outputData)
+    void* outputData,
+    const DataType DT_DATA,
+    const DLayout_t layout)
 {
     const int BS = 128;
     const int GS = 256;
     // assumes warp size == 32
     ASSERT(BS % 32 == 0);
-    normalizeNotAcrossSpatialKernel<BS><<<GS, BS, 0, stream>>>(channelShared, N, C, H, W, eps,
-                                                               (const float*) scale,
-                                                               (float*) inputData,
-                                                               (float*) outputData);
+    if (layout == NHWC8)
+    {
+        if (DT_DATA != DataType::kHALF)
+        {
+            return STATUS_BAD_PARAM;
+        }
+        const int pixels = N * H * W;
+        const int HWC8_GS = std::min((pixels + BS / 32 - 1) / (BS / 32), 4096);
+        normalizeNotAcrossSpatialHWC8Kernel<BS><<<HWC8_GS, BS, 0, stream>>>(channelShared, pixels, C, eps,
+                                                                           (const float*) scale,
+                                                                           (const __half*) inputData,
+                                                                           (__half*) outputData);
+    }
+    else if (DT_DATA == DataType::kHALF)
+    {
+        normalizeNotAcrossSpatialKernel<__half, BS><<<GS, BS, 0, stream>>>(channelShared, N, C, H, W, eps,
+                                                                           (const float*) scale,
+                                                                           (const __half*) inputData,
+                                                                           (__half*) outputData);
+    }
+    else
+    {
+        normalizeNotAcrossSpatialKernel<float, BS><<<GS, BS, 0, stream>>>(channelShared, N, C, H, W, eps,
+                                                                          (const float*) scale,
+                                                                          (const float*) inputData,
+                                                                          (float*) outputData);
+    }
     CSC(cudaGetLastError(), STATUS_FAILURE);
     return STATUS_SUCCESS;
 }
 
-__global__ void squareKernel(
-    const int n,
-    const float* x,
-    float* y)
+// One CTA per sample: sum of squares with a block reduction, then the scaled output, all samples in one launch
+template <unsigned nthds_per_cta>
+__launch_bounds__(nthds_per_cta)
+    __global__ void normalizeAcrossSpatialKernel(
+        const bool channelShared,
+        const int N,
+        const int dim,
+        const int spatialDim,
+        const float eps,
+        const float* scale,
+        const float* inputData,
+        float* outputData)
 {
-    for (int i = blockIdx.x * blockDim.x + threadIdx.x;
-         i < n; i += gridDim.x * blockDim.x)
+    __shared__ float sum[nthds_per_cta];
+    for (int n = blockIdx.x; n < N; n += gridDim.x)
     {
-        y[i] = x[i] * x[i];
+        const float* input = inputData + (size_t) n * dim;
+        float* output = outputData + (size_t) n * dim;
+        float localsum = 0.0F;
+        for (int i = threadIdx.x; i < dim; i += nthds_per_cta)
+        {
+            localsum += input[i] * input[i];
+        }
+        sum[threadIdx.x] = localsum;
+        __syncthreads();
+        for (int stride = nthds_per_cta / 2; stride > 0; stride /= 2)
+        {
+            if (threadIdx.x < stride)
+            {
+                sum[threadIdx.x] += sum[threadIdx.x + stride];
+            }
+            __syncthreads();
+        }
+        // Use eps to prevent being divided by zero
+        const float norm = 1.0F / sqrtf(sum[0] + eps);
+        for (int i = threadIdx.x; i < dim; i += nthds_per_cta)
+        {
+            // scale factors are either shared or independent across different channels
+            output[i] = input[i] * norm * (channelShared ? scale[0] : scale[i / spatialDim]);
+        }
+        // sum is reused by the next sample
+        __syncthreads();
     }
 }
 
-__global__ void scalChannelKernel(
-    const int n,
-    const int spatialDim,
-    const float* inputData,
-    const float* scale,
-    float* outputData)
+pluginStatus_t normalizeAcrossSpatialGpu(
+    cudaStream_t stream,
+    const bool channelShared,
+    const int N,
+    const int C,
+    const int H,
+    const int W,
+    const float eps,
+    const void* scale,
+    const void* inputData,
+    void* outputData)
 {
-    for (int i = blockIdx.x * blockDim.x + threadIdx.x;
-         i < n; i += gridDim.x * blockDim.x)
-    {
-        // scale factors are indepedent across different channels
-        // scale[i / spatialDim]: find the right scale factor for specific channels
-        outputData[i] = inputData[i] / scale[i / spatialDim];
-    }
+    const int BS = 512;
+    normalizeAcrossSpatialKernel<BS><<<N, BS, 0, stream>>>(channelShared, N, C * H * W, H * W, eps,
+                                                           (const float*) scale,
+                                                           (const float*) inputData,
+                                                           (float*) outputData);
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
 }
 
 pluginStatus_t normalizeInference(
@@ -171,49 +262,23 @@ pluginStatus_t normalizeInference(
     const void* scale,
     const void* inputData,
     void* outputData,
-    void* workspace)
+    void* workspace,
+    const DataType DT_DATA,
+    const DLayout_t layout)
 {
-    const int dim = C * H * W;
     // Normalization is conducted for each sample from the batch indepdently
     if (acrossSpatial)
     {
-        float* input = (float*) const_cast<void*>(inputData);
-        float* output = (float*) outputData;
-        float* buffer = (float*) workspace;
-        for (int n = 0; n < N; ++n)
+        if (DT_DATA != DataType::kFLOAT || layout != NCHW)
         {
-            // Take the square of each element in the input
-            squareKernel<<<(dim + 511) / 512, 512, 0, stream>>>(dim, input, buffer);
-            float normsqr = 0.0F;
-            // Sum up all the squared elements
-            CUBLAS_CHECK(cublasSasum(handle, dim, buffer, 1, &normsqr));
-            // Make a copy of the input to the output
-            CUBLAS_CHECK(cublasScopy(handle, dim, input, 1, output, 1));
-            // Calculate the inverse of the square root of the sum
-            // Use eps to prevent being divided by zero
-            normsqr = 1 / sqrt(normsqr + eps);
-            // Scale all the outputs by normsqr
-            CUBLAS_CHECK(cublasSscal(handle, dim, &normsqr, output, 1));
-            // If channel shared is true, scale all the outputs
-            if (channelShared)
-            {
-                CUBLAS_CHECK(cublasSscal(handle, dim, (float*) scale, output, 1));
-            }
-            // Use different scale factors for different channels
-            else
-            {
-                // scale the output according to channels
-                scalChannelKernel<<<(dim + 511) / 512, 512, 0, stream>>>(dim, H * W, output, (float*) scale, output);
-            }
-            // Move cursors
-            input += dim;
-            output += dim;
+            return STATUS_BAD_PARAM;
         }
-        return STATUS_SUCCESS;
+        return normalizeAcrossSpatialGpu(stream, channelShared, N, C, H, W, eps, scale, inputData, outputData);
     }
     // Normalization ignoring the batch
     else
     {
-        return normalizeNotAcrossSpatialGpu(stream, channelShared, N, C, H, W, eps, scale, inputData, outputData);
+        return normalizeNotAcrossSpatialGpu(
+            stream, channelShared, N, C, H, W, eps, scale, inputData, outputData, DT_DATA, layout);
     }
 }
@@ -13,10 +13,11 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <cuda_fp16.h>
 #include <vector>
 #include "kernel.h"
 
-template <typename Dtype, unsigned nthds_per_cta>
+template <typename Dtype, typename Otype, unsigned nthds_per_cta>
 __launch_bounds__(nthds_per_cta)
     __global__ void permuteData_kernel(
         const int nthreads,
@@ -25,7 +26,7 @@ __launch_bounds__(nthds_per_cta)
         const int num_dim,
         bool confSigmoid,
         const Dtype* data,
-        Dtype* new_data)
+        Otype* new_data)
 {
     // data format: [batch_size, num_data, num_classes, num_dim]
     for (int index = blockIdx.x * nthds_per_cta + threadIdx.x;
@@ -37,7 +38,7 @@ __launch_bounds__(nthds_per_cta)
         const int d = (index / num_dim / num_classes) % num_data;
         const int n = index / num_dim / num_classes / num_data;
         const int new_index = ((n * num_classes + c) * num_data + d) * num_dim + i;
-        float result = data[index];
+        float result = float(data[index]);
         if (confSigmoid)
             result = exp(result) / (1 + exp(result));
 
@@ -46,7 +47,7 @@ __launch_bounds__(nthds_per_cta)
     // new data format: [batch_size, num_classes, num_data, num_dim]
 }
 
-template <typename Dtype>
+template <typename Dtype, typename Otype>
 pluginStatus_t permuteData_gpu(
     cudaStream_t stream,
     const int nthreads,
@@ -59,8 +60,8 @@ pluginStatus_t permuteData_gpu(
 {
     const int BS = 512;
     const int GS = (nthreads + BS - 1) / BS;
-    permuteData_kernel<Dtype, BS><<<GS, BS, 0, stream>>>(nthreads, num_classes, num_data, num_dim, confSigmoid,
-                                                         (const Dtype*) data, (Dtype*) new_data);
+    permuteData_kernel<Dtype, Otype, BS><<<GS, BS, 0, stream>>>(nthreads, num_classes, num_data, num_dim, confSigmoid,
+                                                                (const Dtype*) data, (Otype*) new_data);
     CSC(cudaGetLastError(), STATUS_FAILURE);
     return STATUS_SUCCESS;
 }
@@ -100,7 +101,10 @@ static std::vector<pdLaunchConfig> pdFuncVec;
 bool permuteDataInit()
 {
     pdFuncVec.push_back(pdLaunchConfig(DataType::kFLOAT,
-                                       permuteData_gpu<float>));
+                                       permuteData_gpu<float, float>));
+    // FP16 data is widened to FP32 for the rest of the detection pipeline
+    pdFuncVec.push_back(pdLaunchConfig(DataType::kHALF,
+                                       permuteData_gpu<__half, float>));
     return true;
 }
 
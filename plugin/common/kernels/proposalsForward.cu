@@ -64,7 +64,7 @@ pluginStatus_t proposalsInference(cudaStream_t stream,
     // deltas: predicted bounding box offsets
     DEBUG_PRINTF("&&&& DELTAS  %u\n", hash(deltas, N * A * 4 * H * W * sizeof(float)));
 
-    size_t nmsWorkspaceSize = proposalsForwardNMSWorkspaceSize(N, A, H, W, nmsMaxOut);
+    size_t nmsWorkspaceSize = proposalsForwardNMSWorkspaceSize(N, A, H, W, preNmsTop, nmsMaxOut);
 
     void* nmsWorkspace = workspace;
 
@@ -135,9 +135,10 @@ size_t proposalsForwardNMSWorkspaceSize(int N,
                                         int A,
                                         int H,
                                         int W,
+                                        int preNmsTop,
                                         int nmsMaxOut)
 {
-    return N * A * H * W * 5 * 5 * sizeof(float) + (1 << 22);
+    return nmsWorkspaceSize(N, A * H * W, preNmsTop);
 }
 
 size_t proposalsForwardBboxWorkspaceSize(int N,
@@ -159,10 +160,11 @@ size_t proposalsInferenceWorkspaceSize(int N,
                                        int A,
                                        int H,
                                        int W,
+                                       int preNmsTop,
                                        int nmsMaxOut)
 {
     size_t wss[3];
-    wss[0] = proposalsForwardNMSWorkspaceSize(N, A, H, W, nmsMaxOut);
+    wss[0] = proposalsForwardNMSWorkspaceSize(N, A, H, W, preNmsTop, nmsMaxOut);
     wss[1] = proposalsForwardBboxWorkspaceSize(N, A, H, W);
     wss[2] = proposalForwardFgScoresWorkspaceSize(N, A, H, W);
     return calculateTotalWorkspaceSize(wss, 3);
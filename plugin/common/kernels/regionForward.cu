@@ -14,10 +14,40 @@
  * limitations under the License.
  */
 #include "kernel.h"
+#include <cfloat>
+#include <cuda_fp16.h>
 
-template <unsigned nthdsPerCTA>
+namespace
+{
+__device__ inline float loadValue(const float* p)
+{
+    return *p;
+}
+
+__device__ inline float loadValue(const __half* p)
+{
+    return __half2float(*p);
+}
+
+__device__ inline void storeValue(float* p, float v)
+{
+    *p = v;
+}
+
+__device__ inline void storeValue(__half* p, float v)
+{
+    *p = __float2half(v);
+}
+
+__device__ inline float sigmoid(float x)
+{
+    return 1.F / (1.F + expf(-x));
+}
+} // namespace
+
+template <typename T, unsigned nthdsPerCTA>
 __launch_bounds__(nthdsPerCTA)
-    __global__ void softmaxKernel(const float* input,
+    __global__ void softmaxKernel(const T* input,
                                   const int n,
                                   const int batch,
                                   const int batchOffset,
@@ -25,7 +55,7 @@ __launch_bounds__(nthdsPerCTA)
                                   const int groupOffset,
                                   const int stride,
                                   const float temp,
-                                  float* output)
+                                  T* output)
 {
     int id = blockIdx.x * nthdsPerCTA + threadIdx.x;
     if (id < batch * groups)
@@ -39,7 +69,7 @@ __launch_bounds__(nthdsPerCTA)
         // Find the largest digits before softmax
         for (int i = 0; i < n; ++i)
         {
-            float val = input[i * stride + offset];
+            float val = loadValue(input + i * stride + offset);
             largest = (val > largest) ? val : largest;
         }
         // Softmax for a group of candidate classes
@@ -51,27 +81,78 @@ __launch_bounds__(nthdsPerCTA)
              * xm = max{x_1, x_2, ..., x_n}
              * e^{x_1} / (e^{x_1} + e^{x_2} + e^{x_n}) = e^{x_1 - xm} / (e^{x_1 - xm} + e^{x_2 - xm} + e^{x_n - xm})
              */
-            float e = exp(input[i * stride + offset] / temp - largest / temp);
-            sum += e;
-            output[i * stride + offset] = e;
+            sum += exp(loadValue(input + i * stride + offset) / temp - largest / temp);
         }
         // Normalize
         for (int i = 0; i < n; ++i)
-            output[i * stride + offset] /= sum;
+            storeValue(output + i * stride + offset,
+                exp(loadValue(input + i * stride + offset) / temp - largest / temp) / sum);
     }
 }
 
-template <unsigned nthdsPerCTA>
+/*
+ * One thread per anchor and cell, reading each input value once for the coordinates and the objectness, and twice
+ * for the classes: an online softmax finds the largest value and the sum of exponentials in the first read.
+ * The channels of an anchor are t_x, t_y, t_w, t_h, ..., t_o, then the classes. Sigmoid is applied to t_x, t_y and
+ * t_o, the other coordinates are copied. Without softmax, the classes are copied for the softmax tree kernels.
+ */
+template <typename T, unsigned nthdsPerCTA>
 __launch_bounds__(nthdsPerCTA)
-    __global__ void activateKernel(float* data,
-                                   const int range)
+    __global__ void regionKernel(const T* input,
+                                 const int anchors,
+                                 const int spatialDim,
+                                 const int coords,
+                                 const int classes,
+                                 const bool softmax,
+                                 T* output)
 {
-    int i = blockIdx.x * nthdsPerCTA + threadIdx.x;
-    // Sigmoid function
-    if (i < range)
-        data[i] = 1. / (1. + exp(-data[i]));
+    const int anchorStride = (coords + 1 + classes) * spatialDim;
+    for (int id = blockIdx.x * nthdsPerCTA + threadIdx.x; id < anchors * spatialDim; id += gridDim.x * nthdsPerCTA)
+    {
+        const int offset = (id / spatialDim) * anchorStride + id % spatialDim;
+        const T* in = input + offset;
+        T* out = output + offset;
+        for (int c = 0; c < coords; ++c)
+        {
+            const float v = loadValue(in + c * spatialDim);
+            storeValue(out + c * spatialDim, c < 2 ? sigmoid(v) : v);
+        }
+        storeValue(out + coords * spatialDim, sigmoid(loadValue(in + coords * spatialDim)));
+
+        in += (coords + 1) * spatialDim;
+        out += (coords + 1) * spatialDim;
+        if (!softmax)
+        {
+            for (int c = 0; c < classes; ++c)
+            {
+                out[c * spatialDim] = in[c * spatialDim];
+            }
+            continue;
+        }
+        float largest = -FLT_MAX;
+        float sum = 0.F;
+        for (int c = 0; c < classes; ++c)
+        {
+            const float v = loadValue(in + c * spatialDim);
+            if (v > largest)
+            {
+                sum = sum * expf(largest - v) + 1.F;
+                largest = v;
+            }
+            else
+            {
+                sum += expf(v - largest);
+            }
+        }
+        const float scale = 1.F / sum;
+        for (int c = 0; c < classes; ++c)
+        {
+            storeValue(out + c * spatialDim, expf(loadValue(in + c * spatialDim) - largest) * scale);
+        }
+    }
 }
 
+template <typename T>
 pluginStatus_t regionGPU(
     cudaStream_t stream,
     const int batch,
@@ -83,52 +164,28 @@ pluginStatus_t regionGPU(
     const int classes,
     const bool hasSoftmaxTree,
     const nvinfer1::plugin::softmaxTree* smTree,
-    const float* input,
-    float* output)
+    const T* input,
+    T* output)
 {
     const int BS = 512;
-    const int GS1 = (2 * H * W + BS - 1) / BS;
-    const int GS2 = (H * W + BS - 1) / BS;
-    // Applying sigmoid activations
-    for (int b = 0; b < batch; ++b)
-    {
-        for (int n = 0; n < num; ++n)
-        {
-            // Apply sigmoid activation for the encoded center coordinates t_x, and t_y
-            int index = b * C * H * W + n * H * W * (coords + classes + 1);
-            activateKernel<BS><<<GS1, BS, 0, stream>>>(output + index, 2 * H * W);
-            /*
-             * Apply sigmoid for the encoded objectness t_o
-             * + 4 * H * W because we want to skip the first four coordinates t_x, t_y, t_w, t_h
-             * Chaning 4 * H * W to + coords * H * W will not make this function more general
-             * Since we already assumed the information layout in the channels of the input tensor
-             */
-            index = b * C * H * W + n * H * W * (coords + classes + 1) + 4 * H * W;
-            activateKernel<BS><<<GS2, BS, 0, stream>>>(output + index, H * W);
-        }
-    }
-    const int GS3 = (batch * num * H * W + BS - 1) / BS;
-    // Applying softmax activations
+    const int GS = (batch * num * H * W + BS - 1) / BS;
+    // Activations of all the anchors in a single pass, the softmax tree groups are normalized afterwards
+    regionKernel<T, BS><<<GS, BS, 0, stream>>>(input, batch * num, H * W, coords, classes, !hasSoftmaxTree, output);
     if (hasSoftmaxTree)
     {
         // Softmax for hierarchical classification
-        // The first 5 elements are t_x, t_y, t_w, t_h, t_o which we don't need to apply softmax activation
-        int count = 5;
+        // The first coords + 1 elements are t_x, t_y, t_w, t_h, t_o which we don't need to apply softmax activation
+        int count = coords + 1;
         // Only groups and groupSize information is useful for this plugin
         // Applying softmax activation sequentially for each group of candidate classes
         for (int i = 0; i < smTree->groups; ++i)
         {
             int groupSize = smTree->groupSize[i];
-            softmaxKernel<BS><<<GS3, BS, 0, stream>>>(input + count * H * W, groupSize, batch * num, (C * H * W / num), H * W, 1, H * W, 1., output + count * H * W);
+            softmaxKernel<T, BS><<<GS, BS, 0, stream>>>(input + count * H * W, groupSize, batch * num, (C * H * W / num), H * W, 1, H * W, 1., output + count * H * W);
             count += groupSize;
         }
     }
-    else
-    {
-        // Softmax for non-hierarchical classificiation
-        softmaxKernel<BS><<<GS3, BS, 0, stream>>>(input + 5 * H * W, classes, batch * num, (C * H * W / num), H * W, 1, H * W, 1., output + 5 * H * W);
-    }
-
+    CSC(cudaGetLastError(), STATUS_FAILURE);
     return STATUS_SUCCESS;
 }
 
@@ -143,9 +200,15 @@ pluginStatus_t regionInference(
     const int classes,
     const bool hasSoftmaxTree,
     const nvinfer1::plugin::softmaxTree* smTree,
+    const nvinfer1::DataType type,
     const void* input,
     void* output)
 {
-    CHECK(cudaMemcpyAsync(output, input, batch * C * H * W * sizeof(float), cudaMemcpyDeviceToDevice, stream));
-    return regionGPU(stream, batch, C, H, W, num, coords, classes, hasSoftmaxTree, smTree, (const float*) input, (float*) output);
+    if (type == nvinfer1::DataType::kHALF)
+    {
+        return regionGPU(stream, batch, C, H, W, num, coords, classes, hasSoftmaxTree, smTree,
+            static_cast<const __half*>(input), static_cast<__half*>(output));
+    }
+    return regionGPU(stream, batch, C, H, W, num, coords, classes, hasSoftmaxTree, smTree,
+        static_cast<const float*>(input), static_cast<float*>(output));
 }
@@ -15,13 +15,14 @@
  */
 #include "reducedMath.h"
 #include "kernel.h"
+#include <cuda_fp16.h>
 
 using namespace nvinfer1::rt; // for reduced_divisor
 
-template <unsigned nthdsPerCTA>
+template <typename T, unsigned nthdsPerCTA>
 __launch_bounds__(nthdsPerCTA)
     __global__ void reorgKernel(
-        const float* input, // input tensor of shape (batch, C, H, W)
+        const T* input, // input tensor of shape (batch, C, H, W)
         const int volume,   // note that volumes of input and output tensors are the same
         reduced_divisor batch,
         reduced_divisor C,
@@ -29,7 +30,7 @@ __launch_bounds__(nthdsPerCTA)
         reduced_divisor W,
         reduced_divisor C_out,
         reduced_divisor stride,
-        float* output) // output tensor of shape (batch, C * stride * stride, H / stride, W / stride)
+        T* output) // output tensor of shape (batch, C * stride * stride, H / stride, W / stride)
 {
     /*
      * Reference
@@ -38,7 +39,7 @@ __launch_bounds__(nthdsPerCTA)
      */
 
     // outIndex is row-major position of input coordinates
-    for (int outIndex = blockIdx.x * nthdsPerCTA + threadIdx.x; outIndex < volume; outIndex += nthdsPerCTA)
+    for (int outIndex = blockIdx.x * nthdsPerCTA + threadIdx.x; outIndex < volume; outIndex += gridDim.x * nthdsPerCTA)
     {
         int i = outIndex;
 
@@ -65,6 +66,7 @@ __launch_bounds__(nthdsPerCTA)
     }
 }
 
+template <typename T>
 pluginStatus_t reorgGPU(
     cudaStream_t stream,
     const int batch,
@@ -72,15 +74,15 @@ pluginStatus_t reorgGPU(
     const int H,
     const int W,
     const int stride,
-    const float* input,
-    float* output)
+    const T* input,
+    T* output)
 {
     const int BS = 512;                    // number of threads in one block
     const int volume = batch * C * H * W;  // size of input tensor
     const int GS = (volume + BS - 1) / BS; // number of blocks to launch, calculated so global number of threads is >= volume
 
     reduced_divisor C_out(C / (stride * stride));
-    reorgKernel<BS><<<GS, BS, 0, stream>>>(input, volume, reduced_divisor(batch), reduced_divisor(C), reduced_divisor(H), reduced_divisor(W), C_out, reduced_divisor(stride), output);
+    reorgKernel<T, BS><<<GS, BS, 0, stream>>>(input, volume, reduced_divisor(batch), reduced_divisor(C), reduced_divisor(H), reduced_divisor(W), C_out, reduced_divisor(stride), output);
     return STATUS_SUCCESS;
 }
 
@@ -91,8 +93,14 @@ pluginStatus_t reorgInference(
     const int H,
     const int W,
     const int stride,
+    const nvinfer1::DataType type,
     const void* input,
     void* output)
 {
+    // The elements are only moved, so FP16 takes the same kernel on 16-bit words
+    if (type == nvinfer1::DataType::kHALF)
+    {
+        return reorgGPU(stream, batch, C, H, W, stride, (const __half*) input, (__half*) output);
+    }
     return reorgGPU(stream, batch, C, H, W, stride, (const float*) input, (float*) output);
 }
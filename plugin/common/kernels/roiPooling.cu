@@ -18,6 +18,7 @@
 #include <assert.h>
 #include <cfloat>
 #include <cstdio>
+#include <cuda_fp16.h>
 #include <math.h>
 #include <stdio.h>
 #include <vector>
@@ -133,7 +134,8 @@ pluginStatus_t ROIPoolingForwardKernelAlignedLauncher(cudaStream_t stream,
                                                      void* top,
                                                      int* maxIds)
 {
-    size_t shmemSize = H * W * sizeof(DATA_T) + (R / N) * 4 * sizeof(ROI_T);
+    // The channel is staged in FP32 whatever DATA_T is
+    size_t shmemSize = H * W * sizeof(float) + (R / N) * 4 * sizeof(ROI_T);
 
     if (shmemSize > 48 * 1024)
     {
@@ -159,6 +161,112 @@ pluginStatus_t ROIPoolingForwardKernelAlignedLauncher(cudaStream_t stream,
     return STATUS_SUCCESS;
 }
 
+// ROI POOLING FORWARD KERNEL, CHANNELS LAST
+// One block per roi. Each thread pools a vector of 8 FP16 channels over a bin, so that the threads of a warp read
+// consecutive vectors of the same position instead of one scattered value per channel.
+template <typename ROI_T>
+__global__ void ROIPoolingForwardKernelNHWC8(int ROICount,
+                                             const ROI_T* rois,
+                                             int N,
+                                             int C,
+                                             int H,
+                                             int W,
+                                             const __half* featureMap,
+                                             const int poolingH,
+                                             const int poolingW,
+                                             const float spatialScale,
+                                             __half* top)
+{
+    const int roi = blockIdx.x;
+    const int batch = roi / (ROICount / N);
+    const int vectors = (C + 7) / 8;
+
+    const float4 box = reinterpret_cast<const float4*>(rois)[roi];
+    const int roiStartW = round(box.x * spatialScale);
+    const int roiStartH = round(box.y * spatialScale);
+    // Force malformed ROIs to be 1x1
+    const int roiWidth = max(static_cast<int>(round(box.z * spatialScale)) - roiStartW + 1, 1);
+    const int roiHeight = max(static_cast<int>(round(box.w * spatialScale)) - roiStartH + 1, 1);
+    const float binSizeH = static_cast<float>(roiHeight) / static_cast<float>(poolingH);
+    const float binSizeW = static_cast<float>(roiWidth) / static_cast<float>(poolingW);
+
+    const uint4* bottom = reinterpret_cast<const uint4*>(featureMap) + static_cast<size_t>(batch) * H * W * vectors;
+    uint4* out = reinterpret_cast<uint4*>(top) + static_cast<size_t>(roi) * poolingH * poolingW * vectors;
+    for (int i = threadIdx.x; i < poolingH * poolingW * vectors; i += blockDim.x)
+    {
+        const int v = i % vectors;
+        const int ph = i / vectors / poolingW;
+        const int pw = i / vectors % poolingW;
+        // Same bins as the NCHW kernel, clipped to the feature map
+        const int hstart = min(max(static_cast<int>(floor(ph * binSizeH)) + roiStartH, 0), H);
+        const int hend = min(max(static_cast<int>(ceil((ph + 1) * binSizeH)) + roiStartH, 0), H);
+        const int wstart = min(max(static_cast<int>(floor(pw * binSizeW)) + roiStartW, 0), W);
+        const int wend = min(max(static_cast<int>(ceil((pw + 1) * binSizeW)) + roiStartW, 0), W);
+        const bool is_empty = (hend <= hstart) || (wend <= wstart);
+
+        // Define an empty pooling region to be zero
+        float maxval[8];
+        for (int k = 0; k < 8; ++k)
+        {
+            maxval[k] = is_empty ? 0 : -FLT_MAX;
+        }
+        for (int h = hstart; h < hend; ++h)
+        {
+            for (int w = wstart; w < wend; ++w)
+            {
+                const uint4 packed = bottom[(h * W + w) * vectors + v];
+                const __half2* values = reinterpret_cast<const __half2*>(&packed);
+                for (int k = 0; k < 4; ++k)
+                {
+                    const float2 value = __half22float2(values[k]);
+                    maxval[2 * k] = fmaxf(maxval[2 * k], value.x);
+                    maxval[2 * k + 1] = fmaxf(maxval[2 * k + 1], value.y);
+                }
+            }
+        }
+        uint4 result;
+        __half2* pooled = reinterpret_cast<__half2*>(&result);
+        for (int k = 0; k < 4; ++k)
+        {
+            pooled[k] = __floats2half2_rn(maxval[2 * k], maxval[2 * k + 1]);
+        }
+        out[i] = result;
+    }
+}
+
+template <typename ROI_T>
+pluginStatus_t ROIPoolingForwardKernelNHWC8Launcher(cudaStream_t stream,
+                                                   const int R,        // TOTAL number of rois -> ~nmsMaxOut * N
+                                                   const int N,        // Batch size
+                                                   const int C,        // Channels
+                                                   const int H,        // Input feature map H
+                                                   const int W,        // Input feature map W
+                                                   const int poolingH, // Output feature map H
+                                                   const int poolingW, // Output feature map W
+                                                   const float spatialScale,
+                                                   const void* rois,
+                                                   const void* featureMap,
+                                                   void* top,
+                                                   int* maxIds)
+{
+    // the rois of an image are contiguous, R should always be a multiple of N
+    assert(R % N == 0);
+
+    ROIPoolingForwardKernelNHWC8<ROI_T><<<R, 256, 0, stream>>>(R,
+                                                               (const ROI_T*) rois,
+                                                               N,
+                                                               C,
+                                                               H,
+                                                               W,
+                                                               (const __half*) featureMap,
+                                                               poolingH,
+                                                               poolingW,
+                                                               spatialScale,
+                                                               (__half*) top);
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
+}
+
 // ROI POOLING LAUNCH CONFIG 
 
 typedef pluginStatus_t (*roiFwd)(cudaStream_t,
@@ -230,6 +338,7 @@ struct roiFwdLaunchConfig
 };
 
 #define FLOAT32 nvinfer1::DataType::kFLOAT
+#define FLOAT16 nvinfer1::DataType::kHALF
 bool roiFwdLCVecInit(std::vector<roiFwdLaunchConfig>& roiFwdLCVec)
 {
     roiFwdLCVec.push_back(roiFwdLaunchConfig(FLOAT32,
@@ -246,6 +355,20 @@ bool roiFwdLCVecInit(std::vector<roiFwdLaunchConfig>& roiFwdLCVec)
                                              NCHW,
                                              false,
                                              ROIPoolingForwardKernelAlignedLauncher<float, float, false>));
+    roiFwdLCVec.push_back(roiFwdLaunchConfig(FLOAT32,
+                                             FLOAT16,
+                                             NCHW,
+                                             FLOAT16,
+                                             NCHW,
+                                             true,
+                                             ROIPoolingForwardKernelAlignedLauncher<__half, float, true>));
+    roiFwdLCVec.push_back(roiFwdLaunchConfig(FLOAT32,
+                                             FLOAT16,
+                                             NHWC8,
+                                             FLOAT16,
+                                             NHWC8,
+                                             true,
+                                             ROIPoolingForwardKernelNHWC8Launcher<float>));
     return true;
 }
 
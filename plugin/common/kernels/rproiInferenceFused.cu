@@ -104,7 +104,8 @@ size_t RPROIInferenceFusedWorkspaceSize(int N,
                                         int A,
                                         int H,
                                         int W,
+                                        int preNmsTop,
                                         int nmsMaxOut)
 {
-    return proposalsInferenceWorkspaceSize(N, A, H, W, nmsMaxOut);
+    return proposalsInferenceWorkspaceSize(N, A, H, W, preNmsTop, nmsMaxOut);
 }
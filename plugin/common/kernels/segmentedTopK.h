@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_SEGMENTED_TOP_K_H
+#define TRT_SEGMENTED_TOP_K_H
+
+#include "cub/cub.cuh"
+#include "plugin.h"
+#include <cuda_fp16.h>
+#include <stdint.h>
+
+/*
+ * Segmented top-K shared by the detection plugins, include from .cu files only.
+ *
+ * segmentedTopK writes the topK largest keys of each segment [beginOffsets[s], endOffsets[s]) of keysIn, and their
+ * values, in decreasing order at the start of the segment in keysOut and valuesOut. Equal keys keep their input order,
+ * so these are the first topK entries cub::DeviceSegmentedRadixSort::SortPairsDescending would give. The rest of the
+ * segment is left untouched in the outputs, which may not alias the inputs.
+ *
+ * One block per segment selects the entries, a key and its position in the segment packed in 64 bits:
+ * - segments of up to kTopKTileFactor tiles of P >= topK entries are merged tile by tile into the P largest, in shared
+ *   memory, with a bitonic network. The tiles without an entry above the topK-th largest so far are skipped.
+ * - larger segments are radix-selected. The histograms of the key digits, from the most significant, find the topK-th
+ *   largest key, then the keys above it and the first equal ones are compacted and sorted by the same network.
+ * Above kTopKMaxSelect, the segments are sorted whole by cub in the segmentedTopKWorkspaceSize bytes of workspace.
+ */
+
+const int kTopKMaxSelect = 1024;
+const int kTopKThreads = 256;
+const int kTopKTileFactor = 4;
+const int kTopKRadixBits = 8;
+const int kTopKRadixBins = 1 << kTopKRadixBits;
+
+// Keys mapped to unsigned integers of the same order, in the kBits most significant bits, as cub does for its sort
+template <typename T>
+struct TopKKey;
+
+template <>
+struct TopKKey<float>
+{
+    static const int kBits = 32;
+
+    __device__ static unsigned ordered(float key)
+    {
+        const unsigned bits = __float_as_uint(key);
+        return bits ^ ((bits >> 31) ? 0xffffffffu : 0x80000000u);
+    }
+};
+
+template <>
+struct TopKKey<__half>
+{
+    static const int kBits = 16;
+
+    __device__ static unsigned ordered(__half key)
+    {
+        const unsigned bits = __half_as_ushort(key);
+        return (bits ^ ((bits >> 15) ? 0xffffu : 0x8000u)) << 16;
+    }
+};
+
+// The larger key first, the earlier position among equal keys. 0, below any entry, pads the networks.
+__device__ inline uint64_t topKEntry(unsigned key, int position)
+{
+    return ((uint64_t) key << 32) | (uint32_t) ~position;
+}
+
+__device__ inline int topKPosition(uint64_t entry)
+{
+    return (int) ~(uint32_t) entry;
+}
+
+// Sorts the N entries, a power of 2
+template <int N, int THREADS>
+__device__ void topKBitonicSort(uint64_t* entries, const bool descending)
+{
+    for (int k = 2; k <= N; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            for (int i = threadIdx.x; i < N; i += THREADS)
+            {
+                const int l = i ^ j;
+                if (l > i)
+                {
+                    const uint64_t a = entries[i];
+                    const uint64_t b = entries[l];
+                    // The runs of k entries alternate directions, the last one has the requested one
+                    const bool ascending = ((i & k) == 0) != descending;
+                    if ((a > b) == ascending)
+                    {
+                        entries[i] = b;
+                        entries[l] = a;
+                    }
+                }
+            }
+            __syncthreads();
+        }
+    }
+}
+
+// Merges the ascending tile in entries[P, 2P) into the descending entries[0, P), which form a bitonic sequence: its P
+// largest are the pairwise maximums, a bitonic sequence again, merged in descending order.
+template <int P, int THREADS>
+__device__ void topKMergeTile(uint64_t* entries)
+{
+    for (int i = threadIdx.x; i < P; i += THREADS)
+    {
+        const uint64_t b = entries[i + P];
+        if (b > entries[i])
+        {
+            entries[i] = b;
+        }
+    }
+    __syncthreads();
+    for (int j = P >> 1; j > 0; j >>= 1)
+    {
+        for (int i = threadIdx.x; i < P; i += THREADS)
+        {
+            const int l = i ^ j;
+            if (l > i)
+            {
+                const uint64_t a = entries[i];
+                const uint64_t b = entries[l];
+                if (a < b)
+                {
+                    entries[i] = b;
+                    entries[l] = a;
+                }
+            }
+        }
+        __syncthreads();
+    }
+}
+
+template <typename T_KEY, typename T_VALUE, int P, int THREADS>
+__global__ __launch_bounds__(THREADS) void segmentedTopK_kernel(const int topK, const T_KEY* __restrict__ keysIn,
+    T_KEY* __restrict__ keysOut, const T_VALUE* __restrict__ valuesIn, T_VALUE* __restrict__ valuesOut,
+    const int* __restrict__ beginOffsets, const int* __restrict__ endOffsets)
+{
+    typedef cub::BlockScan<int, THREADS> BlockScan;
+    __shared__ typename BlockScan::TempStorage scanStorage;
+    __shared__ uint64_t entries[2 * P];
+    __shared__ int histogram[kTopKRadixBins];
+    __shared__ int selectedDigit;
+    __shared__ int selectedRemaining;
+
+    const int begin = beginOffsets[blockIdx.x];
+    const int count = endOffsets[blockIdx.x] - begin;
+    if (count <= 0)
+    {
+        return;
+    }
+    const T_KEY* keys = keysIn + begin;
+
+    if (count <= kTopKTileFactor * P)
+    {
+        for (int i = threadIdx.x; i < P; i += THREADS)
+        {
+            entries[i] = 0;
+        }
+        __syncthreads();
+        for (int tile = 0; tile < count; tile += P)
+        {
+            const uint64_t last = entries[topK - 1];
+            int above = 0;
+            for (int i = threadIdx.x; i < P; i += THREADS)
+            {
+                const int position = tile + i;
+                const uint64_t entry
+                    = position < count ? topKEntry(TopKKey<T_KEY>::ordered(keys[position]), position) : 0;
+                entries[P + i] = entry;
+                above |= entry > last;
+            }
+            if (__syncthreads_or(above))
+            {
+                topKBitonicSort<P, THREADS>(entries + P, false);
+                topKMergeTile<P, THREADS>(entries);
+            }
+        }
+    }
+    else
+    {
+        // Digits of the topK-th largest key, and how many of the keys equal to it so far are in the top K
+        unsigned prefix = 0;
+        unsigned prefixMask = 0;
+        int remaining = topK;
+        for (int shift = 32 - kTopKRadixBits; shift >= 32 - TopKKey<T_KEY>::kBits; shift -= kTopKRadixBits)
+        {
+            for (int b = threadIdx.x; b < kTopKRadixBins; b += THREADS)
+            {
+                histogram[b] = 0;
+            }
+            __syncthreads();
+            for (int i = threadIdx.x; i < count; i += THREADS)
+            {
+                const unsigned key = TopKKey<T_KEY>::ordered(keys[i]);
+                if ((key & prefixMask) == prefix)
+                {
+                    atomicAdd(&histogram[(key >> shift) & (kTopKRadixBins - 1)], 1);
+                }
+            }
+            __syncthreads();
+            if (threadIdx.x == 0)
+            {
+                int digit = kTopKRadixBins - 1;
+                while (digit > 0 && histogram[digit] < remaining)
+                {
+                    remaining -= histogram[digit];
+                    digit--;
+                }
+                selectedDigit = digit;
+                selectedRemaining = remaining;
+            }
+            __syncthreads();
+            prefix |= (unsigned) selectedDigit << shift;
+            prefixMask |= (unsigned) (kTopKRadixBins - 1) << shift;
+            remaining = selectedRemaining;
+        }
+
+        // Exactly topK entries are selected, in their input order
+        int selected = 0;
+        int equals = 0;
+        for (int tile = 0; tile < count && selected < topK; tile += THREADS)
+        {
+            const int position = tile + threadIdx.x;
+            const unsigned key = position < count ? TopKKey<T_KEY>::ordered(keys[position]) : 0;
+            const int equal = position < count && key == prefix;
+            int equalRank, tileEquals;
+            BlockScan(scanStorage).ExclusiveSum(equal, equalRank, tileEquals);
+            __syncthreads();
+            const int take = position < count && (key > prefix || (equal && equals + equalRank < remaining));
+            int slot, tileTaken;
+            BlockScan(scanStorage).ExclusiveSum(take, slot, tileTaken);
+            __syncthreads();
+            if (take)
+            {
+                entries[selected + slot] = topKEntry(key, position);
+            }
+            selected += tileTaken;
+            equals += tileEquals;
+        }
+        for (int i = topK + threadIdx.x; i < P; i += THREADS)
+        {
+            entries[i] = 0;
+        }
+        __syncthreads();
+        topKBitonicSort<P, THREADS>(entries, true);
+    }
+
+    const int outputs = min(topK, count);
+    for (int r = threadIdx.x; r < outputs; r += THREADS)
+    {
+        const int position = topKPosition(entries[r]);
+        keysOut[begin + r] = keys[position];
+        valuesOut[begin + r] = valuesIn[begin + position];
+    }
+}
+
+// Workspace of segmentedTopK, only needed by the whole sort above kTopKMaxSelect
+template <typename T_KEY, typename T_VALUE>
+size_t segmentedTopKWorkspaceSize(int numItems, int numSegments, int topK)
+{
+    if (topK > 0 && topK <= kTopKMaxSelect)
+    {
+        return 0;
+    }
+    size_t temp_storage_bytes = 0;
+    cub::DeviceSegmentedRadixSort::SortPairsDescending((void*) NULL, temp_storage_bytes, (const T_KEY*) NULL,
+        (T_KEY*) NULL, (const T_VALUE*) NULL, (T_VALUE*) NULL, numItems, numSegments, (const int*) NULL,
+        (const int*) NULL);
+    return temp_storage_bytes;
+}
+
+template <typename T_KEY, typename T_VALUE, int P>
+pluginStatus_t segmentedTopKSelect(cudaStream_t stream, const int numSegments, const int topK, const T_KEY* keysIn,
+    T_KEY* keysOut, const T_VALUE* valuesIn, T_VALUE* valuesOut, const int* beginOffsets, const int* endOffsets)
+{
+    segmentedTopK_kernel<T_KEY, T_VALUE, P, kTopKThreads><<<numSegments, kTopKThreads, 0, stream>>>(
+        topK, keysIn, keysOut, valuesIn, valuesOut, beginOffsets, endOffsets);
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
+}
+
+// A topK of 0 or less sorts the segments whole
+template <typename T_KEY, typename T_VALUE>
+pluginStatus_t segmentedTopK(cudaStream_t stream, const int numItems, const int numSegments, const int topK,
+    const T_KEY* keysIn, T_KEY* keysOut, const T_VALUE* valuesIn, T_VALUE* valuesOut, const int* beginOffsets,
+    const int* endOffsets, void* workspace, size_t workspaceSize)
+{
+    if (numSegments == 0)
+    {
+        return STATUS_SUCCESS;
+    }
+    if (topK > 0 && topK <= 128)
+    {
+        return segmentedTopKSelect<T_KEY, T_VALUE, 128>(
+            stream, numSegments, topK, keysIn, keysOut, valuesIn, valuesOut, beginOffsets, endOffsets);
+    }
+    if (topK > 0 && topK <= 256)
+    {
+        return segmentedTopKSelect<T_KEY, T_VALUE, 256>(
+            stream, numSegments, topK, keysIn, keysOut, valuesIn, valuesOut, beginOffsets, endOffsets);
+    }
+    if (topK > 0 && topK <= 512)
+    {
+        return segmentedTopKSelect<T_KEY, T_VALUE, 512>(
+            stream, numSegments, topK, keysIn, keysOut, valuesIn, valuesOut, beginOffsets, endOffsets);
+    }
+    if (topK > 0 && topK <= kTopKMaxSelect)
+    {
+        return segmentedTopKSelect<T_KEY, T_VALUE, kTopKMaxSelect>(
+            stream, numSegments, topK, keysIn, keysOut, valuesIn, valuesOut, beginOffsets, endOffsets);
+    }
+
+    cub::DeviceSegmentedRadixSort::SortPairsDescending(workspace, workspaceSize, keysIn, keysOut, valuesIn, valuesOut,
+        numItems, numSegments, beginOffsets, endOffsets, 0, sizeof(T_KEY) * 8, stream);
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
+}
+
+#endif // TRT_SEGMENTED_TOP_K_H
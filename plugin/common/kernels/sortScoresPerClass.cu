@@ -14,10 +14,12 @@
  * limitations under the License.
  */
 #include "cub/cub.cuh"
+#include <cuda_fp16.h>
 #include <vector>
 #include "kernel.h"
 #include "bboxUtils.h"
 #include "cub_helper.h"
+#include "segmentedTopK.h"
 
 
 template <typename T_SCORE, unsigned nthds_per_cta>
@@ -85,12 +87,193 @@ __launch_bounds__(nthds_per_cta)
     }
 }
 
+/*
+ * Score of a candidate of a segment. Class-major scores are read from the segment itself. Prior-major scores are read
+ * with a stride of num_classes from the output of the confidence head, and converted as permuteData does.
+ */
+template <typename T_SCORE, typename T_INPUT, bool PRIOR_MAJOR>
+__device__ T_SCORE loadScore(
+    const T_INPUT* conf_input,
+    const int segment,
+    const int cur_idx,
+    const int num_classes,
+    const int num_preds_per_class,
+    const bool conf_sigmoid)
+{
+    if (!PRIOR_MAJOR)
+    {
+        return conf_input[segment * num_preds_per_class + cur_idx];
+    }
+    const int image = segment / num_classes;
+    const int class_idx = segment % num_classes;
+    float score = float(conf_input[(image * num_preds_per_class + cur_idx) * num_classes + class_idx]);
+    if (conf_sigmoid)
+        score = exp(score) / (1 + exp(score));
+    return score;
+}
+
+/*
+ * Compacting variant of prepareSortData, one block per (image, class) segment. The candidates above the threshold are
+ * moved to the front of their segment in temp_scores/temp_idx, in their original order so that the stable sort keeps
+ * ties as the unfiltered path does. The end of each segment is reported in d_end_offsets and only the selected
+ * candidates are sorted. The rest of the segment is cleared in both sort buffers.
+ */
+template <typename T_SCORE, typename T_INPUT, bool PRIOR_MAJOR, unsigned nthds_per_cta>
+__launch_bounds__(nthds_per_cta)
+    __global__ void compactSortData(
+        const int num_classes,
+        const int num_preds_per_class,
+        const int background_label_id,
+        const float confidence_threshold,
+        const bool conf_sigmoid,
+        const T_INPUT* conf_input,
+        T_SCORE* conf_scores_gpu,
+        int* index_array_gpu,
+        T_SCORE* temp_scores,
+        int* temp_idx,
+        int* d_begin_offsets,
+        int* d_end_offsets)
+{
+    typedef cub::BlockScan<int, nthds_per_cta> BlockScan;
+    __shared__ typename BlockScan::TempStorage temp_storage;
+
+    const int segment = blockIdx.x;
+    const int segment_start = segment * num_preds_per_class;
+    // Number of selected candidates, uniform across the block
+    int selected = 0;
+    if ((segment % num_classes) != background_label_id)
+    {
+        for (int tile = 0; tile < num_preds_per_class; tile += nthds_per_cta)
+        {
+            const int cur_idx = tile + threadIdx.x;
+            const T_SCORE score = cur_idx < num_preds_per_class
+                ? loadScore<T_SCORE, T_INPUT, PRIOR_MAJOR>(
+                    conf_input, segment, cur_idx, num_classes, num_preds_per_class, conf_sigmoid)
+                : T_SCORE(0);
+            const int flag = (cur_idx < num_preds_per_class && score > confidence_threshold) ? 1 : 0;
+            int position, tile_selected;
+            BlockScan(temp_storage).ExclusiveSum(flag, position, tile_selected);
+            if (flag)
+            {
+                temp_scores[segment_start + selected + position] = score;
+                temp_idx[segment_start + selected + position] = segment_start + cur_idx;
+            }
+            selected += tile_selected;
+            // temp_storage is reused by the next tile
+            __syncthreads();
+        }
+    }
+
+    for (int cur_idx = selected + threadIdx.x; cur_idx < num_preds_per_class; cur_idx += nthds_per_cta)
+    {
+        conf_scores_gpu[segment_start + cur_idx] = 0.0f;
+        index_array_gpu[segment_start + cur_idx] = -1;
+        temp_scores[segment_start + cur_idx] = 0.0f;
+        temp_idx[segment_start + cur_idx] = -1;
+    }
+    if (threadIdx.x == 0)
+    {
+        d_begin_offsets[segment] = segment_start;
+        d_end_offsets[segment] = segment_start + selected;
+    }
+}
+
+template <typename T_SCORE, typename T_INPUT, bool PRIOR_MAJOR>
+pluginStatus_t sortScoresPerClassCompactFrom_gpu(
+    cudaStream_t stream,
+    const int num,
+    const int num_classes,
+    const int num_preds_per_class,
+    const int top_k,
+    const int background_label_id,
+    const float confidence_threshold,
+    const bool conf_sigmoid,
+    const void* conf_input,
+    void* conf_scores_gpu,
+    void* index_array_gpu,
+    void* workspace)
+{
+    const int num_segments = num * num_classes;
+    const int arrayLen = num * num_classes * num_preds_per_class;
+    void* temp_scores = workspace;
+    void* temp_idx = nextWorkspacePtr((int8_t*) temp_scores, arrayLen * sizeof(T_SCORE));
+    void* d_begin_offsets = nextWorkspacePtr((int8_t*) temp_idx, arrayLen * sizeof(int));
+    void* d_end_offsets = nextWorkspacePtr((int8_t*) d_begin_offsets, num_segments * sizeof(int));
+    void* cubWorkspace = nextWorkspacePtr((int8_t*) d_end_offsets, num_segments * sizeof(int));
+
+    const int BS = 256;
+    compactSortData<T_SCORE, T_INPUT, PRIOR_MAJOR, BS><<<num_segments, BS, 0, stream>>>(num_classes,
+                                                                 num_preds_per_class,
+                                                                 background_label_id, confidence_threshold,
+                                                                 conf_sigmoid,
+                                                                 (const T_INPUT*) conf_input,
+                                                                 (T_SCORE*) conf_scores_gpu,
+                                                                 (int*) index_array_gpu,
+                                                                 (T_SCORE*) temp_scores,
+                                                                 (int*) temp_idx,
+                                                                 (int*) d_begin_offsets,
+                                                                 (int*) d_end_offsets);
+
+    // Only the top_k first candidates of each class go through the NMS
+    if (top_k > 0 && top_k <= kTopKMaxSelect)
+    {
+        return segmentedTopK(stream, arrayLen, num_segments, top_k,
+                             (const T_SCORE*) temp_scores, (T_SCORE*) conf_scores_gpu,
+                             (const int*) temp_idx, (int*) index_array_gpu,
+                             (const int*) d_begin_offsets, (const int*) d_end_offsets,
+                             nullptr, 0);
+    }
+
+    // Sort from the compacted buffers into the output buffers, the DoubleBuffer flavour needs no copy of the keys
+    cub::DoubleBuffer<T_SCORE> keys((T_SCORE*) temp_scores, (T_SCORE*) conf_scores_gpu);
+    cub::DoubleBuffer<int> values((int*) temp_idx, (int*) index_array_gpu);
+    size_t temp_storage_bytes = cubSortPairsDoubleBufferWorkspaceSize<T_SCORE, int>(arrayLen, num_segments);
+    cub::DeviceSegmentedRadixSort::SortPairsDescending(
+        cubWorkspace, temp_storage_bytes,
+        keys, values,
+        arrayLen, num_segments,
+        (const int*) d_begin_offsets, (const int*) d_end_offsets,
+        0, sizeof(T_SCORE) * 8,
+        stream);
+    // Depending on the number of radix passes, the sorted data may have ended up in the compaction buffers
+    if (keys.Current() != (T_SCORE*) conf_scores_gpu)
+    {
+        CSC(cudaMemcpyAsync(conf_scores_gpu, temp_scores, arrayLen * sizeof(T_SCORE), cudaMemcpyDeviceToDevice, stream),
+            STATUS_FAILURE);
+        CSC(cudaMemcpyAsync(index_array_gpu, temp_idx, arrayLen * sizeof(int), cudaMemcpyDeviceToDevice, stream),
+            STATUS_FAILURE);
+    }
+    CSC(cudaGetLastError(), STATUS_FAILURE);
+    return STATUS_SUCCESS;
+}
+
+template <typename T_SCORE>
+pluginStatus_t sortScoresPerClassCompact_gpu(
+    cudaStream_t stream,
+    const int num,
+    const int num_classes,
+    const int num_preds_per_class,
+    const int top_k,
+    const int background_label_id,
+    const float confidence_threshold,
+    void* conf_scores_gpu,
+    void* index_array_gpu,
+    void* workspace)
+{
+    // The scores are compacted from the class-major buffer they are sorted into
+    return sortScoresPerClassCompactFrom_gpu<T_SCORE, T_SCORE, false>(stream, num, num_classes, num_preds_per_class,
+                                                                      top_k, background_label_id, confidence_threshold,
+                                                                      false, conf_scores_gpu, conf_scores_gpu,
+                                                                      index_array_gpu, workspace);
+}
+
 template <typename T_SCORE>
 pluginStatus_t sortScoresPerClass_gpu(
     cudaStream_t stream,
     const int num,
     const int num_classes,
     const int num_preds_per_class,
+    const int top_k,
     const int background_label_id,
     const float confidence_threshold,
     void* conf_scores_gpu,
@@ -114,17 +297,12 @@ pluginStatus_t sortScoresPerClass_gpu(
                                                         (int*) temp_idx,
                                                         (int*) d_offsets);
 
-    size_t temp_storage_bytes = cubSortPairsWorkspaceSize<T_SCORE, int>(arrayLen, num_segments);
-    cub::DeviceSegmentedRadixSort::SortPairsDescending(
-        cubWorkspace, temp_storage_bytes,
-        (const T_SCORE*) (temp_scores), (T_SCORE*) (conf_scores_gpu),
-        (const int*) (temp_idx), (int*) (index_array_gpu),
-        arrayLen, num_segments,
-        (const int*) d_offsets, (const int*) d_offsets + 1,
-        0, sizeof(T_SCORE) * 8,
-        stream);
-    CSC(cudaGetLastError(), STATUS_FAILURE);
-    return STATUS_SUCCESS;
+    size_t temp_storage_bytes = segmentedTopKWorkspaceSize<T_SCORE, int>(arrayLen, num_segments, top_k);
+    return segmentedTopK(stream, arrayLen, num_segments, top_k,
+                         (const T_SCORE*) (temp_scores), (T_SCORE*) (conf_scores_gpu),
+                         (const int*) (temp_idx), (int*) (index_array_gpu),
+                         (const int*) d_offsets, (const int*) d_offsets + 1,
+                         cubWorkspace, temp_storage_bytes);
 }
 
 // sortScoresPerClass LAUNCH CONFIG 
@@ -133,6 +311,7 @@ typedef pluginStatus_t (*sspcFunc)(cudaStream_t,
                                 const int,
                                 const int,
                                 const int,
+                                const int,
                                 const float,
                                 void*,
                                 void*,
@@ -140,28 +319,33 @@ typedef pluginStatus_t (*sspcFunc)(cudaStream_t,
 struct sspcLaunchConfig
 {
     DataType t_score;
+    bool compact;
     sspcFunc function;
 
-    sspcLaunchConfig(DataType t_score)
+    sspcLaunchConfig(DataType t_score, bool compact)
         : t_score(t_score)
+        , compact(compact)
     {
     }
-    sspcLaunchConfig(DataType t_score, sspcFunc function)
+    sspcLaunchConfig(DataType t_score, bool compact, sspcFunc function)
         : t_score(t_score)
+        , compact(compact)
         , function(function)
     {
     }
     bool operator==(const sspcLaunchConfig& other)
     {
-        return t_score == other.t_score;
+        return t_score == other.t_score && compact == other.compact;
     }
 };
 
 static std::vector<sspcLaunchConfig> sspcFuncVec;
 bool sspcInit()
 {
-    sspcFuncVec.push_back(sspcLaunchConfig(DataType::kFLOAT,
+    sspcFuncVec.push_back(sspcLaunchConfig(DataType::kFLOAT, false,
                                            sortScoresPerClass_gpu<float>));
+    sspcFuncVec.push_back(sspcLaunchConfig(DataType::kFLOAT, true,
+                                           sortScoresPerClassCompact_gpu<float>));
     return true;
 }
 
@@ -172,14 +356,16 @@ pluginStatus_t sortScoresPerClass(
     const int num,
     const int num_classes,
     const int num_preds_per_class,
+    const int top_k,
     const int background_label_id,
     const float confidence_threshold,
     const DataType DT_SCORE,
     void* conf_scores_gpu,
     void* index_array_gpu,
-    void* workspace)
+    void* workspace,
+    const bool compact)
 {
-    sspcLaunchConfig lc = sspcLaunchConfig(DT_SCORE);
+    sspcLaunchConfig lc = sspcLaunchConfig(DT_SCORE, compact);
     for (unsigned i = 0; i < sspcFuncVec.size(); ++i)
     {
         if (lc == sspcFuncVec[i])
@@ -189,6 +375,7 @@ pluginStatus_t sortScoresPerClass(
                                            num,
                                            num_classes,
                                            num_preds_per_class,
+                                           top_k,
                                            background_label_id,
                                            confidence_threshold,
                                            conf_scores_gpu,
@@ -199,20 +386,57 @@ pluginStatus_t sortScoresPerClass(
     return STATUS_BAD_PARAM;
 }
 
+pluginStatus_t sortScoresPerClassPriorMajor(
+    cudaStream_t stream,
+    const int num,
+    const int num_classes,
+    const int num_preds_per_class,
+    const int top_k,
+    const int background_label_id,
+    const float confidence_threshold,
+    const DataType DT_CONF,
+    const bool conf_sigmoid,
+    const void* conf_data,
+    void* conf_scores_gpu,
+    void* index_array_gpu,
+    void* workspace)
+{
+    switch (DT_CONF)
+    {
+    case DataType::kFLOAT:
+        return sortScoresPerClassCompactFrom_gpu<float, float, true>(stream, num, num_classes, num_preds_per_class,
+                                                                     top_k, background_label_id, confidence_threshold,
+                                                                     conf_sigmoid, conf_data, conf_scores_gpu,
+                                                                     index_array_gpu, workspace);
+    // FP16 scores are widened to FP32 for the sort
+    case DataType::kHALF:
+        return sortScoresPerClassCompactFrom_gpu<float, __half, true>(stream, num, num_classes, num_preds_per_class,
+                                                                      top_k, background_label_id, confidence_threshold,
+                                                                      conf_sigmoid, conf_data, conf_scores_gpu,
+                                                                      index_array_gpu, workspace);
+    default: return STATUS_BAD_PARAM;
+    }
+}
+
 size_t sortScoresPerClassWorkspaceSize(
     const int num,
     const int num_classes,
     const int num_preds_per_class,
-    const DataType DT_CONF)
+    const DataType DT_CONF,
+    const bool compact)
 {
     size_t wss[4];
     const int arrayLen = num * num_classes * num_preds_per_class;
-    wss[0] = arrayLen * dataTypeSize(DT_CONF);      // temp scores
-    wss[1] = arrayLen * sizeof(int);                // temp indices
-    wss[2] = (num * num_classes + 1) * sizeof(int); // offsets
+    wss[0] = arrayLen * dataTypeSize(DT_CONF); // temp scores
+    wss[1] = arrayLen * sizeof(int);           // temp indices
+    // offsets, separate begin and end offsets when compacting
+    wss[2] = (compact ? 2 * num * num_classes : num * num_classes + 1) * sizeof(int);
     if (DT_CONF == DataType::kFLOAT)
     {
-        wss[3] = cubSortPairsWorkspaceSize<float, int>(arrayLen, num * num_classes); // cub workspace
+        // cub workspace, the compacting sort ping-pongs between the temp and output buffers instead of allocating its
+        // own copies of the keys and values
+        wss[3] = compact ? cubSortPairsDoubleBufferWorkspaceSize<float, int>(arrayLen, num * num_classes)
+                         : cubSortPairsWorkspaceSize<float, int>(arrayLen, num * num_classes);
     }
     else
     {
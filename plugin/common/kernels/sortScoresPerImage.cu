@@ -18,12 +18,14 @@
 #include "kernel.h"
 #include "bboxUtils.h"
 #include "cub_helper.h"
+#include "segmentedTopK.h"
 
 template <typename T_SCORE>
 pluginStatus_t sortScoresPerImage_gpu(
     cudaStream_t stream,
     const int num_images,
     const int num_items_per_image,
+    const int top_k,
     void* unsorted_scores,
     void* unsorted_bbox_indices,
     void* sorted_scores,
@@ -36,21 +38,17 @@ pluginStatus_t sortScoresPerImage_gpu(
     setUniformOffsets(stream, num_images, num_items_per_image, (int*) d_offsets);
 
     const int arrayLen = num_images * num_items_per_image;
-    size_t temp_storage_bytes = cubSortPairsWorkspaceSize<T_SCORE, int>(arrayLen, num_images);
-    cub::DeviceSegmentedRadixSort::SortPairsDescending(
-        cubWorkspace, temp_storage_bytes,
-        (const T_SCORE*) (unsorted_scores), (T_SCORE*) (sorted_scores),
-        (const int*) (unsorted_bbox_indices), (int*) (sorted_bbox_indices),
-        arrayLen, num_images,
-        (const int*) d_offsets, (const int*) d_offsets + 1,
-        0, sizeof(T_SCORE) * 8,
-        stream);
-    CSC(cudaGetLastError(), STATUS_FAILURE);
-    return STATUS_SUCCESS;
+    size_t temp_storage_bytes = segmentedTopKWorkspaceSize<T_SCORE, int>(arrayLen, num_images, top_k);
+    return segmentedTopK(stream, arrayLen, num_images, top_k,
+                         (const T_SCORE*) (unsorted_scores), (T_SCORE*) (sorted_scores),
+                         (const int*) (unsorted_bbox_indices), (int*) (sorted_bbox_indices),
+                         (const int*) d_offsets, (const int*) d_offsets + 1,
+                         cubWorkspace, temp_storage_bytes);
 }
 
 // sortScoresPerImage LAUNCH CONFIG
 typedef pluginStatus_t (*sspiFunc)(cudaStream_t,
+                                const int,
                                 const int,
                                 const int,
                                 void*,
@@ -92,6 +90,7 @@ pluginStatus_t sortScoresPerImage(
     cudaStream_t stream,
     const int num_images,
     const int num_items_per_image,
+    const int top_k,
     const DataType DT_SCORE,
     void* unsorted_scores,
     void* unsorted_bbox_indices,
@@ -108,6 +107,7 @@ pluginStatus_t sortScoresPerImage(
             return sspiFuncVec[i].function(stream,
                                            num_images,
                                            num_items_per_image,
+                                           top_k,
                                            unsorted_scores,
                                            unsorted_bbox_indices,
                                            sorted_scores,
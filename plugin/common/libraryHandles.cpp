@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "libraryHandles.h"
+#include <cuda_runtime.h>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+namespace
+{
+struct DeviceHandles
+{
+    int references{0};
+    std::map<std::thread::id, cublasHandle_t> cublas;
+#ifdef PLUGIN_CUBLASLT
+    cublasLtHandle_t cublasLt{nullptr};
+#endif
+};
+
+std::mutex gLibraryHandlesMutex;
+std::map<int, DeviceHandles> gLibraryHandles;
+
+DeviceHandles& currentDeviceHandles()
+{
+    int device{0};
+    cudaGetDevice(&device);
+    return gLibraryHandles[device];
+}
+
+void destroy(DeviceHandles& handles)
+{
+    for (auto& h : handles.cublas)
+    {
+        cublasDestroy(h.second);
+    }
+    handles.cublas.clear();
+#ifdef PLUGIN_CUBLASLT
+    if (handles.cublasLt)
+    {
+        cublasLtDestroy(handles.cublasLt);
+        handles.cublasLt = nullptr;
+    }
+#endif
+}
+} // namespace
+
+void acquireLibraryHandles()
+{
+    std::lock_guard<std::mutex> lock(gLibraryHandlesMutex);
+    ++currentDeviceHandles().references;
+}
+
+void releaseLibraryHandles()
+{
+    std::lock_guard<std::mutex> lock(gLibraryHandlesMutex);
+    auto& handles = currentDeviceHandles();
+    if (handles.references > 0 && --handles.references == 0)
+    {
+        destroy(handles);
+    }
+}
+
+cublasHandle_t getCublasHandle()
+{
+    std::lock_guard<std::mutex> lock(gLibraryHandlesMutex);
+    auto& handle = currentDeviceHandles().cublas[std::this_thread::get_id()];
+    if (!handle && cublasCreate(&handle) != CUBLAS_STATUS_SUCCESS)
+    {
+        handle = nullptr;
+    }
+    return handle;
+}
+
+#ifdef PLUGIN_CUBLASLT
+cublasLtHandle_t getCublasLtHandle()
+{
+    std::lock_guard<std::mutex> lock(gLibraryHandlesMutex);
+    auto& handle = currentDeviceHandles().cublasLt;
+    if (!handle && cublasLtCreate(&handle) != CUBLAS_STATUS_SUCCESS)
+    {
+        handle = nullptr;
+    }
+    return handle;
+}
+#endif
+
+} // namespace plugin
+} // namespace nvinfer1
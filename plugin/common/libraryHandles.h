@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_LIBRARY_HANDLES_H
+#define TRT_LIBRARY_HANDLES_H
+#include <cublas_v2.h>
+#include <cuda.h>
+// The libraries of the plugin families without cuBLASLt users do not link it
+#if CUDA_VERSION >= 10010 && !defined(PLUGIN_WITHOUT_CUBLASLT)
+#define PLUGIN_CUBLASLT 1
+#include <cublasLt.h>
+#endif
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+//!
+//! \brief Take a reference on the library handles of the current device, from the initialize() of a plugin
+//!
+//! The handles are shared by all the plugins of the process instead of being created by each instance, which costs
+//! time and device memory for every layer of every execution context. They are created at their first use and
+//! destroyed when the last reference on their device is released.
+//!
+void acquireLibraryHandles();
+
+//!
+//! \brief Release a reference taken by acquireLibraryHandles, from the terminate() of the plugin on the same device
+//!
+void releaseLibraryHandles();
+
+//!
+//! \brief The cuBLAS handle of the current device for the calling thread
+//!
+//! A cuBLAS handle holds its stream and its math and pointer modes, which plugins set before each call, so each thread
+//! enqueuing on the device has its own. Valid until the references on the device are all released.
+//!
+cublasHandle_t getCublasHandle();
+
+#ifdef PLUGIN_CUBLASLT
+//!
+//! \brief The cuBLASLt handle of the current device, shared by all threads since cuBLASLt calls take their stream
+//!
+cublasLtHandle_t getCublasLtHandle();
+#endif
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_LIBRARY_HANDLES_H
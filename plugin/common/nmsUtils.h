@@ -21,6 +21,7 @@
 using namespace nvinfer1;
 using namespace nvinfer1::plugin;
 
+// compactScores: the per-class sort only handles the candidates above the score threshold, see sortScoresPerClass
 size_t detectionInferenceWorkspaceSize(bool shareLocation, int N, int C1, int C2, int numClasses, int numPredsPerClass,
-    int topK, DataType DT_BBOX, DataType DT_SCORE);
+    int topK, DataType DT_BBOX, DataType DT_SCORE, bool compactScores = false);
 #endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "pluginAllocator.h"
+#include <atomic>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+namespace
+{
+std::atomic<IGpuAllocator*> gPluginAllocator{nullptr};
+} // namespace
+
+void setPluginGpuAllocator(IGpuAllocator* allocator)
+{
+    gPluginAllocator = allocator;
+}
+
+IGpuAllocator* getPluginGpuAllocator()
+{
+    return gPluginAllocator;
+}
+
+cudaError_t pluginMalloc(void** ptr, size_t size)
+{
+    IGpuAllocator* allocator = gPluginAllocator;
+    if (!allocator)
+    {
+        return cudaMalloc(ptr, size);
+    }
+    *ptr = allocator->allocate(size, 0, 0);
+    return *ptr || !size ? cudaSuccess : cudaErrorMemoryAllocation;
+}
+
+cudaError_t pluginFree(void* ptr)
+{
+    IGpuAllocator* allocator = gPluginAllocator;
+    if (!allocator)
+    {
+        return cudaFree(ptr);
+    }
+    allocator->free(ptr);
+    return cudaSuccess;
+}
+
+} // namespace plugin
+} // namespace nvinfer1
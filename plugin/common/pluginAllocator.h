@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_PLUGIN_ALLOCATOR_H
+#define TRT_PLUGIN_ALLOCATOR_H
+#include "NvInferRuntimeCommon.h"
+#include <cuda_runtime.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+//!
+//! \brief Set the allocator used for the device memory owned by plugins, nullptr restores cudaMalloc and cudaFree
+//!
+//! The allocator must outlive all the plugins, and it should be set before any plugin is initialized so that memory is
+//! released by the allocator that acquired it.
+//!
+void setPluginGpuAllocator(IGpuAllocator* allocator);
+
+IGpuAllocator* getPluginGpuAllocator();
+
+//!
+//! \brief Allocate plugin device memory, weights or scratch space, with the plugin allocator if one is set
+//!
+//! The signature follows cudaMalloc so that calls can be wrapped in the existing error checking macros.
+//!
+cudaError_t pluginMalloc(void** ptr, size_t size);
+
+//!
+//! \brief Release device memory acquired with pluginMalloc
+//!
+cudaError_t pluginFree(void* ptr);
+
+template <typename T>
+cudaError_t pluginMalloc(T** ptr, size_t size)
+{
+    return pluginMalloc(reinterpret_cast<void**>(ptr), size);
+}
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_PLUGIN_ALLOCATOR_H
@@ -17,11 +17,16 @@
 #include "NvInfer.h"
 
 #include "cropAndResizePlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <cassert>
 #include <cstring>
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::CropAndResizeDynamic;
+using nvinfer1::plugin::CropAndResizeDynamicPluginCreator;
 using nvinfer1::plugin::CropAndResizePlugin;
 using nvinfer1::plugin::CropAndResizePluginCreator;
 
@@ -30,11 +35,43 @@ namespace
 {
 static const char* CROP_AND_RESIZE_PLUGIN_VERSION{"1"};
 static const char* CROP_AND_RESIZE_PLUGIN_NAME{"CropAndResize"};
+static const char* CROP_AND_RESIZE_DYNAMIC_PLUGIN_NAME{"CropAndResizeDynamic"};
+
+void addCropAndResizeFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("crop_width", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("crop_height", nullptr, PluginFieldType::kINT32, 1));
+}
+
+void parseCropAndResizeFields(const PluginFieldCollection* fc, int& crop_width, int& crop_height)
+{
+    const PluginField* fields = fc->fields;
+    int nbFields = fc->nbFields;
+
+    for (int i = 0; i < nbFields; ++i)
+    {
+        ASSERT(fields[i].type == PluginFieldType::kINT32);
+
+        if (!strcmp(fields[i].name, "crop_width"))
+        {
+            crop_width = *(reinterpret_cast<const int*>(fields[i].data));
+        }
+
+        if (!strcmp(fields[i].name, "crop_height"))
+        {
+            crop_height = *(reinterpret_cast<const int*>(fields[i].data));
+        }
+    }
+
+    ASSERT(crop_width > 0 && crop_height > 0);
+}
 } // namespace
 
 // Static class fields initialization
 PluginFieldCollection CropAndResizePluginCreator::mFC{};
 std::vector<PluginField> CropAndResizePluginCreator::mPluginAttributes;
+PluginFieldCollection CropAndResizeDynamicPluginCreator::mFC{};
+std::vector<PluginField> CropAndResizeDynamicPluginCreator::mPluginAttributes;
 
 // Helper function for serializing plugin
 template <typename T>
@@ -78,7 +115,15 @@ CropAndResizePlugin::CropAndResizePlugin(const std::string name, const void* ser
     mInputHeight = readFromBuffer<size_t>(d);
     mDepth = readFromBuffer<size_t>(d);
     mNumboxes = readFromBuffer<size_t>(d);
-    ASSERT(d == a + sizeof(size_t) * 6);
+    // Engines serialized before the vectorized formats were added only support FP32 linear
+    if (d < a + serial_size)
+    {
+        mPrecision = readFromBuffer<DataType>(d);
+        mFormat = readFromBuffer<TensorFormat>(d);
+        mInputScale = readFromBuffer<float>(d);
+        mOutputScale = readFromBuffer<float>(d);
+    }
+    ASSERT(d == a + serial_size);
 }
 
 CropAndResizePlugin::CropAndResizePlugin(const std::string name, int crop_width, int crop_height, int depth,
@@ -130,18 +175,22 @@ int CropAndResizePlugin::initialize()
 
 int CropAndResizePlugin::enqueue(int batchSize, const void* const* inputs, void** outputs, void*, cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
     int status = -1;
     // Our plugin outputs only one tensor
     void* output = outputs[0];
     // Launch CUDA kernel wrapper and save its return value
     status = cropAndResizeInference(stream, mDepth * mInputHeight * mInputWidth * batchSize, inputs[0], inputs[1],
-        batchSize, mInputHeight, mInputWidth, mNumboxes, mCropHeight, mCropWidth, mDepth, output);
+        batchSize, mInputHeight, mInputWidth, mNumboxes, mCropHeight, mCropWidth, mDepth, mPrecision, mFormat,
+        mInputScale, mOutputScale, output);
     return status;
 }
 
 size_t CropAndResizePlugin::getSerializationSize() const
 {
-    return 6 * sizeof(size_t);
+    return 6 * sizeof(size_t) + sizeof(DataType) + sizeof(TensorFormat) + 2 * sizeof(float);
 }
 
 void CropAndResizePlugin::serialize(void* buffer) const
@@ -154,19 +203,35 @@ void CropAndResizePlugin::serialize(void* buffer) const
     writeToBuffer<size_t>(d, mInputHeight);
     writeToBuffer<size_t>(d, mDepth);
     writeToBuffer<size_t>(d, mNumboxes);
+    writeToBuffer<DataType>(d, mPrecision);
+    writeToBuffer<TensorFormat>(d, mFormat);
+    writeToBuffer<float>(d, mInputScale);
+    writeToBuffer<float>(d, mOutputScale);
     ASSERT(d == a + getSerializationSize());
 }
 
-bool CropAndResizePlugin::supportsFormat(DataType type, PluginFormat format) const
+bool CropAndResizePlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
 {
-    // This plugin only supports ordinary floats, and NCHW input format
-    if (type == DataType::kFLOAT && format == PluginFormat::kNCHW)
+    ASSERT(nbInputs == 2 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    // The boxes are ordinary floats in NCHW format
+    if (pos == 1)
     {
-        return true;
+        return inOut[1].type == DataType::kFLOAT && inOut[1].format == TensorFormat::kLINEAR;
     }
-    else
+    // The crops have the type and format of the image
+    if (pos == 2)
     {
-        return false;
+        return inOut[2].type == inOut[0].type && inOut[2].format == inOut[0].format;
+    }
+    switch (inOut[0].type)
+    {
+    case DataType::kFLOAT: return inOut[0].format == TensorFormat::kLINEAR;
+    case DataType::kHALF:
+        return inOut[0].format == TensorFormat::kLINEAR || inOut[0].format == TensorFormat::kHWC8
+            || inOut[0].format == TensorFormat::kCHW16;
+    case DataType::kINT8: return inOut[0].format == TensorFormat::kCHW32;
+    default: return false;
     }
 }
 
@@ -180,8 +245,7 @@ void CropAndResizePlugin::destroy()
 
 IPluginV2Ext* CropAndResizePlugin::clone() const
 {
-    IPluginV2Ext* plugin
-        = new CropAndResizePlugin(mLayerName, mCropWidth, mCropHeight, mDepth, mInputWidth, mInputHeight, mNumboxes);
+    IPluginV2Ext* plugin = new CropAndResizePlugin(*this);
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
@@ -199,9 +263,9 @@ const char* CropAndResizePlugin::getPluginNamespace() const
 // Return the DataType of the plugin output at the requested index.
 DataType CropAndResizePlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
-    // one outputs
+    // one outputs, with the type of the image
     ASSERT(index == 0);
-    return DataType::kFLOAT;
+    return inputTypes[0];
 }
 // Return true if output tensor is broadcast across a batch.
 bool CropAndResizePlugin::isOutputBroadcastAcrossBatch(
@@ -216,19 +280,21 @@ bool CropAndResizePlugin::canBroadcastInputAcrossBatch(int inputIndex) const
     return false;
 }
 
-void CropAndResizePlugin::configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
-    const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
-    const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
+void CropAndResizePlugin::configurePlugin(
+    const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
 {
-    ASSERT(
-        inputTypes[0] == DataType::kFLOAT && inputTypes[1] == DataType::kFLOAT && floatFormat == PluginFormat::kNCHW);
-
-    ASSERT(nbInputs == 2);
-    ASSERT(nbOutputs == 1);
-    mDepth = inputDims[0].d[0];
-    mInputHeight = inputDims[0].d[1];
-    mInputWidth = inputDims[0].d[2];
-    mNumboxes = inputDims[1].d[0];
+    ASSERT(in[1].type == DataType::kFLOAT && in[1].format == TensorFormat::kLINEAR);
+
+    ASSERT(nbInput == 2);
+    ASSERT(nbOutput == 1);
+    mDepth = in[0].dims.d[0];
+    mInputHeight = in[0].dims.d[1];
+    mInputWidth = in[0].dims.d[2];
+    mNumboxes = in[1].dims.d[0];
+    mPrecision = in[0].type;
+    mFormat = in[0].format;
+    mInputScale = in[0].scale;
+    mOutputScale = out[0].scale;
 }
 
 // Attach the plugin object to an execution context and grant the plugin the access to some context resource.
@@ -242,8 +308,7 @@ void CropAndResizePlugin::detachFromContext() {}
 
 CropAndResizePluginCreator::CropAndResizePluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("crop_width", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("crop_height", nullptr, PluginFieldType::kINT32, 1));
+    addCropAndResizeFields(mPluginAttributes);
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -267,36 +332,210 @@ const PluginFieldCollection* CropAndResizePluginCreator::getFieldNames()
 
 IPluginV2Ext* CropAndResizePluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    int nbFields = fc->nbFields;
     int crop_width = 0, crop_height = 0;
+    parseCropAndResizeFields(fc, crop_width, crop_height);
+    IPluginV2Ext* plugin = new CropAndResizePlugin(name, crop_width, crop_height);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
 
-    for (int i = 0; i < nbFields; ++i)
-    {
-        ASSERT(fields[i].type == PluginFieldType::kINT32);
+IPluginV2Ext* CropAndResizePluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    // This object will be deleted when the network is destroyed,
+    IPluginV2Ext* plugin = new CropAndResizePlugin(name, serialData, serialLength);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
 
-        if (!strcmp(fields[i].name, "crop_width"))
-        {
-            crop_width = *(reinterpret_cast<const int*>(fields[i].data));
-        }
+CropAndResizeDynamic::CropAndResizeDynamic(const std::string name, int crop_width, int crop_height)
+    : mLayerName(name)
+    , mCropWidth(crop_width)
+    , mCropHeight(crop_height)
+{
+}
 
-        if (!strcmp(fields[i].name, "crop_height"))
-        {
-            crop_height = *(reinterpret_cast<const int*>(fields[i].data));
-        }
+CropAndResizeDynamic::CropAndResizeDynamic(const std::string name, const void* serial_buf, size_t serial_size)
+    : mLayerName(name)
+{
+    const char* d = reinterpret_cast<const char*>(serial_buf);
+    const char* a = d;
+    ASSERT(serial_size == 2 * sizeof(int));
+    mCropWidth = readFromBuffer<int>(d);
+    mCropHeight = readFromBuffer<int>(d);
+    ASSERT(d == a + serial_size);
+}
+
+const char* CropAndResizeDynamic::getPluginType() const
+{
+    return CROP_AND_RESIZE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* CropAndResizeDynamic::getPluginVersion() const
+{
+    return CROP_AND_RESIZE_PLUGIN_VERSION;
+}
+
+int CropAndResizeDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs CropAndResizeDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 2);
+    ASSERT(inputs[0].nbDims == 4 && inputs[1].nbDims == 4);
+    DimsExprs output;
+    output.nbDims = 5;
+    output.d[0] = inputs[0].d[0];
+    output.d[1] = inputs[1].d[1];
+    output.d[2] = inputs[0].d[1];
+    output.d[3] = exprBuilder.constant(mCropHeight);
+    output.d[4] = exprBuilder.constant(mCropWidth);
+    return output;
+}
+
+int CropAndResizeDynamic::initialize()
+{
+    return 0;
+}
+
+void CropAndResizeDynamic::terminate() {}
+
+size_t CropAndResizeDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return 0;
+}
+
+int CropAndResizeDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    const Dims& image = inputDesc[0].dims;
+    const int batchSize = image.d[0];
+    const int depth = image.d[1];
+    const int inputHeight = image.d[2];
+    const int inputWidth = image.d[3];
+    const int numBoxes = inputDesc[1].dims.d[1];
+    return cropAndResizeInference(stream, depth * inputHeight * inputWidth * batchSize, inputs[0], inputs[1],
+        batchSize, inputHeight, inputWidth, numBoxes, mCropHeight, mCropWidth, depth, inputDesc[0].type,
+        inputDesc[0].format, inputDesc[0].scale, outputDesc[0].scale, outputs[0]);
+}
+
+size_t CropAndResizeDynamic::getSerializationSize() const
+{
+    return 2 * sizeof(int);
+}
+
+void CropAndResizeDynamic::serialize(void* buffer) const
+{
+    char* d = reinterpret_cast<char*>(buffer);
+    char* a = d;
+    writeToBuffer<int>(d, mCropWidth);
+    writeToBuffer<int>(d, mCropHeight);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void CropAndResizeDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 4 && in[1].desc.dims.nbDims == 4);
+}
+
+bool CropAndResizeDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 2 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    // Same combinations as CropAndResizePlugin
+    if (pos == 1)
+    {
+        return inOut[1].type == DataType::kFLOAT && inOut[1].format == TensorFormat::kLINEAR;
+    }
+    if (pos == 2)
+    {
+        return inOut[2].type == inOut[0].type && inOut[2].format == inOut[0].format;
+    }
+    switch (inOut[0].type)
+    {
+    case DataType::kFLOAT: return inOut[0].format == TensorFormat::kLINEAR;
+    case DataType::kHALF:
+        return inOut[0].format == TensorFormat::kLINEAR || inOut[0].format == TensorFormat::kHWC8
+            || inOut[0].format == TensorFormat::kCHW16;
+    case DataType::kINT8: return inOut[0].format == TensorFormat::kCHW32;
+    default: return false;
     }
+}
 
-    ASSERT(crop_width > 0 && crop_height > 0);
-    IPluginV2Ext* plugin = new CropAndResizePlugin(name, crop_width, crop_height);
+void CropAndResizeDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* CropAndResizeDynamic::clone() const
+{
+    IPluginV2DynamicExt* plugin = new CropAndResizeDynamic(*this);
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
 
-IPluginV2Ext* CropAndResizePluginCreator::deserializePlugin(
+void CropAndResizeDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* CropAndResizeDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType CropAndResizeDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+CropAndResizeDynamicPluginCreator::CropAndResizeDynamicPluginCreator()
+{
+    addCropAndResizeFields(mPluginAttributes);
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* CropAndResizeDynamicPluginCreator::getPluginName() const
+{
+    return CROP_AND_RESIZE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* CropAndResizeDynamicPluginCreator::getPluginVersion() const
+{
+    return CROP_AND_RESIZE_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* CropAndResizeDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* CropAndResizeDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    int crop_width = 0, crop_height = 0;
+    parseCropAndResizeFields(fc, crop_width, crop_height);
+    IPluginV2DynamicExt* plugin = new CropAndResizeDynamic(name, crop_width, crop_height);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* CropAndResizeDynamicPluginCreator::deserializePlugin(
     const char* name, const void* serialData, size_t serialLength)
 {
-    // This object will be deleted when the network is destroyed,
-    IPluginV2Ext* plugin = new CropAndResizePlugin(name, serialData, serialLength);
+    IPluginV2DynamicExt* plugin = new CropAndResizeDynamic(name, serialData, serialLength);
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
@@ -26,14 +26,15 @@
 using namespace nvinfer1::plugin;
 
 // One of the preferred ways of making TensorRT to be able to see
-// our custom layer requires extending IPluginV2Ext and BaseCreator classes.
+// our custom layer requires extending IPluginV2IOExt and BaseCreator classes.
+// IPluginV2IOExt is needed for the per-tensor formats and INT8 scales.
 // For requirements for overriden functions, check TensorRT API docs.
 namespace nvinfer1
 {
 namespace plugin
 {
 
-class CropAndResizePlugin : public IPluginV2Ext
+class CropAndResizePlugin : public IPluginV2IOExt
 {
 public:
     CropAndResizePlugin(const std::string name);
@@ -67,8 +68,6 @@ public:
 
     void serialize(void* buffer) const override;
 
-    bool supportsFormat(DataType type, PluginFormat format) const override;
-
     const char* getPluginType() const override;
 
     const char* getPluginVersion() const override;
@@ -90,15 +89,78 @@ public:
     void attachToContext(
         cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override;
 
-    void configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
-        const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
-        const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize) override;
+    void configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
 
     void detachFromContext() override;
 
 private:
     const std::string mLayerName;
     size_t mInputWidth, mInputHeight, mNumboxes, mCropHeight, mCropWidth, mDepth;
+    // Type and format of the image and the crops, the boxes are always FP32 linear
+    DataType mPrecision{DataType::kFLOAT};
+    TensorFormat mFormat{TensorFormat::kLINEAR};
+    float mInputScale{-1.f};
+    float mOutputScale{-1.f};
+    std::string mNamespace;
+};
+
+// Explicit batch version of CropAndResizePlugin. The inputs are the feature maps [N, C, H, W] and the rois
+// [N, B, 4, 1], the output is [N, B, C, crop_height, crop_width]. All the shapes are read at enqueue time.
+class CropAndResizeDynamic : public IPluginV2DynamicExt
+{
+public:
+    CropAndResizeDynamic(const std::string name, int crop_width, int crop_height);
+
+    CropAndResizeDynamic(const std::string name, const void* serial_buf, size_t serial_size);
+
+    CropAndResizeDynamic() = delete;
+
+    ~CropAndResizeDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    const std::string mLayerName;
+    int mCropWidth;
+    int mCropHeight;
     std::string mNamespace;
 };
 
@@ -125,6 +187,29 @@ private:
     std::string mNamespace;
 };
 
+// Takes the same fields as CropAndResize
+class CropAndResizeDynamicPluginCreator : public BaseCreator
+{
+public:
+    CropAndResizeDynamicPluginCreator();
+
+    ~CropAndResizeDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
 } // namespace plugin
 
 } // namespace nvinfer1
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ctcDecoderKernels.h"
+#include <cuda_fp16.h>
+#include <math_constants.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+constexpr int kThreads = 256;
+constexpr int kMaxCandidates = kMaxCTCBeamWidth * (kMaxCTCBeamWidth + 1);
+// FNV-1a, a prefix is identified by the hash of its tokens
+constexpr unsigned long long kHashSeed = 0xcbf29ce484222325ULL;
+constexpr unsigned long long kHashPrime = 0x100000001b3ULL;
+
+__device__ inline float toFloat(float x)
+{
+    return x;
+}
+
+__device__ inline float toFloat(__half x)
+{
+    return __half2float(x);
+}
+
+__device__ inline unsigned long long extendHash(unsigned long long hash, int token)
+{
+    return (hash ^ static_cast<unsigned long long>(token + 1)) * kHashPrime;
+}
+
+// log(exp(a) + exp(b)) for probabilities that may be zero
+__device__ inline float logAdd(float a, float b)
+{
+    if (a == -CUDART_INF_F)
+    {
+        return b;
+    }
+    if (b == -CUDART_INF_F)
+    {
+        return a;
+    }
+    return fmaxf(a, b) + log1pf(expf(-fabsf(a - b)));
+}
+
+// The maximum, or the sum, of the values of the block
+__device__ float blockReduce(float value, float* values, bool maximum)
+{
+    values[threadIdx.x] = value;
+    __syncthreads();
+    for (int stride = blockDim.x / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+        {
+            const float other = values[threadIdx.x + stride];
+            values[threadIdx.x] = maximum ? fmaxf(values[threadIdx.x], other) : values[threadIdx.x] + other;
+        }
+        __syncthreads();
+    }
+    const float result = values[0];
+    __syncthreads();
+    return result;
+}
+
+// Index of the largest value of the block, the lowest index among ties, or -1 if all the values are -inf
+__device__ int blockArgMax(float value, int index, float* values, int* indices)
+{
+    values[threadIdx.x] = value;
+    indices[threadIdx.x] = index;
+    __syncthreads();
+    for (int stride = blockDim.x / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+        {
+            const float other = values[threadIdx.x + stride];
+            const int otherIndex = indices[threadIdx.x + stride];
+            if (other > values[threadIdx.x] || (other == values[threadIdx.x] && otherIndex < indices[threadIdx.x]))
+            {
+                values[threadIdx.x] = other;
+                indices[threadIdx.x] = otherIndex;
+            }
+        }
+        __syncthreads();
+    }
+    const int best = values[0] == -CUDART_INF_F ? -1 : indices[0];
+    __syncthreads();
+    return best;
+}
+
+// One block per sequence, a tile of frames per pass with one thread per frame. The kept tokens of a tile are
+// compacted by a scan of their flags, the argmax of the last frame of a tile carries over to the next one.
+template <typename T>
+__global__ void ctcGreedyKernel(int frames, int vocab, int blank, const T* scores, const int* lengths, int* tokens,
+    int* counts)
+{
+    __shared__ int best[kThreads];
+    __shared__ int offsets[kThreads];
+    const int sequence = blockIdx.x;
+    const int valid = lengths ? min(max(lengths[sequence], 0), frames) : frames;
+    const T* sequenceScores = scores + static_cast<size_t>(sequence) * frames * vocab;
+    int* sequenceTokens = tokens + static_cast<size_t>(sequence) * frames;
+
+    int written{0};
+    int previous{-1};
+    for (int tile = 0; tile < valid; tile += blockDim.x)
+    {
+        const int t = tile + threadIdx.x;
+        int token{-1};
+        if (t < valid)
+        {
+            const T* frame = sequenceScores + static_cast<size_t>(t) * vocab;
+            float bestScore = toFloat(frame[0]);
+            token = 0;
+            for (int v = 1; v < vocab; ++v)
+            {
+                const float score = toFloat(frame[v]);
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    token = v;
+                }
+            }
+        }
+        best[threadIdx.x] = token;
+        __syncthreads();
+        const int before = threadIdx.x ? best[threadIdx.x - 1] : previous;
+        const int keep = token >= 0 && token != blank && token != before;
+        offsets[threadIdx.x] = keep;
+        __syncthreads();
+        for (int stride = 1; stride < blockDim.x; stride *= 2)
+        {
+            const int add = threadIdx.x >= stride ? offsets[threadIdx.x - stride] : 0;
+            __syncthreads();
+            offsets[threadIdx.x] += add;
+            __syncthreads();
+        }
+        if (keep)
+        {
+            sequenceTokens[written + offsets[threadIdx.x] - 1] = token;
+        }
+        written += offsets[blockDim.x - 1];
+        previous = best[blockDim.x - 1];
+        __syncthreads();
+    }
+    for (int t = written + threadIdx.x; t < frames; t += blockDim.x)
+    {
+        sequenceTokens[t] = -1;
+    }
+    if (threadIdx.x == 0)
+    {
+        counts[sequence] = written;
+    }
+}
+
+struct Beam
+{
+    unsigned long long hash;
+    float blank;    // Log probability of the prefix with the frames so far ending in a blank
+    float nonBlank; // Ending in its last token
+    int last;       // Last token, -1 for the empty prefix
+    int node;       // Node of the last token in the prefix tree, -1 for the empty prefix
+    int length;
+};
+
+struct Node
+{
+    int parent;
+    int token;
+};
+
+// One block per sequence. Candidate i extends beam i / (beamWidth + 1) with the i % (beamWidth + 1)-th most likely
+// token of the frame, the last one keeps the prefix of the beam, for a blank or a repeat of its last token.
+template <typename T>
+__global__ void ctcBeamSearchKernel(int frames, int vocab, int blank, int beamWidth, const T* scores,
+    const int* lengths, const float* lm, float lmWeight, float insertionBonus, int* tokens, int* counts, Node* tree)
+{
+    extern __shared__ float logProbs[];
+    __shared__ Beam beams[kMaxCTCBeamWidth];
+    __shared__ Beam next[kMaxCTCBeamWidth];
+    __shared__ int top[kMaxCTCBeamWidth];
+    __shared__ float candidateBlank[kMaxCandidates];
+    __shared__ float candidateNonBlank[kMaxCandidates];
+    __shared__ float candidateScore[kMaxCandidates];
+    __shared__ float reduceValues[kThreads];
+    __shared__ int reduceIndices[kThreads];
+    __shared__ int nbBeams;
+    __shared__ int nbTop;
+
+    const int sequence = blockIdx.x;
+    const int valid = lengths ? min(max(lengths[sequence], 0), frames) : frames;
+    const T* sequenceScores = scores + static_cast<size_t>(sequence) * frames * vocab;
+    Node* sequenceTree = tree + static_cast<size_t>(sequence) * frames * beamWidth;
+    const int options = beamWidth + 1;
+
+    if (threadIdx.x == 0)
+    {
+        beams[0] = Beam{kHashSeed, 0.F, -CUDART_INF_F, -1, -1, 0};
+        nbBeams = 1;
+    }
+    __syncthreads();
+
+    for (int t = 0; t < valid; ++t)
+    {
+        // Log softmax of the frame
+        const T* frame = sequenceScores + static_cast<size_t>(t) * vocab;
+        float localMax{-CUDART_INF_F};
+        for (int v = threadIdx.x; v < vocab; v += blockDim.x)
+        {
+            logProbs[v] = toFloat(frame[v]);
+            localMax = fmaxf(localMax, logProbs[v]);
+        }
+        const float frameMax = blockReduce(localMax, reduceValues, true);
+        float localSum{0.F};
+        for (int v = threadIdx.x; v < vocab; v += blockDim.x)
+        {
+            localSum += expf(logProbs[v] - frameMax);
+        }
+        const float logNorm = frameMax + logf(blockReduce(localSum, reduceValues, false));
+        for (int v = threadIdx.x; v < vocab; v += blockDim.x)
+        {
+            logProbs[v] -= logNorm;
+        }
+        __syncthreads();
+
+        // The most likely tokens of the frame, blank excepted
+        if (threadIdx.x == 0)
+        {
+            nbTop = 0;
+        }
+        __syncthreads();
+        for (int r = 0; r < beamWidth && r < vocab - 1; ++r)
+        {
+            float localBest{-CUDART_INF_F};
+            int localToken{vocab};
+            for (int v = threadIdx.x; v < vocab; v += blockDim.x)
+            {
+                bool taken = v == blank;
+                for (int p = 0; p < r && !taken; ++p)
+                {
+                    taken = top[p] == v;
+                }
+                if (!taken && logProbs[v] > localBest)
+                {
+                    localBest = logProbs[v];
+                    localToken = v;
+                }
+            }
+            const int token = blockArgMax(localBest, localToken, reduceValues, reduceIndices);
+            if (token < 0)
+            {
+                break;
+            }
+            if (threadIdx.x == 0)
+            {
+                top[r] = token;
+                nbTop = r + 1;
+            }
+            __syncthreads();
+        }
+
+        // Score the candidates
+        const int nbCandidates = nbBeams * options;
+        for (int i = threadIdx.x; i < nbCandidates; i += blockDim.x)
+        {
+            const Beam& beam = beams[i / options];
+            const int option = i % options;
+            const float total = logAdd(beam.blank, beam.nonBlank);
+            float blankScore{-CUDART_INF_F};
+            float nonBlankScore{-CUDART_INF_F};
+            if (option == beamWidth)
+            {
+                blankScore = total + logProbs[blank];
+                nonBlankScore = beam.last >= 0 ? beam.nonBlank + logProbs[beam.last] : -CUDART_INF_F;
+            }
+            else if (option < nbTop)
+            {
+                const int c = top[option];
+                // A repeat of the last token only extends the prefix after a blank
+                nonBlankScore = (c == beam.last ? beam.blank : total) + logProbs[c] + insertionBonus;
+                if (lm)
+                {
+                    nonBlankScore += lmWeight * lm[static_cast<size_t>(beam.last < 0 ? blank : beam.last) * vocab + c];
+                }
+            }
+            candidateBlank[i] = blankScore;
+            candidateNonBlank[i] = nonBlankScore;
+        }
+        __syncthreads();
+
+        // An extension that reaches the prefix of another beam merges into the candidate keeping that beam. The
+        // prefix of a beam has one parent, so each kept candidate receives from one extension at most.
+        for (int i = threadIdx.x; i < nbCandidates; i += blockDim.x)
+        {
+            const int option = i % options;
+            if (option < nbTop && candidateNonBlank[i] != -CUDART_INF_F)
+            {
+                const unsigned long long hash = extendHash(beams[i / options].hash, top[option]);
+                for (int b = 0; b < nbBeams; ++b)
+                {
+                    if (beams[b].hash == hash)
+                    {
+                        const int kept = b * options + beamWidth;
+                        candidateNonBlank[kept] = logAdd(candidateNonBlank[kept], candidateNonBlank[i]);
+                        candidateNonBlank[i] = -CUDART_INF_F;
+                        break;
+                    }
+                }
+            }
+        }
+        __syncthreads();
+        for (int i = threadIdx.x; i < kMaxCandidates; i += blockDim.x)
+        {
+            candidateScore[i] = i < nbCandidates ? logAdd(candidateBlank[i], candidateNonBlank[i]) : -CUDART_INF_F;
+        }
+        __syncthreads();
+
+        // Keep the best candidates as the beams of the next frame
+        int selected{0};
+        for (; selected < beamWidth; ++selected)
+        {
+            float localBest{-CUDART_INF_F};
+            int localIndex{kMaxCandidates};
+            for (int i = threadIdx.x; i < nbCandidates; i += blockDim.x)
+            {
+                if (candidateScore[i] > localBest)
+                {
+                    localBest = candidateScore[i];
+                    localIndex = i;
+                }
+            }
+            const int winner = blockArgMax(localBest, localIndex, reduceValues, reduceIndices);
+            if (winner < 0)
+            {
+                break;
+            }
+            if (threadIdx.x == 0)
+            {
+                const Beam& beam = beams[winner / options];
+                const int option = winner % options;
+                Beam& chosen = next[selected];
+                chosen = beam;
+                chosen.blank = candidateBlank[winner];
+                chosen.nonBlank = candidateNonBlank[winner];
+                if (option != beamWidth)
+                {
+                    const int c = top[option];
+                    const int node = t * beamWidth + selected;
+                    sequenceTree[node] = Node{beam.node, c};
+                    chosen.hash = extendHash(beam.hash, c);
+                    chosen.last = c;
+                    chosen.node = node;
+                    chosen.length = beam.length + 1;
+                }
+                candidateScore[winner] = -CUDART_INF_F;
+            }
+            __syncthreads();
+        }
+        if (selected)
+        {
+            if (threadIdx.x < selected)
+            {
+                beams[threadIdx.x] = next[threadIdx.x];
+            }
+            if (threadIdx.x == 0)
+            {
+                nbBeams = selected;
+            }
+            __syncthreads();
+        }
+    }
+
+    // The beams are selected best first, walk the prefix tree back from the best one
+    int* sequenceTokens = tokens + static_cast<size_t>(sequence) * frames;
+    const int length = beams[0].length;
+    for (int t = length + threadIdx.x; t < frames; t += blockDim.x)
+    {
+        sequenceTokens[t] = -1;
+    }
+    if (threadIdx.x == 0)
+    {
+        int node = beams[0].node;
+        for (int p = length - 1; p >= 0; --p)
+        {
+            sequenceTokens[p] = sequenceTree[node].token;
+            node = sequenceTree[node].parent;
+        }
+        counts[sequence] = length;
+    }
+}
+
+} // namespace
+
+cudaError_t ctcGreedyDecode(cudaStream_t stream, int batch, int frames, int vocab, int blank, DataType scoreType,
+    const void* scores, const int* lengths, int* tokens, int* counts)
+{
+    if (!batch)
+    {
+        return cudaSuccess;
+    }
+    if (scoreType == DataType::kHALF)
+    {
+        ctcGreedyKernel<<<batch, kThreads, 0, stream>>>(
+            frames, vocab, blank, static_cast<const __half*>(scores), lengths, tokens, counts);
+    }
+    else
+    {
+        ctcGreedyKernel<<<batch, kThreads, 0, stream>>>(
+            frames, vocab, blank, static_cast<const float*>(scores), lengths, tokens, counts);
+    }
+    return cudaPeekAtLastError();
+}
+
+size_t ctcBeamSearchWorkspaceSize(int batch, int frames, int beamWidth)
+{
+    return static_cast<size_t>(batch) * frames * beamWidth * sizeof(Node);
+}
+
+cudaError_t ctcBeamSearch(cudaStream_t stream, int batch, int frames, int vocab, int blank, int beamWidth,
+    DataType scoreType, const void* scores, const int* lengths, const float* lm, float lmWeight, float insertionBonus,
+    int* tokens, int* counts, void* workspace)
+{
+    if (!batch)
+    {
+        return cudaSuccess;
+    }
+    const size_t sharedSize = vocab * sizeof(float);
+    auto* tree = static_cast<Node*>(workspace);
+    if (scoreType == DataType::kHALF)
+    {
+        ctcBeamSearchKernel<<<batch, kThreads, sharedSize, stream>>>(frames, vocab, blank, beamWidth,
+            static_cast<const __half*>(scores), lengths, lm, lmWeight, insertionBonus, tokens, counts, tree);
+    }
+    else
+    {
+        ctcBeamSearchKernel<<<batch, kThreads, sharedSize, stream>>>(frames, vocab, blank, beamWidth,
+            static_cast<const float*>(scores), lengths, lm, lmWeight, insertionBonus, tokens, counts, tree);
+    }
+    return cudaPeekAtLastError();
+}
+
+} // namespace plugin
+} // namespace nvinfer1
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_CTC_DECODER_KERNELS_H
+#define TRT_CTC_DECODER_KERNELS_H
+#include "NvInfer.h"
+#include <cuda_runtime.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Largest beam of ctcBeamSearch, the candidates of a frame are ranked in shared memory
+constexpr int kMaxCTCBeamWidth = 32;
+// Largest vocabulary of ctcBeamSearch, the log probabilities of a frame are staged in shared memory
+constexpr int kMaxCTCBeamVocab = 4096;
+
+// Collapses the frame by frame argmax of each of the batch sequences of frames x vocab FP32 or FP16 scores: repeated
+// tokens are merged and blanks are dropped. Only the first lengths[i] frames of sequence i are decoded when lengths is
+// not null. Writes the tokens of each sequence, padded with -1 to frames, and their count.
+cudaError_t ctcGreedyDecode(cudaStream_t stream, int batch, int frames, int vocab, int blank, DataType scoreType,
+    const void* scores, const int* lengths, int* tokens, int* counts);
+
+// Workspace of ctcBeamSearch, the prefix tree of the beams of every frame
+size_t ctcBeamSearchWorkspaceSize(int batch, int frames, int beamWidth);
+
+// Prefix beam search over the log softmax of the scores, one block per sequence. Each frame extends the beamWidth best
+// prefixes with the beamWidth most likely tokens of the frame, and prefixes reached in several ways merge their
+// probabilities. When lm is not null, each extension by token c after token p adds lmWeight * lm[p * vocab + c], the
+// log probability of a bigram language model, with the blank as the context of the first token, and every extension
+// adds insertionBonus. Writes the tokens of the best prefix, padded with -1, and their count.
+cudaError_t ctcBeamSearch(cudaStream_t stream, int batch, int frames, int vocab, int blank, int beamWidth,
+    DataType scoreType, const void* scores, const int* lengths, const float* lm, float lmWeight, float insertionBonus,
+    int* tokens, int* counts, void* workspace);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_CTC_DECODER_KERNELS_H
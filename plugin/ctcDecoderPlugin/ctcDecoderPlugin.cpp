@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ctcDecoderPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include "pluginAllocator.h"
+#include <cstring>
+
+using namespace nvinfer1;
+using namespace plugin;
+using nvinfer1::plugin::CTCDecoderPlugin;
+using nvinfer1::plugin::CTCDecoderPluginCreator;
+
+namespace
+{
+const char* CTC_DECODER_PLUGIN_VERSION{"1"};
+const char* CTC_DECODER_PLUGIN_NAME{"CTCDecoder_TRT"};
+} // namespace
+
+PluginFieldCollection CTCDecoderPluginCreator::mFC{};
+std::vector<PluginField> CTCDecoderPluginCreator::mPluginAttributes;
+
+CTCDecoderPluginCreator::CTCDecoderPluginCreator()
+{
+    mPluginAttributes.emplace_back(PluginField("blank_index", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("beam_width", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("lm_bigram", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("lm_weight", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("insertion_bonus", nullptr, PluginFieldType::kFLOAT32, 1));
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* CTCDecoderPluginCreator::getPluginName() const
+{
+    return CTC_DECODER_PLUGIN_NAME;
+}
+
+const char* CTCDecoderPluginCreator::getPluginVersion() const
+{
+    return CTC_DECODER_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* CTCDecoderPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* CTCDecoderPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    int blank{-1};
+    int beamWidth{1};
+    const float* lm{nullptr};
+    int lmCount{0};
+    float lmWeight{0.F};
+    float insertionBonus{0.F};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "blank_index"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            blank = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "beam_width"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            beamWidth = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "lm_bigram"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            lm = static_cast<const float*>(fields[i].data);
+            lmCount = fields[i].length;
+        }
+        else if (!strcmp(attrName, "lm_weight"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            lmWeight = *static_cast<const float*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "insertion_bonus"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            insertionBonus = *static_cast<const float*>(fields[i].data);
+        }
+    }
+    ASSERT(blank >= -1);
+    ASSERT(beamWidth >= 1 && beamWidth <= kMaxCTCBeamWidth);
+    // The language model is only used by the beam search
+    ASSERT(!lm || beamWidth > 1);
+    auto* plugin = new CTCDecoderPlugin(blank, beamWidth, lm, lmCount, lmWeight, insertionBonus);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* CTCDecoderPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
+{
+    auto* plugin = new CTCDecoderPlugin(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+CTCDecoderPlugin::CTCDecoderPlugin(
+    int blank, int beamWidth, const float* lm, int lmCount, float lmWeight, float insertionBonus)
+    : mBlank(blank)
+    , mBeamWidth(beamWidth)
+    , mLmWeight(lmWeight)
+    , mInsertionBonus(insertionBonus)
+    , mLm(std::make_shared<std::vector<float>>(lm, lm + (lm ? lmCount : 0)))
+{
+}
+
+CTCDecoderPlugin::CTCDecoderPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mBlank = read<int>(d);
+    mBeamWidth = read<int>(d);
+    mLmWeight = read<float>(d);
+    mInsertionBonus = read<float>(d);
+    mHasLengths = read<int>(d) != 0;
+    mScoreType = read<DataType>(d);
+    const int lmCount = read<int>(d);
+    const auto* lm = reinterpret_cast<const float*>(d);
+    mLm = std::make_shared<std::vector<float>>(lm, lm + lmCount);
+    d += lmCount * sizeof(float);
+    ASSERT(d == a + length);
+}
+
+int CTCDecoderPlugin::getNbOutputs() const
+{
+    return 2;
+}
+
+DimsExprs CTCDecoderPlugin::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex < 2 && (nbInputs == 1 || nbInputs == 2) && inputs[0].nbDims == 3);
+    // index 0: tokens [batch, frames], index 1: number of tokens [batch]
+    DimsExprs out;
+    out.nbDims = outputIndex == 0 ? 2 : 1;
+    out.d[0] = inputs[0].d[0];
+    out.d[1] = inputs[0].d[1];
+    return out;
+}
+
+int CTCDecoderPlugin::initialize()
+{
+    if (mLm->empty() || mDeviceLm)
+    {
+        return 0;
+    }
+    void* lm{nullptr};
+    const size_t size = mLm->size() * sizeof(float);
+    if (pluginMalloc(&lm, size) != cudaSuccess)
+    {
+        return 1;
+    }
+    mDeviceLm = std::shared_ptr<void>(lm, [](void* p) { pluginFree(p); });
+    return cudaMemcpy(lm, mLm->data(), size, cudaMemcpyHostToDevice) != cudaSuccess;
+}
+
+void CTCDecoderPlugin::terminate()
+{
+    mDeviceLm.reset();
+}
+
+size_t CTCDecoderPlugin::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return mBeamWidth > 1 ? ctcBeamSearchWorkspaceSize(inputs[0].dims.d[0], inputs[0].dims.d[1], mBeamWidth) : 0;
+}
+
+int CTCDecoderPlugin::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const int batch = inputDesc[0].dims.d[0];
+    const int frames = inputDesc[0].dims.d[1];
+    const int vocab = inputDesc[0].dims.d[2];
+    const int blank = mBlank < 0 ? vocab - 1 : mBlank;
+    const auto* lengths = mHasLengths ? static_cast<const int*>(inputs[1]) : nullptr;
+    auto* tokens = static_cast<int*>(outputs[0]);
+    auto* counts = static_cast<int*>(outputs[1]);
+    const cudaError_t status = mBeamWidth > 1
+        ? ctcBeamSearch(stream, batch, frames, vocab, blank, mBeamWidth, mScoreType, inputs[0], lengths,
+            static_cast<const float*>(mDeviceLm.get()), mLmWeight, mInsertionBonus, tokens, counts, workspace)
+        : ctcGreedyDecode(stream, batch, frames, vocab, blank, mScoreType, inputs[0], lengths, tokens, counts);
+    return status != cudaSuccess;
+}
+
+size_t CTCDecoderPlugin::getSerializationSize() const
+{
+    // blank, beam width, LM weight, insertion bonus, lengths, score type, LM count, LM
+    return sizeof(int) * 2 + sizeof(float) * 2 + sizeof(int) + sizeof(DataType) + sizeof(int)
+        + mLm->size() * sizeof(float);
+}
+
+void CTCDecoderPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mBlank);
+    write(d, mBeamWidth);
+    write(d, mLmWeight);
+    write(d, mInsertionBonus);
+    write(d, static_cast<int>(mHasLengths));
+    write(d, mScoreType);
+    write(d, static_cast<int>(mLm->size()));
+    std::memcpy(d, mLm->data(), mLm->size() * sizeof(float));
+    d += mLm->size() * sizeof(float);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void CTCDecoderPlugin::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT((nbInputs == 1 || nbInputs == 2) && nbOutputs == 2);
+    ASSERT(in[0].desc.dims.nbDims == 3);
+    // Verify the vocabulary once it is known
+    const int vocab = in[0].desc.dims.d[2];
+    if (vocab != -1)
+    {
+        ASSERT(mBlank < vocab);
+        ASSERT(mBeamWidth == 1 || vocab <= kMaxCTCBeamVocab);
+        ASSERT(mLm->empty() || mLm->size() == static_cast<size_t>(vocab) * vocab);
+    }
+    mHasLengths = nbInputs == 2;
+    mScoreType = in[0].desc.type;
+}
+
+bool CTCDecoderPlugin::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT((nbInputs == 1 || nbInputs == 2) && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    // The scores are FP32 or FP16, the lengths and the outputs INT32
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    return inOut[pos].type == DataType::kINT32;
+}
+
+const char* CTCDecoderPlugin::getPluginType() const
+{
+    return CTC_DECODER_PLUGIN_NAME;
+}
+
+const char* CTCDecoderPlugin::getPluginVersion() const
+{
+    return CTC_DECODER_PLUGIN_VERSION;
+}
+
+void CTCDecoderPlugin::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* CTCDecoderPlugin::clone() const
+{
+    return new CTCDecoderPlugin(*this);
+}
+
+DataType CTCDecoderPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0 || index == 1);
+    return DataType::kINT32;
+}
+
+void CTCDecoderPlugin::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* CTCDecoderPlugin::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_CTC_DECODER_PLUGIN_H
+#define TRT_CTC_DECODER_PLUGIN_H
+
+#include <cuda_runtime_api.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+#include "NvInferPlugin.h"
+#include "ctcDecoderKernels.h"
+#include "plugin.h"
+
+namespace nvinfer1
+{
+namespace plugin
+{
+// Decodes the frame by frame scores of a CTC acoustic model into tokens on the device, greedily or with a prefix beam
+// search and an optional bigram language model, so that only the tokens are copied back to the host. Takes the
+// [batch, frames, vocab] FP32 or FP16 scores, logits or log probabilities, and optionally the INT32 [batch] numbers of
+// valid frames. Outputs the INT32 [batch, frames] tokens, padded with -1, and the INT32 [batch] numbers of tokens.
+class CTCDecoderPlugin : public IPluginV2DynamicExt
+{
+public:
+    CTCDecoderPlugin(int blank, int beamWidth, const float* lm, int lmCount, float lmWeight, float insertionBonus);
+
+    CTCDecoderPlugin(const void* data, size_t length);
+
+    ~CTCDecoderPlugin() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+private:
+    int mBlank;     // -1 for the last token of the vocabulary
+    int mBeamWidth; // 1 decodes greedily
+    float mLmWeight;
+    float mInsertionBonus;
+    bool mHasLengths{false};
+    DataType mScoreType{DataType::kFLOAT};
+    // The vocab x vocab bigram log probabilities, empty without a language model, the clones share it and its device
+    // copy
+    std::shared_ptr<const std::vector<float>> mLm;
+    std::shared_ptr<void> mDeviceLm;
+    std::string mNamespace;
+};
+
+class CTCDecoderPluginCreator : public BaseCreator
+{
+public:
+    CTCDecoderPluginCreator();
+
+    ~CTCDecoderPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+} // namespace plugin
+} // namespace nvinfer1
+#endif // TRT_CTC_DECODER_PLUGIN_H
@@ -14,30 +14,73 @@
  * limitations under the License.
  */
 #include "detectionLayerPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "plugin.h"
 #include <cuda_runtime_api.h>
 
 using namespace nvinfer1;
 using namespace plugin;
 using nvinfer1::plugin::DetectionLayer;
+using nvinfer1::plugin::DetectionLayerDynamic;
+using nvinfer1::plugin::DetectionLayerDynamicPluginCreator;
 using nvinfer1::plugin::DetectionLayerPluginCreator;
 
 namespace
 {
 const char* DETECTIONLAYER_PLUGIN_VERSION{"1"};
 const char* DETECTIONLAYER_PLUGIN_NAME{"DetectionLayer_TRT"};
+const char* DETECTIONLAYER_DYNAMIC_PLUGIN_NAME{"DetectionLayerDynamic_TRT"};
+
+void addDetectionLayerFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("num_classes", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("keep_topk", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("score_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+RefineNMSParameters parseDetectionLayerFields(const PluginFieldCollection* fc)
+{
+    RefineNMSParameters params{};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "num_classes"))
+        {
+            assert(fields[i].type == PluginFieldType::kINT32);
+            params.numClasses = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "keep_topk"))
+        {
+            assert(fields[i].type == PluginFieldType::kINT32);
+            params.keepTopK = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "score_threshold"))
+        {
+            assert(fields[i].type == PluginFieldType::kFLOAT32);
+            params.scoreThreshold = *(static_cast<const float*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "iou_threshold"))
+        {
+            assert(fields[i].type == PluginFieldType::kFLOAT32);
+            params.iouThreshold = *(static_cast<const float*>(fields[i].data));
+        }
+    }
+    return params;
+}
 } // namespace
 
 PluginFieldCollection DetectionLayerPluginCreator::mFC{};
 std::vector<PluginField> DetectionLayerPluginCreator::mPluginAttributes;
+PluginFieldCollection DetectionLayerDynamicPluginCreator::mFC{};
+std::vector<PluginField> DetectionLayerDynamicPluginCreator::mPluginAttributes;
 
 DetectionLayerPluginCreator::DetectionLayerPluginCreator()
 {
-
-    mPluginAttributes.emplace_back(PluginField("num_classes", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("keep_topk", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("score_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    addDetectionLayerFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -60,32 +103,8 @@ const PluginFieldCollection* DetectionLayerPluginCreator::getFieldNames()
 
 IPluginV2Ext* DetectionLayerPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "num_classes"))
-        {
-            assert(fields[i].type == PluginFieldType::kINT32);
-            mNbClasses = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "keep_topk"))
-        {
-            assert(fields[i].type == PluginFieldType::kINT32);
-            mKeepTopK = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "score_threshold"))
-        {
-            assert(fields[i].type == PluginFieldType::kFLOAT32);
-            mScoreThreshold = *(static_cast<const float*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "iou_threshold"))
-        {
-            assert(fields[i].type == PluginFieldType::kFLOAT32);
-            mIOUThreshold = *(static_cast<const float*>(fields[i].data));
-        }
-    }
-    return new DetectionLayer(mNbClasses, mKeepTopK, mScoreThreshold, mIOUThreshold);
+    const RefineNMSParameters params = parseDetectionLayerFields(fc);
+    return new DetectionLayer(params.numClasses, params.keepTopK, params.scoreThreshold, params.iouThreshold);
 };
 
 IPluginV2Ext* DetectionLayerPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
@@ -141,7 +160,7 @@ void DetectionLayer::destroy()
 
 bool DetectionLayer::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 };
 
 const char* DetectionLayer::getPluginType() const
@@ -171,7 +190,7 @@ const char* DetectionLayer::getPluginNamespace() const
 
 size_t DetectionLayer::getSerializationSize() const
 {
-    return sizeof(int) * 2 + sizeof(float) * 2 + sizeof(int) * 2;
+    return sizeof(int) * 2 + sizeof(float) * 2 + sizeof(int) * 2 + sizeof(DataType);
 };
 
 void DetectionLayer::serialize(void* buffer) const
@@ -183,6 +202,7 @@ void DetectionLayer::serialize(void* buffer) const
     write(d, mIOUThreshold);
     write(d, mMaxBatchSize);
     write(d, mAnchorsCnt);
+    write(d, mType);
     ASSERT(d == a + getSerializationSize());
 };
 
@@ -195,6 +215,12 @@ DetectionLayer::DetectionLayer(const void* data, size_t length)
     float iou_threshold = read<float>(d);
     mMaxBatchSize = read<int>(d);
     mAnchorsCnt = read<int>(d);
+    // Engines serialized before FP16 was supported are FP32
+    mType = DataType::kFLOAT;
+    if (d < a + length)
+    {
+        mType = read<DataType>(d);
+    }
     ASSERT(d == a + length);
 
     mNbClasses = num_classes;
@@ -207,8 +233,6 @@ DetectionLayer::DetectionLayer(const void* data, size_t length)
     mParam.keepTopK = mKeepTopK;
     mParam.scoreThreshold = mScoreThreshold;
     mParam.iouThreshold = mIOUThreshold;
-
-    mType = DataType::kFLOAT;
 };
 
 void DetectionLayer::check_valid_inputs(const nvinfer1::Dims* inputs, int nbInputDims)
@@ -251,14 +275,16 @@ Dims DetectionLayer::getOutputDimensions(int index, const Dims* inputs, int nbIn
 int DetectionLayer::enqueue(
     int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
 
     void* detections = outputs[0];
 
     // refine detection
     RefineDetectionWorkSpace refDetcWorkspace(batch_size, mAnchorsCnt, mParam, mType);
-    cudaError_t status = RefineBatchClassNMS(stream, batch_size, mAnchorsCnt,
-        DataType::kFLOAT, // mType,
-        mParam, refDetcWorkspace, workspace,
+    cudaError_t status = RefineBatchClassNMS(stream, batch_size, mAnchorsCnt, mType, mParam, refDetcWorkspace,
+        workspace,
         inputs[1],       // inputs[InScore]
         inputs[0],       // inputs[InDelta],
         mValidCnt->mPtr, // inputs[InCountValid],
@@ -271,8 +297,8 @@ int DetectionLayer::enqueue(
 
 DataType DetectionLayer::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
-    // Only DataType::kFLOAT is acceptable by the plugin layer
-    return DataType::kFLOAT;
+    // The detections have the type of the inputs
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -295,6 +321,7 @@ void DetectionLayer::configurePlugin(const Dims* inputDims, int nbInputs, const
     check_valid_inputs(inputDims, nbInputs);
     assert(inputDims[0].d[0] == inputDims[1].d[0] && inputDims[1].d[0] == inputDims[2].d[0]);
 
+    assert(supportsFormat(inputTypes[0], floatFormat));
     mAnchorsCnt = inputDims[2].d[0];
     mType = inputTypes[0];
     mMaxBatchSize = maxBatchSize;
@@ -308,3 +335,219 @@ void DetectionLayer::attachToContext(
 
 // Detach the plugin object from its execution context.
 void DetectionLayer::detachFromContext() {}
+
+DetectionLayerDynamic::DetectionLayerDynamic(int num_classes, int keep_topk, float score_threshold, float iou_threshold)
+{
+    ASSERT(num_classes > 0);
+    ASSERT(keep_topk > 0);
+    ASSERT(score_threshold >= 0.0f);
+    ASSERT(iou_threshold > 0.0f);
+
+    mParam.backgroundLabelId = 0;
+    mParam.numClasses = num_classes;
+    mParam.keepTopK = keep_topk;
+    mParam.scoreThreshold = score_threshold;
+    mParam.iouThreshold = iou_threshold;
+}
+
+DetectionLayerDynamic::DetectionLayerDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mParam = read<RefineNMSParameters>(d);
+    mMaxBatchSize = read<int>(d);
+    mAnchorsCnt = read<int>(d);
+    ASSERT(d == a + length);
+}
+
+int DetectionLayerDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs DetectionLayerDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 3);
+
+    // [N, keep_topk, (y1, x1, y2, x2, class_id, score)]
+    DimsExprs detections;
+    detections.nbDims = 3;
+    detections.d[0] = inputs[0].d[0];
+    detections.d[1] = exprBuilder.constant(mParam.keepTopK);
+    detections.d[2] = exprBuilder.constant(6);
+    return detections;
+}
+
+int DetectionLayerDynamic::initialize()
+{
+    // Every image has all of its ROIs
+    std::vector<int> tempValidCnt(mMaxBatchSize, mAnchorsCnt);
+
+    mValidCnt = std::make_shared<CudaBind<int>>(mMaxBatchSize);
+
+    CUASSERT(cudaMemcpy(
+        mValidCnt->mPtr, static_cast<void*>(tempValidCnt.data()), sizeof(int) * mMaxBatchSize, cudaMemcpyHostToDevice));
+
+    return STATUS_SUCCESS;
+}
+
+void DetectionLayerDynamic::terminate()
+{
+    mValidCnt.reset();
+}
+
+size_t DetectionLayerDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    RefineDetectionWorkSpace refine(inputs[0].dims.d[0], mAnchorsCnt, mParam, inputs[0].type);
+    return refine.totalSize;
+}
+
+int DetectionLayerDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const int batch = inputDesc[0].dims.d[0];
+    ASSERT(batch <= mMaxBatchSize);
+    const DataType type = inputDesc[0].type;
+
+    // refine detection
+    RefineDetectionWorkSpace refDetcWorkspace(batch, mAnchorsCnt, mParam, type);
+    cudaError_t status = RefineBatchClassNMS(stream, batch, mAnchorsCnt, type, mParam, refDetcWorkspace, workspace,
+        inputs[1],       // inputs[InScore]
+        inputs[0],       // inputs[InDelta],
+        mValidCnt->mPtr, // inputs[InCountValid],
+        inputs[2],       // inputs[ROI]
+        outputs[0]);
+
+    ASSERT(status == cudaSuccess);
+    return status;
+}
+
+size_t DetectionLayerDynamic::getSerializationSize() const
+{
+    return sizeof(RefineNMSParameters) + sizeof(int) * 2;
+}
+
+void DetectionLayerDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mParam);
+    write(d, mMaxBatchSize);
+    write(d, mAnchorsCnt);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void DetectionLayerDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 3);
+    ASSERT(nbOutputs == 1);
+    // classifier_delta_bbox[N, anchors, num_classes*4, 1, 1]
+    // classifier_class[N, anchors, num_classes, 1, 1]
+    // rpn_rois[N, anchors, 4]
+    ASSERT(in[0].desc.dims.nbDims == 5 && in[0].desc.dims.d[2] == mParam.numClasses * 4);
+    ASSERT(in[1].desc.dims.nbDims == 5 && in[1].desc.dims.d[2] == mParam.numClasses);
+    ASSERT(in[2].desc.dims.nbDims == 3 && in[2].desc.dims.d[2] == 4);
+
+    // The working buffers are sized for a number of ROIs known at build time
+    mAnchorsCnt = in[2].desc.dims.d[1];
+    ASSERT(mAnchorsCnt > 0);
+    mMaxBatchSize = in[0].max.d[0];
+}
+
+bool DetectionLayerDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 3 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    // The detections have the type of the inputs
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* DetectionLayerDynamic::getPluginType() const
+{
+    return DETECTIONLAYER_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* DetectionLayerDynamic::getPluginVersion() const
+{
+    return DETECTIONLAYER_PLUGIN_VERSION;
+}
+
+void DetectionLayerDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* DetectionLayerDynamic::clone() const
+{
+    return new DetectionLayerDynamic(*this);
+}
+
+void DetectionLayerDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* DetectionLayerDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType DetectionLayerDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+DetectionLayerDynamicPluginCreator::DetectionLayerDynamicPluginCreator()
+{
+    addDetectionLayerFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* DetectionLayerDynamicPluginCreator::getPluginName() const
+{
+    return DETECTIONLAYER_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* DetectionLayerDynamicPluginCreator::getPluginVersion() const
+{
+    return DETECTIONLAYER_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* DetectionLayerDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* DetectionLayerDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    const RefineNMSParameters params = parseDetectionLayerFields(fc);
+    auto* plugin = new DetectionLayerDynamic(
+        params.numClasses, params.keepTopK, params.scoreThreshold, params.iouThreshold);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* DetectionLayerDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new DetectionLayerDynamic(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
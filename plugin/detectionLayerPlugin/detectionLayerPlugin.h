@@ -104,6 +104,63 @@ private:
     std::string mNameSpace;
 };
 
+// Explicit batch version of DetectionLayer. The inputs are the deltas [N, R, num_classes * 4, 1, 1], the scores
+// [N, R, num_classes, 1, 1] and the ROIs [N, R, 4], the output the detections [N, keep_topk, 6]. R must be static.
+class DetectionLayerDynamic : public IPluginV2DynamicExt
+{
+public:
+    DetectionLayerDynamic(int num_classes, int keep_topk, float score_threshold, float iou_threshold);
+
+    DetectionLayerDynamic(const void* data, size_t length);
+
+    ~DetectionLayerDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    RefineNMSParameters mParam;
+    int mMaxBatchSize{};
+    int mAnchorsCnt{};
+    std::shared_ptr<CudaBind<int>> mValidCnt; // valid cnt = number of input rois for every image.
+    std::string mNamespace;
+};
+
 class DetectionLayerPluginCreator : public BaseCreator
 {
 public:
@@ -123,10 +180,29 @@ public:
 
 private:
     static PluginFieldCollection mFC;
-    int mNbClasses;
-    int mKeepTopK;
-    float mScoreThreshold;
-    float mIOUThreshold;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as DetectionLayer_TRT
+class DetectionLayerDynamicPluginCreator : public BaseCreator
+{
+public:
+    DetectionLayerDynamicPluginCreator();
+
+    ~DetectionLayerDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
 };
 } // namespace plugin
@@ -20,11 +20,15 @@
 
 #include "NvInfer.h"
 #include "embLayerNormPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "bertCommon.h"
 #include "common.h"
 #include "serialize.hpp"
 
 using namespace nvinfer1;
+using nvinfer1::plugin::pluginMalloc;
 using bert::operator+;
 
 namespace bert
@@ -124,9 +128,74 @@ inline int computeMaskIdx(cudaStream_t stream, const int S, const int B, const i
     return 0;
 }
 
-template <typename T, unsigned TPB>
+// Position of a packed token in its sequence, from the B + 1 cumulative sequence lengths
+__device__ inline int packedPosition(const int token, const int* cuSeqlens, const int B)
+{
+    int first = 0;
+    int last = B;
+    while (last - first > 1)
+    {
+        const int mid = (first + last) / 2;
+        if (cuSeqlens[mid] <= token)
+        {
+            first = mid;
+        }
+        else
+        {
+            last = mid;
+        }
+    }
+    return token - cuSeqlens[first];
+}
+
+// Row-wise INT8 quantization of an embedding table, each row with its own scale max|x| / 127
+template <unsigned TPB>
+__global__ void quantizeRowsKernel(int ld, const float* src, int8_t* dst, float* scales)
+{
+    using BlockReduce = cub::BlockReduce<float, TPB>;
+    __shared__ typename BlockReduce::TempStorage tmpStorage;
+    __shared__ float rowScale;
+
+    // blockIdx.x is the row
+    const int offset = blockIdx.x * ld;
+
+    float threadMax = 0.f;
+    for (int it = threadIdx.x; it < ld; it += TPB)
+    {
+        threadMax = fmaxf(threadMax, fabsf(src[offset + it]));
+    }
+    const float rowMax = BlockReduce(tmpStorage).Reduce(threadMax, cub::Max());
+    if (threadIdx.x == 0)
+    {
+        rowScale = rowMax / 127.f;
+        scales[blockIdx.x] = rowScale;
+    }
+    __syncthreads();
+
+    const float rScale = rowScale > 0.f ? 1.f / rowScale : 0.f;
+    for (int it = threadIdx.x; it < ld; it += TPB)
+    {
+        const float q = fminf(fmaxf(rintf(src[offset + it] * rScale), -127.f), 127.f);
+        dst[offset + it] = static_cast<int8_t>(q);
+    }
+}
+
+// Element of an embedding table, the INT8 tables are dequantized with the scale of the row
+template <typename T>
+__device__ inline float embeddingAt(const T* emb, int idx, float /* scale */)
+{
+    return weightToFloat(emb[idx]);
+}
+
+__device__ inline float embeddingAt(const int8_t* emb, int idx, float scale)
+{
+    return scale * emb[idx];
+}
+
+template <typename T, typename TW, unsigned TPB>
 __global__ void embLayerNormKernel(int ld, const int* inputIds, const int* tokenIds, const float* beta,
-    const float* gamma, const T* wordEmb, const T* posEmb, const T* tokEmb, T* output)
+    const float* gamma, const TW* wordEmb, const float* wordScales, const T* posEmb, const T* tokEmb, T* output,
+    const int* cuSeqlens, const int nbSeqs)
 {
 
     cub::Sum pairSum;
@@ -135,8 +204,11 @@ __global__ void embLayerNormKernel(int ld, const int* inputIds, const int* token
     // blockIdx.y = batch
     // gridDim.x = S
     // gridDim.y = B
+    // Packed sequences: blockIdx.x = token, gridDim.x = T, gridDim.y = 1
     __shared__ int wordId;
     __shared__ int tokenId;
+    __shared__ int position;
+    __shared__ float wordScale;
 
     const T rld = T(1.f) / T(ld);
     const int seqPos = blockIdx.y + blockIdx.x * gridDim.y;
@@ -144,12 +216,14 @@ __global__ void embLayerNormKernel(int ld, const int* inputIds, const int* token
     {
         wordId = inputIds[seqPos];
         tokenId = tokenIds[seqPos];
+        position = cuSeqlens ? packedPosition(blockIdx.x, cuSeqlens, nbSeqs) : blockIdx.x;
+        wordScale = wordScales ? wordScales[wordId] : 1.f;
     }
     __syncthreads();
 
     // 2. load pos/tok/word embeddings and add them toghether
     // offset into embeddings is given by wordId * hidden_size
-    const int poffset = blockIdx.x * ld;
+    const int poffset = position * ld;
     const int woffset = wordId * ld;
     const int toffset = tokenId * ld;
     // the output offset is given by b * (S*hidden_size) + s * hidden_size
@@ -159,7 +233,7 @@ __global__ void embLayerNormKernel(int ld, const int* inputIds, const int* token
 
     for (int it = threadIdx.x; it < ld; it += TPB)
     {
-        const T w(wordEmb[woffset + it]);
+        const T w(embeddingAt(wordEmb, woffset + it, wordScale));
         const T t(tokEmb[toffset + it]);
         const T p(posEmb[poffset + it]);
         const T val = w + t + p;
@@ -173,17 +247,111 @@ __global__ void embLayerNormKernel(int ld, const int* inputIds, const int* token
     layerNorm<T, T, TPB>(threadData, ld, outOffset, beta, gamma, output);
 }
 
+//!
+//! With cuSeqlens, the S tokens of the B sequences are packed in a single batch and cuSeqlens holds the B + 1
+//! cumulative sequence lengths
+//!
+//! With wordScales, the word embeddings are INT8 quantized with a scale per row, otherwise they are of type T
+//!
 template <typename T>
 inline int embSkipLayerNorm(cudaStream_t stream, int ld, int B, int S, const int* inputIds, const int* token_ids,
-    const float* beta, const float* gamma, const T* wordEmb, const T* posEmb, const T* tokEmb, T* output)
+    const float* beta, const float* gamma, const void* wordEmb, const float* wordScales, const T* posEmb,
+    const T* tokEmb, T* output, const int* cuSeqlens = nullptr)
 {
 
     constexpr int tpb = 256;
-    const dim3 grid(S, B, 1);
+    const dim3 grid(S, cuSeqlens ? 1 : B, 1);
     const dim3 block(tpb, 1, 1);
 
-    embLayerNormKernel<T, tpb>
-        <<<grid, block, 0, stream>>>(ld, inputIds, token_ids, beta, gamma, wordEmb, posEmb, tokEmb, output);
+    if (wordScales)
+    {
+        embLayerNormKernel<T, int8_t, tpb><<<grid, block, 0, stream>>>(ld, inputIds, token_ids, beta, gamma,
+            static_cast<const int8_t*>(wordEmb), wordScales, posEmb, tokEmb, output, cuSeqlens, B);
+    }
+    else
+    {
+        embLayerNormKernel<T, T, tpb><<<grid, block, 0, stream>>>(ld, inputIds, token_ids, beta, gamma,
+            static_cast<const T*>(wordEmb), nullptr, posEmb, tokEmb, output, cuSeqlens, B);
+    }
+    CHECK(cudaPeekAtLastError());
+
+    return 0;
+}
+
+template <typename T, typename TW, unsigned TPB>
+__global__ void embLayerNormKernelInt8(int ld, const int* inputIds, const int* tokenIds, const float* beta,
+    const float* gamma, const TW* wordEmb, const float* wordScales, const T* posEmb, const T* tokEmb,
+    int8_t* output, const int* cuSeqlens, const int nbSeqs, const float outRScale)
+{
+    // The sum of the embeddings, in FP32
+    extern __shared__ float row[];
+
+    cub::Sum pairSum;
+    // 1. lookup word and token of the block, laid out as in embLayerNormKernel
+    __shared__ int wordId;
+    __shared__ int tokenId;
+    __shared__ int position;
+    __shared__ float wordScale;
+
+    const float rld = 1.f / ld;
+    const int seqPos = blockIdx.y + blockIdx.x * gridDim.y;
+    if (threadIdx.x == 0)
+    {
+        wordId = inputIds[seqPos];
+        tokenId = tokenIds[seqPos];
+        position = cuSeqlens ? packedPosition(blockIdx.x, cuSeqlens, nbSeqs) : blockIdx.x;
+        wordScale = wordScales ? wordScales[wordId] : 1.f;
+    }
+    __syncthreads();
+
+    // 2. load pos/tok/word embeddings and add them toghether
+    const int poffset = position * ld;
+    const int woffset = wordId * ld;
+    const int toffset = tokenId * ld;
+    const int outOffset = seqPos * ld;
+
+    kvp<float> threadData(0, 0);
+
+    for (int it = threadIdx.x; it < ld; it += TPB)
+    {
+        const float val = embeddingAt(wordEmb, woffset + it, wordScale) + float(tokEmb[toffset + it])
+            + float(posEmb[poffset + it]);
+
+        row[it] = val;
+        const float rldval = rld * val;
+        threadData = pairSum(threadData, kvp<float>(rldval, rldval * val));
+    }
+
+    // 3. layer norm on the sum, quantized on output
+    layerNormInt8<TPB>(threadData, ld, outOffset, row, beta, gamma, outRScale, output);
+}
+
+//!
+//! INT8 output with its per-tensor scale. The embeddings have the plugin type, or INT8 with a scale per row for the
+//! word embeddings as in embSkipLayerNorm, the math is FP32.
+//!
+template <typename T>
+inline int embSkipLayerNormInt8(cudaStream_t stream, int ld, int B, int S, const int* inputIds,
+    const int* token_ids, const float* beta, const float* gamma, const void* wordEmb, const float* wordScales,
+    const T* posEmb, const T* tokEmb, const float outScale, int8_t* output, const int* cuSeqlens = nullptr)
+{
+
+    constexpr int tpb = 256;
+    const dim3 grid(S, cuSeqlens ? 1 : B, 1);
+    const dim3 block(tpb, 1, 1);
+    const size_t smemSize = ld * sizeof(float);
+
+    if (wordScales)
+    {
+        embLayerNormKernelInt8<T, int8_t, tpb><<<grid, block, smemSize, stream>>>(ld, inputIds, token_ids, beta,
+            gamma, static_cast<const int8_t*>(wordEmb), wordScales, posEmb, tokEmb, output, cuSeqlens, B,
+            1.f / outScale);
+    }
+    else
+    {
+        embLayerNormKernelInt8<T, T, tpb><<<grid, block, smemSize, stream>>>(ld, inputIds, token_ids, beta, gamma,
+            static_cast<const T*>(wordEmb), nullptr, posEmb, tokEmb, output, cuSeqlens, B, 1.f / outScale);
+    }
     CHECK(cudaPeekAtLastError());
 
     return 0;
@@ -194,6 +362,44 @@ namespace
 {
 static const char* EMB_LAYER_NORM_VERSION{"1"};
 static const char* EMB_LAYER_NORM_NAME{"CustomEmbLayerNormPluginDynamic"};
+
+// Copy an embedding table to the device in the precision of the plugin
+void uploadEmbedding(const Weights& src, DataType type, cuda_shared_ptr<void>& dst)
+{
+    void* dev{nullptr};
+    CHECK(pluginMalloc(&dev, samplesCommon::getElementSize(type) * src.count));
+    make_cuda_shared(dst, dev);
+    if (type == DataType::kFLOAT)
+    {
+        convertAndCopyToDevice(src, static_cast<float*>(dev));
+    }
+    else
+    {
+        convertAndCopyToDevice(src, static_cast<half*>(dev));
+    }
+}
+
+// Copy an embedding table of rows of ld elements to the device, quantized to INT8 with a scale per row
+void uploadQuantizedEmbedding(
+    const Weights& src, size_t ld, cuda_shared_ptr<void>& dst, cuda_shared_ptr<float>& scales)
+{
+    const size_t rows = src.count / ld;
+    cuda_shared_ptr<void> table;
+    uploadEmbedding(src, DataType::kFLOAT, table);
+
+    void* dev{nullptr};
+    CHECK(pluginMalloc(&dev, sizeof(int8_t) * src.count));
+    make_cuda_shared(dst, dev);
+    float* scalesDev{nullptr};
+    CHECK(pluginMalloc(&scalesDev, sizeof(float) * rows));
+    make_cuda_shared(scales, scalesDev);
+
+    constexpr int tpb = 256;
+    quantizeRowsKernel<tpb><<<rows, tpb>>>(
+        ld, static_cast<const float*>(table.get()), static_cast<int8_t*>(dev), scalesDev);
+    CHECK(cudaPeekAtLastError());
+    CHECK(cudaStreamSynchronize(nullptr));
+}
 } // namespace
 
 // Static class fields initialization
@@ -203,7 +409,8 @@ std::vector<PluginField> EmbLayerNormPluginDynamicCreator::mPluginAttributes;
 REGISTER_TENSORRT_PLUGIN(EmbLayerNormPluginDynamicCreator);
 
 EmbLayerNormPluginDynamic::EmbLayerNormPluginDynamic(const std::string& name, const bool outputFp16,
-    const Weights& beta, const Weights& gamma, const Weights& wordEmb, const Weights& posEmb, const Weights& tokEmb)
+    const Weights& beta, const Weights& gamma, const Weights& wordEmb, const Weights& posEmb, const Weights& tokEmb,
+    const bool packed, const bool wordEmbInt8)
     : mLayerName(name)
     , mLd(beta.count)
     , mGamma(gamma)
@@ -211,11 +418,8 @@ EmbLayerNormPluginDynamic::EmbLayerNormPluginDynamic(const std::string& name, co
     , mWordEmb(wordEmb)
     , mPosEmb(posEmb)
     , mTokEmb(tokEmb)
-    , mGammaDev(nullptr)
-    , mBetaDev(nullptr)
-    , mWordEmbDev(nullptr)
-    , mTokEmbDev(nullptr)
-    , mPosEmbDev(nullptr)
+    , mPacked(packed)
+    , mWordEmbInt8(wordEmbInt8)
 {
     // Assuming Weights.count is the number of elements and not bytes
     assert(beta.count == gamma.count);
@@ -242,13 +446,35 @@ EmbLayerNormPluginDynamic::EmbLayerNormPluginDynamic(const std::string& name, co
     deserialize_value(&data, &length, &mTokVocabSize);
 
     const char* d = static_cast<const char*>(data);
-    mBetaDev = deserToDev<float>(d, mLd);
-    mGammaDev = deserToDev<float>(d, mLd);
+    mStaged.stage<float>(d, mLd);
+    mStaged.stage<float>(d, mLd);
 
     const size_t wordSize = samplesCommon::getElementSize(mType);
-    mWordEmbDev = deserToDev<char>(d, mLd * mWordVocabSize * wordSize);
-    mPosEmbDev = deserToDev<char>(d, mLd * mPosVocabSize * wordSize);
-    mTokEmbDev = deserToDev<char>(d, mLd * mTokVocabSize * wordSize);
+    mStaged.stage<char>(d, mLd * mWordVocabSize * wordSize);
+    mStaged.stage<char>(d, mLd * mPosVocabSize * wordSize);
+    mStaged.stage<char>(d, mLd * mTokVocabSize * wordSize);
+    // Engines serialized before packed sequences were supported end with the embeddings
+    const char* end = static_cast<const char*>(data) + length;
+    mPacked = false;
+    if (d < end)
+    {
+        std::memcpy(&mPacked, d, sizeof(mPacked));
+        d += sizeof(mPacked);
+    }
+    // INT8 word embeddings follow, with a word vocabulary size of 0 in the header
+    mWordEmbInt8 = false;
+    if (d < end)
+    {
+        std::memcpy(&mWordEmbInt8, d, sizeof(mWordEmbInt8));
+        d += sizeof(mWordEmbInt8);
+    }
+    if (mWordEmbInt8)
+    {
+        std::memcpy(&mWordVocabSize, d, sizeof(mWordVocabSize));
+        d += sizeof(mWordVocabSize);
+        mStaged.stage<int8_t>(d, mLd * mWordVocabSize);
+        mStaged.stage<float>(d, mWordVocabSize);
+    }
     // this signals init not to allocate/copy
     mGamma.count = -1;
     mBeta.count = -1;
@@ -269,14 +495,17 @@ IPluginV2DynamicExt* EmbLayerNormPluginDynamic::clone() const
 {
     gLogVerbose << "EMBLN clone start" << std::endl;
     auto ret = new EmbLayerNormPluginDynamic(
-        mLayerName, mType == DataType::kHALF, mBeta, mGamma, mWordEmb, mPosEmb, mTokEmb);
+        mLayerName, mType == DataType::kHALF, mBeta, mGamma, mWordEmb, mPosEmb, mTokEmb, mPacked, mWordEmbInt8);
     ret->mS = mS;
 
+    // Clones share the device weights instead of uploading their own copy in initialize()
     ret->mWordEmbDev = mWordEmbDev;
+    ret->mWordScaleDev = mWordScaleDev;
     ret->mPosEmbDev = mPosEmbDev;
     ret->mTokEmbDev = mTokEmbDev;
     ret->mBetaDev = mBetaDev;
     ret->mGammaDev = mGammaDev;
+    ret->mStaged = mStaged;
     gLogVerbose << "EMBLN clone done" << std::endl;
     return ret;
 }
@@ -290,7 +519,7 @@ DimsExprs EmbLayerNormPluginDynamic::getOutputDimensions(
 
     assert(inputs[0].nbDims == 2); // BxS
     assert(inputs[0].nbDims == inputs[1].nbDims);
-    assert(inputs[0].nbDims == inputs[2].nbDims);
+    assert(mPacked ? inputs[2].nbDims == 1 : inputs[0].nbDims == inputs[2].nbDims);
 
     assert(outputIndex == 0 || outputIndex == 1);
 
@@ -306,9 +535,10 @@ DimsExprs EmbLayerNormPluginDynamic::getOutputDimensions(
         return ret;
     }
 
+    // Mask indices, or the cumulative sequence lengths passed through for packed sequences
     DimsExprs ret;
     ret.nbDims = 1;
-    ret.d[0] = inputs[0].d[BDIM];
+    ret.d[0] = mPacked ? inputs[2].d[0] : inputs[0].d[BDIM];
     return ret;
 }
 
@@ -330,21 +560,27 @@ bool EmbLayerNormPluginDynamic::supportsFormatCombination(
     }
 
     const PluginTensorDesc& prev = inOut[pos - 1];
+    if (mPacked && pos == 2)
+    { // cumulative sequence lengths
+        return desc.type == DataType::kINT32 && desc.dims.nbDims == 1;
+    }
     if (pos == 1 || pos == 2)
     {
         return desc.type == DataType::kINT32 && desc.dims.nbDims == 2 && desc.dims.d[BDIM] == prev.dims.d[BDIM]
             && desc.dims.d[SDIM] == prev.dims.d[SDIM];
     }
 
+    const PluginTensorDesc& ids = inOut[0];
     if (pos == 3)
-    { // embedded sequence
+    { // embedded sequence, INT8 quantized with the output scale
 
-        return desc.type == mType && desc.dims.nbDims == 5 && desc.dims.d[BDIM] == prev.dims.d[BDIM]
-            && desc.dims.d[SDIM] == prev.dims.d[SDIM] && desc.dims.d[3] == 1 && desc.dims.d[4] == 1;
+        return (desc.type == mType || desc.type == DataType::kINT8) && desc.dims.nbDims == 5 && desc.dims.d[BDIM] == ids.dims.d[BDIM]
+            && desc.dims.d[SDIM] == ids.dims.d[SDIM] && desc.dims.d[3] == 1 && desc.dims.d[4] == 1;
     }
 
     // pos == 4: mask
-    return desc.type == DataType::kINT32 && desc.dims.nbDims == 1 && desc.dims.d[0] == prev.dims.d[1];
+    return desc.type == DataType::kINT32 && desc.dims.nbDims == 1
+        && desc.dims.d[0] == (mPacked ? inOut[2].dims.d[0] : ids.dims.d[BDIM]);
 }
 
 void EmbLayerNormPluginDynamic::configurePlugin(
@@ -360,8 +596,8 @@ void EmbLayerNormPluginDynamic::configurePlugin(
     TRT_UNUSED B;
     assert(mS == inputs[1].desc.dims.d[SDIM]);
     assert(B == inputs[1].desc.dims.d[BDIM]);
-    assert(mS == inputs[2].desc.dims.d[SDIM]);
-    assert(B == inputs[2].desc.dims.d[BDIM]);
+    assert(mPacked || mS == inputs[2].desc.dims.d[SDIM]);
+    assert(mPacked || B == inputs[2].desc.dims.d[BDIM]);
 
     assert(outputs[0].desc.dims.nbDims == 5);
     assert(outputs[0].desc.dims.d[SDIM] == mS);
@@ -371,12 +607,12 @@ void EmbLayerNormPluginDynamic::configurePlugin(
     assert(outputs[0].desc.dims.d[4] == 1);
 
     assert(outputs[1].desc.dims.nbDims == 1);
-    assert(outputs[1].desc.dims.d[0] == B);
+    assert(outputs[1].desc.dims.d[0] == (mPacked ? inputs[2].desc.dims.d[0] : B));
 
     assert(inputs[0].desc.type == DataType::kINT32);
     assert(inputs[1].desc.type == DataType::kINT32);
     assert(inputs[2].desc.type == DataType::kINT32);
-    assert(outputs[0].desc.type == DataType::kFLOAT || outputs[0].desc.type == DataType::kHALF);
+    assert(outputs[0].desc.type == mType || outputs[0].desc.type == DataType::kINT8);
     assert(outputs[1].desc.type == DataType::kINT32);
 }
 
@@ -389,6 +625,10 @@ size_t EmbLayerNormPluginDynamic::getWorkspaceSize(
 int EmbLayerNormPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
     const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    mStaged.wait();
     const int batchSize = inputDesc->dims.d[BDIM];
     const int S = inputDesc->dims.d[SDIM];
     int status = -1;
@@ -397,31 +637,60 @@ int EmbLayerNormPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const
     const int* inputIds = static_cast<const int*>(inputs[0]);
     const int* segmentIds = static_cast<const int*>(inputs[1]);
     const int* inputMask = static_cast<const int*>(inputs[2]);
-
-    if (mType == DataType::kFLOAT)
+    // Packed sequences: the S dimension holds the tokens of all the sequences and the third input their cumulative
+    // lengths, which are passed on to the attention layers instead of mask indices
+    const int* cuSeqlens = mPacked ? inputMask : nullptr;
+    const int nbSeqs = mPacked ? inputDesc[2].dims.d[0] - 1 : batchSize;
+    // The word embeddings are of type mType, or INT8 along with their scales
+    const void* wordEmb = mWordEmbDev.get();
+    const float* wordScales = mWordScaleDev.get();
+
+    if (outputDesc[0].type == DataType::kINT8)
+    {
+        int8_t* output = static_cast<int8_t*>(outputs[0]);
+        const float outScale = outputDesc[0].scale;
+        if (mType == DataType::kHALF)
+        {
+            const half* tokEmb = static_cast<const half*>(mTokEmbDev.get());
+            const half* posEmb = static_cast<const half*>(mPosEmbDev.get());
+            status = embSkipLayerNormInt8<half>(stream, mLd, nbSeqs, S, inputIds, segmentIds, mBetaDev.get(),
+                mGammaDev.get(), wordEmb, wordScales, posEmb, tokEmb, outScale, output, cuSeqlens);
+        }
+        else
+        {
+            const float* tokEmb = static_cast<const float*>(mTokEmbDev.get());
+            const float* posEmb = static_cast<const float*>(mPosEmbDev.get());
+            status = embSkipLayerNormInt8<float>(stream, mLd, nbSeqs, S, inputIds, segmentIds, mBetaDev.get(),
+                mGammaDev.get(), wordEmb, wordScales, posEmb, tokEmb, outScale, output, cuSeqlens);
+        }
+    }
+    else if (mType == DataType::kFLOAT)
     {
         float* output = static_cast<float*>(outputs[0]);
-        float* wordEmb = static_cast<float*>(mWordEmbDev);
-        float* tokEmb = static_cast<float*>(mTokEmbDev);
-        float* posEmb = static_cast<float*>(mPosEmbDev);
-        embSkipLayerNorm<float>(
-            stream, mLd, batchSize, S, inputIds, segmentIds, mBetaDev, mGammaDev, wordEmb, posEmb, tokEmb, output);
+        float* tokEmb = static_cast<float*>(mTokEmbDev.get());
+        float* posEmb = static_cast<float*>(mPosEmbDev.get());
+        embSkipLayerNorm<float>(stream, mLd, nbSeqs, S, inputIds, segmentIds, mBetaDev.get(), mGammaDev.get(),
+            wordEmb, wordScales, posEmb, tokEmb, output, cuSeqlens);
     }
     else if (mType == DataType::kHALF)
     {
         half* output = static_cast<half*>(outputs[0]);
 
-        half* wordEmb = static_cast<half*>(mWordEmbDev);
-        half* tokEmb = static_cast<half*>(mTokEmbDev);
-        half* posEmb = static_cast<half*>(mPosEmbDev);
-        embSkipLayerNorm<half>(
-            stream, mLd, batchSize, S, inputIds, segmentIds, mBetaDev, mGammaDev, wordEmb, posEmb, tokEmb, output);
+        half* tokEmb = static_cast<half*>(mTokEmbDev.get());
+        half* posEmb = static_cast<half*>(mPosEmbDev.get());
+        embSkipLayerNorm<half>(stream, mLd, nbSeqs, S, inputIds, segmentIds, mBetaDev.get(), mGammaDev.get(),
+            wordEmb, wordScales, posEmb, tokEmb, output, cuSeqlens);
     }
     else
     {
         assert(false);
     }
     int* maskIdx = static_cast<int*>(outputs[1]);
+    if (mPacked)
+    {
+        CHECK(cudaMemcpyAsync(maskIdx, cuSeqlens, sizeof(int) * (nbSeqs + 1), cudaMemcpyDeviceToDevice, stream));
+        return status;
+    }
     computeMaskIdx(stream, S, batchSize, inputMask, maskIdx);
 
     return status;
@@ -458,77 +727,77 @@ int EmbLayerNormPluginDynamic::getNbOutputs() const
 
 int EmbLayerNormPluginDynamic::initialize()
 {
-    if (mGamma.values)
+    // The weights staged at deserialization are uploaded together with those of the other plugins
+    if (!mStaged.empty() && !mBetaDev)
     {
-        CHECK(cudaMalloc(&mGammaDev, sizeof(float) * mGamma.count));
-        CHECK(cudaMemcpy(mGammaDev, mGamma.values, sizeof(float) * mGamma.count, cudaMemcpyHostToDevice));
+        mStaged.resolve(0, mBetaDev);
+        mStaged.resolve(1, mGammaDev);
+        mStaged.resolve(2, mWordEmbDev);
+        mStaged.resolve(3, mPosEmbDev);
+        mStaged.resolve(4, mTokEmbDev);
+        if (mWordEmbInt8)
+        {
+            mStaged.resolve(5, mWordEmbDev);
+            mStaged.resolve(6, mWordScaleDev);
+        }
     }
-    if (mBeta.values)
+    // Clones were handed the device weights of the plugin they were cloned from, only the first one uploads them
+    if (mGamma.values && !mGammaDev)
     {
-        CHECK(cudaMalloc(&mBetaDev, sizeof(float) * mBeta.count));
-        CHECK(cudaMemcpy(mBetaDev, mBeta.values, sizeof(float) * mBeta.count, cudaMemcpyHostToDevice));
+        float* gamma{nullptr};
+        CHECK(pluginMalloc(&gamma, sizeof(float) * mGamma.count));
+        make_cuda_shared(mGammaDev, gamma);
+        CHECK(cudaMemcpy(gamma, mGamma.values, sizeof(float) * mGamma.count, cudaMemcpyHostToDevice));
+    }
+    if (mBeta.values && !mBetaDev)
+    {
+        float* beta{nullptr};
+        CHECK(pluginMalloc(&beta, sizeof(float) * mBeta.count));
+        make_cuda_shared(mBetaDev, beta);
+        CHECK(cudaMemcpy(beta, mBeta.values, sizeof(float) * mBeta.count, cudaMemcpyHostToDevice));
     }
-    const size_t wordSize = samplesCommon::getElementSize(mType);
 
-    if (mWordEmb.values)
+    if (mWordEmb.values && !mWordEmbDev)
     {
-        CHECK(cudaMalloc(&mWordEmbDev, wordSize * mWordEmb.count));
-        if (mType == DataType::kFLOAT)
+        if (mWordEmbInt8)
         {
-            convertAndCopyToDevice(mWordEmb, reinterpret_cast<float*>(mWordEmbDev));
+            uploadQuantizedEmbedding(mWordEmb, mLd, mWordEmbDev, mWordScaleDev);
         }
         else
         {
-            convertAndCopyToDevice(mWordEmb, reinterpret_cast<half*>(mWordEmbDev));
+            uploadEmbedding(mWordEmb, mType, mWordEmbDev);
         }
     }
-    if (mTokEmb.values)
+    if (mTokEmb.values && !mTokEmbDev)
     {
-        CHECK(cudaMalloc(&mTokEmbDev, wordSize * mTokEmb.count));
-        if (mType == DataType::kFLOAT)
-        {
-            convertAndCopyToDevice(mTokEmb, reinterpret_cast<float*>(mTokEmbDev));
-        }
-        else
-        {
-            convertAndCopyToDevice(mTokEmb, reinterpret_cast<half*>(mTokEmbDev));
-        }
+        uploadEmbedding(mTokEmb, mType, mTokEmbDev);
     }
-
-    if (mPosEmb.values)
+    if (mPosEmb.values && !mPosEmbDev)
     {
-        CHECK(cudaMalloc(&mPosEmbDev, wordSize * mPosEmb.count));
-        if (mType == DataType::kFLOAT)
-        {
-            convertAndCopyToDevice(mPosEmb, reinterpret_cast<float*>(mPosEmbDev));
-        }
-        else
-        {
-            convertAndCopyToDevice(mPosEmb, reinterpret_cast<half*>(mPosEmbDev));
-        }
+        uploadEmbedding(mPosEmb, mType, mPosEmbDev);
     }
     return 0;
 }
 
 void EmbLayerNormPluginDynamic::terminate()
 {
-    gLogVerbose << "EMBLN terminate start" << std::endl;
-    CHECK(cudaFree(mGammaDev));
-    CHECK(cudaFree(mBetaDev));
-    CHECK(cudaFree(mWordEmbDev));
-    CHECK(cudaFree(mTokEmbDev));
-    CHECK(cudaFree(mPosEmbDev));
-    gLogVerbose << "EMBLN terminate done" << std::endl;
+    // The device weights are shared with the clones and released with the last plugin holding them
+    gLogVerbose << "EMBLN terminate" << std::endl;
 }
 
 size_t EmbLayerNormPluginDynamic::getSerializationSize() const
 {
     const size_t wordSize = samplesCommon::getElementSize(mType);
+    const size_t wordEmbSize = mWordEmbInt8 ? 0 : wordSize * mLd * mWordVocabSize;
+    const size_t wordEmbInt8Size
+        = mWordEmbInt8 ? sizeof(mWordVocabSize) + (sizeof(int8_t) * mLd + sizeof(float)) * mWordVocabSize : 0;
     return 2 * sizeof(float) * mLd        // beta + gamma
         + sizeof(mType) + sizeof(mLd) * 5 //mLd, mS, m*VocabSize
-        + wordSize * mLd * mWordVocabSize // word emb
+        + wordEmbSize                     // word emb
         + wordSize * mLd * mPosVocabSize  // pos emb
         + wordSize * mLd * mTokVocabSize  // tok emb
+        + sizeof(mPacked)
+        + sizeof(mWordEmbInt8) + wordEmbInt8Size // INT8 word emb and their scales
         ;
 }
 
@@ -539,16 +808,31 @@ void EmbLayerNormPluginDynamic::serialize(void* buffer) const
     serialize_value(&buffer, mType);
     serialize_value(&buffer, mLd);
     serialize_value(&buffer, mS);
-    serialize_value(&buffer, mWordVocabSize);
+    // INT8 word embeddings are serialized at the end, engines of older versions cannot read them anyway
+    serialize_value(&buffer, mWordEmbInt8 ? size_t{0} : mWordVocabSize);
     serialize_value(&buffer, mPosVocabSize);
     serialize_value(&buffer, mTokVocabSize);
 
     char* d = static_cast<char*>(buffer);
-    serFromDev(d, mBetaDev, mLd);
-    serFromDev(d, mGammaDev, mLd);
-    serFromDev(d, static_cast<char*>(mWordEmbDev), mLd * mWordVocabSize * wordSize);
-    serFromDev(d, static_cast<char*>(mPosEmbDev), mLd * mPosVocabSize * wordSize);
-    serFromDev(d, static_cast<char*>(mTokEmbDev), mLd * mTokVocabSize * wordSize);
+    serFromDev(d, mBetaDev.get(), mLd);
+    serFromDev(d, mGammaDev.get(), mLd);
+    if (!mWordEmbInt8)
+    {
+        serFromDev(d, static_cast<char*>(mWordEmbDev.get()), mLd * mWordVocabSize * wordSize);
+    }
+    serFromDev(d, static_cast<char*>(mPosEmbDev.get()), mLd * mPosVocabSize * wordSize);
+    serFromDev(d, static_cast<char*>(mTokEmbDev.get()), mLd * mTokVocabSize * wordSize);
+    std::memcpy(d, &mPacked, sizeof(mPacked));
+    d += sizeof(mPacked);
+    std::memcpy(d, &mWordEmbInt8, sizeof(mWordEmbInt8));
+    d += sizeof(mWordEmbInt8);
+    if (mWordEmbInt8)
+    {
+        std::memcpy(d, &mWordVocabSize, sizeof(mWordVocabSize));
+        d += sizeof(mWordVocabSize);
+        serFromDev(d, static_cast<int8_t*>(mWordEmbDev.get()), mLd * mWordVocabSize);
+        serFromDev(d, mWordScaleDev.get(), mWordVocabSize);
+    }
 }
 
 void EmbLayerNormPluginDynamic::destroy()
@@ -597,6 +881,8 @@ IPluginV2* EmbLayerNormPluginDynamicCreator::createPlugin(const char* name, cons
     gLogVerbose << "Creating EmbLayerNormPluginDynamic...\n";
 
     bool output_fp16 = false;
+    bool packed = false;
+    bool word_emb_int8 = false;
     Weights beta;
     Weights gamma;
     Weights word_emb;
@@ -650,11 +936,23 @@ IPluginV2* EmbLayerNormPluginDynamicCreator::createPlugin(const char* name, cons
             assert(fc->fields[i].type == PluginFieldType::kINT32);
             output_fp16 = reinterpret_cast<const int*>(fc->fields[i].data)[0] != 0;
         }
+        if (field_name.compare("packed") == 0)
+        {
+            gLogVerbose << "Building packed...\n";
+            assert(fc->fields[i].type == PluginFieldType::kINT32);
+            packed = reinterpret_cast<const int*>(fc->fields[i].data)[0] != 0;
+        }
+        if (field_name.compare("word_emb_int8") == 0)
+        {
+            gLogVerbose << "Building word_emb_int8...\n";
+            assert(fc->fields[i].type == PluginFieldType::kINT32);
+            word_emb_int8 = reinterpret_cast<const int*>(fc->fields[i].data)[0] != 0;
+        }
     }
 
     gLogVerbose << "Building the Plugin...\n";
-    EmbLayerNormPluginDynamic* p
-        = new EmbLayerNormPluginDynamic(name, output_fp16, beta, gamma, word_emb, pos_emb, tok_emb);
+    EmbLayerNormPluginDynamic* p = new EmbLayerNormPluginDynamic(
+        name, output_fp16, beta, gamma, word_emb, pos_emb, tok_emb, packed, word_emb_int8);
     return p;
 }
 
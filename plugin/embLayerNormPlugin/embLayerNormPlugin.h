@@ -19,6 +19,7 @@
 
 #include "NvInferPlugin.h"
 #include "NvInferRuntime.h"
+#include "bertCommon.h"
 
 #include <string>
 #include <vector>
@@ -32,8 +33,14 @@ namespace bert
 class EmbLayerNormPluginDynamic : public nvinfer1::IPluginV2DynamicExt
 {
 public:
+    //!
+    //! \param packed Take the tokens of all the sequences packed in a single batch along with their cumulative lengths,
+    //!        instead of padded sequences and a mask
+    //! \param wordEmbInt8 Keep the word embeddings quantized to INT8 with a scale per row, dequantized by the lookup
+    //!
     EmbLayerNormPluginDynamic(const std::string& name, const bool use_fp16, const nvinfer1::Weights& beta, const nvinfer1::Weights& gamma,
-        const nvinfer1::Weights& word_emb, const nvinfer1::Weights& pos_emb, const nvinfer1::Weights& tok_emb);
+        const nvinfer1::Weights& word_emb, const nvinfer1::Weights& pos_emb, const nvinfer1::Weights& tok_emb,
+        const bool packed = false, const bool wordEmbInt8 = false);
 
     EmbLayerNormPluginDynamic(const std::string& name, const void* data, size_t length);
 
@@ -73,11 +80,16 @@ private:
     const std::string mLayerName;
     std::string mNamespace;
 
-    float* mGammaDev;
-    float* mBetaDev;
-    void* mWordEmbDev;
-    void* mTokEmbDev;
-    void* mPosEmbDev;
+    bert::cuda_shared_ptr<float> mGammaDev;
+    bert::cuda_shared_ptr<float> mBetaDev;
+    bert::cuda_shared_ptr<void> mWordEmbDev;
+    bert::cuda_shared_ptr<void> mTokEmbDev;
+    bert::cuda_shared_ptr<void> mPosEmbDev;
+    // Scale of each row of the word embeddings, when they are INT8
+    bert::cuda_shared_ptr<float> mWordScaleDev;
+    // Weights of a deserialized plugin, staged in order beta, gamma, word, position and token embeddings, then the
+    // INT8 word embeddings and their scales
+    bert::StagedWeights mStaged;
     size_t mLd; // leading dim = hidden size
     size_t mB;  // batch size
     size_t mS;  // sequence length
@@ -90,6 +102,8 @@ private:
     nvinfer1::Weights mTokEmb;
     nvinfer1::Weights mPosEmb;
     nvinfer1::DataType mType;
+    bool mPacked;
+    bool mWordEmbInt8;
 
 protected:
     // To prevent compiler warnings.
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "dotProductTopKPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include <cstring>
+
+using namespace nvinfer1;
+using namespace plugin;
+using nvinfer1::plugin::DotProductTopKPlugin;
+using nvinfer1::plugin::DotProductTopKPluginCreator;
+
+namespace
+{
+const char* DOT_PRODUCT_TOPK_PLUGIN_VERSION{"1"};
+const char* DOT_PRODUCT_TOPK_PLUGIN_NAME{"DotProductTopK_TRT"};
+} // namespace
+
+PluginFieldCollection DotProductTopKPluginCreator::mFC{};
+std::vector<PluginField> DotProductTopKPluginCreator::mPluginAttributes;
+
+DotProductTopKPluginCreator::DotProductTopKPluginCreator()
+{
+    mPluginAttributes.emplace_back(PluginField("weights", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("num_items", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("embedding_dim", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("k", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("table_type", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("managed", nullptr, PluginFieldType::kINT32, 1));
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* DotProductTopKPluginCreator::getPluginName() const
+{
+    return DOT_PRODUCT_TOPK_PLUGIN_NAME;
+}
+
+const char* DotProductTopKPluginCreator::getPluginVersion() const
+{
+    return DOT_PRODUCT_TOPK_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* DotProductTopKPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2Ext* DotProductTopKPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    const float* weights{nullptr};
+    int weightsCount{0};
+    int items{0};
+    int dim{0};
+    int k{0};
+    int tableType{static_cast<int>(EmbeddingTableType::kFLOAT)};
+    int managed{0};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "weights"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            weights = static_cast<const float*>(fields[i].data);
+            weightsCount = fields[i].length;
+        }
+        else if (!strcmp(attrName, "num_items"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            items = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "embedding_dim"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            dim = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "k"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            k = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "table_type"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            tableType = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "managed"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            managed = *static_cast<const int*>(fields[i].data);
+        }
+    }
+    ASSERT(weights != nullptr && items > 0 && dim > 0 && static_cast<int64_t>(items) * dim == weightsCount);
+    ASSERT(dim <= kMaxTopKEmbeddingDim);
+    ASSERT(k > 0 && k <= kMaxTopK && k <= items);
+    ASSERT(tableType >= 0 && tableType <= static_cast<int>(EmbeddingTableType::kINT8));
+    auto* plugin = new DotProductTopKPlugin(
+        weights, items, dim, k, static_cast<EmbeddingTableType>(tableType), managed != 0);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2Ext* DotProductTopKPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
+{
+    auto* plugin = new DotProductTopKPlugin(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+DotProductTopKPlugin::DotProductTopKPlugin(
+    const float* weights, int items, int dim, int k, EmbeddingTableType tableType, bool managed)
+    : mItems(items)
+    , mDim(dim)
+    , mK(k)
+    , mTableType(tableType)
+    , mManaged(managed)
+{
+    auto table = std::make_shared<std::vector<char>>(embeddingTableSize(mTableType, mItems, mDim));
+    quantizeEmbeddingTable(mTableType, mItems, mDim, weights, table->data());
+    mTable = table;
+}
+
+DotProductTopKPlugin::DotProductTopKPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mItems = read<int>(d);
+    mDim = read<int>(d);
+    mK = read<int>(d);
+    mTableType = static_cast<EmbeddingTableType>(read<int>(d));
+    mManaged = read<int>(d) != 0;
+    mQueryType = read<DataType>(d);
+    const size_t tableSize = embeddingTableSize(mTableType, mItems, mDim);
+    mTable = std::make_shared<std::vector<char>>(d, d + tableSize);
+    d += tableSize;
+    ASSERT(d == a + length);
+}
+
+int DotProductTopKPlugin::getNbOutputs() const
+{
+    return 2;
+}
+
+Dims DotProductTopKPlugin::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
+{
+    ASSERT(index < 2 && nbInputDims == 1 && inputs[0].nbDims == 1 && inputs[0].d[0] == mDim);
+    Dims output;
+    output.nbDims = 1;
+    output.d[0] = mK;
+    return output;
+}
+
+int DotProductTopKPlugin::initialize()
+{
+    if (!mDeviceTable)
+    {
+        mDeviceTable = uploadEmbeddingTable(mTable->data(), mTable->size(), mManaged);
+    }
+    return mDeviceTable ? 0 : 1;
+}
+
+void DotProductTopKPlugin::terminate()
+{
+    mDeviceTable.reset();
+}
+
+void DotProductTopKPlugin::destroy()
+{
+    delete this;
+}
+
+size_t DotProductTopKPlugin::getWorkspaceSize(int maxBatchSize) const
+{
+    return dotProductTopKWorkspaceSize(maxBatchSize, mItems, mK);
+}
+
+int DotProductTopKPlugin::enqueue(
+    int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const cudaError_t status = dotProductTopK(stream, batch_size, mItems, mDim, mK, mTableType, mQueryType,
+        inputs[0], mDeviceTable.get(), static_cast<float*>(outputs[0]), static_cast<int*>(outputs[1]), workspace);
+    return status != cudaSuccess;
+}
+
+size_t DotProductTopKPlugin::getSerializationSize() const
+{
+    // items, dim, k, table type, managed, query type, table
+    return sizeof(int) * 5 + sizeof(DataType) + mTable->size();
+}
+
+void DotProductTopKPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mItems);
+    write(d, mDim);
+    write(d, mK);
+    write(d, static_cast<int>(mTableType));
+    write(d, static_cast<int>(mManaged));
+    write(d, mQueryType);
+    std::memcpy(d, mTable->data(), mTable->size());
+    d += mTable->size();
+    ASSERT(d == a + getSerializationSize());
+}
+
+const char* DotProductTopKPlugin::getPluginType() const
+{
+    return DOT_PRODUCT_TOPK_PLUGIN_NAME;
+}
+
+const char* DotProductTopKPlugin::getPluginVersion() const
+{
+    return DOT_PRODUCT_TOPK_PLUGIN_VERSION;
+}
+
+IPluginV2Ext* DotProductTopKPlugin::clone() const
+{
+    return new DotProductTopKPlugin(*this);
+}
+
+void DotProductTopKPlugin::setPluginNamespace(const char* libNamespace)
+{
+    mNameSpace = libNamespace;
+}
+
+const char* DotProductTopKPlugin::getPluginNamespace() const
+{
+    return mNameSpace.c_str();
+}
+
+bool DotProductTopKPlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    switch (pos)
+    {
+    case 0: return inOut[0].type == DataType::kFLOAT || inOut[0].type == DataType::kHALF;
+    case 1: return inOut[1].type == DataType::kFLOAT;
+    default: return inOut[2].type == DataType::kINT32;
+    }
+}
+
+DataType DotProductTopKPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index < 2);
+    return index == 0 ? DataType::kFLOAT : DataType::kINT32;
+}
+
+bool DotProductTopKPlugin::isOutputBroadcastAcrossBatch(
+    int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+{
+    return false;
+}
+
+bool DotProductTopKPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+{
+    return false;
+}
+
+void DotProductTopKPlugin::configurePlugin(
+    const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
+{
+    ASSERT(nbInput == 1 && nbOutput == 2);
+    mQueryType = in[0].type;
+}
+
+void DotProductTopKPlugin::attachToContext(
+    cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator)
+{
+}
+
+void DotProductTopKPlugin::detachFromContext() {}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "embeddingBagPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include <cstring>
+
+using namespace nvinfer1;
+using namespace plugin;
+using nvinfer1::plugin::EmbeddingBagPlugin;
+using nvinfer1::plugin::EmbeddingBagPluginCreator;
+
+namespace
+{
+const char* EMBEDDING_BAG_PLUGIN_VERSION{"1"};
+const char* EMBEDDING_BAG_PLUGIN_NAME{"EmbeddingBag_TRT"};
+} // namespace
+
+PluginFieldCollection EmbeddingBagPluginCreator::mFC{};
+std::vector<PluginField> EmbeddingBagPluginCreator::mPluginAttributes;
+
+EmbeddingBagPluginCreator::EmbeddingBagPluginCreator()
+{
+    mPluginAttributes.emplace_back(PluginField("weights", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("num_embeddings", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("embedding_dim", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("pooling", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("table_type", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("managed", nullptr, PluginFieldType::kINT32, 1));
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* EmbeddingBagPluginCreator::getPluginName() const
+{
+    return EMBEDDING_BAG_PLUGIN_NAME;
+}
+
+const char* EmbeddingBagPluginCreator::getPluginVersion() const
+{
+    return EMBEDDING_BAG_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* EmbeddingBagPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2Ext* EmbeddingBagPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    const float* weights{nullptr};
+    int weightsCount{0};
+    int rows{0};
+    int dim{0};
+    int pooling{0};
+    int tableType{static_cast<int>(EmbeddingTableType::kFLOAT)};
+    int managed{0};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "weights"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            weights = static_cast<const float*>(fields[i].data);
+            weightsCount = fields[i].length;
+        }
+        else if (!strcmp(attrName, "num_embeddings"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            rows = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "embedding_dim"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            dim = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "pooling"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            pooling = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "table_type"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            tableType = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "managed"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            managed = *static_cast<const int*>(fields[i].data);
+        }
+    }
+    ASSERT(weights != nullptr && rows > 0 && dim > 0 && static_cast<int64_t>(rows) * dim == weightsCount);
+    ASSERT(pooling == 0 || pooling == 1);
+    ASSERT(tableType >= 0 && tableType <= static_cast<int>(EmbeddingTableType::kINT8));
+    auto* plugin = new EmbeddingBagPlugin(
+        weights, rows, dim, pooling == 1, static_cast<EmbeddingTableType>(tableType), managed != 0);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2Ext* EmbeddingBagPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
+{
+    auto* plugin = new EmbeddingBagPlugin(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+EmbeddingBagPlugin::EmbeddingBagPlugin(
+    const float* weights, int rows, int dim, bool mean, EmbeddingTableType tableType, bool managed)
+    : mRows(rows)
+    , mDim(dim)
+    , mMean(mean)
+    , mTableType(tableType)
+    , mManaged(managed)
+{
+    auto table = std::make_shared<std::vector<char>>(embeddingTableSize(mTableType, mRows, mDim));
+    quantizeEmbeddingTable(mTableType, mRows, mDim, weights, table->data());
+    mTable = table;
+}
+
+EmbeddingBagPlugin::EmbeddingBagPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mRows = read<int>(d);
+    mDim = read<int>(d);
+    mMean = read<int>(d) != 0;
+    mTableType = static_cast<EmbeddingTableType>(read<int>(d));
+    mManaged = read<int>(d) != 0;
+    mBags = read<int>(d);
+    mHotness = read<int>(d);
+    mOutputType = read<DataType>(d);
+    const size_t tableSize = embeddingTableSize(mTableType, mRows, mDim);
+    mTable = std::make_shared<std::vector<char>>(d, d + tableSize);
+    d += tableSize;
+    ASSERT(d == a + length);
+}
+
+int EmbeddingBagPlugin::getNbOutputs() const
+{
+    return 1;
+}
+
+Dims EmbeddingBagPlugin::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
+{
+    ASSERT(index == 0 && nbInputDims == 1 && inputs[0].nbDims >= 1);
+    Dims output = inputs[0];
+    output.d[output.nbDims - 1] = mDim;
+    return output;
+}
+
+int EmbeddingBagPlugin::initialize()
+{
+    if (!mDeviceTable)
+    {
+        mDeviceTable = uploadEmbeddingTable(mTable->data(), mTable->size(), mManaged);
+    }
+    return mDeviceTable ? 0 : 1;
+}
+
+void EmbeddingBagPlugin::terminate()
+{
+    mDeviceTable.reset();
+}
+
+void EmbeddingBagPlugin::destroy()
+{
+    delete this;
+}
+
+size_t EmbeddingBagPlugin::getWorkspaceSize(int) const
+{
+    return 0;
+}
+
+int EmbeddingBagPlugin::enqueue(
+    int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const cudaError_t status = embeddingBag(stream, batch_size * mBags, mHotness, mRows, mDim, mMean, mTableType,
+        mOutputType, static_cast<const int*>(inputs[0]), mDeviceTable.get(), outputs[0]);
+    return status != cudaSuccess;
+}
+
+size_t EmbeddingBagPlugin::getSerializationSize() const
+{
+    // rows, dim, pooling, table type, managed, bags, hotness, output type, table
+    return sizeof(int) * 7 + sizeof(DataType) + mTable->size();
+}
+
+void EmbeddingBagPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mRows);
+    write(d, mDim);
+    write(d, static_cast<int>(mMean));
+    write(d, static_cast<int>(mTableType));
+    write(d, static_cast<int>(mManaged));
+    write(d, mBags);
+    write(d, mHotness);
+    write(d, mOutputType);
+    std::memcpy(d, mTable->data(), mTable->size());
+    d += mTable->size();
+    ASSERT(d == a + getSerializationSize());
+}
+
+const char* EmbeddingBagPlugin::getPluginType() const
+{
+    return EMBEDDING_BAG_PLUGIN_NAME;
+}
+
+const char* EmbeddingBagPlugin::getPluginVersion() const
+{
+    return EMBEDDING_BAG_PLUGIN_VERSION;
+}
+
+IPluginV2Ext* EmbeddingBagPlugin::clone() const
+{
+    return new EmbeddingBagPlugin(*this);
+}
+
+void EmbeddingBagPlugin::setPluginNamespace(const char* libNamespace)
+{
+    mNameSpace = libNamespace;
+}
+
+const char* EmbeddingBagPlugin::getPluginNamespace() const
+{
+    return mNameSpace.c_str();
+}
+
+bool EmbeddingBagPlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    // The table storage is independent of the output type
+    return pos == 0 ? inOut[0].type == DataType::kINT32
+                    : inOut[1].type == DataType::kFLOAT || inOut[1].type == DataType::kHALF;
+}
+
+DataType EmbeddingBagPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return DataType::kFLOAT;
+}
+
+bool EmbeddingBagPlugin::isOutputBroadcastAcrossBatch(
+    int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+{
+    return false;
+}
+
+bool EmbeddingBagPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+{
+    return false;
+}
+
+void EmbeddingBagPlugin::configurePlugin(
+    const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
+{
+    ASSERT(nbInput == 1 && nbOutput == 1);
+    const Dims& dims = in[0].dims;
+    mHotness = dims.d[dims.nbDims - 1];
+    mBags = 1;
+    for (int i = 0; i < dims.nbDims - 1; ++i)
+    {
+        mBags *= dims.d[i];
+    }
+    mOutputType = out[0].type;
+}
+
+void EmbeddingBagPlugin::attachToContext(
+    cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator)
+{
+}
+
+void EmbeddingBagPlugin::detachFromContext() {}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_EMBEDDING_BAG_PLUGIN_H
+#define TRT_EMBEDDING_BAG_PLUGIN_H
+
+#include <cuda_runtime_api.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+#include "NvInferPlugin.h"
+#include "embeddingKernels.h"
+#include "plugin.h"
+
+namespace nvinfer1
+{
+namespace plugin
+{
+// Looks up the rows of an embedding table picked by INT32 indices and pools them, instead of multiplying one-hot
+// vectors with the whole table. The last input dimension holds the indices of a bag, the output replaces it with the
+// embedding dimension.
+class EmbeddingBagPlugin : public IPluginV2IOExt
+{
+public:
+    EmbeddingBagPlugin(const float* weights, int rows, int dim, bool mean, EmbeddingTableType tableType, bool managed);
+
+    EmbeddingBagPlugin(const void* data, size_t length);
+
+    ~EmbeddingBagPlugin() override = default;
+
+    int getNbOutputs() const override;
+
+    Dims getOutputDimensions(int index, const Dims* inputs, int nbInputDims) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    void destroy() override;
+
+    size_t getWorkspaceSize(int maxBatchSize) const override;
+
+    int enqueue(
+        int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    IPluginV2Ext* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    bool isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const override;
+
+    bool canBroadcastInputAcrossBatch(int inputIndex) const override;
+
+    void attachToContext(
+        cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override;
+
+    void configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
+
+    void detachFromContext() override;
+
+private:
+    int mRows;
+    int mDim;
+    bool mMean;
+    EmbeddingTableType mTableType;
+    bool mManaged;
+    // Bags per batch item and indices per bag
+    int mBags{0};
+    int mHotness{0};
+    DataType mOutputType{DataType::kFLOAT};
+    // The table in its storage type, the clones share it and its device copy
+    std::shared_ptr<const std::vector<char>> mTable;
+    std::shared_ptr<void> mDeviceTable;
+    std::string mNameSpace;
+};
+
+class EmbeddingBagPluginCreator : public BaseCreator
+{
+public:
+    EmbeddingBagPluginCreator();
+
+    ~EmbeddingBagPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2Ext* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2Ext* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+} // namespace plugin
+} // namespace nvinfer1
+#endif // TRT_EMBEDDING_BAG_PLUGIN_H
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "embeddingKernels.h"
+#include "pluginAllocator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <cuda_fp16.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+constexpr int kThreads = 256;
+constexpr int kWarpSize = 32;
+// Candidates sorted at once by a block: the items of a chunk, or the running top k followed by a tile of candidates
+constexpr int kSortSize = 2048;
+static_assert(kMaxTopK * 2 <= kSortSize, "The merge needs a tile of at least k candidates");
+
+__host__ __device__ inline int divUp(int a, int b)
+{
+    return (a + b - 1) / b;
+}
+
+// The INT8 scales start on a 4 bytes boundary
+inline size_t int8RowsSize(int rows, int dim)
+{
+    return (static_cast<size_t>(rows) * dim + 3) / 4 * 4;
+}
+
+__device__ inline float toFloat(float x)
+{
+    return x;
+}
+
+__device__ inline float toFloat(__half x)
+{
+    return __half2float(x);
+}
+
+__device__ inline void store(float* y, float x)
+{
+    *y = x;
+}
+
+__device__ inline void store(__half* y, float x)
+{
+    *y = __float2half(x);
+}
+
+__device__ inline float loadWeight(const float* table, const float* /*scales*/, int row, size_t offset)
+{
+    return table[offset];
+}
+
+__device__ inline float loadWeight(const __half* table, const float* /*scales*/, int row, size_t offset)
+{
+    return __half2float(table[offset]);
+}
+
+__device__ inline float loadWeight(const int8_t* table, const float* scales, int row, size_t offset)
+{
+    return table[offset] * scales[row];
+}
+
+// One block per bag, the threads run over the embedding dimension so that each row is read coalesced
+template <typename TTable, typename TOut>
+__global__ void embeddingBagKernel(int bags, int hotness, int rows, int dim, bool mean, const int* indices,
+    const TTable* table, const float* scales, TOut* output)
+{
+    for (int bag = blockIdx.x; bag < bags; bag += gridDim.x)
+    {
+        const int* bagIndices = indices + static_cast<size_t>(bag) * hotness;
+        for (int d = threadIdx.x; d < dim; d += blockDim.x)
+        {
+            float sum = 0.F;
+            int count = 0;
+            for (int h = 0; h < hotness; ++h)
+            {
+                const int row = __ldg(bagIndices + h);
+                if (row >= 0 && row < rows)
+                {
+                    sum += loadWeight(table, scales, row, static_cast<size_t>(row) * dim + d);
+                    ++count;
+                }
+            }
+            store(output + static_cast<size_t>(bag) * dim + d, mean && count > 0 ? sum / count : sum);
+        }
+    }
+}
+
+template <typename TTable>
+void launchEmbeddingBag(cudaStream_t stream, int bags, int hotness, int rows, int dim, bool mean,
+    DataType outputType, const int* indices, const TTable* table, const float* scales, void* output)
+{
+    const int threads = std::min(kThreads, divUp(dim, kWarpSize) * kWarpSize);
+    const int blocks = std::min(bags, 65535);
+    if (outputType == DataType::kHALF)
+    {
+        embeddingBagKernel<<<blocks, threads, 0, stream>>>(
+            bags, hotness, rows, dim, mean, indices, table, scales, static_cast<__half*>(output));
+    }
+    else
+    {
+        embeddingBagKernel<<<blocks, threads, 0, stream>>>(
+            bags, hotness, rows, dim, mean, indices, table, scales, static_cast<float*>(output));
+    }
+}
+
+// Sorts kSortSize pairs by decreasing score, with all the threads of the block
+__device__ void bitonicSortDescending(float* scores, int* ids)
+{
+    for (int size = 2; size <= kSortSize; size <<= 1)
+    {
+        for (int stride = size >> 1; stride > 0; stride >>= 1)
+        {
+            for (int i = threadIdx.x; i < kSortSize; i += blockDim.x)
+            {
+                const int j = i ^ stride;
+                const bool descending = (i & size) == 0;
+                if (j > i && (scores[i] < scores[j]) == descending)
+                {
+                    const float score = scores[i];
+                    scores[i] = scores[j];
+                    scores[j] = score;
+                    const int id = ids[i];
+                    ids[i] = ids[j];
+                    ids[j] = id;
+                }
+            }
+            __syncthreads();
+        }
+    }
+}
+
+// Grid (chunks, batch), one warp per item scores kSortSize items of the chunk and the block keeps the k best ones
+template <typename TTable, typename TQuery>
+__global__ void chunkTopKKernel(int items, int dim, int k, const TQuery* queries, const TTable* table,
+    const float* scales, float* chunkScores, int* chunkIds)
+{
+    extern __shared__ float shared[];
+    float* scores = shared;
+    int* ids = reinterpret_cast<int*>(scores + kSortSize);
+    float* query = reinterpret_cast<float*>(ids + kSortSize);
+
+    const int chunk = blockIdx.x;
+    const int b = blockIdx.y;
+    for (int d = threadIdx.x; d < dim; d += blockDim.x)
+    {
+        query[d] = toFloat(queries[static_cast<size_t>(b) * dim + d]);
+    }
+    __syncthreads();
+
+    const int lane = threadIdx.x % kWarpSize;
+    for (int slot = threadIdx.x / kWarpSize; slot < kSortSize; slot += blockDim.x / kWarpSize)
+    {
+        const int item = chunk * kSortSize + slot;
+        // The last chunk is padded with scores that sort after any item
+        float score = -FLT_MAX;
+        if (item < items)
+        {
+            const size_t row = static_cast<size_t>(item) * dim;
+            float sum = 0.F;
+            for (int d = lane; d < dim; d += kWarpSize)
+            {
+                sum += query[d] * loadWeight(table, scales, item, row + d);
+            }
+            for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+            {
+                sum += __shfl_xor_sync(0xffffffff, sum, offset);
+            }
+            score = sum;
+        }
+        if (lane == 0)
+        {
+            scores[slot] = score;
+            ids[slot] = item < items ? item : -1;
+        }
+    }
+    __syncthreads();
+    bitonicSortDescending(scores, ids);
+
+    const size_t base = (static_cast<size_t>(b) * gridDim.x + chunk) * k;
+    for (int i = threadIdx.x; i < k; i += blockDim.x)
+    {
+        chunkScores[base + i] = scores[i];
+        chunkIds[base + i] = ids[i];
+    }
+}
+
+// One block per query, merges the top k of every chunk a tile of candidates at a time
+__global__ void mergeTopKKernel(int candidates, int k, const float* chunkScores, const int* chunkIds, float* scores,
+    int* indices)
+{
+    __shared__ float bestScores[kSortSize];
+    __shared__ int bestIds[kSortSize];
+
+    const int b = blockIdx.x;
+    const float* queryScores = chunkScores + static_cast<size_t>(b) * candidates;
+    const int* queryIds = chunkIds + static_cast<size_t>(b) * candidates;
+    for (int i = threadIdx.x; i < k; i += blockDim.x)
+    {
+        bestScores[i] = -FLT_MAX;
+        bestIds[i] = -1;
+    }
+    const int tile = kSortSize - k;
+    for (int start = 0; start < candidates; start += tile)
+    {
+        for (int i = threadIdx.x; i < tile; i += blockDim.x)
+        {
+            const int c = start + i;
+            bestScores[k + i] = c < candidates ? queryScores[c] : -FLT_MAX;
+            bestIds[k + i] = c < candidates ? queryIds[c] : -1;
+        }
+        __syncthreads();
+        bitonicSortDescending(bestScores, bestIds);
+    }
+    for (int i = threadIdx.x; i < k; i += blockDim.x)
+    {
+        scores[static_cast<size_t>(b) * k + i] = bestScores[i];
+        indices[static_cast<size_t>(b) * k + i] = bestIds[i];
+    }
+}
+
+template <typename TTable, typename TQuery>
+void launchDotProductTopK(cudaStream_t stream, int batch, int items, int dim, int k, const TQuery* queries,
+    const TTable* table, const float* scales, float* scores, int* indices, void* workspace)
+{
+    const int chunks = divUp(items, kSortSize);
+    const size_t sharedSize = kSortSize * (sizeof(float) + sizeof(int)) + dim * sizeof(float);
+    const dim3 grid(chunks, batch);
+    if (chunks == 1)
+    {
+        // The top k of the only chunk is the result
+        chunkTopKKernel<<<grid, kThreads, sharedSize, stream>>>(
+            items, dim, k, queries, table, scales, scores, indices);
+        return;
+    }
+    auto* chunkScores = static_cast<float*>(workspace);
+    auto* chunkIds = reinterpret_cast<int*>(chunkScores + static_cast<size_t>(batch) * chunks * k);
+    chunkTopKKernel<<<grid, kThreads, sharedSize, stream>>>(
+        items, dim, k, queries, table, scales, chunkScores, chunkIds);
+    mergeTopKKernel<<<batch, kThreads, 0, stream>>>(chunks * k, k, chunkScores, chunkIds, scores, indices);
+}
+
+template <typename TTable>
+void launchDotProductTopK(cudaStream_t stream, int batch, int items, int dim, int k, DataType queryType,
+    const void* queries, const TTable* table, const float* scales, float* scores, int* indices, void* workspace)
+{
+    if (queryType == DataType::kHALF)
+    {
+        launchDotProductTopK(stream, batch, items, dim, k, static_cast<const __half*>(queries), table, scales,
+            scores, indices, workspace);
+    }
+    else
+    {
+        launchDotProductTopK(stream, batch, items, dim, k, static_cast<const float*>(queries), table, scales,
+            scores, indices, workspace);
+    }
+}
+
+} // namespace
+
+size_t embeddingTableSize(EmbeddingTableType type, int rows, int dim)
+{
+    const size_t elements = static_cast<size_t>(rows) * dim;
+    switch (type)
+    {
+    case EmbeddingTableType::kHALF: return elements * sizeof(__half);
+    case EmbeddingTableType::kINT8: return int8RowsSize(rows, dim) + rows * sizeof(float);
+    default: return elements * sizeof(float);
+    }
+}
+
+void quantizeEmbeddingTable(EmbeddingTableType type, int rows, int dim, const float* weights, void* table)
+{
+    const size_t elements = static_cast<size_t>(rows) * dim;
+    if (type == EmbeddingTableType::kFLOAT)
+    {
+        std::memcpy(table, weights, elements * sizeof(float));
+    }
+    else if (type == EmbeddingTableType::kHALF)
+    {
+        auto* halfTable = static_cast<__half*>(table);
+        for (size_t i = 0; i < elements; ++i)
+        {
+            halfTable[i] = __float2half(weights[i]);
+        }
+    }
+    else
+    {
+        auto* int8Table = static_cast<int8_t*>(table);
+        auto* scales = reinterpret_cast<float*>(static_cast<char*>(table) + int8RowsSize(rows, dim));
+        for (int r = 0; r < rows; ++r)
+        {
+            const float* row = weights + static_cast<size_t>(r) * dim;
+            float amax = 0.F;
+            for (int d = 0; d < dim; ++d)
+            {
+                amax = std::max(amax, std::abs(row[d]));
+            }
+            scales[r] = amax / 127.F;
+            const float inverse = amax > 0.F ? 127.F / amax : 0.F;
+            for (int d = 0; d < dim; ++d)
+            {
+                const float q = std::round(row[d] * inverse);
+                int8Table[static_cast<size_t>(r) * dim + d] = static_cast<int8_t>(std::max(-127.F, std::min(127.F, q)));
+            }
+        }
+    }
+}
+
+std::shared_ptr<void> uploadEmbeddingTable(const void* table, size_t size, bool managed)
+{
+    void* ptr{nullptr};
+    if (managed)
+    {
+        int device{0};
+        if (cudaGetDevice(&device) != cudaSuccess || cudaMallocManaged(&ptr, size) != cudaSuccess)
+        {
+            return nullptr;
+        }
+        std::memcpy(ptr, table, size);
+        // The rows are duplicated on the device as the lookups read them and evicted under memory pressure, advice
+        // is only a hint and is not supported everywhere, so failures are ignored
+        cudaMemAdvise(ptr, size, cudaMemAdviseSetPreferredLocation, cudaCpuDeviceId);
+        cudaMemAdvise(ptr, size, cudaMemAdviseSetReadMostly, device);
+        cudaGetLastError();
+        return std::shared_ptr<void>(ptr, [](void* p) { cudaFree(p); });
+    }
+    if (pluginMalloc(&ptr, size) != cudaSuccess)
+    {
+        return nullptr;
+    }
+    if (cudaMemcpy(ptr, table, size, cudaMemcpyHostToDevice) != cudaSuccess)
+    {
+        pluginFree(ptr);
+        return nullptr;
+    }
+    return std::shared_ptr<void>(ptr, [](void* p) { pluginFree(p); });
+}
+
+cudaError_t embeddingBag(cudaStream_t stream, int bags, int hotness, int rows, int dim, bool mean,
+    EmbeddingTableType tableType, DataType outputType, const int* indices, const void* table, void* output)
+{
+    if (bags == 0)
+    {
+        return cudaSuccess;
+    }
+    switch (tableType)
+    {
+    case EmbeddingTableType::kFLOAT:
+        launchEmbeddingBag(stream, bags, hotness, rows, dim, mean, outputType, indices,
+            static_cast<const float*>(table), nullptr, output);
+        break;
+    case EmbeddingTableType::kHALF:
+        launchEmbeddingBag(stream, bags, hotness, rows, dim, mean, outputType, indices,
+            static_cast<const __half*>(table), nullptr, output);
+        break;
+    case EmbeddingTableType::kINT8:
+        launchEmbeddingBag(stream, bags, hotness, rows, dim, mean, outputType, indices,
+            static_cast<const int8_t*>(table),
+            reinterpret_cast<const float*>(static_cast<const char*>(table) + int8RowsSize(rows, dim)), output);
+        break;
+    }
+    return cudaGetLastError();
+}
+
+size_t dotProductTopKWorkspaceSize(int batch, int items, int k)
+{
+    const int chunks = divUp(items, kSortSize);
+    return chunks == 1 ? 0 : static_cast<size_t>(batch) * chunks * k * (sizeof(float) + sizeof(int));
+}
+
+cudaError_t dotProductTopK(cudaStream_t stream, int batch, int items, int dim, int k, EmbeddingTableType tableType,
+    DataType queryType, const void* queries, const void* table, float* scores, int* indices, void* workspace)
+{
+    if (batch == 0)
+    {
+        return cudaSuccess;
+    }
+    switch (tableType)
+    {
+    case EmbeddingTableType::kFLOAT:
+        launchDotProductTopK(stream, batch, items, dim, k, queryType, queries, static_cast<const float*>(table),
+            nullptr, scores, indices, workspace);
+        break;
+    case EmbeddingTableType::kHALF:
+        launchDotProductTopK(stream, batch, items, dim, k, queryType, queries, static_cast<const __half*>(table),
+            nullptr, scores, indices, workspace);
+        break;
+    case EmbeddingTableType::kINT8:
+        launchDotProductTopK(stream, batch, items, dim, k, queryType, queries, static_cast<const int8_t*>(table),
+            reinterpret_cast<const float*>(static_cast<const char*>(table) + int8RowsSize(items, dim)), scores,
+            indices, workspace);
+        break;
+    }
+    return cudaGetLastError();
+}
+
+} // namespace plugin
+} // namespace nvinfer1
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_EMBEDDING_KERNELS_H
+#define TRT_EMBEDDING_KERNELS_H
+#include "NvInfer.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+#include <memory>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Storage of the rows of an embedding table
+enum class EmbeddingTableType : int32_t
+{
+    kFLOAT = 0,
+    kHALF = 1,
+    // Symmetric per-row quantization, the rows are followed by one FP32 scale per row
+    kINT8 = 2
+};
+
+// Largest k of dotProductTopK, and largest embedding dimension, the query is staged in shared memory
+constexpr int kMaxTopK = 1024;
+constexpr int kMaxTopKEmbeddingDim = 8192;
+
+// Bytes of a table of rows x dim embeddings in the given storage
+size_t embeddingTableSize(EmbeddingTableType type, int rows, int dim);
+
+// Converts rows x dim FP32 weights into a table of embeddingTableSize bytes
+void quantizeEmbeddingTable(EmbeddingTableType type, int rows, int dim, const float* weights, void* table);
+
+// Copies a table to the device, or to managed memory that stays in host memory and is paged in by the lookups when
+// managed is set, for tables larger than the device memory. Returns nullptr if the memory could not be allocated.
+std::shared_ptr<void> uploadEmbeddingTable(const void* table, size_t size, bool managed);
+
+// Sums, or averages when mean is set, the rows picked by each of the bags of hotness indices into a dim vector.
+// Indices outside of [0, rows) are padding and are skipped, a bag of padding only is zero. The output is FP32 or FP16.
+cudaError_t embeddingBag(cudaStream_t stream, int bags, int hotness, int rows, int dim, bool mean,
+    EmbeddingTableType tableType, DataType outputType, const int* indices, const void* table, void* output);
+
+// Workspace of dotProductTopK for batch queries
+size_t dotProductTopKWorkspaceSize(int batch, int items, int k);
+
+// Scores each of the batch FP32 or FP16 queries of dim elements against the items rows of the table, and keeps the k
+// best scores in decreasing order along with their item indices. The scores are never written to global memory, every
+// block keeps the top k of its chunk of items and a second pass merges the chunks.
+cudaError_t dotProductTopK(cudaStream_t stream, int batch, int items, int dim, int k, EmbeddingTableType tableType,
+    DataType queryType, const void* queries, const void* table, float* scores, int* indices, void* workspace);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_EMBEDDING_KERNELS_H
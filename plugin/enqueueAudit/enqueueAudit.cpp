@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Preloadable library auditing the CUDA runtime calls issued by plugin enqueues.
+//
+// Plugins built with ENABLE_ENQUEUE_AUDIT mark their enqueues with trtEnqueueAuditBegin/End. This library defines
+// those marks, and interposes the runtime entry points that allocate, free, synchronize or copy synchronously: calls
+// made on a thread inside a marked enqueue are counted per plugin type and call, and reported when the process exits.
+// Such calls stall the stream and break CUDA graph capture. Set TRT_ENQUEUE_AUDIT=abort to abort on the first call
+// instead, for the tests that must not regress. The plugins must use the shared CUDA runtime for the interposition to
+// see their calls.
+//
+//     LD_PRELOAD=libnvinfer_plugin_audit.so trtexec --loadEngine=model.engine
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cuda_runtime_api.h>
+#include <dlfcn.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace
+{
+
+class EnqueueAudit
+{
+public:
+    EnqueueAudit()
+    {
+        const char* mode = std::getenv("TRT_ENQUEUE_AUDIT");
+        mAbort = mode && std::strcmp(mode, "abort") == 0;
+    }
+
+    ~EnqueueAudit()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mViolations.empty())
+        {
+            std::fprintf(stderr, "[enqueue audit] No allocation, synchronization or blocking copy in plugin enqueues\n");
+            return;
+        }
+        for (const auto& plugin : mViolations)
+        {
+            for (const auto& call : plugin.second)
+            {
+                std::fprintf(stderr, "[enqueue audit] %s: %s x %zu\n", plugin.first.c_str(), call.first.c_str(),
+                    call.second);
+            }
+        }
+    }
+
+    void report(const char* pluginType, const char* call)
+    {
+        if (mAbort)
+        {
+            std::fprintf(stderr, "[enqueue audit] %s called %s in enqueue\n", pluginType, call);
+            std::abort();
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mViolations[pluginType][call];
+    }
+
+private:
+    bool mAbort{false};
+    std::mutex mMutex;
+    std::map<std::string, std::map<std::string, size_t>> mViolations;
+};
+
+EnqueueAudit& audit()
+{
+    static EnqueueAudit audit;
+    return audit;
+}
+
+// Plugin type of the enqueue running on this thread, and how deep the enqueues nest
+thread_local const char* tPluginType{nullptr};
+thread_local int tDepth{0};
+
+void check(const char* call)
+{
+    if (tDepth > 0)
+    {
+        audit().report(tPluginType, call);
+    }
+}
+
+template <typename F>
+F next(const char* name)
+{
+    void* symbol = dlsym(RTLD_NEXT, name);
+    if (!symbol)
+    {
+        std::fprintf(stderr, "[enqueue audit] Could not find %s in the CUDA runtime\n", name);
+        std::abort();
+    }
+    return reinterpret_cast<F>(symbol);
+}
+
+} // namespace
+
+#define AUDIT_FORWARD(name, ...)                                                                                       \
+    static const auto real = next<decltype(&name)>(#name);                                                             \
+    check(#name);                                                                                                      \
+    return real(__VA_ARGS__)
+
+extern "C"
+{
+
+    __attribute__((visibility("default"))) void trtEnqueueAuditBegin(const char* pluginType)
+    {
+        // Create the report before the first enqueue so that it is destroyed after the plugins
+        audit();
+        if (tDepth++ == 0)
+        {
+            tPluginType = pluginType;
+        }
+    }
+
+    __attribute__((visibility("default"))) void trtEnqueueAuditEnd()
+    {
+        --tDepth;
+    }
+
+    cudaError_t CUDARTAPI cudaMalloc(void** devPtr, size_t size)
+    {
+        AUDIT_FORWARD(cudaMalloc, devPtr, size);
+    }
+
+    cudaError_t CUDARTAPI cudaMallocHost(void** ptr, size_t size)
+    {
+        AUDIT_FORWARD(cudaMallocHost, ptr, size);
+    }
+
+    cudaError_t CUDARTAPI cudaHostAlloc(void** pHost, size_t size, unsigned int flags)
+    {
+        AUDIT_FORWARD(cudaHostAlloc, pHost, size, flags);
+    }
+
+    cudaError_t CUDARTAPI cudaMallocManaged(void** devPtr, size_t size, unsigned int flags)
+    {
+        AUDIT_FORWARD(cudaMallocManaged, devPtr, size, flags);
+    }
+
+    cudaError_t CUDARTAPI cudaFree(void* devPtr)
+    {
+        AUDIT_FORWARD(cudaFree, devPtr);
+    }
+
+    cudaError_t CUDARTAPI cudaFreeHost(void* ptr)
+    {
+        AUDIT_FORWARD(cudaFreeHost, ptr);
+    }
+
+    cudaError_t CUDARTAPI cudaMemcpy(void* dst, const void* src, size_t count, enum cudaMemcpyKind kind)
+    {
+        AUDIT_FORWARD(cudaMemcpy, dst, src, count, kind);
+    }
+
+    cudaError_t CUDARTAPI cudaMemset(void* devPtr, int value, size_t count)
+    {
+        AUDIT_FORWARD(cudaMemset, devPtr, value, count);
+    }
+
+    cudaError_t CUDARTAPI cudaDeviceSynchronize(void)
+    {
+        AUDIT_FORWARD(cudaDeviceSynchronize);
+    }
+
+    cudaError_t CUDARTAPI cudaStreamSynchronize(cudaStream_t stream)
+    {
+        AUDIT_FORWARD(cudaStreamSynchronize, stream);
+    }
+
+    cudaError_t CUDARTAPI cudaEventSynchronize(cudaEvent_t event)
+    {
+        AUDIT_FORWARD(cudaEventSynchronize, event);
+    }
+
+} // extern "C"
@@ -16,8 +16,12 @@
 
 #include "NvInfer.h"
 #include "fcPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "bertCommon.h"
 #include "common.h"
+#include "gemmAlgoCache.h"
 #include "serialize.hpp"
 
 #include <algorithm>
@@ -25,10 +29,14 @@
 #include <cstdio>
 #include <cstring>
 #include <cublasLt.h>
+#include <cuda.h>
 #include <cuda_runtime.h>
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::pluginMalloc;
+using nvinfer1::plugin::GemmAlgoEntry;
+using nvinfer1::plugin::GemmAlgoKey;
 using bert::operator+;
 
 namespace bert
@@ -48,6 +56,133 @@ std::vector<PluginField> FCPluginDynamicCreator::mPluginAttributes;
 REGISTER_TENSORRT_PLUGIN(FCPluginDynamicCreator);
 
 constexpr size_t maxWorkspaceBytes = 4194304; // 4MB
+constexpr size_t immaBufferAlignment = 256;     // of the INT8 buffers after the cuBLASLt workspace
+
+// constants for approximating the normal cdf in the Gelu epilogue
+constexpr float kGeluA = 0.5;
+constexpr float kGeluB = 0.7978845608028654;   // sqrt(2.0/M_PI)
+constexpr float kGeluC = 0.035677408136300125; // 0.044715 * sqrt(2.0/M_PI)
+
+//!
+//! Bias and Gelu in place on the column-major output, for algorithms without the cuBLASLt epilogue
+//!
+template <typename T, int TPB, bool hasBias, bool gelu>
+__global__ void fcEpilogueKernel(const int ld, const T* bias, T* output)
+{
+    const int offset = blockIdx.x * ld;
+
+    for (int it = threadIdx.x; it < ld; it += TPB)
+    {
+        const int idx = offset + it;
+        float val = output[idx];
+        if (hasBias)
+        {
+            val += float(bias[it]);
+        }
+        if (gelu)
+        {
+            val *= kGeluA + kGeluA * tanhf(val * (kGeluC * val * val + kGeluB));
+        }
+        output[idx] = T(val);
+    }
+}
+
+template <typename T>
+void computeFCEpilogue(const int ld, const int cols, const T* bias, const bool gelu, T* output, cudaStream_t stream)
+{
+    constexpr int blockSize = 256;
+    if (bias && gelu)
+    {
+        fcEpilogueKernel<T, blockSize, true, true><<<cols, blockSize, 0, stream>>>(ld, bias, output);
+    }
+    else if (bias)
+    {
+        fcEpilogueKernel<T, blockSize, true, false><<<cols, blockSize, 0, stream>>>(ld, bias, output);
+    }
+    else
+    {
+        fcEpilogueKernel<T, blockSize, false, true><<<cols, blockSize, 0, stream>>>(ld, bias, output);
+    }
+    CHECK(cudaPeekAtLastError());
+}
+
+//!
+//! Dequantize the INT32 accumulators of the IMMA GEMM, rows x cols in COL32, apply the bias, Gelu and INT8 residual,
+//! and quantize to the row-major INT8 output
+//!
+template <int TPB, bool gelu>
+__global__ void fcImmaEpilogueKernel(const int rows, const int cols, const int32_t* acc, const float dqScale,
+    const float* bias, const int8_t* residual, const float residualScale, const float qScale, int8_t* output)
+{
+    const size_t total = static_cast<size_t>(rows) * cols;
+    for (size_t idx = blockIdx.x * static_cast<size_t>(TPB) + threadIdx.x; idx < total;
+         idx += static_cast<size_t>(gridDim.x) * TPB)
+    {
+        const int r = static_cast<int>(idx / cols);
+        const int c = static_cast<int>(idx % cols);
+        float val = acc[(static_cast<size_t>(c / 32) * rows + r) * 32 + c % 32] * dqScale;
+        if (bias)
+        {
+            val += bias[c];
+        }
+        if (gelu)
+        {
+            val *= kGeluA + kGeluA * tanhf(val * (kGeluC * val * val + kGeluB));
+        }
+        if (residual)
+        {
+            val += residual[idx] * residualScale;
+        }
+        output[idx] = static_cast<int8_t>(fmaxf(-128.F, fminf(127.F, rintf(val * qScale))));
+    }
+}
+
+void computeFCImmaEpilogue(const int rows, const int cols, const int32_t* acc, const float dqScale, const float* bias,
+    const bool gelu, const int8_t* residual, const float residualScale, const float qScale, int8_t* output,
+    cudaStream_t stream)
+{
+    constexpr int blockSize = 256;
+    const size_t total = static_cast<size_t>(rows) * cols;
+    const int blocks = static_cast<int>(std::min<size_t>((total + blockSize - 1) / blockSize, 1024));
+    if (gelu)
+    {
+        fcImmaEpilogueKernel<blockSize, true><<<blocks, blockSize, 0, stream>>>(
+            rows, cols, acc, dqScale, bias, residual, residualScale, qScale, output);
+    }
+    else
+    {
+        fcImmaEpilogueKernel<blockSize, false><<<blocks, blockSize, 0, stream>>>(
+            rows, cols, acc, dqScale, bias, residual, residualScale, qScale, output);
+    }
+    CHECK(cudaPeekAtLastError());
+}
+
+//!
+//! Largest magnitude of the host weights, which sets the scale of their per-tensor quantization
+//!
+static float weightsAbsMax(const Weights& w)
+{
+    float absMax = 0.F;
+    for (int64_t i = 0; i < w.count; ++i)
+    {
+        const float v = w.type == DataType::kFLOAT ? static_cast<const float*>(w.values)[i]
+                                                   : static_cast<float>(static_cast<const half*>(w.values)[i]);
+        absMax = std::max(absMax, std::abs(v));
+    }
+    return absMax;
+}
+
+static std::vector<int8_t> quantizeWeights(const Weights& w, const float scale)
+{
+    std::vector<int8_t> q(w.count);
+    for (int64_t i = 0; i < w.count; ++i)
+    {
+        const float v = w.type == DataType::kFLOAT ? static_cast<const float*>(w.values)[i]
+                                                   : static_cast<float>(static_cast<const half*>(w.values)[i]);
+        q[i] = static_cast<int8_t>(std::max(-127.F, std::min(127.F, std::round(v / scale))));
+    }
+    return q;
+}
 
 // Utility function to print customMatmulPerf_t structure
 static void printPerfStructure(const customMatmulPerf_t& perf, int const& m, int const& n, int const& k)
@@ -132,7 +267,8 @@ void LtGemmSearch(cublasLtHandle_t ltHandle, cublasOperation_t transa, cublasOpe
     void const* A, int const& lda, void const* B, int const& ldb, void const* beta, /* host pointer */
     void* C, int const& ldc, void* workSpace, size_t workSpaceSize, cudaDataType_t computeType,
     cudaDataType_t scaleType, cudaDataType_t Atype, cudaDataType_t Btype, cudaDataType_t Ctype,
-    std::vector<customMatmulPerf_t>& perfResults)
+    std::vector<customMatmulPerf_t>& perfResults, cublasLtOrder_t orderA, cublasLtOrder_t orderB,
+    cublasLtOrder_t orderC)
 {
 
     cublasStatus_t status = CUBLAS_STATUS_SUCCESS;
@@ -171,6 +307,13 @@ void LtGemmSearch(cublasLtHandle_t ltHandle, cublasOperation_t transa, cublasOpe
     CHECK(cublasLtMatrixLayoutCreate(&Adesc, Atype, transa == CUBLAS_OP_N ? m : k, transa == CUBLAS_OP_N ? k : m, lda));
     CHECK(cublasLtMatrixLayoutCreate(&Bdesc, Btype, transb == CUBLAS_OP_N ? k : n, transb == CUBLAS_OP_N ? n : k, ldb));
     CHECK(cublasLtMatrixLayoutCreate(&Cdesc, Ctype, m, n, ldc));
+    // The IMMA kernels only run on the COL32 and COL4_4R2_8C layouts
+    if (orderA != CUBLASLT_ORDER_COL)
+    {
+        CHECK(cublasLtMatrixLayoutSetAttribute(Adesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &orderA, sizeof(orderA)));
+        CHECK(cublasLtMatrixLayoutSetAttribute(Bdesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &orderB, sizeof(orderB)));
+        CHECK(cublasLtMatrixLayoutSetAttribute(Cdesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &orderC, sizeof(orderC)));
+    }
 
     // Request the 4 first AlgoId available for SGEMM ( computeType = scaleType =
     // Atype = Btype = Ctype = Dtype = CUDA_R_32F)
@@ -335,16 +478,66 @@ void LtGemmSearch(cublasLtHandle_t ltHandle, cublasOperation_t transa, cublasOpe
     CHECK(cudaEventDestroy(stopEvent));
 }
 
-FCPluginDynamic::FCPluginDynamic(const std::string name, const DataType type, const int outDim, const Weights& W)
+//!
+//! Search the fastest algorithm once per GPU and GEMM shape, FC layers with the same shape reuse the result
+//!
+template <typename T>
+static cublasLtMatmulAlgo_t cachedGemmSearch(Gemm<T> g, size_t& actualWorkspace)
+{
+    static_assert(sizeof(cublasLtMatmulAlgo_t) == sizeof(GemmAlgoEntry::algo), "Unexpected cuBLASLt algorithm size");
+
+    GemmAlgoKey key{};
+    key.m = g.m;
+    key.n = g.n;
+    key.k = g.k;
+    key.dataType = Gemm<T>::Types::cudaTypeI;
+    key.transA = g.transA;
+    key.transB = g.transB;
+    const bool cacheable = nvinfer1::plugin::setGemmAlgoKeyDevice(key);
+
+    cublasLtMatmulAlgo_t algo;
+    GemmAlgoEntry entry;
+    if (cacheable && nvinfer1::plugin::findGemmAlgo(key, entry))
+    {
+        gLogVerbose << "Reusing cached cuBLAS GEMM algorithm" << std::endl;
+        memcpy(&algo, entry.algo, sizeof(algo));
+        actualWorkspace = entry.workspaceSize;
+        return algo;
+    }
+
+    gLogVerbose << "Start cuBLAS GEMM search" << std::endl;
+    algo = gemmSearch<T>(g, maxWorkspaceBytes, actualWorkspace);
+    gLogVerbose << "Done cuBLAS GEMM search" << std::endl;
+    if (cacheable)
+    {
+        memcpy(entry.algo, &algo, sizeof(algo));
+        entry.workspaceSize = actualWorkspace;
+        nvinfer1::plugin::insertGemmAlgo(key, entry);
+    }
+    return algo;
+}
+
+FCPluginDynamic::FCPluginDynamic(const std::string name, const DataType type, const int outDim, const Weights& W,
+    const Weights& bias, const FCEpilogue epilogue)
     : mLayerName(name)
     , mOutDim(outDim)
     , mW(W)
+    , mB(bias)
     , mNumParams(W.count)
     , mType(type)
+    , mEpilogue(epilogue)
+    , mNumBias(bias.count)
+    , mWeightScale(1.F)
+    , mInputScale(1.F)
+    , mOutputScale(1.F)
+    , mResidualScale(1.F)
+    , mLtEpilogue(false)
 {
-    mB.count = 0;
-    mB.values = nullptr;
     memset(mAlgo.data, 0, sizeof(mAlgo.data));
+    if (mType == DataType::kINT8 && W.values)
+    {
+        mWeightScale = std::max(weightsAbsMax(W), 1e-6F) / 127.F;
+    }
 }
 
 FCPluginDynamic::FCPluginDynamic(const std::string name, const void* data, size_t length)
@@ -362,11 +555,43 @@ FCPluginDynamic::FCPluginDynamic(const std::string name, const void* data, size_
     // reading this back as bytes, therefore need the element size
     const char* d = static_cast<const char*>(data);
     size_t wordSize = samplesCommon::getElementSize(mType);
-    mWdev = deserToDev<char>(d, mNumParams * wordSize);
+    mStaged.stage<char>(d, mNumParams * wordSize);
+    length -= mNumParams * wordSize;
+
+    // Engines serialized before epilogues were supported end with the weights
+    mEpilogue = FCEpilogue::kNONE;
+    mNumBias = 0;
+    mLtEpilogue = false;
+    mWeightScale = 1.F;
+    mInputScale = 1.F;
+    mOutputScale = 1.F;
+    mResidualScale = 1.F;
+    if (length > 0)
+    {
+        data = d;
+        deserialize_value(&data, &length, &mEpilogue);
+        deserialize_value(&data, &length, &mNumBias);
+        d = static_cast<const char*>(data);
+        if (mNumBias > 0)
+        {
+            mStaged.stage<char>(d, mNumBias * getBiasWordSize());
+            length -= mNumBias * getBiasWordSize();
+        }
+    }
+    if (mType == DataType::kINT8)
+    {
+        data = d;
+        deserialize_value(&data, &length, &mWeightScale);
+        deserialize_value(&data, &length, &mInputScale);
+        deserialize_value(&data, &length, &mOutputScale);
+        deserialize_value(&data, &length, &mResidualScale);
+    }
 
     // this signals init not to allocate/copy
     mW.count = mNumParams;
     mW.values = nullptr;
+    mB.count = mNumBias;
+    mB.values = nullptr;
 
     gLogVerbose << "FC Deser done\n";
 }
@@ -374,13 +599,22 @@ FCPluginDynamic::FCPluginDynamic(const std::string name, const void* data, size_
 // IPluginV2DynamicExt Methods
 IPluginV2DynamicExt* FCPluginDynamic::clone() const
 {
-    return new FCPluginDynamic(mLayerName, mType, mOutDim, mW);
+    auto ret = new FCPluginDynamic(mLayerName, mType, mOutDim, mW, mB, mEpilogue);
+    // Clones share the device weights instead of uploading their own copy in initialize()
+    ret->mWdev = mWdev;
+    ret->mBiasDev = mBiasDev;
+    ret->mStaged = mStaged;
+    ret->mWeightScale = mWeightScale;
+    ret->mInputScale = mInputScale;
+    ret->mOutputScale = mOutputScale;
+    ret->mResidualScale = mResidualScale;
+    return ret;
 }
 
 DimsExprs FCPluginDynamic::getOutputDimensions(
     int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
 {
-    assert(nbInputs == 1);
+    assert(nbInputs == getNbInputs());
     assert(outputIndex == 0);
     DimsExprs ret;
     ret.nbDims = 5;
@@ -394,7 +628,7 @@ DimsExprs FCPluginDynamic::getOutputDimensions(
 
 bool FCPluginDynamic::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
 {
-    assert(nbInputs == 1);
+    assert(nbInputs == getNbInputs());
     assert(nbOutputs == 1);
 
     const PluginTensorDesc& in = inOut[pos];
@@ -404,7 +638,7 @@ bool FCPluginDynamic::supportsFormatCombination(int pos, const PluginTensorDesc*
     }
     const PluginTensorDesc& prev = inOut[pos - 1];
 
-    // output
+    // residual or output
     return in.type == prev.type && in.format == prev.format;
 }
 
@@ -413,9 +647,13 @@ void FCPluginDynamic::configurePlugin(
 {
     // Validate input arguments
     assert(nbOutputs == 1);
-    assert(nbInputs == 1);
+    assert(nbInputs == getNbInputs());
     assert(mType == inputs[0].desc.type);
     const auto& inDims0 = inputs[0].desc.dims;
+    // The residual has the shape of the output
+    assert(mEpilogue != FCEpilogue::kRESIDUAL
+        || std::equal(outputs[0].desc.dims.d, outputs[0].desc.dims.d + outputs[0].desc.dims.nbDims,
+            inputs[1].desc.dims.d));
 
     assert(inDims0.nbDims == 5);
     mK = inDims0.d[HDIM]; // hiddensize
@@ -430,21 +668,39 @@ void FCPluginDynamic::configurePlugin(
 
     mNmax = S * B;
 
+    if (mType == DataType::kINT8)
+    {
+        // The COL32 layouts of the IMMA kernels are not padded
+        assert(mK % 32 == 0);
+        // The quantization scales of the tensors, from the calibration or the dynamic ranges of the network
+        mInputScale = inputs[0].desc.scale;
+        mOutputScale = outputs[0].desc.scale;
+        if (mEpilogue == FCEpilogue::kRESIDUAL)
+        {
+            mResidualScale = inputs[1].desc.scale;
+        }
+    }
+
     // max workspace size allowed for search
     size_t actualWorkspace = 0;
 
     if (mAlgo.data[0] == 0 && memcmp(mAlgo.data, mAlgo.data+1, sizeof(mAlgo.data)-sizeof(mAlgo.data[0])) == 0)
     {
-        gLogVerbose << "Start cuBLAS GEMM search" << std::endl;
         if (mType == DataType::kFLOAT)
         {
-            mAlgo = gemmSearch<float>(mOutDim, mNmax, mK, maxWorkspaceBytes, actualWorkspace);
+            mAlgo = cachedGemmSearch(Gemm<float>(mOutDim, mNmax, mK, false, false), actualWorkspace);
+        }
+        else if (mType == DataType::kHALF)
+        {
+            mAlgo = cachedGemmSearch(Gemm<half>(mOutDim, mNmax, mK, false, false), actualWorkspace);
         }
         else
         {
-            mAlgo = gemmSearch<half>(mOutDim, mNmax, mK, maxWorkspaceBytes, actualWorkspace);
+            // The tokens are the rows of the IMMA GEMM, so that the weights are the operand in COL4_4R2_8C
+            Gemm<int8_t> g;
+            g.initImma(mNmax, mOutDim, mK);
+            mAlgo = cachedGemmSearch(g, actualWorkspace);
         }
-        gLogVerbose << "Done cuBLAS GEMM search" << std::endl;
     }
 
     AlgoProps p;
@@ -466,32 +722,78 @@ void FCPluginDynamic::configurePlugin(
 size_t FCPluginDynamic::getWorkspaceSize(
     const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
 {
+    if (mType == DataType::kINT8)
+    {
+        // The input in COL32 and the INT32 accumulators after the cuBLASLt workspace
+        const size_t n = inputs[0].dims.d[SDIM] * inputs[0].dims.d[BDIM];
+        const size_t k = inputs[0].dims.d[HDIM];
+        return maxWorkspaceBytes + alignTo<size_t>(n * k, immaBufferAlignment) + n * mOutDim * sizeof(int32_t);
+    }
     return maxWorkspaceBytes;
 }
 
 int FCPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
     const void* const* inputs, void* const* outputs, void* workSpace, cudaStream_t stream)
 {
-    const size_t workspaceSize = getWorkspaceSize(inputDesc, 1, outputDesc, 1);
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    mStaged.wait();
+    const size_t workspaceSize = maxWorkspaceBytes;
 
     int status = -1;
 
     const int S = inputDesc->dims.d[SDIM];
     const int B = inputDesc->dims.d[BDIM];
     const int n = S * B;
-    mLtContext.setN(n);
 
+    // The residual is accumulated by the GEMM, output = W * input + residual
+    const bool residual = mEpilogue == FCEpilogue::kRESIDUAL;
+    const bool gelu = mEpilogue == FCEpilogue::kGELU;
+    const bool epilogueKernel = !mLtEpilogue && (mNumBias > 0 || gelu);
+
+    if (mType == DataType::kINT8)
+    {
+        char* buffers = static_cast<char*>(workSpace) + maxWorkspaceBytes;
+        int8_t* inputCol32 = reinterpret_cast<int8_t*>(buffers);
+        const size_t inputBytes = alignTo<size_t>(static_cast<size_t>(n) * mK, immaBufferAlignment);
+        int32_t* acc = reinterpret_cast<int32_t*>(buffers + inputBytes);
+
+        mLtContext.setImmaRows(n);
+        CHECK(mLtContext.transformInput(inputs[0], inputCol32, stream));
+
+        Gemm<int8_t> g;
+        g.initImma(n, mOutDim, mK);
+        g.A = inputCol32;
+        g.B = reinterpret_cast<int8_t*>(mWdev.get());
+        g.C = acc;
+        CHECK(cublasLtMatmul(mLtContext, g, mAlgo, workSpace, workspaceSize, stream));
+
+        const float* bias = mNumBias > 0 ? reinterpret_cast<const float*>(mBiasDev.get()) : nullptr;
+        const int8_t* skip = residual ? static_cast<const int8_t*>(inputs[1]) : nullptr;
+        computeFCImmaEpilogue(n, mOutDim, acc, mInputScale * mWeightScale, bias, gelu, skip, mResidualScale,
+            1.F / mOutputScale, static_cast<int8_t*>(outputs[0]), stream);
+        return 0;
+    }
+
+    mLtContext.setN(n);
     if (mType == DataType::kFLOAT)
     {
         const float* input = static_cast<const float*>(inputs[0]);
         float* output = static_cast<float*>(outputs[0]);
 
         Gemm<float> g(mOutDim, n, mK, false, false);
-        g.A = const_cast<float*>(reinterpret_cast<const float*>(mWdev));
+        g.A = const_cast<float*>(reinterpret_cast<const float*>(mWdev.get()));
         g.B = const_cast<float*>(reinterpret_cast<const float*>(input));
         g.C = output;
+        g.beta = residual ? 1.f : 0.f;
 
-        CHECK(cublasLtMatmul(mLtContext, g, mAlgo, workSpace, workspaceSize, stream));
+        CHECK(cublasLtMatmul(mLtContext, g, mAlgo, workSpace, workspaceSize, stream, residual ? inputs[1] : nullptr));
+        if (epilogueKernel)
+        {
+            const float* bias = reinterpret_cast<const float*>(mBiasDev.get());
+            computeFCEpilogue(mOutDim, n, bias, gelu, output, stream);
+        }
     }
     else if (mType == DataType::kHALF)
     {
@@ -500,10 +802,16 @@ int FCPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTens
 
         Gemm<half> g(mOutDim, n, mK, false, false);
 
-        g.A = const_cast<half*>(reinterpret_cast<const half*>(mWdev));
+        g.A = const_cast<half*>(reinterpret_cast<const half*>(mWdev.get()));
         g.B = const_cast<half*>(reinterpret_cast<const half*>(input));
         g.C = output;
-        CHECK(cublasLtMatmul(mLtContext, g, mAlgo, workSpace, workspaceSize, stream));
+        g.beta = half(residual ? 1.f : 0.f);
+        CHECK(cublasLtMatmul(mLtContext, g, mAlgo, workSpace, workspaceSize, stream, residual ? inputs[1] : nullptr));
+        if (epilogueKernel)
+        {
+            const half* bias = reinterpret_cast<const half*>(mBiasDev.get());
+            computeFCEpilogue(mOutDim, n, bias, gelu, output, stream);
+        }
     }
     else
     {
@@ -518,8 +826,8 @@ int FCPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTens
 DataType FCPluginDynamic::getOutputDataType(int index, const DataType* inputTypes, int nbInputs) const
 {
     assert(index == 0);
-    assert(nbInputs == 1);
-    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF);
+    assert(nbInputs == getNbInputs());
+    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF || inputTypes[0] == DataType::kINT8);
     // assert(inputTypes[0] == DataType::kHALF);
     return inputTypes[0];
 }
@@ -540,6 +848,17 @@ int FCPluginDynamic::getNbOutputs() const
     return 1;
 }
 
+int FCPluginDynamic::getNbInputs() const
+{
+    return mEpilogue == FCEpilogue::kRESIDUAL ? 2 : 1;
+}
+
+size_t FCPluginDynamic::getBiasWordSize() const
+{
+    // The INT8 plugin adds the bias to the dequantized accumulators
+    return mType == DataType::kINT8 ? sizeof(float) : samplesCommon::getElementSize(mType);
+}
+
 int FCPluginDynamic::initialize()
 {
 
@@ -549,29 +868,99 @@ int FCPluginDynamic::initialize()
         Gemm<half> g(mOutDim, mNmax, mK, false, false);
         mLtContext.create(g, 4096000);
     }
+    else if (mType == DataType::kINT8)
+    {
+        Gemm<int8_t> g;
+        g.initImma(mNmax, mOutDim, mK);
+        mLtContext.create(g, 4096000);
+    }
     else
     {
         Gemm<float> g(mOutDim, mNmax, mK, false, false);
         mLtContext.create(g, 4096000);
     }
 
-    if (mW.values)
+    // The weights staged at deserialization are uploaded together with those of the other plugins
+    if (!mStaged.empty() && !mWdev)
+    {
+        mStaged.resolve(0, mWdev);
+        if (mNumBias > 0)
+        {
+            mStaged.resolve(1, mBiasDev);
+        }
+    }
+
+    if (mW.values && !mWdev)
     {
         // target size
         size_t wordSize = samplesCommon::getElementSize(mType);
         size_t nbBytes = mW.count * wordSize;
-        CHECK(cudaMalloc(&mWdev, nbBytes));
+        char* weights{nullptr};
+        CHECK(pluginMalloc(&weights, nbBytes));
+        make_cuda_shared(mWdev, weights);
 
         if (mType == DataType::kFLOAT)
         {
-            convertAndCopyToDevice(mW, reinterpret_cast<float*>(mWdev));
+            convertAndCopyToDevice(mW, reinterpret_cast<float*>(weights));
+        }
+        else if (mType == DataType::kHALF)
+        {
+            convertAndCopyToDevice(mW, reinterpret_cast<half*>(weights));
         }
         else
         {
-            convertAndCopyToDevice(mW, reinterpret_cast<half*>(mWdev));
+            // Quantize once and keep the weights in the layout of the IMMA kernels, which is also serialized
+            const std::vector<int8_t> quantized = quantizeWeights(mW, mWeightScale);
+            int8_t* linear{nullptr};
+            CHECK(pluginMalloc(&linear, nbBytes));
+            CHECK(cudaMemcpy(linear, quantized.data(), nbBytes, cudaMemcpyHostToDevice));
+            CHECK(mLtContext.transformWeights(linear, weights, mOutDim, mK));
+            CHECK(cudaStreamSynchronize(nullptr));
+            CHECK(nvinfer1::plugin::pluginFree(linear));
         }
     }
 
+    if (mB.values && !mBiasDev)
+    {
+        const size_t nbBytes = mB.count * getBiasWordSize();
+        char* bias{nullptr};
+        CHECK(pluginMalloc(&bias, nbBytes));
+        make_cuda_shared(mBiasDev, bias);
+
+        if (mType == DataType::kFLOAT || mType == DataType::kINT8)
+        {
+            convertAndCopyToDevice(mB, reinterpret_cast<float*>(bias));
+        }
+        else
+        {
+            convertAndCopyToDevice(mB, reinterpret_cast<half*>(bias));
+        }
+    }
+
+    // Prefer the cuBLASLt epilogue when the selected algorithm implements it
+    // The INT8 plugin applies it with the dequantization of the accumulators
+    cublasLtEpilogue_t epilogue = mNumBias > 0 ? CUBLASLT_EPILOGUE_BIAS : CUBLASLT_EPILOGUE_DEFAULT;
+    mLtEpilogue = mEpilogue != FCEpilogue::kGELU && mType != DataType::kINT8;
+    if (mEpilogue == FCEpilogue::kGELU && mType != DataType::kINT8)
+    {
+#if CUDA_VERSION >= 11030
+        epilogue = mNumBias > 0 ? CUBLASLT_EPILOGUE_GELU_BIAS : CUBLASLT_EPILOGUE_GELU;
+        mLtEpilogue = true;
+#endif
+    }
+    if (mLtEpilogue && epilogue != CUBLASLT_EPILOGUE_DEFAULT)
+    {
+        uint32_t epilogueMask{0};
+        cublasLtMatmulAlgoCapGetAttribute(
+            &mAlgo, CUBLASLT_ALGO_CAP_EPILOGUE_MASK, &epilogueMask, sizeof(epilogueMask), nullptr);
+        mLtEpilogue = (epilogueMask & epilogue) == epilogue;
+        if (mLtEpilogue)
+        {
+            mLtContext.setEpilogue(epilogue, mBiasDev.get());
+        }
+    }
+    gLogVerbose << "FC epilogue: " << (mLtEpilogue ? "cuBLASLt" : "kernel") << std::endl;
+
     return 0;
 }
 
@@ -579,7 +968,7 @@ void FCPluginDynamic::terminate()
 {
 
     gLogVerbose << "FC Plugin terminate start" << std::endl;
-    cudaFree(mWdev);
+    // The device weights are shared with the clones and released with the last plugin holding them
     mLtContext.destroy();
     gLogVerbose << "FC Plugin terminate done" << std::endl;
 }
@@ -588,8 +977,11 @@ size_t FCPluginDynamic::getSerializationSize() const
 {
 
     size_t wordSize = samplesCommon::getElementSize(mType);
+    const size_t scales = mType == DataType::kINT8
+        ? sizeof(mWeightScale) + sizeof(mInputScale) + sizeof(mOutputScale) + sizeof(mResidualScale)
+        : 0;
     return wordSize * mNumParams + sizeof(mType) + sizeof(mOutDim) + sizeof(mNumParams) + sizeof(mAlgo) + sizeof(mNmax)
-        + sizeof(mK);
+        + sizeof(mK) + sizeof(mEpilogue) + sizeof(mNumBias) + getBiasWordSize() * mNumBias + scales;
 }
 
 void FCPluginDynamic::serialize(void* buffer) const
@@ -603,7 +995,24 @@ void FCPluginDynamic::serialize(void* buffer) const
 
     size_t wordSize = samplesCommon::getElementSize(mType);
     char* d = static_cast<char*>(buffer);
-    serFromDev(d, mWdev, mNumParams * wordSize); // in bytes
+    serFromDev(d, mWdev.get(), mNumParams * wordSize); // in bytes
+
+    buffer = d;
+    serialize_value(&buffer, mEpilogue);
+    serialize_value(&buffer, mNumBias);
+    d = static_cast<char*>(buffer);
+    if (mNumBias > 0)
+    {
+        serFromDev(d, mBiasDev.get(), mNumBias * getBiasWordSize());
+    }
+    if (mType == DataType::kINT8)
+    {
+        buffer = d;
+        serialize_value(&buffer, mWeightScale);
+        serialize_value(&buffer, mInputScale);
+        serialize_value(&buffer, mOutputScale);
+        serialize_value(&buffer, mResidualScale);
+    }
 }
 
 void FCPluginDynamic::destroy()
@@ -654,6 +1063,8 @@ IPluginV2* FCPluginDynamicCreator::createPlugin(const char* name, const PluginFi
     Weights W;
     W.count = 0;
     W.values = nullptr;
+    Weights bias{DataType::kFLOAT, nullptr, 0};
+    int epilogue = 0;
 
     for (int i = 0; i < fc->nbFields; i++)
     {
@@ -679,6 +1090,20 @@ IPluginV2* FCPluginDynamicCreator::createPlugin(const char* name, const PluginFi
             gLogVerbose << "Is W float32: " << (W.type == DataType::kFLOAT) << std::endl;
         }
 
+        if (field_name.compare("bias") == 0)
+        {
+            gLogVerbose << "Building bias...\n";
+            bias.values = fc->fields[i].data;
+            bias.count = fc->fields[i].length;
+            bias.type = fieldTypeToDataType(fc->fields[i].type);
+        }
+
+        if (field_name.compare("epilogue") == 0)
+        {
+            epilogue = static_cast<const int*>(fc->fields[i].data)[0];
+            gLogVerbose << "Building epilogue: " << epilogue << std::endl;
+        }
+
     }
 
     if (outDims <= 0)
@@ -695,8 +1120,25 @@ IPluginV2* FCPluginDynamicCreator::createPlugin(const char* name, const PluginFi
         gLogError << "Invalid weights" << std::endl;
     }
 
+    if (bias.values && bias.count != outDims)
+    {
+        gLogError << "Invalid bias, expected " << outDims << " values" << std::endl;
+        return nullptr;
+    }
+
+    if (epilogue < static_cast<int>(FCEpilogue::kNONE) || epilogue > static_cast<int>(FCEpilogue::kRESIDUAL))
+    {
+        gLogError << "Invalid epilogue " << epilogue << std::endl;
+        return nullptr;
+    }
+
     DataType type = static_cast<DataType>(typeId);
-    return new FCPluginDynamic(name, type, outDims, W);
+    if (type == DataType::kINT8 && outDims % 32 != 0)
+    {
+        gLogError << "INT8 requires a multiple of 32 output dimensions, got " << outDims << std::endl;
+        return nullptr;
+    }
+    return new FCPluginDynamic(name, type, outDims, W, bias, static_cast<FCEpilogue>(epilogue));
 }
 
 IPluginV2* FCPluginDynamicCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
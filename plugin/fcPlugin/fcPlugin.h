@@ -19,6 +19,7 @@
 
 #include "bertCommon.h"
 #include "NvInferPlugin.h"
+#include "libraryHandles.h"
 
 #include <cublasLt.h>
 #include <string>
@@ -56,6 +57,21 @@ struct GemmTypes<float>
     static const cudaDataType_t cudaTypeCom = CUDA_R_32F;
 };
 
+//!
+//! IMMA kernels accumulate INT8 products in INT32, the plugin dequantizes the accumulators
+//!
+template <>
+struct GemmTypes<int8_t>
+{
+    static const cudaDataType_t cudaTypeI = CUDA_R_8I;
+    using dataTypeI = int8_t;
+    static const cudaDataType_t cudaTypeO = CUDA_R_32I;
+    using dataTypeO = int32_t;
+    static const cudaDataType_t cudaTypeS = CUDA_R_32I;
+    using dataTypeS = int32_t;
+    static const cudaDataType_t cudaTypeCom = CUDA_R_32I;
+};
+
 template <typename T>
 struct Gemm
 {
@@ -76,6 +92,10 @@ struct Gemm
     cublasOperation_t opA;
     cublasOperation_t opB;
 
+    cublasLtOrder_t orderA{CUBLASLT_ORDER_COL};
+    cublasLtOrder_t orderB{CUBLASLT_ORDER_COL};
+    cublasLtOrder_t orderC{CUBLASLT_ORDER_COL};
+
     const int word_size{sizeof(T)};
     typename Types::dataTypeS alpha;
     typename Types::dataTypeS beta;
@@ -114,10 +134,28 @@ struct Gemm
         elemC = n * m;
         bytesA = word_size * elemA;
         bytesB = word_size * elemB;
-        bytesC = word_size * elemC;
+        bytesC = sizeof(typename Types::dataTypeO) * elemC;
         alpha = T(1.f);
         beta = T(0.f);
     }
+
+    //!
+    //! C = A * B^T for the IMMA kernels: A is m x k in COL32, B is n x k in COL4_4R2_8C and C is m x n in COL32.
+    //! k and n must be multiples of 32, so that the layouts are not padded.
+    //!
+    void initImma(int m_, int n_, int k_)
+    {
+        init(m_, n_, k_, false, true);
+        rA = m;
+        rB = n;
+        rC = m;
+        ldA = 32 * m;
+        ldB = 32 * alignTo(n, 8);
+        ldC = 32 * m;
+        orderA = CUBLASLT_ORDER_COL32;
+        orderB = CUBLASLT_ORDER_COL4_4R2_8C;
+        orderC = CUBLASLT_ORDER_COL32;
+    }
 };
 
 auto constexpr algoCombinations = 6000;
@@ -161,7 +199,10 @@ void LtGemmSearch(cublasLtHandle_t ltHandle,
                   cudaDataType_t Atype,
                   cudaDataType_t Btype,
                   cudaDataType_t Ctype,
-                  std::vector<customMatmulPerf_t> &perfResults);
+                  std::vector<customMatmulPerf_t> &perfResults,
+                  cublasLtOrder_t orderA = CUBLASLT_ORDER_COL,
+                  cublasLtOrder_t orderB = CUBLASLT_ORDER_COL,
+                  cublasLtOrder_t orderC = CUBLASLT_ORDER_COL);
 // clang-format on
 template <typename T>
 void LtGemmSearch(cublasLtHandle_t ltHandle, const Gemm<T>& g, void* workSpace, size_t workSpaceSize,
@@ -189,7 +230,10 @@ void LtGemmSearch(cublasLtHandle_t ltHandle, const Gemm<T>& g, void* workSpace,
                Gemm<T>::Types::cudaTypeI,
                Gemm<T>::Types::cudaTypeI,
                Gemm<T>::Types::cudaTypeO,
-               perfResults);
+               perfResults,
+               g.orderA,
+               g.orderB,
+               g.orderC);
     // clang-format on
 }
 
@@ -205,6 +249,9 @@ struct LtContext
     cublasLtMatrixLayout_t Bdesc{nullptr};
     cublasLtMatrixLayout_t Cdesc{nullptr};
     cublasLtMatmulHeuristicResult_t heuristicResult = {};
+    // IMMA only: the row-major INT8 input, transformed to the COL32 layout of A before each GEMM
+    cublasLtMatrixLayout_t inputDesc{nullptr};
+    cublasLtMatrixTransformDesc_t transformDesc{nullptr};
 
     void destroy()
     {
@@ -214,13 +261,22 @@ struct LtContext
         cublasLtMatrixLayoutDestroy(Adesc);
         cublasLtMatrixLayoutDestroy(Bdesc);
         cublasLtMatrixLayoutDestroy(Cdesc);
-
-        cublasLtDestroy(cublas);
+        if (transformDesc)
+        {
+            cublasLtMatrixLayoutDestroy(inputDesc);
+            cublasLtMatrixTransformDescDestroy(transformDesc);
+            inputDesc = nullptr;
+            transformDesc = nullptr;
+        }
+
+        nvinfer1::plugin::releaseLibraryHandles();
     }
     template <typename T>
     void create(Gemm<T>& g, size_t workspaceSize)
     {
-        cublasLtCreate(&cublas);
+        // The handle of the device is shared with the other plugins
+        nvinfer1::plugin::acquireLibraryHandles();
+        cublas = nvinfer1::plugin::getCublasLtHandle();
         typeA = Gemm<T>::Types::cudaTypeI;
         typeB = Gemm<T>::Types::cudaTypeI;
         typeC = Gemm<T>::Types::cudaTypeO;
@@ -235,6 +291,18 @@ struct LtContext
         cublasLtMatrixLayoutCreate(&Adesc, typeA, g.rA, g.cA, g.ldA);
         cublasLtMatrixLayoutCreate(&Bdesc, typeB, g.rB, g.cB, g.ldB);
         cublasLtMatrixLayoutCreate(&Cdesc, typeC, g.rC, g.cC, g.ldC);
+
+        if (g.orderA != CUBLASLT_ORDER_COL)
+        {
+            cublasLtMatrixLayoutSetAttribute(Adesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &g.orderA, sizeof(g.orderA));
+            cublasLtMatrixLayoutSetAttribute(Bdesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &g.orderB, sizeof(g.orderB));
+            cublasLtMatrixLayoutSetAttribute(Cdesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &g.orderC, sizeof(g.orderC));
+
+            const cublasLtOrder_t rowMajor = CUBLASLT_ORDER_ROW;
+            cublasLtMatrixLayoutCreate(&inputDesc, typeA, g.rA, g.k, g.k);
+            cublasLtMatrixLayoutSetAttribute(inputDesc, CUBLASLT_MATRIX_LAYOUT_ORDER, &rowMajor, sizeof(rowMajor));
+            cublasLtMatrixTransformDescCreate(&transformDesc, CUDA_R_32F);
+        }
     }
 
     void setN(int n)
@@ -243,11 +311,66 @@ struct LtContext
         cublasLtMatrixLayoutSetAttribute(Bdesc, CUBLASLT_MATRIX_LAYOUT_COLS, &n, sizeof(n));
         cublasLtMatrixLayoutSetAttribute(Cdesc, CUBLASLT_MATRIX_LAYOUT_COLS, &n, sizeof(n));
     }
+
+    //!
+    //! The IMMA GEMM has the tokens in the rows of A and C, whose COL32 leading dimension depends on them
+    //!
+    void setImmaRows(int m)
+    {
+        const uint64_t rows = m;
+        const int64_t ld = 32 * rows;
+        cublasLtMatrixLayoutSetAttribute(inputDesc, CUBLASLT_MATRIX_LAYOUT_ROWS, &rows, sizeof(rows));
+        cublasLtMatrixLayoutSetAttribute(Adesc, CUBLASLT_MATRIX_LAYOUT_ROWS, &rows, sizeof(rows));
+        cublasLtMatrixLayoutSetAttribute(Adesc, CUBLASLT_MATRIX_LAYOUT_LD, &ld, sizeof(ld));
+        cublasLtMatrixLayoutSetAttribute(Cdesc, CUBLASLT_MATRIX_LAYOUT_ROWS, &rows, sizeof(rows));
+        cublasLtMatrixLayoutSetAttribute(Cdesc, CUBLASLT_MATRIX_LAYOUT_LD, &ld, sizeof(ld));
+    }
+
+    //!
+    //! Transform the row-major INT8 input to the COL32 layout of A
+    //!
+    cublasStatus_t transformInput(const void* input, void* inputCol32, cudaStream_t stream)
+    {
+        const float alpha{1.F};
+        const float beta{0.F};
+        return cublasLtMatrixTransform(cublas, transformDesc, &alpha, input, inputDesc, &beta, nullptr, nullptr,
+            inputCol32, Adesc, stream);
+    }
+
+    //!
+    //! Transform the column-major weights, n x k, to the COL4_4R2_8C layout of B once at initialization
+    //!
+    cublasStatus_t transformWeights(const void* weights, void* weightsCol4, int n, int k)
+    {
+        cublasLtMatrixLayout_t weightsDesc{nullptr};
+        cublasLtMatrixLayoutCreate(&weightsDesc, typeB, n, k, n);
+        const float alpha{1.F};
+        const float beta{0.F};
+        const cublasStatus_t status = cublasLtMatrixTransform(cublas, transformDesc, &alpha, weights, weightsDesc,
+            &beta, nullptr, nullptr, weightsCol4, Bdesc, nullptr);
+        cublasLtMatrixLayoutDestroy(weightsDesc);
+        return status;
+    }
+
+    //!
+    //! Let cuBLASLt apply the epilogue, with a bias vector of m elements in the output type if it has one
+    //!
+    void setEpilogue(cublasLtEpilogue_t epilogue, const void* bias)
+    {
+        cublasLtMatmulDescSetAttribute(operationDesc, CUBLASLT_MATMUL_DESC_EPILOGUE, &epilogue, sizeof(epilogue));
+        if (bias)
+        {
+            cublasLtMatmulDescSetAttribute(operationDesc, CUBLASLT_MATMUL_DESC_BIAS_POINTER, &bias, sizeof(bias));
+        }
+    }
 };
 
+//!
+//! Computes D = alpha * A * B + beta * C, where D is g.C and C is g.C unless another input matrix is given
+//!
 template <typename T>
-cublasStatus_t inline cublasLtMatmul(
-    LtContext& ctx, Gemm<T>& g, cublasLtMatmulAlgo_t algo, void* workspace, size_t workspaceSize, cudaStream_t stream)
+cublasStatus_t inline cublasLtMatmul(LtContext& ctx, Gemm<T>& g, cublasLtMatmulAlgo_t algo, void* workspace,
+    size_t workspaceSize, cudaStream_t stream, const void* C = nullptr)
 {
     // clang-format off
      return cublasLtMatmul(ctx.cublas,
@@ -258,7 +381,7 @@ cublasStatus_t inline cublasLtMatmul(
                     g.B,
                     ctx.Bdesc,
                     &g.beta,
-                    g.C,
+                    C ? C : g.C,
                     ctx.Cdesc,
                     g.C,
                     ctx.Cdesc,
@@ -336,22 +459,22 @@ inline cublasLtMatmulAlgo_t gemmSearch(
     Gemm<T> g(m, n, k, false, false);
     std::vector<customMatmulPerf_t> perfResults(algoCombinations);
 
-    cudaMalloc(&g.A, g.bytesA);
-    cudaMalloc(&g.B, g.bytesB);
-    cudaMalloc(&g.C, g.bytesC);
+    nvinfer1::plugin::pluginMalloc(&g.A, g.bytesA);
+    nvinfer1::plugin::pluginMalloc(&g.B, g.bytesB);
+    nvinfer1::plugin::pluginMalloc(&g.C, g.bytesC);
 
     void* workspace;
-    CHECK(cudaMalloc(&workspace, workspaceSize));
-    cublasLtHandle_t lt;
-    CHECK(cublasLtCreate(&lt));
+    CHECK(nvinfer1::plugin::pluginMalloc(&workspace, workspaceSize));
+    nvinfer1::plugin::acquireLibraryHandles();
+    cublasLtHandle_t lt = nvinfer1::plugin::getCublasLtHandle();
     LtGemmSearch(lt, g, workspace, workspaceSize, perfResults);
     cudaDeviceSynchronize();
-    cublasLtDestroy(lt);
-    cudaFree(workspace);
+    nvinfer1::plugin::releaseLibraryHandles();
+    nvinfer1::plugin::pluginFree(workspace);
 
-    cudaFree(g.A);
-    cudaFree(g.B);
-    cudaFree(g.C);
+    nvinfer1::plugin::pluginFree(g.A);
+    nvinfer1::plugin::pluginFree(g.B);
+    nvinfer1::plugin::pluginFree(g.C);
 
     actualWorkspace = perfResults[0].workspaceSize;
     return perfResults[0].algo;
@@ -363,27 +486,37 @@ inline cublasLtMatmulAlgo_t gemmSearch(Gemm<T>& g, const size_t workspaceSize, s
 
     std::vector<customMatmulPerf_t> perfResults(algoCombinations);
 
-    cudaMalloc(&g.A, g.bytesA);
-    cudaMalloc(&g.B, g.bytesB);
-    cudaMalloc(&g.C, g.bytesC);
+    nvinfer1::plugin::pluginMalloc(&g.A, g.bytesA);
+    nvinfer1::plugin::pluginMalloc(&g.B, g.bytesB);
+    nvinfer1::plugin::pluginMalloc(&g.C, g.bytesC);
 
     void* workspace;
-    CHECK(cudaMalloc(&workspace, workspaceSize));
-    cublasLtHandle_t lt;
-    CHECK(cublasLtCreate(&lt));
+    CHECK(nvinfer1::plugin::pluginMalloc(&workspace, workspaceSize));
+    nvinfer1::plugin::acquireLibraryHandles();
+    cublasLtHandle_t lt = nvinfer1::plugin::getCublasLtHandle();
     LtGemmSearch(lt, g, workspace, workspaceSize, perfResults);
     cudaDeviceSynchronize();
-    cublasLtDestroy(lt);
-    cudaFree(workspace);
+    nvinfer1::plugin::releaseLibraryHandles();
+    nvinfer1::plugin::pluginFree(workspace);
 
-    cudaFree(g.A);
-    cudaFree(g.B);
-    cudaFree(g.C);
+    nvinfer1::plugin::pluginFree(g.A);
+    nvinfer1::plugin::pluginFree(g.B);
+    nvinfer1::plugin::pluginFree(g.C);
 
     actualWorkspace = perfResults[0].workspaceSize;
     return perfResults[0].algo;
 }
 
+//!
+//! Operation fused with the matrix multiplication, after the optional bias
+//!
+enum class FCEpilogue : int32_t
+{
+    kNONE = 0,     //!< Output the product
+    kGELU = 1,     //!< Apply the Gelu activation
+    kRESIDUAL = 2, //!< Add a second input of the output shape
+};
+
 // One of the preferred ways of making TensorRT to be able to see
 // our custom layer requires extending IPluginV2 and IPluginCreator classes.
 // For requirements for overriden functions, check TensorRT API docs.
@@ -391,8 +524,9 @@ inline cublasLtMatmulAlgo_t gemmSearch(Gemm<T>& g, const size_t workspaceSize, s
 class FCPluginDynamic : public nvinfer1::IPluginV2DynamicExt
 {
 public:
-    FCPluginDynamic(
-        const std::string name, const nvinfer1::DataType type, const int outDim, const nvinfer1::Weights& W);
+    FCPluginDynamic(const std::string name, const nvinfer1::DataType type, const int outDim, const nvinfer1::Weights& W,
+        const nvinfer1::Weights& bias = nvinfer1::Weights{nvinfer1::DataType::kFLOAT, nullptr, 0},
+        const FCEpilogue epilogue = FCEpilogue::kNONE);
 
     FCPluginDynamic(const std::string name, const void* data, size_t length);
 
@@ -429,6 +563,9 @@ public:
     const char* getPluginNamespace() const override;
 
 private:
+    int getNbInputs() const;
+    size_t getBiasWordSize() const;
+
     const std::string mLayerName;
     std::string mNamespace;
 
@@ -443,7 +580,19 @@ private:
     nvinfer1::Weights mW;
     nvinfer1::Weights mB;
 
-    char* mWdev; // store weights as bytes: depends on the compute type
+    bert::cuda_shared_ptr<char> mWdev; // store weights as bytes: depends on the compute type
+
+    FCEpilogue mEpilogue;
+    size_t mNumBias; // 0 or mOutDim
+    // INT8 only: the weights are quantized per tensor and stored in the COL4_4R2_8C layout of the IMMA kernels, the
+    // bias stays in FP32
+    float mWeightScale;
+    float mInputScale;
+    float mOutputScale;
+    float mResidualScale;
+    bert::cuda_shared_ptr<char> mBiasDev;
+    bert::StagedWeights mStaged; // Weights then bias of a deserialized plugin
+    bool mLtEpilogue; // the algorithm applies bias and epilogue, otherwise a kernel does after the GEMM
 
     LtContext mLtContext;
 
@@ -14,9 +14,12 @@
  * limitations under the License.
  */
 #include "flattenConcat.h"
+#include "flattenConcatKernels.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <algorithm>
 #include <cstring>
-#include <cudnn.h>
 #include <iostream>
 #include <numeric>
 #include <string>
@@ -66,9 +69,6 @@ FlattenConcat::FlattenConcat(
     {
         mInputConcatAxis[i] = inputConcatAxis[i];
     }
-
-    // Create cublas context
-    LOG_ERROR(cublasCreate(&mCublas));
 }
 
 FlattenConcat::FlattenConcat(const void* data, size_t length)
@@ -80,7 +80,7 @@ FlattenConcat::FlattenConcat(const void* data, size_t length)
     mOutputConcatAxis = read<int>(d);
     mNumInputs = read<int>(d);
     LOG_ERROR(cudaMallocHost((void**) &mInputConcatAxis, mNumInputs * sizeof(int)));
-    LOG_ERROR(cudaMallocHost((void**) &mCopySize, mNumInputs * sizeof(int)));
+    LOG_ERROR(cudaMallocHost((void**) &mCopySize, mNumInputs * sizeof(size_t)));
 
     std::for_each(mInputConcatAxis, mInputConcatAxis + mNumInputs, [&](int& inp) { inp = read<int>(d); });
 
@@ -88,6 +88,8 @@ FlattenConcat::FlattenConcat(const void* data, size_t length)
 
     std::for_each(mCopySize, mCopySize + mNumInputs, [&](size_t& inp) { inp = read<size_t>(d); });
 
+    mDataType = read<DataType>(d);
+
     ASSERT(d == a + length);
 }
 
@@ -146,10 +148,7 @@ int FlattenConcat::initialize()
     return STATUS_SUCCESS;
 }
 
-void FlattenConcat::terminate()
-{
-    LOG_ERROR(cublasDestroy(mCublas));
-}
+void FlattenConcat::terminate() {}
 
 size_t FlattenConcat::getWorkspaceSize(int) const
 {
@@ -158,43 +157,31 @@ size_t FlattenConcat::getWorkspaceSize(int) const
 
 int FlattenConcat::enqueue(int batchSize, const void* const* inputs, void** outputs, void*, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     int numConcats = 1;
     ASSERT(mConcatAxisID != 0);
     // mCHW is the first input tensor
     numConcats = std::accumulate(mCHW.d, mCHW.d + mConcatAxisID - 1, 1, std::multiplies<int>());
 
-    LOG_ERROR(cublasSetStream(mCublas, stream));
-
     // Num concats will be proportional to number of samples in a batch
     if (!mIgnoreBatch)
     {
         numConcats *= batchSize;
     }
 
-    auto* output = reinterpret_cast<float*>(outputs[0]);
-    int offset = 0;
-    for (int i = 0; i < mNumInputs; ++i)
-    {
-        const auto* input = reinterpret_cast<const float*>(inputs[i]);
-        float* inputTemp;
-        LOG_ERROR(cudaMalloc(&inputTemp, mCopySize[i] * batchSize));
-        LOG_ERROR(cudaMemcpyAsync(inputTemp, input, mCopySize[i] * batchSize, cudaMemcpyDeviceToDevice, stream));
-
-        for (int n = 0; n < numConcats; ++n)
-        {
-            LOG_ERROR(cublasScopy(mCublas, mInputConcatAxis[i], inputTemp + n * mInputConcatAxis[i], 1,
-                output + (n * mOutputConcatAxis + offset), 1));
-        }
-        LOG_ERROR(cudaFree(inputTemp));
-        offset += mInputConcatAxis[i];
-    }
+    // Every input row goes straight to its offset in the output, nothing is allocated here
+    LOG_ERROR(flattenConcatGather(
+        stream, mDataType, mNumInputs, inputs, mInputConcatAxis, mOutputConcatAxis, numConcats, outputs[0]));
 
     return 0;
 }
 
 size_t FlattenConcat::getSerializationSize() const
 {
-    return sizeof(bool) + sizeof(int) * (3 + mNumInputs) + sizeof(nvinfer1::Dims) + (sizeof(mCopySize) * mNumInputs);
+    return sizeof(bool) + sizeof(int) * (3 + mNumInputs) + sizeof(nvinfer1::Dims) + (sizeof(mCopySize) * mNumInputs)
+        + sizeof(DataType);
 }
 
 void FlattenConcat::serialize(void* buffer) const
@@ -213,6 +200,7 @@ void FlattenConcat::serialize(void* buffer) const
     {
         write(d, mCopySize[i]);
     }
+    write(d, mDataType);
     ASSERT(d == a + getSerializationSize());
 }
 
@@ -252,7 +240,7 @@ const char* FlattenConcat::getPluginNamespace() const
 DataType FlattenConcat::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
     ASSERT(index < 3);
-    return DataType::kFLOAT;
+    return inputTypes[0];
 }
 
 void FlattenConcat::configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
@@ -263,6 +251,7 @@ void FlattenConcat::configurePlugin(const Dims* inputDims, int nbInputs, const D
     mCHW = inputDims[0];
     mNumInputs = nbInputs;
     ASSERT(inputDims[0].nbDims == 3);
+    mDataType = inputTypes[0];
 
     if (mInputConcatAxis == nullptr)
     {
@@ -292,13 +281,14 @@ void FlattenConcat::configurePlugin(const Dims* inputDims, int nbInputs, const D
 
     for (int i = 0; i < nbInputs; ++i)
     {
-        mCopySize[i] = inputDims[i].d[0] * inputDims[i].d[1] * inputDims[i].d[2] * sizeof(float);
+        mCopySize[i] = inputDims[i].d[0] * inputDims[i].d[1] * inputDims[i].d[2]
+            * (mDataType == DataType::kHALF ? sizeof(uint16_t) : sizeof(float));
     }
 }
 
 bool FlattenConcat::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 }
 const char* FlattenConcat::getPluginType() const
 {
@@ -319,6 +309,7 @@ IPluginV2Ext* FlattenConcat::clone() const
 {
     auto* plugin
         = new FlattenConcat(mConcatAxisID, mIgnoreBatch, mNumInputs, mOutputConcatAxis, mInputConcatAxis, mCopySize);
+    plugin->mDataType = mDataType;
     plugin->setPluginNamespace(mPluginNamespace);
     return plugin;
 }
@@ -19,8 +19,6 @@
 #include "NvInferPlugin.h"
 #include "plugin.h"
 #include <cstdlib>
-#include <cublas_v2.h>
-#include <cudnn.h>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -111,8 +109,8 @@ private:
     int mConcatAxisID{0}, mOutputConcatAxis{0}, mNumInputs{0};
     int* mInputConcatAxis = nullptr;
     nvinfer1::Dims mCHW;
+    DataType mDataType{DataType::kFLOAT};
     const char* mPluginNamespace;
-    cublasHandle_t mCublas;
 };
 
 class FlattenConcatPluginCreator : public BaseCreator
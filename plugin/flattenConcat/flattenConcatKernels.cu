@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "flattenConcatKernels.h"
+#include <algorithm>
+#include <cuda_fp16.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+constexpr int kThreads = 256;
+constexpr int kMaxBlocks = 4096;
+// Inputs gathered by one launch, more inputs take one launch per group
+constexpr int kMaxGatherInputs = 16;
+
+struct GatherParams
+{
+    const void* inputs[kMaxGatherInputs];
+    // Offsets of the inputs in an output row, relative to base; offsets[count] is the width of the group
+    int offsets[kMaxGatherInputs + 1];
+    int count;
+    int base;
+};
+
+template <typename T>
+__global__ void flattenConcatGatherKernel(GatherParams params, int numConcats, int outputConcatAxis, T* output)
+{
+    const int width = params.offsets[params.count];
+    const size_t total = static_cast<size_t>(numConcats) * width;
+    for (size_t idx = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; idx < total;
+         idx += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const int n = idx / width;
+        const int r = idx - static_cast<size_t>(n) * width;
+        int i = 0;
+        while (r >= params.offsets[i + 1])
+        {
+            ++i;
+        }
+        const int rowSize = params.offsets[i + 1] - params.offsets[i];
+        const T* input = static_cast<const T*>(params.inputs[i]);
+        output[static_cast<size_t>(n) * outputConcatAxis + params.base + r]
+            = input[static_cast<size_t>(n) * rowSize + r - params.offsets[i]];
+    }
+}
+
+template <typename T>
+cudaError_t gather(cudaStream_t stream, int numInputs, const void* const* inputs, const int* inputConcatAxis,
+    int outputConcatAxis, int numConcats, T* output)
+{
+    int base = 0;
+    for (int first = 0; first < numInputs; first += kMaxGatherInputs)
+    {
+        GatherParams params;
+        params.count = std::min(kMaxGatherInputs, numInputs - first);
+        params.base = base;
+        params.offsets[0] = 0;
+        for (int i = 0; i < params.count; ++i)
+        {
+            params.inputs[i] = inputs[first + i];
+            params.offsets[i + 1] = params.offsets[i] + inputConcatAxis[first + i];
+        }
+        const size_t total = static_cast<size_t>(numConcats) * params.offsets[params.count];
+        if (total > 0)
+        {
+            const int blocks = static_cast<int>(std::min<size_t>((total + kThreads - 1) / kThreads, kMaxBlocks));
+            flattenConcatGatherKernel<T><<<blocks, kThreads, 0, stream>>>(params, numConcats, outputConcatAxis, output);
+        }
+        base += params.offsets[params.count];
+    }
+    return cudaGetLastError();
+}
+
+} // namespace
+
+cudaError_t flattenConcatGather(cudaStream_t stream, DataType type, int numInputs, const void* const* inputs,
+    const int* inputConcatAxis, int outputConcatAxis, int numConcats, void* output)
+{
+    if (type == DataType::kHALF)
+    {
+        return gather(stream, numInputs, inputs, inputConcatAxis, outputConcatAxis, numConcats,
+            static_cast<__half*>(output));
+    }
+    return gather(stream, numInputs, inputs, inputConcatAxis, outputConcatAxis, numConcats,
+        static_cast<float*>(output));
+}
+
+} // namespace plugin
+} // namespace nvinfer1
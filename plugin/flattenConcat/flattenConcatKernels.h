@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_FLATTENCONCAT_KERNELS_H
+#define TRT_FLATTENCONCAT_KERNELS_H
+
+#include "NvInfer.h"
+#include <cuda_runtime.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Copies row n of every input, of inputConcatAxis[i] elements, to its offset in row n of the output, for the
+// numConcats rows. The pointers and offsets travel as kernel parameters, so nothing is allocated or copied beforehand.
+cudaError_t flattenConcatGather(cudaStream_t stream, DataType type, int numInputs, const void* const* inputs,
+    const int* inputConcatAxis, int outputConcatAxis, int numConcats, void* output);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_FLATTENCONCAT_KERNELS_H
@@ -20,11 +20,15 @@
 
 #include "NvInfer.h"
 #include "geluPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "bertCommon.h"
 #include "common.h"
 #include "serialize.hpp"
 
 using namespace nvinfer1;
+using nvinfer1::plugin::pluginMalloc;
 
 namespace bert
 {
@@ -130,6 +134,50 @@ void computeGeluBias(
     CHECK(cudaPeekAtLastError());
 }
 
+template <typename T, int TPB, bool hasBias>
+__global__ void geluInt8Kernel(const float inScale, const float outRScale, const int n, const int ld,
+    const int8_t* input, const T* bias, int8_t* output)
+{
+
+    const int idx = blockIdx.x * TPB + threadIdx.x;
+
+    if (idx < n)
+    {
+        float in = dequantize(input[idx], inScale);
+        if (hasBias)
+        {
+            in += float(bias[idx % ld]);
+        }
+        const float cdf = A + A * tanh(in * (C * in * in + B));
+        output[idx] = quantize(in * cdf, outRScale);
+    }
+}
+
+//!
+//! INT8 input and output with their per-tensor scales. The optional bias has the plugin type, the math is FP32.
+//!
+template <typename T>
+int computeGeluInt8(cudaStream_t stream, const int n, const int ld, const float inScale, const float outScale,
+    const int8_t* input, const T* bias, int8_t* output)
+{
+    constexpr int blockSize = 256;
+    const int gridSize = (n + blockSize - 1) / blockSize;
+    const float outRScale = 1.f / outScale;
+    if (bias)
+    {
+        geluInt8Kernel<T, blockSize, true>
+            <<<gridSize, blockSize, 0, stream>>>(inScale, outRScale, n, ld, input, bias, output);
+    }
+    else
+    {
+        geluInt8Kernel<T, blockSize, false>
+            <<<gridSize, blockSize, 0, stream>>>(inScale, outRScale, n, ld, input, bias, output);
+    }
+
+    CHECK(cudaPeekAtLastError());
+    return 0;
+}
+
 /////////////////////////////////
 
 namespace
@@ -181,7 +229,7 @@ GeluPluginDynamic::GeluPluginDynamic(const std::string name, const void* data, s
             gLogError << "Gelu+bias: deserialization inconsistent. HasBias but mLd is 0" << std::endl;
         }
         const size_t wordSize = samplesCommon::getElementSize(mType);
-        mBiasDev = deserToDev<char>(d, mLd * wordSize);
+        mStaged.stage<char>(d, mLd * wordSize);
     }
     gLogVerbose << "Finished deserializing GELU plugin" << std::endl;
     mBias.values = nullptr;
@@ -192,7 +240,11 @@ nvinfer1::IPluginV2DynamicExt* GeluPluginDynamic::clone() const
 {
     if (mHasBias)
     {
-        return new GeluPluginDynamic(mLayerName, mType, mBias);
+        auto ret = new GeluPluginDynamic(mLayerName, mType, mBias);
+        // Clones share the device bias instead of uploading their own copy in initialize()
+        ret->mBiasDev = mBiasDev;
+        ret->mStaged = mStaged;
+        return ret;
     }
     return new GeluPluginDynamic(mLayerName, mType);
 }
@@ -210,7 +262,8 @@ bool GeluPluginDynamic::supportsFormatCombination(
     const PluginTensorDesc& input = inOut[0];
     if (pos == 0)
     {
-        return (input.type == mType) && (input.format == TensorFormat::kLINEAR);
+        // INT8 I/O is quantized with the tensor scales, the bias keeps the plugin type
+        return (input.type == mType || input.type == DataType::kINT8) && (input.format == TensorFormat::kLINEAR);
     }
     if (pos == 1)
     {
@@ -223,7 +276,7 @@ bool GeluPluginDynamic::supportsFormatCombination(
 void GeluPluginDynamic::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
     const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs)
 {
-    assert(mType == in[0].desc.type);
+    assert(mType == in[0].desc.type || in[0].desc.type == DataType::kINT8);
 }
 
 size_t GeluPluginDynamic::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
@@ -235,19 +288,41 @@ int GeluPluginDynamic::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
     const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
     cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    mStaged.wait();
     const int inputVolume = volume(inputDesc[0].dims);
 
     int status = -1;
 
     // Our plugin outputs only one tensor
     // Launch CUDA kernel wrapper and save its return value
-    if (mType == DataType::kFLOAT)
+    if (inputDesc[0].type == DataType::kINT8)
+    {
+        const int8_t* input = static_cast<const int8_t*>(inputs[0]);
+        int8_t* output = static_cast<int8_t*>(outputs[0]);
+        const float inScale = inputDesc[0].scale;
+        const float outScale = outputDesc[0].scale;
+        const int ld = mHasBias ? mLd : 1;
+        if (mType == DataType::kHALF)
+        {
+            const half* bias = reinterpret_cast<half*>(mBiasDev.get());
+            status = computeGeluInt8(stream, inputVolume, ld, inScale, outScale, input, bias, output);
+        }
+        else
+        {
+            const float* bias = reinterpret_cast<float*>(mBiasDev.get());
+            status = computeGeluInt8(stream, inputVolume, ld, inScale, outScale, input, bias, output);
+        }
+    }
+    else if (mType == DataType::kFLOAT)
     {
         const float* input = static_cast<const float*>(inputs[0]);
         float* output = static_cast<float*>(outputs[0]);
         if (mHasBias)
         {
-            const float* bias = reinterpret_cast<float*>(mBiasDev);
+            const float* bias = reinterpret_cast<float*>(mBiasDev.get());
             const int cols = inputVolume / mLd;
             const int rows = mLd;
             computeGeluBias(output, input, bias, rows, cols, stream);
@@ -265,7 +340,7 @@ int GeluPluginDynamic::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
 
         if (mHasBias)
         {
-            const half* bias = reinterpret_cast<half*>(mBiasDev);
+            const half* bias = reinterpret_cast<half*>(mBiasDev.get());
             const int cols = inputVolume / mLd;
             const int rows = mLd;
             computeGeluBias(output, input, bias, rows, cols, stream);
@@ -288,7 +363,7 @@ nvinfer1::DataType GeluPluginDynamic::getOutputDataType(
     int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
     assert(index == 0);
-    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF);
+    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF || inputTypes[0] == DataType::kINT8);
     return inputTypes[0];
 }
 
@@ -312,20 +387,27 @@ int GeluPluginDynamic::getNbOutputs() const
 int GeluPluginDynamic::initialize()
 {
     gLogVerbose << "GELU init start" << std::endl;
-    if (mHasBias && mBias.values)
+    // The bias staged at deserialization is uploaded together with the weights of the other plugins
+    if (!mStaged.empty() && !mBiasDev)
+    {
+        mStaged.resolve(0, mBiasDev);
+    }
+    if (mHasBias && mBias.values && !mBiasDev)
     {
         // target size
         const size_t wordSize = samplesCommon::getElementSize(mType);
         const size_t nbBytes = mBias.count * wordSize;
-        CHECK(cudaMalloc(&mBiasDev, nbBytes));
+        char* bias{nullptr};
+        CHECK(pluginMalloc(&bias, nbBytes));
+        make_cuda_shared(mBiasDev, bias);
 
         if (mType == DataType::kFLOAT)
         {
-            convertAndCopyToDevice(mBias, reinterpret_cast<float*>(mBiasDev));
+            convertAndCopyToDevice(mBias, reinterpret_cast<float*>(bias));
         }
         else
         {
-            convertAndCopyToDevice(mBias, reinterpret_cast<half*>(mBiasDev));
+            convertAndCopyToDevice(mBias, reinterpret_cast<half*>(bias));
         }
     }
     gLogVerbose << "GELU init done" << std::endl;
@@ -334,10 +416,7 @@ int GeluPluginDynamic::initialize()
 
 void GeluPluginDynamic::terminate()
 {
-    if (mHasBias)
-    {
-        CHECK(cudaFree(mBiasDev));
-    }
+    // The device bias is shared with the clones and released with the last plugin holding it
 }
 
 size_t GeluPluginDynamic::getSerializationSize() const
@@ -361,7 +440,7 @@ void GeluPluginDynamic::serialize(void* buffer) const
         {
             gLogError << "Gelu+bias: bias size inconsistent" << std::endl;
         }
-        serFromDev(d, mBiasDev, mLd * wordSize);
+        serFromDev(d, mBiasDev.get(), mLd * wordSize);
     }
 }
 
@@ -18,12 +18,21 @@
 #define TRT_GELU_PLUGIN_H
 
 #include "NvInferPlugin.h"
+#include "bertCommon.h"
 #include <string>
 #include <vector>
 
 namespace bert
 {
 
+//!
+//! output = Gelu(input + bias) over cols rows of ld elements, the output may be the input
+//!
+void computeGeluBias(
+    float* output, const float* input, const float* bias, const int ld, const int cols, cudaStream_t stream);
+void computeGeluBias(
+    half* output, const half* input, const half* bias, const int ld, const int cols, cudaStream_t stream);
+
 // One of the preferred ways of making TensorRT to be able to see
 // our custom layer requires extending IPluginV2 and IPluginCreator classes.
 // For requirements for overriden functions, check TensorRT API docs.
@@ -75,7 +84,8 @@ private:
     nvinfer1::DataType mType;
     bool mHasBias;
     nvinfer1::Weights mBias;
-    char* mBiasDev;
+    bert::cuda_shared_ptr<char> mBiasDev;
+    bert::StagedWeights mStaged; // Bias of a deserialized plugin
     size_t mLd;
 
 protected:
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "gridAnchorPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <cstring>
 #include <cublas_v2.h>
 #include <cudnn.h>
@@ -22,6 +25,8 @@
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::GridAnchorDynamic;
+using nvinfer1::plugin::GridAnchorDynamicPluginCreator;
 using nvinfer1::plugin::GridAnchorGenerator;
 using nvinfer1::plugin::GridAnchorPluginCreator;
 
@@ -29,9 +34,211 @@ namespace
 {
 const char* GRID_ANCHOR_PLUGIN_VERSION{"1"};
 const char* GRID_ANCHOR_PLUGIN_NAME{"GridAnchor_TRT"};
+const char* GRID_ANCHOR_DYNAMIC_PLUGIN_NAME{"GridAnchorDynamic_TRT"};
+
+// Compute the widths and heights of the anchors of layer id and return their number
+int anchorSizes(const GridAnchorParameters& param, int id, int numLayers, std::vector<float>& widths,
+    std::vector<float>& heights)
+{
+    std::vector<float> tmpScales(numLayers + 1);
+
+    // Calculate the scales of SSD model for each layer
+    for (int i = 0; i < numLayers; i++)
+    {
+        tmpScales[i] = (param.minSize + (param.maxSize - param.minSize) * id / (numLayers - 1));
+    }
+    // Add another 1.0f to tmpScales to prevent going out side of the vector in calculating the scale_next.
+    tmpScales.push_back(1.0f); // has 7 entries
+    // scale0 are for the first layer specifically
+    std::vector<float> scale0 = {0.1f, tmpScales[0], tmpScales[0]};
+
+    std::vector<float> aspect_ratios;
+    std::vector<float> scales;
+    int numPriors;
+
+    // The first layer is different
+    if (id == 0)
+    {
+        for (int i = 0; i < param.numAspectRatios; i++)
+        {
+            aspect_ratios.push_back(param.aspectRatios[i]);
+            scales.push_back(scale0[i]);
+        }
+        numPriors = param.numAspectRatios;
+    }
+
+    else
+    {
+        for (int i = 0; i < param.numAspectRatios; i++)
+        {
+            aspect_ratios.push_back(param.aspectRatios[i]);
+        }
+        // Additional aspect ratio of 1.0 as described in the paper
+        aspect_ratios.push_back(1.0);
+
+        // scales
+        for (int i = 0; i < param.numAspectRatios; i++)
+        {
+            scales.push_back(tmpScales[id]);
+        }
+        auto scale_next = (id == numLayers - 1)
+            ? 1.0
+            : (param.minSize + (param.maxSize - param.minSize) * (id + 1) / (numLayers - 1));
+        scales.push_back(sqrt(tmpScales[id] * scale_next));
+
+        numPriors = param.numAspectRatios + 1;
+    }
+
+    widths.clear();
+    heights.clear();
+    // Calculate the width and height of the prior boxes
+    for (int i = 0; i < numPriors; i++)
+    {
+        float sqrt_AR = sqrt(aspect_ratios[i]);
+        widths.push_back(scales[i] * sqrt_AR);
+        heights.push_back(scales[i] / sqrt_AR);
+    }
+    return numPriors;
+}
+
+float* copyToDevice(const std::vector<float>& values)
+{
+    float* deviceData = nullptr;
+    CUASSERT(cudaMalloc(&deviceData, values.size() * sizeof(float)));
+    CUASSERT(cudaMemcpy(deviceData, values.data(), values.size() * sizeof(float), cudaMemcpyHostToDevice));
+    return deviceData;
+}
+
+void writeVector(char*& d, const std::vector<float>& values)
+{
+    write(d, static_cast<int>(values.size()));
+    std::memcpy(d, values.data(), values.size() * sizeof(float));
+    d += values.size() * sizeof(float);
+}
+
+std::vector<float> readVector(const char*& d)
+{
+    int count = read<int>(d);
+    std::vector<float> values(count);
+    std::memcpy(values.data(), d, count * sizeof(float));
+    d += count * sizeof(float);
+    return values;
+}
+
+void addGridAnchorFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("minSize", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("maxSize", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("aspectRatios", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("featureMapShapes", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("variance", nullptr, PluginFieldType::kFLOAT32, 4));
+    attributes.emplace_back(PluginField("numLayers", nullptr, PluginFieldType::kINT32, 1));
+}
+
+// The aspect ratios of the parameters point into aspectRatios and firstLayerAspectRatios. H and W are left to 0 when
+// featureMapShapes is missing and requireShapes is false.
+std::vector<GridAnchorParameters> parseGridAnchorFields(const PluginFieldCollection* fc, bool requireShapes,
+    std::vector<float>& aspectRatios, std::vector<float>& firstLayerAspectRatios)
+{
+    float minScale = 0.2F, maxScale = 0.95F;
+    int numLayers = 6;
+    std::vector<int> fMapShapes;
+    std::vector<float> layerVariances;
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "numLayers"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            numLayers = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "minSize"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            minScale = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "maxSize"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            maxScale = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "variance"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            layerVariances.reserve(size);
+            const auto* lVar = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                layerVariances.push_back(*lVar);
+                lVar++;
+            }
+        }
+        else if (!strcmp(attrName, "aspectRatios"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            aspectRatios.reserve(size);
+            const auto* aR = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                aspectRatios.push_back(*aR);
+                aR++;
+            }
+        }
+        else if (!strcmp(attrName, "featureMapShapes"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            int size = fields[i].length;
+            fMapShapes.reserve(size);
+            const int* fMap = static_cast<const int*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                fMapShapes.push_back(*fMap);
+                fMap++;
+            }
+        }
+    }
+    ASSERT(numLayers > 0);
+    ASSERT((int) fMapShapes.size() == numLayers || (!requireShapes && fMapShapes.empty()));
+    const auto shape = [&fMapShapes](int i) { return fMapShapes.empty() ? 0 : fMapShapes[i]; };
+
+    // Reducing the number of boxes predicted by the first layer.
+    // This is in accordance with the standard implementation.
+    int numFirstLayerARs = 3;
+    // First layer only has the first 3 aspect ratios from aspectRatios
+    firstLayerAspectRatios.reserve(numFirstLayerARs);
+    for (int i = 0; i < numFirstLayerARs; ++i)
+    {
+        firstLayerAspectRatios.push_back(aspectRatios[i]);
+    }
+    // A comprehensive list of box parameters that are required by anchor generator
+    std::vector<GridAnchorParameters> boxParams(numLayers);
+
+    // One set of box parameters for one layer
+    for (int i = 0; i < numLayers; i++)
+    {
+        // Only the first layer is different
+        if (i == 0)
+        {
+            boxParams[i] = {minScale, maxScale, firstLayerAspectRatios.data(), (int) firstLayerAspectRatios.size(),
+                shape(i), shape(i), {layerVariances[0], layerVariances[1], layerVariances[2], layerVariances[3]}};
+        }
+        else
+        {
+            boxParams[i] = {minScale, maxScale, aspectRatios.data(), (int) aspectRatios.size(), shape(i),
+                shape(i), {layerVariances[0], layerVariances[1], layerVariances[2], layerVariances[3]}};
+        }
+    }
+
+    return boxParams;
+}
 } // namespace
 PluginFieldCollection GridAnchorPluginCreator::mFC{};
 std::vector<PluginField> GridAnchorPluginCreator::mPluginAttributes;
+PluginFieldCollection GridAnchorDynamicPluginCreator::mFC{};
+std::vector<PluginField> GridAnchorDynamicPluginCreator::mPluginAttributes;
 
 GridAnchorGenerator::GridAnchorGenerator(const GridAnchorParameters* paramIn, int mNumLayers)
     : mNumLayers(mNumLayers)
@@ -58,63 +265,9 @@ GridAnchorGenerator::GridAnchorGenerator(const GridAnchorParameters* paramIn, in
             mParam[id].variance[i] = paramIn[id].variance[i];
         }
 
-        std::vector<float> tmpScales(mNumLayers + 1);
-
-        // Calculate the scales of SSD model for each layer
-        for (int i = 0; i < mNumLayers; i++)
-        {
-            tmpScales[i] = (mParam[id].minSize + (mParam[id].maxSize - mParam[id].minSize) * id / (mNumLayers - 1));
-        }
-        // Add another 1.0f to tmpScales to prevent going out side of the vector in calculating the scale_next.
-        tmpScales.push_back(1.0f); // has 7 entries
-        // scale0 are for the first layer specifically
-        std::vector<float> scale0 = {0.1f, tmpScales[0], tmpScales[0]};
-
-        std::vector<float> aspect_ratios;
-        std::vector<float> scales;
-
-        // The first layer is different
-        if (id == 0)
-        {
-            for (int i = 0; i < mParam[id].numAspectRatios; i++)
-            {
-                aspect_ratios.push_back(mParam[id].aspectRatios[i]);
-                scales.push_back(scale0[i]);
-            }
-            mNumPriors[id] = mParam[id].numAspectRatios;
-        }
-
-        else
-        {
-            for (int i = 0; i < mParam[id].numAspectRatios; i++)
-            {
-                aspect_ratios.push_back(mParam[id].aspectRatios[i]);
-            }
-            // Additional aspect ratio of 1.0 as described in the paper
-            aspect_ratios.push_back(1.0);
-
-            // scales
-            for (int i = 0; i < mParam[id].numAspectRatios; i++)
-            {
-                scales.push_back(tmpScales[id]);
-            }
-            auto scale_next = (id == mNumLayers - 1)
-                ? 1.0
-                : (mParam[id].minSize + (mParam[id].maxSize - mParam[id].minSize) * (id + 1) / (mNumLayers - 1));
-            scales.push_back(sqrt(tmpScales[id] * scale_next));
-
-            mNumPriors[id] = mParam[id].numAspectRatios + 1;
-        }
-
         std::vector<float> tmpWidths;
         std::vector<float> tmpHeights;
-        // Calculate the width and height of the prior boxes
-        for (int i = 0; i < mNumPriors[id]; i++)
-        {
-            float sqrt_AR = sqrt(aspect_ratios[i]);
-            tmpWidths.push_back(scales[i] * sqrt_AR);
-            tmpHeights.push_back(scales[i] / sqrt_AR);
-        }
+        mNumPriors[id] = anchorSizes(mParam[id], id, mNumLayers, tmpWidths, tmpHeights);
 
         mDeviceWidths[id] = copyToDevice(&tmpWidths[0], tmpWidths.size());
         mDeviceHeights[id] = copyToDevice(&tmpHeights[0], tmpHeights.size());
@@ -183,10 +336,28 @@ Dims GridAnchorGenerator::getOutputDimensions(int index, const Dims* inputs, int
 
 int GridAnchorGenerator::initialize()
 {
+    // Generate prior boxes for each layer
+    mAnchors.resize(mNumLayers, nullptr);
+    for (int id = 0; id < mNumLayers; id++)
+    {
+        const size_t size = 2 * mParam[id].H * mParam[id].W * mNumPriors[id] * 4 * sizeof(float);
+        CUASSERT(cudaMalloc(&mAnchors[id], size));
+        pluginStatus_t status = anchorGridInference(
+            0, mParam[id], mNumPriors[id], mDeviceWidths[id].values, mDeviceHeights[id].values, mAnchors[id]);
+        ASSERT(status == STATUS_SUCCESS);
+    }
+    CUASSERT(cudaStreamSynchronize(0));
     return STATUS_SUCCESS;
 }
 
-void GridAnchorGenerator::terminate() {}
+void GridAnchorGenerator::terminate()
+{
+    for (void* anchors : mAnchors)
+    {
+        CUASSERT(cudaFree(anchors));
+    }
+    mAnchors.clear();
+}
 
 size_t GridAnchorGenerator::getWorkspaceSize(int maxBatchSize) const
 {
@@ -196,13 +367,13 @@ size_t GridAnchorGenerator::getWorkspaceSize(int maxBatchSize) const
 int GridAnchorGenerator::enqueue(
     int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
-    // Generate prior boxes for each layer
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     for (int id = 0; id < mNumLayers; id++)
     {
-        void* outputData = outputs[id];
-        pluginStatus_t status = anchorGridInference(
-            stream, mParam[id], mNumPriors[id], mDeviceWidths[id].values, mDeviceHeights[id].values, outputData);
-        ASSERT(status == STATUS_SUCCESS);
+        const size_t size = 2 * mParam[id].H * mParam[id].W * mNumPriors[id] * 4 * sizeof(float);
+        CSC(cudaMemcpyAsync(outputs[id], mAnchors[id], size, cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
     }
     return STATUS_SUCCESS;
 }
@@ -348,12 +519,7 @@ IPluginV2Ext* GridAnchorGenerator::clone() const
 
 GridAnchorPluginCreator::GridAnchorPluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("minSize", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("maxSize", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("aspectRatios", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("featureMapShapes", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("variance", nullptr, PluginFieldType::kFLOAT32, 4));
-    mPluginAttributes.emplace_back(PluginField("numLayers", nullptr, PluginFieldType::kINT32, 1));
+    addGridAnchorFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -376,111 +542,306 @@ const PluginFieldCollection* GridAnchorPluginCreator::getFieldNames()
 
 IPluginV2Ext* GridAnchorPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    float minScale = 0.2F, maxScale = 0.95F;
-    int numLayers = 6;
     std::vector<float> aspectRatios;
-    std::vector<int> fMapShapes;
-    std::vector<float> layerVariances;
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
+    std::vector<float> firstLayerAspectRatios;
+    std::vector<GridAnchorParameters> boxParams = parseGridAnchorFields(fc, true, aspectRatios, firstLayerAspectRatios);
+    const int numLayers = boxParams.size();
+
+    GridAnchorGenerator* obj = new GridAnchorGenerator(boxParams.data(), numLayers);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
+
+IPluginV2Ext* GridAnchorPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call GridAnchor::destroy()
+    GridAnchorGenerator* obj = new GridAnchorGenerator(serialData, serialLength);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
+
+GridAnchorDynamic::GridAnchorDynamic(const GridAnchorParameters* param, int numLayers)
+    : mNumLayers(numLayers)
+    , mParam(param, param + numLayers)
+    , mNumPriors(numLayers)
+    , mWidths(numLayers)
+    , mHeights(numLayers)
+    , mDeviceWidths(numLayers, nullptr)
+    , mDeviceHeights(numLayers, nullptr)
+    , mAnchors(numLayers, nullptr)
+    , mAnchorsCapacity(numLayers, 0)
+    , mAnchorsShape(2 * numLayers, 0)
+{
+    for (int id = 0; id < mNumLayers; id++)
     {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "numLayers"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            numLayers = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "minSize"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            minScale = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "maxSize"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            maxScale = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "variance"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            layerVariances.reserve(size);
-            const auto* lVar = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                layerVariances.push_back(*lVar);
-                lVar++;
-            }
-        }
-        else if (!strcmp(attrName, "aspectRatios"))
+        ASSERT(param[id].numAspectRatios >= 0 && param[id].aspectRatios != nullptr);
+        mNumPriors[id] = anchorSizes(param[id], id, mNumLayers, mWidths[id], mHeights[id]);
+        mParam[id].aspectRatios = nullptr;
+    }
+}
+
+GridAnchorDynamic::GridAnchorDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mNumLayers = read<int>(d);
+    mParam.resize(mNumLayers);
+    mNumPriors.resize(mNumLayers);
+    mWidths.resize(mNumLayers);
+    mHeights.resize(mNumLayers);
+    for (int id = 0; id < mNumLayers; id++)
+    {
+        mParam[id] = read<GridAnchorParameters>(d);
+        mParam[id].aspectRatios = nullptr;
+        mNumPriors[id] = read<int>(d);
+        mWidths[id] = readVector(d);
+        mHeights[id] = readVector(d);
+    }
+    mDeviceWidths.assign(mNumLayers, nullptr);
+    mDeviceHeights.assign(mNumLayers, nullptr);
+    mAnchors.assign(mNumLayers, nullptr);
+    mAnchorsCapacity.assign(mNumLayers, 0);
+    mAnchorsShape.assign(2 * mNumLayers, 0);
+    ASSERT(d == a + length);
+}
+
+int GridAnchorDynamic::getNbOutputs() const
+{
+    return mNumLayers;
+}
+
+DimsExprs GridAnchorDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == mNumLayers);
+    ASSERT(outputIndex >= 0 && outputIndex < mNumLayers);
+    ASSERT(inputs[outputIndex].nbDims == 4);
+    // The first channel is for anchor coordinates, the second one for the variances
+    const DimsExprs& input = inputs[outputIndex];
+    DimsExprs output;
+    output.nbDims = 4;
+    output.d[0] = exprBuilder.constant(1);
+    output.d[1] = exprBuilder.constant(2);
+    const IDimensionExpr* area = exprBuilder.operation(DimensionOperation::kPROD, *input.d[2], *input.d[3]);
+    output.d[2]
+        = exprBuilder.operation(DimensionOperation::kPROD, *area, *exprBuilder.constant(mNumPriors[outputIndex] * 4));
+    output.d[3] = exprBuilder.constant(1);
+    return output;
+}
+
+int GridAnchorDynamic::initialize()
+{
+    for (int id = 0; id < mNumLayers; id++)
+    {
+        mDeviceWidths[id] = copyToDevice(mWidths[id]);
+        mDeviceHeights[id] = copyToDevice(mHeights[id]);
+    }
+    return STATUS_SUCCESS;
+}
+
+void GridAnchorDynamic::terminate()
+{
+    for (int id = 0; id < mNumLayers; id++)
+    {
+        CUASSERT(cudaFree(mDeviceWidths[id]));
+        CUASSERT(cudaFree(mDeviceHeights[id]));
+        CUASSERT(cudaFree(mAnchors[id]));
+    }
+    mDeviceWidths.assign(mNumLayers, nullptr);
+    mDeviceHeights.assign(mNumLayers, nullptr);
+    mAnchors.assign(mNumLayers, nullptr);
+    mAnchorsCapacity.assign(mNumLayers, 0);
+    mAnchorsShape.assign(2 * mNumLayers, 0);
+}
+
+size_t GridAnchorDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return 0;
+}
+
+int GridAnchorDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    for (int id = 0; id < mNumLayers; id++)
+    {
+        const int H = inputDesc[id].dims.d[2];
+        const int W = inputDesc[id].dims.d[3];
+        const size_t size = 2 * H * W * mNumPriors[id] * 4 * sizeof(float);
+        if (mAnchors[id] != nullptr && mAnchorsShape[2 * id] == H && mAnchorsShape[2 * id + 1] == W)
         {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            aspectRatios.reserve(size);
-            const auto* aR = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                aspectRatios.push_back(*aR);
-                aR++;
-            }
+            CSC(cudaMemcpyAsync(outputs[id], mAnchors[id], size, cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
+            continue;
         }
-        else if (!strcmp(attrName, "featureMapShapes"))
+
+        GridAnchorParameters param = mParam[id];
+        param.H = H;
+        param.W = W;
+        pluginStatus_t status = anchorGridInference(
+            stream, param, mNumPriors[id], mDeviceWidths[id], mDeviceHeights[id], outputs[id]);
+        ASSERT(status == STATUS_SUCCESS);
+
+        // Keep a copy for the following calls with the same shape when the cache is large enough
+        if (size <= mAnchorsCapacity[id])
         {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            int size = fields[i].length;
-            fMapShapes.reserve(size);
-            const int* fMap = static_cast<const int*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                fMapShapes.push_back(*fMap);
-                fMap++;
-            }
+            CSC(cudaMemcpyAsync(mAnchors[id], outputs[id], size, cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
+            mAnchorsShape[2 * id] = H;
+            mAnchorsShape[2 * id + 1] = W;
         }
     }
-    // Reducing the number of boxes predicted by the first layer.
-    // This is in accordance with the standard implementation.
-    std::vector<float> firstLayerAspectRatios;
+    return 0;
+}
 
-    ASSERT(numLayers > 0);
-    ASSERT((int) fMapShapes.size() == numLayers);
+size_t GridAnchorDynamic::getSerializationSize() const
+{
+    // mNumLayers, then for each layer GridAnchorParameters, numPriors and the count and values of widths and heights
+    size_t sum = sizeof(int);
+    for (int id = 0; id < mNumLayers; id++)
+    {
+        sum += sizeof(GridAnchorParameters) + sizeof(int) * 3;
+        sum += sizeof(float) * (mWidths[id].size() + mHeights[id].size());
+    }
+    return sum;
+}
 
-    int numFirstLayerARs = 3;
-    // First layer only has the first 3 aspect ratios from aspectRatios
-    firstLayerAspectRatios.reserve(numFirstLayerARs);
-    for (int i = 0; i < numFirstLayerARs; ++i)
+void GridAnchorDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mNumLayers);
+    for (int id = 0; id < mNumLayers; id++)
     {
-        firstLayerAspectRatios.push_back(aspectRatios[i]);
+        write(d, mParam[id]);
+        write(d, mNumPriors[id]);
+        writeVector(d, mWidths[id]);
+        writeVector(d, mHeights[id]);
     }
-    // A comprehensive list of box parameters that are required by anchor generator
-    std::vector<GridAnchorParameters> boxParams(numLayers);
+    ASSERT(d == a + getSerializationSize());
+}
 
-    // One set of box parameters for one layer
-    for (int i = 0; i < numLayers; i++)
+void GridAnchorDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == mNumLayers);
+    ASSERT(nbOutputs == mNumLayers);
+    for (int id = 0; id < mNumLayers; id++)
     {
-        // Only the first layer is different
-        if (i == 0)
-        {
-            boxParams[i] = {minScale, maxScale, firstLayerAspectRatios.data(), (int) firstLayerAspectRatios.size(),
-                fMapShapes[i], fMapShapes[i],
-                {layerVariances[0], layerVariances[1], layerVariances[2], layerVariances[3]}};
-        }
-        else
+        ASSERT(in[id].desc.dims.nbDims == 4);
+        ASSERT(out[id].desc.dims.nbDims == 4);
+
+        // Size the anchor cache for the largest feature map of the profile, so enqueue() never allocates
+        if (in[id].max.d[2] > 0 && in[id].max.d[3] > 0)
         {
-            boxParams[i] = {minScale, maxScale, aspectRatios.data(), (int) aspectRatios.size(), fMapShapes[i],
-                fMapShapes[i], {layerVariances[0], layerVariances[1], layerVariances[2], layerVariances[3]}};
+            const size_t capacity = 2 * in[id].max.d[2] * in[id].max.d[3] * mNumPriors[id] * 4 * sizeof(float);
+            if (capacity > mAnchorsCapacity[id])
+            {
+                CUASSERT(cudaFree(mAnchors[id]));
+                CUASSERT(cudaMalloc(&mAnchors[id], capacity));
+                mAnchorsCapacity[id] = capacity;
+            }
         }
     }
+    mAnchorsShape.assign(2 * mNumLayers, 0);
+}
 
-    GridAnchorGenerator* obj = new GridAnchorGenerator(boxParams.data(), numLayers);
+bool GridAnchorDynamic::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == mNumLayers && nbOutputs == mNumLayers && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    // Only the shapes of the inputs are used, so their type does not matter as long as it is a float type
+    if (pos < nbInputs)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    return inOut[pos].type == DataType::kFLOAT;
+}
+
+const char* GridAnchorDynamic::getPluginType() const
+{
+    return GRID_ANCHOR_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* GridAnchorDynamic::getPluginVersion() const
+{
+    return GRID_ANCHOR_PLUGIN_VERSION;
+}
+
+void GridAnchorDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* GridAnchorDynamic::clone() const
+{
+    auto* plugin = new GridAnchorDynamic(*this);
+    plugin->mDeviceWidths.assign(mNumLayers, nullptr);
+    plugin->mDeviceHeights.assign(mNumLayers, nullptr);
+    plugin->mAnchors.assign(mNumLayers, nullptr);
+    plugin->mAnchorsCapacity.assign(mNumLayers, 0);
+    plugin->mAnchorsShape.assign(2 * mNumLayers, 0);
+    return plugin;
+}
+
+void GridAnchorDynamic::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* GridAnchorDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType GridAnchorDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index < mNumLayers);
+    return DataType::kFLOAT;
+}
+
+GridAnchorDynamicPluginCreator::GridAnchorDynamicPluginCreator()
+{
+    addGridAnchorFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* GridAnchorDynamicPluginCreator::getPluginName() const
+{
+    return GRID_ANCHOR_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* GridAnchorDynamicPluginCreator::getPluginVersion() const
+{
+    return GRID_ANCHOR_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* GridAnchorDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* GridAnchorDynamicPluginCreator::createPlugin(const char* /*name*/, const PluginFieldCollection* fc)
+{
+    // The plugin copies what it needs from the aspect ratios, so they only have to outlive the constructor
+    std::vector<float> aspectRatios;
+    std::vector<float> firstLayerAspectRatios;
+    std::vector<GridAnchorParameters> boxParams
+        = parseGridAnchorFields(fc, false, aspectRatios, firstLayerAspectRatios);
+    auto* obj = new GridAnchorDynamic(boxParams.data(), static_cast<int>(boxParams.size()));
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
 
-IPluginV2Ext* GridAnchorPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
+IPluginV2DynamicExt* GridAnchorDynamicPluginCreator::deserializePlugin(
+    const char* /*name*/, const void* serialData, size_t serialLength)
 {
-    // This object will be deleted when the network is destroyed, which will
-    // call GridAnchor::destroy()
-    GridAnchorGenerator* obj = new GridAnchorGenerator(serialData, serialLength);
+    auto* obj = new GridAnchorDynamic(serialData, serialLength);
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
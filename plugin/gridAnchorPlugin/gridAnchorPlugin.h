@@ -92,9 +92,75 @@ private:
     std::vector<GridAnchorParameters> mParam;
     int* mNumPriors;
     Weights *mDeviceWidths, *mDeviceHeights;
+    // The anchors only depend on the parameters, they are generated once by initialize() and copied by enqueue()
+    std::vector<void*> mAnchors;
     const char* mPluginNamespace;
 };
 
+// Explicit batch version of GridAnchor. The inputs are the [N, C, H, W] feature maps of the layers, output i is
+// [1, 2, H_i * W_i * numPriors_i * 4, 1] and is recomputed for the shapes seen at enqueue time.
+class GridAnchorDynamic : public IPluginV2DynamicExt
+{
+public:
+    GridAnchorDynamic(const GridAnchorParameters* param, int numLayers);
+
+    GridAnchorDynamic(const void* data, size_t length);
+
+    ~GridAnchorDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    int mNumLayers{};
+    // The aspect ratios of mParam are not used, the anchor sizes live in the host vectors below. H and W are taken
+    // from the inputs at enqueue time.
+    std::vector<GridAnchorParameters> mParam;
+    std::vector<int> mNumPriors;
+    std::vector<std::vector<float>> mWidths, mHeights;
+    std::vector<float*> mDeviceWidths, mDeviceHeights;
+    // Anchors of the last H and W seen by enqueue() for each layer, regenerated only when the shape changes
+    std::vector<float*> mAnchors;
+    std::vector<size_t> mAnchorsCapacity;
+    std::vector<int> mAnchorsShape;
+    std::string mNamespace;
+};
+
 class GridAnchorPluginCreator : public BaseCreator
 {
 public:
@@ -112,6 +178,29 @@ public:
 
     IPluginV2Ext* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
 
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as GridAnchor_TRT, featureMapShapes is optional since the sizes come from the inputs
+class GridAnchorDynamicPluginCreator : public BaseCreator
+{
+public:
+    GridAnchorDynamicPluginCreator();
+
+    ~GridAnchorDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
 private:
     static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
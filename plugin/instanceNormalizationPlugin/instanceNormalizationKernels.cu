@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "instanceNormalizationKernels.h"
+#include <cuda_fp16.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+constexpr int kThreads = 256;
+// Elements of an instance reduced by one block in the linear format
+constexpr int kChunkElements = 4096;
+// The HWC8 kernels run 32 channels by 8 pixel rows per block, over the pixels of a chunk
+constexpr int kChannelTile = 32;
+constexpr int kPixelRows = 8;
+constexpr int kChunkPixels = 64;
+
+// Partial mean and sum of squared differences of count elements, merged with the parallel algorithm of Chan et al.
+struct Welford
+{
+    float count;
+    float mean;
+    float m2;
+};
+
+__device__ inline void welfordAdd(Welford& w, float x)
+{
+    w.count += 1;
+    const float delta = x - w.mean;
+    w.mean += delta / w.count;
+    w.m2 += delta * (x - w.mean);
+}
+
+__device__ inline void welfordMerge(Welford& a, const Welford& b)
+{
+    const float count = a.count + b.count;
+    if (count > 0)
+    {
+        const float delta = b.mean - a.mean;
+        a.mean += delta * b.count / count;
+        a.m2 += b.m2 + delta * delta * a.count * b.count / count;
+        a.count = count;
+    }
+}
+
+__device__ inline float toFloat(float x)
+{
+    return x;
+}
+
+__device__ inline float toFloat(__half x)
+{
+    return __half2float(x);
+}
+
+template <typename T>
+__device__ inline T fromFloat(float x);
+
+template <>
+__device__ inline float fromFloat<float>(float x)
+{
+    return x;
+}
+
+template <>
+__device__ inline __half fromFloat<__half>(float x)
+{
+    return __float2half(x);
+}
+
+__host__ __device__ inline int divUp(int a, int b)
+{
+    return (a + b - 1) / b;
+}
+
+inline int linearChunks(int spatial)
+{
+    return divUp(spatial, kChunkElements);
+}
+
+inline int hwcChunks(int spatial)
+{
+    return divUp(spatial, kChunkPixels);
+}
+
+__host__ __device__ inline int hwcChannels(int c)
+{
+    return divUp(c, 8) * 8;
+}
+
+// Grid (n * c, chunks), one partial per chunk of an instance
+template <typename T>
+__global__ void linearStatsKernel(int spatial, int chunks, const T* input, Welford* partials)
+{
+    __shared__ Welford shared[kThreads];
+    const int instance = blockIdx.x;
+    const int begin = blockIdx.y * kChunkElements;
+    const int end = min(begin + kChunkElements, spatial);
+    const T* x = input + static_cast<size_t>(instance) * spatial;
+
+    Welford w{0, 0, 0};
+    for (int i = begin + threadIdx.x; i < end; i += kThreads)
+    {
+        welfordAdd(w, toFloat(x[i]));
+    }
+    shared[threadIdx.x] = w;
+    __syncthreads();
+    for (int stride = kThreads / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+        {
+            welfordMerge(shared[threadIdx.x], shared[threadIdx.x + stride]);
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0)
+    {
+        partials[static_cast<size_t>(instance) * chunks + blockIdx.y] = shared[0];
+    }
+}
+
+// Grid (n * channel tiles, chunks), blocks of kChannelTile x kPixelRows threads, each warp reading consecutive channels
+template <typename T>
+__global__ void hwcStatsKernel(int c, int spatial, int chunks, const T* input, Welford* partials)
+{
+    __shared__ Welford shared[kPixelRows][kChannelTile];
+    const int tiles = divUp(hwcChannels(c), kChannelTile);
+    const int image = blockIdx.x / tiles;
+    const int channel = (blockIdx.x % tiles) * kChannelTile + threadIdx.x;
+    const int begin = blockIdx.y * kChunkPixels;
+    const int end = min(begin + kChunkPixels, spatial);
+    const int stride = hwcChannels(c);
+    const T* x = input + static_cast<size_t>(image) * spatial * stride;
+
+    Welford w{0, 0, 0};
+    if (channel < c)
+    {
+        for (int p = begin + threadIdx.y; p < end; p += kPixelRows)
+        {
+            welfordAdd(w, toFloat(x[static_cast<size_t>(p) * stride + channel]));
+        }
+    }
+    shared[threadIdx.y][threadIdx.x] = w;
+    __syncthreads();
+    if (threadIdx.y == 0 && channel < c)
+    {
+        for (int row = 1; row < kPixelRows; ++row)
+        {
+            welfordMerge(w, shared[row][threadIdx.x]);
+        }
+        partials[(static_cast<size_t>(image) * c + channel) * chunks + blockIdx.y] = w;
+    }
+}
+
+// One thread per instance, folds the statistics, scale and bias into y = x * a + b
+__global__ void finalizeKernel(int instances, int c, int chunks, float epsilon, const float* scale, const float* bias,
+    const Welford* partials, float2* coefficients)
+{
+    const int instance = blockIdx.x * blockDim.x + threadIdx.x;
+    if (instance >= instances)
+    {
+        return;
+    }
+    Welford w{0, 0, 0};
+    for (int chunk = 0; chunk < chunks; ++chunk)
+    {
+        welfordMerge(w, partials[static_cast<size_t>(instance) * chunks + chunk]);
+    }
+    const int channel = instance % c;
+    const float a = scale[channel] * rsqrtf(w.m2 / w.count + epsilon);
+    coefficients[instance] = make_float2(a, bias[channel] - w.mean * a);
+}
+
+template <typename T>
+__global__ void linearApplyKernel(int spatial, const float2* coefficients, const T* input, T* output)
+{
+    const int instance = blockIdx.x;
+    const int begin = blockIdx.y * kChunkElements;
+    const int end = min(begin + kChunkElements, spatial);
+    const size_t offset = static_cast<size_t>(instance) * spatial;
+    const float2 ab = coefficients[instance];
+    for (int i = begin + threadIdx.x; i < end; i += kThreads)
+    {
+        output[offset + i] = fromFloat<T>(toFloat(input[offset + i]) * ab.x + ab.y);
+    }
+}
+
+// The padding channels of the output are zeroed
+template <typename T>
+__global__ void hwcApplyKernel(int c, int spatial, const float2* coefficients, const T* input, T* output)
+{
+    const int tiles = divUp(hwcChannels(c), kChannelTile);
+    const int image = blockIdx.x / tiles;
+    const int channel = (blockIdx.x % tiles) * kChannelTile + threadIdx.x;
+    const int stride = hwcChannels(c);
+    if (channel >= stride)
+    {
+        return;
+    }
+    const int begin = blockIdx.y * kChunkPixels;
+    const int end = min(begin + kChunkPixels, spatial);
+    const size_t offset = static_cast<size_t>(image) * spatial * stride + channel;
+    const float2 ab = channel < c ? coefficients[image * c + channel] : make_float2(0, 0);
+    for (int p = begin + threadIdx.y; p < end; p += kPixelRows)
+    {
+        const size_t i = offset + static_cast<size_t>(p) * stride;
+        output[i] = fromFloat<T>(channel < c ? toFloat(input[i]) * ab.x + ab.y : 0.F);
+    }
+}
+
+template <typename T>
+void launchForward(cudaStream_t stream, TensorFormat format, int n, int c, int spatial, float epsilon,
+    const float* scale, const float* bias, const T* input, T* output, Welford* partials, float2* coefficients)
+{
+    const int instances = n * c;
+    if (format == TensorFormat::kHWC8)
+    {
+        const int chunks = hwcChunks(spatial);
+        const dim3 grid(n * divUp(hwcChannels(c), kChannelTile), chunks);
+        const dim3 block(kChannelTile, kPixelRows);
+        hwcStatsKernel<T><<<grid, block, 0, stream>>>(c, spatial, chunks, input, partials);
+        finalizeKernel<<<divUp(instances, kThreads), kThreads, 0, stream>>>(
+            instances, c, chunks, epsilon, scale, bias, partials, coefficients);
+        hwcApplyKernel<T><<<grid, block, 0, stream>>>(c, spatial, coefficients, input, output);
+    }
+    else
+    {
+        const int chunks = linearChunks(spatial);
+        const dim3 grid(instances, chunks);
+        linearStatsKernel<T><<<grid, kThreads, 0, stream>>>(spatial, chunks, input, partials);
+        finalizeKernel<<<divUp(instances, kThreads), kThreads, 0, stream>>>(
+            instances, c, chunks, epsilon, scale, bias, partials, coefficients);
+        linearApplyKernel<T><<<grid, kThreads, 0, stream>>>(spatial, coefficients, input, output);
+    }
+}
+
+size_t partialsSize(int n, int c, int spatial, TensorFormat format)
+{
+    const int chunks = format == TensorFormat::kHWC8 ? hwcChunks(spatial) : linearChunks(spatial);
+    // Keep the coefficients that follow aligned
+    return (static_cast<size_t>(n) * c * chunks * sizeof(Welford) + 15) / 16 * 16;
+}
+
+} // namespace
+
+size_t instanceNormalizationWorkspaceSize(int n, int c, int spatial, TensorFormat format)
+{
+    return partialsSize(n, c, spatial, format) + static_cast<size_t>(n) * c * sizeof(float2);
+}
+
+cudaError_t instanceNormalizationForward(cudaStream_t stream, DataType type, TensorFormat format, int n, int c,
+    int spatial, float epsilon, const float* scale, const float* bias, const void* input, void* output,
+    void* workspace)
+{
+    auto* partials = static_cast<Welford*>(workspace);
+    auto* coefficients
+        = reinterpret_cast<float2*>(static_cast<char*>(workspace) + partialsSize(n, c, spatial, format));
+    if (type == DataType::kHALF)
+    {
+        launchForward(stream, format, n, c, spatial, epsilon, scale, bias, static_cast<const __half*>(input),
+            static_cast<__half*>(output), partials, coefficients);
+    }
+    else
+    {
+        launchForward(stream, format, n, c, spatial, epsilon, scale, bias, static_cast<const float*>(input),
+            static_cast<float*>(output), partials, coefficients);
+    }
+    return cudaGetLastError();
+}
+
+} // namespace plugin
+} // namespace nvinfer1
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_INSTANCE_NORMALIZATION_KERNELS_H
+#define TRT_INSTANCE_NORMALIZATION_KERNELS_H
+#include "NvInfer.h"
+#include <cuda_runtime.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Workspace of instanceNormalizationForward for n images of c channels and spatial elements each
+size_t instanceNormalizationWorkspaceSize(int n, int c, int spatial, TensorFormat format);
+
+// Normalizes each of the n * c instances over its spatial elements, then applies the per-channel scale and bias.
+// The input and output are FP32 or FP16 in the linear format, or FP16 in the HWC8 format.
+cudaError_t instanceNormalizationForward(cudaStream_t stream, DataType type, TensorFormat format, int n, int c,
+    int spatial, float epsilon, const float* scale, const float* bias, const void* input, void* output,
+    void* workspace);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_INSTANCE_NORMALIZATION_KERNELS_H
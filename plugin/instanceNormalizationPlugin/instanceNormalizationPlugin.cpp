@@ -15,6 +15,10 @@
  */
 #include <stdexcept>
 #include "instanceNormalizationPlugin.h"
+#include "instanceNormalizationKernels.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 
 using namespace nvinfer1;
 using nvinfer1::plugin::InstanceNormalizationPlugin;
@@ -30,16 +34,6 @@ using nvinfer1::plugin::InstanceNormalizationPluginCreator;
         }                                                                                                              \
     } while (0)
 
-#define CHECK_CUDNN(call)                                                                                              \
-    do                                                                                                                 \
-    {                                                                                                                  \
-        cudnnStatus_t status = call;                                                                                   \
-        if (status != CUDNN_STATUS_SUCCESS)                                                                            \
-        {                                                                                                              \
-            return status;                                                                                             \
-        }                                                                                                              \
-    } while (0)
-
 inline bool is_CHW(nvinfer1::Dims const& dims)
 {
     return (dims.nbDims == 3 && dims.type[0] == nvinfer1::DimensionType::kCHANNEL
@@ -67,17 +61,6 @@ inline float half_to_float_fast(unsigned short value)
     return result.f;
 }
 
-cudnnStatus_t convert_trt2cudnn_dtype(nvinfer1::DataType trt_dtype, cudnnDataType_t* cudnn_dtype)
-{
-    switch (trt_dtype)
-    {
-    case nvinfer1::DataType::kFLOAT: *cudnn_dtype = CUDNN_DATA_FLOAT; break;
-    case nvinfer1::DataType::kHALF: *cudnn_dtype = CUDNN_DATA_HALF; break;
-    default: return CUDNN_STATUS_BAD_PARAM;
-    }
-    return CUDNN_STATUS_SUCCESS;
-}
-
 namespace {
     constexpr const char* INSTANCE_PLUGIN_VERSION{"001"};
     constexpr const char* INSTANCE_PLUGIN_NAME{"InstanceNormalization_TRT"};
@@ -93,6 +76,8 @@ InstanceNormalizationPlugin::InstanceNormalizationPlugin(
     , _nchan(scale.size())
     , _h_scale(scale)
     , _h_bias(bias)
+    , _d_scale(nullptr)
+    , _d_bias(nullptr)
     , _initialized(false)
 {
     ASSERT(scale.size() == bias.size());
@@ -102,6 +87,8 @@ InstanceNormalizationPlugin::InstanceNormalizationPlugin(
     float epsilon, nvinfer1::Weights const& scale, nvinfer1::Weights const& bias)
     : _epsilon(epsilon)
     , _nchan(scale.count)
+    , _d_scale(nullptr)
+    , _d_bias(nullptr)
     , _initialized(false)
 {
     ASSERT(scale.count == bias.count);
@@ -141,7 +128,10 @@ InstanceNormalizationPlugin::InstanceNormalizationPlugin(
     }
 }
 
-InstanceNormalizationPlugin::InstanceNormalizationPlugin(void const* serialData, size_t serialLength) : _initialized(false)
+InstanceNormalizationPlugin::InstanceNormalizationPlugin(void const* serialData, size_t serialLength)
+    : _d_scale(nullptr)
+    , _d_bias(nullptr)
+    , _initialized(false)
 {
     deserialize_value(&serialData, &serialLength, &_epsilon);
     deserialize_value(&serialData, &serialLength, &_nchan);
@@ -169,11 +159,17 @@ DimsExprs InstanceNormalizationPlugin::getOutputDimensions(
 
 int InstanceNormalizationPlugin::initialize()
 {
+    if (_initialized)
+    {
+        return 0;
+    }
+    // The scale and bias are uploaded once, enqueue neither allocates nor synchronizes
+    size_t nchan_bytes = _nchan * sizeof(float);
+    CHECK_CUDA(cudaMalloc((void**) &_d_scale, nchan_bytes));
+    CHECK_CUDA(cudaMalloc((void**) &_d_bias, nchan_bytes));
+    CHECK_CUDA(cudaMemcpy(_d_scale, _h_scale.data(), nchan_bytes, cudaMemcpyHostToDevice));
+    CHECK_CUDA(cudaMemcpy(_d_bias, _h_bias.data(), nchan_bytes, cudaMemcpyHostToDevice));
     _initialized = true;
-    CHECK_CUDNN(cudnnCreate(&_cudnn_handle));
-    CHECK_CUDNN(cudnnCreateTensorDescriptor(&_b_desc));
-    CHECK_CUDNN(cudnnCreateTensorDescriptor(&_x_desc));
-    CHECK_CUDNN(cudnnCreateTensorDescriptor(&_y_desc));
     return 0;
 }
 
@@ -183,58 +179,44 @@ void InstanceNormalizationPlugin::terminate()
     {
         return;
     }
-    cudnnDestroyTensorDescriptor(_y_desc);
-    cudnnDestroyTensorDescriptor(_x_desc);
-    cudnnDestroyTensorDescriptor(_b_desc);
-    cudnnDestroy(_cudnn_handle);
+    cudaFree(_d_bias);
+    cudaFree(_d_scale);
+    _d_bias = nullptr;
+    _d_scale = nullptr;
     _initialized = false;
 }
 
-size_t InstanceNormalizationPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs, const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const 
-{ 
-    return 0; 
+// The spatial elements of an instance are all the dimensions after the channels, so 3D inputs are supported as well
+static int spatialVolume(nvinfer1::Dims const& dims)
+{
+    int spatial = 1;
+    for (int i = 2; i < dims.nbDims; ++i)
+    {
+        spatial *= dims.d[i];
+    }
+    return spatial;
 }
 
+size_t InstanceNormalizationPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const
+{
+    nvinfer1::Dims input_dims = inputs[0].dims;
+    return nvinfer1::plugin::instanceNormalizationWorkspaceSize(
+        input_dims.d[0], input_dims.d[1], spatialVolume(input_dims), inputs[0].format);
+}
 
 int InstanceNormalizationPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
     const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
     cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     nvinfer1::Dims input_dims = inputDesc[0].dims;
     int n = input_dims.d[0];
     int c = input_dims.d[1];
-    int h = input_dims.d[2];
-    int w = input_dims.d[3];
-    size_t nchan_bytes = c * sizeof(float);
-
-    // Note: We repeat the data for each batch entry so that we can do the full
-    //       computation in a single CUDNN call in enqueue().
-    CHECK_CUDA(cudaMalloc((void**) &_d_scale, n * nchan_bytes));
-    CHECK_CUDA(cudaMalloc((void**) &_d_bias, n * nchan_bytes));
-    for (int i = 0; i < n; ++i)
-    {
-        CHECK_CUDA(cudaMemcpy(_d_scale + i * c, _h_scale.data(), nchan_bytes, cudaMemcpyHostToDevice));
-        CHECK_CUDA(cudaMemcpy(_d_bias + i * c, _h_bias.data(), nchan_bytes, cudaMemcpyHostToDevice));
-    }
-
-    CHECK_CUDNN(cudnnSetTensor4dDescriptor(_b_desc, CUDNN_TENSOR_NCHW, CUDNN_DATA_FLOAT, 1, n * c, 1, 1));
-    cudnnDataType_t cudnn_dtype;
-    CHECK_CUDNN(convert_trt2cudnn_dtype(inputDesc[0].type, &cudnn_dtype));
-    CHECK_CUDNN(cudnnSetTensor4dDescriptor(_x_desc, CUDNN_TENSOR_NCHW, cudnn_dtype, 1, n * c, h, w));
-    CHECK_CUDNN(cudnnSetTensor4dDescriptor(_y_desc, CUDNN_TENSOR_NCHW, cudnn_dtype, 1, n * c, h, w));
-    float alpha = 1;
-    float beta = 0;
-    void const* x_ptr = inputs[0];
-    void* y_ptr = outputs[0];
-    CHECK_CUDNN(cudnnSetStream(_cudnn_handle, stream));
-    // Note: Use of CUDNN_BATCHNORM_SPATIAL_PERSISTENT can cause numerical
-    //       overflows (NaNs) for fp32 data in some circumstances. The lower-
-    //       performance CUDNN_BATCHNORM_SPATIAL should be used if this is not
-    //       acceptable.
-    CHECK_CUDNN(cudnnBatchNormalizationForwardTraining(_cudnn_handle, CUDNN_BATCHNORM_SPATIAL_PERSISTENT, &alpha, &beta,
-        _x_desc, x_ptr, _y_desc, y_ptr, _b_desc, _d_scale, _d_bias, 1., nullptr, nullptr, _epsilon, nullptr, nullptr));
-    cudaFree(_d_bias);
-    cudaFree(_d_scale);
+    CHECK_CUDA(nvinfer1::plugin::instanceNormalizationForward(stream, inputDesc[0].type, inputDesc[0].format, n, c,
+        spatialVolume(input_dims), _epsilon, _d_scale, _d_bias, inputs[0], outputs[0], workspace));
     return 0;
 }
 
@@ -258,8 +240,12 @@ bool InstanceNormalizationPlugin::supportsFormatCombination(
     int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
 {
     ASSERT(inOut && pos < (nbInputs + nbOutputs));
-    return ((inOut[pos].type == nvinfer1::DataType::kFLOAT || inOut[pos].type == nvinfer1::DataType::kHALF)
-        && inOut[pos].format == nvinfer1::PluginFormat::kNCHW && inOut[pos].type == inOut[0].type);
+    // FP32 or FP16 in NCHW, or FP16 in HWC8, the output in the type and format of the input
+    const nvinfer1::PluginTensorDesc& desc = inOut[pos];
+    const bool linear = (desc.type == nvinfer1::DataType::kFLOAT || desc.type == nvinfer1::DataType::kHALF)
+        && desc.format == nvinfer1::PluginFormat::kNCHW;
+    const bool hwc8 = desc.type == nvinfer1::DataType::kHALF && desc.format == nvinfer1::PluginFormat::kHWC8;
+    return (linear || hwc8) && desc.type == inOut[0].type && desc.format == inOut[0].format;
 }
 
 const char* InstanceNormalizationPlugin::getPluginType() const
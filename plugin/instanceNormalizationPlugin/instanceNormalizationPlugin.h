@@ -17,7 +17,6 @@
 #define TRT_INSTANCE_NORMALIZATION_PLUGIN_H
 #include "serialize.hpp"
 #include "plugin.h"
-#include <cudnn.h>
 #include <vector>
 #include <iostream>
 #include <string>
@@ -91,8 +90,6 @@ private:
     float* _d_scale;
     float* _d_bias;
     bool _initialized;
-    cudnnHandle_t _cudnn_handle;
-    cudnnTensorDescriptor_t _x_desc, _y_desc, _b_desc;
     const char* mPluginNamespace;
     std::string mNamespace;
 };
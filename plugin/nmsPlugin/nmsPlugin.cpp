@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "nmsPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <cstring>
 #include <iostream>
 #include <sstream>
@@ -21,21 +24,133 @@
 
 using namespace nvinfer1;
 using nvinfer1::plugin::DetectionOutput;
+using nvinfer1::plugin::DetectionOutputDynamic;
 using nvinfer1::plugin::DetectionOutputParameters;
+using nvinfer1::plugin::NMSDynamicPluginCreator;
 using nvinfer1::plugin::NMSPluginCreator;
 
 namespace
 {
 const char* NMS_PLUGIN_VERSION{"1"};
 const char* NMS_PLUGIN_NAME{"NMS_TRT"};
+const char* NMS_DYNAMIC_PLUGIN_VERSION{"1"};
+const char* NMS_DYNAMIC_PLUGIN_NAME{"NMSDynamic_TRT"};
+
+// Fields shared by NMS_TRT and NMSDynamic_TRT
+void addDetectionOutputFields(std::vector<PluginField>& attributes)
+{
+    // NMS Plugin field meta data {name,  data, type, length}
+    attributes.emplace_back(PluginField("shareLocation", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("varianceEncodedInTarget", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("backgroundLabelId", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("numClasses", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("topK", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("keepTopK", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("confidenceThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("nmsThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("inputOrder", nullptr, PluginFieldType::kINT32, 3));
+    attributes.emplace_back(PluginField("confSigmoid", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("isNormalized", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("codeType", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("permuteInputs", nullptr, PluginFieldType::kINT32, 1));
+}
+
+void parseDetectionOutputFields(const PluginFieldCollection* fc, DetectionOutputParameters& params, bool& permuteInputs)
+{
+    const PluginField* fields = fc->fields;
+    // Default init values for TF SSD network
+    params.codeType = CodeTypeSSD::TF_CENTER;
+    params.inputOrder[0] = 0;
+    params.inputOrder[1] = 2;
+    params.inputOrder[2] = 1;
+    permuteInputs = false;
+
+    // Read configurations from  each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "shareLocation"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.shareLocation = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "varianceEncodedInTarget"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.varianceEncodedInTarget = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "backgroundLabelId"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.backgroundLabelId = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "numClasses"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.numClasses = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "topK"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.topK = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "keepTopK"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.keepTopK = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "confidenceThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.confidenceThreshold = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "nmsThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.nmsThreshold = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "confSigmoid"))
+        {
+            params.confSigmoid = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "isNormalized"))
+        {
+            params.isNormalized = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "inputOrder"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            const int size = fields[i].length;
+            const int* o = static_cast<const int*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                params.inputOrder[j] = *o;
+                o++;
+            }
+        }
+        else if (!strcmp(attrName, "codeType"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.codeType = static_cast<CodeTypeSSD>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "permuteInputs"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            permuteInputs = *(static_cast<const int*>(fields[i].data)) != 0;
+        }
+    }
+}
 } // namespace
 
 PluginFieldCollection NMSPluginCreator::mFC{};
 std::vector<PluginField> NMSPluginCreator::mPluginAttributes;
+PluginFieldCollection NMSDynamicPluginCreator::mFC{};
+std::vector<PluginField> NMSDynamicPluginCreator::mPluginAttributes;
 
 // Constrcutor
-DetectionOutput::DetectionOutput(DetectionOutputParameters params)
+DetectionOutput::DetectionOutput(DetectionOutputParameters params, bool permuteInputs)
     : param(params)
+    , mPermuteInputs(permuteInputs)
 {
 }
 
@@ -60,6 +175,16 @@ DetectionOutput::DetectionOutput(const void* data, size_t length)
     C2 = read<int>(d);
     // Number of bounding boxes per sample
     numPriors = read<int>(d);
+    // Precision of the inputs, absent from engines serialized before FP16 support
+    if (d < a + length)
+    {
+        mPrecision = read<DataType>(d);
+    }
+    // Absent from engines serialized before the inputs could be read in place, both paths give the same detections
+    if (d < a + length)
+    {
+        mPermuteInputs = read<bool>(d);
+    }
     ASSERT(d == a + length);
 }
 
@@ -95,13 +220,16 @@ Dims DetectionOutput::getOutputDimensions(int index, const Dims* inputs, int nbI
 size_t DetectionOutput::getWorkspaceSize(int maxBatchSize) const
 {
     return detectionInferenceWorkspaceSize(param.shareLocation, maxBatchSize, C1, C2, param.numClasses, numPriors,
-        param.topK, DataType::kFLOAT, DataType::kFLOAT);
+        param.topK, DataType::kFLOAT, DataType::kFLOAT, true);
 }
 
 // Plugin layer implementation
 int DetectionOutput::enqueue(
     int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     // Input order {loc, conf, prior}
     const void* const locData = inputs[param.inputOrder[0]];
     const void* const confData = inputs[param.inputOrder[1]];
@@ -113,8 +241,9 @@ int DetectionOutput::enqueue(
 
     pluginStatus_t status = detectionInference(stream, batchSize, C1, C2, param.shareLocation,
         param.varianceEncodedInTarget, param.backgroundLabelId, numPriors, param.numClasses, param.topK, param.keepTopK,
-        param.confidenceThreshold, param.nmsThreshold, param.codeType, DataType::kFLOAT, locData, priorData,
-        DataType::kFLOAT, confData, keepCount, topDetections, workspace, param.isNormalized, param.confSigmoid);
+        param.confidenceThreshold, param.nmsThreshold, param.codeType, mPrecision, locData, priorData,
+        mPrecision, confData, keepCount, topDetections, workspace, param.isNormalized, param.confSigmoid,
+        mPermuteInputs);
     ASSERT(status == STATUS_SUCCESS);
     return 0;
 }
@@ -122,8 +251,8 @@ int DetectionOutput::enqueue(
 // Returns the size of serialized parameters
 size_t DetectionOutput::getSerializationSize() const
 {
-    // DetectionOutputParameters, C1,C2,numPriors
-    return sizeof(DetectionOutputParameters) + sizeof(int) * 3;
+    // DetectionOutputParameters, C1,C2,numPriors,mPrecision,mPermuteInputs
+    return sizeof(DetectionOutputParameters) + sizeof(int) * 3 + sizeof(DataType) + sizeof(bool);
 }
 
 // Serialization of plugin parameters
@@ -134,13 +263,15 @@ void DetectionOutput::serialize(void* buffer) const
     write(d, C1);
     write(d, C2);
     write(d, numPriors);
+    write(d, mPrecision);
+    write(d, mPermuteInputs);
     ASSERT(d == a + getSerializationSize());
 }
 
 // Check if the DataType and Plugin format is supported
 bool DetectionOutput::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 }
 
 // Get the plugin type
@@ -165,7 +296,9 @@ void DetectionOutput::destroy()
 IPluginV2Ext* DetectionOutput::clone() const
 {
     // Create a new instance
-    IPluginV2Ext* plugin = new DetectionOutput(param, C1, C2, numPriors);
+    auto* plugin = new DetectionOutput(param, C1, C2, numPriors);
+    plugin->mPrecision = mPrecision;
+    plugin->mPermuteInputs = mPermuteInputs;
 
     // Set the namespace
     plugin->setPluginNamespace(mPluginNamespace);
@@ -247,6 +380,10 @@ void DetectionOutput::configurePlugin(const Dims* inputDims, int nbInputs, const
 
     // Verify C2
     ASSERT(numPriors * param.numClasses == inputDims[param.inputOrder[1]].d[0]);
+
+    // All inputs share the same precision, boxes are decoded and sorted in FP32 in either case
+    ASSERT(inputTypes[param.inputOrder[0]] == DataType::kFLOAT || inputTypes[param.inputOrder[0]] == DataType::kHALF);
+    mPrecision = inputTypes[param.inputOrder[0]];
 }
 
 // Attach the plugin object to an execution context and grant the plugin the access to some context resource.
@@ -258,22 +395,200 @@ void DetectionOutput::attachToContext(
 // Detach the plugin object from its execution context.
 void DetectionOutput::detachFromContext() {}
 
+DetectionOutputDynamic::DetectionOutputDynamic(DetectionOutputParameters params, bool permuteInputs)
+    : param(params)
+    , mPermuteInputs(permuteInputs)
+{
+}
+
+DetectionOutputDynamic::DetectionOutputDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    param = read<DetectionOutputParameters>(d);
+    mPrecision = read<DataType>(d);
+    // Absent from engines serialized before the inputs could be read in place, both paths give the same detections
+    if (d < a + length)
+    {
+        mPermuteInputs = read<bool>(d);
+    }
+    ASSERT(d == a + length);
+}
+
+int DetectionOutputDynamic::getNbOutputs() const
+{
+    // Plugin layer has 2 outputs
+    return 2;
+}
+
+int DetectionOutputDynamic::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void DetectionOutputDynamic::terminate() {}
+
+DimsExprs DetectionOutputDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == 3);
+    ASSERT(outputIndex == 0 || outputIndex == 1);
+    // Output dimensions
+    // index 0 : Dimensions batchSize x 1 x param.keepTopK x 7
+    // index 1: Dimensions batchSize x 1 x 1 x 1
+    DimsExprs out;
+    out.nbDims = 4;
+    out.d[0] = inputs[param.inputOrder[0]].d[0];
+    out.d[1] = exprBuilder.constant(1);
+    out.d[2] = exprBuilder.constant(outputIndex == 0 ? param.keepTopK : 1);
+    out.d[3] = exprBuilder.constant(outputIndex == 0 ? 7 : 1);
+    return out;
+}
+
+size_t DetectionOutputDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const int batchSize = inputs[param.inputOrder[0]].dims.d[0];
+    const int C1 = inputs[param.inputOrder[0]].dims.d[1];
+    const int C2 = inputs[param.inputOrder[1]].dims.d[1];
+    const int numPriors = inputs[param.inputOrder[2]].dims.d[2] / 4;
+    return detectionInferenceWorkspaceSize(param.shareLocation, batchSize, C1, C2, param.numClasses, numPriors,
+        param.topK, DataType::kFLOAT, DataType::kFLOAT, true);
+}
+
+int DetectionOutputDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    // Input order {loc, conf, prior}, the priors are shared by all the images of the batch
+    const int batchSize = inputDesc[param.inputOrder[0]].dims.d[0];
+    const int C1 = inputDesc[param.inputOrder[0]].dims.d[1];
+    const int C2 = inputDesc[param.inputOrder[1]].dims.d[1];
+    const int numPriors = inputDesc[param.inputOrder[2]].dims.d[2] / 4;
+
+    const void* const locData = inputs[param.inputOrder[0]];
+    const void* const confData = inputs[param.inputOrder[1]];
+    const void* const priorData = inputs[param.inputOrder[2]];
+
+    // Output from plugin index 0: topDetections index 1: keepCount
+    void* topDetections = outputs[0];
+    void* keepCount = outputs[1];
+
+    pluginStatus_t status = detectionInference(stream, batchSize, C1, C2, param.shareLocation,
+        param.varianceEncodedInTarget, param.backgroundLabelId, numPriors, param.numClasses, param.topK, param.keepTopK,
+        param.confidenceThreshold, param.nmsThreshold, param.codeType, mPrecision, locData, priorData, mPrecision,
+        confData, keepCount, topDetections, workspace, param.isNormalized, param.confSigmoid, mPermuteInputs);
+    ASSERT(status == STATUS_SUCCESS);
+    return 0;
+}
+
+size_t DetectionOutputDynamic::getSerializationSize() const
+{
+    // DetectionOutputParameters, mPrecision, mPermuteInputs
+    return sizeof(DetectionOutputParameters) + sizeof(DataType) + sizeof(bool);
+}
+
+void DetectionOutputDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, param);
+    write(d, mPrecision);
+    write(d, mPermuteInputs);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void DetectionOutputDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 3);
+    ASSERT(nbOutputs == 2);
+
+    // loc [batchSize, C1, 1, 1], conf [batchSize, C2, 1, 1], prior [1 or batchSize, 2, numPriors * 4, 1]
+    for (int i = 0; i < nbInputs; i++)
+    {
+        ASSERT(in[i].desc.dims.nbDims == 4);
+    }
+
+    const int C1 = in[param.inputOrder[0]].desc.dims.d[1];
+    const int C2 = in[param.inputOrder[1]].desc.dims.d[1];
+    const int priorSize = in[param.inputOrder[2]].desc.dims.d[2];
+    // Verify C1 and C2 once the dimensions are known
+    if (C1 != -1 && C2 != -1 && priorSize != -1)
+    {
+        const int nbBoxCoordinates = 4;
+        const int numPriors = priorSize / nbBoxCoordinates;
+        const int numLocClasses = param.shareLocation ? 1 : param.numClasses;
+        ASSERT(numPriors * numLocClasses * nbBoxCoordinates == C1);
+        ASSERT(numPriors * param.numClasses == C2);
+    }
+    mPrecision = in[param.inputOrder[0]].desc.type;
+}
+
+bool DetectionOutputDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 3 && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    // The outputs are always FP32, the inputs share one precision
+    if (pos >= nbInputs)
+    {
+        return inOut[pos].type == DataType::kFLOAT;
+    }
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* DetectionOutputDynamic::getPluginType() const
+{
+    return NMS_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* DetectionOutputDynamic::getPluginVersion() const
+{
+    return NMS_DYNAMIC_PLUGIN_VERSION;
+}
+
+void DetectionOutputDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* DetectionOutputDynamic::clone() const
+{
+    auto* plugin = new DetectionOutputDynamic(param, mPermuteInputs);
+    plugin->mPrecision = mPrecision;
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+void DetectionOutputDynamic::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* DetectionOutputDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType DetectionOutputDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    // Two outputs
+    ASSERT(index == 0 || index == 1);
+    return DataType::kFLOAT;
+}
+
 // Plugin creator constructor
 NMSPluginCreator::NMSPluginCreator()
 {
-    // NMS Plugin field meta data {name,  data, type, length}
-    mPluginAttributes.emplace_back(PluginField("shareLocation", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("varianceEncodedInTarget", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("backgroundLabelId", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("numClasses", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("topK", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("keepTopK", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("confidenceThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("nmsThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("inputOrder", nullptr, PluginFieldType::kINT32, 3));
-    mPluginAttributes.emplace_back(PluginField("confSigmoid", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("isNormalized", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("codeType", nullptr, PluginFieldType::kINT32, 1));
+    addDetectionOutputFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -300,84 +615,10 @@ const PluginFieldCollection* NMSPluginCreator::getFieldNames()
 // Creates the NMS plugin
 IPluginV2Ext* NMSPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    // Default init values for TF SSD network
-    params.codeType = CodeTypeSSD::TF_CENTER;
-    params.inputOrder[0] = 0;
-    params.inputOrder[1] = 2;
-    params.inputOrder[2] = 1;
-
-    // Read configurations from  each fields
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "shareLocation"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.shareLocation = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "varianceEncodedInTarget"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.varianceEncodedInTarget = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "backgroundLabelId"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.backgroundLabelId = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "numClasses"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.numClasses = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "topK"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.topK = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "keepTopK"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.keepTopK = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "confidenceThreshold"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.confidenceThreshold = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "nmsThreshold"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.nmsThreshold = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "confSigmoid"))
-        {
-            params.confSigmoid = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "isNormalized"))
-        {
-            params.isNormalized = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "inputOrder"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            const int size = fields[i].length;
-            const int* o = static_cast<const int*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                params.inputOrder[j] = *o;
-                o++;
-            }
-        }
-        else if (!strcmp(attrName, "codeType"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.codeType = static_cast<CodeTypeSSD>(*(static_cast<const int*>(fields[i].data)));
-        }
-    }
+    bool permuteInputs{false};
+    parseDetectionOutputFields(fc, params, permuteInputs);
 
-    DetectionOutput* obj = new DetectionOutput(params);
+    DetectionOutput* obj = new DetectionOutput(params, permuteInputs);
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
@@ -390,3 +631,45 @@ IPluginV2Ext* NMSPluginCreator::deserializePlugin(const char* name, const void*
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
+
+NMSDynamicPluginCreator::NMSDynamicPluginCreator()
+{
+    addDetectionOutputFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* NMSDynamicPluginCreator::getPluginName() const
+{
+    return NMS_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* NMSDynamicPluginCreator::getPluginVersion() const
+{
+    return NMS_DYNAMIC_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* NMSDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* NMSDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    DetectionOutputParameters params{};
+    bool permuteInputs{false};
+    parseDetectionOutputFields(fc, params, permuteInputs);
+
+    DetectionOutputDynamic* obj = new DetectionOutputDynamic(params, permuteInputs);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
+
+IPluginV2DynamicExt* NMSDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    DetectionOutputDynamic* obj = new DetectionOutputDynamic(serialData, serialLength);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
@@ -30,7 +30,7 @@ namespace plugin
 class DetectionOutput : public IPluginV2Ext
 {
 public:
-    DetectionOutput(DetectionOutputParameters param);
+    DetectionOutput(DetectionOutputParameters param, bool permuteInputs = false);
 
     DetectionOutput(DetectionOutputParameters param, int C1, int C2, int numPriors);
 
@@ -87,9 +87,68 @@ public:
 private:
     DetectionOutputParameters param;
     int C1, C2, numPriors;
+    DataType mPrecision{DataType::kFLOAT};
+    // Permute the inputs class-major before decoding and sorting them, instead of reading them in place
+    bool mPermuteInputs{false};
     const char* mPluginNamespace;
 };
 
+// Explicit batch version of DetectionOutput. The batch is the first dimension of all the tensors and the number of
+// priors may change between optimization profiles, so that one engine covers several input resolutions.
+class DetectionOutputDynamic : public IPluginV2DynamicExt
+{
+public:
+    DetectionOutputDynamic(DetectionOutputParameters param, bool permuteInputs = false);
+
+    DetectionOutputDynamic(const void* data, size_t length);
+
+    ~DetectionOutputDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+private:
+    DetectionOutputParameters param;
+    DataType mPrecision{DataType::kFLOAT};
+    bool mPermuteInputs{false};
+    std::string mNamespace;
+};
+
 class NMSPluginCreator : public BaseCreator
 {
 public:
@@ -114,6 +173,28 @@ private:
     DetectionOutputParameters params;
     static std::vector<PluginField> mPluginAttributes;
 };
+
+class NMSDynamicPluginCreator : public BaseCreator
+{
+public:
+    NMSDynamicPluginCreator();
+
+    ~NMSDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
 } // namespace plugin
 } // namespace nvinfer1
 
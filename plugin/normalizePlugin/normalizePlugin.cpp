@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 #include "normalizePlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "libraryHandles.h"
+#include "nvtxRange.h"
 #include <cstring>
 #include <cublas_v2.h>
 #include <cudnn.h>
@@ -22,16 +26,89 @@
 
 using namespace nvinfer1;
 using nvinfer1::plugin::Normalize;
+using nvinfer1::plugin::NormalizeDynamic;
+using nvinfer1::plugin::NormalizeDynamicPluginCreator;
 using nvinfer1::plugin::NormalizePluginCreator;
 
 namespace
 {
 const char* NORMALIZE_PLUGIN_VERSION{"1"};
 const char* NORMALIZE_PLUGIN_NAME{"Normalize_TRT"};
+const char* NORMALIZE_DYNAMIC_PLUGIN_NAME{"NormalizeDynamic_TRT"};
+
+// FP32 linear, or with !acrossSpatial, FP16 linear or HWC8
+bool supportsNormalizeFormat(bool acrossSpatial, DataType type, PluginFormat format)
+{
+    if (type == DataType::kFLOAT && format == PluginFormat::kNCHW)
+    {
+        return true;
+    }
+    return !acrossSpatial && type == DataType::kHALF
+        && (format == PluginFormat::kNCHW || format == PluginFormat::kHWC8);
+}
+
+DLayout_t normalizeLayout(PluginFormat format)
+{
+    return format == PluginFormat::kHWC8 ? NHWC8 : NCHW;
+}
+
+void addNormalizeFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("weights", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("acrossSpatial", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("channelShared", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("nbWeights", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("eps", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+// Parses the fields shared by Normalize_TRT and NormalizeDynamic_TRT
+void parseNormalizeFields(const PluginFieldCollection* fc, int& nbWeights, bool& acrossSpatial, bool& channelShared,
+    float& eps, std::vector<float>& weightValues)
+{
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "nbWeights"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            nbWeights = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "acrossSpatial"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            acrossSpatial = *(static_cast<const bool*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "channelShared"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            channelShared = *(static_cast<const bool*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "eps"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            eps = *(static_cast<const float*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "weights"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            weightValues.reserve(size);
+            const auto* w = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                weightValues.push_back(*w);
+                w++;
+            }
+        }
+    }
+}
 } // namespace
 
 PluginFieldCollection NormalizePluginCreator::mFC{};
 std::vector<PluginField> NormalizePluginCreator::mPluginAttributes;
+PluginFieldCollection NormalizeDynamicPluginCreator::mFC{};
+std::vector<PluginField> NormalizeDynamicPluginCreator::mPluginAttributes;
 
 Normalize::Normalize(const Weights* weights, int nbWeights, bool acrossSpatial, bool channelShared, float eps)
     : acrossSpatial(acrossSpatial)
@@ -42,7 +119,6 @@ Normalize::Normalize(const Weights* weights, int nbWeights, bool acrossSpatial,
     ASSERT(nbWeights == 1);
     ASSERT(weights[0].count >= 1);
     mWeights = copyToDevice(weights[0].values, weights[0].count);
-    cublasCreate(&mCublas);
 }
 
 Normalize::Normalize(
@@ -58,7 +134,6 @@ Normalize::Normalize(
     ASSERT(nbWeights == 1);
     ASSERT(weights[0].count >= 1);
     mWeights = copyToDevice(weights[0].values, weights[0].count);
-    cublasCreate(&mCublas);
 }
 
 Normalize::Normalize(const void* buffer, size_t length)
@@ -73,6 +148,12 @@ Normalize::Normalize(const void* buffer, size_t length)
 
     int nbWeights = read<int>(d);
     mWeights = deserializeToDevice(d, nbWeights);
+    // Absent from the engines serialized before FP16 support, which are FP32 linear
+    if (d < a + length)
+    {
+        mDataType = read<DataType>(d);
+        mFormat = read<PluginFormat>(d);
+    }
     ASSERT(d == a + length);
 }
 
@@ -92,12 +173,13 @@ Dims Normalize::getOutputDimensions(int index, const Dims* inputs, int nbInputDi
 
 int Normalize::initialize()
 {
+    plugin::acquireLibraryHandles();
     return 0;
 }
 
 void Normalize::terminate()
 {
-    CUBLASASSERT(cublasDestroy(mCublas));
+    plugin::releaseLibraryHandles();
 }
 
 size_t Normalize::getWorkspaceSize(int maxBatchSize) const
@@ -107,18 +189,23 @@ size_t Normalize::getWorkspaceSize(int maxBatchSize) const
 
 int Normalize::enqueue(int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     const void* inputData = inputs[0];
     void* outputData = outputs[0];
-    pluginStatus_t status = normalizeInference(stream, mCublas, acrossSpatial, channelShared, batchSize, C, H, W, eps,
-        reinterpret_cast<const float*>(mWeights.values), inputData, outputData, workspace);
+    pluginStatus_t status = normalizeInference(stream, plugin::getCublasHandle(), acrossSpatial, channelShared,
+        batchSize, C, H, W, eps, reinterpret_cast<const float*>(mWeights.values), inputData, outputData, workspace,
+        mDataType, normalizeLayout(mFormat));
     ASSERT(status == STATUS_SUCCESS);
     return 0;
 }
 
 size_t Normalize::getSerializationSize() const
 {
-    // C,H,W, acrossSpatial,channelShared, eps, mWeights.count,mWeights.values
-    return sizeof(int) * 3 + sizeof(bool) * 2 + sizeof(float) + sizeof(int) + mWeights.count * sizeof(float);
+    // C,H,W, acrossSpatial,channelShared, eps, mWeights.count,mWeights.values, mDataType, mFormat
+    return sizeof(int) * 3 + sizeof(bool) * 2 + sizeof(float) + sizeof(int) + mWeights.count * sizeof(float)
+        + sizeof(DataType) + sizeof(PluginFormat);
 }
 
 void Normalize::serialize(void* buffer) const
@@ -132,13 +219,15 @@ void Normalize::serialize(void* buffer) const
     write(d, eps);
     write(d, (int) mWeights.count);
     serializeFromDevice(d, mWeights);
+    write(d, mDataType);
+    write(d, mFormat);
 
     ASSERT(d == a + getSerializationSize());
 }
 
 bool Normalize::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return supportsNormalizeFormat(acrossSpatial, type, format);
 }
 
 Weights Normalize::copyToDevice(const void* hostData, size_t count)
@@ -177,7 +266,7 @@ const char* Normalize::getPluginNamespace() const
 DataType Normalize::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
     ASSERT(index == 0);
-    return DataType::kFLOAT;
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -197,7 +286,9 @@ void Normalize::configurePlugin(const Dims* inputDims, int nbInputs, const Dims*
     const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
     const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
 {
-    ASSERT(*inputTypes == DataType::kFLOAT && floatFormat == PluginFormat::kNCHW);
+    ASSERT(supportsFormat(*inputTypes, floatFormat));
+    mDataType = *inputTypes;
+    mFormat = floatFormat;
     C = inputDims[0].d[0];
     H = inputDims[0].d[1];
     W = inputDims[0].d[2];
@@ -244,7 +335,9 @@ void Normalize::destroy()
 IPluginV2Ext* Normalize::clone() const
 {
     // Create a new instance
-    IPluginV2Ext* plugin = new Normalize(&mWeights, mNbWeights, acrossSpatial, channelShared, eps, C, H, W);
+    auto* plugin = new Normalize(&mWeights, mNbWeights, acrossSpatial, channelShared, eps, C, H, W);
+    plugin->mDataType = mDataType;
+    plugin->mFormat = mFormat;
 
     // Set the namespace
     plugin->setPluginNamespace(mPluginNamespace);
@@ -253,11 +346,7 @@ IPluginV2Ext* Normalize::clone() const
 
 NormalizePluginCreator::NormalizePluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("weights", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("acrossSpatial", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("channelShared", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("nbWeights", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("eps", nullptr, PluginFieldType::kFLOAT32, 1));
+    addNormalizeFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -281,43 +370,7 @@ const PluginFieldCollection* NormalizePluginCreator::getFieldNames()
 IPluginV2Ext* NormalizePluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
     std::vector<float> weightValues;
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "nbWeights"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            mNbWeights = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "acrossSpatial"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            mAcrossSpatial = *(static_cast<const bool*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "channelShared"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            mChannelShared = *(static_cast<const bool*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "eps"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            mEps = *(static_cast<const float*>(fields[i].data));
-        }
-        else if (!strcmp(attrName, "weights"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            weightValues.reserve(size);
-            const auto* w = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                weightValues.push_back(*w);
-                w++;
-            }
-        }
-    }
+    parseNormalizeFields(fc, mNbWeights, mAcrossSpatial, mChannelShared, mEps, weightValues);
     Weights weights{DataType::kFLOAT, weightValues.data(), (int64_t) weightValues.size()};
 
     Normalize* obj = new Normalize(&weights, mNbWeights, mAcrossSpatial, mChannelShared, mEps);
@@ -333,3 +386,211 @@ IPluginV2Ext* NormalizePluginCreator::deserializePlugin(const char* name, const
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
+
+NormalizeDynamic::NormalizeDynamic(
+    const Weights* weights, int nbWeights, bool acrossSpatial, bool channelShared, float eps)
+    : mNbWeights(nbWeights)
+    , acrossSpatial(acrossSpatial)
+    , channelShared(channelShared)
+    , eps(eps)
+{
+    ASSERT(nbWeights == 1);
+    ASSERT(weights[0].count >= 1);
+    const auto* values = static_cast<const float*>(weights[0].values);
+    mWeights.assign(values, values + weights[0].count);
+}
+
+NormalizeDynamic::NormalizeDynamic(const void* buffer, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(buffer), *a = d;
+    acrossSpatial = read<bool>(d);
+    channelShared = read<bool>(d);
+    eps = read<float>(d);
+
+    int count = read<int>(d);
+    mWeights.resize(count);
+    std::memcpy(mWeights.data(), d, count * sizeof(float));
+    d += count * sizeof(float);
+    mNbWeights = 1;
+    ASSERT(d == a + length);
+}
+
+int NormalizeDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs NormalizeDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == 1);
+    ASSERT(outputIndex == 0);
+    ASSERT(inputs[0].nbDims == 4);
+    return inputs[0];
+}
+
+int NormalizeDynamic::initialize()
+{
+    plugin::acquireLibraryHandles();
+    CUASSERT(cudaMalloc(&mDeviceWeights, mWeights.size() * sizeof(float)));
+    CUASSERT(cudaMemcpy(mDeviceWeights, mWeights.data(), mWeights.size() * sizeof(float), cudaMemcpyHostToDevice));
+    return 0;
+}
+
+void NormalizeDynamic::terminate()
+{
+    plugin::releaseLibraryHandles();
+    CUASSERT(cudaFree(mDeviceWeights));
+    mDeviceWeights = nullptr;
+}
+
+size_t NormalizeDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return normalizePluginWorkspaceSize(acrossSpatial, inputs[0].dims.d[1], inputs[0].dims.d[2], inputs[0].dims.d[3]);
+}
+
+int NormalizeDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    const Dims& dims = inputDesc[0].dims;
+    pluginStatus_t status = normalizeInference(stream, plugin::getCublasHandle(), acrossSpatial, channelShared,
+        dims.d[0], dims.d[1], dims.d[2], dims.d[3], eps, mDeviceWeights, inputs[0], outputs[0], workspace,
+        inputDesc[0].type, normalizeLayout(inputDesc[0].format));
+    ASSERT(status == STATUS_SUCCESS);
+    return 0;
+}
+
+size_t NormalizeDynamic::getSerializationSize() const
+{
+    // acrossSpatial, channelShared, eps, weight count, weight values
+    return sizeof(bool) * 2 + sizeof(float) + sizeof(int) + mWeights.size() * sizeof(float);
+}
+
+void NormalizeDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, acrossSpatial);
+    write(d, channelShared);
+    write(d, eps);
+    write(d, static_cast<int>(mWeights.size()));
+    std::memcpy(d, mWeights.data(), mWeights.size() * sizeof(float));
+    d += mWeights.size() * sizeof(float);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void NormalizeDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 1);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 4);
+    if (channelShared)
+    {
+        ASSERT(mWeights.size() == 1);
+    }
+    else
+    {
+        // The channel count is a build time constant even when the spatial dimensions are dynamic
+        ASSERT(static_cast<int>(mWeights.size()) == in[0].desc.dims.d[1]);
+    }
+}
+
+bool NormalizeDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (pos == 1)
+    {
+        return inOut[1].type == inOut[0].type && inOut[1].format == inOut[0].format;
+    }
+    return supportsNormalizeFormat(acrossSpatial, inOut[0].type, inOut[0].format);
+}
+
+const char* NormalizeDynamic::getPluginType() const
+{
+    return NORMALIZE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* NormalizeDynamic::getPluginVersion() const
+{
+    return NORMALIZE_PLUGIN_VERSION;
+}
+
+void NormalizeDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* NormalizeDynamic::clone() const
+{
+    Weights weights{DataType::kFLOAT, mWeights.data(), static_cast<int64_t>(mWeights.size())};
+    auto* plugin = new NormalizeDynamic(&weights, mNbWeights, acrossSpatial, channelShared, eps);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+void NormalizeDynamic::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* NormalizeDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType NormalizeDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+NormalizeDynamicPluginCreator::NormalizeDynamicPluginCreator()
+{
+    addNormalizeFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* NormalizeDynamicPluginCreator::getPluginName() const
+{
+    return NORMALIZE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* NormalizeDynamicPluginCreator::getPluginVersion() const
+{
+    return NORMALIZE_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* NormalizeDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* NormalizeDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    int nbWeights{};
+    bool acrossSpatial{};
+    bool channelShared{};
+    float eps{};
+    std::vector<float> weightValues;
+    parseNormalizeFields(fc, nbWeights, acrossSpatial, channelShared, eps, weightValues);
+    Weights weights{DataType::kFLOAT, weightValues.data(), (int64_t) weightValues.size()};
+
+    auto* obj = new NormalizeDynamic(&weights, nbWeights, acrossSpatial, channelShared, eps);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
+
+IPluginV2DynamicExt* NormalizeDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    auto* obj = new NormalizeDynamic(serialData, serialLength);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
@@ -90,8 +90,6 @@ private:
     void serializeFromDevice(char*& hostBuffer, Weights deviceWeights) const;
     Weights deserializeToDevice(const char*& hostBuffer, size_t count);
 
-    cublasHandle_t mCublas{};
-
     int C{};
     int H{};
     int W{};
@@ -100,9 +98,70 @@ private:
     bool channelShared{};
     float eps{};
     Weights mWeights{};
+    DataType mDataType{DataType::kFLOAT};
+    PluginFormat mFormat{PluginFormat::kNCHW};
     const char* mPluginNamespace;
 };
 
+// Explicit batch version of Normalize, the input is [N, C, H, W] and H and W may change between optimization profiles.
+// The scale weights are kept on the host and only copied to the device by initialize().
+class NormalizeDynamic : public IPluginV2DynamicExt
+{
+public:
+    NormalizeDynamic(const Weights* weights, int nbWeights, bool acrossSpatial, bool channelShared, float eps);
+
+    NormalizeDynamic(const void* buffer, size_t length);
+
+    ~NormalizeDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    int mNbWeights{};
+    bool acrossSpatial{};
+    bool channelShared{};
+    float eps{};
+    std::vector<float> mWeights;
+    float* mDeviceWeights{};
+    std::string mNamespace;
+};
+
 class NormalizePluginCreator : public BaseCreator
 {
 public:
@@ -128,6 +187,28 @@ private:
     int mNbWeights{};
     static std::vector<PluginField> mPluginAttributes;
 };
+
+class NormalizeDynamicPluginCreator : public BaseCreator
+{
+public:
+    NormalizeDynamicPluginCreator();
+
+    ~NormalizeDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
 } // namespace plugin
 } // namespace nvinfer1
 
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fasterRCNNDetectionOutputKernels.h"
+#include <algorithm>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+constexpr int kThreads = 256;
+
+// One thread per box, the same transform as bbox_transform_inv and clip_boxes of py-faster-rcnn
+__global__ void decodeFasterRCNNBoxesKernel(
+    int boxes, int nmsMaxOut, int numClasses, const float* rois, const float* deltas, const float* imInfo, float* out)
+{
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < boxes; i += gridDim.x * blockDim.x)
+    {
+        const int roi = i / numClasses;
+        const float* info = imInfo + (roi / nmsMaxOut) * 3;
+        const float scale = info[2];
+        const float x1 = rois[roi * 4] / scale;
+        const float y1 = rois[roi * 4 + 1] / scale;
+        const float width = rois[roi * 4 + 2] / scale - x1 + 1.F;
+        const float height = rois[roi * 4 + 3] / scale - y1 + 1.F;
+        const float ctrX = x1 + 0.5F * width;
+        const float ctrY = y1 + 0.5F * height;
+
+        const float* delta = deltas + static_cast<size_t>(i) * 4;
+        const float predCtrX = delta[0] * width + ctrX;
+        const float predCtrY = delta[1] * height + ctrY;
+        const float predW = expf(delta[2]) * width;
+        const float predH = expf(delta[3]) * height;
+
+        const float maxX = info[1] / scale - 1.F;
+        const float maxY = info[0] / scale - 1.F;
+        float* box = out + static_cast<size_t>(i) * 4;
+        box[0] = fmaxf(fminf(predCtrX - 0.5F * predW, maxX), 0.F);
+        box[1] = fmaxf(fminf(predCtrY - 0.5F * predH, maxY), 0.F);
+        box[2] = fmaxf(fminf(predCtrX + 0.5F * predW, maxX), 0.F);
+        box[3] = fmaxf(fminf(predCtrY + 0.5F * predH, maxY), 0.F);
+    }
+}
+
+} // namespace
+
+cudaError_t decodeFasterRCNNBoxes(cudaStream_t stream, int n, int nmsMaxOut, int numClasses, const float* rois,
+    const float* deltas, const float* imInfo, float* boxes)
+{
+    const int count = n * nmsMaxOut * numClasses;
+    const int blocks = std::min((count + kThreads - 1) / kThreads, 65535);
+    decodeFasterRCNNBoxesKernel<<<blocks, kThreads, 0, stream>>>(
+        count, nmsMaxOut, numClasses, rois, deltas, imInfo, boxes);
+    return cudaGetLastError();
+}
+
+} // namespace plugin
+} // namespace nvinfer1
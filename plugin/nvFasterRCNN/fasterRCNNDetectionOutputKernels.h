@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_FASTER_RCNN_DETECTION_OUTPUT_KERNELS_H
+#define TRT_FASTER_RCNN_DETECTION_OUTPUT_KERNELS_H
+#include <cuda_runtime.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Applies the per-class deltas [n, nmsMaxOut, numClasses, 4] to the rois [n, nmsMaxOut, 4] of the scaled images, and
+// clips the boxes [n, nmsMaxOut, numClasses, 4] to the original images described by imInfo [n, 3]: height, width and
+// scale of the scaled image.
+cudaError_t decodeFasterRCNNBoxes(cudaStream_t stream, int n, int nmsMaxOut, int numClasses, const float* rois,
+    const float* deltas, const float* imInfo, float* boxes);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_FASTER_RCNN_DETECTION_OUTPUT_KERNELS_H
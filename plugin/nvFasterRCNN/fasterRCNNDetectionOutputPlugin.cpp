@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "fasterRCNNDetectionOutputPlugin.h"
+#include "bboxUtils.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "fasterRCNNDetectionOutputKernels.h"
+#include "kernel.h"
+#include "nmsUtils.h"
+#include "nvtxRange.h"
+#include "batchedNMSPlugin/batchedNMSInference.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace nvinfer1;
+using namespace plugin;
+using nvinfer1::plugin::FasterRCNNDetectionOutputDynamic;
+using nvinfer1::plugin::FasterRCNNDetectionOutputDynamicPluginCreator;
+using nvinfer1::plugin::FasterRCNNDetectionOutputParams;
+using nvinfer1::plugin::FasterRCNNDetectionOutputPlugin;
+using nvinfer1::plugin::FasterRCNNDetectionOutputPluginCreator;
+
+namespace
+{
+const char* FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_VERSION{"1"};
+const char* FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_NAME{"FasterRCNNDetectionOutput_TRT"};
+const char* FASTER_RCNN_DETECTION_OUTPUT_DYNAMIC_PLUGIN_NAME{"FasterRCNNDetectionOutputDynamic_TRT"};
+
+int volume(const Dims& dims)
+{
+    int v = 1;
+    for (int i = 0; i < dims.nbDims; ++i)
+    {
+        v *= dims.d[i];
+    }
+    return v;
+}
+
+void addDetectionOutputFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("numClasses", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("topK", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("keepTopK", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("scoreThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("iouThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+FasterRCNNDetectionOutputParams parseDetectionOutputFields(const PluginFieldCollection* fc)
+{
+    // Every roi is a candidate of every class unless topK is set
+    FasterRCNNDetectionOutputParams params{0, -1, 100, 0.05F, 0.3F};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "numClasses"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.numClasses = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "topK"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.topK = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "keepTopK"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.keepTopK = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "scoreThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.scoreThreshold = *static_cast<const float*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "iouThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.iouThreshold = *static_cast<const float*>(fields[i].data);
+        }
+    }
+    return params;
+}
+
+size_t decodedBoxesSize(const FasterRCNNDetectionOutputParams& params, int batchSize, int nmsMaxOut)
+{
+    return static_cast<size_t>(batchSize) * nmsMaxOut * params.numClasses * 4 * sizeof(float);
+}
+
+size_t detectionOutputWorkspaceSize(const FasterRCNNDetectionOutputParams& params, int batchSize, int nmsMaxOut)
+{
+    const int topK = params.topK > 0 ? std::min(params.topK, nmsMaxOut) : nmsMaxOut;
+    size_t wss[2];
+    wss[0] = decodedBoxesSize(params, batchSize, nmsMaxOut);
+    wss[1] = detectionInferenceWorkspaceSize(false, batchSize, nmsMaxOut * params.numClasses * 4,
+        nmsMaxOut * params.numClasses, params.numClasses, nmsMaxOut, topK, DataType::kFLOAT, DataType::kFLOAT, true);
+    return calculateTotalWorkspaceSize(wss, 2);
+}
+
+// Decodes the boxes into the workspace and runs the NMS over them, shared by the implicit and explicit batch plugins
+int detectionOutputInference(cudaStream_t stream, const FasterRCNNDetectionOutputParams& params, int batchSize,
+    int nmsMaxOut, const void* const* inputs, void* const* outputs, void* workspace)
+{
+    auto* boxes = static_cast<float*>(workspace);
+    void* nmsWorkspace
+        = nextWorkspacePtr(static_cast<int8_t*>(workspace), decodedBoxesSize(params, batchSize, nmsMaxOut));
+    if (decodeFasterRCNNBoxes(stream, batchSize, nmsMaxOut, params.numClasses, static_cast<const float*>(inputs[0]),
+            static_cast<const float*>(inputs[1]), static_cast<const float*>(inputs[3]), boxes)
+        != cudaSuccess)
+    {
+        return 1;
+    }
+
+    // The boxes are clipped to the image in pixels, the IoU is the one of normalized boxes as in the host reference
+    const int topK = params.topK > 0 ? std::min(params.topK, nmsMaxOut) : nmsMaxOut;
+    const pluginStatus_t status = nmsInference(stream, batchSize, nmsMaxOut * params.numClasses * 4,
+        nmsMaxOut * params.numClasses, false, 0, nmsMaxOut, params.numClasses, topK, params.keepTopK,
+        params.scoreThreshold, params.iouThreshold, DataType::kFLOAT, boxes, DataType::kFLOAT, inputs[2], outputs[0],
+        outputs[1], outputs[2], outputs[3], nmsWorkspace, true, false, false);
+    return status != STATUS_SUCCESS;
+}
+} // namespace
+
+PluginFieldCollection FasterRCNNDetectionOutputPluginCreator::mFC{};
+std::vector<PluginField> FasterRCNNDetectionOutputPluginCreator::mPluginAttributes;
+PluginFieldCollection FasterRCNNDetectionOutputDynamicPluginCreator::mFC{};
+std::vector<PluginField> FasterRCNNDetectionOutputDynamicPluginCreator::mPluginAttributes;
+
+FasterRCNNDetectionOutputPluginCreator::FasterRCNNDetectionOutputPluginCreator()
+{
+    addDetectionOutputFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* FasterRCNNDetectionOutputPluginCreator::getPluginName() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_NAME;
+}
+
+const char* FasterRCNNDetectionOutputPluginCreator::getPluginVersion() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* FasterRCNNDetectionOutputPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2Ext* FasterRCNNDetectionOutputPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    auto* plugin = new FasterRCNNDetectionOutputPlugin(parseDetectionOutputFields(fc));
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2Ext* FasterRCNNDetectionOutputPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new FasterRCNNDetectionOutputPlugin(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+FasterRCNNDetectionOutputPlugin::FasterRCNNDetectionOutputPlugin(FasterRCNNDetectionOutputParams params)
+    : mParams(params)
+{
+    ASSERT(mParams.numClasses > 1 && mParams.keepTopK > 0);
+}
+
+FasterRCNNDetectionOutputPlugin::FasterRCNNDetectionOutputPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mParams = read<FasterRCNNDetectionOutputParams>(d);
+    mNmsMaxOut = read<int>(d);
+    ASSERT(d == a + length);
+}
+
+int FasterRCNNDetectionOutputPlugin::getNbOutputs() const
+{
+    return 4;
+}
+
+Dims FasterRCNNDetectionOutputPlugin::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
+{
+    ASSERT(nbInputDims == 4 && index >= 0 && index < getNbOutputs());
+    const int nmsMaxOut = volume(inputs[0]) / 4;
+    ASSERT(volume(inputs[1]) == nmsMaxOut * mParams.numClasses * 4);
+    ASSERT(volume(inputs[2]) == nmsMaxOut * mParams.numClasses);
+    ASSERT(volume(inputs[3]) == 3);
+    // num_detections, nmsed_boxes, then nmsed_scores and nmsed_classes, as BatchedNMS_TRT
+    if (index == 0)
+    {
+        Dims dim0{};
+        dim0.nbDims = 0;
+        return dim0;
+    }
+    if (index == 1)
+    {
+        return DimsHW(mParams.keepTopK, 4);
+    }
+    Dims dim1{};
+    dim1.nbDims = 1;
+    dim1.d[0] = mParams.keepTopK;
+    return dim1;
+}
+
+int FasterRCNNDetectionOutputPlugin::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void FasterRCNNDetectionOutputPlugin::terminate() {}
+
+void FasterRCNNDetectionOutputPlugin::destroy()
+{
+    delete this;
+}
+
+size_t FasterRCNNDetectionOutputPlugin::getWorkspaceSize(int maxBatchSize) const
+{
+    return detectionOutputWorkspaceSize(mParams, maxBatchSize, mNmsMaxOut);
+}
+
+int FasterRCNNDetectionOutputPlugin::enqueue(
+    int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    return detectionOutputInference(stream, mParams, batch_size, mNmsMaxOut, inputs, outputs, workspace);
+}
+
+size_t FasterRCNNDetectionOutputPlugin::getSerializationSize() const
+{
+    // FasterRCNNDetectionOutputParams, nmsMaxOut
+    return sizeof(FasterRCNNDetectionOutputParams) + sizeof(int);
+}
+
+void FasterRCNNDetectionOutputPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mParams);
+    write(d, mNmsMaxOut);
+    ASSERT(d == a + getSerializationSize());
+}
+
+const char* FasterRCNNDetectionOutputPlugin::getPluginType() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_NAME;
+}
+
+const char* FasterRCNNDetectionOutputPlugin::getPluginVersion() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_VERSION;
+}
+
+IPluginV2Ext* FasterRCNNDetectionOutputPlugin::clone() const
+{
+    return new FasterRCNNDetectionOutputPlugin(*this);
+}
+
+void FasterRCNNDetectionOutputPlugin::setPluginNamespace(const char* libNamespace)
+{
+    mNameSpace = libNamespace;
+}
+
+const char* FasterRCNNDetectionOutputPlugin::getPluginNamespace() const
+{
+    return mNameSpace.c_str();
+}
+
+bool FasterRCNNDetectionOutputPlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
+{
+    ASSERT(nbInputs == 4 && nbOutputs == 4 && pos < nbInputs + nbOutputs);
+    // num_detections is INT32, everything else FP32
+    const DataType type = pos == nbInputs ? DataType::kINT32 : DataType::kFLOAT;
+    return inOut[pos].type == type && inOut[pos].format == TensorFormat::kLINEAR;
+}
+
+DataType FasterRCNNDetectionOutputPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    return index == 0 ? DataType::kINT32 : DataType::kFLOAT;
+}
+
+bool FasterRCNNDetectionOutputPlugin::isOutputBroadcastAcrossBatch(
+    int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+{
+    return false;
+}
+
+bool FasterRCNNDetectionOutputPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+{
+    return false;
+}
+
+void FasterRCNNDetectionOutputPlugin::configurePlugin(
+    const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
+{
+    ASSERT(nbInput == 4 && nbOutput == 4);
+    mNmsMaxOut = volume(in[0].dims) / 4;
+}
+
+void FasterRCNNDetectionOutputPlugin::attachToContext(
+    cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator)
+{
+}
+
+void FasterRCNNDetectionOutputPlugin::detachFromContext() {}
+
+FasterRCNNDetectionOutputDynamic::FasterRCNNDetectionOutputDynamic(FasterRCNNDetectionOutputParams params)
+    : mParams(params)
+{
+    ASSERT(mParams.numClasses > 1 && mParams.keepTopK > 0);
+}
+
+FasterRCNNDetectionOutputDynamic::FasterRCNNDetectionOutputDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    ASSERT(length == sizeof(FasterRCNNDetectionOutputParams));
+    mParams = read<FasterRCNNDetectionOutputParams>(d);
+    ASSERT(d == a + length);
+}
+
+int FasterRCNNDetectionOutputDynamic::getNbOutputs() const
+{
+    return 4;
+}
+
+DimsExprs FasterRCNNDetectionOutputDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == 4 && outputIndex >= 0 && outputIndex < getNbOutputs());
+    // num_detections, nmsed_boxes, then nmsed_scores and nmsed_classes, as BatchedNMSDynamic_TRT
+    DimsExprs output;
+    output.d[0] = inputs[0].d[0];
+    if (outputIndex == 0)
+    {
+        output.nbDims = 2;
+        output.d[1] = exprBuilder.constant(1);
+    }
+    else if (outputIndex == 1)
+    {
+        output.nbDims = 3;
+        output.d[1] = exprBuilder.constant(mParams.keepTopK);
+        output.d[2] = exprBuilder.constant(4);
+    }
+    else
+    {
+        output.nbDims = 2;
+        output.d[1] = exprBuilder.constant(mParams.keepTopK);
+    }
+    return output;
+}
+
+int FasterRCNNDetectionOutputDynamic::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void FasterRCNNDetectionOutputDynamic::terminate() {}
+
+size_t FasterRCNNDetectionOutputDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const int batchSize = inputs[0].dims.d[0];
+    return detectionOutputWorkspaceSize(mParams, batchSize, volume(inputs[0].dims) / (4 * batchSize));
+}
+
+int FasterRCNNDetectionOutputDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    const int batchSize = inputDesc[0].dims.d[0];
+    const int nmsMaxOut = volume(inputDesc[0].dims) / (4 * batchSize);
+    return detectionOutputInference(stream, mParams, batchSize, nmsMaxOut, inputs, outputs, workspace);
+}
+
+size_t FasterRCNNDetectionOutputDynamic::getSerializationSize() const
+{
+    return sizeof(FasterRCNNDetectionOutputParams);
+}
+
+void FasterRCNNDetectionOutputDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mParams);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void FasterRCNNDetectionOutputDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 4 && nbOutputs == 4);
+    // Checked on the largest shapes of the profile, where every dimension is known
+    const int batchSize = in[0].max.d[0];
+    const int nmsMaxOut = volume(in[0].max) / (4 * batchSize);
+    ASSERT(volume(in[1].max) == batchSize * nmsMaxOut * mParams.numClasses * 4);
+    ASSERT(volume(in[2].max) == batchSize * nmsMaxOut * mParams.numClasses);
+    ASSERT(volume(in[3].max) == batchSize * 3);
+}
+
+bool FasterRCNNDetectionOutputDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 4 && nbOutputs == 4 && pos < nbInputs + nbOutputs);
+    // num_detections is INT32, everything else FP32
+    const DataType type = pos == nbInputs ? DataType::kINT32 : DataType::kFLOAT;
+    return inOut[pos].type == type && inOut[pos].format == TensorFormat::kLINEAR;
+}
+
+const char* FasterRCNNDetectionOutputDynamic::getPluginType() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* FasterRCNNDetectionOutputDynamic::getPluginVersion() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_VERSION;
+}
+
+void FasterRCNNDetectionOutputDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* FasterRCNNDetectionOutputDynamic::clone() const
+{
+    return new FasterRCNNDetectionOutputDynamic(*this);
+}
+
+void FasterRCNNDetectionOutputDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* FasterRCNNDetectionOutputDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType FasterRCNNDetectionOutputDynamic::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    return index == 0 ? DataType::kINT32 : DataType::kFLOAT;
+}
+
+FasterRCNNDetectionOutputDynamicPluginCreator::FasterRCNNDetectionOutputDynamicPluginCreator()
+{
+    addDetectionOutputFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* FasterRCNNDetectionOutputDynamicPluginCreator::getPluginName() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* FasterRCNNDetectionOutputDynamicPluginCreator::getPluginVersion() const
+{
+    return FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* FasterRCNNDetectionOutputDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* FasterRCNNDetectionOutputDynamicPluginCreator::createPlugin(
+    const char* name, const PluginFieldCollection* fc)
+{
+    auto* plugin = new FasterRCNNDetectionOutputDynamic(parseDetectionOutputFields(fc));
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* FasterRCNNDetectionOutputDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new FasterRCNNDetectionOutputDynamic(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
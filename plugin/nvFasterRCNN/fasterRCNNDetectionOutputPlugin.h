@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_H
+#define TRT_FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_H
+
+#include <cuda_runtime_api.h>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+#include "NvInferPlugin.h"
+#include "plugin.h"
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+struct FasterRCNNDetectionOutputParams
+{
+    int numClasses;
+    // Candidates kept per class before NMS, and detections kept per image after it
+    int topK;
+    int keepTopK;
+    float scoreThreshold;
+    float iouThreshold;
+};
+
+// Second stage post-processing of Faster R-CNN, appended after RPROI_TRT and the classifier: decodes and clips the
+// per-class boxes of every roi, then runs the per-class NMS of BatchedNMS_TRT so that only the final detections leave
+// the device. Inputs are the rois, the per-class deltas and probabilities of the rois, and the image info.
+class FasterRCNNDetectionOutputPlugin : public IPluginV2IOExt
+{
+public:
+    FasterRCNNDetectionOutputPlugin(FasterRCNNDetectionOutputParams params);
+
+    FasterRCNNDetectionOutputPlugin(const void* data, size_t length);
+
+    ~FasterRCNNDetectionOutputPlugin() override = default;
+
+    int getNbOutputs() const override;
+
+    Dims getOutputDimensions(int index, const Dims* inputs, int nbInputDims) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    void destroy() override;
+
+    size_t getWorkspaceSize(int maxBatchSize) const override;
+
+    int enqueue(
+        int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    IPluginV2Ext* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    bool isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const override;
+
+    bool canBroadcastInputAcrossBatch(int inputIndex) const override;
+
+    void attachToContext(
+        cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override;
+
+    void configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
+
+    void detachFromContext() override;
+
+private:
+    FasterRCNNDetectionOutputParams mParams;
+    // Rois per image, from the first input
+    int mNmsMaxOut{0};
+    std::string mNameSpace;
+};
+
+// Explicit batch version of FasterRCNNDetectionOutputPlugin. The batch size is the first dimension of the rois
+// [N, 1, nmsMaxOut, 4] and of the image info [N, 1, 1, 3]; the deltas and probabilities may be laid out with the rois
+// of all the images in their first dimension, as the classifier after RPROIDynamic_TRT produces them. The outputs are
+// num_detections [N, 1], nmsed_boxes [N, keepTopK, 4], nmsed_scores and nmsed_classes [N, keepTopK].
+class FasterRCNNDetectionOutputDynamic : public IPluginV2DynamicExt
+{
+public:
+    FasterRCNNDetectionOutputDynamic(FasterRCNNDetectionOutputParams params);
+
+    FasterRCNNDetectionOutputDynamic(const void* data, size_t length);
+
+    ~FasterRCNNDetectionOutputDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    FasterRCNNDetectionOutputParams mParams;
+    std::string mNamespace;
+};
+
+class FasterRCNNDetectionOutputPluginCreator : public BaseCreator
+{
+public:
+    FasterRCNNDetectionOutputPluginCreator();
+
+    ~FasterRCNNDetectionOutputPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2Ext* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2Ext* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as FasterRCNNDetectionOutput_TRT
+class FasterRCNNDetectionOutputDynamicPluginCreator : public BaseCreator
+{
+public:
+    FasterRCNNDetectionOutputDynamicPluginCreator();
+
+    ~FasterRCNNDetectionOutputDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+} // namespace plugin
+} // namespace nvinfer1
+#endif // TRT_FASTER_RCNN_DETECTION_OUTPUT_PLUGIN_H
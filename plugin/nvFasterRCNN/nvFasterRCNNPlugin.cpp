@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "nvFasterRCNNPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <cstdio>
 #include <cstring>
 #include <cublas_v2.h>
@@ -21,6 +24,8 @@
 
 using namespace nvinfer1;
 using nvinfer1::Dims;
+using nvinfer1::plugin::RPROIDynamic;
+using nvinfer1::plugin::RPROIDynamicPluginCreator;
 using nvinfer1::plugin::RPROIPlugin;
 using nvinfer1::plugin::RPROIPluginCreator;
 
@@ -28,10 +33,118 @@ namespace
 {
 const char* RPROI_PLUGIN_VERSION{"1"};
 const char* RPROI_PLUGIN_NAME{"RPROI_TRT"};
+const char* RPROI_DYNAMIC_PLUGIN_NAME{"RPROIDynamic_TRT"};
+
+void addRPROIFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("poolingH", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("poolingW", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("featureStride", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("preNmsTop", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("nmsMaxOut", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("anchorsRatioCount", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("anchorsScaleCount", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("iouThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("minBoxSize", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("spatialScale", nullptr, PluginFieldType::kFLOAT32, 1));
+
+    // TODO Do we need to pass the size attribute here for float arrarys, we
+    // dont have that information at this point.
+    attributes.emplace_back(PluginField("anchorsRatios", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("anchorsScales", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+// The ratios and scales are copied once all the fields are read, so their counts may come in any order
+RPROIParams parseRPROIFields(
+    const PluginFieldCollection* fc, std::vector<float>& anchorsRatios, std::vector<float>& anchorsScales)
+{
+    RPROIParams params{};
+    const float* ratios = nullptr;
+    const float* scales = nullptr;
+    const PluginField* fields = fc->fields;
+    int nbFields = fc->nbFields;
+
+    for (int i = 0; i < nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "poolingH"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.poolingH = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "poolingW"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.poolingW = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "featureStride"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.featureStride = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "preNmsTop"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.preNmsTop = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "nmsMaxOut"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.nmsMaxOut = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "anchorsRatioCount"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.anchorsRatioCount = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "anchorsScaleCount"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.anchorsScaleCount = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "iouThreshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.iouThreshold = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        if (!strcmp(attrName, "minBoxSize"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.minBoxSize = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        if (!strcmp(attrName, "spatialScale"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.spatialScale = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        if (!strcmp(attrName, "anchorsRatios"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            ratios = static_cast<const float*>(fields[i].data);
+        }
+        if (!strcmp(attrName, "anchorsScales"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            scales = static_cast<const float*>(fields[i].data);
+        }
+    }
+
+    if (ratios != nullptr)
+    {
+        anchorsRatios.assign(ratios, ratios + params.anchorsRatioCount);
+    }
+    if (scales != nullptr)
+    {
+        anchorsScales.assign(scales, scales + params.anchorsScaleCount);
+    }
+    return params;
+}
 } // namespace
 
 PluginFieldCollection RPROIPluginCreator::mFC{};
 std::vector<PluginField> RPROIPluginCreator::mPluginAttributes;
+PluginFieldCollection RPROIDynamicPluginCreator::mFC{};
+std::vector<PluginField> RPROIDynamicPluginCreator::mPluginAttributes;
 
 RPROIPlugin::RPROIPlugin(RPROIParams params, const float* anchorsRatios, const float* anchorsScales)
     : params(params)
@@ -86,6 +199,12 @@ RPROIPlugin::RPROIPlugin(const void* data, size_t length)
     d += params.anchorsRatioCount * sizeof(float);
     anchorsScalesHost = copyToHost(d, params.anchorsScaleCount);
     d += params.anchorsScaleCount * sizeof(float);
+    // Plans serialized before the FP16 feature maps end with the scales
+    if (d != a + length)
+    {
+        mFeatureType = read<DataType>(d);
+        mFeatureFormat = read<TensorFormat>(d);
+    }
     ASSERT(d == a + length);
 
     CHECK(cudaMalloc((void**) &anchorsDev, 4 * params.anchorsRatioCount * params.anchorsScaleCount * sizeof(float)));
@@ -141,11 +260,14 @@ Dims RPROIPlugin::getOutputDimensions(int index, const Dims* inputs, int nbInput
 
 size_t RPROIPlugin::getWorkspaceSize(int maxBatchSize) const
 {
-    return RPROIInferenceFusedWorkspaceSize(maxBatchSize, A, H, W, params.nmsMaxOut);
+    return RPROIInferenceFusedWorkspaceSize(maxBatchSize, A, H, W, params.preNmsTop, params.nmsMaxOut);
 }
 
 int RPROIPlugin::enqueue(int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     // Bounding box (region proposal) objectness scores.
     const void* const scores = inputs[0];
     // Predicted bounding box offsets.
@@ -159,12 +281,13 @@ int RPROIPlugin::enqueue(int batchSize, const void* const* inputs, void** output
     void* rois = outputs[0];
     // ROI pooled feature map corresponding to the region of interest (ROI).
     void* pfmap = outputs[1];
+    const DLayout_t layout = mFeatureFormat == TensorFormat::kHWC8 ? NHWC8 : NCHW;
 
     pluginStatus_t status = RPROIInferenceFused(stream, batchSize, A, C, H, W, params.poolingH, params.poolingW,
         params.featureStride, params.preNmsTop, params.nmsMaxOut, params.iouThreshold, params.minBoxSize,
         params.spatialScale, (const float*) iinfo, this->anchorsDev, nvinfer1::DataType::kFLOAT, NCHW, scores,
-        nvinfer1::DataType::kFLOAT, NCHW, deltas, nvinfer1::DataType::kFLOAT, NCHW, fmap, workspace,
-        nvinfer1::DataType::kFLOAT, rois, nvinfer1::DataType::kFLOAT, NCHW, pfmap);
+        nvinfer1::DataType::kFLOAT, NCHW, deltas, mFeatureType, layout, fmap, workspace, nvinfer1::DataType::kFLOAT,
+        rois, mFeatureType, layout, pfmap);
     ASSERT(status == STATUS_SUCCESS);
     return 0;
 }
@@ -175,7 +298,8 @@ size_t RPROIPlugin::getSerializationSize() const
     size_t intSize = sizeof(int) * 4;
     size_t ratiosSize = sizeof(float) * params.anchorsRatioCount;
     size_t scalesSize = sizeof(float) * params.anchorsScaleCount;
-    return paramSize + intSize + ratiosSize + scalesSize;
+    size_t featureSize = sizeof(DataType) + sizeof(TensorFormat);
+    return paramSize + intSize + ratiosSize + scalesSize + featureSize;
 }
 
 void RPROIPlugin::serialize(void* buffer) const
@@ -193,6 +317,8 @@ void RPROIPlugin::serialize(void* buffer) const
     d += sizeof(int);
     d += copyFromHost(d, anchorsRatiosHost, params.anchorsRatioCount);
     d += copyFromHost(d, anchorsScalesHost, params.anchorsScaleCount);
+    write(d, mFeatureType);
+    write(d, mFeatureFormat);
     ASSERT(d == a + getSerializationSize());
 }
 
@@ -210,9 +336,23 @@ int RPROIPlugin::copyFromHost(char* dstHostBuffer, const void* source, int count
     return count * sizeof(float);
 }
 
-bool RPROIPlugin::supportsFormat(DataType type, PluginFormat format) const
+bool RPROIPlugin::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    ASSERT(nbInputs == 4 && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    // The feature map can stay in the FP16 layouts of the backbone, the pooled feature map follows it for the
+    // classifier. The scores, deltas, image info and rois are FP32 linear.
+    const PluginTensorDesc& desc = inOut[pos];
+    if (pos == 2)
+    {
+        return (desc.type == DataType::kFLOAT && desc.format == TensorFormat::kLINEAR)
+            || (desc.type == DataType::kHALF
+                   && (desc.format == TensorFormat::kLINEAR || desc.format == TensorFormat::kHWC8));
+    }
+    if (pos == nbInputs + 1)
+    {
+        return desc.type == inOut[2].type && desc.format == inOut[2].format;
+    }
+    return desc.type == DataType::kFLOAT && desc.format == TensorFormat::kLINEAR;
 }
 
 const char* RPROIPlugin::getPluginType() const
@@ -234,7 +374,9 @@ void RPROIPlugin::destroy()
 
 IPluginV2Ext* RPROIPlugin::clone() const
 {
-    IPluginV2Ext* plugin = new RPROIPlugin(params, anchorsRatiosHost, anchorsScalesHost, A, C, H, W, anchorsDev);
+    auto* plugin = new RPROIPlugin(params, anchorsRatiosHost, anchorsScalesHost, A, C, H, W, anchorsDev);
+    plugin->mFeatureType = mFeatureType;
+    plugin->mFeatureFormat = mFeatureFormat;
     plugin->setPluginNamespace(mPluginNamespace);
     return plugin;
 }
@@ -253,9 +395,9 @@ const char* RPROIPlugin::getPluginNamespace() const
 // Return the DataType of the plugin output at the requested index.
 DataType RPROIPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
-    // Two outputs
+    // Two outputs, the pooled feature map has the type of the feature map
     ASSERT(index == 0 || index == 1);
-    return DataType::kFLOAT;
+    return index == 1 ? inputTypes[2] : DataType::kFLOAT;
 }
 // Return true if output tensor is broadcast across a batch.
 bool RPROIPlugin::isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
@@ -269,34 +411,29 @@ bool RPROIPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
     return false;
 }
 
-// Configure the layer with input and output data types.
-// inutDims: input Dimensions for the plugin layer
-// nInputs : Number of inputs to the plugin layer
-// outputDims: output Dimensions from the plugin layer
-// nOutputs: number of outputs from the plugin layer
-// type: DataType configuration for the plugin layer
-// format: format NCHW, NHWC etc
-// maxbatchSize: maximum batch size for the plugin layer
-void RPROIPlugin::configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
-    const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
-    const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
+// Configure the layer with the descriptions of its inputs and outputs: scores, deltas, feature map and image
+// info, then rois and pooled feature map.
+void RPROIPlugin::configurePlugin(const PluginTensorDesc* in, int nbInputs, const PluginTensorDesc* out, int nbOutputs)
 {
-    ASSERT(*inputTypes == DataType::kFLOAT && floatFormat == PluginFormat::kNCHW);
+    ASSERT(nbInputs == 4);
+    ASSERT(in[0].type == DataType::kFLOAT && in[0].format == TensorFormat::kLINEAR);
+    mFeatureType = in[2].type;
+    mFeatureFormat = in[2].format;
 
     A = params.anchorsRatioCount * params.anchorsScaleCount;
-    C = inputDims[2].d[0];
-    H = inputDims[2].d[1];
-    W = inputDims[2].d[2];
+    C = in[2].dims.d[0];
+    H = in[2].dims.d[1];
+    W = in[2].dims.d[2];
 
-    ASSERT(nbInputs == 4);
-    ASSERT(inputDims[0].d[0] == (2 * A) && inputDims[1].d[0] == (4 * A));
-    ASSERT(inputDims[0].d[1] == inputDims[1].d[1] && inputDims[0].d[1] == inputDims[2].d[1]);
-    ASSERT(inputDims[0].d[2] == inputDims[1].d[2] && inputDims[0].d[2] == inputDims[2].d[2]);
-    ASSERT(nbOutputs == 2 && outputDims[0].nbDims == 3 // rois
-        && outputDims[1].nbDims == 4);                 // pooled feature map
-    ASSERT(outputDims[0].d[0] == 1 && outputDims[0].d[1] == params.nmsMaxOut && outputDims[0].d[2] == 4);
-    ASSERT(outputDims[1].d[0] == params.nmsMaxOut && outputDims[1].d[1] == C && outputDims[1].d[2] == params.poolingH
-        && outputDims[1].d[3] == params.poolingW);
+    ASSERT(in[0].dims.d[0] == (2 * A) && in[1].dims.d[0] == (4 * A));
+    ASSERT(in[0].dims.d[1] == in[1].dims.d[1] && in[0].dims.d[1] == in[2].dims.d[1]);
+    ASSERT(in[0].dims.d[2] == in[1].dims.d[2] && in[0].dims.d[2] == in[2].dims.d[2]);
+    ASSERT(nbOutputs == 2 && out[0].dims.nbDims == 3 // rois
+        && out[1].dims.nbDims == 4);                  // pooled feature map
+    ASSERT(out[0].dims.d[0] == 1 && out[0].dims.d[1] == params.nmsMaxOut && out[0].dims.d[2] == 4);
+    ASSERT(out[1].dims.d[0] == params.nmsMaxOut && out[1].dims.d[1] == C && out[1].dims.d[2] == params.poolingH
+        && out[1].dims.d[3] == params.poolingW);
+    ASSERT(out[1].type == mFeatureType && out[1].format == mFeatureFormat);
 }
 
 // Attach the plugin object to an execution context and grant the plugin the access to some context resource.
@@ -309,22 +446,7 @@ void RPROIPlugin::detachFromContext() {}
 
 RPROIPluginCreator::RPROIPluginCreator()
 {
-
-    mPluginAttributes.emplace_back(PluginField("poolingH", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("poolingW", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("featureStride", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("preNmsTop", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("nmsMaxOut", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("anchorsRatioCount", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("anchorsScaleCount", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("iouThreshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("minBoxSize", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("spatialScale", nullptr, PluginFieldType::kFLOAT32, 1));
-
-    // TODO Do we need to pass the size attribute here for float arrarys, we
-    // dont have that information at this point.
-    mPluginAttributes.emplace_back(PluginField("anchorsRatios", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("anchorsScales", nullptr, PluginFieldType::kFLOAT32, 1));
+    addRPROIFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -352,85 +474,9 @@ const PluginFieldCollection* RPROIPluginCreator::getFieldNames()
 
 IPluginV2Ext* RPROIPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    int nbFields = fc->nbFields;
-
-    for (int i = 0; i < nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "poolingH"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.poolingH = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "poolingW"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.poolingW = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "featureStride"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.featureStride = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "preNmsTop"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.preNmsTop = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "nmsMaxOut"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.nmsMaxOut = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "anchorsRatioCount"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.anchorsRatioCount = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "anchorsScaleCount"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.anchorsScaleCount = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "iouThreshold"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.iouThreshold = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        if (!strcmp(attrName, "minBoxSize"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.minBoxSize = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        if (!strcmp(attrName, "spatialScale"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.spatialScale = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        if (!strcmp(attrName, "anchorsRatios"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            anchorsRatios.reserve(params.anchorsRatioCount);
-            const float* ratios = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < params.anchorsRatioCount; ++j)
-            {
-                anchorsRatios.push_back(*ratios);
-                ratios++;
-            }
-        }
-        if (!strcmp(attrName, "anchorsScales"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            anchorsScales.reserve(params.anchorsScaleCount);
-            const float* scales = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < params.anchorsScaleCount; ++j)
-            {
-                anchorsScales.push_back(*scales);
-                scales++;
-            }
-        }
-    }
+    std::vector<float> anchorsRatios;
+    std::vector<float> anchorsScales;
+    RPROIParams params = parseRPROIFields(fc, anchorsRatios, anchorsScales);
 
     // This object will be deleted when the network is destroyed, which will
     // call RPROIPlugin::terminate()
@@ -447,3 +493,229 @@ IPluginV2Ext* RPROIPluginCreator::deserializePlugin(const char* name, const void
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
+
+RPROIDynamic::RPROIDynamic(RPROIParams params, const float* anchorsRatios, const float* anchorsScales)
+    : mParams(params)
+{
+    ASSERT(params.anchorsRatioCount > 0 && params.anchorsScaleCount > 0);
+    mAnchorsRatios.assign(anchorsRatios, anchorsRatios + params.anchorsRatioCount);
+    mAnchorsScales.assign(anchorsScales, anchorsScales + params.anchorsScaleCount);
+}
+
+RPROIDynamic::RPROIDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    ASSERT(length >= sizeof(RPROIParams));
+    mParams = read<RPROIParams>(d);
+    ASSERT(length
+        == sizeof(RPROIParams) + (mParams.anchorsRatioCount + mParams.anchorsScaleCount) * sizeof(float));
+    const float* ratios = reinterpret_cast<const float*>(d);
+    mAnchorsRatios.assign(ratios, ratios + mParams.anchorsRatioCount);
+    d += mParams.anchorsRatioCount * sizeof(float);
+    const float* scales = reinterpret_cast<const float*>(d);
+    mAnchorsScales.assign(scales, scales + mParams.anchorsScaleCount);
+    d += mParams.anchorsScaleCount * sizeof(float);
+    ASSERT(d == a + length);
+}
+
+int RPROIDynamic::getNbOutputs() const
+{
+    return 2;
+}
+
+DimsExprs RPROIDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex >= 0 && outputIndex < 2);
+    ASSERT(nbInputs == 4);
+    ASSERT(inputs[0].nbDims == 4 && inputs[1].nbDims == 4 && inputs[2].nbDims == 4);
+    DimsExprs output;
+    output.nbDims = 4;
+    if (outputIndex == 0) // rois
+    {
+        output.d[0] = inputs[0].d[0];
+        output.d[1] = exprBuilder.constant(1);
+        output.d[2] = exprBuilder.constant(mParams.nmsMaxOut);
+        output.d[3] = exprBuilder.constant(4);
+    }
+    else // pool5, the ROIs of all the images one after the other
+    {
+        const IDimensionExpr* nmsMaxOut = exprBuilder.constant(mParams.nmsMaxOut);
+        output.d[0] = exprBuilder.operation(DimensionOperation::kPROD, *inputs[0].d[0], *nmsMaxOut);
+        output.d[1] = inputs[2].d[1];
+        output.d[2] = exprBuilder.constant(mParams.poolingH);
+        output.d[3] = exprBuilder.constant(mParams.poolingW);
+    }
+    return output;
+}
+
+int RPROIDynamic::initialize()
+{
+    const int A = mParams.anchorsRatioCount * mParams.anchorsScaleCount;
+    CSC(cudaMalloc((void**) &mAnchorsDev, 4 * A * sizeof(float)), STATUS_FAILURE);
+    return generateAnchors(0, mParams.anchorsRatioCount, mAnchorsRatios.data(), mParams.anchorsScaleCount,
+        mAnchorsScales.data(), mParams.featureStride, mAnchorsDev);
+}
+
+void RPROIDynamic::terminate()
+{
+    CUASSERT(cudaFree(mAnchorsDev));
+    mAnchorsDev = nullptr;
+}
+
+size_t RPROIDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const int A = mParams.anchorsRatioCount * mParams.anchorsScaleCount;
+    const Dims& fmap = inputs[2].dims;
+    return RPROIInferenceFusedWorkspaceSize(fmap.d[0], A, fmap.d[2], fmap.d[3], mParams.preNmsTop, mParams.nmsMaxOut);
+}
+
+int RPROIDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    const Dims& fmap = inputDesc[2].dims;
+    const int A = mParams.anchorsRatioCount * mParams.anchorsScaleCount;
+    const DataType featureType = inputDesc[2].type;
+    const DLayout_t layout = inputDesc[2].format == TensorFormat::kHWC8 ? NHWC8 : NCHW;
+
+    pluginStatus_t status = RPROIInferenceFused(stream, fmap.d[0], A, fmap.d[1], fmap.d[2], fmap.d[3],
+        mParams.poolingH, mParams.poolingW, mParams.featureStride, mParams.preNmsTop, mParams.nmsMaxOut,
+        mParams.iouThreshold, mParams.minBoxSize, mParams.spatialScale, static_cast<const float*>(inputs[3]),
+        mAnchorsDev, DataType::kFLOAT, NCHW, inputs[0], DataType::kFLOAT, NCHW, inputs[1], featureType, layout,
+        inputs[2], workspace, DataType::kFLOAT, outputs[0], featureType, layout, outputs[1]);
+    ASSERT(status == STATUS_SUCCESS);
+    return status;
+}
+
+size_t RPROIDynamic::getSerializationSize() const
+{
+    // RPROIParams, then the ratios and scales, whose counts are in the parameters
+    return sizeof(RPROIParams) + (mAnchorsRatios.size() + mAnchorsScales.size()) * sizeof(float);
+}
+
+void RPROIDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mParams);
+    std::memcpy(d, mAnchorsRatios.data(), mAnchorsRatios.size() * sizeof(float));
+    d += mAnchorsRatios.size() * sizeof(float);
+    std::memcpy(d, mAnchorsScales.data(), mAnchorsScales.size() * sizeof(float));
+    d += mAnchorsScales.size() * sizeof(float);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void RPROIDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 4 && nbOutputs == 2);
+    const int A = mParams.anchorsRatioCount * mParams.anchorsScaleCount;
+    const Dims& scores = in[0].desc.dims;
+    const Dims& deltas = in[1].desc.dims;
+    ASSERT(scores.nbDims == 4 && deltas.nbDims == 4 && in[2].desc.dims.nbDims == 4);
+    // The channels are fixed by the anchors even when the batch size and the feature map size are not
+    ASSERT(scores.d[1] == -1 || scores.d[1] == 2 * A);
+    ASSERT(deltas.d[1] == -1 || deltas.d[1] == 4 * A);
+}
+
+bool RPROIDynamic::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 4 && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    // Same combinations as RPROIPlugin
+    const PluginTensorDesc& desc = inOut[pos];
+    if (pos == 2)
+    {
+        return (desc.type == DataType::kFLOAT && desc.format == TensorFormat::kLINEAR)
+            || (desc.type == DataType::kHALF
+                   && (desc.format == TensorFormat::kLINEAR || desc.format == TensorFormat::kHWC8));
+    }
+    if (pos == nbInputs + 1)
+    {
+        return desc.type == inOut[2].type && desc.format == inOut[2].format;
+    }
+    return desc.type == DataType::kFLOAT && desc.format == TensorFormat::kLINEAR;
+}
+
+const char* RPROIDynamic::getPluginType() const
+{
+    return RPROI_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* RPROIDynamic::getPluginVersion() const
+{
+    return RPROI_PLUGIN_VERSION;
+}
+
+void RPROIDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* RPROIDynamic::clone() const
+{
+    auto* plugin = new RPROIDynamic(*this);
+    plugin->mAnchorsDev = nullptr;
+    return plugin;
+}
+
+void RPROIDynamic::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* RPROIDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType RPROIDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0 || index == 1);
+    return index == 1 ? inputTypes[2] : DataType::kFLOAT;
+}
+
+RPROIDynamicPluginCreator::RPROIDynamicPluginCreator()
+{
+    addRPROIFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* RPROIDynamicPluginCreator::getPluginName() const
+{
+    return RPROI_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* RPROIDynamicPluginCreator::getPluginVersion() const
+{
+    return RPROI_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* RPROIDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* RPROIDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    std::vector<float> anchorsRatios;
+    std::vector<float> anchorsScales;
+    RPROIParams params = parseRPROIFields(fc, anchorsRatios, anchorsScales);
+    ASSERT(static_cast<int>(anchorsRatios.size()) == params.anchorsRatioCount
+        && static_cast<int>(anchorsScales.size()) == params.anchorsScaleCount);
+    auto* plugin = new RPROIDynamic(params, anchorsRatios.data(), anchorsScales.data());
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* RPROIDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    auto* plugin = new RPROIDynamic(serialData, serialLength);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
@@ -19,6 +19,7 @@
 #include "cudnn.h"
 #include "kernel.h"
 #include "plugin.h"
+#include <string>
 #include <vector>
 
 namespace nvinfer1
@@ -26,7 +27,7 @@ namespace nvinfer1
 namespace plugin
 {
 
-class RPROIPlugin : public IPluginV2Ext
+class RPROIPlugin : public IPluginV2IOExt
 {
 public:
     RPROIPlugin(RPROIParams params, const float* anchorsRatios, const float* anchorsScales);
@@ -55,8 +56,6 @@ public:
 
     void serialize(void* buffer) const override;
 
-    bool supportsFormat(DataType type, PluginFormat format) const override;
-
     const char* getPluginType() const override;
 
     const char* getPluginVersion() const override;
@@ -78,9 +77,9 @@ public:
     void attachToContext(
         cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override;
 
-    void configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
-        const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
-        const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize) override;
+    void configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
 
     void detachFromContext() override;
 
@@ -97,6 +96,68 @@ private:
     RPROIParams params;
     int A, C, H, W;
     float *anchorsRatiosHost{nullptr}, *anchorsScalesHost{nullptr};
+    // Type and format of the feature map, shared by the pooled feature map
+    DataType mFeatureType{DataType::kFLOAT};
+    TensorFormat mFeatureFormat{TensorFormat::kLINEAR};
+};
+
+// Explicit batch version of RPROIPlugin. The inputs are scores [N, 2A, H, W], deltas [N, 4A, H, W], the feature map
+// [N, C, H, W] and the image info [N, 1, 1, 3]. The outputs are the rois [N, 1, nmsMaxOut, 4] and the pooled feature
+// map [N * nmsMaxOut, C, poolingH, poolingW], which has the memory layout of the implicit batch output.
+class RPROIDynamic : public IPluginV2DynamicExt
+{
+public:
+    RPROIDynamic(RPROIParams params, const float* anchorsRatios, const float* anchorsScales);
+
+    RPROIDynamic(const void* data, size_t length);
+
+    ~RPROIDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    RPROIParams mParams;
+    std::vector<float> mAnchorsRatios;
+    std::vector<float> mAnchorsScales;
+    // Generated by initialize(), not serialized
+    float* mAnchorsDev{nullptr};
+    std::string mNamespace;
 };
 
 class RPROIPluginCreator : public BaseCreator
@@ -118,9 +179,29 @@ public:
 
 private:
     static PluginFieldCollection mFC;
-    RPROIParams params;
-    std::vector<float> anchorsRatios;
-    std::vector<float> anchorsScales;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as RPROI_TRT
+class RPROIDynamicPluginCreator : public BaseCreator
+{
+public:
+    RPROIDynamicPluginCreator();
+
+    ~RPROIDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
 };
 
@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 #include "priorBoxPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <cublas_v2.h>
@@ -24,36 +28,25 @@
 
 using namespace nvinfer1;
 using nvinfer1::plugin::PriorBox;
+using nvinfer1::plugin::PriorBoxDynamic;
+using nvinfer1::plugin::PriorBoxDynamicPluginCreator;
 using nvinfer1::plugin::PriorBoxPluginCreator;
 
 namespace
 {
 const char* PRIOR_BOX_PLUGIN_VERSION{"1"};
 const char* PRIOR_BOX_PLUGIN_NAME{"PriorBox_TRT"};
-} // namespace
-
-PluginFieldCollection PriorBoxPluginCreator::mFC{};
-std::vector<PluginField> PriorBoxPluginCreator::mPluginAttributes;
+const char* PRIOR_BOX_DYNAMIC_PLUGIN_NAME{"PriorBoxDynamic_TRT"};
 
-// Constructor
-PriorBox::PriorBox(PriorBoxParameters param)
-    : mParam(param)
+// Aspect ratio of 1.0 is built in, duplicated aspect ratios from the input are dropped and the reciprocals are added
+// when flip is set
+std::vector<float> expandAspectRatios(const PriorBoxParameters& param)
 {
-    // minSize is required and needs to be non-negative
-    ASSERT(param.numMinSize > 0 && param.minSize != nullptr);
-    for (int i = 0; i < param.numMinSize; ++i)
-    {
-        ASSERT(param.minSize[i] > 0 && "minSize must be positive");
-    }
-    minSize = copyToDevice(param.minSize, param.numMinSize);
-    ASSERT(param.numAspectRatios >= 0 && param.aspectRatios != nullptr);
-    // Aspect ratio of 1.0 is built in.
     std::vector<float> tmpAR(1, 1);
     for (int i = 0; i < param.numAspectRatios; ++i)
     {
         float ar = param.aspectRatios[i];
         bool alreadyExist = false;
-        // Prevent duplicated aspect ratios from input
         for (unsigned j = 0; j < tmpAR.size(); ++j)
         {
             if (std::fabs(ar - tmpAR[j]) < 1e-6)
@@ -71,6 +64,174 @@ PriorBox::PriorBox(PriorBoxParameters param)
             }
         }
     }
+    return tmpAR;
+}
+
+float* copyToDevice(const std::vector<float>& values)
+{
+    if (values.empty())
+    {
+        return nullptr;
+    }
+    float* deviceData = nullptr;
+    CUASSERT(cudaMalloc(&deviceData, values.size() * sizeof(float)));
+    CUASSERT(cudaMemcpy(deviceData, values.data(), values.size() * sizeof(float), cudaMemcpyHostToDevice));
+    return deviceData;
+}
+
+void writeVector(char*& d, const std::vector<float>& values)
+{
+    write(d, static_cast<int>(values.size()));
+    std::memcpy(d, values.data(), values.size() * sizeof(float));
+    d += values.size() * sizeof(float);
+}
+
+std::vector<float> readVector(const char*& d)
+{
+    int count = read<int>(d);
+    std::vector<float> values(count);
+    std::memcpy(values.data(), d, count * sizeof(float));
+    d += count * sizeof(float);
+    return values;
+}
+
+void addPriorBoxFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("minSize", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("maxSize", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("aspectRatios", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("flip", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("clip", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("variance", nullptr, PluginFieldType::kFLOAT32, 4));
+    attributes.emplace_back(PluginField("imgH", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("imgW", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("stepH", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("stepW", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("offset", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+// The arrays of the parameters are allocated in allocs, which the creator frees when it is destroyed
+PriorBoxParameters parsePriorBoxFields(const PluginFieldCollection* fc, std::vector<void*>& allocs)
+{
+    const auto allocFloats = [&allocs](int size) {
+        allocs.push_back(malloc(sizeof(float) * size));
+        return static_cast<float*>(allocs.back());
+    };
+    const PluginField* fields = fc->fields;
+
+    PriorBoxParameters params;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "minSize"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            params.minSize = allocFloats(size);
+            const auto* minS = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                params.minSize[j] = *minS;
+                minS++;
+            }
+            params.numMinSize = size;
+        }
+        else if (!strcmp(attrName, "maxSize"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            params.maxSize = allocFloats(size);
+            const auto* maxS = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                params.maxSize[j] = *maxS;
+                maxS++;
+            }
+            params.numMaxSize = size;
+        }
+        else if (!strcmp(attrName, "aspectRatios"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            params.aspectRatios = allocFloats(size);
+            const auto* aR = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                params.aspectRatios[j] = *aR;
+                aR++;
+            }
+            params.numAspectRatios = size;
+        }
+        else if (!strcmp(attrName, "variance"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            int size = fields[i].length;
+            const auto* lVar = static_cast<const float*>(fields[i].data);
+            for (int j = 0; j < size; j++)
+            {
+                params.variance[j] = (*lVar);
+                lVar++;
+            }
+        }
+        else if (!strcmp(attrName, "flip"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.flip = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "clip"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.clip = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "imgH"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.imgH = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "imgW"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.imgW = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "stepH"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.stepH = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "stepW"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.stepW = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "offset"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            params.offset = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+    }
+    return params;
+}
+} // namespace
+
+PluginFieldCollection PriorBoxPluginCreator::mFC{};
+std::vector<PluginField> PriorBoxPluginCreator::mPluginAttributes;
+PluginFieldCollection PriorBoxDynamicPluginCreator::mFC{};
+std::vector<PluginField> PriorBoxDynamicPluginCreator::mPluginAttributes;
+
+// Constructor
+PriorBox::PriorBox(PriorBoxParameters param)
+    : mParam(param)
+{
+    // minSize is required and needs to be non-negative
+    ASSERT(param.numMinSize > 0 && param.minSize != nullptr);
+    for (int i = 0; i < param.numMinSize; ++i)
+    {
+        ASSERT(param.minSize[i] > 0 && "minSize must be positive");
+    }
+    minSize = copyToDevice(param.minSize, param.numMinSize);
+    ASSERT(param.numAspectRatios >= 0 && param.aspectRatios != nullptr);
+    // Aspect ratio of 1.0 is built in.
+    std::vector<float> tmpAR = expandAspectRatios(param);
     /*
      * aspectRatios is of type nvinfer1::Weights
      * https://docs.nvidia.com/deeplearning/sdk/tensorrt-api/c_api/classnvinfer1_1_1_weights.html
@@ -114,28 +275,7 @@ PriorBox::PriorBox(PriorBoxParameters param, int H, int W)
     }
     minSize = copyToDevice(param.minSize, param.numMinSize);
     ASSERT(param.numAspectRatios >= 0 && param.aspectRatios != nullptr);
-    std::vector<float> tmpAR(1, 1);
-    for (int i = 0; i < param.numAspectRatios; ++i)
-    {
-        float ar = param.aspectRatios[i];
-        bool alreadyExist = false;
-        for (unsigned j = 0; j < tmpAR.size(); ++j)
-        {
-            if (std::fabs(ar - tmpAR[j]) < 1e-6)
-            {
-                alreadyExist = true;
-                break;
-            }
-        }
-        if (!alreadyExist)
-        {
-            tmpAR.push_back(ar);
-            if (param.flip)
-            {
-                tmpAR.push_back(1.0F / ar);
-            }
-        }
-    }
+    std::vector<float> tmpAR = expandAspectRatios(param);
     aspectRatios = copyToDevice(&tmpAR[0], tmpAR.size());
     numPriors = tmpAR.size() * param.numMinSize;
     if (param.numMaxSize > 0)
@@ -191,11 +331,18 @@ Dims PriorBox::getOutputDimensions(int index, const Dims* inputs, int nbInputDim
 
 int PriorBox::initialize()
 {
+    CUASSERT(cudaMalloc(&mPriors, 2 * H * W * numPriors * 4 * sizeof(float)));
+    pluginStatus_t status = priorBoxInference(0, mParam, H, W, numPriors, aspectRatios.count, minSize.values,
+        maxSize.values, aspectRatios.values, mPriors);
+    ASSERT(status == STATUS_SUCCESS);
+    CUASSERT(cudaStreamSynchronize(0));
     return STATUS_SUCCESS;
 }
 
 void PriorBox::terminate()
 {
+    CUASSERT(cudaFree(mPriors));
+    mPriors = nullptr;
     CUASSERT(cudaFree(const_cast<void*>(minSize.values)));
     if (mParam.numMaxSize > 0)
     {
@@ -215,11 +362,12 @@ size_t PriorBox::getWorkspaceSize(int /*maxBatchSize*/) const
 int PriorBox::enqueue(
     int /*batchSize*/, const void* const* /*inputs*/, void** outputs, void* /*workspace*/, cudaStream_t stream)
 {
-    void* outputData = outputs[0];
-    pluginStatus_t status = priorBoxInference(stream, mParam, H, W, numPriors, aspectRatios.count, minSize.values,
-        maxSize.values, aspectRatios.values, outputData);
-    ASSERT(status == STATUS_SUCCESS);
-
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    CSC(cudaMemcpyAsync(outputs[0], mPriors, 2 * H * W * numPriors * 4 * sizeof(float), cudaMemcpyDeviceToDevice,
+            stream),
+        STATUS_FAILURE);
     return 0;
 }
 
@@ -360,17 +508,7 @@ void PriorBox::detachFromContext() {}
 
 PriorBoxPluginCreator::PriorBoxPluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("minSize", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("maxSize", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("aspectRatios", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("flip", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("clip", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("variance", nullptr, PluginFieldType::kFLOAT32, 4));
-    mPluginAttributes.emplace_back(PluginField("imgH", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("imgW", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("stepH", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("stepW", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("offset", nullptr, PluginFieldType::kFLOAT32, 1));
+    addPriorBoxFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -402,109 +540,283 @@ const PluginFieldCollection* PriorBoxPluginCreator::getFieldNames()
 
 IPluginV2Ext* PriorBoxPluginCreator::createPlugin(const char* /*name*/, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
+    PriorBox* obj = new PriorBox(parsePriorBoxFields(fc, mTmpAllocs));
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
 
-    PriorBoxParameters params;
-    for (int i = 0; i < fc->nbFields; ++i)
+IPluginV2Ext* PriorBoxPluginCreator::deserializePlugin(
+    const char* /*name*/, const void* serialData, size_t serialLength)
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call PriorBox::destroy()
+    PriorBox* obj = new PriorBox(serialData, serialLength);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
+
+PriorBoxDynamic::PriorBoxDynamic(PriorBoxParameters param)
+    : mParam(param)
+{
+    ASSERT(param.numMinSize > 0 && param.minSize != nullptr);
+    for (int i = 0; i < param.numMinSize; ++i)
     {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "minSize"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            params.minSize = allocMemory<float>(size);
-            const auto* minS = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                params.minSize[j] = *minS;
-                minS++;
-            }
-            params.numMinSize = size;
-        }
-        else if (!strcmp(attrName, "maxSize"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            params.maxSize = allocMemory<float>(size);
-            const auto* maxS = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                params.maxSize[j] = *maxS;
-                maxS++;
-            }
-            params.numMaxSize = size;
-        }
-        else if (!strcmp(attrName, "aspectRatios"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            params.aspectRatios = allocMemory<float>(size);
-            const auto* aR = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                params.aspectRatios[j] = *aR;
-                aR++;
-            }
-            params.numAspectRatios = size;
-        }
-        else if (!strcmp(attrName, "variance"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            int size = fields[i].length;
-            const auto* lVar = static_cast<const float*>(fields[i].data);
-            for (int j = 0; j < size; j++)
-            {
-                params.variance[j] = (*lVar);
-                lVar++;
-            }
-        }
-        else if (!strcmp(attrName, "flip"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.flip = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "clip"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.clip = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "imgH"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.imgH = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "imgW"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.imgW = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "stepH"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.stepH = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
-        }
-        else if (!strcmp(attrName, "stepW"))
+        ASSERT(param.minSize[i] > 0 && "minSize must be positive");
+    }
+    mMinSize.assign(param.minSize, param.minSize + param.numMinSize);
+    ASSERT(param.numAspectRatios >= 0 && param.aspectRatios != nullptr);
+    mAspectRatios = expandAspectRatios(param);
+    mNumPriors = mAspectRatios.size() * param.numMinSize;
+    if (param.numMaxSize > 0)
+    {
+        ASSERT(param.numMinSize == param.numMaxSize && param.maxSize != nullptr);
+        for (int i = 0; i < param.numMaxSize; ++i)
         {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.stepW = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+            ASSERT(param.maxSize[i] > param.minSize[i] && "maxSize must be greater than minSize");
         }
-        else if (!strcmp(attrName, "offset"))
+        mMaxSize.assign(param.maxSize, param.maxSize + param.numMaxSize);
+        mNumPriors += param.numMaxSize;
+    }
+    mParam.minSize = mParam.maxSize = mParam.aspectRatios = nullptr;
+}
+
+PriorBoxDynamic::PriorBoxDynamic(const void* buffer, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(buffer), *a = d;
+    mParam = read<PriorBoxParameters>(d);
+    mNumPriors = read<int>(d);
+    mMinSize = readVector(d);
+    mMaxSize = readVector(d);
+    mAspectRatios = readVector(d);
+    mParam.minSize = mParam.maxSize = mParam.aspectRatios = nullptr;
+    ASSERT(d == a + length);
+}
+
+int PriorBoxDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs PriorBoxDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(outputIndex == 0);
+    ASSERT(inputs[0].nbDims == 4);
+    // The first channel is for prior box coordinates, the second one for the variances
+    DimsExprs output;
+    output.nbDims = 4;
+    output.d[0] = exprBuilder.constant(1);
+    output.d[1] = exprBuilder.constant(2);
+    const IDimensionExpr* area = exprBuilder.operation(DimensionOperation::kPROD, *inputs[0].d[2], *inputs[0].d[3]);
+    output.d[2] = exprBuilder.operation(DimensionOperation::kPROD, *area, *exprBuilder.constant(mNumPriors * 4));
+    output.d[3] = exprBuilder.constant(1);
+    return output;
+}
+
+int PriorBoxDynamic::initialize()
+{
+    mDeviceMinSize = copyToDevice(mMinSize);
+    mDeviceMaxSize = copyToDevice(mMaxSize);
+    mDeviceAspectRatios = copyToDevice(mAspectRatios);
+    return STATUS_SUCCESS;
+}
+
+void PriorBoxDynamic::terminate()
+{
+    CUASSERT(cudaFree(mDeviceMinSize));
+    CUASSERT(cudaFree(mDeviceMaxSize));
+    CUASSERT(cudaFree(mDeviceAspectRatios));
+    CUASSERT(cudaFree(mPriors));
+    mDeviceMinSize = mDeviceMaxSize = mDeviceAspectRatios = mPriors = nullptr;
+    mPriorsCapacity = 0;
+    std::fill(mPriorsShape, mPriorsShape + 4, 0);
+}
+
+size_t PriorBoxDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return 0;
+}
+
+int PriorBoxDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    const int H = inputDesc[0].dims.d[2];
+    const int W = inputDesc[0].dims.d[3];
+    const size_t size = 2 * H * W * mNumPriors * 4 * sizeof(float);
+    const int shape[4] = {H, W, inputDesc[1].dims.d[2], inputDesc[1].dims.d[3]};
+    if (mPriors != nullptr && std::equal(shape, shape + 4, mPriorsShape))
+    {
+        CSC(cudaMemcpyAsync(outputs[0], mPriors, size, cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
+        return 0;
+    }
+
+    PriorBoxParameters param = mParam;
+    if (param.imgH == 0 || param.imgW == 0)
+    {
+        param.imgH = inputDesc[1].dims.d[2];
+        param.imgW = inputDesc[1].dims.d[3];
+    }
+    if (param.stepH == 0 || param.stepW == 0)
+    {
+        param.stepH = static_cast<float>(param.imgH) / H;
+        param.stepW = static_cast<float>(param.imgW) / W;
+    }
+    pluginStatus_t status = priorBoxInference(stream, param, H, W, mNumPriors, mAspectRatios.size(), mDeviceMinSize,
+        mDeviceMaxSize, mDeviceAspectRatios, outputs[0]);
+    ASSERT(status == STATUS_SUCCESS);
+
+    // Keep a copy for the following calls with the same shapes when the cache is large enough
+    if (size <= mPriorsCapacity)
+    {
+        CSC(cudaMemcpyAsync(mPriors, outputs[0], size, cudaMemcpyDeviceToDevice, stream), STATUS_FAILURE);
+        std::copy(shape, shape + 4, mPriorsShape);
+    }
+    return 0;
+}
+
+size_t PriorBoxDynamic::getSerializationSize() const
+{
+    // PriorBoxParameters, numPriors, then the count and values of minSize, maxSize and aspectRatios
+    return sizeof(PriorBoxParameters) + sizeof(int) * 4
+        + sizeof(float) * (mMinSize.size() + mMaxSize.size() + mAspectRatios.size());
+}
+
+void PriorBoxDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mParam);
+    write(d, mNumPriors);
+    writeVector(d, mMinSize);
+    writeVector(d, mMaxSize);
+    writeVector(d, mAspectRatios);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void PriorBoxDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 4);
+    ASSERT(in[1].desc.dims.nbDims == 4);
+    ASSERT(out[0].desc.dims.nbDims == 4);
+
+    // Size the prior cache for the largest feature map of the profile, so enqueue() never allocates
+    if (in[0].max.d[2] > 0 && in[0].max.d[3] > 0)
+    {
+        const size_t capacity = 2 * in[0].max.d[2] * in[0].max.d[3] * mNumPriors * 4 * sizeof(float);
+        if (capacity > mPriorsCapacity)
         {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            params.offset = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+            CUASSERT(cudaFree(mPriors));
+            CUASSERT(cudaMalloc(&mPriors, capacity));
+            mPriorsCapacity = capacity;
         }
     }
-    PriorBox* obj = new PriorBox(params);
+    std::fill(mPriorsShape, mPriorsShape + 4, 0);
+}
+
+bool PriorBoxDynamic::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 2 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    // Only the shapes of the inputs are used, so their type does not matter as long as it is a float type
+    if (pos < nbInputs)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    return inOut[pos].type == DataType::kFLOAT;
+}
+
+const char* PriorBoxDynamic::getPluginType() const
+{
+    return PRIOR_BOX_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* PriorBoxDynamic::getPluginVersion() const
+{
+    return PRIOR_BOX_PLUGIN_VERSION;
+}
+
+void PriorBoxDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* PriorBoxDynamic::clone() const
+{
+    auto* plugin = new PriorBoxDynamic(*this);
+    plugin->mDeviceMinSize = plugin->mDeviceMaxSize = plugin->mDeviceAspectRatios = plugin->mPriors = nullptr;
+    plugin->mPriorsCapacity = 0;
+    std::fill(plugin->mPriorsShape, plugin->mPriorsShape + 4, 0);
+    return plugin;
+}
+
+void PriorBoxDynamic::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* PriorBoxDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType PriorBoxDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return DataType::kFLOAT;
+}
+
+PriorBoxDynamicPluginCreator::PriorBoxDynamicPluginCreator()
+{
+    addPriorBoxFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+PriorBoxDynamicPluginCreator::~PriorBoxDynamicPluginCreator()
+{
+    for (auto v : mTmpAllocs)
+    {
+        free(v);
+    }
+}
+
+const char* PriorBoxDynamicPluginCreator::getPluginName() const
+{
+    return PRIOR_BOX_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* PriorBoxDynamicPluginCreator::getPluginVersion() const
+{
+    return PRIOR_BOX_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* PriorBoxDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* PriorBoxDynamicPluginCreator::createPlugin(const char* /*name*/, const PluginFieldCollection* fc)
+{
+    auto* obj = new PriorBoxDynamic(parsePriorBoxFields(fc, mTmpAllocs));
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
 
-IPluginV2Ext* PriorBoxPluginCreator::deserializePlugin(
+IPluginV2DynamicExt* PriorBoxDynamicPluginCreator::deserializePlugin(
     const char* /*name*/, const void* serialData, size_t serialLength)
 {
-    // This object will be deleted when the network is destroyed, which will
-    // call PriorBox::destroy()
-    PriorBox* obj = new PriorBox(serialData, serialLength);
+    auto* obj = new PriorBoxDynamic(serialData, serialLength);
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
@@ -93,9 +93,75 @@ private:
     PriorBoxParameters mParam;
     int numPriors, H, W;
     Weights minSize, maxSize, aspectRatios; // not learnable weights
+    // H and W are fixed once configured, so the priors are generated once by initialize() and copied by enqueue()
+    void* mPriors{nullptr};
     const char* mPluginNamespace;
 };
 
+// Explicit batch version of PriorBox. The inputs are the [N, C, H, W] feature map and the [N, C, imgH, imgW] image,
+// the output is [1, 2, H * W * numPriors * 4, 1] and is recomputed for the shapes seen at enqueue time.
+class PriorBoxDynamic : public IPluginV2DynamicExt
+{
+public:
+    PriorBoxDynamic(PriorBoxParameters param);
+
+    PriorBoxDynamic(const void* buffer, size_t length);
+
+    ~PriorBoxDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    // The pointers in mParam are not used, the sizes and aspect ratios live in the host vectors below
+    PriorBoxParameters mParam;
+    int mNumPriors{};
+    std::vector<float> mMinSize, mMaxSize, mAspectRatios;
+    float* mDeviceMinSize{};
+    float* mDeviceMaxSize{};
+    float* mDeviceAspectRatios{};
+    // Priors of the last shape seen by enqueue(), regenerated only when the shape changes
+    float* mPriors{};
+    size_t mPriorsCapacity{};
+    int mPriorsShape[4]{};
+    std::string mNamespace;
+};
+
 class PriorBoxPluginCreator : public BaseCreator
 {
 public:
@@ -114,14 +180,28 @@ public:
     IPluginV2Ext* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
 
 private:
-    template <typename T>
-    T* allocMemory(int size = 1)
-    {
-        mTmpAllocs.reserve(mTmpAllocs.size() + 1);
-        T* tmpMem = static_cast<T*>(malloc(sizeof(T) * size));
-        mTmpAllocs.push_back(tmpMem);
-        return tmpMem;
-    }
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+    std::vector<void*> mTmpAllocs;
+};
+
+// Takes the same fields as PriorBox_TRT
+class PriorBoxDynamicPluginCreator : public BaseCreator
+{
+public:
+    PriorBoxDynamicPluginCreator();
+
+    ~PriorBoxDynamicPluginCreator() override;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
 
 private:
     static PluginFieldCollection mFC;
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "proposalLayerPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "mrcnn_config.h"
 #include "plugin.h"
 #include <cuda_runtime_api.h>
@@ -23,23 +26,121 @@
 using namespace nvinfer1;
 using namespace plugin;
 using nvinfer1::plugin::ProposalLayer;
+using nvinfer1::plugin::ProposalLayerDynamic;
+using nvinfer1::plugin::ProposalLayerDynamicPluginCreator;
 using nvinfer1::plugin::ProposalLayerPluginCreator;
 
 namespace
 {
 const char* PROPOSALLAYER_PLUGIN_VERSION{"1"};
 const char* PROPOSALLAYER_PLUGIN_NAME{"ProposalLayer_TRT"};
+const char* PROPOSALLAYER_DYNAMIC_PLUGIN_NAME{"ProposalLayerDynamic_TRT"};
+
+struct ProposalLayerFields
+{
+    int preNMSTopK;
+    int keepTopK;
+    float iouThreshold;
+    nvinfer1::DimsHW imageSize;
+    std::vector<float> anchorScales;
+};
+
+void addProposalLayerFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("prenms_topk", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("keep_topk", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("image_size", nullptr, PluginFieldType::kINT32, 2));
+    attributes.emplace_back(PluginField(
+        "anchor_scales", nullptr, PluginFieldType::kFLOAT32, MaskRCNNConfig::RPN_ANCHOR_SCALES.size()));
+}
+
+ProposalLayerFields parseProposalLayerFields(const PluginFieldCollection* fc)
+{
+    ProposalLayerFields parsed{};
+    // The image size and the anchor scales of MaskRCNNConfig unless they are given
+    parsed.imageSize = DimsHW(MaskRCNNConfig::IMAGE_SHAPE.h(), MaskRCNNConfig::IMAGE_SHAPE.w());
+    parsed.anchorScales = MaskRCNNConfig::RPN_ANCHOR_SCALES;
+
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "prenms_topk"))
+        {
+            assert(fields[i].type == PluginFieldType::kINT32);
+            parsed.preNMSTopK = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "keep_topk"))
+        {
+            assert(fields[i].type == PluginFieldType::kINT32);
+            parsed.keepTopK = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "iou_threshold"))
+        {
+            assert(fields[i].type == PluginFieldType::kFLOAT32);
+            parsed.iouThreshold = *(static_cast<const float*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "image_size"))
+        {
+            assert(fields[i].type == PluginFieldType::kINT32 && fields[i].length == 2);
+            const int* imageSize = static_cast<const int*>(fields[i].data);
+            parsed.imageSize = DimsHW(imageSize[0], imageSize[1]);
+        }
+        if (!strcmp(attrName, "anchor_scales"))
+        {
+            assert(fields[i].type == PluginFieldType::kFLOAT32);
+            const float* scales = static_cast<const float*>(fields[i].data);
+            parsed.anchorScales.assign(scales, scales + fields[i].length);
+        }
+    }
+    return parsed;
+}
+
+// Anchors of every pyramid level for an image of image_dims, with the coordinates normalized to the image
+void generatePyramidAnchors(
+    const nvinfer1::DimsHW& image_dims, const std::vector<float>& scales, std::vector<float>& anchors)
+{
+    const auto& ratios = MaskRCNNConfig::RPN_ANCHOR_RATIOS;
+    const auto& strides = MaskRCNNConfig::BACKBONE_STRIDES;
+    auto anchor_stride = MaskRCNNConfig::RPN_ANCHOR_STRIDE;
+
+    const float cy = image_dims.h() - 1;
+    const float cx = image_dims.w() - 1;
+
+    assert(anchors.size() == 0);
+
+    assert(scales.size() == strides.size());
+    for (size_t s = 0; s < scales.size(); ++s)
+    {
+        float scale = scales[s];
+        int stride = strides[s];
+
+        for (int y = 0; y < image_dims.h(); y += anchor_stride * stride)
+            for (int x = 0; x < image_dims.w(); x += anchor_stride * stride)
+                for (float r : ratios)
+                {
+                    float sqrt_r = sqrt(r);
+                    float h = scale / sqrt_r;
+                    float w = scale * sqrt_r;
+
+                    anchors.insert(anchors.end(),
+                        {(y - h / 2) / cy, (x - w / 2) / cx, (y + h / 2 - 1) / cy, (x + w / 2 - 1) / cx});
+                }
+    }
+
+    assert(anchors.size() % 4 == 0);
+}
 } // namespace
 
 PluginFieldCollection ProposalLayerPluginCreator::mFC{};
 std::vector<PluginField> ProposalLayerPluginCreator::mPluginAttributes;
+PluginFieldCollection ProposalLayerDynamicPluginCreator::mFC{};
+std::vector<PluginField> ProposalLayerDynamicPluginCreator::mPluginAttributes;
 
 ProposalLayerPluginCreator::ProposalLayerPluginCreator()
 {
-
-    mPluginAttributes.emplace_back(PluginField("prenms_topk", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("keep_topk", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    addProposalLayerFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -62,27 +163,9 @@ const PluginFieldCollection* ProposalLayerPluginCreator::getFieldNames()
 
 IPluginV2Ext* ProposalLayerPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "prenms_topk"))
-        {
-            assert(fields[i].type == PluginFieldType::kINT32);
-            mPreNMSTopK = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "keep_topk"))
-        {
-            assert(fields[i].type == PluginFieldType::kINT32);
-            mKeepTopK = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "iou_threshold"))
-        {
-            assert(fields[i].type == PluginFieldType::kFLOAT32);
-            mIOUThreshold = *(static_cast<const float*>(fields[i].data));
-        }
-    }
-    return new ProposalLayer(mPreNMSTopK, mKeepTopK, mIOUThreshold);
+    const ProposalLayerFields parsed = parseProposalLayerFields(fc);
+    return new ProposalLayer(
+        parsed.preNMSTopK, parsed.keepTopK, parsed.iouThreshold, parsed.imageSize, parsed.anchorScales);
 };
 
 IPluginV2Ext* ProposalLayerPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
@@ -90,15 +173,19 @@ IPluginV2Ext* ProposalLayerPluginCreator::deserializePlugin(const char* name, co
     return new ProposalLayer(data, length);
 };
 
-ProposalLayer::ProposalLayer(int prenms_topk, int keep_topk, float iou_threshold)
+ProposalLayer::ProposalLayer(int prenms_topk, int keep_topk, float iou_threshold, const nvinfer1::DimsHW& image_size,
+    const std::vector<float>& anchor_scales)
     : mPreNMSTopK(prenms_topk)
     , mKeepTopK(keep_topk)
     , mIOUThreshold(iou_threshold)
+    , mImageSize(image_size)
+    , mAnchorScales(anchor_scales)
 {
     mBackgroundLabel = -1;
     assert(mPreNMSTopK > 0);
     assert(mKeepTopK > 0);
     assert(iou_threshold > 0.0f);
+    assert(mImageSize.h() > 0 && mImageSize.w() > 0);
 
     mParam.backgroundLabelId = -1;
     mParam.numClasses = 1;
@@ -118,23 +205,11 @@ int ProposalLayer::getNbOutputs() const
 
 int ProposalLayer::initialize()
 {
-    // Init the mValidCnt of max batch size
-    std::vector<int> tempValidCnt(mMaxBatchSize, mPreNMSTopK);
-
-    mValidCnt = std::make_shared<CudaBind<int>>(mMaxBatchSize);
-
-    CUASSERT(cudaMemcpy(
-        mValidCnt->mPtr, static_cast<void*>(tempValidCnt.data()), sizeof(int) * mMaxBatchSize, cudaMemcpyHostToDevice));
-
-    // Init the anchors for batch size:
-    mAnchorBoxesDevice = std::make_shared<CudaBind<float>>(mAnchorsCnt * 4 * mMaxBatchSize);
-    int batch_offset = sizeof(float) * mAnchorsCnt * 4;
-    uint8_t* device_ptr = static_cast<uint8_t*>(mAnchorBoxesDevice->mPtr);
-    for (int i = 0; i < mMaxBatchSize; i++)
-    {
-        CUASSERT(cudaMemcpy(static_cast<void*>(device_ptr + i * batch_offset),
-            static_cast<void*>(mAnchorBoxesHost.data()), batch_offset, cudaMemcpyHostToDevice));
-    }
+    // A single copy of the anchors, the proposal kernels read it for every image of the batch
+    assert(mAnchorsCnt == (int) (mAnchorBoxesHost.size() / 4));
+    mAnchorBoxesDevice = std::make_shared<CudaBind<float>>(mAnchorsCnt * 4);
+    CUASSERT(cudaMemcpy(mAnchorBoxesDevice->mPtr, static_cast<const void*>(mAnchorBoxesHost.data()),
+        sizeof(float) * mAnchorsCnt * 4, cudaMemcpyHostToDevice));
 
     return 0;
 };
@@ -148,7 +223,7 @@ void ProposalLayer::destroy()
 
 bool ProposalLayer::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 };
 
 const char* ProposalLayer::getPluginType() const
@@ -178,7 +253,8 @@ const char* ProposalLayer::getPluginNamespace() const
 
 size_t ProposalLayer::getSerializationSize() const
 {
-    return sizeof(int) * 2 + sizeof(float) + sizeof(int) * 2;
+    return sizeof(int) * 2 + sizeof(float) + sizeof(int) * 2 + sizeof(DataType) + sizeof(int) * 3
+        + sizeof(float) * mAnchorScales.size();
 };
 
 void ProposalLayer::serialize(void* buffer) const
@@ -189,6 +265,14 @@ void ProposalLayer::serialize(void* buffer) const
     write(d, mIOUThreshold);
     write(d, mMaxBatchSize);
     write(d, mAnchorsCnt);
+    write(d, mType);
+    write(d, mImageSize.h());
+    write(d, mImageSize.w());
+    write(d, static_cast<int>(mAnchorScales.size()));
+    for (float scale : mAnchorScales)
+    {
+        write(d, scale);
+    }
     ASSERT(d == a + getSerializationSize());
 };
 
@@ -200,6 +284,25 @@ ProposalLayer::ProposalLayer(const void* data, size_t length)
     float iou_threshold = read<float>(d);
     mMaxBatchSize = read<int>(d);
     mAnchorsCnt = read<int>(d);
+    // Engines serialized before FP16 was supported are FP32
+    mType = DataType::kFLOAT;
+    if (d < a + length)
+    {
+        mType = read<DataType>(d);
+    }
+    // Absent from the engines serialized before the image size and the anchor scales were attributes
+    mImageSize = DimsHW(MaskRCNNConfig::IMAGE_SHAPE.h(), MaskRCNNConfig::IMAGE_SHAPE.w());
+    mAnchorScales = MaskRCNNConfig::RPN_ANCHOR_SCALES;
+    if (d < a + length)
+    {
+        mImageSize.h() = read<int>(d);
+        mImageSize.w() = read<int>(d);
+        mAnchorScales.resize(read<int>(d));
+        for (float& scale : mAnchorScales)
+        {
+            scale = read<float>(d);
+        }
+    }
     ASSERT(d == a + length);
 
     mBackgroundLabel = -1;
@@ -214,8 +317,6 @@ ProposalLayer::ProposalLayer(const void* data, size_t length)
     mParam.scoreThreshold = 0.0;
     mParam.iouThreshold = mIOUThreshold;
 
-    mType = DataType::kFLOAT;
-
     generate_pyramid_anchors();
 };
 
@@ -257,55 +358,24 @@ Dims ProposalLayer::getOutputDimensions(int index, const Dims* inputs, int nbInp
 
 void ProposalLayer::generate_pyramid_anchors()
 {
-    const auto image_dims = MaskRCNNConfig::IMAGE_SHAPE;
-
-    const auto& scales = MaskRCNNConfig::RPN_ANCHOR_SCALES;
-    const auto& ratios = MaskRCNNConfig::RPN_ANCHOR_RATIOS;
-    const auto& strides = MaskRCNNConfig::BACKBONE_STRIDES;
-    auto anchor_stride = MaskRCNNConfig::RPN_ANCHOR_STRIDE;
-
-    const float cy = image_dims.d[1] - 1;
-    const float cx = image_dims.d[2] - 1;
-
-    auto& anchors = mAnchorBoxesHost;
-    assert(anchors.size() == 0);
-
-    assert(scales.size() == strides.size());
-    for (size_t s = 0; s < scales.size(); ++s)
-    {
-        float scale = scales[s];
-        int stride = strides[s];
-
-        for (int y = 0; y < image_dims.d[1]; y += anchor_stride * stride)
-            for (int x = 0; x < image_dims.d[2]; x += anchor_stride * stride)
-                for (float r : ratios)
-                {
-                    float sqrt_r = sqrt(r);
-                    float h = scale / sqrt_r;
-                    float w = scale * sqrt_r;
-
-                    anchors.insert(anchors.end(),
-                        {(y - h / 2) / cy, (x - w / 2) / cx, (y + h / 2 - 1) / cy, (x + w / 2 - 1) / cx});
-                }
-    }
-
-    assert(anchors.size() % 4 == 0);
+    generatePyramidAnchors(mImageSize, mAnchorScales, mAnchorBoxesHost);
 }
 
 int ProposalLayer::enqueue(
     int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
 
     void* proposals = outputs[0];
 
     // proposal
     ProposalWorkSpace proposalWorkspace(batch_size, mAnchorsCnt, mPreNMSTopK, mParam, mType);
-    cudaError_t status = proposalRefineBatchClassNMS(stream, batch_size, mAnchorsCnt, mPreNMSTopK,
-        DataType::kFLOAT, // mType,
-        mParam, proposalWorkspace, workspace,
+    cudaError_t status = proposalRefineBatchClassNMS(stream, batch_size, mAnchorsCnt, mPreNMSTopK, mType, mParam,
+        proposalWorkspace, workspace,
         inputs[0], // inputs[object_score]
         inputs[1], // inputs[bbox_delta],
-        mValidCnt->mPtr,
         mAnchorBoxesDevice->mPtr, // inputs[anchors]
         proposals);
 
@@ -316,8 +386,8 @@ int ProposalLayer::enqueue(
 // Return the DataType of the plugin output at the requested index
 DataType ProposalLayer::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
-    // Only DataType::kFLOAT is acceptable by the plugin layer
-    return DataType::kFLOAT;
+    // The proposals have the type of the inputs
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -337,9 +407,12 @@ void ProposalLayer::configurePlugin(const Dims* inputDims, int nbInputs, const D
     const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
     const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
 {
+    assert(supportsFormat(inputTypes[0], floatFormat));
     check_valid_inputs(inputDims, nbInputs);
     assert(inputDims[0].d[0] == inputDims[1].d[0]);
 
+    mType = inputTypes[0];
+
     mAnchorsCnt = inputDims[0].d[0];
     assert(mAnchorsCnt == (int) (mAnchorBoxesHost.size() / 4));
     mMaxBatchSize = maxBatchSize;
@@ -353,3 +426,242 @@ void ProposalLayer::attachToContext(
 
 // Detach the plugin object from its execution context.
 void ProposalLayer::detachFromContext() {}
+
+ProposalLayerDynamic::ProposalLayerDynamic(int prenms_topk, int keep_topk, float iou_threshold,
+    const nvinfer1::DimsHW& image_size, const std::vector<float>& anchor_scales)
+    : mPreNMSTopK(prenms_topk)
+    , mKeepTopK(keep_topk)
+    , mIOUThreshold(iou_threshold)
+    , mImageSize(image_size)
+    , mAnchorScales(anchor_scales)
+{
+    ASSERT(mPreNMSTopK > 0);
+    ASSERT(mKeepTopK > 0);
+    ASSERT(mIOUThreshold > 0.0f);
+    ASSERT(mImageSize.h() > 0 && mImageSize.w() > 0);
+
+    mParam.backgroundLabelId = -1;
+    mParam.numClasses = 1;
+    mParam.keepTopK = mKeepTopK;
+    mParam.scoreThreshold = 0.0;
+    mParam.iouThreshold = mIOUThreshold;
+
+    generatePyramidAnchors(mImageSize, mAnchorScales, mAnchorBoxesHost);
+    mAnchorsCnt = static_cast<int>(mAnchorBoxesHost.size() / 4);
+}
+
+ProposalLayerDynamic::ProposalLayerDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mPreNMSTopK = read<int>(d);
+    mKeepTopK = read<int>(d);
+    mIOUThreshold = read<float>(d);
+    mImageSize.h() = read<int>(d);
+    mImageSize.w() = read<int>(d);
+    mAnchorScales.resize(read<int>(d));
+    for (float& scale : mAnchorScales)
+    {
+        scale = read<float>(d);
+    }
+    ASSERT(d == a + length);
+
+    mParam.backgroundLabelId = -1;
+    mParam.numClasses = 1;
+    mParam.keepTopK = mKeepTopK;
+    mParam.scoreThreshold = 0.0;
+    mParam.iouThreshold = mIOUThreshold;
+
+    generatePyramidAnchors(mImageSize, mAnchorScales, mAnchorBoxesHost);
+    mAnchorsCnt = static_cast<int>(mAnchorBoxesHost.size() / 4);
+}
+
+int ProposalLayerDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs ProposalLayerDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 2);
+
+    // [N, keep_topk, (y1, x1, y2, x2)]
+    DimsExprs proposals;
+    proposals.nbDims = 3;
+    proposals.d[0] = inputs[0].d[0];
+    proposals.d[1] = exprBuilder.constant(mKeepTopK);
+    proposals.d[2] = exprBuilder.constant(4);
+    return proposals;
+}
+
+int ProposalLayerDynamic::initialize()
+{
+    // A single copy of the anchors, the proposal kernels read it for every image of the batch
+    mAnchorBoxesDevice = std::make_shared<CudaBind<float>>(mAnchorsCnt * 4);
+    CUASSERT(cudaMemcpy(mAnchorBoxesDevice->mPtr, static_cast<const void*>(mAnchorBoxesHost.data()),
+        sizeof(float) * mAnchorsCnt * 4, cudaMemcpyHostToDevice));
+
+    return STATUS_SUCCESS;
+}
+
+void ProposalLayerDynamic::terminate()
+{
+    mAnchorBoxesDevice.reset();
+}
+
+size_t ProposalLayerDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    ProposalWorkSpace proposal(inputs[0].dims.d[0], mAnchorsCnt, mPreNMSTopK, mParam, inputs[0].type);
+    return proposal.totalSize;
+}
+
+int ProposalLayerDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const int batch = inputDesc[0].dims.d[0];
+    const DataType type = inputDesc[0].type;
+
+    // proposal
+    ProposalWorkSpace proposalWorkspace(batch, mAnchorsCnt, mPreNMSTopK, mParam, type);
+    cudaError_t status = proposalRefineBatchClassNMS(stream, batch, mAnchorsCnt, mPreNMSTopK, type, mParam,
+        proposalWorkspace, workspace,
+        inputs[0],                // inputs[object_score]
+        inputs[1],                // inputs[bbox_delta],
+        mAnchorBoxesDevice->mPtr, // inputs[anchors]
+        outputs[0]);
+
+    ASSERT(status == cudaSuccess);
+    return status;
+}
+
+size_t ProposalLayerDynamic::getSerializationSize() const
+{
+    return sizeof(int) * 2 + sizeof(float) + sizeof(int) * 3 + sizeof(float) * mAnchorScales.size();
+}
+
+void ProposalLayerDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mPreNMSTopK);
+    write(d, mKeepTopK);
+    write(d, mIOUThreshold);
+    write(d, mImageSize.h());
+    write(d, mImageSize.w());
+    write(d, static_cast<int>(mAnchorScales.size()));
+    for (float scale : mAnchorScales)
+    {
+        write(d, scale);
+    }
+    ASSERT(d == a + getSerializationSize());
+}
+
+void ProposalLayerDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(nbOutputs == 1);
+    // object_score[N, anchors, 2, 1],
+    // foreground_delta[N, anchors, 4, 1],
+    // anchors should be generated inside
+    ASSERT(in[0].desc.dims.nbDims == 4 && in[0].desc.dims.d[2] == 2);
+    ASSERT(in[1].desc.dims.nbDims == 4 && in[1].desc.dims.d[2] == 4);
+    ASSERT(in[0].desc.dims.d[1] == mAnchorsCnt && in[1].desc.dims.d[1] == mAnchorsCnt);
+}
+
+bool ProposalLayerDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 2 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    // The proposals have the type of the inputs
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* ProposalLayerDynamic::getPluginType() const
+{
+    return PROPOSALLAYER_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* ProposalLayerDynamic::getPluginVersion() const
+{
+    return PROPOSALLAYER_PLUGIN_VERSION;
+}
+
+void ProposalLayerDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* ProposalLayerDynamic::clone() const
+{
+    return new ProposalLayerDynamic(*this);
+}
+
+void ProposalLayerDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* ProposalLayerDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType ProposalLayerDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+ProposalLayerDynamicPluginCreator::ProposalLayerDynamicPluginCreator()
+{
+    addProposalLayerFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* ProposalLayerDynamicPluginCreator::getPluginName() const
+{
+    return PROPOSALLAYER_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* ProposalLayerDynamicPluginCreator::getPluginVersion() const
+{
+    return PROPOSALLAYER_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* ProposalLayerDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* ProposalLayerDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    const ProposalLayerFields parsed = parseProposalLayerFields(fc);
+    auto* plugin = new ProposalLayerDynamic(
+        parsed.preNMSTopK, parsed.keepTopK, parsed.iouThreshold, parsed.imageSize, parsed.anchorScales);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* ProposalLayerDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new ProposalLayerDynamic(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
@@ -34,7 +34,8 @@ namespace plugin
 class ProposalLayer : public IPluginV2Ext
 {
 public:
-    ProposalLayer(int prenms_topk, int keep_topk, float iou_threshold);
+    ProposalLayer(int prenms_topk, int keep_topk, float iou_threshold, const nvinfer1::DimsHW& image_size,
+        const std::vector<float>& anchor_scales);
 
     ProposalLayer(const void* data, size_t length);
 
@@ -101,9 +102,10 @@ private:
 
     int mMaxBatchSize;
     int mAnchorsCnt;
-    std::shared_ptr<CudaBind<int>> mValidCnt; // valid cnt = number of input roi for every image.
+    nvinfer1::DimsHW mImageSize;
+    std::vector<float> mAnchorScales; // one scale per pyramid level
     std::shared_ptr<CudaBind<float>>
-        mAnchorBoxesDevice; // [N, anchors(261888 for resnet101 + 1024*1024), (y1, x1, y2, x2)]
+        mAnchorBoxesDevice; // [anchors(261888 for resnet101 + 1024*1024), (y1, x1, y2, x2)], shared by the batch
     std::vector<float> mAnchorBoxesHost;
 
     nvinfer1::DataType mType;
@@ -112,6 +114,72 @@ private:
     std::string mNameSpace;
 };
 
+// Explicit batch version of ProposalLayer. The inputs are the scores [N, anchors, 2, 1] and the deltas
+// [N, anchors, 4, 1], the output the proposals [N, keep_topk, 4]. The anchors are generated for image_size, so only
+// the batch size may change.
+class ProposalLayerDynamic : public IPluginV2DynamicExt
+{
+public:
+    ProposalLayerDynamic(int prenms_topk, int keep_topk, float iou_threshold, const nvinfer1::DimsHW& image_size,
+        const std::vector<float>& anchor_scales);
+
+    ProposalLayerDynamic(const void* data, size_t length);
+
+    ~ProposalLayerDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    int mPreNMSTopK;
+    int mKeepTopK;
+    float mIOUThreshold;
+    nvinfer1::DimsHW mImageSize;
+    std::vector<float> mAnchorScales; // one scale per pyramid level
+    RefineNMSParameters mParam;
+
+    int mAnchorsCnt;
+    std::vector<float> mAnchorBoxesHost;
+    std::shared_ptr<CudaBind<float>> mAnchorBoxesDevice; // [anchors, (y1, x1, y2, x2)], shared by the batch
+
+    std::string mNamespace;
+};
+
 class ProposalLayerPluginCreator : public BaseCreator
 {
 public:
@@ -131,10 +199,29 @@ public:
 
 private:
     static PluginFieldCollection mFC;
-    int mPreNMSTopK;
-    int mKeepTopK;
-    float mScoreThreshold;
-    float mIOUThreshold;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as ProposalLayer_TRT
+class ProposalLayerDynamicPluginCreator : public BaseCreator
+{
+public:
+    ProposalLayerDynamicPluginCreator();
+
+    ~ProposalLayerDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
 };
 } // namespace plugin
@@ -15,6 +15,9 @@
  */
 
 #include "proposalPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "NvInfer.h"
 #include <cassert>
 #include <cmath>
@@ -23,6 +26,8 @@
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::ProposalDynamic;
+using nvinfer1::plugin::ProposalDynamicPluginCreator;
 using nvinfer1::plugin::ProposalPlugin;
 using nvinfer1::plugin::ProposalPluginCreator;
 
@@ -31,12 +36,15 @@ namespace
 {
 static const char* PROPOSAL_PLUGIN_VERSION{"1"};
 static const char* PROPOSAL_PLUGIN_NAME{"Proposal"};
+static const char* PROPOSAL_DYNAMIC_PLUGIN_NAME{"ProposalDynamic"};
 static const float RPN_STD_SCALING{1.0f};
 } // namespace
 
 // Static class fields initialization
 PluginFieldCollection ProposalPluginCreator::mFC{};
 std::vector<PluginField> ProposalPluginCreator::mPluginAttributes;
+PluginFieldCollection ProposalDynamicPluginCreator::mFC{};
+std::vector<PluginField> ProposalDynamicPluginCreator::mPluginAttributes;
 
 // Helper function for serializing plugin
 template <typename T>
@@ -55,6 +63,109 @@ T readFromBuffer(const char*& buffer)
     return val;
 }
 
+namespace
+{
+void addProposalFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("input_height", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("input_width", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("rpn_stride", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("roi_min_size", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("nms_iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("pre_nms_top_n", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("post_nms_top_n", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("anchor_sizes", nullptr, PluginFieldType::kFLOAT32, 1));
+    attributes.emplace_back(PluginField("anchor_ratios", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+// Parses the fields of both creators and builds the plugin, ProposalPlugin and ProposalDynamic take the same arguments
+template <typename PluginType>
+PluginType* createProposal(const char* name, const PluginFieldCollection* fc, bool imageSizeFromShape)
+{
+    const PluginField* fields = fc->fields;
+    int nbFields = fc->nbFields;
+    int input_height = 0, input_width = 0, rpn_stride = 0, pre_nms_top_n = 0, post_nms_top_n = 0;
+    float roi_min_size = 0.0f, nms_iou_threshold = 0.0f;
+    std::vector<float> anchor_sizes;
+    std::vector<float> anchor_ratios;
+
+    for (int i = 0; i < nbFields; ++i)
+    {
+        const char* attr_name = fields[i].name;
+
+        if (!strcmp(attr_name, "input_height"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            input_height = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "input_width"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            input_width = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "rpn_stride"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            rpn_stride = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "roi_min_size"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            roi_min_size = *(static_cast<const float*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "nms_iou_threshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            nms_iou_threshold = *(static_cast<const float*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "pre_nms_top_n"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            pre_nms_top_n = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "post_nms_top_n"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            post_nms_top_n = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attr_name, "anchor_sizes"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            const float* as = static_cast<const float*>(fields[i].data);
+
+            for (int j = 0; j < fields[i].length; ++j)
+            {
+                ASSERT(*as > 0.0f);
+                anchor_sizes.push_back(*as);
+                ++as;
+            }
+        }
+        else if (!strcmp(attr_name, "anchor_ratios"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            const float* ar = static_cast<const float*>(fields[i].data);
+
+            // take the square root.
+            for (int j = 0; j < fields[i].length; ++j)
+            {
+                ASSERT(*ar > 0.0f);
+                anchor_ratios.push_back(std::sqrt(*ar));
+                ++ar;
+            }
+        }
+    }
+
+    // The explicit batch version takes the image size from the shape of the inputs when it is 0
+    const int minImageSize = imageSizeFromShape ? 0 : 1;
+    ASSERT(input_height >= minImageSize && input_width >= minImageSize && rpn_stride > 0 && pre_nms_top_n > 0
+        && post_nms_top_n && roi_min_size >= 0.0f && nms_iou_threshold > 0.0f);
+
+    return new PluginType(name, input_height, input_width, RPN_STD_SCALING, rpn_stride, roi_min_size,
+        nms_iou_threshold, pre_nms_top_n, post_nms_top_n, &anchor_sizes[0], anchor_sizes.size(), &anchor_ratios[0],
+        anchor_ratios.size());
+}
+} // namespace
+
 ProposalPlugin::ProposalPlugin(const std::string name)
     : mLayerName(name)
 {
@@ -177,23 +288,35 @@ Dims ProposalPlugin::getOutputDimensions(int index, const Dims* inputs, int nbIn
 
 int ProposalPlugin::initialize()
 {
+    if (mDeviceAnchors == nullptr)
+    {
+        CUASSERT(cudaMalloc(&mDeviceAnchors, (mAnchorSizeNum + mAnchorRatioNum) * sizeof(float)));
+        CUASSERT(cudaMemcpy(
+            mDeviceAnchors, mAnchorSizes.data(), mAnchorSizeNum * sizeof(float), cudaMemcpyHostToDevice));
+        CUASSERT(cudaMemcpy(mDeviceAnchors + mAnchorSizeNum, mAnchorRatios.data(), mAnchorRatioNum * sizeof(float),
+            cudaMemcpyHostToDevice));
+    }
     return 0;
 }
 
 size_t ProposalPlugin::getWorkspaceSize(int max_batch_size) const
 {
-    return _get_workspace_size(max_batch_size, mAnchorSizeNum, mAnchorRatioNum, mRpnHeight, mRpnWidth, mMaxBoxNum);
+    return _get_workspace_size(
+        max_batch_size, mAnchorSizeNum, mAnchorRatioNum, mRpnHeight, mRpnWidth, mPreNmsTopN, mMaxBoxNum);
 }
 
 int ProposalPlugin::enqueue(
     int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
     int status = -1;
     // Our plugin outputs only one tensor
     void* output = outputs[0];
     status = proposalInference_gpu(stream, inputs[0], inputs[1], batchSize, mInputHeight, mInputWidth, mRpnHeight,
-        mRpnWidth, mMaxBoxNum, mPreNmsTopN, &mAnchorSizes[0], mAnchorSizeNum, &mAnchorRatios[0], mAnchorRatioNum,
-        mRpnStdScaling, mRpnStride, mBboxMinSize, mNmsIouThreshold, workspace, output);
+        mRpnWidth, mMaxBoxNum, mPreNmsTopN, mDeviceAnchors, mAnchorSizeNum, mDeviceAnchors + mAnchorSizeNum,
+        mAnchorRatioNum, mRpnStdScaling, mRpnStride, mBboxMinSize, mNmsIouThreshold, workspace, output);
     return status;
 }
 
@@ -245,7 +368,14 @@ bool ProposalPlugin::supportsFormat(DataType type, PluginFormat format) const
     }
 }
 
-void ProposalPlugin::terminate() {}
+void ProposalPlugin::terminate()
+{
+    if (mDeviceAnchors != nullptr)
+    {
+        CUASSERT(cudaFree(mDeviceAnchors));
+        mDeviceAnchors = nullptr;
+    }
+}
 
 void ProposalPlugin::destroy()
 {
@@ -316,15 +446,7 @@ void ProposalPlugin::detachFromContext() {}
 
 ProposalPluginCreator::ProposalPluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("input_height", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("input_width", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("rpn_stride", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("roi_min_size", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("nms_iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("pre_nms_top_n", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("post_nms_top_n", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("anchor_sizes", nullptr, PluginFieldType::kFLOAT32, 1));
-    mPluginAttributes.emplace_back(PluginField("anchor_ratios", nullptr, PluginFieldType::kFLOAT32, 1));
+    addProposalFields(mPluginAttributes);
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -348,93 +470,252 @@ const PluginFieldCollection* ProposalPluginCreator::getFieldNames()
 
 IPluginV2Ext* ProposalPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    int nbFields = fc->nbFields;
-    int input_height = 0, input_width = 0, rpn_stride = 0, pre_nms_top_n = 0, post_nms_top_n = 0;
-    float roi_min_size = 0.0f, nms_iou_threshold = 0.0f;
-    std::vector<float> anchor_sizes;
-    std::vector<float> anchor_ratios;
+    IPluginV2Ext* plugin = createProposal<ProposalPlugin>(name, fc, false);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
 
-    for (int i = 0; i < nbFields; ++i)
+IPluginV2Ext* ProposalPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
+{
+    // This object will be deleted when the network is destroyed,
+    IPluginV2Ext* plugin = new ProposalPlugin(name, serialData, serialLength);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+ProposalDynamic::ProposalDynamic(const std::string name, int input_height, int input_width, float rpn_std_scaling,
+    int rpn_stride, float bbox_min_size, float nms_iou_threshold, int pre_nms_top_n, int max_box_num,
+    const float* anchor_sizes, int anc_size_num, const float* anchor_ratios, int anc_ratio_num)
+    : mLayerName(name)
+    , mInputHeight(input_height)
+    , mInputWidth(input_width)
+    , mRpnStdScaling(rpn_std_scaling)
+    , mRpnStride(rpn_stride)
+    , mBboxMinSize(bbox_min_size)
+    , mNmsIouThreshold(nms_iou_threshold)
+    , mPreNmsTopN(pre_nms_top_n)
+    , mMaxBoxNum(max_box_num)
+    , mAnchorSizes(anchor_sizes, anchor_sizes + anc_size_num)
+    , mAnchorRatios(anchor_ratios, anchor_ratios + anc_ratio_num)
+{
+}
+
+ProposalDynamic::ProposalDynamic(const std::string name, const void* serial_buf, size_t serial_size)
+    : mLayerName(name)
+{
+    const char* d = reinterpret_cast<const char*>(serial_buf);
+    const char* a = d;
+    ASSERT(serial_size >= sizeof(int) * 7 + sizeof(float) * 3);
+    mInputHeight = readFromBuffer<int>(a);
+    mInputWidth = readFromBuffer<int>(a);
+    mRpnStride = readFromBuffer<int>(a);
+    mPreNmsTopN = readFromBuffer<int>(a);
+    mMaxBoxNum = readFromBuffer<int>(a);
+    const int anchorSizeNum = readFromBuffer<int>(a);
+    const int anchorRatioNum = readFromBuffer<int>(a);
+    mRpnStdScaling = readFromBuffer<float>(a);
+    mBboxMinSize = readFromBuffer<float>(a);
+    mNmsIouThreshold = readFromBuffer<float>(a);
+    ASSERT(anchorSizeNum >= 0 && anchorRatioNum >= 0
+        && serial_size == sizeof(int) * 7 + sizeof(float) * (3 + anchorSizeNum + anchorRatioNum));
+
+    for (int i = 0; i < anchorSizeNum; ++i)
     {
-        const char* attr_name = fields[i].name;
+        mAnchorSizes.push_back(readFromBuffer<float>(a));
+    }
 
-        if (!strcmp(attr_name, "input_height"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            input_height = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "input_width"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            input_width = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "rpn_stride"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            rpn_stride = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "roi_min_size"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            roi_min_size = *(static_cast<const float*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "nms_iou_threshold"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            nms_iou_threshold = *(static_cast<const float*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "pre_nms_top_n"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            pre_nms_top_n = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "post_nms_top_n"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            post_nms_top_n = *(static_cast<const int*>(fields[i].data));
-        }
-        else if (!strcmp(attr_name, "anchor_sizes"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            const float* as = static_cast<const float*>(fields[i].data);
+    for (int i = 0; i < anchorRatioNum; ++i)
+    {
+        mAnchorRatios.push_back(readFromBuffer<float>(a));
+    }
 
-            for (int j = 0; j < fields[i].length; ++j)
-            {
-                ASSERT(*as > 0.0f);
-                anchor_sizes.push_back(*as);
-                ++as;
-            }
-        }
-        else if (!strcmp(attr_name, "anchor_ratios"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
-            const float* ar = static_cast<const float*>(fields[i].data);
+    ASSERT(a == d + serial_size);
+}
 
-            // take the square root.
-            for (int j = 0; j < fields[i].length; ++j)
-            {
-                ASSERT(*ar > 0.0f);
-                anchor_ratios.push_back(std::sqrt(*ar));
-                ++ar;
-            }
-        }
+const char* ProposalDynamic::getPluginType() const
+{
+    return PROPOSAL_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* ProposalDynamic::getPluginVersion() const
+{
+    return PROPOSAL_PLUGIN_VERSION;
+}
+
+int ProposalDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs ProposalDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 2);
+    ASSERT(inputs[0].nbDims == 4 && inputs[1].nbDims == 4);
+    DimsExprs output;
+    output.nbDims = 4;
+    output.d[0] = inputs[0].d[0];
+    output.d[1] = exprBuilder.constant(mMaxBoxNum);
+    output.d[2] = exprBuilder.constant(4);
+    output.d[3] = exprBuilder.constant(1);
+    return output;
+}
+
+int ProposalDynamic::initialize()
+{
+    const size_t sizeNum = mAnchorSizes.size();
+    const size_t ratioNum = mAnchorRatios.size();
+    CUASSERT(cudaMalloc(&mDeviceAnchors, (sizeNum + ratioNum) * sizeof(float)));
+    CUASSERT(cudaMemcpy(mDeviceAnchors, mAnchorSizes.data(), sizeNum * sizeof(float), cudaMemcpyHostToDevice));
+    CUASSERT(cudaMemcpy(
+        mDeviceAnchors + sizeNum, mAnchorRatios.data(), ratioNum * sizeof(float), cudaMemcpyHostToDevice));
+    return 0;
+}
+
+void ProposalDynamic::terminate()
+{
+    CUASSERT(cudaFree(mDeviceAnchors));
+    mDeviceAnchors = nullptr;
+}
+
+size_t ProposalDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const Dims& dims = inputs[0].dims;
+    return _get_workspace_size(
+        dims.d[0], mAnchorSizes.size(), mAnchorRatios.size(), dims.d[2], dims.d[3], mPreNmsTopN, mMaxBoxNum);
+}
+
+int ProposalDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    const Dims& dims = inputDesc[0].dims;
+    const int rpnHeight = dims.d[2];
+    const int rpnWidth = dims.d[3];
+    const int inputHeight = mInputHeight > 0 ? mInputHeight : rpnHeight * mRpnStride;
+    const int inputWidth = mInputWidth > 0 ? mInputWidth : rpnWidth * mRpnStride;
+    const int sizeNum = mAnchorSizes.size();
+    return proposalInference_gpu(stream, inputs[0], inputs[1], dims.d[0], inputHeight, inputWidth, rpnHeight,
+        rpnWidth, mMaxBoxNum, mPreNmsTopN, mDeviceAnchors, sizeNum, mDeviceAnchors + sizeNum, mAnchorRatios.size(),
+        mRpnStdScaling, mRpnStride, mBboxMinSize, mNmsIouThreshold, workspace, outputs[0]);
+}
+
+size_t ProposalDynamic::getSerializationSize() const
+{
+    // Seven ints and three floats, then the anchor sizes and ratios
+    return sizeof(int) * 7 + sizeof(float) * (3 + mAnchorSizes.size() + mAnchorRatios.size());
+}
+
+void ProposalDynamic::serialize(void* buffer) const
+{
+    char* d = reinterpret_cast<char*>(buffer);
+    char* a = d;
+    writeToBuffer<int>(a, mInputHeight);
+    writeToBuffer<int>(a, mInputWidth);
+    writeToBuffer<int>(a, mRpnStride);
+    writeToBuffer<int>(a, mPreNmsTopN);
+    writeToBuffer<int>(a, mMaxBoxNum);
+    writeToBuffer<int>(a, mAnchorSizes.size());
+    writeToBuffer<int>(a, mAnchorRatios.size());
+    writeToBuffer<float>(a, mRpnStdScaling);
+    writeToBuffer<float>(a, mBboxMinSize);
+    writeToBuffer<float>(a, mNmsIouThreshold);
+
+    for (const float size : mAnchorSizes)
+    {
+        writeToBuffer<float>(a, size);
+    }
+
+    for (const float ratio : mAnchorRatios)
+    {
+        writeToBuffer<float>(a, ratio);
     }
 
-    ASSERT(input_height > 0 && input_width > 0 && rpn_stride > 0 && pre_nms_top_n > 0 && post_nms_top_n
-        && roi_min_size >= 0.0f && nms_iou_threshold > 0.0f);
+    ASSERT(a == d + getSerializationSize());
+}
+
+void ProposalDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 2);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 4 && in[1].desc.dims.nbDims == 4);
+}
+
+bool ProposalDynamic::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 2 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    // This plugin only supports ordinary floats, and NCHW input format
+    return inOut[pos].type == DataType::kFLOAT && inOut[pos].format == TensorFormat::kLINEAR;
+}
 
-    IPluginV2Ext* plugin = new ProposalPlugin(name, input_height, input_width, RPN_STD_SCALING, rpn_stride,
-        roi_min_size, nms_iou_threshold, pre_nms_top_n, post_nms_top_n, &anchor_sizes[0], anchor_sizes.size(),
-        &anchor_ratios[0], anchor_ratios.size());
+void ProposalDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* ProposalDynamic::clone() const
+{
+    IPluginV2DynamicExt* plugin = new ProposalDynamic(mLayerName, mInputHeight, mInputWidth, mRpnStdScaling,
+        mRpnStride, mBboxMinSize, mNmsIouThreshold, mPreNmsTopN, mMaxBoxNum, mAnchorSizes.data(), mAnchorSizes.size(),
+        mAnchorRatios.data(), mAnchorRatios.size());
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
 
-IPluginV2Ext* ProposalPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
+void ProposalDynamic::setPluginNamespace(const char* libNamespace)
 {
-    // This object will be deleted when the network is destroyed,
-    IPluginV2Ext* plugin = new ProposalPlugin(name, serialData, serialLength);
+    mNamespace = libNamespace;
+}
+
+const char* ProposalDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType ProposalDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return DataType::kFLOAT;
+}
+
+ProposalDynamicPluginCreator::ProposalDynamicPluginCreator()
+{
+    addProposalFields(mPluginAttributes);
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* ProposalDynamicPluginCreator::getPluginName() const
+{
+    return PROPOSAL_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* ProposalDynamicPluginCreator::getPluginVersion() const
+{
+    return PROPOSAL_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* ProposalDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* ProposalDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    IPluginV2DynamicExt* plugin = createProposal<ProposalDynamic>(name, fc, true);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* ProposalDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    IPluginV2DynamicExt* plugin = new ProposalDynamic(name, serialData, serialLength);
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
@@ -115,6 +115,80 @@ private:
     size_t mAnchorSizeNum, mAnchorRatioNum;
     std::vector<float> mAnchorSizes;
     std::vector<float> mAnchorRatios;
+    // The anchor sizes followed by the anchor ratios, on the device
+    float* mDeviceAnchors{nullptr};
+};
+
+// Explicit batch version of ProposalPlugin. The inputs are scores [N, A, H, W] and deltas [N, A * 4, H, W], the
+// output is rois [N, post_nms_top_n, 4, 1]. H and W are read at enqueue time; when input_height or input_width is 0
+// the image size is H or W times rpn_stride, so that the boxes follow the input resolution.
+class ProposalDynamic : public IPluginV2DynamicExt
+{
+public:
+    ProposalDynamic(const std::string name, int input_height, int input_width, float rpn_std_scaling, int rpn_stride,
+        float bbox_min_size, float nms_iou_threshold, int pre_nms_top_n, int max_box_num, const float* anchor_sizes,
+        int anc_size_num, const float* anchor_ratios, int anc_ratio_num);
+
+    ProposalDynamic(const std::string name, const void* serial_buf, size_t serial_size);
+
+    ProposalDynamic() = delete;
+
+    ~ProposalDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    const std::string mLayerName;
+    std::string mNamespace;
+    // 0 when the image size comes from the shape of the inputs
+    int mInputHeight;
+    int mInputWidth;
+    float mRpnStdScaling;
+    int mRpnStride;
+    float mBboxMinSize;
+    float mNmsIouThreshold;
+    int mPreNmsTopN;
+    int mMaxBoxNum;
+    std::vector<float> mAnchorSizes;
+    std::vector<float> mAnchorRatios;
+    // The anchor sizes followed by the anchor ratios, on the device
+    float* mDeviceAnchors{nullptr};
 };
 
 class ProposalPluginCreator : public BaseCreator
@@ -140,6 +214,29 @@ private:
     std::string mNamespace;
 };
 
+// Takes the same fields as Proposal, input_height and input_width may be 0
+class ProposalDynamicPluginCreator : public BaseCreator
+{
+public:
+    ProposalDynamicPluginCreator();
+
+    ~ProposalDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
 } // namespace plugin
 
 } // namespace nvinfer1
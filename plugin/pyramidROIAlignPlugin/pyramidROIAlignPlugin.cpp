@@ -14,26 +14,55 @@
  * limitations under the License.
  */
 #include "pyramidROIAlignPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "plugin.h"
 #include <cuda_runtime_api.h>
 
 using namespace nvinfer1;
 using namespace plugin;
 using nvinfer1::plugin::PyramidROIAlign;
+using nvinfer1::plugin::PyramidROIAlignDynamic;
+using nvinfer1::plugin::PyramidROIAlignDynamicPluginCreator;
 using nvinfer1::plugin::PyramidROIAlignPluginCreator;
 
 namespace
 {
 const char* PYRAMIDROIALGIN_PLUGIN_VERSION{"1"};
 const char* PYRAMIDROIALGIN_PLUGIN_NAME{"PyramidROIAlign_TRT"};
+const char* PYRAMIDROIALGIN_DYNAMIC_PLUGIN_NAME{"PyramidROIAlignDynamic_TRT"};
+
+void addPyramidROIAlignFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("pooled_size", nullptr, PluginFieldType::kINT32, 1));
+}
+
+int parsePyramidROIAlignFields(const PluginFieldCollection* fc)
+{
+    int pooledSize{};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "pooled_size"))
+        {
+            assert(fields[i].type == PluginFieldType::kINT32);
+            pooledSize = *(static_cast<const int*>(fields[i].data));
+        }
+    }
+    return pooledSize;
+}
 } // namespace
 
 PluginFieldCollection PyramidROIAlignPluginCreator::mFC{};
 std::vector<PluginField> PyramidROIAlignPluginCreator::mPluginAttributes;
+PluginFieldCollection PyramidROIAlignDynamicPluginCreator::mFC{};
+std::vector<PluginField> PyramidROIAlignDynamicPluginCreator::mPluginAttributes;
 
 PyramidROIAlignPluginCreator::PyramidROIAlignPluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("pooled_size", nullptr, PluginFieldType::kINT32, 1));
+    addPyramidROIAlignFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -56,17 +85,7 @@ const PluginFieldCollection* PyramidROIAlignPluginCreator::getFieldNames()
 
 IPluginV2Ext* PyramidROIAlignPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "pooled_size"))
-        {
-            assert(fields[i].type == PluginFieldType::kINT32);
-            mPooledSize = *(static_cast<const int*>(fields[i].data));
-        }
-    }
-    return new PyramidROIAlign(mPooledSize);
+    return new PyramidROIAlign(parsePyramidROIAlignFields(fc));
 };
 
 IPluginV2Ext* PyramidROIAlignPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
@@ -103,14 +122,14 @@ void PyramidROIAlign::destroy()
     delete this;
 };
 
-size_t PyramidROIAlign::getWorkspaceSize(int) const
+size_t PyramidROIAlign::getWorkspaceSize(int maxBatchSize) const
 {
-    return 0;
+    return roiAlignBucketedWorkspaceSize(maxBatchSize, mROICount);
 }
 
 bool PyramidROIAlign::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 };
 
 const char* PyramidROIAlign::getPluginType() const
@@ -182,14 +201,17 @@ Dims PyramidROIAlign::getOutputDimensions(int index, const Dims* inputs, int nbI
 int PyramidROIAlign::enqueue(
     int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
 
     void* pooled = outputs[0];
 
-    cudaError_t status = roiAlign(stream, batch_size, mFeatureLength, mROICount, mThresh,
+    cudaError_t status = roiAlignBucketed(stream, batch_size, mFeatureLength, mROICount, mThresh, mPrecision,
 
         inputs[0], &inputs[1], mFeatureSpatialSize,
 
-        pooled, mPooledSize);
+        pooled, mPooledSize, workspace);
 
     assert(status == cudaSuccess);
     return 0;
@@ -197,7 +219,7 @@ int PyramidROIAlign::enqueue(
 
 size_t PyramidROIAlign::getSerializationSize() const
 {
-    return sizeof(int) * 2 + sizeof(int) * 3 + sizeof(float) + sizeof(int) * 2 * 4;
+    return sizeof(int) * 2 + sizeof(int) * 3 + sizeof(float) + sizeof(int) * 2 * 4 + sizeof(DataType);
 };
 
 void PyramidROIAlign::serialize(void* buffer) const
@@ -217,6 +239,7 @@ void PyramidROIAlign::serialize(void* buffer) const
     write(d, mFeatureSpatialSize[2].x);
     write(d, mFeatureSpatialSize[3].y);
     write(d, mFeatureSpatialSize[3].x);
+    write(d, mPrecision);
     assert(d == a + getSerializationSize());
 };
 
@@ -236,6 +259,11 @@ PyramidROIAlign::PyramidROIAlign(const void* data, size_t length)
     mFeatureSpatialSize[2].x = read<int>(d);
     mFeatureSpatialSize[3].y = read<int>(d);
     mFeatureSpatialSize[3].x = read<int>(d);
+    // Engines serialized before FP16 was supported are FP32
+    if (d < a + length)
+    {
+        mPrecision = read<DataType>(d);
+    }
 
     assert(d == a + length);
 };
@@ -243,8 +271,8 @@ PyramidROIAlign::PyramidROIAlign(const void* data, size_t length)
 // Return the DataType of the plugin output at the requested index
 DataType PyramidROIAlign::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
-    // Only DataType::kFLOAT is acceptable by the plugin layer
-    return DataType::kFLOAT;
+    // The pooled features have the type of the inputs
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -272,6 +300,7 @@ void PyramidROIAlign::configurePlugin(const Dims* inputDims, int nbInputs, const
 
     mROICount = inputDims[0].d[0];
     mFeatureLength = inputDims[1].d[0];
+    mPrecision = inputTypes[0];
 
     for (size_t layer = 0; layer < mFeatureMapCount; ++layer)
     {
@@ -287,3 +316,197 @@ void PyramidROIAlign::attachToContext(
 
 // Detach the plugin object from its execution context.
 void PyramidROIAlign::detachFromContext() {}
+
+PyramidROIAlignDynamic::PyramidROIAlignDynamic(int pooled_size)
+    : mPooledSize({pooled_size, pooled_size})
+{
+    ASSERT(pooled_size > 0);
+}
+
+PyramidROIAlignDynamic::PyramidROIAlignDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mPooledSize = {read<int>(d), read<int>(d)};
+    ASSERT(d == a + length);
+}
+
+int PyramidROIAlignDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs PyramidROIAlignDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 1 + mFeatureMapCount);
+
+    DimsExprs result;
+    result.nbDims = 5;
+    result.d[0] = inputs[0].d[0];
+    // ROI count
+    result.d[1] = inputs[0].d[1];
+    // feature length
+    result.d[2] = inputs[1].d[1];
+    result.d[3] = exprBuilder.constant(mPooledSize.y);
+    result.d[4] = exprBuilder.constant(mPooledSize.x);
+    return result;
+}
+
+int PyramidROIAlignDynamic::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void PyramidROIAlignDynamic::terminate() {}
+
+size_t PyramidROIAlignDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return roiAlignBucketedWorkspaceSize(inputs[0].dims.d[0], inputs[0].dims.d[1]);
+}
+
+int PyramidROIAlignDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    xy_t featureSpatialSize[mFeatureMapCount];
+    for (int layer = 0; layer < mFeatureMapCount; ++layer)
+    {
+        const Dims& dims = inputDesc[layer + 1].dims;
+        featureSpatialSize[layer] = {dims.d[2], dims.d[3]};
+    }
+    // PyramidROIAlign selects the levels for an image of MaskRCNNConfig::IMAGE_SHAPE, here the image is p2 upsampled
+    // by the first backbone stride
+    const float stride = MaskRCNNConfig::BACKBONE_STRIDES[0];
+    const float imageArea = featureSpatialSize[0].y * stride * featureSpatialSize[0].x * stride;
+    const float thresh = (224 * 224 * 2.0f / imageArea) / (4.0f * 4.0f);
+
+    const Dims& rois = inputDesc[0].dims;
+    cudaError_t status = roiAlignBucketed(stream, rois.d[0], inputDesc[1].dims.d[1], rois.d[1], thresh,
+        inputDesc[0].type, inputs[0], &inputs[1], featureSpatialSize, outputs[0], mPooledSize, workspace);
+
+    ASSERT(status == cudaSuccess);
+    return status;
+}
+
+size_t PyramidROIAlignDynamic::getSerializationSize() const
+{
+    return sizeof(int) * 2;
+}
+
+void PyramidROIAlignDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mPooledSize.y);
+    write(d, mPooledSize.x);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void PyramidROIAlignDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 1 + mFeatureMapCount);
+    ASSERT(nbOutputs == 1);
+    // roi: [N, anchors, 4]
+    ASSERT(in[0].desc.dims.nbDims == 3 && in[0].desc.dims.d[2] == 4);
+    // feature_map list(4 maps): p2, p3, p4, p5, NCHW with the same #C
+    for (int i = 1; i < nbInputs; ++i)
+    {
+        ASSERT(in[i].desc.dims.nbDims == 4 && in[i].desc.dims.d[1] == in[1].desc.dims.d[1]);
+    }
+}
+
+bool PyramidROIAlignDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 1 + mFeatureMapCount && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    // The feature maps and the pooled features have the type of the ROIs
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* PyramidROIAlignDynamic::getPluginType() const
+{
+    return PYRAMIDROIALGIN_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* PyramidROIAlignDynamic::getPluginVersion() const
+{
+    return PYRAMIDROIALGIN_PLUGIN_VERSION;
+}
+
+void PyramidROIAlignDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* PyramidROIAlignDynamic::clone() const
+{
+    return new PyramidROIAlignDynamic(*this);
+}
+
+void PyramidROIAlignDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* PyramidROIAlignDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType PyramidROIAlignDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+PyramidROIAlignDynamicPluginCreator::PyramidROIAlignDynamicPluginCreator()
+{
+    addPyramidROIAlignFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* PyramidROIAlignDynamicPluginCreator::getPluginName() const
+{
+    return PYRAMIDROIALGIN_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* PyramidROIAlignDynamicPluginCreator::getPluginVersion() const
+{
+    return PYRAMIDROIALGIN_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* PyramidROIAlignDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* PyramidROIAlignDynamicPluginCreator::createPlugin(
+    const char* name, const PluginFieldCollection* fc)
+{
+    auto* plugin = new PyramidROIAlignDynamic(parsePyramidROIAlignFields(fc));
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* PyramidROIAlignDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new PyramidROIAlignDynamic(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
@@ -97,9 +97,66 @@ private:
     int mInputSize;
     float mThresh;
     xy_t mFeatureSpatialSize[mFeatureMapCount];
+    DataType mPrecision{DataType::kFLOAT};
     std::string mNameSpace;
 };
 
+// Explicit batch version of PyramidROIAlign. The inputs are the ROIs [N, R, 4] and the feature maps p2 to p5
+// [N, C, H, W], the output the pooled features [N, R, C, pooled_size, pooled_size]. The feature map sizes are read at
+// enqueue time, and the image size that selects the level of a ROI is derived from the size of p2.
+class PyramidROIAlignDynamic : public IPluginV2DynamicExt
+{
+public:
+    PyramidROIAlignDynamic(int pooled_size);
+
+    PyramidROIAlignDynamic(const void* data, size_t length);
+
+    ~PyramidROIAlignDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    static const int mFeatureMapCount = 4;
+    xy_t mPooledSize;
+    std::string mNamespace;
+};
+
 class PyramidROIAlignPluginCreator : public BaseCreator
 {
 public:
@@ -119,7 +176,29 @@ public:
 
 private:
     static PluginFieldCollection mFC;
-    int mPooledSize;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as PyramidROIAlign_TRT
+class PyramidROIAlignDynamicPluginCreator : public BaseCreator
+{
+public:
+    PyramidROIAlignDynamicPluginCreator();
+
+    ~PyramidROIAlignDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
 };
 } // namespace plugin
@@ -14,10 +14,15 @@
  * limitations under the License.
  */
 #include "regionPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include <cstring>
 
 using namespace nvinfer1;
 using nvinfer1::plugin::Region;
+using nvinfer1::plugin::RegionDynamic;
+using nvinfer1::plugin::RegionDynamicPluginCreator;
 using nvinfer1::plugin::RegionParameters; // Needed for Windows Build
 using nvinfer1::plugin::RegionPluginCreator;
 
@@ -25,6 +30,7 @@ namespace
 {
 const char* REGION_PLUGIN_VERSION{"1"};
 const char* REGION_PLUGIN_NAME{"Region_TRT"};
+const char* REGION_DYNAMIC_PLUGIN_NAME{"RegionDynamic_TRT"};
 
 template <typename T>
 void safeFree(T* ptr)
@@ -41,10 +47,52 @@ void allocateChunk(T*& ptr, int count)
 {
     ptr = static_cast<T*>(malloc(count * sizeof(T)));
 }
+
+void addRegionFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("num", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("coords", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("classes", nullptr, PluginFieldType::kINT32, 1));
+    attributes.emplace_back(PluginField("smTree", nullptr, PluginFieldType::kINT32, 1));
+}
+
+RegionParameters parseRegionFields(const PluginFieldCollection* fc)
+{
+    RegionParameters params{};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "num"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.num = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "coords"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.coords = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "classes"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            params.classes = *(static_cast<const int*>(fields[i].data));
+        }
+        if (!strcmp(attrName, "smTree"))
+        {
+            // TODO not sure if this will work
+            void* tmpData = const_cast<void*>(fields[i].data);
+            params.smTree = static_cast<nvinfer1::plugin::softmaxTree*>(tmpData);
+        }
+    }
+    return params;
+}
 } // namespace
 
 PluginFieldCollection RegionPluginCreator::mFC{};
 std::vector<PluginField> RegionPluginCreator::mPluginAttributes;
+PluginFieldCollection RegionDynamicPluginCreator::mFC{};
+std::vector<PluginField> RegionDynamicPluginCreator::mPluginAttributes;
 
 Region::Region(RegionParameters params)
     : num(params.num)
@@ -196,6 +244,7 @@ Region::Region(const void* buffer, size_t length)
     {
         smTree = nullptr;
     }
+    mDataType = read<DataType>(d);
     ASSERT(d == a + length);
 }
 
@@ -213,6 +262,9 @@ Dims Region::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
 
 int Region::enqueue(int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     const void* inputData = inputs[0];
     void* outputData = outputs[0];
     if (smTree)
@@ -224,7 +276,7 @@ int Region::enqueue(int batchSize, const void* const* inputs, void** outputs, vo
         hasSoftmaxTree = false;
     }
     pluginStatus_t status = regionInference(
-        stream, batchSize, C, H, W, num, coords, classes, hasSoftmaxTree, smTree, inputData, outputData);
+        stream, batchSize, C, H, W, num, coords, classes, hasSoftmaxTree, smTree, mDataType, inputData, outputData);
     ASSERT(status == STATUS_SUCCESS);
     return status;
 }
@@ -232,7 +284,7 @@ int Region::enqueue(int batchSize, const void* const* inputs, void** outputs, vo
 size_t Region::getSerializationSize() const
 {
     // C, H, W, num, classes, coords, smTree !nullptr and other array members !nullptr, softmaxTree members
-    size_t count = 6 * sizeof(int) + 8 * sizeof(bool);
+    size_t count = 6 * sizeof(int) + 8 * sizeof(bool) + sizeof(DataType);
     if (smTree)
     {
         count += 2 * sizeof(int);
@@ -333,12 +385,13 @@ void Region::serialize(void* buffer) const
             }
         }
     }
+    write(d, mDataType);
     ASSERT(d == a + getSerializationSize());
 }
 
 bool Region::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 }
 
 int Region::initialize()
@@ -395,7 +448,8 @@ void Region::destroy()
 IPluginV2Ext* Region::clone() const
 {
     RegionParameters params{num, coords, classes, smTree};
-    IPluginV2Ext* plugin = new Region(params, C, H, W);
+    auto* plugin = new Region(params, C, H, W);
+    plugin->mDataType = mDataType;
     plugin->setPluginNamespace(mPluginNamespace);
     return plugin;
 }
@@ -415,7 +469,7 @@ const char* Region::getPluginNamespace() const
 DataType Region::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
 {
     ASSERT(index == 0);
-    return DataType::kFLOAT;
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -435,7 +489,8 @@ void Region::configurePlugin(const Dims* inputDims, int nbInputs, const Dims* ou
     const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
     const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
 {
-    ASSERT(*inputTypes == DataType::kFLOAT && floatFormat == PluginFormat::kNCHW);
+    ASSERT((*inputTypes == DataType::kFLOAT || *inputTypes == DataType::kHALF) && floatFormat == PluginFormat::kNCHW);
+    mDataType = *inputTypes;
     ASSERT(nbInputs == 1);
     ASSERT(nbOutputs == 1);
     C = inputDims[0].d[0];
@@ -457,10 +512,7 @@ void Region::detachFromContext() {}
 
 RegionPluginCreator::RegionPluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("num", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("coords", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("classes", nullptr, PluginFieldType::kINT32, 1));
-    mPluginAttributes.emplace_back(PluginField("smTree", nullptr, PluginFieldType::kINT32, 1));
+    addRegionFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -483,34 +535,7 @@ const PluginFieldCollection* RegionPluginCreator::getFieldNames()
 
 IPluginV2Ext* RegionPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "num"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.num = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "coords"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.coords = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "classes"))
-        {
-            ASSERT(fields[i].type == PluginFieldType::kINT32);
-            params.classes = *(static_cast<const int*>(fields[i].data));
-        }
-        if (!strcmp(attrName, "smTree"))
-        {
-            // TODO not sure if this will work
-            void* tmpData = const_cast<void*>(fields[i].data);
-            params.smTree = static_cast<nvinfer1::plugin::softmaxTree*>(tmpData);
-        }
-    }
-
-    Region* obj = new Region(params);
+    Region* obj = new Region(parseRegionFields(fc));
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
@@ -523,3 +548,191 @@ IPluginV2Ext* RegionPluginCreator::deserializePlugin(const char* name, const voi
     obj->setPluginNamespace(mNamespace.c_str());
     return obj;
 }
+
+RegionDynamic::RegionDynamic(RegionParameters params)
+    : mNum(params.num)
+    , mCoords(params.coords)
+    , mClasses(params.classes)
+{
+    if (params.smTree && params.smTree->groupSize)
+    {
+        mGroupSize.assign(params.smTree->groupSize, params.smTree->groupSize + params.smTree->groups);
+    }
+}
+
+RegionDynamic::RegionDynamic(const void* buffer, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(buffer), *a = d;
+    mNum = read<int>(d);
+    mCoords = read<int>(d);
+    mClasses = read<int>(d);
+    const int groups = read<int>(d);
+    ASSERT(groups >= 0 && length == 4 * sizeof(int) + groups * sizeof(int));
+    for (int i = 0; i < groups; ++i)
+    {
+        mGroupSize.push_back(read<int>(d));
+    }
+    ASSERT(d == a + length);
+}
+
+int RegionDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs RegionDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(nbInputs == 1);
+    ASSERT(outputIndex == 0);
+    return inputs[0];
+}
+
+int RegionDynamic::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void RegionDynamic::terminate() {}
+
+size_t RegionDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return 0;
+}
+
+int RegionDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+    const Dims& dims = inputDesc[0].dims;
+    // Only the groups and their sizes are read from the tree
+    nvinfer1::plugin::softmaxTree tree{};
+    tree.groups = static_cast<int>(mGroupSize.size());
+    tree.groupSize = const_cast<int*>(mGroupSize.data());
+    pluginStatus_t status = regionInference(stream, dims.d[0], dims.d[1], dims.d[2], dims.d[3], mNum, mCoords,
+        mClasses, !mGroupSize.empty(), &tree, inputDesc[0].type, inputs[0], outputs[0]);
+    ASSERT(status == STATUS_SUCCESS);
+    return status;
+}
+
+size_t RegionDynamic::getSerializationSize() const
+{
+    // num, coords, classes, the number of groups and their sizes
+    return 4 * sizeof(int) + mGroupSize.size() * sizeof(int);
+}
+
+void RegionDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mNum);
+    write(d, mCoords);
+    write(d, mClasses);
+    write(d, static_cast<int>(mGroupSize.size()));
+    for (const int size : mGroupSize)
+    {
+        write(d, size);
+    }
+    ASSERT(d == a + getSerializationSize());
+}
+
+void RegionDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 1);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 4);
+    // 1 stands for the objectness of the bounding box, the channels are fixed even when H and W are not
+    const int C = in[0].desc.dims.d[1];
+    ASSERT(C == -1 || C == mNum * (mCoords + 1 + mClasses));
+}
+
+bool RegionDynamic::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* RegionDynamic::getPluginType() const
+{
+    return REGION_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* RegionDynamic::getPluginVersion() const
+{
+    return REGION_PLUGIN_VERSION;
+}
+
+void RegionDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* RegionDynamic::clone() const
+{
+    return new RegionDynamic(*this);
+}
+
+void RegionDynamic::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* RegionDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType RegionDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+RegionDynamicPluginCreator::RegionDynamicPluginCreator()
+{
+    addRegionFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* RegionDynamicPluginCreator::getPluginName() const
+{
+    return REGION_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* RegionDynamicPluginCreator::getPluginVersion() const
+{
+    return REGION_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* RegionDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* RegionDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    auto* obj = new RegionDynamic(parseRegionFields(fc));
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
+
+IPluginV2DynamicExt* RegionDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength)
+{
+    auto* obj = new RegionDynamic(serialData, serialLength);
+    obj->setPluginNamespace(mNamespace.c_str());
+    return obj;
+}
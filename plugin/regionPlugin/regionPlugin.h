@@ -18,6 +18,7 @@
 #include "kernel.h"
 #include "plugin.h"
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace nvinfer1
@@ -89,9 +90,67 @@ private:
     int classes;
     softmaxTree* smTree;
     bool hasSoftmaxTree;
+    DataType mDataType{DataType::kFLOAT};
     const char* mPluginNamespace;
 };
 
+// Explicit batch version of Region. The input is [N, C, H, W] and the output has its shape. The kernels only use the
+// group sizes of the softmax tree, so only they are kept and serialized.
+class RegionDynamic : public IPluginV2DynamicExt
+{
+public:
+    RegionDynamic(RegionParameters params);
+
+    RegionDynamic(const void* buffer, size_t length);
+
+    ~RegionDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    int mNum{};
+    int mCoords{};
+    int mClasses{};
+    std::vector<int> mGroupSize; // Empty without a softmax tree
+    std::string mNamespace;
+};
+
 class RegionPluginCreator : public BaseCreator
 {
 public:
@@ -111,7 +170,29 @@ public:
 
 private:
     static PluginFieldCollection mFC;
-    RegionParameters params;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as Region_TRT
+class RegionDynamicPluginCreator : public BaseCreator
+{
+public:
+    RegionDynamicPluginCreator();
+
+    ~RegionDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+private:
+    static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
 };
 } // namespace plugin
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "reorgPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 
 using namespace nvinfer1;
 using nvinfer1::plugin::Reorg;
@@ -36,6 +39,7 @@ Reorg::Reorg(const void* buffer, size_t length)
     H = read<int>(d);
     W = read<int>(d);
     stride = read<int>(d);
+    mDataType = read<DataType>(d);
     ASSERT(d == a + length);
 }
 
@@ -53,17 +57,20 @@ Dims Reorg::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
 
 int Reorg::enqueue(int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
     const void* inputData = inputs[0];
     void* outputData = outputs[0];
-    pluginStatus_t status = reorgInference(stream, batchSize, C, H, W, stride, inputData, outputData);
+    pluginStatus_t status = reorgInference(stream, batchSize, C, H, W, stride, mDataType, inputData, outputData);
     ASSERT(status == STATUS_SUCCESS);
     return status;
 }
 
 size_t Reorg::getSerializationSize() const
 {
-    // C, H, W, stride
-    return sizeof(int) * 4;
+    // C, H, W, stride, data type
+    return sizeof(int) * 4 + sizeof(DataType);
 }
 
 void Reorg::serialize(void* buffer) const
@@ -73,12 +80,13 @@ void Reorg::serialize(void* buffer) const
     write(d, H);
     write(d, W);
     write(d, stride);
+    write(d, mDataType);
     ASSERT(d == a + getSerializationSize());
 }
 
 bool Reorg::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 }
 
 int Reorg::initialize()
@@ -125,8 +133,8 @@ DataType Reorg::getOutputDataType(int index, const nvinfer1::DataType* inputType
     // Only 1 input and 1 output from the plugin layer
     ASSERT(index == 0);
 
-    // Only DataType::kFLOAT is acceptable by the plugin layer
-    return DataType::kFLOAT;
+    // The output has the type of the input
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -146,7 +154,8 @@ void Reorg::configurePlugin(const Dims* inputDims, int nbInputs, const Dims* out
     const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
     const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
 {
-    ASSERT(*inputTypes == DataType::kFLOAT && floatFormat == PluginFormat::kNCHW);
+    ASSERT((*inputTypes == DataType::kFLOAT || *inputTypes == DataType::kHALF) && floatFormat == PluginFormat::kNCHW);
+    mDataType = *inputTypes;
     ASSERT(nbInputs == 1);
     ASSERT(nbOutputs == 1);
     ASSERT(stride > 0);
@@ -165,7 +174,8 @@ void Reorg::detachFromContext() {}
 
 IPluginV2Ext* Reorg::clone() const
 {
-    IPluginV2Ext* plugin = new Reorg(stride);
+    auto* plugin = new Reorg(stride);
+    plugin->mDataType = mDataType;
     plugin->setPluginNamespace(mPluginNamespace);
     return plugin;
 }
@@ -83,6 +83,7 @@ public:
 private:
     int C, H, W;
     int stride;
+    DataType mDataType{DataType::kFLOAT};
     const char* mPluginNamespace;
 };
 
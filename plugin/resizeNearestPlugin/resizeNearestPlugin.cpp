@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 #include "resizeNearestPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "plugin.h"
 #include <cuda_runtime_api.h>
 #include <iostream>
@@ -23,20 +26,95 @@
 using namespace nvinfer1;
 using namespace plugin;
 using nvinfer1::plugin::ResizeNearest;
+using nvinfer1::plugin::ResizeNearestDynamic;
+using nvinfer1::plugin::ResizeNearestDynamicPluginCreator;
 using nvinfer1::plugin::ResizeNearestPluginCreator;
 
 namespace
 {
 const char* RESIZE_PLUGIN_VERSION{"1"};
 const char* RESIZE_PLUGIN_NAME{"ResizeNearest_TRT"};
+const char* RESIZE_DYNAMIC_PLUGIN_NAME{"ResizeNearestDynamic_TRT"};
+
+void addResizeNearestFields(std::vector<PluginField>& attributes)
+{
+    attributes.emplace_back(PluginField("scale", nullptr, PluginFieldType::kFLOAT32, 1));
+}
+
+float parseResizeNearestFields(const PluginFieldCollection* fc)
+{
+    float scale{};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "scale"))
+        {
+            assert(fields[i].type == PluginFieldType::kFLOAT32);
+            scale = *(static_cast<const float*>(fields[i].data));
+        }
+    }
+    return scale;
+}
+
+// Resize a batch of nchan x isize images in the given precision and format to osize. Shared by both versions of the
+// plugin, the implicit batch one passes its configured dimensions and the dynamic one those of the descriptors.
+int resizeNearestInference(cudaStream_t stream, int batch, int nchan, float scale, int2 isize, int2 osize,
+    DataType precision, TensorFormat format, float inputScale, float outputScale, const void* input, void* output)
+{
+    int istride = isize.x;
+    int ostride = osize.x;
+    int ibatchstride = isize.y * istride;
+    int obatchstride = osize.y * ostride;
+
+    if (precision == DataType::kFLOAT)
+    {
+        dim3 block(32, 16);
+        dim3 grid((osize.x - 1) / block.x + 1, (osize.y - 1) / block.y + 1, std::min(batch * nchan, 65535));
+
+        resizeNearest(grid, block, stream, batch * nchan, scale, osize, static_cast<float const*>(input), istride,
+            ibatchstride, static_cast<float*>(output), ostride, obatchstride);
+
+        return cudaGetLastError() != cudaSuccess;
+    }
+
+    // The vectorized formats are resized one pixel, i.e. one vector of channels, at a time
+    cudaError_t status = cudaSuccess;
+    if (format == TensorFormat::kLINEAR)
+    {
+        status = resizeNearestPixels(stream, batch * nchan, sizeof(uint16_t), scale, isize, osize, input, output);
+    }
+    else if (format == TensorFormat::kHWC8)
+    {
+        status = resizeNearestPixels(stream, batch, static_cast<int>(nAlignUp(nchan, 8) * sizeof(uint16_t)), scale,
+            isize, osize, input, output);
+    }
+    else if (format == TensorFormat::kCHW16)
+    {
+        status = resizeNearestPixels(
+            stream, batch * ((nchan + 15) / 16), 16 * sizeof(uint16_t), scale, isize, osize, input, output);
+    }
+    else if (inputScale == outputScale)
+    {
+        status = resizeNearestPixels(stream, batch * ((nchan + 31) / 32), 32, scale, isize, osize, input, output);
+    }
+    else
+    {
+        status = resizeNearestInt8(stream, batch * ((nchan + 31) / 32), 32, scale, isize, osize, inputScale,
+            outputScale, static_cast<const int8_t*>(input), static_cast<int8_t*>(output));
+    }
+    return status != cudaSuccess;
+}
 } // namespace
 
 PluginFieldCollection ResizeNearestPluginCreator::mFC{};
 std::vector<PluginField> ResizeNearestPluginCreator::mPluginAttributes;
+PluginFieldCollection ResizeNearestDynamicPluginCreator::mFC{};
+std::vector<PluginField> ResizeNearestDynamicPluginCreator::mPluginAttributes;
 
 ResizeNearestPluginCreator::ResizeNearestPluginCreator()
 {
-    mPluginAttributes.emplace_back(PluginField("scale", nullptr, PluginFieldType::kFLOAT32, 1));
+    addResizeNearestFields(mPluginAttributes);
 
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
@@ -59,17 +137,7 @@ const PluginFieldCollection* ResizeNearestPluginCreator::getFieldNames()
 
 IPluginV2Ext* ResizeNearestPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
 {
-    const PluginField* fields = fc->fields;
-    for (int i = 0; i < fc->nbFields; ++i)
-    {
-        const char* attrName = fields[i].name;
-        if (!strcmp(attrName, "scale"))
-        {
-            assert(fields[i].type == PluginFieldType::kFLOAT32);
-            mScale = *(static_cast<const float*>(fields[i].data));
-        }
-    }
-    return new ResizeNearest(mScale);
+    return new ResizeNearest(parseResizeNearestFields(fc));
 };
 
 IPluginV2Ext* ResizeNearestPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
@@ -129,8 +197,8 @@ size_t ResizeNearest::getWorkspaceSize(int) const
 
 size_t ResizeNearest::getSerializationSize() const
 {
-    // scale, dimensions: 3 * 2
-    return sizeof(float) + sizeof(int) * 3 * 2;
+    // scale, dimensions: 3 * 2, precision, format, input and output scales
+    return sizeof(float) + sizeof(int) * 3 * 2 + sizeof(DataType) + sizeof(TensorFormat) + sizeof(float) * 2;
 };
 
 void ResizeNearest::serialize(void* buffer) const
@@ -143,6 +211,10 @@ void ResizeNearest::serialize(void* buffer) const
     write(d, mOutputDims.d[0]);
     write(d, mOutputDims.d[1]);
     write(d, mOutputDims.d[2]);
+    write(d, mPrecision);
+    write(d, mFormat);
+    write(d, mInputScale);
+    write(d, mOutputScale);
     ASSERT(d == a + getSerializationSize());
 };
 
@@ -158,6 +230,14 @@ ResizeNearest::ResizeNearest(const void* data, size_t length)
     mOutputDims.d[0] = read<int>(d);
     mOutputDims.d[1] = read<int>(d);
     mOutputDims.d[2] = read<int>(d);
+    // Engines serialized before the vectorized formats were added only support FP32 linear
+    if (d < a + length)
+    {
+        mPrecision = read<DataType>(d);
+        mFormat = read<TensorFormat>(d);
+        mInputScale = read<float>(d);
+        mOutputScale = read<float>(d);
+    }
     ASSERT(d == a + length);
 };
 
@@ -186,29 +266,38 @@ const char* ResizeNearest::getPluginNamespace() const
     return mNameSpace.c_str();
 }
 
-bool ResizeNearest::supportsFormat(DataType type, PluginFormat format) const
+bool ResizeNearest::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    ASSERT(nbInputs == 1 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    // The output mirrors the input, the resize only moves whole pixels
+    if (pos == 1)
+    {
+        return inOut[1].type == inOut[0].type && inOut[1].format == inOut[0].format;
+    }
+    switch (inOut[0].type)
+    {
+    case DataType::kFLOAT: return inOut[0].format == TensorFormat::kLINEAR;
+    case DataType::kHALF:
+        return inOut[0].format == TensorFormat::kLINEAR || inOut[0].format == TensorFormat::kHWC8
+            || inOut[0].format == TensorFormat::kCHW16;
+    case DataType::kINT8: return inOut[0].format == TensorFormat::kCHW32;
+    default: return false;
+    }
 };
 
 int ResizeNearest::enqueue(
     int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
 
     int nchan = mOutputDims.d[0];
-    float scale = mScale;
     int2 osize = {mOutputDims.d[2], mOutputDims.d[1]};
-    int istride = mInputDims.d[2];
-    int ostride = mOutputDims.d[2];
-    int ibatchstride = mInputDims.d[1] * istride;
-    int obatchstride = mOutputDims.d[1] * ostride;
-    dim3 block(32, 16);
-    dim3 grid((osize.x - 1) / block.x + 1, (osize.y - 1) / block.y + 1, std::min(batch_size * nchan, 65535));
-
-    resizeNearest(grid, block, stream, batch_size * nchan, scale, osize, static_cast<float const*>(inputs[0]), istride,
-        ibatchstride, static_cast<float*>(outputs[0]), ostride, obatchstride);
-
-    return cudaGetLastError() != cudaSuccess;
+    int2 isize = {mInputDims.d[2], mInputDims.d[1]};
+    return resizeNearestInference(stream, batch_size, nchan, mScale, isize, osize, mPrecision, mFormat, mInputScale,
+        mOutputScale, inputs[0], outputs[0]);
 };
 
 // Return the DataType of the plugin output at the requested index
@@ -217,8 +306,8 @@ DataType ResizeNearest::getOutputDataType(int index, const nvinfer1::DataType* i
     // Only 1 input and 1 output from the plugin layer
     ASSERT(index == 0);
 
-    // Only DataType::kFLOAT is acceptable by the plugin layer
-    return DataType::kFLOAT;
+    // The output has the type of the input
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -234,15 +323,17 @@ bool ResizeNearest::canBroadcastInputAcrossBatch(int inputIndex) const
 }
 
 // Configure the layer with input and output data types.
-void ResizeNearest::configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
-    const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
-    const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize)
+void ResizeNearest::configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
 {
-    assert(nbInputs == 1);
-    mInputDims = inputDims[0];
-
-    assert(nbOutputs == 1);
-    mOutputDims = outputDims[0];
+    assert(nbInput == 1);
+    mInputDims = in[0].dims;
+    mPrecision = in[0].type;
+    mFormat = in[0].format;
+    mInputScale = in[0].scale;
+
+    assert(nbOutput == 1);
+    mOutputDims = out[0].dims;
+    mOutputScale = out[0].scale;
 }
 
 // Attach the plugin object to an execution context and grant the plugin the access to some context resource.
@@ -253,3 +344,190 @@ void ResizeNearest::attachToContext(
 
 // Detach the plugin object from its execution context.
 void ResizeNearest::detachFromContext() {}
+
+ResizeNearestDynamic::ResizeNearestDynamic(float scale)
+    : mScale(scale)
+{
+    ASSERT(mScale > 0);
+}
+
+ResizeNearestDynamic::ResizeNearestDynamic(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mScale = read<float>(d);
+    ASSERT(d == a + length);
+}
+
+int ResizeNearestDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs ResizeNearestDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 1);
+    ASSERT(inputs[0].nbDims == 4);
+    DimsExprs output(inputs[0]);
+    for (int d = 2; d < 4; ++d)
+    {
+        if (mScale >= 1)
+        {
+            const int factor = static_cast<int>(mScale);
+            ASSERT(factor == mScale);
+            output.d[d]
+                = exprBuilder.operation(DimensionOperation::kPROD, *inputs[0].d[d], *exprBuilder.constant(factor));
+        }
+        else
+        {
+            const int factor = static_cast<int>(1 / mScale + 0.5f);
+            ASSERT(factor * mScale == 1);
+            output.d[d]
+                = exprBuilder.operation(DimensionOperation::kFLOOR_DIV, *inputs[0].d[d], *exprBuilder.constant(factor));
+        }
+    }
+    return output;
+}
+
+int ResizeNearestDynamic::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void ResizeNearestDynamic::terminate() {}
+
+size_t ResizeNearestDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return 0;
+}
+
+int ResizeNearestDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const Dims& inputDims = inputDesc[0].dims;
+    const Dims& outputDims = outputDesc[0].dims;
+    int2 isize = {inputDims.d[3], inputDims.d[2]};
+    int2 osize = {outputDims.d[3], outputDims.d[2]};
+    return resizeNearestInference(stream, inputDims.d[0], inputDims.d[1], mScale, isize, osize, inputDesc[0].type,
+        inputDesc[0].format, inputDesc[0].scale, outputDesc[0].scale, inputs[0], outputs[0]);
+}
+
+size_t ResizeNearestDynamic::getSerializationSize() const
+{
+    return sizeof(float);
+}
+
+void ResizeNearestDynamic::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mScale);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void ResizeNearestDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 1);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 4);
+}
+
+bool ResizeNearestDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    // The output mirrors the input, the resize only moves whole pixels
+    if (pos == 1)
+    {
+        return inOut[1].type == inOut[0].type && inOut[1].format == inOut[0].format;
+    }
+    switch (inOut[0].type)
+    {
+    case DataType::kFLOAT: return inOut[0].format == TensorFormat::kLINEAR;
+    case DataType::kHALF:
+        return inOut[0].format == TensorFormat::kLINEAR || inOut[0].format == TensorFormat::kHWC8
+            || inOut[0].format == TensorFormat::kCHW16;
+    case DataType::kINT8: return inOut[0].format == TensorFormat::kCHW32;
+    default: return false;
+    }
+}
+
+const char* ResizeNearestDynamic::getPluginType() const
+{
+    return RESIZE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* ResizeNearestDynamic::getPluginVersion() const
+{
+    return RESIZE_PLUGIN_VERSION;
+}
+
+void ResizeNearestDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* ResizeNearestDynamic::clone() const
+{
+    return new ResizeNearestDynamic(*this);
+}
+
+void ResizeNearestDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* ResizeNearestDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType ResizeNearestDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+ResizeNearestDynamicPluginCreator::ResizeNearestDynamicPluginCreator()
+{
+    addResizeNearestFields(mPluginAttributes);
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* ResizeNearestDynamicPluginCreator::getPluginName() const
+{
+    return RESIZE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* ResizeNearestDynamicPluginCreator::getPluginVersion() const
+{
+    return RESIZE_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* ResizeNearestDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* ResizeNearestDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    auto* plugin = new ResizeNearestDynamic(parseResizeNearestFields(fc));
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* ResizeNearestDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new ResizeNearestDynamic(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
@@ -30,7 +30,7 @@ namespace nvinfer1
 {
 namespace plugin
 {
-class ResizeNearest : public IPluginV2Ext
+class ResizeNearest : public IPluginV2IOExt
 {
 public:
     ResizeNearest(float scale);
@@ -58,8 +58,6 @@ public:
 
     void serialize(void* buffer) const override;
 
-    bool supportsFormat(DataType type, PluginFormat format) const override;
-
     const char* getPluginType() const override;
 
     const char* getPluginVersion() const override;
@@ -79,9 +77,9 @@ public:
     void attachToContext(
         cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override;
 
-    void configurePlugin(const Dims* inputDims, int nbInputs, const Dims* outputDims, int nbOutputs,
-        const DataType* inputTypes, const DataType* outputTypes, const bool* inputIsBroadcast,
-        const bool* outputIsBroadcast, PluginFormat floatFormat, int maxBatchSize) override;
+    void configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
 
     void detachFromContext() override;
 
@@ -89,9 +87,68 @@ private:
     float mScale;
     Dims mInputDims;
     Dims mOutputDims;
+    // FP32 linear, FP16 linear, kHWC8 or kCHW16, or INT8 kCHW32
+    DataType mPrecision{DataType::kFLOAT};
+    TensorFormat mFormat{TensorFormat::kLINEAR};
+    float mInputScale{-1.f};
+    float mOutputScale{-1.f};
     std::string mNameSpace;
 };
 
+// Explicit batch version of ResizeNearest. The input is [N, C, H, W] and the output [N, C, H * scale, W * scale],
+// so the scale or its inverse must be an integer for the output shape to be an expression of the input shape.
+class ResizeNearestDynamic : public IPluginV2DynamicExt
+{
+public:
+    ResizeNearestDynamic(float scale);
+
+    ResizeNearestDynamic(const void* data, size_t length);
+
+    ~ResizeNearestDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    float mScale;
+    std::string mNamespace;
+};
+
 class ResizeNearestPluginCreator : public BaseCreator
 {
 public:
@@ -111,7 +168,29 @@ public:
 
 private:
     static PluginFieldCollection mFC;
-    float mScale;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as ResizeNearest_TRT
+class ResizeNearestDynamicPluginCreator : public BaseCreator
+{
+public:
+    ResizeNearestDynamicPluginCreator();
+
+    ~ResizeNearestDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
 };
 } // namespace plugin
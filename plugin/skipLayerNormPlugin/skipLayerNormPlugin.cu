@@ -17,6 +17,10 @@
 #include "NvInfer.h"
 #include "bertCommon.h"
 #include "skipLayerNormPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "kernelTactics.h"
+#include "nvtxRange.h"
 #include "common.h"
 #include "serialize.hpp"
 
@@ -25,6 +29,7 @@
 #include <vector>
 
 using namespace nvinfer1;
+using nvinfer1::plugin::pluginMalloc;
 using bert::operator+;
 
 namespace bert
@@ -88,44 +93,301 @@ __global__ void skipLayerNormKernel(
     layerNorm<T, T, TPB>(threadData, ld, offset, beta, gamma, output);
 }
 
+// Copies N elements with 128 bit accesses, both pointers must be 16 bytes aligned
+template <typename T, int N>
+__device__ inline void copyVec(const T* src, T* dst)
+{
+    static_assert((N * sizeof(T)) % sizeof(uint4) == 0, "Vector copies move multiples of 16 bytes");
+    const uint4* src4 = reinterpret_cast<const uint4*>(src);
+    uint4* dst4 = reinterpret_cast<uint4*>(dst);
+#pragma unroll
+    for (int it = 0; it < (N * sizeof(T)) / sizeof(uint4); it++)
+    {
+        dst4[it] = src4[it];
+    }
+}
+
+// Partial mean and sum of squared deviations, merged with Chan's parallel update of the Welford algorithm
+struct WelfordData
+{
+    float mean;
+    float m2;
+    float count;
+};
+
+struct WelfordReduce
+{
+    __device__ inline WelfordData operator()(const WelfordData& a, const WelfordData& b) const
+    {
+        const float count = a.count + b.count;
+        if (count == 0.f)
+        {
+            return a;
+        }
+        const float delta = b.mean - a.mean;
+        const float rCount = 1.f / count;
+        return WelfordData{a.mean + delta * b.count * rCount, a.m2 + b.m2 + delta * delta * a.count * b.count * rCount,
+            count};
+    }
+};
+
+//!
+//! Skip layer norm for hidden sizes of exactly TPB * VPT: each thread keeps VPT consecutive values in registers, loaded
+//! and stored with 128 bit accesses, and the statistics are computed in a single pass in FP32
+//!
+template <typename T, unsigned TPB, int VPT, bool hasBias>
+__global__ void skipLayerNormKernelVec(
+    const int ld, const T* input, const T* skip, const float* beta, const float* gamma, T* output, const T* bias)
+{
+    const int offset = blockIdx.x * ld + threadIdx.x * VPT;
+    const int col = threadIdx.x * VPT;
+
+    T inLocal[VPT];
+    T skipLocal[VPT];
+    T biasLocal[VPT];
+    copyVec<T, VPT>(&input[offset], inLocal);
+    copyVec<T, VPT>(&skip[offset], skipLocal);
+    if (hasBias)
+    {
+        copyVec<T, VPT>(&bias[col], biasLocal);
+    }
+
+    float val[VPT];
+    WelfordData threadData{0.f, 0.f, 0.f};
+#pragma unroll
+    for (int it = 0; it < VPT; it++)
+    {
+        val[it] = float(inLocal[it]) + float(skipLocal[it]);
+        if (hasBias)
+        {
+            val[it] += float(biasLocal[it]);
+        }
+        threadData.count += 1.f;
+        const float delta = val[it] - threadData.mean;
+        threadData.mean += delta / threadData.count;
+        threadData.m2 += delta * (val[it] - threadData.mean);
+    }
+
+    using BlockReduce = cub::BlockReduce<WelfordData, TPB>;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ float mu;     // mean
+    __shared__ float rsigma; // 1 / std.dev.
+
+    const WelfordData stats = BlockReduce(tempStorage).Reduce(threadData, WelfordReduce());
+
+    if (threadIdx.x == 0)
+    {
+        mu = stats.mean;
+        rsigma = rsqrt(stats.m2 / stats.count);
+    }
+    __syncthreads();
+
+    float gammaLocal[VPT];
+    float betaLocal[VPT];
+    copyVec<float, VPT>(&gamma[col], gammaLocal);
+    copyVec<float, VPT>(&beta[col], betaLocal);
+
+    T outLocal[VPT];
+#pragma unroll
+    for (int it = 0; it < VPT; it++)
+    {
+        outLocal[it] = T(gammaLocal[it] * (val[it] - mu) * rsigma + betaLocal[it]);
+    }
+    copyVec<T, VPT>(outLocal, &output[offset]);
+}
+
+// Number of elements per 128 bit access
+template <typename T>
+constexpr int vecSize()
+{
+    return sizeof(uint4) / sizeof(T);
+}
+
+bool skipLayerNormTacticApplies(const SkipLayerNormTactic tactic, const int ld)
+{
+    switch (tactic)
+    {
+    case SkipLayerNormTactic::kHEURISTIC: return true;
+    case SkipLayerNormTactic::kVEC: return ld == 768 || ld == 1024;
+    case SkipLayerNormTactic::kSMALL_32: return ld <= 32;
+    case SkipLayerNormTactic::kSMALL_128: return ld <= 128;
+    case SkipLayerNormTactic::kSMALL_384: return ld <= 384;
+    case SkipLayerNormTactic::kLOOP_128:
+    case SkipLayerNormTactic::kLOOP_256:
+    case SkipLayerNormTactic::kLOOP_512:
+    case SkipLayerNormTactic::kLOOP_1024: return true;
+    case SkipLayerNormTactic::kCOUNT: break;
+    }
+    return false;
+}
+
+//! The variant chosen from the hidden size alone, for the plugins that were not timed
+static SkipLayerNormTactic heuristicTactic(const int ld)
+{
+    // The most common BERT hidden sizes use the vectorized kernel
+    if (ld == 768 || ld == 1024)
+    {
+        return SkipLayerNormTactic::kVEC;
+    }
+    if (ld <= 32)
+    {
+        return SkipLayerNormTactic::kSMALL_32;
+    }
+    if (ld <= 128)
+    {
+        return SkipLayerNormTactic::kSMALL_128;
+    }
+    if (ld == 384)
+    {
+        return SkipLayerNormTactic::kSMALL_384;
+    }
+    return SkipLayerNormTactic::kLOOP_256;
+}
+
 template <typename T, bool hasBias>
 int computeSkipLayerNorm(cudaStream_t stream, const int ld, const int n, const T* input, const T* skip,
-    const float* beta, const float* gamma, T* output, const T* bias)
+    const float* beta, const float* gamma, T* output, const T* bias, const SkipLayerNormTactic tactic)
 {
 
     // this must be true because n is the total size of the tensor
     assert(n % ld == 0);
     const int gridSize = n / ld;
-
-    if (ld <= 32)
-    {
-        constexpr int blockSize = 32;
-        skipLayerNormKernelSmall<T, blockSize, hasBias>
-            <<<gridSize, blockSize, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
-    }
-    else if (ld <= 128)
+    constexpr int VPT = vecSize<T>();
+    if (!skipLayerNormTacticApplies(tactic, ld))
     {
-        constexpr int blockSize = 128;
-        skipLayerNormKernelSmall<T, blockSize, hasBias>
-            <<<gridSize, blockSize, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        return -1;
     }
-    else if (ld == 384)
+
+    switch (tactic == SkipLayerNormTactic::kHEURISTIC ? heuristicTactic(ld) : tactic)
     {
-        constexpr int blockSize = 384;
-        skipLayerNormKernelSmall<T, blockSize, hasBias>
-            <<<gridSize, blockSize, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+    case SkipLayerNormTactic::kVEC:
+        if (ld == 768)
+        {
+            constexpr int blockSize = 768 / VPT;
+            skipLayerNormKernelVec<T, blockSize, VPT, hasBias>
+                <<<gridSize, blockSize, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        }
+        else
+        {
+            constexpr int blockSize = 1024 / VPT;
+            skipLayerNormKernelVec<T, blockSize, VPT, hasBias>
+                <<<gridSize, blockSize, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        }
+        break;
+    case SkipLayerNormTactic::kSMALL_32:
+        skipLayerNormKernelSmall<T, 32, hasBias>
+            <<<gridSize, 32, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kSMALL_128:
+        skipLayerNormKernelSmall<T, 128, hasBias>
+            <<<gridSize, 128, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kSMALL_384:
+        skipLayerNormKernelSmall<T, 384, hasBias>
+            <<<gridSize, 384, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kLOOP_128:
+        skipLayerNormKernel<T, 128, hasBias><<<gridSize, 128, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kLOOP_256:
+        skipLayerNormKernel<T, 256, hasBias><<<gridSize, 256, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kLOOP_512:
+        skipLayerNormKernel<T, 512, hasBias><<<gridSize, 512, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kLOOP_1024:
+        skipLayerNormKernel<T, 1024, hasBias>
+            <<<gridSize, 1024, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        break;
+    case SkipLayerNormTactic::kHEURISTIC:
+    case SkipLayerNormTactic::kCOUNT: break;
     }
-    else
+    CHECK(cudaPeekAtLastError());
+
+    return 0;
+}
+
+template int computeSkipLayerNorm<float, false>(cudaStream_t stream, const int ld, const int n, const float* input,
+    const float* skip, const float* beta, const float* gamma, float* output, const float* bias,
+    SkipLayerNormTactic tactic);
+template int computeSkipLayerNorm<float, true>(cudaStream_t stream, const int ld, const int n, const float* input,
+    const float* skip, const float* beta, const float* gamma, float* output, const float* bias,
+    SkipLayerNormTactic tactic);
+template int computeSkipLayerNorm<half, false>(cudaStream_t stream, const int ld, const int n, const half* input,
+    const half* skip, const float* beta, const float* gamma, half* output, const half* bias,
+    SkipLayerNormTactic tactic);
+template int computeSkipLayerNorm<half, true>(cudaStream_t stream, const int ld, const int n, const half* input,
+    const half* skip, const float* beta, const float* gamma, half* output, const half* bias,
+    SkipLayerNormTactic tactic);
+
+template <typename T, unsigned TPB, bool hasBias>
+__global__ void skipLayerNormKernelInt8(const int ld, const int8_t* input, const int8_t* skip, const float* beta,
+    const float* gamma, int8_t* output, const T* bias, const float inScale, const float skipScale,
+    const float outRScale)
+{
+    // The row before normalization, in FP32
+    extern __shared__ float row[];
+
+    const float rld = 1.f / ld;
+    const int offset = blockIdx.x * ld;
+
+    cub::Sum pairSum;
+    // reduce x and x^2
+    kvp<float> threadData(0, 0);
+
+    for (int i = threadIdx.x; i < ld; i += TPB)
     {
-        constexpr int blockSize = 256;
-        skipLayerNormKernel<T, blockSize, hasBias>
-            <<<gridSize, blockSize, 0, stream>>>(ld, input, skip, beta, gamma, output, bias);
+        const int idx = offset + i;
+        float val = dequantize(input[idx], inScale) + dequantize(skip[idx], skipScale);
+
+        if (hasBias)
+        {
+            val += float(bias[i]);
+        }
+        const float rldval = rld * val;
+        threadData = pairSum(threadData, kvp<float>(rldval, rldval * val));
+        row[i] = val;
     }
+
+    layerNormInt8<TPB>(threadData, ld, offset, row, beta, gamma, outRScale, output);
+}
+
+//!
+//! INT8 inputs and output with their per-tensor scales. The bias has the plugin type, the math is FP32.
+//!
+template <typename T, bool hasBias>
+int computeSkipLayerNormInt8(cudaStream_t stream, const int ld, const int n, const int8_t* input,
+    const int8_t* skip, const float* beta, const float* gamma, int8_t* output, const T* bias, const float inScale,
+    const float skipScale, const float outScale)
+{
+
+    // this must be true because n is the total size of the tensor
+    assert(n % ld == 0);
+    const int gridSize = n / ld;
+    constexpr int blockSize = 256;
+    const size_t smemSize = ld * sizeof(float);
+
+    skipLayerNormKernelInt8<T, blockSize, hasBias><<<gridSize, blockSize, smemSize, stream>>>(
+        ld, input, skip, beta, gamma, output, bias, inScale, skipScale, 1.f / outScale);
     CHECK(cudaPeekAtLastError());
 
     return 0;
 }
 
+template <typename T>
+int computeSkipLayerNormInt8(cudaStream_t stream, const int ld, const int n, const int8_t* input,
+    const int8_t* skip, const float* beta, const float* gamma, int8_t* output, const T* bias, const float inScale,
+    const float skipScale, const float outScale)
+{
+    if (bias)
+    {
+        return computeSkipLayerNormInt8<T, true>(
+            stream, ld, n, input, skip, beta, gamma, output, bias, inScale, skipScale, outScale);
+    }
+    return computeSkipLayerNormInt8<T, false>(
+        stream, ld, n, input, skip, beta, gamma, output, bias, inScale, skipScale, outScale);
+}
+
 // Clip plugin specific constants
 namespace
 {
@@ -133,6 +395,56 @@ static const char* SKIP_LAYER_NORM_VERSION{"1"};
 static const char* SKIP_LAYER_NORM_NAME{"CustomSkipLayerNormPluginDynamic"};
 } // namespace
 
+//!
+//! Time the variants that apply to the hidden size over n elements, on scratch buffers, once per GPU and shape
+//!
+template <typename T>
+static SkipLayerNormTactic selectSkipLayerNormTactic(const DataType type, const int ld, const int n, const bool hasBias)
+{
+    T* input{nullptr};
+    T* skip{nullptr};
+    T* output{nullptr};
+    T* bias{nullptr};
+    float* beta{nullptr};
+    float* gamma{nullptr};
+    CHECK(pluginMalloc(&input, n * sizeof(T)));
+    CHECK(pluginMalloc(&skip, n * sizeof(T)));
+    CHECK(pluginMalloc(&output, n * sizeof(T)));
+    CHECK(pluginMalloc(&bias, ld * sizeof(T)));
+    CHECK(pluginMalloc(&beta, ld * sizeof(float)));
+    CHECK(pluginMalloc(&gamma, ld * sizeof(float)));
+    // The values do not change the time of the kernels
+    CHECK(cudaMemset(input, 0, n * sizeof(T)));
+    CHECK(cudaMemset(skip, 0, n * sizeof(T)));
+
+    std::vector<nvinfer1::plugin::KernelTactic> tactics;
+    for (int t = 0; t < static_cast<int>(SkipLayerNormTactic::kCOUNT); ++t)
+    {
+        const auto tactic = static_cast<SkipLayerNormTactic>(t);
+        if (skipLayerNormTacticApplies(tactic, ld))
+        {
+            tactics.push_back({t, [=](cudaStream_t stream) {
+                return hasBias ? computeSkipLayerNorm<T, true>(
+                                     stream, ld, n, input, skip, beta, gamma, output, bias, tactic)
+                               : computeSkipLayerNorm<T, false>(
+                                     stream, ld, n, input, skip, beta, gamma, output, bias, tactic);
+            }});
+        }
+    }
+    nvinfer1::plugin::KernelTacticKey key{};
+    key.plugin = SKIP_LAYER_NORM_NAME;
+    key.dataType = static_cast<int>(type);
+    key.shape = {ld, n, hasBias};
+    const int selected = nvinfer1::plugin::selectKernelTactic(key, tactics);
+
+    for (void* p : {static_cast<void*>(input), static_cast<void*>(skip), static_cast<void*>(output),
+             static_cast<void*>(bias), static_cast<void*>(beta), static_cast<void*>(gamma)})
+    {
+        nvinfer1::plugin::pluginFree(p);
+    }
+    return selected < 0 ? SkipLayerNormTactic::kHEURISTIC : static_cast<SkipLayerNormTactic>(selected);
+}
+
 // Static class fields initialization
 PluginFieldCollection SkipLayerNormPluginDynamicCreator::mFC{};
 std::vector<PluginField> SkipLayerNormPluginDynamicCreator::mPluginAttributes;
@@ -174,12 +486,20 @@ SkipLayerNormPluginDynamic::SkipLayerNormPluginDynamic(const std::string name, c
     deserialize_value(&data, &length, &mHasBias);
 
     const char* d = static_cast<const char*>(data);
-    mBetaDev = deserToDev<float>(d, mLd);
-    mGammaDev = deserToDev<float>(d, mLd);
+    mStaged.stage<float>(d, mLd);
+    mStaged.stage<float>(d, mLd);
+    length -= 2 * mLd * sizeof(float);
     if (mHasBias)
     {
         const size_t wordSize = samplesCommon::getElementSize(mType);
-        mBiasDev = deserToDev<char>(d, mLd * wordSize);
+        mStaged.stage<char>(d, mLd * wordSize);
+        length -= mLd * wordSize;
+    }
+    // Engines serialized before the kernel variants were timed end with the weights
+    if (length > 0)
+    {
+        data = d;
+        deserialize_value(&data, &length, &mTactic);
     }
     // this signals init not to allocate/copy
     mGamma.count = mLd;
@@ -195,11 +515,15 @@ SkipLayerNormPluginDynamic::SkipLayerNormPluginDynamic(const std::string name, c
 // IPluginV2DynamicExt Methods
 IPluginV2DynamicExt* SkipLayerNormPluginDynamic::clone() const
 {
-    if (mHasBias)
-    {
-        return new SkipLayerNormPluginDynamic(mLayerName, mType, mLd, mBeta, mGamma, mBias);
-    }
-    return new SkipLayerNormPluginDynamic(mLayerName, mType, mLd, mBeta, mGamma);
+    auto ret = mHasBias ? new SkipLayerNormPluginDynamic(mLayerName, mType, mLd, mBeta, mGamma, mBias)
+                        : new SkipLayerNormPluginDynamic(mLayerName, mType, mLd, mBeta, mGamma);
+    // Clones share the device weights instead of uploading their own copy in initialize()
+    ret->mGammaDev = mGammaDev;
+    ret->mBetaDev = mBetaDev;
+    ret->mBiasDev = mBiasDev;
+    ret->mStaged = mStaged;
+    ret->mTactic = mTactic;
+    return ret;
 }
 
 DimsExprs SkipLayerNormPluginDynamic::getOutputDimensions(
@@ -220,8 +544,8 @@ bool SkipLayerNormPluginDynamic::supportsFormatCombination(
     const PluginTensorDesc& in = inOut[pos];
     if (pos == 0)
     {
-        // return (in.type == DataType::kFLOAT || in.type == DataType::kHALF) && (in.format == TensorFormat::kLINEAR);
-        return (in.type == mType) && (in.format == TensorFormat::kLINEAR);
+        // INT8 I/O is quantized with the tensor scales, the bias keeps the plugin type
+        return (in.type == mType || in.type == DataType::kINT8) && (in.format == TensorFormat::kLINEAR);
     }
     const PluginTensorDesc& prev = inOut[pos - 1];
 
@@ -239,8 +563,8 @@ void SkipLayerNormPluginDynamic::configurePlugin(
     // Validate input arguments
     assert(nbOutputs == 1);
     assert(nbInputs == 2);
-    assert(mType == inputs[0].desc.type);
-    assert(mType == inputs[1].desc.type);
+    assert(mType == inputs[0].desc.type || inputs[0].desc.type == DataType::kINT8);
+    assert(inputs[0].desc.type == inputs[1].desc.type);
     const auto& inDims0 = inputs[0].desc.dims;
     const auto& inDims1 = inputs[1].desc.dims;
     TRT_UNUSED inDims1;
@@ -252,6 +576,15 @@ void SkipLayerNormPluginDynamic::configurePlugin(
     mLd = inDims0.d[HDIM]; // hiddensize
     assert(inDims0.d[3] == 1);
     assert(inDims0.d[4] == 1);
+
+    // The INT8 kernel has a single variant, the others are timed for the largest shape of the profile
+    if (mTactic == SkipLayerNormTactic::kHEURISTIC && inputs[0].desc.type != DataType::kINT8)
+    {
+        const int n = volume(inputs[0].max);
+        mTactic = mType == DataType::kFLOAT ? selectSkipLayerNormTactic<float>(mType, mLd, n, mHasBias)
+                                            : selectSkipLayerNormTactic<half>(mType, mLd, n, mHasBias);
+        gLogVerbose << "SkipLayerNorm tactic " << static_cast<int>(mTactic) << " for hidden size " << mLd << std::endl;
+    }
 }
 
 size_t SkipLayerNormPluginDynamic::getWorkspaceSize(
@@ -263,27 +596,53 @@ size_t SkipLayerNormPluginDynamic::getWorkspaceSize(
 int SkipLayerNormPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
     const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(mLayerName.c_str());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), mLayerName.c_str());
+    mStaged.wait();
     const int inputVolume = volume(inputDesc[0].dims);
     int status = -1;
 
     // Our plugin outputs only one tensor
     // Launch CUDA kernel wrapper and save its return value
-    if (mType == DataType::kFLOAT)
+    if (inputDesc[0].type == DataType::kINT8)
+    {
+        const int8_t* input = static_cast<const int8_t*>(inputs[0]);
+        const int8_t* skip = static_cast<const int8_t*>(inputs[1]);
+        int8_t* output = static_cast<int8_t*>(outputs[0]);
+        const float inScale = inputDesc[0].scale;
+        const float skipScale = inputDesc[1].scale;
+        const float outScale = outputDesc[0].scale;
+
+        if (mType == DataType::kHALF)
+        {
+            const half* bias = mHasBias ? reinterpret_cast<half*>(mBiasDev.get()) : nullptr;
+            status = computeSkipLayerNormInt8(stream, mLd, inputVolume, input, skip, mBetaDev.get(), mGammaDev.get(),
+                output, bias, inScale, skipScale, outScale);
+        }
+        else
+        {
+            const float* bias = mHasBias ? reinterpret_cast<float*>(mBiasDev.get()) : nullptr;
+            status = computeSkipLayerNormInt8(stream, mLd, inputVolume, input, skip, mBetaDev.get(), mGammaDev.get(),
+                output, bias, inScale, skipScale, outScale);
+        }
+    }
+    else if (mType == DataType::kFLOAT)
     {
         const float* input = static_cast<const float*>(inputs[0]);
         const float* skip = static_cast<const float*>(inputs[1]);
         float* output = static_cast<float*>(outputs[0]);
 
-        float* bias = reinterpret_cast<float*>(mBiasDev);
+        float* bias = reinterpret_cast<float*>(mBiasDev.get());
         if (mHasBias)
         {
             status = computeSkipLayerNorm<float, true>(
-                stream, mLd, inputVolume, input, skip, mBetaDev, mGammaDev, output, bias);
+                stream, mLd, inputVolume, input, skip, mBetaDev.get(), mGammaDev.get(), output, bias, mTactic);
         }
         else
         {
             status = computeSkipLayerNorm<float, false>(
-                stream, mLd, inputVolume, input, skip, mBetaDev, mGammaDev, output, bias);
+                stream, mLd, inputVolume, input, skip, mBetaDev.get(), mGammaDev.get(), output, bias, mTactic);
         }
     }
     else if (mType == DataType::kHALF)
@@ -291,17 +650,17 @@ int SkipLayerNormPluginDynamic::enqueue(const PluginTensorDesc* inputDesc, const
         const half* input = static_cast<const half*>(inputs[0]);
         const half* skip = static_cast<const half*>(inputs[1]);
         half* output = static_cast<half*>(outputs[0]);
-        half* bias = reinterpret_cast<half*>(mBiasDev);
+        half* bias = reinterpret_cast<half*>(mBiasDev.get());
 
         if (mHasBias)
         {
             status = computeSkipLayerNorm<half, true>(
-                stream, mLd, inputVolume, input, skip, mBetaDev, mGammaDev, output, bias);
+                stream, mLd, inputVolume, input, skip, mBetaDev.get(), mGammaDev.get(), output, bias, mTactic);
         }
         else
         {
             status = computeSkipLayerNorm<half, false>(
-                stream, mLd, inputVolume, input, skip, mBetaDev, mGammaDev, output, bias);
+                stream, mLd, inputVolume, input, skip, mBetaDev.get(), mGammaDev.get(), output, bias, mTactic);
         }
     }
     else
@@ -317,7 +676,7 @@ DataType SkipLayerNormPluginDynamic::getOutputDataType(int index, const DataType
 {
     assert(index == 0);
     assert(nbInputs == 2);
-    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF);
+    assert(inputTypes[0] == DataType::kFLOAT || inputTypes[0] == DataType::kHALF || inputTypes[0] == DataType::kINT8);
     assert(inputTypes[0] == inputTypes[1]);
     return inputTypes[0];
 }
@@ -339,31 +698,47 @@ int SkipLayerNormPluginDynamic::getNbOutputs() const
 }
 int SkipLayerNormPluginDynamic::initialize()
 {
-    if (mGamma.values)
+    // The weights staged at deserialization are uploaded together with those of the other plugins
+    if (!mStaged.empty() && !mBetaDev)
     {
-        CHECK(cudaMalloc(&mGammaDev, sizeof(float) * mGamma.count));
-        CHECK(cudaMemcpy(mGammaDev, mGamma.values, sizeof(float) * mGamma.count, cudaMemcpyHostToDevice));
+        mStaged.resolve(0, mBetaDev);
+        mStaged.resolve(1, mGammaDev);
+        if (mHasBias)
+        {
+            mStaged.resolve(2, mBiasDev);
+        }
+    }
+    if (mGamma.values && !mGammaDev)
+    {
+        float* gamma{nullptr};
+        CHECK(pluginMalloc(&gamma, sizeof(float) * mGamma.count));
+        make_cuda_shared(mGammaDev, gamma);
+        CHECK(cudaMemcpy(gamma, mGamma.values, sizeof(float) * mGamma.count, cudaMemcpyHostToDevice));
     }
-    if (mBeta.values)
+    if (mBeta.values && !mBetaDev)
     {
-        CHECK(cudaMalloc(&mBetaDev, sizeof(float) * mBeta.count));
-        CHECK(cudaMemcpy(mBetaDev, mBeta.values, sizeof(float) * mGamma.count, cudaMemcpyHostToDevice));
+        float* beta{nullptr};
+        CHECK(pluginMalloc(&beta, sizeof(float) * mBeta.count));
+        make_cuda_shared(mBetaDev, beta);
+        CHECK(cudaMemcpy(beta, mBeta.values, sizeof(float) * mGamma.count, cudaMemcpyHostToDevice));
     }
 
-    if (mHasBias && mBias.values)
+    if (mHasBias && mBias.values && !mBiasDev)
     {
         // target size
         const size_t wordSize = samplesCommon::getElementSize(mType);
         const size_t nbBytes = mBias.count * wordSize;
-        CHECK(cudaMalloc(&mBiasDev, nbBytes));
+        char* bias{nullptr};
+        CHECK(pluginMalloc(&bias, nbBytes));
+        make_cuda_shared(mBiasDev, bias);
 
         if (mType == DataType::kFLOAT)
         {
-            convertAndCopyToDevice(mBias, reinterpret_cast<float*>(mBiasDev));
+            convertAndCopyToDevice(mBias, reinterpret_cast<float*>(bias));
         }
         else
         {
-            convertAndCopyToDevice(mBias, reinterpret_cast<half*>(mBiasDev));
+            convertAndCopyToDevice(mBias, reinterpret_cast<half*>(bias));
         }
     }
     return 0;
@@ -371,20 +746,14 @@ int SkipLayerNormPluginDynamic::initialize()
 
 void SkipLayerNormPluginDynamic::terminate()
 {
-    gLogVerbose << "SKIPLN terminate start" << std::endl;
-    cudaFree(mGammaDev);
-    cudaFree(mBetaDev);
-    if (mHasBias)
-    {
-        cudaFree(mBiasDev);
-    }
-    gLogVerbose << "SKIPLN terminate done" << std::endl;
+    // The device weights are shared with the clones and released with the last plugin holding them
+    gLogVerbose << "SKIPLN terminate" << std::endl;
 }
 
 size_t SkipLayerNormPluginDynamic::getSerializationSize() const
 {
     size_t biasSize = mHasBias ? (mLd * samplesCommon::getElementSize(mType)) : 0;
-    return 2 * sizeof(float) * mLd + sizeof(DataType) + sizeof(mLd) + biasSize + sizeof(mHasBias);
+    return 2 * sizeof(float) * mLd + sizeof(DataType) + sizeof(mLd) + biasSize + sizeof(mHasBias) + sizeof(mTactic);
 }
 
 void SkipLayerNormPluginDynamic::serialize(void* buffer) const
@@ -393,14 +762,18 @@ void SkipLayerNormPluginDynamic::serialize(void* buffer) const
     serialize_value(&buffer, mLd);
     serialize_value(&buffer, mHasBias);
 
+    // Each weight is stored as the kernels read it, so that deserialization stages it without a conversion: beta and
+    // gamma in FP32 for the normalization, the bias in the precision of the plugin
     char* d = static_cast<char*>(buffer);
-    serFromDev(d, mBetaDev, mLd);
-    serFromDev(d, mGammaDev, mLd);
+    serFromDev(d, mBetaDev.get(), mLd);
+    serFromDev(d, mGammaDev.get(), mLd);
     if (mHasBias)
     {
         const size_t wordSize = samplesCommon::getElementSize(mType);
-        serFromDev(d, mBiasDev, mLd * wordSize);
+        serFromDev(d, mBiasDev.get(), mLd * wordSize);
     }
+    buffer = d;
+    serialize_value(&buffer, mTactic);
 }
 
 void SkipLayerNormPluginDynamic::destroy()
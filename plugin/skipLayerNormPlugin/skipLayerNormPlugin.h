@@ -18,11 +18,43 @@
 #define TRT_SKIP_LAYER_NORM_PLUGIN_H
 
 #include "NvInferPlugin.h"
+#include "bertCommon.h"
 #include <string>
 #include <vector>
 
 namespace bert
 {
+
+//!
+//! Kernel variants of the skip layer norm, timed at build time for the shape of the plugin and serialized with it
+//!
+enum class SkipLayerNormTactic : int32_t
+{
+    kHEURISTIC = -1, //!< Chosen from the hidden size, for engines serialized before the variants were timed
+    kVEC = 0,        //!< A 16 byte vector per thread, for hidden sizes of 768 and 1024
+    kSMALL_32,       //!< A value per thread, for hidden sizes up to the block size
+    kSMALL_128,
+    kSMALL_384,
+    kLOOP_128,       //!< A strided loop over the row, for any hidden size
+    kLOOP_256,
+    kLOOP_512,
+    kLOOP_1024,
+    kCOUNT,
+};
+
+bool skipLayerNormTacticApplies(SkipLayerNormTactic tactic, int ld);
+
+//!
+//! output = LayerNorm(input + skip + bias) over rows of ld elements, n is the total number of elements. The output may
+//! be the input or the skip.
+//!
+//! \return -1 if the tactic does not apply to ld, 0 otherwise
+//!
+template <typename T, bool hasBias>
+int computeSkipLayerNorm(cudaStream_t stream, const int ld, const int n, const T* input, const T* skip,
+    const float* beta, const float* gamma, T* output, const T* bias,
+    SkipLayerNormTactic tactic = SkipLayerNormTactic::kHEURISTIC);
+
 // One of the preferred ways of making TensorRT to be able to see
 // our custom layer requires extending IPluginV2 and IPluginCreator classes.
 // For requirements for overriden functions, check TensorRT API docs.
@@ -74,16 +106,21 @@ private:
     const std::string mLayerName;
     std::string mNamespace;
 
-    float* mGammaDev;
-    float* mBetaDev;
+    bert::cuda_shared_ptr<float> mGammaDev;
+    bert::cuda_shared_ptr<float> mBetaDev;
     size_t mLd; // leading dim
     nvinfer1::Weights mBeta;
     nvinfer1::Weights mGamma;
     nvinfer1::DataType mType;
 
     bool mHasBias;
-    char* mBiasDev;
+    bert::cuda_shared_ptr<char> mBiasDev;
     nvinfer1::Weights mBias;
+
+    // Weights of a deserialized plugin, staged in order beta, gamma, bias
+    bert::StagedWeights mStaged;
+
+    SkipLayerNormTactic mTactic{SkipLayerNormTactic::kHEURISTIC}; // Of the FP32 and FP16 kernels
     
 protected:
     // To prevent compiler warnings.
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Device code of the SoftmaxTopK plugin. It is compiled by nvcc into the kernels of every capacity, and embedded in
+// the plugin library as the source NVRTC compiles the kernels specialized for the classes and k of a plugin from, so
+// it does not include the toolkit headers when compiled at runtime.
+#ifndef TRT_SOFTMAX_TOPK_DEVICE_CUH
+#define TRT_SOFTMAX_TOPK_DEVICE_CUH
+
+#ifndef __CUDACC_RTC__
+#include <cuda_fp16.h>
+#endif
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace softmaxTopKDevice
+{
+
+constexpr int kThreads = 256;
+constexpr int kWarpSize = 32;
+constexpr int kWarps = kThreads / kWarpSize;
+
+//! Class of the candidates past the end of a list, sorted after every class
+constexpr int kNoClass = 0x7fffffff;
+
+__device__ inline float negativeInfinity()
+{
+    return -__int_as_float(0x7f800000);
+}
+
+__device__ inline float toFloat(float x)
+{
+    return x;
+}
+
+#ifndef __CUDACC_RTC__
+__device__ inline float toFloat(__half x)
+{
+    return __half2float(x);
+}
+#endif
+
+// Ties go to the lowest class, so that the selection does not depend on which thread read which class
+__device__ inline bool better(float a, int ia, float b, int ib)
+{
+    return a > b || (a == b && ia < ib);
+}
+
+// The best candidates a thread has seen, in decreasing order
+template <int kCapacity>
+struct TopKList
+{
+    float score[kCapacity];
+    int index[kCapacity];
+    int size{0};
+
+    __device__ void insert(float s, int i, int k)
+    {
+        // Past the first k candidates of the thread, most are rejected by this one comparison
+        if (size == k && !better(s, i, score[k - 1], index[k - 1]))
+        {
+            return;
+        }
+        int p = size < k ? size++ : k - 1;
+        for (; p > 0 && better(s, i, score[p - 1], index[p - 1]); --p)
+        {
+            score[p] = score[p - 1];
+            index[p] = index[p - 1];
+        }
+        score[p] = s;
+        index[p] = i;
+    }
+};
+
+// Largest logit of a part of a row and sum of the exponentials of its logits relative to it
+struct SoftmaxState
+{
+    float max;
+    float sum;
+};
+
+__device__ inline void accumulate(SoftmaxState& state, float x)
+{
+    if (x > state.max)
+    {
+        state.sum = state.sum * __expf(state.max - x) + 1.F;
+        state.max = x;
+    }
+    else if (x > negativeInfinity())
+    {
+        state.sum += __expf(x - state.max);
+    }
+}
+
+__device__ inline SoftmaxState combine(const SoftmaxState& a, const SoftmaxState& b)
+{
+    const float m = fmaxf(a.max, b.max);
+    if (m == negativeInfinity())
+    {
+        return a;
+    }
+    return {m, a.sum * __expf(a.max - m) + b.sum * __expf(b.max - m)};
+}
+
+__device__ inline SoftmaxState warpCombine(SoftmaxState state)
+{
+    for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+    {
+        const SoftmaxState other{
+            __shfl_xor_sync(0xffffffff, state.max, offset), __shfl_xor_sync(0xffffffff, state.sum, offset)};
+        state = combine(state, other);
+    }
+    return state;
+}
+
+// Merges the lists of the lanes of a warp into the k best candidates of the warp, which the first lane writes in
+// decreasing order. Each round reduces the heads of the lists to the best one, whose lane moves on to its next.
+template <int kCapacity>
+__device__ void warpSelect(const TopKList<kCapacity>& list, int k, float* scores, int* indices)
+{
+    const int lane = threadIdx.x % kWarpSize;
+    int head = 0;
+    for (int r = 0; r < k; ++r)
+    {
+        float s = head < list.size ? list.score[head] : negativeInfinity();
+        int i = head < list.size ? list.index[head] : kNoClass;
+        for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+        {
+            const float otherScore = __shfl_xor_sync(0xffffffff, s, offset);
+            const int otherIndex = __shfl_xor_sync(0xffffffff, i, offset);
+            if (better(otherScore, otherIndex, s, i))
+            {
+                s = otherScore;
+                i = otherIndex;
+            }
+        }
+        // The classes are unique, only the lane the best one came from holds it
+        if (head < list.size && list.index[head] == i)
+        {
+            ++head;
+        }
+        if (lane == 0)
+        {
+            scores[r] = s;
+            indices[r] = i;
+        }
+    }
+}
+
+// One block per row. Every thread reads a strided share of the row, keeping its k best logits and the softmax state
+// of its share, every warp selects the k best of its lanes, and the first warp the k best of the warps. The kernels
+// compiled at runtime give the classes and k of the plugin as kClasses and kK, the loops on them then have constant
+// trip counts and the lists hold exactly k candidates.
+template <int kCapacity, typename T, int kClasses = 0, int kK = 0>
+__global__ void __launch_bounds__(kThreads) softmaxTopKKernel(
+    int classes, int k, bool logSoftmax, const T* logits, float* scores, int* indices)
+{
+    __shared__ float warpScores[kWarps * kCapacity];
+    __shared__ int warpIndices[kWarps * kCapacity];
+    __shared__ SoftmaxState warpStates[kWarps];
+
+    if (kClasses)
+    {
+        classes = kClasses;
+    }
+    if (kK)
+    {
+        k = kK;
+    }
+    const int warp = threadIdx.x / kWarpSize;
+    const int lane = threadIdx.x % kWarpSize;
+    const T* row = logits + static_cast<size_t>(blockIdx.x) * classes;
+
+    TopKList<kCapacity> list;
+    SoftmaxState state{negativeInfinity(), 0.F};
+    for (int c = threadIdx.x; c < classes; c += kThreads)
+    {
+        const float x = toFloat(row[c]);
+        // NaN logits are left out
+        if (x != x)
+        {
+            continue;
+        }
+        accumulate(state, x);
+        list.insert(x, c, k);
+    }
+    state = warpCombine(state);
+    warpSelect(list, k, warpScores + warp * kCapacity, warpIndices + warp * kCapacity);
+    if (lane == 0)
+    {
+        warpStates[warp] = state;
+    }
+    __syncthreads();
+    if (warp)
+    {
+        return;
+    }
+
+    TopKList<kCapacity> merged;
+    for (int c = lane; c < kWarps * k; c += kWarpSize)
+    {
+        const int candidate = c / k * kCapacity + c % k;
+        merged.insert(warpScores[candidate], warpIndices[candidate], k);
+    }
+    SoftmaxState total = warpStates[0];
+    for (int w = 1; w < kWarps; ++w)
+    {
+        total = combine(total, warpStates[w]);
+    }
+    float* rowScores = scores + static_cast<size_t>(blockIdx.x) * k;
+    int* rowIndices = indices + static_cast<size_t>(blockIdx.x) * k;
+    warpSelect(merged, k, rowScores, rowIndices);
+    __syncwarp();
+
+    // The selection runs on the logits, which the softmax keeps in the same order
+    const float logSum = __logf(total.sum);
+    for (int r = lane; r < k; r += kWarpSize)
+    {
+        const float x = rowScores[r];
+        rowScores[r] = logSoftmax ? x - total.max - logSum : __expf(x - total.max) / total.sum;
+        if (rowIndices[r] == kNoClass)
+        {
+            rowIndices[r] = -1;
+        }
+    }
+}
+
+} // namespace softmaxTopKDevice
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_SOFTMAX_TOPK_DEVICE_CUH
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "softmaxTopKKernels.h"
+#include "softmaxTopKDevice.cuh"
+#include "softmaxTopKDeviceSource.h"
+#include <cuda_fp16.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+using namespace softmaxTopKDevice;
+
+template <int kCapacity, typename T>
+void launchWithCapacity(cudaStream_t stream, int batch, int classes, int k, bool logSoftmax, const T* logits,
+    float* scores, int* indices)
+{
+    softmaxTopKKernel<kCapacity, T>
+        <<<batch, kThreads, 0, stream>>>(classes, k, logSoftmax, logits, scores, indices);
+}
+
+// The lists of the threads are sized for the smallest capacity that holds k, larger lists live in local memory
+template <typename T>
+void launchSoftmaxTopK(cudaStream_t stream, int batch, int classes, int k, bool logSoftmax, const T* logits,
+    float* scores, int* indices)
+{
+    if (k <= 8)
+    {
+        launchWithCapacity<8>(stream, batch, classes, k, logSoftmax, logits, scores, indices);
+    }
+    else if (k <= 32)
+    {
+        launchWithCapacity<32>(stream, batch, classes, k, logSoftmax, logits, scores, indices);
+    }
+    else
+    {
+        launchWithCapacity<kMaxSoftmaxTopK>(stream, batch, classes, k, logSoftmax, logits, scores, indices);
+    }
+}
+
+} // namespace
+
+cudaError_t softmaxTopK(cudaStream_t stream, int batch, int classes, int k, bool logSoftmax, DataType inputType,
+    const void* logits, float* scores, int* indices)
+{
+    if (!batch)
+    {
+        return cudaSuccess;
+    }
+    if (k < 1 || k > kMaxSoftmaxTopK)
+    {
+        return cudaErrorInvalidValue;
+    }
+    if (inputType == DataType::kHALF)
+    {
+        launchSoftmaxTopK(
+            stream, batch, classes, k, logSoftmax, static_cast<const __half*>(logits), scores, indices);
+    }
+    else
+    {
+        launchSoftmaxTopK(
+            stream, batch, classes, k, logSoftmax, static_cast<const float*>(logits), scores, indices);
+    }
+    return cudaPeekAtLastError();
+}
+
+const char* softmaxTopKJitSource()
+{
+    return kSoftmaxTopKDeviceSource;
+}
+
+std::string softmaxTopKJitName(int classes, int k)
+{
+    // The lists hold exactly k candidates
+    return "nvinfer1::plugin::softmaxTopKDevice::softmaxTopKKernel<" + std::to_string(k) + ", float, "
+        + std::to_string(classes) + ", " + std::to_string(k) + ">";
+}
+
+cudaError_t softmaxTopKJit(const JitKernel& kernel, cudaStream_t stream, int batch, int classes, int k,
+    bool logSoftmax, const float* logits, float* scores, int* indices)
+{
+    if (!batch)
+    {
+        return cudaSuccess;
+    }
+    void* args[]{&classes, &k, &logSoftmax, &logits, &scores, &indices};
+    return kernel.launch(dim3(batch), dim3(kThreads), 0, stream, args) ? cudaSuccess : cudaErrorLaunchFailure;
+}
+
+} // namespace plugin
+} // namespace nvinfer1
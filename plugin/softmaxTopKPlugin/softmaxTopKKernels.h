@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_SOFTMAX_TOPK_KERNELS_H
+#define TRT_SOFTMAX_TOPK_KERNELS_H
+#include "NvInfer.h"
+#include "jitKernels.h"
+#include <cuda_runtime.h>
+#include <string>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Largest k of softmaxTopK, every thread keeps the k best classes of its share of a row
+constexpr int kMaxSoftmaxTopK = 128;
+
+// Keeps the k largest of the classes FP32 or FP16 logits of each of the batch rows, in decreasing order, along with
+// their class indices, and scores them with the softmax of the row, or its logarithm with logSoftmax. Each row is read
+// once, the largest logit and the sum of the exponentials are accumulated along with the selection. NaN logits are
+// left out, a row with fewer than k other logits pads its classes with -1.
+cudaError_t softmaxTopK(cudaStream_t stream, int batch, int classes, int k, bool logSoftmax, DataType inputType,
+    const void* logits, float* scores, int* indices);
+
+// Source of the kernels compiled at runtime for the classes and k of a plugin, with a constant number of classes and
+// lists of exactly k candidates
+const char* softmaxTopKJitSource();
+
+// Name expression of the kernel of softmaxTopKJitSource for FP32 logits with classes and k
+std::string softmaxTopKJitName(int classes, int k);
+
+// softmaxTopK of FP32 logits with the kernel compiled from softmaxTopKJitName(classes, k)
+cudaError_t softmaxTopKJit(const JitKernel& kernel, cudaStream_t stream, int batch, int classes, int k,
+    bool logSoftmax, const float* logits, float* scores, int* indices);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_SOFTMAX_TOPK_KERNELS_H
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "softmaxTopKPlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
+#include <cstring>
+
+using namespace nvinfer1;
+using namespace plugin;
+using nvinfer1::plugin::SoftmaxTopKPlugin;
+using nvinfer1::plugin::SoftmaxTopKPluginCreator;
+
+namespace
+{
+const char* SOFTMAX_TOPK_PLUGIN_VERSION{"1"};
+const char* SOFTMAX_TOPK_PLUGIN_NAME{"SoftmaxTopK_TRT"};
+
+// The classes of a batch item are all the elements of its input, such as the [C, 1, 1] output of a classifier
+int flatVolume(const Dims& dims)
+{
+    int v{1};
+    for (int i = 0; i < dims.nbDims; ++i)
+    {
+        v *= dims.d[i];
+    }
+    return v;
+}
+} // namespace
+
+PluginFieldCollection SoftmaxTopKPluginCreator::mFC{};
+std::vector<PluginField> SoftmaxTopKPluginCreator::mPluginAttributes;
+
+SoftmaxTopKPluginCreator::SoftmaxTopKPluginCreator()
+{
+    mPluginAttributes.emplace_back(PluginField("k", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("log_softmax", nullptr, PluginFieldType::kINT32, 1));
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* SoftmaxTopKPluginCreator::getPluginName() const
+{
+    return SOFTMAX_TOPK_PLUGIN_NAME;
+}
+
+const char* SoftmaxTopKPluginCreator::getPluginVersion() const
+{
+    return SOFTMAX_TOPK_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* SoftmaxTopKPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2Ext* SoftmaxTopKPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    int k{5};
+    int logSoftmax{0};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "k"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            k = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "log_softmax"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            logSoftmax = *static_cast<const int*>(fields[i].data);
+        }
+    }
+    ASSERT(k > 0 && k <= kMaxSoftmaxTopK);
+    auto* plugin = new SoftmaxTopKPlugin(k, logSoftmax != 0);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2Ext* SoftmaxTopKPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
+{
+    auto* plugin = new SoftmaxTopKPlugin(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+SoftmaxTopKPlugin::SoftmaxTopKPlugin(int k, bool logSoftmax)
+    : mK(k)
+    , mLogSoftmax(logSoftmax)
+{
+}
+
+SoftmaxTopKPlugin::SoftmaxTopKPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mK = read<int>(d);
+    mLogSoftmax = read<int>(d) != 0;
+    mClasses = read<int>(d);
+    mInputType = read<DataType>(d);
+    // Plans serialized before the kernels were compiled at runtime end here
+    if (d < a + length)
+    {
+        std::shared_ptr<JitKernel> jit{new JitKernel};
+        if (jit->deserialize(d, a + length))
+        {
+            mJit = jit;
+        }
+    }
+    ASSERT(d == a + length);
+}
+
+int SoftmaxTopKPlugin::getNbOutputs() const
+{
+    return 2;
+}
+
+Dims SoftmaxTopKPlugin::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
+{
+    ASSERT(index < 2 && nbInputDims == 1 && flatVolume(inputs[0]) >= mK);
+    Dims output;
+    output.nbDims = 1;
+    output.d[0] = mK;
+    return output;
+}
+
+int SoftmaxTopKPlugin::initialize()
+{
+    // A cubin deserialized for another device, or none, is compiled again, the precompiled kernels run if it fails
+    if (!mJit && mInputType == DataType::kFLOAT && isJitAvailable())
+    {
+        std::shared_ptr<JitKernel> jit{new JitKernel};
+        if (jit->compile(softmaxTopKJitSource(), softmaxTopKJitName(mClasses, mK), {}))
+        {
+            mJit = jit;
+        }
+    }
+    return 0;
+}
+
+void SoftmaxTopKPlugin::terminate() {}
+
+void SoftmaxTopKPlugin::destroy()
+{
+    delete this;
+}
+
+size_t SoftmaxTopKPlugin::getWorkspaceSize(int maxBatchSize) const
+{
+    return 0;
+}
+
+int SoftmaxTopKPlugin::enqueue(
+    int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const cudaError_t status = mJit
+        ? softmaxTopKJit(*mJit, stream, batch_size, mClasses, mK, mLogSoftmax, static_cast<const float*>(inputs[0]),
+            static_cast<float*>(outputs[0]), static_cast<int*>(outputs[1]))
+        : softmaxTopK(stream, batch_size, mClasses, mK, mLogSoftmax, mInputType, inputs[0],
+            static_cast<float*>(outputs[0]), static_cast<int*>(outputs[1]));
+    return status != cudaSuccess;
+}
+
+size_t SoftmaxTopKPlugin::getSerializationSize() const
+{
+    // k, log softmax, classes, input type, specialized kernel
+    return sizeof(int) * 3 + sizeof(DataType)
+        + (mJit ? mJit->getSerializationSize() : JitKernel().getSerializationSize());
+}
+
+void SoftmaxTopKPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mK);
+    write(d, static_cast<int>(mLogSoftmax));
+    write(d, mClasses);
+    write(d, mInputType);
+    if (mJit)
+    {
+        mJit->serialize(d);
+    }
+    else
+    {
+        JitKernel{}.serialize(d);
+    }
+    ASSERT(d == a + getSerializationSize());
+}
+
+const char* SoftmaxTopKPlugin::getPluginType() const
+{
+    return SOFTMAX_TOPK_PLUGIN_NAME;
+}
+
+const char* SoftmaxTopKPlugin::getPluginVersion() const
+{
+    return SOFTMAX_TOPK_PLUGIN_VERSION;
+}
+
+IPluginV2Ext* SoftmaxTopKPlugin::clone() const
+{
+    return new SoftmaxTopKPlugin(*this);
+}
+
+void SoftmaxTopKPlugin::setPluginNamespace(const char* libNamespace)
+{
+    mNameSpace = libNamespace;
+}
+
+const char* SoftmaxTopKPlugin::getPluginNamespace() const
+{
+    return mNameSpace.c_str();
+}
+
+bool SoftmaxTopKPlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    switch (pos)
+    {
+    case 0: return inOut[0].type == DataType::kFLOAT || inOut[0].type == DataType::kHALF;
+    case 1: return inOut[1].type == DataType::kFLOAT;
+    default: return inOut[2].type == DataType::kINT32;
+    }
+}
+
+DataType SoftmaxTopKPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index < 2);
+    return index == 0 ? DataType::kFLOAT : DataType::kINT32;
+}
+
+bool SoftmaxTopKPlugin::isOutputBroadcastAcrossBatch(
+    int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+{
+    return false;
+}
+
+bool SoftmaxTopKPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+{
+    return false;
+}
+
+void SoftmaxTopKPlugin::configurePlugin(
+    const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
+{
+    ASSERT(nbInput == 1 && nbOutput == 2);
+    mClasses = flatVolume(in[0].dims);
+    ASSERT(mClasses >= mK);
+    mInputType = in[0].type;
+    // Compiled for the new shapes in initialize()
+    mJit.reset();
+}
+
+void SoftmaxTopKPlugin::attachToContext(
+    cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator)
+{
+}
+
+void SoftmaxTopKPlugin::detachFromContext() {}
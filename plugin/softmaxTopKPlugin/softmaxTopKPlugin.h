@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_SOFTMAX_TOPK_PLUGIN_H
+#define TRT_SOFTMAX_TOPK_PLUGIN_H
+
+#include <cuda_runtime_api.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+#include "NvInferPlugin.h"
+#include "plugin.h"
+#include "softmaxTopKKernels.h"
+
+namespace nvinfer1
+{
+namespace plugin
+{
+// Classification head on the device: fuses the softmax, or log-softmax, of the logits of each batch item with the
+// selection of its k best classes, so that only k scores and classes per item are copied back to the host instead of
+// the whole probability vector. Takes the FP32 or FP16 logits of each item, flattened over all their dimensions.
+// Outputs the FP32 scores in decreasing order and their INT32 classes, both of shape [k]. With FP32 logits, the
+// kernel is compiled at runtime for the classes and k of the plugin when NVRTC is available, and serialized with it.
+class SoftmaxTopKPlugin : public IPluginV2IOExt
+{
+public:
+    SoftmaxTopKPlugin(int k, bool logSoftmax);
+
+    SoftmaxTopKPlugin(const void* data, size_t length);
+
+    ~SoftmaxTopKPlugin() override = default;
+
+    int getNbOutputs() const override;
+
+    Dims getOutputDimensions(int index, const Dims* inputs, int nbInputDims) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    void destroy() override;
+
+    size_t getWorkspaceSize(int maxBatchSize) const override;
+
+    int enqueue(
+        int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    IPluginV2Ext* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    bool isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const override;
+
+    bool canBroadcastInputAcrossBatch(int inputIndex) const override;
+
+    void attachToContext(
+        cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override;
+
+    void configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
+
+    void detachFromContext() override;
+
+private:
+    int mK;
+    bool mLogSoftmax;
+    int mClasses{0}; // Volume of the input of a batch item
+    DataType mInputType{DataType::kFLOAT};
+    std::shared_ptr<JitKernel> mJit; // Specialized for mClasses and mK, shared by the clones
+    std::string mNameSpace;
+};
+
+class SoftmaxTopKPluginCreator : public BaseCreator
+{
+public:
+    SoftmaxTopKPluginCreator();
+
+    ~SoftmaxTopKPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2Ext* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2Ext* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+} // namespace plugin
+} // namespace nvinfer1
+#endif // TRT_SOFTMAX_TOPK_PLUGIN_H
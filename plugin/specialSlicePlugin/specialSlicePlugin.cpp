@@ -14,22 +14,30 @@
  * limitations under the License.
  */
 #include "specialSlicePlugin.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "nvtxRange.h"
 #include "maskRCNNKernels.h"
 #include <cuda_runtime_api.h>
 
 using namespace nvinfer1;
 using namespace plugin;
 using nvinfer1::plugin::SpecialSlice;
+using nvinfer1::plugin::SpecialSliceDynamic;
+using nvinfer1::plugin::SpecialSliceDynamicPluginCreator;
 using nvinfer1::plugin::SpecialSlicePluginCreator;
 
 namespace
 {
 const char* SPECIALSLICE_PLUGIN_VERSION{"1"};
 const char* SPECIALSLICE_PLUGIN_NAME{"SpecialSlice_TRT"};
+const char* SPECIALSLICE_DYNAMIC_PLUGIN_NAME{"SpecialSliceDynamic_TRT"};
 } // namespace
 
 PluginFieldCollection SpecialSlicePluginCreator::mFC{};
 std::vector<PluginField> SpecialSlicePluginCreator::mPluginAttributes;
+PluginFieldCollection SpecialSliceDynamicPluginCreator::mFC{};
+std::vector<PluginField> SpecialSliceDynamicPluginCreator::mPluginAttributes;
 
 SpecialSlicePluginCreator::SpecialSlicePluginCreator()
 {
@@ -70,7 +78,7 @@ size_t SpecialSlice::getWorkspaceSize(int) const
 
 bool SpecialSlice::supportsFormat(DataType type, PluginFormat format) const
 {
-    return (type == DataType::kFLOAT && format == PluginFormat::kNCHW);
+    return ((type == DataType::kFLOAT || type == DataType::kHALF) && format == PluginFormat::kNCHW);
 };
 
 const char* SpecialSlice::getPluginType() const
@@ -100,13 +108,14 @@ const char* SpecialSlice::getPluginNamespace() const
 
 size_t SpecialSlice::getSerializationSize() const
 {
-    return sizeof(int);
+    return sizeof(int) + sizeof(DataType);
 };
 
 void SpecialSlice::serialize(void* buffer) const
 {
     char *d = reinterpret_cast<char*>(buffer), *a = d;
     write(d, mBboxesCnt);
+    write(d, mType);
     ASSERT(d == a + getSerializationSize());
 };
 
@@ -114,6 +123,11 @@ SpecialSlice::SpecialSlice(const void* data, size_t length)
 {
     const char *d = reinterpret_cast<const char*>(data), *a = d;
     mBboxesCnt = read<int>(d);
+    // Engines serialized before FP16 was supported are FP32
+    if (d < a + length)
+    {
+        mType = read<DataType>(d);
+    }
     assert(d == a + length);
 };
 
@@ -159,8 +173,11 @@ Dims SpecialSlice::getOutputDimensions(int index, const Dims* inputDims, int nbI
 int SpecialSlice::enqueue(
     int batch_size, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
 {
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
 
-    specialSlice(stream, batch_size, mBboxesCnt, inputs[0], outputs[0]);
+    specialSlice(stream, batch_size, mBboxesCnt, mType, inputs[0], outputs[0]);
 
     return cudaGetLastError() != cudaSuccess;
 };
@@ -171,8 +188,8 @@ DataType SpecialSlice::getOutputDataType(int index, const nvinfer1::DataType* in
     // Only 1 input and 1 output from the plugin layer
     ASSERT(index == 0);
 
-    // Only DataType::kFLOAT is acceptable by the plugin layer
-    return DataType::kFLOAT;
+    // The boxes have the type of the detections
+    return inputTypes[0];
 }
 
 // Return true if output tensor is broadcast across a batch.
@@ -195,8 +212,10 @@ void SpecialSlice::configurePlugin(const Dims* inputDims, int nbInputs, const Di
     assert(nbInputs == 1);
 
     assert(nbOutputs == 1);
+    assert(supportsFormat(inputTypes[0], floatFormat));
 
     mBboxesCnt = inputDims[0].d[0];
+    mType = inputTypes[0];
 }
 
 // Attach the plugin object to an execution context and grant the plugin the access to some context resource.
@@ -207,3 +226,159 @@ void SpecialSlice::attachToContext(
 
 // Detach the plugin object from its execution context.
 void SpecialSlice::detachFromContext() {}
+
+SpecialSliceDynamic::SpecialSliceDynamic() {}
+
+SpecialSliceDynamic::SpecialSliceDynamic(const void* data, size_t length)
+{
+    ASSERT(length == 0);
+}
+
+int SpecialSliceDynamic::getNbOutputs() const
+{
+    return 1;
+}
+
+DimsExprs SpecialSliceDynamic::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex == 0);
+    ASSERT(nbInputs == 1);
+    // detections: [N, anchors, (y1, x1, y2, x2, class_id, score)]
+    ASSERT(inputs[0].nbDims == 3);
+    DimsExprs output(inputs[0]);
+    //(y1, x1, y2, x2)
+    output.d[2] = exprBuilder.constant(4);
+    return output;
+}
+
+int SpecialSliceDynamic::initialize()
+{
+    return STATUS_SUCCESS;
+}
+
+void SpecialSliceDynamic::terminate() {}
+
+size_t SpecialSliceDynamic::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    return 0;
+}
+
+int SpecialSliceDynamic::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const Dims& dims = inputDesc[0].dims;
+    specialSlice(stream, dims.d[0], dims.d[1], inputDesc[0].type, inputs[0], outputs[0]);
+
+    return cudaGetLastError() != cudaSuccess;
+}
+
+size_t SpecialSliceDynamic::getSerializationSize() const
+{
+    return 0;
+}
+
+void SpecialSliceDynamic::serialize(void* buffer) const {}
+
+void SpecialSliceDynamic::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    ASSERT(nbInputs == 1);
+    ASSERT(nbOutputs == 1);
+    ASSERT(in[0].desc.dims.nbDims == 3);
+    ASSERT(in[0].desc.dims.d[2] == 6);
+}
+
+bool SpecialSliceDynamic::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbInputs == 1 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != PluginFormat::kNCHW)
+    {
+        return false;
+    }
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    // The boxes have the type of the detections
+    return inOut[pos].type == inOut[0].type;
+}
+
+const char* SpecialSliceDynamic::getPluginType() const
+{
+    return SPECIALSLICE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* SpecialSliceDynamic::getPluginVersion() const
+{
+    return SPECIALSLICE_PLUGIN_VERSION;
+}
+
+void SpecialSliceDynamic::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* SpecialSliceDynamic::clone() const
+{
+    return new SpecialSliceDynamic(*this);
+}
+
+void SpecialSliceDynamic::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* SpecialSliceDynamic::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+DataType SpecialSliceDynamic::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index == 0);
+    return inputTypes[0];
+}
+
+SpecialSliceDynamicPluginCreator::SpecialSliceDynamicPluginCreator()
+{
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* SpecialSliceDynamicPluginCreator::getPluginName() const
+{
+    return SPECIALSLICE_DYNAMIC_PLUGIN_NAME;
+}
+
+const char* SpecialSliceDynamicPluginCreator::getPluginVersion() const
+{
+    return SPECIALSLICE_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* SpecialSliceDynamicPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* SpecialSliceDynamicPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    auto* plugin = new SpecialSliceDynamic();
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* SpecialSliceDynamicPluginCreator::deserializePlugin(
+    const char* name, const void* data, size_t length)
+{
+    auto* plugin = new SpecialSliceDynamic(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
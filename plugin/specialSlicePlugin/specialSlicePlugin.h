@@ -89,9 +89,63 @@ public:
 
 private:
     int mBboxesCnt;
+    DataType mType{DataType::kFLOAT};
     std::string mNameSpace;
 };
 
+// Explicit batch version of SpecialSlice. The detections are [N, R, 6] and the boxes [N, R, 4]. R is read from the
+// input description at enqueue time, so nothing is serialized.
+class SpecialSliceDynamic : public IPluginV2DynamicExt
+{
+public:
+    SpecialSliceDynamic();
+
+    SpecialSliceDynamic(const void* data, size_t length);
+
+    ~SpecialSliceDynamic() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+private:
+    std::string mNamespace;
+};
+
 class SpecialSlicePluginCreator : public BaseCreator
 {
 public:
@@ -109,6 +163,29 @@ public:
 
     IPluginV2Ext* deserializePlugin(const char* name, const void* data, size_t length) override;
 
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+
+// Takes the same fields as SpecialSlice_TRT
+class SpecialSliceDynamicPluginCreator : public BaseCreator
+{
+public:
+    SpecialSliceDynamicPluginCreator();
+
+    ~SpecialSliceDynamicPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
 private:
     static PluginFieldCollection mFC;
     static std::vector<PluginField> mPluginAttributes;
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "yoloDetectionKernels.h"
+#include <algorithm>
+#include <cuda_fp16.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+namespace
+{
+
+constexpr int kThreads = 256;
+constexpr int kMaxBlocks = 4096;
+
+__device__ inline float toFloat(float x)
+{
+    return x;
+}
+
+__device__ inline float toFloat(__half x)
+{
+    return __half2float(x);
+}
+
+__device__ inline float sigmoid(float x)
+{
+    return 1.F / (1.F + __expf(-x));
+}
+
+// One thread per anchor of a cell. The channels of an anchor are height * width values apart, so that consecutive
+// threads read consecutive cells of each channel.
+template <typename T>
+__global__ void yoloDecodeKernel(int batch, int numAnchors, int numClasses, int height, int width, YoloAnchors anchors,
+    bool classSoftmax, float scoreThreshold, const T* head, int priorOffset, int numPriors, float* boxes,
+    float* scores)
+{
+    const int cells = height * width;
+    const size_t total = static_cast<size_t>(batch) * numAnchors * cells;
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < total;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const int cell = static_cast<int>(i % cells);
+        const int anchor = static_cast<int>(i / cells % numAnchors);
+        const int b = static_cast<int>(i / cells / numAnchors);
+        const T* in = head + (static_cast<size_t>(b) * numAnchors + anchor) * (5 + numClasses) * cells + cell;
+        const size_t prior = static_cast<size_t>(b) * numPriors + priorOffset + anchor * cells + cell;
+
+        const float cx = (cell % width + sigmoid(toFloat(in[0]))) / width;
+        const float cy = (cell / width + sigmoid(toFloat(in[cells]))) / height;
+        const float halfWidth = __expf(toFloat(in[2 * cells])) * anchors.width[anchor] / 2;
+        const float halfHeight = __expf(toFloat(in[3 * cells])) * anchors.height[anchor] / 2;
+        reinterpret_cast<float4*>(boxes)[prior]
+            = make_float4(cx - halfWidth, cy - halfHeight, cx + halfWidth, cy + halfHeight);
+
+        // The class probabilities are at most 1, no class of a prior below the threshold can pass it
+        const float objectness = sigmoid(toFloat(in[4 * cells]));
+        float* out = scores + prior * numClasses;
+        if (objectness < scoreThreshold)
+        {
+            for (int c = 0; c < numClasses; ++c)
+            {
+                out[c] = 0.F;
+            }
+            continue;
+        }
+        const T* classes = in + 5 * cells;
+        if (classSoftmax)
+        {
+            float largest = toFloat(classes[0]);
+            for (int c = 1; c < numClasses; ++c)
+            {
+                largest = fmaxf(largest, toFloat(classes[c * cells]));
+            }
+            float sum = 0.F;
+            for (int c = 0; c < numClasses; ++c)
+            {
+                sum += __expf(toFloat(classes[c * cells]) - largest);
+            }
+            const float scale = objectness / sum;
+            for (int c = 0; c < numClasses; ++c)
+            {
+                out[c] = __expf(toFloat(classes[c * cells]) - largest) * scale;
+            }
+        }
+        else
+        {
+            for (int c = 0; c < numClasses; ++c)
+            {
+                out[c] = objectness * sigmoid(toFloat(classes[c * cells]));
+            }
+        }
+    }
+}
+
+} // namespace
+
+cudaError_t yoloDecode(cudaStream_t stream, int batch, int numAnchors, int numClasses, int height, int width,
+    const YoloAnchors& anchors, bool classSoftmax, float scoreThreshold, DataType headType, const void* head,
+    int priorOffset, int numPriors, float* boxes, float* scores)
+{
+    const size_t total = static_cast<size_t>(batch) * numAnchors * height * width;
+    if (!total)
+    {
+        return cudaSuccess;
+    }
+    const int blocks = static_cast<int>(std::min<size_t>((total + kThreads - 1) / kThreads, kMaxBlocks));
+    if (headType == DataType::kHALF)
+    {
+        yoloDecodeKernel<<<blocks, kThreads, 0, stream>>>(batch, numAnchors, numClasses, height, width, anchors,
+            classSoftmax, scoreThreshold, static_cast<const __half*>(head), priorOffset, numPriors, boxes, scores);
+    }
+    else
+    {
+        yoloDecodeKernel<<<blocks, kThreads, 0, stream>>>(batch, numAnchors, numClasses, height, width, anchors,
+            classSoftmax, scoreThreshold, static_cast<const float*>(head), priorOffset, numPriors, boxes, scores);
+    }
+    return cudaPeekAtLastError();
+}
+
+} // namespace plugin
+} // namespace nvinfer1
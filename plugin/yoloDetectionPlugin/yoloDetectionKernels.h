@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_YOLO_DETECTION_KERNELS_H
+#define TRT_YOLO_DETECTION_KERNELS_H
+#include "NvInfer.h"
+#include <cuda_runtime.h>
+
+namespace nvinfer1
+{
+namespace plugin
+{
+
+// Largest number of anchors of a scale, the anchors are passed to the decoding kernel by value
+constexpr int kMaxYoloAnchors = 16;
+
+// Anchor sizes of one scale, normalized by the size of the network input
+struct YoloAnchors
+{
+    float width[kMaxYoloAnchors];
+    float height[kMaxYoloAnchors];
+};
+
+// Decodes the [batch, numAnchors * (5 + numClasses), height, width] FP32 or FP16 logits of one scale of a YOLOv2 or
+// YOLOv3 head. Each anchor of each cell is the prior priorOffset + (anchor * height + y) * width + x of the
+// [batch, numPriors, 4] boxes, written as normalized [x1, y1, x2, y2], and of the [batch, numPriors, numClasses]
+// scores, written as the objectness times the sigmoid, or the softmax with classSoftmax, of the class logits. The
+// scores of priors whose objectness is below scoreThreshold are zero, without evaluating their classes.
+cudaError_t yoloDecode(cudaStream_t stream, int batch, int numAnchors, int numClasses, int height, int width,
+    const YoloAnchors& anchors, bool classSoftmax, float scoreThreshold, DataType headType, const void* head,
+    int priorOffset, int numPriors, float* boxes, float* scores);
+
+} // namespace plugin
+} // namespace nvinfer1
+
+#endif // TRT_YOLO_DETECTION_KERNELS_H
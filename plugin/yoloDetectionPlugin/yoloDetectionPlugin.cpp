@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "yoloDetectionPlugin.h"
+#include "batchedNMSPlugin/batchedNMSInference.h"
+#include "batchedNMSPlugin/fusedNMS.h"
+#include "bboxUtils.h"
+#include "enqueueAudit.h"
+#include "enqueueTiming.h"
+#include "kernel.h"
+#include "nmsUtils.h"
+#include "nvtxRange.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace nvinfer1;
+using namespace plugin;
+using nvinfer1::plugin::YoloDetectionPlugin;
+using nvinfer1::plugin::YoloDetectionPluginCreator;
+
+namespace
+{
+const char* YOLO_DETECTION_PLUGIN_VERSION{"1"};
+const char* YOLO_DETECTION_PLUGIN_NAME{"YoloDetection_TRT"};
+
+// The anchors of every cell of every scale, as many as the boxes fed to the NMS
+int countPriors(const PluginTensorDesc* heads, int nbHeads, int numAnchors)
+{
+    int priors{0};
+    for (int i = 0; i < nbHeads; ++i)
+    {
+        priors += numAnchors * heads[i].dims.d[2] * heads[i].dims.d[3];
+    }
+    return priors;
+}
+
+// The decoded boxes and scores of all the scales, then the workspace of the NMS
+size_t decodedBoxesSize(int batch, int numPriors)
+{
+    return static_cast<size_t>(batch) * numPriors * 4 * sizeof(float);
+}
+
+size_t decodedScoresSize(int batch, int numPriors, int numClasses)
+{
+    return static_cast<size_t>(batch) * numPriors * numClasses * sizeof(float);
+}
+
+size_t nmsWorkspaceSize(int batch, int numPriors, int numClasses, int topK, int keepTopK)
+{
+    if (fusedNMSSupported(true, numClasses, topK, keepTopK, false))
+    {
+        return fusedNMSWorkspaceSize(batch, numClasses, topK);
+    }
+    return detectionInferenceWorkspaceSize(true, batch, numPriors * 4, numPriors * numClasses, numClasses, numPriors,
+        topK, DataType::kFLOAT, DataType::kFLOAT, true);
+}
+} // namespace
+
+PluginFieldCollection YoloDetectionPluginCreator::mFC{};
+std::vector<PluginField> YoloDetectionPluginCreator::mPluginAttributes;
+
+YoloDetectionPluginCreator::YoloDetectionPluginCreator()
+{
+    mPluginAttributes.emplace_back(PluginField("num_classes", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("num_anchors", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("anchors", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("input_width", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("input_height", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("class_softmax", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("top_k", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("keep_top_k", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("score_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("iou_threshold", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("clip_boxes", nullptr, PluginFieldType::kINT32, 1));
+
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* YoloDetectionPluginCreator::getPluginName() const
+{
+    return YOLO_DETECTION_PLUGIN_NAME;
+}
+
+const char* YoloDetectionPluginCreator::getPluginVersion() const
+{
+    return YOLO_DETECTION_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* YoloDetectionPluginCreator::getFieldNames()
+{
+    return &mFC;
+}
+
+IPluginV2DynamicExt* YoloDetectionPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+{
+    int numClasses{80};
+    int numAnchors{3};
+    std::vector<float> anchors;
+    int inputWidth{416};
+    int inputHeight{416};
+    int classSoftmax{0};
+    int topK{1000};
+    int keepTopK{100};
+    float scoreThreshold{0.25F};
+    float iouThreshold{0.45F};
+    int clipBoxes{1};
+    const PluginField* fields = fc->fields;
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "num_classes"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            numClasses = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "num_anchors"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            numAnchors = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "input_width"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            inputWidth = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "input_height"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            inputHeight = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "class_softmax"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            classSoftmax = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "top_k"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            topK = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "keep_top_k"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            keepTopK = *static_cast<const int*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "anchors"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            const auto* values = static_cast<const float*>(fields[i].data);
+            anchors.assign(values, values + fields[i].length);
+        }
+        else if (!strcmp(attrName, "score_threshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            scoreThreshold = *static_cast<const float*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "iou_threshold"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kFLOAT32);
+            iouThreshold = *static_cast<const float*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "clip_boxes"))
+        {
+            ASSERT(fields[i].type == PluginFieldType::kINT32);
+            clipBoxes = *static_cast<const int*>(fields[i].data);
+        }
+    }
+    ASSERT(numClasses > 0);
+    ASSERT(numAnchors > 0 && numAnchors <= kMaxYoloAnchors);
+    // One width and height pair per anchor of each scale
+    ASSERT(!anchors.empty() && anchors.size() % (2 * numAnchors) == 0);
+    ASSERT(inputWidth > 0 && inputHeight > 0);
+    ASSERT(keepTopK > 0 && keepTopK <= topK);
+    auto* plugin = new YoloDetectionPlugin(numClasses, numAnchors, anchors, inputWidth, inputHeight, classSoftmax != 0,
+        topK, keepTopK, scoreThreshold, iouThreshold, clipBoxes != 0);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+IPluginV2DynamicExt* YoloDetectionPluginCreator::deserializePlugin(const char* name, const void* data, size_t length)
+{
+    auto* plugin = new YoloDetectionPlugin(data, length);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+YoloDetectionPlugin::YoloDetectionPlugin(int numClasses, int numAnchors, std::vector<float> anchors, int inputWidth,
+    int inputHeight, bool classSoftmax, int topK, int keepTopK, float scoreThreshold, float iouThreshold,
+    bool clipBoxes)
+    : mNumClasses(numClasses)
+    , mNumAnchors(numAnchors)
+    , mAnchors(std::move(anchors))
+    , mInputWidth(inputWidth)
+    , mInputHeight(inputHeight)
+    , mClassSoftmax(classSoftmax)
+    , mTopK(topK)
+    , mKeepTopK(keepTopK)
+    , mScoreThreshold(scoreThreshold)
+    , mIouThreshold(iouThreshold)
+    , mClipBoxes(clipBoxes)
+{
+}
+
+YoloDetectionPlugin::YoloDetectionPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    mNumClasses = read<int>(d);
+    mNumAnchors = read<int>(d);
+    mInputWidth = read<int>(d);
+    mInputHeight = read<int>(d);
+    mClassSoftmax = read<int>(d) != 0;
+    mTopK = read<int>(d);
+    mKeepTopK = read<int>(d);
+    mScoreThreshold = read<float>(d);
+    mIouThreshold = read<float>(d);
+    mClipBoxes = read<int>(d) != 0;
+    mHeadType = read<DataType>(d);
+    const int anchorCount = read<int>(d);
+    const auto* anchors = reinterpret_cast<const float*>(d);
+    mAnchors.assign(anchors, anchors + anchorCount);
+    d += anchorCount * sizeof(float);
+    ASSERT(d == a + length);
+}
+
+int YoloDetectionPlugin::getNbOutputs() const
+{
+    return 4;
+}
+
+DimsExprs YoloDetectionPlugin::getOutputDimensions(
+    int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+{
+    ASSERT(outputIndex >= 0 && outputIndex < getNbOutputs());
+    ASSERT(nbInputs > 0 && inputs[0].nbDims == 4);
+    // The outputs of BatchedNMSDynamic_TRT: num_detections [batch, 1], nmsed_boxes [batch, keepTopK, 4], nmsed_scores
+    // and nmsed_classes [batch, keepTopK]
+    DimsExprs out;
+    out.d[0] = inputs[0].d[0];
+    if (outputIndex == 0)
+    {
+        out.nbDims = 2;
+        out.d[1] = exprBuilder.constant(1);
+    }
+    else if (outputIndex == 1)
+    {
+        out.nbDims = 3;
+        out.d[1] = exprBuilder.constant(mKeepTopK);
+        out.d[2] = exprBuilder.constant(4);
+    }
+    else
+    {
+        out.nbDims = 2;
+        out.d[1] = exprBuilder.constant(mKeepTopK);
+    }
+    return out;
+}
+
+int YoloDetectionPlugin::initialize()
+{
+    return 0;
+}
+
+void YoloDetectionPlugin::terminate() {}
+
+YoloAnchors YoloDetectionPlugin::scaleAnchors(int scale) const
+{
+    YoloAnchors anchors{};
+    const float* pairs = mAnchors.data() + 2 * mNumAnchors * scale;
+    for (int i = 0; i < mNumAnchors; ++i)
+    {
+        anchors.width[i] = pairs[2 * i] / mInputWidth;
+        anchors.height[i] = pairs[2 * i + 1] / mInputHeight;
+    }
+    return anchors;
+}
+
+int YoloDetectionPlugin::nmsTopK(int numPriors) const
+{
+    return std::min(mTopK, numPriors);
+}
+
+size_t YoloDetectionPlugin::getWorkspaceSize(
+    const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const
+{
+    const int batch = inputs[0].dims.d[0];
+    const int numPriors = countPriors(inputs, nbInputs, mNumAnchors);
+    size_t sizes[] = {decodedBoxesSize(batch, numPriors), decodedScoresSize(batch, numPriors, mNumClasses),
+        nmsWorkspaceSize(batch, numPriors, mNumClasses, nmsTopK(numPriors), mKeepTopK)};
+    return calculateTotalWorkspaceSize(sizes, 3);
+}
+
+int YoloDetectionPlugin::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    NVTX_RANGE(getPluginType());
+    ENQUEUE_AUDIT(getPluginType());
+    ENQUEUE_TIMING(getPluginType(), "");
+
+    const int nbHeads = static_cast<int>(mAnchors.size()) / (2 * mNumAnchors);
+    const int batch = inputDesc[0].dims.d[0];
+    const int numPriors = countPriors(inputDesc, nbHeads, mNumAnchors);
+    auto* boxes = reinterpret_cast<float*>(workspace);
+    auto* scores = reinterpret_cast<float*>(
+        nextWorkspacePtr(reinterpret_cast<int8_t*>(boxes), decodedBoxesSize(batch, numPriors)));
+    void* nmsWorkspace = nextWorkspacePtr(
+        reinterpret_cast<int8_t*>(scores), decodedScoresSize(batch, numPriors, mNumClasses));
+
+    // The scales are decoded into consecutive priors, so that one NMS merges their detections
+    int priorOffset{0};
+    for (int i = 0; i < nbHeads; ++i)
+    {
+        const int height = inputDesc[i].dims.d[2];
+        const int width = inputDesc[i].dims.d[3];
+        if (yoloDecode(stream, batch, mNumAnchors, mNumClasses, height, width, scaleAnchors(i), mClassSoftmax,
+                mScoreThreshold, mHeadType, inputs[i], priorOffset, numPriors, boxes, scores)
+            != cudaSuccess)
+        {
+            return 1;
+        }
+        priorOffset += mNumAnchors * height * width;
+    }
+
+    const pluginStatus_t status = nmsInference(stream, batch, numPriors * 4, numPriors * mNumClasses, true, -1,
+        numPriors, mNumClasses, nmsTopK(numPriors), mKeepTopK, mScoreThreshold, mIouThreshold, DataType::kFLOAT,
+        boxes, DataType::kFLOAT, scores, outputs[0], outputs[1], outputs[2], outputs[3], nmsWorkspace, true, false,
+        mClipBoxes);
+    return status != STATUS_SUCCESS;
+}
+
+size_t YoloDetectionPlugin::getSerializationSize() const
+{
+    // classes, anchors, input width and height, softmax, top K, keep top K, thresholds, clip, head type, anchor count
+    // and sizes
+    return sizeof(int) * 7 + sizeof(float) * 2 + sizeof(int) + sizeof(DataType) + sizeof(int)
+        + mAnchors.size() * sizeof(float);
+}
+
+void YoloDetectionPlugin::serialize(void* buffer) const
+{
+    char *d = reinterpret_cast<char*>(buffer), *a = d;
+    write(d, mNumClasses);
+    write(d, mNumAnchors);
+    write(d, mInputWidth);
+    write(d, mInputHeight);
+    write(d, static_cast<int>(mClassSoftmax));
+    write(d, mTopK);
+    write(d, mKeepTopK);
+    write(d, mScoreThreshold);
+    write(d, mIouThreshold);
+    write(d, static_cast<int>(mClipBoxes));
+    write(d, mHeadType);
+    write(d, static_cast<int>(mAnchors.size()));
+    std::memcpy(d, mAnchors.data(), mAnchors.size() * sizeof(float));
+    d += mAnchors.size() * sizeof(float);
+    ASSERT(d == a + getSerializationSize());
+}
+
+void YoloDetectionPlugin::configurePlugin(
+    const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
+{
+    // One head per scale of the anchors
+    ASSERT(nbInputs == static_cast<int>(mAnchors.size()) / (2 * mNumAnchors) && nbOutputs == 4);
+    for (int i = 0; i < nbInputs; ++i)
+    {
+        ASSERT(in[i].desc.dims.nbDims == 4);
+        const int channels = in[i].desc.dims.d[1];
+        ASSERT(channels == -1 || channels == mNumAnchors * (5 + mNumClasses));
+    }
+    mHeadType = in[0].desc.type;
+}
+
+bool YoloDetectionPlugin::supportsFormatCombination(
+    int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
+{
+    ASSERT(nbOutputs == 4 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    // The heads are FP32 or FP16 alike, num_detections is INT32 and the other outputs FP32
+    if (pos == 0)
+    {
+        return inOut[pos].type == DataType::kFLOAT || inOut[pos].type == DataType::kHALF;
+    }
+    if (pos < nbInputs)
+    {
+        return inOut[pos].type == inOut[0].type;
+    }
+    return inOut[pos].type == (pos == nbInputs ? DataType::kINT32 : DataType::kFLOAT);
+}
+
+const char* YoloDetectionPlugin::getPluginType() const
+{
+    return YOLO_DETECTION_PLUGIN_NAME;
+}
+
+const char* YoloDetectionPlugin::getPluginVersion() const
+{
+    return YOLO_DETECTION_PLUGIN_VERSION;
+}
+
+void YoloDetectionPlugin::destroy()
+{
+    delete this;
+}
+
+IPluginV2DynamicExt* YoloDetectionPlugin::clone() const
+{
+    return new YoloDetectionPlugin(*this);
+}
+
+DataType YoloDetectionPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    ASSERT(index >= 0 && index < 4);
+    return index == 0 ? DataType::kINT32 : DataType::kFLOAT;
+}
+
+void YoloDetectionPlugin::setPluginNamespace(const char* pluginNamespace)
+{
+    mNamespace = pluginNamespace;
+}
+
+const char* YoloDetectionPlugin::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
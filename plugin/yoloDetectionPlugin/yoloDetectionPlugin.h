@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TRT_YOLO_DETECTION_PLUGIN_H
+#define TRT_YOLO_DETECTION_PLUGIN_H
+
+#include <cuda_runtime_api.h>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+#include "NvInferPlugin.h"
+#include "plugin.h"
+#include "yoloDetectionKernels.h"
+
+namespace nvinfer1
+{
+namespace plugin
+{
+// Detection output of YOLOv2 and YOLOv3 on the device: decodes the cells and anchors of the heads of every scale,
+// scores them by objectness times class probability and runs the batched NMS of BatchedNMS_TRT over all the scales
+// at once, so that only the kept detections are copied back to the host. Takes one [batch, anchors * (5 + classes),
+// height, width] FP32 or FP16 head of logits per scale. Outputs the same num_detections, nmsed_boxes, nmsed_scores and
+// nmsed_classes as BatchedNMSDynamic_TRT, in FP32, with normalized [x1, y1, x2, y2] boxes.
+class YoloDetectionPlugin : public IPluginV2DynamicExt
+{
+public:
+    YoloDetectionPlugin(int numClasses, int numAnchors, std::vector<float> anchors, int inputWidth, int inputHeight,
+        bool classSoftmax, int topK, int keepTopK, float scoreThreshold, float iouThreshold, bool clipBoxes);
+
+    YoloDetectionPlugin(const void* data, size_t length);
+
+    ~YoloDetectionPlugin() override = default;
+
+    int getNbOutputs() const override;
+
+    DimsExprs getOutputDimensions(
+        int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(
+        const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override;
+
+    int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out,
+        int nbOutputs) override;
+
+    bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    IPluginV2DynamicExt* clone() const override;
+
+    DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    void setPluginNamespace(const char* pluginNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+private:
+    // The anchors of scale s, normalized by the network input
+    YoloAnchors scaleAnchors(int scale) const;
+
+    // The candidates of each class fed to the NMS, bounded by the priors of all the scales
+    int nmsTopK(int numPriors) const;
+
+    int mNumClasses;
+    int mNumAnchors;             // Per scale
+    std::vector<float> mAnchors; // Width and height pairs in pixels of the network input, scale after scale
+    int mInputWidth;
+    int mInputHeight;
+    bool mClassSoftmax; // YOLOv2 normalizes the classes with a softmax, YOLOv3 scores each with a sigmoid
+    int mTopK;
+    int mKeepTopK;
+    float mScoreThreshold;
+    float mIouThreshold;
+    bool mClipBoxes;
+    DataType mHeadType{DataType::kFLOAT};
+    std::string mNamespace;
+};
+
+class YoloDetectionPluginCreator : public BaseCreator
+{
+public:
+    YoloDetectionPluginCreator();
+
+    ~YoloDetectionPluginCreator() override = default;
+
+    const char* getPluginName() const override;
+
+    const char* getPluginVersion() const override;
+
+    const PluginFieldCollection* getFieldNames() override;
+
+    IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+    IPluginV2DynamicExt* deserializePlugin(const char* name, const void* data, size_t length) override;
+
+private:
+    static PluginFieldCollection mFC;
+    static std::vector<PluginField> mPluginAttributes;
+};
+} // namespace plugin
+} // namespace nvinfer1
+#endif // TRT_YOLO_DETECTION_PLUGIN_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ADAPTIVE_CALIBRATION_H
+#define ADAPTIVE_CALIBRATION_H
+
+#include "CalibrationCache.h"
+#include "logger.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace samplesCommon
+{
+
+//!
+//! \brief Largest relative change of the dynamic range of a tensor between two calibration caches written by TensorRT
+//!
+//! \return The change, or infinity if the caches do not cover the same tensors
+//!
+inline float calibrationChange(const std::string& previous, const std::string& current)
+{
+    const auto before = cacheToDynamicRanges(previous.data(), previous.size());
+    const auto after = cacheToDynamicRanges(current.data(), current.size());
+    if (before.size() != after.size() || before.empty())
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    float change{0};
+    for (const auto& range : after)
+    {
+        const auto old = before.find(range.first);
+        if (old == before.end())
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+        const float reference = std::max(std::abs(old->second), std::numeric_limits<float>::min());
+        change = std::max(change, std::abs(range.second - old->second) / reference);
+    }
+    return change;
+}
+
+//!
+//! \class AdaptiveCalibration
+//!
+//! \brief Calibrates on twice as many batches at a time until the dynamic ranges of the tensors converge.
+//!
+//! TensorRT does not expose the histograms it collects, so convergence is judged on what they produce: the entropy
+//! optimal range of each tensor, read from the cache each calibration writes. Calibration stops once no range moves by
+//! more than the tolerance from one calibration to the next, or once all the batches are used. Doubling keeps the
+//! batches calibrated over all the rounds below twice the batches of the last one.
+//!
+//! \code
+//! AdaptiveCalibration adaptive(nbCalBatches, 1, 0.01F);
+//! do { calibrate on adaptive.nextBatches() batches } while (!adaptive.addCalibration(table));
+//! \endcode
+//!
+class AdaptiveCalibration
+{
+public:
+    //!
+    //! \param tolerance Largest relative change of a range, such as 0.01 for 1%, under which calibration stops
+    //!
+    AdaptiveCalibration(int totalBatches, int firstBatches, float tolerance)
+        : mTotal(std::max(totalBatches, 1))
+        , mNext(std::min(std::max(firstBatches, 1), mTotal))
+        , mTolerance(tolerance)
+    {
+    }
+
+    //!
+    //! \brief The batches the next calibration runs on, from the start of the calibration data
+    //!
+    int nextBatches() const
+    {
+        return mNext;
+    }
+
+    //!
+    //! \brief Record the cache of the calibration on nextBatches() batches
+    //!
+    //! \return True once calibration is done, converged or on all the batches. An empty cache, from a calibration
+    //!         that was read from a cache file instead, is done too.
+    //!
+    bool addCalibration(const std::string& table)
+    {
+        mUsed = mNext;
+        mCalibrated += mNext;
+        const float change = mTable.empty() ? std::numeric_limits<float>::infinity() : calibrationChange(mTable, table);
+        gLogInfo << "Adaptive calibration: " << mUsed << " of " << mTotal << " batches";
+        if (!mTable.empty())
+        {
+            gLogInfo << ", largest range change " << change * 100 << "%";
+        }
+        gLogInfo << std::endl;
+        mTable = table;
+        mConverged = change <= mTolerance;
+        if (mConverged || table.empty() || mNext == mTotal)
+        {
+            gLogInfo << "Adaptive calibration: " << (mConverged ? "converged" : "stopped") << " on " << mUsed << " of "
+                     << mTotal << " batches, " << mCalibrated << " batches calibrated in all" << std::endl;
+            return true;
+        }
+        mNext = std::min(2 * mNext, mTotal);
+        return false;
+    }
+
+    //!
+    //! \brief The batches of the last calibration, that the engine was calibrated with
+    //!
+    int batchesUsed() const
+    {
+        return mUsed;
+    }
+
+    bool converged() const
+    {
+        return mConverged;
+    }
+
+private:
+    int mTotal;
+    int mNext;
+    float mTolerance;
+    int mUsed{0};
+    int mCalibrated{0}; //!< Over all the calibrations
+    bool mConverged{false};
+    std::string mTable;
+};
+
+} // namespace samplesCommon
+
+#endif // ADAPTIVE_CALIBRATION_H
@@ -17,9 +17,13 @@
 #define BATCH_STREAM_H
 
 #include "NvInfer.h"
+#include "PackedDataset.h"
 #include "common.h"
 #include <algorithm>
 #include <assert.h>
+#include <memory>
+#include <numeric>
+#include <random>
 #include <stdio.h>
 #include <vector>
 
@@ -386,4 +390,137 @@ private:
     std::vector<std::string> mDataDir; //!< Directories where the files can be found
 };
 
+//!
+//! \class PackedBatchStream
+//!
+//! \brief Batches of the float samples of a packed dataset, in file order or shuffled.
+//!
+//! A batch of samples adjacent in the file is a view of the mapping, other batches are gathered into a buffer. Copies,
+//! such as those the calibrators keep, share the mapping.
+//!
+class PackedBatchStream : public IBatchStream
+{
+public:
+    //!
+    //! \param shuffle Seed of the order of the samples, 0 keeps the file order
+    //!
+    PackedBatchStream(int batchSize, int maxBatches, const std::string& fileName, unsigned shuffle = 0)
+        : mBatchSize(batchSize)
+        , mDataset(std::make_shared<samplesCommon::PackedDataset>(fileName))
+        , mOrder(mDataset->size())
+    {
+        const nvinfer1::Dims dims = mDataset->dims();
+        if (mDataset->dataType() != nvinfer1::DataType::kFLOAT || dims.nbDims != 3)
+        {
+            throw std::runtime_error("Batches of " + fileName + " need float samples of 3 dimensions");
+        }
+        mDims = Dims{4, {mBatchSize, dims.d[0], dims.d[1], dims.d[2]}, {}};
+        mImageSize = samplesCommon::volume(dims);
+        for (size_t s = 0; s < mDataset->size(); ++s)
+        {
+            if (mDataset->sampleSize(s) != mImageSize * sizeof(float))
+            {
+                throw std::runtime_error("Sample " + std::to_string(s) + " of " + fileName + " has another shape");
+            }
+        }
+        mMaxBatches = std::min(maxBatches, static_cast<int>(mDataset->size()) / mBatchSize);
+        std::iota(mOrder.begin(), mOrder.end(), 0);
+        if (shuffle)
+        {
+            std::shuffle(mOrder.begin(), mOrder.end(), std::default_random_engine(shuffle));
+        }
+        reset(0);
+    }
+
+    void reset(int firstBatch) override
+    {
+        mBatchCount = firstBatch;
+        mCurrent = -1;
+    }
+
+    bool next() override
+    {
+        if (mBatchCount >= mMaxBatches)
+        {
+            return false;
+        }
+        mCurrent = mBatchCount++;
+        const size_t first = mOrder[mCurrent * mBatchSize];
+        // A shuffled order rarely batches consecutive samples, check it before walking the index
+        bool view = true;
+        for (int i = 1; view && i < mBatchSize; ++i)
+        {
+            view = mOrder[mCurrent * mBatchSize + i] == first + i;
+        }
+        mView = view && mDataset->contiguous(first, mBatchSize);
+        mFirst = first;
+        if (mView)
+        {
+            return true;
+        }
+
+        mBatch.resize(mBatchSize * mImageSize);
+        mLabels.resize(mBatchSize);
+        for (int i = 0; i < mBatchSize; ++i)
+        {
+            const size_t sample = mOrder[mCurrent * mBatchSize + i];
+            std::copy_n(
+                static_cast<const float*>(mDataset->sample(sample)), mImageSize, mBatch.data() + i * mImageSize);
+            mLabels[i] = mDataset->hasLabels() ? mDataset->labels()[sample] : 0.0F;
+        }
+        return true;
+    }
+
+    void skip(int skipCount) override
+    {
+        mBatchCount += skipCount;
+    }
+
+    float* getBatch() override
+    {
+        return mView ? static_cast<float*>(mDataset->sample(mFirst)) : mBatch.data();
+    }
+
+    //!
+    //! \return The labels of the batch, nullptr if the dataset has none.
+    //!
+    float* getLabels() override
+    {
+        if (!mDataset->hasLabels())
+        {
+            return nullptr;
+        }
+        return mView ? mDataset->labels() + mFirst : mLabels.data();
+    }
+
+    int getBatchesRead() const override
+    {
+        return mBatchCount;
+    }
+
+    int getBatchSize() const override
+    {
+        return mBatchSize;
+    }
+
+    nvinfer1::Dims getDims() const override
+    {
+        return mDims;
+    }
+
+private:
+    int mBatchSize{0};
+    int mMaxBatches{0};
+    int mBatchCount{0};
+    int mCurrent{-1};
+    size_t mImageSize{0};
+    nvinfer1::Dims mDims{};
+    std::shared_ptr<samplesCommon::PackedDataset> mDataset; //!< Read only, so copies of the stream share it
+    std::vector<size_t> mOrder;                             //!< Samples in the order they are batched
+    std::vector<float> mBatch;                              //!< Gathered batch when its samples are not adjacent
+    std::vector<float> mLabels;                             //!< Gathered labels of the batch
+    bool mView{false};                                      //!< The batch is a view from sample mFirst on
+    size_t mFirst{0};
+};
+
 #endif
@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CALIBRATION_CACHE_H
+#define CALIBRATION_CACHE_H
+
+#include "NvInfer.h"
+#include "logger.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace samplesCommon
+{
+
+namespace detail
+{
+inline uint64_t fnv1a(const char* data, size_t size, uint64_t hash = 0xCBF29CE484222325ULL)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+inline std::string toHex(uint64_t hash)
+{
+    std::ostringstream out;
+    out << std::hex << hash;
+    return out.str();
+}
+} // namespace detail
+
+//!
+//! \brief Hashes the contents of the model files, in order.
+//!
+//! \return The hash as a hexadecimal string, or an empty string if a file cannot be read.
+//!
+inline std::string hashModelFiles(const std::vector<std::string>& fileNames)
+{
+    uint64_t hash = detail::fnv1a(nullptr, 0);
+    std::vector<char> chunk(1 << 20);
+    for (const auto& fileName : fileNames)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            return "";
+        }
+        while (file.read(chunk.data(), chunk.size()) || file.gcount())
+        {
+            hash = detail::fnv1a(chunk.data(), file.gcount(), hash);
+        }
+    }
+    return detail::toHex(hash);
+}
+
+//!
+//! \brief Hashes a string, e.g. a description of the options a file was produced with.
+//!
+inline std::string hashString(const std::string& s)
+{
+    return detail::toHex(detail::fnv1a(s.data(), s.size()));
+}
+
+//!
+//! \brief Converts the per-tensor scales of a cache written by TensorRT to dynamic ranges.
+//!
+//! The cache starts with a version line followed by one "tensor: scale" line per tensor, the scale being the bits of
+//! a float in hexadecimal. The dynamic range of a tensor is its scale times 127.
+//!
+inline std::map<std::string, float> cacheToDynamicRanges(const void* cache, size_t length)
+{
+    std::map<std::string, float> ranges;
+    std::istringstream in(std::string(static_cast<const char*>(cache), length));
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line))
+    {
+        // Tensor names may contain colons, the scale follows the last one
+        const auto colon = line.rfind(':');
+        if (colon == std::string::npos || colon == 0)
+        {
+            continue;
+        }
+        const uint32_t bits = static_cast<uint32_t>(std::stoul(line.substr(colon + 1), nullptr, 16));
+        float scale{0};
+        std::memcpy(&scale, &bits, sizeof(scale));
+        ranges[line.substr(0, colon)] = scale * 127.0F;
+    }
+    return ranges;
+}
+
+//!
+//! \class CalibrationCacheKey
+//!
+//! \brief Identifies the calibration a cache entry was produced by.
+//!
+//! The per-tensor scales of a calibration do not depend on the maximum batch size or on the GPU, so neither is part of
+//! the key. A field left empty is not checked, e.g. when the model files are not known.
+//!
+class CalibrationCacheKey
+{
+public:
+    CalibrationCacheKey()
+    {
+        set("trt", std::to_string(NV_TENSORRT_VERSION));
+    }
+
+    CalibrationCacheKey& setModel(const std::string& modelHash)
+    {
+        return set("model", modelHash);
+    }
+
+    CalibrationCacheKey& setAlgorithm(nvinfer1::CalibrationAlgoType algorithm)
+    {
+        return set("algorithm", std::to_string(static_cast<int>(algorithm)));
+    }
+
+    //!
+    //! \brief Adds an input of the network, dims are the dimensions of one sample without the batch dimension.
+    //!
+    CalibrationCacheKey& addInput(const std::string& name, const nvinfer1::Dims& dims)
+    {
+        std::string value = mFields["inputs"];
+        value += (value.empty() ? "" : ",") + name + ":";
+        for (int i = 0; i < dims.nbDims; ++i)
+        {
+            value += (i ? "x" : "") + std::to_string(dims.d[i]);
+        }
+        return set("inputs", value);
+    }
+
+    //!
+    //! \brief Whether an entry tagged with other was produced by this calibration.
+    //!
+    bool matches(const CalibrationCacheKey& other) const
+    {
+        for (const auto& field : mFields)
+        {
+            if (!field.second.empty())
+            {
+                auto it = other.mFields.find(field.first);
+                if (it == other.mFields.end() || it->second != field.second)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::string toString() const
+    {
+        std::string s;
+        for (const auto& field : mFields)
+        {
+            s += (s.empty() ? "" : " ") + field.first + "=" + field.second;
+        }
+        return s;
+    }
+
+    static CalibrationCacheKey fromString(const std::string& s)
+    {
+        CalibrationCacheKey key;
+        key.mFields.clear();
+        std::istringstream in(s);
+        std::string field;
+        while (in >> field)
+        {
+            const auto pos = field.find('=');
+            if (pos != std::string::npos)
+            {
+                key.mFields[field.substr(0, pos)] = field.substr(pos + 1);
+            }
+        }
+        return key;
+    }
+
+private:
+    CalibrationCacheKey& set(const std::string& name, std::string value)
+    {
+        // Keep the fields parseable by fromString
+        for (auto& c : value)
+        {
+            if (std::isspace(static_cast<unsigned char>(c)) || c == '=')
+            {
+                c = '_';
+            }
+        }
+        mFields[name] = value;
+        return *this;
+    }
+
+    std::map<std::string, std::string> mFields;
+};
+
+//!
+//! \class CalibrationCache
+//!
+//! \brief A calibration cache file holding one entry per CalibrationCacheKey.
+//!
+//! Every entry is a header line with its key and length, followed by the cache written by TensorRT. An entry is only
+//! returned to a calibrator whose key it matches, so rebuilding the same model reuses the scales while a changed model
+//! recalibrates. Files written without keys are still read, with a warning since they cannot be checked.
+//!
+class CalibrationCache
+{
+public:
+    CalibrationCache(std::string fileName, CalibrationCacheKey key)
+        : mFileName(std::move(fileName))
+        , mKey(std::move(key))
+    {
+    }
+
+    //!
+    //! \brief Returns the cache of the entry matching the key, or nullptr if there is none.
+    //!
+    const void* read(size_t& length)
+    {
+        mCache.clear();
+        std::vector<Entry> entries;
+        bool tagged{true};
+        if (load(entries, tagged) && !tagged)
+        {
+            gLogWarning << "Calibration cache " << mFileName << " has no key, it cannot be checked against the model"
+                        << std::endl;
+            mCache = std::move(entries.front().cache);
+        }
+        else
+        {
+            for (auto& entry : entries)
+            {
+                if (mKey.matches(entry.key))
+                {
+                    mCache = std::move(entry.cache);
+                    break;
+                }
+            }
+            if (!entries.empty() && mCache.empty())
+            {
+                gLogInfo << "No entry of calibration cache " << mFileName << " matches " << mKey.toString()
+                         << ", recalibrating" << std::endl;
+            }
+        }
+        length = mCache.size();
+        return length ? mCache.data() : nullptr;
+    }
+
+    //!
+    //! \brief Stores the cache under the key, replacing the entries it matches and keeping the others.
+    //!
+    void write(const void* cache, size_t length)
+    {
+        std::vector<Entry> entries;
+        bool tagged{true};
+        if (!load(entries, tagged) || !tagged)
+        {
+            entries.clear();
+        }
+
+        std::ofstream output(mFileName, std::ios::binary);
+        for (const auto& entry : entries)
+        {
+            if (!mKey.matches(entry.key))
+            {
+                writeEntry(output, entry.key, entry.cache.data(), entry.cache.size());
+            }
+        }
+        writeEntry(output, mKey, cache, length);
+    }
+
+private:
+    struct Entry
+    {
+        CalibrationCacheKey key;
+        std::vector<char> cache;
+    };
+
+    static const std::string& magic()
+    {
+        static const std::string kMagic{"#TRT-CALIBRATION-CACHE-ENTRY"};
+        return kMagic;
+    }
+
+    //! Returns false if the file cannot be read, tagged is false for a file without headers
+    bool load(std::vector<Entry>& entries, bool& tagged) const
+    {
+        std::ifstream input(mFileName, std::ios::binary);
+        if (!input.good())
+        {
+            return false;
+        }
+        std::vector<char> contents{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+        tagged = contents.size() >= magic().size() && std::equal(magic().begin(), magic().end(), contents.begin());
+        if (!tagged)
+        {
+            entries.push_back(Entry{CalibrationCacheKey{}, std::move(contents)});
+            return !entries.back().cache.empty();
+        }
+
+        for (size_t pos = 0; pos < contents.size();)
+        {
+            const auto eol = std::find(contents.begin() + pos, contents.end(), '\n');
+            const std::string header(contents.begin() + pos, eol);
+            if (header.compare(0, magic().size(), magic()) != 0 || eol == contents.end())
+            {
+                gLogWarning << "Calibration cache " << mFileName << " is corrupted, ignoring the rest of it" << std::endl;
+                break;
+            }
+            // The header is the magic, the key fields and the length of the cache last
+            const auto lengthPos = header.rfind(' ');
+            const size_t length = std::stoull(header.substr(lengthPos + 1));
+            const size_t begin = eol - contents.begin() + 1;
+            if (begin + length > contents.size())
+            {
+                gLogWarning << "Calibration cache " << mFileName << " is truncated, ignoring the rest of it" << std::endl;
+                break;
+            }
+            entries.push_back(Entry{CalibrationCacheKey::fromString(header.substr(magic().size(), lengthPos - magic().size())),
+                std::vector<char>(contents.begin() + begin, contents.begin() + begin + length)});
+            // Every entry ends with a newline to keep the file readable
+            pos = begin + length + 1;
+        }
+        return true;
+    }
+
+    static void writeEntry(std::ofstream& output, const CalibrationCacheKey& key, const void* cache, size_t length)
+    {
+        output << magic() << " " << key.toString() << " " << length << "\n";
+        output.write(static_cast<const char*>(cache), length);
+        output << "\n";
+    }
+
+    std::string mFileName;
+    CalibrationCacheKey mKey;
+    std::vector<char> mCache;
+};
+
+} // namespace samplesCommon
+
+#endif // CALIBRATION_CACHE_H
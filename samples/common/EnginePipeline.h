@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ENGINE_PIPELINE_H
+#define ENGINE_PIPELINE_H
+
+#include "NvInfer.h"
+#include "buffers.h"
+#include "common.h"
+#include <algorithm>
+#include <cuda_runtime_api.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace samplesCommon
+{
+
+//!
+//! \class EnginePipeline
+//!
+//! \brief Chain of explicit batch engines whose linked outputs are bound as the inputs of the next stage.
+//!
+//! Each link binds an output of a stage and an input of the next one to the same device buffer, so the data passed
+//! between stages never leaves the device. The other bindings get their own device buffers. Once the inputs of the
+//! first stage are set, resolve() propagates the linked output dimensions to the dynamic inputs of the next stages and
+//! sizes the buffers, then enqueue() runs all the stages on one stream, or as one CUDA graph once captured. The stages
+//! run the optimization profile their contexts are set to, with the bindings of the first profile.
+//!
+class EnginePipeline
+{
+public:
+    struct Link
+    {
+        std::string output;
+        std::string input;
+    };
+
+    //!
+    //! \param links The links of each stage to the next one, one list less than the contexts
+    //!
+    EnginePipeline(std::vector<nvinfer1::IExecutionContext*> contexts, const std::vector<std::vector<Link>>& links)
+        : mStages(contexts.size())
+    {
+        if (contexts.empty() || links.size() + 1 != contexts.size())
+        {
+            throw std::runtime_error("A pipeline needs one list of links between each pair of successive stages");
+        }
+        for (size_t s = 0; s < contexts.size(); ++s)
+        {
+            auto& stage = mStages[s];
+            stage.context = contexts[s];
+            const auto& engine = stage.context->getEngine();
+            if (engine.hasImplicitBatchDimension())
+            {
+                throw std::runtime_error("Pipeline stages must be explicit batch engines");
+            }
+            const int nbBindings = engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+            stage.bindings.resize(nbBindings, nullptr);
+            stage.sources.resize(nbBindings, -1);
+            for (int b = 0; b < nbBindings; ++b)
+            {
+                stage.buffers.emplace_back(engine.getBindingDataType(b));
+            }
+        }
+        for (size_t s = 0; s < links.size(); ++s)
+        {
+            const auto& producer = mStages[s].context->getEngine();
+            const auto& consumer = mStages[s + 1].context->getEngine();
+            for (const auto& link : links[s])
+            {
+                const int output = producer.getBindingIndex(link.output.c_str());
+                const int input = consumer.getBindingIndex(link.input.c_str());
+                if (output < 0 || producer.bindingIsInput(output) || input < 0 || !consumer.bindingIsInput(input))
+                {
+                    throw std::runtime_error("Unknown pipeline link " + link.output + " -> " + link.input);
+                }
+                if (producer.getBindingDataType(output) != consumer.getBindingDataType(input))
+                {
+                    throw std::runtime_error("Pipeline link " + link.output + " -> " + link.input + " changes type");
+                }
+                mStages[s + 1].sources[input] = output;
+            }
+        }
+    }
+
+    ~EnginePipeline()
+    {
+        resetGraph();
+    }
+
+    EnginePipeline(const EnginePipeline&) = delete;
+
+    EnginePipeline& operator=(const EnginePipeline&) = delete;
+
+    //!
+    //! \brief Sets the dimensions of an input that is not linked, such as the inputs of the first stage.
+    //!
+    bool setInputDimensions(int stage, const std::string& input, const nvinfer1::Dims& dims)
+    {
+        auto& context = *mStages[stage].context;
+        const int index = context.getEngine().getBindingIndex(input.c_str());
+        return index >= 0 && context.setBindingDimensions(index, dims);
+    }
+
+    //!
+    //! \brief Propagates the dimensions of the linked outputs to the next stages and sizes the device buffers.
+    //!
+    //! The buffers only grow, the bindings and a captured graph are updated when an address or dimension changed.
+    //!
+    //! \return False if the dimensions of a stage are not all specified, or a linked input rejects its dimensions.
+    //!
+    bool resolve()
+    {
+        bool changed{false};
+        for (size_t s = 0; s < mStages.size(); ++s)
+        {
+            auto& stage = mStages[s];
+            auto& context = *stage.context;
+            const auto& engine = context.getEngine();
+            for (int b = 0; b < static_cast<int>(stage.bindings.size()); ++b)
+            {
+                const int source = stage.sources[b];
+                if (source < 0)
+                {
+                    continue;
+                }
+                const nvinfer1::Dims dims = mStages[s - 1].context->getBindingDimensions(source);
+                const nvinfer1::Dims declared = engine.getBindingDimensions(b);
+                const bool dynamic = std::any_of(declared.d, declared.d + declared.nbDims, [](int d) { return d < 0; });
+                if (dynamic ? !context.setBindingDimensions(b, dims) : volume(dims) != volume(declared))
+                {
+                    return false;
+                }
+            }
+            if (!context.allInputDimensionsSpecified())
+            {
+                return false;
+            }
+            for (int b = 0; b < static_cast<int>(stage.bindings.size()); ++b)
+            {
+                void* previous = stage.bindings[b];
+                if (stage.sources[b] >= 0)
+                {
+                    stage.bindings[b] = mStages[s - 1].bindings[stage.sources[b]];
+                }
+                else
+                {
+                    stage.buffers[b].resize(context.getBindingDimensions(b));
+                    stage.bindings[b] = stage.buffers[b].data();
+                }
+                changed = changed || previous != stage.bindings[b];
+            }
+        }
+
+        // A graph captures the addresses and the shapes of its enqueue
+        if (changed || shapesChanged())
+        {
+            resetGraph();
+        }
+        return true;
+    }
+
+    //!
+    //! \brief The device buffer of a binding of a stage, linked inputs share the buffer of their output.
+    //!
+    void* binding(int stage, const std::string& name)
+    {
+        const int index = mStages[stage].context->getEngine().getBindingIndex(name.c_str());
+        return index < 0 ? nullptr : mStages[stage].bindings[index];
+    }
+
+    //!
+    //! \brief Enqueues all the stages on the stream, as the captured graph if any.
+    //!
+    bool enqueue(cudaStream_t stream)
+    {
+#if CUDA_VERSION >= 10000
+        if (mGraphExec)
+        {
+            return cudaGraphLaunch(mGraphExec, stream) == cudaSuccess;
+        }
+#endif
+        for (auto& stage : mStages)
+        {
+            if (!stage.context->enqueueV2(stage.bindings.data(), stream, nullptr))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //!
+    //! \brief Captures the enqueue of all the stages into a CUDA graph, launched by the next enqueues.
+    //!
+    //! The graph is dropped by resolve() when the buffers or the dimensions change, it then needs a new capture.
+    //!
+    //! \return False if the stages cannot be captured, enqueue then runs them one by one.
+    //!
+    bool capture(cudaStream_t stream)
+    {
+        resetGraph();
+#if CUDA_VERSION >= 10000
+        if (cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal) != cudaSuccess)
+        {
+            return false;
+        }
+        const bool enqueued = enqueue(stream);
+        cudaGraph_t graph{};
+        const bool captured = cudaStreamEndCapture(stream, &graph) == cudaSuccess && enqueued;
+        if (captured && cudaGraphInstantiate(&mGraphExec, graph, nullptr, nullptr, 0) != cudaSuccess)
+        {
+            mGraphExec = nullptr;
+        }
+        if (graph)
+        {
+            cudaGraphDestroy(graph);
+        }
+        // A failed capture leaves an error behind, it is not the one of a later call
+        cudaGetLastError();
+        return mGraphExec != nullptr;
+#else
+        return false;
+#endif
+    }
+
+private:
+    struct Stage
+    {
+        nvinfer1::IExecutionContext* context;
+        std::vector<void*> bindings;
+        std::vector<int> sources; // Output of the previous stage bound to each binding, -1 for an own buffer
+        std::vector<DeviceBuffer> buffers;
+        std::vector<nvinfer1::Dims> dims; // Dimensions of the bindings at the last resolve
+    };
+
+    bool shapesChanged()
+    {
+        bool changed{false};
+        for (auto& stage : mStages)
+        {
+            std::vector<nvinfer1::Dims> dims;
+            for (int b = 0; b < static_cast<int>(stage.bindings.size()); ++b)
+            {
+                dims.push_back(stage.context->getBindingDimensions(b));
+            }
+            const auto same = [](const nvinfer1::Dims& a, const nvinfer1::Dims& b) {
+                return a.nbDims == b.nbDims && std::equal(a.d, a.d + a.nbDims, b.d);
+            };
+            changed = changed || stage.dims.size() != dims.size()
+                || !std::equal(dims.begin(), dims.end(), stage.dims.begin(), same);
+            stage.dims = std::move(dims);
+        }
+        return changed;
+    }
+
+    void resetGraph()
+    {
+#if CUDA_VERSION >= 10000
+        if (mGraphExec)
+        {
+            cudaGraphExecDestroy(mGraphExec);
+            mGraphExec = nullptr;
+        }
+#endif
+    }
+
+    std::vector<Stage> mStages;
+#if CUDA_VERSION >= 10000
+    cudaGraphExec_t mGraphExec{nullptr};
+#endif
+};
+
+} // namespace samplesCommon
+
+#endif // ENGINE_PIPELINE_H
@@ -18,7 +18,14 @@
 #define ENTROPY_CALIBRATOR_H
 
 #include "BatchStream.h"
+#include "CalibrationCache.h"
 #include "NvInfer.h"
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 //! \class EntropyCalibratorImpl
 //!
@@ -28,22 +35,53 @@ template <typename TBatchStream>
 class EntropyCalibratorImpl
 {
 public:
-    EntropyCalibratorImpl(
-        TBatchStream stream, int firstBatch, std::string networkName, const char* inputBlobName, bool readCache = true)
+    //!
+    //! \param maxBatches Calibrate with the first maxBatches batches of the stream only, 0 for all of them. The cache
+    //!        of a partial calibration is kept in memory, and only written by saveCalibrationCache().
+    //!
+    EntropyCalibratorImpl(TBatchStream stream, int firstBatch, std::string networkName, const char* inputBlobName,
+        nvinfer1::CalibrationAlgoType algorithm, const std::string& modelHash, bool readCache = true,
+        int maxBatches = 0)
         : mStream{stream}
-        , mCalibrationTableName("CalibrationTable" + networkName)
         , mInputBlobName(inputBlobName)
         , mReadCache(readCache)
+        , mMaxBatches(maxBatches)
+        , mCalibrationCache(
+              "CalibrationTable" + networkName, makeCacheKey(mStream.getDims(), inputBlobName, algorithm, modelHash))
     {
         nvinfer1::Dims dims = mStream.getDims();
         mInputCount = samplesCommon::volume(dims);
-        CHECK(cudaMalloc(&mDeviceInput, mInputCount * sizeof(float)));
         mStream.reset(firstBatch);
+
+        CHECK(cudaGetDevice(&mDevice));
+        CHECK(cudaStreamCreateWithFlags(&mCopyStream, cudaStreamNonBlocking));
+        for (int i = 0; i < kPrefetchDepth; ++i)
+        {
+            CHECK(cudaMallocHost(reinterpret_cast<void**>(&mSlots[i].host), mInputCount * sizeof(float)));
+            CHECK(cudaMalloc(&mSlots[i].device, mInputCount * sizeof(float)));
+            CHECK(cudaEventCreateWithFlags(&mSlots[i].copied, cudaEventDisableTiming));
+            mFreeSlots.push_back(i);
+        }
+        mProducer = std::thread(&EntropyCalibratorImpl::produce, this);
     }
 
     virtual ~EntropyCalibratorImpl()
     {
-        CHECK(cudaFree(mDeviceInput));
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mProducer.join();
+
+        CHECK(cudaStreamSynchronize(mCopyStream));
+        for (auto& slot : mSlots)
+        {
+            CHECK(cudaEventDestroy(slot.copied));
+            CHECK(cudaFree(slot.device));
+            CHECK(cudaFreeHost(slot.host));
+        }
+        CHECK(cudaStreamDestroy(mCopyStream));
     }
 
     int getBatchSize() const
@@ -53,44 +91,172 @@ public:
 
     bool getBatch(void* bindings[], const char* names[], int nbBindings)
     {
-        if (!mStream.next())
+        int slot{-1};
         {
-            return false;
+            std::unique_lock<std::mutex> lock(mMutex);
+            // TensorRT is done with the batch returned by the previous call
+            if (mBoundSlot >= 0)
+            {
+                mFreeSlots.push_back(mBoundSlot);
+                mBoundSlot = -1;
+                mCondition.notify_all();
+            }
+            mCondition.wait(lock, [this] { return mStreamDone || !mReadySlots.empty(); });
+            if (mReadySlots.empty())
+            {
+                return false;
+            }
+            slot = mReadySlots.front();
+            mReadySlots.pop_front();
+            mBoundSlot = slot;
         }
-        CHECK(cudaMemcpy(mDeviceInput, mStream.getBatch(), mInputCount * sizeof(float), cudaMemcpyHostToDevice));
+        CHECK(cudaEventSynchronize(mSlots[slot].copied));
         assert(!strcmp(names[0], mInputBlobName));
-        bindings[0] = mDeviceInput;
+        bindings[0] = mSlots[slot].device;
         return true;
     }
 
     const void* readCalibrationCache(size_t& length)
     {
-        mCalibrationCache.clear();
-        std::ifstream input(mCalibrationTableName, std::ios::binary);
-        input >> std::noskipws;
-        if (mReadCache && input.good())
+        if (!mReadCache)
         {
-            std::copy(std::istream_iterator<char>(input), std::istream_iterator<char>(),
-                std::back_inserter(mCalibrationCache));
+            length = 0;
+            return nullptr;
         }
-        length = mCalibrationCache.size();
-        return length ? mCalibrationCache.data() : nullptr;
+        const void* cache = mCalibrationCache.read(length);
+        mCacheRead = cache != nullptr;
+        return cache;
     }
 
     void writeCalibrationCache(const void* cache, size_t length)
     {
-        std::ofstream output(mCalibrationTableName, std::ios::binary);
-        output.write(reinterpret_cast<const char*>(cache), length);
+        mTable.assign(static_cast<const char*>(cache), length);
+        if (!mMaxBatches)
+        {
+            mCalibrationCache.write(cache, length);
+        }
+    }
+
+    //!
+    //! \brief The cache TensorRT wrote at the end of the calibration, empty if it calibrated from a cache
+    //!
+    const std::string& calibrationTable() const
+    {
+        return mTable;
+    }
+
+    //!
+    //! \brief Whether TensorRT took the scales from the cache file instead of calibrating
+    //!
+    bool cacheRead() const
+    {
+        return mCacheRead;
+    }
+
+    //!
+    //! \brief Write the cache TensorRT wrote to the cache file, for a partial calibration found to be enough
+    //!
+    void saveCalibrationCache()
+    {
+        mCalibrationCache.write(mTable.data(), mTable.size());
     }
 
 private:
-    TBatchStream mStream;
+    static samplesCommon::CalibrationCacheKey makeCacheKey(nvinfer1::Dims dims, const char* inputBlobName,
+        nvinfer1::CalibrationAlgoType algorithm, const std::string& modelHash)
+    {
+        // BatchStream reports the dimensions of a whole batch file, MNISTBatchStream those of one image
+        if (dims.nbDims == 4)
+        {
+            dims = nvinfer1::Dims3{dims.d[1], dims.d[2], dims.d[3]};
+        }
+        samplesCommon::CalibrationCacheKey key;
+        key.setModel(modelHash).setAlgorithm(algorithm).addInput(inputBlobName, dims);
+        return key;
+    }
+
+    //! Reads and uploads the batches ahead of getBatch, so that decoding the next batch overlaps with the
+    //! calibration of the current one
+    void produce()
+    {
+        CHECK(cudaSetDevice(mDevice));
+        for (;;)
+        {
+            int slot{-1};
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this] { return mStop || !mFreeSlots.empty(); });
+                if (mStop)
+                {
+                    return;
+                }
+                slot = mFreeSlots.front();
+                mFreeSlots.pop_front();
+            }
+
+            const bool hasBatch = (mMaxBatches <= 0 || mProduced < mMaxBatches) && mStream.next();
+            if (hasBatch)
+            {
+                ++mProduced;
+                Slot& s = mSlots[slot];
+                std::copy_n(mStream.getBatch(), mInputCount, s.host);
+                CHECK(cudaMemcpyAsync(
+                    s.device, s.host, mInputCount * sizeof(float), cudaMemcpyHostToDevice, mCopyStream));
+                CHECK(cudaEventRecord(s.copied, mCopyStream));
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (hasBatch)
+                {
+                    mReadySlots.push_back(slot);
+                }
+                else
+                {
+                    mFreeSlots.push_back(slot);
+                    mStreamDone = true;
+                }
+            }
+            mCondition.notify_all();
+            if (!hasBatch)
+            {
+                return;
+            }
+        }
+    }
+
+    //! One batch in flight, from the pinned host copy to the device buffer bound for TensorRT
+    struct Slot
+    {
+        float* host{nullptr};
+        void* device{nullptr};
+        cudaEvent_t copied{nullptr};
+    };
+
+    //! One slot is bound for TensorRT while the producer fills the others
+    static constexpr int kPrefetchDepth = 3;
+
+    TBatchStream mStream; //!< Only used by the producer thread once it is started
     size_t mInputCount;
-    std::string mCalibrationTableName;
     const char* mInputBlobName;
     bool mReadCache{true};
-    void* mDeviceInput{nullptr};
-    std::vector<char> mCalibrationCache;
+    int mMaxBatches{0};
+    int mProduced{0}; //!< Batches read by the producer thread
+    samplesCommon::CalibrationCache mCalibrationCache;
+    std::string mTable;
+    bool mCacheRead{false};
+
+    int mDevice{0};
+    cudaStream_t mCopyStream{nullptr};
+    std::array<Slot, kPrefetchDepth> mSlots;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<int> mFreeSlots;  //!< Slots the producer may fill
+    std::deque<int> mReadySlots; //!< Uploaded batches, in stream order
+    int mBoundSlot{-1};          //!< Slot returned by the last getBatch call
+    bool mStreamDone{false};
+    bool mStop{false};
+    std::thread mProducer;
 };
 
 //! \class Int8EntropyCalibrator2
@@ -102,9 +268,16 @@ template <typename TBatchStream>
 class Int8EntropyCalibrator2 : public IInt8EntropyCalibrator2
 {
 public:
-    Int8EntropyCalibrator2(
-        TBatchStream stream, int firstBatch, const char* networkName, const char* inputBlobName, bool readCache = true)
-        : mImpl(stream, firstBatch, networkName, inputBlobName, readCache)
+    //!
+    //! \param modelHash Hash of the model files from samplesCommon::hashModelFiles, the calibration cache is only reused
+    //!        for the same model. An empty hash reuses the cache of any model with the same input.
+    //!
+    //! \param maxBatches Calibrate with the first maxBatches batches of the stream only, 0 for all of them.
+    //!
+    Int8EntropyCalibrator2(TBatchStream stream, int firstBatch, const char* networkName, const char* inputBlobName,
+        bool readCache = true, const std::string& modelHash = "", int maxBatches = 0)
+        : mImpl(stream, firstBatch, networkName, inputBlobName, CalibrationAlgoType::kENTROPY_CALIBRATION_2, modelHash,
+            readCache, maxBatches)
     {
     }
 
@@ -128,6 +301,21 @@ public:
         mImpl.writeCalibrationCache(cache, length);
     }
 
+    const std::string& calibrationTable() const
+    {
+        return mImpl.calibrationTable();
+    }
+
+    bool cacheRead() const
+    {
+        return mImpl.cacheRead();
+    }
+
+    void saveCalibrationCache()
+    {
+        mImpl.saveCalibrationCache();
+    }
+
 private:
     EntropyCalibratorImpl<TBatchStream> mImpl;
 };
@@ -17,81 +17,80 @@
 #ifndef ERROR_RECORDER_H
 #define ERROR_RECORDER_H
 #include "NvInferRuntimeCommon.h"
+#include <array>
 #include <atomic>
 #include <cstdint>
-#include <exception>
-#include <mutex>
-#include <vector>
+#include <cstring>
 using namespace nvinfer1;
 //!
 //! A simple imeplementation of the IErrorRecorder interface for
 //! use by samples. This interface also can be used as a reference
 //! implementation.
-//! The sample Error recorder is based on a vector that pairs the error
-//! code and the error string into a single element. It also uses
-//! standard mutex's and atomics in order to make sure that the code
-//! works in a multi-threaded environment.
+//! The sample Error recorder keeps the errors in a fixed array of slots,
+//! each pairing the error code with a copy of the error string. A thread
+//! reporting an error claims the next slot with an atomic increment and
+//! publishes it once written, so that neither reporting nor querying takes
+//! a lock when several threads share the recorder. Errors past the last
+//! slot are counted but dropped, which hasOverflowed reports.
 //! SampleErrorRecorder is not intended for use in automotive safety
 //! environments.
 //!
 class SampleErrorRecorder : public IErrorRecorder
 {
-    using errorPair = std::pair<ErrorCode, std::string>;
-    using errorStack = std::vector<errorPair>;
-
 public:
+    //! Number of errors kept, the errors reported after them are dropped
+    static constexpr int32_t kMaxErrors = 256;
+    //! Size of the copy of each error string, longer ones are truncated
+    static constexpr size_t kMaxDescLength = 256;
+
     SampleErrorRecorder() = default;
 
     virtual ~SampleErrorRecorder() noexcept {}
     int32_t getNbErrors() const noexcept final
     {
-        return mErrorStack.size();
+        const int32_t nbReported = mNbReported.load(std::memory_order_acquire);
+        return nbReported < kMaxErrors ? nbReported : kMaxErrors;
     }
     ErrorCode getErrorCode(int32_t errorIdx) const noexcept final
     {
-        return indexCheck(errorIdx) ? ErrorCode::kINVALID_ARGUMENT : (*this)[errorIdx].first;
+        return indexCheck(errorIdx) ? ErrorCode::kINVALID_ARGUMENT : mErrors[errorIdx].code;
     };
     IErrorRecorder::ErrorDesc getErrorDesc(int32_t errorIdx) const noexcept final
     {
-        return indexCheck(errorIdx) ? "errorIdx out of range." : (*this)[errorIdx].second.c_str();
+        return indexCheck(errorIdx) ? "errorIdx out of range." : mErrors[errorIdx].desc.data();
     }
-    // This class can never overflow since we have dynamic resize via std::vector usage.
     bool hasOverflowed() const noexcept final
     {
-        return false;
+        return mNbReported.load(std::memory_order_acquire) > kMaxErrors;
     }
 
-    // Empty the errorStack.
+    // Empty the error slots, which must not run concurrently with reportError.
     void clear() noexcept final
     {
-        try
+        const int32_t nbErrors = getNbErrors();
+        for (int32_t i = 0; i < nbErrors; ++i)
         {
-            // grab a lock so that there is no addition while clearing.
-            std::lock_guard<std::mutex> guard(mStackLock);
-            mErrorStack.clear();
-        }
-        catch (const std::exception& e)
-        {
-            getLogger()->log(ILogger::Severity::kINTERNAL_ERROR, e.what());
+            mErrors[i].ready.store(false, std::memory_order_relaxed);
         }
+        mNbReported.store(0, std::memory_order_release);
     };
 
     //! Simple helper function that
     bool empty() const noexcept
     {
-        return mErrorStack.empty();
+        return mNbReported.load(std::memory_order_acquire) == 0;
     }
 
     bool reportError(ErrorCode val, IErrorRecorder::ErrorDesc desc) noexcept final
     {
-        try
+        const int32_t index = mNbReported.fetch_add(1, std::memory_order_acq_rel);
+        if (index < kMaxErrors)
         {
-            std::lock_guard<std::mutex> guard(mStackLock);
-            mErrorStack.push_back(errorPair(val, desc));
-        }
-        catch (const std::exception& e)
-        {
-            getLogger()->log(ILogger::Severity::kINTERNAL_ERROR, e.what());
+            auto& error = mErrors[index];
+            error.code = val;
+            std::strncpy(error.desc.data(), desc ? desc : "", kMaxDescLength - 1);
+            error.desc[kMaxDescLength - 1] = '\0';
+            error.ready.store(true, std::memory_order_release);
         }
         // All errors are considered fatal.
         return true;
@@ -108,27 +107,30 @@ public:
     }
 
 private:
-    // Simple helper functions.
-    const errorPair& operator[](size_t index) const noexcept
+    struct Error
     {
-        return mErrorStack[index];
-    }
+        std::atomic<bool> ready{false}; // Set once code and desc are written
+        ErrorCode code{ErrorCode::kSUCCESS};
+        std::array<char, kMaxDescLength> desc{};
+    };
 
     bool indexCheck(int32_t index) const noexcept
     {
         // By converting signed to unsigned, we only need a single check since
         // negative numbers turn into large positive greater than the size.
+        // A slot still being written by its reporting thread is not readable yet.
         size_t sIndex = index;
-        return sIndex >= mErrorStack.size();
+        return sIndex >= static_cast<size_t>(getNbErrors()) || !mErrors[sIndex].ready.load(std::memory_order_acquire);
     }
-    // Mutex to hold when locking mErrorStack.
-    std::mutex mStackLock;
 
     // Reference count of the class. Destruction of the class when mRefCount
     // is not zero causes undefined behavior.
     std::atomic<int32_t> mRefCount{0};
 
-    // The error stack that holds the errors recorded by TensorRT.
-    errorStack mErrorStack;
+    // Number of errors reported since the last clear, including the dropped ones.
+    std::atomic<int32_t> mNbReported{0};
+
+    // The error slots that hold the errors recorded by TensorRT.
+    std::array<Error, kMaxErrors> mErrors;
 };     // class SampleErrorRecorder
 #endif // ERROR_RECORDER_H
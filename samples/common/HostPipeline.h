@@ -0,0 +1,579 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HOST_PIPELINE_H
+#define HOST_PIPELINE_H
+
+#include "sampleDevice.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace samplesCommon
+{
+
+//!
+//! \class BoundedQueue
+//!
+//! \brief FIFO of at most capacity items, push() waits while it is full and pop() while it is empty, until closed.
+//!
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity)
+        : mCapacity(std::max<size_t>(capacity, 1))
+    {
+    }
+
+    //!
+    //! \return False if the queue is closed, the item is then dropped.
+    //!
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotFull.wait(lock, [this] { return mClosed || mItems.size() < mCapacity; });
+        if (mClosed)
+        {
+            return false;
+        }
+        mItems.push_back(std::move(item));
+        ++mPushes;
+        mDepthSum += mItems.size();
+        mMaxDepth = std::max(mMaxDepth, mItems.size());
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    //!
+    //! \return False once the queue is closed and empty.
+    //!
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return mClosed || !mItems.empty(); });
+        return take(item);
+    }
+
+    //!
+    //! \return False if the queue is empty.
+    //!
+    bool tryPop(T& item)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return take(item);
+    }
+
+    //!
+    //! \brief Wakes up the waiting calls, the items left can still be popped but no more pushed.
+    //!
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotFull.notify_all();
+        mNotEmpty.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mItems.size();
+    }
+
+    //!
+    //! \brief The mean depth seen by the pushes, the pushed item included.
+    //!
+    double meanDepth() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPushes ? static_cast<double>(mDepthSum) / mPushes : 0.;
+    }
+
+    size_t maxDepth() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mMaxDepth;
+    }
+
+private:
+    bool take(T& item)
+    {
+        if (mItems.empty())
+        {
+            return false;
+        }
+        item = std::move(mItems.front());
+        mItems.pop_front();
+        mNotFull.notify_one();
+        return true;
+    }
+
+    size_t mCapacity;
+    std::deque<T> mItems;
+    bool mClosed{false};
+    unsigned long long mPushes{0};
+    unsigned long long mDepthSum{0};
+    size_t mMaxDepth{0};
+    mutable std::mutex mMutex;
+    std::condition_variable mNotFull;
+    std::condition_variable mNotEmpty;
+};
+
+//!
+//! \class WorkStealingPool
+//!
+//! \brief Threads that each run the tasks of their own deque, newest first, and steal the oldest tasks of the others
+//!        once theirs is empty.
+//!
+//! Tasks submitted from a worker go to its own deque, so that the follow up of a task tends to run on the core that
+//! has its data in cache. Tasks submitted from other threads are dealt to the workers in turn. The tasks left are run
+//! before the destructor returns.
+//!
+class WorkStealingPool
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(int threads = static_cast<int>(std::thread::hardware_concurrency()))
+    {
+        const int workers = std::max(threads, 1);
+        for (int w = 0; w < workers; ++w)
+        {
+            mQueues.emplace_back(new WorkerQueue);
+        }
+        for (int w = 0; w < workers; ++w)
+        {
+            mThreads.emplace_back(&WorkStealingPool::work, this, w);
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mWake.notify_all();
+        for (auto& t : mThreads)
+        {
+            t.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task)
+    {
+        const Worker& self = currentWorker();
+        const size_t w = self.pool == this ? self.index : mNext++ % mQueues.size();
+        {
+            std::lock_guard<std::mutex> lock(mQueues[w]->mutex);
+            mQueues[w]->tasks.push_front(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mPending;
+        }
+        mWake.notify_one();
+    }
+
+    int getThreads() const
+    {
+        return static_cast<int>(mThreads.size());
+    }
+
+    //!
+    //! \brief The tasks run by another worker than the one they were queued to.
+    //!
+    unsigned long long getSteals() const
+    {
+        return mSteals;
+    }
+
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct Worker
+    {
+        const WorkStealingPool* pool;
+        size_t index;
+    };
+
+    static Worker& currentWorker()
+    {
+        static thread_local Worker worker{nullptr, 0};
+        return worker;
+    }
+
+    bool take(size_t w, Task& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mQueues[w]->mutex);
+            auto& own = mQueues[w]->tasks;
+            if (!own.empty())
+            {
+                task = std::move(own.front());
+                own.pop_front();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < mQueues.size(); ++k)
+        {
+            auto& victim = *mQueues[(w + k) % mQueues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                ++mSteals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(size_t w)
+    {
+        currentWorker() = Worker{this, w};
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWake.wait(lock, [this] { return mStop || mPending > 0; });
+                if (!mPending)
+                {
+                    return;
+                }
+                --mPending;
+            }
+            // Each pending count is a task in one of the deques that no other worker claimed, it is found soon
+            Task task;
+            while (!take(w, task))
+            {
+                std::this_thread::yield();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> mQueues;
+    std::vector<std::thread> mThreads;
+    std::atomic<size_t> mNext{0};
+    std::atomic<unsigned long long> mSteals{0};
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    size_t mPending{0};
+    bool mStop{false};
+};
+
+//!
+//! \class HostPipeline
+//!
+//! \brief Chain of CPU and GPU stages that the items pass through in turn, such as decode, inference and parsing.
+//!
+//! Each stage takes its items from a bounded queue and forwards them to the queue of the next stage. CPU stages run as
+//! tasks of a WorkStealingPool, which may be shared with other pipelines, on up to their parallelism of items at a
+//! time. GPU stages have one thread per stream of their own, that enqueues the work of an item on its stream and waits
+//! for it before forwarding the item. The stages are all added before the first submit().
+//!
+//! At most capacity items are in the pipeline, submit() waits beyond, so the queues never fill up and the workers of
+//! the pool never wait on them. Stages with more than one worker may reorder the items, which must be default
+//! constructible and movable.
+//!
+//! printReport() gives the throughput, busy time and queue depth of each stage: the bottleneck is the stage with the
+//! highest utilization, items pile up in its queue.
+//!
+template <typename Item>
+class HostPipeline
+{
+public:
+    //! Return false, or throw, to drop the item, which then counts as a failure of the stage
+    using CpuStage = std::function<bool(Item&)>;
+    using GpuStage = std::function<bool(Item&, sample::TrtCudaStream&)>;
+
+    //!
+    //! \param pool Runs the CPU stages, it must outlive the pipeline
+    //! \param capacity The items in the pipeline at most
+    //!
+    HostPipeline(WorkStealingPool& pool, size_t capacity)
+        : mPool(pool)
+        , mCapacity(std::max<size_t>(capacity, 1))
+    {
+    }
+
+    ~HostPipeline()
+    {
+        drain();
+        for (auto& stage : mStages)
+        {
+            stage->queue.close();
+            for (auto& t : stage->threads)
+            {
+                t.join();
+            }
+            // A drain task may still be about to find its queue empty
+            std::unique_lock<std::mutex> lock(stage->mutex);
+            stage->idle.wait(lock, [&stage] { return stage->active == 0; });
+        }
+    }
+
+    HostPipeline(const HostPipeline&) = delete;
+
+    HostPipeline& operator=(const HostPipeline&) = delete;
+
+    //!
+    //! \brief Appends a stage run by the pool on up to parallelism items at a time.
+    //!
+    void addCpuStage(const std::string& name, int parallelism, CpuStage run)
+    {
+        std::unique_ptr<Stage> stage{new Stage(name, mCapacity)};
+        stage->cpu = std::move(run);
+        stage->workers = std::max(parallelism, 1);
+        mStages.push_back(std::move(stage));
+    }
+
+    //!
+    //! \brief Appends a stage driven by one thread on each of streams streams created for it.
+    //!
+    void addGpuStage(const std::string& name, int streams, GpuStage run)
+    {
+        std::unique_ptr<Stage> stage{new Stage(name, mCapacity)};
+        stage->gpu = std::move(run);
+        stage->workers = std::max(streams, 1);
+        const size_t index = mStages.size();
+        Stage* s = stage.get();
+        for (int i = 0; i < stage->workers; ++i)
+        {
+            stage->streams.emplace_back(new sample::TrtCudaStream);
+        }
+        mStages.push_back(std::move(stage));
+        for (auto& stream : s->streams)
+        {
+            s->threads.emplace_back(&HostPipeline::driveGpu, this, index, s, stream.get());
+        }
+    }
+
+    //!
+    //! \brief Feeds an item to the first stage, once fewer than capacity items are in the pipeline.
+    //!
+    void submit(Item item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mSpace.wait(lock, [this] { return mInFlight < mCapacity; });
+            ++mInFlight;
+            if (!mStarted)
+            {
+                mStart = clock::now();
+                mStarted = true;
+            }
+        }
+        enter(0, std::move(item));
+    }
+
+    //!
+    //! \brief Waits until all the submitted items went through or were dropped.
+    //!
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mSpace.wait(lock, [this] { return mInFlight == 0; });
+        mEnd = clock::now();
+    }
+
+    //!
+    //! \brief Prints the metrics of each stage from the first submit() to the last drain(), or to now.
+    //!
+    void printReport(std::ostream& os) const
+    {
+        double seconds{0};
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto end = mInFlight || mEnd < mStart ? clock::now() : mEnd;
+            seconds = mStarted ? std::chrono::duration<double>(end - mStart).count() : 0.;
+        }
+        std::vector<double> utilization;
+        for (const auto& stage : mStages)
+        {
+            const double busy = stage->busyNs * 1e-9;
+            utilization.push_back(seconds > 0 ? busy / (seconds * stage->workers) : 0.);
+        }
+        const size_t bottleneck = std::max_element(utilization.begin(), utilization.end()) - utilization.begin();
+
+        os << "=== Pipeline Stages ===" << std::endl;
+        for (size_t s = 0; s < mStages.size(); ++s)
+        {
+            const auto& stage = *mStages[s];
+            const unsigned long long items = stage.items;
+            os << stage.name << " (" << stage.workers << (stage.cpu ? " CPU tasks" : " streams") << "): " << items
+               << " items, " << (seconds > 0 ? items / seconds : 0.) << " items/s, "
+               << (items ? stage.busyNs * 1e-6 / items : 0.) << " ms per item, " << utilization[s] * 100
+               << "% busy, queue depth mean " << stage.queue.meanDepth() << " max " << stage.queue.maxDepth();
+            if (stage.failures)
+            {
+                os << ", " << stage.failures << " failed";
+            }
+            if (s == bottleneck && mStages.size() > 1)
+            {
+                os << " <- bottleneck";
+            }
+            os << std::endl;
+        }
+        os << "Pool: " << mPool.getThreads() << " threads, " << mPool.getSteals() << " steals" << std::endl;
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Stage
+    {
+        Stage(const std::string& stageName, size_t capacity)
+            : name(stageName)
+            , queue(capacity)
+        {
+        }
+
+        std::string name;
+        CpuStage cpu;
+        GpuStage gpu;
+        int workers{1};
+        BoundedQueue<Item> queue;
+        std::vector<std::unique_ptr<sample::TrtCudaStream>> streams;
+        std::vector<std::thread> threads;
+        std::mutex mutex; // Orders the pops and the drain tasks of a CPU stage
+        std::condition_variable idle;
+        int active{0};    // Drain tasks of a CPU stage submitted and not done
+        std::atomic<unsigned long long> items{0};
+        std::atomic<unsigned long long> failures{0};
+        std::atomic<long long> busyNs{0};
+    };
+
+    void enter(size_t s, Item item)
+    {
+        if (s == mStages.size())
+        {
+            release();
+            return;
+        }
+        Stage& stage = *mStages[s];
+        stage.queue.push(std::move(item));
+        if (stage.cpu)
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            if (stage.active < stage.workers)
+            {
+                ++stage.active;
+                mPool.submit([this, s] { drainCpu(s); });
+            }
+        }
+    }
+
+    //! A task of a CPU stage runs its items until the queue is empty, within the parallelism of the stage
+    void drainCpu(size_t s)
+    {
+        Stage& stage = *mStages[s];
+        Item item;
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(stage.mutex);
+                if (!stage.queue.tryPop(item))
+                {
+                    if (--stage.active == 0)
+                    {
+                        stage.idle.notify_all();
+                    }
+                    return;
+                }
+            }
+            process(s, stage, item, [&stage](Item& i) { return stage.cpu(i); });
+        }
+    }
+
+    void driveGpu(size_t s, Stage* stage, sample::TrtCudaStream* stream)
+    {
+        Item item;
+        while (stage->queue.pop(item))
+        {
+            process(s, *stage, item, [stage, stream](Item& i) {
+                const bool enqueued = stage->gpu(i, *stream);
+                stream->synchronize();
+                return enqueued;
+            });
+        }
+    }
+
+    template <typename Run>
+    void process(size_t s, Stage& stage, Item& item, Run run)
+    {
+        const auto start = clock::now();
+        bool done{false};
+        try
+        {
+            done = run(item);
+        }
+        catch (const std::exception&)
+        {
+            done = false;
+        }
+        stage.busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        ++stage.items;
+        if (!done)
+        {
+            ++stage.failures;
+            release();
+            return;
+        }
+        enter(s + 1, std::move(item));
+    }
+
+    void release()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        --mInFlight;
+        mSpace.notify_all();
+    }
+
+    WorkStealingPool& mPool;
+    size_t mCapacity;
+    std::vector<std::unique_ptr<Stage>> mStages;
+    mutable std::mutex mMutex;
+    std::condition_variable mSpace;
+    size_t mInFlight{0};
+    bool mStarted{false};
+    clock::time_point mStart{};
+    clock::time_point mEnd{};
+};
+
+} // namespace samplesCommon
+
+#endif // HOST_PIPELINE_H
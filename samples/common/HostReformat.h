@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HOST_REFORMAT_H
+#define HOST_REFORMAT_H
+
+#include "NvInfer.h"
+#include "half.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HOST_REFORMAT_X86 1
+#include <immintrin.h>
+#endif
+
+namespace samplesCommon
+{
+
+//!
+//! \brief Shape of a tensor on the host, in linear NCHW and in a vectorized format of TensorRT
+//!
+//! The channels are the third dimension from the end, the area the product of the last two and the batch the product
+//! of the others. Vectorized formats pad the channels to a multiple of the vector: CHW2, CHW4, CHW16 and CHW32 store
+//! [N][C / vector][H][W][vector], HWC8 stores [N][H][W][C padded to 8].
+//!
+struct HostTensorLayout
+{
+    int batch{1};
+    int channels{1};
+    int area{1};
+    int vector{1};
+    bool channelsLast{false};
+
+    int blocks() const
+    {
+        return (channels + vector - 1) / vector;
+    }
+
+    int paddedChannels() const
+    {
+        return blocks() * vector;
+    }
+
+    size_t linearVolume() const
+    {
+        return static_cast<size_t>(batch) * channels * area;
+    }
+
+    size_t formattedVolume() const
+    {
+        return static_cast<size_t>(batch) * paddedChannels() * area;
+    }
+};
+
+//!
+//! \param dims The dimensions of the tensor, without the batch of implicit batch engines
+//! \param batch The batch of implicit batch engines, 1 otherwise
+//!
+inline HostTensorLayout hostTensorLayout(const nvinfer1::Dims& dims, nvinfer1::TensorFormat format, int batch = 1)
+{
+    HostTensorLayout layout;
+    layout.batch = std::max(batch, 1);
+    for (int d = 0; d < dims.nbDims; ++d)
+    {
+        const int e = dims.nbDims - d;
+        int& target = e > 3 ? layout.batch : e == 3 ? layout.channels : layout.area;
+        target *= std::max(dims.d[d], 1);
+    }
+    switch (format)
+    {
+    case nvinfer1::TensorFormat::kCHW2: layout.vector = 2; break;
+    case nvinfer1::TensorFormat::kCHW4: layout.vector = 4; break;
+    case nvinfer1::TensorFormat::kHWC8:
+        layout.vector = 8;
+        layout.channelsLast = true;
+        break;
+    case nvinfer1::TensorFormat::kCHW16: layout.vector = 16; break;
+    case nvinfer1::TensorFormat::kCHW32: layout.vector = 32; break;
+    default: break;
+    }
+    return layout;
+}
+
+namespace reformat
+{
+
+constexpr int kTILE{128};                           // Pixels of a channel converted at a time
+constexpr size_t kTHREAD_ELEMENTS{size_t(1) << 16}; // Fewest elements worth a thread of their own
+
+#if HOST_REFORMAT_X86
+//! F16C comes with every CPU that has AVX2, which unlike F16C all the supported compilers test for
+inline bool hasF16C()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+__attribute__((target("avx,f16c"))) inline void floatToHalfF16C(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    if (i < count)
+    {
+        // The tail goes through the same instruction, so that every value rounds alike
+        float tail[8]{};
+        uint16_t halves[8];
+        std::copy(src + i, src + count, tail);
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(tail), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(halves), h);
+        std::copy(halves, halves + (count - i), dst + i);
+    }
+}
+
+__attribute__((target("avx,f16c"))) inline void halfToFloatF16C(const uint16_t* src, float* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+    }
+    if (i < count)
+    {
+        uint16_t tail[8]{};
+        float floats[8];
+        std::copy(src + i, src + count, tail);
+        _mm256_storeu_ps(floats, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tail))));
+        std::copy(floats, floats + (count - i), dst + i);
+    }
+}
+#endif
+
+//!
+//! \brief Run run(begin, end) over ranges of the items on up to threads threads, 0 for a thread per CPU
+//!
+//! Tensors too small to amortize starting the threads run on the calling thread alone.
+//!
+template <typename Run>
+void parallelFor(size_t items, size_t itemElements, int threads, Run run)
+{
+    size_t workers = threads > 0 ? threads : std::max(std::thread::hardware_concurrency(), 1U);
+    workers = std::min(workers, std::max<size_t>(items * itemElements / kTHREAD_ELEMENTS, 1));
+    workers = std::min(workers, std::max<size_t>(items, 1));
+    if (workers <= 1)
+    {
+        run(size_t{0}, items);
+        return;
+    }
+    std::vector<std::thread> pool;
+    const size_t share = (items + workers - 1) / workers;
+    for (size_t begin = share; begin < items; begin += share)
+    {
+        pool.emplace_back(run, begin, std::min(begin + share, items));
+    }
+    run(size_t{0}, std::min(share, items));
+    for (auto& t : pool)
+    {
+        t.join();
+    }
+}
+
+} // namespace reformat
+
+//!
+//! \brief Converters of contiguous values, called as convert(src, dst, count)
+//!
+struct CopyValues
+{
+    template <typename T>
+    void operator()(const T* src, T* dst, size_t count) const
+    {
+        std::memcpy(dst, src, count * sizeof(T));
+    }
+};
+
+struct FloatToHalf
+{
+    void operator()(const float* src, half_float::half* dst, size_t count) const
+    {
+        static_assert(sizeof(half_float::half) == sizeof(uint16_t), "half_float::half holds the bits of a half");
+#if HOST_REFORMAT_X86
+        if (reformat::hasF16C())
+        {
+            reformat::floatToHalfF16C(src, reinterpret_cast<uint16_t*>(dst), count);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = static_cast<half_float::half>(src[i]);
+        }
+    }
+};
+
+struct HalfToFloat
+{
+    void operator()(const half_float::half* src, float* dst, size_t count) const
+    {
+#if HOST_REFORMAT_X86
+        if (reformat::hasF16C())
+        {
+            reformat::halfToFloatF16C(reinterpret_cast<const uint16_t*>(src), dst, count);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = static_cast<float>(src[i]);
+        }
+    }
+};
+
+//!
+//! \brief Quantize (x + offset) / scale to the nearest integer, ties to even, saturated to [-128, 127]
+//!
+//! The offset is applied before the scale, such as the subtraction of a mean.
+//!
+struct FloatToInt8
+{
+    explicit FloatToInt8(float scale = 1.F, float offset = 0.F)
+        : scale(scale)
+        , offset(offset)
+    {
+    }
+
+    float scale;
+    float offset;
+
+    void operator()(const float* src, int8_t* dst, size_t count) const
+    {
+        const float inverse = 1.F / scale;
+        size_t i = 0;
+#if HOST_REFORMAT_X86
+        // SSE2 is part of x86-64, four groups of four floats pack with saturation into sixteen bytes
+        const __m128 inv = _mm_set1_ps(inverse);
+        const __m128 off = _mm_set1_ps(offset);
+        const __m128 low = _mm_set1_ps(-128.F);
+        const __m128 high = _mm_set1_ps(127.F);
+        const auto quantize = [&](size_t at)
+        {
+            const __m128 x = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(src + at), off), inv);
+            return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, low), high));
+        };
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i words0 = _mm_packs_epi32(quantize(i), quantize(i + 4));
+            const __m128i words1 = _mm_packs_epi32(quantize(i + 8), quantize(i + 12));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi16(words0, words1));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            const float x = std::nearbyint((src[i] + offset) * inverse);
+            dst[i] = static_cast<int8_t>(std::max(-128.F, std::min(127.F, x)));
+        }
+    }
+};
+
+struct Int8ToFloat
+{
+    explicit Int8ToFloat(float scale = 1.F)
+        : scale(scale)
+    {
+    }
+
+    float scale;
+
+    void operator()(const int8_t* src, float* dst, size_t count) const
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[i] = src[i] * scale;
+        }
+    }
+};
+
+//!
+//! \brief Convert a linear NCHW tensor into a vectorized format, zeroing the padding channels
+//!
+//! Each channel is converted kTILE pixels at a time into a tile, so that the converter runs on contiguous values, then
+//! the tile is interleaved into the vectors of the format. The tiles are split across up to threads threads, 0 for a
+//! thread per CPU.
+//!
+template <typename Src, typename Dst, typename Convert>
+void packHost(const Src* linear, Dst* formatted, const HostTensorLayout& layout, Convert convert, int threads = 0)
+{
+    using reformat::kTILE;
+    const size_t area = layout.area;
+    const int tiles = (layout.area + kTILE - 1) / kTILE;
+    if (layout.vector == 1 && !layout.channelsLast)
+    {
+        const size_t planes = static_cast<size_t>(layout.batch) * layout.channels;
+        reformat::parallelFor(planes * tiles, kTILE, threads, [&](size_t begin, size_t end) {
+            for (size_t item = begin; item < end; ++item)
+            {
+                const size_t at = item / tiles * area + item % tiles * kTILE;
+                convert(linear + at, formatted + at, std::min<size_t>(kTILE, area - item % tiles * kTILE));
+            }
+        });
+        return;
+    }
+
+    const int vector = layout.vector;
+    const int blocks = layout.blocks();
+    const size_t pixelStride = layout.channelsLast ? layout.paddedChannels() : vector;
+    const size_t items = static_cast<size_t>(layout.batch) * blocks * tiles;
+    reformat::parallelFor(items, static_cast<size_t>(vector) * kTILE, threads, [&](size_t begin, size_t end) {
+        std::vector<Dst> tile(static_cast<size_t>(vector) * kTILE);
+        for (size_t item = begin; item < end; ++item)
+        {
+            const size_t n = item / (static_cast<size_t>(blocks) * tiles);
+            const int block = static_cast<int>(item / tiles % blocks);
+            const size_t first = item % tiles * kTILE;
+            const size_t count = std::min<size_t>(kTILE, area - first);
+            for (int v = 0; v < vector; ++v)
+            {
+                const int c = block * vector + v;
+                Dst* row = tile.data() + static_cast<size_t>(v) * kTILE;
+                if (c < layout.channels)
+                {
+                    convert(linear + (n * layout.channels + c) * area + first, row, count);
+                }
+                else
+                {
+                    std::fill(row, row + count, Dst{});
+                }
+            }
+            const size_t base = layout.channelsLast ? n * area * pixelStride + static_cast<size_t>(block) * vector
+                                                    : (n * blocks + block) * area * vector;
+            Dst* out = formatted + base + first * pixelStride;
+            for (size_t p = 0; p < count; ++p)
+            {
+                for (int v = 0; v < vector; ++v)
+                {
+                    out[p * pixelStride + v] = tile[static_cast<size_t>(v) * kTILE + p];
+                }
+            }
+        }
+    });
+}
+
+//!
+//! \brief Convert a tensor in a vectorized format into linear NCHW, dropping the padding channels
+//!
+template <typename Src, typename Dst, typename Convert>
+void unpackHost(const Src* formatted, Dst* linear, const HostTensorLayout& layout, Convert convert, int threads = 0)
+{
+    using reformat::kTILE;
+    const size_t area = layout.area;
+    const int tiles = (layout.area + kTILE - 1) / kTILE;
+    if (layout.vector == 1 && !layout.channelsLast)
+    {
+        packHost(formatted, linear, layout, convert, threads);
+        return;
+    }
+
+    const int vector = layout.vector;
+    const int blocks = layout.blocks();
+    const size_t pixelStride = layout.channelsLast ? layout.paddedChannels() : vector;
+    const size_t items = static_cast<size_t>(layout.batch) * blocks * tiles;
+    reformat::parallelFor(items, static_cast<size_t>(vector) * kTILE, threads, [&](size_t begin, size_t end) {
+        std::vector<Src> tile(static_cast<size_t>(vector) * kTILE);
+        for (size_t item = begin; item < end; ++item)
+        {
+            const size_t n = item / (static_cast<size_t>(blocks) * tiles);
+            const int block = static_cast<int>(item / tiles % blocks);
+            const size_t first = item % tiles * kTILE;
+            const size_t count = std::min<size_t>(kTILE, area - first);
+            const size_t base = layout.channelsLast ? n * area * pixelStride + static_cast<size_t>(block) * vector
+                                                    : (n * blocks + block) * area * vector;
+            const Src* in = formatted + base + first * pixelStride;
+            const int used = std::min(vector, layout.channels - block * vector);
+            for (size_t p = 0; p < count; ++p)
+            {
+                for (int v = 0; v < used; ++v)
+                {
+                    tile[static_cast<size_t>(v) * kTILE + p] = in[p * pixelStride + v];
+                }
+            }
+            for (int v = 0; v < used; ++v)
+            {
+                const int c = block * vector + v;
+                convert(tile.data() + static_cast<size_t>(v) * kTILE, linear + (n * layout.channels + c) * area + first,
+                    count);
+            }
+        }
+    });
+}
+
+} // namespace samplesCommon
+
+#endif // HOST_REFORMAT_H
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MULTI_GPU_CALIBRATION_H
+#define MULTI_GPU_CALIBRATION_H
+
+#include "EntropyCalibrator.h"
+#include "NvInfer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace samplesCommon
+{
+
+//!
+//! \class BatchStreamShard
+//!
+//! \brief Reads at most nbBatches batches of a stream, starting at the batch given to reset.
+//!
+template <typename TBatchStream>
+class BatchStreamShard
+{
+public:
+    BatchStreamShard(TBatchStream stream, int nbBatches)
+        : mStream(stream)
+        , mNbBatches(nbBatches)
+    {
+    }
+
+    void reset(int firstBatch)
+    {
+        mStream.reset(firstBatch);
+        mBatchesRead = 0;
+    }
+
+    bool next()
+    {
+        if (mBatchesRead == mNbBatches || !mStream.next())
+        {
+            return false;
+        }
+        ++mBatchesRead;
+        return true;
+    }
+
+    float* getBatch()
+    {
+        return mStream.getBatch();
+    }
+
+    int getBatchSize() const
+    {
+        return mStream.getBatchSize();
+    }
+
+    nvinfer1::Dims getDims() const
+    {
+        return mStream.getDims();
+    }
+
+private:
+    TBatchStream mStream;
+    int mNbBatches{0};
+    int mBatchesRead{0};
+};
+
+//!
+//! \class ShardCalibrator
+//!
+//! \brief Entropy calibrator over one shard of the calibration batches, keeping the cache in memory.
+//!
+template <typename TBatchStream>
+class ShardCalibrator : public Int8EntropyCalibrator2<BatchStreamShard<TBatchStream>>
+{
+public:
+    ShardCalibrator(TBatchStream stream, int firstBatch, int nbBatches, const char* inputBlobName)
+        : Int8EntropyCalibrator2<BatchStreamShard<TBatchStream>>(
+              BatchStreamShard<TBatchStream>(stream, nbBatches), firstBatch, "", inputBlobName, false)
+    {
+    }
+
+    const void* readCalibrationCache(size_t& length) override
+    {
+        length = 0;
+        return nullptr;
+    }
+
+    void writeCalibrationCache(const void* cache, size_t length) override
+    {
+        const char* begin = static_cast<const char*>(cache);
+        mCache.assign(begin, begin + length);
+    }
+
+    const std::vector<char>& getCache() const
+    {
+        return mCache;
+    }
+
+private:
+    std::vector<char> mCache;
+};
+
+//!
+//! \brief Merges the calibration caches of several shards into one scale per tensor.
+//!
+//! TensorRT does not expose the calibration histograms, only the scales derived from them. MinMax scales are merged
+//! exactly by taking their maximum, other algorithms get the mean of the shard scales weighted by the number of
+//! batches of each shard. A tensor missing from a shard is merged from the shards that have it.
+//!
+//! \return The merged cache, in the format written by TensorRT, or an empty cache if the headers differ.
+//!
+inline std::vector<char> mergeCalibrationCaches(
+    const std::vector<std::vector<char>>& caches, const std::vector<int>& weights)
+{
+    std::string header;
+    std::vector<std::string> order;
+    std::map<std::string, std::pair<double, double>> scales; // Weighted sum or maximum, total weight
+    for (size_t i = 0; i < caches.size(); ++i)
+    {
+        std::istringstream in(std::string(caches[i].begin(), caches[i].end()));
+        std::string line;
+        if (!std::getline(in, line) || (!header.empty() && line != header))
+        {
+            return {};
+        }
+        header = line;
+        const bool minMax = header.find("MinMax") != std::string::npos;
+        while (std::getline(in, line))
+        {
+            const auto pos = line.rfind(": ");
+            if (pos == std::string::npos)
+            {
+                continue;
+            }
+            const std::string name = line.substr(0, pos);
+            const uint32_t bits = static_cast<uint32_t>(std::stoul(line.substr(pos + 2), nullptr, 16));
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(scale));
+
+            auto it = scales.find(name);
+            if (it == scales.end())
+            {
+                order.push_back(name);
+                it = scales.emplace(name, std::make_pair(0.0, 0.0)).first;
+            }
+            if (minMax)
+            {
+                it->second.first = std::max(it->second.first, static_cast<double>(scale));
+                it->second.second = 1.0;
+            }
+            else
+            {
+                it->second.first += static_cast<double>(scale) * weights[i];
+                it->second.second += weights[i];
+            }
+        }
+    }
+
+    std::string merged = header + "\n";
+    for (const auto& name : order)
+    {
+        const auto& s = scales[name];
+        const float scale = static_cast<float>(s.first / s.second);
+        uint32_t bits;
+        std::memcpy(&bits, &scale, sizeof(bits));
+        char hex[9];
+        std::snprintf(hex, sizeof(hex), "%08x", bits);
+        merged += name + ": " + hex + "\n";
+    }
+    return std::vector<char>(merged.begin(), merged.end());
+}
+
+//!
+//! \brief Calibrates on several GPUs, each over a contiguous shard of the batches, and merges the scales.
+//!
+//! \param devices The CUDA devices to calibrate on, one thread each.
+//! \param stream The calibration data, copied for every shard.
+//! \param nbBatches The number of batches to calibrate with, split evenly across the shards.
+//! \param build Builds an engine on the current device with the given calibrator, the engine itself is discarded.
+//!
+//! \return The merged calibration cache, empty on failure. Write it with CalibrationCache to reuse it in the final
+//!         build.
+//!
+template <typename TBatchStream>
+std::vector<char> calibrateOnDevices(const std::vector<int>& devices, const TBatchStream& stream, int nbBatches,
+    const char* inputBlobName, const std::function<bool(nvinfer1::IInt8Calibrator&)>& build)
+{
+    const int nbShards = std::min(static_cast<int>(devices.size()), nbBatches);
+    std::vector<std::vector<char>> caches(nbShards);
+    std::vector<int> weights(nbShards);
+    std::vector<char> succeeded(nbShards, 0);
+    std::vector<std::thread> threads;
+    for (int s = 0; s < nbShards; ++s)
+    {
+        const int first = s * nbBatches / nbShards;
+        weights[s] = (s + 1) * nbBatches / nbShards - first;
+        threads.emplace_back([&, s, first]() {
+            CHECK(cudaSetDevice(devices[s]));
+            ShardCalibrator<TBatchStream> calibrator(stream, first, weights[s], inputBlobName);
+            succeeded[s] = build(calibrator) && !calibrator.getCache().empty();
+            caches[s] = calibrator.getCache();
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    for (int s = 0; s < nbShards; ++s)
+    {
+        if (!succeeded[s])
+        {
+            gLogError << "Calibration failed on device " << devices[s] << std::endl;
+            return {};
+        }
+    }
+    return mergeCalibrationCaches(caches, weights);
+}
+
+} // namespace samplesCommon
+
+#endif // MULTI_GPU_CALIBRATION_H
@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PACKED_DATASET_H
+#define PACKED_DATASET_H
+
+#include "NvInfer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace samplesCommon
+{
+
+//!
+//! \brief Layout of a packed dataset file, all values little endian.
+//!
+//! The header is followed by the samples back to back, then by one float label per sample if the dataset has labels,
+//! then by the index of the samples. Each index entry gives the offset of a sample from the start of the file and its
+//! size, so that samples of different shapes can share a file. Consecutive samples written one after the other are
+//! adjacent, a batch of them is then a view of the file.
+//!
+struct PackedDatasetHeader
+{
+    static constexpr uint64_t kMAGIC{0x314b434150545254ULL}; // "TRTPACK1"
+    static constexpr int kMAX_DIMS{8};
+
+    uint64_t magic{kMAGIC};
+    int32_t dataType{0};  // nvinfer1::DataType of the samples
+    int32_t nbDims{0};    // Dimensions of a sample, without the batch dimension
+    int32_t dims[kMAX_DIMS]{};
+    uint64_t count{0};        // Number of samples
+    uint64_t labelsOffset{0}; // Offset of the labels, 0 without labels
+    uint64_t indexOffset{0};  // Offset of the index, count entries of PackedDatasetEntry
+};
+
+struct PackedDatasetEntry
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+//!
+//! \class PackedDataset
+//!
+//! \brief Random access to the samples of a packed dataset file, mapped into memory.
+//!
+//! The samples are read in place, without a system call per sample. Without mmap the file is read into memory once.
+//!
+class PackedDataset
+{
+public:
+    explicit PackedDataset(const std::string& fileName)
+        : mFileName(fileName)
+    {
+        map();
+        if (mSize < sizeof(PackedDatasetHeader) || header().magic != PackedDatasetHeader::kMAGIC)
+        {
+            throw std::runtime_error(fileName + " is not a packed dataset");
+        }
+        const auto& h = header();
+        const uint64_t indexEnd = h.indexOffset + h.count * sizeof(PackedDatasetEntry);
+        if (h.nbDims < 0 || h.nbDims > PackedDatasetHeader::kMAX_DIMS || indexEnd > mSize
+            || (h.labelsOffset && h.labelsOffset + h.count * sizeof(float) > mSize))
+        {
+            throw std::runtime_error("Packed dataset " + fileName + " is truncated");
+        }
+        for (uint64_t s = 0; s < h.count; ++s)
+        {
+            if (entry(s).offset + entry(s).size > mSize)
+            {
+                throw std::runtime_error("Sample " + std::to_string(s) + " of " + fileName + " is past the end");
+            }
+        }
+    }
+
+    ~PackedDataset()
+    {
+#ifndef _MSC_VER
+        if (mData)
+        {
+            munmap(mData, mSize);
+        }
+#endif
+    }
+
+    PackedDataset(const PackedDataset&) = delete;
+
+    PackedDataset& operator=(const PackedDataset&) = delete;
+
+    //!
+    //! \return True if the file starts with the magic number of a packed dataset.
+    //!
+    static bool isPacked(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::in | std::ios::binary);
+        uint64_t magic{0};
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        return file && magic == PackedDatasetHeader::kMAGIC;
+    }
+
+    size_t size() const
+    {
+        return static_cast<size_t>(header().count);
+    }
+
+    nvinfer1::DataType dataType() const
+    {
+        return static_cast<nvinfer1::DataType>(header().dataType);
+    }
+
+    nvinfer1::Dims dims() const
+    {
+        nvinfer1::Dims dims{};
+        dims.nbDims = header().nbDims;
+        std::copy(header().dims, header().dims + dims.nbDims, dims.d);
+        return dims;
+    }
+
+    bool hasLabels() const
+    {
+        return header().labelsOffset != 0;
+    }
+
+    //!
+    //! \brief A view of a sample, valid as long as the dataset.
+    //!
+    //! The mapping is private, a write to a view does not reach the file.
+    //!
+    void* sample(size_t index)
+    {
+        return base() + entry(index).offset;
+    }
+
+    size_t sampleSize(size_t index) const
+    {
+        return static_cast<size_t>(entry(index).size);
+    }
+
+    float* labels()
+    {
+        return reinterpret_cast<float*>(base() + header().labelsOffset);
+    }
+
+    //!
+    //! \return True if the count samples from first on exist and are adjacent in the file, so that sample(first)
+    //! views all of them.
+    //!
+    bool contiguous(size_t first, size_t count) const
+    {
+        if (first > size() || count > size() - first)
+        {
+            return false;
+        }
+        for (size_t s = first + 1; s < first + count; ++s)
+        {
+            if (entry(s).offset != entry(s - 1).offset + entry(s - 1).size)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    const PackedDatasetHeader& header() const
+    {
+        return *reinterpret_cast<const PackedDatasetHeader*>(base());
+    }
+
+    const PackedDatasetEntry& entry(size_t index) const
+    {
+        return reinterpret_cast<const PackedDatasetEntry*>(base() + header().indexOffset)[index];
+    }
+
+    char* base() const
+    {
+        return mData ? static_cast<char*>(mData) : const_cast<char*>(mCopy.data());
+    }
+
+    void map()
+    {
+#ifndef _MSC_VER
+        const int fd = open(mFileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open packed dataset " + mFileName);
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                mData = data;
+                mSize = st.st_size;
+            }
+        }
+        close(fd);
+        if (mData)
+        {
+            return;
+        }
+#endif
+        std::ifstream file(mFileName, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open packed dataset " + mFileName);
+        }
+        mSize = static_cast<size_t>(file.tellg());
+        mCopy.resize(mSize);
+        file.seekg(0);
+        file.read(mCopy.data(), mSize);
+    }
+
+    std::string mFileName;
+    void* mData{nullptr};   // The mapping of the file
+    std::vector<char> mCopy; // The file read into memory without a mapping
+    size_t mSize{0};
+};
+
+//!
+//! \class PackedDatasetWriter
+//!
+//! \brief Writes the samples of a packed dataset in order, the labels and the index are written by finish().
+//!
+class PackedDatasetWriter
+{
+public:
+    PackedDatasetWriter(const std::string& fileName, nvinfer1::DataType dataType, const nvinfer1::Dims& dims,
+        bool labels)
+        : mFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc)
+        , mLabels(labels)
+    {
+        if (!mFile || dims.nbDims > PackedDatasetHeader::kMAX_DIMS)
+        {
+            throw std::runtime_error("Cannot write packed dataset " + fileName);
+        }
+        mHeader.dataType = static_cast<int32_t>(dataType);
+        mHeader.nbDims = dims.nbDims;
+        std::copy(dims.d, dims.d + dims.nbDims, mHeader.dims);
+        mFile.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+        mOffset = sizeof(mHeader);
+    }
+
+    ~PackedDatasetWriter()
+    {
+        if (mFile.is_open())
+        {
+            finish();
+        }
+    }
+
+    void add(const void* data, size_t size, float label = 0)
+    {
+        mFile.write(static_cast<const char*>(data), size);
+        mIndex.push_back({mOffset, static_cast<uint64_t>(size)});
+        mOffset += size;
+        mLabelValues.push_back(label);
+    }
+
+    //!
+    //! \return False if the file could not be written.
+    //!
+    bool finish()
+    {
+        mHeader.count = mIndex.size();
+        if (mLabels)
+        {
+            align();
+            mHeader.labelsOffset = mOffset;
+            mFile.write(reinterpret_cast<const char*>(mLabelValues.data()), mLabelValues.size() * sizeof(float));
+            mOffset += mLabelValues.size() * sizeof(float);
+        }
+        align();
+        mHeader.indexOffset = mOffset;
+        mFile.write(reinterpret_cast<const char*>(mIndex.data()), mIndex.size() * sizeof(PackedDatasetEntry));
+        mFile.seekp(0);
+        mFile.write(reinterpret_cast<const char*>(&mHeader), sizeof(mHeader));
+        mFile.close();
+        return !mFile.fail();
+    }
+
+private:
+    //! Pads the file so that the labels and the index are read aligned whatever the size of the samples
+    void align()
+    {
+        const char zeros[8]{};
+        const uint64_t padding = (8 - mOffset % 8) % 8;
+        mFile.write(zeros, padding);
+        mOffset += padding;
+    }
+
+    std::ofstream mFile;
+    bool mLabels{false};
+    PackedDatasetHeader mHeader;
+    uint64_t mOffset{0};
+    std::vector<PackedDatasetEntry> mIndex;
+    std::vector<float> mLabelValues;
+};
+
+//!
+//! \brief Packs the batch files read by BatchStream, <prefix><N><suffix> from N = 0 on, into one dataset file.
+//!
+//! Each batch file holds its dimensions as 4 ints (batch, channels, height, width), the batch of float images and
+//! optionally one float label per image. Each image becomes one sample.
+//!
+//! \return The number of samples written, 0 if there is no batch file.
+//!
+inline size_t packBatchFiles(const std::string& prefix, const std::string& suffix, const std::string& fileName)
+{
+    std::unique_ptr<PackedDatasetWriter> writer;
+    size_t samples{0};
+    for (int batch = 0;; ++batch)
+    {
+        FILE* file = fopen((prefix + std::to_string(batch) + suffix).c_str(), "rb");
+        if (!file)
+        {
+            break;
+        }
+        int d[4];
+        if (fread(d, sizeof(int), 4, file) != 4 || d[0] <= 0 || d[1] <= 0 || d[2] <= 0 || d[3] <= 0)
+        {
+            fclose(file);
+            throw std::runtime_error("Invalid batch file " + prefix + std::to_string(batch) + suffix);
+        }
+        const size_t imageSize = static_cast<size_t>(d[1]) * d[2] * d[3];
+        std::vector<float> images(d[0] * imageSize);
+        std::vector<float> labels(d[0], 0.0F);
+        const size_t readImages = fread(images.data(), sizeof(float), images.size(), file);
+        const size_t readLabels = fread(labels.data(), sizeof(float), labels.size(), file);
+        fclose(file);
+        if (readImages != images.size())
+        {
+            throw std::runtime_error("Batch file " + prefix + std::to_string(batch) + suffix + " is truncated");
+        }
+        if (!writer)
+        {
+            writer.reset(new PackedDatasetWriter(
+                fileName, nvinfer1::DataType::kFLOAT, nvinfer1::Dims3{d[1], d[2], d[3]}, readLabels == labels.size()));
+        }
+        for (int i = 0; i < d[0]; ++i)
+        {
+            writer->add(images.data() + i * imageSize, imageSize * sizeof(float), labels[i]);
+        }
+        samples += d[0];
+    }
+    if (writer && !writer->finish())
+    {
+        throw std::runtime_error("Cannot write packed dataset " + fileName);
+    }
+    return samples;
+}
+
+} // namespace samplesCommon
+
+#endif // PACKED_DATASET_H
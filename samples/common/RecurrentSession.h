@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef RECURRENT_SESSION_H
+#define RECURRENT_SESSION_H
+
+#include "NvInfer.h"
+#include "buffers.h"
+#include "common.h"
+#include <algorithm>
+#include <array>
+#include <cuda_runtime_api.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace samplesCommon
+{
+
+//!
+//! \class RecurrentSessionPool
+//!
+//! \brief Device-resident recurrent state for many independent sessions of a stateful engine.
+//!
+//! Every state is an input/output binding pair of the engine, such as hiddenIn/hiddenOut. The pool keeps two device
+//! buffers per state and swaps which one is bound as input and which one as output after every step, so the state
+//! never leaves the device and is never copied between steps. Each session owns one slot of the batch dimension, so
+//! all the open sessions step in a single enqueue of batchSize() samples. A session that does not step carries its
+//! state over with a copy of its own slot.
+//!
+//! With an explicit batch engine the state bindings have no batch dimension, the pool then holds a single session.
+//!
+class RecurrentSessionPool
+{
+public:
+    struct StateBinding
+    {
+        std::string input;
+        std::string output;
+    };
+
+    RecurrentSessionPool(const nvinfer1::ICudaEngine& engine, int maxSessions, const std::vector<StateBinding>& states)
+        : mOpen(maxSessions, false)
+        , mStepping(maxSessions, false)
+    {
+        for (const auto& binding : states)
+        {
+            State state;
+            state.inputIndex = engine.getBindingIndex(binding.input.c_str());
+            state.outputIndex = engine.getBindingIndex(binding.output.c_str());
+            if (state.inputIndex < 0 || state.outputIndex < 0)
+            {
+                throw std::runtime_error("Unknown recurrent state binding " + binding.input + "/" + binding.output);
+            }
+            const nvinfer1::DataType type = engine.getBindingDataType(state.inputIndex);
+            const int64_t vol = volume(engine.getBindingDimensions(state.inputIndex));
+            if (type != engine.getBindingDataType(state.outputIndex)
+                || vol != volume(engine.getBindingDimensions(state.outputIndex)))
+            {
+                throw std::runtime_error("Recurrent state " + binding.input + " and " + binding.output + " differ");
+            }
+            state.sessionBytes = vol * getElementSize(type);
+            for (auto& buffer : state.buffers)
+            {
+                buffer = DeviceBuffer(vol * maxSessions, type);
+            }
+            mStates.emplace_back(std::move(state));
+        }
+    }
+
+    //!
+    //! \brief Opens a session in the lowest free slot, with all its states reset to zero.
+    //!
+    //! \return The session slot, or -1 if all the slots are taken.
+    //!
+    int open(cudaStream_t stream)
+    {
+        const auto it = std::find(mOpen.begin(), mOpen.end(), false);
+        if (it == mOpen.end())
+        {
+            return -1;
+        }
+        *it = true;
+        const int session = static_cast<int>(it - mOpen.begin());
+        for (auto& state : mStates)
+        {
+            CHECK(cudaMemsetAsync(current(state, session), 0, state.sessionBytes, stream));
+        }
+        return session;
+    }
+
+    void close(int session)
+    {
+        mOpen[session] = false;
+        mStepping[session] = false;
+    }
+
+    //!
+    //! \brief Marks a session as stepping in the next enqueue, the other open sessions keep their state.
+    //!
+    void step(int session)
+    {
+        mStepping[session] = true;
+    }
+
+    //!
+    //! \brief The batch size to enqueue, up to the last open slot.
+    //!
+    int batchSize() const
+    {
+        const auto last = std::find(mOpen.rbegin(), mOpen.rend(), true);
+        return static_cast<int>(mOpen.rend() - last);
+    }
+
+    //!
+    //! \brief Points the state bindings to the buffers of the next step, the other bindings are left as they are.
+    //!
+    void bind(std::vector<void*>& bindings)
+    {
+        for (auto& state : mStates)
+        {
+            bindings[state.inputIndex] = state.buffers[mParity].data();
+            bindings[state.outputIndex] = state.buffers[mParity ^ 1].data();
+        }
+    }
+
+    //!
+    //! \brief Makes the outputs of the step just enqueued the inputs of the next one.
+    //!
+    //! Must be called on the stream of the enqueue, after it.
+    //!
+    void advance(cudaStream_t stream)
+    {
+        for (int session = 0; session < static_cast<int>(mOpen.size()); ++session)
+        {
+            if (mOpen[session] && !mStepping[session])
+            {
+                for (auto& state : mStates)
+                {
+                    CHECK(cudaMemcpyAsync(next(state, session), current(state, session), state.sessionBytes,
+                        cudaMemcpyDeviceToDevice, stream));
+                }
+            }
+        }
+        std::fill(mStepping.begin(), mStepping.end(), false);
+        mParity ^= 1;
+    }
+
+    //!
+    //! \brief The device address of the latest value of a state of a session, in the order the states were given.
+    //!
+    void* state(int stateIndex, int session)
+    {
+        return current(mStates[stateIndex], session);
+    }
+
+    size_t stateSize(int stateIndex) const
+    {
+        return mStates[stateIndex].sessionBytes;
+    }
+
+private:
+    struct State
+    {
+        int inputIndex;
+        int outputIndex;
+        size_t sessionBytes;
+        std::array<DeviceBuffer, 2> buffers;
+    };
+
+    void* current(State& state, int session) const
+    {
+        return static_cast<char*>(state.buffers[mParity].data()) + session * state.sessionBytes;
+    }
+
+    void* next(State& state, int session) const
+    {
+        return static_cast<char*>(state.buffers[mParity ^ 1].data()) + session * state.sessionBytes;
+    }
+
+    std::vector<State> mStates;
+    std::vector<bool> mOpen;
+    std::vector<bool> mStepping;
+    int mParity{0};
+};
+
+} // namespace samplesCommon
+
+#endif // RECURRENT_SESSION_H
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SHARED_PLAN_REGISTRY_H
+#define SHARED_PLAN_REGISTRY_H
+
+#ifndef _MSC_VER
+
+#include "NvInfer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace samplesCommon
+{
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The plan header is shared across processes, its atomics must be lock free");
+
+//!
+//! \class SharedPlan
+//!
+//! \brief A serialized engine in shared memory, mapped into this process.
+//!
+//! Every handle holds one reference on the plan. The last handle to be released removes the plan from the registry,
+//! processes that still have it mapped keep using their mapping.
+//!
+class SharedPlan
+{
+public:
+    ~SharedPlan()
+    {
+        if (header()->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            shm_unlink(mShmName.c_str());
+        }
+        munmap(mBase, mMappedSize);
+    }
+
+    SharedPlan(const SharedPlan&) = delete;
+    SharedPlan& operator=(const SharedPlan&) = delete;
+
+    const void* data() const
+    {
+        return static_cast<const char*>(mBase) + kDataOffset;
+    }
+
+    size_t size() const
+    {
+        return header()->size;
+    }
+
+    //!
+    //! \brief Deserializes the plan straight from the shared mapping.
+    //!
+    nvinfer1::ICudaEngine* deserialize(nvinfer1::IRuntime& runtime) const
+    {
+        return runtime.deserializeCudaEngine(data(), size(), nullptr);
+    }
+
+private:
+    friend class SharedPlanRegistry;
+
+    enum : uint32_t
+    {
+        kCreating = 0,
+        kReady = 1
+    };
+
+    struct Header
+    {
+        std::atomic<uint32_t> state;
+        std::atomic<uint32_t> refCount;
+        uint64_t size;
+    };
+
+    //! The plan starts on its own cache line
+    static constexpr size_t kDataOffset{64};
+    static_assert(sizeof(Header) <= kDataOffset, "The plan must not overlap the header");
+
+    SharedPlan(std::string shmName, void* base, size_t mappedSize)
+        : mShmName(std::move(shmName))
+        , mBase(base)
+        , mMappedSize(mappedSize)
+    {
+    }
+
+    Header* header() const
+    {
+        return static_cast<Header*>(mBase);
+    }
+
+    std::string mShmName;
+    void* mBase;
+    size_t mMappedSize;
+};
+
+//!
+//! \class SharedPlanRegistry
+//!
+//! \brief Named serialized engines in POSIX shared memory, for worker processes deserializing the same engine.
+//!
+//! One process publishes a plan under a name, any process can then attach to it by name and deserialize from the
+//! shared pages instead of reading the engine file, so N workers share a single copy of the plan in memory. Plans live
+//! in /dev/shm as "<prefix>.<name>". A process that exits without releasing its handle leaks its reference, remove()
+//! cleans up such a plan.
+//!
+class SharedPlanRegistry
+{
+public:
+    explicit SharedPlanRegistry(std::string prefix)
+        : mPrefix("/" + std::move(prefix))
+    {
+    }
+
+    //!
+    //! \brief Copies a plan into shared memory under the given name, replacing a plan left there by an earlier run.
+    //!
+    //! \return The publisher's handle, the plan stays in the registry at least until it is released.
+    //!
+    std::unique_ptr<SharedPlan> publish(const std::string& name, const void* data, size_t size) const
+    {
+        const std::string shmName = shmNameOf(name);
+        shm_unlink(shmName.c_str());
+        const int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Could not create shared memory /dev/shm" + shmName);
+        }
+        const size_t mappedSize = SharedPlan::kDataOffset + size;
+        void* base = ftruncate(fd, mappedSize) == 0
+            ? mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+            : MAP_FAILED;
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            shm_unlink(shmName.c_str());
+            throw std::runtime_error("Could not map shared memory /dev/shm" + shmName);
+        }
+
+        auto* header = static_cast<SharedPlan::Header*>(base);
+        std::memcpy(static_cast<char*>(base) + SharedPlan::kDataOffset, data, size);
+        header->size = size;
+        header->refCount.store(1, std::memory_order_relaxed);
+        // Attaching processes read the plan once they see it ready
+        header->state.store(SharedPlan::kReady, std::memory_order_release);
+        return std::unique_ptr<SharedPlan>(new SharedPlan(shmName, base, mappedSize));
+    }
+
+    std::unique_ptr<SharedPlan> publish(const std::string& name, const nvinfer1::IHostMemory& plan) const
+    {
+        return publish(name, plan.data(), plan.size());
+    }
+
+    //!
+    //! \brief Attaches to a published plan, waiting for it to be published.
+    //!
+    //! \param timeoutMs How long to wait for the plan, a negative timeout waits forever.
+    //!
+    //! \return The handle, or nullptr if the plan was not published in time.
+    //!
+    std::unique_ptr<SharedPlan> attach(const std::string& name, int timeoutMs = -1) const
+    {
+        const std::string shmName = shmNameOf(name);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        const auto expired = [&]() { return timeoutMs >= 0 && std::chrono::steady_clock::now() > deadline; };
+        void* base{nullptr};
+        size_t mappedSize{0};
+        while (!map(shmName, base, mappedSize))
+        {
+            if (expired())
+            {
+                return nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        auto* header = static_cast<SharedPlan::Header*>(base);
+        while (header->state.load(std::memory_order_acquire) != SharedPlan::kReady)
+        {
+            if (expired())
+            {
+                munmap(base, mappedSize);
+                return nullptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        header->refCount.fetch_add(1, std::memory_order_acq_rel);
+        return std::unique_ptr<SharedPlan>(new SharedPlan(shmName, base, mappedSize));
+    }
+
+    //!
+    //! \brief Removes a plan from the registry regardless of its references, mappings stay valid.
+    //!
+    void remove(const std::string& name) const
+    {
+        shm_unlink(shmNameOf(name).c_str());
+    }
+
+private:
+    std::string shmNameOf(const std::string& name) const
+    {
+        return mPrefix + "." + name;
+    }
+
+    //! Maps the plan segment once it exists, the publisher sizes it before writing the plan
+    static bool map(const std::string& shmName, void*& base, size_t& mappedSize)
+    {
+        const int fd = shm_open(shmName.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        const bool sized = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) > SharedPlan::kDataOffset;
+        base = sized ? mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        mappedSize = st.st_size;
+        return base != MAP_FAILED;
+    }
+
+    std::string mPrefix;
+};
+
+} // namespace samplesCommon
+
+#endif // _MSC_VER
+
+#endif // SHARED_PLAN_REGISTRY_H
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef WEIGHTS_FILE_H
+#define WEIGHTS_FILE_H
+
+#include "NvInfer.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace samplesCommon
+{
+
+//!
+//! \brief Layout of a binary weights file, all values little endian, as written by convertWts.py.
+//!
+//! The header is followed by the raw values of the weights, each aligned to kALIGNMENT bytes from the start of the
+//! file, then by the table of the weights, then by their names back to back, without terminating null characters.
+//!
+struct WeightsFileHeader
+{
+    static constexpr uint64_t kMAGIC{0x3130535457545254ULL}; // "TRTWTS01"
+    static constexpr uint64_t kALIGNMENT{64};
+
+    uint64_t magic{kMAGIC};
+    uint64_t count{0};       // Number of weights
+    uint64_t tableOffset{0}; // Offset of the table, count entries of WeightsFileEntry
+    uint64_t namesOffset{0};
+};
+
+struct WeightsFileEntry
+{
+    static constexpr int kMAX_DIMS{8};
+
+    uint64_t nameOffset; // From the start of the names
+    uint32_t nameLength;
+    int32_t dataType; // nvinfer1::DataType of the values
+    int32_t nbDims;
+    int32_t dims[kMAX_DIMS];
+    int32_t reserved;
+    uint64_t offset; // From the start of the file
+    uint64_t count;  // Number of values
+};
+
+//!
+//! \class WeightsFile
+//!
+//! \brief The weights of a binary weights file, mapped into memory.
+//!
+//! The weights point into the mapping: loading costs a page fault per page touched, instead of parsing every value.
+//! The mapping is private, a sample can transpose or convert weights in place without writing to the file. Without
+//! mmap the file is read into memory once. The weights are valid as long as the file object.
+//!
+class WeightsFile
+{
+public:
+    explicit WeightsFile(const std::string& fileName)
+        : mFileName(fileName)
+    {
+        map();
+        if (mSize < sizeof(WeightsFileHeader) || header().magic != WeightsFileHeader::kMAGIC)
+        {
+            throw std::runtime_error(fileName + " is not a binary weights file");
+        }
+        const auto& h = header();
+        if (h.tableOffset + h.count * sizeof(WeightsFileEntry) > mSize || h.namesOffset > mSize)
+        {
+            throw std::runtime_error("Weights file " + fileName + " is truncated");
+        }
+        for (uint64_t w = 0; w < h.count; ++w)
+        {
+            const auto& e = entry(w);
+            const uint64_t size = e.count * elementSize(static_cast<nvinfer1::DataType>(e.dataType));
+            if (e.offset + size > mSize || h.namesOffset + e.nameOffset + e.nameLength > mSize || e.nbDims < 0
+                || e.nbDims > WeightsFileEntry::kMAX_DIMS)
+            {
+                throw std::runtime_error("Weights " + std::to_string(w) + " of " + fileName + " are past the end");
+            }
+        }
+    }
+
+    ~WeightsFile()
+    {
+#ifndef _MSC_VER
+        if (mData)
+        {
+            munmap(mData, mSize);
+        }
+#endif
+    }
+
+    WeightsFile(const WeightsFile&) = delete;
+
+    WeightsFile& operator=(const WeightsFile&) = delete;
+
+    //!
+    //! \return True if the file starts with the magic number of a binary weights file.
+    //!
+    static bool isWeightsFile(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::in | std::ios::binary);
+        uint64_t magic{0};
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        return file && magic == WeightsFileHeader::kMAGIC;
+    }
+
+    //!
+    //! \return The name of the binary weights file converted from a text weights file, next to it.
+    //!
+    static std::string binaryName(const std::string& fileName)
+    {
+        const size_t dot = fileName.find_last_of('.');
+        const size_t slash = fileName.find_last_of("/\\");
+        const bool hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+        return (hasExtension ? fileName.substr(0, dot) : fileName) + ".trtwts";
+    }
+
+    //!
+    //! \brief The weights by name, with their shape.
+    //!
+    std::map<std::string, std::pair<nvinfer1::Dims, nvinfer1::Weights>> shapedWeights() const
+    {
+        std::map<std::string, std::pair<nvinfer1::Dims, nvinfer1::Weights>> weights;
+        for (uint64_t w = 0; w < header().count; ++w)
+        {
+            const auto& e = entry(w);
+            nvinfer1::Dims dims{};
+            dims.nbDims = e.nbDims;
+            std::copy(e.dims, e.dims + e.nbDims, dims.d);
+            const nvinfer1::Weights values{
+                static_cast<nvinfer1::DataType>(e.dataType), base() + e.offset, static_cast<int64_t>(e.count)};
+            weights[std::string(base() + header().namesOffset + e.nameOffset, e.nameLength)] = {dims, values};
+        }
+        return weights;
+    }
+
+    std::map<std::string, nvinfer1::Weights> weights() const
+    {
+        std::map<std::string, nvinfer1::Weights> weights;
+        for (const auto& w : shapedWeights())
+        {
+            weights[w.first] = w.second.second;
+        }
+        return weights;
+    }
+
+    //!
+    //! \return True if values point into the file, and must not be freed.
+    //!
+    bool contains(const void* values) const
+    {
+        const char* p = static_cast<const char*>(values);
+        return p >= base() && p < base() + mSize;
+    }
+
+private:
+    static size_t elementSize(nvinfer1::DataType type)
+    {
+        switch (type)
+        {
+        case nvinfer1::DataType::kINT32:
+        case nvinfer1::DataType::kFLOAT: return 4;
+        case nvinfer1::DataType::kHALF: return 2;
+        case nvinfer1::DataType::kBOOL:
+        case nvinfer1::DataType::kINT8: return 1;
+        }
+        return 0;
+    }
+
+    const WeightsFileHeader& header() const
+    {
+        return *reinterpret_cast<const WeightsFileHeader*>(base());
+    }
+
+    const WeightsFileEntry& entry(size_t index) const
+    {
+        return reinterpret_cast<const WeightsFileEntry*>(base() + header().tableOffset)[index];
+    }
+
+    char* base() const
+    {
+        return mData ? static_cast<char*>(mData) : reinterpret_cast<char*>(const_cast<uint64_t*>(mCopy.data()));
+    }
+
+    void map()
+    {
+#ifndef _MSC_VER
+        const int fd = open(mFileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open weights file " + mFileName);
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                mData = data;
+                mSize = st.st_size;
+            }
+        }
+        close(fd);
+        if (mData)
+        {
+            return;
+        }
+#endif
+        std::ifstream file(mFileName, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open weights file " + mFileName);
+        }
+        mSize = static_cast<size_t>(file.tellg());
+        // Read into 64-bit words, so that the weights are at least as aligned as the file requires of them
+        mCopy.resize((mSize + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(mCopy.data()), mSize);
+    }
+
+    std::string mFileName;
+    void* mData{nullptr};        // The mapping of the file
+    std::vector<uint64_t> mCopy; // The file read into memory without a mapping
+    size_t mSize{0};
+};
+
+} // namespace samplesCommon
+
+#endif // WEIGHTS_FILE_H
@@ -84,6 +84,7 @@ struct Args
     int batch{1};
     std::vector<std::string> dataDirs;
     bool useILoop{false};
+    bool useGenerationLoop{false};
 };
 
 //!
@@ -100,7 +101,8 @@ inline bool parseArgs(Args& args, int argc, char* argv[])
         int arg;
         static struct option long_options[] = {{"help", no_argument, 0, 'h'}, {"datadir", required_argument, 0, 'd'},
             {"int8", no_argument, 0, 'i'}, {"fp16", no_argument, 0, 'f'}, {"useILoop", no_argument, 0, 'l'},
-            {"useDLACore", required_argument, 0, 'u'}, {"batch", required_argument, 0, 'b'}, {nullptr, 0, nullptr, 0}};
+            {"useGenerationLoop", no_argument, 0, 'g'}, {"useDLACore", required_argument, 0, 'u'},
+            {"batch", required_argument, 0, 'b'}, {nullptr, 0, nullptr, 0}};
         int option_index = 0;
         arg = getopt_long(argc, argv, "hd:iu", long_options, &option_index);
         if (arg == -1)
@@ -125,6 +127,7 @@ inline bool parseArgs(Args& args, int argc, char* argv[])
         case 'i': args.runInInt8 = true; break;
         case 'f': args.runInFp16 = true; break;
         case 'l': args.useILoop = true; break;
+        case 'g': args.useGenerationLoop = true; break;
         case 'u':
             if (optarg)
             {
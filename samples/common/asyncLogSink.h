@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ASYNC_LOG_SINK_H
+#define ASYNC_LOG_SINK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace samplesCommon
+{
+
+//!
+//! \class AsyncLogSink
+//!
+//! \brief Writes log lines to their streams from a background thread.
+//!
+//! Any number of threads push formatted lines into a bounded lock-free ring, a single writer thread drains it in
+//! order and flushes each stream once per batch. A push never waits: when the ring is full the line is dropped and
+//! counted, and the writer reports the number of dropped lines on std::cerr once it catches up.
+//!
+class AsyncLogSink
+{
+public:
+    //!
+    //! \param capacity Number of lines the ring holds, rounded up to a power of two.
+    //!
+    explicit AsyncLogSink(size_t capacity = 4096)
+    {
+        size_t slots{1};
+        while (slots < capacity)
+        {
+            slots <<= 1;
+        }
+        mMask = slots - 1;
+        mSlots.reset(new Slot[slots]);
+        for (size_t i = 0; i < slots; ++i)
+        {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mWriter = std::thread(&AsyncLogSink::run, this);
+    }
+
+    //! Writes out the lines still in the ring before returning
+    ~AsyncLogSink()
+    {
+        mStop.store(true, std::memory_order_release);
+        mWriter.join();
+    }
+
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+    //!
+    //! \brief Queues a line for the given stream.
+    //!
+    //! \return false if the ring was full and the line was dropped.
+    //!
+    bool push(std::ostream& stream, std::string&& line)
+    {
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        Slot* slot{nullptr};
+        for (;;)
+        {
+            slot = &mSlots[pos & mMask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0)
+            {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The writer has not released this slot since the previous lap
+                mDropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->stream = &stream;
+        slot->line = std::move(line);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //!
+    //! \brief Waits until the lines pushed before the call are written and their streams flushed.
+    //!
+    void flush() const
+    {
+        const size_t target = mEnqueuePos.load(std::memory_order_acquire);
+        while (mFlushedPos.load(std::memory_order_acquire) < target)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    //! Number of lines dropped because the ring was full
+    uint64_t dropped() const
+    {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        std::ostream* stream{nullptr};
+        std::string line;
+    };
+
+    //! Lines written between two flushes, so that a burst does not hold its streams unflushed for long
+    static constexpr size_t kMaxBatch{256};
+
+    void run()
+    {
+        uint64_t reported{0};
+        for (;;)
+        {
+            // Read the stop flag first so that lines pushed before the destructor are written
+            const bool stop = mStop.load(std::memory_order_acquire);
+            const size_t written = drain();
+            const uint64_t dropped = mDropped.load(std::memory_order_relaxed);
+            if (dropped != reported)
+            {
+                std::cerr << "[W] " << dropped - reported << " log messages dropped, the log queue was full"
+                          << std::endl;
+                reported = dropped;
+            }
+            if (written == 0)
+            {
+                if (stop)
+                {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        }
+    }
+
+    //! Writes up to kMaxBatch lines available in the ring, returns their number
+    size_t drain()
+    {
+        const size_t begin = mFlushedPos.load(std::memory_order_relaxed);
+        size_t pos = begin;
+        std::ostream* last{nullptr};
+        while (pos - begin < kMaxBatch)
+        {
+            Slot& slot = mSlots[pos & mMask];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+            {
+                break;
+            }
+            if (last && slot.stream != last)
+            {
+                // Keep the order of the lines across stdout and stderr
+                last->flush();
+            }
+            *slot.stream << slot.line;
+            last = slot.stream;
+            slot.line.clear();
+            slot.sequence.store(pos + mMask + 1, std::memory_order_release);
+            ++pos;
+        }
+        if (last)
+        {
+            last->flush();
+        }
+        mFlushedPos.store(pos, std::memory_order_release);
+        return pos - begin;
+    }
+
+    std::unique_ptr<Slot[]> mSlots;
+    size_t mMask{0};
+    //! Producers and the writer update their positions on separate cache lines
+    char mPadding0[64];
+    std::atomic<size_t> mEnqueuePos{0};
+    char mPadding1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> mFlushedPos{0};
+    std::atomic<uint64_t> mDropped{0};
+    std::atomic<bool> mStop{false};
+    std::thread mWriter;
+};
+
+} // namespace samplesCommon
+
+#endif // ASYNC_LOG_SINK_H
@@ -19,6 +19,8 @@
 #include "NvInfer.h"
 #include "common.h"
 #include "half.h"
+#include "sampleDevice.h"
+#include <algorithm>
 #include <cassert>
 #include <cuda_runtime_api.h>
 #include <iostream>
@@ -195,11 +197,19 @@ public:
     }
 };
 
+//!
+//! \brief Host buffers are pageable, unless a sample::TrtPinnedHostPool is installed to serve them pinned.
+//!
 class HostAllocator
 {
 public:
     bool operator()(void** ptr, size_t size) const
     {
+        if (sample::TrtPinnedHostPool* pool = sample::TrtPinnedHostPool::installed())
+        {
+            *ptr = pool->allocate(size);
+            return *ptr != nullptr || size == 0;
+        }
         *ptr = malloc(size);
         return *ptr != nullptr;
     }
@@ -210,12 +220,35 @@ class HostFree
 public:
     void operator()(void* ptr) const
     {
-        free(ptr);
+        sample::TrtPinnedHostPool* pool = sample::TrtPinnedHostPool::installed();
+        if (!pool || !pool->free(ptr))
+        {
+            free(ptr);
+        }
+    }
+};
+
+class PinnedHostAllocator
+{
+public:
+    bool operator()(void** ptr, size_t size) const
+    {
+        return cudaMallocHost(ptr, size) == cudaSuccess;
+    }
+};
+
+class PinnedHostFree
+{
+public:
+    void operator()(void* ptr) const
+    {
+        cudaFreeHost(ptr);
     }
 };
 
 using DeviceBuffer = GenericBuffer<DeviceAllocator, DeviceFree>;
 using HostBuffer = GenericBuffer<HostAllocator, HostFree>;
+using PinnedHostBuffer = GenericBuffer<PinnedHostAllocator, PinnedHostFree>;
 
 //!
 //! \brief  The ManagedBuffer class groups together a pair of corresponding device and host buffers.
@@ -225,6 +258,7 @@ class ManagedBuffer
 public:
     DeviceBuffer deviceBuffer;
     HostBuffer hostBuffer;
+    bool filledOnDevice{false}; //!< An input written on the device, that the input copies leave alone
 };
 
 //!
@@ -252,16 +286,8 @@ public:
         for (int i = 0; i < mEngine->getNbBindings(); i++)
         {
             auto dims = context ? context->getBindingDimensions(i) : mEngine->getBindingDimensions(i);
-            size_t vol = context ? 1 : static_cast<size_t>(mBatchSize);
+            size_t vol = bindingVolume(i, dims, context ? 1 : static_cast<size_t>(mBatchSize));
             nvinfer1::DataType type = mEngine->getBindingDataType(i);
-            int vecDim = mEngine->getBindingVectorizedDim(i);
-            if (-1 != vecDim) // i.e., 0 != lgScalarsPerVector
-            {
-                int scalarsPerVec = mEngine->getBindingComponentsPerElement(i);
-                dims.d[vecDim] = divUp(dims.d[vecDim], scalarsPerVec);
-                vol *= scalarsPerVec;
-            }
-            vol *= samplesCommon::volume(dims);
             std::unique_ptr<ManagedBuffer> manBuf{new ManagedBuffer()};
             manBuf->deviceBuffer = DeviceBuffer(vol, type);
             manBuf->hostBuffer = HostBuffer(vol, type);
@@ -270,6 +296,106 @@ public:
         }
     }
 
+    //!
+    //! \brief Sizes the buffers to the binding dimensions currently set in the context, for dynamic shapes.
+    //!
+    //! \details Buffers only grow: a shape that fits in the current allocation only changes the size reported by
+    //!          size() and copied by the memcpy methods, the allocation and the device bindings are kept.
+    //!          Bindings whose dimensions are not all specified in the context keep their size.
+    //!
+    //! \return true if a buffer was reallocated, in which case getDeviceBindings() holds new pointers.
+    //!
+    bool resize(const nvinfer1::IExecutionContext& context)
+    {
+        const std::vector<void*> previous{mDeviceBindings};
+        for (int i = 0; i < mEngine->getNbBindings(); i++)
+        {
+            const auto dims = context.getBindingDimensions(i);
+            if (std::any_of(dims.d, dims.d + dims.nbDims, [](int d) { return d < 0; }))
+            {
+                continue;
+            }
+            const size_t vol = bindingVolume(i, dims, 1);
+            auto& manBuf = *mManagedBuffers[i];
+            manBuf.deviceBuffer.resize(vol);
+            manBuf.hostBuffer.resize(vol);
+            mDeviceBindings[i] = manBuf.deviceBuffer.data();
+        }
+        if (mPackInputs)
+        {
+            pack();
+        }
+        return mDeviceBindings != previous;
+    }
+
+    //!
+    //! \brief Allocates the buffers for the max shapes of the context's optimization profile,
+    //!        so that resize() does not reallocate for any shape of the profile.
+    //!
+    //! \details The output sizes are those the context computes with the inputs of the profile at their max shapes.
+    //!          The input shapes set in the context before the call are restored if they were all specified,
+    //!          and the sizes are then those of the restored shapes.
+    //!
+    //! \return true if a buffer was reallocated, in which case getDeviceBindings() holds new pointers.
+    //!
+    bool reserve(nvinfer1::IExecutionContext& context)
+    {
+        const int profile = context.getOptimizationProfile();
+        const int bindingsPerProfile = mEngine->getNbBindings() / mEngine->getNbOptimizationProfiles();
+        const int first = profile * bindingsPerProfile;
+        const bool restore = context.allInputDimensionsSpecified() && context.allInputShapesSpecified();
+
+        std::vector<nvinfer1::Dims> dims(bindingsPerProfile);
+        std::vector<std::vector<int32_t>> shapeValues(bindingsPerProfile);
+        for (int b = 0; b < bindingsPerProfile; b++)
+        {
+            const int i = first + b;
+            if (!mEngine->bindingIsInput(i))
+            {
+                continue;
+            }
+            dims[b] = context.getBindingDimensions(i);
+            const auto maxDims = mEngine->getProfileDimensions(i, profile, nvinfer1::OptProfileSelector::kMAX);
+            if (mEngine->isShapeBinding(i))
+            {
+                const int count = static_cast<int>(samplesCommon::volume(maxDims));
+                shapeValues[b].resize(count);
+                if (restore)
+                {
+                    context.getShapeBinding(i, shapeValues[b].data());
+                }
+                context.setInputShapeBinding(
+                    i, mEngine->getProfileShapeValues(profile, i, nvinfer1::OptProfileSelector::kMAX));
+            }
+            else
+            {
+                context.setBindingDimensions(i, maxDims);
+            }
+        }
+
+        const bool reallocated = resize(context);
+        if (restore)
+        {
+            for (int b = 0; b < bindingsPerProfile; b++)
+            {
+                const int i = first + b;
+                if (mEngine->bindingIsInput(i))
+                {
+                    if (mEngine->isShapeBinding(i))
+                    {
+                        context.setInputShapeBinding(i, shapeValues[b].data());
+                    }
+                    else
+                    {
+                        context.setBindingDimensions(i, dims[b]);
+                    }
+                }
+            }
+            resize(context);
+        }
+        return reallocated;
+    }
+
     //!
     //! \brief Returns a vector of device buffers that you can use directly as
     //!        bindings for the execute and enqueue methods of IExecutionContext.
@@ -305,6 +431,43 @@ public:
         return getBuffer(true, tensorName);
     }
 
+    //!
+    //! \brief Marks the input tensorName as written directly on the device, e.g. by GPU preprocessing, so that
+    //!        copyInputToDevice does not overwrite it with its host buffer.
+    //!
+    void setFilledOnDevice(const std::string& tensorName)
+    {
+        int index = mEngine->getBindingIndex(tensorName.c_str());
+        if (index != -1)
+        {
+            mManagedBuffers[index]->filledOnDevice = true;
+            if (mPackInputs)
+            {
+                pack();
+            }
+        }
+    }
+
+    //!
+    //! \brief Stages the inputs in one pinned host buffer and one device buffer, so that copyInputToDevice and
+    //!        copyInputToDeviceAsync transfer all of them with a single copy.
+    //!
+    //! \details Engines with several small inputs then pay the set up latency of one DMA transfer instead of one per
+    //!          input. The host buffers of the inputs are gathered into the staging before each copy, and the device
+    //!          bindings of the inputs become offsets into the device buffer, so getDeviceBindings() holds new
+    //!          pointers. Inputs filled on the device keep their own buffers. The packing follows resize() and
+    //!          setFilledOnDevice(), which may move the device bindings again.
+    //!
+    void packInputs()
+    {
+        if (!mPackInputs)
+        {
+            CHECK(cudaEventCreateWithFlags(&mPackedCopied, cudaEventDisableTiming));
+            mPackInputs = true;
+        }
+        pack();
+    }
+
     //!
     //! \brief Returns the size of the host and device buffers that correspond to tensorName.
     //!        Returns kINVALID_SIZE_VALUE if no such tensor can be found.
@@ -409,19 +572,96 @@ public:
         memcpyBuffers(false, true, true, stream);
     }
 
-    ~BufferManager() = default;
+    ~BufferManager()
+    {
+        if (mPackedCopied)
+        {
+            cudaEventDestroy(mPackedCopied);
+        }
+    }
 
 private:
+    //! Number of elements of binding i with the given dimensions, vectorized dimensions padded to whole vectors
+    size_t bindingVolume(int i, nvinfer1::Dims dims, size_t vol) const
+    {
+        int vecDim = mEngine->getBindingVectorizedDim(i);
+        if (-1 != vecDim) // i.e., 0 != lgScalarsPerVector
+        {
+            int scalarsPerVec = mEngine->getBindingComponentsPerElement(i);
+            dims.d[vecDim] = divUp(dims.d[vecDim], scalarsPerVec);
+            vol *= scalarsPerVec;
+        }
+        return vol * samplesCommon::volume(dims);
+    }
+
     void* getBuffer(const bool isHost, const std::string& tensorName) const
     {
         int index = mEngine->getBindingIndex(tensorName.c_str());
         if (index == -1)
             return nullptr;
-        return (isHost ? mManagedBuffers[index]->hostBuffer.data() : mManagedBuffers[index]->deviceBuffer.data());
+        return (isHost ? mManagedBuffers[index]->hostBuffer.data() : mDeviceBindings[index]);
+    }
+
+    //! Lay the inputs copied from the host out in the staging buffers and point their device bindings into them
+    void pack()
+    {
+        constexpr size_t kPACK_ALIGNMENT{256};
+        mPackedOffsets.assign(mEngine->getNbBindings(), kINVALID_SIZE_VALUE);
+        mPackedSize = 0;
+        for (int i = 0; i < mEngine->getNbBindings(); i++)
+        {
+            const auto& manBuf = *mManagedBuffers[i];
+            if (mEngine->bindingIsInput(i) && !manBuf.filledOnDevice)
+            {
+                mPackedOffsets[i] = mPackedSize;
+                mPackedSize += divUp(manBuf.hostBuffer.nbBytes(), kPACK_ALIGNMENT) * kPACK_ALIGNMENT;
+            }
+        }
+        mPackedHost.resize(mPackedSize);
+        mPackedDevice.resize(mPackedSize);
+        for (int i = 0; i < mEngine->getNbBindings(); i++)
+        {
+            mDeviceBindings[i] = mPackedOffsets[i] == kINVALID_SIZE_VALUE
+                ? mManagedBuffers[i]->deviceBuffer.data()
+                : static_cast<char*>(mPackedDevice.data()) + mPackedOffsets[i];
+        }
+    }
+
+    //!
+    //! Gather the inputs into the staging and copy it in one go. An asynchronous copy out of the staging may still be
+    //! in flight, as with a copy from pageable memory the gather waits for it.
+    //!
+    void copyPackedInputs(const bool async, const cudaStream_t& stream)
+    {
+        CHECK(cudaEventSynchronize(mPackedCopied));
+        for (int i = 0; i < mEngine->getNbBindings(); i++)
+        {
+            if (mPackedOffsets[i] != kINVALID_SIZE_VALUE)
+            {
+                const auto& hostBuffer = mManagedBuffers[i]->hostBuffer;
+                std::memcpy(static_cast<char*>(mPackedHost.data()) + mPackedOffsets[i], hostBuffer.data(),
+                    hostBuffer.nbBytes());
+            }
+        }
+        if (async)
+        {
+            CHECK(cudaMemcpyAsync(
+                mPackedDevice.data(), mPackedHost.data(), mPackedSize, cudaMemcpyHostToDevice, stream));
+            CHECK(cudaEventRecord(mPackedCopied, stream));
+        }
+        else
+        {
+            CHECK(cudaMemcpy(mPackedDevice.data(), mPackedHost.data(), mPackedSize, cudaMemcpyHostToDevice));
+        }
     }
 
     void memcpyBuffers(const bool copyInput, const bool deviceToHost, const bool async, const cudaStream_t& stream = 0)
     {
+        const bool packed = copyInput && mPackedSize;
+        if (packed)
+        {
+            copyPackedInputs(async, stream);
+        }
         for (int i = 0; i < mEngine->getNbBindings(); i++)
         {
             void* dstPtr
@@ -430,6 +670,9 @@ private:
                 = deviceToHost ? mManagedBuffers[i]->deviceBuffer.data() : mManagedBuffers[i]->hostBuffer.data();
             const size_t byteSize = mManagedBuffers[i]->hostBuffer.nbBytes();
             const cudaMemcpyKind memcpyType = deviceToHost ? cudaMemcpyDeviceToHost : cudaMemcpyHostToDevice;
+            const bool inPackedCopy = packed && mPackedOffsets[i] != kINVALID_SIZE_VALUE;
+            if (copyInput && (mManagedBuffers[i]->filledOnDevice || inPackedCopy))
+                continue;
             if ((copyInput && mEngine->bindingIsInput(i)) || (!copyInput && !mEngine->bindingIsInput(i)))
             {
                 if (async)
@@ -444,6 +687,12 @@ private:
     int mBatchSize;                                              //!< The batch size
     std::vector<std::unique_ptr<ManagedBuffer>> mManagedBuffers; //!< The vector of pointers to managed buffers
     std::vector<void*> mDeviceBindings; //!< The vector of device buffers needed for engine execution
+    bool mPackInputs{false};            //!< Whether the inputs are staged together, see packInputs()
+    std::vector<size_t> mPackedOffsets; //!< Offset of each packed input in the staging, kINVALID_SIZE_VALUE if not
+    size_t mPackedSize{0};              //!< Bytes of the staging copied to the device
+    PinnedHostBuffer mPackedHost{nvinfer1::DataType::kINT8};
+    DeviceBuffer mPackedDevice{nvinfer1::DataType::kINT8};
+    cudaEvent_t mPackedCopied{nullptr}; //!< The last asynchronous copy out of the staging
 };
 
 } // namespace samplesCommon
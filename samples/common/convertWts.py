@@ -0,0 +1,116 @@
+#!/usr/bin/python
+#
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Script to convert TensorRT wts weight files into the binary weights format of WeightsFile.h, which the samples map
+# into memory instead of parsing.
+# Reads the v1 format, [name] [type] [size] <hex values>, of the MNIST API sample and of dumpTFWts.py -1, and the v2
+# format, [name] [type] [(shape)] <binary values>, of the MLP and char-RNN samples and of dumpTFWts.py.
+
+from __future__ import print_function
+import argparse
+import struct
+import sys
+
+MAGIC = 0x3130535457545254 # "TRTWTS01"
+ALIGNMENT = 64
+MAX_DIMS = 8
+HEADER = struct.Struct('<QQQQ')
+ENTRY = struct.Struct('<QIii%diiQQ' % MAX_DIMS)
+# Bytes of an element of each nvinfer1::DataType: kFLOAT, kHALF, kINT8, kINT32, kBOOL
+ELEMENT_SIZE = {0: 4, 1: 2, 2: 1, 3: 4, 4: 1}
+
+def write_weights(file_name, weights):
+    """Write a binary weights file from a list of (name, TensorRT type, shape, raw little endian bytes)"""
+    with open(file_name, 'wb') as out:
+        out.write(HEADER.pack(MAGIC, len(weights), 0, 0))
+        offset = HEADER.size
+        offsets = []
+        for name, trt_type, shape, data in weights:
+            padding = (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT
+            out.write(b'\0' * padding)
+            offset += padding
+            offsets.append(offset)
+            out.write(data)
+            offset += len(data)
+
+        padding = (8 - offset % 8) % 8
+        out.write(b'\0' * padding)
+        table_offset = offset + padding
+        names = b''
+        for (name, trt_type, shape, data), data_offset in zip(weights, offsets):
+            if len(shape) > MAX_DIMS:
+                raise ValueError('%s has more than %d dimensions' % (name, MAX_DIMS))
+            encoded = name.encode('utf-8')
+            dims = list(shape) + [0] * (MAX_DIMS - len(shape))
+            count = len(data) // ELEMENT_SIZE[trt_type]
+            out.write(ENTRY.pack(len(names), len(encoded), trt_type, len(shape), *(dims + [0, data_offset, count])))
+            names += encoded
+        out.write(names)
+        out.seek(0)
+        out.write(HEADER.pack(MAGIC, len(weights), table_offset, table_offset + len(weights) * ENTRY.size))
+
+def read_wts(file_name):
+    """Read the weights of a v1 or v2 wts file, in the formats of the samples"""
+    with open(file_name, 'rb') as f:
+        data = bytearray(f.read())
+    pos = [0]
+
+    def token():
+        while chr(data[pos[0]]).isspace():
+            pos[0] += 1
+        start = pos[0]
+        while pos[0] < len(data) and not chr(data[pos[0]]).isspace():
+            pos[0] += 1
+        return data[start:pos[0]].decode('utf-8')
+
+    weights = []
+    for _ in range(int(token())):
+        name = token()
+        trt_type = int(token())
+        size = ELEMENT_SIZE[trt_type]
+        while chr(data[pos[0]]).isspace():
+            pos[0] += 1
+        if chr(data[pos[0]]) == '(':
+            # v2: the shape, one space, then the values
+            end = data.index(b')', pos[0])
+            shape = [int(d) for d in data[pos[0] + 1:end].decode('utf-8').split(',') if d.strip()]
+            pos[0] = end + 2
+            count = 1
+            for d in shape:
+                count *= d
+            values = bytes(data[pos[0]:pos[0] + count * size])
+            pos[0] += count * size
+        else:
+            # v1: the number of values, then each value as the hex of its bits
+            count = int(token())
+            shape = [count]
+            fmt = {1: '<B', 2: '<H', 4: '<I'}[size]
+            values = b''.join(struct.pack(fmt, int(token(), 16)) for _ in range(count))
+        weights.append((name, trt_type, shape, values))
+    return weights
+
+def main():
+    parser = argparse.ArgumentParser(description='TensorRT wts to binary weights converter')
+    parser.add_argument('input', help='The v1 or v2 wts file.')
+    parser.add_argument('output', help='The binary weights file to write.')
+    opt = parser.parse_args()
+    weights = read_wts(opt.input)
+    write_weights(opt.output, weights)
+    print('Converted %d weights of %s to %s' % (len(weights), opt.input, opt.output))
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -21,6 +21,7 @@
 import sys
 import struct
 import argparse
+from convertWts import write_weights
 try:
     import tensorflow as tf
     from tensorflow.python import pywrap_tensorflow
@@ -33,10 +34,13 @@ parser = argparse.ArgumentParser(description='TensorFlow Weight Dumper')
 parser.add_argument('-m', '--model', required=True, help='The checkpoint file basename, example basename(model.ckpt-766908.data-00000-of-00001) -> model.ckpt-766908')
 parser.add_argument('-o', '--output', required=True, help='The weight file to dump all the weights to.')
 parser.add_argument('-1', '--wtsv1', required=False, default=False, type=bool, help='Dump the weights in the wts v1.')
+parser.add_argument('-b', '--binary', required=False, default=False, type=bool, help='Dump the weights in the binary format the samples map into memory, see convertWts.py.')
 
 opt = parser.parse_args()
 
-if opt.wtsv1:
+if opt.binary:
+    print "Outputting the trained weights in the binary weights format of samples/common/WeightsFile.h."
+elif opt.wtsv1:
     print "Outputting the trained weights in TensorRT's wts v1 format. This format is documented as:"
     print "Line 0: <number of buffers in the file>"
     print "Line 1-Num: [buffer name] [buffer type] [buffer size] <hex values>"
@@ -65,11 +69,14 @@ def getTRTType(tensor):
 
 try:
    # Open output file
-    if opt.wtsv1:
+    if opt.binary:
+        outputFileName = outputbase + ".trtwts"
+    elif opt.wtsv1:
         outputFileName = outputbase + ".wts"
     else:
         outputFileName = outputbase + ".wts2"
-    outputFile = open(outputFileName, 'w')
+    if not opt.binary:
+        outputFile = open(outputFileName, 'w')
 
     # read vars from checkpoint
     reader = pywrap_tensorflow.NewCheckpointReader(inputbase)
@@ -79,7 +86,9 @@ try:
     count = 0
     for key in sorted(var_to_shape_map):
         count += 1
-    outputFile.write("%s\n"%(count))
+    if not opt.binary:
+        outputFile.write("%s\n"%(count))
+    binaryWeights = []
 
     # Dump the weights in either v1 or v2 format
     for key in sorted(var_to_shape_map):
@@ -91,6 +100,9 @@ try:
             val = tensor.size
         print("%s %s %s "%(file_key, typeOfElem, val))
         flat_tensor = tensor.flatten()
+        if opt.binary:
+            binaryWeights.append((file_key, typeOfElem, list(tensor.shape), flat_tensor.tobytes()))
+            continue
         outputFile.write("%s 0 %s "%(file_key, val))
         if opt.wtsv1:
             for weight in flat_tensor:
@@ -99,7 +111,10 @@ try:
         else:
             outputFile.write(flat_tensor.tobytes())
         outputFile.write("\n");
-    outputFile.close()
+    if opt.binary:
+        write_weights(outputFileName, binaryWeights)
+    else:
+        outputFile.close()
 
 except Exception as e:  # pylint: disable=broad-except
     print(str(e))
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "imagePreprocessor.h"
+#include <algorithm>
+#include <cmath>
+#include <cuda_fp16.h>
+
+namespace samplesCommon
+{
+namespace
+{
+
+//! Placement of the resized image in the network input
+struct ResizeGeometry
+{
+    int resizedW;
+    int resizedH;
+    int offsetX;
+    int offsetY;
+    float scaleX;
+    float scaleY;
+};
+
+template <typename T>
+__device__ inline T fromFloat(float x, float outputScale);
+
+template <>
+__device__ inline float fromFloat<float>(float x, float /*outputScale*/)
+{
+    return x;
+}
+
+template <>
+__device__ inline __half fromFloat<__half>(float x, float /*outputScale*/)
+{
+    return __float2half(x);
+}
+
+template <>
+__device__ inline int8_t fromFloat<int8_t>(float x, float outputScale)
+{
+    return static_cast<int8_t>(fmaxf(-128.F, fminf(127.F, rintf(x / outputScale))));
+}
+
+//! Grid (columns, rows, images), one thread per output pixel for all of its channels
+template <typename T>
+__global__ void preprocessImagesKernel(
+    ImagePreprocessParams params, ResizeGeometry geometry, const uint8_t* src, T* dst)
+{
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    const int n = blockIdx.z;
+    if (x >= params.dstW || y >= params.dstH)
+    {
+        return;
+    }
+
+    float pixel[3]{params.padValue, params.padValue, params.padValue};
+    const int rx = x - geometry.offsetX;
+    const int ry = y - geometry.offsetY;
+    if (rx >= 0 && ry >= 0 && rx < geometry.resizedW && ry < geometry.resizedH)
+    {
+        // Pixel centers are aligned, as in the bilinear resize of OpenCV
+        const float sx = fmaxf((rx + 0.5F) * geometry.scaleX - 0.5F, 0.F);
+        const float sy = fmaxf((ry + 0.5F) * geometry.scaleY - 0.5F, 0.F);
+        const int x0 = min(static_cast<int>(sx), params.srcW - 1);
+        const int y0 = min(static_cast<int>(sy), params.srcH - 1);
+        const int x1 = min(x0 + 1, params.srcW - 1);
+        const int y1 = min(y0 + 1, params.srcH - 1);
+        const float ax = sx - x0;
+        const float ay = sy - y0;
+
+        const uint8_t* image = src + static_cast<size_t>(n) * params.srcH * params.srcW * 3;
+        const uint8_t* p00 = image + (y0 * params.srcW + x0) * 3;
+        const uint8_t* p01 = image + (y0 * params.srcW + x1) * 3;
+        const uint8_t* p10 = image + (y1 * params.srcW + x0) * 3;
+        const uint8_t* p11 = image + (y1 * params.srcW + x1) * 3;
+        for (int c = 0; c < 3; ++c)
+        {
+            const float top = p00[c] + (p01[c] - p00[c]) * ax;
+            const float bottom = p10[c] + (p11[c] - p10[c]) * ax;
+            pixel[c] = top + (bottom - top) * ay;
+        }
+    }
+
+    const size_t plane = static_cast<size_t>(params.dstH) * params.dstW;
+    T* out = dst + n * 3 * plane + y * params.dstW + x;
+    for (int c = 0; c < 3; ++c)
+    {
+        const float value = (pixel[params.reverseChannels ? 2 - c : c] - params.mean[c]) * params.scale[c];
+        out[c * plane] = fromFloat<T>(value, params.outputScale);
+    }
+}
+
+ResizeGeometry resizeGeometry(const ImagePreprocessParams& params)
+{
+    ResizeGeometry geometry{params.dstW, params.dstH, 0, 0, 0.F, 0.F};
+    if (params.letterbox)
+    {
+        const float ratio = std::min(
+            static_cast<float>(params.dstW) / params.srcW, static_cast<float>(params.dstH) / params.srcH);
+        geometry.resizedW = std::min(params.dstW, static_cast<int>(std::round(params.srcW * ratio)));
+        geometry.resizedH = std::min(params.dstH, static_cast<int>(std::round(params.srcH * ratio)));
+        geometry.offsetX = (params.dstW - geometry.resizedW) / 2;
+        geometry.offsetY = (params.dstH - geometry.resizedH) / 2;
+    }
+    geometry.scaleX = static_cast<float>(params.srcW) / geometry.resizedW;
+    geometry.scaleY = static_cast<float>(params.srcH) / geometry.resizedH;
+    return geometry;
+}
+
+} // namespace
+
+void preprocessImages(
+    const ImagePreprocessParams& params, int batchSize, const uint8_t* src, void* dst, cudaStream_t stream)
+{
+    const ResizeGeometry geometry = resizeGeometry(params);
+    const dim3 block(32, 8);
+    const dim3 grid(divUp(params.dstW, block.x), divUp(params.dstH, block.y), batchSize);
+    switch (params.outputType)
+    {
+    case nvinfer1::DataType::kHALF:
+        preprocessImagesKernel<<<grid, block, 0, stream>>>(params, geometry, src, static_cast<__half*>(dst));
+        break;
+    case nvinfer1::DataType::kINT8:
+        preprocessImagesKernel<<<grid, block, 0, stream>>>(params, geometry, src, static_cast<int8_t*>(dst));
+        break;
+    default:
+        preprocessImagesKernel<<<grid, block, 0, stream>>>(params, geometry, src, static_cast<float*>(dst));
+        break;
+    }
+    CHECK(cudaGetLastError());
+}
+
+} // namespace samplesCommon
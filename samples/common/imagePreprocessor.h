@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TENSORRT_IMAGE_PREPROCESSOR_H
+#define TENSORRT_IMAGE_PREPROCESSOR_H
+
+#include "NvInfer.h"
+#include "common.h"
+#include <cstdint>
+#include <cstring>
+#include <cuda_runtime_api.h>
+
+namespace samplesCommon
+{
+
+//!
+//! \brief How raw 8-bit HWC images map to the CHW input of a network.
+//!
+//! Output channel c is (pixel[c'] - mean[c]) * scale[c], where c' is c, or 2 - c with reverseChannels. The images
+//! are resized bilinearly to dstH x dstW, or with letterbox to the largest size keeping their aspect ratio, centered
+//! and padded with padValue.
+//!
+struct ImagePreprocessParams
+{
+    int srcH{0};
+    int srcW{0};
+    int dstH{0};
+    int dstW{0};
+    bool letterbox{false};
+    //! Raw value of the letterbox padding, normalized like the pixels
+    float padValue{0.F};
+    //! RGB images to a BGR network, or the other way around
+    bool reverseChannels{false};
+    //! Per output channel, scale is the inverse of the standard deviation
+    float mean[3]{0.F, 0.F, 0.F};
+    float scale[3]{1.F, 1.F, 1.F};
+    //! kFLOAT, kHALF or kINT8, INT8 inputs are quantized with outputScale
+    nvinfer1::DataType outputType{nvinfer1::DataType::kFLOAT};
+    float outputScale{1.F};
+};
+
+//!
+//! \brief Runs the fused resize, normalization, channel reorder and conversion of batchSize images on the device.
+//!
+//! \param src The 3 channel images, srcH x srcW x 3 bytes each.
+//! \param dst The network input binding, batchSize x 3 x dstH x dstW elements of outputType.
+//!
+void preprocessImages(
+    const ImagePreprocessParams& params, int batchSize, const uint8_t* src, void* dst, cudaStream_t stream);
+
+//!
+//! \class ImagePreprocessor
+//!
+//! \brief Feeds the raw images to the device and preprocesses them there, into the input binding of an engine.
+//!
+//! The images are copied as 8-bit HWC, a quarter of the bytes of their FP32 CHW conversion, from pinned staging
+//! buffers. The staging buffers of a batch must not be written again until the stream of its enqueue has passed the
+//! copy, alternate two preprocessors to fill a batch while the previous one is in flight.
+//!
+class ImagePreprocessor
+{
+public:
+    ImagePreprocessor(const ImagePreprocessParams& params, int maxBatchSize)
+        : mParams(params)
+        , mMaxBatchSize(maxBatchSize)
+        , mImageSize(static_cast<size_t>(params.srcH) * params.srcW * 3)
+    {
+        CHECK(cudaMallocHost(reinterpret_cast<void**>(&mHost), mImageSize * mMaxBatchSize));
+        CHECK(cudaMalloc(reinterpret_cast<void**>(&mDevice), mImageSize * mMaxBatchSize));
+    }
+
+    ~ImagePreprocessor()
+    {
+        cudaFreeHost(mHost);
+        cudaFree(mDevice);
+    }
+
+    ImagePreprocessor(const ImagePreprocessor&) = delete;
+    ImagePreprocessor& operator=(const ImagePreprocessor&) = delete;
+
+    //!
+    //! \brief The pinned staging buffer of image index of the batch, srcH x srcW x 3 bytes.
+    //!
+    uint8_t* hostImage(int index)
+    {
+        return mHost + mImageSize * index;
+    }
+
+    void setHostImage(int index, const uint8_t* image)
+    {
+        std::memcpy(hostImage(index), image, mImageSize);
+    }
+
+    //!
+    //! \brief Copies batchSize staged images to the device and preprocesses them into binding.
+    //!
+    void enqueue(int batchSize, void* binding, cudaStream_t stream)
+    {
+        assert(batchSize <= mMaxBatchSize);
+        CHECK(cudaMemcpyAsync(mDevice, mHost, mImageSize * batchSize, cudaMemcpyHostToDevice, stream));
+        preprocessImages(mParams, batchSize, mDevice, binding, stream);
+    }
+
+private:
+    ImagePreprocessParams mParams;
+    int mMaxBatchSize;
+    size_t mImageSize;
+    uint8_t* mHost{nullptr};
+    uint8_t* mDevice{nullptr};
+};
+
+} // namespace samplesCommon
+
+#endif // TENSORRT_IMAGE_PREPROCESSOR_H
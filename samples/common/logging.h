@@ -18,16 +18,28 @@
 #define TENSORRT_LOGGING_H
 
 #include "NvInferRuntimeCommon.h"
+#include "asyncLogSink.h"
+#include <atomic>
 #include <cassert>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <ostream>
 #include <sstream>
 #include <string>
 
 using Severity = nvinfer1::ILogger::Severity;
 
+//!
+//! \brief The sink log streams push their lines to, nullptr when they write to their stream directly.
+//!
+inline std::atomic<samplesCommon::AsyncLogSink*>& asyncLogSink()
+{
+    static std::atomic<samplesCommon::AsyncLogSink*> sink{nullptr};
+    return sink;
+}
+
 class LogStreamConsumerBuffer : public std::stringbuf
 {
 public:
@@ -68,16 +80,23 @@ public:
     {
         if (mShouldLog)
         {
+            samplesCommon::AsyncLogSink* sink = asyncLogSink().load(std::memory_order_acquire);
+            if (sink)
+            {
+                std::ostringstream line;
+                putTimestamp(line);
+                line << mPrefix << str();
+                str("");
+                sink->push(mOutput, line.str());
+                // Errors and warnings are out before a failing sample aborts
+                if (&mOutput == &std::cerr)
+                {
+                    sink->flush();
+                }
+                return;
+            }
             // prepend timestamp
-            std::time_t timestamp = std::time(nullptr);
-            tm* tm_local = std::localtime(&timestamp);
-            std::cout << "[";
-            std::cout << std::setw(2) << std::setfill('0') << 1 + tm_local->tm_mon << "/";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_mday << "/";
-            std::cout << std::setw(4) << std::setfill('0') << 1900 + tm_local->tm_year << "-";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_hour << ":";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_min << ":";
-            std::cout << std::setw(2) << std::setfill('0') << tm_local->tm_sec << "] ";
+            putTimestamp(std::cout);
             // std::stringbuf::str() gets the string contents of the buffer
             // insert the buffer contents pre-appended by the appropriate prefix into the stream
             mOutput << mPrefix << str();
@@ -86,6 +105,10 @@ public:
             // flush the stream
             mOutput.flush();
         }
+        else
+        {
+            str("");
+        }
     }
 
     void setShouldLog(bool shouldLog)
@@ -94,6 +117,26 @@ public:
     }
 
 private:
+    static void putTimestamp(std::ostream& stream)
+    {
+        std::time_t timestamp = std::time(nullptr);
+        // std::localtime is not thread safe
+        tm tmLocal;
+#ifdef _MSC_VER
+        localtime_s(&tmLocal, &timestamp);
+#else
+        localtime_r(&timestamp, &tmLocal);
+#endif
+        const tm* tm_local = &tmLocal;
+        stream << "[";
+        stream << std::setw(2) << std::setfill('0') << 1 + tm_local->tm_mon << "/";
+        stream << std::setw(2) << std::setfill('0') << tm_local->tm_mday << "/";
+        stream << std::setw(4) << std::setfill('0') << 1900 + tm_local->tm_year << "-";
+        stream << std::setw(2) << std::setfill('0') << tm_local->tm_hour << ":";
+        stream << std::setw(2) << std::setfill('0') << tm_local->tm_min << ":";
+        stream << std::setw(2) << std::setfill('0') << tm_local->tm_sec << "] ";
+    }
+
     std::ostream& mOutput;
     std::string mPrefix;
     bool mShouldLog;
@@ -135,6 +178,7 @@ public:
         , mShouldLog(severity <= reportableSeverity)
         , mSeverity(severity)
     {
+        setShouldLogState();
     }
 
     LogStreamConsumer(LogStreamConsumer&& other)
@@ -143,15 +187,23 @@ public:
         , mShouldLog(other.mShouldLog)
         , mSeverity(other.mSeverity)
     {
+        setShouldLogState();
     }
 
     void setReportableSeverity(Severity reportableSeverity)
     {
         mShouldLog = mSeverity <= reportableSeverity;
         mBuffer.setShouldLog(mShouldLog);
+        setShouldLogState();
     }
 
 private:
+    //! A stream below the reportable severity is left bad, so insertions into it return before any formatting
+    void setShouldLogState()
+    {
+        clear(mShouldLog ? std::ios::goodbit : std::ios::badbit);
+    }
+
     static std::ostream& severityOstream(Severity severity)
     {
         return severity >= Severity::kINFO ? std::cout : std::cerr;
@@ -206,6 +258,29 @@ public:
     {
     }
 
+    ~Logger()
+    {
+        if (mAsyncSink)
+        {
+            setAsyncLogging(false);
+        }
+    }
+
+    //!
+    //! \brief Makes log streams push their lines to a background writer instead of writing them to the console.
+    //!
+    //! Lines pushed while the queue is full are dropped and counted, errors and warnings wait for the writer. Disabling
+    //! writes out the queued lines; it must not race with threads that are still logging.
+    //!
+    //! \param capacity The number of lines the queue holds.
+    //!
+    void setAsyncLogging(bool enable, size_t capacity = 4096)
+    {
+        std::unique_ptr<samplesCommon::AsyncLogSink> sink{enable ? new samplesCommon::AsyncLogSink(capacity) : nullptr};
+        asyncLogSink().store(sink.get(), std::memory_order_release);
+        mAsyncSink.swap(sink);
+    }
+
     //!
     //! \enum TestResult
     //! \brief Represents the state of a given test
@@ -238,7 +313,11 @@ public:
     //!
     void log(Severity severity, const char* msg) override
     {
-        LogStreamConsumer(mReportableSeverity, severity) << "[TRT] " << std::string(msg) << std::endl;
+        if (severity > mReportableSeverity)
+        {
+            return;
+        }
+        LogStreamConsumer(mReportableSeverity, severity) << "[TRT] " << msg << std::endl;
     }
 
     //!
@@ -432,6 +511,7 @@ private:
     }
 
     Severity mReportableSeverity;
+    std::unique_ptr<samplesCommon::AsyncLogSink> mAsyncSink;
 };
 
 namespace
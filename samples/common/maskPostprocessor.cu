@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "maskPostprocessor.h"
+
+namespace samplesCommon
+{
+namespace
+{
+
+//! Grid (columns, rows, images), one thread per pixel of the largest image. Each pixel visits the detections of its
+//! image from the last, most are rejected by their box, and samples the mask of the first covering it.
+__global__ void pasteMasksKernel(int maskH, int maskW, float threshold, const float* masks, const MaskImage* images,
+    const MaskBox* boxes, int16_t* instances)
+{
+    const MaskImage image = images[blockIdx.z];
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    if (x >= image.width || y >= image.height)
+    {
+        return;
+    }
+
+    int16_t instance = -1;
+    for (int i = image.boxCount - 1; i >= 0; --i)
+    {
+        const MaskBox box = boxes[image.firstBox + i];
+        const int left = static_cast<int>(box.x1);
+        const int top = static_cast<int>(box.y1);
+        const int width = static_cast<int>(box.x2 - box.x1);
+        const int height = static_cast<int>(box.y2 - box.y1);
+        const int bx = x - left;
+        const int by = y - top;
+        if (bx < 0 || by < 0 || bx >= width || by >= height)
+        {
+            continue;
+        }
+        // The corners of the mask are on the corners of the box
+        const float sx = width > 1 ? static_cast<float>(bx) * (maskW - 1) / (width - 1) : 0.F;
+        const float sy = height > 1 ? static_cast<float>(by) * (maskH - 1) / (height - 1) : 0.F;
+        const int x0 = min(static_cast<int>(sx), maskW - 1);
+        const int y0 = min(static_cast<int>(sy), maskH - 1);
+        const int x1 = min(x0 + 1, maskW - 1);
+        const int y1 = min(y0 + 1, maskH - 1);
+        const float ax = sx - x0;
+        const float ay = sy - y0;
+        const float* mask = masks + static_cast<size_t>(box.mask) * maskH * maskW;
+        const float upper = mask[y0 * maskW + x0] + (mask[y0 * maskW + x1] - mask[y0 * maskW + x0]) * ax;
+        const float lower = mask[y1 * maskW + x0] + (mask[y1 * maskW + x1] - mask[y1 * maskW + x0]) * ax;
+        if (upper + (lower - upper) * ay > threshold)
+        {
+            instance = static_cast<int16_t>(i);
+            break;
+        }
+    }
+    instances[image.offset + static_cast<size_t>(y) * image.width + x] = instance;
+}
+
+} // namespace
+
+void pasteMasks(int maskH, int maskW, float threshold, int imageCount, int maxHeight, int maxWidth,
+    const float* masks, const MaskImage* images, const MaskBox* boxes, int16_t* instances, cudaStream_t stream)
+{
+    if (!imageCount || !maxHeight || !maxWidth)
+    {
+        return;
+    }
+    const dim3 block(32, 8);
+    const dim3 grid(divUp(maxWidth, block.x), divUp(maxHeight, block.y), imageCount);
+    pasteMasksKernel<<<grid, block, 0, stream>>>(maskH, maskW, threshold, masks, images, boxes, instances);
+    CHECK(cudaGetLastError());
+}
+
+} // namespace samplesCommon
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TENSORRT_MASK_POSTPROCESSOR_H
+#define TENSORRT_MASK_POSTPROCESSOR_H
+
+#include "common.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cuda_runtime_api.h>
+#include <utility>
+#include <vector>
+
+namespace samplesCommon
+{
+
+//!
+//! \brief A detection whose mask is pasted, in pixels of its image.
+//!
+//! The mask is resized to the integer size of the box, with the corners of the mask on the corners of the box, and
+//! pasted at its integer origin, as the host paste of the Mask R-CNN sample.
+//!
+struct MaskBox
+{
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+    //! Index of the maskH x maskW mask of the detection among the masks of the batch
+    int mask;
+};
+
+//!
+//! \brief An image of the batch and its detections.
+//!
+struct MaskImage
+{
+    int height;
+    int width;
+    //! Offset of the instance map of the image among those of the batch, in pixels
+    size_t offset;
+    //! The detections of the image are boxes [firstBox, firstBox + boxCount) of the batch
+    int firstBox;
+    int boxCount;
+};
+
+//!
+//! \brief Thresholds, resizes and pastes the masks of all the detections of a batch in one launch.
+//!
+//! Writes the instance map of each image, the index of the detection of the image covering each pixel, or -1. Where
+//! detections overlap, the last one covers the pixel, as when the masks are pasted in order.
+//!
+//! \param masks The FP32 probabilities of the masks, maskH x maskW each.
+//! \param images, boxes Device copies of the images and detections of the batch.
+//! \param maxHeight, maxWidth The largest image of the batch.
+//!
+void pasteMasks(int maskH, int maskW, float threshold, int imageCount, int maxHeight, int maxWidth,
+    const float* masks, const MaskImage* images, const MaskBox* boxes, int16_t* instances, cudaStream_t stream);
+
+//!
+//! \class MaskPostprocessor
+//!
+//! \brief Turns the low resolution masks of the detections of a batch into full resolution instance maps on the
+//! device, and copies only the maps back.
+//!
+//! The maps are two bytes per pixel of each image, instead of the maskH x maskW FP32 masks of every class of every
+//! detection. The descriptions of the detections and the maps go through pinned staging buffers, the maps can be read
+//! once the stream of the enqueue has passed it.
+//!
+class MaskPostprocessor
+{
+public:
+    MaskPostprocessor(int maskH, int maskW, float threshold, int maxImages, int maxBoxes, size_t maxPixels)
+        : mMaskH(maskH)
+        , mMaskW(maskW)
+        , mThreshold(threshold)
+        , mMaxImages(maxImages)
+        , mMaxBoxes(maxBoxes)
+        , mMaxPixels(maxPixels)
+    {
+        CHECK(cudaMallocHost(reinterpret_cast<void**>(&mHostImages), sizeof(MaskImage) * maxImages));
+        CHECK(cudaMallocHost(reinterpret_cast<void**>(&mHostBoxes), sizeof(MaskBox) * maxBoxes));
+        CHECK(cudaMallocHost(reinterpret_cast<void**>(&mHostInstances), sizeof(int16_t) * maxPixels));
+        CHECK(cudaMalloc(reinterpret_cast<void**>(&mDeviceImages), sizeof(MaskImage) * maxImages));
+        CHECK(cudaMalloc(reinterpret_cast<void**>(&mDeviceBoxes), sizeof(MaskBox) * maxBoxes));
+        CHECK(cudaMalloc(reinterpret_cast<void**>(&mDeviceInstances), sizeof(int16_t) * maxPixels));
+    }
+
+    ~MaskPostprocessor()
+    {
+        cudaFreeHost(mHostImages);
+        cudaFreeHost(mHostBoxes);
+        cudaFreeHost(mHostInstances);
+        cudaFree(mDeviceImages);
+        cudaFree(mDeviceBoxes);
+        cudaFree(mDeviceInstances);
+    }
+
+    MaskPostprocessor(const MaskPostprocessor&) = delete;
+    MaskPostprocessor& operator=(const MaskPostprocessor&) = delete;
+
+    //!
+    //! \brief Pastes the masks of the detections of each image and copies the instance maps to the host.
+    //!
+    //! \param sizes The height and width of each image.
+    //! \param boxes The detections of each image.
+    //! \param masks The device masks of the batch, indexed by MaskBox::mask.
+    //!
+    void enqueue(const std::vector<std::pair<int, int>>& sizes, const std::vector<std::vector<MaskBox>>& boxes,
+        const float* masks, cudaStream_t stream)
+    {
+        assert(sizes.size() == boxes.size() && static_cast<int>(sizes.size()) <= mMaxImages);
+        size_t pixels{0};
+        int boxCount{0};
+        int maxHeight{0};
+        int maxWidth{0};
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            mHostImages[i] = MaskImage{sizes[i].first, sizes[i].second, pixels, boxCount,
+                static_cast<int>(boxes[i].size())};
+            assert(boxCount + boxes[i].size() <= static_cast<size_t>(mMaxBoxes));
+            std::copy(boxes[i].begin(), boxes[i].end(), mHostBoxes + boxCount);
+            pixels += static_cast<size_t>(sizes[i].first) * sizes[i].second;
+            boxCount += static_cast<int>(boxes[i].size());
+            maxHeight = std::max(maxHeight, sizes[i].first);
+            maxWidth = std::max(maxWidth, sizes[i].second);
+        }
+        assert(pixels <= mMaxPixels);
+        mOffsets.resize(sizes.size());
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            mOffsets[i] = mHostImages[i].offset;
+        }
+
+        const int imageCount = static_cast<int>(sizes.size());
+        CHECK(cudaMemcpyAsync(
+            mDeviceImages, mHostImages, sizeof(MaskImage) * imageCount, cudaMemcpyHostToDevice, stream));
+        CHECK(cudaMemcpyAsync(mDeviceBoxes, mHostBoxes, sizeof(MaskBox) * boxCount, cudaMemcpyHostToDevice, stream));
+        pasteMasks(mMaskH, mMaskW, mThreshold, imageCount, maxHeight, maxWidth, masks, mDeviceImages, mDeviceBoxes,
+            mDeviceInstances, stream);
+        CHECK(cudaMemcpyAsync(
+            mHostInstances, mDeviceInstances, sizeof(int16_t) * pixels, cudaMemcpyDeviceToHost, stream));
+    }
+
+    //!
+    //! \brief The height x width instance map of image index of the last enqueue.
+    //!
+    const int16_t* instances(int index) const
+    {
+        return mHostInstances + mOffsets[index];
+    }
+
+private:
+    int mMaskH;
+    int mMaskW;
+    float mThreshold;
+    int mMaxImages;
+    int mMaxBoxes;
+    size_t mMaxPixels;
+    std::vector<size_t> mOffsets;
+    MaskImage* mHostImages{nullptr};
+    MaskBox* mHostBoxes{nullptr};
+    int16_t* mHostInstances{nullptr};
+    MaskImage* mDeviceImages{nullptr};
+    MaskBox* mDeviceBoxes{nullptr};
+    int16_t* mDeviceInstances{nullptr};
+};
+
+} // namespace samplesCommon
+
+#endif // TENSORRT_MASK_POSTPROCESSOR_H
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_NVTX_RANGE_H
+#define TRT_NVTX_RANGE_H
+
+//!
+//! NVTX ranges naming the plugin enqueues and the inference stages on Nsight Systems timelines.
+//!
+//! The ranges are compiled in with the USE_NVTX CMake option, which defines ENABLE_NVTX and links nvToolsExt, and
+//! are emitted only when the TRT_NVTX environment variable is set to anything but 0. Without ENABLE_NVTX, NVTX_RANGE
+//! expands to nothing.
+//!
+
+#ifdef ENABLE_NVTX
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <nvToolsExt.h>
+
+namespace samplesCommon
+{
+
+//!
+//! \brief True when TRT_NVTX is set to anything but 0, read once
+//!
+inline bool nvtxEnabled()
+{
+    static const bool enabled = []() {
+        const char* value = std::getenv("TRT_NVTX");
+        return value && std::strcmp(value, "0") != 0;
+    }();
+    return enabled;
+}
+
+//!
+//! \brief An ARGB color of a fixed palette, so that the ranges of each stream get their own color
+//!
+inline uint32_t nvtxColor(int index)
+{
+    static const uint32_t kColors[]
+        = {0xFF76B900, 0xFF1F77B4, 0xFFFF7F0E, 0xFFD62728, 0xFF9467BD, 0xFF8C564B, 0xFFE377C2, 0xFF17BECF};
+    const int count = sizeof(kColors) / sizeof(kColors[0]);
+    return kColors[((index % count) + count) % count];
+}
+
+//!
+//! \class NvtxRange
+//! \brief A range pushed on the calling thread for the lifetime of the object
+//!
+class NvtxRange
+{
+public:
+    explicit NvtxRange(const char* name, uint32_t color = nvtxColor(0))
+        : mPushed(nvtxEnabled())
+    {
+        if (mPushed)
+        {
+            nvtxEventAttributes_t attributes{};
+            attributes.version = NVTX_VERSION;
+            attributes.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+            attributes.colorType = NVTX_COLOR_ARGB;
+            attributes.color = color;
+            attributes.messageType = NVTX_MESSAGE_TYPE_ASCII;
+            attributes.message.ascii = name;
+            nvtxRangePushEx(&attributes);
+        }
+    }
+
+    NvtxRange(const NvtxRange&) = delete;
+    NvtxRange& operator=(const NvtxRange&) = delete;
+
+    ~NvtxRange()
+    {
+        if (mPushed)
+        {
+            nvtxRangePop();
+        }
+    }
+
+private:
+    bool mPushed;
+};
+
+} // namespace samplesCommon
+
+#define NVTX_RANGE(name) samplesCommon::NvtxRange nvtxRange_(name)
+#define NVTX_RANGE_COLOR(name, index) samplesCommon::NvtxRange nvtxRange_(name, samplesCommon::nvtxColor(index))
+
+#else
+
+#define NVTX_RANGE(name)
+#define NVTX_RANGE_COLOR(name, index)
+
+#endif // ENABLE_NVTX
+
+#endif // TRT_NVTX_RANGE_H
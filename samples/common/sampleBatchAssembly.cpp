@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include "sampleBatchAssembly.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+bool BatchAssembly::setUp(const std::vector<Bindings*>& bindings, int maxBatch, std::ostream& err)
+{
+    mSlots.clear();
+    for (const auto* set : bindings)
+    {
+        // In binding order, the same for every binding set
+        std::map<int, std::string> inputs;
+        for (const auto& n : set->getInputBindings())
+        {
+            inputs[n.second] = n.first;
+        }
+        std::vector<int> outputs;
+        for (const auto& n : set->getOutputBindings())
+        {
+            outputs.push_back(n.second);
+        }
+        std::sort(outputs.begin(), outputs.end());
+        mInputs = static_cast<int>(inputs.size());
+        mOutputs = static_cast<int>(outputs.size());
+
+        mSlots.emplace_back();
+        auto& slot = mSlots.back();
+        std::vector<RequestCopy> copies;
+        for (int r = 0; r < maxBatch; ++r)
+        {
+            for (const auto& input : inputs)
+            {
+                const int b = input.first;
+                const auto* host = static_cast<const char*>(set->getHostBuffer(b));
+                if (!host)
+                {
+                    err << "Batch assembly requires host values for input " << input.second << std::endl;
+                    return false;
+                }
+                const size_t bytes = set->getHostSize(b) / maxBatch;
+                auto* item = static_cast<char*>(const_cast<void*>(set->getDeviceBuffer(b))) + r * bytes;
+                slot.inputs.push_back({TrtHostBuffer(bytes), TrtDeviceBuffer(bytes), item, bytes});
+                std::memcpy(slot.inputs.back().host.get(), host + r * bytes, bytes);
+                copies.push_back({slot.inputs.back().device.get(), item, bytes, bytes});
+                slot.maxItemBytes = std::max(slot.maxItemBytes, bytes);
+            }
+            for (const int b : outputs)
+            {
+                const size_t bytes = set->getHostSize(b) / maxBatch;
+                auto* item = static_cast<char*>(const_cast<void*>(set->getDeviceBuffer(b))) + r * bytes;
+                slot.outputs.push_back({TrtHostBuffer(bytes), TrtDeviceBuffer(), item, bytes});
+            }
+        }
+        slot.copies.allocate(copies.size() * sizeof(RequestCopy));
+        cudaCheck(cudaMemcpy(
+            slot.copies.get(), copies.data(), copies.size() * sizeof(RequestCopy), cudaMemcpyHostToDevice));
+    }
+    return true;
+}
+
+void BatchAssembly::gather(int slot, int batch, cudaStream_t stream) const
+{
+    const auto& s = mSlots[slot];
+    for (int t = 0; t < batch * mInputs; ++t)
+    {
+        const auto& input = s.inputs[t];
+        cudaCheck(
+            cudaMemcpyAsync(input.device.get(), input.host.get(), input.bytes, cudaMemcpyHostToDevice, stream));
+    }
+    // The items past the batch still hold the requests of an earlier, larger batch
+    gatherRequests(static_cast<const RequestCopy*>(s.copies.get()), static_cast<int>(s.inputs.size()),
+        batch * mInputs, s.maxItemBytes, stream);
+}
+
+void BatchAssembly::scatter(int slot, int batch, cudaStream_t stream) const
+{
+    const auto& s = mSlots[slot];
+    for (int t = 0; t < batch * mOutputs; ++t)
+    {
+        const auto& output = s.outputs[t];
+        cudaCheck(cudaMemcpyAsync(output.host.get(), output.item, output.bytes, cudaMemcpyDeviceToHost, stream));
+    }
+}
+
+} // namespace sample
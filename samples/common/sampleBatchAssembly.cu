@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleBatchAssembly.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kTHREADS{256};
+constexpr int kMAX_BLOCKS{64};
+
+//! One row of blocks per request, copying 16 bytes per thread when the buffers and sizes allow it. The items of the
+//! requests from valid on are only zeroed.
+__global__ void gatherRequestsKernel(const RequestCopy* copies, int valid)
+{
+    RequestCopy copy = copies[blockIdx.y];
+    if (static_cast<int>(blockIdx.y) >= valid)
+    {
+        copy.bytes = 0;
+    }
+    const size_t start = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x;
+    const size_t stride = static_cast<size_t>(gridDim.x) * blockDim.x;
+    const auto aligned = [](size_t v) { return v % sizeof(uint4) == 0; };
+    if (aligned(reinterpret_cast<uintptr_t>(copy.source)) && aligned(reinterpret_cast<uintptr_t>(copy.destination))
+        && aligned(copy.bytes) && aligned(copy.itemBytes))
+    {
+        const auto* source = static_cast<const uint4*>(copy.source);
+        auto* destination = static_cast<uint4*>(copy.destination);
+        const size_t words = copy.bytes / sizeof(uint4);
+        for (size_t i = start; i < copy.itemBytes / sizeof(uint4); i += stride)
+        {
+            destination[i] = i < words ? source[i] : make_uint4(0, 0, 0, 0);
+        }
+        return;
+    }
+    const auto* source = static_cast<const unsigned char*>(copy.source);
+    auto* destination = static_cast<unsigned char*>(copy.destination);
+    for (size_t i = start; i < copy.itemBytes; i += stride)
+    {
+        destination[i] = i < copy.bytes ? source[i] : 0;
+    }
+}
+
+} // namespace
+
+void gatherRequests(const RequestCopy* copies, int count, int valid, size_t maxItemBytes, cudaStream_t stream)
+{
+    if (!count || !maxItemBytes)
+    {
+        return;
+    }
+    const size_t words = (maxItemBytes + sizeof(uint4) - 1) / sizeof(uint4);
+    const int blocks = static_cast<int>(std::min<size_t>((words + kTHREADS - 1) / kTHREADS, kMAX_BLOCKS));
+    gatherRequestsKernel<<<dim3(blocks, count), kTHREADS, 0, stream>>>(copies, valid);
+}
+
+} // namespace sample
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_BATCH_ASSEMBLY_H
+#define TRT_SAMPLE_BATCH_ASSEMBLY_H
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include "sampleDevice.h"
+
+namespace sample
+{
+
+class Bindings;
+
+//!
+//! \struct RequestCopy
+//! \brief The device buffer of a request and the item of a batch binding it is gathered into
+//!
+struct RequestCopy
+{
+    const void* source;
+    void* destination;
+    size_t bytes;     //!< Of the request, up to itemBytes
+    size_t itemBytes; //!< Of the batch item, the bytes past those of the request are zeroed
+};
+
+//!
+//! \brief Copy each of the first valid of count requests into its batch item, and zero the items of the others, with a
+//! single kernel, maxItemBytes being the largest item
+//!
+//! \param copies The copies in device memory
+//!
+void gatherRequests(const RequestCopy* copies, int count, int valid, size_t maxItemBytes, cudaStream_t stream);
+
+//!
+//! \class BatchAssembly
+//! \brief Assembles the batches of dynamic batching on the device from requests in buffers of their own
+//!
+//! Each binding set has the pinned host buffers of maxBatch requests, holding the items of its inputs, as a server
+//! receives them. Every request fills an item of each input. The inputs of every request of a batch are copied to
+//! device buffers of the request, and one kernel gathers them into consecutive items of the input bindings and zeroes
+//! the items past the last request of a partial batch. The outputs of every request are copied from its item of the
+//! output bindings into pinned host buffers of the request.
+//! No host copy packs the requests into a batch or splits the outputs of a batch, so assembling a batch does not
+//! depend on the bandwidth of the host memory. The host buffers of the output bindings are not updated.
+//!
+class BatchAssembly
+{
+public:
+    //!
+    //! \brief Allocate the buffers of maxBatch requests for each binding set, with the items of its host inputs
+    //!
+    //! \return False with the reason in err if an input has no host buffer to take the requests from
+    //!
+    bool setUp(const std::vector<Bindings*>& bindings, int maxBatch, std::ostream& err);
+
+    //!
+    //! \brief Copy the inputs of batch requests to the device and gather them into the inputs of binding set slot
+    //!
+    void gather(int slot, int batch, cudaStream_t stream) const;
+
+    //!
+    //! \brief Copy the outputs of each of batch requests from the outputs of binding set slot to its own buffers
+    //!
+    void scatter(int slot, int batch, cudaStream_t stream) const;
+
+private:
+    //!
+    //! \brief A buffer of a request and its item of a binding
+    //!
+    struct Transfer
+    {
+        TrtHostBuffer host;
+        TrtDeviceBuffer device; //!< Of input requests, outputs are copied from the binding
+        void* item;
+        size_t bytes;
+    };
+
+    //!
+    //! \brief The requests of a binding set, request major
+    //!
+    struct Slot
+    {
+        std::vector<Transfer> inputs;
+        std::vector<Transfer> outputs;
+        TrtDeviceBuffer copies; //!< RequestCopy of each input transfer
+        size_t maxItemBytes{0};
+    };
+
+    std::vector<Slot> mSlots;
+    int mInputs{0};  //!< Input bindings of each request
+    int mOutputs{0}; //!< Output bindings of each request
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_BATCH_ASSEMBLY_H
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iomanip>
+
+#include <cuda_runtime_api.h>
+
+#include "logger.h"
+#include "sampleCascade.h"
+#include "sampleOptions.h"
+#include "sampleRandom.h"
+
+using namespace nvinfer1;
+
+namespace sample
+{
+
+namespace
+{
+
+//! The first stage of the next batches is issued while the second stage of a batch waits for its count, and the
+//! oldest batch is collected before its slot is reused
+constexpr int kSLOTS{3};
+
+bool isDynamic(const Dims& dims)
+{
+    return std::any_of(dims.d, dims.d + dims.nbDims, [](int dim) { return dim == -1; });
+}
+
+//! Bindings of the first profile, the only one the stages run
+int bindingsInProfile(const ICudaEngine& engine)
+{
+    return engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+}
+
+//! Dimensions of an item of a binding of the first stage with rows as first dimension, for the second stage
+Dims withRows(const Dims& dims, bool implicitBatch, int rows)
+{
+    Dims batched = dims;
+    if (implicitBatch)
+    {
+        batched.nbDims = dims.nbDims + 1;
+        std::copy(dims.d, dims.d + dims.nbDims, batched.d + 1);
+    }
+    batched.d[0] = rows;
+    return batched;
+}
+
+} // namespace
+
+bool Cascade::setUp(ICudaEngine& first, ICudaEngine& second, const InferenceOptions& inference, std::ostream& err)
+{
+    mFirstEngine = &first;
+    mSecondEngine = &second;
+    mThreshold = inference.cascade.threshold;
+    mBatch = first.hasImplicitBatchDimension() ? inference.batch : 0;
+    if (second.hasImplicitBatchDimension())
+    {
+        err << "The second stage of a cascade takes the positives as its dynamic batch, it must be an explicit batch "
+            << "engine" << std::endl;
+        return false;
+    }
+    mFirst.reset(first.createExecutionContext());
+    mSecond.reset(second.createExecutionContext());
+    if (!mFirst || !mSecond)
+    {
+        err << "The stages of the cascade failed to create their execution contexts" << std::endl;
+        return false;
+    }
+
+    const InputShapes noShapes;
+    const auto& shapes = inference.shapes.empty() ? noShapes : inference.shapes[0];
+    const int nbFirst = bindingsInProfile(first);
+    for (int b = 0; b < nbFirst; ++b)
+    {
+        const auto dims = mFirst->getBindingDimensions(b);
+        if (!first.bindingIsInput(b) || !isDynamic(dims))
+        {
+            continue;
+        }
+        const std::string name = first.getBindingName(b);
+        const auto shape = shapes.find(name);
+        Dims staticDims{};
+        if (shape == shapes.end())
+        {
+            constexpr int DEFAULT_DIMENSION = 1;
+            staticDims.nbDims = dims.nbDims;
+            std::transform(dims.d, dims.d + dims.nbDims, staticDims.d,
+                [&](int dim) { return dim > 0 ? dim : DEFAULT_DIMENSION; });
+            gLogWarning << "Dynamic dimensions required for input: " << name
+                        << ", but no shapes were provided. Automatically overriding shape to: " << staticDims
+                        << std::endl;
+        }
+        else
+        {
+            staticDims = shape->second;
+        }
+        mFirst->setBindingDimensions(b, staticDims);
+    }
+    if (!mFirst->allInputDimensionsSpecified())
+    {
+        err << "The first stage of the cascade has inputs without dimensions" << std::endl;
+        return false;
+    }
+    for (int b = 0; b < nbFirst; ++b)
+    {
+        const auto dims = mFirst->getBindingDimensions(b);
+        const auto vol
+            = volume(dims, first.getBindingVectorizedDim(b), first.getBindingComponentsPerElement(b), mBatch);
+        mFirstBytes.push_back(vol * dataTypeSize(first.getBindingDataType(b)));
+    }
+
+    mScore = first.getBindingIndex(inference.cascade.score.c_str());
+    if (mScore < 0 || mScore >= nbFirst || first.bindingIsInput(mScore))
+    {
+        err << "The first stage of the cascade has no output " << inference.cascade.score << std::endl;
+        return false;
+    }
+    const auto scoreDims = mFirst->getBindingDimensions(mScore);
+    mItems = mBatch ? mBatch : scoreDims.nbDims ? scoreDims.d[0] : 1;
+    if (first.getBindingDataType(mScore) != DataType::kFLOAT || mFirstBytes[mScore] != mItems * sizeof(float))
+    {
+        err << "The score output " << inference.cascade.score << " of the cascade must hold one FP32 value per item"
+            << std::endl;
+        return false;
+    }
+
+    // Size the bindings of the second stage for all the items, each row up to the smallest profile batch is allocated
+    const int nbSecond = bindingsInProfile(second);
+    mSecondDims.resize(nbSecond);
+    for (int b = 0; b < nbSecond; ++b)
+    {
+        if (!second.bindingIsInput(b))
+        {
+            continue;
+        }
+        const std::string name = second.getBindingName(b);
+        const int source = first.getBindingIndex(name.c_str());
+        if (second.isShapeBinding(b) || source < 0 || source >= nbFirst)
+        {
+            err << "Second stage input " << name << " is not a tensor of the first stage" << std::endl;
+            return false;
+        }
+        const auto minDims = second.getProfileDimensions(b, 0, OptProfileSelector::kMIN);
+        const auto maxDims = second.getProfileDimensions(b, 0, OptProfileSelector::kMAX);
+        if (second.getBindingDimensions(b).d[0] != -1 || maxDims.d[0] < mItems)
+        {
+            err << "Second stage input " << name << " must have a dynamic first dimension of up to " << mItems
+                << " items" << std::endl;
+            return false;
+        }
+        mMinRows = std::max(mMinRows, minDims.d[0]);
+        mSecondDims[b] = withRows(mFirst->getBindingDimensions(source), mBatch != 0, mItems);
+        if (!mSecond->setBindingDimensions(b, mSecondDims[b]))
+        {
+            err << "Second stage input " << name << " does not take the dimensions " << mSecondDims[b]
+                << " of the first stage" << std::endl;
+            return false;
+        }
+        mLinks.push_back({b, source, mFirstBytes[source] / mItems});
+    }
+    if (!mSecond->allInputDimensionsSpecified())
+    {
+        err << "The second stage of the cascade has inputs without dimensions" << std::endl;
+        return false;
+    }
+    for (int b = 0; b < nbSecond; ++b)
+    {
+        const auto vol = volume(mSecond->getBindingDimensions(b), second.getBindingVectorizedDim(b),
+            second.getBindingComponentsPerElement(b), 0);
+        mSecondRows.push_back(vol * dataTypeSize(second.getBindingDataType(b)) / mItems);
+    }
+    for (const auto& link : mLinks)
+    {
+        if (link.rowBytes != mSecondRows[link.input])
+        {
+            err << "Second stage input " << second.getBindingName(link.input) << " takes " << mSecondRows[link.input]
+                << " bytes per item, the first stage gives " << link.rowBytes << std::endl;
+            return false;
+        }
+    }
+
+    mStream.reset(new TrtCudaStream);
+    mBase.reset(new TrtCudaEvent(!inference.spin));
+    mSlots.resize(kSLOTS);
+    for (auto& slot : mSlots)
+    {
+        for (int b = 0; b < nbFirst; ++b)
+        {
+            slot.first.emplace_back(new TrtDeviceBuffer(mFirstBytes[b]));
+            slot.firstPointers.push_back(slot.first.back()->get());
+        }
+        for (int b = 0; b < nbSecond; ++b)
+        {
+            slot.second.emplace_back(new TrtDeviceBuffer(mSecondRows[b] * mItems));
+            slot.secondPointers.push_back(slot.second.back()->get());
+            slot.outputs.emplace_back(second.bindingIsInput(b) ? nullptr : new TrtHostBuffer(mSecondRows[b] * mItems));
+        }
+        slot.indices.allocate(mItems * sizeof(int));
+        slot.hostIndices.allocate(mItems * sizeof(int));
+        slot.count.allocate(sizeof(int));
+        slot.hostCount.allocate(sizeof(int));
+        for (auto* event : {&slot.inStart, &slot.inEnd, &slot.firstStart, &slot.firstEnd, &slot.compactEnd,
+                 &slot.secondStart, &slot.secondEnd, &slot.outEnd})
+        {
+            event->reset(new TrtCudaEvent(!inference.spin));
+        }
+    }
+
+    // The same random inputs are copied in for every batch
+    for (int b = 0; b < nbFirst; ++b)
+    {
+        if (!first.bindingIsInput(b))
+        {
+            mHostInputs.emplace_back();
+            continue;
+        }
+        const auto type = first.getBindingDataType(b);
+        generateRandom(mSlots[0].firstPointers[b], type, mFirstBytes[b] / dataTypeSize(type), b, mStream->get());
+        mHostInputs.emplace_back(new TrtHostBuffer(mFirstBytes[b]));
+        cudaCheck(cudaMemcpyAsync(mHostInputs[b]->get(), mSlots[0].firstPointers[b], mFirstBytes[b],
+            cudaMemcpyDeviceToHost, mStream->get()));
+    }
+    mStream->synchronize();
+    return true;
+}
+
+void Cascade::issueFirst(Slot& slot)
+{
+    auto& stream = *mStream;
+    slot.inStart->record(stream);
+    for (size_t b = 0; b < mHostInputs.size(); ++b)
+    {
+        if (mHostInputs[b])
+        {
+            cudaCheck(cudaMemcpyAsync(slot.firstPointers[b], mHostInputs[b]->get(), mFirstBytes[b],
+                cudaMemcpyHostToDevice, stream.get()));
+        }
+    }
+    slot.inEnd->record(stream);
+
+    slot.firstStart->record(stream);
+    if (mBatch)
+    {
+        mFirst->enqueue(mBatch, slot.firstPointers.data(), stream.get(), nullptr);
+    }
+    else
+    {
+        mFirst->enqueueV2(slot.firstPointers.data(), stream.get(), nullptr);
+    }
+    slot.firstEnd->record(stream);
+
+    auto* indices = static_cast<int*>(slot.indices.get());
+    auto* count = static_cast<int*>(slot.count.get());
+    compactPositives(static_cast<const float*>(slot.firstPointers[mScore]), mItems, mThreshold, indices, count,
+        stream.get());
+    for (const auto& link : mLinks)
+    {
+        gatherRows(slot.firstPointers[link.source], slot.secondPointers[link.input], link.rowBytes, indices, count,
+            mItems, stream.get());
+    }
+    cudaCheck(cudaMemcpyAsync(slot.hostCount.get(), count, sizeof(int), cudaMemcpyDeviceToHost, stream.get()));
+    slot.compactEnd->record(stream);
+}
+
+void Cascade::issueSecond(Slot& slot)
+{
+    auto& stream = *mStream;
+    slot.compactEnd->synchronize();
+    slot.positives = *static_cast<const int*>(slot.hostCount.get());
+
+    // The rows past the positives up to the smallest batch of the profile run on stale items, and are not copied out
+    const int rows = std::max(slot.positives, mMinRows);
+    for (const auto& link : mLinks)
+    {
+        auto dims = mSecondDims[link.input];
+        dims.d[0] = rows;
+        mSecond->setBindingDimensions(link.input, dims);
+    }
+    slot.secondStart->record(stream);
+    if (slot.positives)
+    {
+        mSecond->enqueueV2(slot.secondPointers.data(), stream.get(), nullptr);
+    }
+    slot.secondEnd->record(stream);
+    for (size_t b = 0; b < slot.outputs.size(); ++b)
+    {
+        if (slot.outputs[b] && slot.positives)
+        {
+            cudaCheck(cudaMemcpyAsync(slot.outputs[b]->get(), slot.secondPointers[b], mSecondRows[b] * slot.positives,
+                cudaMemcpyDeviceToHost, stream.get()));
+        }
+    }
+    cudaCheck(cudaMemcpyAsync(slot.hostIndices.get(), slot.indices.get(), slot.positives * sizeof(int),
+        cudaMemcpyDeviceToHost, stream.get()));
+    slot.outEnd->record(stream);
+}
+
+float Cascade::collect(const Slot& slot, std::vector<InferenceTrace>& trace, std::vector<CascadeTrace>& cascadeTrace)
+{
+    slot.outEnd->synchronize();
+    const auto& base = *mBase;
+    CascadeTrace t;
+    t.positives = slot.positives;
+    t.firstStart = *slot.firstStart - base;
+    t.firstEnd = *slot.firstEnd - base;
+    t.compactEnd = *slot.compactEnd - base;
+    t.secondStart = *slot.secondStart - base;
+    t.secondEnd = *slot.secondEnd - base;
+    cascadeTrace.push_back(t);
+    const float outEnd = *slot.outEnd - base;
+    trace.emplace_back(0, *slot.inStart - base, *slot.inEnd - base, t.firstStart, t.secondEnd, t.secondEnd, outEnd);
+    return outEnd;
+}
+
+void Cascade::run(
+    const InferenceOptions& inference, std::vector<InferenceTrace>& trace, std::vector<CascadeTrace>& cascadeTrace)
+{
+    mBase->record(*mStream);
+    const float warmupMs = static_cast<float>(inference.warmup);
+    const float maxDurationMs = inference.duration * 1000.F + warmupMs;
+    int counted{0};
+    float durationMs{0};
+    int issued{0};
+    int collected{0};
+    while (counted < inference.iterations || durationMs < maxDurationMs)
+    {
+        if (issued >= kSLOTS)
+        {
+            durationMs = collect(mSlots[collected % kSLOTS], trace, cascadeTrace);
+            ++collected;
+            if (durationMs > warmupMs)
+            {
+                ++counted;
+            }
+        }
+        issueFirst(mSlots[issued % kSLOTS]);
+        if (issued)
+        {
+            issueSecond(mSlots[(issued - 1) % kSLOTS]);
+        }
+        ++issued;
+    }
+    issueSecond(mSlots[(issued - 1) % kSLOTS]);
+    for (; collected < issued; ++collected)
+    {
+        collect(mSlots[collected % kSLOTS], trace, cascadeTrace);
+    }
+}
+
+void printCascadeReport(const std::vector<CascadeTrace>& cascadeTrace, int items, float warmupMs, std::ostream& os)
+{
+    int batches{0};
+    long long positives{0};
+    int minPositives{items};
+    int maxPositives{0};
+    float first{0};
+    float compact{0};
+    float second{0};
+    for (const auto& t : cascadeTrace)
+    {
+        if (t.firstStart < warmupMs)
+        {
+            continue;
+        }
+        ++batches;
+        positives += t.positives;
+        minPositives = std::min(minPositives, t.positives);
+        maxPositives = std::max(maxPositives, t.positives);
+        first += t.firstEnd - t.firstStart;
+        compact += t.compactEnd - t.firstEnd;
+        second += t.secondEnd - t.secondStart;
+    }
+    const float n = std::max(batches, 1);
+    const float meanPositives = positives / n;
+
+    os << "=== Cascade ===" << std::endl;
+    os << "Batches: " << batches << ", positives: mean " << meanPositives << " of " << items << " items ("
+       << std::fixed << std::setprecision(1) << 100 * meanPositives / std::max(items, 1) << "%)" << std::defaultfloat
+       << std::setprecision(6) << ", min " << (batches ? minPositives : 0) << ", max " << maxPositives << std::endl;
+    os << "First stage: " << first / n << " ms per batch" << std::endl;
+    os << "Compaction: " << compact / n << " ms per batch, with the gather of the rows and the count readback"
+       << std::endl;
+    os << "Second stage: " << second / n << " ms per batch, " << (positives ? second / positives : 0)
+       << " ms per positive" << std::endl;
+}
+
+} // namespace sample
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleCascade.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kWARP{32};
+constexpr int kCOMPACT_THREADS{1024};
+constexpr int kGATHER_THREADS{256};
+constexpr int kMAX_BLOCKS{64};
+constexpr int kMAX_ROWS{65535};
+
+//! One block scans the flags of the items a chunk of blockDim items at a time, keeping the order of the items
+__global__ void __launch_bounds__(kCOMPACT_THREADS) compactPositivesKernel(
+    const float* scores, int items, float threshold, int* indices, int* count)
+{
+    __shared__ int warpTotals[kCOMPACT_THREADS / kWARP];
+    __shared__ int base;
+    const int lane = threadIdx.x % kWARP;
+    const int warp = threadIdx.x / kWARP;
+    if (threadIdx.x == 0)
+    {
+        base = 0;
+    }
+    __syncthreads();
+    for (int start = 0; start < items; start += blockDim.x)
+    {
+        const int i = start + threadIdx.x;
+        // NaN scores are not positive
+        const bool positive = i < items && scores[i] > threshold;
+        const unsigned int ballot = __ballot_sync(0xffffffff, positive);
+        const int rank = __popc(ballot & ((1U << lane) - 1));
+        if (lane == 0)
+        {
+            warpTotals[warp] = __popc(ballot);
+        }
+        __syncthreads();
+        int offset = base;
+        for (int w = 0; w < warp; ++w)
+        {
+            offset += warpTotals[w];
+        }
+        if (positive)
+        {
+            indices[offset + rank] = i;
+        }
+        __syncthreads();
+        if (threadIdx.x == blockDim.x - 1)
+        {
+            base = offset + rank + positive;
+        }
+        __syncthreads();
+    }
+    if (threadIdx.x == 0)
+    {
+        *count = base;
+    }
+}
+
+//! One row of blocks per destination row, copying 16 bytes per thread when the buffers and the rows allow it
+__global__ void gatherRowsKernel(
+    const void* source, void* destination, size_t rowBytes, const int* indices, const int* count)
+{
+    const size_t start = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x;
+    const size_t stride = static_cast<size_t>(gridDim.x) * blockDim.x;
+    const auto aligned = [](size_t v) { return v % sizeof(uint4) == 0; };
+    const bool vectorized = aligned(reinterpret_cast<uintptr_t>(source))
+        && aligned(reinterpret_cast<uintptr_t>(destination)) && aligned(rowBytes);
+    for (int row = blockIdx.y; row < *count; row += gridDim.y)
+    {
+        const auto* from = static_cast<const unsigned char*>(source) + indices[row] * rowBytes;
+        auto* to = static_cast<unsigned char*>(destination) + row * rowBytes;
+        if (vectorized)
+        {
+            for (size_t i = start; i < rowBytes / sizeof(uint4); i += stride)
+            {
+                reinterpret_cast<uint4*>(to)[i] = reinterpret_cast<const uint4*>(from)[i];
+            }
+            continue;
+        }
+        for (size_t i = start; i < rowBytes; i += stride)
+        {
+            to[i] = from[i];
+        }
+    }
+}
+
+} // namespace
+
+void compactPositives(const float* scores, int items, float threshold, int* indices, int* count, cudaStream_t stream)
+{
+    compactPositivesKernel<<<1, kCOMPACT_THREADS, 0, stream>>>(scores, items, threshold, indices, count);
+}
+
+void gatherRows(const void* source, void* destination, size_t rowBytes, const int* indices, const int* count,
+    int maxRows, cudaStream_t stream)
+{
+    if (!maxRows || !rowBytes)
+    {
+        return;
+    }
+    const size_t words = (rowBytes + sizeof(uint4) - 1) / sizeof(uint4);
+    const int blocks = static_cast<int>(std::min<size_t>((words + kGATHER_THREADS - 1) / kGATHER_THREADS, kMAX_BLOCKS));
+    const int rows = std::min(maxRows, kMAX_ROWS);
+    gatherRowsKernel<<<dim3(blocks, rows), kGATHER_THREADS, 0, stream>>>(
+        source, destination, rowBytes, indices, count);
+}
+
+} // namespace sample
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_CASCADE_H
+#define TRT_SAMPLE_CASCADE_H
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include "NvInfer.h"
+
+#include "sampleDevice.h"
+#include "sampleReporting.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+struct InferenceOptions;
+
+//!
+//! \brief Write the indices of the items whose score is above threshold to indices, in increasing order, and their
+//!        number to count, with a single block
+//!
+void compactPositives(const float* scores, int items, float threshold, int* indices, int* count, cudaStream_t stream);
+
+//!
+//! \brief Copy the rows of source listed in the first *count indices to consecutive rows of destination
+//!
+//! \param maxRows The largest count, the rows past count are left as they are
+//!
+void gatherRows(const void* source, void* destination, size_t rowBytes, const int* indices, const int* count,
+    int maxRows, cudaStream_t stream);
+
+//!
+//! \struct CascadeTrace
+//! \brief Measurement points of a batch in the stages of a cascade, in milliseconds from the start of the run
+//!
+struct CascadeTrace
+{
+    int positives{0};
+    float firstStart{0};
+    float firstEnd{0};
+    float compactEnd{0}; //!< Of the compaction, the gather of the rows of the second stage and the count readback
+    float secondStart{0};
+    float secondEnd{0};
+};
+
+//!
+//! \class Cascade
+//! \brief A filter engine run on every item of a batch, and a second engine run only on the items it selects
+//!
+//! The items whose score output of the first stage is above the threshold are compacted on the device: one kernel
+//! lists their indices in order, and another gathers their rows of the first stage tensors that feed the second
+//! stage, inputs such as crops or outputs such as features, into the inputs of the second stage. Only the number of
+//! positives is read back, to set the dynamic batch dimension of the second stage, so its cost follows the positives
+//! instead of the batch. The host does not wait for that count before issuing the first stage of the next batch, so
+//! the device computes while the count is read. The outputs of the second stage and the indices of its items are
+//! copied to the host.
+//!
+class Cascade
+{
+public:
+    Cascade() = default;
+
+    Cascade(const Cascade&) = delete;
+
+    Cascade& operator=(const Cascade&) = delete;
+
+    //!
+    //! \brief Create the contexts, stream, events and buffers of the stages, on the current device
+    //!
+    //! The dynamic inputs of the first stage take the first shapes of --shapes. Each input of the second stage is a
+    //! binding of the first stage with the same name and the same item size, and its first dimension is dynamic and
+    //! takes up to the items of the first stage.
+    //!
+    //! \return False with the reason in err if the engines cannot be chained
+    //!
+    bool setUp(nvinfer1::ICudaEngine& first, nvinfer1::ICudaEngine& second, const InferenceOptions& inference,
+        std::ostream& err);
+
+    //!
+    //! \brief Run batches back to back for the iterations and duration of the inference options
+    //!
+    //! \param trace A query from the inputs copied to the first stage to the outputs copied from the second stage
+    //! \param cascadeTrace The stages and the positives of each batch
+    //!
+    void run(
+        const InferenceOptions& inference, std::vector<InferenceTrace>& trace, std::vector<CascadeTrace>& cascadeTrace);
+
+    //! Items of a batch of the first stage
+    int getItems() const
+    {
+        return mItems;
+    }
+
+private:
+    struct Link
+    {
+        int input;  //!< Binding of the second stage
+        int source; //!< Binding of the first stage
+        size_t rowBytes;
+    };
+
+    struct Slot
+    {
+        std::vector<std::unique_ptr<TrtDeviceBuffer>> first;  //!< By binding of the first stage
+        std::vector<std::unique_ptr<TrtDeviceBuffer>> second; //!< By binding of the second stage
+        std::vector<std::unique_ptr<TrtHostBuffer>> outputs;  //!< By binding of the second stage
+        TrtDeviceBuffer indices;
+        TrtHostBuffer hostIndices;
+        TrtDeviceBuffer count;
+        TrtHostBuffer hostCount;
+        std::vector<void*> firstPointers;
+        std::vector<void*> secondPointers;
+        std::unique_ptr<TrtCudaEvent> inStart;
+        std::unique_ptr<TrtCudaEvent> inEnd;
+        std::unique_ptr<TrtCudaEvent> firstStart;
+        std::unique_ptr<TrtCudaEvent> firstEnd;
+        std::unique_ptr<TrtCudaEvent> compactEnd;
+        std::unique_ptr<TrtCudaEvent> secondStart;
+        std::unique_ptr<TrtCudaEvent> secondEnd;
+        std::unique_ptr<TrtCudaEvent> outEnd;
+        int positives{0};
+    };
+
+    //! Copy the inputs of the slot in, run the first stage, compact the positives and read their count
+    void issueFirst(Slot& slot);
+
+    //! Wait for the count of the slot, run the second stage on its positives and copy their outputs out
+    void issueSecond(Slot& slot);
+
+    //! Wait for the batch of the slot to leave the second stage and add it to the traces
+    float collect(const Slot& slot, std::vector<InferenceTrace>& trace, std::vector<CascadeTrace>& cascadeTrace);
+
+    nvinfer1::ICudaEngine* mFirstEngine{nullptr};
+    nvinfer1::ICudaEngine* mSecondEngine{nullptr};
+    TrtUniquePtr<nvinfer1::IExecutionContext> mFirst;
+    TrtUniquePtr<nvinfer1::IExecutionContext> mSecond;
+    int mBatch{0}; //!< Of an implicit batch first stage, 0 for explicit batch
+    int mItems{0};
+    int mMinRows{1}; //!< Smallest batch of the profile of the second stage
+    int mScore{-1};
+    float mThreshold{0};
+    std::vector<size_t> mFirstBytes;             //!< Of each binding
+    std::vector<size_t> mSecondRows;             //!< Bytes of an item of each binding of the second stage
+    std::vector<nvinfer1::Dims> mSecondDims;     //!< Of the bindings of the second stage, the items first
+    std::vector<Link> mLinks;
+    std::vector<std::unique_ptr<TrtHostBuffer>> mHostInputs; //!< By binding of the first stage
+    std::vector<Slot> mSlots;
+    std::unique_ptr<TrtCudaStream> mStream;
+    std::unique_ptr<TrtCudaEvent> mBase; //!< Start of the run
+};
+
+//!
+//! \brief Print the mean positives of the batches, the time of each stage and of the compaction, and the share of
+//!        the items the second stage ran on
+//!
+void printCascadeReport(const std::vector<CascadeTrace>& cascadeTrace, int items, float warmupMs, std::ostream& os);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_CASCADE_H
@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleCluster.h"
+#include "logger.h"
+#include "sampleOptions.h"
+#include "sampleReporting.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include <cuda_runtime_api.h>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace sample
+{
+
+constexpr int ClusterNode::kCLUSTER_JOIN_SECONDS;
+constexpr int ClusterNode::kCLUSTER_REPORT_SECONDS;
+
+#if defined(__linux__)
+
+namespace
+{
+
+//! The timed inferences of a node, as reported to the coordinator
+struct NodeStats
+{
+    std::string host;
+    std::string device;
+    long long queries{0};
+    float spanMs{0};
+    LatencyHistograms histograms;
+
+    float throughput() const
+    {
+        return spanMs > 0 ? 1000.F * queries / spanMs : 0;
+    }
+};
+
+NodeStats traceToNodeStats(const std::vector<InferenceTrace>& trace, float warmupMs, int queries)
+{
+    NodeStats stats;
+    float start{std::numeric_limits<float>::max()};
+    float end{0};
+    for (const auto& t : trace)
+    {
+        if (t.computeStart >= warmupMs)
+        {
+            // With dynamic batching every trace entry carries its own number of queries
+            stats.queries += static_cast<long long>(t.batch ? t.batch : queries) * t.weight;
+            start = std::min(start, t.inStart);
+            end = std::max(end, t.outEnd);
+        }
+    }
+    stats.spanMs = end > start ? end - start : 0;
+    stats.histograms = traceToHistograms(trace, warmupMs);
+    return stats;
+}
+
+float median(std::vector<float> values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    return n ? (n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2) : 0;
+}
+
+//!
+//! \brief Print the nodes, the merged histograms and the aggregate throughput, and flag the outlier nodes
+//!
+//! A node is slow if its throughput is below the median throughput of the nodes by more than the tolerance, and its
+//! GPU, H2D or D2H is flagged if its median time of that stage exceeds the median of the nodes by more than the
+//! tolerance. With two nodes the median is their mean, so that the slower of the two is the one flagged.
+//!
+void printClusterReport(const std::vector<NodeStats>& nodes, float tolerance, std::ostream& os)
+{
+    std::vector<float> throughputs;
+    std::vector<float> computes;
+    std::vector<float> ins;
+    std::vector<float> outs;
+    LatencyHistograms merged;
+    double throughput{0};
+    for (const auto& n : nodes)
+    {
+        throughputs.push_back(n.throughput());
+        computes.push_back(n.histograms.compute.percentileMs(50));
+        ins.push_back(n.histograms.in.percentileMs(50));
+        outs.push_back(n.histograms.out.percentileMs(50));
+        merged.merge(n.histograms);
+        throughput += n.throughput();
+    }
+    const float medianThroughput = median(throughputs);
+    const float medianCompute = median(computes);
+    const float medianIn = median(ins);
+    const float medianOut = median(outs);
+    const float factor = tolerance / 100;
+    const auto above
+        = [factor](float value, float reference) { return reference > 0 && value > reference * (1 + factor); };
+
+    os << "=== Cluster ===" << std::endl;
+    int outliers{0};
+    for (size_t n = 0; n < nodes.size(); ++n)
+    {
+        const auto& node = nodes[n];
+        std::string flags;
+        if (medianThroughput > 0 && throughputs[n] < medianThroughput * (1 - factor))
+        {
+            flags += " slow";
+        }
+        if (above(computes[n], medianCompute))
+        {
+            flags += " GPU";
+        }
+        if (above(ins[n], medianIn))
+        {
+            flags += " H2D";
+        }
+        if (above(outs[n], medianOut))
+        {
+            flags += " D2H";
+        }
+        outliers += !flags.empty();
+        os << "Node " << n << " " << node.host << " (" << node.device << "): " << throughputs[n]
+           << " qps, GPU Compute p50 " << computes[n] << " ms, H2D p50 " << ins[n] << " ms, D2H p50 " << outs[n]
+           << " ms, end to end p99 " << node.histograms.e2e.percentileMs(99) << " ms"
+           << (flags.empty() ? "" : ", outlier:" + flags) << std::endl;
+    }
+    os << "Cluster throughput: " << throughput << " qps over " << nodes.size() << " nodes, median node "
+       << medianThroughput << " qps" << std::endl;
+    if (outliers)
+    {
+        os << "Cluster outliers: " << outliers << " nodes more than " << tolerance << "% from the median" << std::endl;
+    }
+    printHistograms(merged, os);
+}
+
+//! Read size bytes, waiting up to timeoutMs for each part, or forever if negative
+bool receiveAll(int fd, void* data, size_t size, int timeoutMs)
+{
+    char* p = static_cast<char*>(data);
+    while (size)
+    {
+        pollfd ready{fd, POLLIN, 0};
+        const int polled = poll(&ready, 1, timeoutMs);
+        if (polled < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (polled <= 0)
+        {
+            return false;
+        }
+        const ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendAll(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size)
+    {
+        // A node gone before its message must not raise SIGPIPE
+        const ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendMessage(int fd, ClusterMessageType type, const std::string& text)
+{
+    ClusterMessage header;
+    header.magic = htonl(kCLUSTER_MAGIC);
+    header.type = htonl(static_cast<uint32_t>(type));
+    header.size = htonl(static_cast<uint32_t>(text.size()));
+    return sendAll(fd, &header, sizeof(header)) && sendAll(fd, text.data(), text.size());
+}
+
+bool receiveMessage(int fd, ClusterMessageType& type, std::string& text, int timeoutMs)
+{
+    ClusterMessage header;
+    if (!receiveAll(fd, &header, sizeof(header), timeoutMs) || ntohl(header.magic) != kCLUSTER_MAGIC)
+    {
+        return false;
+    }
+    type = static_cast<ClusterMessageType>(ntohl(header.type));
+    text.resize(ntohl(header.size));
+    return text.empty() || receiveAll(fd, &text[0], text.size(), timeoutMs);
+}
+
+void closeSocket(int& fd)
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void setNoDelay(int fd)
+{
+    // The start message is a handful of bytes that must not wait for more
+    const int on{1};
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+} // namespace
+
+#endif
+
+ClusterNode::ClusterNode(const InferenceOptions& inference)
+    : mInference(inference)
+{
+    // Every node must run the same options, only the part each node has in the cluster differs
+    InferenceOptions shared = inference;
+    shared.clusterNodes = 0;
+    shared.joinCluster.clear();
+    shared.clusterPort = 0;
+    shared.clusterOutlier = 0;
+    std::ostringstream options;
+    options << shared;
+    mOptions = options.str();
+
+#if defined(__linux__)
+    char host[256]{};
+    gethostname(host, sizeof(host) - 1);
+    mHost = host;
+#endif
+    int device{0};
+    cudaDeviceProp properties{};
+    if (cudaGetDevice(&device) == cudaSuccess && cudaGetDeviceProperties(&properties, device) == cudaSuccess)
+    {
+        mDevice = properties.name;
+    }
+}
+
+ClusterNode::~ClusterNode()
+{
+#if defined(__linux__)
+    closeSocket(mCoordinator);
+    for (auto& p : mPeers)
+    {
+        closeSocket(p.fd);
+    }
+#endif
+}
+
+#if defined(__linux__)
+
+bool ClusterNode::synchronize()
+{
+    return mInference.clusterNodes ? coordinate() : join();
+}
+
+bool ClusterNode::coordinate()
+{
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(mInference.clusterPort));
+    const int on{1};
+    if (listener < 0 || setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on))
+        || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) || listen(listener, SOMAXCONN))
+    {
+        gLogError << "Could not listen on port " << mInference.clusterPort << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0)
+        {
+            ::close(listener);
+        }
+        return false;
+    }
+    gLogInfo << "Cluster: waiting for " << mInference.clusterNodes - 1 << " nodes on port " << mInference.clusterPort
+             << std::endl;
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(kCLUSTER_JOIN_SECONDS);
+    const auto remainingMs = [&deadline]()
+    {
+        const auto left
+            = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        return static_cast<int>(std::max<long long>(left.count(), 0));
+    };
+    bool joined{true};
+    while (joined && static_cast<int>(mPeers.size()) < mInference.clusterNodes - 1)
+    {
+        pollfd ready{listener, POLLIN, 0};
+        const int polled = poll(&ready, 1, remainingMs());
+        if (polled < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (polled <= 0)
+        {
+            gLogError << "Cluster: " << mPeers.size() << " of " << mInference.clusterNodes - 1 << " nodes joined in "
+                      << kCLUSTER_JOIN_SECONDS << " s" << std::endl;
+            joined = false;
+            break;
+        }
+        Peer peer;
+        peer.fd = accept(listener, nullptr, nullptr);
+        if (peer.fd < 0)
+        {
+            continue;
+        }
+        setNoDelay(peer.fd);
+        ClusterMessageType type{};
+        std::string text;
+        if (!receiveMessage(peer.fd, type, text, remainingMs()) || type != ClusterMessageType::kJOIN)
+        {
+            gLogWarning << "Cluster: a connection closed before joining" << std::endl;
+            closeSocket(peer.fd);
+            continue;
+        }
+        std::istringstream join(text);
+        std::getline(join, peer.host);
+        std::getline(join, peer.device);
+        const std::string options{std::istreambuf_iterator<char>(join), std::istreambuf_iterator<char>()};
+        mPeers.push_back(peer);
+        if (options != mOptions)
+        {
+            gLogError << "Cluster: node " << peer.host << " runs other inference options:" << std::endl
+                      << options << std::endl;
+            joined = false;
+            break;
+        }
+        gLogInfo << "Cluster: node " << mPeers.size() << " " << peer.host << " (" << peer.device << ") joined"
+                 << std::endl;
+    }
+    ::close(listener);
+    if (!joined)
+    {
+        abort("The nodes of the cluster did not all join with the inference options of the coordinator");
+        return false;
+    }
+    for (const auto& p : mPeers)
+    {
+        if (!sendMessage(p.fd, ClusterMessageType::kSTART, ""))
+        {
+            gLogError << "Cluster: node " << p.host << " left before the start" << std::endl;
+            abort("A node left before the start");
+            return false;
+        }
+    }
+    gLogInfo << "Cluster: started " << mInference.clusterNodes << " nodes" << std::endl;
+    return true;
+}
+
+bool ClusterNode::join()
+{
+    const size_t colon = mInference.joinCluster.rfind(':');
+    const std::string host = mInference.joinCluster.substr(0, colon);
+    const std::string port = colon == std::string::npos ? std::to_string(mInference.clusterPort)
+                                                        : mInference.joinCluster.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    // The coordinator may still be building or loading its engine
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(kCLUSTER_JOIN_SECONDS);
+    while (mCoordinator < 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        addrinfo* addresses{nullptr};
+        if (!getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses))
+        {
+            for (addrinfo* a = addresses; a && mCoordinator < 0; a = a->ai_next)
+            {
+                mCoordinator = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (mCoordinator >= 0 && connect(mCoordinator, a->ai_addr, a->ai_addrlen))
+                {
+                    closeSocket(mCoordinator);
+                }
+            }
+            freeaddrinfo(addresses);
+        }
+        if (mCoordinator < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+        }
+    }
+    if (mCoordinator < 0)
+    {
+        gLogError << "Cluster: could not connect to the coordinator " << mInference.joinCluster << " in "
+                  << kCLUSTER_JOIN_SECONDS << " s" << std::endl;
+        return false;
+    }
+    setNoDelay(mCoordinator);
+    if (!sendMessage(mCoordinator, ClusterMessageType::kJOIN, mHost + "\n" + mDevice + "\n" + mOptions))
+    {
+        gLogError << "Cluster: the coordinator " << mInference.joinCluster << " closed the connection" << std::endl;
+        return false;
+    }
+    gLogInfo << "Cluster: joined " << mInference.joinCluster << ", waiting for the start" << std::endl;
+
+    // The other nodes may take as long to join
+    ClusterMessageType type{};
+    std::string text;
+    if (!receiveMessage(mCoordinator, type, text, kCLUSTER_JOIN_SECONDS * 1000) || type != ClusterMessageType::kSTART)
+    {
+        gLogError << "Cluster: the coordinator did not start the run"
+                  << (type == ClusterMessageType::kABORT ? ": " + text : std::string()) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ClusterNode::abort(const std::string& reason)
+{
+    for (auto& p : mPeers)
+    {
+        sendMessage(p.fd, ClusterMessageType::kABORT, reason);
+        closeSocket(p.fd);
+    }
+    mPeers.clear();
+}
+
+bool ClusterNode::report(const std::vector<InferenceTrace>& trace, float warmupMs, int queries, std::ostream& os)
+{
+    NodeStats local = traceToNodeStats(trace, warmupMs, queries);
+    if (mCoordinator >= 0)
+    {
+        std::ostringstream text;
+        text << local.queries << " " << local.spanMs << std::endl;
+        writeHistograms(local.histograms, text);
+        if (!sendMessage(mCoordinator, ClusterMessageType::kREPORT, text.str()))
+        {
+            gLogError << "Cluster: could not report to the coordinator" << std::endl;
+            return false;
+        }
+        gLogInfo << "Cluster: reported to " << mInference.joinCluster << std::endl;
+        return true;
+    }
+
+    local.host = mHost;
+    local.device = mDevice;
+    std::vector<NodeStats> nodes{local};
+    bool complete{true};
+    // The nodes run for as long as the coordinator, apart from the start skew and their own warm up
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(kCLUSTER_REPORT_SECONDS);
+    const auto remainingMs = [&deadline]()
+    {
+        const auto left
+            = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        return static_cast<int>(std::max<long long>(left.count(), 0));
+    };
+    for (auto& p : mPeers)
+    {
+        ClusterMessageType type{};
+        std::string text;
+        NodeStats node;
+        node.host = p.host;
+        node.device = p.device;
+        std::istringstream is;
+        bool received = receiveMessage(p.fd, type, text, remainingMs()) && type == ClusterMessageType::kREPORT;
+        if (received)
+        {
+            is.str(text);
+            received = static_cast<bool>(is >> node.queries >> node.spanMs);
+            is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            received = received && readHistograms(is, node.histograms);
+        }
+        if (!received)
+        {
+            gLogError << "Cluster: no report from node " << p.host << " (" << p.device << ") within "
+                      << kCLUSTER_REPORT_SECONDS << " s of the end of the run" << std::endl;
+            complete = false;
+            continue;
+        }
+        nodes.push_back(node);
+        closeSocket(p.fd);
+    }
+    printClusterReport(nodes, mInference.clusterOutlier, os);
+    return complete;
+}
+
+#else
+
+bool ClusterNode::synchronize()
+{
+    gLogError << "Cluster runs (--clusterNodes, --joinCluster) require POSIX sockets" << std::endl;
+    return false;
+}
+
+bool ClusterNode::coordinate()
+{
+    return false;
+}
+
+bool ClusterNode::join()
+{
+    return false;
+}
+
+void ClusterNode::abort(const std::string&) {}
+
+bool ClusterNode::report(const std::vector<InferenceTrace>&, float, int, std::ostream&)
+{
+    return false;
+}
+
+#endif
+
+} // namespace sample
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_CLUSTER_H
+#define TRT_SAMPLE_CLUSTER_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace sample
+{
+
+struct InferenceOptions;
+struct InferenceTrace;
+
+//!
+//! Protocol between the nodes of a cluster run and their coordinator, over TCP
+//!
+//! Each message is a header in network byte order followed by size bytes of text. A node joins with its host, its
+//! device and its inference options, one per line, the options last. Once all the nodes have joined with the options
+//! of the coordinator, the coordinator sends a start to all of them. After the run each node sends a report, its
+//! queries and the span of its timed inferences in milliseconds on a line, followed by its latency histograms as
+//! written by writeHistograms(). An abort carries the reason the coordinator rejected a node or gave up.
+//!
+constexpr uint32_t kCLUSTER_MAGIC{0x43545254}; // "TRTC"
+
+enum class ClusterMessageType : uint32_t
+{
+    kJOIN = 0,
+    kSTART = 1,
+    kREPORT = 2,
+    kABORT = 3,
+};
+
+struct ClusterMessage
+{
+    uint32_t magic{kCLUSTER_MAGIC};
+    uint32_t type{0};
+    uint32_t size{0};
+};
+
+//!
+//! \class ClusterNode
+//! \brief One trtexec process of a benchmark run on several machines at once
+//!
+//! The coordinator, itself a node, listens for the other nodes, and every node runs the same inference options from
+//! the same start. The coordinator merges the histograms of all the nodes, sums their throughputs and flags the nodes
+//! whose throughput, compute or transfer times stray from the median of the nodes by more than the outlier tolerance.
+//!
+class ClusterNode
+{
+public:
+    explicit ClusterNode(const InferenceOptions& inference);
+
+    ~ClusterNode();
+
+    ClusterNode(const ClusterNode&) = delete;
+
+    ClusterNode& operator=(const ClusterNode&) = delete;
+
+    //!
+    //! \brief Wait until all the nodes have joined with the same inference options and the coordinator has started
+    //!        them
+    //!
+    //! The coordinator waits for the nodes, the nodes retry connecting until the coordinator listens, each for up to
+    //! kCLUSTER_JOIN_SECONDS. The nodes start within a network round trip of each other.
+    //!
+    //! \return False if a node has other options, a connection failed, or the platform has no sockets
+    //!
+    bool synchronize();
+
+    //!
+    //! \brief Send the timed inferences of the trace to the coordinator, or on the coordinator gather the reports of
+    //!        the nodes and print the cluster report
+    //!
+    //! The coordinator waits up to kCLUSTER_REPORT_SECONDS past the end of its own run for the reports of all the
+    //! nodes.
+    //!
+    //! \return False if a report could not be sent, or on the coordinator if a node did not report in time
+    //!
+    bool report(const std::vector<InferenceTrace>& trace, float warmupMs, int queries, std::ostream& os);
+
+    static constexpr int kCLUSTER_JOIN_SECONDS{600};
+    static constexpr int kCLUSTER_REPORT_SECONDS{600};
+
+private:
+    struct Peer
+    {
+        int fd{-1};
+        std::string host;
+        std::string device;
+    };
+
+    bool coordinate();
+
+    bool join();
+
+    void abort(const std::string& reason);
+
+    const InferenceOptions& mInference;
+    std::string mOptions; //!< The inference options, without those of the cluster, that all the nodes must share
+    std::string mHost;
+    std::string mDevice;
+    int mCoordinator{-1}; //!< Connection of a node to the coordinator
+    std::vector<Peer> mPeers; //!< Connections of the coordinator to the nodes
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_CLUSTER_H
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "logger.h"
+#include "sampleContextPool.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//! Yields before a waiting checkout sleeps between its polls of the free stack
+constexpr int kWAIT_SPINS{64};
+constexpr int kWAIT_SLEEP_US{20};
+
+constexpr uint64_t kSLOT_MASK{0xFFFFFFFFULL};
+
+} // namespace
+
+std::ostream& operator<<(std::ostream& os, const ContextPoolStats& stats)
+{
+    os << "Context pool: " << stats.contexts << " contexts, " << stats.checkouts << " checkouts, " << stats.waits
+       << " waited, mean wait " << stats.meanWaitMs << " ms, max wait " << stats.maxWaitMs << " ms";
+    return os;
+}
+
+ContextPool::ContextPool(nvinfer1::ICudaEngine& engine, int maxContexts, SetUp setUp, int contexts)
+    : mEngine(engine)
+    , mSetUp(std::move(setUp))
+    , mSlots(std::max(maxContexts, 1))
+{
+    for (int c = 0; c < std::min(contexts, static_cast<int>(mSlots.size())); ++c)
+    {
+        const uint32_t slot = grow();
+        if (!slot)
+        {
+            break;
+        }
+        push(slot - 1);
+    }
+}
+
+ContextPool::Handle ContextPool::acquire()
+{
+    uint32_t slot = pop();
+    if (!slot)
+    {
+        slot = grow();
+    }
+    if (!slot)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        const auto start = clock::now();
+        for (int spin = 0; !(slot = pop()); ++spin)
+        {
+            // No context to wait for if the pool failed to create any
+            if (mFull.load(std::memory_order_acquire) && !size())
+            {
+                return Handle{};
+            }
+            if (spin < kWAIT_SPINS)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(kWAIT_SLEEP_US));
+            }
+        }
+        const uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        mWaits.fetch_add(1, std::memory_order_relaxed);
+        mWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+        uint64_t maxWaitNs = mMaxWaitNs.load(std::memory_order_relaxed);
+        while (waitNs > maxWaitNs && !mMaxWaitNs.compare_exchange_weak(maxWaitNs, waitNs, std::memory_order_relaxed))
+        {
+        }
+    }
+    mCheckouts.fetch_add(1, std::memory_order_relaxed);
+    return Handle(this, slot - 1);
+}
+
+ContextPool::Handle ContextPool::tryAcquire()
+{
+    uint32_t slot = pop();
+    if (!slot)
+    {
+        slot = grow();
+    }
+    if (!slot)
+    {
+        return Handle{};
+    }
+    mCheckouts.fetch_add(1, std::memory_order_relaxed);
+    return Handle(this, slot - 1);
+}
+
+ContextPoolStats ContextPool::getStats() const
+{
+    ContextPoolStats stats;
+    stats.contexts = size();
+    stats.checkouts = mCheckouts.load(std::memory_order_relaxed);
+    stats.waits = mWaits.load(std::memory_order_relaxed);
+    stats.meanWaitMs = stats.waits ? mWaitNs.load(std::memory_order_relaxed) / 1e6F / stats.waits : 0;
+    stats.maxWaitMs = mMaxWaitNs.load(std::memory_order_relaxed) / 1e6F;
+    return stats;
+}
+
+uint32_t ContextPool::pop()
+{
+    uint64_t top = mFree.load(std::memory_order_acquire);
+    while (true)
+    {
+        const uint32_t slot = static_cast<uint32_t>(top & kSLOT_MASK);
+        if (!slot)
+        {
+            return 0;
+        }
+        // Slots are never freed, so reading the next of a slot another thread popped meanwhile is safe, the count
+        // of pushes fails the swap then
+        const uint64_t next = (top & ~kSLOT_MASK) | mSlots[slot - 1]->next.load(std::memory_order_relaxed);
+        if (mFree.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            return slot;
+        }
+    }
+}
+
+void ContextPool::push(uint32_t slot)
+{
+    Slot& pushed = *mSlots[slot];
+    uint64_t top = mFree.load(std::memory_order_relaxed);
+    uint64_t desired{0};
+    do
+    {
+        pushed.next.store(static_cast<uint32_t>(top & kSLOT_MASK), std::memory_order_relaxed);
+        desired = (((top >> 32) + 1) << 32) | (slot + 1);
+    } while (!mFree.compare_exchange_weak(top, desired, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint32_t ContextPool::grow()
+{
+    int reserved = mReserved.load(std::memory_order_relaxed);
+    do
+    {
+        if (mFull.load(std::memory_order_acquire) || reserved >= static_cast<int>(mSlots.size()))
+        {
+            return 0;
+        }
+    } while (!mReserved.compare_exchange_weak(reserved, reserved + 1, std::memory_order_relaxed));
+
+    std::unique_ptr<Slot> slot(new Slot);
+    slot->context.reset(mEngine.createExecutionContext());
+    if (!slot->context || !mSetUp(*slot->context, slot->bindings))
+    {
+        // Most likely out of device memory or of optimization profiles, neither comes back for the next context
+        if (!mFull.exchange(true, std::memory_order_acq_rel))
+        {
+            gLogWarning << "Context pool stops growing at " << size() << " contexts, context " << reserved + 1
+                        << " could not be set up" << std::endl;
+        }
+        return 0;
+    }
+    mSlots[reserved] = std::move(slot);
+    mCreated.fetch_add(1, std::memory_order_release);
+    return static_cast<uint32_t>(reserved) + 1;
+}
+
+} // namespace sample
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_CONTEXT_POOL_H
+#define TRT_SAMPLE_CONTEXT_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "NvInfer.h"
+
+#include "sampleDevice.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+struct ContextPoolStats
+{
+    int contexts{0};
+    uint64_t checkouts{0};
+    uint64_t waits{0}; //!< Checkouts that found no free context and could not create one
+    float meanWaitMs{0};
+    float maxWaitMs{0};
+};
+
+std::ostream& operator<<(std::ostream& os, const ContextPoolStats& stats);
+
+//!
+//! \class ContextPool
+//! \brief Execution contexts of a shared engine, with their bindings and streams, checked out by any thread
+//!
+//! A checkout pops a free context from a lock-free stack, so threads that share a few contexts never contend on a
+//! mutex. When no context is free the pool creates one, up to its limit, and stops growing at the first context it
+//! fails to create, such as when the device is out of memory. Past that a checkout spins until a context is released.
+//!
+//! The work enqueued on the stream of a context keeps running after its handle is released, the next holder orders
+//! its work after it by enqueueing on the same stream. All the handles must be released before the pool is destroyed.
+//!
+class ContextPool
+{
+    struct Slot
+    {
+        TrtUniquePtr<nvinfer1::IExecutionContext> context;
+        Bindings bindings;
+        TrtCudaStream stream;
+        std::atomic<uint32_t> next{0}; //!< Index plus one of the slot below on the free stack, 0 for none
+    };
+
+public:
+    //!
+    //! \brief Allocates the bindings of a new context and sets its profile and input shapes
+    //!
+    using SetUp = std::function<bool(nvinfer1::IExecutionContext& context, Bindings& bindings)>;
+
+    //!
+    //! \class Handle
+    //! \brief A checked out context, released to the pool when the handle is destroyed
+    //!
+    class Handle
+    {
+    public:
+        Handle() = default;
+
+        Handle(ContextPool* pool, uint32_t slot)
+            : mPool(pool)
+            , mSlot(slot)
+        {
+        }
+
+        Handle(Handle&& other)
+            : mPool(other.mPool)
+            , mSlot(other.mSlot)
+        {
+            other.mPool = nullptr;
+        }
+
+        Handle& operator=(Handle&& other)
+        {
+            if (this != &other)
+            {
+                release();
+                mPool = other.mPool;
+                mSlot = other.mSlot;
+                other.mPool = nullptr;
+            }
+            return *this;
+        }
+
+        Handle(const Handle&) = delete;
+
+        Handle& operator=(const Handle&) = delete;
+
+        ~Handle()
+        {
+            release();
+        }
+
+        explicit operator bool() const
+        {
+            return mPool != nullptr;
+        }
+
+        nvinfer1::IExecutionContext& context() const
+        {
+            return *slot().context;
+        }
+
+        Bindings& bindings() const
+        {
+            return slot().bindings;
+        }
+
+        TrtCudaStream& stream() const
+        {
+            return slot().stream;
+        }
+
+        void release()
+        {
+            if (mPool)
+            {
+                mPool->push(mSlot);
+                mPool = nullptr;
+            }
+        }
+
+    private:
+        Slot& slot() const
+        {
+            return *mPool->mSlots[mSlot];
+        }
+
+        ContextPool* mPool{nullptr};
+        uint32_t mSlot{0};
+    };
+
+    //!
+    //! \param maxContexts Limit on the contexts the pool creates
+    //! \param contexts Contexts created upfront, the others are created at the checkouts that need them
+    //!
+    ContextPool(nvinfer1::ICudaEngine& engine, int maxContexts, SetUp setUp, int contexts = 1);
+
+    ContextPool(const ContextPool&) = delete;
+
+    ContextPool& operator=(const ContextPool&) = delete;
+
+    //!
+    //! \brief Check out a context, waiting for one if the pool cannot grow
+    //!
+    //! \return An empty handle if the pool holds no context and cannot create one
+    //!
+    Handle acquire();
+
+    //!
+    //! \brief Check out a free context or one created on the spot, without waiting
+    //!
+    Handle tryAcquire();
+
+    //! The contexts created so far
+    int size() const
+    {
+        return mCreated.load(std::memory_order_acquire);
+    }
+
+    ContextPoolStats getStats() const;
+
+private:
+    //! \return The index plus one of a free slot, 0 if none
+    uint32_t pop();
+
+    void push(uint32_t slot);
+
+    //! \return The index plus one of a new slot, 0 if the pool cannot grow
+    uint32_t grow();
+
+    nvinfer1::ICudaEngine& mEngine;
+    SetUp mSetUp;
+    // Sized to the limit upfront, each slot is written once before it is first pushed on the free stack
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    //! Top of the free stack, the index plus one of its slot in the low half and a count of the pushes in the high
+    //! half, which keeps a pop from swapping in a stale top after the slot was popped and pushed again
+    std::atomic<uint64_t> mFree{0};
+    std::atomic<int> mReserved{0}; //!< Slots claimed by the contexts created or being created
+    std::atomic<int> mCreated{0};
+    std::atomic<bool> mFull{false};
+    std::atomic<uint64_t> mCheckouts{0};
+    std::atomic<uint64_t> mWaits{0};
+    std::atomic<uint64_t> mWaitNs{0};
+    std::atomic<uint64_t> mMaxWaitNs{0};
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_CONTEXT_POOL_H
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#include "sampleConvergence.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//! Latency percentile whose confidence interval is checked, the tail the CI perf runs gate on
+constexpr float kPERCENTILE{0.99F};
+
+//! Quantile of the normal distribution for 95% confidence
+constexpr double kZ95{1.959964};
+
+//! Windows the means of the measurement need, fewer give too rough an estimate of their variance
+constexpr int kMIN_WINDOWS{10};
+
+//! Quantile of Student's t distribution for 95% confidence and the given degrees of freedom
+double studentT95(int dof)
+{
+    static const double kT95[]{12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179,
+        2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052,
+        2.048, 2.045, 2.042};
+    constexpr int kTABLE = sizeof(kT95) / sizeof(kT95[0]);
+    return dof < 1 ? std::numeric_limits<double>::infinity() : dof <= kTABLE ? kT95[dof - 1] : kZ95;
+}
+
+//! Half width of the 95% confidence interval of the mean of values, relative to the mean
+float relativeHalfWidth(const std::vector<double>& values)
+{
+    const int n = static_cast<int>(values.size());
+    double mean{0};
+    for (const auto v : values)
+    {
+        mean += v;
+    }
+    mean /= n;
+    double variance{0};
+    for (const auto v : values)
+    {
+        variance += (v - mean) * (v - mean);
+    }
+    variance /= std::max(n - 1, 1);
+    return mean > 0 ? static_cast<float>(studentT95(n - 1) * std::sqrt(variance / n) / mean) : 0;
+}
+
+float latency(const InferenceTrace& t)
+{
+    return traceToTiming(t).latency();
+}
+
+} // namespace
+
+bool ConvergenceMonitor::steady(const std::vector<InferenceTrace>& trace) const
+{
+    if (trace.size() < 2 * static_cast<size_t>(mWindow))
+    {
+        return false;
+    }
+    double latencies[2]{0, 0};
+    double computes[2]{0, 0};
+    const size_t first = trace.size() - 2 * mWindow;
+    for (size_t i = first; i < trace.size(); ++i)
+    {
+        const int w = (i - first) < static_cast<size_t>(mWindow) ? 0 : 1;
+        latencies[w] += latency(trace[i]);
+        computes[w] += trace[i].computeEnd - trace[i].computeStart;
+    }
+    const auto within = [this](double previous, double last) {
+        return previous > 0 && std::abs(last - previous) <= mDrift * previous;
+    };
+    return within(latencies[0], latencies[1]) && within(computes[0], computes[1]);
+}
+
+bool ConvergenceMonitor::converged(
+    const std::vector<InferenceTrace>& trace, size_t first, int queries, ConvergenceStats& stats) const
+{
+    const size_t n = trace.size() - first;
+    const int windows = static_cast<int>(n / mWindow);
+    stats.queries = static_cast<int>(n);
+    if (windows < kMIN_WINDOWS)
+    {
+        const float unknown = std::numeric_limits<float>::infinity();
+        stats.meanWidth = stats.percentileWidth = stats.throughputWidth = unknown;
+        return false;
+    }
+
+    // Means of the latency and throughputs of the windows, a window spans from the last completion of the previous
+    std::vector<double> means;
+    std::vector<double> throughputs;
+    float end = trace[first].inStart;
+    for (int w = 0; w < windows; ++w)
+    {
+        double sum{0};
+        float windowEnd = end;
+        for (size_t i = first + w * mWindow; i < first + (w + 1) * mWindow; ++i)
+        {
+            sum += latency(trace[i]);
+            windowEnd = std::max(windowEnd, trace[i].outEnd);
+        }
+        means.push_back(sum / mWindow);
+        if (windowEnd > end)
+        {
+            throughputs.push_back(1000.0 * mWindow * queries / (windowEnd - end));
+        }
+        end = windowEnd;
+    }
+    stats.meanWidth = 100 * relativeHalfWidth(means);
+    stats.throughputWidth = throughputs.size() > 1 ? 100 * relativeHalfWidth(throughputs)
+                                                   : std::numeric_limits<float>::infinity();
+
+    // The ranks around the percentile between which it lies with 95% confidence, from the binomial distribution of
+    // the number of latencies under it
+    std::vector<float> latencies;
+    latencies.reserve(n);
+    std::transform(trace.begin() + first, trace.end(), std::back_inserter(latencies), latency);
+    std::sort(latencies.begin(), latencies.end());
+    const double rank = kPERCENTILE * n;
+    const double spread = kZ95 * std::sqrt(n * kPERCENTILE * (1 - kPERCENTILE));
+    const long low = static_cast<long>(std::floor(rank - spread));
+    const long high = static_cast<long>(std::ceil(rank + spread));
+    const float estimate = latencies[std::min(static_cast<size_t>(rank), n - 1)];
+    if (low < 0 || high >= static_cast<long>(n) || !(estimate > 0))
+    {
+        stats.percentileWidth = std::numeric_limits<float>::infinity();
+    }
+    else
+    {
+        stats.percentileWidth = 100 * (latencies[high] - latencies[low]) / 2 / estimate;
+    }
+
+    const float width = 100 * mWidth;
+    return stats.meanWidth <= width && stats.percentileWidth <= width && stats.throughputWidth <= width;
+}
+
+} // namespace sample
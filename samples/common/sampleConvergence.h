@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_CONVERGENCE_H
+#define TRT_SAMPLE_CONVERGENCE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "sampleReporting.h"
+
+namespace sample
+{
+
+//!
+//! \class ConvergenceMonitor
+//! \brief Decide from the trace of a run when its warm up reached steady state and when its measurement is precise
+//!        enough
+//!
+//! The trace is cut in windows of consecutive queries. The warm up is steady once the mean host latency and the mean
+//! GPU compute time of the last window are within the drift of those of the window before, the compute time being
+//! where clocks still ramping up show. The measurement is precise once the 95% confidence intervals of the mean
+//! latency, of the latency percentile and of the throughput are narrow enough. The mean and the throughput use the
+//! means of the windows, which are close to independent even though consecutive queries are not. The percentile uses
+//! the distribution-free interval between two order statistics.
+//!
+class ConvergenceMonitor
+{
+public:
+    //!
+    //! \param drift Percent of the mean latency and compute time two steady windows may differ by
+    //! \param width Percent of the estimates the half width of their confidence intervals must be under
+    //! \param window Queries per window
+    //!
+    ConvergenceMonitor(float drift, float width, int window)
+        : mDrift(drift / 100)
+        , mWidth(width / 100)
+        , mWindow(window)
+    {
+    }
+
+    int getWindow() const
+    {
+        return mWindow;
+    }
+
+    //!
+    //! \return True if the last two windows of the trace are within the drift of each other
+    //!
+    bool steady(const std::vector<InferenceTrace>& trace) const;
+
+    //!
+    //! \brief Compute the relative half widths of the confidence intervals of the entries of the trace from first
+    //!
+    //! \return True if all of them are under the width
+    //!
+    bool converged(const std::vector<InferenceTrace>& trace, size_t first, int queries, ConvergenceStats& stats) const;
+
+private:
+    float mDrift{0};
+    float mWidth{0};
+    int mWindow{0};
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_CONVERGENCE_H
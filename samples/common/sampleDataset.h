@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_DATASET_H
+#define TRT_SAMPLE_DATASET_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "PackedDataset.h"
+#include "sampleDevice.h"
+
+namespace sample
+{
+
+//!
+//! \class InputDataset
+//! \brief The samples of one input binding, read from the files of a directory or from a packed binary file
+//!
+//! A directory holds one sample per file, taken in file name order. A packed file holds the samples back to back, its
+//! size must be a multiple of the sample size. A packed dataset file is mapped and its samples are copied from the
+//! mapping, they must all have the sample size.
+//!
+class InputDataset
+{
+public:
+
+    InputDataset(const std::string& path, size_t sampleSize) : mSampleSize(sampleSize)
+    {
+        if (isDirectory(path))
+        {
+            mFiles = listFiles(path);
+            for (const auto& f : mFiles)
+            {
+                if (fileSize(f) != mSampleSize)
+                {
+                    throw std::runtime_error("Input file " + f + " is not " + std::to_string(mSampleSize) + " bytes");
+                }
+            }
+            mCount = mFiles.size();
+        }
+        else if (samplesCommon::PackedDataset::isPacked(path))
+        {
+            mDataset.reset(new samplesCommon::PackedDataset(path));
+            for (size_t s = 0; s < mDataset->size(); ++s)
+            {
+                if (mDataset->sampleSize(s) != mSampleSize)
+                {
+                    throw std::runtime_error("Sample " + std::to_string(s) + " of " + path + " is not "
+                                             + std::to_string(mSampleSize) + " bytes");
+                }
+            }
+            mCount = mDataset->size();
+        }
+        else
+        {
+            const size_t size = fileSize(path);
+            if (size % mSampleSize)
+            {
+                throw std::runtime_error("Input file " + path + " is not made of " + std::to_string(mSampleSize)
+                                         + " byte samples");
+            }
+            mPacked.open(path, std::ios::in | std::ios::binary);
+            mCount = size / mSampleSize;
+        }
+        if (!mCount)
+        {
+            throw std::runtime_error("No input samples in " + path);
+        }
+    }
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    void read(size_t sample, void* dst)
+    {
+        char* data = static_cast<char*>(dst);
+        if (mDataset)
+        {
+            std::memcpy(data, mDataset->sample(sample), mSampleSize);
+        }
+        else if (mFiles.empty())
+        {
+            mPacked.seekg(sample * mSampleSize);
+            mPacked.read(data, mSampleSize);
+        }
+        else
+        {
+            std::ifstream file(mFiles[sample], std::ios::in | std::ios::binary);
+            file.read(data, mSampleSize);
+        }
+    }
+
+private:
+
+    static size_t fileSize(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Cannot open input file " + path);
+        }
+        return static_cast<size_t>(file.tellg());
+    }
+
+#ifdef _MSC_VER
+    static bool isDirectory(const std::string& path)
+    {
+        const DWORD attributes = GetFileAttributesA(path.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+    }
+
+    static std::vector<std::string> listFiles(const std::string& path)
+    {
+        std::vector<std::string> files;
+        WIN32_FIND_DATAA entry;
+        const HANDLE find = FindFirstFileA((path + "\\*").c_str(), &entry);
+        if (find != INVALID_HANDLE_VALUE)
+        {
+            do
+            {
+                if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    files.emplace_back(path + "\\" + entry.cFileName);
+                }
+            } while (FindNextFileA(find, &entry));
+            FindClose(find);
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+#else
+    static bool isDirectory(const std::string& path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    }
+
+    static std::vector<std::string> listFiles(const std::string& path)
+    {
+        std::vector<std::string> files;
+        if (DIR* dir = opendir(path.c_str()))
+        {
+            while (const dirent* entry = readdir(dir))
+            {
+                const std::string file = path + "/" + entry->d_name;
+                if (!isDirectory(file))
+                {
+                    files.push_back(file);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+#endif
+
+    size_t mSampleSize{0};
+    size_t mCount{0};
+    std::vector<std::string> mFiles;
+    std::ifstream mPacked;
+    std::unique_ptr<samplesCommon::PackedDataset> mDataset;
+};
+
+//!
+//! \class InputPrefetcher
+//! \brief Loads the next samples of the input datasets of a stream into a ring of pinned host buffers ahead of use
+//!
+//! A loader thread reads one sample of every dataset into each free slot of the ring. transfer() copies the oldest
+//! slot to the device buffers and releases it, the loader refills it once the copy is done. The datasets cycle
+//! independently, each from the given first sample.
+//!
+class InputPrefetcher
+{
+public:
+
+    struct Input
+    {
+        std::unique_ptr<InputDataset> dataset;
+        void* device;
+        size_t size;
+    };
+
+    InputPrefetcher(std::vector<Input> inputs, int depth, size_t first) : mInputs(std::move(inputs)), mNext(first)
+    {
+        for (int s = 0; s < depth; ++s)
+        {
+            mSlots.emplace_back(new Slot);
+            for (const auto& input : mInputs)
+            {
+                mSlots.back()->buffers.emplace_back(input.size);
+            }
+        }
+        mLoader = std::thread(&InputPrefetcher::load, this);
+    }
+
+    InputPrefetcher(const InputPrefetcher&) = delete;
+
+    InputPrefetcher& operator=(const InputPrefetcher&) = delete;
+
+    ~InputPrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mLoader.join();
+    }
+
+    //!
+    //! \brief Copy the next samples to the device, the first batch/maxBatch of each sample
+    //!
+    void transfer(TrtCudaStream& stream, int batch = 1, int maxBatch = 1)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mLoaded > 0; });
+        Slot& slot = *mSlots[mHead];
+        lock.unlock();
+
+        for (size_t i = 0; i < mInputs.size(); ++i)
+        {
+            cudaCheck(cudaMemcpyAsync(mInputs[i].device, slot.buffers[i].get(), mInputs[i].size / maxBatch * batch,
+                cudaMemcpyHostToDevice, stream.get()));
+        }
+        slot.copied.record(stream);
+        slot.inFlight = true;
+
+        lock.lock();
+        mHead = (mHead + 1) % mSlots.size();
+        --mLoaded;
+        lock.unlock();
+        mCondition.notify_all();
+    }
+
+private:
+
+    struct Slot
+    {
+        std::vector<TrtHostBuffer> buffers;
+        TrtCudaEvent copied;
+        bool inFlight{false};
+    };
+
+    void load()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mCondition.wait(lock, [this] { return mStop || mLoaded < mSlots.size(); });
+            if (mStop)
+            {
+                return;
+            }
+            Slot& slot = *mSlots[(mHead + mLoaded) % mSlots.size()];
+            lock.unlock();
+
+            // The slot is free once the copy of its previous samples is done
+            if (slot.inFlight)
+            {
+                slot.copied.synchronize();
+            }
+            for (size_t i = 0; i < mInputs.size(); ++i)
+            {
+                auto& dataset = *mInputs[i].dataset;
+                dataset.read(mNext % dataset.size(), slot.buffers[i].get());
+            }
+            ++mNext;
+
+            lock.lock();
+            ++mLoaded;
+            mCondition.notify_all();
+        }
+    }
+
+    std::vector<Input> mInputs;
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    size_t mHead{0};
+    size_t mLoaded{0};
+    size_t mNext{0};
+    bool mStop{false};
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::thread mLoader;
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_DATASET_H
@@ -17,9 +17,30 @@
 #ifndef TRT_SAMPLE_DEVICE_H
 #define TRT_SAMPLE_DEVICE_H
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 #include <cuda_runtime.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "NvInferRuntimeCommon.h"
 
 namespace sample
 {
@@ -33,6 +54,123 @@ inline void cudaCheck(cudaError_t ret, std::ostream& err = std::cerr)
     }
 }
 
+//!
+//! \brief Parse a list of CPUs in the format of sysfs and taskset, e.g. "0-3,8,10-11"
+//!
+//! \return The CPUs, empty if the list is malformed
+//!
+inline std::vector<int> parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        int first{-1};
+        int last{-1};
+        char dash{0};
+        std::istringstream bounds(range);
+        if (!(bounds >> first) || first < 0)
+        {
+            return {};
+        }
+        last = first;
+        if (bounds >> dash && (dash != '-' || !(bounds >> last) || last < first))
+        {
+            return {};
+        }
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+//!
+//! \return The sysfs directory of the PCI device of a CUDA device, empty if unknown
+//!
+inline std::string devicePciPath(int device)
+{
+    char busId[32]{};
+    if (cudaDeviceGetPCIBusId(busId, sizeof(busId), device) != cudaSuccess)
+    {
+        return "";
+    }
+    std::string path{"/sys/bus/pci/devices/"};
+    for (const char* c = busId; *c; ++c)
+    {
+        path += static_cast<char>(std::tolower(*c));
+    }
+    return path;
+}
+
+//!
+//! \return The CPUs local to the PCIe root of the device as reported by sysfs, empty if unknown
+//!
+inline std::vector<int> deviceLocalCpus(int device)
+{
+    const std::string path = devicePciPath(device);
+    if (path.empty())
+    {
+        return {};
+    }
+    std::ifstream file(path + "/local_cpulist");
+    std::string list;
+    return std::getline(file, list) ? parseCpuList(list) : std::vector<int>{};
+}
+
+//!
+//! \brief Pin the calling thread to a set of CPUs
+//!
+//! \return False if thread affinity is not supported or none of the CPUs is available to the process
+//!
+inline bool setThreadAffinity(const std::vector<int>& cpus)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return !cpus.empty() && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+//!
+//! \brief Create the context of a device from the calling thread temporarily pinned to a set of CPUs
+//!
+//! The threads the driver starts with the context, which handle completions and host callbacks, inherit the affinity.
+//! The device is left current and the affinity of the calling thread is restored.
+//!
+//! \return False if the calling thread could not be pinned, the context is created anyway
+//!
+inline bool createPinnedContext(int device, const std::vector<int>& cpus)
+{
+#if defined(__linux__)
+    cpu_set_t previous;
+    const bool saved = pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous) == 0;
+    const bool pinned = saved && setThreadAffinity(cpus);
+    cudaCheck(cudaSetDevice(device));
+    cudaCheck(cudaFree(nullptr));
+    if (pinned)
+    {
+        pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+    }
+    return pinned;
+#else
+    cudaCheck(cudaSetDevice(device));
+    cudaCheck(cudaFree(nullptr));
+    return false;
+#endif
+}
+
 class TrtCudaEvent;
 
 namespace
@@ -62,6 +200,14 @@ public:
         cudaCheck(cudaStreamCreate(&mStream));
     }
 
+    //!
+    //! \param priority Lower values are higher priorities, the device clamps the value to its range
+    //!
+    explicit TrtCudaStream(int priority)
+    {
+        cudaCheck(cudaStreamCreateWithPriority(&mStream, cudaStreamDefault, priority));
+    }
+
     TrtCudaStream(const TrtCudaStream&) = delete;
 
     TrtCudaStream& operator=(const TrtCudaStream&) = delete;
@@ -82,6 +228,11 @@ public:
 
     void wait(TrtCudaEvent& event);
 
+    void synchronize()
+    {
+        cudaCheck(cudaStreamSynchronize(mStream));
+    }
+
     void sleep(int* ms)
     {
 #if CUDA_VERSION < 10000
@@ -104,9 +255,13 @@ class TrtCudaEvent
 {
 public:
 
-    explicit TrtCudaEvent(bool blocking = true)
+    //!
+    //! \param timing False for an event only used to synchronize, which is cheaper to record
+    //!
+    explicit TrtCudaEvent(bool blocking = true, bool timing = true)
     {
-        const unsigned int flags = blocking ? cudaEventBlockingSync : cudaEventDefault;
+        const unsigned int flags
+            = (blocking ? cudaEventBlockingSync : cudaEventDefault) | (timing ? 0U : cudaEventDisableTiming);
         cudaCheck(cudaEventCreateWithFlags(&mEvent, flags));
     }
 
@@ -156,6 +311,208 @@ inline void TrtCudaStream::wait(TrtCudaEvent& event)
     cudaCheck(cudaStreamWaitEvent(mStream, event.get(), 0));
 }
 
+//!
+//! \class EventWaiter
+//! \brief Waits for events by blocking, by spinning, or by spinning for a window adapted to the recent waits first
+//!
+//! A hybrid waiter polls cudaEventQuery while the event is expected to complete soon, which avoids the wake up latency
+//! of a blocking sync, then yields and blocks so that long waits do not hold a CPU core. The window is 1.5 times the
+//! moving average of the recent waits when that is short enough to be worth spinning, otherwise a short poll before
+//! blocking. Hybrid waits need events created with blocking sync.
+//!
+class EventWaiter
+{
+public:
+    enum class Mode
+    {
+        kBLOCK,
+        kSPIN,
+        kHYBRID
+    };
+
+    explicit EventWaiter(Mode mode = Mode::kBLOCK)
+        : mMode(mode)
+    {
+    }
+
+    void wait(TrtCudaEvent& event)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        const auto start = clock::now();
+        if (mMode == Mode::kHYBRID)
+        {
+            const auto deadline = start + std::chrono::duration<float, std::micro>(mWindowUs);
+            cudaError_t status{cudaErrorNotReady};
+            while ((status = cudaEventQuery(event.get())) == cudaErrorNotReady && clock::now() < deadline)
+            {
+            }
+            if (status == cudaSuccess)
+            {
+                ++mSpunWaits;
+            }
+            else
+            {
+                std::this_thread::yield();
+                event.synchronize();
+            }
+        }
+        else
+        {
+            event.synchronize();
+        }
+        const float waitUs = std::chrono::duration<float, std::micro>(clock::now() - start).count();
+        mAverageUs = mWaits ? mAverageUs + (waitUs - mAverageUs) * kAVERAGE_WEIGHT : waitUs;
+        mWindowUs = kMIN_SPIN_US;
+        if (mAverageUs * 1.5F > kMIN_SPIN_US && mAverageUs * 1.5F <= kMAX_SPIN_US)
+        {
+            mWindowUs = mAverageUs * 1.5F;
+        }
+        ++mWaits;
+        mWaitMs += waitUs / 1000;
+    }
+
+    Mode getMode() const
+    {
+        return mMode;
+    }
+
+    unsigned long long getWaits() const
+    {
+        return mWaits;
+    }
+
+    //! Hybrid waits whose event completed within the spin window
+    unsigned long long getSpunWaits() const
+    {
+        return mSpunWaits;
+    }
+
+    double getWaitMs() const
+    {
+        return mWaitMs;
+    }
+
+private:
+    static constexpr float kMIN_SPIN_US{10.F};
+    static constexpr float kMAX_SPIN_US{500.F};
+    static constexpr float kAVERAGE_WEIGHT{0.125F};
+
+    Mode mMode{Mode::kBLOCK};
+    float mAverageUs{0};
+    float mWindowUs{kMIN_SPIN_US};
+    unsigned long long mWaits{0};
+    unsigned long long mSpunWaits{0};
+    double mWaitMs{0};
+};
+
+//!
+//! \brief CPU time used by the calling thread, 0 where thread CPU clocks are not available
+//!
+inline double threadCpuMs()
+{
+#if defined(__linux__)
+    timespec time{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+#else
+    return 0;
+#endif
+}
+
+//!
+//! \class TrtCudaGraph
+//! \brief Managed CUDA graph, instantiated from the work captured on a stream
+//!
+class TrtCudaGraph
+{
+public:
+
+    TrtCudaGraph() = default;
+
+    TrtCudaGraph(const TrtCudaGraph&) = delete;
+
+    TrtCudaGraph& operator=(const TrtCudaGraph&) = delete;
+
+    TrtCudaGraph(TrtCudaGraph&&) = delete;
+
+    TrtCudaGraph& operator=(TrtCudaGraph&&) = delete;
+
+    ~TrtCudaGraph()
+    {
+#if CUDA_VERSION >= 10000
+        if (mGraphExec)
+        {
+            // An executable graph still in flight is released on completion
+            cudaGraphExecDestroy(mGraphExec);
+        }
+#endif
+    }
+
+    //!
+    //! \brief Start capturing the work submitted to a stream
+    //!
+    //! \return boolean Return false if CUDA graphs are not supported
+    //!
+    bool beginCapture(TrtCudaStream& stream)
+    {
+#if CUDA_VERSION >= 10010
+        cudaCheck(cudaStreamBeginCapture(stream.get(), cudaStreamCaptureModeThreadLocal));
+        return true;
+#elif CUDA_VERSION >= 10000
+        cudaCheck(cudaStreamBeginCapture(stream.get()));
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    //!
+    //! \brief Stop capturing and instantiate the graph
+    //!
+    //! \return boolean Return false if the capture was invalidated, for instance by a synchronization or by work on the
+    //! legacy default stream, in which case the graph cannot be launched
+    //!
+    bool endCapture(TrtCudaStream& stream)
+    {
+#if CUDA_VERSION >= 10000
+        cudaGraph_t graph{};
+        if (cudaStreamEndCapture(stream.get(), &graph) != cudaSuccess)
+        {
+            // Clear the sticky error of the invalidated capture
+            cudaGetLastError();
+            if (graph)
+            {
+                cudaGraphDestroy(graph);
+            }
+            return false;
+        }
+        const bool instantiated = cudaGraphInstantiate(&mGraphExec, graph, nullptr, nullptr, 0) == cudaSuccess;
+        if (!instantiated)
+        {
+            cudaGetLastError();
+            mGraphExec = {};
+        }
+        cudaCheck(cudaGraphDestroy(graph));
+        return instantiated;
+#else
+        return false;
+#endif
+    }
+
+    void launch(TrtCudaStream& stream)
+    {
+#if CUDA_VERSION >= 10000
+        cudaCheck(cudaGraphLaunch(mGraphExec, stream.get()));
+#endif
+    }
+
+private:
+
+#if CUDA_VERSION >= 10000
+    cudaGraphExec_t mGraphExec{};
+#endif
+};
+
 //!
 //! \class TrtCudaBuffer
 //! \brief Managed buffer for host and device
@@ -222,6 +579,230 @@ private:
     void* mPtr{nullptr};
 };
 
+//!
+//! \class TrtPinnedHostPool
+//! \brief Pinned host memory carved from large registered slabs, optionally placed on the NUMA node of a device
+//!
+//! cudaMallocHost is slow and pins the pages on the node of the calling thread. The pool maps slabs, binds them to
+//! the node closest to the device before the first touch, and pins them once with cudaHostRegister. Buffers are carved
+//! from the slabs and released buffers are kept for requests of up to their size and no smaller than half of it. The
+//! slabs are returned to the system when the pool is destroyed, which must happen after its buffers are released.
+//!
+class TrtPinnedHostPool
+{
+public:
+
+    //!
+    //! \param device The device whose NUMA node the slabs are placed on, or -1 to leave placement to the system
+    //! \param slabSize The size of the slabs, larger requests get a slab of their own
+    //!
+    explicit TrtPinnedHostPool(int device = -1, size_t slabSize = size_t(64) << 20)
+        : mNode(device < 0 ? -1 : numaNodeOf(device))
+        , mSlabSize(roundUp(slabSize))
+    {
+    }
+
+    TrtPinnedHostPool(const TrtPinnedHostPool&) = delete;
+
+    TrtPinnedHostPool& operator=(const TrtPinnedHostPool&) = delete;
+
+    ~TrtPinnedHostPool()
+    {
+        if (installed() == this)
+        {
+            installed() = nullptr;
+        }
+        for (const auto& slab : mSlabs)
+        {
+            releaseSlab(slab.first, slab.second);
+        }
+    }
+
+    void* allocate(size_t size)
+    {
+        if (!size)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mAllocations;
+        const size_t blockSize = roundUp(size);
+        auto block = mFree.lower_bound(blockSize);
+        if (block != mFree.end() && block->first / 2 <= blockSize)
+        {
+            ++mHits;
+            void* ptr = block->second;
+            mUsed[ptr] = block->first;
+            mFree.erase(block);
+            return ptr;
+        }
+
+        if (mSlabRemaining < blockSize)
+        {
+            // The tail of the current slab is dropped, buffers are mostly allocated once and of similar sizes
+            const size_t slabSize = std::max(mSlabSize, blockSize);
+            mSlabNext = static_cast<char*>(mapSlab(slabSize));
+            mSlabRemaining = slabSize;
+            mSlabs.emplace_back(mSlabNext, slabSize);
+            mReserved += slabSize;
+        }
+        void* ptr = mSlabNext;
+        mSlabNext += blockSize;
+        mSlabRemaining -= blockSize;
+        mUsed[ptr] = blockSize;
+        return ptr;
+    }
+
+    //!
+    //! \return False if the buffer was not allocated from the pool
+    //!
+    bool free(void* ptr)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto block = mUsed.find(ptr);
+        if (block == mUsed.end())
+        {
+            return false;
+        }
+        mFree.emplace(block->second, block->first);
+        mUsed.erase(block);
+        return true;
+    }
+
+    //!
+    //! \brief Serve the pinned host buffers of TrtHostBuffer and samplesCommon::HostBuffer from this pool
+    //!
+    void install()
+    {
+        installed() = this;
+    }
+
+    //!
+    //! \return The installed pool, nullptr if pinned host buffers are allocated one by one
+    //!
+    static TrtPinnedHostPool*& installed()
+    {
+        static TrtPinnedHostPool* pool{nullptr};
+        return pool;
+    }
+
+    //!
+    //! \brief Print the number of allocations, served from released buffers or not, and the host memory pinned
+    //!
+    void print(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        os << "Pinned host pool: " << mAllocations << " allocations, " << mHits << " from cache, " << (mReserved >> 20)
+           << " MiB pinned";
+        if (mNode >= 0)
+        {
+            os << " on NUMA node " << mNode;
+        }
+        os << std::endl;
+    }
+
+    //!
+    //! \return The NUMA node of the device as reported by sysfs, -1 if unknown
+    //!
+    static int numaNodeOf(int device)
+    {
+        int node{-1};
+#if defined(__linux__)
+        const std::string path = devicePciPath(device);
+        if (path.empty())
+        {
+            return -1;
+        }
+        std::ifstream numaNode(path + "/numa_node");
+        if (!(numaNode >> node))
+        {
+            node = -1;
+        }
+#endif
+        return node;
+    }
+
+private:
+
+    static size_t roundUp(size_t size)
+    {
+        constexpr size_t kGRANULARITY{4096};
+        return (size + kGRANULARITY - 1) / kGRANULARITY * kGRANULARITY;
+    }
+
+    void* mapSlab(size_t size) const
+    {
+        void* slab{nullptr};
+#if defined(__linux__)
+        slab = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slab == MAP_FAILED)
+        {
+            cudaCheck(cudaErrorMemoryAllocation);
+        }
+        if (mNode >= 0)
+        {
+            // Bind before cudaHostRegister touches the pages, the default placement is kept if binding fails
+            constexpr int kMPOL_BIND{2};
+            unsigned long nodeMask[16]{};
+            nodeMask[mNode / (8 * sizeof(unsigned long))] = 1UL << (mNode % (8 * sizeof(unsigned long)));
+            syscall(SYS_mbind, slab, size, kMPOL_BIND, nodeMask, 8 * sizeof(nodeMask), 0);
+        }
+        cudaCheck(cudaHostRegister(slab, size, cudaHostRegisterPortable));
+#else
+        cudaCheck(cudaMallocHost(&slab, size));
+#endif
+        return slab;
+    }
+
+    static void releaseSlab(void* slab, size_t size)
+    {
+#if defined(__linux__)
+        cudaHostUnregister(slab);
+        munmap(slab, size);
+#else
+        cudaFreeHost(slab);
+#endif
+    }
+
+    int mNode{-1};
+    size_t mSlabSize{0};
+    mutable std::mutex mMutex;
+    std::vector<std::pair<void*, size_t>> mSlabs;
+    char* mSlabNext{nullptr};
+    size_t mSlabRemaining{0};
+    std::multimap<size_t, void*> mFree;
+    std::unordered_map<void*, size_t> mUsed;
+    size_t mReserved{0};
+    int mAllocations{0};
+    int mHits{0};
+};
+
+struct HostAllocator
+{
+    void operator()(void** ptr, size_t size)
+    {
+        if (TrtPinnedHostPool* pool = TrtPinnedHostPool::installed())
+        {
+            *ptr = pool->allocate(size);
+            return;
+        }
+        // Portable, so that the buffers of one device can be shared with the others
+        cudaCheck(cudaHostAlloc(ptr, size, cudaHostAllocPortable));
+    }
+};
+
+struct HostDeallocator
+{
+    void operator()(void* ptr)
+    {
+        TrtPinnedHostPool* pool = TrtPinnedHostPool::installed();
+        if (!pool || !pool->free(ptr))
+        {
+            cudaCheck(cudaFreeHost(ptr));
+        }
+    }
+};
+
 struct DeviceAllocator
 {
     void operator()(void** ptr, size_t size) { cudaCheck(cudaMalloc(ptr, size)); }
@@ -232,20 +813,347 @@ struct DeviceDeallocator
     void operator()(void* ptr) { cudaCheck(cudaFree(ptr)); }
 };
 
-struct HostAllocator
+
+struct MappedAllocator
 {
-    void operator()(void** ptr, size_t size) { cudaCheck(cudaMallocHost(ptr, size)); }
+    void operator()(void** ptr, size_t size) { cudaCheck(cudaHostAlloc(ptr, size, cudaHostAllocMapped)); }
 };
 
-struct HostDeallocator
+struct ManagedAllocator
 {
-    void operator()(void* ptr) { cudaCheck(cudaFreeHost(ptr)); }
+    void operator()(void** ptr, size_t size) { cudaCheck(cudaMallocManaged(ptr, size, cudaMemAttachGlobal)); }
 };
 
 using TrtDeviceBuffer = TrtCudaBuffer<DeviceAllocator, DeviceDeallocator>;
 
 using TrtHostBuffer = TrtCudaBuffer<HostAllocator, HostDeallocator>;
 
+using TrtMappedBuffer = TrtCudaBuffer<MappedAllocator, HostDeallocator>;
+
+using TrtManagedBuffer = TrtCudaBuffer<ManagedAllocator, DeviceDeallocator>;
+
+//!
+//! \class TrtCudaMemoryPool
+//! \brief Caching device allocator for TensorRT and the plugins
+//!
+//! Released blocks are kept and handed out again to requests of up to the block size and no smaller than half of it,
+//! so that creating and destroying engines and contexts does not go through cudaMalloc and cudaFree, which synchronize
+//! the device. Cached blocks are returned to the device when an allocation fails and when the pool is destroyed.
+//!
+class TrtCudaMemoryPool : public nvinfer1::IGpuAllocator
+{
+public:
+
+    TrtCudaMemoryPool() = default;
+
+    TrtCudaMemoryPool(const TrtCudaMemoryPool&) = delete;
+
+    TrtCudaMemoryPool& operator=(const TrtCudaMemoryPool&) = delete;
+
+    ~TrtCudaMemoryPool()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        releaseCached();
+        for (const auto& b : mUsed)
+        {
+            cudaFree(b.first);
+        }
+    }
+
+    void* allocate(uint64_t size, uint64_t /*alignment*/, uint32_t /*flags*/) override
+    {
+        // cudaMalloc alignment covers all the alignments TensorRT requests
+        if (!size)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mAllocations;
+        const auto blockSize = roundUp(size);
+        auto block = mFree.lower_bound(blockSize);
+        if (block != mFree.end() && block->first / 2 <= blockSize)
+        {
+            ++mHits;
+            void* ptr = block->second;
+            mUsed[ptr] = block->first;
+            mFree.erase(block);
+            return ptr;
+        }
+
+        void* ptr{nullptr};
+        if (cudaMalloc(&ptr, blockSize) != cudaSuccess)
+        {
+            releaseCached();
+            if (cudaMalloc(&ptr, blockSize) != cudaSuccess)
+            {
+                return nullptr;
+            }
+        }
+        mUsed[ptr] = blockSize;
+        mReserved += blockSize;
+        mPeakReserved = std::max(mPeakReserved, mReserved);
+        return ptr;
+    }
+
+    void free(void* memory) override
+    {
+        if (!memory)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto block = mUsed.find(memory);
+        if (block == mUsed.end())
+        {
+            // Not acquired from the pool, e.g. allocated before the pool was installed
+            cudaFree(memory);
+            return;
+        }
+        mFree.emplace(block->second, block->first);
+        mUsed.erase(block);
+    }
+
+    //!
+    //! \brief Print the number of allocations, served from the cache or not, and the peak device memory reserved
+    //!
+    void print(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        os << "Memory pool: " << mAllocations << " allocations, " << mHits << " from cache, peak reserved "
+           << (mPeakReserved >> 20) << " MiB" << std::endl;
+    }
+
+private:
+
+    static uint64_t roundUp(uint64_t size)
+    {
+        constexpr uint64_t kGRANULARITY{512};
+        return (size + kGRANULARITY - 1) / kGRANULARITY * kGRANULARITY;
+    }
+
+    void releaseCached()
+    {
+        for (const auto& b : mFree)
+        {
+            cudaFree(b.second);
+            mReserved -= b.first;
+        }
+        mFree.clear();
+    }
+
+    mutable std::mutex mMutex;
+    std::multimap<uint64_t, void*> mFree;
+    std::unordered_map<void*, uint64_t> mUsed;
+    uint64_t mReserved{0};
+    uint64_t mPeakReserved{0};
+    int mAllocations{0};
+    int mHits{0};
+};
+
+//!
+//! \class TrtCudaMemoryAccount
+//! \brief Account for the device memory of TensorRT and of the plugins, phase by phase
+//!
+//! The account hands out one allocator per owner, each forwarding to the wrapped allocator, or to cudaMalloc without
+//! one, and tagging the live allocations with their owner. Each phase records the high-water mark of the live memory
+//! of every owner while it runs, and at its end the memory used on the device. Memory allocated past the allocators,
+//! such as the binding buffers, library handles and blocks cached by a pool, is the remainder of the device memory
+//! used. The memory used when the account is created, by the CUDA context and other processes, is the baseline.
+//!
+class TrtCudaMemoryAccount
+{
+public:
+
+    enum class Owner : int
+    {
+        kTENSORRT = 0,
+        kPLUGINS = 1
+    };
+
+    static constexpr int kOWNERS{2};
+
+    struct Phase
+    {
+        std::string name;
+        uint64_t peak[kOWNERS]{}; //!< High-water mark of the live memory of each owner during the phase
+        uint64_t live[kOWNERS]{}; //!< Live memory of each owner at the end of the phase
+        uint64_t used{0};         //!< Memory used on the device at the end of the phase
+    };
+
+    explicit TrtCudaMemoryAccount(nvinfer1::IGpuAllocator* allocator = nullptr)
+        : mAllocator(allocator)
+        , mOwners{{*this, Owner::kTENSORRT}, {*this, Owner::kPLUGINS}}
+    {
+        mBaseline = deviceUsed();
+    }
+
+    TrtCudaMemoryAccount(const TrtCudaMemoryAccount&) = delete;
+
+    TrtCudaMemoryAccount& operator=(const TrtCudaMemoryAccount&) = delete;
+
+    nvinfer1::IGpuAllocator* getAllocator(Owner owner)
+    {
+        return &mOwners[static_cast<int>(owner)];
+    }
+
+    //!
+    //! \brief End the current phase, if any, and start recording a new one
+    //!
+    void beginPhase(const std::string& name)
+    {
+        endPhase();
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPhases.emplace_back();
+        mPhases.back().name = name;
+        std::copy(mLive, mLive + kOWNERS, mPhases.back().peak);
+        mOpen = true;
+    }
+
+    void endPhase()
+    {
+        // Pending frees of the device are only visible in the memory used once they complete
+        cudaDeviceSynchronize();
+        const uint64_t used = deviceUsed();
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mOpen)
+        {
+            std::copy(mLive, mLive + kOWNERS, mPhases.back().live);
+            mPhases.back().used = used;
+            mOpen = false;
+        }
+    }
+
+    //!
+    //! \brief Print, for every ended phase, the peak and final memory of each owner and the untracked memory
+    //!
+    void print(std::ostream& os) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto mib = [](uint64_t bytes) { return bytes / 1048576.0; };
+        os << "=== Device Memory ===" << std::endl;
+        os << "Baseline (CUDA context, other processes): " << mib(mBaseline) << " MiB" << std::endl;
+        const size_t ended = mOpen ? mPhases.size() - 1 : mPhases.size();
+        for (size_t p = 0; p < ended; ++p)
+        {
+            const auto& phase = mPhases[p];
+            const uint64_t tracked = phase.live[0] + phase.live[1];
+            const uint64_t untracked = phase.used > mBaseline + tracked ? phase.used - mBaseline - tracked : 0;
+            os << phase.name << ": TensorRT " << mib(phase.live[0]) << " MiB (peak " << mib(phase.peak[0])
+               << "), plugins " << mib(phase.live[1]) << " MiB (peak " << mib(phase.peak[1]) << "), untracked "
+               << mib(untracked) << " MiB, device " << mib(phase.used) << " MiB used" << std::endl;
+        }
+    }
+
+private:
+
+    class OwnerAllocator : public nvinfer1::IGpuAllocator
+    {
+    public:
+        OwnerAllocator(TrtCudaMemoryAccount& account, Owner owner)
+            : mAccount(account)
+            , mOwner(static_cast<int>(owner))
+        {
+        }
+
+        void* allocate(uint64_t size, uint64_t alignment, uint32_t flags) override
+        {
+            return mAccount.allocate(mOwner, size, alignment, flags);
+        }
+
+        void free(void* memory) override
+        {
+            mAccount.free(memory);
+        }
+
+    private:
+        TrtCudaMemoryAccount& mAccount;
+        int mOwner;
+    };
+
+    static uint64_t deviceUsed()
+    {
+        size_t free{0};
+        size_t total{0};
+        cudaMemGetInfo(&free, &total);
+        return total - free;
+    }
+
+    void* allocate(int owner, uint64_t size, uint64_t alignment, uint32_t flags)
+    {
+        void* ptr{nullptr};
+        if (mAllocator)
+        {
+            ptr = mAllocator->allocate(size, alignment, flags);
+        }
+        else if (size && cudaMalloc(&ptr, size) != cudaSuccess)
+        {
+            ptr = nullptr;
+        }
+        if (!ptr)
+        {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mAllocations[ptr] = std::make_pair(owner, size);
+        mLive[owner] += size;
+        if (mOpen)
+        {
+            auto& peak = mPhases.back().peak[owner];
+            peak = std::max(peak, mLive[owner]);
+        }
+        return ptr;
+    }
+
+    void free(void* memory)
+    {
+        if (!memory)
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto allocation = mAllocations.find(memory);
+            if (allocation != mAllocations.end())
+            {
+                mLive[allocation->second.first] -= allocation->second.second;
+                mAllocations.erase(allocation);
+            }
+        }
+        if (mAllocator)
+        {
+            mAllocator->free(memory);
+        }
+        else
+        {
+            cudaFree(memory);
+        }
+    }
+
+    nvinfer1::IGpuAllocator* mAllocator{nullptr};
+    OwnerAllocator mOwners[kOWNERS];
+    mutable std::mutex mMutex;
+    std::unordered_map<void*, std::pair<int, uint64_t>> mAllocations;
+    uint64_t mLive[kOWNERS]{};
+    uint64_t mBaseline{0};
+    std::vector<Phase> mPhases;
+    bool mOpen{false};
+};
+
+//!
+//! \enum MemoryType
+//! \brief Memory backing a MirroredBuffer
+//!
+//! kDEVICE pairs pinned host memory with device memory and copies between them. kMAPPED and kMANAGED give the device
+//! direct access to a single allocation, mapped pinned host memory or unified memory respectively, so transfers are
+//! no-ops.
+//!
+enum class MemoryType
+{
+    kDEVICE,
+    kMAPPED,
+    kMANAGED
+};
+
 //!
 //! \class MirroredBuffer
 //! \brief Coupled host and device buffers
@@ -254,25 +1162,160 @@ class MirroredBuffer
 {
 public:
 
-    void allocate(size_t size)
+    //!
+    //! \param host False to leave device memory without a host buffer, for data that never leaves the device
+    //!
+    void allocate(size_t size, MemoryType type = MemoryType::kDEVICE, bool host = true)
     {
         mSize = size;
-        mHostBuffer.allocate(size);
-        mDeviceBuffer.allocate(size);
+        mType = type;
+        switch (type)
+        {
+        case MemoryType::kDEVICE:
+        {
+            if (host)
+            {
+                mHostBuffer.allocate(size);
+            }
+            mDeviceBuffer.allocate(size);
+            mHostPtr = mHostBuffer.get();
+            mDevicePtr = mDeviceBuffer.get();
+            break;
+        }
+        case MemoryType::kMAPPED:
+        {
+            mMappedBuffer.allocate(size);
+            mHostPtr = mMappedBuffer.get();
+            cudaCheck(cudaHostGetDevicePointer(&mDevicePtr, mHostPtr, 0));
+            break;
+        }
+        case MemoryType::kMANAGED:
+        {
+            mManagedBuffer.allocate(size);
+            mHostPtr = mManagedBuffer.get();
+            mDevicePtr = mHostPtr;
+            break;
+        }
+        }
+    }
+
+    //!
+    //! \brief Transfer from the host buffer of another buffer of the same size instead of from a buffer of its own
+    //!
+    //! Pinned host memory is accessible from all the devices, so the buffers of different devices can share their host
+    //! buffer. The other buffer must outlive this one. Zero-copy buffers keep their own memory.
+    //!
+    void shareHostBuffer(const MirroredBuffer& other)
+    {
+        if (mType == MemoryType::kDEVICE && other.mType == MemoryType::kDEVICE && mSize == other.mSize)
+        {
+            if (mPacked)
+            {
+                // The host memory of a packed buffer has to stay next to the others of its region
+                std::memcpy(mHostPtr, other.mHostPtr, mSize);
+                return;
+            }
+            mHostBuffer.reset();
+            mHostPtr = other.mHostPtr;
+        }
+    }
+
+    //!
+    //! \brief Use the host and device buffers of another buffer of the same device instead of buffers of its own
+    //!
+    //! For values that never change once set, such as inputs generated on the device, that the queries of several
+    //! streams can read at the same time. The other buffer must outlive this one.
+    //!
+    void shareBuffers(const MirroredBuffer& other)
+    {
+        mSize = other.mSize;
+        mType = other.mType;
+        mHostBuffer.reset();
+        mDeviceBuffer.reset();
+        mHostPtr = other.mHostPtr;
+        mDevicePtr = other.mDevicePtr;
+    }
+
+    //!
+    //! \brief Move the contents to offset bytes into the buffers of region, and use that memory from then on
+    //!
+    //! Buffers packed one after the other into a region transfer together with a single copy of the region. The
+    //! region must be large enough and outlive this buffer.
+    //!
+    void packInto(const MirroredBuffer& region, size_t offset)
+    {
+        if (isZeroCopy() || region.isZeroCopy())
+        {
+            return;
+        }
+        void* host = static_cast<char*>(region.mHostPtr) + offset;
+        std::memcpy(host, mHostPtr, mSize);
+        mHostBuffer.reset();
+        mDeviceBuffer.reset();
+        mHostPtr = host;
+        mDevicePtr = static_cast<char*>(region.mDevicePtr) + offset;
+        mPacked = true;
     }
 
-    void* getDeviceBuffer() const { return mDeviceBuffer.get(); }
+    bool isPacked() const { return mPacked; }
 
-    void* getHostBuffer() const { return mHostBuffer.get(); }
+    void* getDeviceBuffer() const { return mDevicePtr; }
 
-    void hostToDevice(TrtCudaStream& stream)
+    void* getHostBuffer() const { return mHostPtr; }
+
+    //!
+    //! \return True if the device accesses the host buffer directly and no transfer is needed
+    //!
+    bool isZeroCopy() const { return mType != MemoryType::kDEVICE; }
+
+    // A negative size transfers the whole buffer
+    void hostToDevice(TrtCudaStream& stream, int size = -1)
     {
-        cudaCheck(cudaMemcpyAsync(mDeviceBuffer.get(), mHostBuffer.get(), mSize, cudaMemcpyHostToDevice, stream.get()));
+        if (!isZeroCopy())
+        {
+            cudaCheck(cudaMemcpyAsync(mDevicePtr, mHostPtr, size < 0 ? mSize : size, cudaMemcpyHostToDevice, stream.get()));
+        }
+    }
+
+    void deviceToHost(TrtCudaStream& stream, int size = -1)
+    {
+        if (!isZeroCopy())
+        {
+            cudaCheck(cudaMemcpyAsync(mHostPtr, mDevicePtr, size < 0 ? mSize : size, cudaMemcpyDeviceToHost, stream.get()));
+        }
     }
 
-    void deviceToHost(TrtCudaStream& stream)
+    //!
+    //! \brief Transfer size bytes from offset bytes into the buffers
+    //!
+    void hostToDevice(TrtCudaStream& stream, size_t offset, size_t size)
     {
-        cudaCheck(cudaMemcpyAsync(mHostBuffer.get(), mDeviceBuffer.get(), mSize, cudaMemcpyDeviceToHost, stream.get()));
+        if (!isZeroCopy() && size)
+        {
+            cudaCheck(cudaMemcpyAsync(static_cast<char*>(mDevicePtr) + offset, static_cast<char*>(mHostPtr) + offset,
+                size, cudaMemcpyHostToDevice, stream.get()));
+        }
+    }
+
+    void deviceToHost(TrtCudaStream& stream, size_t offset, size_t size)
+    {
+        if (!isZeroCopy() && size)
+        {
+            cudaCheck(cudaMemcpyAsync(static_cast<char*>(mHostPtr) + offset, static_cast<char*>(mDevicePtr) + offset,
+                size, cudaMemcpyDeviceToHost, stream.get()));
+        }
+    }
+
+    //!
+    //! \brief Transfer the first width bytes of each of height blocks of pitch bytes, in a single strided copy
+    //!
+    void deviceToHost(TrtCudaStream& stream, size_t width, size_t pitch, int height)
+    {
+        if (!isZeroCopy() && width && height)
+        {
+            cudaCheck(cudaMemcpy2DAsync(
+                mHostPtr, pitch, mDevicePtr, pitch, width, height, cudaMemcpyDeviceToHost, stream.get()));
+        }
     }
 
     int getSize() const
@@ -283,8 +1326,14 @@ public:
 private:
 
     int mSize{0};
+    MemoryType mType{MemoryType::kDEVICE};
+    bool mPacked{false};
+    void* mHostPtr{nullptr};
+    void* mDevicePtr{nullptr};
     TrtHostBuffer mHostBuffer;
     TrtDeviceBuffer mDeviceBuffer;
+    TrtMappedBuffer mMappedBuffer;
+    TrtManagedBuffer mManagedBuffer;
 };
 
 } // namespace sample
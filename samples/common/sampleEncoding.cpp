@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <limits>
+#if CUDA_VERSION < 10000
+#include <half.h>
+#else
+#include <cuda_fp16.h>
+#endif
+
+#include "sampleEncoding.h"
+
+namespace sample
+{
+
+namespace
+{
+
+#if CUDA_VERSION < 10000
+using Half = half_float::half;
+#else
+using Half = __half;
+#endif
+
+template <typename Narrow>
+bool narrowIntegers(const int32_t* values, Narrow* encoded, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (values[i] < std::numeric_limits<Narrow>::min() || values[i] > std::numeric_limits<Narrow>::max())
+        {
+            return false;
+        }
+        encoded[i] = static_cast<Narrow>(values[i]);
+    }
+    return true;
+}
+
+template <typename Narrow>
+void widenIntegers(const Narrow* encoded, int32_t* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        values[i] = encoded[i];
+    }
+}
+
+template <typename T>
+void unpackMask(const uint32_t* words, T* values, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        values[i] = static_cast<T>((words[i / 32] >> (i % 32)) & 1U ? 1.F : 0.F);
+    }
+}
+
+} // namespace
+
+size_t encodedSize(TransferEncoding encoding, size_t count)
+{
+    switch (encoding)
+    {
+    case TransferEncoding::kFP16:
+    case TransferEncoding::kINT16: return count * 2;
+    case TransferEncoding::kINT8: return count;
+    case TransferEncoding::kMASK: return (count + 31) / 32 * sizeof(uint32_t);
+    case TransferEncoding::kNONE: break;
+    }
+    return 0;
+}
+
+bool canEncode(TransferEncoding encoding, nvinfer1::DataType dataType, bool isInput)
+{
+    switch (encoding)
+    {
+    case TransferEncoding::kFP16: return dataType == nvinfer1::DataType::kFLOAT;
+    case TransferEncoding::kINT16:
+    case TransferEncoding::kINT8: return dataType == nvinfer1::DataType::kINT32;
+    case TransferEncoding::kMASK:
+        return !isInput && (dataType == nvinfer1::DataType::kFLOAT || dataType == nvinfer1::DataType::kHALF);
+    case TransferEncoding::kNONE: break;
+    }
+    return false;
+}
+
+bool encodeHost(
+    const void* values, nvinfer1::DataType dataType, TransferEncoding encoding, void* encoded, size_t count)
+{
+    switch (encoding)
+    {
+    case TransferEncoding::kFP16:
+    {
+        const auto* v = static_cast<const float*>(values);
+        auto* e = static_cast<Half*>(encoded);
+        for (size_t i = 0; i < count; ++i)
+        {
+            e[i] = static_cast<Half>(v[i]);
+        }
+        return true;
+    }
+    case TransferEncoding::kINT16:
+        return narrowIntegers(static_cast<const int32_t*>(values), static_cast<int16_t*>(encoded), count);
+    case TransferEncoding::kINT8:
+        return narrowIntegers(static_cast<const int32_t*>(values), static_cast<int8_t*>(encoded), count);
+    case TransferEncoding::kMASK:
+    case TransferEncoding::kNONE: break;
+    }
+    return false;
+}
+
+void decodeHost(
+    const void* encoded, TransferEncoding encoding, void* values, nvinfer1::DataType dataType, size_t count)
+{
+    switch (encoding)
+    {
+    case TransferEncoding::kFP16:
+    {
+        const auto* e = static_cast<const Half*>(encoded);
+        auto* v = static_cast<float*>(values);
+        for (size_t i = 0; i < count; ++i)
+        {
+            v[i] = static_cast<float>(e[i]);
+        }
+        break;
+    }
+    case TransferEncoding::kINT16:
+        widenIntegers(static_cast<const int16_t*>(encoded), static_cast<int32_t*>(values), count);
+        break;
+    case TransferEncoding::kINT8:
+        widenIntegers(static_cast<const int8_t*>(encoded), static_cast<int32_t*>(values), count);
+        break;
+    case TransferEncoding::kMASK:
+        if (dataType == nvinfer1::DataType::kHALF)
+        {
+            unpackMask(static_cast<const uint32_t*>(encoded), static_cast<Half*>(values), count);
+        }
+        else
+        {
+            unpackMask(static_cast<const uint32_t*>(encoded), static_cast<float*>(values), count);
+        }
+        break;
+    case TransferEncoding::kNONE: break;
+    }
+}
+
+} // namespace sample
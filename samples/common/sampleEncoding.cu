@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleEncoding.h"
+#include <algorithm>
+#include <cstdint>
+#include <cuda_fp16.h>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kTHREADS{256};
+constexpr int kMAX_BLOCKS{1024};
+
+int blocksFor(size_t count)
+{
+    return static_cast<int>(std::min<size_t>((count + kTHREADS - 1) / kTHREADS, kMAX_BLOCKS));
+}
+
+__device__ float toFloat(float v)
+{
+    return v;
+}
+
+__device__ float toFloat(__half v)
+{
+    return __half2float(v);
+}
+
+__global__ void floatToHalfKernel(const float* values, __half* encoded, size_t count)
+{
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < count;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        encoded[i] = __float2half(values[i]);
+    }
+}
+
+__global__ void halfToFloatKernel(const __half* encoded, float* values, size_t count)
+{
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < count;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        values[i] = __half2float(encoded[i]);
+    }
+}
+
+//! Values out of the range of Narrow saturate, as a count or an index past the range would otherwise wrap around
+template <typename Narrow, int kLOW, int kHIGH>
+__global__ void narrowIntegersKernel(const int32_t* values, Narrow* encoded, size_t count)
+{
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < count;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        encoded[i] = static_cast<Narrow>(max(kLOW, min(kHIGH, values[i])));
+    }
+}
+
+template <typename Narrow>
+__global__ void widenIntegersKernel(const Narrow* encoded, int32_t* values, size_t count)
+{
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < count;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        values[i] = encoded[i];
+    }
+}
+
+//! Each warp packs 32 consecutive values into a word, all the lanes of a warp run the same iterations of the loop
+//! since the blocks and the rounded count are multiples of the warp size
+template <typename T>
+__global__ void packMaskKernel(const T* values, float threshold, uint32_t* words, size_t count)
+{
+    const size_t rounded = (count + 31) / 32 * 32;
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < rounded;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const unsigned int bits = __ballot_sync(0xFFFFFFFFU, i < count && toFloat(values[i]) > threshold);
+        if (i % 32 == 0)
+        {
+            words[i / 32] = bits;
+        }
+    }
+}
+
+} // namespace
+
+void encodeDevice(const void* values, nvinfer1::DataType dataType, TransferEncoding encoding, float threshold,
+    void* encoded, size_t count, cudaStream_t stream)
+{
+    if (!count)
+    {
+        return;
+    }
+    switch (encoding)
+    {
+    case TransferEncoding::kFP16:
+        floatToHalfKernel<<<blocksFor(count), kTHREADS, 0, stream>>>(
+            static_cast<const float*>(values), static_cast<__half*>(encoded), count);
+        break;
+    case TransferEncoding::kINT16:
+        narrowIntegersKernel<int16_t, INT16_MIN, INT16_MAX><<<blocksFor(count), kTHREADS, 0, stream>>>(
+            static_cast<const int32_t*>(values), static_cast<int16_t*>(encoded), count);
+        break;
+    case TransferEncoding::kINT8:
+        narrowIntegersKernel<int8_t, INT8_MIN, INT8_MAX><<<blocksFor(count), kTHREADS, 0, stream>>>(
+            static_cast<const int32_t*>(values), static_cast<int8_t*>(encoded), count);
+        break;
+    case TransferEncoding::kMASK:
+        if (dataType == nvinfer1::DataType::kHALF)
+        {
+            packMaskKernel<<<blocksFor(count), kTHREADS, 0, stream>>>(
+                static_cast<const __half*>(values), threshold, static_cast<uint32_t*>(encoded), count);
+        }
+        else
+        {
+            packMaskKernel<<<blocksFor(count), kTHREADS, 0, stream>>>(
+                static_cast<const float*>(values), threshold, static_cast<uint32_t*>(encoded), count);
+        }
+        break;
+    case TransferEncoding::kNONE: break;
+    }
+}
+
+void decodeDevice(const void* encoded, TransferEncoding encoding, void* values, nvinfer1::DataType dataType,
+    size_t count, cudaStream_t stream)
+{
+    if (!count)
+    {
+        return;
+    }
+    switch (encoding)
+    {
+    case TransferEncoding::kFP16:
+        halfToFloatKernel<<<blocksFor(count), kTHREADS, 0, stream>>>(
+            static_cast<const __half*>(encoded), static_cast<float*>(values), count);
+        break;
+    case TransferEncoding::kINT16:
+        widenIntegersKernel<<<blocksFor(count), kTHREADS, 0, stream>>>(
+            static_cast<const int16_t*>(encoded), static_cast<int32_t*>(values), count);
+        break;
+    case TransferEncoding::kINT8:
+        widenIntegersKernel<<<blocksFor(count), kTHREADS, 0, stream>>>(
+            static_cast<const int8_t*>(encoded), static_cast<int32_t*>(values), count);
+        break;
+    case TransferEncoding::kMASK:
+    case TransferEncoding::kNONE: break;
+    }
+}
+
+} // namespace sample
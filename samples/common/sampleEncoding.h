@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_ENCODING_H
+#define TRT_SAMPLE_ENCODING_H
+
+#include <cstddef>
+
+#include <cuda_runtime_api.h>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+//!
+//! \brief How the values of a binding cross PCIe, narrower than its data type
+//!
+//! Inputs are narrowed on the host once and widened on the device after each copy, outputs are narrowed on the device
+//! before each copy and widened on the host when read.
+//!
+enum class TransferEncoding
+{
+    kNONE,
+    kFP16,  //!< FP32 values as FP16
+    kINT16, //!< INT32 values as INT16, saturated on the device
+    kINT8,  //!< INT32 values as INT8, saturated on the device
+    kMASK,  //!< FP32 or FP16 outputs as one bit per value, set above a threshold, widened to 0 and 1
+};
+
+//!
+//! \return The bytes of count values in encoding
+//!
+size_t encodedSize(TransferEncoding encoding, size_t count);
+
+//!
+//! \return True if the values of a binding of dataType can be transferred in encoding
+//!
+bool canEncode(TransferEncoding encoding, nvinfer1::DataType dataType, bool isInput);
+
+//!
+//! \brief Narrow count host values into encoded
+//!
+//! \return False if a value does not fit in the encoding
+//!
+bool encodeHost(
+    const void* values, nvinfer1::DataType dataType, TransferEncoding encoding, void* encoded, size_t count);
+
+//!
+//! \brief Widen count encoded host values into values of dataType
+//!
+void decodeHost(
+    const void* encoded, TransferEncoding encoding, void* values, nvinfer1::DataType dataType, size_t count);
+
+//!
+//! \brief Narrow count device values into encoded, the values above threshold set the bits of a mask
+//!
+void encodeDevice(const void* values, nvinfer1::DataType dataType, TransferEncoding encoding, float threshold,
+    void* encoded, size_t count, cudaStream_t stream);
+
+//!
+//! \brief Widen count encoded device values into values of dataType
+//!
+void decodeDevice(const void* encoded, TransferEncoding encoding, void* values, nvinfer1::DataType dataType,
+    size_t count, cudaStream_t stream);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_ENCODING_H
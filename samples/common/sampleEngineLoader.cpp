@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#include <cuda_runtime_api.h>
+
+#include "logger.h"
+#include "sampleDevice.h"
+#include "sampleEngineLoader.h"
+#include "sampleEngines.h"
+
+using namespace nvinfer1;
+
+namespace sample
+{
+
+namespace
+{
+
+//! What an engine logged while its thread loaded it
+struct LoadMessages
+{
+    std::ostringstream err;
+    std::ostringstream info;
+    std::ostringstream verbose;
+};
+
+bool loadOne(EngineLoad& load, int DLACore, IGpuAllocator* allocator, LoadMessages& messages)
+{
+    using clock = std::chrono::high_resolution_clock;
+    const auto start = clock::now();
+    const cudaError_t status = cudaSetDevice(load.device);
+    if (status != cudaSuccess)
+    {
+        messages.err << "Cannot set device " << load.device << ": " << cudaGetErrorString(status) << std::endl;
+        return false;
+    }
+    load.engine.reset(
+        readEngine(load.file, DLACore, messages.err, messages.info, messages.verbose, allocator, &load.startup));
+    if (!load.engine)
+    {
+        return false;
+    }
+    const auto contextsStart = clock::now();
+    for (int c = 0; c < load.contexts; ++c)
+    {
+        load.context.emplace_back(load.engine->createExecutionContext());
+        if (!load.context.back())
+        {
+            messages.err << "Cannot create execution context " << c << " of " << load.file << std::endl;
+            return false;
+        }
+    }
+    const auto end = clock::now();
+    load.startup.contextsMs = std::chrono::duration<float, std::milli>(end - contextsStart).count();
+    load.readyMs = std::chrono::duration<float, std::milli>(end - start).count();
+    return true;
+}
+
+} // namespace
+
+bool loadEngines(std::vector<EngineLoad>& loads, int DLACore, int threads, EngineLoadStats& stats, std::ostream& err,
+    IGpuAllocator* allocator)
+{
+    using clock = std::chrono::high_resolution_clock;
+    const int engines = static_cast<int>(loads.size());
+    if (!threads)
+    {
+        threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    }
+    stats.threads = std::max(std::min(threads, engines), 1);
+
+    int device{0};
+    cudaCheck(cudaGetDevice(&device));
+    const auto start = clock::now();
+    std::vector<LoadMessages> messages(loads.size());
+    std::vector<char> loaded(loads.size(), 0);
+    std::atomic<int> next{0};
+    const auto worker = [&]() {
+        for (int e = next++; e < engines; e = next++)
+        {
+            loaded[e] = loadOne(loads[e], DLACore, allocator, messages[e]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < stats.threads; ++t)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : pool)
+    {
+        t.join();
+    }
+    stats.totalMs = std::chrono::duration<float, std::milli>(clock::now() - start).count();
+    cudaCheck(cudaSetDevice(device));
+
+    // The loggers are not made for concurrent messages, each engine logs its own once all are loaded
+    bool success{true};
+    for (int e = 0; e < engines; ++e)
+    {
+        const std::string verbose = messages[e].verbose.str();
+        if (!verbose.empty())
+        {
+            gLogVerbose << verbose << std::flush;
+        }
+        const std::string info = messages[e].info.str();
+        if (!info.empty())
+        {
+            gLogInfo << loads[e].file << ": " << info << std::flush;
+        }
+        if (!loaded[e])
+        {
+            err << messages[e].err.str() << "Loading of " << loads[e].file << " failed" << std::endl;
+            success = false;
+        }
+    }
+    return success;
+}
+
+void printEngineLoadReport(const std::vector<EngineLoad>& loads, const EngineLoadStats& stats, std::ostream& os)
+{
+    if (loads.empty())
+    {
+        return;
+    }
+    float serialMs{0};
+    os << "=== Engine loading (" << stats.threads << " threads) ===" << std::endl;
+    for (const auto& load : loads)
+    {
+        const auto& times = load.startup;
+        os << load.file << " on device " << load.device << ": ready in " << load.readyMs << " ms (read "
+           << times.readMs << " ms, decompress " << times.decompressMs << " ms, deserialize " << times.deserializeMs
+           << " ms, " << load.contexts << " contexts " << times.contextsMs << " ms)" << std::endl;
+        serialMs += load.readyMs;
+    }
+    os << "All " << loads.size() << " engines ready in " << stats.totalMs << " ms, " << serialMs
+       << " ms one after another";
+    if (stats.totalMs > 0)
+    {
+        os << " (" << serialMs / stats.totalMs << "x)";
+    }
+    os << std::endl;
+}
+
+} // namespace sample
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_ENGINE_LOADER_H
+#define TRT_SAMPLE_ENGINE_LOADER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+
+#include "sampleReporting.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+//!
+//! \struct EngineLoad
+//! \brief An engine file to load on a device with its execution contexts, and the times it took
+//!
+struct EngineLoad
+{
+    std::string file;
+    int device{0};
+    int contexts{0}; //!< Execution contexts to create once the engine is deserialized
+    TrtUniquePtr<nvinfer1::ICudaEngine> engine;
+    std::vector<TrtUniquePtr<nvinfer1::IExecutionContext>> context;
+    StartupTimes startup; //!< Read, decompression, deserialization and context times
+    float readyMs{0};     //!< From the start of the load to the engine and its contexts ready
+};
+
+//!
+//! \struct EngineLoadStats
+//! \brief Threads used by loadEngines and its time to have all the engines ready, in milliseconds
+//!
+struct EngineLoadStats
+{
+    int threads{0};
+    float totalMs{0};
+};
+
+//!
+//! \brief Load the engines and create their execution contexts on a pool of threads, the current device is kept
+//!
+//! Each thread takes the next engine to load, sets its device and reads it as loadEngine does, the engine files are
+//! mapped when possible. The deserializations, with the weight uploads and the initialization of the plugins inside
+//! them, and the context creations of different engines then overlap instead of running one after another. The
+//! messages of each engine are logged in the order of the engines once all are loaded.
+//!
+//! \param threads Threads of the pool, 0 for one per engine up to the hardware concurrency
+//! \param allocator Device allocator for the runtimes, nullptr for the default one, it must be thread safe
+//!
+//! \return boolean Return true if all the engines and their contexts were created
+//!
+bool loadEngines(std::vector<EngineLoad>& loads, int DLACore, int threads, EngineLoadStats& stats, std::ostream& err,
+    nvinfer1::IGpuAllocator* allocator = nullptr);
+
+//!
+//! \brief Print the time to ready of each engine loaded and of all of them, against loading them one after another
+//!
+void printEngineLoadReport(const std::vector<EngineLoad>& loads, const EngineLoadStats& stats, std::ostream& os);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_ENGINE_LOADER_H
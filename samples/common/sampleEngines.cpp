@@ -15,21 +15,34 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <map>
 #include <random>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "NvInfer.h"
 #include "NvCaffeParser.h"
 #include "NvOnnxParser.h"
 #include "NvUffParser.h"
 
+#include "CalibrationCache.h"
 #include "logger.h"
 #include "sampleUtils.h"
 #include "sampleOptions.h"
+#include "samplePlanFile.h"
+#include "sampleReporting.h"
 #include "sampleEngines.h"
 
 using namespace nvinfer1;
@@ -149,8 +162,8 @@ namespace
 class RndInt8Calibrator : public nvinfer1::IInt8EntropyCalibrator2
 {
 public:
-    RndInt8Calibrator(
-        int batches, const std::string& cacheFile, const nvinfer1::INetworkDefinition& network, std::ostream& err);
+    RndInt8Calibrator(int batches, const std::string& cacheFile, const nvinfer1::INetworkDefinition& network,
+        const std::string& modelHash, std::ostream& err);
 
     ~RndInt8Calibrator()
     {
@@ -169,22 +182,37 @@ public:
 
     const void* readCalibrationCache(size_t& length) override;
 
-    virtual void writeCalibrationCache(const void*, size_t) override {}
+    //! The cache is not written back to the file, it is only kept for the export of its dynamic ranges
+    virtual void writeCalibrationCache(const void* cache, size_t length) override
+    {
+        mCache.assign(static_cast<const char*>(cache), static_cast<const char*>(cache) + length);
+    }
+
+    //!
+    //! \brief The cache read or written by the last calibration, empty before the build
+    //!
+    const std::vector<char>& getCache() const
+    {
+        return mCache;
+    }
 
 private:
+    static samplesCommon::CalibrationCacheKey makeCacheKey(
+        const nvinfer1::INetworkDefinition& network, const std::string& modelHash);
+
     int mBatches{};
     int mCurrentBatch{};
-    std::string mCacheFile;
     std::map<std::string, void*> mInputDeviceBuffers;
-    std::vector<char> mCalibrationCache;
+    samplesCommon::CalibrationCache mCalibrationCache;
+    std::vector<char> mCache;
     std::ostream& mErr;
 };
 
-RndInt8Calibrator::RndInt8Calibrator(
-    int batches, const std::string& cacheFile, const INetworkDefinition& network, std::ostream& err)
+RndInt8Calibrator::RndInt8Calibrator(int batches, const std::string& cacheFile, const INetworkDefinition& network,
+    const std::string& modelHash, std::ostream& err)
     : mBatches(batches)
     , mCurrentBatch(0)
-    , mCacheFile(cacheFile)
+    , mCalibrationCache(cacheFile, makeCacheKey(network, modelHash))
     , mErr(err)
 {
     std::default_random_engine generator;
@@ -225,16 +253,160 @@ bool RndInt8Calibrator::getBatch(void* bindings[], const char* names[], int nbBi
 
 const void* RndInt8Calibrator::readCalibrationCache(size_t& length)
 {
-    mCalibrationCache.clear();
-    std::ifstream input(mCacheFile, std::ios::binary);
-    input >> std::noskipws;
-    if (input.good())
+    const void* cache = mCalibrationCache.read(length);
+    mCache.assign(static_cast<const char*>(cache), static_cast<const char*>(cache) + length);
+    return cache;
+}
+
+samplesCommon::CalibrationCacheKey RndInt8Calibrator::makeCacheKey(
+    const INetworkDefinition& network, const std::string& modelHash)
+{
+    samplesCommon::CalibrationCacheKey key;
+    key.setModel(modelHash).setAlgorithm(CalibrationAlgoType::kENTROPY_CALIBRATION_2);
+    for (int i = 0; i < network.getNbInputs(); i++)
     {
-        std::copy(
-            std::istream_iterator<char>(input), std::istream_iterator<char>(), std::back_inserter(mCalibrationCache));
+        // The batch dimension is not part of the key, the scales do not depend on it
+        Dims dims = network.getInput(i)->getDimensions();
+        if (!network.hasImplicitBatchDimension())
+        {
+            std::copy(dims.d + 1, dims.d + dims.nbDims, dims.d);
+            --dims.nbDims;
+        }
+        key.addInput(network.getInput(i)->getName(), dims);
     }
+    return key;
+}
 
-    return mCalibrationCache.size() ? mCalibrationCache.data() : nullptr;
+//! Pins the layers to their precision, strict types keep the builder from picking faster precisions instead
+bool setLayerPrecisions(const std::unordered_map<std::string, DataType>& precisions, INetworkDefinition& network,
+    IBuilderConfig& config, std::ostream& err)
+{
+    size_t found{0};
+    for (int l = 0; l < network.getNbLayers(); ++l)
+    {
+        auto* layer = network.getLayer(l);
+        const auto p = precisions.find(layer->getName());
+        if (p == precisions.end())
+        {
+            continue;
+        }
+        ++found;
+        if (p->second == DataType::kINT8 && !config.getFlag(BuilderFlag::kINT8))
+        {
+            err << "Layer " << p->first << " is set to int8 without int8 enabled (--int8)" << std::endl;
+            return false;
+        }
+        if (p->second == DataType::kHALF)
+        {
+            config.setFlag(BuilderFlag::kFP16);
+        }
+        layer->setPrecision(p->second);
+        for (int o = 0; o < layer->getNbOutputs(); ++o)
+        {
+            // Network outputs keep the types of the I/O formats, and shape or index tensors their integer type
+            const ITensor* output = layer->getOutput(o);
+            const bool floating
+                = output && (output->getType() == DataType::kFLOAT || output->getType() == DataType::kHALF);
+            if (floating && !output->isNetworkOutput())
+            {
+                layer->setOutputType(o, p->second);
+            }
+        }
+    }
+    if (found < precisions.size())
+    {
+        gLogWarning << precisions.size() - found << " layers with a precision set are not in the network" << std::endl;
+    }
+    config.setFlag(BuilderFlag::kSTRICT_TYPES);
+    return true;
+}
+
+//! Reads "tensor:range" lines, tensor names may contain colons so the range follows the last one
+bool readDynamicRanges(const std::string& fileName, std::unordered_map<std::string, float>& ranges, std::ostream& err)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        err << "Could not read dynamic ranges " << fileName << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const auto colon = line.rfind(':');
+        if (colon == std::string::npos || colon == 0)
+        {
+            continue;
+        }
+        ranges[line.substr(0, colon)] = std::stof(line.substr(colon + 1));
+    }
+    return true;
+}
+
+//! Sets the ranges of the tensors of the network found in the file, the others are left unset
+bool setDynamicRanges(const std::string& fileName, INetworkDefinition& network, std::ostream& err)
+{
+    std::unordered_map<std::string, float> ranges;
+    if (!readDynamicRanges(fileName, ranges, err))
+    {
+        return false;
+    }
+    int missing{0};
+    const auto setRange = [&ranges, &missing](ITensor* tensor)
+    {
+        // Optional tensors are nullptr, and tensors are seen once per layer reading them
+        if (!tensor || tensor->dynamicRangeIsSet())
+        {
+            return;
+        }
+        const auto range = ranges.find(tensor->getName());
+        if (range == ranges.end())
+        {
+            ++missing;
+            return;
+        }
+        tensor->setDynamicRange(-range->second, range->second);
+    };
+    for (int l = 0; l < network.getNbLayers(); ++l)
+    {
+        auto* layer = network.getLayer(l);
+        for (int i = 0; i < layer->getNbInputs(); ++i)
+        {
+            setRange(layer->getInput(i));
+        }
+        for (int o = 0; o < layer->getNbOutputs(); ++o)
+        {
+            setRange(layer->getOutput(o));
+        }
+    }
+    if (missing)
+    {
+        gLogWarning << "No dynamic range in " << fileName << " for " << missing
+                    << " tensor reads or writes of the network, they get default ranges" << std::endl;
+    }
+    return true;
+}
+
+bool saveDynamicRanges(const std::vector<char>& cache, const std::string& fileName, std::ostream& err)
+{
+    const auto ranges = samplesCommon::cacheToDynamicRanges(cache.data(), cache.size());
+    if (ranges.empty())
+    {
+        err << "The calibration cache has no scales to export" << std::endl;
+        return false;
+    }
+    std::ofstream file(fileName);
+    for (const auto& r : ranges)
+    {
+        file << r.first << ":" << r.second << std::endl;
+    }
+    if (!file)
+    {
+        err << "Could not write dynamic ranges to " << fileName << std::endl;
+        return false;
+    }
+    gLogInfo << "Dynamic ranges of " << ranges.size() << " tensors exported to " << fileName << std::endl;
+    return true;
 }
 
 void setTensorScales(const INetworkDefinition& network, float inScales = 2.0f, float outScales = 4.0f)
@@ -272,21 +444,80 @@ void setTensorScales(const INetworkDefinition& network, float inScales = 2.0f, f
     }
 }
 
+#if !defined(_MSC_VER)
+//! Read-only mapping of a whole file, empty if the file cannot be mapped
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& fileName)
+    {
+        const int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                // The runtime walks the engine front to back, start reading ahead right away
+                madvise(data, st.st_size, MADV_SEQUENTIAL);
+                madvise(data, st.st_size, MADV_WILLNEED);
+                mData = data;
+                mSize = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (mData)
+        {
+            munmap(mData, mSize);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const void* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    void* mData{nullptr};
+    size_t mSize{0};
+};
+#endif
+
 } // namespace
 
 ICudaEngine* networkToEngine(const BuildOptions& build, const SystemOptions& sys, IBuilder& builder,
-    INetworkDefinition& network, std::ostream& err)
+    INetworkDefinition& network, std::ostream& err, const std::string& modelHash)
 {
     TrtUniquePtr<IBuilderConfig> config{builder.createBuilderConfig()};
 
-    IOptimizationProfile* profile{nullptr};
+    std::vector<IOptimizationProfile*> profiles;
     if (build.maxBatch)
     {
         builder.setMaxBatchSize(build.maxBatch);
     }
     else
     {
-        profile = builder.createOptimizationProfile();
+        const size_t nbProfiles = std::max(build.optProfiles.size(), static_cast<size_t>(1));
+        for (size_t p = 0; p < nbProfiles; ++p)
+        {
+            profiles.push_back(builder.createOptimizationProfile());
+        }
     }
 
     bool hasDynamicShapes{false};
@@ -317,18 +548,20 @@ ICudaEngine* networkToEngine(const BuildOptions& build, const SystemOptions& sys
             input->setAllowedFormats(1U << static_cast<int>(TensorFormat::kLINEAR));
         }
 
-        if (profile)
+        for (size_t p = 0; p < profiles.size(); ++p)
         {
+            auto* profile = profiles[p];
             Dims dims = input->getDimensions();
             const bool isDynamicInput = std::any_of(dims.d, dims.d + dims.nbDims, [](int dim){ return dim == -1; }) || input->isShapeTensor();
             if (isDynamicInput)
             {
                 hasDynamicShapes = true;
-                auto shape = build.shapes.find(input->getName());
+                const bool hasProfileShapes = p < build.optProfiles.size();
+                auto shape = hasProfileShapes ? build.optProfiles[p].find(input->getName()) : ShapeProfile::const_iterator();
                 ShapeRange shapes{};
 
                 // If no shape is provided, set dynamic dimensions to 1.
-                if (shape == build.shapes.end())
+                if (!hasProfileShapes || shape == build.optProfiles[p].end())
                 {
                     constexpr int DEFAULT_DIMENSION = 1;
                     Dims staticDims{};
@@ -373,14 +606,17 @@ ICudaEngine* networkToEngine(const BuildOptions& build, const SystemOptions& sys
         }
     }
 
-    if (profile && hasDynamicShapes)
+    if (hasDynamicShapes)
     {
-        if (!profile->isValid())
+        for (auto* profile : profiles)
         {
-            err << "Required optimization profile is invalid" << std::endl;
-            return nullptr;
+            if (!profile->isValid())
+            {
+                err << "Required optimization profile is invalid" << std::endl;
+                return nullptr;
+            }
+            config->addOptimizationProfile(profile);
         }
-        config->addOptimizationProfile(profile);
     }
 
     for (unsigned int i = 0, n = network.getNbOutputs(); i < n; i++)
@@ -410,19 +646,36 @@ ICudaEngine* networkToEngine(const BuildOptions& build, const SystemOptions& sys
         config->setFlag(BuilderFlag::kINT8);
     }
 
+    if (build.refittable)
+    {
+        config->setFlag(BuilderFlag::kREFIT);
+    }
+
+    if (!build.layerPrecisions.empty() && !setLayerPrecisions(build.layerPrecisions, network, *config, err))
+    {
+        return nullptr;
+    }
+
     auto isInt8 = [](const IOFormat& format) { return format.first == DataType::kINT8; };
     auto int8IO = std::count_if(build.inputFormats.begin(), build.inputFormats.end(), isInt8)
         + std::count_if(build.outputFormats.begin(), build.outputFormats.end(), isInt8);
 
+    std::unique_ptr<RndInt8Calibrator> calibrator;
     if ((build.int8 && build.calibration.empty()) || int8IO)
     {
+        // The ranges of the file are set first, default scales complete them
+        if (!build.dynamicRanges.empty() && !setDynamicRanges(build.dynamicRanges, network, err))
+        {
+            return nullptr;
+        }
         // Explicitly set int8 scales if no calibrator is provided and if I/O tensors use int8,
         // because auto calibration does not support this case.
         setTensorScales(network);
     }
     else if (build.int8)
     {
-        config->setInt8Calibrator(new RndInt8Calibrator(1, build.calibration, network, err));
+        calibrator.reset(new RndInt8Calibrator(1, build.calibration, network, modelHash, err));
+        config->setInt8Calibrator(calibrator.get());
     }
 
     if (build.safe)
@@ -454,68 +707,299 @@ ICudaEngine* networkToEngine(const BuildOptions& build, const SystemOptions& sys
         }
     }
 
-    return builder.buildEngineWithConfig(network, *config);
-}
-
-ICudaEngine* modelToEngine(
-    const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys, std::ostream& err)
-{
-    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
-    if (builder == nullptr)
+    ICudaEngine* engine = builder.buildEngineWithConfig(network, *config);
+    if (engine && calibrator && !build.exportDynamicRanges.empty()
+        && !saveDynamicRanges(calibrator->getCache(), build.exportDynamicRanges, err))
     {
-        err << "Builder creation failed" << std::endl;
+        engine->destroy();
         return nullptr;
     }
+    return engine;
+}
+
+namespace
+{
+
+//!
+//! \brief Parse a model into a new network of the builder
+//!
+//! \param modelHash Set to the hash of the model files if the build reads a calibration cache
+//!
+TrtUniquePtr<INetworkDefinition> parseModel(const ModelOptions& model, const BuildOptions& build, IBuilder& builder,
+    Parser& parser, std::string& modelHash, std::ostream& err)
+{
     const bool isOnnxModel = model.baseModel.format == ModelFormat::kONNX;
     auto batchFlag = (build.maxBatch && !isOnnxModel) ? 0U : 1U
         << static_cast<uint32_t>(nvinfer1::NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
-    TrtUniquePtr<INetworkDefinition> network{builder->createNetworkV2(batchFlag)};
+    TrtUniquePtr<INetworkDefinition> network{builder.createNetworkV2(batchFlag)};
     if (!network)
     {
         err << "Network creation failed" << std::endl;
         return nullptr;
     }
-    Parser parser = modelToNetwork(model, *network, err);
+    parser = modelToNetwork(model, *network, err);
     if (!parser)
     {
         err << "Parsing model failed" << std::endl;
         return nullptr;
     }
 
-    return networkToEngine(build, sys, *builder, *network, err);
+    // Only hash the model when its calibration cache is read
+    if (build.int8 && !build.calibration.empty())
+    {
+        std::vector<std::string> modelFiles{model.baseModel.model};
+        if (model.baseModel.format == ModelFormat::kCAFFE)
+        {
+            modelFiles.push_back(model.prototxt);
+        }
+        modelHash = samplesCommon::hashModelFiles(modelFiles);
+    }
+    return network;
 }
 
-ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& err)
+} // namespace
+
+ICudaEngine* modelToEngine(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys,
+    std::ostream& err, IGpuAllocator* allocator)
 {
-    std::ifstream engineFile(engine, std::ios::binary);
-    if (!engineFile)
+    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
+    if (builder == nullptr)
+    {
+        err << "Builder creation failed" << std::endl;
+        return nullptr;
+    }
+    if (allocator)
+    {
+        builder->setGpuAllocator(allocator);
+    }
+    Parser parser;
+    std::string modelHash;
+    TrtUniquePtr<INetworkDefinition> network = parseModel(model, build, *builder, parser, modelHash, err);
+    if (!network)
     {
-        err << "Error opening engine file: " << engine << std::endl;
         return nullptr;
     }
 
-    engineFile.seekg(0, engineFile.end);
-    long int fsize = engineFile.tellg();
-    engineFile.seekg(0, engineFile.beg);
+    return networkToEngine(build, sys, *builder, *network, err, modelHash);
+}
 
-    std::vector<char> engineData(fsize);
-    engineFile.read(engineData.data(), fsize);
-    if (!engineFile)
+bool getLayerNames(
+    const ModelOptions& model, const BuildOptions& build, std::vector<std::string>& names, std::ostream& err)
+{
+    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
+    if (builder == nullptr)
     {
-        err << "Error loading engine file: " << engine << std::endl;
-        return nullptr;
+        err << "Builder creation failed" << std::endl;
+        return false;
     }
+    Parser parser;
+    std::string modelHash;
+    TrtUniquePtr<INetworkDefinition> network = parseModel(model, build, *builder, parser, modelHash, err);
+    if (!network)
+    {
+        return false;
+    }
+    names.clear();
+    for (int l = 0; l < network->getNbLayers(); ++l)
+    {
+        names.emplace_back(network->getLayer(l)->getName());
+    }
+    return true;
+}
+
+bool getLayerCosts(const ModelOptions& model, const BuildOptions& build, int batch, LayerCosts& costs,
+    std::ostream& err)
+{
+    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
+    if (builder == nullptr)
+    {
+        err << "Builder creation failed" << std::endl;
+        return false;
+    }
+    Parser parser;
+    std::string modelHash;
+    TrtUniquePtr<INetworkDefinition> network = parseModel(model, build, *builder, parser, modelHash, err);
+    if (!network)
+    {
+        return false;
+    }
+    const DataType precision = build.int8 ? DataType::kINT8 : build.fp16 ? DataType::kHALF : DataType::kFLOAT;
+    costs = estimateLayerCosts(*network, batch, precision);
+    return true;
+}
+
+bool describeNetwork(
+    const ModelOptions& model, const BuildOptions& build, NetworkDescription& description, std::ostream& err)
+{
+    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
+    if (builder == nullptr)
+    {
+        err << "Builder creation failed" << std::endl;
+        return false;
+    }
+    Parser parser;
+    std::string modelHash;
+    TrtUniquePtr<INetworkDefinition> network = parseModel(model, build, *builder, parser, modelHash, err);
+    if (!network)
+    {
+        return false;
+    }
+    description = NetworkDescription{};
+    description.implicitBatch = network->hasImplicitBatchDimension();
+    const auto describe = [](const ITensor& tensor) {
+        NetworkTensor t;
+        t.name = tensor.getName();
+        t.type = tensor.getType();
+        t.dims = tensor.getDimensions();
+        return t;
+    };
+    for (int i = 0; i < network->getNbInputs(); ++i)
+    {
+        description.inputs.push_back(describe(*network->getInput(i)));
+    }
+    for (int o = 0; o < network->getNbOutputs(); ++o)
+    {
+        description.outputs.push_back(describe(*network->getOutput(o)));
+    }
+    for (int l = 0; l < network->getNbLayers(); ++l)
+    {
+        const auto& layer = *network->getLayer(l);
+        auto& d = description.layers[layer.getName()];
+        for (int i = 0; i < layer.getNbInputs(); ++i)
+        {
+            // Optional inputs are null
+            const auto* input = layer.getInput(i);
+            d.inputs.emplace_back(input ? input->getName() : "");
+        }
+        for (int o = 0; o < layer.getNbOutputs(); ++o)
+        {
+            d.outputs.emplace_back(layer.getOutput(o)->getName());
+        }
+        d.plugin = layer.getType() == LayerType::kPLUGIN_V2 || layer.getType() == LayerType::kPLUGIN;
+    }
+    return true;
+}
+
+bool saveLayerPrecisions(const std::vector<std::pair<std::string, nvinfer1::DataType>>& precisions,
+    const std::string& fileName, std::ostream& err)
+{
+    std::ofstream file(fileName);
+    for (const auto& p : precisions)
+    {
+        file << p.first << ":" << p.second << std::endl;
+    }
+    if (!file)
+    {
+        err << "Could not write layer precisions to " << fileName << std::endl;
+        return false;
+    }
+    return true;
+}
+
+ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& err, IGpuAllocator* allocator,
+    StartupTimes* startup)
+{
+    return readEngine(engine, DLACore, err, gLogInfo, gLogVerbose, allocator, startup);
+}
+
+ICudaEngine* readEngine(const std::string& engine, int DLACore, std::ostream& err, std::ostream& info,
+    std::ostream& verbose, IGpuAllocator* allocator, StartupTimes* startup)
+{
+    using clock = std::chrono::high_resolution_clock;
+    const auto readStart = clock::now();
+
+    const void* engineData{nullptr};
+    size_t fsize{0};
+#if !defined(_MSC_VER)
+    // The runtime reads the mapped pages directly, without a second host copy of the engine
+    MappedFile mapped(engine);
+    if (mapped.data())
+    {
+        engineData = mapped.data();
+        fsize = mapped.size();
+    }
+#endif
+    std::vector<char> engineBuffer;
+    if (!engineData)
+    {
+        std::ifstream engineFile(engine, std::ios::binary);
+        if (!engineFile)
+        {
+            err << "Error opening engine file: " << engine << std::endl;
+            return nullptr;
+        }
+
+        engineFile.seekg(0, engineFile.end);
+        fsize = engineFile.tellg();
+        engineFile.seekg(0, engineFile.beg);
+
+        engineBuffer.resize(fsize);
+        engineFile.read(engineBuffer.data(), fsize);
+        if (!engineFile)
+        {
+            err << "Error loading engine file: " << engine << std::endl;
+            return nullptr;
+        }
+        engineData = engineBuffer.data();
+    }
+    const auto readEnd = clock::now();
+
+    // Compressed plans decompress from the mapped or read file into a buffer of their own
+    std::vector<char> planBuffer;
+    const size_t fileSize = fsize;
+    if (isCompressedPlan(engineData, fsize))
+    {
+        std::string metadata;
+        if (!readCompressedPlan(engineData, fsize, planBuffer, metadata, err))
+        {
+            err << "Error decompressing engine file: " << engine << std::endl;
+            return nullptr;
+        }
+        verbose << "Compressed plan metadata:" << std::endl << metadata;
+        engineData = planBuffer.data();
+        fsize = planBuffer.size();
+    }
+    const auto decompressEnd = clock::now();
 
     TrtUniquePtr<IRuntime> runtime{createInferRuntime(gLogger.getTRTLogger())};
+    if (allocator)
+    {
+        runtime->setGpuAllocator(allocator);
+    }
     if (DLACore != -1)
     {
         runtime->setDLACore(DLACore);
     }
 
-    return runtime->deserializeCudaEngine(engineData.data(), fsize, nullptr);
+    const auto deserializeStart = clock::now();
+    ICudaEngine* cudaEngine = runtime->deserializeCudaEngine(engineData, fsize, nullptr);
+    const auto deserializeEnd = clock::now();
+
+    const std::chrono::duration<float, std::milli> readTime = readEnd - readStart;
+    const std::chrono::duration<float, std::milli> decompressTime = decompressEnd - readEnd;
+    const std::chrono::duration<float, std::milli> deserializeTime = deserializeEnd - deserializeStart;
+    info << "Engine loaded in " << readTime.count() + decompressTime.count() + deserializeTime.count() << " ms ("
+         << (engineBuffer.empty() ? "map: " : "read: ") << readTime.count() << " ms, ";
+    if (!planBuffer.empty())
+    {
+        info << "decompress: " << decompressTime.count() << " ms, ";
+    }
+    info << "deserialize: " << deserializeTime.count() << " ms, " << fsize << " bytes";
+    if (!planBuffer.empty())
+    {
+        info << " from " << fileSize << " compressed";
+    }
+    info << ")" << std::endl;
+    if (startup)
+    {
+        startup->readMs = readTime.count();
+        startup->decompressMs = decompressTime.count();
+        startup->deserializeMs = deserializeTime.count();
+    }
+    return cudaEngine;
 }
 
-bool saveEngine(const ICudaEngine& engine, const std::string& fileName, std::ostream& err)
+bool saveEngine(const ICudaEngine& engine, const std::string& fileName, std::ostream& err, int compression)
 {
     std::ofstream engineFile(fileName, std::ios::binary);
     if (!engineFile)
@@ -531,27 +1015,93 @@ bool saveEngine(const ICudaEngine& engine, const std::string& fileName, std::ost
         return false;
     }
 
+    if (compression)
+    {
+        return writeCompressedPlan(serializedEngine->data(), serializedEngine->size(), compression,
+            planMetadata(engine), engineFile, err);
+    }
     engineFile.write(static_cast<char*>(serializedEngine->data()), serializedEngine->size());
     return !engineFile.fail();
 }
 
-TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys, std::ostream& err)
+namespace
+{
+
+//! Name of the cached engine for the model and options, empty if a file of the model cannot be read
+std::string engineCacheFile(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys)
+{
+    std::vector<std::string> files{model.baseModel.model};
+    if (!model.prototxt.empty())
+    {
+        files.push_back(model.prototxt);
+    }
+    if (build.int8 && !build.calibration.empty())
+    {
+        files.push_back(build.calibration);
+    }
+    if (!build.dynamicRanges.empty())
+    {
+        files.push_back(build.dynamicRanges);
+    }
+    files.insert(files.end(), sys.plugins.begin(), sys.plugins.end());
+    const std::string filesHash = samplesCommon::hashModelFiles(files);
+    if (filesHash.empty())
+    {
+        return "";
+    }
+
+    // Describe everything the engine depends on besides the files, options that only name files are left out
+    BuildOptions engineBuild = build;
+    engineBuild.save = false;
+    engineBuild.engine.clear();
+    engineBuild.gemmAlgoCache.clear();
+    engineBuild.engineCache.clear();
+    cudaDeviceProp properties;
+    cudaCheck(cudaGetDeviceProperties(&properties, sys.device));
+    std::ostringstream description;
+    description << NV_TENSORRT_VERSION << " " << properties.name << " " << properties.major << "." << properties.minor
+                << " DLA " << sys.DLACore << " " << sys.fallback << std::endl
+                << model << engineBuild;
+    return build.engineCache + "/" + filesHash + "-" + samplesCommon::hashString(description.str()) + ".engine";
+}
+
+} // namespace
+
+TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(const ModelOptions& model, const BuildOptions& build,
+    const SystemOptions& sys, std::ostream& err, nvinfer1::IGpuAllocator* allocator, StartupTimes* startup)
 {
     TrtUniquePtr<nvinfer1::ICudaEngine> engine;
+    const std::string cacheFile = build.load || build.engineCache.empty() ? "" : engineCacheFile(model, build, sys);
     if (build.load)
     {
-        engine.reset(loadEngine(build.engine, sys.DLACore, err));
+        engine.reset(loadEngine(build.engine, sys.DLACore, err, allocator, startup));
+    }
+    else if (!cacheFile.empty() && std::ifstream(cacheFile).good())
+    {
+        gLogInfo << "Loading engine built with the same model and options from " << cacheFile << std::endl;
+        engine.reset(loadEngine(cacheFile, sys.DLACore, err, allocator, startup));
     }
     else
     {
-        engine.reset(modelToEngine(model, build, sys, err));
+        const auto buildStart = std::chrono::high_resolution_clock::now();
+        engine.reset(modelToEngine(model, build, sys, err, allocator));
+        const std::chrono::duration<float, std::milli> buildTime
+            = std::chrono::high_resolution_clock::now() - buildStart;
+        if (startup)
+        {
+            startup->buildMs = buildTime.count();
+        }
+        if (engine && !cacheFile.empty() && !saveEngine(*engine, cacheFile, err, build.compression))
+        {
+            gLogWarning << "Could not add the engine to the engine cache " << build.engineCache << std::endl;
+        }
     }
     if (!engine)
     {
         err << "Engine creation failed" << std::endl;
         return nullptr;
     }
-    if (build.save && !saveEngine(*engine, build.engine, err))
+    if (build.save && !saveEngine(*engine, build.engine, err, build.compression))
     {
         err << "Saving engine to file failed" << std::endl;
         return nullptr;
@@ -559,4 +1109,310 @@ TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(const ModelOptions& model, const B
     return engine;
 }
 
+std::vector<TrtUniquePtr<nvinfer1::ICudaEngine>> replicateEngine(
+    const nvinfer1::ICudaEngine& engine, const std::vector<int>& devices, std::ostream& err)
+{
+    int current{0};
+    cudaGetDevice(&current);
+    TrtUniquePtr<IHostMemory> plan{engine.serialize()};
+    if (!plan)
+    {
+        err << "Engine serialization failed" << std::endl;
+        return {};
+    }
+
+    std::vector<TrtUniquePtr<nvinfer1::ICudaEngine>> engines;
+    for (const auto device : devices)
+    {
+        // An engine runs on the device current when it is deserialized
+        cudaSetDevice(device);
+        TrtUniquePtr<IRuntime> runtime{createInferRuntime(gLogger.getTRTLogger())};
+        engines.emplace_back(runtime->deserializeCudaEngine(plan->data(), plan->size(), nullptr));
+        if (!engines.back())
+        {
+            err << "Engine deserialization on device " << device << " failed" << std::endl;
+            engines.clear();
+            break;
+        }
+    }
+    cudaSetDevice(current);
+    return engines;
+}
+
+namespace
+{
+
+//!
+//! \brief The weights of the roles of a layer that can be refitted, empty weights are skipped
+//!
+std::vector<std::pair<WeightsRole, Weights>> layerWeights(ILayer& layer)
+{
+    switch (layer.getType())
+    {
+    case LayerType::kCONVOLUTION:
+    {
+        const auto& conv = static_cast<const IConvolutionLayer&>(layer);
+        return {{WeightsRole::kKERNEL, conv.getKernelWeights()}, {WeightsRole::kBIAS, conv.getBiasWeights()}};
+    }
+    case LayerType::kDECONVOLUTION:
+    {
+        const auto& deconv = static_cast<const IDeconvolutionLayer&>(layer);
+        return {{WeightsRole::kKERNEL, deconv.getKernelWeights()}, {WeightsRole::kBIAS, deconv.getBiasWeights()}};
+    }
+    case LayerType::kFULLY_CONNECTED:
+    {
+        const auto& fc = static_cast<const IFullyConnectedLayer&>(layer);
+        return {{WeightsRole::kKERNEL, fc.getKernelWeights()}, {WeightsRole::kBIAS, fc.getBiasWeights()}};
+    }
+    case LayerType::kSCALE:
+    {
+        const auto& scale = static_cast<const IScaleLayer&>(layer);
+        return {{WeightsRole::kSCALE, scale.getScale()}, {WeightsRole::kSHIFT, scale.getShift()}};
+    }
+    case LayerType::kCONSTANT:
+    {
+        return {{WeightsRole::kCONSTANT, static_cast<const IConstantLayer&>(layer).getWeights()}};
+    }
+    default: return {};
+    }
+}
+
+const char* roleName(WeightsRole role)
+{
+    const char* names[] = {"kernel", "bias", "shift", "scale", "constant"};
+    return names[static_cast<int>(role)];
+}
+
+} // namespace
+
+bool refitEngine(ICudaEngine& engine, const ModelOptions& model, std::ostream& err)
+{
+    if (!engine.isRefittable())
+    {
+        err << "The engine was not built refittable (--refittable)" << std::endl;
+        return false;
+    }
+
+    // The parser owns the weights, it must live until the engine is refitted
+    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
+    if (!builder)
+    {
+        err << "Builder creation failed" << std::endl;
+        return false;
+    }
+    BuildOptions build;
+    build.maxBatch = engine.hasImplicitBatchDimension() ? engine.getMaxBatchSize() : 0;
+    Parser parser;
+    std::string modelHash;
+    TrtUniquePtr<INetworkDefinition> network = parseModel(model, build, *builder, parser, modelHash, err);
+    if (!network)
+    {
+        return false;
+    }
+
+    TrtUniquePtr<IRefitter> refitter{createInferRefitter(engine, gLogger.getTRTLogger())};
+    if (!refitter)
+    {
+        err << "Refitter creation failed" << std::endl;
+        return false;
+    }
+    const int all = refitter->getAll(0, nullptr, nullptr);
+    std::vector<const char*> names(all);
+    std::vector<WeightsRole> roles(all);
+    refitter->getAll(all, names.data(), roles.data());
+    std::set<std::pair<std::string, WeightsRole>> refittable;
+    for (int w = 0; w < all; ++w)
+    {
+        refittable.emplace(names[w], roles[w]);
+    }
+
+    int set{0};
+    for (int l = 0; l < network->getNbLayers(); ++l)
+    {
+        auto& layer = *network->getLayer(l);
+        for (const auto& w : layerWeights(layer))
+        {
+            if (w.second.count && refittable.count({layer.getName(), w.first}))
+            {
+                if (!refitter->setWeights(layer.getName(), w.first, w.second))
+                {
+                    err << "Setting the " << roleName(w.first) << " weights of " << layer.getName() << " failed"
+                        << std::endl;
+                    return false;
+                }
+                ++set;
+            }
+        }
+    }
+
+    const int missing = refitter->getMissing(0, nullptr, nullptr);
+    if (missing)
+    {
+        names.resize(missing);
+        roles.resize(missing);
+        refitter->getMissing(missing, names.data(), roles.data());
+        for (int m = 0; m < missing; ++m)
+        {
+            err << "Missing " << roleName(roles[m]) << " weights of " << names[m] << std::endl;
+        }
+        err << "The model has no weights for " << missing << " of the " << all << " refittable weights" << std::endl;
+        return false;
+    }
+    if (!refitter->refitCudaEngine())
+    {
+        err << "Refitting the engine failed" << std::endl;
+        return false;
+    }
+    gLogInfo << "Refitted " << set << " weights" << std::endl;
+    return true;
+}
+
+std::vector<BuildVariant> makeBuildVariants(const BuildOptions& build, const std::vector<int>& devices)
+{
+    const std::vector<int> batches = build.matrixBatches.empty() ? std::vector<int>{0} : build.matrixBatches;
+    std::vector<BuildVariant> variants;
+    for (const auto& precision : build.matrixPrecisions)
+    {
+        for (const auto batch : batches)
+        {
+            BuildVariant v;
+            v.name = precision + (batch ? ".b" + std::to_string(batch) : "");
+            v.batch = batch;
+            v.device = devices[variants.size() % devices.size()];
+            v.plan = build.engine + "." + v.name;
+
+            v.build = build;
+            v.build.fp16 = precision == "fp16";
+            v.build.int8 = precision == "int8";
+            v.build.save = false;
+            v.build.engine.clear();
+            v.build.engineCache.clear();
+            v.build.matrixPrecisions.clear();
+            v.build.matrixBatches.clear();
+            v.build.workspace = std::max(build.workspace / build.buildJobs, 1);
+            if (batch && v.build.maxBatch)
+            {
+                v.build.maxBatch = batch;
+            }
+            else if (batch)
+            {
+                for (auto& profile : v.build.optProfiles)
+                {
+                    for (auto& input : profile)
+                    {
+                        auto& range = input.second;
+                        auto& minBatch = range[static_cast<size_t>(OptProfileSelector::kMIN)].d[0];
+                        minBatch = std::min(minBatch, batch);
+                        range[static_cast<size_t>(OptProfileSelector::kOPT)].d[0] = batch;
+                        range[static_cast<size_t>(OptProfileSelector::kMAX)].d[0] = batch;
+                    }
+                }
+            }
+            variants.push_back(v);
+        }
+    }
+    return variants;
+}
+
+namespace
+{
+
+//!
+//! \brief Parse the model once on the device and build the variants in turn
+//!
+void buildVariants(const ModelOptions& model, SystemOptions sys, int device, std::vector<BuildVariant*> variants,
+    std::ostream& err)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    cudaCheck(cudaSetDevice(device));
+    sys.device = device;
+    TrtUniquePtr<IBuilder> builder{createInferBuilder(gLogger.getTRTLogger())};
+    if (!builder)
+    {
+        err << "Builder creation on device " << device << " failed" << std::endl;
+        return;
+    }
+    // The variants differ in precision and shapes only, the hash is the same for all of them
+    Parser parser;
+    std::string modelHash;
+    BuildOptions parseBuild = variants.front()->build;
+    parseBuild.int8 = std::any_of(
+        variants.begin(), variants.end(), [](const BuildVariant* v) { return v->build.int8; });
+    TrtUniquePtr<INetworkDefinition> network = parseModel(model, parseBuild, *builder, parser, modelHash, err);
+    if (!network)
+    {
+        return;
+    }
+
+    for (auto* v : variants)
+    {
+        const auto buildStart = clock::now();
+        TrtUniquePtr<ICudaEngine> engine{networkToEngine(v->build, sys, *builder, *network, err, modelHash)};
+        v->buildMs = std::chrono::duration<float, std::milli>(clock::now() - buildStart).count();
+        if (!engine)
+        {
+            err << "Building " << v->name << " on device " << device << " failed" << std::endl;
+            continue;
+        }
+        if (!saveEngine(*engine, v->plan, err, v->build.compression))
+        {
+            err << "Saving " << v->name << " to " << v->plan << " failed" << std::endl;
+            continue;
+        }
+        v->planSize = static_cast<size_t>(std::ifstream(v->plan, std::ios::binary | std::ios::ate).tellg());
+        v->built = true;
+    }
+}
+
+} // namespace
+
+bool buildEngineMatrix(const ModelOptions& model, const SystemOptions& sys, int jobs, std::vector<BuildVariant>& variants,
+    std::ostream& err)
+{
+    int current{0};
+    cudaGetDevice(&current);
+
+    // The variants of a device are dealt to its jobs in turn, every job reports to its own stream
+    std::map<int, std::vector<std::vector<BuildVariant*>>> deviceJobs;
+    std::map<int, int> dealt;
+    for (auto& v : variants)
+    {
+        auto& jobVariants = deviceJobs[v.device];
+        const int j = dealt[v.device]++ % jobs;
+        if (j == static_cast<int>(jobVariants.size()))
+        {
+            jobVariants.emplace_back();
+        }
+        jobVariants[j].push_back(&v);
+    }
+    std::vector<std::ostringstream> errs;
+    for (const auto& d : deviceJobs)
+    {
+        errs.resize(errs.size() + d.second.size());
+    }
+
+    std::vector<std::thread> threads;
+    size_t job = 0;
+    for (const auto& d : deviceJobs)
+    {
+        for (const auto& jobVariants : d.second)
+        {
+            threads.emplace_back(
+                buildVariants, std::cref(model), sys, d.first, jobVariants, std::ref(errs[job++]));
+        }
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    cudaSetDevice(current);
+
+    for (const auto& e : errs)
+    {
+        err << e.str();
+    }
+    return std::all_of(variants.begin(), variants.end(), [](const BuildVariant& v) { return v.built; });
+}
+
 } // namespace sample
@@ -18,17 +18,23 @@
 #define TRT_SAMPLE_ENGINES_H
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "NvInfer.h"
 #include "NvCaffeParser.h"
 #include "NvOnnxParser.h"
 #include "NvUffParser.h"
 
+#include "sampleFormats.h"
+#include "sampleRoofline.h"
 #include "sampleUtils.h"
 
 namespace sample
 {
 
+struct StartupTimes;
+
 struct Parser
 {
     TrtUniquePtr<nvcaffeparser1::ICaffeParser> caffeParser;
@@ -54,39 +60,140 @@ Parser modelToNetwork(const ModelOptions& model, nvinfer1::INetworkDefinition& n
 //!
 //! \brief Create an engine for a network defintion
 //!
+//! \param modelHash Hash of the model files, a calibration cache is only used if it was written for the same model.
+//!        An empty hash accepts the cache of any model with the same inputs.
+//!
 //! \return Pointer to the engine created or nullptr if the creation failed
 //!
 nvinfer1::ICudaEngine* networkToEngine(const BuildOptions& build, const SystemOptions& sys, nvinfer1::IBuilder& builder,
-    nvinfer1::INetworkDefinition& network, std::ostream& err);
+    nvinfer1::INetworkDefinition& network, std::ostream& err, const std::string& modelHash = "");
 
 //!
 //! \brief Create an engine for a given model
 //!
+//! \param allocator Device allocator for the builder, nullptr for the default one
+//!
 //! \return Pointer to the engine created or nullptr if the creation failed
 //!
-nvinfer1::ICudaEngine* modelToEngine(
-    const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys, std::ostream& err);
+nvinfer1::ICudaEngine* modelToEngine(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys,
+    std::ostream& err, nvinfer1::IGpuAllocator* allocator = nullptr);
 
 //!
 //! \brief Load a serialized engine
 //!
+//! \param allocator Device allocator for the runtime, nullptr for the default one
+//! \param startup Set to the read, decompression and deserialization times if not nullptr
+//!
+//! Compressed plan files are recognized by their header, decompressed and checked against their checksum.
+//!
 //! \return Pointer to the engine loaded or nullptr if the operation failed
 //!
-nvinfer1::ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& err);
+nvinfer1::ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& err,
+    nvinfer1::IGpuAllocator* allocator = nullptr, StartupTimes* startup = nullptr);
+
+//!
+//! \brief Load a serialized engine as loadEngine does, with its messages written to the given streams
+//!
+//! Engines read on several threads at once each write to their own streams, the caller logs them in order.
+//!
+nvinfer1::ICudaEngine* readEngine(const std::string& engine, int DLACore, std::ostream& err, std::ostream& info,
+    std::ostream& verbose, nvinfer1::IGpuAllocator* allocator = nullptr, StartupTimes* startup = nullptr);
 
 //!
 //! \brief Save an engine into a file
 //!
+//! \param compression The zlib level of a compressed plan file, 0 to save the plan as serialized
+//!
 //! \return boolean Return true if the engine was successfully saved
 //!
-bool saveEngine(const nvinfer1::ICudaEngine& engine, const std::string& fileName, std::ostream& err);
+bool saveEngine(
+    const nvinfer1::ICudaEngine& engine, const std::string& fileName, std::ostream& err, int compression = 0);
 
 //!
 //! \brief Create an engine from model or serialized file, and optionally save engine
 //!
+//! \param allocator Device allocator for building or loading the engine, it must outlive the engine
+//! \param startup Set to the load or build times if not nullptr
+//!
 //! \return Pointer to the engine created or nullptr if the creation failed
 //!
-TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys, std::ostream& err);
+TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(const ModelOptions& model, const BuildOptions& build,
+    const SystemOptions& sys, std::ostream& err, nvinfer1::IGpuAllocator* allocator = nullptr,
+    StartupTimes* startup = nullptr);
+
+//!
+//! \brief Deserialize a copy of an engine on each of the given devices, the current device is restored
+//!
+//! \return The engines in the order of the devices, or an empty vector if a deserialization failed
+//!
+std::vector<TrtUniquePtr<nvinfer1::ICudaEngine>> replicateEngine(
+    const nvinfer1::ICudaEngine& engine, const std::vector<int>& devices, std::ostream& err);
+
+//!
+//! \brief Parse a model and list the names of its layers, in network order
+//!
+bool getLayerNames(
+    const ModelOptions& model, const BuildOptions& build, std::vector<std::string>& names, std::ostream& err);
+
+//!
+//! \brief Parse a model and estimate the operations and bytes of its layers, \see estimateLayerCosts
+//!
+//! The floating point layers are assumed to run in the fastest precision the build options enable.
+//!
+bool getLayerCosts(const ModelOptions& model, const BuildOptions& build, int batch, LayerCosts& costs,
+    std::ostream& err);
+
+//!
+//! \brief Parse a model and describe its I/O tensors and the tensors of its layers
+//!
+bool describeNetwork(
+    const ModelOptions& model, const BuildOptions& build, NetworkDescription& description, std::ostream& err);
+
+//!
+//! \brief Write per-layer precisions in the format read by --layerPrecisions, in the given order
+//!
+bool saveLayerPrecisions(const std::vector<std::pair<std::string, nvinfer1::DataType>>& precisions,
+    const std::string& fileName, std::ostream& err);
+
+//!
+//! \brief Refit a refittable engine with the weights of a model, matching its layers and weights roles by name
+//!
+//! \return boolean Return true if the model has weights for all the refittable weights and the engine was refitted
+//!
+bool refitEngine(nvinfer1::ICudaEngine& engine, const ModelOptions& model, std::ostream& err);
+
+//!
+//! \struct BuildVariant
+//! \brief One configuration of a build matrix, with the results of its build
+//!
+struct BuildVariant
+{
+    std::string name;  //!< Precision and batch size, e.g. fp16.b8
+    BuildOptions build;
+    int batch{0};      //!< Batch size of the variant, 0 for the batch options as given
+    int device{0};
+    std::string plan;  //!< File the engine is saved to
+    bool built{false};
+    float buildMs{0};
+    size_t planSize{0};
+};
+
+//!
+//! \brief Expand the build matrix of the build options into one variant per precision and batch size
+//!
+//! The variants are assigned to the devices in turn and run with 1/buildJobs of the workspace.
+//!
+std::vector<BuildVariant> makeBuildVariants(const BuildOptions& build, const std::vector<int>& devices);
+
+//!
+//! \brief Build and save the engines of the variants, concurrently on their devices
+//!
+//! Each build job parses the model once and builds its variants in turn, there are buildJobs jobs per device.
+//!
+//! \return boolean Return true if all the variants were built and saved
+//!
+bool buildEngineMatrix(const ModelOptions& model, const SystemOptions& sys, int jobs, std::vector<BuildVariant>& variants,
+    std::ostream& err);
 
 } // namespace sample
 
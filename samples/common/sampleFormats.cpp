@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+
+#include "HostReformat.h"
+#include "half.h"
+#include "sampleFormats.h"
+#include "sampleReporting.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//!
+//! \brief Set the vector size and whether the channels are the innermost dimension for a tensor format
+//!
+void formatLayout(nvinfer1::TensorFormats formats, int& vector, bool& channelsLast)
+{
+    vector = 1;
+    channelsLast = false;
+    if (formats & (1U << static_cast<int>(nvinfer1::TensorFormat::kCHW2)))
+    {
+        vector = 2;
+    }
+    else if (formats & (1U << static_cast<int>(nvinfer1::TensorFormat::kHWC8)))
+    {
+        vector = 8;
+        channelsLast = true;
+    }
+    else if (formats & (1U << static_cast<int>(nvinfer1::TensorFormat::kCHW4)))
+    {
+        vector = 4;
+    }
+    else if (formats & (1U << static_cast<int>(nvinfer1::TensorFormat::kCHW16)))
+    {
+        vector = 16;
+    }
+    else if (formats & (1U << static_cast<int>(nvinfer1::TensorFormat::kCHW32)))
+    {
+        vector = 32;
+    }
+}
+
+//!
+//! \brief The layer or binding a reformat layer serves, from its name
+//!
+//! \return False if the name is not the one of a reformat of a layer input or output
+//!
+bool parseReformat(const std::string& name, std::string& layer, bool& input, int& index)
+{
+    // "<layer> input reformatter <i>" and "<layer> output reformatter <i>"
+    for (const bool in : {true, false})
+    {
+        const std::string marker{in ? " input reformatter " : " output reformatter "};
+        const auto at = name.rfind(marker);
+        if (at != std::string::npos)
+        {
+            layer = name.substr(0, at);
+            input = in;
+            index = std::atoi(name.c_str() + at + marker.size());
+            return true;
+        }
+    }
+    // "Reformatting CopyNode for Input Tensor <i> to <layer>"
+    const std::string prefix{"Reformatting CopyNode for "};
+    const auto tensor = name.find("Tensor ", prefix.size());
+    const auto to = name.find(" to ", prefix.size());
+    if (name.compare(0, prefix.size(), prefix) || tensor == std::string::npos || to == std::string::npos)
+    {
+        return false;
+    }
+    input = !name.compare(prefix.size(), 5, "Input");
+    index = std::atoi(name.c_str() + tensor + 7);
+    layer = name.substr(to + 4);
+    return true;
+}
+
+//!
+//! \brief The group of a reformat, after the binding, plugin or layer whose tensor it converts
+//!
+std::string reformatGroup(const std::string& name, const NetworkDescription* network)
+{
+    std::string layer;
+    bool input{false};
+    int index{0};
+    if (!parseReformat(name, layer, input, index))
+    {
+        return "unattributed";
+    }
+    if (!network)
+    {
+        return "layer " + layer;
+    }
+    // Fused layers are named after their parts, the first one reads the inputs and the last one writes the outputs
+    const std::string separator{" + "};
+    const auto first = layer.find(separator);
+    const auto last = layer.rfind(separator);
+    const std::string part = input ? layer.substr(0, first)
+                                   : last == std::string::npos ? layer : layer.substr(last + separator.size());
+    const auto description = network->layers.find(part);
+    if (description == network->layers.end())
+    {
+        return "layer " + layer;
+    }
+    const auto& tensors = input ? description->second.inputs : description->second.outputs;
+    if (index >= 0 && index < static_cast<int>(tensors.size()))
+    {
+        const auto& io = input ? network->inputs : network->outputs;
+        const auto& tensor = tensors[index];
+        if (std::any_of(io.begin(), io.end(), [&tensor](const NetworkTensor& t) { return t.name == tensor; }))
+        {
+            return "binding " + tensor;
+        }
+    }
+    return (description->second.plugin ? "plugin " : "layer ") + layer;
+}
+
+bool isReformat(const std::string& name)
+{
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    return lower.find("reformat") != std::string::npos || lower.find("copy") != std::string::npos;
+}
+
+} // namespace
+
+bool formatFits(const NetworkTensor& tensor, bool implicitBatch, const IOFormat& format)
+{
+    const bool linear = format.second == 1U << static_cast<int>(nvinfer1::TensorFormat::kLINEAR);
+    const bool floating = tensor.type == nvinfer1::DataType::kFLOAT || tensor.type == nvinfer1::DataType::kHALF;
+    const int minDims = implicitBatch ? 3 : 4;
+    return floating && (linear || tensor.dims.nbDims >= minDims);
+}
+
+float hostConversionMs(const nvinfer1::Dims& dims, int batch, const IOFormat& format, bool toFormat)
+{
+    int vector{1};
+    bool channelsLast{false};
+    formatLayout(format.second, vector, channelsLast);
+    if (format.first == nvinfer1::DataType::kFLOAT && vector == 1)
+    {
+        return 0;
+    }
+    samplesCommon::HostTensorLayout layout;
+    layout.batch = batch;
+    for (int d = 0; d < dims.nbDims; ++d)
+    {
+        const int e = dims.nbDims - d;
+        int& target = e > 3 ? layout.batch : e == 3 ? layout.channels : layout.area;
+        target *= std::max(dims.d[d], 1);
+    }
+    layout.vector = vector;
+    layout.channelsLast = channelsLast;
+    const size_t padded = layout.formattedVolume();
+    std::vector<float> linear(layout.linearVolume(), 0.5F);
+
+    // The conversions of an application using the host reformat library, on all the CPUs. The scale of the I/O
+    // tensors is the one set by the builder of trtexec when no calibration is given.
+    constexpr float kINT8_SCALE{2.0F / 127};
+    constexpr int kRUNS{3};
+    using clock = std::chrono::high_resolution_clock;
+    std::chrono::duration<float, std::milli> total{0};
+    std::vector<half_float::half> halves(format.first == nvinfer1::DataType::kHALF ? padded : 0);
+    std::vector<int8_t> bytes(format.first == nvinfer1::DataType::kINT8 ? padded : 0);
+    std::vector<float> floats(format.first == nvinfer1::DataType::kFLOAT ? padded : 0);
+    // The first run pages the buffers in
+    for (int r = 0; r <= kRUNS; ++r)
+    {
+        const auto start = clock::now();
+        switch (format.first)
+        {
+        case nvinfer1::DataType::kHALF:
+            if (toFormat)
+            {
+                samplesCommon::packHost(linear.data(), halves.data(), layout, samplesCommon::FloatToHalf{});
+            }
+            else
+            {
+                samplesCommon::unpackHost(halves.data(), linear.data(), layout, samplesCommon::HalfToFloat{});
+            }
+            break;
+        case nvinfer1::DataType::kINT8:
+            if (toFormat)
+            {
+                samplesCommon::packHost(linear.data(), bytes.data(), layout, samplesCommon::FloatToInt8(kINT8_SCALE));
+            }
+            else
+            {
+                samplesCommon::unpackHost(
+                    bytes.data(), linear.data(), layout, samplesCommon::Int8ToFloat(kINT8_SCALE));
+            }
+            break;
+        default:
+            if (toFormat)
+            {
+                samplesCommon::packHost(linear.data(), floats.data(), layout, samplesCommon::CopyValues{});
+            }
+            else
+            {
+                samplesCommon::unpackHost(floats.data(), linear.data(), layout, samplesCommon::CopyValues{});
+            }
+            break;
+        }
+        if (r)
+        {
+            total += clock::now() - start;
+        }
+    }
+    return total.count() / kRUNS;
+}
+
+void printReformatReport(const Profiler& profiler, const NetworkDescription* network, std::ostream& os)
+{
+    struct Group
+    {
+        std::string name;
+        int reformats{0};
+        float ms{0};
+    };
+    std::vector<Group> groups;
+    float totalMs{0};
+    float reformatMs{0};
+    int reformats{0};
+    for (const auto& layer : profiler.aggregate())
+    {
+        const float ms = layer.timeMs / std::max<size_t>(layer.timesMs.size(), 1);
+        totalMs += ms;
+        if (!isReformat(layer.name))
+        {
+            continue;
+        }
+        const std::string name = reformatGroup(layer.name, network);
+        auto group = std::find_if(groups.begin(), groups.end(), [&name](const Group& g) { return g.name == name; });
+        if (group == groups.end())
+        {
+            groups.emplace_back();
+            groups.back().name = name;
+            group = groups.end() - 1;
+        }
+        ++group->reformats;
+        group->ms += ms;
+        reformatMs += ms;
+        ++reformats;
+    }
+    std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.ms > b.ms; });
+    const auto percent = [totalMs](float ms) { return totalMs > 0 ? ms / totalMs * 100 : 0; };
+
+    os << "=== Reformats ===" << std::endl;
+    os << reformats << " reformat layers, " << std::fixed << std::setprecision(3) << reformatMs << " ms per inference, "
+       << std::setprecision(1) << percent(reformatMs) << "% of the layer time" << std::endl;
+    for (const auto& g : groups)
+    {
+        os << g.name << ": " << g.reformats << (g.reformats > 1 ? " reformats, " : " reformat, ")
+           << std::setprecision(3) << g.ms << " ms, " << std::setprecision(1) << percent(g.ms) << "%" << std::endl;
+    }
+}
+
+} // namespace sample
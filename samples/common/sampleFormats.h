@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_FORMATS_H
+#define TRT_SAMPLE_FORMATS_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NvInfer.h"
+#include "sampleOptions.h"
+
+namespace sample
+{
+
+class Profiler;
+
+//!
+//! \struct NetworkTensor
+//! \brief An input or output of a network, before the build
+//!
+struct NetworkTensor
+{
+    std::string name;
+    nvinfer1::DataType type{nvinfer1::DataType::kFLOAT};
+    nvinfer1::Dims dims{};
+};
+
+//!
+//! \struct NetworkDescription
+//! \brief The I/O tensors of a network, and the tensors each layer reads and writes
+//!
+struct NetworkDescription
+{
+    struct Layer
+    {
+        std::vector<std::string> inputs;  //!< Names of the input tensors, empty for missing optional inputs
+        std::vector<std::string> outputs; //!< Names of the output tensors
+        bool plugin{false};
+    };
+
+    bool implicitBatch{false};
+    std::vector<NetworkTensor> inputs;
+    std::vector<NetworkTensor> outputs;
+    std::unordered_map<std::string, Layer> layers; //!< By layer name
+};
+
+//!
+//! \brief Whether a tensor can take a format: vectorized formats require a floating point tensor with CHW dimensions
+//!
+bool formatFits(const NetworkTensor& tensor, bool implicitBatch, const IOFormat& format);
+
+//!
+//! \brief Measure the host time to convert a linear fp32 tensor to the type and layout of a format, or back from them
+//!
+//! This is the cost of an application feeding the tensor from, or reading it into, linear fp32 data on the host with
+//! the conversions of HostReformat.h. The vectorized dimension is the channel one, the third from the end, padded to
+//! the vector size.
+//!
+//! \param dims The dimensions of the binding, without the batch for implicit batch engines
+//! \param batch The batch of implicit batch engines, 1 otherwise
+//! \param toFormat Convert from linear fp32 to the format if true, from the format to linear fp32 otherwise
+//!
+//! \return The time of one conversion in ms, 0 for linear fp32
+//!
+float hostConversionMs(const nvinfer1::Dims& dims, int batch, const IOFormat& format, bool toFormat);
+
+//!
+//! \brief Print the time of the reformat layers of a profile, grouped by the layer or binding each serves
+//!
+//! TensorRT names reformat layers after the layer whose input or output they convert. With the description of the
+//! network, reformats of layer inputs and outputs that are network I/O are attributed to the binding, those of plugin
+//! layers to the plugin. Other layers named as copies or reformats are grouped as unattributed.
+//!
+//! \param network The description of the network, or nullptr to attribute reformats to layers by name only
+//!
+void printReformatReport(const Profiler& profiler, const NetworkDescription* network, std::ostream& os);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_FORMATS_H
@@ -15,57 +15,273 @@
  */
 
 #include <array>
+#include <atomic>
 #include <vector>
 #include <numeric>
 #include <algorithm>
 #include <utility>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <random>
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <chrono>
+#include <iterator>
+#include <sstream>
 
 #include "NvInfer.h"
 
 #include "logger.h"
+#include "nvtxRange.h"
 #include "sampleDevice.h"
 #include "sampleUtils.h"
 #include "sampleOptions.h"
 #include "sampleReporting.h"
+#include "sampleConvergence.h"
 #include "sampleInference.h"
 
 namespace sample
 {
 
-void setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inference)
+namespace
 {
-    for (int s = 0; s < inference.streams; ++s)
+
+MemoryType toMemoryType(InputMemory memory)
+{
+    switch (memory)
     {
-        iEnv.context.emplace_back(iEnv.engine->createExecutionContext());
-        iEnv.bindings.emplace_back(new Bindings);
+    case InputMemory::kMAPPED: return MemoryType::kMAPPED;
+    case InputMemory::kMANAGED: return MemoryType::kMANAGED;
+    case InputMemory::kDEVICE: break;
     }
-    if (iEnv.profiler)
+    return MemoryType::kDEVICE;
+}
+
+TransferEncoding toTransferEncoding(const std::string& name)
+{
+    return name == "fp16" ? TransferEncoding::kFP16
+        : name == "int16" ? TransferEncoding::kINT16
+        : name == "int8"  ? TransferEncoding::kINT8
+        : name == "mask"  ? TransferEncoding::kMASK : TransferEncoding::kNONE;
+}
+
+//!
+//! \brief Select the unused optimization profile whose opt shapes are the closest to the given input shapes
+//!
+//! \return The index of the profile or -1 if no unused profile accepts the shapes
+//!
+int selectProfile(const nvinfer1::ICudaEngine& engine, const InputShapes& shapes, const std::vector<bool>& usedProfiles)
+{
+    const int nbProfiles = std::max(engine.getNbOptimizationProfiles(), 1);
+    const int bindingsInProfile = engine.getNbBindings() / nbProfiles;
+
+    int best = -1;
+    int bestDistance = std::numeric_limits<int>::max();
+    for (int p = 0; p < nbProfiles; ++p)
+    {
+        if (usedProfiles[p])
+        {
+            continue;
+        }
+        bool fits = true;
+        int distance = 0;
+        for (int b = 0; b < bindingsInProfile && fits; ++b)
+        {
+            const auto shape = shapes.find(engine.getBindingName(b));
+            if (!engine.bindingIsInput(b) || engine.isShapeBinding(b) || shape == shapes.end())
+            {
+                continue;
+            }
+            const int binding = b + p * bindingsInProfile;
+            const auto min = engine.getProfileDimensions(binding, p, nvinfer1::OptProfileSelector::kMIN);
+            const auto opt = engine.getProfileDimensions(binding, p, nvinfer1::OptProfileSelector::kOPT);
+            const auto max = engine.getProfileDimensions(binding, p, nvinfer1::OptProfileSelector::kMAX);
+            const auto& dims = shape->second;
+            fits = dims.nbDims == min.nbDims;
+            for (int d = 0; d < dims.nbDims && fits; ++d)
+            {
+                fits = min.d[d] <= dims.d[d] && dims.d[d] <= max.d[d];
+            }
+            distance += std::abs(volume(opt) - volume(dims));
+        }
+        if (fits && distance < bestDistance)
+        {
+            best = p;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+//!
+//! \brief Allocate a binding set of a context bound to the profile of the bindings from offset on
+//!
+//! \param first The sample streamed inputs start from
+//!
+bool setUpBindings(const nvinfer1::ICudaEngine& engine, const nvinfer1::IExecutionContext& context,
+    const InferenceOptions& inference, int offset, int batch, size_t first, const Bindings* source, Bindings& bindings)
+{
+    // Replay and tiling write the device buffers of the inputs of each query, the generated ones included
+    const bool shareDevice = inference.replay.empty() && !inference.tiledHeight;
+    const int nbProfiles = std::max(engine.getNbOptimizationProfiles(), 1);
+    const int bindingsInProfile = engine.getNbBindings() / nbProfiles;
+    std::vector<std::pair<int, std::string>> datasets;
+    for (int b = 0; b < bindingsInProfile; ++b)
+    {
+        const int binding = b + offset;
+        const auto dims = context.getBindingDimensions(binding);
+        const auto vecDim = engine.getBindingVectorizedDim(binding);
+        const auto comps = engine.getBindingComponentsPerElement(binding);
+        const auto dataType = engine.getBindingDataType(binding);
+        const auto vol = volume(dims, vecDim, comps, batch);
+        const auto name = engine.getBindingName(b);
+        const auto isInput = engine.bindingIsInput(binding);
+        const auto input = inference.inputs.find(name);
+        auto fileName = isInput && input != inference.inputs.end() ? input->second : "";
+        if (inference.streamInputs && !fileName.empty())
+        {
+            datasets.emplace_back(binding, fileName);
+            fileName.clear();
+        }
+        const auto generation = !inference.deviceInputs ? InputGeneration::kHOST
+            : inference.mirrorInputs ? InputGeneration::kDEVICE_MIRRORED : InputGeneration::kDEVICE;
+        bindings.addBinding(binding, name, isInput, vol, dataType, fileName, toMemoryType(inference.inputMemory),
+            generation, source, shareDevice);
+    }
+    for (const auto& compact : inference.compactOutputs)
+    {
+        // The rows are the outermost dimension of a batch item, after the batch dimension of explicit batch engines
+        const int b = engine.getBindingIndex(compact.first.c_str());
+        const int rowDim = inference.batch ? 0 : 1;
+        const auto dims = b < 0 ? nvinfer1::Dims{} : context.getBindingDimensions(b + offset);
+        if (dims.nbDims <= rowDim || !bindings.setCompactOutput(compact.first, compact.second, dims.d[rowDim]))
+        {
+            gLogError << "Output " << compact.first << " cannot be copied up to the INT32 count of each batch item in "
+                      << compact.second << std::endl;
+            return false;
+        }
+    }
+    if (!datasets.empty())
+    {
+        try
+        {
+            bindings.streamInputs(datasets, inference.prefetchDepth, first);
+        }
+        catch (const std::runtime_error& e)
+        {
+            gLogError << e.what() << std::endl;
+            return false;
+        }
+    }
+    for (const auto& encoding : inference.transferEncodings)
+    {
+        if (!bindings.setTransferEncoding(
+                encoding.first, toTransferEncoding(encoding.second), inference.maskThreshold))
+        {
+            gLogError << "Binding " << encoding.first << " cannot be transferred as " << encoding.second << std::endl;
+            return false;
+        }
+    }
+    if (inference.packTransfers)
+    {
+        bindings.packTransfers();
+    }
+
+    return true;
+}
+
+//!
+//! \brief Divide the batch dimension of the inputs of an explicit batch context by the number of micro-batches
+//!
+bool setMicroBatchShapes(const nvinfer1::ICudaEngine& engine, nvinfer1::IExecutionContext& context, int microBatches,
+    int offset, int bindingsInProfile)
+{
+    for (int b = offset; b < offset + bindingsInProfile; ++b)
+    {
+        if (!engine.bindingIsInput(b))
+        {
+            continue;
+        }
+        auto dims = context.getBindingDimensions(b);
+        const std::string name = engine.getBindingName(b);
+        if (engine.isShapeBinding(b) || dims.nbDims < 1 || dims.d[0] % microBatches)
+        {
+            gLogError << "Micro-batches require a batch dimension that is a multiple of " << microBatches
+                      << " for input " << name << std::endl;
+            return false;
+        }
+        dims.d[0] /= microBatches;
+        if (!context.setBindingDimensions(b, dims))
+        {
+            gLogError << "The profile of the context does not accept the micro-batch " << dims << " of input " << name
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+//!
+//! \brief Bind the context of a stream to a profile, set its input dimensions and allocate its bindings
+//!
+bool setUpStream(InferenceEnvironment& iEnv, const InferenceOptions& inference, int stream, std::vector<bool>& usedProfiles)
+{
+    auto& engine = *iEnv.engine;
+    auto& context = *iEnv.context[stream];
+    const InputShapes noShapes;
+    const auto& shapes = inference.shapes.empty() ? noShapes : inference.shapes[stream % inference.shapes.size()];
+    // Report missing shapes only once for each set of shapes, drawn shapes replace them with shape churn
+    const bool warn = static_cast<size_t>(stream) < std::max(inference.shapes.size(), static_cast<size_t>(1))
+        && inference.shapeChurn.empty();
+
+    // Execution contexts cannot share a profile, so with multiple profiles each stream is bound to its own
+    const int nbProfiles = std::max(engine.getNbOptimizationProfiles(), 1);
+    const int bindingsInProfile = engine.getNbBindings() / nbProfiles;
+    int profile = 0;
+    if (nbProfiles > 1)
     {
-        iEnv.context.front()->setProfiler(iEnv.profiler.get());
+        profile = selectProfile(engine, shapes, usedProfiles);
+        if (profile < 0)
+        {
+            gLogError << "No unused optimization profile accepts the input shapes of stream " << stream << std::endl;
+            return false;
+        }
+        if (!context.setOptimizationProfile(profile))
+        {
+            gLogError << "Failed to set optimization profile " << profile << " for stream " << stream << std::endl;
+            return false;
+        }
+        usedProfiles[profile] = true;
+        gLogInfo << "Stream " << stream << " bound to optimization profile " << profile << std::endl;
     }
+    const int offset = profile * bindingsInProfile;
+    // The replay sets the shapes of each request, the bindings are allocated for the largest ones before
+    std::vector<std::pair<int, nvinfer1::Dims>> configuredDims;
 
     // Set all input dimensions before all bindings can be allocated
-    for (int b = 0; b < iEnv.engine->getNbBindings(); ++b)
+    for (int b = 0; b < bindingsInProfile; ++b)
     {
-        if (iEnv.engine->bindingIsInput(b))
+        const int binding = b + offset;
+        if (engine.bindingIsInput(binding))
         {
-            auto dims = iEnv.context.front()->getBindingDimensions(b);
-            const bool isDynamicInput = std::any_of(dims.d, dims.d + dims.nbDims, [](int dim){ return dim == -1; }) || iEnv.engine->isShapeBinding(b);
+            auto dims = context.getBindingDimensions(binding);
+            const bool isDynamicInput = std::any_of(dims.d, dims.d + dims.nbDims, [](int dim){ return dim == -1; }) || engine.isShapeBinding(binding);
             if (isDynamicInput)
             {
-                auto shape = inference.shapes.find(iEnv.engine->getBindingName(b));
+                auto shape = shapes.find(engine.getBindingName(b));
 
                 // If no shape is provided, set dynamic dimensions to 1.
                 nvinfer1::Dims staticDims{};
-                if (shape == inference.shapes.end())
+                if (shape == shapes.end())
                 {
                     constexpr int DEFAULT_DIMENSION = 1;
-                    if (iEnv.engine->isShapeBinding(b))
+                    if (engine.isShapeBinding(binding))
                     {
                         staticDims.nbDims = dims.d[0];
                         std::fill(staticDims.d, staticDims.d + staticDims.nbDims, DEFAULT_DIMENSION);
@@ -75,50 +291,442 @@ void setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inferenc
                         staticDims.nbDims = dims.nbDims;
                         std::transform(dims.d, dims.d + dims.nbDims, staticDims.d, [&](int dim) { return dim > 0 ? dim : DEFAULT_DIMENSION; });
                     }
-                    gLogWarning << "Dynamic dimensions required for input: " << iEnv.engine->getBindingName(b) << ", but no shapes were provided. Automatically overriding shape to: " << staticDims << std::endl;
+                    if (warn)
+                    {
+                        gLogWarning << "Dynamic dimensions required for input: " << engine.getBindingName(b) << ", but no shapes were provided. Automatically overriding shape to: " << staticDims << std::endl;
+                    }
                 }
                 else
                 {
                     staticDims = shape->second;
                 }
 
-                for (auto& c : iEnv.context)
+                if (!inference.replay.empty() && !engine.isShapeBinding(binding))
                 {
-                    if (iEnv.engine->isShapeBinding(b))
+                    configuredDims.emplace_back(binding, staticDims);
+                }
+                if ((!inference.shapeChurn.empty() || !inference.replay.empty()) && !engine.isShapeBinding(binding))
+                {
+                    // Allocate for the largest shapes of the profile, the shapes of each query are set at its enqueue
+                    staticDims = engine.getProfileDimensions(binding, profile, nvinfer1::OptProfileSelector::kMAX);
+                }
+
+                if (inference.dynamicBatching && !engine.isShapeBinding(binding))
+                {
+                    // Allocate for the largest batch of the profile, the batch dimension is set at each enqueue
+                    if (dims.d[0] != -1)
                     {
-                        c->setInputShapeBinding(b, staticDims.d);
+                        gLogError << "Dynamic batching requires a dynamic batch dimension for input: "
+                                  << engine.getBindingName(b) << std::endl;
+                        return false;
                     }
-                    else
+                    staticDims.d[0] = engine.getProfileDimensions(binding, profile, nvinfer1::OptProfileSelector::kMAX).d[0];
+                    if (iEnv.maxBatch && iEnv.maxBatch != staticDims.d[0])
                     {
-                        c->setBindingDimensions(b, staticDims);
+                        gLogError << "Dynamic batching requires the same max batch dimension for all inputs" << std::endl;
+                        return false;
                     }
+                    iEnv.maxBatch = staticDims.d[0];
+                }
+
+                if (engine.isShapeBinding(binding))
+                {
+                    context.setInputShapeBinding(binding, staticDims.d);
+                }
+                else
+                {
+                    context.setBindingDimensions(binding, staticDims);
                 }
             }
         }
     }
 
-    for (int b = 0; b < iEnv.engine->getNbBindings(); ++b)
+    if (inference.dynamicBatching)
+    {
+        if (inference.batch)
+        {
+            iEnv.maxBatch = engine.getMaxBatchSize();
+        }
+        else if (!iEnv.maxBatch)
+        {
+            gLogError << "Dynamic batching requires an input with a dynamic batch dimension" << std::endl;
+            return false;
+        }
+    }
+    const int batch = inference.dynamicBatching && inference.batch ? iEnv.maxBatch : inference.batch;
+
+    for (int d = 0; d < inference.depth; ++d)
+    {
+        auto& bindings = d ? *iEnv.slotBindings[stream][d - 1] : *iEnv.bindings[stream];
+        // The inputs read or filled once for the first stream are shared by the slots and the other streams
+        const Bindings* source = d ? iEnv.bindings[stream].get() : stream ? iEnv.bindings.front().get() : nullptr;
+        // Streamed slots start apart, so that they do not all run the same sample
+        if (!setUpBindings(engine, context, inference, offset, batch, stream + d * inference.streams, source, bindings))
+        {
+            return false;
+        }
+    }
+
+    for (const auto& dims : configuredDims)
+    {
+        context.setBindingDimensions(dims.first, dims.second);
+    }
+
+    if (inference.microBatches > 1)
+    {
+        // The bindings are allocated for the whole batch above, each enqueue then runs one chunk of it
+        if (!inference.batch
+            && !setMicroBatchShapes(engine, context, inference.microBatches, offset, bindingsInProfile))
+        {
+            return false;
+        }
+        for (int d = 0; d < inference.depth; ++d)
+        {
+            (d ? *iEnv.slotBindings[stream][d - 1] : *iEnv.bindings[stream]).splitMicroBatches(inference.microBatches);
+        }
+    }
+
+    if (!inference.shapeChurn.empty())
+    {
+        iEnv.shapeSamplers.emplace_back(new ShapeSampler);
+        if (!iEnv.shapeSamplers.back()->setUp(context, inference, stream))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+constexpr int ShapeSampler::kUNIFORM_BUCKETS;
+
+bool ShapeSampler::setUp(const nvinfer1::IExecutionContext& context, const InferenceOptions& inference,
+    unsigned int seed)
+{
+    mEngine.seed(seed);
+    const auto& engine = context.getEngine();
+    const int bindingsInProfile = engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+    const int profile = std::max(context.getOptimizationProfile(), 0);
+    std::map<std::array<int, 3>, int> values; // Index of the value of each dimension index and profile range
+    for (int b = 0; b < bindingsInProfile; ++b)
+    {
+        const int binding = b + profile * bindingsInProfile;
+        if (!engine.bindingIsInput(binding) || engine.isShapeBinding(binding))
+        {
+            continue;
+        }
+        const auto dims = engine.getBindingDimensions(binding);
+        const bool isDynamic = std::any_of(dims.d, dims.d + dims.nbDims, [](int dim) { return dim == -1; });
+        Range range;
+        range.name = engine.getBindingName(b);
+        range.binding = binding;
+        using Selector = nvinfer1::OptProfileSelector;
+        range.min = isDynamic ? engine.getProfileDimensions(binding, profile, Selector::kMIN) : dims;
+        range.max = isDynamic ? engine.getProfileDimensions(binding, profile, Selector::kMAX) : dims;
+        for (int d = 0; d < dims.nbDims; ++d)
+        {
+            if (dims.d[d] != -1)
+            {
+                range.values.push_back(-1);
+                continue;
+            }
+            const std::array<int, 3> key{{d, range.min.d[d], range.max.d[d]}};
+            auto value = values.find(key);
+            if (value == values.end())
+            {
+                value = values.emplace(key, static_cast<int>(mValues.size())).first;
+                mValues.emplace_back(range.min.d[d], range.max.d[d]);
+            }
+            range.values.push_back(value->second);
+        }
+        mMinVolume += volume(range.min);
+        mMaxVolume += volume(range.max);
+        mRanges.push_back(range);
+    }
+    if (mValues.empty())
+    {
+        gLogError << "Shape churn requires an input with dynamic dimensions" << std::endl;
+        return false;
+    }
+
+    std::vector<double> counts;
+    for (size_t h = 0; h < inference.churnShapes.size(); ++h)
     {
-        const auto dims = iEnv.context.front()->getBindingDimensions(b);
-        const auto vecDim = iEnv.engine->getBindingVectorizedDim(b);
-        const auto comps = iEnv.engine->getBindingComponentsPerElement(b);
-        const auto dataType = iEnv.engine->getBindingDataType(b);
-        const auto vol = volume(dims, vecDim, comps, inference.batch);
-        const auto name = iEnv.engine->getBindingName(b);
-        const auto isInput = iEnv.engine->bindingIsInput(b);
-        for (auto& bindings : iEnv.bindings)
+        Shapes shapes;
+        bool fits{true};
+        for (const auto& s : inference.churnShapes[h].first)
         {
-            const auto input = inference.inputs.find(name);
-            if (isInput && input != inference.inputs.end())
+            const auto range = std::find_if(
+                mRanges.begin(), mRanges.end(), [&s](const Range& r) { return r.name == s.first; });
+            fits = fits && range != mRanges.end() && range->min.nbDims == s.second.nbDims;
+            for (int d = 0; fits && d < s.second.nbDims; ++d)
             {
-                bindings->addBinding(b, name, isInput, vol, dataType, input->second);
+                fits = range->min.d[d] <= s.second.d[d] && s.second.d[d] <= range->max.d[d];
             }
-            else
+            if (fits)
+            {
+                shapes.emplace_back(range->binding, s.second);
+            }
+        }
+        if (fits)
+        {
+            mShapes.push_back(shapes);
+            mBuckets.push_back(static_cast<int>(h));
+            counts.push_back(inference.churnShapes[h].second);
+        }
+    }
+    if (!inference.churnShapes.empty())
+    {
+        if (mShapes.empty())
+        {
+            gLogError << "No shape of " << inference.shapeChurn << " fits optimization profile " << profile
+                      << std::endl;
+            return false;
+        }
+        if (mShapes.size() < inference.churnShapes.size())
+        {
+            gLogWarning << inference.churnShapes.size() - mShapes.size() << " shapes of " << inference.shapeChurn
+                        << " do not fit optimization profile " << profile << " and are not drawn" << std::endl;
+        }
+        mPick = std::discrete_distribution<int>(counts.begin(), counts.end());
+    }
+    return true;
+}
+
+int ShapeSampler::draw(Shapes& shapes)
+{
+    if (!mShapes.empty())
+    {
+        const int s = mPick(mEngine);
+        shapes = mShapes[s];
+        return mBuckets[s];
+    }
+
+    std::vector<int> values(mValues.size());
+    for (size_t v = 0; v < mValues.size(); ++v)
+    {
+        values[v] = mValues[v](mEngine);
+    }
+    shapes.clear();
+    double drawnVolume{0};
+    for (const auto& r : mRanges)
+    {
+        nvinfer1::Dims dims = r.min;
+        for (int d = 0; d < dims.nbDims; ++d)
+        {
+            if (r.values[d] >= 0)
+            {
+                dims.d[d] = values[r.values[d]];
+            }
+        }
+        drawnVolume += volume(dims);
+        shapes.emplace_back(r.binding, dims);
+    }
+    const double span = mMaxVolume - mMinVolume;
+    const int bucket = span > 0 ? static_cast<int>((drawnVolume - mMinVolume) / span * kUNIFORM_BUCKETS) : 0;
+    return std::min(bucket, kUNIFORM_BUCKETS - 1);
+}
+
+std::vector<std::string> ShapeSampler::bucketNames(const InferenceOptions& inference)
+{
+    std::vector<std::string> names;
+    if (inference.churnShapes.empty())
+    {
+        for (int b = 0; b < kUNIFORM_BUCKETS; ++b)
+        {
+            names.push_back("Volume " + std::to_string(100 * b / kUNIFORM_BUCKETS) + "-"
+                + std::to_string(100 * (b + 1) / kUNIFORM_BUCKETS) + "% of the profile range");
+        }
+        return names;
+    }
+    for (const auto& entry : inference.churnShapes)
+    {
+        std::vector<std::pair<std::string, nvinfer1::Dims>> shapes(entry.first.begin(), entry.first.end());
+        std::sort(shapes.begin(), shapes.end(),
+            [](const std::pair<std::string, nvinfer1::Dims>& a, const std::pair<std::string, nvinfer1::Dims>& b) {
+                return a.first < b.first;
+            });
+        std::ostringstream name;
+        for (size_t s = 0; s < shapes.size(); ++s)
+        {
+            name << (s ? "," : "") << shapes[s].first << ":" << shapes[s].second;
+        }
+        names.push_back(name.str());
+    }
+    return names;
+}
+
+void SharedDeviceMemory::attach(nvinfer1::IExecutionContext& context)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    const size_t size = context.getEngine().getDeviceMemorySize();
+    mSeparateSize += size;
+    mContexts.push_back(&context);
+    if (size > mSize)
+    {
+        mBuffer.allocate(size);
+        mSize = size;
+        for (auto* c : mContexts)
+        {
+            c->setDeviceMemory(mBuffer.get());
+        }
+        return;
+    }
+    context.setDeviceMemory(mBuffer.get());
+}
+
+void SharedDeviceMemory::serialize(TrtCudaStream& stream, const std::function<void()>& compute)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    stream.wait(mLastCompute);
+    compute();
+    mLastCompute.record(stream);
+}
+
+bool setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inference)
+{
+    using clock = std::chrono::high_resolution_clock;
+    const auto contextsStart = clock::now();
+    if (iEnv.memoryAccount)
+    {
+        iEnv.memoryAccount->beginPhase("Contexts");
+    }
+    if (inference.shareMemory && !iEnv.sharedMemory)
+    {
+        iEnv.sharedMemory = std::make_shared<SharedDeviceMemory>();
+    }
+    if (inference.sharedCopyStreams && !iEnv.copyStreams)
+    {
+        iEnv.copyStreams = std::make_shared<CopyStreams>();
+    }
+    // Contexts created along with the engine by loadEngines are kept
+    for (int s = static_cast<int>(iEnv.context.size()); s < inference.streams; ++s)
+    {
+        if (iEnv.sharedMemory)
+        {
+            iEnv.context.emplace_back(iEnv.engine->createExecutionContextWithoutDeviceMemory());
+            iEnv.sharedMemory->attach(*iEnv.context.back());
+        }
+        else
+        {
+            iEnv.context.emplace_back(iEnv.engine->createExecutionContext());
+        }
+    }
+    const auto contextsEnd = clock::now();
+    if (iEnv.memoryAccount)
+    {
+        iEnv.memoryAccount->beginPhase("Bindings");
+    }
+    for (int s = 0; s < inference.streams; ++s)
+    {
+        iEnv.bindings.emplace_back(new Bindings);
+        iEnv.slotBindings.emplace_back();
+        for (int d = 1; d < inference.depth; ++d)
+        {
+            iEnv.slotBindings.back().emplace_back(new Bindings);
+        }
+    }
+
+    std::vector<bool> usedProfiles(std::max(iEnv.engine->getNbOptimizationProfiles(), 1), false);
+    for (int s = 0; s < inference.streams; ++s)
+    {
+        if (!setUpStream(iEnv, inference, s, usedProfiles))
+        {
+            return false;
+        }
+    }
+    if (!inference.replayRequests.empty())
+    {
+        iEnv.replay.reset(new ReplayTrace);
+        if (!iEnv.replay->setUp(inference.replayRequests, *iEnv.engine, gLogError))
+        {
+            return false;
+        }
+    }
+    if (inference.tiledHeight)
+    {
+        for (int s = 0; s < inference.streams; ++s)
+        {
+            std::vector<Bindings*> bindings{iEnv.bindings[s].get()};
+            for (const auto& slot : iEnv.slotBindings[s])
+            {
+                bindings.push_back(slot.get());
+            }
+            const auto inputs = bindings.front()->getInputBindings();
+            const auto input = inputs.empty() ? inference.inputs.end() : inference.inputs.find(inputs.begin()->first);
+            iEnv.tilings.emplace_back(new TiledInference);
+            if (!iEnv.tilings.back()->setUp(*iEnv.context[s], bindings, inference.batch, inference.tiledHeight,
+                    inference.tiledWidth, inference.tileOverlap, input == inference.inputs.end() ? "" : input->second,
+                    gLogError))
             {
-                bindings->addBinding(b, name, isInput, vol, dataType);
+                return false;
             }
         }
+        const auto& tiling = *iEnv.tilings.front();
+        gLogInfo << "Each query runs " << tiling.getTiles() << " tiles of the " << inference.tiledHeight << "x"
+                 << inference.tiledWidth << " image in " << tiling.getGroups() << " enqueues of batch "
+                 << tiling.getBatch() << std::endl;
     }
+    if (inference.batchAssembly)
+    {
+        for (int s = 0; s < inference.streams; ++s)
+        {
+            std::vector<Bindings*> bindings{iEnv.bindings[s].get()};
+            for (const auto& slot : iEnv.slotBindings[s])
+            {
+                bindings.push_back(slot.get());
+            }
+            iEnv.assemblies.emplace_back(new BatchAssembly);
+            if (!iEnv.assemblies.back()->setUp(bindings, iEnv.maxBatch, gLogError))
+            {
+                return false;
+            }
+        }
+    }
+    const auto bindingsEnd = clock::now();
+    if (iEnv.memoryAccount)
+    {
+        iEnv.memoryAccount->beginPhase("Inference");
+    }
+
+    if (inference.prewarm)
+    {
+        // Lazy initializations, such as library handles created at the first enqueue, happen before the timed run
+        TrtCudaStream stream;
+        for (int s = 0; s < inference.streams; ++s)
+        {
+            void** buffers = iEnv.bindings[s]->getDeviceBuffers();
+            const bool enqueued = inference.batch
+                ? iEnv.context[s]->enqueue(inference.batch, buffers, stream.get(), nullptr)
+                : iEnv.context[s]->enqueueV2(buffers, stream.get(), nullptr);
+            if (!enqueued)
+            {
+                gLogError << "Prewarm inference on stream " << s << " failed" << std::endl;
+                return false;
+            }
+        }
+        stream.synchronize();
+    }
+    const auto prewarmEnd = clock::now();
+
+    if (iEnv.profiler)
+    {
+        // Every context reports to its own profiler, the layer times are aggregated over all the streams
+        for (auto& context : iEnv.context)
+        {
+            context->setProfiler(iEnv.profiler->addContext());
+        }
+    }
+
+    const std::chrono::duration<float, std::milli> contextsTime = contextsEnd - contextsStart;
+    const std::chrono::duration<float, std::milli> bindingsTime = bindingsEnd - contextsEnd;
+    const std::chrono::duration<float, std::milli> prewarmTime = prewarmEnd - bindingsEnd;
+    iEnv.startup.contextsMs = contextsTime.count();
+    iEnv.startup.bindingsMs = bindingsTime.count();
+    iEnv.startup.prewarmMs = prewarmTime.count();
+    return true;
 }
 
 namespace {
@@ -129,9 +737,9 @@ namespace {
 //!
 struct SyncStruct
 {
-    std::mutex mutex;
     TrtCudaStream mainStream;
     TrtCudaEvent mainStart{cudaEventBlockingSync};
+    std::chrono::high_resolution_clock::time_point hostStart; //!< When mainStart was recorded, origin of the host times
     int sleep{0};
 };
 
@@ -146,9 +754,9 @@ public:
 
     explicit EnqueueImplicit(int batch): mBatch(batch) {}
 
-    void operator() (nvinfer1::IExecutionContext& context, void** buffers, TrtCudaStream& stream) const
+    void operator() (nvinfer1::IExecutionContext& context, void** buffers, TrtCudaStream& stream, int batch) const
     {
-        context.enqueue(mBatch, buffers, stream.get(), nullptr);
+        context.enqueue(batch ? batch : mBatch, buffers, stream.get(), nullptr);
     }
 
 private:
@@ -165,13 +773,16 @@ class EnqueueExplicit
 
 public:
 
-    void operator() (nvinfer1::IExecutionContext& context, void** buffers, TrtCudaStream& stream) const
+    void operator() (nvinfer1::IExecutionContext& context, void** buffers, TrtCudaStream& stream, int /*batch*/) const
     {
         context.enqueueV2(buffers, stream.get(), nullptr);
     }
 };
 
-using EnqueueFunction = std::function<void(nvinfer1::IExecutionContext&, void**, TrtCudaStream&)>;
+//!
+//! The last argument is the batch size of a dynamically gathered batch, 0 to run the configured batch or shapes
+//!
+using EnqueueFunction = std::function<void(nvinfer1::IExecutionContext&, void**, TrtCudaStream&, int)>;
 
 enum class StreamType : int
 {
@@ -192,52 +803,350 @@ enum class EventType : int
     kNUM = 6
 };
 
-using MultiStream = std::array<TrtCudaStream, static_cast<int>(StreamType::kNUM)>;
+using MultiStream = std::array<std::unique_ptr<TrtCudaStream>, static_cast<int>(StreamType::kNUM)>;
 
 using MultiEvent = std::array<std::unique_ptr<TrtCudaEvent>, static_cast<int>(EventType::kNUM)>;
 
+class Iteration;
+
 //!
-//! \class Iteration
-//! \brief Inference iteration and streams management
+//! \class CompletionQueue
+//! \brief Iterations whose oldest query completed, in completion order, pushed by host functions on their streams
 //!
-class Iteration
+//! One host thread can then keep many streams busy and serve the completions in any order, instead of waiting for
+//! the streams in turn. The host functions only queue the iteration, CUDA calls are not allowed in them.
+//!
+class CompletionQueue
 {
-
 public:
+    void push(Iteration* iteration)
+    {
+        // Notified under the lock: once pop returns the last completion the queue may be destroyed, which must not
+        // happen while a host function still uses the condition
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCompleted.push_back(iteration);
+        mCondition.notify_one();
+    }
+
+    Iteration* pop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return !mCompleted.empty(); });
+        Iteration* iteration = mCompleted.front();
+        mCompleted.pop_front();
+        return iteration;
+    }
+
+    //!
+    //! \brief Queue iteration once the work enqueued so far on stream is done
+    //!
+    void notify(TrtCudaStream& stream, Iteration* iteration);
+
+private:
+    struct Notice
+    {
+        CompletionQueue* queue;
+        Iteration* iteration;
+    };
+
+#if CUDA_VERSION < 10000
+    static void complete(cudaStream_t /*stream*/, cudaError_t /*status*/, void* notice)
+#else
+    static void complete(void* notice)
+#endif
+    {
+        const auto* n = static_cast<const Notice*>(notice);
+        n->queue->push(n->iteration);
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Iteration*> mCompleted;
+    std::list<Notice> mNotices; // One per iteration, their addresses are passed to the host functions
+};
+
+//!
+//! \class GraphCache
+//! \brief Least recently used cache of CUDA graphs capturing an enqueue, keyed by profile and input shapes
+//!
+class GraphCache
+{
+
+public:
+
+    using Key = std::vector<int>;
+
+    explicit GraphCache(int capacity): mCapacity(capacity) {}
+
+    //!
+    //! \return The graph captured for the key, or nullptr if it is not in the cache
+    //!
+    TrtCudaGraph* find(const Key& key)
+    {
+        auto entry = mIndex.find(key);
+        if (entry == mIndex.end())
+        {
+            ++mMisses;
+            return nullptr;
+        }
+        ++mHits;
+        mGraphs.splice(mGraphs.begin(), mGraphs, entry->second);
+        return mGraphs.front().second.get();
+    }
+
+    //!
+    //! \brief Add an empty graph for the key, evicting the least recently used one if the cache is full
+    //!
+    TrtCudaGraph& insert(const Key& key)
+    {
+        if (static_cast<int>(mGraphs.size()) >= mCapacity)
+        {
+            mIndex.erase(mGraphs.back().first);
+            mGraphs.pop_back();
+            ++mEvictions;
+        }
+        mGraphs.emplace_front(key, std::unique_ptr<TrtCudaGraph>(new TrtCudaGraph));
+        mIndex[key] = mGraphs.begin();
+        return *mGraphs.front().second;
+    }
+
+    int hits() const
+    {
+        return mHits;
+    }
+
+    int misses() const
+    {
+        return mMisses;
+    }
+
+    int evictions() const
+    {
+        return mEvictions;
+    }
+
+private:
+
+    using Graphs = std::list<std::pair<Key, std::unique_ptr<TrtCudaGraph>>>;
+
+    int mCapacity{0};
+    int mHits{0};
+    int mMisses{0};
+    int mEvictions{0};
+    Graphs mGraphs;
+    std::map<Key, Graphs::iterator> mIndex;
+};
+
+//!
+//! \class Iteration
+//! \brief Inference iteration and streams management
+//!
+class Iteration
+{
 
-    Iteration(int id, bool overlap, bool spin, nvinfer1::IExecutionContext& context, Bindings& bindings,
-               EnqueueFunction enqueue): mContext(context), mBindings(bindings), mEnqueue(enqueue),
-               mStreamId(id), mDepth(1 + overlap), mActive(mDepth), mEvents(mDepth)
+public:
+
+    using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+    //!
+    //! \param bindings One binding set for each of the depth queries in flight
+    //! \param hostStart The origin of the host times of the trace
+    //! \param priority The CUDA priority of the streams, 0 for the default one
+    //!
+    Iteration(int id, bool spin, nvinfer1::IExecutionContext& context, std::vector<Bindings*> bindings,
+               EnqueueFunction enqueue, TimePoint hostStart, int maxBatch = 0, int graphCacheSize = 0,
+               int priority = 0):
+               mContext(context), mBindings(std::move(bindings)), mEnqueue(enqueue), mStreamId(id),
+               mDepth(static_cast<int>(mBindings.size())), mMaxBatch(maxBatch), mHostStart(hostStart), mActive(mDepth),
+               mArrivals(mDepth), mBatches(mDepth), mEnqueueTimes(mDepth), mEvents(mDepth), mSlotEvents(mDepth),
+               mSpin(spin), mWaiter(spin ? EventWaiter::Mode::kSPIN : EventWaiter::Mode::kBLOCK)
     {
+        for (auto& s : mStream)
+        {
+            s.reset(priority ? new TrtCudaStream(priority) : new TrtCudaStream);
+        }
         for (int d = 0; d < mDepth; ++d)
         {
             for (int e = 0; e < static_cast<int>(EventType::kNUM); ++e)
             {
                 mEvents[d][e].reset(new TrtCudaEvent(!spin));
             }
+            mSlotEvents[d] = &mEvents[d];
+        }
+
+        const auto& engine = mContext.getEngine();
+        const int bindingsInProfile = engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+        const int offset = std::max(mContext.getOptimizationProfile(), 0) * bindingsInProfile;
+        mProfileOffset = offset;
+        for (int b = offset; b < offset + bindingsInProfile; ++b)
+        {
+            if (engine.bindingIsInput(b))
+            {
+                mInputs.emplace_back(b, mContext.getBindingDimensions(b));
+            }
+        }
+        mResizeBatch = mMaxBatch && !engine.hasImplicitBatchDimension();
+        mInputTransfers = mBindings.front()->hasInputTransfers();
+
+        if (graphCacheSize)
+        {
+            mGraphs.reset(new GraphCache(graphCacheSize));
         }
+
+        cudaCheck(cudaGetDevice(&mDevice));
+
+        const std::string stream = "Stream " + std::to_string(mStreamId) + " ";
+        mStageNames = {stream + "H2D", stream + "compute", stream + "D2H"};
     }
 
-    void query()
+    //!
+    //! \brief Issue a request, optionally stamped with its arrival time in ms since the start event
+    //!
+    //! \param batch The number of requests gathered with dynamic batching, 0 to run the configured batch
+    //! \param request The request of the replay trace whose shapes and input data the query runs, with --replay
+    //!
+    void query(float arrival = kNO_ARRIVAL, int batch = 0, int request = -1)
     {
         if (mActive[mNext])
         {
             return;
         }
 
-        record(EventType::kINPUT_S, StreamType::kINPUT);
-        mBindings.transferInputToDevice(getStream(StreamType::kINPUT));
-        record(EventType::kINPUT_E, StreamType::kINPUT);
+        mArrivals[mNext] = arrival;
+        mBatches[mNext] = batch;
+        if (mSampler)
+        {
+            mDraws[mNext].bucket = mSampler->draw(mDraws[mNext].shapes);
+        }
+        else if (mReplay && request >= 0)
+        {
+            // The inputs the request does not set run with their shapes at set up
+            auto& shapes = mDraws[mNext].shapes;
+            shapes.clear();
+            std::copy_if(mInputs.begin(), mInputs.end(), std::back_inserter(shapes),
+                [this](const std::pair<int, nvinfer1::Dims>& input) {
+                    return !mContext.getEngine().isShapeBinding(input.first);
+                });
+            mReplay->getShapes(request, mProfileOffset, shapes);
+        }
+        if (mTimingSample)
+        {
+            // The first query of every sample is timed, the others only record the events their waits need
+            if (mQueries++ % mTimingSample)
+            {
+                mSlotEvents[mNext] = &mSyncEvents[mNext];
+            }
+            else
+            {
+                mSlotEvents[mNext] = mFreeEvents.back();
+                mFreeEvents.pop_back();
+            }
+        }
+        const int transferBatch = batch ? batch : 1;
+        const int transferMaxBatch = batch ? mMaxBatch : 1;
 
-        wait(EventType::kINPUT_E, StreamType::kCOMPUTE); // Wait for input DMA before compute
-        record(EventType::kCOMPUTE_S, StreamType::kCOMPUTE);
-        mEnqueue(mContext, mBindings.getDeviceBuffers(), getStream(StreamType::kCOMPUTE));
-        record(EventType::kCOMPUTE_E, StreamType::kCOMPUTE);
+        if (mGraphIteration || mMicroBatches || mTiling)
+        {
+            if (mGraphIteration)
+            {
+                queryGraph(batch, transferBatch, transferMaxBatch);
+            }
+            else if (mMicroBatches)
+            {
+                queryMicroBatches();
+            }
+            else
+            {
+                queryTiles();
+            }
+            mActive[mNext] = true;
+            moveNext();
+            return;
+        }
 
-        wait(EventType::kCOMPUTE_E, StreamType::kOUTPUT); // Wait for compute before output DMA
-        record(EventType::kOUTPUT_S, StreamType::kOUTPUT);
-        mBindings.transferOutputToHost(getStream(StreamType::kOUTPUT));
-        record(EventType::kOUTPUT_E, StreamType::kOUTPUT);
+        if (mInputTransfers)
+        {
+            NVTX_RANGE_COLOR(mStageNames[0].c_str(), mStreamId);
+            record(EventType::kINPUT_S, StreamType::kINPUT);
+            if (mAssembly)
+            {
+                mAssembly->gather(mNext, transferBatch, getStream(StreamType::kINPUT).get());
+            }
+            else
+            {
+                mBindings[mNext]->transferInputToDevice(
+                    getStream(StreamType::kINPUT), transferBatch, transferMaxBatch);
+            }
+            if (mReplay && request >= 0)
+            {
+                mReplay->transferInputs(request, mProfileOffset, *mBindings[mNext], getStream(StreamType::kINPUT));
+            }
+            record(EventType::kINPUT_E, StreamType::kINPUT);
+
+            wait(EventType::kINPUT_E, StreamType::kCOMPUTE); // Wait for input DMA before compute
+        }
+        else
+        {
+            // Zero-copy inputs, the input events mark an empty transfer on the compute stream
+            record(EventType::kINPUT_S, StreamType::kCOMPUTE);
+            if (mReplay && request >= 0)
+            {
+                mReplay->transferInputs(request, mProfileOffset, *mBindings[mNext], getStream(StreamType::kCOMPUTE));
+            }
+            record(EventType::kINPUT_E, StreamType::kCOMPUTE);
+        }
+        {
+            NVTX_RANGE_COLOR(mStageNames[1].c_str(), mStreamId);
+            const auto compute = [this, batch]()
+            {
+                record(EventType::kCOMPUTE_S, StreamType::kCOMPUTE);
+                // Host time to submit the compute, which the device waits for when the submission is the bottleneck
+                mEnqueueTimes[mNext].first = std::chrono::high_resolution_clock::now();
+                if (mResizeBatch)
+                {
+                    setBatch(batch);
+                }
+                if (!mDraws.empty())
+                {
+                    setShapes(mDraws[mNext]);
+                }
+                enqueue(batch);
+                mEnqueueTimes[mNext].second = std::chrono::high_resolution_clock::now();
+                record(EventType::kCOMPUTE_E, StreamType::kCOMPUTE);
+            };
+            if (mSharedMemory)
+            {
+                mSharedMemory->serialize(getStream(StreamType::kCOMPUTE), compute);
+            }
+            else
+            {
+                compute();
+            }
+        }
+
+        {
+            NVTX_RANGE_COLOR(mStageNames[2].c_str(), mStreamId);
+            wait(EventType::kCOMPUTE_E, StreamType::kOUTPUT); // Wait for compute before output DMA
+            if (mCheck)
+            {
+                mCheck->enqueue(mNext, getStream(StreamType::kOUTPUT).get());
+            }
+            record(EventType::kOUTPUT_S, StreamType::kOUTPUT);
+            if (mAssembly)
+            {
+                mAssembly->scatter(mNext, transferBatch, getStream(StreamType::kOUTPUT).get());
+            }
+            else
+            {
+                mBindings[mNext]->transferOutputToHost(
+                    getStream(StreamType::kOUTPUT), transferBatch, transferMaxBatch);
+            }
+            record(EventType::kOUTPUT_E, StreamType::kOUTPUT);
+            if (mCompletions)
+            {
+                mCompletions->notify(getStream(StreamType::kOUTPUT), this);
+            }
+        }
 
         mActive[mNext] = true;
         moveNext();
@@ -247,9 +1156,35 @@ public:
     {
         if (mActive[mNext])
         {
-            getEvent(EventType::kOUTPUT_E).synchronize();
-            trace.emplace_back(getTrace(start));
+            mWaiter.wait(getEvent(EventType::kOUTPUT_E));
             mActive[mNext] = false;
+            if (mSlotEvents[mNext] == &mSyncEvents[mNext])
+            {
+                // An untimed query counts in the trace entry of its sample
+                if (mKeepTrace)
+                {
+                    ++trace[mLastTrace].weight;
+                }
+                return 0;
+            }
+            const InferenceTrace entry = getTrace(start);
+            if (mRecorder)
+            {
+                mRecorder->record(mContext, *mBindings[mNext], mStreamId, entry.computeStart);
+            }
+            if (mHistograms && entry.computeStart >= mHistogramsWarmupMs)
+            {
+                mHistograms->record(traceToTiming(entry));
+            }
+            if (mKeepTrace)
+            {
+                trace.push_back(entry);
+                mLastTrace = trace.size() - 1;
+            }
+            if (mTimingSample)
+            {
+                mFreeEvents.push_back(mSlotEvents[mNext]);
+            }
             return getEvent(EventType::kCOMPUTE_S) - start;
         }
         return 0;
@@ -266,147 +1201,1652 @@ public:
 
     void wait(TrtCudaEvent& start)
     {
-        getStream(StreamType::kINPUT).wait(start);
+        getStream(mInputTransfers ? StreamType::kINPUT : StreamType::kCOMPUTE).wait(start);
     }
 
-private:
-
-    void moveNext()
+    bool busy() const
     {
-        mNext = mDepth - 1 - mNext;
+        return mActive[mNext];
     }
 
-    TrtCudaStream& getStream(StreamType t)
+    const GraphCache* getGraphCache() const
     {
-        return mStream[static_cast<int>(t)];
+        return mGraphs.get();
     }
 
-    TrtCudaEvent& getEvent(EventType t)
+    //!
+    //! \brief Draw the input shapes of each query from the sampler, and set them before its enqueue
+    //!
+    void setShapeSampler(ShapeSampler* sampler)
     {
-        return *mEvents[mNext][static_cast<int>(t)];
+        mSampler = sampler;
+        mDraws.resize(sampler ? mDepth : 0);
     }
 
-    void record(EventType e, StreamType s)
+    //!
+    //! \brief Run the queries issued with a request of the replay with its shapes and input data
+    //!
+    void setReplay(const ReplayTrace* replay)
     {
-        getEvent(e).record(getStream(s));
+        mReplay = replay;
+        mDraws.resize(replay ? mDepth : 0);
     }
 
-    void wait(EventType e, StreamType s)
+    //!
+    //! \brief Serialize the computes with those of the other contexts using the same device memory
+    //!
+    void setSharedMemory(SharedDeviceMemory* memory)
     {
-        getStream(s).wait(getEvent(e));
+        mSharedMemory = memory;
     }
 
-    InferenceTrace getTrace(const TrtCudaEvent& start)
+    //!
+    //! \brief Queue the outputs of each completed inference to the recorder
+    //!
+    void setRecorder(OutputRecorder* recorder)
     {
-        return InferenceTrace(mStreamId, getEvent(EventType::kINPUT_S) - start, getEvent(EventType::kINPUT_E) - start,
-                                         getEvent(EventType::kCOMPUTE_S) - start, getEvent(EventType::kCOMPUTE_E) - start,
-                                         getEvent(EventType::kOUTPUT_S)- start, getEvent(EventType::kOUTPUT_E)- start);
+        mRecorder = recorder;
     }
 
-    nvinfer1::IExecutionContext& mContext;
-    Bindings& mBindings;
-
-    EnqueueFunction mEnqueue;
-
-    int mStreamId{0};
-    int mNext{0};
-    int mDepth{2}; // default to double buffer to hide DMA transfers
+    //!
+    //! \brief Record the time of each query that starts after the warm up into histograms, as it completes
+    //!
+    //! \param keepTrace False to leave the queries out of the trace, for runs only reported from the histograms
+    //!
+    void setHistograms(LatencyHistograms* histograms, float warmupMs, bool keepTrace)
+    {
+        mHistograms = histograms;
+        mHistogramsWarmupMs = warmupMs;
+        mKeepTrace = keepTrace;
+    }
 
-    std::vector<bool> mActive;
-    MultiStream mStream;
-    std::vector<MultiEvent> mEvents;
-};
+    //!
+    //! \brief Compare the device outputs of every Nth query to their reference, before their transfer
+    //!
+    void setCheck(std::unique_ptr<OutputValidator::Check> check)
+    {
+        mCheck = std::move(check);
+    }
 
-using IterationStreams = std::vector<std::unique_ptr<Iteration>>;
+    //!
+    //! \brief Queue the iteration to completions at the end of each query, nullptr to stop
+    //!
+    void setCompletionQueue(CompletionQueue* completions)
+    {
+        mCompletions = completions;
+    }
 
-void inferenceLoop(IterationStreams& iStreams, const TrtCudaEvent& mainStart, int batch, int iterations, float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& trace)
-{
-    float durationMs = 0;
-    int skip = 0;
+    //!
+    //! \brief Wait for the completions by spinning then blocking, the events are created with blocking sync
+    //!
+    void setHybridWait()
+    {
+        mWaiter = EventWaiter(EventWaiter::Mode::kHYBRID);
+    }
 
-    for (int i = 0; i < iterations + skip || durationMs < maxDurationMs; ++i)
+    //!
+    //! \brief Capture the input copies and output copies of each query in its graph with the compute, before any query
+    //!
+    //! Requires a graph cache. The streams of the query wait on each other with their own events, without timing, and
+    //! the graph starts and ends on the first stream.
+    //!
+    void setGraphIteration()
     {
-        for (auto& s : iStreams)
+        if (!mGraphs)
         {
-            s->query();
+            return;
         }
-        for (auto& s : iStreams)
+        mGraphIteration = true;
+        createHandOverEvents();
+    }
+
+    //!
+    //! \brief Split each query in count micro-batches, before any query
+    //!
+    //! The bindings must be split too. The input copy, compute and output copy of each micro-batch wait for the
+    //! previous stage of the same micro-batch only, so that the copies of one overlap the computes of the others.
+    //!
+    //! \param batch The batch of a micro-batch of an implicit batch context, 0 for explicit batch
+    //!
+    void setMicroBatches(int count, int batch)
+    {
+        if (count < 2)
         {
-            durationMs = std::max(durationMs, s->sync(mainStart, trace));
+            return;
         }
-        if (durationMs < warmupMs) // Warming up
+        mMicroBatches = count;
+        mMicroBatch = batch;
+        createHandOverEvents();
+    }
+
+    //!
+    //! \brief Issue the copies on streams shared with the other iterations of the device instead of their own, nullptr
+    //!        to keep these
+    //!
+    void setCopyStreams(CopyStreams* streams)
+    {
+        mCopyStreams = streams;
+        if (streams)
         {
-            if (durationMs) // Skip complete iterations
-            {
-                ++skip;
-            }
-            continue;
+            mStream[static_cast<int>(StreamType::kINPUT)].reset();
+            mStream[static_cast<int>(StreamType::kOUTPUT)].reset();
         }
     }
-    for (auto& s : iStreams)
+
+    //!
+    //! \brief Run each query as the tiles of an image, cut from the device image and blended into an output image
+    //!
+    void setTiling(TiledInference* tiling)
     {
-        s->syncAll(mainStart, trace);
+        mTiling = tiling;
     }
-}
-
-void inferenceExecution(const InferenceOptions& inference, InferenceEnvironment& iEnv, SyncStruct& sync, int offset, int streams, std::vector<InferenceTrace>& trace)
-{
-    float warmupMs = static_cast<float>(inference.warmup);
-    float durationMs = static_cast<float>(inference.duration) * 1000 + warmupMs;
-
-    auto enqueue = inference.batch ? EnqueueFunction(EnqueueImplicit(inference.batch)) : EnqueueFunction(EnqueueExplicit());
 
-    IterationStreams iStreams;
-    for (int s = 0; s < streams; ++s)
+    //!
+    //! \brief Copy the requests of each dynamic batch on their own, gathered into the batch on the device
+    //!
+    void setBatchAssembly(BatchAssembly* assembly)
     {
-        iStreams.emplace_back(new Iteration(offset + s, inference.overlap, inference.spin, *iEnv.context[offset], *iEnv.bindings[offset], enqueue));
+        mAssembly = assembly;
     }
 
-    for (auto& s : iStreams)
+    const EventWaiter& getWaiter() const
     {
-        s->wait(sync.mainStart);
+        return mWaiter;
     }
 
-    std::vector<InferenceTrace> localTrace;
-    inferenceLoop(iStreams, sync.mainStart, inference.batch, inference.iterations, durationMs, warmupMs, localTrace);
-
-    sync.mutex.lock();
-    trace.insert(trace.end(), localTrace.begin(), localTrace.end());
-    sync.mutex.unlock();
-}
-
-inline
-std::thread makeThread(const InferenceOptions& inference, InferenceEnvironment& iEnv, SyncStruct& sync, int thread, int streamsPerThread, std::vector<InferenceTrace>& trace)
-{
-    return std::thread(inferenceExecution, std::cref(inference), std::ref(iEnv), std::ref(sync), thread, streamsPerThread, std::ref(trace));
-}
-
-} // namespace
-
-void runInference(const InferenceOptions& inference, InferenceEnvironment& iEnv, std::vector<InferenceTrace>& trace)
-{
-    trace.resize(0);
+    //!
+    //! \brief Time only the first query of every \p every queries on the stream, call before the first query
+    //!
+    //! The other queries record their input, compute and output end events, created without timing, for the waits
+    //! between the streams and the synchronization. They add to the weight of the trace entry of their sample, which
+    //! has to stay in the same trace vector.
+    //!
+    void setTimingSample(int every)
+    {
+        if (every < 2)
+        {
+            return;
+        }
+        mTimingSample = every;
+        mSyncEvents.resize(mDepth);
+        for (int d = 0; d < mDepth; ++d)
+        {
+            for (const auto e : {EventType::kINPUT_E, EventType::kCOMPUTE_E, EventType::kOUTPUT_E})
+            {
+                mSyncEvents[d][static_cast<int>(e)].reset(new TrtCudaEvent(!mSpin, false));
+            }
+            // The timing events become a pool, at most one set per query in flight
+            mFreeEvents.push_back(&mEvents[d]);
+        }
+    }
 
-    SyncStruct sync;
-    sync.sleep = inference.sleep;
-    sync.mainStream.sleep(&sync.sleep);
-    sync.mainStart.record(sync.mainStream);
+private:
 
-    int threadsNum = inference.threads ? inference.streams : 1;
-    int streamsPerThread  = inference.streams / threadsNum;
+    //!
+    //! \brief Set the batch dimension of all the execution tensor inputs of an explicit batch context
+    //!
+    void setBatch(int batch)
+    {
+        for (auto input : mInputs)
+        {
+            if (!mContext.getEngine().isShapeBinding(input.first))
+            {
+                input.second.d[0] = batch;
+                mContext.setBindingDimensions(input.first, input.second);
+            }
+        }
+    }
 
-    std::vector<std::thread> threads;
-    for (int t = 0; t < threadsNum; ++t)
+    //!
+    //! Input shapes drawn for a query, and the host time to set them on the context
+    //!
+    struct ShapeDraw
     {
-        threads.emplace_back(makeThread(inference, iEnv, sync, t, streamsPerThread, trace));
+        ShapeSampler::Shapes shapes;
+        int bucket{-1};
+        bool changed{false}; //!< The shapes differ from those of the previous query of the context
+        float ms{0};
+    };
+
+    //!
+    //! \brief Set the input shapes drawn for a query that differ from the current ones
+    //!
+    void setShapes(ShapeDraw& draw)
+    {
+        const auto start = std::chrono::high_resolution_clock::now();
+        draw.changed = false;
+        for (const auto& shape : draw.shapes)
+        {
+            const auto dims = mContext.getBindingDimensions(shape.first);
+            if (dims.nbDims != shape.second.nbDims || !std::equal(dims.d, dims.d + dims.nbDims, shape.second.d))
+            {
+                mContext.setBindingDimensions(shape.first, shape.second);
+                draw.changed = true;
+            }
+        }
+        const std::chrono::duration<float, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+        draw.ms = time.count();
     }
-    for (auto& th : threads)
+
+    //!
+    //! \brief Build the graph cache key from the profile, the implicit batch and the current input shapes
+    //!
+    //! Graphs capture the buffers of the binding set of the slot in flight, so the slot is part of the key.
+    //!
+    GraphCache::Key getShapeKey(int batch) const
     {
-        th.join();
+        GraphCache::Key key{mContext.getOptimizationProfile(), batch, mNext};
+        for (const auto& input : mInputs)
+        {
+            const auto& engine = mContext.getEngine();
+            const auto dims = mContext.getBindingDimensions(input.first);
+            key.push_back(dims.nbDims);
+            key.insert(key.end(), dims.d, dims.d + dims.nbDims);
+            if (engine.isShapeBinding(input.first))
+            {
+                std::vector<int32_t> values(std::max(volume(dims), 1));
+                mContext.getShapeBinding(input.first, values.data());
+                key.insert(key.end(), values.begin(), values.end());
+            }
+        }
+        return key;
     }
 
-    auto cmpTrace = [](const InferenceTrace& a, const InferenceTrace& b) { return a.inStart < b.inStart; };
-    std::sort(trace.begin(), trace.end(), cmpTrace);
+    //!
+    //! \brief Enqueue inference, replaying the graph captured for the current shapes if there is one
+    //!
+    //! A graph that is not in the cache is captured after a regular enqueue with the same shapes, since the first
+    //! enqueue after a shape change may perform work that is not allowed during capture.
+    //!
+    void enqueue(int batch)
+    {
+        auto& stream = getStream(StreamType::kCOMPUTE);
+        if (!mGraphs)
+        {
+            mEnqueue(mContext, mBindings[mNext]->getDeviceBuffers(), stream, batch);
+            return;
+        }
+
+        const auto key = getShapeKey(batch);
+        if (auto* graph = mGraphs->find(key))
+        {
+            graph->launch(stream);
+            return;
+        }
+
+        mEnqueue(mContext, mBindings[mNext]->getDeviceBuffers(), stream, batch);
+        auto& graph = mGraphs->insert(key);
+        if (!graph.beginCapture(stream))
+        {
+            gLogWarning << "CUDA graphs require CUDA 10, graph capture disabled" << std::endl;
+            mGraphs.reset();
+            return;
+        }
+        mEnqueue(mContext, mBindings[mNext]->getDeviceBuffers(), stream, batch);
+        if (!graph.endCapture(stream))
+        {
+            // The engine ran above, only graph replay is given up
+            gLogWarning << "Stream " << mStreamId << ": the engine execution could not be captured into a CUDA graph, "
+                        << "a layer or plugin synchronizes or uses the default stream. Graph capture disabled"
+                        << std::endl;
+            mGraphs.reset();
+        }
+    }
+
+    //!
+    //! \brief Issue the input copies, the engine execution and the output copies of a query, ending on the origin
+    //!
+    //! Each stream waits for the previous one, and the origin stream for the last one, so that a capture on the origin
+    //! joins all of them.
+    //!
+    void issueIteration(StreamType origin, int batch, int transferBatch, int transferMaxBatch)
+    {
+        if (mInputTransfers)
+        {
+            mBindings[mNext]->transferInputToDevice(getStream(StreamType::kINPUT), transferBatch, transferMaxBatch);
+            handOver(StreamType::kINPUT, StreamType::kCOMPUTE, 0);
+        }
+        mEnqueue(mContext, mBindings[mNext]->getDeviceBuffers(), getStream(StreamType::kCOMPUTE), batch);
+        handOver(StreamType::kCOMPUTE, StreamType::kOUTPUT, 1);
+        mBindings[mNext]->transferOutputToHost(getStream(StreamType::kOUTPUT), transferBatch, transferMaxBatch);
+        handOver(StreamType::kOUTPUT, origin, 2);
+    }
+
+    //!
+    //! \brief Issue a query as a single launch of the graph of its copies and compute for the current shapes
+    //!
+    //! The events of the query are recorded around the graph on the origin stream, so the compute covers the copies
+    //! and the input and output transfers are empty. As for the compute graphs, a query with shapes that have no graph
+    //! yet runs without capture first.
+    //!
+    void queryGraph(int batch, int transferBatch, int transferMaxBatch)
+    {
+        NVTX_RANGE_COLOR(mStageNames[1].c_str(), mStreamId);
+        const auto origin = mInputTransfers ? StreamType::kINPUT : StreamType::kCOMPUTE;
+        auto& stream = getStream(origin);
+        record(EventType::kINPUT_S, origin);
+        record(EventType::kINPUT_E, origin);
+        record(EventType::kCOMPUTE_S, origin);
+        mEnqueueTimes[mNext].first = std::chrono::high_resolution_clock::now();
+        if (mResizeBatch)
+        {
+            setBatch(batch);
+        }
+        if (!mDraws.empty())
+        {
+            setShapes(mDraws[mNext]);
+        }
+
+        const auto key = getShapeKey(batch);
+        if (auto* graph = mGraphs->find(key))
+        {
+            graph->launch(stream);
+        }
+        else
+        {
+            issueIteration(origin, batch, transferBatch, transferMaxBatch);
+            auto& captured = mGraphs->insert(key);
+            if (!captured.beginCapture(stream))
+            {
+                gLogWarning << "CUDA graphs require CUDA 10, graph capture disabled" << std::endl;
+                mGraphs.reset();
+                mGraphIteration = false;
+            }
+            else
+            {
+                issueIteration(origin, batch, transferBatch, transferMaxBatch);
+                if (!captured.endCapture(stream))
+                {
+                    // The query ran above, only graph replay is given up
+                    gLogWarning << "Stream " << mStreamId << ": the iteration could not be captured into a CUDA graph, "
+                                << "a layer or plugin synchronizes or uses the default stream. Graph capture disabled"
+                                << std::endl;
+                    mGraphs.reset();
+                    mGraphIteration = false;
+                }
+            }
+        }
+        mEnqueueTimes[mNext].second = std::chrono::high_resolution_clock::now();
+
+        record(EventType::kCOMPUTE_E, origin);
+        record(EventType::kOUTPUT_S, origin);
+        record(EventType::kOUTPUT_E, origin);
+        if (mCompletions)
+        {
+            mCompletions->notify(stream, this);
+        }
+    }
+
+    //!
+    //! \brief Issue the micro-batches of a query, each one's copies and compute waiting for its previous stage
+    //!
+    //! The events of the query span the stages of all the micro-batches, so its transfers overlap its compute.
+    //!
+    void queryMicroBatches()
+    {
+        NVTX_RANGE_COLOR(mStageNames[1].c_str(), mStreamId);
+        auto& bindings = *mBindings[mNext];
+        const int last = mMicroBatches - 1;
+        if (mInputTransfers)
+        {
+            record(EventType::kINPUT_S, StreamType::kINPUT);
+        }
+        else
+        {
+            record(EventType::kINPUT_S, StreamType::kCOMPUTE);
+            record(EventType::kINPUT_E, StreamType::kCOMPUTE);
+        }
+        mEnqueueTimes[mNext].first = std::chrono::high_resolution_clock::now();
+        for (int m = 0; m < mMicroBatches; ++m)
+        {
+            if (mInputTransfers)
+            {
+                bindings.transferMicroBatchInput(getStream(StreamType::kINPUT), m);
+                if (m == last)
+                {
+                    record(EventType::kINPUT_E, StreamType::kINPUT);
+                }
+                handOver(StreamType::kINPUT, StreamType::kCOMPUTE, 0);
+            }
+            if (!m)
+            {
+                record(EventType::kCOMPUTE_S, StreamType::kCOMPUTE);
+            }
+            mEnqueue(mContext, bindings.getMicroBatchBuffers(m), getStream(StreamType::kCOMPUTE), mMicroBatch);
+            if (m == last)
+            {
+                record(EventType::kCOMPUTE_E, StreamType::kCOMPUTE);
+            }
+            handOver(StreamType::kCOMPUTE, StreamType::kOUTPUT, 1);
+            if (!m)
+            {
+                record(EventType::kOUTPUT_S, StreamType::kOUTPUT);
+            }
+            if (m == last && mCheck)
+            {
+                // All the outputs are computed, the copies only read them
+                mCheck->enqueue(mNext, getStream(StreamType::kOUTPUT).get());
+            }
+            bindings.transferMicroBatchOutput(getStream(StreamType::kOUTPUT), m);
+        }
+        mEnqueueTimes[mNext].second = std::chrono::high_resolution_clock::now();
+        record(EventType::kOUTPUT_E, StreamType::kOUTPUT);
+        if (mCompletions)
+        {
+            mCompletions->notify(getStream(StreamType::kOUTPUT), this);
+        }
+    }
+
+    //!
+    //! \brief Issue the enqueues of the tiles of the image, and the copy of the output image
+    //!
+    //! The image is already on the device, the input events mark an empty transfer. The compute spans the cuts, the
+    //! enqueues and the blends of all the tiles.
+    //!
+    void queryTiles()
+    {
+        auto& compute = getStream(StreamType::kCOMPUTE);
+        void** buffers = mBindings[mNext]->getDeviceBuffers();
+        record(EventType::kINPUT_S, StreamType::kCOMPUTE);
+        record(EventType::kINPUT_E, StreamType::kCOMPUTE);
+        {
+            NVTX_RANGE_COLOR(mStageNames[1].c_str(), mStreamId);
+            record(EventType::kCOMPUTE_S, StreamType::kCOMPUTE);
+            mEnqueueTimes[mNext].first = std::chrono::high_resolution_clock::now();
+            mTiling->begin(compute.get());
+            for (int g = 0; g < mTiling->getGroups(); ++g)
+            {
+                mTiling->cut(g, buffers, compute.get());
+                mEnqueue(mContext, buffers, compute, 0);
+                mTiling->blend(g, buffers, compute.get());
+            }
+            mTiling->finish(mNext, compute.get());
+            mEnqueueTimes[mNext].second = std::chrono::high_resolution_clock::now();
+            record(EventType::kCOMPUTE_E, StreamType::kCOMPUTE);
+        }
+        {
+            NVTX_RANGE_COLOR(mStageNames[2].c_str(), mStreamId);
+            wait(EventType::kCOMPUTE_E, StreamType::kOUTPUT);
+            record(EventType::kOUTPUT_S, StreamType::kOUTPUT);
+            mTiling->outputToHost(mNext, getStream(StreamType::kOUTPUT).get());
+            record(EventType::kOUTPUT_E, StreamType::kOUTPUT);
+            if (mCompletions)
+            {
+                mCompletions->notify(getStream(StreamType::kOUTPUT), this);
+            }
+        }
+    }
+
+    void createHandOverEvents()
+    {
+        for (auto& e : mHandOverEvents)
+        {
+            e.reset(new TrtCudaEvent(!mSpin, false));
+        }
+    }
+
+    //!
+    //! \brief Make a stream wait for the work submitted so far to another, with a hand over event of its own
+    //!
+    void handOver(StreamType from, StreamType to, int event)
+    {
+        mHandOverEvents[event]->record(getStream(from));
+        getStream(to).wait(*mHandOverEvents[event]);
+    }
+
+    static constexpr float kNO_ARRIVAL{-1.0F};
+
+    void moveNext()
+    {
+        mNext = (mNext + 1) % mDepth;
+    }
+
+    TrtCudaStream& getStream(StreamType t)
+    {
+        if (mCopyStreams && t != StreamType::kCOMPUTE)
+        {
+            return t == StreamType::kINPUT ? mCopyStreams->input : mCopyStreams->output;
+        }
+        return *mStream[static_cast<int>(t)];
+    }
+
+    TrtCudaEvent& getEvent(EventType t)
+    {
+        return *(*mSlotEvents[mNext])[static_cast<int>(t)];
+    }
+
+    void record(EventType e, StreamType s)
+    {
+        // Untimed queries have no start events
+        auto& event = (*mSlotEvents[mNext])[static_cast<int>(e)];
+        if (event)
+        {
+            event->record(getStream(s));
+        }
+    }
+
+    void wait(EventType e, StreamType s)
+    {
+        getStream(s).wait(getEvent(e));
+    }
+
+    InferenceTrace getTrace(const TrtCudaEvent& start)
+    {
+        const float inStart = getEvent(EventType::kINPUT_S) - start;
+        const float arrival = mArrivals[mNext] == kNO_ARRIVAL ? inStart : std::min(mArrivals[mNext], inStart);
+        InferenceTrace trace(mStreamId, inStart, getEvent(EventType::kINPUT_E) - start,
+                                         getEvent(EventType::kCOMPUTE_S) - start, getEvent(EventType::kCOMPUTE_E) - start,
+                                         getEvent(EventType::kOUTPUT_S)- start, getEvent(EventType::kOUTPUT_E)- start, arrival,
+                                         mBatches[mNext]);
+        trace.device = mDevice;
+        trace.enqueueStart = std::chrono::duration<float, std::milli>(mEnqueueTimes[mNext].first - mHostStart).count();
+        trace.enqueueEnd = std::chrono::duration<float, std::milli>(mEnqueueTimes[mNext].second - mHostStart).count();
+        if (!mDraws.empty())
+        {
+            trace.shapeBucket = mDraws[mNext].bucket;
+            trace.shapeChange = mDraws[mNext].changed;
+            trace.shapeMs = mDraws[mNext].ms;
+        }
+        return trace;
+    }
+
+    nvinfer1::IExecutionContext& mContext;
+    std::vector<Bindings*> mBindings;
+
+    EnqueueFunction mEnqueue;
+
+    int mStreamId{0};
+    int mDevice{0};
+    int mNext{0};
+    int mDepth{2}; // Queries in flight, each with its own events and bindings
+    int mMaxBatch{0};
+    TimePoint mHostStart;
+    bool mResizeBatch{false};
+    bool mInputTransfers{true};
+
+    std::vector<std::pair<int, nvinfer1::Dims>> mInputs; // Input bindings of the profile and their dimensions at set up
+    int mProfileOffset{0}; // First binding of the profile of the context
+    std::unique_ptr<GraphCache> mGraphs;
+    bool mGraphIteration{false}; // The graphs capture whole queries, copies included, instead of the engine execution
+    // Hand over between the streams of a graph query or of the micro-batches of a query
+    std::array<std::unique_ptr<TrtCudaEvent>, 3> mHandOverEvents;
+    int mMicroBatches{0};
+    int mMicroBatch{0};
+    TiledInference* mTiling{nullptr};
+    BatchAssembly* mAssembly{nullptr};
+    SharedDeviceMemory* mSharedMemory{nullptr};
+    OutputRecorder* mRecorder{nullptr};
+    LatencyHistograms* mHistograms{nullptr}; // Of the thread running the stream
+    float mHistogramsWarmupMs{0};
+    bool mKeepTrace{true};
+    std::unique_ptr<OutputValidator::Check> mCheck;
+    ShapeSampler* mSampler{nullptr};
+    const ReplayTrace* mReplay{nullptr};
+    std::vector<ShapeDraw> mDraws; // Shapes of the query in flight of each slot with a sampler or a replay
+    std::array<std::string, 3> mStageNames; // NVTX ranges of the input, compute and output stages
+
+    std::vector<bool> mActive;
+    std::vector<float> mArrivals;
+    std::vector<int> mBatches;
+    std::vector<std::pair<TimePoint, TimePoint>> mEnqueueTimes; // Host times around the submission of the compute
+    MultiStream mStream;
+    CopyStreams* mCopyStreams{nullptr}; // Replace the input and output streams of mStream with --sharedCopyStreams
+    std::vector<MultiEvent> mEvents;
+    std::vector<MultiEvent*> mSlotEvents; // Events of the query in flight of each slot
+    bool mSpin{false};
+    EventWaiter mWaiter;
+    CompletionQueue* mCompletions{nullptr};
+
+    int mTimingSample{0}; // Queries per timed query, 0 times all of them
+    int mQueries{0};
+    size_t mLastTrace{0};                 // Trace entry of the last timed query
+    std::vector<MultiEvent> mSyncEvents;  // Events of the untimed queries of each slot, without timing
+    std::vector<MultiEvent*> mFreeEvents; // Timing event sets of mEvents no query in flight uses
+};
+
+constexpr float Iteration::kNO_ARRIVAL;
+
+void CompletionQueue::notify(TrtCudaStream& stream, Iteration* iteration)
+{
+    Notice* notice{nullptr};
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& n : mNotices)
+        {
+            if (n.iteration == iteration)
+            {
+                notice = &n;
+            }
+        }
+        if (!notice)
+        {
+            mNotices.push_back({this, iteration});
+            notice = &mNotices.back();
+        }
+    }
+#if CUDA_VERSION < 10000
+    cudaCheck(cudaStreamAddCallback(stream.get(), complete, notice, 0));
+#else
+    cudaCheck(cudaLaunchHostFunc(stream.get(), complete, notice));
+#endif
+}
+
+using IterationStreams = std::vector<std::unique_ptr<Iteration>>;
+
+//!
+//! \class ArrivalSchedule
+//! \brief Generate request arrival times, in milliseconds, for a given rate and distribution
+//!
+class ArrivalSchedule
+{
+
+public:
+
+    ArrivalSchedule(float qps, ArrivalType arrival, unsigned int seed): mArrival(arrival), mPeriodMs(1000.0F / qps),
+        mEngine(seed), mInterval(qps / 1000.0F) {}
+
+    float next()
+    {
+        mTimeMs += mArrival == ArrivalType::kPOISSON ? mInterval(mEngine) : mPeriodMs;
+        return mTimeMs;
+    }
+
+private:
+
+    ArrivalType mArrival{ArrivalType::kFIXED};
+    float mPeriodMs{0};
+    float mTimeMs{0};
+    std::default_random_engine mEngine;
+    std::exponential_distribution<float> mInterval;
+};
+
+void inferenceLoop(IterationStreams& iStreams, const TrtCudaEvent& mainStart, int batch, int iterations, float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& trace)
+{
+    float durationMs = 0;
+    int skip = 0;
+
+    for (int i = 0; i < iterations + skip || durationMs < maxDurationMs; ++i)
+    {
+        for (auto& s : iStreams)
+        {
+            s->query();
+        }
+        for (auto& s : iStreams)
+        {
+            durationMs = std::max(durationMs, s->sync(mainStart, trace));
+        }
+        if (durationMs < warmupMs) // Warming up
+        {
+            if (durationMs) // Skip complete iterations
+            {
+                ++skip;
+            }
+            continue;
+        }
+    }
+    for (auto& s : iStreams)
+    {
+        s->syncAll(mainStart, trace);
+    }
+}
+
+//!
+//! \brief Run the streams back to back as inferenceLoop does, with a warm up and a measurement that adapt to the run
+//!
+//! With a drift, the warm up lasts at least warmupMs and until the monitor finds the last windows of queries steady,
+//! or for at most maxDurationMs past warmupMs. With a width, the measurement stops once at least iterations queries
+//! are measured and the monitor finds them precise enough, or after maxDurationMs past the warm up. Without one, the
+//! warm up or the measurement is the one of inferenceLoop.
+//!
+void convergenceLoop(IterationStreams& iStreams, const TrtCudaEvent& mainStart, const ConvergenceMonitor& monitor,
+    bool adaptiveWarmup, bool earlyStop, int batch, int iterations, float maxDurationMs, float warmupMs,
+    std::vector<InferenceTrace>& trace, ConvergenceStats& stats)
+{
+    const size_t window = static_cast<size_t>(monitor.getWindow());
+    float durationMs{0};
+    bool warming{true};
+    float measureStartMs{0};
+    size_t first{0};
+    size_t checked{0};
+    while (true)
+    {
+        for (auto& s : iStreams)
+        {
+            s->query();
+        }
+        for (auto& s : iStreams)
+        {
+            durationMs = std::max(durationMs, s->sync(mainStart, trace));
+        }
+        if (warming)
+        {
+            if (durationMs < warmupMs)
+            {
+                continue;
+            }
+            if (adaptiveWarmup && trace.size() < checked + window)
+            {
+                continue;
+            }
+            checked = trace.size();
+            stats.steady = adaptiveWarmup && monitor.steady(trace);
+            if (!adaptiveWarmup || stats.steady || durationMs >= warmupMs + maxDurationMs)
+            {
+                warming = false;
+                first = trace.size();
+                measureStartMs = durationMs;
+            }
+            continue;
+        }
+        const int measured = static_cast<int>(trace.size() - first);
+        const bool pastDuration = durationMs >= measureStartMs + maxDurationMs;
+        if (!earlyStop)
+        {
+            if (measured >= iterations && pastDuration)
+            {
+                break;
+            }
+            continue;
+        }
+        if (pastDuration)
+        {
+            break;
+        }
+        if (measured >= iterations && trace.size() >= checked + window)
+        {
+            checked = trace.size();
+            if (monitor.converged(trace, first, batch ? batch : 1, stats))
+            {
+                stats.converged = true;
+                break;
+            }
+        }
+    }
+    for (auto& s : iStreams)
+    {
+        s->syncAll(mainStart, trace);
+    }
+
+    // The queries in flight at the end of the warm up complete after it, the reports measure from the first of them
+    stats.warmupQueries = static_cast<int>(first);
+    stats.warmupMs = first < trace.size() ? trace[first].computeStart : durationMs;
+    for (size_t i = first; i < trace.size(); ++i)
+    {
+        stats.warmupMs = std::min(stats.warmupMs, trace[i].computeStart);
+    }
+    monitor.converged(trace, first, batch ? batch : 1, stats);
+}
+
+//!
+//! \brief Keep the pipelines of all the streams full from one thread, reissuing on each stream as it completes
+//!
+//! The completions are served in the order they happen rather than stream after stream, so a slow stream does not
+//! hold back the others. At least iterations times the number of streams queries run after the warm up, as many as
+//! with inferenceLoop, but counted across the streams: a fast stream runs more of them than a slow one.
+//!
+void asyncLoop(IterationStreams& iStreams, const TrtCudaEvent& mainStart, int iterations, float maxDurationMs,
+    float warmupMs, std::vector<InferenceTrace>& trace)
+{
+    CompletionQueue completions;
+    int inFlight{0};
+    for (auto& s : iStreams)
+    {
+        s->setCompletionQueue(&completions);
+        while (!s->busy())
+        {
+            s->query();
+            ++inFlight;
+        }
+    }
+
+    float durationMs{0};
+    int timed{0};
+    const int minQueries = iterations * static_cast<int>(iStreams.size());
+    while (inFlight)
+    {
+        Iteration* s = completions.pop();
+        --inFlight;
+        // The oldest query of the stream completed, so the wait of its sync returns at once
+        durationMs = std::max(durationMs, s->sync(mainStart, trace));
+        if (durationMs >= warmupMs)
+        {
+            ++timed;
+        }
+        if (timed < minQueries || durationMs < maxDurationMs)
+        {
+            s->query();
+            ++inFlight;
+        }
+    }
+    for (auto& s : iStreams)
+    {
+        s->setCompletionQueue(nullptr);
+    }
+}
+
+//!
+//! \brief Issue requests at scheduled arrival times, independently of completions
+//!
+//! Requests are assigned round robin to streams. A request that arrives while its stream has no free slot waits for
+//! the oldest request on that stream to complete, so the wait shows up as queueing delay in the trace.
+//!
+void openLoop(IterationStreams& iStreams, TrtCudaEvent& mainStart, ArrivalSchedule& schedule, int iterations,
+    float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& trace)
+{
+    // Align the host clock to the device timeline, on which all the trace times are relative to mainStart
+    mainStart.synchronize();
+    const auto hostStart = std::chrono::high_resolution_clock::now();
+
+    int issued = 0;
+    size_t next = 0;
+    for (float arrivalMs = schedule.next(); issued < iterations || arrivalMs < maxDurationMs; arrivalMs = schedule.next())
+    {
+        std::this_thread::sleep_until(hostStart + std::chrono::duration<float, std::milli>(arrivalMs));
+
+        auto& s = iStreams[next];
+        next = (next + 1) % iStreams.size();
+        if (s->busy())
+        {
+            s->sync(mainStart, trace);
+        }
+        s->query(arrivalMs);
+
+        if (arrivalMs >= warmupMs)
+        {
+            ++issued;
+        }
+    }
+    for (auto& s : iStreams)
+    {
+        s->syncAll(mainStart, trace);
+    }
+}
+
+//!
+//! \brief Issue the requests of a replay trace at their arrival times scaled by the speed, round robin over the streams
+//!
+//! The trace runs once, at its own pace. A thread takes the requests first, first + step and so on, so that the threads
+//! of the streams share the trace.
+//!
+void replayLoop(IterationStreams& iStreams, TrtCudaEvent& mainStart, const ReplayTrace& replay, float speed,
+    size_t first, size_t step, std::vector<InferenceTrace>& trace)
+{
+    mainStart.synchronize();
+    const auto hostStart = std::chrono::high_resolution_clock::now();
+
+    size_t next = 0;
+    for (size_t r = first; r < replay.size(); r += step)
+    {
+        const float arrivalMs = replay.getArrival(r) / speed;
+        std::this_thread::sleep_until(hostStart + std::chrono::duration<float, std::milli>(arrivalMs));
+
+        auto& s = iStreams[next];
+        next = (next + 1) % iStreams.size();
+        if (s->busy())
+        {
+            s->sync(mainStart, trace);
+        }
+        s->query(arrivalMs, 0, static_cast<int>(r));
+    }
+    for (auto& s : iStreams)
+    {
+        s->syncAll(mainStart, trace);
+    }
+}
+
+//!
+//! \brief Gather requests arriving at scheduled times into batches and issue them
+//!
+//! A batch is dispatched once it is full or once its oldest request waited for the maximum queue delay. While all the
+//! slots of the next stream are busy, requests keep arriving and are added to the pending batch up to its capacity.
+//!
+void dynamicBatchingLoop(IterationStreams& iStreams, TrtCudaEvent& mainStart, ArrivalSchedule& schedule, int maxBatch,
+    float maxQueueDelayMs, int iterations, float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& trace)
+{
+    mainStart.synchronize();
+    const auto hostStart = std::chrono::high_resolution_clock::now();
+    const auto sleepUntil = [&hostStart](float ms)
+    {
+        std::this_thread::sleep_until(hostStart + std::chrono::duration<float, std::milli>(ms));
+    };
+    const auto elapsedMs = [&hostStart]()
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - hostStart).count();
+    };
+
+    int issued = 0;
+    size_t next = 0;
+    float arrivalMs = schedule.next();
+    while (issued < iterations || arrivalMs < maxDurationMs)
+    {
+        const float oldestMs = arrivalMs;
+        const float deadlineMs = oldestMs + maxQueueDelayMs;
+        int batch = 0;
+        while (batch < maxBatch && arrivalMs <= deadlineMs)
+        {
+            sleepUntil(arrivalMs);
+            ++batch;
+            arrivalMs = schedule.next();
+        }
+        if (batch < maxBatch)
+        {
+            sleepUntil(deadlineMs);
+        }
+
+        auto& s = iStreams[next];
+        next = (next + 1) % iStreams.size();
+        if (s->busy())
+        {
+            s->sync(mainStart, trace);
+            const float nowMs = elapsedMs();
+            while (batch < maxBatch && arrivalMs <= nowMs)
+            {
+                ++batch;
+                arrivalMs = schedule.next();
+            }
+        }
+        s->query(oldestMs, batch);
+
+        if (oldestMs >= warmupMs)
+        {
+            ++issued;
+        }
+    }
+    for (auto& s : iStreams)
+    {
+        s->syncAll(mainStart, trace);
+    }
+}
+
+//!
+//! \brief Run requests with deadlines and priority classes, earliest deadline first
+//!
+//! Each request draws its class from the shares of the classes, and is due the SLA of its class after its arrival.
+//! The pending requests are ordered by deadline, then by class. The requests that could no longer meet their deadline
+//! even if they ran at once are shed. A dispatch runs the earliest deadlines, with dynamic batching up to maxBatch of
+//! them, once the batch is full, once its oldest request waited for the maximum queue delay, or as soon as waiting
+//! for the next arrival would miss the tightest deadline. The run time of a dispatch is estimated from the recent
+//! completions. At least iterations requests arrive after the warm up.
+//!
+//! \param maxBatch The batch gathered with dynamic batching, 0 to run one request per query with the configured batch
+//!
+void deadlineLoop(IterationStreams& iStreams, TrtCudaEvent& mainStart, ArrivalSchedule& schedule,
+    const std::vector<RequestClass>& classes, unsigned int seed, int maxBatch, float maxQueueDelayMs, int iterations,
+    float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& trace, DeadlineStats& stats)
+{
+    struct Request
+    {
+        float arrivalMs;
+        float deadlineMs;
+        int priority;
+    };
+    // A heap of the pending requests with the earliest deadline on top
+    const auto later = [](const Request& a, const Request& b)
+    {
+        return a.deadlineMs > b.deadlineMs || (a.deadlineMs == b.deadlineMs && a.priority > b.priority);
+    };
+    std::vector<Request> pending;
+    std::vector<std::deque<std::vector<Request>>> running(iStreams.size());
+
+    std::vector<float> shares;
+    stats = DeadlineStats{};
+    for (const auto& c : classes)
+    {
+        shares.push_back(c.share);
+        stats.classes.emplace_back();
+        stats.classes.back().slaMs = c.slaMs;
+    }
+    std::default_random_engine engine(seed);
+    std::discrete_distribution<int> draw(shares.begin(), shares.end());
+    stats.startMs = warmupMs;
+    stats.endMs = warmupMs;
+
+    mainStart.synchronize();
+    const auto hostStart = std::chrono::high_resolution_clock::now();
+    const auto sleepUntil = [&hostStart](float ms)
+    {
+        std::this_thread::sleep_until(hostStart + std::chrono::duration<float, std::milli>(ms));
+    };
+    const auto elapsedMs = [&hostStart]()
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - hostStart).count();
+    };
+
+    // Moving average of the time from the start of a dispatch to its completion
+    float serviceMs{0};
+    // The trace entries from first on are the oldest dispatches of stream s, in order
+    const auto complete = [&](size_t s, size_t first)
+    {
+        for (size_t t = first; t < trace.size() && !running[s].empty(); ++t)
+        {
+            const auto& done = trace[t];
+            const float runMs = done.outEnd - done.inStart;
+            serviceMs = serviceMs ? 0.875F * serviceMs + 0.125F * runMs : runMs;
+            for (const auto& r : running[s].front())
+            {
+                if (r.arrivalMs >= warmupMs)
+                {
+                    auto& c = stats.classes[r.priority];
+                    ++(done.outEnd <= r.deadlineMs ? c.onTime : c.late);
+                    stats.endMs = std::max(stats.endMs, static_cast<double>(done.outEnd));
+                }
+            }
+            running[s].pop_front();
+        }
+    };
+
+    const size_t capacity = maxBatch ? maxBatch : 1;
+    int admitted{0};
+    size_t next{0};
+    float arrivalMs = schedule.next();
+    const auto admitting = [&]() { return admitted < iterations || arrivalMs < maxDurationMs; };
+    while (admitting() || !pending.empty())
+    {
+        const float nowMs = elapsedMs();
+        while (admitting() && arrivalMs <= nowMs)
+        {
+            const int priority = draw(engine);
+            pending.push_back(Request{arrivalMs, arrivalMs + classes[priority].slaMs, priority});
+            std::push_heap(pending.begin(), pending.end(), later);
+            if (arrivalMs >= warmupMs)
+            {
+                ++stats.classes[priority].requests;
+                ++admitted;
+            }
+            arrivalMs = schedule.next();
+        }
+        while (!pending.empty() && pending.front().deadlineMs < nowMs + serviceMs)
+        {
+            if (pending.front().arrivalMs >= warmupMs)
+            {
+                ++stats.classes[pending.front().priority].shed;
+            }
+            std::pop_heap(pending.begin(), pending.end(), later);
+            pending.pop_back();
+        }
+        if (pending.empty())
+        {
+            if (admitting())
+            {
+                sleepUntil(arrivalMs);
+            }
+            continue;
+        }
+
+        float oldestMs = pending.front().arrivalMs;
+        for (const auto& r : pending)
+        {
+            oldestMs = std::min(oldestMs, r.arrivalMs);
+        }
+        const bool full = pending.size() >= capacity;
+        const bool waited = oldestMs + maxQueueDelayMs <= nowMs;
+        const bool cut = !admitting() || arrivalMs + serviceMs > pending.front().deadlineMs;
+        if (!full && !waited && !cut)
+        {
+            sleepUntil(std::min(arrivalMs, oldestMs + maxQueueDelayMs));
+            continue;
+        }
+
+        const size_t stream = next;
+        auto& s = iStreams[stream];
+        if (s->busy())
+        {
+            // Admit and shed again once the slot is free, the wait may have made requests late
+            const size_t first = trace.size();
+            s->sync(mainStart, trace);
+            complete(stream, first);
+            continue;
+        }
+        next = (next + 1) % iStreams.size();
+        std::vector<Request> batch;
+        while (!pending.empty() && batch.size() < capacity)
+        {
+            std::pop_heap(pending.begin(), pending.end(), later);
+            batch.push_back(pending.back());
+            pending.pop_back();
+        }
+        float batchArrivalMs = batch.front().arrivalMs;
+        for (const auto& r : batch)
+        {
+            batchArrivalMs = std::min(batchArrivalMs, r.arrivalMs);
+        }
+        s->query(batchArrivalMs, maxBatch ? static_cast<int>(batch.size()) : 0);
+        running[stream].push_back(std::move(batch));
+    }
+    for (size_t s = 0; s < iStreams.size(); ++s)
+    {
+        const size_t first = trace.size();
+        iStreams[s]->syncAll(mainStart, trace);
+        complete(s, first);
+    }
+}
+
+IterationStreams makeIterationStreams(
+    const InferenceOptions& inference, InferenceEnvironment& iEnv, const SyncStruct& sync, int offset, int streams)
+{
+    IterationStreams iStreams;
+    for (int s = 0; s < streams; ++s)
+    {
+        auto& context = *iEnv.context[offset + s];
+        auto enqueue = inference.batch ? EnqueueFunction(EnqueueImplicit(inference.batch)) : EnqueueFunction(EnqueueExplicit());
+        std::vector<Bindings*> bindings{iEnv.bindings[offset + s].get()};
+        for (const auto& slot : iEnv.slotBindings[offset + s])
+        {
+            bindings.push_back(slot.get());
+        }
+        std::unique_ptr<OutputValidator::Check> check;
+        if (iEnv.validator)
+        {
+            check = iEnv.validator->makeCheck(bindings);
+        }
+        iStreams.emplace_back(new Iteration(offset + s, inference.spin, context, std::move(bindings), enqueue,
+            sync.hostStart, iEnv.maxBatch, inference.graph ? inference.graphCacheSize : 0, inference.priority));
+        iStreams.back()->setSharedMemory(iEnv.sharedMemory.get());
+        iStreams.back()->setRecorder(iEnv.recorder.get());
+        iStreams.back()->setCheck(std::move(check));
+        iStreams.back()->setTimingSample(inference.timingSample);
+        if (!iEnv.shapeSamplers.empty())
+        {
+            iStreams.back()->setShapeSampler(iEnv.shapeSamplers[offset + s].get());
+        }
+        iStreams.back()->setReplay(iEnv.replay.get());
+        if (inference.hybridWait)
+        {
+            iStreams.back()->setHybridWait();
+        }
+        if (inference.graphIteration)
+        {
+            iStreams.back()->setGraphIteration();
+        }
+        if (iEnv.copyStreams)
+        {
+            iStreams.back()->setCopyStreams(iEnv.copyStreams.get());
+        }
+        iStreams.back()->setMicroBatches(inference.microBatches, inference.batch / inference.microBatches);
+        if (!iEnv.tilings.empty())
+        {
+            iStreams.back()->setTiling(iEnv.tilings[offset + s].get());
+        }
+        if (!iEnv.assemblies.empty())
+        {
+            iStreams.back()->setBatchAssembly(iEnv.assemblies[offset + s].get());
+        }
+    }
+    return iStreams;
+}
+
+//!
+//! \brief Run the iterations of two environments in turn, alternating which one goes first from one round to the next
+//!
+//! Every round runs one iteration on each stream of both environments, so clock and thermal drift affect both alike.
+//! Rounds that start before the end of the warm up are not traced, the traces of both hold the same rounds in order.
+//!
+void comparisonLoop(IterationStreams& iStreamsA, IterationStreams& iStreamsB, const TrtCudaEvent& mainStart,
+    int iterations, float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& traceA,
+    std::vector<InferenceTrace>& traceB)
+{
+    const auto iterate = [&mainStart](IterationStreams& iStreams, std::vector<InferenceTrace>& trace)
+    {
+        for (auto& s : iStreams)
+        {
+            s->query();
+        }
+        for (auto& s : iStreams)
+        {
+            s->syncAll(mainStart, trace);
+        }
+    };
+    const auto startsAfter = [](float ms, const std::vector<InferenceTrace>& trace)
+    {
+        return std::all_of(trace.begin(), trace.end(), [ms](const InferenceTrace& t) { return t.computeStart >= ms; });
+    };
+
+    float durationMs = 0;
+    std::vector<InferenceTrace> roundA;
+    std::vector<InferenceTrace> roundB;
+    for (int i = 0, rounds = 0; rounds < iterations || durationMs < maxDurationMs; ++i)
+    {
+        roundA.clear();
+        roundB.clear();
+        if (i % 2)
+        {
+            iterate(iStreamsB, roundB);
+            iterate(iStreamsA, roundA);
+        }
+        else
+        {
+            iterate(iStreamsA, roundA);
+            iterate(iStreamsB, roundB);
+        }
+        for (const auto& t : roundA)
+        {
+            durationMs = std::max(durationMs, t.computeStart);
+        }
+        for (const auto& t : roundB)
+        {
+            durationMs = std::max(durationMs, t.computeStart);
+        }
+        if (startsAfter(warmupMs, roundA) && startsAfter(warmupMs, roundB))
+        {
+            traceA.insert(traceA.end(), roundA.begin(), roundA.end());
+            traceB.insert(traceB.end(), roundB.begin(), roundB.end());
+            ++rounds;
+        }
+    }
+}
+
+//!
+//! \param lane The tag of the trace entries, the device or the index of the environment when several share a device
+//! \param share The fraction of the offered request rate served by the environment
+//! \param cpu The CPU the thread is pinned to, -1 to leave it to the scheduler
+//!
+void inferenceExecution(const InferenceOptions& inference, InferenceEnvironment& iEnv, SyncStruct& sync, std::mutex& traceMutex,
+    int device, int lane, float share, int cpu, int offset, int streams, std::vector<InferenceTrace>& trace)
+{
+    if (cpu >= 0 && !setThreadAffinity({cpu}))
+    {
+        gLogWarning << "Could not pin the inference thread " << offset << " of device " << device << " to CPU " << cpu
+                    << std::endl;
+    }
+    cudaCheck(cudaSetDevice(device));
+    float warmupMs = static_cast<float>(inference.warmup);
+    float durationMs = static_cast<float>(inference.duration) * 1000 + warmupMs;
+
+    IterationStreams iStreams = makeIterationStreams(inference, iEnv, sync, offset, streams);
+    for (auto& s : iStreams)
+    {
+        s->wait(sync.mainStart);
+    }
+
+    // The queries are counted in the histograms of the thread as they complete, except with a warm up that ends
+    // when the run is steady, where they are counted from the trace once the end of the warm up is known
+    const bool convergenceRun = !iEnv.replay && !inference.qps && (inference.steadyState || inference.confidence);
+    LatencyHistograms histograms;
+    if (!convergenceRun)
+    {
+        for (auto& s : iStreams)
+        {
+            s->setHistograms(&histograms, warmupMs, iEnv.keepTrace);
+        }
+    }
+
+    std::vector<InferenceTrace> localTrace;
+    DeadlineStats deadlines;
+    ConvergenceStats convergence;
+    const double cpuStart = threadCpuMs();
+    const auto wallStart = std::chrono::high_resolution_clock::now();
+    if (iEnv.replay)
+    {
+        const int threads = inference.threads ? inference.streams : 1;
+        replayLoop(iStreams, sync.mainStart, *iEnv.replay, inference.replaySpeed, offset, threads, localTrace);
+    }
+    else if (inference.qps)
+    {
+        // Each thread of each environment offers its part of the share of the requested rate
+        const int threads = inference.threads ? inference.streams : 1;
+        const unsigned int seed = lane * threads + offset;
+        ArrivalSchedule schedule(inference.qps * share / threads, inference.arrival, seed);
+        if (!inference.deadlines.empty())
+        {
+            const float maxQueueDelayMs = static_cast<float>(inference.maxQueueDelay) / 1000;
+            deadlineLoop(iStreams, sync.mainStart, schedule, inference.deadlines, seed,
+                inference.dynamicBatching ? iEnv.maxBatch : 0, maxQueueDelayMs, inference.iterations, durationMs,
+                warmupMs, localTrace, deadlines);
+        }
+        else if (inference.dynamicBatching)
+        {
+            const float maxQueueDelayMs = static_cast<float>(inference.maxQueueDelay) / 1000;
+            dynamicBatchingLoop(iStreams, sync.mainStart, schedule, iEnv.maxBatch, maxQueueDelayMs, inference.iterations,
+                durationMs, warmupMs, localTrace);
+        }
+        else
+        {
+            openLoop(iStreams, sync.mainStart, schedule, inference.iterations, durationMs, warmupMs, localTrace);
+        }
+    }
+    else if (inference.steadyState || inference.confidence)
+    {
+        const ConvergenceMonitor monitor(inference.steadyState, inference.confidence, inference.convergenceWindow);
+        const float maxDurationMs = static_cast<float>(inference.duration) * 1000;
+        convergence.adaptiveWarmup = inference.steadyState > 0;
+        convergence.earlyStop = inference.confidence > 0;
+        convergence.width = inference.confidence;
+        convergenceLoop(iStreams, sync.mainStart, monitor, convergence.adaptiveWarmup, convergence.earlyStop,
+            inference.batch, inference.iterations, maxDurationMs, warmupMs, localTrace, convergence);
+    }
+    else if (inference.asyncCompletion)
+    {
+        asyncLoop(iStreams, sync.mainStart, inference.iterations, durationMs, warmupMs, localTrace);
+    }
+    else
+    {
+        inferenceLoop(iStreams, sync.mainStart, inference.batch, inference.iterations, durationMs, warmupMs, localTrace);
+    }
+    const double cpuMs = threadCpuMs() - cpuStart;
+    const double wallMs
+        = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - wallStart).count();
+
+    if (convergenceRun)
+    {
+        histograms = traceToHistograms(localTrace, convergence.warmupMs);
+    }
+    for (auto& t : localTrace)
+    {
+        t.device = lane;
+    }
+    std::lock_guard<std::mutex> lock(traceMutex);
+    trace.insert(trace.end(), localTrace.begin(), localTrace.end());
+    iEnv.histograms.merge(histograms);
+    iEnv.waitStats.cpuMs += cpuMs;
+    iEnv.deadlineStats.merge(deadlines);
+    iEnv.convergence = convergence;
+    iEnv.waitStats.wallMs = std::max(iEnv.waitStats.wallMs, wallMs);
+    for (const auto& s : iStreams)
+    {
+        const EventWaiter& waiter = s->getWaiter();
+        iEnv.waitStats.waits += waiter.getWaits();
+        iEnv.waitStats.spunWaits += waiter.getSpunWaits();
+        iEnv.waitStats.waitMs += waiter.getWaitMs();
+        if (const auto* graphs = s->getGraphCache())
+        {
+            iEnv.graphCacheHits += graphs->hits();
+            iEnv.graphCacheMisses += graphs->misses();
+            iEnv.graphCacheEvictions += graphs->evictions();
+        }
+    }
+}
+
+inline
+std::thread makeThread(const InferenceOptions& inference, InferenceEnvironment& iEnv, SyncStruct& sync, std::mutex& traceMutex,
+    int device, int lane, float share, int cpu, int thread, int streamsPerThread, std::vector<InferenceTrace>& trace)
+{
+    return std::thread(inferenceExecution, std::cref(inference), std::ref(iEnv), std::ref(sync), std::ref(traceMutex), device,
+        lane, share, cpu, thread, streamsPerThread, std::ref(trace));
+}
+
+//!
+//! \brief Run the environments at once, each on its device, and tag the trace entries of each with its lane
+//!
+//! Each environment runs with its inference options and serves its share of their offered request rate. The sleep
+//! time, telemetry and affinity come from the options of the first environment. The telemetry of a device goes to the
+//! first environment running on it.
+//!
+void runEnvironments(const std::vector<InferenceOptions>& inferences, const std::vector<InferenceEnvironment*>& iEnvs,
+    const std::vector<int>& devices, const std::vector<int>& lanes, const std::vector<float>& shares,
+    std::vector<InferenceTrace>& trace)
+{
+    trace.resize(0);
+    const InferenceOptions& inference = inferences.front();
+    for (auto* env : iEnvs)
+    {
+        env->waitStats = WaitStats{};
+        env->deadlineStats = DeadlineStats{};
+        env->histograms = LatencyHistograms{};
+    }
+
+    // The start events of the environments are recorded back to back, their timelines are aligned on them
+    std::vector<std::unique_ptr<SyncStruct>> syncs;
+    for (const auto device : devices)
+    {
+        cudaCheck(cudaSetDevice(device));
+        syncs.emplace_back(new SyncStruct);
+        auto& sync = *syncs.back();
+        sync.sleep = inference.sleep;
+        sync.mainStream.sleep(&sync.sleep);
+        sync.mainStart.record(sync.mainStream);
+        sync.hostStart = std::chrono::high_resolution_clock::now();
+    }
+
+    // The samples share the host clock origin of the enqueue times of the trace
+    std::vector<int> sampled;
+    for (const auto device : devices)
+    {
+        if (std::find(sampled.begin(), sampled.end(), device) == sampled.end())
+        {
+            sampled.push_back(device);
+        }
+    }
+    TelemetrySampler telemetry(sampled, inference.telemetry);
+    if (inference.telemetry && !telemetry.start(syncs.front()->hostStart))
+    {
+        gLogWarning << "NVML is not available for all the devices, telemetry disabled" << std::endl;
+    }
+
+    // The threads take the CPUs of the list in turn, across devices unless each device has its local CPUs
+    std::vector<std::vector<int>> cpus(devices.size(), inference.affinity);
+    if (inference.numaAffinity)
+    {
+        for (size_t d = 0; d < devices.size(); ++d)
+        {
+            cpus[d] = deviceLocalCpus(devices[d]);
+            if (cpus[d].empty())
+            {
+                gLogWarning << "The CPUs local to device " << devices[d] << " are unknown, its threads are not pinned"
+                            << std::endl;
+            }
+        }
+    }
+
+    std::mutex traceMutex;
+    std::vector<std::thread> threads;
+    size_t turn{0};
+    for (size_t d = 0; d < devices.size(); ++d)
+    {
+        const int threadsNum = inferences[d].threads ? inferences[d].streams : 1;
+        const int streamsPerThread = inferences[d].streams / threadsNum;
+        if (inference.numaAffinity)
+        {
+            turn = 0;
+        }
+        for (int t = 0; t < threadsNum; ++t, ++turn)
+        {
+            const int cpu = cpus[d].empty() ? -1 : cpus[d][turn % cpus[d].size()];
+            threads.emplace_back(makeThread(inferences[d], *iEnvs[d], *syncs[d], traceMutex, devices[d], lanes[d],
+                shares[d], cpu, t, streamsPerThread, trace));
+        }
+    }
+    for (auto& th : threads)
+    {
+        th.join();
+    }
+    cudaCheck(cudaSetDevice(devices.front()));
+
+    const auto samples = telemetry.stop();
+    for (size_t d = 0; d < devices.size(); ++d)
+    {
+        auto& deviceSamples = iEnvs[d]->telemetry;
+        deviceSamples.clear();
+        if (std::find(devices.begin(), devices.begin() + d, devices[d]) == devices.begin() + d)
+        {
+            std::copy_if(samples.begin(), samples.end(), std::back_inserter(deviceSamples),
+                [&devices, d](const TelemetrySample& s) { return s.device == devices[d]; });
+        }
+    }
+
+    auto cmpTrace = [](const InferenceTrace& a, const InferenceTrace& b) { return a.inStart < b.inStart; };
+    std::sort(trace.begin(), trace.end(), cmpTrace);
+}
+
+} // namespace
+
+void runInference(const InferenceOptions& inference, InferenceEnvironment& iEnv, std::vector<InferenceTrace>& trace)
+{
+    int device{0};
+    cudaCheck(cudaGetDevice(&device));
+    runInference(inference, {&iEnv}, {device}, trace);
+}
+
+void runInference(const InferenceOptions& inference, const std::vector<InferenceEnvironment*>& iEnvs,
+    const std::vector<int>& devices, std::vector<InferenceTrace>& trace)
+{
+    const std::vector<float> shares(devices.size(), 1.0F / devices.size());
+    runEnvironments(std::vector<InferenceOptions>(devices.size(), inference), iEnvs, devices, devices, shares, trace);
+}
+
+void runHeterogeneous(const InferenceOptions& inference, const std::vector<InferenceEnvironment*>& iEnvs,
+    const std::vector<float>& weights, std::vector<InferenceTrace>& trace)
+{
+    int device{0};
+    cudaCheck(cudaGetDevice(&device));
+    std::vector<int> lanes(iEnvs.size());
+    std::iota(lanes.begin(), lanes.end(), 0);
+    const float total = std::accumulate(weights.begin(), weights.end(), 0.0F);
+    std::vector<float> shares;
+    for (const auto w : weights)
+    {
+        shares.push_back(w / total);
+    }
+    const std::vector<InferenceOptions> inferences(iEnvs.size(), inference);
+    runEnvironments(inferences, iEnvs, std::vector<int>(iEnvs.size(), device), lanes, shares, trace);
+}
+
+void runConcurrent(const std::vector<InferenceOptions>& inferences, const std::vector<InferenceEnvironment*>& iEnvs,
+    std::vector<InferenceTrace>& trace)
+{
+    int device{0};
+    cudaCheck(cudaGetDevice(&device));
+    std::vector<int> lanes(iEnvs.size());
+    std::iota(lanes.begin(), lanes.end(), 0);
+    runEnvironments(inferences, iEnvs, std::vector<int>(iEnvs.size(), device), lanes,
+        std::vector<float>(iEnvs.size(), 1.0F), trace);
+}
+
+void runComparison(const InferenceOptions& inference, InferenceEnvironment& iEnvA, InferenceEnvironment& iEnvB,
+    std::vector<InferenceTrace>& traceA, std::vector<InferenceTrace>& traceB)
+{
+    traceA.resize(0);
+    traceB.resize(0);
+
+    SyncStruct sync;
+    sync.sleep = inference.sleep;
+    sync.mainStream.sleep(&sync.sleep);
+    sync.mainStart.record(sync.mainStream);
+    sync.hostStart = std::chrono::high_resolution_clock::now();
+
+    IterationStreams iStreamsA = makeIterationStreams(inference, iEnvA, sync, 0, inference.streams);
+    IterationStreams iStreamsB = makeIterationStreams(inference, iEnvB, sync, 0, inference.streams);
+    for (auto* iStreams : {&iStreamsA, &iStreamsB})
+    {
+        for (auto& s : *iStreams)
+        {
+            s->wait(sync.mainStart);
+        }
+    }
+
+    const float warmupMs = static_cast<float>(inference.warmup);
+    const float durationMs = static_cast<float>(inference.duration) * 1000 + warmupMs;
+    comparisonLoop(iStreamsA, iStreamsB, sync.mainStart, inference.iterations, durationMs, warmupMs, traceA, traceB);
+}
+
+bool runSwap(const InferenceOptions& inference, InferenceEnvironment& live,
+    const std::function<InferenceEnvironment*()>& prepare, SwapTiming& timing, const std::function<void()>& retire)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    struct Completion
+    {
+        clock::time_point start;
+        clock::time_point end;
+        bool swapped; // Served by the new environment
+    };
+
+    int device{0};
+    cudaCheck(cudaGetDevice(&device));
+    const auto enqueue = inference.batch ? EnqueueFunction(EnqueueImplicit(inference.batch)) : EnqueueFunction(EnqueueExplicit());
+    std::atomic<InferenceEnvironment*> serving{&live};
+    std::atomic<bool> prepared{false};
+    std::atomic<bool> drained{false}; // The server no longer runs the old environment
+    std::vector<Completion> completions;
+
+    std::thread server([&]()
+    {
+        cudaCheck(cudaSetDevice(device));
+        TrtCudaStream stream;
+        int after{0};
+        int before{0};
+        while (!prepared.load() || (serving.load() != &live && after < std::max(before, inference.iterations)))
+        {
+            auto* iEnv = serving.load();
+            const bool swapped = iEnv != &live;
+            if (swapped)
+            {
+                drained.store(true);
+            }
+            const auto start = clock::now();
+            auto& bindings = *iEnv->bindings.front();
+            bindings.transferInputToDevice(stream);
+            enqueue(*iEnv->context.front(), bindings.getDeviceBuffers(), stream, 0);
+            bindings.transferOutputToHost(stream);
+            cudaCheck(cudaStreamSynchronize(stream.get()));
+            completions.push_back(Completion{start, clock::now(), swapped});
+            ++(swapped ? after : before);
+        }
+    });
+
+    const auto prepareStart = clock::now();
+    InferenceEnvironment* next = prepare();
+    const auto prepareEnd = clock::now();
+    float drainMs{0};
+    float retireMs{0};
+    if (next)
+    {
+        serving.store(next);
+        while (!drained.load())
+        {
+            std::this_thread::yield();
+        }
+        const auto drainEnd = clock::now();
+        drainMs = std::chrono::duration<float, std::milli>(drainEnd - prepareEnd).count();
+        if (retire)
+        {
+            retire();
+            retireMs = std::chrono::duration<float, std::milli>(clock::now() - drainEnd).count();
+        }
+    }
+    prepared.store(true);
+    server.join();
+
+    const auto ms = [](clock::duration d) { return std::chrono::duration<float, std::milli>(d).count(); };
+    timing = SwapTiming();
+    timing.prepareMs = ms(prepareEnd - prepareStart);
+    timing.drainMs = drainMs;
+    timing.retireMs = retireMs;
+    for (size_t c = 0; c < completions.size(); ++c)
+    {
+        const float latencyMs = ms(completions[c].end - completions[c].start);
+        timing.maxLatencyMs = std::max(timing.maxLatencyMs, latencyMs);
+        if (!completions[c].swapped)
+        {
+            timing.meanLatencyMs += latencyMs;
+            ++timing.before;
+            continue;
+        }
+        if (!timing.after++)
+        {
+            timing.firstLatencyMs = latencyMs;
+        }
+    }
+    timing.meanLatencyMs /= std::max(timing.before, 1);
+    for (size_t c = 1; c < completions.size(); ++c)
+    {
+        const float gapMs = ms(completions[c].end - completions[c - 1].end);
+        timing.meanGapMs += gapMs;
+        timing.maxGapMs = std::max(timing.maxGapMs, gapMs);
+        if (completions[c].swapped && !completions[c - 1].swapped)
+        {
+            timing.swapGapMs = gapMs;
+        }
+    }
+    timing.meanGapMs /= std::max(completions.size(), static_cast<size_t>(2)) - 1;
+    return next != nullptr;
+}
+
+void shareInputs(const InferenceEnvironment& source, InferenceEnvironment& iEnv)
+{
+    for (size_t s = 0; s < iEnv.bindings.size() && s < source.bindings.size(); ++s)
+    {
+        iEnv.bindings[s]->shareInputs(*source.bindings[s]);
+    }
 }
 
 } // namespace sample
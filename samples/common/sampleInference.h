@@ -17,37 +17,264 @@
 #ifndef TRT_SAMPLE_INFERENCE_H
 #define TRT_SAMPLE_INFERENCE_H
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <iostream>
+#include <random>
 #include <vector>
 #include <string>
 
 #include "NvInfer.h"
 
+#include "sampleBatchAssembly.h"
+#include "sampleDevice.h"
+#include "sampleOutputRecorder.h"
+#include "sampleReplay.h"
 #include "sampleUtils.h"
 #include "sampleReporting.h"
+#include "sampleTelemetry.h"
+#include "sampleTiling.h"
+#include "sampleValidation.h"
 
 namespace sample
 {
 
+//!
+//! \class SharedDeviceMemory
+//! \brief Activation memory shared by execution contexts that never compute at the same time
+//!
+//! The region grows to the largest device memory size of the contexts attached to it. Their computes are serialized,
+//! each one waits on its stream for the previous compute of any of the contexts, so they can still run on different
+//! streams and overlap their transfers.
+//!
+class SharedDeviceMemory
+{
+public:
+    //!
+    //! \brief Make a context created without device memory use the region, before any of the contexts runs
+    //!
+    void attach(nvinfer1::IExecutionContext& context);
+
+    //!
+    //! \brief Run compute, which enqueues on stream, after the previous compute on the region
+    //!
+    void serialize(TrtCudaStream& stream, const std::function<void()>& compute);
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    //! The device memory the contexts attached would use without sharing
+    size_t separateSize() const
+    {
+        return mSeparateSize;
+    }
+
+private:
+    std::mutex mMutex;
+    TrtDeviceBuffer mBuffer;
+    size_t mSize{0};
+    size_t mSeparateSize{0};
+    std::vector<nvinfer1::IExecutionContext*> mContexts;
+    TrtCudaEvent mLastCompute{false};
+};
+
+//!
+//! \class ShapeSampler
+//! \brief Draws the input shapes of each query of a stream within its optimization profile, with --shapeChurn
+//!
+//! Shapes come from the histogram of the options, among its shapes that fit the profile, or are drawn uniformly within
+//! the profile bounds. Uniform draws give the dynamic dimensions of the same index and profile range the same value in
+//! all the inputs, as for a sequence length shared by several inputs. Each draw falls in a bucket, one per shape of the
+//! histogram, or one per quarter of the range of input volumes of the profile.
+//!
+class ShapeSampler
+{
+public:
+    //! Input bindings and their dimensions
+    using Shapes = std::vector<std::pair<int, nvinfer1::Dims>>;
+
+    //!
+    //! \brief Set up the draws for the profile of a context
+    //!
+    //! \return False if the profile has no dynamic input or no shape of the histogram fits it
+    //!
+    bool setUp(const nvinfer1::IExecutionContext& context, const InferenceOptions& inference, unsigned int seed);
+
+    //!
+    //! \return The bucket of the shapes drawn
+    //!
+    int draw(Shapes& shapes);
+
+    //!
+    //! \brief Names of the buckets of the draws with the inference options
+    //!
+    static std::vector<std::string> bucketNames(const InferenceOptions& inference);
+
+private:
+    static constexpr int kUNIFORM_BUCKETS{4};
+
+    struct Range
+    {
+        std::string name;
+        int binding{0};
+        nvinfer1::Dims min{};
+        nvinfer1::Dims max{};
+        std::vector<int> values; //!< Index of the value drawn for each dimension, -1 for static dimensions
+    };
+
+    std::default_random_engine mEngine;
+    std::vector<Range> mRanges; //!< Execution tensor inputs of the profile
+    std::vector<std::uniform_int_distribution<int>> mValues;
+    double mMinVolume{0};
+    double mMaxVolume{0};
+    std::vector<Shapes> mShapes; //!< Shapes of the histogram that fit the profile
+    std::vector<int> mBuckets;   //!< Index in the histogram of each of mShapes
+    std::discrete_distribution<int> mPick;
+};
+
+//!
+//! \brief One stream for the input copies and one for the output copies of all the streams of a device
+//!
+//! The copies then reach the copy engines in the order their queries were submitted, one direction each, instead of
+//! interleaved from two streams per inference stream.
+//!
+struct CopyStreams
+{
+    TrtCudaStream input;
+    TrtCudaStream output;
+};
+
 struct InferenceEnvironment
 {
     TrtUniquePtr<nvinfer1::ICudaEngine> engine;
     std::unique_ptr<Profiler> profiler;
     std::vector<TrtUniquePtr<nvinfer1::IExecutionContext>> context;
     std::vector<std::unique_ptr<Bindings>> bindings;
+    //! Binding sets of the pipeline slots past the first of each stream, the first slot uses bindings
+    std::vector<std::vector<std::unique_ptr<Bindings>>> slotBindings;
+    int maxBatch{0}; //!< Largest batch gathered with dynamic batching, bindings are allocated for it
+    int graphCacheHits{0};      //!< Enqueues replayed from a captured CUDA graph
+    int graphCacheMisses{0};    //!< Enqueues that required a graph capture
+    int graphCacheEvictions{0}; //!< Graphs replaced in a full cache
+    std::vector<TelemetrySample> telemetry; //!< Samples of the device taken during the last inference run
+    StartupTimes startup; //!< Times of the engine creation and of the inference set up
+    WaitStats waitStats;  //!< Host cost of the waits for the completions of the last inference run
+    DeadlineStats deadlineStats; //!< Requests of the last inference run with --deadlines
+    ConvergenceStats convergence; //!< Warm up and precision of the last run with --steadyState or --confidence
+    LatencyHistograms histograms; //!< Latencies of the last inference run past its warm up, merged from its threads
+    bool keepTrace{true}; //!< Queries are kept in the trace of the run, not only counted in the histograms
+    //! Activation memory of the contexts with --shareDeviceMemory, environments set up with the same one share it
+    std::shared_ptr<SharedDeviceMemory> sharedMemory;
+    //! Records the outputs of every inference with --recordOutputs, environments may share one
+    std::shared_ptr<OutputRecorder> recorder;
+    //! Checks the outputs of every Nth inference on the device with --validateOutputs
+    std::shared_ptr<OutputValidator> validator;
+    //! Records the device memory of the contexts and bindings in phases of their own with --memoryReport
+    TrtCudaMemoryAccount* memoryAccount{nullptr};
+    //! Draw the input shapes of the queries of each stream with --shapeChurn
+    std::vector<std::unique_ptr<ShapeSampler>> shapeSamplers;
+    //! Copy streams of all the streams with --sharedCopyStreams, environments set up with the same one share it
+    std::shared_ptr<CopyStreams> copyStreams;
+    //! Tiles of the image of the queries of each stream with --tiledImage
+    std::vector<std::unique_ptr<TiledInference>> tilings;
+    //! Requests of the dynamic batches of each stream with --batchAssembly
+    std::vector<std::unique_ptr<BatchAssembly>> assemblies;
+    //! Requests replayed with --replay, shared by the streams
+    std::unique_ptr<ReplayTrace> replay;
 };
 
 //!
 //! \brief Set up contexts and bindings for inference
 //!
-void setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inference);
+//! \return boolean Return false if the engine does not support the inference options
+//!
+bool setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inference);
 
 //!
 //! \brief Run inference and collect timing
 //!
 void runInference(const InferenceOptions& inference, InferenceEnvironment& iEnv, std::vector<InferenceTrace>& trace);
 
+//!
+//! \brief Run inference on several devices at once and collect timing
+//!
+//! Each environment is set up on the device of the same index and runs the streams and threads of the inference options.
+//! The offered request rate is shared between the devices and the trace entries are tagged with their device.
+//!
+void runInference(const InferenceOptions& inference, const std::vector<InferenceEnvironment*>& iEnvs,
+    const std::vector<int>& devices, std::vector<InferenceTrace>& trace);
+
+//!
+//! \brief Run several engines at once on the current device, typically on the GPU and on each DLA core
+//!
+//! Each environment runs the streams and threads of the inference options. The offered request rate is split between
+//! the environments in proportion to their weights, and the trace entries are tagged with the environment index.
+//!
+void runHeterogeneous(const InferenceOptions& inference, const std::vector<InferenceEnvironment*>& iEnvs,
+    const std::vector<float>& weights, std::vector<InferenceTrace>& trace);
+
+//!
+//! \brief Run several engines at once on the current device, each with its own inference options
+//!
+//! Each environment runs the streams, threads, request rate and stream priority of its options, the trace entries are
+//! tagged with the environment index. The sleep time, telemetry and thread affinity come from the first options.
+//!
+void runConcurrent(const std::vector<InferenceOptions>& inferences, const std::vector<InferenceEnvironment*>& iEnvs,
+    std::vector<InferenceTrace>& trace);
+
+//!
+//! \brief Run the iterations of two engines interleaved on the current device and collect the timing of each
+//!
+//! Both environments are set up with the same inference options. A single thread drives all their streams, each round
+//! runs one iteration of every stream of both engines, and the n-th entries of the traces come from the same round.
+//!
+void runComparison(const InferenceOptions& inference, InferenceEnvironment& iEnvA, InferenceEnvironment& iEnvB,
+    std::vector<InferenceTrace>& traceA, std::vector<InferenceTrace>& traceB);
+
+//!
+//! \struct SwapTiming
+//! \brief Inferences served across a swap of environments, times in milliseconds
+//!
+struct SwapTiming
+{
+    float prepareMs{0};      //!< Time to prepare the new environment, while the old one serves
+    float drainMs{0};        //!< Time from the switch to the end of the last inference of the old environment
+    float retireMs{0};       //!< Time to release the old environment, while the new one serves
+    float meanGapMs{0};      //!< Mean time between two completed inferences
+    float maxGapMs{0};       //!< Longest time between two completed inferences, which includes the swap
+    float swapGapMs{0};      //!< Time between the last inference of the old environment and the first of the new one
+    float meanLatencyMs{0};  //!< Mean latency of the inferences of the old environment
+    float maxLatencyMs{0};   //!< Longest latency of an inference
+    float firstLatencyMs{0}; //!< Latency of the first inference of the new environment
+    int before{0};           //!< Inferences served by the old environment
+    int after{0};            //!< Inferences served by the new environment
+};
+
+//!
+//! \brief Serve inference on the first stream of an environment while another one is prepared, then switch to it
+//!
+//! Inference runs back to back on a serving thread, prepare runs on the calling thread. Once it returns, the next
+//! inference runs on the environment it returned, for as many iterations as ran before, and at least the iterations of
+//! the inference options. Once the inference in flight on the old environment completes, retire, if given, runs on the
+//! calling thread while the new environment serves.
+//!
+//! \return boolean Return false if prepare returned nullptr, the old environment served all the inferences then
+//!
+bool runSwap(const InferenceOptions& inference, InferenceEnvironment& live,
+    const std::function<InferenceEnvironment*()>& prepare, SwapTiming& timing,
+    const std::function<void()>& retire = nullptr);
+
+//!
+//! \brief Make the streams of an environment transfer their inputs from the host buffers of another environment
+//!
+//! Both environments run the same engine with the same inference options, typically on different devices. The source
+//! environment must outlive the other one.
+//!
+void shareInputs(const InferenceEnvironment& source, InferenceEnvironment& iEnv);
+
 } // namespace sample
 
 #endif // TRT_SAMPLE_INFERENCE_H
@@ -14,18 +14,23 @@
  * limitations under the License.
  */
 
+#include <cmath>
 #include <cstring>
 #include <string>
 #include <vector>
 #include <functional>
 #include <algorithm>
 #include <stdexcept>
+#include <fstream>
+#include <sstream>
 #include <iostream>
+#include <map>
 
 #include "NvInfer.h"
 
 #include "sampleUtils.h"
 #include "sampleOptions.h"
+#include "sampleProfiles.h"
 
 namespace sample
 {
@@ -106,6 +111,34 @@ inline nvinfer1::DataType stringToValue<nvinfer1::DataType>(const std::string& o
     return dt->second;
 }
 
+//! Reads "layer:precision" lines, layer names may contain colons so the precision follows the last one
+std::unordered_map<std::string, nvinfer1::DataType> readLayerPrecisions(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        throw std::invalid_argument("Could not read layer precisions " + fileName);
+    }
+    std::unordered_map<std::string, nvinfer1::DataType> precisions;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        const auto colon = line.rfind(':');
+        const auto precision
+            = stringToValue<nvinfer1::DataType>(colon == std::string::npos ? "" : line.substr(colon + 1));
+        if (colon == 0 || precision == nvinfer1::DataType::kINT32)
+        {
+            throw std::invalid_argument("Invalid layer precision " + line + " in " + fileName);
+        }
+        precisions[line.substr(0, colon)] = precision;
+    }
+    return precisions;
+}
+
 template <>
 inline nvinfer1::TensorFormats stringToValue<nvinfer1::TensorFormats>(const std::string& option)
 {
@@ -127,6 +160,31 @@ inline nvinfer1::TensorFormats stringToValue<nvinfer1::TensorFormats>(const std:
     return formats;
 }
 
+template <>
+inline InputMemory stringToValue<InputMemory>(const std::string& option)
+{
+    const std::unordered_map<std::string, InputMemory> strToMemory{
+        {"device", InputMemory::kDEVICE}, {"mapped", InputMemory::kMAPPED}, {"managed", InputMemory::kMANAGED}};
+    auto memory = strToMemory.find(option);
+    if (memory == strToMemory.end())
+    {
+        throw std::invalid_argument("Invalid input memory " + option);
+    }
+    return memory->second;
+}
+
+template <>
+inline ArrivalType stringToValue<ArrivalType>(const std::string& option)
+{
+    const std::unordered_map<std::string, ArrivalType> strToArrival{{"fixed", ArrivalType::kFIXED}, {"poisson", ArrivalType::kPOISSON}};
+    auto arrival = strToArrival.find(option);
+    if (arrival == strToArrival.end())
+    {
+        throw std::invalid_argument("Invalid arrival distribution " + option);
+    }
+    return arrival->second;
+}
+
 template <>
 inline IOFormat stringToValue<IOFormat>(const std::string& option)
 {
@@ -185,7 +243,7 @@ inline bool checkEraseOption(Arguments& arguments, const std::string& option, T&
     auto match = arguments.find(option);
     if (match != arguments.end())
     {
-        value = stringToValue<T>(match->second);
+        value = stringToValue<T>(match->second.first);
         arguments.erase(match);
         return true;
     }
@@ -193,6 +251,9 @@ inline bool checkEraseOption(Arguments& arguments, const std::string& option, T&
     return false;
 }
 
+//!
+//! \brief Collect all the values of an option, in the order they appear on the command line
+//!
 template <typename T>
 inline bool checkEraseRepeatedOption(Arguments& arguments, const std::string& option, std::vector<T>& values)
 {
@@ -201,13 +262,131 @@ inline bool checkEraseRepeatedOption(Arguments& arguments, const std::string& op
     {
         return false;
     }
-    auto addValue = [&values](Arguments::value_type& value) {values.emplace_back(stringToValue<T>(value.second));};
+    std::vector<std::pair<std::string, int>> matches;
+    auto addValue = [&matches](Arguments::value_type& value) { matches.emplace_back(value.second); };
     std::for_each(match.first, match.second, addValue);
+    auto cmpPosition = [](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b) { return a.second < b.second; };
+    std::sort(matches.begin(), matches.end(), cmpPosition);
+    for (const auto& m : matches)
+    {
+        values.emplace_back(stringToValue<T>(m.first));
+    }
     arguments.erase(match.first, match.second);
     return true;
 }
 
-void insertShapes(std::unordered_map<std::string, ShapeRange>& shapes, const std::string& name, const nvinfer1::Dims& dims)
+//!
+//! \brief Read a histogram of request shapes, one "count spec" line per shapes, with a --shapes spec
+//!
+ShapeHistogram readShapeHistogram(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        throw std::invalid_argument(std::string("Cannot open shape histogram ") + fileName);
+    }
+    ShapeHistogram histogram;
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number)
+    {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        double count{0};
+        std::string spec;
+        InputShapes shapes;
+        if (fields >> count >> spec && count > 0)
+        {
+            for (const auto& s : splitToStringVec(spec, ','))
+            {
+                shapes.insert(splitNameAndValue<nvinfer1::Dims>(s));
+            }
+        }
+        const auto& first = histogram.empty() ? shapes : histogram.front().first;
+        const bool consistent = !shapes.empty() && shapes.size() == first.size()
+            && std::all_of(shapes.begin(), shapes.end(), [&first](const InputShapes::value_type& s) {
+                   const auto other = first.find(s.first);
+                   return other != first.end() && other->second.nbDims == s.second.nbDims;
+               });
+        if (!consistent)
+        {
+            throw std::invalid_argument(fileName + ":" + std::to_string(number) + " is not a positive count followed "
+                "by the shapes of the same inputs as the other lines");
+        }
+        histogram.emplace_back(shapes, count);
+    }
+    if (histogram.empty())
+    {
+        throw std::invalid_argument(std::string("Shape histogram ") + fileName + " has no shapes");
+    }
+    return histogram;
+}
+
+//!
+//! \brief Read a trace of requests, one "arrivalMs [shapes [inputs]]" line per request
+//!
+//! The shapes are a --shapes spec, or "-" for the --shapes of the stream, and the inputs a --loadInputs spec. The
+//! requests are sorted by arrival, and the arrivals made relative to the first one.
+//!
+std::vector<ReplayRequest> readReplayTrace(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (!file)
+    {
+        throw std::invalid_argument(std::string("Cannot open replay trace ") + fileName);
+    }
+    std::vector<ReplayRequest> requests;
+    std::string line;
+    for (int number = 1; std::getline(file, line); ++number)
+    {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        ReplayRequest request;
+        std::string shapes;
+        std::string inputs;
+        std::string extra;
+        const bool arrival = (fields >> request.arrivalMs) && std::isfinite(request.arrivalMs);
+        fields >> shapes >> inputs;
+        if (!arrival || fields >> extra)
+        {
+            throw std::invalid_argument(fileName + ":" + std::to_string(number) + " is not an arrival time in ms "
+                "followed by optional shapes and inputs");
+        }
+        if (!shapes.empty() && shapes != "-")
+        {
+            for (const auto& spec : splitToStringVec(shapes, ','))
+            {
+                request.shapes.insert(splitNameAndValue<nvinfer1::Dims>(spec));
+            }
+        }
+        if (!inputs.empty())
+        {
+            splitInsertKeyValue(splitToStringVec(inputs, ','), request.inputs);
+        }
+        requests.push_back(std::move(request));
+    }
+    if (requests.empty())
+    {
+        throw std::invalid_argument(std::string("Replay trace ") + fileName + " has no requests");
+    }
+    std::stable_sort(requests.begin(), requests.end(),
+        [](const ReplayRequest& a, const ReplayRequest& b) { return a.arrivalMs < b.arrivalMs; });
+    const float first = requests.front().arrivalMs;
+    for (auto& r : requests)
+    {
+        r.arrivalMs -= first;
+    }
+    return requests;
+}
+
+void insertShapes(ShapeProfile& shapes, const std::string& name, const nvinfer1::Dims& dims)
 {
     std::pair<std::string, ShapeRange> profile;
     profile.first = name;
@@ -218,17 +397,25 @@ void insertShapes(std::unordered_map<std::string, ShapeRange>& shapes, const std
 }
 
 template <typename T>
-void printShapes(std::ostream& os, const char* phase, const T& shapes)
+void printShapes(std::ostream& os, const char* phase, const std::vector<T>& shapeSets)
 {
-    if (shapes.empty())
+    if (shapeSets.empty())
     {
         os << "Input " << phase << " shapes: model" << std::endl;
     }
     else
     {
-        for (const auto& s : shapes)
+        for (size_t p = 0; p < shapeSets.size(); ++p)
         {
-            os << "Input " << phase << " shape: " << s.first << "=" << s.second << std::endl;
+            for (const auto& s : shapeSets[p])
+            {
+                os << "Input " << phase << " shape";
+                if (shapeSets.size() > 1)
+                {
+                    os << " (" << p << ")";
+                }
+                os << ": " << s.first << "=" << s.second << std::endl;
+            }
         }
     }
 }
@@ -257,11 +444,11 @@ Arguments argsToArgumentsMap(int argc, char* argv[])
         if (valuePtr)
         {
             std::string value{valuePtr + 1};
-            arguments.emplace(std::string(argv[i], valuePtr - argv[i]), value);
+            arguments.emplace(std::string(argv[i], valuePtr - argv[i]), std::make_pair(value, i));
         }
         else
         {
-            arguments.emplace(argv[i], "");
+            arguments.emplace(argv[i], std::make_pair(std::string(), i));
         }
     }
     return arguments;
@@ -373,34 +560,59 @@ void BuildOptions::parse(Arguments& arguments)
     getFormats(inputFormats, "--inputIOFormats");
     getFormats(outputFormats, "--outputIOFormats");
 
-    auto getShapes = [&arguments](std::unordered_map<std::string, ShapeRange>& shapes, const char* argument,
+    // The n-th occurrence of each of --minShapes, --optShapes and --maxShapes belongs to the n-th profile
+    auto getShapes = [&arguments](std::vector<ShapeProfile>& profiles, const char* argument,
                          nvinfer1::OptProfileSelector selector) {
-        std::string list;
-        checkEraseOption(arguments, argument, list);
-        std::vector<std::string> shapeList{splitToStringVec(list, ',')};
-        for (const auto& s : shapeList)
+        std::vector<std::string> lists;
+        checkEraseRepeatedOption(arguments, argument, lists);
+        if (profiles.size() < lists.size())
         {
-            auto nameDimsPair = splitNameAndValue<nvinfer1::Dims>(s);
-            std::string tensorName = nameDimsPair.first;
-            nvinfer1::Dims dims = nameDimsPair.second;
-
-            if (shapes.find(tensorName) == shapes.end())
-            {
-                insertShapes(shapes, tensorName, dims);
-            }
-            else
+            profiles.resize(lists.size());
+        }
+        for (size_t p = 0; p < lists.size(); ++p)
+        {
+            auto& shapes = profiles[p];
+            std::vector<std::string> shapeList{splitToStringVec(lists[p], ',')};
+            for (const auto& s : shapeList)
             {
-                shapes[tensorName][static_cast<size_t>(selector)] = dims;
+                auto nameDimsPair = splitNameAndValue<nvinfer1::Dims>(s);
+                std::string tensorName = nameDimsPair.first;
+                nvinfer1::Dims dims = nameDimsPair.second;
+
+                if (shapes.find(tensorName) == shapes.end())
+                {
+                    insertShapes(shapes, tensorName, dims);
+                }
+                else
+                {
+                    shapes[tensorName][static_cast<size_t>(selector)] = dims;
+                }
             }
         }
     };
 
     bool explicitBatch{false};
     checkEraseOption(arguments, "--explicitBatch", explicitBatch);
-    getShapes(shapes, "--minShapes", nvinfer1::OptProfileSelector::kMIN);
-    getShapes(shapes, "--optShapes", nvinfer1::OptProfileSelector::kOPT);
-    getShapes(shapes, "--maxShapes", nvinfer1::OptProfileSelector::kMAX);
-    explicitBatch = explicitBatch || !shapes.empty();
+    getShapes(optProfiles, "--minShapes", nvinfer1::OptProfileSelector::kMIN);
+    getShapes(optProfiles, "--optShapes", nvinfer1::OptProfileSelector::kOPT);
+    getShapes(optProfiles, "--maxShapes", nvinfer1::OptProfileSelector::kMAX);
+    checkEraseOption(arguments, "--histogramProfiles", histogramProfiles);
+    if (checkEraseOption(arguments, "--shapeHistogram", shapeHistogram))
+    {
+        if (!optProfiles.empty())
+        {
+            throw std::invalid_argument("The shape histogram (--shapeHistogram) chooses the profiles, without "
+                                        "--minShapes, --optShapes or --maxShapes");
+        }
+        if (histogramProfiles < 1)
+        {
+            throw std::invalid_argument(std::string("Histogram profiles ") + std::to_string(histogramProfiles)
+                + " is not positive");
+        }
+        histogram = readShapeHistogram(shapeHistogram);
+        optProfiles = chooseProfiles(histogram, histogramProfiles, histogramPadding);
+    }
+    explicitBatch = explicitBatch || !optProfiles.empty();
 
     int batch{0};
     checkEraseOption(arguments, "--maxBatch", batch);
@@ -428,7 +640,20 @@ void BuildOptions::parse(Arguments& arguments)
     checkEraseOption(arguments, "--fp16", fp16);
     checkEraseOption(arguments, "--int8", int8);
     checkEraseOption(arguments, "--safe", safe);
+    checkEraseOption(arguments, "--refittable", refittable);
     checkEraseOption(arguments, "--calib", calibration);
+    if (checkEraseOption(arguments, "--dynamicRanges", dynamicRanges) && (!int8 || !calibration.empty()))
+    {
+        throw std::invalid_argument("Dynamic ranges (--dynamicRanges) replace the calibration of int8 (--int8), "
+                                    "without --calib");
+    }
+    if (checkEraseOption(arguments, "--exportDynamicRanges", exportDynamicRanges) && (!int8 || calibration.empty()))
+    {
+        throw std::invalid_argument("Exporting dynamic ranges (--exportDynamicRanges) requires an int8 calibration "
+                                    "cache (--int8 --calib)");
+    }
+    checkEraseOption(arguments, "--gemmAlgoCache", gemmAlgoCache);
+    checkEraseOption(arguments, "--engineCache", engineCache);
     if (checkEraseOption(arguments, "--loadEngine", engine))
     {
         load = true;
@@ -441,13 +666,140 @@ void BuildOptions::parse(Arguments& arguments)
     {
         throw std::invalid_argument("Incompatible load and save engine options selected");
     }
+    if (checkEraseOption(arguments, "--refit", refit) && !load)
+    {
+        throw std::invalid_argument("Refitting (--refit) requires an engine to refit (--loadEngine)");
+    }
+    if (checkEraseOption(arguments, "--compressEngine", compression) && !save && engineCache.empty() && refit.empty())
+    {
+        throw std::invalid_argument("Engine compression (--compressEngine) requires an engine to save (--saveEngine, "
+                                    "--engineCache or --refit)");
+    }
+    if (compression < 0 || compression > 9)
+    {
+        throw std::invalid_argument(std::string("Compression level ") + std::to_string(compression)
+            + " is not between 1 and 9");
+    }
+
+    std::string matrix;
+    if (checkEraseOption(arguments, "--buildMatrix", matrix))
+    {
+        const std::vector<std::string> lists{splitToStringVec(matrix, ':')};
+        matrixPrecisions = splitToStringVec(lists[0], ',');
+        for (const auto& p : matrixPrecisions)
+        {
+            if (p != "fp32" && p != "fp16" && p != "int8")
+            {
+                throw std::invalid_argument(std::string("Unknown precision ") + p + " in build matrix");
+            }
+        }
+        for (const auto& b : lists.size() > 1 ? splitToStringVec(lists[1], ',') : std::vector<std::string>{})
+        {
+            matrixBatches.push_back(stringToValue<int>(b));
+            if (matrixBatches.back() < 1)
+            {
+                throw std::invalid_argument(std::string("Batch size ") + b + " in build matrix is not positive");
+            }
+        }
+        if (!save)
+        {
+            throw std::invalid_argument("Build matrix (--buildMatrix) requires a plan file prefix (--saveEngine)");
+        }
+        if (!matrixBatches.empty() && explicitBatch && optProfiles.empty())
+        {
+            throw std::invalid_argument(
+                "Build matrix batch sizes with explicit batch require dynamic shapes (--minShapes/--optShapes/--maxShapes)");
+        }
+    }
+    std::string precisionsFile;
+    if (checkEraseOption(arguments, "--layerPrecisions", precisionsFile))
+    {
+        layerPrecisions = readLayerPrecisions(precisionsFile);
+    }
+    if (checkEraseOption(arguments, "--precisionSearch", precisionSearch) && !fp16 && !int8)
+    {
+        throw std::invalid_argument(
+            "Precision search (--precisionSearch) requires a lower precision (--fp16 or --int8)");
+    }
+    if (checkEraseOption(arguments, "--precisionTolerance", precisionTolerance) && precisionSearch.empty())
+    {
+        throw std::invalid_argument("Precision tolerance (--precisionTolerance) requires a search (--precisionSearch)");
+    }
+    if (checkEraseOption(arguments, "--exportLayerPrecisions", exportLayerPrecisions) && precisionSearch.empty())
+    {
+        throw std::invalid_argument(
+            "Exporting layer precisions (--exportLayerPrecisions) requires a search (--precisionSearch)");
+    }
+    if (!precisionSearch.empty() && (load || !matrixPrecisions.empty()))
+    {
+        throw std::invalid_argument("Precision search (--precisionSearch) builds the model, without --loadEngine or "
+                                    "--buildMatrix");
+    }
+    if (checkEraseOption(arguments, "--ioFormatSearch", formatSearch) && !fp16 && !int8)
+    {
+        throw std::invalid_argument(
+            "I/O format search (--ioFormatSearch) requires a lower precision (--fp16 or --int8)");
+    }
+    if (formatSearch && (load || !matrixPrecisions.empty() || !precisionSearch.empty()))
+    {
+        throw std::invalid_argument("I/O format search (--ioFormatSearch) builds the model, without --loadEngine, "
+                                    "--buildMatrix or --precisionSearch");
+    }
+    if (formatSearch && (!inputFormats.empty() || !outputFormats.empty()))
+    {
+        throw std::invalid_argument("I/O format search (--ioFormatSearch) chooses the formats of --inputIOFormats and "
+                                    "--outputIOFormats");
+    }
+    if (checkEraseOption(arguments, "--workspaceSearch", workspaceSearch) && !(workspaceSearch > 0))
+    {
+        throw std::invalid_argument("Workspace search tolerance (--workspaceSearch) must be a positive percentage");
+    }
+    if (workspaceSearch > 0 && (load || !matrixPrecisions.empty() || !precisionSearch.empty() || formatSearch))
+    {
+        throw std::invalid_argument("Workspace search (--workspaceSearch) builds the model, without --loadEngine, "
+                                    "--buildMatrix, --precisionSearch or --ioFormatSearch");
+    }
+    if (checkEraseOption(arguments, "--buildJobs", buildJobs) && matrixPrecisions.empty())
+    {
+        throw std::invalid_argument("Concurrent builds (--buildJobs) require a build matrix (--buildMatrix)");
+    }
+    if (buildJobs < 1)
+    {
+        throw std::invalid_argument(std::string("Build jobs ") + std::to_string(buildJobs) + " is not positive");
+    }
 }
 
 void SystemOptions::parse(Arguments& arguments)
 {
     checkEraseOption(arguments, "--device", device);
+    std::string list;
+    if (checkEraseOption(arguments, "--devices", list))
+    {
+        for (const auto& d : splitToStringVec(list, ','))
+        {
+            devices.push_back(stringToValue<int>(d));
+        }
+        if (devices.empty())
+        {
+            throw std::invalid_argument("Empty device list");
+        }
+        device = devices.front();
+    }
     checkEraseOption(arguments, "--useDLACore", DLACore);
+    if (checkEraseOption(arguments, "--dlaCores", list))
+    {
+        for (const auto& c : splitToStringVec(list, ','))
+        {
+            DLACores.push_back(stringToValue<int>(c));
+        }
+        if (DLACores.empty())
+        {
+            throw std::invalid_argument("Empty DLA core list");
+        }
+    }
     checkEraseOption(arguments, "--allowGPUFallback", fallback);
+    checkEraseOption(arguments, "--memPool", memPool);
+    checkEraseOption(arguments, "--hostPool", hostPool);
     std::string pluginName;
     while (checkEraseOption(arguments, "--plugins", pluginName))
     {
@@ -465,22 +817,597 @@ void InferenceOptions::parse(Arguments& arguments)
     bool exposeDMA{false};
     if (checkEraseOption(arguments, "--exposeDMA", exposeDMA))
     {
-        overlap = !exposeDMA;
+        overlap = !exposeDMA;
+    }
+    if (checkEraseOption(arguments, "--pipelineDepth", depth) && !overlap && depth > 1)
+    {
+        throw std::invalid_argument("Pipeline depth above 1 overlaps the transfers, without --exposeDMA");
+    }
+    if (depth < 1)
+    {
+        throw std::invalid_argument(std::string("Pipeline depth ") + std::to_string(depth) + " is not positive");
+    }
+    if (!overlap)
+    {
+        depth = 1;
+    }
+    checkEraseOption(arguments, "--useSpinWait", spin);
+    checkEraseOption(arguments, "--useHybridWait", hybridWait);
+    checkEraseOption(arguments, "--asyncCompletion", asyncCompletion);
+    if (hybridWait && spin)
+    {
+        throw std::invalid_argument("Hybrid waits (--useHybridWait) already spin, without --useSpinWait");
+    }
+    checkEraseOption(arguments, "--prewarm", prewarm);
+    checkEraseOption(arguments, "--shareDeviceMemory", shareMemory);
+    checkEraseOption(arguments, "--sharedCopyStreams", sharedCopyStreams);
+    checkEraseOption(arguments, "--threads", threads);
+    checkEraseOption(arguments, "--streamPriority", priority);
+    if (priority > 0)
+    {
+        throw std::invalid_argument(std::string("Stream priority ") + std::to_string(priority)
+            + " is above 0, the lowest priority");
+    }
+    std::string cpus;
+    if (checkEraseOption(arguments, "--affinity", cpus))
+    {
+        numaAffinity = cpus == "numa";
+        affinity = numaAffinity ? std::vector<int>{} : parseCpuList(cpus);
+        if (!numaAffinity && affinity.empty())
+        {
+            throw std::invalid_argument(std::string("Invalid CPU list ") + cpus);
+        }
+    }
+    if (checkEraseOption(arguments, "--driverAffinity", driverAffinity) && !numaAffinity && affinity.empty())
+    {
+        throw std::invalid_argument("Driver thread affinity requires thread affinity (--affinity)");
+    }
+    checkEraseOption(arguments, "--useCudaGraph", graph);
+    if (checkEraseOption(arguments, "--graphIteration", graphIteration))
+    {
+        graph = true;
+    }
+    if (checkEraseOption(arguments, "--graphCacheSize", graphCacheSize) && !graph)
+    {
+        throw std::invalid_argument("Graph cache size requires CUDA graphs (--useCudaGraph)");
+    }
+    if (graphCacheSize < 1)
+    {
+        throw std::invalid_argument(std::string("Graph cache size ") + std::to_string(graphCacheSize) + " is not positive");
+    }
+    if (shareMemory && graph)
+    {
+        // A captured compute cannot wait for the previous compute of another stream
+        throw std::invalid_argument("Shared device memory (--shareDeviceMemory) not supported with CUDA graphs");
+    }
+    checkEraseOption(arguments, "--buildOnly", skip);
+    checkEraseOption(arguments, "--qps", qps);
+    if (qps < 0)
+    {
+        throw std::invalid_argument(std::string("Request rate ") + std::to_string(qps) + " is negative");
+    }
+    if (checkEraseOption(arguments, "--arrival", arrival) && !qps)
+    {
+        throw std::invalid_argument("Arrival distribution requires a request rate (--qps)");
+    }
+    checkEraseOption(arguments, "--dynamicBatching", dynamicBatching);
+    if (checkEraseOption(arguments, "--maxQueueDelay", maxQueueDelay) && !dynamicBatching)
+    {
+        throw std::invalid_argument("Maximum queue delay requires dynamic batching (--dynamicBatching)");
+    }
+    if (dynamicBatching && !qps)
+    {
+        throw std::invalid_argument("Dynamic batching requires a request rate (--qps)");
+    }
+    std::string deadlineSpec;
+    if (checkEraseOption(arguments, "--deadlines", deadlineSpec))
+    {
+        if (!qps)
+        {
+            throw std::invalid_argument("Request deadlines (--deadlines) require a request rate (--qps)");
+        }
+        for (const auto& c : splitToStringVec(deadlineSpec, ','))
+        {
+            const std::vector<std::string> fields{splitToStringVec(c, ':')};
+            RequestClass requests;
+            if (fields.size() == 2)
+            {
+                requests.share = stringToValue<float>(fields[0]);
+                requests.slaMs = stringToValue<float>(fields[1]);
+            }
+            if (fields.size() != 2 || requests.share <= 0 || requests.slaMs <= 0)
+            {
+                throw std::invalid_argument(std::string("Invalid request class ") + c + ", expected a positive share "
+                                            "and SLA in ms");
+            }
+            deadlines.push_back(requests);
+        }
+    }
+    if (maxQueueDelay < 0)
+    {
+        throw std::invalid_argument(std::string("Maximum queue delay ") + std::to_string(maxQueueDelay) + " is negative");
+    }
+    checkEraseOption(arguments, "--inputMemory", inputMemory);
+    checkEraseOption(arguments, "--packTransfers", packTransfers);
+    checkEraseOption(arguments, "--microBatches", microBatches);
+    std::string tiled;
+    if (checkEraseOption(arguments, "--tiledImage", tiled))
+    {
+        const auto sizes = splitToStringVec(tiled, 'x');
+        tiledHeight = sizes.size() == 2 ? stringToValue<int>(sizes[0]) : 0;
+        tiledWidth = sizes.size() == 2 ? stringToValue<int>(sizes[1]) : 0;
+        if (tiledHeight < 1 || tiledWidth < 1)
+        {
+            throw std::invalid_argument(std::string("Invalid tiled image size ") + tiled);
+        }
+    }
+    if (checkEraseOption(arguments, "--tileOverlap", tileOverlap) && !tiledHeight)
+    {
+        throw std::invalid_argument("Tile overlap requires a tiled image (--tiledImage)");
+    }
+    if (microBatches < 1)
+    {
+        throw std::invalid_argument(std::string("Micro-batch count ") + std::to_string(microBatches)
+            + " is not positive");
+    }
+    checkEraseOption(arguments, "--deviceInputs", deviceInputs);
+    checkEraseOption(arguments, "--telemetry", telemetry);
+    if (telemetry < 0)
+    {
+        throw std::invalid_argument(std::string("Telemetry period ") + std::to_string(telemetry) + " is negative");
+    }
+    if (checkEraseOption(arguments, "--compareEngine", compareEngine) && qps)
+    {
+        throw std::invalid_argument("Engine comparison (--compareEngine) runs closed loop, without --qps");
+    }
+    std::string coSpec;
+    while (checkEraseOption(arguments, "--coEngine", coSpec))
+    {
+        const std::vector<std::string> fields{splitToStringVec(coSpec, ':')};
+        CoEngine co;
+        co.engine = fields.empty() ? "" : fields[0];
+        co.streams = fields.size() > 1 ? stringToValue<int>(fields[1]) : co.streams;
+        co.qps = fields.size() > 2 ? stringToValue<float>(fields[2]) : co.qps;
+        co.priority = fields.size() > 3 ? stringToValue<int>(fields[3]) : co.priority;
+        if (co.engine.empty() || fields.size() > 4)
+        {
+            throw std::invalid_argument(std::string("Invalid concurrent engine ") + coSpec);
+        }
+        if (co.streams < 1 || co.qps < 0 || co.priority > 0)
+        {
+            throw std::invalid_argument(std::string("Concurrent engine ") + coSpec + " needs a positive stream count, "
+                "a rate of at least 0 and a priority of at most 0");
+        }
+        coEngines.push_back(co);
+    }
+    if (!coEngines.empty() && (!compareEngine.empty() || dynamicBatching))
+    {
+        throw std::invalid_argument("Concurrent engines (--coEngine) not supported with --compareEngine or "
+                                    "--dynamicBatching");
+    }
+
+    std::string list;
+    checkEraseOption(arguments, "--loadInputs", list);
+    std::vector<std::string> inputsList{splitToStringVec(list, ',')};
+    splitInsertKeyValue(inputsList, inputs);
+    checkEraseOption(arguments, "--streamInputs", streamInputs);
+    if (streamInputs && inputs.empty())
+    {
+        throw std::invalid_argument("Streaming inputs requires input files (--loadInputs)");
+    }
+    if (streamInputs && inputMemory != InputMemory::kDEVICE)
+    {
+        throw std::invalid_argument("Streaming inputs requires device input memory (--inputMemory=device)");
+    }
+    if (checkEraseOption(arguments, "--prefetchDepth", prefetchDepth) && !streamInputs)
+    {
+        throw std::invalid_argument("Prefetch depth requires streaming inputs (--streamInputs)");
+    }
+    if (prefetchDepth < 1)
+    {
+        throw std::invalid_argument(std::string("Prefetch depth ") + std::to_string(prefetchDepth) + " is not positive");
+    }
+    list.clear();
+    checkEraseOption(arguments, "--compactOutputs", list);
+    std::vector<std::string> compactList{splitToStringVec(list, ',')};
+    splitInsertKeyValue(compactList, compactOutputs);
+    list.clear();
+    checkEraseOption(arguments, "--transferEncoding", list);
+    std::vector<std::string> encodingList{splitToStringVec(list, ',')};
+    splitInsertKeyValue(encodingList, transferEncodings);
+    for (const auto& encoding : transferEncodings)
+    {
+        if (encoding.second != "fp16" && encoding.second != "int16" && encoding.second != "int8"
+            && encoding.second != "mask")
+        {
+            throw std::invalid_argument("Unknown transfer encoding " + encoding.second + " of " + encoding.first);
+        }
+    }
+    if (checkEraseOption(arguments, "--maskThreshold", maskThreshold)
+        && std::none_of(transferEncodings.begin(), transferEncodings.end(),
+            [](const std::pair<const std::string, std::string>& e) { return e.second == "mask"; }))
+    {
+        throw std::invalid_argument("Mask threshold requires a mask encoded output (--transferEncoding)");
+    }
+
+    std::string sweepSpec;
+    if (checkEraseOption(arguments, "--sweep", sweepSpec))
+    {
+        sweep = true;
+        const std::vector<std::string> dims{splitToStringVec(sweepSpec, ':')};
+        const auto parseCounts = [](const std::string& list, const char* name) {
+            std::vector<int> counts;
+            for (const auto& c : list.empty() ? std::vector<std::string>{} : splitToStringVec(list, ','))
+            {
+                counts.push_back(stringToValue<int>(c));
+                if (counts.back() < 1)
+                {
+                    throw std::invalid_argument(std::string(name) + " " + c + " in sweep is not positive");
+                }
+            }
+            return counts;
+        };
+        sweepStreams = parseCounts(dims.empty() ? "" : dims[0], "Stream count");
+        sweepBatches = parseCounts(dims.size() > 1 ? dims[1] : "", "Batch size");
+        for (const auto& d : dims.size() > 2 ? splitToStringVec(dims[2], ',') : std::vector<std::string>{})
+        {
+            if (d == "threads")
+            {
+                sweepThreads = true;
+            }
+            else if (d == "graph")
+            {
+                sweepGraph = true;
+            }
+            else if (d == "spin")
+            {
+                sweepSpin = true;
+            }
+            else
+            {
+                throw std::invalid_argument(std::string("Unknown sweep switch ") + d);
+            }
+        }
+        if (sweepSpin && hybridWait)
+        {
+            throw std::invalid_argument("Sweeping spin waits (--sweep=spin) compares them to blocking, without "
+                                        "--useHybridWait");
+        }
+        if (qps || !compareEngine.empty() || !coEngines.empty())
+        {
+            throw std::invalid_argument("Sweeps (--sweep) run closed loop, without --qps, --compareEngine or "
+                                        "--coEngine");
+        }
+        if (sweepGraph && shareMemory)
+        {
+            throw std::invalid_argument("Shared device memory (--shareDeviceMemory) not supported with CUDA graphs");
+        }
+    }
+    if (checkEraseOption(arguments, "--capacity", capacity))
+    {
+        if (capacity < 1)
+        {
+            throw std::invalid_argument(std::string("Capacity stream limit ") + std::to_string(capacity)
+                + " is not positive");
+        }
+        if (sweep || qps || !compareEngine.empty() || !coEngines.empty())
+        {
+            throw std::invalid_argument("The capacity search (--capacity) runs closed loop, without --sweep, --qps, "
+                                        "--compareEngine or --coEngine");
+        }
+    }
+    if (checkEraseOption(arguments, "--capacityGain", capacityGain) && !capacity)
+    {
+        throw std::invalid_argument("Capacity gain requires a capacity search (--capacity)");
+    }
+    if (capacityGain < 0)
+    {
+        throw std::invalid_argument(std::string("Capacity gain ") + std::to_string(capacityGain) + " is negative");
+    }
+    std::string powerSpec;
+    if (checkEraseOption(arguments, "--powerSweep", powerSpec))
+    {
+        for (const auto& p : splitToStringVec(powerSpec, ','))
+        {
+            const auto hasUnit = [&p](const std::string& unit) {
+                return p.size() > unit.size() && p.compare(p.size() - unit.size(), unit.size(), unit) == 0;
+            };
+            PowerSetting setting;
+            if (hasUnit("MHz"))
+            {
+                const int mhz = stringToValue<int>(p.substr(0, p.size() - 3));
+                if (mhz < 1)
+                {
+                    throw std::invalid_argument(std::string("SM clock ") + p + " in power sweep is not positive");
+                }
+                setting.smClock = static_cast<unsigned int>(mhz);
+            }
+            else if (hasUnit("W"))
+            {
+                setting.powerLimit = stringToValue<float>(p.substr(0, p.size() - 1));
+                if (setting.powerLimit <= 0)
+                {
+                    throw std::invalid_argument(std::string("Power limit ") + p + " in power sweep is not positive");
+                }
+            }
+            else
+            {
+                throw std::invalid_argument(std::string("Power sweep setting ") + p + " is neither watts nor MHz");
+            }
+            powerSweep.push_back(setting);
+        }
+        if (powerSweep.empty())
+        {
+            throw std::invalid_argument("Power sweep (--powerSweep) without settings");
+        }
+        if (sweep || capacity || qps || !compareEngine.empty() || !coEngines.empty())
+        {
+            throw std::invalid_argument("The power sweep (--powerSweep) runs closed loop, without --sweep, --capacity, "
+                                        "--qps, --compareEngine or --coEngine");
+        }
+    }
+    if (checkEraseOption(arguments, "--latencyTarget", latencyTarget) && !sweep && !capacity && powerSweep.empty())
+    {
+        throw std::invalid_argument("Latency target requires a sweep (--sweep), a capacity search (--capacity) or a "
+                                    "power sweep (--powerSweep)");
+    }
+    if (latencyTarget < 0)
+    {
+        throw std::invalid_argument(std::string("Latency target ") + std::to_string(latencyTarget) + " is negative");
+    }
+    if (checkEraseOption(arguments, "--throughputTarget", throughputTarget) && powerSweep.empty())
+    {
+        throw std::invalid_argument("Throughput target requires a power sweep (--powerSweep)");
+    }
+    if (throughputTarget < 0)
+    {
+        throw std::invalid_argument(std::string("Throughput target ") + std::to_string(throughputTarget)
+            + " is negative");
+    }
+
+    checkEraseOption(arguments, "--validateOutputs", validateOutputs);
+    if (checkEraseOption(arguments, "--validateEvery", validateEvery) && validateOutputs.empty())
+    {
+        throw std::invalid_argument("Validation interval requires reference outputs (--validateOutputs)");
+    }
+    if (checkEraseOption(arguments, "--validateTolerance", validateTolerance) && validateOutputs.empty())
+    {
+        throw std::invalid_argument("Validation tolerance requires reference outputs (--validateOutputs)");
+    }
+    if (checkEraseOption(arguments, "--batchAssembly", batchAssembly))
+    {
+        if (!dynamicBatching)
+        {
+            throw std::invalid_argument("Batch assembly (--batchAssembly) requires dynamic batching "
+                                        "(--dynamicBatching)");
+        }
+        if (graph || inputMemory != InputMemory::kDEVICE || packTransfers || deviceInputs || !compactOutputs.empty()
+            || !transferEncodings.empty() || !validateOutputs.empty())
+        {
+            // The requests are copied on their own, into and out of the batch bindings of the stream
+            throw std::invalid_argument("Batch assembly (--batchAssembly) does not support --useCudaGraph, "
+                                        "--inputMemory, --packTransfers, --deviceInputs, --compactOutputs, "
+                                        "--transferEncoding or --validateOutputs");
+        }
+    }
+    if (validateEvery < 1)
+    {
+        throw std::invalid_argument(std::string("Validation interval ") + std::to_string(validateEvery)
+            + " is not positive");
+    }
+    if (validateTolerance < 0)
+    {
+        throw std::invalid_argument(std::string("Validation tolerance ") + std::to_string(validateTolerance)
+            + " is negative");
+    }
+    if (!validateOutputs.empty()
+        && (streamInputs || dynamicBatching || sweep || !compareEngine.empty() || !coEngines.empty()))
+    {
+        throw std::invalid_argument("Output validation (--validateOutputs) runs the same inputs and batch on the main "
+                                    "engine, without --streamInputs, --dynamicBatching, --sweep, --compareEngine or "
+                                    "--coEngine");
+    }
+    checkEraseOption(arguments, "--timingSample", timingSample);
+    if (timingSample < 0)
+    {
+        throw std::invalid_argument(std::string("Timing sample ") + std::to_string(timingSample) + " is negative");
+    }
+    if (timingSample > 1
+        && (qps || dynamicBatching || sweep || !compareEngine.empty() || !coEngines.empty()))
+    {
+        throw std::invalid_argument("Timing samples (--timingSample) report the throughput of back to back queries "
+                                    "of the main engine, without --qps, --dynamicBatching, --sweep, --compareEngine "
+                                    "or --coEngine");
+    }
+    if (asyncCompletion && (qps || dynamicBatching || !compareEngine.empty()))
+    {
+        throw std::invalid_argument("Asynchronous completions (--asyncCompletion) reissue queries back to back, "
+                                    "without --qps, --dynamicBatching or --compareEngine");
+    }
+    if (graphIteration && (streamInputs || !compactOutputs.empty() || !validateOutputs.empty() || sharedCopyStreams))
+    {
+        // Their copies depend on host state of each query, synchronize on the counts of the outputs, or share a stream
+        // with the queries of other contexts that a capture would take in
+        throw std::invalid_argument("Graphs of whole iterations (--graphIteration) do not support --streamInputs, "
+                                    "--compactOutputs, --validateOutputs or --sharedCopyStreams");
+    }
+    checkEraseOption(arguments, "--serve", serve);
+    if (!serve.empty()
+        && (streamInputs || dynamicBatching || sweep || graph || !compareEngine.empty() || !coEngines.empty()
+            || !validateOutputs.empty() || deviceInputs))
+    {
+        throw std::invalid_argument("The server mode (--serve) runs the requests of its clients, without "
+                                    "--streamInputs, --dynamicBatching, --sweep, --useCudaGraph, --compareEngine, "
+                                    "--coEngine, --validateOutputs or --deviceInputs");
+    }
+    checkEraseOption(arguments, "--resultCache", resultCache);
+    if (resultCache < 0 || (resultCache && serve.empty()))
+    {
+        throw std::invalid_argument("The result cache (--resultCache) takes a positive size in MB and --serve");
+    }
+
+    std::vector<std::string> lists;
+    checkEraseRepeatedOption(arguments, "--shapes", lists);
+    for (const auto& l : lists)
+    {
+        std::vector<std::string> shapeList{splitToStringVec(l, ',')};
+        shapes.emplace_back();
+        splitInsertKeyValue(shapeList, shapes.back());
+    }
+
+    if (checkEraseOption(arguments, "--shapeChurn", shapeChurn))
+    {
+        if (dynamicBatching || streamInputs || sweep || timingSample > 1 || !serve.empty() || !validateOutputs.empty())
+        {
+            throw std::invalid_argument("Shape churn (--shapeChurn) sets the input shapes of every query, without "
+                                        "--dynamicBatching, --streamInputs, --sweep, --timingSample, --serve or "
+                                        "--validateOutputs");
+        }
+        if (shapeChurn != "uniform")
+        {
+            churnShapes = readShapeHistogram(shapeChurn);
+        }
+    }
+    checkEraseOption(arguments, "--swapEngine", swapEngine);
+    if (!swapEngine.empty()
+        && (qps || skip || sweep || !serve.empty() || !compareEngine.empty() || !coEngines.empty()
+            || !shapeChurn.empty()))
+    {
+        throw std::invalid_argument("The engine swap (--swapEngine) serves back to back on the first stream, without "
+                                    "--qps, --buildOnly, --sweep, --serve, --compareEngine, --coEngine or --shapeChurn");
+    }
+    std::string stageSpec;
+    while (checkEraseOption(arguments, "--pipelineStage", stageSpec))
+    {
+        const std::vector<std::string> fields{splitToStringVec(stageSpec, ':')};
+        PipelineStage stage;
+        stage.engine = fields.empty() ? "" : fields[0];
+        stage.device = fields.size() > 1 ? stringToValue<int>(fields[1]) : stage.device;
+        if (stage.engine.empty() || fields.size() > 2 || stage.device < 0)
+        {
+            throw std::invalid_argument(std::string("Invalid pipeline stage ") + stageSpec);
+        }
+        pipelineStages.push_back(stage);
+    }
+    if (!pipelineStages.empty()
+        && (streams > 1 || qps || skip || sweep || capacity || dynamicBatching || microBatches > 1 || !serve.empty()
+            || !compareEngine.empty() || !swapEngine.empty() || !coEngines.empty() || !shapeChurn.empty()))
+    {
+        // The micro-batches in flight are set by --pipelineDepth, each stage runs a single context and stream
+        throw std::invalid_argument("Pipeline stages (--pipelineStage) run closed loop on a single stream, without "
+                                    "--streams, --qps, --buildOnly, --sweep, --capacity, --dynamicBatching, "
+                                    "--microBatches, --serve, --compareEngine, --swapEngine, --coEngine or "
+                                    "--shapeChurn");
+    }
+    checkEraseOption(arguments, "--loadThreads", loadThreads);
+    if (loadThreads < 0)
+    {
+        throw std::invalid_argument(std::string("Invalid number of load threads ") + std::to_string(loadThreads));
+    }
+
+    if (checkEraseOption(arguments, "--replay", replay))
+    {
+        if (qps || skip || sweep || capacity || dynamicBatching || !deadlines.empty() || streamInputs
+            || microBatches > 1 || tiledHeight || graphIteration || asyncCompletion || timingSample > 1
+            || !serve.empty() || !compareEngine.empty() || !swapEngine.empty() || !coEngines.empty()
+            || !pipelineStages.empty() || !shapeChurn.empty())
+        {
+            // The trace sets the arrival, the shapes and the inputs of every query
+            throw std::invalid_argument("Replay (--replay) issues the requests of the trace, without --qps, "
+                                        "--buildOnly, --sweep, --capacity, --dynamicBatching, --deadlines, "
+                                        "--streamInputs, --microBatches, --tiledImage, --graphIteration, "
+                                        "--asyncCompletion, --timingSample, --serve, --compareEngine, --swapEngine, "
+                                        "--coEngine, --pipelineStage or --shapeChurn");
+        }
+        replayRequests = readReplayTrace(replay);
+    }
+    if (checkEraseOption(arguments, "--replaySpeed", replaySpeed) && (replay.empty() || !(replaySpeed > 0)))
+    {
+        throw std::invalid_argument("Replay speed (--replaySpeed) must be positive and requires --replay");
+    }
+    if (checkEraseOption(arguments, "--replayWindow", replayWindow) && (replay.empty() || replayWindow < 1))
+    {
+        throw std::invalid_argument("Replay window (--replayWindow) must be positive and requires --replay");
+    }
+
+    checkEraseOption(arguments, "--steadyState", steadyState);
+    checkEraseOption(arguments, "--confidence", confidence);
+    if (steadyState < 0 || confidence < 0)
+    {
+        throw std::invalid_argument("The steady state drift (--steadyState) and the confidence (--confidence) must be "
+                                    "positive");
+    }
+    if (steadyState || confidence)
+    {
+        if (qps || skip || sweep || capacity || threads || asyncCompletion || timingSample > 1 || dynamicBatching
+            || !deadlines.empty() || !serve.empty() || !compareEngine.empty() || !swapEngine.empty()
+            || !coEngines.empty() || !pipelineStages.empty() || !replay.empty())
+        {
+            // The checks need the trace of the queries as they complete, in a single closed loop
+            throw std::invalid_argument("The steady state (--steadyState) and confidence (--confidence) checks run the "
+                                        "streams closed loop from one thread, without --qps, --buildOnly, --sweep, "
+                                        "--capacity, --threads, --asyncCompletion, --timingSample, --dynamicBatching, "
+                                        "--deadlines, --serve, --compareEngine, --swapEngine, --coEngine, "
+                                        "--pipelineStage or --replay");
+        }
+    }
+    if (checkEraseOption(arguments, "--convergenceWindow", convergenceWindow)
+        && ((!steadyState && !confidence) || convergenceWindow < 2))
+    {
+        throw std::invalid_argument("The convergence window (--convergenceWindow) must be at least 2 queries and "
+                                    "requires --steadyState or --confidence");
+    }
+    std::string cascadeSpec;
+    if (checkEraseOption(arguments, "--cascade", cascadeSpec))
+    {
+        const std::vector<std::string> fields{splitToStringVec(cascadeSpec, ':')};
+        cascade.engine = fields.empty() ? "" : fields[0];
+        cascade.score = fields.size() > 1 ? fields[1] : "";
+        cascade.threshold = fields.size() > 2 ? stringToValue<float>(fields[2]) : cascade.threshold;
+        if (cascade.engine.empty() || cascade.score.empty() || fields.size() > 3)
+        {
+            throw std::invalid_argument(std::string("Invalid cascade ") + cascadeSpec);
+        }
+        if (streams > 1 || qps || skip || sweep || capacity || threads || dynamicBatching || microBatches > 1
+            || tiledHeight || graph || asyncCompletion || timingSample > 1 || !validateOutputs.empty()
+            || !serve.empty() || !compareEngine.empty() || !swapEngine.empty() || !coEngines.empty()
+            || !pipelineStages.empty() || !shapeChurn.empty() || !replay.empty() || steadyState || confidence)
+        {
+            // The second stage of each batch waits for the positives of the first on a single stream
+            throw std::invalid_argument("The cascade (--cascade) runs closed loop on a single stream, without "
+                                        "--streams, --qps, --buildOnly, --sweep, --capacity, --threads, "
+                                        "--dynamicBatching, --microBatches, --tiledImage, --useCudaGraph, "
+                                        "--asyncCompletion, --timingSample, --validateOutputs, --serve, "
+                                        "--compareEngine, --swapEngine, --coEngine, --pipelineStage, --shapeChurn, "
+                                        "--replay, --steadyState or --confidence");
+        }
+    }
+
+    checkEraseOption(arguments, "--clusterPort", clusterPort);
+    checkEraseOption(arguments, "--joinCluster", joinCluster);
+    if (checkEraseOption(arguments, "--clusterNodes", clusterNodes) && clusterNodes < 2)
+    {
+        throw std::invalid_argument(std::string("Cluster nodes ") + std::to_string(clusterNodes)
+                                    + " must be at least 2, the coordinator included");
+    }
+    if (clusterNodes && !joinCluster.empty())
+    {
+        throw std::invalid_argument("A cluster node (--joinCluster) cannot also coordinate (--clusterNodes)");
+    }
+    if (clusterPort < 1 || clusterPort > 65535)
+    {
+        throw std::invalid_argument(std::string("Cluster port ") + std::to_string(clusterPort) + " is not a TCP port");
+    }
+    if (checkEraseOption(arguments, "--clusterOutlier", clusterOutlier) && !(clusterOutlier > 0))
+    {
+        throw std::invalid_argument("Cluster outlier tolerance (--clusterOutlier) must be a positive percentage");
+    }
+    if ((clusterNodes || !joinCluster.empty())
+        && (skip || sweep || capacity || !serve.empty() || !compareEngine.empty() || !swapEngine.empty()))
+    {
+        throw std::invalid_argument("Cluster runs (--clusterNodes, --joinCluster) run the benchmark, without "
+                                    "--buildOnly, --sweep, --capacity, --serve, --compareEngine or --swapEngine");
     }
-    checkEraseOption(arguments, "--useSpinWait", spin);
-    checkEraseOption(arguments, "--threads", threads);
-    checkEraseOption(arguments, "--useCudaGraph", graph);
-    checkEraseOption(arguments, "--buildOnly", skip);
-
-    std::string list;
-    checkEraseOption(arguments, "--loadInputs", list);
-    std::vector<std::string> inputsList{splitToStringVec(list, ',')};
-    splitInsertKeyValue(inputsList, inputs);
-
-    list.erase();
-    checkEraseOption(arguments, "--shapes", list);
-    std::vector<std::string> shapeList{splitToStringVec(list, ',')};
-    splitInsertKeyValue(shapeList, shapes);
 
     int batchOpt{0};
     checkEraseOption(arguments, "--batch", batchOpt);
@@ -500,6 +1427,42 @@ void InferenceOptions::parse(Arguments& arguments)
             batch = 0;
         }
     }
+    if (!shapeChurn.empty() && batchOpt)
+    {
+        throw std::invalid_argument("Shape churn (--shapeChurn) draws dynamic shapes, without --batch");
+    }
+    if (microBatches > 1)
+    {
+        if (batch % microBatches)
+        {
+            throw std::invalid_argument(std::string("Batch ") + std::to_string(batch) + " is not a multiple of "
+                + std::to_string(microBatches) + " micro-batches");
+        }
+        if (graph || dynamicBatching || !shapeChurn.empty() || streamInputs || !compactOutputs.empty() || shareMemory
+            || !serve.empty())
+        {
+            // The queries need a fixed batch split in chunks of their own bindings, copied and computed in turn
+            throw std::invalid_argument("Micro-batches (--microBatches) do not support --useCudaGraph, "
+                                        "--dynamicBatching, --shapeChurn, --streamInputs, --compactOutputs, "
+                                        "--shareDeviceMemory or --serve");
+        }
+    }
+    if (tiledHeight
+        && (graph || dynamicBatching || !shapeChurn.empty() || streamInputs || !compactOutputs.empty()
+            || !validateOutputs.empty() || microBatches > 1 || !compareEngine.empty() || !coEngines.empty()
+            || !serve.empty()))
+    {
+        // Each query runs the tiles of one image, with its own copies
+        throw std::invalid_argument("Tiled images (--tiledImage) do not support --useCudaGraph, --dynamicBatching, "
+                                    "--shapeChurn, --streamInputs, --compactOutputs, --validateOutputs, "
+                                    "--microBatches, --compareEngine, --coEngine or --serve");
+    }
+    if (!transferEncodings.empty() && (microBatches > 1 || tiledHeight || !serve.empty()))
+    {
+        // These copy the host buffers of the bindings in their data type
+        throw std::invalid_argument("Transfer encodings (--transferEncoding) do not support --microBatches, "
+                                    "--tiledImage or --serve");
+    }
 }
 
 void ReportingOptions::parse(Arguments& arguments)
@@ -507,11 +1470,39 @@ void ReportingOptions::parse(Arguments& arguments)
     checkEraseOption(arguments, "--percentile", percentile);
     checkEraseOption(arguments, "--avgRuns", avgs);
     checkEraseOption(arguments, "--verbose", verbose);
+    checkEraseOption(arguments, "--dumpInput", input);
     checkEraseOption(arguments, "--dumpOutput", output);
     checkEraseOption(arguments, "--dumpProfile", profile);
+    checkEraseOption(arguments, "--roofline", roofline);
+    checkEraseOption(arguments, "--reformatReport", reformats);
+    profile = profile || roofline || reformats;
     checkEraseOption(arguments, "--exportTimes", exportTimes);
+    checkEraseOption(arguments, "--exportChromeTrace", exportChromeTrace);
     checkEraseOption(arguments, "--exportOutput", exportOutput);
     checkEraseOption(arguments, "--exportProfile", exportProfile);
+    checkEraseOption(arguments, "--exportHistograms", exportHistograms);
+    checkEraseOption(arguments, "--histogramsOnly", histogramsOnly);
+    checkEraseOption(arguments, "--exportTelemetry", exportTelemetry);
+    checkEraseOption(arguments, "--exportSummary", exportSummary);
+    checkEraseOption(arguments, "--startupReport", startup);
+    checkEraseOption(arguments, "--memoryReport", memory);
+    checkEraseOption(arguments, "--copyReport", copies);
+    checkEraseOption(arguments, "--pluginEnqueueProfile", pluginEnqueue);
+    checkEraseOption(arguments, "--recordOutputs", recordOutputs);
+    if (checkEraseOption(arguments, "--recordQueue", recordQueue) && recordOutputs.empty())
+    {
+        throw std::invalid_argument("Record queue size requires recording the outputs (--recordOutputs)");
+    }
+    if (recordQueue < 1)
+    {
+        throw std::invalid_argument(
+            std::string("Record queue size ") + std::to_string(recordQueue) + " is not positive");
+    }
+    std::string list;
+    if (checkEraseOption(arguments, "--mergeHistograms", list))
+    {
+        mergeHistograms = splitToStringVec(list, ',');
+    }
     if (percentile < 0 || percentile > 100)
     {
         throw std::invalid_argument(std::string("Percentile ") + std::to_string(percentile) + "is not in [0,100]");
@@ -532,28 +1523,38 @@ void AllOptions::parse(Arguments& arguments)
     system.parse(arguments);
     inference.parse(arguments);
 
-    if ((!build.maxBatch && inference.batch && inference.batch != defaultBatch && !build.shapes.empty())
+    if ((!build.maxBatch && inference.batch && inference.batch != defaultBatch && !build.optProfiles.empty())
         || (build.maxBatch && build.maxBatch != defaultMaxBatch && !inference.batch))
     {
         // If either has selected implict batch and the other has selected explicit batch
         throw std::invalid_argument("Conflicting build and inference batch settings");
     }
 
-    if (build.shapes.empty() && !inference.shapes.empty())
+    if (build.optProfiles.empty() && !inference.shapes.empty())
     {
-        for (auto& s : inference.shapes)
+        // Build one profile for each set of inference shapes
+        for (auto& shapes : inference.shapes)
         {
-            insertShapes(build.shapes, s.first, s.second);
+            build.optProfiles.emplace_back();
+            for (auto& s : shapes)
+            {
+                insertShapes(build.optProfiles.back(), s.first, s.second);
+            }
         }
         build.maxBatch = 0;
     }
     else
     {
-        if (!build.shapes.empty() && inference.shapes.empty())
+        if (!build.optProfiles.empty() && inference.shapes.empty())
         {
-            for (auto& s : build.shapes)
+            // Run the opt shapes of each profile
+            for (auto& profile : build.optProfiles)
             {
-                inference.shapes.insert({s.first, s.second[static_cast<size_t>(nvinfer1::OptProfileSelector::kOPT)]});
+                inference.shapes.emplace_back();
+                for (auto& s : profile)
+                {
+                    inference.shapes.back().insert({s.first, s.second[static_cast<size_t>(nvinfer1::OptProfileSelector::kOPT)]});
+                }
             }
         }
         if (!build.maxBatch)
@@ -578,17 +1579,97 @@ void AllOptions::parse(Arguments& arguments)
                 build.maxBatch = inference.batch;
             }
         }
+        // The engine is built once for all the batch sizes of a sweep
+        for (const auto b : inference.sweepBatches)
+        {
+            if (build.maxBatch != defaultMaxBatch && build.maxBatch < b)
+            {
+                throw std::invalid_argument("Build max batch " + std::to_string(build.maxBatch)
+                    + " is less than sweep batch " + std::to_string(b));
+            }
+            build.maxBatch = std::max(build.maxBatch, b);
+        }
+    }
+    if (!inference.sweepBatches.empty() && !inference.batch && inference.shapes.empty())
+    {
+        throw std::invalid_argument("Sweep batch sizes with explicit batch require dynamic shapes (--shapes)");
     }
 
     reporting.parse(arguments);
     helps = parseHelp(arguments);
+    inference.mirrorInputs = inference.deviceInputs && reporting.input;
 
     if (!helps)
     {
+        if (!reporting.mergeHistograms.empty())
+        {
+            // Merging histogram files does not need a model
+            return;
+        }
+        if (reporting.histogramsOnly
+            && (inference.steadyState || inference.confidence || !inference.deadlines.empty()
+                || inference.dynamicBatching || !inference.shapeChurn.empty() || !inference.replay.empty()
+                || inference.clusterNodes || !inference.joinCluster.empty() || !reporting.exportTimes.empty()
+                || !reporting.exportChromeTrace.empty() || !reporting.exportSummary.empty() || reporting.profile
+                || !reporting.exportProfile.empty()))
+        {
+            // These read the trace of the queries, during the run or in their reports
+            throw std::invalid_argument("Histograms only runs (--histogramsOnly) do not support --steadyState, "
+                                        "--confidence, --deadlines, --dynamicBatching, --shapeChurn, --replay, "
+                                        "--clusterNodes, --joinCluster, --exportTimes, --exportChromeTrace, "
+                                        "--exportSummary or layer profiles");
+        }
+        if (!reporting.exportTelemetry.empty() && !inference.telemetry)
+        {
+            throw std::invalid_argument("Exporting telemetry (--exportTelemetry) requires sampling it (--telemetry)");
+        }
+        if (!inference.swapEngine.empty()
+            && (!build.refit.empty() || system.devices.size() > 1 || !system.DLACores.empty()))
+        {
+            throw std::invalid_argument("The engine swap (--swapEngine) replaces the main engine on a single device, "
+                                        "without --refit, --devices or --dlaCores");
+        }
+        if (!inference.powerSweep.empty()
+            && (system.devices.size() > 1 || !system.DLACores.empty() || !inference.serve.empty()
+                || !inference.swapEngine.empty() || !inference.pipelineStages.empty()
+                || !inference.cascade.engine.empty()))
+        {
+            throw std::invalid_argument("The power sweep (--powerSweep) runs the main engine alone on --device, "
+                                        "without --devices, --dlaCores, --serve, --swapEngine, --pipelineStage or "
+                                        "--cascade");
+        }
+        if (!inference.pipelineStages.empty() && (system.devices.size() > 1 || !system.DLACores.empty()))
+        {
+            throw std::invalid_argument("Pipeline stages (--pipelineStage) run the main engine on --device, their "
+                                        "own devices are in their specs, without --devices or --dlaCores");
+        }
+        if (!inference.cascade.engine.empty() && (system.devices.size() > 1 || !system.DLACores.empty()))
+        {
+            throw std::invalid_argument("The cascade (--cascade) runs both stages on --device, without --devices or "
+                                        "--dlaCores");
+        }
+        if (!inference.replay.empty() && system.devices.size() > 1)
+        {
+            throw std::invalid_argument(
+                "Replay (--replay) issues the trace once on a single device, without --devices");
+        }
+        if ((inference.steadyState || inference.confidence) && system.devices.size() > 1)
+        {
+            throw std::invalid_argument("The steady state (--steadyState) and confidence (--confidence) checks run on "
+                                        "a single device, without --devices");
+        }
+        if (!build.refit.empty() && model.baseModel.format == ModelFormat::kANY)
+        {
+            throw std::invalid_argument("Refitting (--refit) requires a model with the new weights");
+        }
         if (!build.load && model.baseModel.format == ModelFormat::kANY)
         {
             throw std::invalid_argument("Model missing or format not recognized");
         }
+        if (reporting.roofline && model.baseModel.format == ModelFormat::kANY)
+        {
+            throw std::invalid_argument("The roofline report (--roofline) requires the model to estimate its layers");
+        }
         if (!build.load && !build.maxBatch && model.baseModel.format != ModelFormat::kONNX)
         {
             throw std::invalid_argument("Explicit batch size not supported for Caffe and Uff models");
@@ -617,6 +1698,91 @@ void AllOptions::parse(Arguments& arguments)
                 throw std::invalid_argument("GPU fallback (--allowGPUFallback) not allowed for safe DLA capability");
             }
         }
+        if (!system.DLACores.empty())
+        {
+            if (system.DLACore >= 0 || system.devices.size() > 1)
+            {
+                throw std::invalid_argument("DLA cores (--dlaCores) already run next to the GPU, without --useDLACore "
+                                            "and --devices");
+            }
+            if (build.load)
+            {
+                throw std::invalid_argument("DLA cores (--dlaCores) require a model to build an engine for each core");
+            }
+            if (reporting.profile || !reporting.exportProfile.empty())
+            {
+                throw std::invalid_argument("Layer profiles not supported with DLA cores (--dlaCores)");
+            }
+            if (!inference.serve.empty())
+            {
+                throw std::invalid_argument("The server mode (--serve) runs the main engine alone, without DLA cores "
+                                            "(--dlaCores)");
+            }
+            if (!inference.compareEngine.empty() || inference.sweep || !inference.coEngines.empty())
+            {
+                throw std::invalid_argument("DLA cores (--dlaCores) not supported with --compareEngine, --sweep or "
+                                            "--coEngine");
+            }
+        }
+        if (system.devices.size() > 1)
+        {
+            if (system.DLACore >= 0)
+            {
+                throw std::invalid_argument("Multiple devices (--devices) not supported with DLA");
+            }
+            if (system.memPool)
+            {
+                throw std::invalid_argument("The memory pool (--memPool) caches the memory of a single device");
+            }
+            if (reporting.memory)
+            {
+                throw std::invalid_argument("The memory report (--memoryReport) accounts for a single device");
+            }
+            if (reporting.profile || !reporting.exportProfile.empty())
+            {
+                throw std::invalid_argument("Layer profiles not supported with multiple devices (--devices)");
+            }
+            if (!inference.compareEngine.empty() || !inference.coEngines.empty())
+            {
+                throw std::invalid_argument("Engine comparison (--compareEngine) and concurrent engines (--coEngine) "
+                                            "run on a single device");
+            }
+            if (!inference.validateOutputs.empty())
+            {
+                throw std::invalid_argument("Output validation (--validateOutputs) keeps its reference on a single "
+                                            "device");
+            }
+            if (!inference.serve.empty())
+            {
+                throw std::invalid_argument("The server mode (--serve) runs on a single device");
+            }
+            if (inference.timingSample > 1)
+            {
+                throw std::invalid_argument("Timing samples (--timingSample) not supported with multiple devices "
+                                            "(--devices)");
+            }
+        }
+        if (!inference.coEngines.empty() && (reporting.profile || !reporting.exportProfile.empty()))
+        {
+            throw std::invalid_argument("Layer profiles not supported with concurrent engines (--coEngine)");
+        }
+        if (!inference.transferEncodings.empty() && !reporting.recordOutputs.empty())
+        {
+            throw std::invalid_argument("Output recording (--recordOutputs) copies the outputs in their data type, "
+                                        "without --transferEncoding");
+        }
+        if (inference.batchAssembly && (reporting.output || !reporting.exportOutput.empty()
+            || !reporting.recordOutputs.empty()))
+        {
+            // The outputs of the requests are copied to buffers of their own, not to those of the bindings
+            throw std::invalid_argument("Batch assembly (--batchAssembly) does not support --dumpOutput, "
+                                        "--exportOutput or --recordOutputs");
+        }
+        if (inference.timingSample > 1 && !reporting.recordOutputs.empty())
+        {
+            throw std::invalid_argument("Output recording (--recordOutputs) requires every query to be timed, without "
+                                        "--timingSample");
+        }
     }
 }
 
@@ -692,6 +1858,19 @@ std::ostream& operator<<(std::ostream& os, const ModelOptions& options)
     return os;
 }
 
+std::ostream& operator<<(std::ostream& os, nvinfer1::DataType type)
+{
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT: return os << "fp32";
+    case nvinfer1::DataType::kHALF: return os << "fp16";
+    case nvinfer1::DataType::kINT8: return os << "int8";
+    case nvinfer1::DataType::kINT32: return os << "int32";
+    case nvinfer1::DataType::kBOOL: return os << "bool";
+    }
+    return os;
+}
+
 std::ostream& operator<<(std::ostream& os, const IOFormat& format)
 {
     switch (format.first)
@@ -795,10 +1974,61 @@ std::ostream& operator<<(std::ostream& os, const BuildOptions& options)
           "avgTiming: "      << options.avgTiming                                                                       << std::endl <<
           "Precision: "      << (options.fp16 ? "FP16" : (options.int8 ? "INT8" : "FP32"))                              << std::endl <<
           "Calibration: "    << (options.int8 && options.calibration.empty() ? "Dynamic" : options.calibration.c_str()) << std::endl <<
+          "Dynamic ranges: " << options.dynamicRanges                                                                   << std::endl <<
+          "Export dynamic ranges: " << options.exportDynamicRanges                                                      << std::endl <<
+          "GEMM algo cache: " << options.gemmAlgoCache                                                                  << std::endl <<
+          "Engine cache: "   << options.engineCache                                                                     << std::endl <<
           "Safe mode: "      << boolToEnabled(options.safe)                                                             << std::endl <<
+          "Refittable: "     << boolToEnabled(options.refittable)                                                       << std::endl <<
+          "Refit engine: "   << options.refit                                                                           << std::endl <<
           "Save engine: "    << (options.save ? options.engine : "")                                                    << std::endl <<
+          "Compression: "    << (options.compression ? "zlib level " + std::to_string(options.compression) : "disabled") << std::endl <<
           "Load engine: "    << (options.load ? options.engine : "")                                                    << std::endl;
 // clang-format on
+    if (!options.layerPrecisions.empty())
+    {
+        // Sorted, the description of the options keys the engine cache
+        const std::map<std::string, nvinfer1::DataType> sorted(
+            options.layerPrecisions.begin(), options.layerPrecisions.end());
+        os << "Layer precisions:";
+        for (const auto& p : sorted)
+        {
+            os << " " << p.first << ":" << p.second;
+        }
+        os << std::endl;
+    }
+    if (!options.precisionSearch.empty())
+    {
+        os << "Precision search: reference " << options.precisionSearch << ", tolerance " << options.precisionTolerance
+           << ", export " << options.exportLayerPrecisions << std::endl;
+    }
+    if (options.formatSearch)
+    {
+        os << "I/O format search: enabled" << std::endl;
+    }
+    if (options.workspaceSearch > 0)
+    {
+        os << "Workspace search: within " << options.workspaceSearch << "% of the latency with " << options.workspace
+           << " MB" << std::endl;
+    }
+    if (!options.matrixPrecisions.empty())
+    {
+        os << "Build matrix:";
+        for (const auto& p : options.matrixPrecisions)
+        {
+            os << " " << p;
+        }
+        os << " x batch";
+        for (const auto b : options.matrixBatches)
+        {
+            os << " " << b;
+        }
+        if (options.matrixBatches.empty())
+        {
+            os << " as given";
+        }
+        os << ", " << options.buildJobs << " jobs per device" << std::endl;
+    }
 
     auto printIOFormats = [](std::ostream& os, const char* direction, const std::vector<IOFormat> formats)
     {
@@ -817,7 +2047,12 @@ std::ostream& operator<<(std::ostream& os, const BuildOptions& options)
 
     printIOFormats(os, "Input", options.inputFormats);
     printIOFormats(os, "Output", options.outputFormats);
-    printShapes(os, "build", options.shapes);
+    printShapes(os, "build", options.optProfiles);
+    if (!options.shapeHistogram.empty())
+    {
+        os << "Shape histogram: " << options.shapeHistogram << ", " << options.optProfiles.size() << " profiles, "
+           << options.histogramPadding * 100 << "% expected padding" << std::endl;
+    }
 
     return os;
 }
@@ -828,8 +2063,22 @@ std::ostream& operator<<(std::ostream& os, const SystemOptions& options)
     os << "=== System Options ==="                                                                << std::endl <<
 
           "Device: "  << options.device                                                           << std::endl <<
+          "Devices:";
+    for (const auto d : options.devices)
+    {
+        os << " " << d;
+    }
+    os << std::endl <<
           "DLACore: " << (options.DLACore != -1 ? std::to_string(options.DLACore) : "")           <<
-                         (options.DLACore != -1 && options.fallback ? "(With GPU fallback)" : "") << std::endl;
+                         (options.DLACore != -1 && options.fallback ? "(With GPU fallback)" : "") << std::endl <<
+          "DLA cores:";
+    for (const auto c : options.DLACores)
+    {
+        os << " " << c;
+    }
+    os << std::endl <<
+          "Memory pool: " << boolToEnabled(options.memPool)                                       << std::endl <<
+          "Pinned host pool: " << boolToEnabled(options.hostPool)                                 << std::endl;
 // clang-format on
     os << "Plugins:";
     for (const auto p : options.plugins)
@@ -861,20 +2110,292 @@ std::ostream& operator<<(std::ostream& os, const InferenceOptions& options)
           "Sleep time: "     << options.sleep      << "ms"           << std::endl <<
           "Streams: "        << options.streams                      << std::endl <<
           "ExposeDMA: "      << boolToEnabled(!options.overlap)      << std::endl <<
+          "Pipeline depth: " << options.depth                        << std::endl <<
           "Spin-wait: "      << boolToEnabled(options.spin)          << std::endl <<
+          "Hybrid wait: "    << boolToEnabled(options.hybridWait)    << std::endl <<
+          "Async completion: " << boolToEnabled(options.asyncCompletion) << std::endl <<
+          "Prewarm: "        << boolToEnabled(options.prewarm)       << std::endl <<
+          "Shared memory: "  << boolToEnabled(options.shareMemory)   << std::endl <<
+          "Shared copy streams: " << boolToEnabled(options.sharedCopyStreams) << std::endl <<
           "Multithreading: " << boolToEnabled(options.threads)       << std::endl <<
-          "CUDA Graph: "     << boolToEnabled(options.graph)         << std::endl <<
-          "Skip inference: " << boolToEnabled(options.skip)          << std::endl;
-    if (options.batch)
+          "Stream priority: " << options.priority                    << std::endl <<
+          "Thread affinity: ";
+    if (options.numaAffinity)
+    {
+                          os << "CPUs local to the device";
+    }
+    else if (options.affinity.empty())
+    {
+                          os << "none";
+    }
+    for (size_t c = 0; c < options.affinity.size(); ++c)
+    {
+                          os << (c ? "," : "") << options.affinity[c];
+    }
+                          os << (options.driverAffinity ? " (with driver threads)" : "") << std::endl <<
+          "CUDA Graph: "     << boolToEnabled(options.graph);
+    if (options.graph)
+    {
+                          os << " (cache size "
+                             << options.graphCacheSize << (options.graphIteration ? ", with the copies" : "") << ")";
+    }
+                          os                                         << std::endl <<
+          "Skip inference: " << boolToEnabled(options.skip)          << std::endl <<
+          "Request rate: ";
+    if (options.qps)
+    {
+                          os << options.qps << " qps ("
+                             << (options.arrival == ArrivalType::kPOISSON ? "poisson" : "fixed") << " arrivals)" << std::endl;
+    }
+    else
+    {
+                          os << "closed loop"                        << std::endl;
+    }
+    os << "Deadlines: ";
+    if (options.deadlines.empty())
+    {
+        os << "none";
+    }
+    for (size_t c = 0; c < options.deadlines.size(); ++c)
+    {
+        os << (c ? ", " : "") << "class " << c << " share " << options.deadlines[c].share << " within "
+           << options.deadlines[c].slaMs << "ms";
+    }
+    os << std::endl;
+    os << "Shape churn: " << (options.shapeChurn.empty() ? "disabled" : options.shapeChurn) << std::endl;
+    os << "Dynamic batching: " << boolToEnabled(options.dynamicBatching);
+    if (options.dynamicBatching)
+    {
+                          os << " (max queue delay "
+                             << options.maxQueueDelay << "us" << (options.batchAssembly ? ", batch assembly" : "")
+                             << ")";
+    }
+                          os                                         << std::endl;
+    const char* memoryNames[] = {"device", "mapped", "managed"};
+    os << "Input memory: "   << memoryNames[static_cast<int>(options.inputMemory)] << std::endl;
+    os << "Packed transfers: " << boolToEnabled(options.packTransfers)               << std::endl;
+    os << "Micro-batches: " << options.microBatches                                 << std::endl;
+    os << "Tiled image: ";
+    if (options.tiledHeight)
+    {
+        os << options.tiledHeight << "x" << options.tiledWidth << " (overlap " << options.tileOverlap << ")";
+    }
+    else
+    {
+        os << "none";
+    }
+    os << std::endl;
+    os << "Device inputs: "  << boolToEnabled(options.deviceInputs)                  << std::endl;
+    os << "Compare engine: " << options.compareEngine                                << std::endl;
+    os << "Swap engine: "    << options.swapEngine                                   << std::endl;
+    os << "Concurrent engines:";
+    if (options.coEngines.empty())
+    {
+        os << " none";
+    }
+    for (const auto& co : options.coEngines)
+    {
+        os << " " << co.engine << " (" << co.streams << " streams, ";
+        if (co.qps)
+        {
+            os << co.qps << " qps";
+        }
+        else
+        {
+            os << "closed loop";
+        }
+        os << ", priority " << co.priority << ")";
+    }
+    os << std::endl;
+    os << "Pipeline stages:";
+    if (options.pipelineStages.empty())
+    {
+        os << " none";
+    }
+    for (const auto& stage : options.pipelineStages)
+    {
+        os << " " << stage.engine << " (device " << stage.device << ")";
+    }
+    os << std::endl;
+    os << "Load threads: ";
+    if (options.loadThreads)
+    {
+        os << options.loadThreads << std::endl;
+    }
+    else
+    {
+        os << "one per engine" << std::endl;
+    }
+    os << "Cascade: ";
+    if (options.cascade.engine.empty())
+    {
+        os << "none" << std::endl;
+    }
+    else
+    {
+        os << options.cascade.engine << " on the items with " << options.cascade.score << " > "
+           << options.cascade.threshold << std::endl;
+    }
+    os << "Replay: ";
+    if (options.replay.empty())
+    {
+        os << "disabled";
+    }
+    else
+    {
+        os << options.replay << " (" << options.replayRequests.size() << " requests over "
+           << options.replayRequests.back().arrivalMs << " ms, " << options.replaySpeed << "x speed, windows of "
+           << options.replayWindow << " ms)";
+    }
+    os << std::endl;
+    os << "Convergence: ";
+    if (!options.steadyState && !options.confidence)
+    {
+        os << "disabled";
+    }
+    else
+    {
+        if (options.steadyState)
+        {
+            os << "steady state within " << options.steadyState << "%, ";
+        }
+        if (options.confidence)
+        {
+            os << "confidence within " << options.confidence << "%, ";
+        }
+        os << "windows of " << options.convergenceWindow << " queries";
+    }
+    os << std::endl;
+    os << "Sweep: ";
+    if (options.sweep)
+    {
+        const auto printCounts = [&os](const char* name, const std::vector<int>& counts) {
+            os << name;
+            for (size_t c = 0; c < counts.size(); ++c)
+            {
+                os << (c ? "," : " ") << counts[c];
+            }
+        };
+        printCounts("streams", options.sweepStreams);
+        printCounts(", batch", options.sweepBatches);
+        os << (options.sweepThreads ? ", threads" : "") << (options.sweepGraph ? ", graph" : "")
+           << (options.sweepSpin ? ", spin" : "");
+        if (options.latencyTarget)
+        {
+            os << ", latency target " << options.latencyTarget << " ms";
+        }
+        os << std::endl;
+    }
+    else
+    {
+        os << "Disabled" << std::endl;
+    }
+    os << "Capacity: ";
+    if (options.capacity)
+    {
+        os << "up to " << options.capacity << " streams, " << options.capacityGain << "% gain per step";
+        if (options.latencyTarget && !options.sweep)
+        {
+            os << ", latency target " << options.latencyTarget << " ms";
+        }
+        os << std::endl;
+    }
+    else
+    {
+        os << "Disabled" << std::endl;
+    }
+    os << "Power sweep: ";
+    if (!options.powerSweep.empty())
+    {
+        const char* sep = "";
+        for (const auto& p : options.powerSweep)
+        {
+            os << sep;
+            sep = ", ";
+            if (p.smClock)
+            {
+                os << p.smClock << " MHz";
+            }
+            else
+            {
+                os << p.powerLimit << " W";
+            }
+        }
+        if (options.latencyTarget && !options.sweep && !options.capacity)
+        {
+            os << ", latency target " << options.latencyTarget << " ms";
+        }
+        if (options.throughputTarget)
+        {
+            os << ", throughput target " << options.throughputTarget << " qps";
+        }
+        os << std::endl;
+    }
+    else
+    {
+        os << "Disabled" << std::endl;
+    }
+    os << "Telemetry: ";
+    if (options.telemetry)
+    {
+        os << "every " << options.telemetry << " ms" << std::endl;
+    }
+    else
+    {
+        os << "Disabled" << std::endl;
+    }
+    if (!options.batch)
     {
         printShapes(os, "inference", options.shapes);
     }
 // clang-format on
-    os << "Inputs:" << std::endl;
+    os << "Inputs:";
+    if (options.streamInputs)
+    {
+        os << " streamed (prefetch depth " << options.prefetchDepth << ")";
+    }
+    os << std::endl;
     for (const auto& input : options.inputs)
     {
         os << input.first << "<-" << input.second << std::endl;
     }
+    os << "Compact outputs:" << std::endl;
+    for (const auto& output : options.compactOutputs)
+    {
+        os << output.first << " up to " << output.second << std::endl;
+    }
+    os << "Transfer encodings:" << std::endl;
+    for (const auto& encoding : options.transferEncodings)
+    {
+        os << encoding.first << " as " << encoding.second;
+        if (encoding.second == "mask")
+        {
+            os << " above " << options.maskThreshold;
+        }
+        os << std::endl;
+    }
+    os << "Validate outputs: " << (options.validateOutputs.empty() ? "Disabled" : options.validateOutputs);
+    if (!options.validateOutputs.empty())
+    {
+        os << " (every " << options.validateEvery << " inferences, tolerance " << options.validateTolerance << ")";
+    }
+    os << std::endl;
+    os << "Timing: " << (options.timingSample > 1 ? "One query out of " + std::to_string(options.timingSample)
+                                                   : std::string("Every query")) << std::endl;
+    os << "Serve: " << (options.serve.empty() ? "Disabled" : options.serve) << std::endl;
+    if (options.resultCache)
+    {
+        os << "Result cache: " << options.resultCache << " MB" << std::endl;
+    }
+    if (options.clusterNodes)
+    {
+        os << "Cluster: coordinator of " << options.clusterNodes << " nodes on port " << options.clusterPort
+           << ", outliers " << options.clusterOutlier << "% from the median" << std::endl;
+    }
+    else if (!options.joinCluster.empty())
+    {
+        os << "Cluster: node of " << options.joinCluster << std::endl;
+    }
 
     return os;
 }
@@ -887,11 +2408,29 @@ std::ostream& operator<<(std::ostream& os, const ReportingOptions& options)
           "Verbose: "                     << boolToEnabled(options.verbose) << std::endl <<
           "Averages: "                    << options.avgs << " inferences"  << std::endl <<
           "Percentile: "                  << options.percentile             << std::endl <<
+          "Dump input: "                  << boolToEnabled(options.input)   << std::endl <<
           "Dump output: "                 << boolToEnabled(options.output)  << std::endl <<
           "Profile: "                     << boolToEnabled(options.profile) << std::endl <<
+          "Roofline: "                    << boolToEnabled(options.roofline) << std::endl <<
+          "Reformat report: "             << boolToEnabled(options.reformats) << std::endl <<
           "Export timing to JSON file: "  << options.exportTimes            << std::endl <<
+          "Export Chrome trace: "         << options.exportChromeTrace      << std::endl <<
           "Export output to JSON file: "  << options.exportOutput           << std::endl <<
-          "Export profile to JSON file: " << options.exportProfile          << std::endl;
+          "Export profile to JSON file: " << options.exportProfile          << std::endl <<
+          "Export histograms: "           << options.exportHistograms       << std::endl <<
+          "Histograms only: "             << boolToEnabled(options.histogramsOnly) << std::endl <<
+          "Export telemetry: "            << options.exportTelemetry        << std::endl <<
+          "Export summary: "              << options.exportSummary          << std::endl <<
+          "Record outputs: "              << options.recordOutputs;
+    if (!options.recordOutputs.empty())
+    {
+        os << " (queue " << options.recordQueue << " MiB)";
+    }
+    os                                                                  << std::endl <<
+          "Startup report: "              << boolToEnabled(options.startup) << std::endl <<
+          "Memory report: "               << boolToEnabled(options.memory)  << std::endl <<
+          "Copy report: "                 << boolToEnabled(options.copies)  << std::endl <<
+          "Plugin enqueue profile: "      << boolToEnabled(options.pluginEnqueue) << std::endl;
 // clang-format on
 
     return os;
@@ -944,7 +2483,9 @@ void BuildOptions::help(std::ostream& os)
           "  --minShapes=spec            Build with dynamic shapes using a profile with the min shapes provided"                      << std::endl <<
           "  --optShapes=spec            Build with dynamic shapes using a profile with the opt shapes provided"                      << std::endl <<
           "  --maxShapes=spec            Build with dynamic shapes using a profile with the max shapes provided"                      << std::endl <<
-          "                              Note: if any of min/max/opt is missing, the profile will be completed using the shapes "     << std::endl <<
+          "                              Note: each of --minShapes, --optShapes and --maxShapes can be repeated to build "            << std::endl <<
+          "                                    multiple profiles, the n-th occurrence of each belonging to the n-th profile;"         << std::endl <<
+          "                                    if any of min/max/opt is missing, the profile will be completed using the shapes "     << std::endl <<
           "                                    provided and assuming that opt will be equal to max unless they are both specified;"   << std::endl <<           
           "                                    partially specified shapes are applied starting from the batch size;"                  << std::endl <<           
           "                                    dynamic shapes imply explicit batch"                                                   << std::endl <<           
@@ -952,6 +2493,9 @@ void BuildOptions::help(std::ostream& os)
           "                              Input shapes spec ::= Ishp[\",\"spec]"                                                       << std::endl <<
           "                                           Ishp ::= name\":\"shape"                                                        << std::endl <<
           "                                          shape ::= N[[\"x\"N]*\"*\"]"                                                     << std::endl <<
+          "  --shapeHistogram=<file>     Choose the profiles for the request shapes of the file instead, one \"count spec\" line per "
+                                "set of shapes; the profiles minimize the expected padding of the requests to their max shapes" << std::endl <<
+          "  --histogramProfiles=N       Profiles chosen for the shape histogram (default = " << defaultHistogramProfiles << ")"     << std::endl <<
           "  --inputIOFormats=spec       Type and formats of the input tensors (default = all inputs in fp32:chw)"                    << std::endl <<
           "  --outputIOFormats=spec      Type and formats of the output tensors (default = all outputs in fp32:chw)"                  << std::endl <<
           "                              IO Formats: spec  ::= IOfmt[\",\"spec]"                                                      << std::endl <<
@@ -966,9 +2510,44 @@ void BuildOptions::help(std::ostream& os)
           "  --fp16                      Enable fp16 algorithms, in addition to fp32 (default = disabled)"                            << std::endl <<
           "  --int8                      Enable int8 algorithms, in addition to fp32 (default = disabled)"                             << std::endl <<
           "  --calib=<file>              Read INT8 calibration cache file"                                                            << std::endl <<
+          "  --dynamicRanges=<file>      Set the INT8 dynamic ranges of the tensors named in file instead of calibrating, one "
+                               "\"tensor:range\" line per tensor; the other tensors get default ranges"                   << std::endl <<
+          "  --exportDynamicRanges=<file> Write the dynamic ranges of the --calib cache used by the build to file, in the "
+                                                                                   "format of --dynamicRanges"       << std::endl <<
+          "  --gemmAlgoCache=<file>      Reuse the GEMM algorithms of the FC plugins found in file, and save the cache back to file"   << std::endl <<
+          "  --engineCache=<dir>         Load the engine from dir if it was built from the same model files, options and GPU,"       << std::endl <<
+          "                              otherwise build it and add it to dir"                                                        << std::endl <<
           "  --safe                      Only test the functionality available in safety restricted flows"                            << std::endl <<
+          "  --refittable                Build an engine whose weights can be refitted (default = disabled)"                         << std::endl <<
+          "  --refit=<file>              Refit the refittable --loadEngine engine with the weights of the model options and save "
+                       "it to file; unless --buildOnly, a copy is refitted while the loaded engine serves inference, then "
+                                                                         "replaces it, and the swap is timed"                << std::endl <<
           "  --saveEngine=<file>         Save the serialized engine"                                                                  << std::endl <<
-          "  --loadEngine=<file>         Load a serialized engine"                                                                    << std::endl;
+          "  --compressEngine=N          Save the engines compressed in chunks with zlib level N (1 fastest - 9 smallest), after a "
+                  "header with build metadata and a checksum; --loadEngine recognizes compressed engines" << std::endl <<
+          "  --loadEngine=<file>         Load a serialized engine"                                                                    << std::endl <<
+          "  --buildMatrix=spec          Parse the model once and build one engine per precision and batch size, distributed over "
+                        "--devices, saving each to <saveEngine>.<precision>[.b<batch>] and measuring its latency"       << std::endl <<
+          "                              spec ::= precision[\",\"precision]*[\":\"batch[\",\"batch]*]"                             << std::endl <<
+          "                              precision ::= \"fp32\"|\"fp16\"|\"int8\", the batch sets the max batch, or "
+                                                                  "dimension 0 of the opt and max shapes with explicit batch" << std::endl <<
+          "  --buildJobs=N               Run N matrix builds at a time on each device, each with 1/N of the workspace "
+                                                                                                          "(default = 1)"     << std::endl <<
+          "  --layerPrecisions=<file>    Pin the layers named in file to a precision with strict types, one \"layer:precision\" "
+                                                       "line per layer, precision ::= \"fp32\"|\"fp16\"|\"int8\""          << std::endl <<
+          "  --precisionSearch=<file>    Build with every layer in fp32, then move the layers to the lowest enabled precision "
+                        "in order of decreasing profiled time, keeping each move while the outputs stay within tolerance "
+                         "of the reference outputs of file, as written by --exportOutput with the same inputs"          << std::endl <<
+          "  --precisionTolerance=E      Largest output difference of the search, relative to the largest absolute "
+                                                        "reference value (default = " << defaultPrecisionTolerance << ")" << std::endl <<
+          "  --exportLayerPrecisions=<file> Write the per-layer precisions found by the search to file, in the format "
+                                                                                              "of --layerPrecisions"  << std::endl <<
+          "  --ioFormatSearch            Build with the inputs, then the outputs, in each of the I/O formats of the enabled "
+                     "precisions (fp16:chw2, fp16:hwc8, int8:chw4, int8:chw32) and keep the fastest, counting the host "
+                                                                       "conversion from and to linear fp32 data" << std::endl <<
+          "  --workspaceSearch=P         Build with --workspace, then with half the workspace at a time down to 0, and keep "
+                   "the smallest workspace whose mean latency stays within P percent of the first, reporting the latency "
+                                                                                             "of each size" << std::endl;
 // clang-format on
 }
 
@@ -977,8 +2556,18 @@ void SystemOptions::help(std::ostream& os)
 // clang-format off
     os << "=== System Options ==="                                                                         << std::endl <<
           "  --device=N                  Select cuda device N (default = "         << defaultDevice << ")" << std::endl <<
+          "  --devices=N,M,...           Run inference on all the listed devices at once, the engine is built or loaded"
+                                                                                    " on the first"     << std::endl <<
+          "                              one and copied to the others, which share its input host buffers"   << std::endl <<
           "  --useDLACore=N              Select DLA core N for layers that support DLA (default = none)"   << std::endl <<
+          "  --dlaCores=N,M,...          Run an engine on each listed DLA core and one on the GPU at the same time, the"
+                                                                                    " requests are split"  << std::endl <<
+          "                              by the throughput of each engine measured in a one second run"    << std::endl <<
           "  --allowGPUFallback          When DLA is enabled, allow GPU fallback for unsupported layers "
+                                                                                    "(default = disabled)" << std::endl <<
+          "  --memPool                   Serve the device memory of TensorRT and the plugins from a caching pool "
+                                                                                    "(default = disabled)" << std::endl <<
+          "  --hostPool                  Serve the pinned host buffers from slabs placed on the NUMA node of the device "
                                                                                     "(default = disabled)" << std::endl;
     os << "  --plugins                   Plugin library (.so) to load (can be specified multiple times)"   << std::endl;
 // clang-format on
@@ -991,27 +2580,192 @@ void InferenceOptions::help(std::ostream& os)
           "  --batch=N                   Set batch size for implicit batch engines (default = "              << defaultBatch << ")" << std::endl <<
           "  --shapes=spec               Set input shapes for dynamic shapes inputs. Input names can be wrapped with single quotes"
                                                                                                                   "(ex: 'Input:0')" << std::endl <<
+          "                              It can be repeated to run different shapes on different streams; each stream is bound"
+                                                           " to the unused optimization profile that best fits its shapes" << std::endl <<
           "                              Input shapes spec ::= Ishp[\",\"spec]"                                                     << std::endl <<
           "                                           Ishp ::= name\":\"shape"                                                      << std::endl <<
           "                                          shape ::= N[[\"x\"N]*\"*\"]"                                                   << std::endl <<
+          "  --shapeChurn=uniform|<file> Draw the input shapes of every query within the profile of its stream, uniformly or from a "
+                  "shape histogram in the format of --shapeHistogram; report the latency of each shape bucket" << std::endl <<
+          "                              and the host cost of the shape changes. Uniform draws give dynamic dimensions of the same "
+                                                                     "index and profile range the same value" << std::endl <<
+          "  --replay=<file>             Replay a trace of recorded requests at their arrival times, round robin over the streams, "
+                  "with the input shapes and data of each request, and report the latency in windows of arrivals" << std::endl <<
+          "                              Each line of the trace is: arrivalMs [shapes [inputs]], with shapes a --shapes spec or "
+                                          "\"-\" and inputs a --loadInputs spec; the trace runs once, without --iterations "
+                                                                        "and --duration, --warmUp leaves its start out" << std::endl <<
+          "  --replaySpeed=X             Replay the trace X times faster than it was recorded (default = 1)"                       << std::endl <<
+          "  --replayWindow=N            Report the latency of the requests arriving in each window of N ms of the replay "
+                                                                                "(default = " << defaultReplayWindow << ")" << std::endl <<
           "  --loadInputs=spec           Load input values from files (default = generate random inputs). Input names can be "
                                                                                        "wrapped with single quotes (ex: 'Input:0')" << std::endl <<
           "                              Input values spec ::= Ival[\",\"spec]"                                                     << std::endl <<
           "                                           Ival ::= name\":\"file"                                                       << std::endl <<
+          "  --compactOutputs=spec       Copy to the host only the rows of each batch item below the count that another INT32 "
+                     "output, with one value per batch item, gives for it, such as the detections of NMS plugins, instead of "
+                                  "the whole outputs. The host waits for the counts of each inference before the copies" << std::endl <<
+          "                              Compact outputs spec ::= Cout[\",\"spec]"                                                 << std::endl <<
+          "                                              Cout ::= name\":\"count"                                                   << std::endl <<
+          "  --transferEncoding=spec     Copy bindings over PCIe narrower than their data type: inputs are narrowed on the host "
+                  "once and widened by a kernel after each copy, outputs are narrowed by a kernel before each copy and "
+                   "widened on the host when dumped or exported. fp16 applies to FP32 bindings, int16 and int8 to INT32 "
+                 "bindings, whose inputs must fit and whose outputs saturate, and mask to FP32 and FP16 outputs, copied "
+                                                      "as one bit per value, set above --maskThreshold" << std::endl <<
+          "                              Transfer encodings spec ::= Tenc[\",\"spec]"                                            << std::endl <<
+          "                                                 Tenc ::= name\":\"(\"fp16\"|\"int16\"|\"int8\"|\"mask\")"                 << std::endl <<
+          "  --maskThreshold=T           Values above T set the bits of mask encoded outputs (default = " << defaultMaskThreshold << ")" << std::endl <<
+          "  --streamInputs              Cycle through the samples of the --loadInputs files, one per inference, instead of "
+                                 "running the same input: a file is a directory with one sample per file, taken in name "
+                                 "order, a packed file with the samples back to back, or a packed dataset file, which is "
+                                                                                  "memory mapped (default = disabled)" << std::endl <<
+          "  --prefetchDepth=N           Samples loaded ahead of use by a loader thread for each stream with --streamInputs "
+                                                                                       "(default = " << defaultPrefetchDepth << ")" << std::endl <<
+          "  --validateOutputs=<file>    Check the outputs against the reference values of file, written by --exportOutput, "
+                         "with a kernel on the device after every Nth inference of each stream, and fail on mismatches" << std::endl <<
+          "  --validateEvery=N           Check one inference out of every N of each stream (default = " << defaultValidateEvery << ")" << std::endl <<
+          "  --validateTolerance=t       Values of the outputs mismatch when |output - reference| > t * (1 + |reference|) "
+                                                                                 "(default = " << defaultValidateTolerance << ")" << std::endl <<
+          "  --timingSample=N            Time one query out of every N of each stream, the others only record the events "
+                      "the waits between streams need, created without timing, which lowers the overhead of the measure at "
+                                            "low latencies; latencies are reported over the timed queries (default = 0, all)" << std::endl <<
+          "  --serve=<socket>            Keep the engine and its contexts resident and serve inference requests on the Unix "
+                 "domain socket, with the tensors passed in POSIX shared memory registered as pinned memory (Linux only)" << std::endl <<
+          "  --resultCache=M             Skip the inferences of the server whose inputs hash like those of a previous one, and "
+                 "reply with its outputs, kept in M MB of pinned memory for the least recently used inputs (default = 0, "
+                 "disabled)" << std::endl <<
           "  --iterations=N              Run at least N inference iterations (default = "               << defaultIterations << ")" << std::endl <<
           "  --warmUp=N                  Run for N milliseconds to warmup before measuring performance (default = "
                                                                                                             << defaultWarmUp << ")" << std::endl <<
           "  --duration=N                Run performance measurements for at least N seconds wallclock time (default = "
                                                                                                           << defaultDuration << ")" << std::endl <<
+          "  --steadyState=D             End the warm up once the mean latency and GPU compute time of the last window of queries "
+                  "are within D percent of those of the window before; --warmUp is then the minimum warm up and" << std::endl <<
+          "                              --duration its maximum (default = 0, fixed warm up)"                                       << std::endl <<
+          "  --confidence=W              End the measurement once the 95% confidence intervals of the mean latency, the 99th "
+                  "percentile latency and the throughput are within W percent of them; --iterations is then the" << std::endl <<
+          "                              minimum measurement and --duration its maximum (default = 0, fixed duration)"             << std::endl <<
+          "  --convergenceWindow=N       Check the steady state and the confidence every N queries, over windows of N queries "
+                                                                         "(default = " << defaultConvergenceWindow << ")" << std::endl <<
           "  --sleepTime=N               Delay inference start with a gap of N milliseconds between launch and compute "
                                                                                                "(default = " << defaultSleep << ")" << std::endl <<
           "  --streams=N                 Instantiate N engines to use concurrently (default = "            << defaultStreams << ")" << std::endl <<
           "  --exposeDMA                 Serialize DMA transfers to and from device. (default = disabled)"                          << std::endl <<
+          "  --pipelineDepth=N           Keep up to N queries in flight per stream, each with its own bindings, to overlap "
+                          "the transfers and compute of successive queries (default = " << defaultPipelineDepth << ")" << std::endl <<
           "  --useSpinWait               Actively synchronize on GPU events. This option may decrease synchronization time but "
                                                                              "increase CPU usage and power (default = disabled)"    << std::endl <<
+          "  --asyncCompletion           Queue the completions of the queries from host functions on the streams and reissue "
+             "each stream as it completes, in completion order, so that one thread keeps all its streams busy (default = disabled)" << std::endl <<
+          "  --useHybridWait             Spin on GPU events for a window adapted to the recent waits, then yield and block, "
+                          "trading less CPU than --useSpinWait for less wake up latency than blocking (default = disabled)" << std::endl <<
+          "  --prewarm                   Run one inference on each context before the timed run, so that the lazy initializations "
+                                         "of TensorRT and the plugins do not delay the first request (default = disabled)" << std::endl <<
+          "  --shareDeviceMemory         Create the contexts of all the streams, and of --compareEngine, without device memory and "
+                          "share one region sized for the largest; their computes then run one after the other (default = disabled)" << std::endl <<
+          "  --sharedCopyStreams         Issue the input copies of all the streams of a device on one stream, and their output "
+               "copies on another, in the order of submission, and report the copies as --copyReport (default = disabled)" << std::endl <<
           "  --threads                   Enable multithreading to drive engines with independent threads (default = disabled)"      << std::endl <<
+          "  --streamPriority=N          Create the inference streams with CUDA priority N, lower values are higher priorities, "
+                                   "the device clamps N to its range (default = 0, the default and lowest priority)" << std::endl <<
+          "  --affinity=spec             Pin each inference thread to one CPU, in turn from a list or from the CPUs local to "
+                                                                                   "the device (default = none)"    << std::endl <<
+          "                              spec ::= \"numa\"|cpu[-cpu][,cpu[-cpu]]*, e.g. 0-7,16-23"                                   << std::endl <<
+          "  --driverAffinity            Create the device contexts on the same CPUs, so that the driver threads run there too "
+                                                                                             "(default = disabled)"    << std::endl <<
           "  --useCudaGraph              Use cuda graph to capture engine execution and then launch inference (default = disabled)" << std::endl <<
-          "  --buildOnly                 Skip inference perf measurement (default = disabled)"                                      << std::endl;
+          "  --graphCacheSize=N          Keep up to N captured graphs per stream, one for each set of input shapes, replacing the "
+                                               "least recently used (default = " << defaultGraphCacheSize << ")" << std::endl <<
+          "  --graphIteration            Capture the input copies, the engine execution and the output copies of each query, with "
+                              "the waits between their streams, into one graph per binding set, launched with a single "
+                                 "call. The compute time of the trace covers the whole graph (implies --useCudaGraph)" << std::endl <<
+          "  --buildOnly                 Skip inference perf measurement (default = disabled)"                                      << std::endl <<
+          "  --qps=N                     Issue inference requests at an offered rate of N requests per second (open loop), "
+                                                          "each request runs one batch (default = closed loop, back to back)" << std::endl <<
+          "  --arrival=dist              Distribution of request arrivals with --qps (default = fixed)"                             << std::endl <<
+          "                              dist ::= \"fixed\"|\"poisson\""                                                            << std::endl <<
+          "  --dynamicBatching           Gather single requests issued with --qps into batches, up to the engine max batch size for"
+                                            " implicit batch, or the profile max batch dimension for explicit batch" << std::endl <<
+          "  --maxQueueDelay=N           Dispatch a partial batch once its oldest request waited N microseconds (default = "
+                                                                                                     << defaultMaxQueueDelay << ")" << std::endl <<
+          "  --batchAssembly             Copy each request of --dynamicBatching from a pinned buffer of its own and gather them into "
+                  "the batch on the device, then copy each result back on its own"                                        << std::endl <<
+          "  --deadlines=spec            Give the requests of --qps a deadline and a priority class, run them earliest deadline first, "
+                  "shed those that can no longer meet it and cut a batch early for the tightest one; report the goodput" << std::endl <<
+          "                              spec ::= class[\",\"spec], in decreasing priority"                                        << std::endl <<
+          "                              class ::= share\":\"sla, the relative share of the requests and their SLA in ms"          << std::endl <<
+          "  --inputMemory=type          Memory backing the input bindings (default = device)"                                      << std::endl <<
+          "                              type ::= \"device\"|\"mapped\"|\"managed\""                                                << std::endl <<
+          "                              device: pinned host memory copied to device memory before each inference"                 << std::endl <<
+          "                              mapped: mapped pinned host memory read directly by the device, no copy"                    << std::endl <<
+          "                              managed: unified memory, no explicit copy"                                                  << std::endl <<
+          "  --packTransfers             Stage the inputs one after the other in one pinned buffer and one device buffer, and the "
+              "outputs in another pair, so that each full batch transfers with a single copy each way (default = disabled)" << std::endl <<
+          "  --microBatches=N            Split the batch of each query in N chunks, along the outermost dimension of the bindings, "
+                  "and pipeline their input copies, computes and output copies; the profile of explicit batch engines "
+                                                                "must accept the batch of a chunk (default = 1)" << std::endl <<
+          "  --tiledImage=HxW            Run an image of H x W pixels per query, as tiles of the spatial size of the input that "
+                  "are cut and blended on the device, a batch of tiles per enqueue; the engine must have one FP32 CHW "
+                      "input and output, the image is random or read from --loadInputs, --dumpOutput and --exportOutput print "
+                      "the blended output image (default = disabled)" << std::endl <<
+          "  --tileOverlap=P             Overlap neighbor tiles by P input pixels, blended linearly across the overlap "
+                                                                   "(default = " << defaultTileOverlap << ")" << std::endl <<
+          "  --deviceInputs              Generate the random inputs once in device memory, with a Philox generator, instead of "
+                "on the host, so that they are not copied before each inference; the values differ from the host ones, "
+                                        "the inputs read from files are still copied (default = disabled)" << std::endl <<
+          "  --compareEngine=<file>      Interleave the iterations of the engine with those of another one on the same device "
+                       "and report their latency and throughput differences, and their layer differences with --dumpProfile" << std::endl <<
+          "  --swapEngine=<file>         Serve the engine while another one is loaded and set up in the background, then swap "
+                    "it in between two inferences, release the old one while it serves, and report the latency spike" << std::endl <<
+          "  --coEngine=spec             Run another engine at once with the main one on the same device, with its own streams, "
+                        "request rate and stream priority, and report the latency of each (can be specified multiple times)" << std::endl <<
+          "                              spec ::= file[\":\"streams[\":\"qps[\":\"priority]]], with 1 stream, closed loop "
+                                                                                 "and priority 0 by default" << std::endl <<
+          "  --pipelineStage=spec        Run the engine of the next segment of a network split by layers on its own device, "
+                    "fed with the outputs of the previous segment of the same names copied peer to peer, as a pipeline "
+                                                    "of --pipelineDepth micro-batches in flight (can be specified multiple times)" << std::endl <<
+          "                              spec ::= file[\":\"device], on device 0 by default; the main engine is the "
+                                                                "first stage, on --device, and reports per stage" << std::endl <<
+          "  --loadThreads=N             Load the engines of --coEngine and --pipelineStage on N threads at once, with their "
+                  "execution contexts, and report the time each and all of them took to be ready (default = 0, one "
+                                                                "thread per engine up to the hardware concurrency)" << std::endl <<
+          "  --cascade=spec              Run the main engine as a filter on every item of a batch and the engine of spec only on "
+                  "the items whose score is above the threshold, compacted on the device into its dynamic batch" << std::endl <<
+          "                              spec ::= file\":\"score[\":\"threshold], score being an FP32 output of the main engine "
+                                "with one value per item, threshold " << defaultCascadeThreshold << " by default" << std::endl <<
+          "  --sweep=spec                Measure throughput and latency for every combination of stream counts, batch sizes "
+                        "and switches, each warmed up and timed like a single run, and print the Pareto frontier" << std::endl <<
+          "                              spec ::= [streams][\":\"[batches][\":\"switches]], with the --streams and --batch "
+                                                                                         "values by default"          << std::endl <<
+          "                              streams ::= N[\",\"N]*, batches ::= N[\",\"N]*"                               << std::endl <<
+          "                              switches ::= switch[\",\"switch]*, each run off and on"                        << std::endl <<
+          "                              switch ::= \"threads\"|\"graph\"|\"spin\""                                   << std::endl <<
+          "  --capacity=N                Add a stream, with its context and bindings, at a time up to N streams until the "
+                       "set up runs out of device memory or the throughput stops scaling, and report the device memory, "
+                               "throughput and latency of each step, the best one and its memory headroom" << std::endl <<
+          "  --capacityGain=P            Percent of throughput a step must add over the best one to count as scaling, the "
+                                            "search stops after two steps that do not (default = " << defaultCapacityGain
+                                                                                                << ")" << std::endl <<
+          "  --powerSweep=settings       Measure throughput, latency and mean power at the default power limit and clocks of "
+                     "the device, then at each setting, set with NVML when permitted, and report the most inferences "
+                                 "per joule meeting the targets. Power is sampled every --telemetry ms, or "
+                                                          << defaultPowerSweepTelemetry << " ms by default" << std::endl <<
+          "                              settings ::= setting[\",\"setting]*"                                        << std::endl <<
+          "                              setting ::= N\"W\"|N\"MHz\", a power limit or a locked SM clock"             << std::endl <<
+          "  --latencyTarget=ms          Report the best sweep configuration, capacity step or power setting, whose host "
+                                                      "latency at the --percentile is below ms (default = none)" << std::endl <<
+          "  --throughputTarget=N        Report the most efficient power setting with at least N inferences per second "
+                                                                                      "(default = none)" << std::endl <<
+          "  --telemetry=N               Sample the clocks, power, temperature and throttle reasons of the devices with NVML "
+                              "every N milliseconds during inference and report how long they were throttled (default = "
+                                                                                                  "disabled)" << std::endl <<
+          "  --clusterNodes=N            Coordinate a run on N nodes, this one included: wait for the other nodes to join "
+                           "with the same inference options, start them together, and report their merged histograms, "
+                           "aggregate throughput and the outlier nodes"                              << std::endl <<
+          "  --joinCluster=host[:port]   Run as a node of the cluster run of the coordinator on host"  << std::endl <<
+          "  --clusterPort=P             TCP port the coordinator listens on (default = " << defaultClusterPort << ")" << std::endl <<
+          "  --clusterOutlier=P          Flag the nodes whose throughput, GPU compute, H2D or D2H time is more than P percent "
+                                            "from the median of the nodes (default = " << defaultClusterOutlier
+                                                                                                << ")" << std::endl;
 // clang-format on
 }
 
@@ -1025,13 +2779,46 @@ void ReportingOptions::help(std::ostream& os)
           "  --percentile=P              Report performance for the P percentage (0<=P<=100, 0 "
                                         "representing max perf, and 100 representing min perf; (default"
                                                                       " = " << defaultPercentile << "%)" << std::endl <<
+          "  --dumpInput                 Print the input tensor(s), copied back to the host with --deviceInputs "
+                                                                                  "(default = disabled)" << std::endl <<
           "  --dumpOutput                Print the output tensor(s) of the last inference iteration "
                                                                                   "(default = disabled)" << std::endl <<
-          "  --dumpProfile               Print profile information per layer (default = disabled)"       << std::endl <<
+          "  --dumpProfile               Print profile information per layer, aggregated over all the streams; "
+                   "profiled inferences run synchronously, use --threads for streams to overlap (default = disabled)" << std::endl <<
+          "  --roofline                  Estimate the operations and bytes of each layer from the model, and report the "
+           "throughput of the profiled layers against the peaks of the device; implies --dumpProfile (default = disabled)" << std::endl <<
+          "  --reformatReport            Report the time of the reformat layers, by the layer, plugin or binding they "
+                                            "serve when the model is given; implies --dumpProfile (default = disabled)" << std::endl <<
           "  --exportTimes=<file>        Write the timing results in a json file (default = disabled)"   << std::endl <<
+          "  --exportChromeTrace=<file>  Write the timeline of the streams in the trace event format of chrome://tracing and "
+                     "Perfetto, with the layers of each inference when profiling (default = disabled)"     << std::endl <<
           "  --exportOutput=<file>       Write the output tensors to a json file (default = disabled)"   << std::endl <<
           "  --exportProfile=<file>      Write the profile information per layer in a json file "
-                                                                              "(default = disabled)"     << std::endl;
+                                                                              "(default = disabled)"     << std::endl <<
+          "  --exportTelemetry=<file>    Write the samples of --telemetry in a json file (default = disabled)" << std::endl <<
+          "  --exportSummary=<file>      Write the throughput, the latency percentiles, the build time and the device memory "
+                             "used of the run as a one line json record, as collected by benchmark.py (default = disabled)"
+                                                                                                           << std::endl <<
+          "  --recordOutputs=<prefix>    Record the outputs of every inference in binary to prefix.bin, from a background thread, "
+                   "and describe each record (stream, time, output names, types, dimensions and offsets) in prefix.json "
+                                                                                             "(default = disabled)" << std::endl <<
+          "  --recordQueue=N             Queue up to N MiB of outputs for the writer, inferences past it are not recorded "
+                                                                             "(default = " << defaultRecordQueue << ")" << std::endl <<
+          "  --startupReport             Report the time of each phase from the start of trtexec to the end of the first "
+                                                                                   "inference (default = disabled)" << std::endl <<
+          "  --memoryReport              Report the device memory held by TensorRT, by the plugins and outside of their "
+                                            "allocators after each phase of the set up and run (default = disabled)" << std::endl <<
+          "  --copyReport                Report the time the H2D and D2H copies of each device were busy, overlapped with "
+                           "computes, and the copies that ran ahead of those of earlier queries (default = disabled)" << std::endl <<
+          "  --pluginEnqueueProfile      Report the host time spent in the enqueue of each plugin layer, next to its GPU "
+                                                                     "time when profiling (default = disabled)" << std::endl <<
+          "  --exportHistograms=<file>   Write the latency histograms of the run in a text file that "
+                                                           "--mergeHistograms can combine (default = disabled)" << std::endl <<
+          "  --histogramsOnly            Count the queries in the latency histograms only, without keeping a trace of "
+                "every query, so that long runs report in fixed memory; the reports built from the trace are left "
+                                                                                         "out (default = disabled)" << std::endl <<
+          "  --mergeHistograms=f1,f2,... Merge histogram files written by --exportHistograms and report their "
+                       "percentiles, without running a model; --exportHistograms writes the merged histograms" << std::endl;
 // clang-format on
 }
 
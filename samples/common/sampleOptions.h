@@ -36,6 +36,7 @@ constexpr int defaultMaxBatch{1};
 constexpr int defaultWorkspace{16};
 constexpr int defaultMinTiming{1};
 constexpr int defaultAvgTiming{8};
+constexpr int defaultHistogramProfiles{3};
 
 // System default params
 constexpr int defaultDevice{0};
@@ -47,10 +48,29 @@ constexpr int defaultIterations{10};
 constexpr int defaultWarmUp{200};
 constexpr int defaultDuration{3};
 constexpr int defaultSleep{0};
+constexpr float defaultQps{0};
+constexpr int defaultMaxQueueDelay{100};
+constexpr int defaultGraphCacheSize{16};
+constexpr int defaultPrefetchDepth{4};
+constexpr int defaultPipelineDepth{2};
+constexpr int defaultTileOverlap{16};
+constexpr int defaultValidateEvery{100};
+constexpr float defaultValidateTolerance{1e-3F};
+constexpr float defaultMaskThreshold{0.5F};
+constexpr float defaultCapacityGain{5};
+constexpr int defaultClusterPort{29400};
+constexpr float defaultClusterOutlier{10};
+constexpr int defaultReplayWindow{1000};
+constexpr int defaultConvergenceWindow{20};
+constexpr float defaultCascadeThreshold{0.5F};
+constexpr int defaultPowerSweepTelemetry{50};
+
+constexpr float defaultPrecisionTolerance{0.01F};
 
 // Reporting default params
 constexpr int defaultAvgRuns{10};
 constexpr float defaultPercentile{99};
+constexpr int defaultRecordQueue{256};
 
 enum class ModelFormat
 {
@@ -60,12 +80,41 @@ enum class ModelFormat
     kUFF
 };
 
-using Arguments = std::unordered_multimap<std::string, std::string>;
+enum class ArrivalType
+{
+    kFIXED,
+    kPOISSON
+};
+
+enum class InputMemory
+{
+    kDEVICE,
+    kMAPPED,
+    kMANAGED
+};
+
+//! Option name to value and position of the option on the command line
+using Arguments = std::unordered_multimap<std::string, std::pair<std::string, int>>;
 
 using IOFormat = std::pair<nvinfer1::DataType, nvinfer1::TensorFormats>;
 
 using ShapeRange = std::array<nvinfer1::Dims, nvinfer1::EnumMax<nvinfer1::OptProfileSelector>()>;
 
+using ShapeProfile = std::unordered_map<std::string, ShapeRange>;
+
+using InputShapes = std::unordered_map<std::string, nvinfer1::Dims>;
+
+//! Request shapes and how many requests had them
+using ShapeHistogram = std::vector<std::pair<InputShapes, double>>;
+
+//! Request of a recorded trace, replayed at its arrival time with its input shapes and data
+struct ReplayRequest
+{
+    float arrivalMs{0}; // From the first request of the trace
+    InputShapes shapes; // Of the dynamic inputs it sets, the others keep their --shapes
+    std::unordered_map<std::string, std::string> inputs; // Files of the input data it sets, by input name
+};
+
 struct Options
 {
     virtual void parse(Arguments& arguments) = 0;
@@ -112,13 +161,33 @@ struct BuildOptions : public Options
     bool fp16{false};
     bool int8{false};
     bool safe{false};
+    bool refittable{false};
     bool save{false};
     bool load{false};
     std::string engine;
     std::string calibration;
-    std::unordered_map<std::string, ShapeRange> shapes;
+    std::string dynamicRanges;       // Per-tensor ranges set instead of calibrating, one "tensor:range" line each
+    std::string exportDynamicRanges; // File the ranges of the calibration cache are written to
+    std::string gemmAlgoCache;
+    std::string engineCache; // Directory of engines keyed by model files, options and GPU
+    std::string refit;       // File the loaded engine is saved to once refitted with the weights of the model
+    int compression{0};      // zlib level of the saved engines, 0 saves them uncompressed
+    std::vector<ShapeProfile> optProfiles; // One optimization profile per set of --minShapes/--optShapes/--maxShapes
+    std::string shapeHistogram;  // File of request shapes the profiles are chosen for, instead of the shape options
+    ShapeHistogram histogram;    // Read from shapeHistogram
+    int histogramProfiles{defaultHistogramProfiles};
+    double histogramPadding{0};  // Expected padding of the chosen profiles, relative to the request volume
     std::vector<IOFormat> inputFormats;
     std::vector<IOFormat> outputFormats;
+    std::vector<std::string> matrixPrecisions; // Precisions of the build matrix, empty for a single build
+    std::vector<int> matrixBatches; // Batch sizes of the build matrix, empty for the batch options as given
+    int buildJobs{1};               // Concurrent matrix builds per device, they share the workspace
+    std::unordered_map<std::string, nvinfer1::DataType> layerPrecisions; // Read from --layerPrecisions, strict types
+    std::string precisionSearch; // Reference outputs of the mixed precision search, empty without a search
+    float precisionTolerance{defaultPrecisionTolerance}; // Output error of the search relative to the reference range
+    std::string exportLayerPrecisions; // File the per-layer precisions found by the search are written to
+    bool formatSearch{false};          // Build with each candidate I/O format and keep the fastest end to end
+    float workspaceSearch{0}; // Latency increase in percent the smallest workspace may cost, 0 without a search
 
     void parse(Arguments& arguments) override;
 
@@ -128,8 +197,12 @@ struct BuildOptions : public Options
 struct SystemOptions : public Options
 {
     int device{defaultDevice};
+    std::vector<int> devices; // Devices running inference, the engine is built on the first one, empty for device only
     int DLACore{-1};
+    std::vector<int> DLACores; // DLA cores each running an engine next to the GPU one, empty for a single engine
     bool fallback{false};
+    bool memPool{false};
+    bool hostPool{false};
     std::vector<std::string> plugins;
 
     void parse(Arguments& arguments) override;
@@ -137,21 +210,125 @@ struct SystemOptions : public Options
     static void help(std::ostream& out);
 };
 
+//! Requests of a priority class, a share of the offered rate each due within its SLA of its arrival
+struct RequestClass
+{
+    float share{1};
+    float slaMs{0};
+};
+
+//! Engine run at once with the main one, on the same device, with its own streams, request rate and stream priority
+struct CoEngine
+{
+    std::string engine;
+    int streams{1};
+    float qps{0}; // Zero runs closed loop
+    int priority{0};
+};
+
+//! Engine of the next segment of a network split by layers, run on its own device after the previous segment
+struct PipelineStage
+{
+    std::string engine;
+    int device{0};
+};
+
+struct CascadeStage
+{
+    std::string engine; // Empty without a cascade
+    std::string score;  // FP32 output of the main engine with one score per item
+    float threshold{defaultCascadeThreshold};
+};
+
+struct PowerSetting
+{
+    float powerLimit{0};     // W, 0 leaves the limit of the device
+    unsigned int smClock{0}; // MHz the SM clock is locked at, 0 leaves the clocks unlocked
+};
+
 struct InferenceOptions : public Options
 {
     int batch{defaultBatch}; // Parsing sets batch to 0 is shapes is not empty
     int iterations{defaultIterations};
     int warmup{defaultWarmUp};
     int duration{defaultDuration};
+    float steadyState{0}; // Percent of latency drift between windows ending the warm up, 0 for a fixed warm up
+    float confidence{0};  // Percent of the estimates the confidence intervals stop the run under, 0 to run on
+    int convergenceWindow{defaultConvergenceWindow}; // Queries per window of the steady state and confidence checks
     int sleep{defaultSleep};
     int streams{defaultStreams};
     bool overlap{true};
+    int depth{defaultPipelineDepth}; // Queries in flight per stream, each with its own bindings, 1 without overlap
     bool spin{false};
+    bool hybridWait{false}; // Spin for a window adapted to the recent waits, then block
+    bool asyncCompletion{false}; // Streams are reissued from host function completions, in completion order
     bool threads{false};
+    int priority{0}; // CUDA priority of the streams, lower values are higher priorities, 0 is the default and lowest
+    bool prewarm{false}; // Run an inference on each context at set up, so that lazy initializations happen then
+    bool shareMemory{false}; // Contexts share one activation region and their computes run one after the other
+    bool sharedCopyStreams{false}; // The copies of all the streams of a device go through one stream per direction
+    std::vector<int> affinity; // CPUs the inference threads are pinned to in turn, one CPU each
+    bool numaAffinity{false};  // Pin the threads of each device to the CPUs local to its PCIe root instead
+    bool driverAffinity{false}; // Create the device contexts on the same CPUs, for the driver threads
     bool graph{false};
+    bool graphIteration{false}; // The graphs capture the input and output copies of each query with its compute
+    int graphCacheSize{defaultGraphCacheSize}; // Captured graphs kept per stream, one for each set of input shapes
     bool skip{false};
+    float qps{defaultQps}; // Zero selects closed-loop issuing, back to back
+    ArrivalType arrival{ArrivalType::kFIXED};
+    bool dynamicBatching{false};
+    int maxQueueDelay{defaultMaxQueueDelay}; // Microseconds
+    bool batchAssembly{false}; // Requests are copied on their own and gathered into the batch on the device
+    std::vector<RequestClass> deadlines; // Priority classes of the requests, highest first, empty without deadlines
+    InputMemory inputMemory{InputMemory::kDEVICE}; // Zero-copy input types skip the host to device transfer
+    bool packTransfers{false}; // Inputs, and outputs, are staged contiguously and transferred with one copy each way
+    int microBatches{1}; // Chunks of the batch of each query, pipelined through the copies and the compute
+    int tiledHeight{0}; // Image each query runs as tiles of the input, 0 to run the input
+    int tiledWidth{0};
+    int tileOverlap{defaultTileOverlap}; // Pixels of the input shared by neighbor tiles
+    bool deviceInputs{false}; // Random inputs are generated in device memory once instead of copied from the host
+    bool mirrorInputs{false}; // Generated inputs are copied back to host buffers, for --dumpInput
     std::unordered_map<std::string, std::string> inputs;
-    std::unordered_map<std::string, nvinfer1::Dims> shapes;
+    bool streamInputs{false}; // Inputs cycle through the samples of their files instead of reusing one
+    int prefetchDepth{defaultPrefetchDepth};
+    std::unordered_map<std::string, std::string> compactOutputs; // Output -> count output bounding its copied rows
+    std::unordered_map<std::string, std::string> transferEncodings; // Binding -> fp16, int16, int8 or mask
+    float maskThreshold{defaultMaskThreshold}; // Values above it set the bits of the mask encoded outputs
+    std::string validateOutputs; // Reference outputs, as exported by --exportOutput, checked on the device
+    int validateEvery{defaultValidateEvery}; // Inferences per stream between two checks of the outputs
+    float validateTolerance{defaultValidateTolerance};
+    std::string serve; // Unix domain socket the server mode accepts requests on, empty runs the benchmark
+    int resultCache{0}; // MB of pinned memory caching the outputs of the server by their inputs, 0 disables it
+    int timingSample{0}; // Queries per stream between two timed ones, the others only record synchronization events
+    std::vector<InputShapes> shapes; // Streams run the sets of --shapes in turn
+    std::string shapeChurn;     // "uniform" or a shape histogram file the queries draw their input shapes from
+    ShapeHistogram churnShapes; // Read from a shapeChurn file, empty for uniform draws
+    std::string compareEngine; // Engine whose iterations interleave with the main one for an A/B comparison
+    std::string swapEngine;    // Engine loaded and set up while the main one serves, then swapped in
+    std::vector<CoEngine> coEngines; // Engines run concurrently with the main one, each reported separately
+    std::vector<PipelineStage> pipelineStages; // Stages fed by the main engine in turn, each on its own device
+    int loadThreads{0}; // Threads loading the --coEngine and --pipelineStage engines, 0 for one per engine
+    CascadeStage cascade; // Engine run only on the items of the main engine whose score is above the threshold
+    std::string replay;                        // Trace of recorded requests replayed at their arrival times
+    std::vector<ReplayRequest> replayRequests; // Read from replay, in arrival order
+    float replaySpeed{1};                      // Times faster than recorded the trace is replayed
+    int replayWindow{defaultReplayWindow};     // Milliseconds of arrivals of each window of the replay report
+    int telemetry{0}; // Milliseconds between NVML samples of the devices during inference, 0 disables sampling
+    bool sweep{false};
+    std::vector<int> sweepStreams; // Empty sweeps --streams alone
+    std::vector<int> sweepBatches; // Empty sweeps the --batch or --shapes batch alone
+    bool sweepThreads{false};
+    bool sweepGraph{false};
+    bool sweepSpin{false};
+    int capacity{0}; // Most streams the capacity search adds, 0 disables the search
+    float capacityGain{defaultCapacityGain}; // Percent of throughput a step must add to count as scaling
+    std::vector<PowerSetting> powerSweep; // Settings measured after the default ones, empty disables the sweep
+    float latencyTarget{0}; // Milliseconds of host latency at the reported percentile, 0 for no target
+    float throughputTarget{0}; // Inferences per second of the power sweep, 0 for no target
+    int clusterNodes{0}; // Nodes of the cluster run this process coordinates, itself included, 0 if not coordinating
+    std::string joinCluster; // Coordinator host[:port] of the cluster run this process is a node of
+    int clusterPort{defaultClusterPort};
+    float clusterOutlier{defaultClusterOutlier}; // Percent from the median of the nodes that flags a node
 
     void parse(Arguments& arguments) override;
 
@@ -163,11 +340,26 @@ struct ReportingOptions : public Options
     bool verbose{false};
     int avgs{defaultAvgRuns};
     float percentile{defaultPercentile};
+    bool input{false};
     bool output{false};
     bool profile{false};
+    bool roofline{false}; // Report each profiled layer against the compute and bandwidth roofs of the device
+    bool reformats{false}; // Report the reformat layers of the profile by the layer or binding they serve
     std::string exportTimes;
+    std::string exportChromeTrace;
     std::string exportOutput;
     std::string exportProfile;
+    std::string exportHistograms;
+    std::string exportTelemetry;
+    std::string exportSummary; // One line JSON record of the run, for the benchmark suite
+    bool startup{false}; // Report the time of each phase from the start of the process to the first inference
+    bool memory{false};  // Report the device memory of TensorRT, the plugins and the bindings in each phase
+    bool copies{false};  // Report the overlap of the copies with the computes and the order of the copies
+    bool pluginEnqueue{false}; // Report the host time of the enqueue of each plugin layer
+    std::string recordOutputs; // Prefix of the binary outputs of every inference and of their description
+    int recordQueue{defaultRecordQueue}; // MiB of outputs queued for the writer before inferences are not recorded
+    std::vector<std::string> mergeHistograms; // Histogram files to merge instead of running a model
+    bool histogramsOnly{false}; // The run is reported from its latency histograms, without a trace of its queries
 
     void parse(Arguments& arguments) override;
 
@@ -202,6 +394,8 @@ std::ostream& operator<<(std::ostream& os, const UffInput& input);
 
 std::ostream& operator<<(std::ostream& os, const IOFormat& format);
 
+std::ostream& operator<<(std::ostream& os, nvinfer1::DataType type);
+
 std::ostream& operator<<(std::ostream& os, const ShapeRange& dims);
 
 std::ostream& operator<<(std::ostream& os, const ModelOptions& options);
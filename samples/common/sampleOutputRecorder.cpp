@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include "logger.h"
+#include "sampleOutputRecorder.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+namespace
+{
+
+const char* typeName(nvinfer1::DataType type)
+{
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT: return "float32";
+    case nvinfer1::DataType::kHALF: return "float16";
+    case nvinfer1::DataType::kINT8: return "int8";
+    case nvinfer1::DataType::kINT32: return "int32";
+    case nvinfer1::DataType::kBOOL: return "bool";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+OutputRecorder::OutputRecorder(const std::string& prefix, size_t queueBytes)
+    : mPrefix(prefix)
+    , mQueueBytes(queueBytes)
+    , mFile(prefix + ".bin", std::ios::out | std::ios::binary | std::ios::trunc)
+{
+    mOpen = static_cast<bool>(mFile);
+    if (!mOpen)
+    {
+        gLogWarning << "Could not open " << prefix << ".bin, outputs are not recorded" << std::endl;
+    }
+    mWriter = std::thread(&OutputRecorder::write, this);
+}
+
+OutputRecorder::~OutputRecorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    mWriter.join();
+    mFile.close();
+    writeDescription();
+    if (mDropped)
+    {
+        gLogWarning << "Output recording dropped " << mDropped << " inferences, the writer did not keep up"
+                    << std::endl;
+    }
+}
+
+bool OutputRecorder::record(
+    const nvinfer1::IExecutionContext& context, const Bindings& bindings, int stream, float timeMs)
+{
+    // The queue space is reserved under the lock and the outputs are copied outside of it
+    Record record{stream, timeMs, {}, {}};
+    const auto outputs = bindings.getOutputBindings();
+    const std::map<std::string, int> ordered(outputs.begin(), outputs.end());
+    size_t size{0};
+    for (const auto& o : ordered)
+    {
+        size += bindings.getHostSize(o.second);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mQueuedBytes + size > mQueueBytes || !mOpen)
+        {
+            ++mDropped;
+            return false;
+        }
+        mQueuedBytes += size;
+    }
+    record.data.resize(size);
+    size_t offset{0};
+    for (const auto& o : ordered)
+    {
+        const size_t bytes = bindings.getHostSize(o.second);
+        std::memcpy(record.data.data() + offset, bindings.getHostBuffer(o.second), bytes);
+        record.outputs.push_back({o.first, bindings.getDataType(o.second), context.getBindingDimensions(o.second),
+            offset, bytes});
+        offset += bytes;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.emplace_back(std::move(record));
+    }
+    mCondition.notify_one();
+    return true;
+}
+
+size_t OutputRecorder::getRecorded() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mWritten.size() + mQueue.size();
+}
+
+size_t OutputRecorder::getDropped() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mDropped;
+}
+
+void OutputRecorder::write()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this] { return mStop || !mQueue.empty(); });
+        if (mQueue.empty())
+        {
+            return;
+        }
+        Record record = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+
+        mFile.write(record.data.data(), record.data.size());
+        for (auto& o : record.outputs)
+        {
+            o.offset += mOffset;
+        }
+        mOffset += record.data.size();
+        const size_t size = record.data.size();
+        record.data = std::vector<char>();
+
+        lock.lock();
+        mQueuedBytes -= size;
+        mWritten.emplace_back(std::move(record));
+    }
+}
+
+void OutputRecorder::writeDescription()
+{
+    std::ofstream os(mPrefix + ".json", std::ofstream::trunc);
+    os << "[" << std::endl;
+    for (size_t r = 0; r < mWritten.size(); ++r)
+    {
+        const auto& record = mWritten[r];
+        os << (r ? ", " : "  ") << "{ \"stream\" : " << record.stream << ", \"time\" : " << record.timeMs
+           << ", \"outputs\" : [";
+        for (size_t o = 0; o < record.outputs.size(); ++o)
+        {
+            const auto& output = record.outputs[o];
+            os << (o ? ", " : " ") << "{ \"name\" : \"" << output.name << "\", \"type\" : \"" << typeName(output.type)
+               << "\", \"dimensions\" : [";
+            for (int d = 0; d < output.dims.nbDims; ++d)
+            {
+                os << (d ? ", " : "") << output.dims.d[d];
+            }
+            os << "], \"offset\" : " << output.offset << ", \"size\" : " << output.size << " }";
+        }
+        os << " ] }" << std::endl;
+    }
+    os << "]" << std::endl;
+}
+
+} // namespace sample
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_OUTPUT_RECORDER_H
+#define TRT_SAMPLE_OUTPUT_RECORDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+class Bindings;
+
+//!
+//! \class OutputRecorder
+//! \brief Records the outputs of every inference in binary, written by a background thread
+//!
+//! The inference threads copy the host outputs of each inference into a queue, the writer thread appends them raw to
+//! <prefix>.bin. Once stopped, <prefix>.json describes each record: its stream, its time and, for each output, its
+//! name, type, dimensions, and offset and size in the binary file. A record that does not fit in the queue is dropped
+//! rather than delaying the inference thread, and counted.
+//!
+class OutputRecorder
+{
+public:
+    //!
+    //! \param queueBytes The bytes of outputs the queue holds at most before records are dropped
+    //!
+    OutputRecorder(const std::string& prefix, size_t queueBytes);
+
+    //!
+    //! \brief Write the queued records and the description of all of them
+    //!
+    ~OutputRecorder();
+
+    OutputRecorder(const OutputRecorder&) = delete;
+    OutputRecorder& operator=(const OutputRecorder&) = delete;
+
+    //!
+    //! \brief Queue the host outputs of an inference, the dimensions are those of the context at the time of the call
+    //!
+    //! \param timeMs The time of the inference, such as its compute start in the trace
+    //!
+    //! \return False if the record was dropped
+    //!
+    bool record(const nvinfer1::IExecutionContext& context, const Bindings& bindings, int stream, float timeMs);
+
+    size_t getRecorded() const;
+
+    size_t getDropped() const;
+
+private:
+    struct Output
+    {
+        std::string name;
+        nvinfer1::DataType type;
+        nvinfer1::Dims dims;
+        uint64_t offset; // In the binary file
+        uint64_t size;
+    };
+
+    struct Record
+    {
+        int stream;
+        float timeMs;
+        std::vector<Output> outputs;
+        std::vector<char> data;
+    };
+
+    void write();
+
+    void writeDescription();
+
+    std::string mPrefix;
+    size_t mQueueBytes{0};
+    std::ofstream mFile;
+    bool mOpen{false};
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Record> mQueue;
+    size_t mQueuedBytes{0};
+    size_t mDropped{0};
+    bool mStop{false};
+
+    std::vector<Record> mWritten; // Written records, without their data
+    uint64_t mOffset{0};
+    std::thread mWriter;
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_OUTPUT_RECORDER_H
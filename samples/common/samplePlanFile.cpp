@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+
+#include <cuda_runtime_api.h>
+#ifndef _MSC_VER
+#include <dlfcn.h>
+#endif
+
+#include "logger.h"
+#include "samplePlanFile.h"
+#include "sampleOptions.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+namespace
+{
+
+constexpr char kPLAN_MAGIC[8]{'T', 'R', 'T', 'P', 'L', 'A', 'N', 'Z'};
+constexpr uint32_t kPLAN_VERSION{1};
+constexpr int kZ_OK{0};
+
+struct PlanHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t chunkSize;
+    uint64_t planSize;
+    uint32_t checksum; //!< CRC-32 of the plan
+    uint32_t metadataSize;
+};
+
+static_assert(sizeof(PlanHeader) == 32, "The plan header has no padding");
+
+//!
+//! \struct Zlib
+//! \brief The part of the zlib API used by the plan files, declared here since zlib is loaded at run time
+//!
+struct Zlib
+{
+    using Bytes = unsigned char*;
+    using ConstBytes = const unsigned char*;
+
+    int (*compress2)(Bytes, unsigned long*, ConstBytes, unsigned long, int){nullptr};
+    int (*uncompress)(Bytes, unsigned long*, ConstBytes, unsigned long){nullptr};
+    unsigned long (*compressBound)(unsigned long){nullptr};
+    unsigned long (*crc32)(unsigned long, ConstBytes, unsigned int){nullptr};
+
+    bool loaded{false};
+
+    Zlib()
+    {
+#ifndef _MSC_VER
+        void* library = dlopen("libz.so.1", RTLD_NOW);
+        loaded = library && load(library, "compress2", compress2) && load(library, "uncompress", uncompress)
+            && load(library, "compressBound", compressBound) && load(library, "crc32", crc32);
+#endif
+    }
+
+    //! CRC-32 of a buffer of any size
+    uint32_t checksum(const void* data, size_t size) const
+    {
+        unsigned long crc = crc32(0, nullptr, 0);
+        const auto* bytes = static_cast<ConstBytes>(data);
+        for (size_t offset = 0; offset < size; offset += kPLAN_CHUNK_SIZE)
+        {
+            crc = crc32(crc, bytes + offset, static_cast<unsigned int>(std::min(size - offset, kPLAN_CHUNK_SIZE)));
+        }
+        return static_cast<uint32_t>(crc);
+    }
+
+private:
+#ifndef _MSC_VER
+    template <typename T>
+    static bool load(void* library, const char* name, T& symbol)
+    {
+        symbol = reinterpret_cast<T>(dlsym(library, name));
+        return symbol != nullptr;
+    }
+#endif
+};
+
+//!
+//! \return The functions of zlib, loaded at the first call, or nullptr if the library cannot be loaded
+//!
+const Zlib* getZlib(std::ostream& err)
+{
+    static const Zlib zlib;
+    if (!zlib.loaded)
+    {
+        err << "Compressed plans require zlib, libz.so.1 could not be loaded" << std::endl;
+        return nullptr;
+    }
+    return &zlib;
+}
+
+} // namespace
+
+bool isCompressedPlan(const void* data, size_t size)
+{
+    return size >= sizeof(PlanHeader) && !std::memcmp(data, kPLAN_MAGIC, sizeof(kPLAN_MAGIC));
+}
+
+std::string planMetadata(const nvinfer1::ICudaEngine& engine)
+{
+    std::ostringstream metadata;
+    metadata << "TensorRT: " << NV_TENSORRT_MAJOR << "." << NV_TENSORRT_MINOR << "." << NV_TENSORRT_PATCH << std::endl;
+    int device{0};
+    cudaDeviceProp properties{};
+    if (cudaGetDevice(&device) == cudaSuccess && cudaGetDeviceProperties(&properties, device) == cudaSuccess)
+    {
+        metadata << "Device: " << properties.name << " (compute capability " << properties.major << "."
+                 << properties.minor << ")" << std::endl;
+    }
+    const std::time_t now = std::time(nullptr);
+    char created[32]{};
+    std::strftime(created, sizeof(created), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    metadata << "Created: " << created << std::endl;
+    metadata << "Batch: " << (engine.hasImplicitBatchDimension() ? "implicit, max " : "explicit")
+             << (engine.hasImplicitBatchDimension() ? std::to_string(engine.getMaxBatchSize()) : "") << std::endl;
+    metadata << "Optimization profiles: " << engine.getNbOptimizationProfiles() << std::endl;
+    const int bindingsInProfile = engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+    for (int b = 0; b < bindingsInProfile; ++b)
+    {
+        metadata << (engine.bindingIsInput(b) ? "Input: " : "Output: ") << engine.getBindingName(b) << " "
+                 << engine.getBindingDimensions(b) << " " << engine.getBindingDataType(b) << std::endl;
+    }
+    return metadata.str();
+}
+
+bool writeCompressedPlan(const void* plan, size_t size, int level, const std::string& metadata, std::ostream& file,
+    std::ostream& err)
+{
+    const Zlib* zlib = getZlib(err);
+    if (!zlib)
+    {
+        return false;
+    }
+    PlanHeader header{};
+    std::memcpy(header.magic, kPLAN_MAGIC, sizeof(kPLAN_MAGIC));
+    header.version = kPLAN_VERSION;
+    header.chunkSize = static_cast<uint32_t>(kPLAN_CHUNK_SIZE);
+    header.planSize = size;
+    header.checksum = zlib->checksum(plan, size);
+    header.metadataSize = static_cast<uint32_t>(metadata.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(metadata.data(), metadata.size());
+
+    const auto* bytes = static_cast<const unsigned char*>(plan);
+    std::vector<unsigned char> chunk(zlib->compressBound(kPLAN_CHUNK_SIZE));
+    size_t compressed{0};
+    for (size_t offset = 0; offset < size; offset += kPLAN_CHUNK_SIZE)
+    {
+        unsigned long chunkSize = chunk.size();
+        if (zlib->compress2(chunk.data(), &chunkSize, bytes + offset, std::min(size - offset, kPLAN_CHUNK_SIZE), level)
+            != kZ_OK)
+        {
+            err << "Plan compression failed" << std::endl;
+            return false;
+        }
+        const uint32_t chunkBytes = static_cast<uint32_t>(chunkSize);
+        file.write(reinterpret_cast<const char*>(&chunkBytes), sizeof(chunkBytes));
+        file.write(reinterpret_cast<const char*>(chunk.data()), chunkSize);
+        compressed += sizeof(chunkBytes) + chunkSize;
+    }
+    if (!file)
+    {
+        err << "Could not write the compressed plan" << std::endl;
+        return false;
+    }
+    gLogInfo << "Plan compressed from " << size << " to " << sizeof(header) + metadata.size() + compressed
+             << " bytes" << std::endl;
+    return true;
+}
+
+bool readCompressedPlan(
+    const void* data, size_t size, std::vector<char>& plan, std::string& metadata, std::ostream& err)
+{
+    const Zlib* zlib = getZlib(err);
+    if (!zlib)
+    {
+        return false;
+    }
+    if (!isCompressedPlan(data, size))
+    {
+        err << "Not a compressed plan" << std::endl;
+        return false;
+    }
+    PlanHeader header{};
+    std::memcpy(&header, data, sizeof(header));
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    size_t offset = sizeof(header);
+    if (header.version != kPLAN_VERSION || !header.chunkSize || size - offset < header.metadataSize)
+    {
+        err << "Unsupported compressed plan version " << header.version << " or truncated header" << std::endl;
+        return false;
+    }
+    metadata.assign(reinterpret_cast<const char*>(bytes + offset), header.metadataSize);
+    offset += header.metadataSize;
+
+    plan.resize(header.planSize);
+    auto* planBytes = reinterpret_cast<unsigned char*>(plan.data());
+    for (size_t planOffset = 0; planOffset < plan.size(); planOffset += header.chunkSize)
+    {
+        uint32_t chunkBytes{0};
+        if (size - offset < sizeof(chunkBytes))
+        {
+            err << "Truncated compressed plan" << std::endl;
+            return false;
+        }
+        std::memcpy(&chunkBytes, bytes + offset, sizeof(chunkBytes));
+        offset += sizeof(chunkBytes);
+        const size_t expected = std::min(plan.size() - planOffset, static_cast<size_t>(header.chunkSize));
+        unsigned long chunkSize = expected;
+        if (size - offset < chunkBytes
+            || zlib->uncompress(planBytes + planOffset, &chunkSize, bytes + offset, chunkBytes) != kZ_OK
+            || chunkSize != expected)
+        {
+            err << "Corrupted compressed plan, chunk at plan offset " << planOffset << " does not decompress"
+                << std::endl;
+            return false;
+        }
+        offset += chunkBytes;
+    }
+    if (zlib->checksum(plan.data(), plan.size()) != header.checksum)
+    {
+        err << "Corrupted compressed plan, the checksum of the plan does not match" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace sample
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_PLAN_FILE_H
+#define TRT_SAMPLE_PLAN_FILE_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+//!
+//! Compressed plan files start with a header giving the size and CRC-32 of the plan, the size of its chunks and of a
+//! text of metadata, which follows the header. The chunks follow, each compressed with zlib and preceded by its
+//! compressed size, so that they decompress one after the other into the buffer of the plan as the file is read.
+//! zlib is loaded at run time, from libz.so.1.
+//!
+constexpr size_t kPLAN_CHUNK_SIZE{4 << 20};
+
+//!
+//! \return True if the data starts with the header of a compressed plan
+//!
+bool isCompressedPlan(const void* data, size_t size);
+
+//!
+//! \brief Describe an engine for the metadata of its compressed plan: TensorRT version, device, time and bindings
+//!
+std::string planMetadata(const nvinfer1::ICudaEngine& engine);
+
+//!
+//! \brief Write a plan compressed in chunks
+//!
+//! \param level The zlib compression level, from 1, the fastest, to 9, the smallest
+//!
+//! \return False if zlib cannot be loaded or the file cannot be written
+//!
+bool writeCompressedPlan(const void* plan, size_t size, int level, const std::string& metadata, std::ostream& file,
+    std::ostream& err);
+
+//!
+//! \brief Decompress a compressed plan chunk by chunk into plan and check its checksum
+//!
+//! \return False if zlib cannot be loaded, the data is truncated or corrupted, or the checksum does not match
+//!
+bool readCompressedPlan(
+    const void* data, size_t size, std::vector<char>& plan, std::string& metadata, std::ostream& err);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_PLAN_FILE_H
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "sampleProfiles.h"
+
+namespace sample
+{
+
+namespace
+{
+
+double shapesVolume(const InputShapes& shapes)
+{
+    double total{0};
+    for (const auto& s : shapes)
+    {
+        double v{1};
+        for (int d = 0; d < s.second.nbDims; ++d)
+        {
+            v *= s.second.d[d];
+        }
+        total += v;
+    }
+    return total;
+}
+
+bool sameShapes(const InputShapes& a, const InputShapes& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (const auto& s : a)
+    {
+        const auto other = b.find(s.first);
+        if (other == b.end() || other->second.nbDims != s.second.nbDims
+            || !std::equal(s.second.d, s.second.d + s.second.nbDims, other->second.d))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! The smallest, or largest, of each dimension of two sets of shapes of the same inputs
+InputShapes combine(const InputShapes& a, const InputShapes& b, bool largest)
+{
+    InputShapes combined{a};
+    for (auto& s : combined)
+    {
+        const auto& other = b.at(s.first);
+        for (int d = 0; d < s.second.nbDims; ++d)
+        {
+            s.second.d[d] = largest ? std::max(s.second.d[d], other.d[d]) : std::min(s.second.d[d], other.d[d]);
+        }
+    }
+    return combined;
+}
+
+} // namespace
+
+std::vector<ShapeProfile> chooseProfiles(const ShapeHistogram& histogram, int nbProfiles, double& padding)
+{
+    // Equal shapes merged, ordered by volume
+    ShapeHistogram points;
+    for (const auto& entry : histogram)
+    {
+        const auto same = std::find_if(points.begin(), points.end(),
+            [&entry](const ShapeHistogram::value_type& p) { return sameShapes(p.first, entry.first); });
+        if (same == points.end())
+        {
+            points.push_back(entry);
+        }
+        else
+        {
+            same->second += entry.second;
+        }
+    }
+    std::sort(points.begin(), points.end(),
+        [](const ShapeHistogram::value_type& a, const ShapeHistogram::value_type& b) {
+            return shapesVolume(a.first) < shapesVolume(b.first);
+        });
+    padding = 0;
+    const int n = static_cast<int>(points.size());
+    if (!n)
+    {
+        return {};
+    }
+    const int groups = std::max(std::min(nbProfiles, n), 1);
+
+    // cost[i][j] is the padding of the requests of shapes i to j in one profile
+    std::vector<double> volumes;
+    for (const auto& p : points)
+    {
+        volumes.push_back(shapesVolume(p.first));
+    }
+    std::vector<std::vector<double>> cost(n, std::vector<double>(n, 0));
+    for (int i = 0; i < n; ++i)
+    {
+        InputShapes max{points[i].first};
+        double weight{0};
+        double volume{0};
+        for (int j = i; j < n; ++j)
+        {
+            max = combine(max, points[j].first, true);
+            weight += points[j].second;
+            volume += points[j].second * volumes[j];
+            cost[i][j] = weight * shapesVolume(max) - volume;
+        }
+    }
+
+    // best[g][j] is the least padding of shapes 0 to j in g + 1 profiles, the last one starting at start[g][j]
+    constexpr double kINFINITE{std::numeric_limits<double>::infinity()};
+    std::vector<std::vector<double>> best(groups, std::vector<double>(n, kINFINITE));
+    std::vector<std::vector<int>> start(groups, std::vector<int>(n, 0));
+    best[0] = cost[0];
+    for (int g = 1; g < groups; ++g)
+    {
+        for (int j = g; j < n; ++j)
+        {
+            for (int i = g; i <= j; ++i)
+            {
+                const double c = best[g - 1][i - 1] + cost[i][j];
+                if (c < best[g][j])
+                {
+                    best[g][j] = c;
+                    start[g][j] = i;
+                }
+            }
+        }
+    }
+
+    double total{0};
+    for (int k = 0; k < n; ++k)
+    {
+        total += points[k].second * volumes[k];
+    }
+    padding = total > 0 ? best[groups - 1][n - 1] / total : 0;
+
+    std::vector<ShapeProfile> profiles(groups);
+    for (int g = groups - 1, j = n - 1; g >= 0; j = start[g][j] - 1, --g)
+    {
+        const int i = start[g][j];
+        InputShapes min{points[i].first};
+        InputShapes max{points[i].first};
+        int opt{i};
+        for (int k = i; k <= j; ++k)
+        {
+            min = combine(min, points[k].first, false);
+            max = combine(max, points[k].first, true);
+            opt = points[k].second > points[opt].second ? k : opt;
+        }
+        for (const auto& s : min)
+        {
+            auto& range = profiles[g][s.first];
+            range[static_cast<size_t>(nvinfer1::OptProfileSelector::kMIN)] = s.second;
+            range[static_cast<size_t>(nvinfer1::OptProfileSelector::kOPT)] = points[opt].first.at(s.first);
+            range[static_cast<size_t>(nvinfer1::OptProfileSelector::kMAX)] = max.at(s.first);
+        }
+    }
+    return profiles;
+}
+
+ProfileRouter::ProfileRouter(const nvinfer1::ICudaEngine& engine)
+{
+    const int nbProfiles = std::max(engine.getNbOptimizationProfiles(), 1);
+    const int bindingsInProfile = engine.getNbBindings() / nbProfiles;
+    mProfiles.resize(nbProfiles);
+    for (int p = 0; p < nbProfiles; ++p)
+    {
+        for (int b = 0; b < bindingsInProfile; ++b)
+        {
+            if (!engine.bindingIsInput(b) || engine.isShapeBinding(b))
+            {
+                continue;
+            }
+            const int binding = b + p * bindingsInProfile;
+            mProfiles[p][engine.getBindingName(b)]
+                = Range{engine.getProfileDimensions(binding, p, nvinfer1::OptProfileSelector::kMIN),
+                    engine.getProfileDimensions(binding, p, nvinfer1::OptProfileSelector::kMAX)};
+        }
+    }
+}
+
+int ProfileRouter::route(const InputShapes& shapes) const
+{
+    int best{-1};
+    double bestVolume{std::numeric_limits<double>::infinity()};
+    for (int p = 0; p < getNbProfiles(); ++p)
+    {
+        bool fits{true};
+        for (const auto& s : shapes)
+        {
+            const auto range = mProfiles[p].find(s.first);
+            if (range == mProfiles[p].end())
+            {
+                continue;
+            }
+            const auto& dims = s.second;
+            fits = fits && dims.nbDims == range->second.min.nbDims;
+            for (int d = 0; d < dims.nbDims && fits; ++d)
+            {
+                fits = range->second.min.d[d] <= dims.d[d] && dims.d[d] <= range->second.max.d[d];
+            }
+        }
+        const double volume = maxVolume(p, shapes);
+        if (fits && volume < bestVolume)
+        {
+            best = p;
+            bestVolume = volume;
+        }
+    }
+    return best;
+}
+
+double ProfileRouter::maxVolume(int profile, const InputShapes& shapes) const
+{
+    InputShapes max;
+    for (const auto& s : shapes)
+    {
+        const auto range = mProfiles[profile].find(s.first);
+        if (range != mProfiles[profile].end())
+        {
+            max[s.first] = range->second.max;
+        }
+    }
+    return shapesVolume(max);
+}
+
+void printProfileRouting(const ProfileRouter& router, const ShapeHistogram& histogram, std::ostream& os)
+{
+    std::vector<double> requests(router.getNbProfiles(), 0);
+    std::vector<double> volumes(router.getNbProfiles(), 0);
+    std::vector<double> padded(router.getNbProfiles(), 0);
+    double total{0};
+    double unrouted{0};
+    for (const auto& entry : histogram)
+    {
+        total += entry.second;
+        const int p = router.route(entry.first);
+        if (p < 0)
+        {
+            unrouted += entry.second;
+            continue;
+        }
+        requests[p] += entry.second;
+        volumes[p] += entry.second * shapesVolume(entry.first);
+        padded[p] += entry.second * router.maxVolume(p, entry.first);
+    }
+    const auto percent = [](double part, double whole) { return whole > 0 ? 100 * part / whole : 0; };
+
+    os << "=== Profile Routing ===" << std::endl;
+    for (int p = 0; p < router.getNbProfiles(); ++p)
+    {
+        os << "Profile " << p << ": " << percent(requests[p], total) << "% of the requests, padding "
+           << percent(padded[p] - volumes[p], volumes[p]) << "%" << std::endl;
+    }
+    if (unrouted > 0)
+    {
+        os << "No profile accepts " << percent(unrouted, total) << "% of the requests" << std::endl;
+    }
+    double volume{0};
+    double paddedVolume{0};
+    for (int p = 0; p < router.getNbProfiles(); ++p)
+    {
+        volume += volumes[p];
+        paddedVolume += padded[p];
+    }
+    os << "Expected padding: " << percent(paddedVolume - volume, volume) << "% of the routed request volume"
+       << std::endl;
+}
+
+} // namespace sample
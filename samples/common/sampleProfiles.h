@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_PROFILES_H
+#define TRT_SAMPLE_PROFILES_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NvInfer.h"
+#include "sampleOptions.h"
+
+namespace sample
+{
+
+//!
+//! \brief Choose up to nbProfiles optimization profiles for the request shapes of a histogram
+//!
+//! The cost model pads each request to the max shapes of its profile, and takes its latency as proportional to the
+//! padded volume, so the profiles minimize the expected padding. The shapes are ordered by volume and split into
+//! contiguous groups by dynamic programming. Each group becomes a profile from the smallest to the largest dimensions
+//! of its shapes, tuned for its most frequent shapes.
+//!
+//! \param padding Set to the expected padding of the requests, relative to their volume
+//!
+std::vector<ShapeProfile> chooseProfiles(const ShapeHistogram& histogram, int nbProfiles, double& padding);
+
+//!
+//! \class ProfileRouter
+//! \brief Route requests to the optimization profile of an engine that runs their shapes with the least padding
+//!
+class ProfileRouter
+{
+public:
+    explicit ProfileRouter(const nvinfer1::ICudaEngine& engine);
+
+    //!
+    //! \return The profile accepting the shapes with the smallest max shapes, -1 if no profile accepts them
+    //!
+    int route(const InputShapes& shapes) const;
+
+    //!
+    //! \return The volume of the max shapes of the profile, over the inputs given in shapes
+    //!
+    double maxVolume(int profile, const InputShapes& shapes) const;
+
+    int getNbProfiles() const
+    {
+        return static_cast<int>(mProfiles.size());
+    }
+
+private:
+    struct Range
+    {
+        nvinfer1::Dims min;
+        nvinfer1::Dims max;
+    };
+
+    std::vector<std::unordered_map<std::string, Range>> mProfiles;
+};
+
+//!
+//! \brief Print the share of the requests of the histogram routed to each profile and their padding
+//!
+void printProfileRouting(const ProfileRouter& router, const ShapeHistogram& histogram, std::ostream& os);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_PROFILES_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleRandom.h"
+#include <algorithm>
+#include <cstdint>
+#include <cuda_fp16.h>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kTHREADS{256};
+constexpr int kMAX_BLOCKS{1024};
+
+// Philox4x32 multipliers and Weyl sequence key increments, from Salmon et al., "Parallel random numbers: as easy as
+// 1, 2, 3", SC 2011
+constexpr uint32_t kPHILOX_M0{0xD2511F53};
+constexpr uint32_t kPHILOX_M1{0xCD9E8D57};
+constexpr uint32_t kPHILOX_W0{0x9E3779B9};
+constexpr uint32_t kPHILOX_W1{0xBB67AE85};
+constexpr int kPHILOX_ROUNDS{10};
+
+//! Four random words out of a counter and a key
+__device__ inline uint4 philox(uint4 counter, uint2 key)
+{
+    for (int r = 0; r < kPHILOX_ROUNDS; ++r)
+    {
+        const uint32_t hi0 = __umulhi(kPHILOX_M0, counter.x);
+        const uint32_t lo0 = kPHILOX_M0 * counter.x;
+        const uint32_t hi1 = __umulhi(kPHILOX_M1, counter.z);
+        const uint32_t lo1 = kPHILOX_M1 * counter.z;
+        counter = make_uint4(hi1 ^ counter.y ^ key.x, lo1, hi0 ^ counter.w ^ key.y, lo0);
+        key.x += kPHILOX_W0;
+        key.y += kPHILOX_W1;
+    }
+    return counter;
+}
+
+//! Uniform in [-1, 1) from the 24 high bits of a word
+__device__ inline float toUniform(uint32_t bits)
+{
+    return static_cast<float>(bits >> 8) * (2.F / (1U << 24)) - 1.F;
+}
+
+template <typename T>
+__device__ inline T fromBits(uint32_t bits);
+
+template <>
+__device__ inline float fromBits<float>(uint32_t bits)
+{
+    return toUniform(bits);
+}
+
+template <>
+__device__ inline __half fromBits<__half>(uint32_t bits)
+{
+    return __float2half(toUniform(bits));
+}
+
+template <>
+__device__ inline int32_t fromBits<int32_t>(uint32_t bits)
+{
+    return static_cast<int32_t>(bits & 0xFF) - 128;
+}
+
+template <>
+__device__ inline int8_t fromBits<int8_t>(uint32_t bits)
+{
+    return static_cast<int8_t>(static_cast<int32_t>(bits & 0xFF) - 128);
+}
+
+template <>
+__device__ inline bool fromBits<bool>(uint32_t bits)
+{
+    return bits & 1U;
+}
+
+//! Grid-stride loop over groups of four values, each group uses one Philox call with its index as the counter
+template <typename T>
+__global__ void generateRandomKernel(T* buffer, size_t count, uint2 key)
+{
+    const size_t groups = (count + 3) / 4;
+    for (size_t g = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; g < groups;
+         g += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const uint4 bits = philox(make_uint4(static_cast<uint32_t>(g), static_cast<uint32_t>(g >> 32), 0, 0), key);
+        const uint32_t words[4]{bits.x, bits.y, bits.z, bits.w};
+        const size_t first = g * 4;
+        for (size_t i = 0; i < 4 && first + i < count; ++i)
+        {
+            buffer[first + i] = fromBits<T>(words[i]);
+        }
+    }
+}
+
+template <typename T>
+void launchGenerateRandom(void* buffer, size_t count, unsigned long long seed, cudaStream_t stream)
+{
+    const size_t groups = (count + 3) / 4;
+    const int blocks = static_cast<int>(std::min<size_t>((groups + kTHREADS - 1) / kTHREADS, kMAX_BLOCKS));
+    const uint2 key = make_uint2(static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32));
+    generateRandomKernel<T><<<blocks, kTHREADS, 0, stream>>>(static_cast<T*>(buffer), count, key);
+}
+
+} // namespace
+
+void generateRandom(void* buffer, nvinfer1::DataType type, size_t count, unsigned long long seed, cudaStream_t stream)
+{
+    if (!count)
+    {
+        return;
+    }
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT: launchGenerateRandom<float>(buffer, count, seed, stream); break;
+    case nvinfer1::DataType::kHALF: launchGenerateRandom<__half>(buffer, count, seed, stream); break;
+    case nvinfer1::DataType::kINT32: launchGenerateRandom<int32_t>(buffer, count, seed, stream); break;
+    case nvinfer1::DataType::kINT8: launchGenerateRandom<int8_t>(buffer, count, seed, stream); break;
+    case nvinfer1::DataType::kBOOL: launchGenerateRandom<bool>(buffer, count, seed, stream); break;
+    }
+}
+
+} // namespace sample
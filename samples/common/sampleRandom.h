@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_RANDOM_H
+#define TRT_SAMPLE_RANDOM_H
+
+#include <cstddef>
+
+#include <cuda_runtime_api.h>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+//!
+//! \brief Fill count values of type type in device memory with random values, in the ranges of the host inputs
+//!
+//! The values come from a Philox4x32-10 counter based generator keyed by seed, the value at index i only depends on i
+//! and the seed, so that a buffer is filled in parallel and the same seed gives the same values on every device and
+//! run. Floats and halves are uniform in [-1, 1), INT32 and INT8 in [-128, 127] and booleans in {0, 1}.
+//!
+void generateRandom(void* buffer, nvinfer1::DataType type, size_t count, unsigned long long seed, cudaStream_t stream);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_RANDOM_H
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+
+#include <cuda_runtime_api.h>
+
+#include "sampleReplay.h"
+
+namespace sample
+{
+
+bool ReplayTrace::setUp(
+    const std::vector<ReplayRequest>& requests, const nvinfer1::ICudaEngine& engine, std::ostream& err)
+{
+    const int bindingsInProfile = engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+    const auto findInput = [&](const std::string& name) {
+        const int b = engine.getBindingIndex(name.c_str());
+        return b >= 0 && b < bindingsInProfile && engine.bindingIsInput(b) ? b : -1;
+    };
+
+    std::unordered_map<std::string, int> files;
+    for (size_t r = 0; r < requests.size(); ++r)
+    {
+        const auto& request = requests[r];
+        Request resolved;
+        resolved.arrivalMs = request.arrivalMs;
+        for (const auto& shape : request.shapes)
+        {
+            const int b = findInput(shape.first);
+            if (b < 0 || engine.isShapeBinding(b))
+            {
+                err << "Replay request " << r << " sets the shape of " << shape.first
+                    << ", which is not an execution tensor input of the engine" << std::endl;
+                return false;
+            }
+            resolved.shapes.emplace_back(b, shape.second);
+        }
+        for (const auto& input : request.inputs)
+        {
+            const int b = findInput(input.first);
+            if (b < 0)
+            {
+                err << "Replay request " << r << " loads " << input.first << ", which is not an input of the engine"
+                    << std::endl;
+                return false;
+            }
+            auto file = files.find(input.second);
+            if (file == files.end())
+            {
+                std::ifstream is(input.second, std::ios::in | std::ios::binary | std::ios::ate);
+                if (!is)
+                {
+                    err << "Replay request " << r << " input file " << input.second << " cannot be read" << std::endl;
+                    return false;
+                }
+                const size_t size = static_cast<size_t>(is.tellg());
+                is.seekg(0);
+                mData.emplace_back(new TrtHostBuffer(std::max(size, size_t(1))));
+                is.read(static_cast<char*>(mData.back()->get()), size);
+                mSizes.push_back(size);
+                file = files.emplace(input.second, static_cast<int>(mData.size()) - 1).first;
+            }
+            resolved.inputs.push_back({b, file->second});
+        }
+        mRequests.push_back(std::move(resolved));
+    }
+    return true;
+}
+
+void ReplayTrace::getShapes(size_t request, int offset, Shapes& shapes) const
+{
+    for (const auto& shape : mRequests[request].shapes)
+    {
+        const int binding = shape.first + offset;
+        const auto current = std::find_if(shapes.begin(), shapes.end(),
+            [binding](const Shapes::value_type& s) { return s.first == binding; });
+        if (current != shapes.end())
+        {
+            current->second = shape.second;
+        }
+        else
+        {
+            shapes.emplace_back(binding, shape.second);
+        }
+    }
+}
+
+void ReplayTrace::transferInputs(size_t request, int offset, Bindings& bindings, TrtCudaStream& stream) const
+{
+    for (const auto& input : mRequests[request].inputs)
+    {
+        const int binding = input.binding + offset;
+        // The buffers are allocated for the largest shapes, a file larger than its input is truncated to them
+        const size_t size = std::min(mSizes[input.data], bindings.getHostSize(binding));
+        cudaCheck(cudaMemcpyAsync(bindings.getDeviceBuffers()[binding], mData[input.data]->get(), size,
+            cudaMemcpyHostToDevice, stream.get()));
+    }
+}
+
+} // namespace sample
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_REPLAY_H
+#define TRT_SAMPLE_REPLAY_H
+
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "NvInfer.h"
+
+#include "sampleDevice.h"
+#include "sampleOptions.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+//!
+//! \class ReplayTrace
+//! \brief The requests of a --replay trace, their inputs resolved on an engine and their input data in pinned memory
+//!
+//! Each distinct input file of the trace is read once. The data of a request is copied over the device buffer of its
+//! input after the regular input copy of the query, so that the host buffers the slots of a stream share are left
+//! untouched.
+//!
+class ReplayTrace
+{
+public:
+    //! Input bindings and their dimensions
+    using Shapes = std::vector<std::pair<int, nvinfer1::Dims>>;
+
+    //!
+    //! \return False with the reason in err if a request names an unknown input or an input file cannot be read
+    //!
+    bool setUp(const std::vector<ReplayRequest>& requests, const nvinfer1::ICudaEngine& engine, std::ostream& err);
+
+    size_t size() const
+    {
+        return mRequests.size();
+    }
+
+    float getArrival(size_t request) const
+    {
+        return mRequests[request].arrivalMs;
+    }
+
+    //!
+    //! \brief Replace the dimensions of the inputs the request sets in shapes, whose bindings are in the profile at
+    //!        offset
+    //!
+    void getShapes(size_t request, int offset, Shapes& shapes) const;
+
+    //!
+    //! \brief Copy the input data of the request to the device buffers of the bindings of the profile at offset
+    //!
+    void transferInputs(size_t request, int offset, Bindings& bindings, TrtCudaStream& stream) const;
+
+private:
+    struct Input
+    {
+        int binding; //!< In the first profile
+        int data;
+    };
+
+    struct Request
+    {
+        float arrivalMs{0};
+        Shapes shapes; //!< By binding of the first profile
+        std::vector<Input> inputs;
+    };
+
+    std::vector<Request> mRequests;
+    std::vector<std::unique_ptr<TrtHostBuffer>> mData; //!< One per distinct input file
+    std::vector<size_t> mSizes;
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_REPLAY_H
@@ -16,10 +16,18 @@
 
 #include <iostream>
 #include <iomanip>
+#include <iterator>
 #include <fstream>
 #include <utility>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <tuple>
 #include <numeric>
+#include <sstream>
+#include <unordered_map>
 
 #include "sampleOptions.h"
 #include "sampleInference.h"
@@ -68,12 +76,30 @@ float findMedian(const std::vector<InferenceTime>& timings, const T& toFloat)
     return (toFloat(timings[m-1]) + toFloat(timings[m])) / 2;
 }
 
-inline InferenceTime traceToTiming(const InferenceTrace& a)
+} // namespace
+
+std::vector<float> traceToIdleGaps(const std::vector<InferenceTrace>& trace)
 {
-    return InferenceTime((a.inEnd - a.inStart), (a.computeEnd - a.computeStart), (a.outEnd - a.outStart), (a.outEnd - a.inStart));
-};
+    std::vector<size_t> order(trace.size());
+    std::iota(order.begin(), order.end(), 0);
+    const auto cmpStreamCompute = [&trace](size_t a, size_t b) {
+        return std::make_tuple(trace[a].device, trace[a].stream, trace[a].computeStart)
+            < std::make_tuple(trace[b].device, trace[b].stream, trace[b].computeStart);
+    };
+    std::sort(order.begin(), order.end(), cmpStreamCompute);
 
-} // namespace
+    std::vector<float> gaps(trace.size(), 0);
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        const auto& previous = trace[order[i - 1]];
+        const auto& t = trace[order[i]];
+        if (previous.device == t.device && previous.stream == t.stream)
+        {
+            gaps[order[i]] = std::max(t.computeStart - previous.computeEnd, 0.0F);
+        }
+    }
+    return gaps;
+}
 
 void printProlog(int warmups, int timings, float warmupMs, float benchTimeMs, std::ostream& os)
 {
@@ -99,15 +125,12 @@ void printTiming(const std::vector<InferenceTime>& timings, int runsPerAvg, std:
                << sum.e2e / runsPerAvg << " ms)" << std::endl;
 // clang on
             count = 0;
-            sum.in = 0;
-            sum.compute = 0;
-            sum.out = 0;
-            sum.e2e = 0;
+            sum = InferenceTime();
         }
     }
 }
 
-void printEpilog(std::vector<InferenceTime> timings, float walltimeMs, float percentile, int queries, std::ostream& os)
+void printEpilog(std::vector<InferenceTime> timings, float walltimeMs, float percentile, float queries, std::ostream& os)
 {
     const InferenceTime totalTime = std::accumulate(timings.begin(), timings.end(), InferenceTime());
 
@@ -136,6 +159,20 @@ void printEpilog(std::vector<InferenceTime> timings, float walltimeMs, float per
     const float gpuMedian = findMedian(timings, getCompute);
     const float gpuPercentile = findPercentile(percentile, timings, getCompute);
 
+    const auto getEnqueue = [](const InferenceTime& t) { return t.enqueue; };
+    const auto cmpEnqueue = [](const InferenceTime& a, const InferenceTime& b) { return a.enqueue < b.enqueue; };
+    std::sort(timings.begin(), timings.end(), cmpEnqueue);
+    const float enqueueMax = timings.back().enqueue;
+    const float enqueueMedian = findMedian(timings, getEnqueue);
+    const float enqueuePercentile = findPercentile(percentile, timings, getEnqueue);
+
+    const auto getGap = [](const InferenceTime& t) { return t.gap; };
+    const auto cmpGap = [](const InferenceTime& a, const InferenceTime& b) { return a.gap < b.gap; };
+    std::sort(timings.begin(), timings.end(), cmpGap);
+    const float gapMax = timings.back().gap;
+    const float gapMedian = findMedian(timings, getGap);
+    const float gapPercentile = findPercentile(percentile, timings, getGap);
+
 // clang off
     os << "Host latency"                                                           << std::endl <<
           "min: "                << latencyMin                           << " ms "
@@ -159,169 +196,1549 @@ void printEpilog(std::vector<InferenceTime> timings, float walltimeMs, float per
           "median: "             << gpuMedian                            << " ms"  << std::endl <<
           "percentile: "         << gpuPercentile                        << " ms "
           "at "                  << percentile                           << "%"    << std::endl <<
-          "total compute time: " << totalTime.compute / 1000             << " s"   << std::endl;
+          "total compute time: " << totalTime.compute / 1000             << " s"   << std::endl <<
+          "Host enqueue"                                                           << std::endl <<
+          "max: "                << enqueueMax                           << " ms"  << std::endl <<
+          "mean: "               << totalTime.enqueue / timings.size()   << " ms"  << std::endl <<
+          "median: "             << enqueueMedian                        << " ms"  << std::endl <<
+          "percentile: "         << enqueuePercentile                    << " ms "
+          "at "                  << percentile                           << "%"    << std::endl <<
+          "GPU idle between computes of a stream"                                  << std::endl <<
+          "max: "                << gapMax                               << " ms"  << std::endl <<
+          "mean: "               << totalTime.gap / timings.size()       << " ms"  << std::endl <<
+          "median: "             << gapMedian                            << " ms"  << std::endl <<
+          "percentile: "         << gapPercentile                        << " ms "
+          "at "                  << percentile                           << "%"    << std::endl <<
+          "total idle time: "    << totalTime.gap / 1000                 << " s"   << std::endl;
+// clang on
+}
+
+void printLoadEpilog(std::vector<InferenceTime> timings, float walltimeMs, float percentile, float qps, std::ostream& os)
+{
+    const InferenceTime totalTime = std::accumulate(timings.begin(), timings.end(), InferenceTime());
+
+    const auto getResponse = [](const InferenceTime& t) { return t.response(); };
+    const auto cmpResponse = [](const InferenceTime& a, const InferenceTime& b) { return a.response() < b.response(); };
+    std::sort(timings.begin(), timings.end(), cmpResponse);
+    const float responseMin = timings.front().response();
+    const float responseMax = timings.back().response();
+    const float responseMedian = findMedian(timings, getResponse);
+    const float responsePercentile = findPercentile(percentile, timings, getResponse);
+
+    const auto getQueue = [](const InferenceTime& t) { return t.queue; };
+    const auto cmpQueue = [](const InferenceTime& a, const InferenceTime& b) { return a.queue < b.queue; };
+    std::sort(timings.begin(), timings.end(), cmpQueue);
+    const float queueMedian = findMedian(timings, getQueue);
+    const float queuePercentile = findPercentile(percentile, timings, getQueue);
+
+    const float achievedQps = timings.size() / walltimeMs * 1000;
+
+// clang off
+    os << "Latency under load (arrival to output)"                                 << std::endl <<
+          "offered load: "       << qps                                  << " qps" << std::endl <<
+          "achieved load: "      << achievedQps                          << " qps" << std::endl <<
+          "min: "                << responseMin                          << " ms"  << std::endl <<
+          "max: "                << responseMax                          << " ms"  << std::endl <<
+          "mean: "               << totalTime.response() / timings.size()
+                                                                         << " ms "
+          "(queueing "           << totalTime.queue / timings.size()     << " ms)" << std::endl <<
+          "median: "             << responseMedian                       << " ms "
+          "(queueing "           << queueMedian                          << " ms)" << std::endl <<
+          "percentile: "         << responsePercentile                   << " ms "
+          "at "                  << percentile                           << "% "
+          "(queueing "           << queuePercentile                      << " ms "
+          "at "                  << percentile                           << "%)"   << std::endl;
 // clang on
 }
 
-void printPerformanceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs, int queries, std::ostream& os)
+void printPerformanceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs, int queries, float qps, std::ostream& os)
 {
     const auto isNotWarmup = [&warmupMs](const InferenceTrace& a) { return a.computeStart >= warmupMs; };
     const auto noWarmup = std::find_if(trace.begin(), trace.end(), isNotWarmup);
     const int warmups = noWarmup - trace.begin();
     const float benchTime = trace.back().outEnd - noWarmup->inStart;
-    printProlog(warmups * queries, (trace.size() - warmups) * queries, warmupMs, benchTime, os);
+
+    // With dynamic batching every trace entry carries its own number of queries, timing samples stand for several
+    const auto addQueries = [&queries](int accumulator, const InferenceTrace& t)
+    {
+        return accumulator + (t.batch ? t.batch : queries) * t.weight;
+    };
+    const int warmupQueries = std::accumulate(trace.begin(), noWarmup, 0, addQueries);
+    const int timingQueries = std::accumulate(noWarmup, trace.end(), 0, addQueries);
+    printProlog(warmupQueries, timingQueries, warmupMs, benchTime, os);
 
     std::vector<InferenceTime> timings(trace.size() - warmups);
     std::transform(noWarmup, trace.end(), timings.begin(), traceToTiming);
+    const auto gaps = traceToIdleGaps(trace);
+    for (size_t t = 0; t < timings.size(); ++t)
+    {
+        timings[t].gap = gaps[warmups + t];
+    }
     printTiming(timings, reporting.avgs, os);
-    printEpilog(timings, benchTime, reporting.percentile, queries, os);
+    printEpilog(timings, benchTime, reporting.percentile, static_cast<float>(timingQueries) / timings.size(), os);
+    if (qps)
+    {
+        printLoadEpilog(timings, benchTime, reporting.percentile, qps, os);
+    }
 }
 
-//! Printed format:
-//! [ value, ...]
-//! value ::= { "start in" : time, "end in" : time, "start compute" : time, "end compute" : time, "start out" : time,
-//!             "in" : time, "compute" : time, "out" : time, "latency" : time, "end to end" : time}
-//!
-void exportJSONTrace(const std::vector<InferenceTrace>& trace, const std::string& fileName)
+void printDeviceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs, int queries, std::ostream& os)
 {
-    std::ofstream os(fileName, std::ofstream::trunc);
-    os << "[" << std::endl;
-    const char* sep = "  ";
+    std::map<int, std::vector<InferenceTime>> timings;
+    std::map<int, std::pair<float, float>> spans;
+    std::map<int, int> deviceQueries;
     for (const auto& t : trace)
     {
-        const InferenceTime it(traceToTiming(t));
-        os << sep << "{ ";
-        sep = ", ";
+        if (t.computeStart < warmupMs)
+        {
+            continue;
+        }
+        timings[t.device].push_back(traceToTiming(t));
+        auto span = spans.emplace(t.device, std::make_pair(t.inStart, t.outEnd)).first;
+        span->second.first = std::min(span->second.first, t.inStart);
+        span->second.second = std::max(span->second.second, t.outEnd);
+        deviceQueries[t.device] += t.batch ? t.batch : queries;
+    }
+
+    const auto getLatency = [](const InferenceTime& t) { return t.latency(); };
+    const auto cmpLatency = [](const InferenceTime& a, const InferenceTime& b) { return a.latency() < b.latency(); };
+    const auto getCompute = [](const InferenceTime& t) { return t.compute; };
+    const auto cmpCompute = [](const InferenceTime& a, const InferenceTime& b) { return a.compute < b.compute; };
+    for (auto& d : timings)
+    {
+        auto& deviceTimings = d.second;
+        const InferenceTime totalTime = std::accumulate(deviceTimings.begin(), deviceTimings.end(), InferenceTime());
+        const float walltimeMs = spans[d.first].second - spans[d.first].first;
+
+        std::sort(deviceTimings.begin(), deviceTimings.end(), cmpLatency);
+        const float latencyMedian = findMedian(deviceTimings, getLatency);
+        const float latencyPercentile = findPercentile(reporting.percentile, deviceTimings, getLatency);
+        std::sort(deviceTimings.begin(), deviceTimings.end(), cmpCompute);
+        const float gpuMedian = findMedian(deviceTimings, getCompute);
+
 // clang off
-        os << "\"startInMs\" : "      << t.inStart      << sep << "\"endInMs\" : "      << t.inEnd      << sep
-           << "\"startComputeMs\" : " << t.computeStart << sep << "\"endComputeMs\" : " << t.computeEnd << sep
-           << "\"startOutMs\" : "     << t.outStart     << sep << "\"endOutMs\" : "     << t.outEnd     << sep
-           << "\"inMs\" : "           << it.in          << sep << "\"computeMs\" : "    << it.compute   << sep
-           << "\"outMs\" : "          << it.out         << sep << "\"latencyMs\" : "    << it.latency() << sep
-           << "\"endToEndMs\" : "     << it.e2e         << " }"                                         << std::endl;
+        os << "Device "              << d.first                                                << ": "
+              "throughput: "         << deviceQueries[d.first] / walltimeMs * 1000             << " qps, "
+              "host latency mean: "  << totalTime.latency() / deviceTimings.size()             << " ms, "
+              "median: "             << latencyMedian                                          << " ms, "
+              "percentile: "         << latencyPercentile << " ms at " << reporting.percentile << "%, "
+              "GPU compute mean: "   << totalTime.compute / deviceTimings.size()               << " ms, "
+              "median: "             << gpuMedian                                              << " ms"  << std::endl;
 // clang on
     }
-    os << "]" << std::endl;
 }
 
-void Profiler::reportLayerTime(const char* layerName, float timeMs)
+void printHeterogeneousReport(const std::vector<InferenceTrace>& trace, const std::vector<std::string>& names,
+    const ReportingOptions& reporting, float warmupMs, int queries, std::ostream& os)
 {
-    if (mIterator == mLayers.end())
+    std::vector<std::vector<InferenceTime>> timings(names.size());
+    std::vector<std::vector<std::pair<float, float>>> computes(names.size());
+    std::vector<int> engineQueries(names.size(), 0);
+    float start{std::numeric_limits<float>::max()};
+    float end{0};
+    for (const auto& t : trace)
     {
-        const bool first = !mLayers.empty() && mLayers.begin()->name == layerName;
-        mUpdatesCount += mLayers.empty() || first;
-        if (first)
+        if (t.computeStart < warmupMs)
         {
-            mIterator = mLayers.begin();
+            continue;
         }
-        else
+        timings[t.device].push_back(traceToTiming(t));
+        computes[t.device].emplace_back(t.computeStart, t.computeEnd);
+        engineQueries[t.device] += t.batch ? t.batch : queries;
+        start = std::min(start, t.inStart);
+        end = std::max(end, t.outEnd);
+    }
+    const float walltimeMs = std::max(end - start, std::numeric_limits<float>::min());
+    const int totalQueries = std::max(std::accumulate(engineQueries.begin(), engineQueries.end(), 0), 1);
+
+    const auto getLatency = [](const InferenceTime& t) { return t.latency(); };
+    const auto cmpLatency = [](const InferenceTime& a, const InferenceTime& b) { return a.latency() < b.latency(); };
+    os << "Combined throughput: " << totalQueries / walltimeMs * 1000 << " qps" << std::endl;
+    for (size_t e = 0; e < names.size(); ++e)
+    {
+        auto& engineTimings = timings[e];
+        if (engineTimings.empty())
         {
-            mLayers.emplace_back();
-            mLayers.back().name = layerName;
-            mIterator = mLayers.end() - 1;
+            os << names[e] << ": no inference after the warm up" << std::endl;
+            continue;
         }
-    }
+        std::sort(engineTimings.begin(), engineTimings.end(), cmpLatency);
+        const float latencyMedian = findMedian(engineTimings, getLatency);
+        const float latencyPercentile = findPercentile(reporting.percentile, engineTimings, getLatency);
 
-    mIterator->timeMs += timeMs;
-    ++mIterator;
+        // The streams of an engine overlap, the busy time is the length of the union of their computes
+        auto& intervals = computes[e];
+        std::sort(intervals.begin(), intervals.end());
+        float busyMs{0};
+        float busyEnd{intervals.front().first};
+        for (const auto& i : intervals)
+        {
+            busyMs += std::max(i.second - std::max(i.first, busyEnd), 0.0F);
+            busyEnd = std::max(busyEnd, i.second);
+        }
+
+// clang off
+        os << names[e]           << ": "
+              "throughput: "     << engineQueries[e] / walltimeMs * 1000                   << " qps ("
+                                 << engineQueries[e] * 100.0F / totalQueries               << "% of the queries), "
+              "utilization: "    << busyMs / walltimeMs * 100                              << "%, "
+              "latency median: " << latencyMedian                                          << " ms, "
+              "percentile: "     << latencyPercentile << " ms at " << reporting.percentile << "%"  << std::endl;
+// clang on
+    }
 }
 
-void Profiler::print(std::ostream& os) const
+void printStartupReport(const StartupTimes& times, std::ostream& os)
 {
-    const std::string nameHdr("Layer");
-    const std::string timeHdr("   Time (ms)");
-    const std::string avgHdr("   Avg. Time (ms)");
-    const std::string percentageHdr("   Time \%");
+    const std::vector<std::pair<const char*, float>> phases{{"CUDA context", times.cudaMs},
+        {"Plugins", times.pluginsMs}, {"Engine file", times.readMs}, {"Decompression", times.decompressMs},
+        {"Deserialization", times.deserializeMs}, {"Engine build", times.buildMs},
+        {"Execution contexts", times.contextsMs}, {"Bindings", times.bindingsMs}, {"Prewarm", times.prewarmMs},
+        {"First inference", times.firstInferenceMs}};
+    float totalMs{0};
+    for (const auto& p : phases)
+    {
+        totalMs += p.second;
+    }
+    os << "Time to first inference: " << totalMs << " ms" << std::endl;
+    for (const auto& p : phases)
+    {
+        if (p.second > 0)
+        {
+            os << "  " << std::left << std::setw(20) << p.first << std::right << p.second << " ms ("
+               << p.second / totalMs * 100 << "%)" << std::endl;
+        }
+    }
+}
 
-    const float totalTimeMs = getTotalTime();
+void DeadlineStats::merge(const DeadlineStats& other)
+{
+    if (other.classes.empty())
+    {
+        return;
+    }
+    if (classes.empty())
+    {
+        *this = other;
+        return;
+    }
+    for (size_t c = 0; c < classes.size() && c < other.classes.size(); ++c)
+    {
+        classes[c].requests += other.classes[c].requests;
+        classes[c].onTime += other.classes[c].onTime;
+        classes[c].late += other.classes[c].late;
+        classes[c].shed += other.classes[c].shed;
+    }
+    startMs = std::min(startMs, other.startMs);
+    endMs = std::max(endMs, other.endMs);
+}
 
-    const auto cmpLayer = [](const LayerProfile& a, const LayerProfile& b)
+void printDeadlineReport(const DeadlineStats& stats, std::ostream& os)
+{
+    if (stats.classes.empty())
     {
-        return a.name.size() < b.name.size();
+        return;
+    }
+    const double seconds = std::max(stats.endMs - stats.startMs, 0.) / 1000;
+    const auto rate = [seconds](unsigned long long requests) { return seconds > 0 ? requests / seconds : 0.; };
+    const auto percent = [](unsigned long long part, unsigned long long whole) {
+        return whole ? 100. * part / whole : 0.;
     };
-    const auto longestName = std::max_element(mLayers.begin(), mLayers.end(), cmpLayer);
-    const auto nameLength = std::max(longestName->name.size() + 1, nameHdr.size());
-    const auto timeLength = timeHdr.size();
-    const auto avgLength = avgHdr.size();
-    const auto percentageLength = percentageHdr.size();
-
-    os << std::endl << "=== Profile (" << mUpdatesCount << " iterations ) ===" << std::endl
-       << std::setw(nameLength) << nameHdr << timeHdr << avgHdr << percentageHdr << std::endl;
+    DeadlineStats::Class total;
+    os << "=== Deadlines (earliest deadline first) ===" << std::endl;
+    for (size_t c = 0; c < stats.classes.size(); ++c)
+    {
+        const auto& requests = stats.classes[c];
+        os << "Class " << c << " (SLA " << requests.slaMs << " ms): " << requests.requests << " requests, "
+           << percent(requests.onTime, requests.requests) << "% on time, " << percent(requests.late, requests.requests)
+           << "% late, " << percent(requests.shed, requests.requests) << "% shed, goodput " << rate(requests.onTime)
+           << " qps" << std::endl;
+        total.requests += requests.requests;
+        total.onTime += requests.onTime;
+        total.late += requests.late;
+        total.shed += requests.shed;
+    }
+    os << "Throughput: " << rate(total.onTime + total.late) << " qps completed, goodput: " << rate(total.onTime)
+       << " qps within their SLA (" << percent(total.onTime, total.requests) << "% of the requests)" << std::endl;
+}
 
-    for (const auto& p : mLayers)
+void printWaitReport(const WaitStats& stats, const std::string& mode, std::ostream& os)
+{
+    if (!stats.waits)
     {
-// clang off
-        os << std::setw(nameLength)                                             << p.name
-           << std::setw(timeLength)       << std::fixed << std::setprecision(2) << p.timeMs
-           << std::setw(avgLength)        << std::fixed << std::setprecision(2) << p.timeMs / mUpdatesCount
-           << std::setw(percentageLength) << std::fixed << std::setprecision(1) << p.timeMs / totalTimeMs * 100
-           << std::endl;
+        return;
     }
+    os << "=== Completion Waits (" << mode << ") ===" << std::endl;
+    os << "CPU: " << stats.cpuMs << " ms over " << stats.wallMs << " ms of inference, "
+       << (stats.wallMs > 0 ? stats.cpuMs / stats.wallMs : 0) << " cores" << std::endl;
+    os << "Waits: " << stats.waits << ", mean " << stats.waitMs / stats.waits << " ms";
+    if (mode == "hybrid")
     {
-        os << std::setw(nameLength)                                             << "Total"
-           << std::setw(timeLength)       << std::fixed << std::setprecision(2) << totalTimeMs
-           << std::setw(avgLength)        << std::fixed << std::setprecision(2) << totalTimeMs / mUpdatesCount
-           << std::setw(percentageLength) << std::fixed << std::setprecision(1) << 100.0
-           << std::endl;
-// clang on
+        os << ", " << stats.spunWaits * 100.0 / stats.waits << "% completed while spinning";
     }
     os << std::endl;
-
 }
 
-void Profiler::exportJSONProfile(const std::string& fileName) const
+namespace
 {
-    std::ofstream os(fileName, std::ofstream::trunc);
-    os << "[" << std::endl
-       << "  { \"count\" : " << mUpdatesCount << " }" << std::endl;
 
-    const auto totalTimeMs = getTotalTime();
+//!
+//! \struct PairedDifference
+//! \brief Means of two paired samples and the mean of their differences, with its 95% confidence interval
+//!
+struct PairedDifference
+{
+    float meanA{0};
+    float meanB{0};
+    float mean{0};
+    float interval{0};
+};
 
-    for (const auto& l : mLayers)
+PairedDifference pairedDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    PairedDifference d;
+    const size_t n = std::min(a.size(), b.size());
+    if (!n)
+    {
+        return d;
+    }
+    double sumA{0}, sumB{0}, sumD{0}, sumD2{0};
+    for (size_t i = 0; i < n; ++i)
+    {
+        sumA += a[i];
+        sumB += b[i];
+        sumD += b[i] - a[i];
+        sumD2 += static_cast<double>(b[i] - a[i]) * (b[i] - a[i]);
+    }
+    d.meanA = static_cast<float>(sumA / n);
+    d.meanB = static_cast<float>(sumB / n);
+    d.mean = static_cast<float>(sumD / n);
+    if (n > 1)
     {
+        const double variance = std::max((sumD2 - sumD * sumD / n) / (n - 1), 0.0);
+        d.interval = static_cast<float>(1.96 * std::sqrt(variance / n));
+    }
+    return d;
+}
+
+void printPairedDifference(const char* name, const char* unit, const PairedDifference& d, std::ostream& os)
+{
+    const float relative = d.meanA ? 100 * d.mean / d.meanA : 0;
+    const float relativeInterval = d.meanA ? 100 * d.interval / d.meanA : 0;
 // clang off
-        os << ", {" << " \"name\" : \""      << l.name << "\""
-                       ", \"timeMs\" : "     << l.timeMs
-           <<          ", \"averageMs\" : "  << l.timeMs / mUpdatesCount
-           <<          ", \"percentage\" : " << l.timeMs / totalTimeMs * 100
-           << " }"  << std::endl;
+    os << name            << ": "
+          "A "            << d.meanA    << " " << unit << ", "
+          "B "            << d.meanB    << " " << unit << ", "
+          "B - A "        << d.mean     << " +/- " << d.interval << " " << unit << " "
+          "("             << relative   << "% +/- " << relativeInterval << "%)" << std::endl;
 // clang on
+}
+
+} // namespace
+
+void printComparisonReport(const std::vector<InferenceTrace>& traceA, const std::vector<InferenceTrace>& traceB,
+    int queries, int streams, std::ostream& os)
+{
+    const size_t rounds = std::min(traceA.size(), traceB.size()) / std::max(streams, 1);
+    std::array<std::vector<float>, 2> latency;
+    std::array<std::vector<float>, 2> compute;
+    std::array<std::vector<float>, 2> throughput;
+    const std::array<const std::vector<InferenceTrace>*, 2> traces{{&traceA, &traceB}};
+    for (int e = 0; e < 2; ++e)
+    {
+        for (size_t r = 0; r < rounds; ++r)
+        {
+            const auto begin = traces[e]->begin() + r * streams;
+            float start = begin->inStart;
+            float end = begin->outEnd;
+            float roundQueries = 0;
+            for (auto t = begin; t != begin + streams; ++t)
+            {
+                const InferenceTime time = traceToTiming(*t);
+                latency[e].push_back(time.latency());
+                compute[e].push_back(time.compute);
+                start = std::min(start, t->inStart);
+                end = std::max(end, t->outEnd);
+                roundQueries += t->batch ? t->batch : queries;
+            }
+            throughput[e].push_back(end > start ? roundQueries / (end - start) * 1000 : 0);
+        }
     }
-    os << "]" << std::endl;
+
+    os << "=== Comparison (A: engine, B: compare engine, " << rounds << " interleaved rounds) ===" << std::endl;
+    printPairedDifference("Host latency", "ms", pairedDifference(latency[0], latency[1]), os);
+    printPairedDifference("GPU compute", "ms", pairedDifference(compute[0], compute[1]), os);
+    printPairedDifference("Throughput", "qps", pairedDifference(throughput[0], throughput[1]), os);
 }
 
-void dumpInputs(const nvinfer1::IExecutionContext& context, const Bindings& bindings, std::ostream& os)
+constexpr int LatencyHistogram::kSUB_BUCKETS;
+constexpr int LatencyHistogram::kMAX_SHIFT;
+constexpr int LatencyHistogram::kBUCKETS;
+
+int LatencyHistogram::bucketOf(uint64_t ns)
 {
-    os << "Input Tensors:" << std::endl;
-    bindings.dumpInputs(context, os);
+    if (ns < kSUB_BUCKETS)
+    {
+        return static_cast<int>(ns);
+    }
+    int msb = 7;
+    while (msb < 63 && ns >> (msb + 1))
+    {
+        ++msb;
+    }
+    // Values with the same msb fall in kSUB_BUCKETS / 2 buckets of their 7 leading bits
+    const int shift = msb - 6;
+    if (shift > kMAX_SHIFT)
+    {
+        return kBUCKETS - 1;
+    }
+    const int sub = static_cast<int>(ns >> shift) - kSUB_BUCKETS / 2;
+    return kSUB_BUCKETS + (shift - 1) * kSUB_BUCKETS / 2 + sub;
 }
 
-void dumpOutputs(const nvinfer1::IExecutionContext& context, const Bindings& bindings, std::ostream& os)
+uint64_t LatencyHistogram::highestOf(int bucket)
 {
-    os << "Output Tensors:" << std::endl;
-    bindings.dumpOutputs(context, os);
+    if (bucket < kSUB_BUCKETS)
+    {
+        return bucket;
+    }
+    const int shift = (bucket - kSUB_BUCKETS) / (kSUB_BUCKETS / 2) + 1;
+    const uint64_t sub = (bucket - kSUB_BUCKETS) % (kSUB_BUCKETS / 2) + kSUB_BUCKETS / 2;
+    return ((sub + 1) << shift) - 1;
 }
 
-void exportJSONOutput(const nvinfer1::IExecutionContext& context, const Bindings& bindings, const std::string& fileName)
+void LatencyHistogram::merge(const LatencyHistogram& other)
 {
-    std::ofstream os(fileName, std::ofstream::trunc);
-    std::string sep ="  ";
-    const auto output = bindings.getOutputBindings();
-    os << "[" << std::endl;
-    for (const auto& binding : output)
+    for (int b = 0; b < kBUCKETS; ++b)
+    {
+        mBuckets[b] += other.mBuckets[b];
+    }
+    mCount += other.mCount;
+    mSumNs += other.mSumNs;
+    mMinNs = std::min(mMinNs, other.mMinNs);
+    mMaxNs = std::max(mMaxNs, other.mMaxNs);
+}
+
+float LatencyHistogram::percentileMs(float percentage) const
+{
+    if (!mCount)
+    {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(percentage / 100 * mCount)), 1);
+    uint64_t below = 0;
+    for (int b = 0; b < kBUCKETS; ++b)
+    {
+        below += mBuckets[b];
+        if (below >= rank)
+        {
+            return static_cast<float>(std::min(highestOf(b), mMaxNs) / 1e6);
+        }
+    }
+    return maxMs();
+}
+
+void LatencyHistogram::serialize(std::ostream& os, const std::string& name) const
+{
+    const auto nonEmpty = std::count_if(mBuckets.begin(), mBuckets.end(), [](uint64_t c) { return c != 0; });
+    os << name << " " << mCount << " " << mSumNs << " " << mMinNs << " " << mMaxNs << " " << nonEmpty << std::endl;
+    for (int b = 0; b < kBUCKETS; ++b)
+    {
+        if (mBuckets[b])
+        {
+            os << b << " " << mBuckets[b] << std::endl;
+        }
+    }
+}
+
+bool LatencyHistogram::deserialize(std::istream& is, uint64_t count, uint64_t sumNs, uint64_t minNs, uint64_t maxNs, int buckets)
+{
+    LatencyHistogram other;
+    for (int b = 0; b < buckets; ++b)
+    {
+        int bucket{0};
+        uint64_t bucketCount{0};
+        if (!(is >> bucket >> bucketCount) || bucket < 0 || bucket >= kBUCKETS)
+        {
+            return false;
+        }
+        other.mBuckets[bucket] += bucketCount;
+    }
+    other.mCount = count;
+    other.mSumNs = sumNs;
+    other.mMinNs = minNs;
+    other.mMaxNs = maxNs;
+    merge(other);
+    return true;
+}
+
+namespace
+{
+
+const char* const kHISTOGRAMS_HEADER{"# trtexec latency histograms, nanoseconds, 128 sub-buckets"};
+
+//! The histograms in the order of the export, with their names
+std::array<std::pair<const char*, LatencyHistogram*>, 4> namedHistograms(LatencyHistograms& histograms)
+{
+    return {{{"h2d", &histograms.in}, {"compute", &histograms.compute}, {"d2h", &histograms.out},
+        {"e2e", &histograms.e2e}}};
+}
+
+} // namespace
+
+LatencyHistograms traceToHistograms(const std::vector<InferenceTrace>& trace, float warmupMs)
+{
+    LatencyHistograms histograms;
+    for (const auto& t : trace)
+    {
+        if (t.computeStart >= warmupMs)
+        {
+            histograms.record(traceToTiming(t));
+        }
+    }
+    return histograms;
+}
+
+void printHistograms(const LatencyHistograms& histograms, std::ostream& os)
+{
+    const auto print = [&os](const char* name, const LatencyHistogram& h)
     {
 // clang off
-        os << sep << "{ \"name\" : \"" << binding.first << "\"" << std::endl;
-        sep = ", ";
-        os << "  " << sep << "\"dimensions\" : \"";
-        bindings.dumpBindingDimensions(binding.second, context, os);
-        os << "\"" << std::endl;
-        os << "  " << sep << "\"values\" : [ ";
-        bindings.dumpBindingValues(binding.second, os, sep);
-        os << " ]" << std::endl << "  }"  << std::endl;
+        os << name                                                           << ": "
+              "p50 "   << h.percentileMs(50)   << " ms, p90 "   << h.percentileMs(90) << " ms, "
+              "p99 "   << h.percentileMs(99)   << " ms, p99.9 " << h.percentileMs(99.9F) << " ms, "
+              "max "   << h.maxMs()            << " ms, mean "  << h.meanMs()            << " ms "
+              "("      << h.count()            << " samples)"                                    << std::endl;
 // clang on
+    };
+    os << "Latency histograms" << std::endl;
+    print("H2D", histograms.in);
+    print("GPU Compute", histograms.compute);
+    print("D2H", histograms.out);
+    print("End to end", histograms.e2e);
+}
+
+void writeHistograms(const LatencyHistograms& histograms, std::ostream& os)
+{
+    os << kHISTOGRAMS_HEADER << std::endl;
+    for (const auto& h : namedHistograms(const_cast<LatencyHistograms&>(histograms)))
+    {
+        h.second->serialize(os, h.first);
     }
-    os << "]" << std::endl;
+}
+
+bool readHistograms(std::istream& is, LatencyHistograms& histograms)
+{
+    std::string header;
+    if (!std::getline(is, header) || header != kHISTOGRAMS_HEADER)
+    {
+        return false;
+    }
+    std::string name;
+    uint64_t count{0}, sumNs{0}, minNs{0}, maxNs{0};
+    int buckets{0};
+    const auto named = namedHistograms(histograms);
+    while (is >> name >> count >> sumNs >> minNs >> maxNs >> buckets)
+    {
+        const auto h = std::find_if(named.begin(), named.end(),
+            [&name](const std::pair<const char*, LatencyHistogram*>& n) { return name == n.first; });
+        if (h == named.end() || !h->second->deserialize(is, count, sumNs, minNs, maxNs, buckets))
+        {
+            return false;
+        }
+    }
+    return is.eof();
+}
+
+void exportHistograms(const LatencyHistograms& histograms, const std::string& fileName)
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    writeHistograms(histograms, os);
+}
+
+bool importHistograms(const std::string& fileName, LatencyHistograms& histograms)
+{
+    std::ifstream is(fileName);
+    return readHistograms(is, histograms);
+}
+
+void printStageReport(const std::vector<InferenceTrace>& trace, float warmupMs, int depth, std::ostream& os)
+{
+    // Busy times of the H2D, compute and D2H stages and of the queries in flight, with the span of each stream
+    struct StageTimes
+    {
+        std::array<float, 4> busy{};
+        float start{std::numeric_limits<float>::max()};
+        float end{0};
+    };
+    std::map<std::pair<int, int>, StageTimes> streams;
+    for (const auto& t : trace)
+    {
+        if (t.computeStart < warmupMs)
+        {
+            continue;
+        }
+        auto& times = streams[std::make_pair(t.device, t.stream)];
+        times.busy[0] += t.inEnd - t.inStart;
+        times.busy[1] += t.computeEnd - t.computeStart;
+        times.busy[2] += t.outEnd - t.outStart;
+        times.busy[3] += t.outEnd - t.inStart;
+        times.start = std::min(times.start, t.inStart);
+        times.end = std::max(times.end, t.outEnd);
+    }
+
+    const bool devices = !streams.empty() && streams.begin()->first.first != streams.rbegin()->first.first;
+    os << "Stage occupancy (pipeline depth " << depth << ")" << std::endl;
+    for (const auto& s : streams)
+    {
+        const auto& times = s.second;
+        const float spanMs = std::max(times.end - times.start, std::numeric_limits<float>::min());
+        if (devices)
+        {
+            os << "Device " << s.first.first << " ";
+        }
+// clang off
+        os << "Stream "        << s.first.second                 << ": "
+              "H2D "           << times.busy[0] / spanMs * 100   << "%, "
+              "compute "       << times.busy[1] / spanMs * 100   << "%, "
+              "D2H "           << times.busy[2] / spanMs * 100   << "% busy, "
+              "queries in flight: " << times.busy[3] / spanMs    << std::endl;
+// clang on
+    }
+}
+
+namespace
+{
+
+using Interval = std::pair<float, float>;
+
+//! Sort and merge the intervals, dropping the empty ones
+std::vector<Interval> mergeIntervals(std::vector<Interval> intervals)
+{
+    std::sort(intervals.begin(), intervals.end());
+    std::vector<Interval> merged;
+    for (const auto& i : intervals)
+    {
+        if (i.second <= i.first)
+        {
+            continue;
+        }
+        if (merged.empty() || i.first > merged.back().second)
+        {
+            merged.push_back(i);
+        }
+        else
+        {
+            merged.back().second = std::max(merged.back().second, i.second);
+        }
+    }
+    return merged;
+}
+
+float intervalsLength(const std::vector<Interval>& intervals)
+{
+    return std::accumulate(intervals.begin(), intervals.end(), 0.F,
+        [](float sum, const Interval& i) { return sum + i.second - i.first; });
+}
+
+//! Length of the intersection of two merged interval lists
+float intervalsOverlap(const std::vector<Interval>& a, const std::vector<Interval>& b)
+{
+    float overlap{0};
+    for (size_t i = 0, j = 0; i < a.size() && j < b.size();)
+    {
+        overlap += std::max(0.F, std::min(a[i].second, b[j].second) - std::max(a[i].first, b[j].first));
+        a[i].second < b[j].second ? ++i : ++j;
+    }
+    return overlap;
+}
+
+} // namespace
+
+void printCopyReport(const std::vector<InferenceTrace>& trace, float warmupMs, std::ostream& os)
+{
+    std::map<int, std::vector<const InferenceTrace*>> devices;
+    for (const auto& t : trace)
+    {
+        if (t.computeStart >= warmupMs)
+        {
+            devices[t.device].push_back(&t);
+        }
+    }
+
+    os << "=== Copies ===" << std::endl;
+    for (auto& d : devices)
+    {
+        auto& queries = d.second;
+        float start{std::numeric_limits<float>::max()};
+        float end{0};
+        std::vector<Interval> h2d;
+        std::vector<Interval> compute;
+        std::vector<Interval> d2h;
+        for (const auto* t : queries)
+        {
+            start = std::min(start, t->inStart);
+            end = std::max(end, t->outEnd);
+            h2d.emplace_back(t->inStart, t->inEnd);
+            compute.emplace_back(t->computeStart, t->computeEnd);
+            d2h.emplace_back(t->outStart, t->outEnd);
+        }
+        const auto computes = mergeIntervals(compute);
+        const float spanMs = std::max(end - start, std::numeric_limits<float>::min());
+
+        // Submission order, the host time of the enqueue of each query
+        std::stable_sort(queries.begin(), queries.end(),
+            [](const InferenceTrace* a, const InferenceTrace* b) { return a->enqueueStart < b->enqueueStart; });
+        const auto outOfOrder = [&queries](float InferenceTrace::*copyStart, float InferenceTrace::*copyEnd)
+        {
+            int count{0};
+            float latest{-std::numeric_limits<float>::max()};
+            for (const auto* t : queries)
+            {
+                if (t->*copyEnd <= t->*copyStart)
+                {
+                    continue;
+                }
+                count += t->*copyStart < latest;
+                latest = std::max(latest, t->*copyStart);
+            }
+            return count;
+        };
+
+        const auto print = [&](const char* name, const std::vector<Interval>& copies, int reordered)
+        {
+            const auto merged = mergeIntervals(copies);
+            const float busy = intervalsLength(merged);
+            const int count = static_cast<int>(std::count_if(
+                copies.begin(), copies.end(), [](const Interval& i) { return i.second > i.first; }));
+            os << "Device " << d.first << " " << name << ": " << count << " copies, busy " << busy / spanMs * 100
+               << "% of " << spanMs << " ms, " << (busy > 0 ? intervalsOverlap(merged, computes) / busy * 100 : 0)
+               << "% overlapped with computes, " << reordered << " ahead of an earlier query" << std::endl;
+        };
+        print("H2D", h2d, outOfOrder(&InferenceTrace::inStart, &InferenceTrace::inEnd));
+        print("D2H", d2h, outOfOrder(&InferenceTrace::outStart, &InferenceTrace::outEnd));
+    }
+}
+
+void printShapeChurnReport(const std::vector<InferenceTrace>& trace, const std::vector<std::string>& buckets,
+    float warmupMs, float percentile, std::ostream& os)
+{
+    std::vector<std::vector<InferenceTime>> timings(buckets.size());
+    size_t queries{0};
+    size_t changes{0};
+    double changeMs{0};
+    double changedEnqueueMs{0};
+    double keptEnqueueMs{0};
+    for (const auto& t : trace)
+    {
+        if (t.computeStart < warmupMs || t.shapeBucket < 0 || t.shapeBucket >= static_cast<int>(buckets.size()))
+        {
+            continue;
+        }
+        timings[t.shapeBucket].push_back(traceToTiming(t));
+        ++queries;
+        if (t.shapeChange)
+        {
+            ++changes;
+            changeMs += t.shapeMs;
+            changedEnqueueMs += timings[t.shapeBucket].back().enqueue;
+        }
+        else
+        {
+            keptEnqueueMs += timings[t.shapeBucket].back().enqueue;
+        }
+    }
+    if (!queries)
+    {
+        return;
+    }
+
+    const auto getLatency = [](const InferenceTime& t) { return t.latency(); };
+    const auto cmpLatency = [](const InferenceTime& a, const InferenceTime& b) { return a.latency() < b.latency(); };
+    os << "=== Shape Churn ===" << std::endl;
+    for (size_t b = 0; b < buckets.size(); ++b)
+    {
+        auto& bucketTimings = timings[b];
+        if (bucketTimings.empty())
+        {
+            continue;
+        }
+        const InferenceTime total = std::accumulate(bucketTimings.begin(), bucketTimings.end(), InferenceTime());
+        const float n = static_cast<float>(bucketTimings.size());
+        std::sort(bucketTimings.begin(), bucketTimings.end(), cmpLatency);
+        os << buckets[b] << ": " << bucketTimings.size() << " queries, host latency mean " << total.latency() / n
+           << " ms, percentile " << findPercentile(percentile, bucketTimings, getLatency) << " ms at " << percentile
+           << "%, GPU compute mean " << total.compute / n << " ms, enqueue mean " << total.enqueue / n << " ms"
+           << std::endl;
+    }
+    os << "Shape changes: " << changes << " of " << queries << " queries, setting the shapes took "
+       << (changes ? changeMs / changes * 1000 : 0) << " us mean" << std::endl;
+    os << "Enqueue mean: " << (changes ? changedEnqueueMs / changes : 0) << " ms after a shape change, "
+       << (queries > changes ? keptEnqueueMs / (queries - changes) : 0) << " ms with the same shapes" << std::endl;
+}
+
+void printReplayReport(const std::vector<InferenceTrace>& trace, float windowMs, float percentile, std::ostream& os)
+{
+    if (trace.empty())
+    {
+        return;
+    }
+    // The latency a request sees is from its arrival, so a burst queued behind busy streams shows in its window
+    std::map<int, std::vector<InferenceTime>> windows;
+    for (const auto& t : trace)
+    {
+        windows[static_cast<int>(t.arrival / windowMs)].push_back(traceToTiming(t));
+    }
+
+    const auto getLatency = [](const InferenceTime& t) { return t.queue + t.e2e; };
+    const auto cmpLatency = [&getLatency](const InferenceTime& a, const InferenceTime& b) {
+        return getLatency(a) < getLatency(b);
+    };
+    os << "=== Replay ===" << std::endl;
+    int worst{-1};
+    float worstMs{0};
+    for (auto& w : windows)
+    {
+        auto& timings = w.second;
+        std::sort(timings.begin(), timings.end(), cmpLatency);
+        const float n = static_cast<float>(timings.size());
+        const double total = std::accumulate(timings.begin(), timings.end(), 0.0,
+            [&getLatency](double sum, const InferenceTime& t) { return sum + getLatency(t); });
+        const float queue = std::accumulate(timings.begin(), timings.end(), 0.0F,
+            [](float sum, const InferenceTime& t) { return sum + t.queue; });
+        const float latencyPercentile = findPercentile(percentile, timings, getLatency);
+        if (latencyPercentile > worstMs)
+        {
+            worst = w.first;
+            worstMs = latencyPercentile;
+        }
+        os << "[" << w.first * windowMs << ", " << (w.first + 1) * windowMs << ") ms: " << timings.size()
+           << " requests (" << n * 1000 / windowMs << " qps), latency mean " << total / n << " ms, percentile "
+           << latencyPercentile << " ms at " << percentile << "%, max " << getLatency(timings.back())
+           << " ms, queue mean " << queue / n << " ms" << std::endl;
+    }
+    if (worst >= 0)
+    {
+        os << "Worst window: [" << worst * windowMs << ", " << (worst + 1) * windowMs << ") ms, " << worstMs
+           << " ms at " << percentile << "%" << std::endl;
+    }
+}
+
+void printConvergenceReport(const ConvergenceStats& stats, std::ostream& os)
+{
+    if (!stats.adaptiveWarmup && !stats.earlyStop)
+    {
+        return;
+    }
+    os << "=== Convergence ===" << std::endl;
+    if (stats.adaptiveWarmup)
+    {
+        os << "Warm up: " << (stats.steady ? "steady state" : "no steady state, warm up cut") << " after "
+           << stats.warmupMs << " ms and " << stats.warmupQueries << " queries" << std::endl;
+    }
+    os << "Measurement: " << stats.queries << " queries";
+    if (stats.earlyStop)
+    {
+        os << ", " << (stats.converged ? "converged" : "not converged within the duration");
+    }
+    os << std::endl;
+    os << "95% confidence half widths: mean latency " << stats.meanWidth << "%, 99th percentile "
+       << stats.percentileWidth << "%, throughput " << stats.throughputWidth << "%";
+    if (stats.earlyStop)
+    {
+        os << " (target " << stats.width << "%)";
+    }
+    os << std::endl;
+}
+
+void printBatchingReport(const std::vector<InferenceTrace>& trace, float warmupMs, int maxBatch, std::ostream& os)
+{
+    const auto isNotWarmup = [&warmupMs](const InferenceTrace& a) { return a.computeStart >= warmupMs; };
+    std::vector<int> batches;
+    for (auto t = std::find_if(trace.begin(), trace.end(), isNotWarmup); t != trace.end(); ++t)
+    {
+        batches.push_back(t->batch);
+    }
+    if (batches.empty())
+    {
+        return;
+    }
+    std::sort(batches.begin(), batches.end());
+
+    const int requests = std::accumulate(batches.begin(), batches.end(), 0);
+    const float batchMean = static_cast<float>(requests) / batches.size();
+    const int fullBatches = std::count(batches.begin(), batches.end(), maxBatch);
+    const int partialBatches = batches.size() - fullBatches;
+
+// clang off
+    os << "Dynamic batching"                                                                              << std::endl <<
+          "batches: "            << batches.size()             << " (" << requests << " requests)"        << std::endl <<
+          "batch size: min "     << batches.front()            << ", max " << batches.back()
+       << ", median "            << batches[batches.size() / 2] << ", mean " << batchMean                 << std::endl <<
+          "batch fill: "         << batchMean / maxBatch * 100 << "% of max batch " << maxBatch           << std::endl <<
+          "full batches: "       << fullBatches                << ", partial batches: " << partialBatches << std::endl;
+// clang on
+}
+
+//! Printed format:
+//! [ value, ...]
+//! value ::= { "arrival" : time, "start in" : time, "end in" : time, "start compute" : time, "end compute" : time,
+//!             "start out" : time, "end out" : time, "queue" : time, "in" : time, "compute" : time, "out" : time,
+//!             "latency" : time, "end to end" : time, "start enqueue" : time, "end enqueue" : time,
+//!             "enqueue" : time, "idle" : time}
+//!
+void exportJSONTrace(const std::vector<InferenceTrace>& trace, const std::string& fileName)
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    os << "[" << std::endl;
+    const char* sep = "  ";
+    const auto gaps = traceToIdleGaps(trace);
+    for (size_t i = 0; i < trace.size(); ++i)
+    {
+        const auto& t = trace[i];
+        const InferenceTime it(traceToTiming(t));
+        os << sep << "{ ";
+        sep = ", ";
+// clang off
+        os << "\"arrivalMs\" : "      << t.arrival      << sep << "\"queueMs\" : "      << it.queue     << sep
+           << "\"startInMs\" : "      << t.inStart      << sep << "\"endInMs\" : "      << t.inEnd      << sep
+           << "\"startComputeMs\" : " << t.computeStart << sep << "\"endComputeMs\" : " << t.computeEnd << sep
+           << "\"startOutMs\" : "     << t.outStart     << sep << "\"endOutMs\" : "     << t.outEnd     << sep
+           << "\"inMs\" : "           << it.in          << sep << "\"computeMs\" : "    << it.compute   << sep
+           << "\"outMs\" : "          << it.out         << sep << "\"latencyMs\" : "    << it.latency() << sep
+           << "\"endToEndMs\" : "     << it.e2e         << sep << "\"startEnqueueMs\" : " << t.enqueueStart << sep
+           << "\"endEnqueueMs\" : "   << t.enqueueEnd   << sep << "\"enqueueMs\" : "    << it.enqueue   << sep
+           << "\"idleMs\" : "         << gaps[i]        << " }"                                         << std::endl;
+// clang on
+    }
+    os << "]" << std::endl;
+}
+
+namespace
+{
+
+void exportJSONStats(std::ostream& os, const char* name, std::vector<InferenceTime>& timings,
+    float (*toFloat)(const InferenceTime&))
+{
+    std::sort(timings.begin(), timings.end(),
+        [toFloat](const InferenceTime& a, const InferenceTime& b) { return toFloat(a) < toFloat(b); });
+    const float total = std::accumulate(timings.begin(), timings.end(), 0.F,
+        [toFloat](float sum, const InferenceTime& t) { return sum + toFloat(t); });
+    os << "\"" << name << "\" : { \"min\" : " << toFloat(timings.front()) << ", \"mean\" : " << total / timings.size()
+       << ", \"median\" : " << findMedian(timings, toFloat) << ", \"p90\" : " << findPercentile(90, timings, toFloat)
+       << ", \"p95\" : " << findPercentile(95, timings, toFloat) << ", \"p99\" : "
+       << findPercentile(99, timings, toFloat) << ", \"max\" : " << toFloat(timings.back()) << " }";
+}
+
+} // namespace
+
+//! Printed format, on one line:
+//! { "model" : string, "queries" : count, "inferences" : count, "walltimeMs" : time, "throughputQps" : rate,
+//!   "hostLatencyMs" : stats, "gpuComputeMs" : stats, "endToEndMs" : stats, "buildMs" : time,
+//!   "deserializeMs" : time, "deviceMemoryMiB" : size }
+//! stats ::= { "min" : time, "mean" : time, "median" : time, "p90" : time, "p95" : time, "p99" : time, "max" : time }
+//!
+void exportJSONSummary(const std::string& model, const std::vector<InferenceTrace>& trace, float warmupMs, int queries,
+    const StartupTimes& startup, uint64_t deviceMemory, const std::string& fileName)
+{
+    std::vector<InferenceTime> timings;
+    int timingQueries{0};
+    float start{0};
+    float end{0};
+    for (const auto& t : trace)
+    {
+        if (t.computeStart < warmupMs)
+        {
+            continue;
+        }
+        start = timings.empty() ? t.inStart : std::min(start, t.inStart);
+        end = std::max(end, t.outEnd);
+        timings.push_back(traceToTiming(t));
+        timingQueries += (t.batch ? t.batch : queries) * t.weight;
+    }
+    std::ofstream os(fileName, std::ofstream::trunc);
+    os << "{ \"model\" : \"" << model << "\", \"queries\" : " << timingQueries
+       << ", \"inferences\" : " << timings.size() << ", \"walltimeMs\" : " << end - start << ", \"throughputQps\" : "
+       << (end > start ? timingQueries / (end - start) * 1000 : 0);
+    if (!timings.empty())
+    {
+        os << ", ";
+        exportJSONStats(os, "hostLatencyMs", timings, [](const InferenceTime& t) { return t.latency(); });
+        os << ", ";
+        exportJSONStats(os, "gpuComputeMs", timings, [](const InferenceTime& t) { return t.compute; });
+        os << ", ";
+        exportJSONStats(os, "endToEndMs", timings, [](const InferenceTime& t) { return t.e2e; });
+    }
+    os << ", \"buildMs\" : " << startup.buildMs << ", \"deserializeMs\" : " << startup.deserializeMs
+       << ", \"deviceMemoryMiB\" : " << deviceMemory / 1048576.0 << " }" << std::endl;
+}
+
+namespace
+{
+
+void exportChromeEvent(std::ostream& os, const char*& sep, const std::string& name, int pid, int tid, float startMs,
+    float endMs)
+{
+    os << sep << "{ \"name\" : \"" << name << "\", \"cat\" : \"inference\", \"ph\" : \"X\", \"pid\" : " << pid
+       << ", \"tid\" : " << tid << ", \"ts\" : " << startMs * 1000 << ", \"dur\" : " << (endMs - startMs) * 1000
+       << " }" << std::endl;
+    sep = ", ";
+}
+
+void exportChromeCounter(std::ostream& os, const char*& sep, const char* name, int pid, float timeMs,
+    const std::string& args)
+{
+    os << sep << "{ \"name\" : \"" << name << "\", \"ph\" : \"C\", \"pid\" : " << pid << ", \"ts\" : " << timeMs * 1000
+       << ", \"args\" : { " << args << " } }" << std::endl;
+    sep = ", ";
+}
+
+void exportChromeName(std::ostream& os, const char*& sep, const char* type, const std::string& name, int pid, int tid)
+{
+    os << sep << "{ \"name\" : \"" << type << "\", \"ph\" : \"M\", \"pid\" : " << pid << ", \"tid\" : " << tid
+       << ", \"args\" : { \"name\" : \"" << name << "\" } }" << std::endl;
+    sep = ", ";
+}
+
+} // namespace
+
+void exportChromeTrace(const std::vector<InferenceTrace>& trace, const Profiler* profiler, const std::string& fileName,
+    const std::vector<TelemetrySample>& telemetry)
+{
+    enum Track
+    {
+        kQUEUE,
+        kINPUT,
+        kCOMPUTE,
+        kLAYERS,
+        kOUTPUT
+    };
+
+    std::ofstream os(fileName, std::ofstream::trunc);
+    os << "{ \"displayTimeUnit\" : \"ms\", \"traceEvents\" : [" << std::endl;
+    const char* sep = "  ";
+
+    std::map<int, int> inferences; // Inferences seen so far on each stream, to match them with the profiled ones
+    for (const auto& t : trace)
+    {
+        if (inferences.emplace(t.stream, 0).second)
+        {
+            const int pid = t.stream;
+            exportChromeName(os, sep, "process_name", "Stream " + std::to_string(t.stream), pid, 0);
+            exportChromeName(os, sep, "thread_name", "Queue", pid, kQUEUE);
+            exportChromeName(os, sep, "thread_name", "H2D", pid, kINPUT);
+            exportChromeName(os, sep, "thread_name", "Compute", pid, kCOMPUTE);
+            exportChromeName(os, sep, "thread_name", "Layers", pid, kLAYERS);
+            exportChromeName(os, sep, "thread_name", "D2H", pid, kOUTPUT);
+        }
+        const int inference = inferences[t.stream]++;
+
+        if (t.arrival < t.inStart)
+        {
+            exportChromeEvent(os, sep, "queue", t.stream, kQUEUE, t.arrival, t.inStart);
+        }
+        if (t.inStart < t.inEnd)
+        {
+            exportChromeEvent(os, sep, "H2D", t.stream, kINPUT, t.inStart, t.inEnd);
+        }
+        exportChromeEvent(os, sep, "compute", t.stream, kCOMPUTE, t.computeStart, t.computeEnd);
+        exportChromeEvent(os, sep, "D2H", t.stream, kOUTPUT, t.outStart, t.outEnd);
+
+        if (profiler && t.stream < profiler->getContextCount())
+        {
+            float startMs = t.computeStart;
+            for (const auto& l : profiler->getContextLayers(t.stream))
+            {
+                if (inference < static_cast<int>(l.timesMs.size()))
+                {
+                    const float endMs = startMs + l.timesMs[inference];
+                    exportChromeEvent(os, sep, l.name, t.stream, kLAYERS, startMs, endMs);
+                    startMs = endMs;
+                }
+            }
+        }
+    }
+
+    // The telemetry processes take ids past those of the streams
+    constexpr int kTELEMETRY_PID{1 << 16};
+    std::set<int> devices;
+    for (const auto& s : telemetry)
+    {
+        const int pid = kTELEMETRY_PID + s.device;
+        if (devices.insert(s.device).second)
+        {
+            exportChromeName(os, sep, "process_name", "Device " + std::to_string(s.device) + " telemetry", pid, 0);
+        }
+        const std::string sm = std::to_string(s.smClock);
+        const std::string mem = std::to_string(s.memClock);
+        exportChromeCounter(os, sep, "clocks", pid, s.timeMs, "\"SM MHz\" : " + sm + ", \"memory MHz\" : " + mem);
+        exportChromeCounter(os, sep, "power", pid, s.timeMs, "\"W\" : " + std::to_string(s.power));
+        exportChromeCounter(os, sep, "temperature", pid, s.timeMs, "\"C\" : " + std::to_string(s.temperature));
+        exportChromeCounter(os, sep, "throttled", pid, s.timeMs, "\"throttled\" : " + std::to_string(isThrottled(s)));
+    }
+    os << "] }" << std::endl;
+}
+
+void ContextProfiler::reportLayerTime(const char* layerName, float timeMs)
+{
+    if (mIterator == mLayers.end())
+    {
+        const bool first = !mLayers.empty() && mLayers.begin()->name == layerName;
+        mUpdatesCount += mLayers.empty() || first;
+        if (first)
+        {
+            mIterator = mLayers.begin();
+        }
+        else
+        {
+            mLayers.emplace_back();
+            mLayers.back().name = layerName;
+            mIterator = mLayers.end() - 1;
+        }
+    }
+
+    mIterator->timeMs += timeMs;
+    mIterator->timesMs.push_back(timeMs);
+    ++mIterator;
+}
+
+std::vector<LayerProfile> Profiler::aggregate() const
+{
+    std::vector<LayerProfile> layers;
+    std::unordered_map<std::string, size_t> indices;
+    for (const auto& c : mContexts)
+    {
+        for (const auto& l : c->mLayers)
+        {
+            const auto index = indices.emplace(l.name, layers.size());
+            if (index.second)
+            {
+                layers.emplace_back();
+                layers.back().name = l.name;
+            }
+            auto& layer = layers[index.first->second];
+            layer.timeMs += l.timeMs;
+            layer.timesMs.insert(layer.timesMs.end(), l.timesMs.begin(), l.timesMs.end());
+        }
+    }
+    for (auto& l : layers)
+    {
+        std::sort(l.timesMs.begin(), l.timesMs.end());
+    }
+    return layers;
+}
+
+namespace
+{
+
+//!
+//! \brief Find percentile in an ascending sequence of layer times
+//!
+float findLayerPercentile(float percentage, const std::vector<float>& timesMs)
+{
+    const int all = static_cast<int>(timesMs.size());
+    const int exclude = static_cast<int>((1 - percentage / 100) * all);
+    return all ? timesMs[std::max(all - 1 - exclude, 0)] : 0;
+}
+
+float findLayerMedian(const std::vector<float>& timesMs)
+{
+    const size_t m = timesMs.size() / 2;
+    if (timesMs.empty())
+    {
+        return 0;
+    }
+    return timesMs.size() % 2 ? timesMs[m] : (timesMs[m - 1] + timesMs[m]) / 2;
+}
+
+float meanEndToEnd(const std::vector<InferenceTrace>& trace)
+{
+    const auto plusEndToEnd = [](float accumulator, const InferenceTrace& t)
+    {
+        return accumulator + traceToTiming(t).e2e;
+    };
+    return trace.empty() ? 0 : std::accumulate(trace.begin(), trace.end(), 0.0F, plusEndToEnd) / trace.size();
+}
+
+} // namespace
+
+void Profiler::print(std::ostream& os, const std::vector<InferenceTrace>& trace) const
+{
+    const std::string nameHdr("Layer");
+    const std::string countHdr("   Count");
+    const std::string timeHdr("   Time (ms)");
+    const std::string avgHdr("   Avg. Time (ms)");
+    const std::string medianHdr("   Median (ms)");
+    const std::string p99Hdr("   P99 (ms)");
+    const std::string percentageHdr("   Time \%");
+    const std::string e2eHdr("   E2E \%");
+
+    const auto layers = aggregate();
+    if (layers.empty())
+    {
+        return;
+    }
+    const auto plusLayerTime = [](float accumulator, const LayerProfile& lp)
+    {
+        return accumulator + lp.timeMs;
+    };
+    const float totalTimeMs = std::accumulate(layers.begin(), layers.end(), 0.0F, plusLayerTime);
+    const int updatesCount = getUpdatesCount();
+    const float e2eMs = meanEndToEnd(trace);
+
+    const auto cmpLayer = [](const LayerProfile& a, const LayerProfile& b)
+    {
+        return a.name.size() < b.name.size();
+    };
+    const auto longestName = std::max_element(layers.begin(), layers.end(), cmpLayer);
+    const auto nameLength = std::max(longestName->name.size() + 1, nameHdr.size());
+    const auto countLength = countHdr.size();
+    const auto timeLength = timeHdr.size();
+    const auto avgLength = avgHdr.size();
+    const auto medianLength = medianHdr.size();
+    const auto p99Length = p99Hdr.size();
+    const auto percentageLength = percentageHdr.size();
+    const auto e2eLength = e2eHdr.size();
+
+    os << std::endl << "=== Profile (" << updatesCount << " iterations over " << mContexts.size() << " contexts ) ==="
+       << std::endl << std::setw(nameLength) << nameHdr << countHdr << timeHdr << avgHdr << medianHdr << p99Hdr
+       << percentageHdr << (e2eMs > 0 ? e2eHdr : "") << std::endl;
+
+    for (const auto& p : layers)
+    {
+        const float avgMs = p.timeMs / p.timesMs.size();
+// clang off
+        os << std::setw(nameLength)                                             << p.name
+           << std::setw(countLength)                                            << p.timesMs.size()
+           << std::setw(timeLength)       << std::fixed << std::setprecision(2) << p.timeMs
+           << std::setw(avgLength)        << std::fixed << std::setprecision(2) << avgMs
+           << std::setw(medianLength)     << std::fixed << std::setprecision(2) << findLayerMedian(p.timesMs)
+           << std::setw(p99Length)        << std::fixed << std::setprecision(2) << findLayerPercentile(99, p.timesMs)
+           << std::setw(percentageLength) << std::fixed << std::setprecision(1) << p.timeMs / totalTimeMs * 100;
+        if (e2eMs > 0)
+        {
+            os << std::setw(e2eLength)    << std::fixed << std::setprecision(1) << avgMs / e2eMs * 100;
+        }
+        os << std::endl;
+    }
+    {
+        os << std::setw(nameLength)                                             << "Total"
+           << std::setw(countLength)                                            << updatesCount
+           << std::setw(timeLength)       << std::fixed << std::setprecision(2) << totalTimeMs
+           << std::setw(avgLength)        << std::fixed << std::setprecision(2) << totalTimeMs / updatesCount
+           << std::setw(medianLength)                                           << "-"
+           << std::setw(p99Length)                                              << "-"
+           << std::setw(percentageLength) << std::fixed << std::setprecision(1) << 100.0;
+        if (e2eMs > 0)
+        {
+            os << std::setw(e2eLength)    << std::fixed << std::setprecision(1) << totalTimeMs / updatesCount / e2eMs * 100;
+        }
+        os << std::endl;
+// clang on
+    }
+    os << std::endl;
+
+}
+
+void Profiler::printComparison(const Profiler& a, const Profiler& b, std::ostream& os)
+{
+    const auto layersA = a.aggregate();
+    const auto layersB = b.aggregate();
+    const int updatesA = std::max(a.getUpdatesCount(), 1);
+    const int updatesB = std::max(b.getUpdatesCount(), 1);
+
+    // The layers of A in order, then those found in B only
+    std::vector<std::string> names;
+    std::unordered_map<std::string, std::pair<float, float>> timesMs;
+    for (const auto& l : layersA)
+    {
+        names.push_back(l.name);
+        timesMs[l.name].first = l.timeMs / updatesA;
+    }
+    for (const auto& l : layersB)
+    {
+        if (timesMs.find(l.name) == timesMs.end())
+        {
+            names.push_back(l.name);
+        }
+        timesMs[l.name].second = l.timeMs / updatesB;
+    }
+    if (names.empty())
+    {
+        return;
+    }
+
+    const std::string nameHdr("Layer");
+    const std::string aHdr("   A (ms)");
+    const std::string bHdr("   B (ms)");
+    const std::string deltaHdr("   B - A (ms)");
+    const auto cmpName = [](const std::string& x, const std::string& y) { return x.size() < y.size(); };
+    const auto nameLength = std::max(std::max_element(names.begin(), names.end(), cmpName)->size() + 1, nameHdr.size());
+
+    os << std::endl << "=== Profile comparison (mean time per iteration) ===" << std::endl
+       << std::setw(nameLength) << nameHdr << aHdr << bHdr << deltaHdr << std::endl;
+    const auto printTime = [&os](float timeMs, size_t length)
+    {
+        if (timeMs)
+        {
+            os << std::setw(length) << std::fixed << std::setprecision(3) << timeMs;
+        }
+        else
+        {
+            os << std::setw(length) << "-";
+        }
+    };
+    float totalA{0};
+    float totalB{0};
+    for (const auto& name : names)
+    {
+        const auto& t = timesMs[name];
+        os << std::setw(nameLength) << name;
+        printTime(t.first, aHdr.size());
+        printTime(t.second, bHdr.size());
+        os << std::setw(deltaHdr.size()) << std::fixed << std::setprecision(3) << t.second - t.first << std::endl;
+        totalA += t.first;
+        totalB += t.second;
+    }
+    os << std::setw(nameLength) << "Total";
+    printTime(totalA, aHdr.size());
+    printTime(totalB, bHdr.size());
+    os << std::setw(deltaHdr.size()) << std::fixed << std::setprecision(3) << totalB - totalA << std::endl << std::endl;
+}
+
+void PluginEnqueueProfiler::report(const char* pluginType, const char* layerName, float microseconds)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTimesUs[std::make_pair(std::string(pluginType), std::string(layerName))].push_back(microseconds);
+}
+
+void PluginEnqueueProfiler::print(std::ostream& os, const Profiler* profiler) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mTimesUs.empty())
+    {
+        return;
+    }
+
+    // Plugin layers keep the name of their network layer, under which the profile reports their GPU time
+    std::unordered_map<std::string, float> gpuUs;
+    if (profiler)
+    {
+        for (const auto& l : profiler->aggregate())
+        {
+            gpuUs[l.name] = l.timesMs.empty() ? 0 : l.timeMs * 1000 / l.timesMs.size();
+        }
+    }
+
+    const std::string typeHdr("Plugin");
+    const std::string nameHdr("   Layer");
+    const std::string countHdr("   Count");
+    const std::string avgHdr("   Avg. Host (us)");
+    const std::string medianHdr("   Median (us)");
+    const std::string p99Hdr("   P99 (us)");
+    const std::string maxHdr("   Max (us)");
+    const std::string gpuHdr("   Avg. GPU (us)");
+    size_t typeLength = typeHdr.size();
+    size_t nameLength = nameHdr.size();
+    for (const auto& t : mTimesUs)
+    {
+        typeLength = std::max(typeLength, t.first.first.size() + 1);
+        nameLength = std::max(nameLength, t.first.second.size() + 3);
+    }
+
+    os << std::endl << "=== Plugin enqueue profile (host time per enqueue, warm up included) ===" << std::endl
+       << std::setw(typeLength) << typeHdr << std::setw(nameLength) << nameHdr << countHdr << avgHdr << medianHdr
+       << p99Hdr << maxHdr << gpuHdr << std::endl;
+    for (const auto& t : mTimesUs)
+    {
+        std::vector<float> times(t.second);
+        std::sort(times.begin(), times.end());
+        const float avgUs = std::accumulate(times.begin(), times.end(), 0.0F) / times.size();
+        const auto gpu = gpuUs.find(t.first.second);
+// clang off
+        os << std::setw(typeLength)                                             << t.first.first
+           << std::setw(nameLength)                                             << t.first.second
+           << std::setw(countHdr.size())                                        << times.size()
+           << std::setw(avgHdr.size())    << std::fixed << std::setprecision(1) << avgUs
+           << std::setw(medianHdr.size()) << std::fixed << std::setprecision(1) << findLayerMedian(times)
+           << std::setw(p99Hdr.size())    << std::fixed << std::setprecision(1) << findLayerPercentile(99, times)
+           << std::setw(maxHdr.size())    << std::fixed << std::setprecision(1) << times.back();
+// clang on
+        if (gpu != gpuUs.end() && !t.first.second.empty())
+        {
+            os << std::setw(gpuHdr.size()) << std::fixed << std::setprecision(1) << gpu->second;
+        }
+        else
+        {
+            os << std::setw(gpuHdr.size()) << "-";
+        }
+        os << std::endl;
+    }
+    os << std::endl;
+}
+
+void Profiler::exportJSONProfile(const std::string& fileName, const std::vector<InferenceTrace>& trace) const
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    os << "[" << std::endl
+       << "  { \"count\" : " << getUpdatesCount() << ", \"contexts\" : " << mContexts.size() << " }" << std::endl;
+
+    const auto layers = aggregate();
+    const auto plusLayerTime = [](float accumulator, const LayerProfile& lp)
+    {
+        return accumulator + lp.timeMs;
+    };
+    const float totalTimeMs = std::accumulate(layers.begin(), layers.end(), 0.0F, plusLayerTime);
+    const float e2eMs = meanEndToEnd(trace);
+
+    for (const auto& l : layers)
+    {
+        const float avgMs = l.timeMs / l.timesMs.size();
+// clang off
+        os << ", {" << " \"name\" : \""      << l.name << "\""
+                       ", \"count\" : "      << l.timesMs.size()
+           <<          ", \"timeMs\" : "     << l.timeMs
+           <<          ", \"averageMs\" : "  << avgMs
+           <<          ", \"medianMs\" : "   << findLayerMedian(l.timesMs)
+           <<          ", \"p99Ms\" : "      << findLayerPercentile(99, l.timesMs)
+           <<          ", \"percentage\" : " << l.timeMs / totalTimeMs * 100;
+        if (e2eMs > 0)
+        {
+            os <<      ", \"endToEndPercentage\" : " << avgMs / e2eMs * 100;
+        }
+        os << " }"  << std::endl;
+// clang on
+    }
+    os << "]" << std::endl;
+}
+
+void dumpInputs(const nvinfer1::IExecutionContext& context, const Bindings& bindings, std::ostream& os)
+{
+    os << "Input Tensors:" << std::endl;
+    bindings.dumpInputs(context, os);
+}
+
+void dumpOutputs(const nvinfer1::IExecutionContext& context, const Bindings& bindings, std::ostream& os)
+{
+    os << "Output Tensors:" << std::endl;
+    bindings.dumpOutputs(context, os);
+}
+
+void exportJSONOutput(const nvinfer1::IExecutionContext& context, const Bindings& bindings, const std::string& fileName)
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    std::string sep ="  ";
+    const auto output = bindings.getOutputBindings();
+    os << "[" << std::endl;
+    for (const auto& binding : output)
+    {
+// clang off
+        os << sep << "{ \"name\" : \"" << binding.first << "\"" << std::endl;
+        sep = ", ";
+        os << "  " << sep << "\"dimensions\" : \"";
+        bindings.dumpBindingDimensions(binding.second, context, os);
+        os << "\"" << std::endl;
+        os << "  " << sep << "\"values\" : [ ";
+        bindings.dumpBindingValues(binding.second, os, sep);
+        os << " ]" << std::endl << "  }"  << std::endl;
+// clang on
+    }
+    os << "]" << std::endl;
+}
+
+void dumpOutputs(const TiledInference& tiling, std::ostream& os)
+{
+    os << "Output Tensors:" << std::endl;
+    os << tiling.getOutputName() << ": (";
+    tiling.dumpOutputDimensions(os);
+    os << ")" << std::endl;
+    tiling.dumpOutputValues(os);
+    os << std::endl;
+}
+
+void exportJSONOutput(const TiledInference& tiling, const std::string& fileName)
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    const std::string sep{", "};
+// clang off
+    os << "[" << std::endl;
+    os << "  { \"name\" : \"" << tiling.getOutputName() << "\"" << std::endl;
+    os << "  " << sep << "\"dimensions\" : \"";
+    tiling.dumpOutputDimensions(os);
+    os << "\"" << std::endl;
+    os << "  " << sep << "\"values\" : [ ";
+    tiling.dumpOutputValues(os, sep);
+    os << " ]" << std::endl << "  }"  << std::endl;
+    os << "]" << std::endl;
+// clang on
+}
+
+OutputValues getOutputValues(const Bindings& bindings)
+{
+    OutputValues outputs;
+    for (const auto& binding : bindings.getOutputBindings())
+    {
+        outputs[binding.first] = bindings.getBindingValues(binding.second);
+    }
+    return outputs;
+}
+
+bool importJSONOutput(const std::string& fileName, OutputValues& outputs, std::ostream& err)
+{
+    std::ifstream is(fileName);
+    if (!is)
+    {
+        err << "Could not read outputs " << fileName << std::endl;
+        return false;
+    }
+    const std::string json{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+
+    // Only the layout written by exportJSONOutput is read, the name of each output comes before its values
+    const std::string nameKey{"\"name\" : \""};
+    const std::string valuesKey{"\"values\" : ["};
+    for (auto n = json.find(nameKey); n != std::string::npos; n = json.find(nameKey, n))
+    {
+        n += nameKey.size();
+        const auto nameEnd = json.find('"', n);
+        const auto v = json.find(valuesKey, nameEnd);
+        const auto valuesEnd = json.find(']', v);
+        if (nameEnd == std::string::npos || v == std::string::npos || valuesEnd == std::string::npos)
+        {
+            err << "Invalid outputs " << fileName << std::endl;
+            return false;
+        }
+        auto& values = outputs[json.substr(n, nameEnd - n)];
+        std::istringstream valuesStream(json.substr(v + valuesKey.size(), valuesEnd - v - valuesKey.size()));
+        std::string value;
+        while (std::getline(valuesStream, value, ','))
+        {
+            values.push_back(std::stof(value));
+        }
+        n = valuesEnd;
+    }
+    return true;
+}
+
+float outputError(const OutputValues& outputs, const OutputValues& reference)
+{
+    float range{0};
+    float difference{0};
+    for (const auto& r : reference)
+    {
+        const auto o = outputs.find(r.first);
+        if (o == outputs.end() || o->second.size() != r.second.size())
+        {
+            return std::numeric_limits<float>::infinity();
+        }
+        for (size_t i = 0; i < r.second.size(); ++i)
+        {
+            range = std::max(range, std::abs(r.second[i]));
+            // NaN outputs, e.g. from an overflow in a lower precision, must not compare as close
+            const float d = std::abs(o->second[i] - r.second[i]);
+            difference = d <= difference ? difference : d;
+        }
+    }
+    return range > 0 ? difference / range : difference;
 }
 
 } // namespace sample
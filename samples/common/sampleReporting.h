@@ -17,11 +17,20 @@
 #ifndef TRT_SAMPLE_REPORTING_H
 #define TRT_SAMPLE_REPORTING_H
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "NvInfer.h"
 
 #include "sampleOptions.h"
+#include "sampleTelemetry.h"
 #include "sampleUtils.h"
 
 namespace sample
@@ -33,7 +42,8 @@ namespace sample
 //!
 struct InferenceTime
 {
-    InferenceTime(float i, float c, float o, float e): in(i), compute(c), out(o), e2e(e) {}
+    InferenceTime(float i, float c, float o, float e, float q = 0, float n = 0, float g = 0):
+        in(i), compute(c), out(o), e2e(e), queue(q), enqueue(n), gap(g) {}
 
     InferenceTime() = default;
     InferenceTime(const InferenceTime&) = default;
@@ -46,12 +56,96 @@ struct InferenceTime
     float compute{0}; // Compute
     float out{0};     // Device to Host
     float e2e{0};     // end to end
+    float queue{0};   // Request arrival to start of input, only with open-loop issuing
+    float enqueue{0}; // Host time to submit the compute
+    float gap{0};     // Device idle time on the stream between the previous compute and this one
 
     // ideal latency
     float latency() const
     {
         return in + compute + out;
     }
+
+    // latency observed by a request, including the time spent waiting to be issued
+    float response() const
+    {
+        return queue + e2e;
+    }
+};
+
+//!
+//! \struct StartupTimes
+//! \brief Time of each phase from the start of the process to the end of the first inference, in milliseconds
+//!
+struct StartupTimes
+{
+    float cudaMs{0};           //!< From the start of main to a CUDA context on the device
+    float pluginsMs{0};        //!< Registering the TensorRT plugins and loading the plugin libraries
+    float readMs{0};           //!< Reading or mapping the engine file
+    float decompressMs{0};     //!< Decompressing a compressed engine file
+    float deserializeMs{0};    //!< Deserializing the engine, plugins included
+    float buildMs{0};          //!< Building the engine when it is not loaded from a file
+    float contextsMs{0};       //!< Creating the execution contexts
+    float bindingsMs{0};       //!< Allocating and filling the bindings
+    float prewarmMs{0};        //!< The inferences of --prewarm
+    float firstInferenceMs{0}; //!< Host latency of the first timed inference, with the lazy initializations left
+};
+
+//!
+//! \struct WaitStats
+//! \brief Host cost of waiting for the completions of the inferences, to trade CPU for latency
+//!
+struct WaitStats
+{
+    unsigned long long waits{0};
+    unsigned long long spunWaits{0}; //!< Hybrid waits whose event completed within the spin window
+    double waitMs{0};                //!< Host time in the waits, over all the streams
+    double cpuMs{0};                 //!< CPU time of the inference threads
+    double wallMs{0};                //!< Wall time of the longest inference thread
+};
+
+//!
+//! \struct DeadlineStats
+//! \brief Outcome of the timed requests of each priority class run with deadlines
+//!
+struct DeadlineStats
+{
+    struct Class
+    {
+        float slaMs{0};
+        unsigned long long requests{0};
+        unsigned long long onTime{0}; //!< Completed within their SLA
+        unsigned long long late{0};   //!< Completed past their deadline
+        unsigned long long shed{0};   //!< Dropped before running, as they could no longer meet their deadline
+    };
+
+    std::vector<Class> classes;
+    double startMs{0}; //!< Window of the timed requests, from the end of the warm up to the last completion
+    double endMs{0};
+
+    //!
+    //! \brief Add the requests of another run of the same classes and extend the window to it
+    //!
+    void merge(const DeadlineStats& other);
+};
+
+//!
+//! \struct ConvergenceStats
+//! \brief When the warm up of a run was steady and how precise its measurement got, with --steadyState and --confidence
+//!
+struct ConvergenceStats
+{
+    bool adaptiveWarmup{false};
+    bool steady{false};     //!< The warm up reached steady state before --duration
+    float warmupMs{0};      //!< Compute start of the first measured query, the warm up of the reports
+    int warmupQueries{0};
+    bool earlyStop{false};
+    bool converged{false};  //!< The measurement reached the confidence before --duration
+    int queries{0};         //!< Measured
+    float meanWidth{0};     //!< Half widths of the 95% confidence intervals, in percent of their estimates
+    float percentileWidth{0};
+    float throughputWidth{0};
+    float width{0};         //!< Requested half width, in percent
 };
 
 //!
@@ -60,8 +154,11 @@ struct InferenceTime
 //!
 struct InferenceTrace
 {
+    InferenceTrace(int s, float is, float ie, float cs, float ce, float os, float oe, float a, int b = 0):
+        stream(s), batch(b), arrival(a), inStart(is), inEnd(ie), computeStart(cs), computeEnd(ce), outStart(os), outEnd(oe) {}
+
     InferenceTrace(int s, float is, float ie, float cs, float ce, float os, float oe):
-        stream(s), inStart(is), inEnd(ie), computeStart(cs), computeEnd(ce), outStart(os), outEnd(oe) {}
+        InferenceTrace(s, is, ie, cs, ce, os, oe, is) {}
 
     InferenceTrace() = default;
     InferenceTrace(const InferenceTrace&) = default;
@@ -71,17 +168,27 @@ struct InferenceTrace
     ~InferenceTrace() = default;
 
     int stream{0};
+    int device{0};    // Device the stream runs on
+    int batch{0};     // Number of requests gathered with dynamic batching, 0 for a fixed batch
+    int weight{1};    // Queries the entry stands for with --timingSample, itself and the untimed ones after it
+    float arrival{0}; // Equal to inStart when requests are issued back to back
     float inStart{0};
     float inEnd{0};
     float computeStart{0};
     float computeEnd{0};
     float outStart{0};
     float outEnd{0};
+    float enqueueStart{0}; // Host clock, from the host issuing the start event, not aligned with the device times
+    float enqueueEnd{0};
+    int shapeBucket{-1};     // Bucket of the input shapes drawn with --shapeChurn, -1 without
+    bool shapeChange{false}; // The drawn shapes differed from those of the previous query of the context
+    float shapeMs{0};        // Host time to check and set the drawn shapes, before the enqueue
 };
 
 inline InferenceTime operator+(const InferenceTime& a, const InferenceTime& b)
 {
-    return InferenceTime(a.in + b.in, a.compute + b.compute, a.out + b.out, a.e2e + b.e2e);
+    return InferenceTime(a.in + b.in, a.compute + b.compute, a.out + b.out, a.e2e + b.e2e, a.queue + b.queue,
+        a.enqueue + b.enqueue, a.gap + b.gap);
 }
 
 inline InferenceTime operator+=(InferenceTime& a, const InferenceTime& b)
@@ -89,6 +196,153 @@ inline InferenceTime operator+=(InferenceTime& a, const InferenceTime& b)
     return a = a+b;
 }
 
+inline InferenceTime traceToTiming(const InferenceTrace& a)
+{
+    return InferenceTime((a.inEnd - a.inStart), (a.computeEnd - a.computeStart), (a.outEnd - a.outStart),
+        (a.outEnd - a.inStart), (a.inStart - a.arrival), (a.enqueueEnd - a.enqueueStart));
+}
+
+//!
+//! \brief Compute for each trace entry the time the device was idle on its stream since the previous compute
+//!
+//! The first compute of each stream has no gap.
+//!
+std::vector<float> traceToIdleGaps(const std::vector<InferenceTrace>& trace);
+
+//!
+//! \class LatencyHistogram
+//! \brief Fixed size log-linear histogram of durations, in the manner of HDR histograms
+//!
+//! Durations are counted in nanoseconds, exactly up to kSUB_BUCKETS ns and then in kSUB_BUCKETS / 2 buckets per
+//! power of two, so a bucket is at most 1/64 of its values wide. The memory is the same whatever the number of
+//! samples, and histograms of different runs add up bucket by bucket.
+//!
+class LatencyHistogram
+{
+
+public:
+
+    static constexpr int kSUB_BUCKETS{128};
+    static constexpr int kMAX_SHIFT{44}; // Durations up to 2^51 ns, about 26 days
+    static constexpr int kBUCKETS{kSUB_BUCKETS + kMAX_SHIFT * kSUB_BUCKETS / 2};
+
+    void record(float ms)
+    {
+        const uint64_t ns = ms > 0 ? static_cast<uint64_t>(ms * 1e6F) : 0;
+        ++mBuckets[bucketOf(ns)];
+        ++mCount;
+        mSumNs += ns;
+        mMinNs = std::min(mMinNs, ns);
+        mMaxNs = std::max(mMaxNs, ns);
+    }
+
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const
+    {
+        return mCount;
+    }
+
+    float meanMs() const
+    {
+        return mCount ? static_cast<float>(static_cast<double>(mSumNs) / mCount / 1e6) : 0;
+    }
+
+    float maxMs() const
+    {
+        return static_cast<float>(mMaxNs / 1e6);
+    }
+
+    //!
+    //! \brief The highest duration of the bucket holding the given percentile, no larger than the maximum recorded
+    //!
+    float percentileMs(float percentage) const;
+
+    //!
+    //! \brief Write the non-empty buckets as "index count" lines after a header line with the name and totals
+    //!
+    void serialize(std::ostream& os, const std::string& name) const;
+
+    //!
+    //! \brief Add the buckets of a histogram written by serialize(), after its header has been read
+    //!
+    bool deserialize(std::istream& is, uint64_t count, uint64_t sumNs, uint64_t minNs, uint64_t maxNs, int buckets);
+
+private:
+
+    static int bucketOf(uint64_t ns);
+
+    static uint64_t highestOf(int bucket);
+
+    std::array<uint64_t, kBUCKETS> mBuckets{};
+    uint64_t mCount{0};
+    uint64_t mSumNs{0};
+    uint64_t mMinNs{UINT64_MAX};
+    uint64_t mMaxNs{0};
+};
+
+//!
+//! \struct LatencyHistograms
+//! \brief Histograms of the stages of an inference
+//!
+struct LatencyHistograms
+{
+    LatencyHistogram in;
+    LatencyHistogram compute;
+    LatencyHistogram out;
+    LatencyHistogram e2e;
+
+    void record(const InferenceTime& t)
+    {
+        in.record(t.in);
+        compute.record(t.compute);
+        out.record(t.out);
+        e2e.record(t.e2e);
+    }
+
+    void merge(const LatencyHistograms& other)
+    {
+        in.merge(other.in);
+        compute.merge(other.compute);
+        out.merge(other.out);
+        e2e.merge(other.e2e);
+    }
+};
+
+//!
+//! \brief Accumulate the inferences of a trace that started after the warm up
+//!
+LatencyHistograms traceToHistograms(const std::vector<InferenceTrace>& trace, float warmupMs);
+
+//!
+//! \brief Print p50, p90, p99, p99.9 and max of each stage
+//!
+void printHistograms(const LatencyHistograms& histograms, std::ostream& os);
+
+//!
+//! \brief Write histograms as text that readHistograms() can merge with the histograms of other runs
+//!
+void writeHistograms(const LatencyHistograms& histograms, std::ostream& os);
+
+//!
+//! \brief Add the histograms written by writeHistograms(), up to the end of the stream
+//!
+//! \return False if the text is not a set of histograms
+//!
+bool readHistograms(std::istream& is, LatencyHistograms& histograms);
+
+//!
+//! \brief Export histograms to a text file that importHistograms() can merge with the histograms of other runs
+//!
+void exportHistograms(const LatencyHistograms& histograms, const std::string& fileName);
+
+//!
+//! \brief Add the histograms of a file written by exportHistograms()
+//!
+//! \return False if the file could not be read
+//!
+bool importHistograms(const std::string& fileName, LatencyHistograms& histograms);
+
 //!
 //! \brief Print benchmarking time and number of traces collected
 //!
@@ -102,18 +356,122 @@ void printTiming(const std::vector<InferenceTime>& timings, int runsPerAvg, std:
 //!
 //! \brief Print the performance summary of a trace
 //!
-void printEpilog(std::vector<InferenceTime> timings, float percentile, int queries, std::ostream& os);
+void printEpilog(std::vector<InferenceTime> timings, float walltimeMs, float percentile, float queries, std::ostream& os);
+
+//!
+//! \brief Print the latency under load of an open-loop trace, from request arrival to output
+//!
+void printLoadEpilog(std::vector<InferenceTime> timings, float walltimeMs, float percentile, float qps, std::ostream& os);
 
 //!
 //! \brief Print and summarize a timing trace
 //!
-void printPerformanceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs, int queries, std::ostream& os);
+//! \param qps The offered request rate if requests were issued open loop, 0 otherwise
+//!
+void printPerformanceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs, int queries, float qps, std::ostream& os);
+
+//!
+//! \brief Print the throughput and latency of each device of a trace collected on several devices
+//!
+void printDeviceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs, int queries, std::ostream& os);
+
+//!
+//! \brief Print the throughput, latency and utilization of each engine of a trace collected with several at once
+//!
+//! The device field of the trace entries is the index of the engine in names. The utilization of an engine is the share
+//! of the run during which it computed on at least one stream.
+//!
+void printHeterogeneousReport(const std::vector<InferenceTrace>& trace, const std::vector<std::string>& names,
+    const ReportingOptions& reporting, float warmupMs, int queries, std::ostream& os);
+
+//!
+//! \brief Print the time of each startup phase, with its share of the time to the end of the first inference
+//!
+void printStartupReport(const StartupTimes& times, std::ostream& os);
+
+//!
+//! \brief Print the CPU use of the inference threads and the time of their waits, of the wait mode named mode
+//!
+void printWaitReport(const WaitStats& stats, const std::string& mode, std::ostream& os);
+
+//!
+//! \brief Print the latency and throughput differences of two engines from the traces of an interleaved comparison
+//!
+//! The traces hold the same rounds in order, each with one inference per stream. The differences are the means of the
+//! round by round differences of B from A, with their 95% confidence intervals.
+//!
+void printComparisonReport(const std::vector<InferenceTrace>& traceA, const std::vector<InferenceTrace>& traceB,
+    int queries, int streams, std::ostream& os);
+
+//!
+//! \brief Print the share of its run time each stage of each stream was busy, and the mean queries in flight
+//!
+//! With the stages of a stream kept busy at the pipeline depth, a deeper pipeline does not help, otherwise the number
+//! of queries in flight tells if a deeper one would overlap more of the transfers.
+//!
+void printStageReport(const std::vector<InferenceTrace>& trace, float warmupMs, int depth, std::ostream& os);
+
+//!
+//! \brief Print for each device the share of the run its H2D and D2H copies were busy, the share of that time that
+//!        overlapped computes, and the copies that started before those of queries submitted earlier
+//!
+void printCopyReport(const std::vector<InferenceTrace>& trace, float warmupMs, std::ostream& os);
+
+//!
+//! \brief Print the goodput, the rate of requests completed within their SLA, next to the throughput of all the
+//!        completed requests, overall and for each priority class
+//!
+void printDeadlineReport(const DeadlineStats& stats, std::ostream& os);
+
+//!
+//! \brief Print the latency of the queries of each bucket of input shapes drawn with --shapeChurn, and the host cost of
+//! the shape changes
+//!
+void printShapeChurnReport(const std::vector<InferenceTrace>& trace, const std::vector<std::string>& buckets,
+    float warmupMs, float percentile, std::ostream& os);
+
+//!
+//! \brief Print the requests of a replay and their latency from arrival to output, in windows of their arrival times
+//!
+//! The worst window at the percentile is repeated last, for the bursts of the trace to stand out.
+//!
+void printReplayReport(const std::vector<InferenceTrace>& trace, float windowMs, float percentile, std::ostream& os);
+
+//!
+//! \brief Print how long the warm up took to reach steady state and the precision the measurement reached
+//!
+void printConvergenceReport(const ConvergenceStats& stats, std::ostream& os);
+
+//!
+//! \brief Print how full the batches gathered with dynamic batching were
+//!
+void printBatchingReport(const std::vector<InferenceTrace>& trace, float warmupMs, int maxBatch, std::ostream& os);
 
 //!
 //! \brief Export a timing trace to JSON file
 //!
 void exportJSONTrace(const std::vector<InferenceTrace>& trace, const std::string& fileName);
 
+//!
+//! \brief Export the summary of a run, past its warm up, as a single line JSON record for regression tracking
+//!
+//! \param deviceMemory Bytes of device memory used at the end of the run
+//!
+void exportJSONSummary(const std::string& model, const std::vector<InferenceTrace>& trace, float warmupMs, int queries,
+    const StartupTimes& startup, uint64_t deviceMemory, const std::string& fileName);
+
+class Profiler;
+
+//!
+//! \brief Export a timing trace to a JSON file in the trace event format of chrome://tracing and Perfetto
+//!
+//! Each stream is a process with one thread per stage. With a profiler, the layers of each inference are laid back
+//! to back from the start of its compute, as the profiler reports durations only. Telemetry samples are counters of a
+//! process per device, on the host clock, which is behind the device timeline by the launch of the start event.
+//!
+void exportChromeTrace(const std::vector<InferenceTrace>& trace, const Profiler* profiler, const std::string& fileName,
+    const std::vector<TelemetrySample>& telemetry = {});
+
 //!
 //! \brief Print input tensors to stream
 //!
@@ -129,6 +487,39 @@ void dumpOutputs(const nvinfer1::IExecutionContext& context, const Bindings& bin
 //!
 void exportJSONOutput(const nvinfer1::IExecutionContext& context, const Bindings& bindings, const std::string& fileName);
 
+class TiledInference;
+
+//!
+//! \brief Print the output image blended from the tiles of the last query to stream
+//!
+void dumpOutputs(const TiledInference& tiling, std::ostream& os);
+
+//!
+//! \brief Export the output image blended from the tiles of the last query to JSON file, in the layout of the tensors
+//!
+void exportJSONOutput(const TiledInference& tiling, const std::string& fileName);
+
+//!
+//! \brief Values of the output tensors by name
+//!
+using OutputValues = std::unordered_map<std::string, std::vector<float>>;
+
+//!
+//! \brief The values of the output tensors, as copied to the host by the last inference
+//!
+OutputValues getOutputValues(const Bindings& bindings);
+
+//!
+//! \brief Read the output tensors of a JSON file written by exportJSONOutput
+//!
+bool importJSONOutput(const std::string& fileName, OutputValues& outputs, std::ostream& err);
+
+//!
+//! \brief Largest absolute difference between the outputs and the reference ones, divided by the largest absolute
+//! reference value, or infinity if the outputs do not match the reference in names and sizes
+//!
+float outputError(const OutputValues& outputs, const OutputValues& reference);
+
 //!
 //! \struct LayerProfile
 //! \brief Layer profile information
@@ -137,40 +528,119 @@ struct LayerProfile
 {
     std::string name;
     float timeMs{0};
+    std::vector<float> timesMs; // One time per profiled inference, for the percentiles
 };
 
 //!
-//! \class Profiler
-//! \brief Collect per-layer profile information, assuming times are reported in the same order
+//! \class ContextProfiler
+//! \brief Collect per-layer profile information of one execution context, assuming times are reported in the same order
 //!
-class Profiler : public nvinfer1::IProfiler
+//! Only the thread running the context reports to its profiler, so it needs no locking.
+//!
+class ContextProfiler : public nvinfer1::IProfiler
 {
 
 public:
 
     void reportLayerTime(const char* layerName, float timeMs) override;
 
-    void print(std::ostream& os) const;
+private:
+
+    friend class Profiler;
+
+    std::vector<LayerProfile> mLayers;
+    std::vector<LayerProfile>::iterator mIterator{mLayers.begin()};
+    int mUpdatesCount{0};
+};
+
+//!
+//! \class Profiler
+//! \brief Per-layer profile information aggregated over the execution contexts of all the streams and threads
+//!
+class Profiler
+{
+
+public:
+
+    //!
+    //! \brief Create the profiler of one more execution context, before inference starts
+    //!
+    nvinfer1::IProfiler* addContext()
+    {
+        mContexts.emplace_back(new ContextProfiler);
+        return mContexts.back().get();
+    }
+
+    //!
+    //! \brief Print the profile, with the share of the mean end to end time of the trace when it is not empty
+    //!
+    void print(std::ostream& os, const std::vector<InferenceTrace>& trace = {}) const;
 
     //!
     //! \brief Export a profile to JSON file
     //!
-    void exportJSONProfile(const std::string& fileName) const;
+    void exportJSONProfile(const std::string& fileName, const std::vector<InferenceTrace>& trace = {}) const;
+
+    //!
+    //! \brief The layers of the context of a stream, with the times of its profiled inferences in order
+    //!
+    const std::vector<LayerProfile>& getContextLayers(int context) const
+    {
+        return mContexts[context]->mLayers;
+    }
+
+    int getContextCount() const
+    {
+        return static_cast<int>(mContexts.size());
+    }
+
+    //!
+    //! \brief Print the mean time of each layer in two profiles and their difference, matching the layers by name
+    //!
+    static void printComparison(const Profiler& a, const Profiler& b, std::ostream& os);
+
+    //!
+    //! \brief Merge the layers of all the contexts by name, in order of first appearance, with sorted times
+    //!
+    std::vector<LayerProfile> aggregate() const;
 
 private:
 
-    float getTotalTime() const
+    int getUpdatesCount() const
     {
-        const auto plusLayerTime = [](float accumulator, const LayerProfile& lp)
+        const auto plusUpdates = [](int accumulator, const std::unique_ptr<ContextProfiler>& c)
         {
-            return accumulator + lp.timeMs;
+            return accumulator + c->mUpdatesCount;
         };
-        return std::accumulate(mLayers.begin(), mLayers.end(), 0.0, plusLayerTime);
+        return std::accumulate(mContexts.begin(), mContexts.end(), 0, plusUpdates);
     }
 
-    std::vector<LayerProfile> mLayers;
-    std::vector<LayerProfile>::iterator mIterator{mLayers.begin()};
-    int mUpdatesCount{0};
+    std::vector<std::unique_ptr<ContextProfiler>> mContexts;
+};
+
+//!
+//! \class PluginEnqueueProfiler
+//! \brief Host time spent in the enqueue of each plugin layer, as reported by the plugin library
+//!
+//! The plugin library reports from the threads that enqueue, warm up included, hence the lock.
+//!
+class PluginEnqueueProfiler
+{
+
+public:
+
+    void report(const char* pluginType, const char* layerName, float microseconds);
+
+    //!
+    //! \brief Print the host times of each plugin layer, with the mean GPU time of the layer of the same name in the
+    //!        profile when there is one
+    //!
+    void print(std::ostream& os, const Profiler* profiler = nullptr) const;
+
+private:
+
+    mutable std::mutex mMutex;
+    std::map<std::pair<std::string, std::string>, std::vector<float>> mTimesUs; // By plugin type and layer name
 };
 
 } // namespace sample
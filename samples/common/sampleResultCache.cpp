@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "sampleResultCache.h"
+
+namespace sample
+{
+
+namespace
+{
+
+// Must match the device hash in sampleResultCache.cu
+constexpr uint64_t kWORD_KEY{0x9E3779B97F4A7C15ULL};
+
+//! The finalizer of MurmurHash3
+inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t loadWord(const unsigned char* bytes, size_t count)
+{
+    uint64_t word{0};
+    for (size_t b = 0; b < count; ++b)
+    {
+        word |= static_cast<uint64_t>(bytes[b]) << (8 * b);
+    }
+    return word;
+}
+
+} // namespace
+
+uint64_t contentHash(const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    const size_t words = size / sizeof(uint64_t);
+    uint64_t sum{0};
+    for (size_t w = 0; w < words; ++w)
+    {
+        sum += mix(loadWord(bytes + w * sizeof(uint64_t), sizeof(uint64_t)) ^ (w * kWORD_KEY));
+    }
+    if (size % sizeof(uint64_t))
+    {
+        sum += mix(loadWord(bytes + words * sizeof(uint64_t), size % sizeof(uint64_t)) ^ (words * kWORD_KEY));
+    }
+    return mix(sum ^ size);
+}
+
+std::ostream& operator<<(std::ostream& os, const ResultCacheStats& stats)
+{
+    const double hitRate = stats.lookups ? 100.0 * stats.hits / stats.lookups : 0;
+    os << "Result cache: " << stats.hits << " hits out of " << stats.lookups << " lookups (" << hitRate << "%), "
+       << stats.entries << " entries in " << (stats.bytes >> 20) << " MB of " << (stats.capacity >> 20) << " MB, "
+       << stats.evictions << " evicted";
+    return os;
+}
+
+ResultCache::ResultCache(size_t capacity, int device)
+    : mPool(device, std::min(capacity, size_t(64) << 20))
+    , mCapacity(capacity)
+{
+}
+
+ResultCache::~ResultCache()
+{
+    for (const auto& e : mEntries)
+    {
+        mPool.free(e.data);
+    }
+}
+
+bool ResultCache::lookup(uint64_t key, const std::vector<Tensor>& outputs)
+{
+    size_t bytes{0};
+    for (const auto& o : outputs)
+    {
+        bytes += o.bytes;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mLookups;
+    const auto found = mIndex.find(key);
+    if (found == mIndex.end() || found->second->bytes != bytes)
+    {
+        return false;
+    }
+    ++mHits;
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    const char* data = static_cast<const char*>(found->second->data);
+    for (const auto& o : outputs)
+    {
+        std::memcpy(o.data, data, o.bytes);
+        data += o.bytes;
+    }
+    return true;
+}
+
+void ResultCache::insert(uint64_t key, const std::vector<Tensor>& outputs)
+{
+    size_t bytes{0};
+    for (const auto& o : outputs)
+    {
+        bytes += o.bytes;
+    }
+    if (!bytes || bytes > mCapacity)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mIndex.count(key))
+    {
+        // Another connection inferred the same inputs meanwhile
+        return;
+    }
+    while (mBytes + bytes > mCapacity)
+    {
+        evict();
+    }
+    char* data = static_cast<char*>(mPool.allocate(bytes));
+    mEntries.push_front({key, data, bytes});
+    mIndex[key] = mEntries.begin();
+    mBytes += bytes;
+    for (const auto& o : outputs)
+    {
+        std::memcpy(data, o.data, o.bytes);
+        data += o.bytes;
+    }
+}
+
+ResultCacheStats ResultCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    ResultCacheStats stats;
+    stats.lookups = mLookups;
+    stats.hits = mHits;
+    stats.evictions = mEvictions;
+    stats.entries = mEntries.size();
+    stats.bytes = mBytes;
+    stats.capacity = mCapacity;
+    return stats;
+}
+
+void ResultCache::evict()
+{
+    const Entry& oldest = mEntries.back();
+    mPool.free(oldest.data);
+    mBytes -= oldest.bytes;
+    mIndex.erase(oldest.key);
+    mEntries.pop_back();
+    ++mEvictions;
+}
+
+} // namespace sample
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleResultCache.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kTHREADS{256};
+constexpr int kMAX_BLOCKS{1024};
+
+// Must match the host hash in sampleResultCache.cpp
+constexpr uint64_t kWORD_KEY{0x9E3779B97F4A7C15ULL};
+
+__device__ __host__ inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+//! Word w of the buffer, byte by byte since device inputs shared over IPC may start at any offset
+__device__ inline uint64_t loadWord(const unsigned char* bytes, size_t size, size_t w)
+{
+    const size_t first = w * sizeof(uint64_t);
+    if (!(reinterpret_cast<uintptr_t>(bytes) % sizeof(uint64_t)) && first + sizeof(uint64_t) <= size)
+    {
+        return *reinterpret_cast<const uint64_t*>(bytes + first);
+    }
+    uint64_t word{0};
+    for (size_t b = 0; b < sizeof(uint64_t) && first + b < size; ++b)
+    {
+        word |= static_cast<uint64_t>(bytes[first + b]) << (8 * b);
+    }
+    return word;
+}
+
+//! Grid-stride sum of the mixes of the words, each block adds its sum to hash once
+__global__ void contentHashKernel(const unsigned char* bytes, size_t size, unsigned long long* hash)
+{
+    __shared__ unsigned long long sums[kTHREADS];
+    const size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    unsigned long long sum{0};
+    for (size_t w = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; w < words;
+         w += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        sum += mix(loadWord(bytes, size, w) ^ (w * kWORD_KEY));
+    }
+    sums[threadIdx.x] = sum;
+    __syncthreads();
+    for (int active = kTHREADS / 2; active > 0; active /= 2)
+    {
+        if (threadIdx.x < active)
+        {
+            sums[threadIdx.x] += sums[threadIdx.x + active];
+        }
+        __syncthreads();
+    }
+    if (!threadIdx.x)
+    {
+        atomicAdd(hash, sums[0]);
+    }
+}
+
+__global__ void finishHashKernel(unsigned long long* hash, size_t size)
+{
+    *hash = mix(*hash ^ size);
+}
+
+} // namespace
+
+void contentHashDevice(const void* data, size_t size, uint64_t* hash, cudaStream_t stream)
+{
+    auto* sum = reinterpret_cast<unsigned long long*>(hash);
+    cudaMemsetAsync(sum, 0, sizeof(*sum), stream);
+    const size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    const int blocks = static_cast<int>(std::min<size_t>((words + kTHREADS - 1) / kTHREADS, kMAX_BLOCKS));
+    if (blocks)
+    {
+        contentHashKernel<<<blocks, kTHREADS, 0, stream>>>(static_cast<const unsigned char*>(data), size, sum);
+    }
+    finishHashKernel<<<1, 1, 0, stream>>>(sum, size);
+}
+
+} // namespace sample
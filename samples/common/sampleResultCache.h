@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_RESULT_CACHE_H
+#define TRT_SAMPLE_RESULT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include "sampleDevice.h"
+
+namespace sample
+{
+
+//!
+//! \brief Non-cryptographic hash of the bytes of a buffer in host memory
+//!
+//! The buffer is read as little endian 64-bit words, the last one padded with zeros. Each word is mixed with its index
+//! and the mixes are summed, so the words hash in any order and in parallel, and the sum is mixed with the size.
+//!
+uint64_t contentHash(const void* data, size_t size);
+
+//!
+//! \brief The same hash of a buffer in device memory, written to hash in device memory once the stream reaches it
+//!
+void contentHashDevice(const void* data, size_t size, uint64_t* hash, cudaStream_t stream);
+
+//! Combine the hash of a buffer into the key of the buffers hashed so far
+inline uint64_t combineHash(uint64_t key, uint64_t hash)
+{
+    return key ^ (hash + 0x9E3779B97F4A7C15ULL + (key << 6) + (key >> 2));
+}
+
+struct ResultCacheStats
+{
+    uint64_t lookups{0};
+    uint64_t hits{0};
+    uint64_t evictions{0};
+    size_t entries{0};
+    size_t bytes{0};    //!< Held by the outputs of the entries
+    size_t capacity{0};
+};
+
+std::ostream& operator<<(std::ostream& os, const ResultCacheStats& stats);
+
+//!
+//! \class ResultCache
+//! \brief Least recently used outputs of previous inferences, in pinned memory, keyed by the hash of their inputs
+//!
+//! Requests that repeat inputs get the outputs of the first inference of these inputs without running the engine. The
+//! key only hashes the inputs, two inputs with the same 64-bit hash would share their outputs.
+//!
+class ResultCache
+{
+public:
+    struct Tensor
+    {
+        char* data;
+        size_t bytes;
+    };
+
+    //!
+    //! \param capacity The bytes of the outputs the cache holds, the least recently used entries are evicted past it
+    //! \param device The device whose NUMA node the pinned memory is placed on
+    //!
+    ResultCache(size_t capacity, int device);
+
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    //!
+    //! \brief Copy the outputs cached for key into outputs, which must have the sizes they were inserted with
+    //!
+    //! \return False without copying if key is not cached
+    //!
+    bool lookup(uint64_t key, const std::vector<Tensor>& outputs);
+
+    //!
+    //! \brief Cache a copy of the outputs of the inputs of key, unless they take more than the capacity
+    //!
+    void insert(uint64_t key, const std::vector<Tensor>& outputs);
+
+    ResultCacheStats getStats() const;
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        void* data;
+        size_t bytes;
+    };
+
+    void evict();
+
+    mutable std::mutex mMutex;
+    TrtPinnedHostPool mPool;
+    std::list<Entry> mEntries; //!< The most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> mIndex;
+    size_t mCapacity{0};
+    size_t mBytes{0};
+    uint64_t mLookups{0};
+    uint64_t mHits{0};
+    uint64_t mEvictions{0};
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_RESULT_CACHE_H
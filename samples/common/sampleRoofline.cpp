@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include "sampleReporting.h"
+#include "sampleRoofline.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//!
+//! \brief Operations of the fully connected plugin, from its K input channels, and of the attention plugin, from the
+//!        S x S scores of each head, with the [S, B, E, 1, 1] layouts of the BERT plugins
+//!
+std::unordered_map<std::string, PluginFlopsFunction> defaultPluginFlops()
+{
+    std::unordered_map<std::string, PluginFlopsFunction> flops;
+    flops["CustomFCPluginDynamic"] = [](nvinfer1::ILayer& layer, double outputVolume) {
+        const auto in = layer.getInput(0)->getDimensions();
+        return in.nbDims > 2 && in.d[2] > 0 ? 2 * outputVolume * in.d[2] : -1;
+    };
+    flops["CustomQKVToContextPluginDynamic"] = [](nvinfer1::ILayer& layer, double outputVolume) {
+        const auto in = layer.getInput(0)->getDimensions();
+        return in.nbDims > 0 && in.d[0] > 0 ? 4 * outputVolume * in.d[0] : -1;
+    };
+    return flops;
+}
+
+std::mutex gPluginFlopsMutex;
+
+std::unordered_map<std::string, PluginFlopsFunction>& pluginFlops()
+{
+    static std::unordered_map<std::string, PluginFlopsFunction> flops{defaultPluginFlops()};
+    return flops;
+}
+
+//!
+//! \return The volume of the tensor for the batch, negative if a dimension past the leading one is dynamic
+//!
+double tensorVolume(const nvinfer1::ITensor& tensor, int batch, bool implicitBatch)
+{
+    const auto dims = tensor.getDimensions();
+    double volume{implicitBatch ? static_cast<double>(batch) : 1};
+    for (int d = 0; d < dims.nbDims; ++d)
+    {
+        if (dims.d[d] < 0 && d)
+        {
+            return -1;
+        }
+        volume *= dims.d[d] < 0 ? batch : dims.d[d];
+    }
+    return volume;
+}
+
+double elementSize(const nvinfer1::ITensor& tensor, nvinfer1::DataType precision)
+{
+    const auto type = tensor.getType();
+    return dataTypeSize(type == nvinfer1::DataType::kFLOAT ? precision : type);
+}
+
+double dimsVolume(const nvinfer1::Dims& dims)
+{
+    double volume{1};
+    for (int d = 0; d < dims.nbDims; ++d)
+    {
+        volume *= dims.d[d];
+    }
+    return volume;
+}
+
+//!
+//! \return The channels of the input of a convolution or deconvolution, in NCHW with or without the batch
+//!
+double inputChannels(const nvinfer1::ILayer& layer, bool implicitBatch)
+{
+    const auto dims = layer.getInput(0)->getDimensions();
+    const int c = implicitBatch ? 0 : 1;
+    return c < dims.nbDims ? dims.d[c] : -1;
+}
+
+struct ProfiledLayer
+{
+    std::string name;
+    double ms{0};
+    LayerCost cost;
+};
+
+} // namespace
+
+void registerPluginFlops(const std::string& pluginType, const PluginFlopsFunction& flops)
+{
+    std::lock_guard<std::mutex> lock(gPluginFlopsMutex);
+    pluginFlops()[pluginType] = flops;
+}
+
+LayerCosts estimateLayerCosts(nvinfer1::INetworkDefinition& network, int batch, nvinfer1::DataType precision)
+{
+    const bool implicitBatch = network.hasImplicitBatchDimension();
+    LayerCosts costs;
+    for (int l = 0; l < network.getNbLayers(); ++l)
+    {
+        auto& layer = *network.getLayer(l);
+        LayerCost cost;
+        bool known{true};
+        double inputVolume{0};
+        for (int i = 0; i < layer.getNbInputs(); ++i)
+        {
+            // Optional inputs are null
+            const auto* tensor = layer.getInput(i);
+            if (!tensor)
+            {
+                continue;
+            }
+            const double volume = tensorVolume(*tensor, batch, implicitBatch);
+            known = known && volume >= 0;
+            inputVolume = std::max(inputVolume, volume);
+            cost.bytes += volume * elementSize(*tensor, precision);
+        }
+        double outputVolume{0};
+        for (int o = 0; o < layer.getNbOutputs(); ++o)
+        {
+            const auto& tensor = *layer.getOutput(o);
+            const double volume = tensorVolume(tensor, batch, implicitBatch);
+            known = known && volume >= 0;
+            outputVolume = o ? outputVolume : volume;
+            cost.bytes += volume * elementSize(tensor, precision);
+        }
+        const double weightSize = dataTypeSize(precision);
+
+        switch (layer.getType())
+        {
+        case nvinfer1::LayerType::kCONVOLUTION:
+        {
+            auto& conv = static_cast<nvinfer1::IConvolutionLayer&>(layer);
+            const double channels = inputChannels(layer, implicitBatch);
+            known = known && channels > 0;
+            cost.flops = 2 * outputVolume * channels / conv.getNbGroups() * dimsVolume(conv.getKernelSizeNd());
+            cost.bytes += conv.getKernelWeights().count * weightSize;
+            break;
+        }
+        case nvinfer1::LayerType::kDECONVOLUTION:
+        {
+            auto& deconv = static_cast<nvinfer1::IDeconvolutionLayer&>(layer);
+            const double maps = deconv.getNbOutputMaps();
+            cost.flops = 2 * inputVolume * maps / deconv.getNbGroups() * dimsVolume(deconv.getKernelSizeNd());
+            cost.bytes += deconv.getKernelWeights().count * weightSize;
+            break;
+        }
+        case nvinfer1::LayerType::kFULLY_CONNECTED:
+        {
+            auto& fc = static_cast<nvinfer1::IFullyConnectedLayer&>(layer);
+            const double weights = fc.getKernelWeights().count;
+            cost.flops = 2 * outputVolume * weights / fc.getNbOutputChannels();
+            cost.bytes += weights * weightSize;
+            break;
+        }
+        case nvinfer1::LayerType::kMATRIX_MULTIPLY:
+        {
+            auto& mm = static_cast<nvinfer1::IMatrixMultiplyLayer&>(layer);
+            const auto a = layer.getInput(0)->getDimensions();
+            const bool transposed = mm.getOperation(0) == nvinfer1::MatrixOperation::kTRANSPOSE;
+            const int k = transposed && a.nbDims > 1 ? a.d[a.nbDims - 2] : a.d[a.nbDims - 1];
+            known = known && k > 0;
+            cost.flops = 2 * outputVolume * k;
+            break;
+        }
+        case nvinfer1::LayerType::kPOOLING:
+        {
+            auto& pool = static_cast<nvinfer1::IPoolingLayer&>(layer);
+            cost.flops = outputVolume * dimsVolume(pool.getWindowSizeNd());
+            break;
+        }
+        case nvinfer1::LayerType::kPLUGIN_V2:
+        {
+            const std::string type = static_cast<nvinfer1::IPluginV2Layer&>(layer).getPlugin().getPluginType();
+            std::lock_guard<std::mutex> lock(gPluginFlopsMutex);
+            const auto flops = pluginFlops().find(type);
+            cost.flops = flops == pluginFlops().end() ? 0 : flops->second(layer, outputVolume);
+            known = known && cost.flops >= 0;
+            break;
+        }
+        case nvinfer1::LayerType::kCONCATENATION:
+        case nvinfer1::LayerType::kCONSTANT:
+        case nvinfer1::LayerType::kGATHER:
+        case nvinfer1::LayerType::kIDENTITY:
+        case nvinfer1::LayerType::kPADDING:
+        case nvinfer1::LayerType::kSHAPE:
+        case nvinfer1::LayerType::kSHUFFLE:
+        case nvinfer1::LayerType::kSLICE: break;
+        default: cost.flops = std::max(inputVolume, outputVolume); break;
+        }
+
+        if (known)
+        {
+            costs[layer.getName()] = cost;
+        }
+    }
+    return costs;
+}
+
+DevicePeaks getDevicePeaks(int device, nvinfer1::DataType precision)
+{
+    cudaDeviceProp properties;
+    if (cudaGetDeviceProperties(&properties, device) != cudaSuccess)
+    {
+        return {};
+    }
+    const int major = properties.major;
+    const int minor = properties.minor;
+    // FP32 lanes per multiprocessor
+    int lanes{64};
+    if (major == 3)
+    {
+        lanes = 192;
+    }
+    else if (major == 5 || (major == 6 && minor) || (major == 8 && minor))
+    {
+        lanes = 128;
+    }
+    int speedup{1};
+    if (precision == nvinfer1::DataType::kHALF)
+    {
+        // Tensor cores from Volta on, packed half arithmetic on GP100 and the Tegra GPUs before
+        speedup = major >= 7 ? 8 : (major == 6 && minor != 1) || (major == 5 && minor == 3) ? 2 : 1;
+    }
+    else if (precision == nvinfer1::DataType::kINT8)
+    {
+        // Integer tensor cores from Turing on, dp4a from GP102 on
+        speedup = major >= 8 || (major == 7 && minor >= 2) ? 16 : (major == 6 && minor) || major == 7 ? 4 : 1;
+    }
+    DevicePeaks peaks;
+    // A multiply-add is two operations per lane and cycle, the clock rates are in kHz
+    peaks.tflops = 2.0 * lanes * speedup * properties.multiProcessorCount * properties.clockRate * 1e3 / 1e12;
+    // Memory clocks transfer twice per cycle
+    peaks.gbps = 2.0 * properties.memoryClockRate * 1e3 * properties.memoryBusWidth / 8 / 1e9;
+    return peaks;
+}
+
+void printRoofline(const Profiler& profiler, const LayerCosts& costs, const DevicePeaks& peaks, std::ostream& os)
+{
+    std::vector<ProfiledLayer> layers;
+    double totalMs{0};
+    double unmatchedMs{0};
+    for (const auto& p : profiler.aggregate())
+    {
+        const double ms = p.timeMs / std::max<size_t>(p.timesMs.size(), 1);
+        totalMs += ms;
+        ProfiledLayer layer;
+        layer.name = p.name;
+        layer.ms = ms;
+        bool matched{false};
+        // Fused layers are named after their parts, separated by " + "
+        const std::string separator{" + "};
+        for (size_t start = 0, end = 0; end != std::string::npos; start = end + separator.size())
+        {
+            end = p.name.find(separator, start);
+            const auto cost = costs.find(p.name.substr(start, end == std::string::npos ? end : end - start));
+            if (cost != costs.end())
+            {
+                layer.cost.flops += cost->second.flops;
+                layer.cost.bytes += cost->second.bytes;
+                matched = true;
+            }
+        }
+        if (matched && ms > 0)
+        {
+            layers.push_back(layer);
+        }
+        else
+        {
+            unmatchedMs += ms;
+        }
+    }
+    if (layers.empty())
+    {
+        return;
+    }
+    std::sort(layers.begin(), layers.end(), [](const ProfiledLayer& a, const ProfiledLayer& b) { return a.ms > b.ms; });
+
+    const double ridge = peaks.gbps > 0 ? peaks.tflops * 1e3 / peaks.gbps : 0;
+    const std::string nameHdr("Layer");
+    const std::string timeHdr("   Time (ms)");
+    const std::string gflopHdr("      GFLOP");
+    const std::string mbHdr("         MB");
+    const std::string intensityHdr("   FLOP/B");
+    const std::string tflopsHdr("   TFLOPS");
+    const std::string gbpsHdr("     GB/s");
+    const std::string boundHdr("    Bound");
+    const std::string roofHdr("   Roof %");
+    const auto longestName = std::max_element(layers.begin(), layers.end(),
+        [](const ProfiledLayer& a, const ProfiledLayer& b) { return a.name.size() < b.name.size(); });
+    const auto nameLength = std::max(longestName->name.size() + 1, nameHdr.size());
+
+    os << std::endl << "=== Roofline (peaks " << std::fixed << std::setprecision(1) << peaks.tflops << " TFLOPS, "
+       << peaks.gbps << " GB/s, ridge " << ridge << " FLOP/B) ===" << std::endl
+       << std::setw(nameLength) << nameHdr << timeHdr << gflopHdr << mbHdr << intensityHdr << tflopsHdr << gbpsHdr
+       << boundHdr << roofHdr << std::endl;
+    for (const auto& l : layers)
+    {
+        const double intensity = l.cost.bytes > 0 ? l.cost.flops / l.cost.bytes : 0;
+        const double tflops = l.cost.flops / (l.ms * 1e9);
+        const double gbps = l.cost.bytes / (l.ms * 1e6);
+        const double attainable = std::min(peaks.tflops, intensity * peaks.gbps / 1e3);
+        const char* bound = intensity < ridge ? "memory" : "compute";
+        // Below the ridge point the share of the roof is the share of the bandwidth
+        const double roof = attainable > 0 ? tflops / attainable : peaks.gbps > 0 ? gbps / peaks.gbps : 0;
+// clang-format off
+        os << std::setw(nameLength)                                                << l.name
+           << std::setw(timeHdr.size())      << std::fixed << std::setprecision(3) << l.ms
+           << std::setw(gflopHdr.size())     << std::fixed << std::setprecision(3) << l.cost.flops / 1e9
+           << std::setw(mbHdr.size())        << std::fixed << std::setprecision(1) << l.cost.bytes / 1e6
+           << std::setw(intensityHdr.size()) << std::fixed << std::setprecision(1) << intensity
+           << std::setw(tflopsHdr.size())    << std::fixed << std::setprecision(2) << tflops
+           << std::setw(gbpsHdr.size())      << std::fixed << std::setprecision(0) << gbps
+           << std::setw(boundHdr.size())                                           << bound
+           << std::setw(roofHdr.size())      << std::fixed << std::setprecision(1) << roof * 100 << std::endl;
+// clang-format on
+    }
+    if (unmatchedMs > 0)
+    {
+        os << "Layers without estimate (reformats, layers with dynamic dimensions): " << std::setprecision(1)
+           << unmatchedMs / totalMs * 100 << "% of the layer time" << std::endl;
+    }
+}
+
+} // namespace sample
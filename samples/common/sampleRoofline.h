@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_ROOFLINE_H
+#define TRT_SAMPLE_ROOFLINE_H
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+class Profiler;
+
+//!
+//! \struct LayerCost
+//! \brief Estimated work of one inference of a network layer
+//!
+struct LayerCost
+{
+    double flops{0}; //!< Floating point, or integer, operations, a multiply-add counting as two
+    double bytes{0}; //!< Bytes of the inputs, outputs and weights, each read or written once
+};
+
+//!
+//! \brief Costs of the layers of a network by layer name
+//!
+using LayerCosts = std::unordered_map<std::string, LayerCost>;
+
+//!
+//! \brief Estimate the operations of a plugin layer, given the volume of its first output with the batch
+//!
+//! \return The operations of the layer, negative if they cannot be estimated from its dimensions
+//!
+using PluginFlopsFunction = std::function<double(nvinfer1::ILayer& layer, double outputVolume)>;
+
+//!
+//! \brief Estimate the operations of the plugins of a type with a function, instead of counting none
+//!
+void registerPluginFlops(const std::string& pluginType, const PluginFlopsFunction& flops);
+
+//!
+//! \brief Estimate the operations and bytes moved by each layer of a network, before it is built
+//!
+//! Convolutions, deconvolutions, fully connected layers and matrix multiplications count their multiply-adds, pooling
+//! its window, plugins what their registered function returns, data movement layers nothing and the other layers one
+//! operation per element. A dynamic leading dimension is taken as the batch, layers with other dynamic dimensions are
+//! left out.
+//!
+//! \param batch The batch of an implicit batch network, or the leading dimension of dynamic explicit batch inputs
+//! \param precision The precision floating point tensors are assumed to run in, for their bytes
+//!
+LayerCosts estimateLayerCosts(nvinfer1::INetworkDefinition& network, int batch, nvinfer1::DataType precision);
+
+//!
+//! \struct DevicePeaks
+//! \brief Peak throughputs of a device, from its properties
+//!
+struct DevicePeaks
+{
+    double tflops{0}; //!< Operations in the given precision, with tensor cores or dp4a where the device has them
+    double gbps{0};   //!< Device memory bandwidth
+};
+
+DevicePeaks getDevicePeaks(int device, nvinfer1::DataType precision);
+
+//!
+//! \brief Print the achieved throughput of each profiled layer against the roofline of the device
+//!
+//! Profiled layers are matched to the network layers by name, fused layers by the names of their parts, and are listed
+//! by decreasing time. A layer is memory bound if its operations per byte are below the ridge point of the device, and
+//! its share of the roof is its throughput over the peak attainable at its operations per byte.
+//!
+void printRoofline(const Profiler& profiler, const LayerCosts& costs, const DevicePeaks& peaks, std::ostream& os);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_ROOFLINE_H
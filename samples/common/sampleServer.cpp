@@ -0,0 +1,701 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleServer.h"
+#include "logger.h"
+#include "sampleInference.h"
+#include "sampleOptions.h"
+
+#if defined(__linux__)
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sampleDevice.h"
+#include "sampleResultCache.h"
+#include "sampleUtils.h"
+#endif
+
+namespace sample
+{
+
+#if defined(__linux__)
+
+namespace
+{
+
+constexpr size_t kTENSOR_ALIGNMENT{256};
+constexpr int kPOLL_MS{200}; // Period at which blocked sockets check for a stop
+
+volatile std::sig_atomic_t gSignaled{0};
+
+void onSignal(int)
+{
+    gSignaled = 1;
+}
+
+const char* typeName(nvinfer1::DataType type)
+{
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT: return "float32";
+    case nvinfer1::DataType::kHALF: return "float16";
+    case nvinfer1::DataType::kINT8: return "int8";
+    case nvinfer1::DataType::kINT32: return "int32";
+    case nvinfer1::DataType::kBOOL: return "bool";
+    }
+    return "unknown";
+}
+
+struct Tensor
+{
+    int binding;
+    bool isInput;
+    size_t offset; // In the region
+    size_t bytes;
+};
+
+//!
+//! \class SharedRegion
+//! \brief The POSIX shared memory object of a client, mapped and registered as pinned memory
+//!
+class SharedRegion
+{
+public:
+    SharedRegion() = default;
+
+    SharedRegion(const SharedRegion&) = delete;
+    SharedRegion& operator=(const SharedRegion&) = delete;
+
+    ~SharedRegion()
+    {
+        close();
+    }
+
+    bool open(const std::string& name, size_t size, std::ostream& err)
+    {
+        close();
+        const int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+        {
+            err << "Could not open shared memory " << name << ": " << std::strerror(errno);
+            return false;
+        }
+        struct stat status;
+        if (fstat(fd, &status) || static_cast<size_t>(status.st_size) < size)
+        {
+            err << "Shared memory " << name << " is smaller than " << size << " bytes";
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            err << "Could not map shared memory " << name << ": " << std::strerror(errno);
+            return false;
+        }
+        const cudaError_t registered = cudaHostRegister(data, size, cudaHostRegisterDefault);
+        if (registered != cudaSuccess)
+        {
+            err << "Could not register shared memory " << name << ": " << cudaGetErrorString(registered);
+            munmap(data, size);
+            return false;
+        }
+        mData = static_cast<char*>(data);
+        mSize = size;
+        return true;
+    }
+
+    void close()
+    {
+        if (mData)
+        {
+            cudaHostUnregister(mData);
+            munmap(mData, mSize);
+            mData = nullptr;
+            mSize = 0;
+        }
+    }
+
+    char* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    char* mData{nullptr};
+    size_t mSize{0};
+};
+
+//! Read size bytes, false on a disconnection, an error or a stop
+bool receive(int fd, void* data, size_t size, const std::atomic<bool>& stop)
+{
+    char* p = static_cast<char*>(data);
+    while (size)
+    {
+        pollfd ready{fd, POLLIN, 0};
+        const int polled = poll(&ready, 1, kPOLL_MS);
+        if (stop || gSignaled || (polled < 0 && errno != EINTR))
+        {
+            return false;
+        }
+        if (polled <= 0)
+        {
+            continue;
+        }
+        const ssize_t n = recv(fd, p, size, 0);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool sendAll(int fd, const void* data, size_t size)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size)
+    {
+        // A client gone before its reply must not raise SIGPIPE
+        const ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool reply(int fd, int32_t status, float computeMs, const std::string& text)
+{
+    ServerReply header;
+    header.status = status;
+    header.computeMs = computeMs;
+    header.replySize = static_cast<uint32_t>(text.size());
+    return sendAll(fd, &header, sizeof(header)) && sendAll(fd, text.data(), text.size());
+}
+
+//!
+//! \class Server
+//! \brief Runs the requests of each connection on a context of the environment it holds while connected
+//!
+class Server
+{
+public:
+    Server(InferenceEnvironment& iEnv, const InferenceOptions& inference)
+        : mEnv(iEnv)
+        , mBatch(inference.batch)
+    {
+        if (inference.resultCache)
+        {
+            int device{0};
+            cudaCheck(cudaGetDevice(&device));
+            mCache.reset(new ResultCache(static_cast<size_t>(inference.resultCache) << 20, device));
+        }
+        const int slots = static_cast<int>(iEnv.context.size());
+        for (int s = 0; s < slots; ++s)
+        {
+            mStreams.emplace_back(new TrtCudaStream(inference.priority));
+            mStarts.emplace_back(new TrtCudaEvent(!inference.spin));
+            mEnds.emplace_back(new TrtCudaEvent(!inference.spin));
+            mFree.push_back(s);
+            describe(s);
+            if (mCache)
+            {
+                // Slots with other shapes or profiles never share their entries
+                mSeeds.push_back(contentHash(mDescriptions[s].data(), mDescriptions[s].size()));
+                const size_t hashes = std::max<size_t>(mTensors[s].size(), 1) * sizeof(uint64_t);
+                mDeviceHashes.emplace_back(new TrtDeviceBuffer(hashes));
+                mHostHashes.emplace_back(new TrtHostBuffer(hashes));
+            }
+        }
+    }
+
+    bool run(const std::string& path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+        {
+            gLogError << "Socket path " << path << " is longer than " << sizeof(address.sun_path) - 1 << " characters"
+                      << std::endl;
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size());
+
+        // Only the socket left by a previous server is replaced, never another file
+        struct stat status;
+        if (!stat(path.c_str(), &status) && S_ISSOCK(status.st_mode))
+        {
+            unlink(path.c_str());
+        }
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address))
+            || listen(listener, SOMAXCONN))
+        {
+            gLogError << "Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+            if (listener >= 0)
+            {
+                ::close(listener);
+            }
+            return false;
+        }
+
+        gSignaled = 0;
+        const auto previousInt = std::signal(SIGINT, onSignal);
+        const auto previousTerm = std::signal(SIGTERM, onSignal);
+        gLogInfo << "Serving on " << path << " with " << mStreams.size() << " contexts" << std::endl;
+
+        while (!mStop && !gSignaled)
+        {
+            pollfd ready{listener, POLLIN, 0};
+            if (poll(&ready, 1, kPOLL_MS) <= 0)
+            {
+                continue;
+            }
+            const int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0)
+            {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                ++mConnections;
+            }
+            std::thread(&Server::serveConnection, this, fd).detach();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStop = true;
+            mCondition.notify_all();
+            mCondition.wait(lock, [this] { return !mConnections; });
+        }
+        ::close(listener);
+        unlink(path.c_str());
+        std::signal(SIGINT, previousInt);
+        std::signal(SIGTERM, previousTerm);
+        gLogInfo << "Served " << mServed << " inferences, " << mFailed << " failed" << std::endl;
+        if (mCache)
+        {
+            gLogInfo << mCache->getStats() << std::endl;
+        }
+        return true;
+    }
+
+private:
+    //! The tensors of the binding set of slot back to back in binding order, each aligned for the copies
+    void describe(int slot)
+    {
+        const Bindings& bindings = *mEnv.bindings[slot];
+        const nvinfer1::IExecutionContext& context = *mEnv.context[slot];
+        const auto names = bindings.getBindings();
+        const std::map<int, std::string> ordered = [&names] {
+            std::map<int, std::string> byIndex;
+            for (const auto& n : names)
+            {
+                byIndex[n.second] = n.first;
+            }
+            return byIndex;
+        }();
+
+        std::vector<Tensor> tensors;
+        std::ostringstream lines;
+        size_t offset{0};
+        for (const auto& b : ordered)
+        {
+            const bool isInput = mEnv.engine->bindingIsInput(b.first);
+            const size_t bytes = bindings.getHostSize(b.first);
+            tensors.push_back({b.first, isInput, offset, bytes});
+            lines << b.second << (isInput ? " input " : " output ") << typeName(bindings.getDataType(b.first)) << " ";
+            const nvinfer1::Dims dims = context.getBindingDimensions(b.first);
+            lines << (mBatch ? std::to_string(mBatch) + (dims.nbDims ? "x" : "") : "");
+            for (int d = 0; d < dims.nbDims; ++d)
+            {
+                lines << (d ? "x" : "") << dims.d[d];
+            }
+            lines << " " << offset << " " << bytes << std::endl;
+            offset += (bytes + kTENSOR_ALIGNMENT - 1) / kTENSOR_ALIGNMENT * kTENSOR_ALIGNMENT;
+        }
+        mTensors.push_back(tensors);
+        mRegionBytes.push_back(offset);
+        mDescriptions.push_back("region " + std::to_string(offset) + "\n" + lines.str());
+    }
+
+    //! \return The slot of a free context, -1 if the server stopped first
+    int acquire()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mStop || !mFree.empty(); });
+        if (mStop)
+        {
+            return -1;
+        }
+        const int slot = mFree.back();
+        mFree.pop_back();
+        return slot;
+    }
+
+    void release(int slot)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFree.push_back(slot);
+        mCondition.notify_all();
+    }
+
+    //! Read an input of slot from the device memory of the client, ready holds the IPC events of the inputs
+    bool bindIpc(int slot, const std::string& name, const ServerIpcInput& input, std::map<int, cudaEvent_t>& ready,
+        std::ostream& err)
+    {
+        Bindings& bindings = *mEnv.bindings[slot];
+        const auto inputs = bindings.getInputBindings();
+        const auto b = inputs.find(name);
+        if (b == inputs.end())
+        {
+            err << "No input " << name;
+            return false;
+        }
+        cudaEvent_t event{nullptr};
+        if (input.hasReady)
+        {
+            const cudaError_t opened = cudaIpcOpenEventHandle(&event, input.ready);
+            if (opened != cudaSuccess)
+            {
+                err << "Could not open the IPC event handle of " << name << ": " << cudaGetErrorString(opened);
+                return false;
+            }
+        }
+        if (!bindings.openIpcInput(b->second, input.memory, input.offset, err))
+        {
+            if (event)
+            {
+                cudaEventDestroy(event);
+            }
+            return false;
+        }
+        auto previous = ready.find(b->second);
+        if (previous != ready.end())
+        {
+            cudaEventDestroy(previous->second);
+            ready.erase(previous);
+        }
+        if (event)
+        {
+            ready[b->second] = event;
+        }
+        return true;
+    }
+
+    void unbindIpc(int slot, std::map<int, cudaEvent_t>& ready)
+    {
+        for (const auto& t : mTensors[slot])
+        {
+            mEnv.bindings[slot]->closeIpcInput(t.binding);
+        }
+        for (const auto& e : ready)
+        {
+            cudaEventDestroy(e.second);
+        }
+        ready.clear();
+    }
+
+    //!
+    //! \brief The key of the inputs of slot in the result cache
+    //!
+    //! The inputs in the region hash on the host, those read from the device memory of the client on the device once
+    //! they are ready, and only their hashes are copied back.
+    //!
+    bool hashInputs(int slot, const SharedRegion& region, const std::map<int, cudaEvent_t>& ready, uint64_t& key)
+    {
+        const Bindings& bindings = *mEnv.bindings[slot];
+        void** buffers = mEnv.bindings[slot]->getDeviceBuffers();
+        TrtCudaStream& stream = *mStreams[slot];
+        auto* deviceHashes = static_cast<uint64_t*>(mDeviceHashes[slot]->get());
+        auto* hostHashes = static_cast<uint64_t*>(mHostHashes[slot]->get());
+        bool ok{true};
+        bool onDevice{false};
+        const auto& tensors = mTensors[slot];
+        for (size_t i = 0; i < tensors.size(); ++i)
+        {
+            const auto& t = tensors[i];
+            if (t.isInput && bindings.isIpcInput(t.binding))
+            {
+                const auto event = ready.find(t.binding);
+                if (event != ready.end())
+                {
+                    ok = ok && cudaStreamWaitEvent(stream.get(), event->second, 0) == cudaSuccess;
+                }
+                contentHashDevice(buffers[t.binding], t.bytes, deviceHashes + i, stream.get());
+                ok = ok && cudaMemcpyAsync(hostHashes + i, deviceHashes + i, sizeof(uint64_t), cudaMemcpyDeviceToHost,
+                    stream.get()) == cudaSuccess;
+                onDevice = true;
+            }
+            else if (t.isInput)
+            {
+                hostHashes[i] = contentHash(region.data() + t.offset, t.bytes);
+            }
+        }
+        if (onDevice)
+        {
+            ok = ok && cudaStreamSynchronize(stream.get()) == cudaSuccess && cudaGetLastError() == cudaSuccess;
+        }
+        key = mSeeds[slot];
+        for (size_t i = 0; i < tensors.size(); ++i)
+        {
+            if (tensors[i].isInput)
+            {
+                key = combineHash(key, hostHashes[i]);
+            }
+        }
+        return ok;
+    }
+
+    bool infer(int slot, const SharedRegion& region, const std::map<int, cudaEvent_t>& ready, float& computeMs)
+    {
+        uint64_t key{0};
+        std::vector<ResultCache::Tensor> outputs;
+        if (mCache)
+        {
+            for (const auto& t : mTensors[slot])
+            {
+                if (!t.isInput)
+                {
+                    outputs.push_back({region.data() + t.offset, t.bytes});
+                }
+            }
+            if (!hashInputs(slot, region, ready, key))
+            {
+                return false;
+            }
+            if (mCache->lookup(key, outputs))
+            {
+                computeMs = 0;
+                return true;
+            }
+        }
+
+        const Bindings& bindings = *mEnv.bindings[slot];
+        void** buffers = mEnv.bindings[slot]->getDeviceBuffers();
+        TrtCudaStream& stream = *mStreams[slot];
+        bool ok{true};
+        for (const auto& t : mTensors[slot])
+        {
+            if (t.isInput && bindings.isIpcInput(t.binding))
+            {
+                // The client records the event once the input is written, on its own stream
+                const auto event = ready.find(t.binding);
+                if (event != ready.end())
+                {
+                    ok = ok && cudaStreamWaitEvent(stream.get(), event->second, 0) == cudaSuccess;
+                }
+            }
+            else if (t.isInput)
+            {
+                ok = ok && cudaMemcpyAsync(buffers[t.binding], region.data() + t.offset, t.bytes,
+                    cudaMemcpyHostToDevice, stream.get()) == cudaSuccess;
+            }
+        }
+        mStarts[slot]->record(stream);
+        nvinfer1::IExecutionContext& context = *mEnv.context[slot];
+        auto compute = [&] {
+            ok = ok
+                && (mBatch ? context.enqueue(mBatch, buffers, stream.get(), nullptr)
+                           : context.enqueueV2(buffers, stream.get(), nullptr));
+        };
+        if (mEnv.sharedMemory)
+        {
+            mEnv.sharedMemory->serialize(stream, compute);
+        }
+        else
+        {
+            compute();
+        }
+        mEnds[slot]->record(stream);
+        for (const auto& t : mTensors[slot])
+        {
+            if (!t.isInput)
+            {
+                ok = ok && cudaMemcpyAsync(region.data() + t.offset, buffers[t.binding], t.bytes,
+                    cudaMemcpyDeviceToHost, stream.get()) == cudaSuccess;
+            }
+        }
+        stream.synchronize();
+        computeMs = *mEnds[slot] - *mStarts[slot];
+        if (ok && mCache)
+        {
+            mCache->insert(key, outputs);
+        }
+        return ok;
+    }
+
+    void serveConnection(int fd)
+    {
+        const int slot = acquire();
+        SharedRegion region;
+        std::map<int, cudaEvent_t> ready; // IPC events of the inputs in device memory of the client
+        ServerRequest request;
+        while (slot >= 0 && receive(fd, &request, sizeof(request), mStop))
+        {
+            const auto type = static_cast<ServerRequestType>(request.type);
+            std::ostringstream err;
+            bool ok{true};
+            float computeMs{0};
+            if (request.magic != kSERVER_MAGIC)
+            {
+                reply(fd, -1, 0, "Not a server request");
+                break;
+            }
+            if (type == ServerRequestType::kREGISTER)
+            {
+                request.name[kSERVER_NAME_SIZE - 1] = '\0';
+                if (request.size < mRegionBytes[slot])
+                {
+                    err << "Region of " << request.size << " bytes, the tensors take " << mRegionBytes[slot];
+                    ok = false;
+                }
+                ok = ok && region.open(request.name, request.size, err);
+            }
+            else if (type == ServerRequestType::kINFER)
+            {
+                if (!region.data())
+                {
+                    err << "No shared memory registered";
+                    ok = false;
+                }
+                else if (!infer(slot, region, ready, computeMs))
+                {
+                    err << "Inference failed";
+                    ok = false;
+                }
+                ++(ok ? mServed : mFailed);
+            }
+            else if (type == ServerRequestType::kBIND_IPC)
+            {
+                ServerIpcInput input;
+                if (request.size != sizeof(input) || !receive(fd, &input, sizeof(input), mStop))
+                {
+                    reply(fd, -1, 0, "Malformed IPC input");
+                    break;
+                }
+                request.name[kSERVER_NAME_SIZE - 1] = '\0';
+                ok = bindIpc(slot, request.name, input, ready, err);
+            }
+            else if (type == ServerRequestType::kSHUTDOWN)
+            {
+                reply(fd, 0, 0, "");
+                mStop = true;
+                break;
+            }
+            else if (type != ServerRequestType::kDESCRIBE)
+            {
+                err << "Unknown request type " << request.type;
+                ok = false;
+            }
+
+            const bool layout = type == ServerRequestType::kDESCRIBE || type == ServerRequestType::kREGISTER;
+            if (!reply(fd, ok ? 0 : -1, computeMs, ok ? (layout ? mDescriptions[slot] : "") : err.str()))
+            {
+                break;
+            }
+        }
+        region.close();
+        ::close(fd);
+        if (slot >= 0)
+        {
+            unbindIpc(slot, ready);
+            release(slot);
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        --mConnections;
+        mCondition.notify_all();
+    }
+
+    InferenceEnvironment& mEnv;
+    int mBatch{0}; // Implicit batch engines only
+    std::vector<std::vector<Tensor>> mTensors;
+    std::vector<size_t> mRegionBytes;
+    std::vector<std::string> mDescriptions;
+    std::vector<std::unique_ptr<TrtCudaStream>> mStreams;
+    std::vector<std::unique_ptr<TrtCudaEvent>> mStarts;
+    std::vector<std::unique_ptr<TrtCudaEvent>> mEnds;
+    std::unique_ptr<ResultCache> mCache;
+    std::vector<uint64_t> mSeeds; // Of the keys of each slot, the hash of its layout
+    std::vector<std::unique_ptr<TrtDeviceBuffer>> mDeviceHashes; // Of the inputs read from client device memory
+    std::vector<std::unique_ptr<TrtHostBuffer>> mHostHashes;     // Of all the inputs, by tensor
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<int> mFree; // Slots of the contexts no connection holds
+    int mConnections{0};
+    std::atomic<bool> mStop{false};
+    std::atomic<unsigned long long> mServed{0};
+    std::atomic<unsigned long long> mFailed{0};
+};
+
+} // namespace
+
+bool serveInference(InferenceEnvironment& iEnv, const InferenceOptions& inference)
+{
+    Server server(iEnv, inference);
+    return server.run(inference.serve);
+}
+
+#else
+
+bool serveInference(InferenceEnvironment& iEnv, const InferenceOptions& inference)
+{
+    gLogError << "The server mode (--serve) requires Unix domain sockets and POSIX shared memory" << std::endl;
+    return false;
+}
+
+#endif
+
+} // namespace sample
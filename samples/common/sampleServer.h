@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_SERVER_H
+#define TRT_SAMPLE_SERVER_H
+
+#include <cstdint>
+#include <string>
+
+#include <cuda_runtime_api.h>
+
+namespace sample
+{
+
+struct InferenceEnvironment;
+struct InferenceOptions;
+
+//!
+//! Protocol of the server mode, in host byte order since clients run on the same machine
+//!
+//! A client sends fixed size requests on the socket and receives a reply for each, followed by replySize bytes of
+//! text. The text of describe and register requests is the layout of the tensors in a shared memory region:
+//!
+//!     region <bytes>
+//!     <name> input|output <type> <dimensions, such as 1x3x224x224> <offset> <bytes>
+//!
+//! with one line per binding, in binding order. Failed requests reply with a negative status and the reason as text.
+//!
+constexpr uint32_t kSERVER_MAGIC{0x53545254}; // "TRTS"
+constexpr int kSERVER_NAME_SIZE{256};
+
+enum class ServerRequestType : uint32_t
+{
+    kDESCRIBE = 0, //!< Reply with the layout of the region
+    kREGISTER = 1, //!< Map the POSIX shared memory object name of size bytes as the region of the connection
+    kINFER = 2,    //!< Copy the inputs from the region, run an inference and copy the outputs back to the region
+    kSHUTDOWN = 3, //!< Stop the server once the connections in progress close
+    kBIND_IPC = 4, //!< Read the input name from the device memory of the client, followed by a ServerIpcInput
+};
+
+struct ServerRequest
+{
+    uint32_t magic{kSERVER_MAGIC};
+    uint32_t type{0};
+    uint64_t size{0};
+    char name[kSERVER_NAME_SIZE]{};
+};
+
+//!
+//! The device memory of an input shared by the client with CUDA IPC, which then skips the host altogether
+//!
+//! The input is at offset bytes into the allocation of memory. If the client creates ready with cudaEventInterprocess
+//! and records it after writing the input, each inference waits for it on the device, otherwise the writes must be
+//! done before the infer request. The input may be written again once the reply of the inference is received, and
+//! stays bound to the device memory until the connection closes.
+//!
+struct ServerIpcInput
+{
+    cudaIpcMemHandle_t memory;
+    cudaIpcEventHandle_t ready;
+    uint64_t offset{0};
+    uint32_t hasReady{0};
+};
+
+struct ServerReply
+{
+    uint32_t magic{kSERVER_MAGIC};
+    int32_t status{0};
+    float computeMs{0}; //!< GPU time of the inference of an infer request
+    uint32_t replySize{0};
+};
+
+//!
+//! \brief Serve inference requests on a Unix domain socket with the contexts of the environment, until a shutdown
+//!        request, SIGINT or SIGTERM
+//!
+//! Each connection holds one of the contexts while it is open, connections above --streams wait for one to be free.
+//! The tensors never pass through the socket: the inputs and outputs of a connection live in a shared memory region
+//! of its client, which the server maps and registers as pinned memory so that the copies to and from the device are
+//! asynchronous DMA transfers. The input shapes are those set up from --shapes.
+//!
+//! With --resultCache, an infer request whose inputs hash like those of a cached inference replies with its outputs,
+//! and a compute time of 0, without running the engine.
+//!
+//! \return False if the socket could not be set up or the platform has no Unix domain sockets
+//!
+bool serveInference(InferenceEnvironment& iEnv, const InferenceOptions& inference);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_SERVER_H
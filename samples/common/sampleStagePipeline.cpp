@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <cuda_runtime_api.h>
+
+#include "logger.h"
+#include "sampleOptions.h"
+#include "sampleRandom.h"
+#include "sampleStagePipeline.h"
+
+using namespace nvinfer1;
+
+namespace sample
+{
+
+namespace
+{
+
+bool isDynamic(const Dims& dims)
+{
+    return std::any_of(dims.d, dims.d + dims.nbDims, [](int dim) { return dim == -1; });
+}
+
+//! Bindings of the first profile, the only one a pipeline stage runs
+int bindingsInProfile(const ICudaEngine& engine)
+{
+    return engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+}
+
+} // namespace
+
+StagePipeline::~StagePipeline()
+{
+    for (const auto& p : mPeersEnabled)
+    {
+        cudaSetDevice(p.first);
+        cudaDeviceDisablePeerAccess(p.second);
+    }
+}
+
+bool StagePipeline::setUp(const std::vector<Stage>& stages, const InferenceOptions& inference, std::ostream& err)
+{
+    mSlots = std::max(inference.depth, 1);
+    mStages.resize(stages.size());
+    const InputShapes noShapes;
+    const auto& shapes = inference.shapes.empty() ? noShapes : inference.shapes[0];
+
+    for (size_t s = 0; s < stages.size(); ++s)
+    {
+        auto& st = mStages[s];
+        st.engine = stages[s].engine;
+        st.device = stages[s].device;
+        cudaCheck(cudaSetDevice(st.device));
+        const ICudaEngine& engine = *st.engine;
+        st.batch = engine.hasImplicitBatchDimension() ? inference.batch : 0;
+        st.context.reset(st.engine->createExecutionContext());
+        if (!st.context)
+        {
+            err << "Stage " << s << " failed to create an execution context" << std::endl;
+            return false;
+        }
+        const int nbBindings = bindingsInProfile(engine);
+
+        // Set all input dimensions before the outputs can be sized
+        for (int b = 0; b < nbBindings; ++b)
+        {
+            if (!engine.bindingIsInput(b))
+            {
+                continue;
+            }
+            const std::string name = engine.getBindingName(b);
+            if (engine.isShapeBinding(b))
+            {
+                err << "Stage " << s << " input " << name << " is a shape tensor, pipeline stages only take execution "
+                    << "tensors" << std::endl;
+                return false;
+            }
+            if (s > 0)
+            {
+                const auto& prev = mStages[s - 1];
+                const int output = prev.engine->getBindingIndex(name.c_str());
+                if (output < 0 || output >= bindingsInProfile(*prev.engine) || prev.engine->bindingIsInput(output))
+                {
+                    err << "Stage " << s << " input " << name << " is not an output of stage " << s - 1 << std::endl;
+                    return false;
+                }
+                if (isDynamic(st.context->getBindingDimensions(b)))
+                {
+                    st.context->setBindingDimensions(b, prev.context->getBindingDimensions(output));
+                }
+                continue;
+            }
+            const auto dims = st.context->getBindingDimensions(b);
+            if (!isDynamic(dims))
+            {
+                continue;
+            }
+            const auto shape = shapes.find(name);
+            Dims staticDims{};
+            if (shape == shapes.end())
+            {
+                constexpr int DEFAULT_DIMENSION = 1;
+                staticDims.nbDims = dims.nbDims;
+                std::transform(dims.d, dims.d + dims.nbDims, staticDims.d,
+                    [&](int dim) { return dim > 0 ? dim : DEFAULT_DIMENSION; });
+                gLogWarning << "Dynamic dimensions required for input: " << name
+                            << ", but no shapes were provided. Automatically overriding shape to: " << staticDims
+                            << std::endl;
+            }
+            else
+            {
+                staticDims = shape->second;
+            }
+            st.context->setBindingDimensions(b, staticDims);
+        }
+        if (!st.context->allInputDimensionsSpecified())
+        {
+            err << "Stage " << s << " has inputs without dimensions" << std::endl;
+            return false;
+        }
+
+        for (int b = 0; b < nbBindings; ++b)
+        {
+            const auto dims = st.context->getBindingDimensions(b);
+            const auto vol = volume(dims, engine.getBindingVectorizedDim(b), engine.getBindingComponentsPerElement(b),
+                st.batch);
+            st.bytes.push_back(vol * dataTypeSize(engine.getBindingDataType(b)));
+        }
+        if (s > 0)
+        {
+            const auto& prev = mStages[s - 1];
+            for (int b = 0; b < nbBindings; ++b)
+            {
+                if (!engine.bindingIsInput(b))
+                {
+                    continue;
+                }
+                const int output = prev.engine->getBindingIndex(engine.getBindingName(b));
+                if (st.bytes[b] != prev.bytes[output])
+                {
+                    err << "Stage " << s << " input " << engine.getBindingName(b) << " takes " << st.bytes[b]
+                        << " bytes, output " << prev.engine->getBindingName(output) << " of stage " << s - 1
+                        << " gives " << prev.bytes[output] << std::endl;
+                    return false;
+                }
+                st.links.push_back({b, output, st.bytes[b]});
+            }
+        }
+
+        st.stream.reset(new TrtCudaStream);
+        st.base.reset(new TrtCudaEvent(!inference.spin));
+        st.buffers.resize(mSlots);
+        st.pointers.resize(mSlots);
+        for (int slot = 0; slot < mSlots; ++slot)
+        {
+            for (int b = 0; b < nbBindings; ++b)
+            {
+                st.buffers[slot].emplace_back(new TrtDeviceBuffer(st.bytes[b]));
+                st.pointers[slot].push_back(st.buffers[slot].back()->get());
+            }
+            st.computeStarts.emplace_back(new TrtCudaEvent(!inference.spin));
+            st.computeEnds.emplace_back(new TrtCudaEvent(!inference.spin));
+            st.transferStarts.emplace_back(new TrtCudaEvent(!inference.spin));
+            st.transferEnds.emplace_back(new TrtCudaEvent(!inference.spin));
+        }
+    }
+
+    // The first stage copies the same random inputs in for every micro-batch, the last copies its outputs out
+    auto& first = mStages.front();
+    cudaCheck(cudaSetDevice(first.device));
+    for (int b = 0; b < bindingsInProfile(*first.engine); ++b)
+    {
+        if (!first.engine->bindingIsInput(b))
+        {
+            mHostInputs.emplace_back();
+            continue;
+        }
+        const auto type = first.engine->getBindingDataType(b);
+        generateRandom(first.pointers[0][b], type, first.bytes[b] / dataTypeSize(type), b, first.stream->get());
+        mHostInputs.emplace_back(new TrtHostBuffer(first.bytes[b]));
+        cudaCheck(cudaMemcpyAsync(mHostInputs[b]->get(), first.pointers[0][b], first.bytes[b], cudaMemcpyDeviceToHost,
+            first.stream->get()));
+    }
+    first.stream->synchronize();
+    for (int slot = 0; slot < mSlots; ++slot)
+    {
+        mInStarts.emplace_back(new TrtCudaEvent(!inference.spin));
+        mInEnds.emplace_back(new TrtCudaEvent(!inference.spin));
+    }
+    auto& last = mStages.back();
+    cudaCheck(cudaSetDevice(last.device));
+    mHostOutputs.resize(mSlots);
+    for (int slot = 0; slot < mSlots; ++slot)
+    {
+        for (int b = 0; b < bindingsInProfile(*last.engine); ++b)
+        {
+            mHostOutputs[slot].emplace_back(
+                last.engine->bindingIsInput(b) ? nullptr : new TrtHostBuffer(last.bytes[b]));
+        }
+    }
+
+    // Without peer access cudaMemcpyPeerAsync still works, staged through host memory by the driver
+    for (size_t s = 0; s + 1 < mStages.size(); ++s)
+    {
+        const int device = mStages[s].device;
+        const int peer = mStages[s + 1].device;
+        int canAccess{0};
+        if (device == peer)
+        {
+            canAccess = 1;
+        }
+        else if (cudaDeviceCanAccessPeer(&canAccess, device, peer) == cudaSuccess && canAccess)
+        {
+            cudaCheck(cudaSetDevice(device));
+            const auto status = cudaDeviceEnablePeerAccess(peer, 0);
+            if (status == cudaSuccess)
+            {
+                mPeersEnabled.emplace_back(device, peer);
+            }
+            else if (status != cudaErrorPeerAccessAlreadyEnabled)
+            {
+                canAccess = 0;
+            }
+            // Clear the sticky error of an access already enabled
+            cudaGetLastError();
+        }
+        mPeerAccess.push_back(canAccess != 0);
+        if (!canAccess)
+        {
+            gLogWarning << "Device " << device << " cannot access device " << peer << ", the outputs of stage " << s
+                        << " are staged through host memory" << std::endl;
+        }
+    }
+
+    return true;
+}
+
+void StagePipeline::issue(int slot)
+{
+    for (size_t s = 0; s < mStages.size(); ++s)
+    {
+        auto& st = mStages[s];
+        cudaCheck(cudaSetDevice(st.device));
+        auto& stream = *st.stream;
+        if (!s)
+        {
+            mInStarts[slot]->record(stream);
+            for (size_t b = 0; b < mHostInputs.size(); ++b)
+            {
+                if (mHostInputs[b])
+                {
+                    cudaCheck(cudaMemcpyAsync(st.pointers[slot][b], mHostInputs[b]->get(), st.bytes[b],
+                        cudaMemcpyHostToDevice, stream.get()));
+                }
+            }
+            mInEnds[slot]->record(stream);
+        }
+        else
+        {
+            stream.wait(*mStages[s - 1].transferEnds[slot]);
+        }
+
+        st.computeStarts[slot]->record(stream);
+        if (st.batch)
+        {
+            st.context->enqueue(st.batch, st.pointers[slot].data(), stream.get(), nullptr);
+        }
+        else
+        {
+            st.context->enqueueV2(st.pointers[slot].data(), stream.get(), nullptr);
+        }
+        st.computeEnds[slot]->record(stream);
+
+        if (s + 1 < mStages.size())
+        {
+            // The next stage must be done with the inputs of the previous micro-batch of the slot before they are
+            // overwritten. The stream of the next stage did not reach this micro-batch yet, so its last compute end
+            // of the slot is the one of the previous micro-batch.
+            auto& next = mStages[s + 1];
+            stream.wait(*next.computeEnds[slot]);
+            st.transferStarts[slot]->record(stream);
+            for (const auto& link : next.links)
+            {
+                cudaCheck(cudaMemcpyPeerAsync(next.pointers[slot][link.input], next.device,
+                    st.pointers[slot][link.output], st.device, link.bytes, stream.get()));
+            }
+            st.transferEnds[slot]->record(stream);
+        }
+        else
+        {
+            st.transferStarts[slot]->record(stream);
+            for (size_t b = 0; b < mHostOutputs[slot].size(); ++b)
+            {
+                if (mHostOutputs[slot][b])
+                {
+                    cudaCheck(cudaMemcpyAsync(mHostOutputs[slot][b]->get(), st.pointers[slot][b], st.bytes[b],
+                        cudaMemcpyDeviceToHost, stream.get()));
+                }
+            }
+            st.transferEnds[slot]->record(stream);
+        }
+    }
+}
+
+float StagePipeline::collect(
+    int slot, int microBatch, std::vector<InferenceTrace>& trace, std::vector<StageTrace>& stageTrace)
+{
+    auto& first = mStages.front();
+    auto& last = mStages.back();
+    last.transferEnds[slot]->synchronize();
+    for (size_t s = 0; s < mStages.size(); ++s)
+    {
+        auto& st = mStages[s];
+        StageTrace t;
+        t.stage = static_cast<int>(s);
+        t.microBatch = microBatch;
+        t.computeStart = *st.computeStarts[slot] - *st.base;
+        t.computeEnd = *st.computeEnds[slot] - *st.base;
+        t.transferStart = *st.transferStarts[slot] - *st.base;
+        t.transferEnd = *st.transferEnds[slot] - *st.base;
+        stageTrace.push_back(t);
+    }
+    const float outEnd = *last.transferEnds[slot] - *last.base;
+    trace.emplace_back(0, *mInStarts[slot] - *first.base, *mInEnds[slot] - *first.base,
+        *first.computeStarts[slot] - *first.base, *last.computeEnds[slot] - *last.base,
+        *last.transferStarts[slot] - *last.base, outEnd);
+    return outEnd;
+}
+
+void StagePipeline::run(
+    const InferenceOptions& inference, std::vector<InferenceTrace>& trace, std::vector<StageTrace>& stageTrace)
+{
+    // The devices time their events from their own start, recorded back to back here to align them
+    for (auto& st : mStages)
+    {
+        cudaCheck(cudaSetDevice(st.device));
+        st.base->record(*st.stream);
+    }
+
+    const float warmupMs = static_cast<float>(inference.warmup);
+    const float maxDurationMs = inference.duration * 1000.F + warmupMs;
+    int counted{0};
+    float durationMs{0};
+    int issued{0};
+    int collected{0};
+    while (counted < inference.iterations || durationMs < maxDurationMs)
+    {
+        const int slot = issued % mSlots;
+        if (issued >= mSlots)
+        {
+            durationMs = collect(slot, collected++, trace, stageTrace);
+            if (durationMs > warmupMs)
+            {
+                ++counted;
+            }
+        }
+        issue(slot);
+        ++issued;
+    }
+    while (collected < issued)
+    {
+        collect(collected % mSlots, collected, trace, stageTrace);
+        ++collected;
+    }
+    cudaCheck(cudaSetDevice(mStages.front().device));
+}
+
+void printPipelineReport(const std::vector<StageTrace>& stageTrace, const std::vector<std::string>& names,
+    const std::vector<int>& devices, const std::vector<bool>& peerAccess, float warmupMs, std::ostream& os)
+{
+    const int nbStages = static_cast<int>(names.size());
+    std::vector<float> compute(nbStages, 0);
+    std::vector<float> transfer(nbStages, 0);
+    std::vector<float> spanStart(nbStages, 0);
+    std::vector<float> spanEnd(nbStages, 0);
+    std::vector<int> count(nbStages, 0);
+    for (const auto& t : stageTrace)
+    {
+        if (t.computeStart < warmupMs)
+        {
+            continue;
+        }
+        const int s = t.stage;
+        spanStart[s] = count[s] ? std::min(spanStart[s], t.computeStart) : t.computeStart;
+        spanEnd[s] = std::max(spanEnd[s], t.transferEnd);
+        compute[s] += t.computeEnd - t.computeStart;
+        transfer[s] += t.transferEnd - t.transferStart;
+        ++count[s];
+    }
+
+    os << "=== Pipeline Stages ===" << std::endl;
+    int bound{0};
+    float boundMs{0};
+    for (int s = 0; s < nbStages; ++s)
+    {
+        const float n = std::max(count[s], 1);
+        const float span = spanEnd[s] - spanStart[s];
+        const float busy = span > 0 ? 100 * (compute[s] + transfer[s]) / span : 0;
+        // The stage that takes the longest per micro-batch paces the whole pipeline once it fills
+        const float stageMs = (compute[s] + transfer[s]) / n;
+        if (stageMs > boundMs)
+        {
+            bound = s;
+            boundMs = stageMs;
+        }
+        const char* link = s + 1 == nbStages ? "to host"
+            : peerAccess[s]                  ? "peer to peer"
+                                             : "staged through host";
+        os << "Stage " << s << " (" << names[s] << ", device " << devices[s] << "): " << count[s]
+           << " micro-batches, compute " << compute[s] / n << " ms, transfer " << transfer[s] / n << " ms (" << link
+           << "), busy " << std::fixed << std::setprecision(1) << busy << std::defaultfloat << std::setprecision(6)
+           << "%" << std::endl;
+    }
+    os << "Throughput bound by stage " << bound << ": " << boundMs << " ms per micro-batch" << std::endl;
+}
+
+void exportJSONStageTrace(const std::vector<StageTrace>& stageTrace, const std::string& fileName)
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    os << "[" << std::endl;
+    const char* sep = "  ";
+    for (const auto& t : stageTrace)
+    {
+        os << sep << "{ ";
+        sep = ", ";
+// clang-format off
+        os << "\"stage\" : "           << t.stage         << sep << "\"microBatch\" : "    << t.microBatch  << sep
+           << "\"startComputeMs\" : "  << t.computeStart  << sep << "\"endComputeMs\" : "  << t.computeEnd  << sep
+           << "\"startTransferMs\" : " << t.transferStart << sep << "\"endTransferMs\" : " << t.transferEnd << sep
+           << "\"computeMs\" : "       << t.computeEnd - t.computeStart << sep
+           << "\"transferMs\" : "      << t.transferEnd - t.transferStart << " }" << std::endl;
+// clang-format on
+    }
+    os << "]" << std::endl;
+}
+
+} // namespace sample
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_STAGE_PIPELINE_H
+#define TRT_SAMPLE_STAGE_PIPELINE_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "NvInfer.h"
+
+#include "sampleDevice.h"
+#include "sampleReporting.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+struct InferenceOptions;
+
+//!
+//! \struct StageTrace
+//! \brief Measurement points of a micro-batch in one stage of a pipeline, in milliseconds from the start of the run
+//!
+struct StageTrace
+{
+    int stage{0};
+    int microBatch{0};
+    float computeStart{0};
+    float computeEnd{0};
+    float transferStart{0}; //!< Copy of the outputs to the next stage, or to the host from the last stage
+    float transferEnd{0};
+};
+
+//!
+//! \class StagePipeline
+//! \brief Engines of the successive segments of a network, each on its own device, run as a pipeline of micro-batches
+//!
+//! The inputs of each stage are the outputs of the previous stage with the same names, copied from device to device
+//! with cudaMemcpyPeerAsync, directly over NVLink or PCIe when the devices can access each other. Every stage has one
+//! set of buffers for each of the --pipelineDepth micro-batches in flight, so that a stage computes the next
+//! micro-batch while the following stage computes the previous one. The stages only wait for each other on their
+//! devices, through events, and the host only waits for the micro-batch whose buffers it reuses next.
+//!
+class StagePipeline
+{
+public:
+    struct Stage
+    {
+        nvinfer1::ICudaEngine* engine;
+        int device;
+    };
+
+    StagePipeline() = default;
+
+    StagePipeline(const StagePipeline&) = delete;
+
+    StagePipeline& operator=(const StagePipeline&) = delete;
+
+    ~StagePipeline();
+
+    //!
+    //! \brief Create the contexts, streams, events and buffers of the stages, on their devices
+    //!
+    //! The dynamic inputs of the first stage take the first shapes of --shapes, those of the next stages the
+    //! dimensions of the outputs they are fed from.
+    //!
+    //! \return False with the reason in err if an input of a stage is not an output of the previous one
+    //!
+    bool setUp(const std::vector<Stage>& stages, const InferenceOptions& inference, std::ostream& err);
+
+    //!
+    //! \brief Run micro-batches back to back for the iterations and duration of the inference options
+    //!
+    //! \param trace A query from the inputs copied to the first stage to the outputs copied from the last stage
+    //! \param stageTrace The compute and transfer of each micro-batch in each stage
+    //!
+    void run(
+        const InferenceOptions& inference, std::vector<InferenceTrace>& trace, std::vector<StageTrace>& stageTrace);
+
+    //! Whether the outputs of each stage are copied directly to the device of the next, rather than through the host
+    const std::vector<bool>& getPeerAccess() const
+    {
+        return mPeerAccess;
+    }
+
+private:
+    struct Link
+    {
+        int input;  //!< Binding of the stage
+        int output; //!< Binding of the previous stage
+        size_t bytes;
+    };
+
+    struct StageState
+    {
+        nvinfer1::ICudaEngine* engine{nullptr};
+        int device{0};
+        int batch{0}; //!< Of implicit batch engines, 0 for explicit batch
+        TrtUniquePtr<nvinfer1::IExecutionContext> context;
+        std::unique_ptr<TrtCudaStream> stream;
+        std::vector<size_t> bytes; //!< Of each binding
+        std::vector<Link> links;   //!< From the previous stage
+        std::vector<std::vector<std::unique_ptr<TrtDeviceBuffer>>> buffers; //!< By slot and binding
+        std::vector<std::vector<void*>> pointers;                           //!< By slot and binding
+        std::unique_ptr<TrtCudaEvent> base;                                 //!< Start of the run on the device
+        std::vector<std::unique_ptr<TrtCudaEvent>> computeStarts;           //!< By slot
+        std::vector<std::unique_ptr<TrtCudaEvent>> computeEnds;
+        std::vector<std::unique_ptr<TrtCudaEvent>> transferStarts;
+        std::vector<std::unique_ptr<TrtCudaEvent>> transferEnds;
+    };
+
+    void issue(int slot);
+
+    //! Wait for the micro-batch of slot to leave the last stage and add it to the traces
+    float collect(int slot, int microBatch, std::vector<InferenceTrace>& trace, std::vector<StageTrace>& stageTrace);
+
+    std::vector<StageState> mStages;
+    int mSlots{0};
+    std::vector<std::unique_ptr<TrtHostBuffer>> mHostInputs;               //!< By binding of the first stage
+    std::vector<std::vector<std::unique_ptr<TrtHostBuffer>>> mHostOutputs; //!< By slot and binding of the last stage
+    std::vector<std::unique_ptr<TrtCudaEvent>> mInStarts;                  //!< By slot, on the first stage
+    std::vector<std::unique_ptr<TrtCudaEvent>> mInEnds;
+    std::vector<bool> mPeerAccess;                  //!< By stage but the last
+    std::vector<std::pair<int, int>> mPeersEnabled; //!< Devices and the peers this pipeline enabled access to
+};
+
+//!
+//! \brief Print the mean compute and transfer time of each stage, the share of the run each stage was busy, and the
+//!        stage that bounds the throughput of the pipeline
+//!
+void printPipelineReport(const std::vector<StageTrace>& stageTrace, const std::vector<std::string>& names,
+    const std::vector<int>& devices, const std::vector<bool>& peerAccess, float warmupMs, std::ostream& os);
+
+//!
+//! \brief Export the stage trace of a pipeline to a JSON file
+//!
+void exportJSONStageTrace(const std::vector<StageTrace>& stageTrace, const std::string& fileName);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_STAGE_PIPELINE_H
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <numeric>
+
+#include <cuda_runtime_api.h>
+#ifndef _MSC_VER
+#include <dlfcn.h>
+#endif
+
+#include "logger.h"
+#include "sampleTelemetry.h"
+
+namespace sample
+{
+
+namespace
+{
+
+// The part of the NVML API used by the sampler and the control, declared here since NVML is loaded at run time
+using nvmlDevice_t = struct nvmlDevice_st*;
+
+constexpr int kNVML_SUCCESS{0};
+constexpr int kNVML_ERROR_NOT_SUPPORTED{3};
+constexpr int kNVML_ERROR_NO_PERMISSION{4};
+constexpr int kNVML_CLOCK_SM{1};
+constexpr int kNVML_CLOCK_MEM{2};
+constexpr int kNVML_TEMPERATURE_GPU{0};
+
+// Throttle reasons that lower the clocks under load, the idle and application clocks reasons are left out
+const std::vector<std::pair<uint64_t, const char*>> kThrottleReasons{{0x4ULL, "power cap"},
+    {0x8ULL, "hardware slowdown"}, {0x10ULL, "sync boost"}, {0x20ULL, "software thermal"},
+    {0x40ULL, "hardware thermal"}, {0x80ULL, "power brake"}};
+
+template <typename T>
+bool loadSymbol(void* library, const char* name, T& symbol)
+{
+#ifdef _MSC_VER
+    symbol = nullptr;
+#else
+    symbol = reinterpret_cast<T>(dlsym(library, name));
+#endif
+    return symbol != nullptr;
+}
+
+} // namespace
+
+bool isThrottled(const TelemetrySample& sample)
+{
+    const auto hasReason = [&sample](const std::pair<uint64_t, const char*>& reason) {
+        return (sample.throttleReasons & reason.first) != 0;
+    };
+    return std::any_of(kThrottleReasons.begin(), kThrottleReasons.end(), hasReason);
+}
+
+struct NvmlLibrary
+{
+    int (*init)(){nullptr};
+    int (*shutdown)(){nullptr};
+    int (*getHandleByPciBusId)(const char*, nvmlDevice_t*){nullptr};
+    int (*getClockInfo)(nvmlDevice_t, int, unsigned int*){nullptr};
+    int (*getPowerUsage)(nvmlDevice_t, unsigned int*){nullptr};
+    int (*getTemperature)(nvmlDevice_t, int, unsigned int*){nullptr};
+    int (*getThrottleReasons)(nvmlDevice_t, unsigned long long*){nullptr};
+    // Control of the power limit and of the clocks, missing from the older drivers
+    int (*getPowerLimit)(nvmlDevice_t, unsigned int*){nullptr};
+    int (*getPowerLimitConstraints)(nvmlDevice_t, unsigned int*, unsigned int*){nullptr};
+    int (*setPowerLimit)(nvmlDevice_t, unsigned int){nullptr};
+    int (*lockGpuClocks)(nvmlDevice_t, unsigned int, unsigned int){nullptr};
+    int (*resetGpuClocks)(nvmlDevice_t){nullptr};
+    const char* (*errorString)(int){nullptr};
+
+    void* library{nullptr};
+    bool initialized{false};
+    std::vector<nvmlDevice_t> devices;
+
+    bool load()
+    {
+#ifndef _MSC_VER
+        library = dlopen("libnvidia-ml.so.1", RTLD_NOW);
+#endif
+        if (!library)
+        {
+            return false;
+        }
+        loadSymbol(library, "nvmlDeviceGetPowerManagementLimit", getPowerLimit);
+        loadSymbol(library, "nvmlDeviceGetPowerManagementLimitConstraints", getPowerLimitConstraints);
+        loadSymbol(library, "nvmlDeviceSetPowerManagementLimit", setPowerLimit);
+        loadSymbol(library, "nvmlDeviceSetGpuLockedClocks", lockGpuClocks);
+        loadSymbol(library, "nvmlDeviceResetGpuLockedClocks", resetGpuClocks);
+        loadSymbol(library, "nvmlErrorString", errorString);
+        return loadSymbol(library, "nvmlInit_v2", init) && loadSymbol(library, "nvmlShutdown", shutdown)
+            && loadSymbol(library, "nvmlDeviceGetHandleByPciBusId_v2", getHandleByPciBusId)
+            && loadSymbol(library, "nvmlDeviceGetClockInfo", getClockInfo)
+            && loadSymbol(library, "nvmlDeviceGetPowerUsage", getPowerUsage)
+            && loadSymbol(library, "nvmlDeviceGetTemperature", getTemperature)
+            && loadSymbol(library, "nvmlDeviceGetCurrentClocksThrottleReasons", getThrottleReasons)
+            && (initialized = init() == kNVML_SUCCESS);
+    }
+
+    //! NVML and CUDA number the devices differently, the PCI bus id identifies them
+    bool addDevice(int device)
+    {
+        char busId[32]{};
+        nvmlDevice_t handle{};
+        if (cudaDeviceGetPCIBusId(busId, sizeof(busId), device) != cudaSuccess
+            || getHandleByPciBusId(busId, &handle) != kNVML_SUCCESS)
+        {
+            return false;
+        }
+        devices.push_back(handle);
+        return true;
+    }
+
+    std::string describe(int status) const
+    {
+        if (status == kNVML_ERROR_NO_PERMISSION)
+        {
+            return "it requires root or administrator permissions";
+        }
+        if (status == kNVML_ERROR_NOT_SUPPORTED)
+        {
+            return "the device does not support it";
+        }
+        return errorString ? errorString(status) : "NVML error " + std::to_string(status);
+    }
+
+    ~NvmlLibrary()
+    {
+        if (initialized)
+        {
+            shutdown();
+        }
+#ifndef _MSC_VER
+        if (library)
+        {
+            dlclose(library);
+        }
+#endif
+    }
+};
+
+TelemetrySampler::TelemetrySampler(std::vector<int> devices, int periodMs)
+    : mDevices(std::move(devices))
+    , mPeriodMs(periodMs)
+{
+}
+
+TelemetrySampler::~TelemetrySampler()
+{
+    stop();
+}
+
+bool TelemetrySampler::start(TimePoint origin)
+{
+    mNvml.reset(new NvmlLibrary);
+    const auto addDevice = [this](int device) { return mNvml->addDevice(device); };
+    if (!mNvml->load() || !std::all_of(mDevices.begin(), mDevices.end(), addDevice))
+    {
+        mNvml.reset();
+        return false;
+    }
+
+    mDone = false;
+    mThread = std::thread(&TelemetrySampler::sample, this, origin);
+    return true;
+}
+
+std::vector<TelemetrySample> TelemetrySampler::stop()
+{
+    if (mThread.joinable())
+    {
+        mDone = true;
+        mThread.join();
+    }
+    mNvml.reset();
+    return std::move(mSamples);
+}
+
+void TelemetrySampler::sample(TimePoint origin)
+{
+    auto next = std::chrono::high_resolution_clock::now();
+    while (!mDone)
+    {
+        for (size_t d = 0; d < mDevices.size(); ++d)
+        {
+            const auto handle = mNvml->devices[d];
+            TelemetrySample s;
+            const auto now = std::chrono::high_resolution_clock::now();
+            s.timeMs = std::chrono::duration<float, std::milli>(now - origin).count();
+            s.device = mDevices[d];
+            // A reading that fails is left at 0
+            mNvml->getClockInfo(handle, kNVML_CLOCK_SM, &s.smClock);
+            mNvml->getClockInfo(handle, kNVML_CLOCK_MEM, &s.memClock);
+            unsigned int milliwatts{0};
+            mNvml->getPowerUsage(handle, &milliwatts);
+            s.power = static_cast<float>(milliwatts) / 1000;
+            mNvml->getTemperature(handle, kNVML_TEMPERATURE_GPU, &s.temperature);
+            unsigned long long reasons{0};
+            mNvml->getThrottleReasons(handle, &reasons);
+            s.throttleReasons = reasons;
+            mSamples.push_back(s);
+        }
+        next += std::chrono::milliseconds(mPeriodMs);
+        std::this_thread::sleep_until(next);
+    }
+}
+
+NvmlControl::NvmlControl(int device)
+    : mDevice(device)
+{
+}
+
+NvmlControl::~NvmlControl()
+{
+    restore();
+}
+
+bool NvmlControl::open(std::ostream& err)
+{
+    mNvml.reset(new NvmlLibrary);
+    if (!mNvml->load() || !mNvml->addDevice(mDevice))
+    {
+        mNvml.reset();
+        err << "NVML is not available for device " << mDevice << std::endl;
+        return false;
+    }
+    if (mNvml->getPowerLimit)
+    {
+        mNvml->getPowerLimit(mNvml->devices.front(), &mPowerLimit);
+    }
+    return true;
+}
+
+bool NvmlControl::setPowerLimit(float watts, std::ostream& err)
+{
+    if (!mNvml || !mNvml->setPowerLimit || !mPowerLimit)
+    {
+        err << "Setting the power limit of device " << mDevice << " is not supported by NVML" << std::endl;
+        return false;
+    }
+    const auto handle = mNvml->devices.front();
+    const auto milliwatts = static_cast<unsigned int>(watts * 1000);
+    unsigned int minLimit{0};
+    unsigned int maxLimit{0};
+    if (mNvml->getPowerLimitConstraints
+        && mNvml->getPowerLimitConstraints(handle, &minLimit, &maxLimit) == kNVML_SUCCESS
+        && (milliwatts < minLimit || milliwatts > maxLimit))
+    {
+        err << "Power limit " << watts << " W is out of the range of device " << mDevice << ", " << minLimit / 1000
+            << " to " << maxLimit / 1000 << " W" << std::endl;
+        return false;
+    }
+    const int status = mNvml->setPowerLimit(handle, milliwatts);
+    if (status != kNVML_SUCCESS)
+    {
+        err << "Could not set the power limit of device " << mDevice << " to " << watts << " W, "
+            << mNvml->describe(status) << std::endl;
+        return false;
+    }
+    mLimitChanged = true;
+    return true;
+}
+
+bool NvmlControl::lockSmClock(unsigned int mhz, std::ostream& err)
+{
+    if (!mNvml || !mNvml->lockGpuClocks || !mNvml->resetGpuClocks)
+    {
+        err << "Locking the clocks of device " << mDevice << " is not supported by NVML" << std::endl;
+        return false;
+    }
+    const int status = mNvml->lockGpuClocks(mNvml->devices.front(), mhz, mhz);
+    if (status != kNVML_SUCCESS)
+    {
+        err << "Could not lock the SM clock of device " << mDevice << " at " << mhz << " MHz, "
+            << mNvml->describe(status) << std::endl;
+        return false;
+    }
+    mClocksLocked = true;
+    return true;
+}
+
+void NvmlControl::restore()
+{
+    if (!mNvml)
+    {
+        return;
+    }
+    const auto handle = mNvml->devices.front();
+    if (mLimitChanged && mNvml->setPowerLimit(handle, mPowerLimit) != kNVML_SUCCESS)
+    {
+        gLogWarning << "Could not restore the power limit of device " << mDevice << " to " << getPowerLimit() << " W"
+                    << std::endl;
+    }
+    if (mClocksLocked && mNvml->resetGpuClocks(handle) != kNVML_SUCCESS)
+    {
+        gLogWarning << "Could not unlock the clocks of device " << mDevice << std::endl;
+    }
+    mLimitChanged = false;
+    mClocksLocked = false;
+}
+
+void printTelemetryReport(const std::vector<TelemetrySample>& samples, float warmupMs, std::ostream& os)
+{
+    std::map<int, std::vector<TelemetrySample>> devices;
+    for (const auto& s : samples)
+    {
+        if (s.timeMs >= warmupMs)
+        {
+            devices[s.device].push_back(s);
+        }
+    }
+
+    for (const auto& d : devices)
+    {
+        const auto& deviceSamples = d.second;
+        const auto begin = deviceSamples.begin();
+        const auto end = deviceSamples.end();
+        const float count = static_cast<float>(deviceSamples.size());
+
+        const auto cmpSmClock = [](const TelemetrySample& a, const TelemetrySample& b) {
+            return a.smClock < b.smClock;
+        };
+        const auto cmpPower = [](const TelemetrySample& a, const TelemetrySample& b) { return a.power < b.power; };
+        const auto cmpTemperature = [](const TelemetrySample& a, const TelemetrySample& b) {
+            return a.temperature < b.temperature;
+        };
+        const auto addSmClock = [](float sum, const TelemetrySample& s) { return sum + s.smClock; };
+        const auto addMemClock = [](float sum, const TelemetrySample& s) { return sum + s.memClock; };
+        const auto addPower = [](float sum, const TelemetrySample& s) { return sum + s.power; };
+        const auto clocks = std::minmax_element(begin, end, cmpSmClock);
+        const float smClockMean = std::accumulate(begin, end, 0.0F, addSmClock) / count;
+        const float memClockMean = std::accumulate(begin, end, 0.0F, addMemClock) / count;
+        const float powerMean = std::accumulate(begin, end, 0.0F, addPower) / count;
+        const float powerMax = std::max_element(begin, end, cmpPower)->power;
+        const unsigned int temperatureMax = std::max_element(begin, end, cmpTemperature)->temperature;
+
+        const float throttled = std::count_if(begin, end, isThrottled) / count * 100;
+
+// clang-format off
+        os << "Telemetry of device "  << d.first << " (" << deviceSamples.size() << " samples)"         << std::endl <<
+              "SM clock: min "        << clocks.first->smClock  << " MHz, "
+              "max "                  << clocks.second->smClock << " MHz, "
+              "mean "                 << smClockMean            << " MHz"                               << std::endl <<
+              "memory clock: mean "   << memClockMean           << " MHz"                               << std::endl <<
+              "power: mean "          << powerMean              << " W, "
+              "max "                  << powerMax               << " W"                                 << std::endl <<
+              "temperature: max "     << temperatureMax         << " C"                                 << std::endl <<
+              "throttled: "           << throttled              << "% of the time";
+// clang-format on
+        const char* sep = " (";
+        for (const auto& reason : kThrottleReasons)
+        {
+            const auto hasReason = [&reason](const TelemetrySample& s) {
+                return (s.throttleReasons & reason.first) != 0;
+            };
+            const float share = std::count_if(begin, end, hasReason) / count * 100;
+            if (share > 0)
+            {
+                os << sep << reason.second << " " << share << "%";
+                sep = ", ";
+            }
+        }
+        os << (throttled > 0 ? ")" : "") << std::endl;
+    }
+}
+
+//! Printed format:
+//! [ value, ...]
+//! value ::= { "time" : time, "device" : device, "SM clock" : MHz, "memory clock" : MHz, "power" : W,
+//!             "temperature" : C, "throttle reasons" : mask }
+//!
+void exportJSONTelemetry(const std::vector<TelemetrySample>& samples, const std::string& fileName)
+{
+    std::ofstream os(fileName, std::ofstream::trunc);
+    os << "[" << std::endl;
+    const char* sep = "  ";
+    for (const auto& s : samples)
+    {
+        os << sep << "{ ";
+        sep = ", ";
+// clang-format off
+        os << "\"timeMs\" : "          << s.timeMs      << sep << "\"device\" : "          << s.device          << sep
+           << "\"smClockMHz\" : "      << s.smClock     << sep << "\"memClockMHz\" : "     << s.memClock        << sep
+           << "\"powerW\" : "          << s.power       << sep << "\"temperatureC\" : "    << s.temperature     << sep
+           << "\"throttleReasons\" : " << s.throttleReasons << " }"                                       << std::endl;
+// clang-format on
+    }
+    os << "]" << std::endl;
+}
+
+} // namespace sample
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_TELEMETRY_H
+#define TRT_SAMPLE_TELEMETRY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sample
+{
+
+//!
+//! \struct TelemetrySample
+//! \brief NVML readings of one device at one time
+//!
+struct TelemetrySample
+{
+    float timeMs{0};             // Host clock, from the host issuing the start event, like the trace enqueue times
+    int device{0};               // CUDA device index
+    unsigned int smClock{0};     // MHz
+    unsigned int memClock{0};    // MHz
+    float power{0};              // W
+    unsigned int temperature{0}; // C
+    uint64_t throttleReasons{0}; // NVML clocks throttle reasons bit mask
+};
+
+//!
+//! \return True if the clocks of the sample were lowered for power, thermal or hardware reasons
+//!
+bool isThrottled(const TelemetrySample& sample);
+
+//! NVML, loaded at run time
+struct NvmlLibrary;
+
+//!
+//! \class TelemetrySampler
+//! \brief Thread sampling the clocks, power, temperature and throttle reasons of devices with NVML
+//!
+//! NVML is loaded at run time, so that trtexec neither links nor requires it. Without NVML the sampler does not start.
+//!
+class TelemetrySampler
+{
+public:
+    using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+    TelemetrySampler(std::vector<int> devices, int periodMs);
+
+    ~TelemetrySampler();
+
+    TelemetrySampler(const TelemetrySampler&) = delete;
+    TelemetrySampler& operator=(const TelemetrySampler&) = delete;
+
+    //!
+    //! \brief Start sampling, the sample times are relative to origin
+    //!
+    //! \return False if NVML or one of the devices is not available
+    //!
+    bool start(TimePoint origin);
+
+    //!
+    //! \return The samples of all the devices in time order
+    //!
+    std::vector<TelemetrySample> stop();
+
+private:
+    void sample(TimePoint origin);
+
+    std::vector<int> mDevices;
+    int mPeriodMs{0};
+    std::unique_ptr<NvmlLibrary> mNvml;
+    std::vector<TelemetrySample> mSamples;
+    std::atomic<bool> mDone{false};
+    std::thread mThread;
+};
+
+//!
+//! \class NvmlControl
+//! \brief Power limit and locked SM clocks of a device, set with NVML and restored when destroyed
+//!
+//! Setting either usually requires root or administrator permissions, and some devices support neither.
+//!
+class NvmlControl
+{
+public:
+    explicit NvmlControl(int device);
+
+    ~NvmlControl();
+
+    NvmlControl(const NvmlControl&) = delete;
+    NvmlControl& operator=(const NvmlControl&) = delete;
+
+    //!
+    //! \brief Load NVML and read the power limit of the device, the one restored
+    //!
+    //! \return False with the reason in err if NVML or the device is not available
+    //!
+    bool open(std::ostream& err);
+
+    //!
+    //! \return False with the reason in err if the limit is out of the range of the device or cannot be set
+    //!
+    bool setPowerLimit(float watts, std::ostream& err);
+
+    //!
+    //! \brief Lock the SM clock of the device at mhz, or the closest clock the device supports
+    //!
+    //! \return False with the reason in err if the clocks cannot be locked
+    //!
+    bool lockSmClock(unsigned int mhz, std::ostream& err);
+
+    //!
+    //! \brief Set back the power limit read by open and unlock the clocks, if either was changed
+    //!
+    void restore();
+
+    //! W, 0 if unknown
+    float getPowerLimit() const
+    {
+        return static_cast<float>(mPowerLimit) / 1000;
+    }
+
+private:
+    int mDevice{0};
+    std::unique_ptr<NvmlLibrary> mNvml;
+    unsigned int mPowerLimit{0}; // mW
+    bool mLimitChanged{false};
+    bool mClocksLocked{false};
+};
+
+//!
+//! \brief Print for each device the clocks, power and temperature, and the share of the time it was throttled
+//!
+//! \param warmupMs Samples before the end of the warmup are left out
+//!
+void printTelemetryReport(const std::vector<TelemetrySample>& samples, float warmupMs, std::ostream& os);
+
+//!
+//! \brief Export the samples to a JSON file
+//!
+void exportJSONTelemetry(const std::vector<TelemetrySample>& samples, const std::string& fileName);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_TELEMETRY_H
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <fstream>
+
+#include "sampleDevice.h"
+#include "sampleRandom.h"
+#include "sampleTiling.h"
+#include "sampleUtils.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//! Tiles step by their size less the overlap, the last one is aligned with the far edge of the image
+std::vector<int> tilePositions(int size, int tile, int overlap)
+{
+    std::vector<int> positions;
+    for (int p = 0;; p += tile - overlap)
+    {
+        positions.push_back(std::min(p, size - tile));
+        if (p + tile >= size)
+        {
+            break;
+        }
+    }
+    return positions;
+}
+
+//! Weight of the pixel i of a tile of size pixels, ramping up linearly over the ramp pixels of each edge
+float rampWeight(int i, int size, int ramp)
+{
+    return std::min(1.F, static_cast<float>(std::min(i, size - 1 - i) + 1) / (ramp + 1));
+}
+
+template <typename T>
+void copyToDevice(T*& device, const std::vector<T>& host)
+{
+    cudaCheck(cudaMalloc(reinterpret_cast<void**>(&device), std::max<size_t>(host.size(), 1) * sizeof(T)));
+    cudaCheck(cudaMemcpy(device, host.data(), host.size() * sizeof(T), cudaMemcpyHostToDevice));
+}
+
+} // namespace
+
+TiledInference::~TiledInference()
+{
+    for (void* p : {static_cast<void*>(mImage), static_cast<void*>(mSums), static_cast<void*>(mWeights),
+             static_cast<void*>(mMask), static_cast<void*>(mInputOrigins), static_cast<void*>(mOutputOrigins)})
+    {
+        cudaFree(p);
+    }
+    for (auto* o : mOutputs)
+    {
+        cudaFree(o);
+    }
+    for (auto* o : mHostOutputs)
+    {
+        cudaFreeHost(o);
+    }
+}
+
+bool TiledInference::setUp(const nvinfer1::IExecutionContext& context, const std::vector<Bindings*>& bindings,
+    int batch, int height, int width, int overlap, const std::string& fileName, std::ostream& err)
+{
+    const auto& engine = context.getEngine();
+    const auto inputs = bindings.front()->getInputBindings();
+    const auto outputs = bindings.front()->getOutputBindings();
+    if (inputs.size() != 1 || outputs.size() != 1)
+    {
+        err << "Tiled inference requires an engine with one input and one output" << std::endl;
+        return false;
+    }
+    mInput = inputs.begin()->second;
+    mOutput = outputs.begin()->second;
+    mOutputName = outputs.begin()->first;
+    for (const int b : {mInput, mOutput})
+    {
+        if (engine.getBindingDataType(b) != nvinfer1::DataType::kFLOAT || engine.getBindingVectorizedDim(b) != -1)
+        {
+            err << "Tiled inference requires FP32 linear bindings, binding " << engine.getBindingName(b) << " is not"
+                << std::endl;
+            return false;
+        }
+    }
+
+    // CHW tiles, after the batch dimension of explicit batch engines
+    const int first = engine.hasImplicitBatchDimension() ? 0 : 1;
+    const auto in = context.getBindingDimensions(mInput);
+    const auto out = context.getBindingDimensions(mOutput);
+    if (in.nbDims != first + 3 || out.nbDims != first + 3 || (first && in.d[0] != out.d[0]))
+    {
+        err << "Tiled inference requires CHW input and output tiles, with the same batch dimension in explicit batch"
+            << std::endl;
+        return false;
+    }
+    mBatch = first ? in.d[0] : batch;
+    mChannels = in.d[first];
+    mTileHeight = in.d[first + 1];
+    mTileWidth = in.d[first + 2];
+    mOutputChannels = out.d[first];
+    mScale = out.d[first + 1] / mTileHeight;
+    if (mScale < 1 || out.d[first + 1] != mScale * mTileHeight || out.d[first + 2] != mScale * mTileWidth)
+    {
+        err << "Tiled inference requires output tiles of the size of the input tiles times an integer scale, not "
+            << out << " for " << in << std::endl;
+        return false;
+    }
+    if (height < mTileHeight || width < mTileWidth)
+    {
+        err << "The image of " << height << "x" << width << " is smaller than a tile of " << mTileHeight << "x"
+            << mTileWidth << std::endl;
+        return false;
+    }
+    if (overlap < 0 || overlap >= std::min(mTileHeight, mTileWidth))
+    {
+        err << "The tile overlap of " << overlap << " is not in [0, " << std::min(mTileHeight, mTileWidth) << ")"
+            << std::endl;
+        return false;
+    }
+    mHeight = height;
+    mWidth = width;
+    mOutputHeight = height * mScale;
+    mOutputWidth = width * mScale;
+
+    for (const int y : tilePositions(height, mTileHeight, overlap))
+    {
+        for (const int x : tilePositions(width, mTileWidth, overlap))
+        {
+            mOrigins.push_back(y);
+            mOrigins.push_back(x);
+        }
+    }
+    std::vector<int> outputOrigins(mOrigins.size());
+    std::transform(mOrigins.begin(), mOrigins.end(), outputOrigins.begin(), [this](int o) { return o * mScale; });
+
+    // Every output pixel is covered by at least one tile, with a weight of at least 1 / (ramp + 1)
+    const int tileHeight = mTileHeight * mScale;
+    const int tileWidth = mTileWidth * mScale;
+    const int ramp = overlap * mScale;
+    std::vector<float> mask(static_cast<size_t>(tileHeight) * tileWidth);
+    for (int y = 0; y < tileHeight; ++y)
+    {
+        for (int x = 0; x < tileWidth; ++x)
+        {
+            mask[y * tileWidth + x] = rampWeight(y, tileHeight, ramp) * rampWeight(x, tileWidth, ramp);
+        }
+    }
+    std::vector<float> weights(static_cast<size_t>(mOutputHeight) * mOutputWidth);
+    for (size_t t = 0; t < outputOrigins.size(); t += 2)
+    {
+        for (int y = 0; y < tileHeight; ++y)
+        {
+            for (int x = 0; x < tileWidth; ++x)
+            {
+                weights[static_cast<size_t>(outputOrigins[t] + y) * mOutputWidth + outputOrigins[t + 1] + x]
+                    += mask[y * tileWidth + x];
+            }
+        }
+    }
+    copyToDevice(mMask, mask);
+    copyToDevice(mWeights, weights);
+    copyToDevice(mInputOrigins, mOrigins);
+    copyToDevice(mOutputOrigins, outputOrigins);
+
+    const size_t imageCount = static_cast<size_t>(mChannels) * height * width;
+    if (fileName.empty())
+    {
+        cudaCheck(cudaMalloc(reinterpret_cast<void**>(&mImage), imageCount * sizeof(float)));
+        generateRandom(mImage, nvinfer1::DataType::kFLOAT, imageCount, kINPUT_SEED, nullptr);
+        cudaCheck(cudaStreamSynchronize(nullptr));
+    }
+    else
+    {
+        std::vector<float> image(imageCount);
+        std::ifstream file(fileName, std::ios::in | std::ios::binary);
+        if (!file.read(reinterpret_cast<char*>(image.data()), imageCount * sizeof(float)))
+        {
+            err << "File " << fileName << " does not hold the " << mChannels << "x" << height << "x" << width
+                << " FP32 values of the image" << std::endl;
+            return false;
+        }
+        copyToDevice(mImage, image);
+    }
+
+    const size_t outputBytes = static_cast<size_t>(mOutputChannels) * mOutputHeight * mOutputWidth * sizeof(float);
+    cudaCheck(cudaMalloc(reinterpret_cast<void**>(&mSums), outputBytes));
+    for (size_t s = 0; s < bindings.size(); ++s)
+    {
+        mOutputs.push_back(nullptr);
+        mHostOutputs.push_back(nullptr);
+        cudaCheck(cudaMalloc(reinterpret_cast<void**>(&mOutputs.back()), outputBytes));
+        cudaCheck(cudaMallocHost(reinterpret_cast<void**>(&mHostOutputs.back()), outputBytes));
+    }
+    return true;
+}
+
+void TiledInference::begin(cudaStream_t stream)
+{
+    const size_t outputBytes = static_cast<size_t>(mOutputChannels) * mOutputHeight * mOutputWidth * sizeof(float);
+    cudaCheck(cudaMemsetAsync(mSums, 0, outputBytes, stream));
+}
+
+void TiledInference::cut(int group, void* const* buffers, cudaStream_t stream) const
+{
+    const int first = group * mBatch;
+    cutTiles(mImage, mChannels, mHeight, mWidth, mInputOrigins + 2 * first, std::min(mBatch, getTiles() - first),
+        mTileHeight, mTileWidth, static_cast<float*>(buffers[mInput]), stream);
+}
+
+void TiledInference::blend(int group, void* const* buffers, cudaStream_t stream)
+{
+    // Past the last tile, the outputs of a partial batch are left out
+    const int first = group * mBatch;
+    blendTiles(static_cast<const float*>(buffers[mOutput]), mOutputChannels, mTileHeight * mScale,
+        mTileWidth * mScale, mMask, mOutputOrigins + 2 * first, std::min(mBatch, getTiles() - first), mOutputHeight,
+        mOutputWidth, mSums, stream);
+}
+
+void TiledInference::finish(int slot, cudaStream_t stream)
+{
+    normalizeTiles(mSums, mWeights, mOutputChannels, mOutputHeight * mOutputWidth, mOutputs[slot], stream);
+}
+
+void TiledInference::outputToHost(int slot, cudaStream_t stream)
+{
+    const size_t outputBytes = static_cast<size_t>(mOutputChannels) * mOutputHeight * mOutputWidth * sizeof(float);
+    cudaCheck(cudaMemcpyAsync(mHostOutputs[slot], mOutputs[slot], outputBytes, cudaMemcpyDeviceToHost, stream));
+    mLastSlot = slot;
+}
+
+void TiledInference::dumpOutputDimensions(std::ostream& os) const
+{
+    os << mOutputChannels << "x" << mOutputHeight << "x" << mOutputWidth;
+}
+
+void TiledInference::dumpOutputValues(std::ostream& os, const std::string& separator) const
+{
+    dumpBuffer<float>(mHostOutputs[mLastSlot], mOutputChannels * mOutputHeight * mOutputWidth, separator, os);
+}
+
+} // namespace sample
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleTiling.h"
+#include <algorithm>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kTHREADS{256};
+constexpr int kMAX_BLOCKS{1024};
+
+int blocksFor(size_t count)
+{
+    return static_cast<int>(std::min<size_t>((count + kTHREADS - 1) / kTHREADS, kMAX_BLOCKS));
+}
+
+//! Grid-stride loop over the values of the tiles, consecutive threads read consecutive columns of the image
+__global__ void cutTilesKernel(const float* image, int channels, int height, int width, const int* origins,
+    int count, int tileHeight, int tileWidth, float* tiles)
+{
+    const size_t tileSize = static_cast<size_t>(channels) * tileHeight * tileWidth;
+    const size_t total = tileSize * count;
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < total;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const int n = static_cast<int>(i / tileSize);
+        const size_t r = i % tileSize;
+        const int c = static_cast<int>(r / (tileHeight * tileWidth));
+        const int y = static_cast<int>(r / tileWidth % tileHeight);
+        const int x = static_cast<int>(r % tileWidth);
+        tiles[i] = image[(static_cast<size_t>(c) * height + origins[2 * n] + y) * width + origins[2 * n + 1] + x];
+    }
+}
+
+//! The tiles of a group overlap each other, their weighted values are added atomically
+__global__ void blendTilesKernel(const float* tiles, int channels, int tileHeight, int tileWidth, const float* mask,
+    const int* origins, int count, int height, int width, float* sums)
+{
+    const size_t tileSize = static_cast<size_t>(channels) * tileHeight * tileWidth;
+    const size_t total = tileSize * count;
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < total;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const int n = static_cast<int>(i / tileSize);
+        const size_t r = i % tileSize;
+        const int c = static_cast<int>(r / (tileHeight * tileWidth));
+        const int y = static_cast<int>(r / tileWidth % tileHeight);
+        const int x = static_cast<int>(r % tileWidth);
+        atomicAdd(&sums[(static_cast<size_t>(c) * height + origins[2 * n] + y) * width + origins[2 * n + 1] + x],
+            tiles[i] * mask[y * tileWidth + x]);
+    }
+}
+
+__global__ void normalizeTilesKernel(const float* sums, const float* weights, int channels, int pixels, float* image)
+{
+    const size_t total = static_cast<size_t>(channels) * pixels;
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < total;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        image[i] = sums[i] / weights[i % pixels];
+    }
+}
+
+} // namespace
+
+void cutTiles(const float* image, int channels, int height, int width, const int* origins, int count, int tileHeight,
+    int tileWidth, float* tiles, cudaStream_t stream)
+{
+    const size_t total = static_cast<size_t>(count) * channels * tileHeight * tileWidth;
+    if (total)
+    {
+        cutTilesKernel<<<blocksFor(total), kTHREADS, 0, stream>>>(
+            image, channels, height, width, origins, count, tileHeight, tileWidth, tiles);
+    }
+}
+
+void blendTiles(const float* tiles, int channels, int tileHeight, int tileWidth, const float* mask, const int* origins,
+    int count, int height, int width, float* sums, cudaStream_t stream)
+{
+    const size_t total = static_cast<size_t>(count) * channels * tileHeight * tileWidth;
+    if (total)
+    {
+        blendTilesKernel<<<blocksFor(total), kTHREADS, 0, stream>>>(
+            tiles, channels, tileHeight, tileWidth, mask, origins, count, height, width, sums);
+    }
+}
+
+void normalizeTiles(
+    const float* sums, const float* weights, int channels, int pixels, float* image, cudaStream_t stream)
+{
+    const size_t total = static_cast<size_t>(channels) * pixels;
+    if (total)
+    {
+        normalizeTilesKernel<<<blocksFor(total), kTHREADS, 0, stream>>>(sums, weights, channels, pixels, image);
+    }
+}
+
+} // namespace sample
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_TILING_H
+#define TRT_SAMPLE_TILING_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+class Bindings;
+
+//!
+//! \brief Copy count tiles of tileHeight x tileWidth out of a CHW image into consecutive CHW tiles
+//!
+//! \param origins The row and column of the top left corner of each tile, interleaved, in device memory
+//!
+void cutTiles(const float* image, int channels, int height, int width, const int* origins, int count, int tileHeight,
+    int tileWidth, float* tiles, cudaStream_t stream);
+
+//!
+//! \brief Add count CHW tiles, weighted by a tileHeight x tileWidth mask, into the sums of a CHW image
+//!
+void blendTiles(const float* tiles, int channels, int tileHeight, int tileWidth, const float* mask, const int* origins,
+    int count, int height, int width, float* sums, cudaStream_t stream);
+
+//!
+//! \brief Divide the sums of a CHW image by the sum of the weights of each of its pixels
+//!
+void normalizeTiles(
+    const float* sums, const float* weights, int channels, int pixels, float* image, cudaStream_t stream);
+
+//!
+//! \class TiledInference
+//! \brief Runs an image larger than the input of an engine as overlapping tiles, cut and blended on the device
+//!
+//! The image stays in device memory. Each query cuts its tiles into the input binding, a batch of tiles per enqueue,
+//! and adds the output tiles into a sum image, weighted by a mask that ramps down over the overlap, so that the seams
+//! blend. The sums are divided by the weights of each pixel into the output image of the binding set, which is then
+//! the only copy to the host. Outputs with a spatial size that is a multiple of the input, as of super-resolution,
+//! make an output image as many times larger.
+//!
+class TiledInference
+{
+public:
+    TiledInference() = default;
+
+    ~TiledInference();
+
+    TiledInference(const TiledInference&) = delete;
+    TiledInference& operator=(const TiledInference&) = delete;
+
+    //!
+    //! \brief Lay out the tiles of an image of height x width over the input of the context, overlapping by overlap
+    //!        pixels, and allocate an output image for each binding set
+    //!
+    //! \param batch The batch of an implicit batch context, 0 to take it from the input dimensions
+    //! \param fileName Raw FP32 CHW values of the image, random values if empty
+    //!
+    //! \return False with the reason in err if the context does not have one FP32 linear input and one such output, or
+    //!         the image is smaller than a tile
+    //!
+    bool setUp(const nvinfer1::IExecutionContext& context, const std::vector<Bindings*>& bindings, int batch,
+        int height, int width, int overlap, const std::string& fileName, std::ostream& err);
+
+    int getTiles() const
+    {
+        return static_cast<int>(mOrigins.size() / 2);
+    }
+
+    //!
+    //! \return The enqueues of an image, one per batch of tiles
+    //!
+    int getGroups() const
+    {
+        return (getTiles() + mBatch - 1) / mBatch;
+    }
+
+    int getBatch() const
+    {
+        return mBatch;
+    }
+
+    //!
+    //! \brief Clear the sums of the image of the next query
+    //!
+    void begin(cudaStream_t stream);
+
+    //!
+    //! \brief Cut the tiles of a group into the input of the device buffers of a binding set
+    //!
+    void cut(int group, void* const* buffers, cudaStream_t stream) const;
+
+    //!
+    //! \brief Add the output tiles of a group from the device buffers of a binding set into the sums
+    //!
+    void blend(int group, void* const* buffers, cudaStream_t stream);
+
+    //!
+    //! \brief Divide the sums into the output image of binding set slot
+    //!
+    void finish(int slot, cudaStream_t stream);
+
+    //!
+    //! \brief Copy the output image of binding set slot to the host, where it is the image printed by the dumps
+    //!
+    void outputToHost(int slot, cudaStream_t stream);
+
+    const std::string& getOutputName() const
+    {
+        return mOutputName;
+    }
+
+    //!
+    //! \brief Print the CHW dimensions of the output image
+    //!
+    void dumpOutputDimensions(std::ostream& os) const;
+
+    //!
+    //! \brief Print the values of the output image last copied to the host, once its stream is synchronized
+    //!
+    void dumpOutputValues(std::ostream& os, const std::string& separator = " ") const;
+
+private:
+    int mInput{-1};
+    int mOutput{-1};
+    int mBatch{1};
+    int mHeight{0};
+    int mWidth{0};
+    int mChannels{0};
+    int mTileHeight{0};
+    int mTileWidth{0};
+    int mOutputChannels{0};
+    int mScale{1}; // Output pixels per input pixel, in each direction
+    int mOutputHeight{0};
+    int mOutputWidth{0};
+    int mLastSlot{0}; // Binding set of the last output copied to the host
+    std::string mOutputName;
+
+    std::vector<int> mOrigins; // Top left corner of each tile in the input image, row then column
+    float* mImage{nullptr};
+    float* mSums{nullptr};
+    float* mWeights{nullptr};
+    float* mMask{nullptr};
+    int* mInputOrigins{nullptr};
+    int* mOutputOrigins{nullptr};
+    std::vector<float*> mOutputs;     // Per binding set
+    std::vector<float*> mHostOutputs; // Pinned, per binding set
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_TILING_H
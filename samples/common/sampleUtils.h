@@ -17,6 +17,8 @@
 #ifndef TRT_SAMPLE_UTILS_H
 #define TRT_SAMPLE_UTILS_H
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <fstream>
@@ -32,7 +34,10 @@
 
 #include "NvInfer.h"
 
+#include "sampleDataset.h"
 #include "sampleDevice.h"
+#include "sampleEncoding.h"
+#include "sampleRandom.h"
 
 namespace sample
 {
@@ -116,6 +121,15 @@ inline void fillBuffer<__half>(void* buffer, int volume, __half min, __half max)
     fillBufferHalf(buffer, volume, min, max);
 }
 
+template <typename T>
+inline std::vector<float> bufferToFloats(const void* buffer, int volume)
+{
+    const T* typedBuffer = static_cast<const T*>(buffer);
+    std::vector<float> values(volume);
+    std::transform(typedBuffer, typedBuffer + volume, values.begin(), [](const T& v) { return static_cast<float>(v); });
+    return values;
+}
+
 template <typename T>
 inline void dumpBuffer(const void* buffer, int volume, const std::string& separator, std::ostream& os)
 {
@@ -131,12 +145,56 @@ inline void dumpBuffer(const void* buffer, int volume, const std::string& separa
 struct Binding
 {
     bool isInput{false};
+    bool isStreamed{false}; //!< Fed from a dataset by the prefetcher instead of the host buffer
+    bool isCount{false};    //!< Bounds the rows copied to the host of compact outputs
+    int countBinding{-1};   //!< Count output of a compact output, -1 for an output copied whole
+    int rows{0};            //!< Rows of each batch item of a compact output
+    void* ipcMemory{nullptr}; //!< Device allocation of another process the input is read from instead of buffer
+    bool isGenerated{false};  //!< Random values generated in device memory, not transferred from the host buffer
     MirroredBuffer buffer;
     int volume{0};
     nvinfer1::DataType dataType{nvinfer1::DataType::kFLOAT};
+    TransferEncoding encoding{TransferEncoding::kNONE};
+    MirroredBuffer encoded; //!< The values as transferred with an encoding, the host buffer of outputs is then stale
+    float threshold{0};     //!< Of the values setting the bits of a mask
+
+    //!
+    //! \brief Narrow the host values of an input into its encoded buffer
+    //!
+    //! \return False if a value does not fit in the encoding
+    //!
+    bool encode()
+    {
+        return encodeHost(buffer.getHostBuffer(), dataType, encoding, encoded.getHostBuffer(), volume);
+    }
+
+    //!
+    //! \return The host values, widened into decoded for encoded outputs
+    //!
+    const void* hostValues(std::vector<char>& decoded) const
+    {
+        if (isInput || encoding == TransferEncoding::kNONE)
+        {
+            return buffer.getHostBuffer();
+        }
+        decoded.resize(buffer.getSize());
+        decodeHost(encoded.getHostBuffer(), encoding, decoded.data(), dataType, volume);
+        return decoded.data();
+    }
 
     void fill(const std::string& fileName)
     {
+        if (samplesCommon::PackedDataset::isPacked(fileName))
+        {
+            // The first sample of a packed dataset, the others are streamed with --streamInputs
+            samplesCommon::PackedDataset dataset(fileName);
+            if (dataset.size())
+            {
+                const size_t size = std::min(dataset.sampleSize(0), static_cast<size_t>(buffer.getSize()));
+                std::memcpy(buffer.getHostBuffer(), dataset.sample(0), size);
+            }
+            return;
+        }
         std::ifstream file(fileName, std::ios::in|std::ios::binary);
         if (file.is_open())
         {
@@ -181,36 +239,73 @@ struct Binding
         }
     }
 
+    //!
+    //! \brief Fill the device buffer with the random values of seed, and copy them to the host buffer if it has one
+    //!
+    void generate(unsigned long long seed)
+    {
+        generateRandom(buffer.getDeviceBuffer(), dataType, volume, seed, 0);
+        if (buffer.getHostBuffer() && !buffer.isZeroCopy())
+        {
+            cudaCheck(cudaMemcpy(buffer.getHostBuffer(), buffer.getDeviceBuffer(), buffer.getSize(),
+                cudaMemcpyDeviceToHost));
+        }
+        cudaCheck(cudaStreamSynchronize(0));
+        isGenerated = true;
+    }
+
+    std::vector<float> values() const
+    {
+        std::vector<char> decoded;
+        const void* host = hostValues(decoded);
+        switch (dataType)
+        {
+        case nvinfer1::DataType::kBOOL: return bufferToFloats<bool>(host, volume);
+        case nvinfer1::DataType::kINT32: return bufferToFloats<int32_t>(host, volume);
+        case nvinfer1::DataType::kINT8: return bufferToFloats<int8_t>(host, volume);
+        case nvinfer1::DataType::kFLOAT: return bufferToFloats<float>(host, volume);
+        case nvinfer1::DataType::kHALF:
+#if CUDA_VERSION < 10000
+            return bufferToFloats<half_float::half>(host, volume);
+#else
+            return bufferToFloats<__half>(host, volume);
+#endif
+        }
+        return {};
+    }
+
     void dump(std::ostream& os, const std::string separator = " ") const
     {
+        std::vector<char> decoded;
+        const void* host = hostValues(decoded);
         switch (dataType)
         {
         case nvinfer1::DataType::kBOOL:
         {
-            dumpBuffer<bool>(buffer.getHostBuffer(), volume, separator, os);
+            dumpBuffer<bool>(host, volume, separator, os);
             break;
         }
         case nvinfer1::DataType::kINT32:
         {
-            dumpBuffer<int32_t>(buffer.getHostBuffer(), volume, separator, os);
+            dumpBuffer<int32_t>(host, volume, separator, os);
             break;
         }
         case nvinfer1::DataType::kINT8:
         {
-            dumpBuffer<int8_t>(buffer.getHostBuffer(), volume, separator, os);
+            dumpBuffer<int8_t>(host, volume, separator, os);
             break;
         }
         case nvinfer1::DataType::kFLOAT:
         {
-            dumpBuffer<float>(buffer.getHostBuffer(), volume, separator, os);
+            dumpBuffer<float>(host, volume, separator, os);
             break;
         }
         case nvinfer1::DataType::kHALF:
         {
 #if CUDA_VERSION < 10000
-            dumpBuffer<half_float::half>(buffer.getHostBuffer(), volume, separator, os);
+            dumpBuffer<half_float::half>(host, volume, separator, os);
 #else
-            dumpBuffer<__half>(buffer.getHostBuffer(), volume, separator, os);
+            dumpBuffer<__half>(host, volume, separator, os);
 #endif
             break;
         }
@@ -219,11 +314,34 @@ struct Binding
 
 };
 
+//!
+//! \brief Where the random values of the inputs without a file come from
+//!
+enum class InputGeneration
+{
+    kHOST,            //!< Generated in the host buffer and copied to the device before each inference
+    kDEVICE,          //!< Generated in device memory once, without a host buffer
+    kDEVICE_MIRRORED, //!< Generated in device memory once, and copied to the host buffer to be printed
+};
+
+//! The seed of the inputs generated on the device, all of them get the same values for the same size
+constexpr unsigned long long kINPUT_SEED{0};
+
 class Bindings
 {
 public:
 
-    void addBinding(int b, const std::string& name, bool isInput, int volume, nvinfer1::DataType dataType, const std::string& fileName = "")
+    //!
+    //! \brief Allocate a binding, inputs are backed by memory of the requested type and outputs by device memory
+    //!
+    //! \param source Bindings of another stream of the same device, or nullptr. An input of the same name and size
+    //!        there transfers from its pinned host buffer instead of allocating and filling one, and with shareDevice
+    //!        a generated input also reads its device buffer, the queries never writing their generated inputs.
+    //!
+    void addBinding(int b, const std::string& name, bool isInput, int volume, nvinfer1::DataType dataType,
+                    const std::string& fileName = "", MemoryType inputMemory = MemoryType::kDEVICE,
+                    InputGeneration generation = InputGeneration::kHOST, const Bindings* source = nullptr,
+                    bool shareDevice = false)
     {
         while (mBindings.size() <= static_cast<size_t>(b))
         {
@@ -232,13 +350,36 @@ public:
         }
         mNames[name] = b;
         mBindings[b].isInput = isInput;
-        mBindings[b].buffer.allocate(volume * dataTypeSize(dataType));
+        const bool generated = isInput && fileName.empty() && generation != InputGeneration::kHOST;
+        const size_t size = volume * dataTypeSize(dataType);
+        const Binding* shared = source && isInput && inputMemory == MemoryType::kDEVICE
+            ? source->findSharedInput(name, size, generated, shareDevice)
+            : nullptr;
+        if (shared && generated)
+        {
+            mBindings[b].buffer.shareBuffers(shared->buffer);
+            mBindings[b].isGenerated = true;
+        }
+        else if (shared)
+        {
+            mBindings[b].buffer.allocate(size, MemoryType::kDEVICE, false);
+            mBindings[b].buffer.shareHostBuffer(shared->buffer);
+        }
+        else
+        {
+            mBindings[b].buffer.allocate(size, isInput ? inputMemory : MemoryType::kDEVICE,
+                !generated || generation == InputGeneration::kDEVICE_MIRRORED);
+        }
         mBindings[b].volume = volume;
         mBindings[b].dataType = dataType;
         mDevicePointers[b] = mBindings[b].buffer.getDeviceBuffer();
-        if (isInput)
+        if (isInput && !shared)
         {
-            if (fileName.empty())
+            if (generated)
+            {
+                mBindings[b].generate(kINPUT_SEED);
+            }
+            else if (fileName.empty())
             {
                 fill(b);
             }
@@ -249,26 +390,338 @@ public:
         }
     }
 
+    //!
+    //! \brief Feed inputs from datasets, one sample per inference, prefetched into depth pinned host buffers
+    //!
+    //! \param datasets The bindings to stream and the directory or packed file of each
+    //! \param first The sample to start from, so that streams do not all run the same sample at the same time
+    //!
+    void streamInputs(const std::vector<std::pair<int, std::string>>& datasets, int depth, size_t first)
+    {
+        std::vector<InputPrefetcher::Input> inputs;
+        for (const auto& d : datasets)
+        {
+            auto& binding = mBindings[d.first];
+            const size_t size = binding.buffer.getSize();
+            inputs.push_back({std::unique_ptr<InputDataset>(new InputDataset(d.second, size)),
+                binding.buffer.getDeviceBuffer(), size});
+            binding.isStreamed = true;
+        }
+        mPrefetcher.reset(new InputPrefetcher(std::move(inputs), depth, first));
+    }
+
+    //!
+    //! \brief Transfer the inputs from the host buffers of the same bindings of another device, streamed and generated
+    //!        inputs excepted
+    //!
+    void shareInputs(const Bindings& other)
+    {
+        for (size_t b = 0; b < mBindings.size() && b < other.mBindings.size(); ++b)
+        {
+            auto& binding = mBindings[b];
+            const auto& source = other.mBindings[b];
+            if (binding.isInput && !binding.isStreamed && !source.isStreamed && !binding.isGenerated
+                && !source.isGenerated)
+            {
+                binding.buffer.shareHostBuffer(other.mBindings[b].buffer);
+                if (binding.encoding != TransferEncoding::kNONE)
+                {
+                    binding.encode();
+                }
+            }
+        }
+    }
+
+    //!
+    //! \brief Read an input from the device memory of another process instead of its buffer, until closeIpcInput
+    //!
+    //! The input is at offset bytes into the allocation of the handle, which the producer keeps while it is open. The
+    //! host buffer of the input is no longer transferred, the producer must order its writes with the inference.
+    //!
+    //! \return False with the reason in err if the handle could not be opened
+    //!
+    bool openIpcInput(int b, const cudaIpcMemHandle_t& handle, size_t offset, std::ostream& err)
+    {
+        closeIpcInput(b);
+        void* memory{nullptr};
+        const cudaError_t opened = cudaIpcOpenMemHandle(&memory, handle, cudaIpcMemLazyEnablePeerAccess);
+        if (opened != cudaSuccess)
+        {
+            err << "Could not open the IPC memory handle: " << cudaGetErrorString(opened);
+            return false;
+        }
+        mBindings[b].ipcMemory = memory;
+        mDevicePointers[b] = static_cast<char*>(memory) + offset;
+        return true;
+    }
+
+    //!
+    //! \brief Read the input from its own buffer again
+    //!
+    void closeIpcInput(int b)
+    {
+        auto& binding = mBindings[b];
+        if (binding.ipcMemory)
+        {
+            cudaIpcCloseMemHandle(binding.ipcMemory);
+            binding.ipcMemory = nullptr;
+            mDevicePointers[b] = binding.buffer.getDeviceBuffer();
+        }
+    }
+
+    bool isIpcInput(int b) const
+    {
+        return mBindings[b].ipcMemory != nullptr;
+    }
+
+    //!
+    //! \brief Pack the inputs copied from their host buffers into one region and the outputs copied whole into another,
+    //!        so that a full batch transfers with one copy each way instead of one per binding
+    //!
+    //! Engines with several small inputs then pay the set up latency of a single DMA transfer. Streamed, generated and
+    //! zero-copy inputs, and the counts and compact outputs keep their own buffers. The device pointers of the packed
+    //! bindings are offsets into the device region, kPACK_ALIGNMENT aligned.
+    //!
+    void packTransfers()
+    {
+        packBindings(mPackedInputs,
+            [](const Binding& b) {
+                return b.isInput && !b.isStreamed && !b.isGenerated && !b.buffer.isZeroCopy()
+                    && b.encoding == TransferEncoding::kNONE;
+            });
+        packBindings(mPackedOutputs, [](const Binding& b) {
+            return !b.isInput && !b.isCount && b.countBinding < 0 && b.encoding == TransferEncoding::kNONE;
+        });
+    }
+
     void** getDeviceBuffers() { return mDevicePointers.data(); }
 
-    void transferInputToDevice(TrtCudaStream& stream)
+    //!
+    //! \brief Transfer the inputs of a batch of size batch, out of buffers allocated for maxBatch
+    //!
+    //! The batch is the outermost dimension of all the bindings, so the first batch/maxBatch of each buffer is copied.
+    //! The default values transfer the whole buffers.
+    //!
+    void transferInputToDevice(TrtCudaStream& stream, int batch = 1, int maxBatch = 1)
     {
+        // Partial batches are not contiguous in the packed region, each binding is copied on its own
+        const bool packed = mPackedInputs.getSize() && batch == maxBatch;
+        if (packed)
+        {
+            mPackedInputs.hostToDevice(stream);
+        }
         for (auto& b : mNames)
         {
-            if (mBindings[b.second].isInput)
+            const auto& binding = mBindings[b.second];
+            if (binding.isInput && !binding.isStreamed && !binding.isGenerated && !binding.ipcMemory
+                && !(packed && binding.buffer.isPacked()))
+            {
+                auto& buffer = mBindings[b.second].buffer;
+                if (binding.encoding != TransferEncoding::kNONE)
+                {
+                    const size_t count = binding.volume / maxBatch * batch;
+                    auto& encoded = mBindings[b.second].encoded;
+                    encoded.hostToDevice(stream, encodedSize(binding.encoding, count));
+                    decodeDevice(encoded.getDeviceBuffer(), binding.encoding, buffer.getDeviceBuffer(),
+                        binding.dataType, count, stream.get());
+                    continue;
+                }
+                buffer.hostToDevice(stream, buffer.getSize() / maxBatch * batch);
+            }
+        }
+        if (mPrefetcher)
+        {
+            mPrefetcher->transfer(stream, batch, maxBatch);
+        }
+    }
+
+    //!
+    //! \return True if at least one input has to be copied to the device before inference
+    //!
+    bool hasInputTransfers() const
+    {
+        if (mPrefetcher)
+        {
+            return true;
+        }
+        for (const auto& b : mNames)
+        {
+            const auto& binding = mBindings[b.second];
+            if (binding.isInput && !binding.buffer.isZeroCopy() && !binding.ipcMemory && !binding.isGenerated)
             {
-                mBindings[b.second].buffer.hostToDevice(stream);
+                return true;
             }
         }
+        return false;
     }
 
-    void transferOutputToHost(TrtCudaStream& stream)
+    //!
+    //! \brief Copy to the host only the rows of each batch item of an output below the count given by another output
+    //!
+    //! \param rows The rows of each batch item, the outermost dimension after the batch one
+    //!
+    //! \return False if the count is not an INT32 output with one value per batch item of the output
+    //!
+    bool setCompactOutput(const std::string& name, const std::string& count, int rows)
     {
+        const auto output = mNames.find(name);
+        const auto counts = mNames.find(count);
+        if (output == mNames.end() || counts == mNames.end() || output == counts || rows <= 0)
+        {
+            return false;
+        }
+        auto& binding = mBindings[output->second];
+        auto& countBinding = mBindings[counts->second];
+        if (binding.isInput || binding.isCount || countBinding.isInput || countBinding.countBinding >= 0
+            || countBinding.dataType != nvinfer1::DataType::kINT32
+            || binding.volume % (countBinding.volume * rows))
+        {
+            return false;
+        }
+        countBinding.isCount = true;
+        binding.countBinding = counts->second;
+        binding.rows = rows;
+        return true;
+    }
+
+    //!
+    //! \brief Transfer a binding in a narrower encoding, widened on the device for inputs and on the host for outputs
+    //!
+    //! The host values of an input are encoded here, and again when shared with another binding set, so that each
+    //! inference only copies the encoded bytes and widens them with a kernel on the stream of the copy. Outputs are
+    //! narrowed by a kernel before their copy, a mask sets a bit for each value above threshold. The host values of
+    //! the outputs, as dumped or exported, are then decoded on read. Streamed, generated, IPC and zero-copy inputs, the
+    //! counts and the compact outputs keep to their data type.
+    //!
+    //! \return False if the binding is not one of these, the encoding does not apply to its data type, or a value of
+    //!         an input does not fit in the encoding
+    //!
+    bool setTransferEncoding(const std::string& name, TransferEncoding encoding, float threshold)
+    {
+        const auto match = mNames.find(name);
+        if (match == mNames.end() || encoding == TransferEncoding::kNONE)
+        {
+            return false;
+        }
+        auto& binding = mBindings[match->second];
+        if (!canEncode(encoding, binding.dataType, binding.isInput) || binding.isStreamed || binding.isGenerated
+            || binding.ipcMemory || binding.buffer.isZeroCopy() || binding.isCount || binding.countBinding >= 0)
+        {
+            return false;
+        }
+        binding.encoded.allocate(encodedSize(encoding, binding.volume));
+        binding.encoding = encoding;
+        binding.threshold = threshold;
+        if (binding.isInput && !binding.encode())
+        {
+            binding.encoding = TransferEncoding::kNONE;
+            return false;
+        }
+        return true;
+    }
+
+    //!
+    //! \brief Transfer the outputs of a batch of size batch, out of buffers allocated for maxBatch
+    //!
+    //! Compact outputs copy the rows up to the largest count of the batch in a single strided copy, the host waits for
+    //! the counts on the stream first. Their rows past the count keep the values of earlier inferences.
+    //!
+    void transferOutputToHost(TrtCudaStream& stream, int batch = 1, int maxBatch = 1)
+    {
+        bool counts{false};
+        for (auto& b : mNames)
+        {
+            auto& binding = mBindings[b.second];
+            if (binding.isCount)
+            {
+                binding.buffer.deviceToHost(stream, binding.buffer.getSize() / maxBatch * batch);
+                counts = true;
+            }
+        }
+        if (counts)
+        {
+            stream.synchronize();
+        }
+
+        const bool packed = mPackedOutputs.getSize() && batch == maxBatch;
+        if (packed)
+        {
+            mPackedOutputs.deviceToHost(stream);
+        }
         for (auto& b : mNames)
         {
-            if (!mBindings[b.second].isInput)
+            auto& binding = mBindings[b.second];
+            if (binding.isInput || binding.isCount || (packed && binding.buffer.isPacked()))
             {
-                mBindings[b.second].buffer.deviceToHost(stream);
+                continue;
+            }
+            if (binding.encoding != TransferEncoding::kNONE)
+            {
+                const size_t count = binding.volume / maxBatch * batch;
+                encodeDevice(binding.buffer.getDeviceBuffer(), binding.dataType, binding.encoding, binding.threshold,
+                    binding.encoded.getDeviceBuffer(), count, stream.get());
+                binding.encoded.deviceToHost(stream, encodedSize(binding.encoding, count));
+                continue;
+            }
+            if (binding.countBinding < 0)
+            {
+                binding.buffer.deviceToHost(stream, binding.buffer.getSize() / maxBatch * batch);
+                continue;
+            }
+            const auto& count = mBindings[binding.countBinding];
+            const int items = count.volume / maxBatch * batch;
+            const auto* itemCounts = static_cast<const int32_t*>(count.buffer.getHostBuffer());
+            const int valid = std::max(0, std::min(binding.rows, *std::max_element(itemCounts, itemCounts + items)));
+            const size_t pitch = binding.buffer.getSize() / count.volume;
+            binding.buffer.deviceToHost(stream, pitch / binding.rows * valid, pitch, items);
+        }
+    }
+
+    //!
+    //! \brief Split all the bindings in count micro-batches along their outermost dimension, the batch
+    //!
+    //! Each micro-batch gets device pointers of its own, into the same buffers.
+    //!
+    void splitMicroBatches(int count)
+    {
+        mMicroBatches.assign(count, mDevicePointers);
+        for (int m = 0; m < count; ++m)
+        {
+            for (size_t b = 0; b < mBindings.size(); ++b)
+            {
+                if (mDevicePointers[b])
+                {
+                    mMicroBatches[m][b] = static_cast<char*>(mDevicePointers[b]) + microBatchSize(b) * m;
+                }
+            }
+        }
+    }
+
+    void** getMicroBatchBuffers(int m) { return mMicroBatches[m].data(); }
+
+    //!
+    //! \brief Transfer the inputs of micro-batch m, generated inputs excepted
+    //!
+    void transferMicroBatchInput(TrtCudaStream& stream, int m)
+    {
+        for (size_t b = 0; b < mBindings.size(); ++b)
+        {
+            auto& binding = mBindings[b];
+            if (binding.isInput && !binding.isGenerated && !binding.ipcMemory)
+            {
+                binding.buffer.hostToDevice(stream, microBatchSize(b) * m, microBatchSize(b));
+            }
+        }
+    }
+
+    void transferMicroBatchOutput(TrtCudaStream& stream, int m)
+    {
+        for (size_t b = 0; b < mBindings.size(); ++b)
+        {
+            auto& binding = mBindings[b];
+            if (!binding.isInput)
+            {
+                binding.buffer.deviceToHost(stream, microBatchSize(b) * m, microBatchSize(b));
             }
         }
     }
@@ -294,6 +747,42 @@ public:
         mBindings[binding].dump(os, separator);
     }
 
+    //!
+    //! \brief The host buffer of a binding, as last transferred for outputs
+    //!
+    const void* getHostBuffer(int binding) const
+    {
+        return mBindings[binding].buffer.getHostBuffer();
+    }
+
+    size_t getHostSize(int binding) const
+    {
+        return mBindings[binding].buffer.getSize();
+    }
+
+    const void* getDeviceBuffer(int binding) const
+    {
+        return mDevicePointers[binding];
+    }
+
+    int getVolume(int binding) const
+    {
+        return mBindings[binding].volume;
+    }
+
+    nvinfer1::DataType getDataType(int binding) const
+    {
+        return mBindings[binding].dataType;
+    }
+
+    //!
+    //! \brief The host values of a binding converted to float
+    //!
+    std::vector<float> getBindingValues(int binding) const
+    {
+        return mBindings[binding].values();
+    }
+
     void dumpInputs(const nvinfer1::IExecutionContext& context, std::ostream& os) const
     {
         auto isInput = [](const Binding& b) { return b.isInput; };
@@ -362,9 +851,64 @@ public:
 
 private:
 
+    static constexpr size_t kPACK_ALIGNMENT{256};
+
+    size_t microBatchSize(size_t b) const
+    {
+        return mBindings[b].buffer.getSize() / mMicroBatches.size();
+    }
+
+    //!
+    //! \return The input of the name an input of size bytes can share the values of, nullptr if there is none
+    //!
+    const Binding* findSharedInput(const std::string& name, size_t size, bool generated, bool shareDevice) const
+    {
+        const auto n = mNames.find(name);
+        if (n == mNames.end())
+        {
+            return nullptr;
+        }
+        const auto& binding = mBindings[n->second];
+        const bool shareable = binding.isInput && !binding.isStreamed && !binding.buffer.isZeroCopy()
+            && static_cast<size_t>(binding.buffer.getSize()) == size && binding.isGenerated == generated
+            && (!generated || shareDevice);
+        return shareable ? &binding : nullptr;
+    }
+
+    //! Pack the bindings selected by packable one after the other into region, if there are at least two of them
+    template <typename Packable>
+    void packBindings(MirroredBuffer& region, Packable packable)
+    {
+        std::vector<std::pair<int, size_t>> offsets;
+        size_t size{0};
+        for (const auto& n : mNames)
+        {
+            const auto& binding = mBindings[n.second];
+            if (packable(binding) && binding.buffer.getSize() > 0)
+            {
+                offsets.emplace_back(n.second, size);
+                size += (binding.buffer.getSize() + kPACK_ALIGNMENT - 1) / kPACK_ALIGNMENT * kPACK_ALIGNMENT;
+            }
+        }
+        if (offsets.size() < 2)
+        {
+            return;
+        }
+        region.allocate(size);
+        for (const auto& o : offsets)
+        {
+            mBindings[o.first].buffer.packInto(region, o.second);
+            mDevicePointers[o.first] = mBindings[o.first].buffer.getDeviceBuffer();
+        }
+    }
+
     std::unordered_map<std::string, int> mNames;
     std::vector<Binding> mBindings;
     std::vector<void*> mDevicePointers;
+    std::vector<std::vector<void*>> mMicroBatches; // Device pointers of each micro-batch, empty without
+    std::unique_ptr<InputPrefetcher> mPrefetcher;
+    MirroredBuffer mPackedInputs;  // Staging of the packed inputs, empty unless packTransfers packed some
+    MirroredBuffer mPackedOutputs;
 };
 
 template <typename T>
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "sampleDevice.h"
+#include "sampleUtils.h"
+#include "sampleValidation.h"
+
+namespace sample
+{
+
+OutputValidator::OutputValidator(
+    const std::unordered_map<std::string, std::vector<float>>& reference, float tolerance, int every)
+    : mTolerance(tolerance)
+    , mEvery(std::max(every, 1))
+{
+    for (const auto& r : reference)
+    {
+        Reference device{nullptr, r.second.size()};
+        const size_t bytes = std::max<size_t>(device.count, 1) * sizeof(float);
+        cudaCheck(cudaMalloc(reinterpret_cast<void**>(&device.device), bytes));
+        cudaCheck(cudaMemcpy(device.device, r.second.data(), device.count * sizeof(float), cudaMemcpyHostToDevice));
+        mReference[r.first] = device;
+    }
+}
+
+OutputValidator::~OutputValidator()
+{
+    for (auto& r : mReference)
+    {
+        cudaFree(r.second.device);
+    }
+}
+
+bool OutputValidator::matches(const Bindings& bindings, std::ostream& err) const
+{
+    const auto outputs = bindings.getOutputBindings();
+    for (const auto& o : outputs)
+    {
+        const auto r = mReference.find(o.first);
+        if (r == mReference.end())
+        {
+            err << "No reference values for output " << o.first << std::endl;
+            return false;
+        }
+        if (r->second.count != static_cast<size_t>(bindings.getVolume(o.second)))
+        {
+            err << "Output " << o.first << " has " << bindings.getVolume(o.second) << " values, its reference "
+                << r->second.count << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+OutputValidator::Check::Check(OutputValidator& validator, const std::vector<Bindings*>& bindings)
+    : mValidator(validator)
+{
+    for (const auto* b : bindings)
+    {
+        mOutputs.emplace_back();
+        for (const auto& o : b->getOutputBindings())
+        {
+            const auto& reference = validator.mReference.at(o.first);
+            mOutputs.back().push_back({b->getDeviceBuffer(o.second), b->getDataType(o.second), reference.device,
+                reference.count});
+        }
+    }
+    for (const auto& o : mOutputs.front())
+    {
+        mValues += o.count;
+    }
+    // The errors of the inference in flight and the totals of the stream
+    cudaCheck(cudaMalloc(reinterpret_cast<void**>(&mStats), 2 * sizeof(ValidationStats)));
+    cudaCheck(cudaMemset(mStats, 0, 2 * sizeof(ValidationStats)));
+}
+
+OutputValidator::Check::~Check()
+{
+    ValidationStats totals;
+    // Synchronous, the checks enqueued on the stream of the iteration are done
+    cudaCheck(cudaMemcpy(&totals, mStats + 1, sizeof(totals), cudaMemcpyDeviceToHost));
+    cudaFree(mStats);
+    mValidator.add(totals);
+}
+
+void OutputValidator::Check::enqueue(int slot, cudaStream_t stream)
+{
+    if (mQueries++ % mValidator.mEvery)
+    {
+        return;
+    }
+    for (const auto& o : mOutputs[slot])
+    {
+        compareOutput(o.device, o.type, o.reference, o.count, mValidator.mTolerance, mStats, stream);
+    }
+    foldValidation(mStats, mStats + 1, mValues, stream);
+}
+
+ValidationStats OutputValidator::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void OutputValidator::add(const ValidationStats& stats)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats.checks += stats.checks;
+    mStats.failedChecks += stats.failedChecks;
+    mStats.values += stats.values;
+    mStats.mismatches += stats.mismatches;
+    mStats.maxAbs = std::max(mStats.maxAbs, stats.maxAbs);
+    mStats.maxRel = std::max(mStats.maxRel, stats.maxRel);
+}
+
+void printValidationReport(const OutputValidator& validator, std::ostream& os)
+{
+    const ValidationStats stats = validator.getStats();
+    os << "=== Output Validation ===" << std::endl;
+    os << "Checks: " << stats.checks << " (one inference out of every " << validator.getEvery() << " per stream), "
+       << stats.failedChecks << " failed" << std::endl;
+    os << "Mismatches: " << stats.mismatches << " of " << stats.values << " values (tolerance "
+       << validator.getTolerance() << ")" << std::endl;
+    os << "Maximum error: " << stats.maxAbs << " absolute, " << stats.maxRel << " relative" << std::endl;
+}
+
+} // namespace sample
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sampleValidation.h"
+#include <algorithm>
+#include <cstdint>
+#include <cuda_fp16.h>
+#include <math_constants.h>
+
+namespace sample
+{
+namespace
+{
+
+constexpr int kTHREADS{256};
+constexpr int kMAX_BLOCKS{1024};
+
+template <typename T>
+__device__ inline float toFloat(T x)
+{
+    return static_cast<float>(x);
+}
+
+template <>
+__device__ inline float toFloat<__half>(__half x)
+{
+    return __half2float(x);
+}
+
+//! Non-negative floats order like their bits as ints, which atomicMax compares
+__device__ inline void atomicMaxFloat(float* address, float value)
+{
+    atomicMax(reinterpret_cast<int*>(address), __float_as_int(value));
+}
+
+//! Grid-stride loop, each thread updates the errors once for all of its values
+template <typename T>
+__global__ void compareOutputKernel(
+    const T* output, const float* reference, size_t count, float tolerance, ValidationStats* errors)
+{
+    unsigned long long mismatches{0};
+    float maxAbs{0.F};
+    float maxRel{0.F};
+    for (size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x; i < count;
+         i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        const float r = reference[i];
+        float abs = fabsf(toFloat(output[i]) - r);
+        if (isnan(abs))
+        {
+            abs = CUDART_INF_F;
+        }
+        if (abs > tolerance * (1.F + fabsf(r)))
+        {
+            ++mismatches;
+        }
+        maxAbs = fmaxf(maxAbs, abs);
+        maxRel = fmaxf(maxRel, abs / fmaxf(fabsf(r), 1e-6F));
+    }
+    if (mismatches)
+    {
+        atomicAdd(&errors->mismatches, mismatches);
+    }
+    if (maxAbs > 0.F)
+    {
+        atomicMaxFloat(&errors->maxAbs, maxAbs);
+        atomicMaxFloat(&errors->maxRel, maxRel);
+    }
+}
+
+__global__ void foldValidationKernel(ValidationStats* errors, ValidationStats* totals, unsigned long long values)
+{
+    ++totals->checks;
+    totals->values += values;
+    if (errors->mismatches)
+    {
+        ++totals->failedChecks;
+        totals->mismatches += errors->mismatches;
+    }
+    totals->maxAbs = fmaxf(totals->maxAbs, errors->maxAbs);
+    totals->maxRel = fmaxf(totals->maxRel, errors->maxRel);
+    *errors = ValidationStats{};
+}
+
+template <typename T>
+void launchCompare(
+    const void* output, const float* reference, size_t count, float tolerance, ValidationStats* errors,
+    cudaStream_t stream)
+{
+    const int blocks = static_cast<int>(std::min<size_t>((count + kTHREADS - 1) / kTHREADS, kMAX_BLOCKS));
+    compareOutputKernel<T><<<blocks, kTHREADS, 0, stream>>>(
+        static_cast<const T*>(output), reference, count, tolerance, errors);
+}
+
+} // namespace
+
+void compareOutput(const void* output, nvinfer1::DataType type, const float* reference, size_t count,
+    float tolerance, ValidationStats* errors, cudaStream_t stream)
+{
+    if (!count)
+    {
+        return;
+    }
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT: launchCompare<float>(output, reference, count, tolerance, errors, stream); break;
+    case nvinfer1::DataType::kHALF: launchCompare<__half>(output, reference, count, tolerance, errors, stream); break;
+    case nvinfer1::DataType::kINT8: launchCompare<int8_t>(output, reference, count, tolerance, errors, stream); break;
+    case nvinfer1::DataType::kINT32: launchCompare<int32_t>(output, reference, count, tolerance, errors, stream); break;
+    case nvinfer1::DataType::kBOOL: launchCompare<bool>(output, reference, count, tolerance, errors, stream); break;
+    }
+}
+
+void foldValidation(ValidationStats* errors, ValidationStats* totals, unsigned long long values, cudaStream_t stream)
+{
+    foldValidationKernel<<<1, 1, 0, stream>>>(errors, totals, values);
+}
+
+} // namespace sample
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_VALIDATION_H
+#define TRT_SAMPLE_VALIDATION_H
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cuda_runtime_api.h>
+
+#include "NvInfer.h"
+
+namespace sample
+{
+
+class Bindings;
+
+//!
+//! \brief Errors of the outputs against their reference, accumulated on the device
+//!
+//! A value mismatches when |output - reference| > tolerance * (1 + |reference|), NaNs always mismatch and count as an
+//! infinite error. The relative error is taken to |reference|, no smaller than 1e-6.
+//!
+struct ValidationStats
+{
+    unsigned long long checks{0};       //!< Validated inferences
+    unsigned long long failedChecks{0}; //!< Validated inferences with at least one mismatch
+    unsigned long long values{0};       //!< Compared output values
+    unsigned long long mismatches{0};
+    float maxAbs{0};
+    float maxRel{0};
+};
+
+//!
+//! \brief Compare count values of an output binding of type type to their reference, into the errors of one inference
+//!
+//! \param errors The device errors of the inference, only mismatches, maxAbs and maxRel are updated
+//!
+void compareOutput(const void* output, nvinfer1::DataType type, const float* reference, size_t count,
+    float tolerance, ValidationStats* errors, cudaStream_t stream);
+
+//!
+//! \brief Add the errors of one inference of values values into the device totals, and clear them for the next one
+//!
+void foldValidation(ValidationStats* errors, ValidationStats* totals, unsigned long long values, cudaStream_t stream);
+
+//!
+//! \class OutputValidator
+//! \brief Checks the outputs of every Nth inference against reference values kept on the device
+//!
+//! The reference outputs are copied to the device once. A comparison kernel runs on the output stream of the checked
+//! inferences, after their compute, and the errors stay on the device until the end of the run, so a validated
+//! benchmark only copies a few scalars per stream back to the host.
+//!
+class OutputValidator
+{
+public:
+    //!
+    //! \param reference The values of each output by name, as exported by --exportOutput
+    //! \param every Check one inference out of every, per stream
+    //!
+    OutputValidator(const std::unordered_map<std::string, std::vector<float>>& reference, float tolerance, int every);
+
+    ~OutputValidator();
+
+    OutputValidator(const OutputValidator&) = delete;
+    OutputValidator& operator=(const OutputValidator&) = delete;
+
+    //!
+    //! \return False with the reason in err if the outputs of the bindings do not match the reference in name or size
+    //!
+    bool matches(const Bindings& bindings, std::ostream& err) const;
+
+    //!
+    //! \class Check
+    //! \brief The checks of the binding sets of one stream, its totals are added to the validator when destroyed
+    //!
+    class Check
+    {
+    public:
+        Check(OutputValidator& validator, const std::vector<Bindings*>& bindings);
+
+        ~Check();
+
+        Check(const Check&) = delete;
+        Check& operator=(const Check&) = delete;
+
+        //!
+        //! \brief Compare the device outputs of binding set slot on stream, once every N calls
+        //!
+        void enqueue(int slot, cudaStream_t stream);
+
+    private:
+        struct Output
+        {
+            const void* device;
+            nvinfer1::DataType type;
+            const float* reference;
+            size_t count;
+        };
+
+        OutputValidator& mValidator;
+        std::vector<std::vector<Output>> mOutputs; // Per binding set
+        unsigned long long mValues{0};             // Values of one inference
+        ValidationStats* mStats{nullptr};          // Errors of the inference in flight, then the totals
+        int mQueries{0};
+    };
+
+    std::unique_ptr<Check> makeCheck(const std::vector<Bindings*>& bindings)
+    {
+        return std::unique_ptr<Check>(new Check(*this, bindings));
+    }
+
+    //!
+    //! \brief The totals of the checks destroyed so far, all of them at the end of a run
+    //!
+    ValidationStats getStats() const;
+
+    int getEvery() const
+    {
+        return mEvery;
+    }
+
+    float getTolerance() const
+    {
+        return mTolerance;
+    }
+
+private:
+    void add(const ValidationStats& stats);
+
+    struct Reference
+    {
+        float* device;
+        size_t count;
+    };
+
+    std::unordered_map<std::string, Reference> mReference;
+    float mTolerance{0};
+    int mEvery{1};
+
+    mutable std::mutex mMutex;
+    ValidationStats mStats;
+};
+
+//!
+//! \brief Print the totals of the output validation
+//!
+void printValidationReport(const OutputValidator& validator, std::ostream& os);
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_VALIDATION_H
@@ -40,6 +40,8 @@
 
 #include "NvInfer.h"
 #include "NvUtils.h"
+#include "RecurrentSession.h"
+#include "WeightsFile.h"
 #include "argsParser.h"
 #include "buffers.h"
 #include "common.h"
@@ -89,6 +91,9 @@ struct SampleCharRNNBindingNames
     const char* CELL_OUT_BLOB_NAME{"cellOut"};
     const char* OUTPUT_BLOB_NAME{"pred"};
     const char* SEQ_LEN_IN_BLOB_NAME{"seqLen"};
+    const char* PROMPT_BLOB_NAME{"prompt"};
+    const char* STEPS_BLOB_NAME{"steps"};
+    const char* GENERATED_BLOB_NAME{"generated"};
 };
 
 struct SampleCharRNNMaps
@@ -121,6 +126,8 @@ struct SampleCharRNNParams : samplesCommon::SampleParams
     vector<std::string> inputSentences;
     vector<std::string> outputSentences;
     bool useILoop;
+    bool useGenerationLoop;
+    int maxSteps; //!< Of the generation loop, the seed characters and all but the last generated one
 };
 
 //!
@@ -148,7 +155,7 @@ public:
     //!
     //! \brief Runs the TensorRT inference engine for this sample
     //!
-    bool infer();
+    virtual bool infer();
 
     //!
     //! \brief Used to clean up any state created in the sample class
@@ -172,22 +179,25 @@ protected:
     nvinfer1::Weights convertRNNBias(nvinfer1::Weights input);
 
     std::map<std::string, nvinfer1::Weights> mWeightMap;
+    std::unique_ptr<samplesCommon::WeightsFile> mWeightsFile; //!< The binary weights file the weights point into
     SampleCharRNNParams mParams;
 
     nvinfer1::ITensor* addReshape(
         SampleUniquePtr<nvinfer1::INetworkDefinition>& network, nvinfer1::ITensor& tensor, nvinfer1::Dims dims);
 
-private:
     //!
-    //! \brief Load requested weights from a formatted file into a map.
+    //! \brief Create full model using the TensorRT network definition API and build the engine.
     //!
-    std::map<std::string, nvinfer1::Weights> loadWeights(const std::string file);
+    virtual void constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
+        SampleUniquePtr<nvinfer1::INetworkDefinition>& network, SampleUniquePtr<nvinfer1::IBuilderConfig>& config);
+
+    std::shared_ptr<nvinfer1::ICudaEngine> mEngine{nullptr}; //!< The TensorRT engine used to run the network
 
+private:
     //!
-    //! \brief Create full model using the TensorRT network definition API and build the engine.
+    //! \brief Load requested weights from a formatted file into a map.
     //!
-    void constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
-        SampleUniquePtr<nvinfer1::INetworkDefinition>& network, SampleUniquePtr<nvinfer1::IBuilderConfig>& config);
+    std::map<std::string, nvinfer1::Weights> loadWeights(const std::string file);
 
     //!
     //! \brief Looks up the embedding tensor for a given char and copies it to input buffer
@@ -197,15 +207,8 @@ private:
     //!
     //! \brief Perform one time step of inference with the TensorRT execution context
     //!
-    bool stepOnce(samplesCommon::BufferManager& buffers,
-                  SampleUniquePtr<nvinfer1::IExecutionContext>& context, cudaStream_t& stream);
-
-    //!
-    //! \brief Copies Ct/Ht output from the RNN to the Ct-1/Ht-1 input buffers for next time step
-    //!
-    void copyRNNOutputsToInputs(samplesCommon::BufferManager& buffers);
-
-    std::shared_ptr<nvinfer1::ICudaEngine> mEngine{nullptr}; //!< The TensorRT engine used to run the network
+    bool stepOnce(samplesCommon::BufferManager& buffers, samplesCommon::RecurrentSessionPool& states, int session,
+        std::vector<void*>& bindings, SampleUniquePtr<nvinfer1::IExecutionContext>& context, cudaStream_t& stream);
 };
 
 class SampleCharRNNv2 : public SampleCharRNNBase
@@ -253,11 +256,49 @@ protected:
     //!
     nvinfer1::ILayer* addLSTMLayers(SampleCharRNNBase::SampleUniquePtr<nvinfer1::INetworkDefinition>& network) final;
 
+    //!
+    //! \brief Convert the LSTM weights of the layers and add them as constants, without the maximum sequence size
+    //!
+    std::vector<LstmParams> addLSTMParams(SampleUniquePtr<nvinfer1::INetworkDefinition>& network);
+
+    //!
+    //! \brief Add one time step of an LSTM layer inside a loop, from its input and the previous hidden and cell state
+    //!
+    //! \return The hidden state as data, and the hidden and cell state of the step
+    //!
+    LstmIO addLSTMStep(
+        SampleUniquePtr<nvinfer1::INetworkDefinition>& network, const LstmIO& inputTensors, const LstmParams& params);
+
 private:
     nvinfer1::ILayer* addLSTMCell(SampleUniquePtr<nvinfer1::INetworkDefinition>& network, const LstmIO& inputTensors,
         nvinfer1::ITensor* sequenceSize, const LstmParams& params, LstmIO& outputTensors);
 };
 
+//!
+//! \brief Generates a whole sequence with a single enqueue, the decode loop being a loop of the network
+//!
+//! \details Each trip of the ILoop feeds a character to the embedding, the LSTM layers, the fully connected layer and
+//!          the TopK layer, and its prediction back to the next trip through a recurrence. The seed characters are
+//!          an input that the trips iterate on, padded with -1 after the seed, where the trips take the prediction of
+//!          the previous trip instead. The predictions, the hidden and the cell state never leave the device between
+//!          the characters.
+//!
+class SampleCharRNNGeneration : public SampleCharRNNLoop
+{
+public:
+    SampleCharRNNGeneration(SampleCharRNNParams params)
+        : SampleCharRNNLoop(params)
+    {
+    }
+
+    bool infer() final;
+
+protected:
+    void constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
+        SampleUniquePtr<nvinfer1::INetworkDefinition>& network,
+        SampleUniquePtr<nvinfer1::IBuilderConfig>& config) final;
+};
+
 //!
 //! \brief Creates the network, configures the builder and creates
 //!        the network engine
@@ -320,11 +361,28 @@ bool SampleCharRNNBase::build()
 //!        <number of buffers>
 //!        for each buffer: [name] [type] [shape] <data as binary blob>\n
 //!        Note: type is the integer value of the DataType enum in NvInfer.h.
+//!        If the binary weights file converted from it by convertWts.py is next to it, the weights point into the
+//!        mapping of that file instead.
 //!
 std::map<std::string, nvinfer1::Weights> SampleCharRNNBase::loadWeights(const std::string file)
 {
     std::map<std::string, nvinfer1::Weights> weightMap;
 
+    const std::string binaryFile = samplesCommon::WeightsFile::binaryName(file);
+    if (samplesCommon::WeightsFile::isWeightsFile(binaryFile))
+    {
+        mWeightsFile.reset(new samplesCommon::WeightsFile(binaryFile));
+        for (const auto& w : mWeightsFile->weights())
+        {
+            if (mParams.weightNames.names.erase(w.first))
+            {
+                weightMap[w.first] = w.second;
+            }
+        }
+        gLogInfo << "Done mapping weights from file..." << std::endl;
+        return weightMap;
+    }
+
     std::ifstream input(file, std::ios_base::binary);
     assert(input.is_open() && "Unable to load weight file.");
 
@@ -445,23 +503,16 @@ nvinfer1::Weights SampleCharRNNBase::convertRNNBias(nvinfer1::Weights input)
     return nvinfer1::Weights{input.type, ptr, input.count * 2};
 }
 
-nvinfer1::ILayer* SampleCharRNNLoop::addLSTMCell(SampleUniquePtr<nvinfer1::INetworkDefinition>& network,
-    const LstmIO& inputTensors, nvinfer1::ITensor* sequenceSize, const LstmParams& params, LstmIO& outputTensors)
+SampleCharRNNLoop::LstmIO SampleCharRNNLoop::addLSTMStep(
+    SampleUniquePtr<nvinfer1::INetworkDefinition>& network, const LstmIO& inputTensors, const LstmParams& params)
 {
-    nvinfer1::ILoop* sequenceLoop = network->addLoop();
-    sequenceLoop->addTripLimit(*sequenceSize, nvinfer1::TripLimit::kCOUNT);
-
-    nvinfer1::ITensor* input = sequenceLoop->addIterator(*inputTensors.data)->getOutput(0);
-    nvinfer1::IRecurrenceLayer* hidden = sequenceLoop->addRecurrence(*inputTensors.hidden);
-    nvinfer1::IRecurrenceLayer* cell = sequenceLoop->addRecurrence(*inputTensors.cell);
-
     nvinfer1::ITensor* mmInput = network
-                                     ->addMatrixMultiply(*input, nvinfer1::MatrixOperation::kVECTOR,
+                                     ->addMatrixMultiply(*inputTensors.data, nvinfer1::MatrixOperation::kVECTOR,
                                          *params.inputWeights, nvinfer1::MatrixOperation::kTRANSPOSE)
                                      ->getOutput(0);
 
     nvinfer1::ITensor* mmHidden = network
-                                      ->addMatrixMultiply(*hidden->getOutput(0), nvinfer1::MatrixOperation::kVECTOR,
+                                      ->addMatrixMultiply(*inputTensors.hidden, nvinfer1::MatrixOperation::kVECTOR,
                                           *params.recurrentWeights, nvinfer1::MatrixOperation::kTRANSPOSE)
                                       ->getOutput(0);
 
@@ -492,7 +543,7 @@ nvinfer1::ILayer* SampleCharRNNLoop::addLSTMCell(SampleUniquePtr<nvinfer1::INetw
 
     nvinfer1::ITensor* C
         = network
-              ->addElementWise(*network->addElementWise(*f, *cell->getOutput(0), nvinfer1::ElementWiseOperation::kPROD)
+              ->addElementWise(*network->addElementWise(*f, *inputTensors.cell, nvinfer1::ElementWiseOperation::kPROD)
                                     ->getOutput(0),
                   *network->addElementWise(*i, *c, nvinfer1::ElementWiseOperation::kPROD)->getOutput(0),
                   nvinfer1::ElementWiseOperation::kSUM)
@@ -503,6 +554,23 @@ nvinfer1::ILayer* SampleCharRNNLoop::addLSTMCell(SampleUniquePtr<nvinfer1::INetw
                   nvinfer1::ElementWiseOperation::kPROD)
               ->getOutput(0);
 
+    return LstmIO{H, H, C};
+}
+
+nvinfer1::ILayer* SampleCharRNNLoop::addLSTMCell(SampleUniquePtr<nvinfer1::INetworkDefinition>& network,
+    const LstmIO& inputTensors, nvinfer1::ITensor* sequenceSize, const LstmParams& params, LstmIO& outputTensors)
+{
+    nvinfer1::ILoop* sequenceLoop = network->addLoop();
+    sequenceLoop->addTripLimit(*sequenceSize, nvinfer1::TripLimit::kCOUNT);
+
+    nvinfer1::ITensor* input = sequenceLoop->addIterator(*inputTensors.data)->getOutput(0);
+    nvinfer1::IRecurrenceLayer* hidden = sequenceLoop->addRecurrence(*inputTensors.hidden);
+    nvinfer1::IRecurrenceLayer* cell = sequenceLoop->addRecurrence(*inputTensors.cell);
+
+    const LstmIO next = addLSTMStep(network, LstmIO{input, hidden->getOutput(0), cell->getOutput(0)}, params);
+    nvinfer1::ITensor* C = next.cell;
+    nvinfer1::ITensor* H = next.hidden;
+
     // Recurrent backedge input for hidden and cell.
     cell->setInput(1, *C);
     hidden->setInput(1, *H);
@@ -526,26 +594,9 @@ nvinfer1::ITensor* SampleCharRNNBase::addReshape(
     return shuffle->getOutput(0);
 }
 
-nvinfer1::ILayer* SampleCharRNNLoop::addLSTMLayers(SampleUniquePtr<nvinfer1::INetworkDefinition>& network)
+std::vector<SampleCharRNNLoop::LstmParams> SampleCharRNNLoop::addLSTMParams(
+    SampleUniquePtr<nvinfer1::INetworkDefinition>& network)
 {
-    nvinfer1::ILayer* dataOut{nullptr};
-
-    nvinfer1::ITensor* data = network->addInput(mParams.bindingNames.INPUT_BLOB_NAME, nvinfer1::DataType::kFLOAT,
-        nvinfer1::Dims2(mParams.seqSize, mParams.dataSize));
-    assert(data != nullptr);
-
-    nvinfer1::ITensor* hiddenLayers = network->addInput(mParams.bindingNames.HIDDEN_IN_BLOB_NAME,
-        nvinfer1::DataType::kFLOAT, nvinfer1::Dims2(mParams.layerCount, mParams.hiddenSize));
-    assert(hiddenLayers != nullptr);
-
-    nvinfer1::ITensor* cellLayers = network->addInput(mParams.bindingNames.CELL_IN_BLOB_NAME,
-        nvinfer1::DataType::kFLOAT, nvinfer1::Dims2(mParams.layerCount, mParams.hiddenSize));
-    assert(cellLayers != nullptr);
-
-    nvinfer1::ITensor* sequenceSize
-        = network->addInput(mParams.bindingNames.SEQ_LEN_IN_BLOB_NAME, nvinfer1::DataType::kINT32, nvinfer1::Dims{});
-    assert(sequenceSize != nullptr);
-
     // convert tensorflow weight format to trt weight format
     std::array<nvinfer1::Weights, 2> rnnw{
         SampleCharRNNBase::convertRNNWeights(mWeightMap[mParams.weightNames.RNNW_L0_NAME], mParams.dataSize),
@@ -560,12 +611,7 @@ nvinfer1::ILayer* SampleCharRNNLoop::addLSTMLayers(SampleUniquePtr<nvinfer1::INe
     mWeightMap["rnnbL0"] = rnnb[0];
     mWeightMap["rnnbL1"] = rnnb[1];
 
-    nvinfer1::ITensor* maxSequenceSize
-        = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &mParams.seqSize, 1})->getOutput(0);
     assert(static_cast<size_t>(mParams.layerCount) <= INDICES.size());
-    LstmIO lstmNext{data, nullptr, nullptr};
-    std::vector<nvinfer1::ITensor*> hiddenOutputs;
-    std::vector<nvinfer1::ITensor*> cellOutputs;
     nvinfer1::Dims2 dimWL0(4 * mParams.hiddenSize, mParams.dataSize);
     nvinfer1::Dims2 dimR(4 * mParams.hiddenSize, mParams.hiddenSize);
     nvinfer1::Dims dimB{1, {4 * mParams.hiddenSize}};
@@ -578,19 +624,54 @@ nvinfer1::ILayer* SampleCharRNNLoop::addLSTMLayers(SampleUniquePtr<nvinfer1::INe
         assert(shift + count <= weights.count);
         return nvinfer1::Weights{weights.type, data + shift * sizeOfElement, count};
     };
+    std::vector<LstmParams> layerParams;
     for (int i = 0; i < mParams.layerCount; ++i)
     {
         nvinfer1::Dims dimW = i == 0 ? dimWL0 : dimR;
-        nvinfer1::ITensor* index
-            = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &INDICES[i], 1})->getOutput(0);
-        nvinfer1::ITensor* hidden = network->addGather(*hiddenLayers, *index, 0)->getOutput(0);
-        nvinfer1::ITensor* cell = network->addGather(*cellLayers, *index, 0)->getOutput(0);
         nvinfer1::ITensor* weightIn = network->addConstant(dimW, extractWeights(rnnw[i], dim0, dimW))->getOutput(0);
         nvinfer1::ITensor* weightRec = network->addConstant(dimR, extractWeights(rnnw[i], dimW, dimR))->getOutput(0);
         nvinfer1::ITensor* biasIn = network->addConstant(dimB, extractWeights(rnnb[i], dim0, dimB))->getOutput(0);
         nvinfer1::ITensor* biasRec = network->addConstant(dimB, extractWeights(rnnb[i], dimB, dimB))->getOutput(0);
+        layerParams.push_back(LstmParams{weightIn, weightRec, biasIn, biasRec, nullptr});
+    }
+    return layerParams;
+}
+
+nvinfer1::ILayer* SampleCharRNNLoop::addLSTMLayers(SampleUniquePtr<nvinfer1::INetworkDefinition>& network)
+{
+    nvinfer1::ILayer* dataOut{nullptr};
+
+    nvinfer1::ITensor* data = network->addInput(mParams.bindingNames.INPUT_BLOB_NAME, nvinfer1::DataType::kFLOAT,
+        nvinfer1::Dims2(mParams.seqSize, mParams.dataSize));
+    assert(data != nullptr);
+
+    nvinfer1::ITensor* hiddenLayers = network->addInput(mParams.bindingNames.HIDDEN_IN_BLOB_NAME,
+        nvinfer1::DataType::kFLOAT, nvinfer1::Dims2(mParams.layerCount, mParams.hiddenSize));
+    assert(hiddenLayers != nullptr);
+
+    nvinfer1::ITensor* cellLayers = network->addInput(mParams.bindingNames.CELL_IN_BLOB_NAME,
+        nvinfer1::DataType::kFLOAT, nvinfer1::Dims2(mParams.layerCount, mParams.hiddenSize));
+    assert(cellLayers != nullptr);
+
+    nvinfer1::ITensor* sequenceSize
+        = network->addInput(mParams.bindingNames.SEQ_LEN_IN_BLOB_NAME, nvinfer1::DataType::kINT32, nvinfer1::Dims{});
+    assert(sequenceSize != nullptr);
+
+    nvinfer1::ITensor* maxSequenceSize
+        = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &mParams.seqSize, 1})->getOutput(0);
+    std::vector<LstmParams> layerParams = addLSTMParams(network);
+    LstmIO lstmNext{data, nullptr, nullptr};
+    std::vector<nvinfer1::ITensor*> hiddenOutputs;
+    std::vector<nvinfer1::ITensor*> cellOutputs;
+    for (int i = 0; i < mParams.layerCount; ++i)
+    {
+        nvinfer1::ITensor* index
+            = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &INDICES[i], 1})->getOutput(0);
+        nvinfer1::ITensor* hidden = network->addGather(*hiddenLayers, *index, 0)->getOutput(0);
+        nvinfer1::ITensor* cell = network->addGather(*cellLayers, *index, 0)->getOutput(0);
         LstmIO lstmInput{lstmNext.data, hidden, cell};
-        LstmParams params{weightIn, weightRec, biasIn, biasRec, maxSequenceSize};
+        LstmParams params = layerParams[i];
+        params.maxSequenceSize = maxSequenceSize;
 
         Dims2 dims{1, mParams.hiddenSize};
         dataOut = addLSTMCell(network, lstmInput, sequenceSize, params, lstmNext);
@@ -790,30 +871,29 @@ bool SampleCharRNNBase::infer()
     cudaStream_t stream;
     CHECK(cudaStreamCreate(&stream));
 
-    // Set sequence lengths to maximum
+    // Set sequence lengths to maximum, they stay the same for all the steps
     std::fill_n(reinterpret_cast<int32_t*>(buffers.getHostBuffer(mParams.bindingNames.SEQ_LEN_IN_BLOB_NAME)), mParams.batchSize, mParams.seqSize);
+    CHECK(cudaMemcpyAsync(buffers.getDeviceBuffer(mParams.bindingNames.SEQ_LEN_IN_BLOB_NAME),
+        buffers.getHostBuffer(mParams.bindingNames.SEQ_LEN_IN_BLOB_NAME),
+        buffers.size(mParams.bindingNames.SEQ_LEN_IN_BLOB_NAME), cudaMemcpyHostToDevice, stream));
 
-    // Initialize hiddenIn and cellIn tensors to zero before seeding
-    void* hiddenIn = buffers.getHostBuffer(mParams.bindingNames.HIDDEN_IN_BLOB_NAME);
-    auto hiddenTensorSize = buffers.size(mParams.bindingNames.HIDDEN_IN_BLOB_NAME);
-
-    void* cellIn = buffers.getHostBuffer(mParams.bindingNames.CELL_IN_BLOB_NAME);
-    auto cellTensorSize = buffers.size(mParams.bindingNames.CELL_IN_BLOB_NAME);
-
-    std::memset(hiddenIn, 0, hiddenTensorSize);
-    std::memset(cellIn, 0, cellTensorSize);
+    // Ht-1/Ct-1 stay on the device, the pool swaps them with Ht/Ct between steps
+    samplesCommon::RecurrentSessionPool states(*mEngine, mParams.batchSize,
+        {{mParams.bindingNames.HIDDEN_IN_BLOB_NAME, mParams.bindingNames.HIDDEN_OUT_BLOB_NAME},
+            {mParams.bindingNames.CELL_IN_BLOB_NAME, mParams.bindingNames.CELL_OUT_BLOB_NAME}});
+    const int session = states.open(stream);
+    std::vector<void*> bindings = buffers.getDeviceBindings();
 
     // Seed the RNN with the input sentence.
     for (auto& a : inputSentence)
     {
         SampleCharRNNBase::copyEmbeddingToInput(buffers, a);
 
-        if (!SampleCharRNNBase::stepOnce(buffers, context, stream))
+        if (!SampleCharRNNBase::stepOnce(buffers, states, session, bindings, context, stream))
         {
             return false;
         }
 
-        SampleCharRNNBase::copyRNNOutputsToInputs(buffers);
         genstr.push_back(a);
     }
 
@@ -826,12 +906,11 @@ bool SampleCharRNNBase::infer()
     {
         SampleCharRNNBase::copyEmbeddingToInput(buffers, *genstr.rbegin());
 
-        if (!SampleCharRNNBase::stepOnce(buffers, context, stream))
+        if (!SampleCharRNNBase::stepOnce(buffers, states, session, bindings, context, stream))
         {
             return false;
         }
 
-        SampleCharRNNBase::copyRNNOutputsToInputs(buffers);
         predIdx = *reinterpret_cast<uint32_t*>(buffers.getHostBuffer(mParams.bindingNames.OUTPUT_BLOB_NAME));
         genstr.push_back(mParams.charMaps.idToChar.at(predIdx));
     }
@@ -859,41 +938,237 @@ void SampleCharRNNBase::copyEmbeddingToInput(samplesCommon::BufferManager& buffe
 //!
 //! \brief Perform one time step of inference with the TensorRT execution context
 //!
-bool SampleCharRNNBase::stepOnce(
-    samplesCommon::BufferManager& buffers, SampleUniquePtr<nvinfer1::IExecutionContext>& context, cudaStream_t& stream)
+bool SampleCharRNNBase::stepOnce(samplesCommon::BufferManager& buffers, samplesCommon::RecurrentSessionPool& states,
+    int session, std::vector<void*>& bindings, SampleUniquePtr<nvinfer1::IExecutionContext>& context,
+    cudaStream_t& stream)
 {
-    // Asynchronously copy data from host input buffers to device input buffers
-    buffers.copyInputToDeviceAsync(stream);
+    // Asynchronously copy the input character, the recurrent state is already on the device
+    const char* inputName = mParams.bindingNames.INPUT_BLOB_NAME;
+    CHECK(cudaMemcpyAsync(buffers.getDeviceBuffer(inputName), buffers.getHostBuffer(inputName), buffers.size(inputName),
+        cudaMemcpyHostToDevice, stream));
 
     // Asynchronously enqueue the inference work
-    if (mParams.useILoop ? !context->enqueueV2(buffers.getDeviceBindings().data(), stream, nullptr)
-                         : !context->enqueue(mParams.batchSize, buffers.getDeviceBindings().data(), stream, nullptr))
+    states.step(session);
+    states.bind(bindings);
+    if (mParams.useILoop ? !context->enqueueV2(bindings.data(), stream, nullptr)
+                         : !context->enqueue(states.batchSize(), bindings.data(), stream, nullptr))
     {
         return false;
     }
-    // Asynchronously copy data from device output buffers to host output buffers
-    buffers.copyOutputToHostAsync(stream);
+    states.advance(stream);
+
+    // Asynchronously copy the prediction back to the host
+    const char* outputName = mParams.bindingNames.OUTPUT_BLOB_NAME;
+    CHECK(cudaMemcpyAsync(buffers.getHostBuffer(outputName), buffers.getDeviceBuffer(outputName),
+        buffers.size(outputName), cudaMemcpyDeviceToHost, stream));
 
     cudaStreamSynchronize(stream);
     return true;
 }
 
 //!
-//! \brief Copies Ct/Ht output from the RNN to the Ct-1/Ht-1 input buffers for next time step
+//! \brief Create the generation network, whose loop runs the seed and generated characters, and build the engine.
+//!
+void SampleCharRNNGeneration::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
+    SampleUniquePtr<nvinfer1::INetworkDefinition>& network, SampleUniquePtr<nvinfer1::IBuilderConfig>& config)
+{
+    const auto& names = mParams.bindingNames;
+    nvinfer1::ITensor* prompt
+        = network->addInput(names.PROMPT_BLOB_NAME, nvinfer1::DataType::kINT32, nvinfer1::Dims{1, {mParams.maxSteps}});
+    assert(prompt != nullptr);
+
+    nvinfer1::ITensor* steps = network->addInput(names.STEPS_BLOB_NAME, nvinfer1::DataType::kINT32, nvinfer1::Dims{});
+    assert(steps != nullptr);
+
+    nvinfer1::ITensor* hiddenLayers = network->addInput(names.HIDDEN_IN_BLOB_NAME, nvinfer1::DataType::kFLOAT,
+        nvinfer1::Dims2(mParams.layerCount, mParams.hiddenSize));
+    assert(hiddenLayers != nullptr);
+
+    nvinfer1::ITensor* cellLayers = network->addInput(names.CELL_IN_BLOB_NAME, nvinfer1::DataType::kFLOAT,
+        nvinfer1::Dims2(mParams.layerCount, mParams.hiddenSize));
+    assert(cellLayers != nullptr);
+
+    std::vector<LstmParams> layerParams = addLSTMParams(network);
+
+    // Transpose FC weights since TensorFlow's weights are transposed when compared to TensorRT
+    utils::transposeSubBuffers((void*) mWeightMap[mParams.weightNames.FCW_NAME].values, nvinfer1::DataType::kFLOAT, 1,
+        mParams.hiddenSize, mParams.vocabSize);
+    nvinfer1::ITensor* fcWeights = network
+                                       ->addConstant(nvinfer1::Dims2(mParams.vocabSize, mParams.hiddenSize),
+                                           mWeightMap[mParams.weightNames.FCW_NAME])
+                                       ->getOutput(0);
+    nvinfer1::ITensor* fcBias
+        = network->addConstant(nvinfer1::Dims{1, {mParams.vocabSize}}, mWeightMap[mParams.weightNames.FCB_NAME])
+              ->getOutput(0);
+    nvinfer1::ITensor* embedding = network
+                                       ->addConstant(nvinfer1::Dims2(mParams.vocabSize, mParams.dataSize),
+                                           mWeightMap[mParams.weightNames.EMBED_NAME])
+                                       ->getOutput(0);
+    nvinfer1::ITensor* zero
+        = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &INDICES[0], 1})->getOutput(0);
+    nvinfer1::ITensor* maxSteps
+        = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &mParams.maxSteps, 1})->getOutput(0);
+
+    nvinfer1::ILoop* loop = network->addLoop();
+    loop->addTripLimit(*steps, nvinfer1::TripLimit::kCOUNT);
+
+    // The trips past the seed characters, padded with -1, feed the prediction of the previous trip back
+    nvinfer1::ITensor* seed = loop->addIterator(*prompt)->getOutput(0);
+    nvinfer1::IRecurrenceLayer* previous = loop->addRecurrence(*zero);
+    nvinfer1::ITensor* generating
+        = network->addElementWise(*seed, *zero, nvinfer1::ElementWiseOperation::kLESS)->getOutput(0);
+    nvinfer1::ITensor* character = network->addSelect(*generating, *previous->getOutput(0), *seed)->getOutput(0);
+    nvinfer1::ITensor* data = network->addGather(*embedding, *character, 0)->getOutput(0);
+
+    std::vector<nvinfer1::ITensor*> hiddenOutputs;
+    std::vector<nvinfer1::ITensor*> cellOutputs;
+    for (int i = 0; i < mParams.layerCount; ++i)
+    {
+        nvinfer1::ITensor* index
+            = network->addConstant(nvinfer1::Dims{}, Weights{DataType::kINT32, &INDICES[i], 1})->getOutput(0);
+        nvinfer1::IRecurrenceLayer* hidden
+            = loop->addRecurrence(*network->addGather(*hiddenLayers, *index, 0)->getOutput(0));
+        nvinfer1::IRecurrenceLayer* cell
+            = loop->addRecurrence(*network->addGather(*cellLayers, *index, 0)->getOutput(0));
+        const LstmIO next
+            = addLSTMStep(network, LstmIO{data, hidden->getOutput(0), cell->getOutput(0)}, layerParams[i]);
+        hidden->setInput(1, *next.hidden);
+        cell->setInput(1, *next.cell);
+        data = next.data;
+
+        Dims2 dims{1, mParams.hiddenSize};
+        hiddenOutputs.push_back(addReshape(
+            network, *loop->addLoopOutput(*next.hidden, nvinfer1::LoopOutput::kLAST_VALUE)->getOutput(0), dims));
+        cellOutputs.push_back(addReshape(
+            network, *loop->addLoopOutput(*next.cell, nvinfer1::LoopOutput::kLAST_VALUE)->getOutput(0), dims));
+    }
+
+    nvinfer1::ITensor* logits = network
+                                    ->addMatrixMultiply(*fcWeights, nvinfer1::MatrixOperation::kNONE, *data,
+                                        nvinfer1::MatrixOperation::kVECTOR)
+                                    ->getOutput(0);
+    logits = network->addElementWise(*logits, *fcBias, nvinfer1::ElementWiseOperation::kSUM)->getOutput(0);
+
+    // Add TopK layer to determine which character has highest probability, and feed it to the next trip.
+    auto pred = network->addTopK(*logits, nvinfer1::TopKOperation::kMAX, 1, 0x1);
+    assert(pred != nullptr);
+    nvinfer1::ITensor* prediction = addReshape(network, *pred->getOutput(1), nvinfer1::Dims{});
+    previous->setInput(1, *prediction);
+
+    nvinfer1::ILoopOutputLayer* generated = loop->addLoopOutput(*prediction, nvinfer1::LoopOutput::kCONCATENATE);
+    generated->setInput(1, *maxSteps);
+    generated->getOutput(0)->setName(names.GENERATED_BLOB_NAME);
+    network->markOutput(*generated->getOutput(0));
+    generated->getOutput(0)->setType(nvinfer1::DataType::kINT32);
+
+    auto addConcatenation = [&network](std::vector<nvinfer1::ITensor*> tensors) -> nvinfer1::ITensor* {
+        nvinfer1::IConcatenationLayer* concat = network->addConcatenation(tensors.data(), tensors.size());
+        concat->setAxis(0);
+        return concat->getOutput(0);
+    };
+
+    nvinfer1::ITensor* hiddenNext = addConcatenation(hiddenOutputs);
+    hiddenNext->setName(names.HIDDEN_OUT_BLOB_NAME);
+    network->markOutput(*hiddenNext);
+
+    nvinfer1::ITensor* cellNext = addConcatenation(cellOutputs);
+    cellNext->setName(names.CELL_OUT_BLOB_NAME);
+    network->markOutput(*cellNext);
+
+    gLogInfo << "Done constructing network..." << std::endl;
+
+    mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
+        builder->buildEngineWithConfig(*network, *config), samplesCommon::InferDeleter());
+}
+
+//!
+//! \brief Generates the predicted sequence of a seed string with a single enqueue
+//!
+//! \details The seed characters are copied in once, the trips of the loop are the seed characters and all the
+//!          generated ones but the last, and the predictions of the trips past the seed are copied out once.
 //!
-void SampleCharRNNBase::copyRNNOutputsToInputs(samplesCommon::BufferManager& buffers)
+bool SampleCharRNNGeneration::infer()
 {
-    // Copy Ct/Ht to the Ct-1/Ht-1 slots.
-    void* hiddenIn = buffers.getHostBuffer(mParams.bindingNames.HIDDEN_IN_BLOB_NAME);
-    void* hiddenOut = buffers.getHostBuffer(mParams.bindingNames.HIDDEN_OUT_BLOB_NAME);
-    auto hiddenTensorSize = buffers.size(mParams.bindingNames.HIDDEN_IN_BLOB_NAME);
+    samplesCommon::BufferManager buffers(mEngine, mParams.batchSize);
+    // The prompt, the step count and the initial states are small, they go to the device in a single copy
+    buffers.packInputs();
+
+    auto context = SampleUniquePtr<nvinfer1::IExecutionContext>(mEngine->createExecutionContext());
+
+    if (!context)
+    {
+        return false;
+    }
 
-    void* cellIn = buffers.getHostBuffer(mParams.bindingNames.CELL_IN_BLOB_NAME);
-    void* cellOut = buffers.getHostBuffer(mParams.bindingNames.CELL_OUT_BLOB_NAME);
-    auto cellTensorSize = buffers.size(mParams.bindingNames.CELL_IN_BLOB_NAME);
+    // Select a random seed string.
+    srand(unsigned(time(nullptr)));
+    int sentenceIndex = rand() % mParams.inputSentences.size();
+    std::string inputSentence = mParams.inputSentences[sentenceIndex];
+    std::string expected = mParams.outputSentences[sentenceIndex];
 
-    std::memcpy(hiddenIn, hiddenOut, hiddenTensorSize);
-    std::memcpy(cellIn, cellOut, cellTensorSize);
+    gLogInfo << "RNN warmup sentence: " << inputSentence << std::endl;
+    gLogInfo << "Expected output: " << expected << std::endl;
+
+    const auto& names = mParams.bindingNames;
+    const int steps = static_cast<int>(inputSentence.size() + expected.size()) - 1;
+    if (steps > mParams.maxSteps)
+    {
+        gLogError << "The sentence takes " << steps << " steps, the generation loop runs up to " << mParams.maxSteps
+                  << std::endl;
+        return false;
+    }
+    int32_t* prompt = static_cast<int32_t*>(buffers.getHostBuffer(names.PROMPT_BLOB_NAME));
+    std::fill_n(prompt, mParams.maxSteps, -1);
+    std::transform(inputSentence.begin(), inputSentence.end(), prompt,
+        [this](char c) { return mParams.charMaps.charToID.at(c); });
+    *static_cast<int32_t*>(buffers.getHostBuffer(names.STEPS_BLOB_NAME)) = steps;
+    std::memset(buffers.getHostBuffer(names.HIDDEN_IN_BLOB_NAME), 0, buffers.size(names.HIDDEN_IN_BLOB_NAME));
+    std::memset(buffers.getHostBuffer(names.CELL_IN_BLOB_NAME), 0, buffers.size(names.CELL_IN_BLOB_NAME));
+
+    cudaStream_t stream;
+    CHECK(cudaStreamCreate(&stream));
+    cudaEvent_t start;
+    cudaEvent_t end;
+    CHECK(cudaEventCreate(&start));
+    CHECK(cudaEventCreate(&end));
+
+    const auto release = [&]()
+    {
+        cudaEventDestroy(start);
+        cudaEventDestroy(end);
+        cudaStreamDestroy(stream);
+    };
+
+    buffers.copyInputToDeviceAsync(stream);
+    CHECK(cudaEventRecord(start, stream));
+    if (!context->enqueueV2(buffers.getDeviceBindings().data(), stream, nullptr))
+    {
+        // The input copy may still be reading the staging of the buffers
+        cudaStreamSynchronize(stream);
+        release();
+        return false;
+    }
+    CHECK(cudaEventRecord(end, stream));
+    buffers.copyOutputToHostAsync(stream);
+    CHECK(cudaStreamSynchronize(stream));
+
+    float ms{0};
+    CHECK(cudaEventElapsedTime(&ms, start, end));
+    release();
+
+    // The prediction of the last seed character is the first generated one
+    const int32_t* generated = static_cast<const int32_t*>(buffers.getHostBuffer(names.GENERATED_BLOB_NAME));
+    std::string genstr;
+    for (int t = static_cast<int>(inputSentence.size()) - 1; t < steps; ++t)
+    {
+        genstr.push_back(mParams.charMaps.idToChar.at(generated[t]));
+    }
+
+    gLogInfo << "Received: " << genstr << std::endl;
+    gLogInfo << "Generated " << genstr.size() << " characters in one enqueue of " << steps << " steps: " << ms
+             << " ms, " << ms / steps << " ms per step" << std::endl;
+
+    return genstr == expected;
 }
 
 //!
@@ -904,7 +1179,10 @@ bool SampleCharRNNBase::teardown()
     // Clean up runtime resources
     for (auto& mem : mWeightMap)
     {
-        delete[] static_cast<const float*>(mem.second.values);
+        if (!mWeightsFile || !mWeightsFile->contains(mem.second.values))
+        {
+            delete[] static_cast<const float*>(mem.second.values);
+        }
     }
 
     return true;
@@ -936,7 +1214,10 @@ SampleCharRNNParams initializeSampleParams(const samplesCommon::Args& args)
     params.vocabSize = 65;
     params.outputSize = 1;
     params.weightFileName = locateFile("char-rnn.wts", params.dataDirs);
-    params.useILoop = args.useILoop;
+    // The generation loop is an ILoop network too, built with an explicit batch
+    params.useILoop = args.useILoop || args.useGenerationLoop;
+    params.useGenerationLoop = args.useGenerationLoop;
+    params.maxSteps = 64;
 
     // Input strings and their respective expected output strings
     const std::vector<std::string> inS{
@@ -978,6 +1259,7 @@ void printHelpInfo()
     std::cout << "Usage: ./sample_char_rnn [-h or --help] [-d or --datadir=<path to data directory>]\n";
     std::cout << "--help          Display help information\n";
     std::cout << "--useILoop      Use ILoop LSTM definition\n";
+    std::cout << "--useGenerationLoop  Generate the whole sequence with one enqueue, the decode loop being an ILoop\n";
     std::cout << "--datadir       Specify path to a data directory, overriding the default. This option can be used multiple times to add multiple directories. If no data directories are given, the default is to use data/samples/char-rnn/ and data/char-rnn/" << std::endl;
 }
 
@@ -1008,7 +1290,11 @@ int main(int argc, char** argv)
     SampleCharRNNParams params = initializeSampleParams(args);
     std::unique_ptr<SampleCharRNNBase> sample;
 
-    if (args.useILoop)
+    if (args.useGenerationLoop)
+    {
+        sample.reset(new SampleCharRNNGeneration(params));
+    }
+    else if (args.useILoop)
     {
         sample.reset(new SampleCharRNNLoop(params));
     }
@@ -23,6 +23,7 @@
 //! Command: ./sample_dynamic_reshape [-h or --help [-d=/path/to/data/dir or --datadir=/path/to/data/dir]
 //!
 
+#include "EnginePipeline.h"
 #include "argsParser.h"
 #include "buffers.h"
 #include "common.h"
@@ -83,10 +84,11 @@ private:
 
     SampleUniquePtr<nvinfer1::IExecutionContext> mPreprocessorContext{nullptr}, mPredictionContext{nullptr};
 
-    samplesCommon::ManagedBuffer mInput{};          //!< Host and device buffers for the input.
-    samplesCommon::DeviceBuffer mPredictionInput{}; //!< Device buffer for the output of the preprocessor, i.e. the
-                                                    //!< input to the prediction model.
-    samplesCommon::ManagedBuffer mOutput{};         //!< Host buffer for the ouptut
+    //! Runs both engines on one stream, the output of the preprocessor is bound as the input of the prediction model.
+    std::unique_ptr<samplesCommon::EnginePipeline> mPipeline{nullptr};
+
+    samplesCommon::HostBuffer mInput{};  //!< Host buffer for the input.
+    samplesCommon::HostBuffer mOutput{}; //!< Host buffer for the ouptut
 
     template <typename T>
     SampleUniquePtr<T> makeUnique(T* t)
@@ -209,11 +211,12 @@ void SampleDynamicReshape::prepare()
 {
     mPreprocessorContext = makeUnique(mPreprocessorEngine->createExecutionContext());
     mPredictionContext = makeUnique(mPredictionEngine->createExecutionContext());
-    // Since input dimensions are not known ahead of time, we only allocate the output buffer and preprocessor output
-    // buffer.
-    mPredictionInput.resize(mPredictionInputDims);
-    mOutput.hostBuffer.resize(mPredictionOutputDims);
-    mOutput.deviceBuffer.resize(mPredictionOutputDims);
+    // The device buffers are sized by the pipeline once the input dimensions are known.
+    const samplesCommon::EnginePipeline::Link link{
+        mPreprocessorEngine->getBindingName(1), mPredictionEngine->getBindingName(0)};
+    mPipeline.reset(
+        new samplesCommon::EnginePipeline({mPreprocessorContext.get(), mPredictionContext.get()}, {{link}}));
+    mOutput.resize(mPredictionOutputDims);
 }
 
 //!
@@ -231,39 +234,32 @@ bool SampleDynamicReshape::infer()
     int digit = digitDistribution(generator);
 
     Dims inputDims = loadPGMFile(locateFile(std::to_string(digit) + ".pgm", mParams.dataDirs));
-    mInput.deviceBuffer.resize(inputDims);
-    CHECK(cudaMemcpy(
-        mInput.deviceBuffer.data(), mInput.hostBuffer.data(), mInput.hostBuffer.nbBytes(), cudaMemcpyHostToDevice));
 
-    // Set the input size for the preprocessor
-    mPreprocessorContext->setBindingDimensions(0, inputDims);
+    // Set the input size for the preprocessor, the pipeline passes the resized shape on to the prediction model.
     // We can only run inference once all dynamic input shapes have been specified.
-    if (!mPreprocessorContext->allInputDimensionsSpecified())
+    const std::string inputName = mPreprocessorEngine->getBindingName(0);
+    if (!mPipeline->setInputDimensions(0, inputName, inputDims) || !mPipeline->resolve())
     {
         return false;
     }
 
-    // Run the preprocessor to resize the input to the correct shape
-    std::vector<void*> preprocessorBindings = {mInput.deviceBuffer.data(), mPredictionInput.data()};
-    // For engines using full dims, we can use executeV2, which does not include a separate batch size parameter.
-    bool status = mPreprocessorContext->executeV2(preprocessorBindings.data());
-    if (!status)
-    {
-        return false;
-    }
+    cudaStream_t stream;
+    CHECK(cudaStreamCreate(&stream));
+    CHECK(cudaMemcpyAsync(
+        mPipeline->binding(0, inputName), mInput.data(), mInput.nbBytes(), cudaMemcpyHostToDevice, stream));
 
-    // Next, run the model to generate a prediction.
-    std::vector<void*> predicitonBindings = {mPredictionInput.data(), mOutput.deviceBuffer.data()};
-    status = mPredictionContext->executeV2(predicitonBindings.data());
-    if (!status)
+    // Run the preprocessor to resize the input to the correct shape, then the model to generate a prediction. The
+    // resized input stays on the device between the two.
+    bool status = mPipeline->enqueue(stream);
+    if (status)
     {
-        return false;
+        // Copy the outputs back to the host and verify the output.
+        CHECK(cudaMemcpyAsync(mOutput.data(), mPipeline->binding(1, mPredictionEngine->getBindingName(1)),
+            mOutput.nbBytes(), cudaMemcpyDeviceToHost, stream));
     }
-
-    // Copy the outputs back to the host and verify the output.
-    CHECK(cudaMemcpy(mOutput.hostBuffer.data(), mOutput.deviceBuffer.data(), mOutput.deviceBuffer.nbBytes(),
-        cudaMemcpyDeviceToHost));
-    return validateOutput(digit);
+    CHECK(cudaStreamSynchronize(stream));
+    CHECK(cudaStreamDestroy(stream));
+    return status && validateOutput(digit);
 }
 
 //!
@@ -295,8 +291,8 @@ Dims SampleDynamicReshape::loadPGMFile(const std::string& fileName)
     gLogInfo << std::endl;
 
     // Normalize and copy to the host buffer.
-    mInput.hostBuffer.resize(inputDims);
-    float* hostDataBuffer = static_cast<float*>(mInput.hostBuffer.data());
+    mInput.resize(inputDims);
+    float* hostDataBuffer = static_cast<float*>(mInput.data());
     std::transform(fileData.begin(), fileData.end(), hostDataBuffer,
         [](uint8_t x) { return 1.0 - static_cast<float>(x / 255.0); });
     return inputDims;
@@ -307,8 +303,8 @@ Dims SampleDynamicReshape::loadPGMFile(const std::string& fileName)
 //!
 bool SampleDynamicReshape::validateOutput(int digit)
 {
-    const float* bufRaw = static_cast<const float*>(mOutput.hostBuffer.data());
-    std::vector<float> prob(bufRaw, bufRaw + mOutput.hostBuffer.size());
+    const float* bufRaw = static_cast<const float*>(mOutput.data());
+    std::vector<float> prob(bufRaw, bufRaw + mOutput.size());
 
     int curIndex{0};
     for (const auto& elem : prob)
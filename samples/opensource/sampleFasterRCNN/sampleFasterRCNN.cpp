@@ -25,6 +25,7 @@
 #include "argsParser.h"
 #include "buffers.h"
 #include "common.h"
+#include "imagePreprocessor.h"
 #include "logger.h"
 
 #include "NvCaffeParser.h"
@@ -44,8 +45,11 @@ const std::string gSampleName = "TensorRT.sample_fasterRCNN";
 //!
 struct SampleFasterRCNNParams : public samplesCommon::CaffeSampleParams
 {
-    int outputClsSize; //!< The number of output classes
-    int nmsMaxOut;     //!< The maximum number of detection post-NMS
+    int outputClsSize;    //!< The number of output classes
+    int nmsMaxOut;        //!< The maximum number of detection post-NMS
+    int keepTopK;         //!< The maximum number of detections per image after the final NMS
+    float scoreThreshold; //!< The class probability above which a box is a detection
+    float nmsThreshold;   //!< The IoU above which the final NMS suppresses a detection
 };
 
 //! \brief  The SampleFasterRCNN class implements the FasterRCNN sample
@@ -91,6 +95,10 @@ private:
 
     std::shared_ptr<nvinfer1::ICudaEngine> mEngine; //!< The TensorRT engine used to run the network
 
+    SampleUniquePtr<nvinfer1::IPluginV2> mDetectionOutput; //!< The post-processing plugin, used until the build
+
+    std::unique_ptr<samplesCommon::ImagePreprocessor> mPreprocessor; //!< Converts the images on the device
+
     //!
     //! \brief Parses a Caffe model for FasterRCNN and creates a TensorRT network
     //!
@@ -99,26 +107,14 @@ private:
         SampleUniquePtr<nvinfer1::IBuilderConfig>& config);
 
     //!
-    //! \brief Reads the input and mean data, preprocesses, and stores the result in a managed buffer
+    //! \brief Reads the input images into the preprocessor and the image info into a managed buffer
     //!
     bool processInput(const samplesCommon::BufferManager& buffers);
 
     //!
-    //! \brief Filters output detections, handles post-processing of bounding boxes and verify results
+    //! \brief Reports the detections and verifies the results
     //!
     bool verifyOutput(const samplesCommon::BufferManager& buffers);
-
-    //!
-    //! \brief Performs inverse bounding box transform and clipping
-    //!
-    void bboxTransformInvAndClip(const float* rois, const float* deltas, float* predBBoxes, const float* imInfo,
-        const int N, const int nmsMaxOut, const int numCls);
-
-    //!
-    //! \brief Performs non maximum suppression on final bounding boxes
-    //!
-    std::vector<int> nonMaximumSuppression(std::vector<std::pair<float, int>>& scoreIndex, float* bbox,
-        const int classNum, const int numClasses, const float nmsThreshold);
 };
 
 //!
@@ -171,8 +167,8 @@ bool SampleFasterRCNN::build()
 }
 
 //!
-//! \brief Uses a caffe parser to create the FasterRCNN network and marks the
-//!        output layers
+//! \brief Uses a caffe parser to create the FasterRCNN network, appends the detection post-processing and marks
+//!        its outputs
 //!
 //! \param network Pointer to the network that will be populated with the FasterRCNN network
 //!
@@ -186,9 +182,24 @@ void SampleFasterRCNN::constructNetwork(SampleUniquePtr<nvcaffeparser1::ICaffePa
         = parser->parse(locateFile(mParams.prototxtFileName, mParams.dataDirs).c_str(),
             locateFile(mParams.weightsFileName, mParams.dataDirs).c_str(), *network, nvinfer1::DataType::kFLOAT);
 
-    for (auto& s : mParams.outputTensorNames)
+    // Decode, clip and suppress the boxes of every roi on the device, only the detections are copied back
+    auto* creator = getPluginRegistry()->getPluginCreator("FasterRCNNDetectionOutput_TRT", "1");
+    std::vector<nvinfer1::PluginField> fields{
+        {"numClasses", &mParams.outputClsSize, nvinfer1::PluginFieldType::kINT32, 1},
+        {"topK", &mParams.nmsMaxOut, nvinfer1::PluginFieldType::kINT32, 1},
+        {"keepTopK", &mParams.keepTopK, nvinfer1::PluginFieldType::kINT32, 1},
+        {"scoreThreshold", &mParams.scoreThreshold, nvinfer1::PluginFieldType::kFLOAT32, 1},
+        {"iouThreshold", &mParams.nmsThreshold, nvinfer1::PluginFieldType::kFLOAT32, 1}};
+    nvinfer1::PluginFieldCollection fc{static_cast<int>(fields.size()), fields.data()};
+    mDetectionOutput.reset(creator->createPlugin("detection_output", &fc));
+
+    nvinfer1::ITensor* inputs[] = {blobNameToTensor->find("rois"), blobNameToTensor->find("bbox_pred"),
+        blobNameToTensor->find("cls_prob"), blobNameToTensor->find("im_info")};
+    auto* detectionOutput = network->addPluginV2(inputs, 4, *mDetectionOutput);
+    for (int i = 0; i < detectionOutput->getNbOutputs(); ++i)
     {
-        network->markOutput(*blobNameToTensor->find(s.c_str()));
+        detectionOutput->getOutput(i)->setName(mParams.outputTensorNames[i].c_str());
+        network->markOutput(*detectionOutput->getOutput(i));
     }
 
     builder->setMaxBatchSize(mParams.batchSize);
@@ -213,8 +224,9 @@ bool SampleFasterRCNN::infer()
         return false;
     }
 
-    // Read the input data into the managed buffers
+    // Read the input data into the managed buffers, the images are preprocessed on the device
     assert(mParams.inputTensorNames.size() == 2);
+    buffers.setFilledOnDevice("data");
     if (!processInput(buffers))
     {
         return false;
@@ -222,6 +234,7 @@ bool SampleFasterRCNN::infer()
 
     // Memcpy from host input buffers to device input buffers
     buffers.copyInputToDevice();
+    mPreprocessor->enqueue(mParams.batchSize, buffers.getDeviceBuffer("data"), 0);
 
     bool status = context->execute(mParams.batchSize, buffers.getDeviceBindings().data());
     if (!status)
@@ -254,7 +267,7 @@ bool SampleFasterRCNN::teardown()
 }
 
 //!
-//! \brief Reads the input and mean data, preprocesses, and stores the result in a managed buffer
+//! \brief Reads the input images into the preprocessor and the image info into a managed buffer
 //!
 bool SampleFasterRCNN::processInput(const samplesCommon::BufferManager& buffers)
 {
@@ -278,54 +291,45 @@ bool SampleFasterRCNN::processInput(const samplesCommon::BufferManager& buffers)
         hostImInfoBuffer[i * 3 + 2] = 1;                 // Image scale
     }
 
-    // Fill data buffer
-    float* hostDataBuffer = static_cast<float*>(buffers.getHostBuffer("data"));
-    // Pixel mean used by the Faster R-CNN's author
-    const float pixelMean[3]{102.9801f, 115.9465f, 122.7717f}; // Also in BGR order
-    for (int i = 0, volImg = inputC * inputH * inputW; i < batchSize; ++i)
+    // The 8-bit images are copied to the device, converted to BGR planes and mean subtracted there
+    samplesCommon::ImagePreprocessParams preprocess;
+    preprocess.srcH = kIMG_H;
+    preprocess.srcW = kIMG_W;
+    preprocess.dstH = inputH;
+    preprocess.dstW = inputW;
+    preprocess.reverseChannels = true;
+    // Pixel mean used by the Faster R-CNN's author, in BGR order
+    preprocess.mean[0] = 102.9801f;
+    preprocess.mean[1] = 115.9465f;
+    preprocess.mean[2] = 122.7717f;
+    if (inputC != kIMG_CHANNELS)
     {
-        for (int c = 0; c < inputC; ++c)
-        {
-            // The color image to input should be in BGR order
-            for (unsigned j = 0, volChl = inputH * inputW; j < volChl; ++j)
-                hostDataBuffer[i * volImg + c * volChl + j] = float(mPPMs[i].buffer[j * inputC + 2 - c]) - pixelMean[c];
-        }
+        return false;
+    }
+    mPreprocessor.reset(new samplesCommon::ImagePreprocessor(preprocess, batchSize));
+    for (int i = 0; i < batchSize; ++i)
+    {
+        mPreprocessor->setHostImage(i, mPPMs[i].buffer);
     }
 
     return true;
 }
 
 //!
-//! \brief Filters output detections and handles post-processing of bounding boxes, verify result
+//! \brief Reports the detections of the GPU post-processing and verifies the result
 //!
 //! \return whether the detection output matches expectations
 //!
 bool SampleFasterRCNN::verifyOutput(const samplesCommon::BufferManager& buffers)
 {
     const int batchSize = mParams.batchSize;
-    const int nmsMaxOut = mParams.nmsMaxOut;
-    const int outputClsSize = mParams.outputClsSize;
-    const int outputBBoxSize = mParams.outputClsSize * 4;
+    const int keepTopK = mParams.keepTopK;
 
-    const float* imInfo = static_cast<const float*>(buffers.getHostBuffer("im_info"));
-    const float* deltas = static_cast<const float*>(buffers.getHostBuffer("bbox_pred"));
-    const float* clsProbs = static_cast<const float*>(buffers.getHostBuffer("cls_prob"));
-    float* rois = static_cast<float*>(buffers.getHostBuffer("rois"));
+    const int* numDetections = static_cast<const int*>(buffers.getHostBuffer("num_detections"));
+    const float* nmsedBoxes = static_cast<const float*>(buffers.getHostBuffer("nmsed_boxes"));
+    const float* nmsedScores = static_cast<const float*>(buffers.getHostBuffer("nmsed_scores"));
+    const float* nmsedClasses = static_cast<const float*>(buffers.getHostBuffer("nmsed_classes"));
 
-    // Unscale back to raw image space
-    for (int i = 0; i < batchSize; ++i)
-    {
-        for (int j = 0; j < nmsMaxOut * 4 && imInfo[i * 3 + 2] != 1; ++j)
-        {
-            rois[i * nmsMaxOut * 4 + j] /= imInfo[i * 3 + 2];
-        }
-    }
-
-    std::vector<float> predBBoxes(batchSize * nmsMaxOut * outputBBoxSize, 0);
-    bboxTransformInvAndClip(rois, deltas, predBBoxes.data(), imInfo, batchSize, nmsMaxOut, outputClsSize);
-
-    const float nmsThreshold = 0.3f;
-    const float score_threshold = 0.8f;
     const std::vector<std::string> classes{"background", "aeroplane", "bicycle", "bird", "boat", "bottle", "bus", "car",
         "cat", "chair", "cow", "diningtable", "dog", "horse", "motorbike", "person", "pottedplant", "sheep", "sofa",
         "train", "tvmonitor"};
@@ -335,136 +339,24 @@ bool SampleFasterRCNN::verifyOutput(const samplesCommon::BufferManager& buffers)
 
     for (int i = 0; i < batchSize; ++i)
     {
-        float* bbox = predBBoxes.data() + i * nmsMaxOut * outputBBoxSize;
-        const float* scores = clsProbs + i * nmsMaxOut * outputClsSize;
-        int numDetections = 0;
-        for (int c = 1; c < outputClsSize; ++c) // Skip the background
+        for (int k = 0; k < numDetections[i]; ++k)
         {
-            std::vector<std::pair<float, int>> scoreIndex;
-            for (int r = 0; r < nmsMaxOut; ++r)
-            {
-                if (scores[r * outputClsSize + c] > score_threshold)
-                {
-                    scoreIndex.push_back(std::make_pair(scores[r * outputClsSize + c], r));
-                    std::stable_sort(scoreIndex.begin(), scoreIndex.end(),
-                        [](const std::pair<float, int>& pair1, const std::pair<float, int>& pair2) {
-                            return pair1.first > pair2.first;
-                        });
-                }
-            }
-
-            // Apply NMS algorithm
-            const std::vector<int> indices = nonMaximumSuppression(scoreIndex, bbox, c, outputClsSize, nmsThreshold);
-
-            numDetections += static_cast<int>(indices.size());
-
-            // Show results
-            for (unsigned k = 0; k < indices.size(); ++k)
-            {
-                const int idx = indices[k];
-                const std::string storeName
-                    = classes[c] + "-" + std::to_string(scores[idx * outputClsSize + c]) + ".ppm";
-                gLogInfo << "Detected " << classes[c] << " in " << mPPMs[i].fileName << " with confidence "
-                         << scores[idx * outputClsSize + c] * 100.0f << "% "
-                         << " (Result stored in " << storeName << ")." << std::endl;
-
-                const samplesCommon::BBox b{bbox[idx * outputBBoxSize + c * 4], bbox[idx * outputBBoxSize + c * 4 + 1],
-                    bbox[idx * outputBBoxSize + c * 4 + 2], bbox[idx * outputBBoxSize + c * 4 + 3]};
-                writePPMFileWithBBox(storeName, mPPMs[i], b);
-            }
+            const int idx = i * keepTopK + k;
+            const std::string& className = classes[static_cast<int>(nmsedClasses[idx])];
+            const std::string storeName = className + "-" + std::to_string(nmsedScores[idx]) + ".ppm";
+            gLogInfo << "Detected " << className << " in " << mPPMs[i].fileName << " with confidence "
+                     << nmsedScores[idx] * 100.0f << "% "
+                     << " (Result stored in " << storeName << ")." << std::endl;
+
+            const float* box = nmsedBoxes + idx * 4;
+            const samplesCommon::BBox b{box[0], box[1], box[2], box[3]};
+            writePPMFileWithBBox(storeName, mPPMs[i], b);
         }
-        pass &= numDetections >= 1;
+        pass &= numDetections[i] >= 1;
     }
     return pass;
 }
 
-//!
-//! \brief Performs inverse bounding box transform
-//!
-void SampleFasterRCNN::bboxTransformInvAndClip(const float* rois, const float* deltas, float* predBBoxes,
-    const float* imInfo, const int N, const int nmsMaxOut, const int numCls)
-{
-    for (int i = 0; i < N * nmsMaxOut; ++i)
-    {
-        float width = rois[i * 4 + 2] - rois[i * 4] + 1;
-        float height = rois[i * 4 + 3] - rois[i * 4 + 1] + 1;
-        float ctr_x = rois[i * 4] + 0.5f * width;
-        float ctr_y = rois[i * 4 + 1] + 0.5f * height;
-        const float* imInfo_offset = imInfo + i / nmsMaxOut * 3;
-        for (int j = 0; j < numCls; ++j)
-        {
-            float dx = deltas[i * numCls * 4 + j * 4];
-            float dy = deltas[i * numCls * 4 + j * 4 + 1];
-            float dw = deltas[i * numCls * 4 + j * 4 + 2];
-            float dh = deltas[i * numCls * 4 + j * 4 + 3];
-            float pred_ctr_x = dx * width + ctr_x;
-            float pred_ctr_y = dy * height + ctr_y;
-            float pred_w = exp(dw) * width;
-            float pred_h = exp(dh) * height;
-            predBBoxes[i * numCls * 4 + j * 4]
-                = std::max(std::min(pred_ctr_x - 0.5f * pred_w, imInfo_offset[1] - 1.f), 0.f);
-            predBBoxes[i * numCls * 4 + j * 4 + 1]
-                = std::max(std::min(pred_ctr_y - 0.5f * pred_h, imInfo_offset[0] - 1.f), 0.f);
-            predBBoxes[i * numCls * 4 + j * 4 + 2]
-                = std::max(std::min(pred_ctr_x + 0.5f * pred_w, imInfo_offset[1] - 1.f), 0.f);
-            predBBoxes[i * numCls * 4 + j * 4 + 3]
-                = std::max(std::min(pred_ctr_y + 0.5f * pred_h, imInfo_offset[0] - 1.f), 0.f);
-        }
-    }
-}
-
-//!
-//! \brief Performs non maximum suppression on final bounding boxes
-//!
-std::vector<int> SampleFasterRCNN::nonMaximumSuppression(std::vector<std::pair<float, int>>& scoreIndex, float* bbox,
-    const int classNum, const int numClasses, const float nmsThreshold)
-{
-    auto overlap1D = [](float x1min, float x1max, float x2min, float x2max) -> float {
-        if (x1min > x2min)
-        {
-            std::swap(x1min, x2min);
-            std::swap(x1max, x2max);
-        }
-        return x1max < x2min ? 0 : std::min(x1max, x2max) - x2min;
-    };
-
-    auto computeIoU = [&overlap1D](float* bbox1, float* bbox2) -> float {
-        float overlapX = overlap1D(bbox1[0], bbox1[2], bbox2[0], bbox2[2]);
-        float overlapY = overlap1D(bbox1[1], bbox1[3], bbox2[1], bbox2[3]);
-        float area1 = (bbox1[2] - bbox1[0]) * (bbox1[3] - bbox1[1]);
-        float area2 = (bbox2[2] - bbox2[0]) * (bbox2[3] - bbox2[1]);
-        float overlap2D = overlapX * overlapY;
-        float u = area1 + area2 - overlap2D;
-        return u == 0 ? 0 : overlap2D / u;
-    };
-
-    std::vector<int> indices;
-    for (auto i : scoreIndex)
-    {
-        const int idx = i.second;
-        bool keep = true;
-        for (unsigned k = 0; k < indices.size(); ++k)
-        {
-            if (keep)
-            {
-                const int kept_idx = indices[k];
-                float overlap = computeIoU(
-                    &bbox[(idx * numClasses + classNum) * 4], &bbox[(kept_idx * numClasses + classNum) * 4]);
-                keep = overlap <= nmsThreshold;
-            }
-            else
-            {
-                break;
-            }
-        }
-        if (keep)
-        {
-            indices.push_back(idx);
-        }
-    }
-    return indices;
-}
-
 //!
 //! \brief Initializes members of the params struct using the command line args
 //!
@@ -485,14 +377,18 @@ SampleFasterRCNNParams initializeSampleParams(const samplesCommon::Args& args)
     params.inputTensorNames.push_back("data");
     params.inputTensorNames.push_back("im_info");
     params.batchSize = 5;
-    params.outputTensorNames.push_back("bbox_pred");
-    params.outputTensorNames.push_back("cls_prob");
-    params.outputTensorNames.push_back("rois");
+    params.outputTensorNames.push_back("num_detections");
+    params.outputTensorNames.push_back("nmsed_boxes");
+    params.outputTensorNames.push_back("nmsed_scores");
+    params.outputTensorNames.push_back("nmsed_classes");
     params.dlaCore = args.useDLACore;
 
     params.outputClsSize = 21;
     params.nmsMaxOut
         = 300; // This value needs to be changed as per the nmsMaxOut value set in RPROI plugin parameters in prototxt
+    params.keepTopK = 100;
+    params.scoreThreshold = 0.8f;
+    params.nmsThreshold = 0.3f;
 
     return params;
 }
@@ -23,6 +23,7 @@
 //!
 
 #include "BatchStream.h"
+#include "AdaptiveCalibration.h"
 #include "EntropyCalibrator.h"
 #include "argsParser.h"
 #include "buffers.h"
@@ -48,6 +49,7 @@ struct SampleINT8Params : public samplesCommon::CaffeSampleParams
 {
     int nbCalBatches;        //!< The number of batches for calibration
     int calBatchSize;        //!< The calibration batch size
+    float calTolerance;      //!< Range change under which adaptive calibration stops, 0 to calibrate on all batches
     std::string networkName; //!< The name of the network
 };
 
@@ -232,12 +234,15 @@ bool SampleINT8::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
     }
     builder->setMaxBatchSize(mParams.batchSize);
 
-    if (dataType == DataType::kINT8)
+    MNISTBatchStream calibrationStream(mParams.calBatchSize, mParams.nbCalBatches, "train-images-idx3-ubyte",
+        "train-labels-idx1-ubyte", mParams.dataDirs);
+    const std::string modelHash = samplesCommon::hashModelFiles({locateFile(mParams.weightsFileName, mParams.dataDirs),
+        locateFile(mParams.prototxtFileName, mParams.dataDirs)});
+    const bool adaptive = dataType == DataType::kINT8 && mParams.calTolerance > 0;
+    if (dataType == DataType::kINT8 && !adaptive)
     {
-        MNISTBatchStream calibrationStream(mParams.calBatchSize, mParams.nbCalBatches, "train-images-idx3-ubyte",
-            "train-labels-idx1-ubyte", mParams.dataDirs);
-        calibrator.reset(new Int8EntropyCalibrator2<MNISTBatchStream>(
-            calibrationStream, 0, mParams.networkName.c_str(), mParams.inputTensorNames[0].c_str()));
+        calibrator.reset(new Int8EntropyCalibrator2<MNISTBatchStream>(calibrationStream, 0,
+            mParams.networkName.c_str(), mParams.inputTensorNames[0].c_str(), true, modelHash));
         config->setInt8Calibrator(calibrator.get());
     }
 
@@ -252,6 +257,36 @@ bool SampleINT8::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
         }
     }
 
+    if (adaptive)
+    {
+        // Each calibration builds an engine, the one of the last calibration is kept. The first one reads the cache
+        // file, which ends the search when it holds the scales of this model.
+        samplesCommon::AdaptiveCalibration calibration(mParams.nbCalBatches, 1, mParams.calTolerance / 100);
+        std::unique_ptr<Int8EntropyCalibrator2<MNISTBatchStream>> partial;
+        do
+        {
+            mEngine.reset();
+            const bool first = !partial;
+            partial.reset(new Int8EntropyCalibrator2<MNISTBatchStream>(calibrationStream, 0,
+                mParams.networkName.c_str(), mParams.inputTensorNames[0].c_str(), first, modelHash,
+                calibration.nextBatches()));
+            config->setInt8Calibrator(partial.get());
+            mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
+                builder->buildEngineWithConfig(*network, *config), samplesCommon::InferDeleter());
+            if (!mEngine)
+            {
+                return false;
+            }
+            if (partial->cacheRead())
+            {
+                gLogInfo << "Adaptive calibration: the scales were read from the calibration cache" << std::endl;
+                return true;
+            }
+        } while (!calibration.addCalibration(partial->calibrationTable()));
+        partial->saveCalibrationCache();
+        return true;
+    }
+
     mEngine = std::shared_ptr<nvinfer1::ICudaEngine>(
         builder->buildEngineWithConfig(*network, *config), samplesCommon::InferDeleter());
     if (!mEngine)
@@ -406,7 +441,8 @@ int SampleINT8::calculateScore(
 //!
 //! \brief Initializes members of the params struct using the command line args
 //!
-SampleINT8Params initializeSampleParams(const samplesCommon::Args& args, int batchSize)
+SampleINT8Params initializeSampleParams(
+    const samplesCommon::Args& args, int batchSize, int nbCalBatches, float calTolerance)
 {
     SampleINT8Params params;
     // Use directories provided by the user, in addition to default directories.
@@ -420,8 +456,9 @@ SampleINT8Params initializeSampleParams(const samplesCommon::Args& args, int bat
 
     params.batchSize = batchSize;
     params.dlaCore = args.useDLACore;
-    params.nbCalBatches = 10;
+    params.nbCalBatches = nbCalBatches;
     params.calBatchSize = 50;
+    params.calTolerance = calTolerance;
     params.inputTensorNames.push_back("data");
     params.outputTensorNames.push_back("prob");
     params.prototxtFileName = "deploy.prototxt";
@@ -450,6 +487,11 @@ void printHelpInfo()
                  "be used for calibration."
               << std::endl;
     std::cout << "score=N         Set the number of batches to be scored (default = 400)." << std::endl;
+    std::cout << "calBatches=N    Set the number of batches of 50 images available for calibration (default = 10)."
+              << std::endl;
+    std::cout << "calTolerance=P  Calibrate on 1, 2, 4... batches until no tensor range changes by more than P%, "
+                 "instead of on all of them (default = 0, off)."
+              << std::endl;
 }
 
 int main(int argc, char** argv)
@@ -464,6 +506,8 @@ int main(int argc, char** argv)
     int batchSize = 32;
     int firstScoreBatch = 16;
     int nbScoreBatches = 1800;
+    int nbCalBatches = 10;
+    float calTolerance = 0;
 
     // Parse extra arguments
     for (int i = 1; i < argc; ++i)
@@ -480,6 +524,14 @@ int main(int argc, char** argv)
         {
             nbScoreBatches = atoi(argv[i] + 6);
         }
+        else if (!strncmp(argv[i], "calBatches=", 11))
+        {
+            nbCalBatches = atoi(argv[i] + 11);
+        }
+        else if (!strncmp(argv[i], "calTolerance=", 13))
+        {
+            calTolerance = atof(argv[i] + 13);
+        }
     }
 
     if (batchSize > 128)
@@ -494,10 +546,16 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
+    if (nbCalBatches < 1 || nbCalBatches * 50 > 60000 || calTolerance < 0)
+    {
+        gLogError << "Please provide 1 to 1200 calibration batches and a non-negative tolerance" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     samplesCommon::Args args;
     samplesCommon::parseArgs(args, argc, argv);
 
-    SampleINT8 sample(initializeSampleParams(args, batchSize));
+    SampleINT8 sample(initializeSampleParams(args, batchSize, nbCalBatches, calTolerance));
 
     auto sampleTest = gLogger.defineTest(gSampleName, argc, argv);
 
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jasperFeatures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace jasperSample
+{
+namespace
+{
+const int kThreadsPerBlock = 256;
+const int kMaxBlocks = 1024;
+constexpr float kLogGuard = 1.F / (1 << 24); // Added to the mel energies before the log, as in training
+
+__global__ void preemphasisKernel(const float* audio, int samples, float preemphasis, float* out)
+{
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < samples; i += gridDim.x * blockDim.x)
+    {
+        out[i] = i ? audio[i] - preemphasis * audio[i - 1] : audio[i];
+    }
+}
+
+// One block per frame, the windowed frame is staged in shared memory and each thread computes the power of some bins
+__global__ void powerSpectrumKernel(const float* signal, int samples, int hop, const float* hann,
+    const float2* twiddles, int fft, int bins, float* power)
+{
+    extern __shared__ float frame[];
+    const int center = blockIdx.x * hop;
+    for (int n = threadIdx.x; n < fft; n += blockDim.x)
+    {
+        // Reflect the samples before the start and past the end of the window, as the centered STFT of training
+        int s = center + n - fft / 2;
+        s = s < 0 ? -s : s;
+        s = s >= samples ? 2 * (samples - 1) - s : s;
+        s = max(0, min(samples - 1, s));
+        frame[n] = signal[s] * hann[n];
+    }
+    __syncthreads();
+    for (int k = threadIdx.x; k < bins; k += blockDim.x)
+    {
+        float re{0.F};
+        float im{0.F};
+        int phase{0};
+        for (int n = 0; n < fft; ++n)
+        {
+            const float2 t = twiddles[phase];
+            re += frame[n] * t.x;
+            im -= frame[n] * t.y;
+            phase += k;
+            phase -= phase >= fft ? fft : 0;
+        }
+        power[blockIdx.x * bins + k] = re * re + im * im;
+    }
+}
+
+// One thread per mel bin and frame, the features are written mel major, as the input of the model
+__global__ void melKernel(
+    const float* power, int frames, int bins, const float* filterbank, int mels, float* features)
+{
+    for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < mels * frames; i += gridDim.x * blockDim.x)
+    {
+        const int m = i / frames;
+        const int t = i % frames;
+        const float* weights = filterbank + m * bins;
+        const float* spectrum = power + t * bins;
+        float energy{0.F};
+        for (int k = 0; k < bins; ++k)
+        {
+            energy += weights[k] * spectrum[k];
+        }
+        features[i] = logf(energy + kLogGuard);
+    }
+}
+
+__device__ float blockSum(float value, float* scratch)
+{
+    scratch[threadIdx.x] = value;
+    __syncthreads();
+    for (int stride = blockDim.x / 2; stride > 0; stride /= 2)
+    {
+        if (threadIdx.x < stride)
+        {
+            scratch[threadIdx.x] += scratch[threadIdx.x + stride];
+        }
+        __syncthreads();
+    }
+    const float sum = scratch[0];
+    __syncthreads();
+    return sum;
+}
+
+// One block per mel bin, the features of the bin get a zero mean and a unit standard deviation over the frames
+__global__ void normalizeKernel(float* features, int frames)
+{
+    __shared__ float scratch[kThreadsPerBlock];
+    float* row = features + blockIdx.x * frames;
+    float sum{0.F};
+    for (int t = threadIdx.x; t < frames; t += blockDim.x)
+    {
+        sum += row[t];
+    }
+    const float mean = blockSum(sum, scratch) / frames;
+    float squares{0.F};
+    for (int t = threadIdx.x; t < frames; t += blockDim.x)
+    {
+        squares += (row[t] - mean) * (row[t] - mean);
+    }
+    const float deviation = sqrtf(blockSum(squares, scratch) / max(frames - 1, 1)) + 1e-5F;
+    for (int t = threadIdx.x; t < frames; t += blockDim.x)
+    {
+        row[t] = (row[t] - mean) / deviation;
+    }
+}
+
+int gridSize(int items)
+{
+    return std::max(1, std::min((items + kThreadsPerBlock - 1) / kThreadsPerBlock, kMaxBlocks));
+}
+
+//! The Slaney mel scale, linear below 1 kHz and logarithmic above
+float hertzToMel(float hertz)
+{
+    const float logStep = std::log(6.4F) / 27.F;
+    return hertz < 1000.F ? 3.F * hertz / 200.F : 15.F + std::log(hertz / 1000.F) / logStep;
+}
+
+float melToHertz(float mel)
+{
+    const float logStep = std::log(6.4F) / 27.F;
+    return mel < 15.F ? 200.F * mel / 3.F : 1000.F * std::exp(logStep * (mel - 15.F));
+}
+
+//! Triangular filters evenly spaced in mels from 0 to the Nyquist frequency, each normalized to the same area
+std::vector<float> slaneyFilterbank(const FeatureParams& params, int bins)
+{
+    std::vector<float> edges(params.mels + 2);
+    const float maxMel = hertzToMel(params.sampleRate / 2.F);
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        edges[e] = melToHertz(maxMel * e / (params.mels + 1));
+    }
+    std::vector<float> filterbank(params.mels * bins);
+    for (int m = 0; m < params.mels; ++m)
+    {
+        const float norm = 2.F / (edges[m + 2] - edges[m]);
+        for (int k = 0; k < bins; ++k)
+        {
+            const float hertz = static_cast<float>(k) * params.sampleRate / params.fft;
+            const float rising = (hertz - edges[m]) / (edges[m + 1] - edges[m]);
+            const float falling = (edges[m + 2] - hertz) / (edges[m + 2] - edges[m + 1]);
+            filterbank[m * bins + k] = std::max(0.F, std::min(rising, falling)) * norm;
+        }
+    }
+    return filterbank;
+}
+
+} // namespace
+
+FeatureExtractor::FeatureExtractor(const FeatureParams& params, int maxFrames)
+    : mParams(params)
+    , mMaxFrames(maxFrames)
+    , mBins(params.fft / 2 + 1)
+    , mTwiddles(2 * params.fft, nvinfer1::DataType::kFLOAT)
+    , mHann(params.fft, nvinfer1::DataType::kFLOAT)
+    , mFilterbank(params.mels * mBins, nvinfer1::DataType::kFLOAT)
+    , mPower(static_cast<size_t>(maxFrames) * mBins, nvinfer1::DataType::kFLOAT)
+    , mPreemphasized(static_cast<size_t>(maxFrames) * params.hop, nvinfer1::DataType::kFLOAT)
+{
+    const double pi = std::acos(-1.0);
+    std::vector<float> twiddles(2 * params.fft);
+    for (int k = 0; k < params.fft; ++k)
+    {
+        twiddles[2 * k] = static_cast<float>(std::cos(2 * pi * k / params.fft));
+        twiddles[2 * k + 1] = static_cast<float>(std::sin(2 * pi * k / params.fft));
+    }
+    // The symmetric window of training, centered in the DFT points
+    std::vector<float> hann(params.fft, 0.F);
+    const int offset = (params.fft - params.window) / 2;
+    for (int n = 0; n < params.window; ++n)
+    {
+        hann[offset + n] = static_cast<float>(0.5 - 0.5 * std::cos(2 * pi * n / (params.window - 1)));
+    }
+    const std::vector<float> filterbank = slaneyFilterbank(params, mBins);
+
+    CHECK(cudaMemcpy(mTwiddles.data(), twiddles.data(), mTwiddles.nbBytes(), cudaMemcpyHostToDevice));
+    CHECK(cudaMemcpy(mHann.data(), hann.data(), mHann.nbBytes(), cudaMemcpyHostToDevice));
+    CHECK(cudaMemcpy(mFilterbank.data(), filterbank.data(), mFilterbank.nbBytes(), cudaMemcpyHostToDevice));
+}
+
+void FeatureExtractor::extract(const float* audio, int frames, float* features, cudaStream_t stream)
+{
+    frames = std::min(frames, mMaxFrames);
+    const int samples = frames * mParams.hop;
+    auto* preemphasized = static_cast<float*>(mPreemphasized.data());
+    auto* power = static_cast<float*>(mPower.data());
+
+    preemphasisKernel<<<gridSize(samples), kThreadsPerBlock, 0, stream>>>(
+        audio, samples, mParams.preemphasis, preemphasized);
+    powerSpectrumKernel<<<frames, kThreadsPerBlock, mParams.fft * sizeof(float), stream>>>(preemphasized, samples,
+        mParams.hop, static_cast<const float*>(mHann.data()), static_cast<const float2*>(mTwiddles.data()),
+        mParams.fft, mBins, power);
+    melKernel<<<gridSize(mParams.mels * frames), kThreadsPerBlock, 0, stream>>>(
+        power, frames, mBins, static_cast<const float*>(mFilterbank.data()), mParams.mels, features);
+    normalizeKernel<<<mParams.mels, kThreadsPerBlock, 0, stream>>>(features, frames);
+    CHECK(cudaGetLastError());
+}
+
+} // namespace jasperSample
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_JASPER_FEATURES_H
+#define SAMPLE_JASPER_FEATURES_H
+
+#include "buffers.h"
+
+#include <cuda_runtime_api.h>
+
+namespace jasperSample
+{
+
+//!
+//! \brief The audio features the Jasper models are trained on
+//!
+struct FeatureParams
+{
+    int sampleRate{16000};
+    int window{320}; //!< Samples of the Hann window of a frame, 20 ms
+    int hop{160};    //!< Samples between the centers of two frames, 10 ms
+    int fft{512};    //!< Points of the DFT, the windowed samples are zero-padded around their center
+    int mels{64};
+    float preemphasis{0.97F};
+};
+
+//!
+//! \class FeatureExtractor
+//! \brief Computes the normalized log mel spectrogram of windows of audio on the device
+//!
+//! The audio is pre-emphasized, then each frame, centered on a multiple of the hop and reflected at the edges of the
+//! window, goes through a Hann window, a DFT, a power spectrum and a Slaney mel filterbank. The log features are
+//! normalized per mel bin over the frames of the window. The DFT twiddles, the window and the filterbank are computed
+//! once on the host and kept on the device.
+//!
+class FeatureExtractor
+{
+public:
+    //!
+    //! \param maxFrames The most frames of a window, which sizes the power spectrum scratch
+    //!
+    FeatureExtractor(const FeatureParams& params, int maxFrames);
+
+    //!
+    //! \brief Write the features of frames frames of audio, frames * hop samples, into features as mels x frames
+    //!
+    //! \param audio Device samples in [-1, 1]
+    //! \param features Device floats, typically the input binding of the engine
+    //!
+    void extract(const float* audio, int frames, float* features, cudaStream_t stream);
+
+    const FeatureParams& getParams() const
+    {
+        return mParams;
+    }
+
+private:
+    FeatureParams mParams;
+    int mMaxFrames{0};
+    int mBins{0};                              //!< fft / 2 + 1
+    samplesCommon::DeviceBuffer mTwiddles;     //!< cos and sin of 2 pi k / fft, for k < fft
+    samplesCommon::DeviceBuffer mHann;         //!< The window, padded to fft points
+    samplesCommon::DeviceBuffer mFilterbank;   //!< mels x bins
+    samplesCommon::DeviceBuffer mPower;        //!< frames x bins scratch
+    samplesCommon::DeviceBuffer mPreemphasized;
+};
+
+} // namespace jasperSample
+
+#endif // SAMPLE_JASPER_FEATURES_H
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//!
+//! sampleJasper.cpp
+//! This file contains the implementation of the streaming Jasper speech recognition sample. It builds an engine from
+//! the ONNX Jasper model, reads a WAV file chunk by chunk, computes the audio features of each chunk with its left
+//! context on the device, straight into the input of the engine, and greedily decodes the characters of the chunk.
+//! It can be run with the following command:
+//! Command: ./sample_jasper [-h or --help] [-d=/path/to/data/dir or --datadir=/path/to/data/dir] [--fp16]
+//!
+
+#include "argsParser.h"
+#include "buffers.h"
+#include "common.h"
+#include "jasperFeatures.h"
+#include "logger.h"
+#include "parserOnnxConfig.h"
+
+#include "NvInfer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cuda_runtime_api.h>
+#include <fstream>
+#include <iomanip>
+
+const std::string gSampleName = "TensorRT.sample_jasper";
+
+//!
+//! \brief The parameters of the streaming Jasper sample
+//!
+struct JasperParams : public samplesCommon::OnnxSampleParams
+{
+    std::string audioFileName;
+    int chunkFrames{160};  //!< New frames of audio of each inference, 1.6 s
+    int contextFrames{96}; //!< Frames of the previous chunks fed again before the new ones, 0.96 s
+    jasperSample::FeatureParams features;
+};
+
+//!
+//! \class WavReader
+//! \brief Reads the samples of a 16-bit PCM mono WAV file a chunk at a time, as they would arrive from a stream
+//!
+class WavReader
+{
+public:
+    //!
+    //! \return False if the file cannot be read or is not 16-bit PCM mono at the sample rate
+    //!
+    bool open(const std::string& fileName, int sampleRate)
+    {
+        mFile.open(fileName, std::ios::binary);
+        char riff[12];
+        if (!mFile.read(riff, sizeof(riff)) || std::strncmp(riff, "RIFF", 4) || std::strncmp(riff + 8, "WAVE", 4))
+        {
+            return false;
+        }
+        bool format{false};
+        char id[4];
+        uint32_t size{0};
+        while (mFile.read(id, sizeof(id)) && mFile.read(reinterpret_cast<char*>(&size), sizeof(size)))
+        {
+            if (!std::strncmp(id, "fmt ", 4))
+            {
+                uint16_t audioFormat{0}, channels{0}, bits{0};
+                uint32_t rate{0};
+                std::vector<char> fmt(size);
+                mFile.read(fmt.data(), size);
+                std::memcpy(&audioFormat, fmt.data(), sizeof(audioFormat));
+                std::memcpy(&channels, fmt.data() + 2, sizeof(channels));
+                std::memcpy(&rate, fmt.data() + 4, sizeof(rate));
+                std::memcpy(&bits, fmt.data() + 14, sizeof(bits));
+                format = size >= 16 && audioFormat == 1 && channels == 1 && bits == 16
+                    && rate == static_cast<uint32_t>(sampleRate);
+            }
+            else if (!std::strncmp(id, "data", 4))
+            {
+                mRemaining = size / sizeof(int16_t);
+                return format;
+            }
+            else
+            {
+                mFile.seekg(size + (size & 1), std::ios::cur);
+            }
+        }
+        return false;
+    }
+
+    //!
+    //! \brief Read up to count samples, scaled to [-1, 1]
+    //!
+    //! \return The samples read, 0 at the end of the file
+    //!
+    int read(float* samples, int count)
+    {
+        mPcm.resize(count);
+        const int wanted = static_cast<int>(std::min<size_t>(count, mRemaining));
+        mFile.read(reinterpret_cast<char*>(mPcm.data()), wanted * sizeof(int16_t));
+        const int got = static_cast<int>(mFile.gcount() / sizeof(int16_t));
+        std::transform(mPcm.begin(), mPcm.begin() + got, samples, [](int16_t s) { return s / 32768.F; });
+        mRemaining -= got;
+        return got;
+    }
+
+private:
+    std::ifstream mFile;
+    size_t mRemaining{0};
+    std::vector<int16_t> mPcm;
+};
+
+//! \brief The SampleJasper class implements the streaming Jasper sample.
+//!
+//! \details Each chunk runs in one of kSLOTS slots, with its own stream, execution context, optimization profile and
+//! buffers, so that the features and the inference of a chunk overlap the inference of the previous one and the host
+//! decodes a chunk while the next ones run.
+//!
+class SampleJasper
+{
+    template <typename T>
+    using SampleUniquePtr = std::unique_ptr<T, samplesCommon::InferDeleter>;
+
+public:
+    SampleJasper(const JasperParams& params)
+        : mParams(params)
+    {
+    }
+
+    ~SampleJasper();
+
+    //!
+    //! \brief Builds the engine with one profile per slot, for the frames of a chunk and its context.
+    //!
+    void build();
+
+    //!
+    //! \brief Creates the execution contexts, streams, buffers and feature extractors of the slots.
+    //!
+    void prepare();
+
+    //!
+    //! \brief Transcribes the audio file chunk by chunk and reports the real-time factor.
+    //!
+    bool infer();
+
+private:
+    static constexpr int kSLOTS = 2;
+
+    //! The labels of the outputs, the blank of the CTC decoding is the last output
+    static const char* kLabels;
+
+    struct Slot
+    {
+        SampleUniquePtr<nvinfer1::IExecutionContext> context{nullptr};
+        std::vector<void*> bindings;
+        std::unique_ptr<jasperSample::FeatureExtractor> extractor;
+        samplesCommon::PinnedHostBuffer hostAudio;
+        samplesCommon::DeviceBuffer audio;
+        samplesCommon::DeviceBuffer input;
+        samplesCommon::DeviceBuffer output;
+        samplesCommon::PinnedHostBuffer logits;
+        cudaStream_t stream{nullptr};
+        cudaEvent_t start{nullptr};
+        cudaEvent_t end{nullptr};
+        int newSamples{0}; //!< Samples of the chunk in flight past the context, 0 if the slot is idle
+    };
+
+    void enqueue(Slot& slot);
+    void decode(Slot& slot, std::string& transcript);
+
+    JasperParams mParams;
+    SampleUniquePtr<nvinfer1::ICudaEngine> mEngine{nullptr};
+    Slot mSlots[kSLOTS];
+    int mFrames{0};         //!< Frames of a window, context and chunk
+    int mOutputFrames{0};   //!< Output frames of a window, the model downsamples the frames
+    int mClasses{0};
+    int mPrevious{-1};      //!< Last output of the previous chunk, CTC merges repeats across the chunks
+    float mGpuMs{0};
+    float mMaxGpuMs{0};
+    int mChunks{0};
+
+    template <typename T>
+    SampleUniquePtr<T> makeUnique(T* t)
+    {
+        if (!t)
+        {
+            throw std::runtime_error{"Failed to create TensorRT object"};
+        }
+        return SampleUniquePtr<T>{t};
+    }
+};
+
+const char* SampleJasper::kLabels = " abcdefghijklmnopqrstuvwxyz'";
+
+SampleJasper::~SampleJasper()
+{
+    for (auto& slot : mSlots)
+    {
+        if (slot.stream)
+        {
+            cudaStreamDestroy(slot.stream);
+            cudaEventDestroy(slot.start);
+            cudaEventDestroy(slot.end);
+        }
+    }
+}
+
+//!
+//! \brief Builds the Jasper engine.
+//!
+//! \details The input of the model is dynamic in time, each slot gets a profile fixed at the frames of a window, since
+//!          execution contexts cannot share a profile.
+//!
+void SampleJasper::build()
+{
+    auto builder = makeUnique(nvinfer1::createInferBuilder(gLogger.getTRTLogger()));
+    const auto explicitBatch = 1U << static_cast<uint32_t>(NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
+    auto network = makeUnique(builder->createNetworkV2(explicitBatch));
+    auto parser = makeUnique(nvonnxparser::createParser(*network, gLogger.getTRTLogger()));
+    if (!parser->parseFromFile(locateFile(mParams.onnxFileName, mParams.dataDirs).c_str(),
+            static_cast<int>(gLogger.getReportableSeverity())))
+    {
+        throw std::runtime_error{"Failed to parse model"};
+    }
+
+    mFrames = mParams.contextFrames + mParams.chunkFrames;
+    auto config = makeUnique(builder->createBuilderConfig());
+    config->setMaxWorkspaceSize(256_MiB);
+    if (mParams.fp16)
+    {
+        config->setFlag(BuilderFlag::kFP16);
+    }
+    const Dims3 window{1, mParams.features.mels, mFrames};
+    const char* input = network->getInput(0)->getName();
+    for (int s = 0; s < kSLOTS; ++s)
+    {
+        auto profile = builder->createOptimizationProfile();
+        profile->setDimensions(input, OptProfileSelector::kMIN, window);
+        profile->setDimensions(input, OptProfileSelector::kOPT, window);
+        profile->setDimensions(input, OptProfileSelector::kMAX, window);
+        config->addOptimizationProfile(profile);
+    }
+    mEngine = makeUnique(builder->buildEngineWithConfig(*network, *config));
+}
+
+//!
+//! \brief Prepares the slots for inference.
+//!
+//! \details The features are written into the input binding of the slot, so the audio is the only host to device
+//!          copy of a chunk.
+//!
+void SampleJasper::prepare()
+{
+    const int bindingsInProfile = mEngine->getNbBindings() / kSLOTS;
+    if (bindingsInProfile != 2 || mEngine->getBindingDataType(0) != DataType::kFLOAT
+        || mEngine->getBindingDataType(1) != DataType::kFLOAT || !mEngine->bindingIsInput(0))
+    {
+        throw std::runtime_error{"Expected one FP32 input of features and one FP32 output of character scores"};
+    }
+    const int samples = mFrames * mParams.features.hop;
+    for (int s = 0; s < kSLOTS; ++s)
+    {
+        auto& slot = mSlots[s];
+        slot.context = makeUnique(mEngine->createExecutionContext());
+        slot.context->setOptimizationProfile(s);
+        const int input = s * bindingsInProfile;
+        slot.context->setBindingDimensions(input, Dims3{1, mParams.features.mels, mFrames});
+        const auto outputDims = slot.context->getBindingDimensions(input + 1);
+        if (outputDims.nbDims != 3)
+        {
+            throw std::runtime_error{"Expected an output of batch x frames x characters"};
+        }
+        mOutputFrames = outputDims.d[1];
+        mClasses = outputDims.d[2];
+        if (mClasses != static_cast<int>(std::strlen(kLabels)) + 1)
+        {
+            throw std::runtime_error{"Expected an output score for each character and the blank"};
+        }
+        slot.extractor.reset(new jasperSample::FeatureExtractor(mParams.features, mFrames));
+        slot.hostAudio = samplesCommon::PinnedHostBuffer(samples, DataType::kFLOAT);
+        slot.audio = samplesCommon::DeviceBuffer(samples, DataType::kFLOAT);
+        slot.input = samplesCommon::DeviceBuffer(mParams.features.mels * mFrames, DataType::kFLOAT);
+        slot.output = samplesCommon::DeviceBuffer(mOutputFrames * mClasses, DataType::kFLOAT);
+        slot.logits = samplesCommon::PinnedHostBuffer(mOutputFrames * mClasses, DataType::kFLOAT);
+        // Bindings of the profiles of the other slots are not read
+        slot.bindings.assign(mEngine->getNbBindings(), nullptr);
+        slot.bindings[input] = slot.input.data();
+        slot.bindings[input + 1] = slot.output.data();
+        CHECK(cudaStreamCreateWithFlags(&slot.stream, cudaStreamNonBlocking));
+        CHECK(cudaEventCreate(&slot.start));
+        CHECK(cudaEventCreate(&slot.end));
+    }
+}
+
+//!
+//! \brief Copies the audio of the window of a slot to the device, computes its features, runs the model on them and
+//!        copies the scores back, all asynchronously on the stream of the slot.
+//!
+void SampleJasper::enqueue(Slot& slot)
+{
+    CHECK(cudaEventRecord(slot.start, slot.stream));
+    CHECK(cudaMemcpyAsync(
+        slot.audio.data(), slot.hostAudio.data(), slot.audio.nbBytes(), cudaMemcpyHostToDevice, slot.stream));
+    slot.extractor->extract(static_cast<const float*>(slot.audio.data()), mFrames,
+        static_cast<float*>(slot.input.data()), slot.stream);
+    if (!slot.context->enqueueV2(slot.bindings.data(), slot.stream, nullptr))
+    {
+        throw std::runtime_error{"Failed to enqueue the inference of a chunk"};
+    }
+    CHECK(cudaMemcpyAsync(
+        slot.logits.data(), slot.output.data(), slot.logits.nbBytes(), cudaMemcpyDeviceToHost, slot.stream));
+    CHECK(cudaEventRecord(slot.end, slot.stream));
+}
+
+//!
+//! \brief Waits for the chunk of a slot and appends the characters of its new frames to the transcript.
+//!
+//! \details The output frames of the context were decoded with the previous chunk, and the frames past the end of the
+//!          audio of the last chunk are skipped. Repeated outputs are merged and blanks are dropped, greedy CTC.
+//!
+void SampleJasper::decode(Slot& slot, std::string& transcript)
+{
+    CHECK(cudaEventSynchronize(slot.end));
+    float ms{0};
+    CHECK(cudaEventElapsedTime(&ms, slot.start, slot.end));
+    mGpuMs += ms;
+    mMaxGpuMs = std::max(mMaxGpuMs, ms);
+    ++mChunks;
+
+    const int first = mOutputFrames * mParams.contextFrames / mFrames;
+    const int newFrames = (slot.newSamples + mParams.features.hop - 1) / mParams.features.hop;
+    const int last = std::min(mOutputFrames, first + (newFrames * mOutputFrames + mFrames - 1) / mFrames);
+    const float* scores = static_cast<const float*>(slot.logits.data());
+    const int blank = mClasses - 1;
+    for (int t = first; t < last; ++t)
+    {
+        const float* frame = scores + t * mClasses;
+        const int best = static_cast<int>(std::max_element(frame, frame + mClasses) - frame);
+        if (best != blank && best != mPrevious)
+        {
+            transcript.push_back(kLabels[best]);
+        }
+        mPrevious = best;
+    }
+    slot.newSamples = 0;
+}
+
+//!
+//! \brief Runs the streaming transcription.
+//!
+//! \details The window of each chunk is the context, the last samples of the previous window, followed by the new
+//!          samples, zero-padded at the end of the file. The first chunk has a silent context.
+//!
+bool SampleJasper::infer()
+{
+    WavReader reader;
+    const auto& features = mParams.features;
+    if (!reader.open(locateFile(mParams.audioFileName, mParams.dataDirs), features.sampleRate))
+    {
+        gLogError << "Expected a 16-bit PCM mono WAV file at " << features.sampleRate << " Hz" << std::endl;
+        return false;
+    }
+    const int contextSamples = mParams.contextFrames * features.hop;
+    const int chunkSamples = mParams.chunkFrames * features.hop;
+    std::vector<float> context(contextSamples, 0.F);
+    std::string transcript;
+    size_t totalSamples{0};
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int chunk = 0;; ++chunk)
+    {
+        auto& slot = mSlots[chunk % kSLOTS];
+        if (slot.newSamples)
+        {
+            decode(slot, transcript);
+        }
+        auto* audio = static_cast<float*>(slot.hostAudio.data());
+        std::copy(context.begin(), context.end(), audio);
+        const int read = reader.read(audio + contextSamples, chunkSamples);
+        if (!read)
+        {
+            break;
+        }
+        std::fill(audio + contextSamples + read, audio + contextSamples + chunkSamples, 0.F);
+        std::copy(audio + chunkSamples, audio + chunkSamples + contextSamples, context.begin());
+        slot.newSamples = read;
+        totalSamples += read;
+        enqueue(slot);
+    }
+    for (int s = 0; s < kSLOTS; ++s)
+    {
+        // The chunks still in flight, oldest first
+        auto& slot = mSlots[(mChunks + s) % kSLOTS];
+        if (slot.newSamples)
+        {
+            decode(slot, transcript);
+        }
+    }
+    const std::chrono::duration<float> wall = std::chrono::high_resolution_clock::now() - start;
+
+    const float audioSeconds = static_cast<float>(totalSamples) / features.sampleRate;
+    gLogInfo << "Transcript: " << transcript << std::endl;
+    gLogInfo << std::fixed << std::setprecision(3) << "Processed " << audioSeconds << " s of audio in " << mChunks
+             << " chunks in " << wall.count() << " s, real-time factor " << std::setprecision(4)
+             << (audioSeconds > 0 ? wall.count() / audioSeconds : 0) << std::endl;
+    gLogInfo << std::setprecision(3) << "GPU time per chunk: mean " << (mChunks ? mGpuMs / mChunks : 0) << " ms, max "
+             << mMaxGpuMs << " ms, for " << mParams.chunkFrames * 1000.F * features.hop / features.sampleRate
+             << " ms of new audio" << std::endl;
+    return totalSamples > 0;
+}
+
+//!
+//! \brief Initializes members of the params struct using the command line args
+//!
+JasperParams initializeSampleParams(const samplesCommon::Args& args)
+{
+    JasperParams params;
+    if (args.dataDirs.empty()) //!< Use default directories if user hasn't provided directory paths
+    {
+        params.dataDirs.push_back("data/jasper/");
+        params.dataDirs.push_back("data/samples/jasper/");
+    }
+    else //!< Use the data directory provided by the user
+    {
+        params.dataDirs = args.dataDirs;
+    }
+    params.onnxFileName = "jasper.onnx";
+    params.audioFileName = "speech.wav";
+    params.batchSize = 1;
+    params.fp16 = args.runInFp16;
+    return params;
+}
+
+//!
+//! \brief Prints the help information for running this sample
+//!
+void printHelpInfo()
+{
+    std::cout << "Usage: ./sample_jasper [-h or --help] [-d or --datadir=<path to data directory>] [--fp16]"
+              << std::endl;
+    std::cout << "--help          Display help information" << std::endl;
+    std::cout << "--datadir       Specify path to a data directory, overriding the default. This option can be used "
+                 "multiple times to add multiple directories. The directories hold jasper.onnx and speech.wav. If no "
+                 "data directories are given, the default is to use (data/samples/jasper/, data/jasper/)"
+              << std::endl;
+    std::cout << "--fp16          Run in FP16 mode." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    samplesCommon::Args args;
+    bool argsOK = samplesCommon::parseArgs(args, argc, argv);
+    if (!argsOK)
+    {
+        gLogError << "Invalid arguments" << std::endl;
+        printHelpInfo();
+        return EXIT_FAILURE;
+    }
+    if (args.help)
+    {
+        printHelpInfo();
+        return EXIT_SUCCESS;
+    }
+
+    auto sampleTest = gLogger.defineTest(gSampleName, argc, argv);
+
+    gLogger.reportTestStart(sampleTest);
+
+    SampleJasper sample{initializeSampleParams(args)};
+
+    sample.build();
+    sample.prepare();
+
+    if (!sample.infer())
+    {
+        return gLogger.reportFail(sampleTest);
+    }
+
+    return gLogger.reportPass(sampleTest);
+}
@@ -27,6 +27,8 @@
 #include "common.h"
 #include "logger.h"
 
+#include "WeightsFile.h"
+
 #include "NvCaffeParser.h"
 #include "NvInfer.h"
 #include <cuda_runtime_api.h>
@@ -89,6 +91,8 @@ private:
     std::map<std::string, std::pair<nvinfer1::Dims, nvinfer1::Weights>>
         mWeightMap; //!< The weight name to weight value map
 
+    std::unique_ptr<samplesCommon::WeightsFile> mWeightsFile; //!< The binary weights file the weights point into
+
     std::shared_ptr<nvinfer1::ICudaEngine> mEngine; //!< The TensorRT engine used to run the network
 
     //!
@@ -350,6 +354,7 @@ bool SampleMLP::teardown()
     for (auto& mem : mWeightMap)
     {
         auto weight = mem.second.second;
+        if (!mWeightsFile || !mWeightsFile->contains(weight.values))
         {
             delete[] static_cast<const float*>(weight.values);
         }
@@ -365,9 +370,19 @@ bool SampleMLP::teardown()
 //!          type is the integer value of the DataType enum in NvInfer.h.
 //!          <number of buffers>
 //!          for each buffer: [name] [type] [size] <data x size in hex>
+//!          If the binary weights file converted from it by convertWts.py is next to it, the weights point into the
+//!          mapping of that file instead.
 //!
 std::map<std::string, std::pair<nvinfer1::Dims, nvinfer1::Weights>> SampleMLP::loadWeights(const std::string& file)
 {
+    const std::string binaryFile = samplesCommon::WeightsFile::binaryName(file);
+    if (samplesCommon::WeightsFile::isWeightsFile(binaryFile))
+    {
+        gLogInfo << "Mapping weights file: " << binaryFile << std::endl;
+        mWeightsFile.reset(new samplesCommon::WeightsFile(binaryFile));
+        return mWeightsFile->shapedWeights();
+    }
+
     std::map<std::string, std::pair<nvinfer1::Dims, nvinfer1::Weights>> weightMap;
     std::ifstream input(file, std::ios_base::binary);
     assert(input.is_open() && "Unable to load weight file.");
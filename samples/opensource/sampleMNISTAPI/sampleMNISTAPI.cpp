@@ -28,6 +28,8 @@
 #include "common.h"
 #include "logger.h"
 
+#include "WeightsFile.h"
+
 #include "NvCaffeParser.h"
 #include "NvInfer.h"
 #include <cuda_runtime_api.h>
@@ -90,6 +92,8 @@ private:
 
     std::map<std::string, nvinfer1::Weights> mWeightMap; //!< The weight name to weight value map
 
+    std::unique_ptr<samplesCommon::WeightsFile> mWeightsFile; //!< The binary weights file the weights point into
+
     std::shared_ptr<nvinfer1::ICudaEngine> mEngine; //!< The TensorRT engine used to run the network
 
     //!
@@ -379,6 +383,10 @@ bool SampleMNISTAPI::teardown()
     for (auto& mem : mWeightMap)
     {
         auto weight = mem.second;
+        if (mWeightsFile && mWeightsFile->contains(weight.values))
+        {
+            continue;
+        }
         if (weight.type == DataType::kFLOAT)
         {
             delete[] static_cast<const uint32_t*>(weight.values);
@@ -397,9 +405,19 @@ bool SampleMNISTAPI::teardown()
 //!
 //! \details TensorRT weight files have a simple space delimited format
 //!          [type] [size] <data x size in hex>
+//!          If the binary weights file converted from it by convertWts.py is next to it, the weights point into the
+//!          mapping of that file instead.
 //!
 std::map<std::string, nvinfer1::Weights> SampleMNISTAPI::loadWeights(const std::string& file)
 {
+    const std::string binaryFile = samplesCommon::WeightsFile::binaryName(file);
+    if (samplesCommon::WeightsFile::isWeightsFile(binaryFile))
+    {
+        gLogInfo << "Mapping weights: " << binaryFile << std::endl;
+        mWeightsFile.reset(new samplesCommon::WeightsFile(binaryFile));
+        return mWeightsFile->weights();
+    }
+
     gLogInfo << "Loading weights: " << file << std::endl;
 
     // Open weights file
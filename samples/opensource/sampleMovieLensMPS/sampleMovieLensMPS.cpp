@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <ctime>
@@ -25,6 +26,7 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <numeric>
 #include <sstream>
 #include <sys/stat.h>
 #include <vector>
@@ -36,6 +38,7 @@
 
 #ifndef _MSC_VER
 #include <sched.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <sys/ipc.h>
 #include <sys/mman.h>
@@ -47,6 +50,7 @@
 
 #include "NvInfer.h"
 #include "NvUffParser.h"
+#include "SharedPlanRegistry.h"
 #include "common.h"
 #include "logger.h"
 
@@ -61,6 +65,7 @@ static const int32_t TOPK_MOVIES{1};         // The output of the topK layer for
 static const int32_t NUM_INDICES{100};       // Total numbers of Movies to predict per user.
 static const int32_t EMBEDDING_VEC_SIZE{32}; // Embedding vector size of each user and item.
 static const int32_t THREADS{1};
+static const int32_t ITERATIONS{1};
 static const char* USER_BLOB_NAME{"user_input"};  // user input blob name.
 static const char* ITEM_BLOB_NAME{"item_input"};  // item input blob name.
 static const char* TOPK_ITEM_PROB{"topk_values"}; // predicted item probability blob name.
@@ -96,6 +101,21 @@ public:
         sem_wait(mSemEngine);
     }
 
+    //! \return False if the semaphore was not posted within ms milliseconds
+    bool waitFor(int ms)
+    {
+        timespec deadline{};
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ms / 1000;
+        deadline.tv_nsec += (ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        return sem_timedwait(mSemEngine, &deadline) == 0;
+    }
+
     void post()
     {
         sem_post(mSemEngine);
@@ -115,42 +135,6 @@ private:
     sem_t* mSemEngine;
 };
 
-class SharedMemory
-{
-public:
-    SharedMemory(const char* modelStreamFd)
-        : mModelStreamFd(modelStreamFd)
-    {
-    }
-
-    ~SharedMemory()
-    {
-        shm_unlink(mModelStreamFd);
-    }
-
-    int open_ro()
-    {
-        return open(O_RDONLY, 0666);
-    }
-
-    int open_rw()
-    {
-        return open(O_RDWR | O_CREAT, 0666);
-    }
-
-private:
-    int open(int flag, mode_t mode)
-    {
-        int fd = shm_open(mModelStreamFd, flag, mode);
-        if (fd <= 0)
-        {
-            throw std::runtime_error("Could not create file descriptor: /dev/shm" + std::string(mModelStreamFd));
-        }
-        return fd;
-    }
-    const char* mModelStreamFd;
-};
-
 // The OutptutArgs struct holds intermediate/final outputs generated by the MovieLens structure per user.
 struct OutputArgs
 {
@@ -168,6 +152,9 @@ struct Args
     int32_t topKMovies{TOPK_MOVIES};             // TopK movies per user.
     int32_t numMoviesPerUser{NUM_INDICES};       // The number of movies per user.
     int32_t nbProcesses{THREADS};                // Number of concurrent processes
+    std::vector<int32_t> sweepProcesses;         // Process counts of the sweep, empty runs nbProcesses alone
+    std::vector<int32_t> sweepSmPercents;        // CUDA_MPS_ACTIVE_THREAD_PERCENTAGE values, empty leaves it unset
+    int32_t iterations{ITERATIONS};              // Timed inferences of each process
     std::string weightFile{DEFAULT_WEIGHT_FILE}; // Weight file (.wts2) format Movielens sample.
     std::string ratingInputFile{RATING_INPUT_FILE}; // The input rating file.
     std::string uffFile{UFF_MODEL_FILE};
@@ -255,6 +242,7 @@ void printHelpInfo()
     std::cout
         << "Usage:\n"
         << " ./sample_movielens_mps [-h or --help] [-b NUM_USERS] [-p NUM_PROCESSES] [--useDLACore=<int>] [--verbose]\n"
+           "                        [--iterations=N] [--sweepProcesses=N[,N]*] [--sweepSm=P[,P]*]\n"
         << "-h             Display help information. All single dash options enable perf mode.\n"
         << "-b             Number of Users i.e. Batch Size (default numUsers=32).\n"
         << "-p             Number of child processes to launch (default nbProcesses=1. Using MPS with this option is "
@@ -264,9 +252,30 @@ void printHelpInfo()
         << "--verbose      Enable verbose prints.\n"
         << "--int8         Run in Int8 mode.\n"
         << "--fp16         Run in FP16 mode.\n"
+        << "--iterations=N Timed inferences of each process (default iterations=1).\n"
+        << "--sweepProcesses=N[,N]* Run the process counts in turn, instead of -p.\n"
+        << "--sweepSm=P[,P]*        Run each process count with each CUDA_MPS_ACTIVE_THREAD_PERCENTAGE in turn.\n"
         << std::endl;
 }
 
+// Parse a comma separated list of positive integers, empty if one is not
+std::vector<int32_t> parseList(const std::string& list)
+{
+    std::vector<int32_t> values;
+    std::istringstream ss(list);
+    std::string value;
+    while (std::getline(ss, value, ','))
+    {
+        const int32_t v = std::atoi(value.c_str());
+        if (v <= 0)
+        {
+            return {};
+        }
+        values.push_back(v);
+    }
+    return values;
+}
+
 // Parse the arguments and return failure if arguments are incorrect
 bool parseArgs(Args& args, int argc, char* argv[])
 {
@@ -306,6 +315,31 @@ bool parseArgs(Args& args, int argc, char* argv[])
         {
             args.enableFP16 = true;
         }
+        else if (argStr.compare(0, 13, "--iterations=") == 0 && argStr.size() > 13)
+        {
+            args.iterations = std::atoi(argv[i] + 13);
+            if (args.iterations <= 0)
+            {
+                return false;
+            }
+        }
+        else if (argStr.compare(0, 17, "--sweepProcesses=") == 0)
+        {
+            args.sweepProcesses = parseList(argStr.substr(17));
+            if (args.sweepProcesses.empty())
+            {
+                return false;
+            }
+        }
+        else if (argStr.compare(0, 10, "--sweepSm=") == 0)
+        {
+            args.sweepSmPercents = parseList(argStr.substr(10));
+            if (args.sweepSmPercents.empty()
+                || *std::max_element(args.sweepSmPercents.begin(), args.sweepSmPercents.end()) > 100)
+            {
+                return false;
+            }
+        }
         else
         {
             return false;
@@ -569,7 +603,78 @@ std::shared_ptr<ICudaEngine> loadModelAndCreateEngine(const char* uffFile, IUffP
     return engine;
 }
 
-bool doInference(void* modelStreamData, int modelStreamSize, void* userInputPtr, void* itemInputPtr, Args& args)
+//! Results of a child process in memory shared with the parent, followed by the latencies of its inferences
+struct ProcessResult
+{
+    double startMs; // Steady clock, which is CLOCK_MONOTONIC and comparable across processes
+    double endMs;
+    int32_t completed;
+};
+
+//!
+//! \class SharedResults
+//! \brief Anonymous shared memory mapped before the fork, each child process writes its own results
+//!
+class SharedResults
+{
+public:
+    SharedResults(int32_t processes, int32_t iterations)
+        : mStride(sizeof(ProcessResult) + iterations * sizeof(float))
+        , mSize(processes * mStride)
+    {
+        mBase = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (mBase == MAP_FAILED)
+        {
+            throw std::runtime_error("Could not map the shared memory of the results");
+        }
+        std::memset(mBase, 0, mSize);
+    }
+
+    ~SharedResults()
+    {
+        munmap(mBase, mSize);
+    }
+
+    ProcessResult& result(int32_t p)
+    {
+        return *reinterpret_cast<ProcessResult*>(static_cast<char*>(mBase) + p * mStride);
+    }
+
+    float* latencies(int32_t p)
+    {
+        return reinterpret_cast<float*>(&result(p) + 1);
+    }
+
+private:
+    size_t mStride;
+    size_t mSize;
+    void* mBase;
+};
+
+double steadyMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+float percentile(std::vector<float> values, float p)
+{
+    if (values.empty())
+    {
+        return 0.F;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t index = static_cast<size_t>(std::max(std::ceil(p / 100.F * values.size()) - 1.F, 0.F));
+    return values[std::min(index, values.size() - 1)];
+}
+
+//!
+//! \brief Run the inferences of child process p and write its results
+//!
+//! The process signals ready once its engine is deserialized and warmed up, and times its inferences only after the
+//! parent started all the processes of the configuration, so that they all compete for the GPU.
+//!
+bool doInference(const samplesCommon::SharedPlan& plan, void* userInputPtr, void* itemInputPtr, const Args& args,
+    SharedResults& results, int32_t p, Semaphore& ready, Semaphore& start)
 {
     auto runtime = SampleUniquePtr<nvinfer1::IRuntime>(nvinfer1::createInferRuntime(gLogger.getTRTLogger()));
     if (args.useDLACore >= 0)
@@ -577,21 +682,31 @@ bool doInference(void* modelStreamData, int modelStreamSize, void* userInputPtr,
         runtime->setDLACore(args.useDLACore);
     }
 
-    auto engine
-        = samplesCommon::infer_object(runtime->deserializeCudaEngine(modelStreamData, modelStreamSize, nullptr));
+    auto engine = samplesCommon::infer_object(plan.deserialize(*runtime));
 
     Batch b{engine.get(), userInputPtr, itemInputPtr, args};
 
+    // The first inference creates the lazy resources of the context, outside of the timed loop
+    submitWork(b, args);
+    CHECK(cudaStreamSynchronize(b.mStream));
+    ready.post();
+    start.wait();
+
+    ProcessResult& result = results.result(p);
+    float* latencies = results.latencies(p);
+    result.startMs = steadyMs();
+    for (int32_t i = 0; i < args.iterations; ++i)
     {
-        samplesCommon::GpuTimer timer{b.mStream};
-        timer.start();
-        // Run inference for all the nbProcesses
+        const double inferenceStart = steadyMs();
         submitWork(b, args);
-        cudaStreamSynchronize(b.mStream);
-        timer.stop();
-        gLogInfo << "Done execution in process: " << getpid() << " . Duration : " << timer.microseconds()
-                 << " microseconds." << std::endl;
+        CHECK(cudaStreamSynchronize(b.mStream));
+        latencies[i] = static_cast<float>(steadyMs() - inferenceStart);
+        ++result.completed;
     }
+    result.endMs = steadyMs();
+    gLogInfo << "Done execution in process: " << getpid() << " . Duration : "
+             << (result.endMs - result.startMs) * 1000 / args.iterations << " microseconds per inference."
+             << std::endl;
 
     int outputItemProbIndex = b.mEngine->getBindingIndex(TOPK_ITEM_PROB);
     int outputItemNameIndex = b.mEngine->getBindingIndex(TOPK_ITEM_NAME);
@@ -603,140 +718,294 @@ bool doInference(void* modelStreamData, int modelStreamSize, void* userInputPtr,
     return pass;
 }
 
-int mainMovieLensMPS(Args& args, OutputArgs& pargs)
+//! Aggregate results of one configuration of the sweep
+struct SweepResult
 {
-    // Parse the ratings file and populate ground truth data
-    args.ratingInputFile = locateFile(args.ratingInputFile, directories);
-    gLogInfo << args.ratingInputFile << std::endl;
-
-    // Parse ground truth data and inputs, common to all processes (if using MPS)
-    parseMovieLensData(args);
-
-    // Create uff parser
-    args.uffFile = locateFile(args.uffFile, directories);
-    auto parser = SampleUniquePtr<nvuffparser::IUffParser>(nvuffparser::createUffParser());
-
-    // All nbProcesses should wait until the parent is done building the engine.
-    Semaphore sem("/engine_built");
-    sem.open();
+    int32_t processes;
+    int32_t smPercent; // 0 leaves CUDA_MPS_ACTIVE_THREAD_PERCENTAGE unset
+    float usersPerSecond;
+    float meanMs;
+    float worstP99Ms; // The p99 latency of the slowest client
+};
 
-    pid_t pid{};
-    // Create child processes
-    for (int i = 0; i < args.nbProcesses; ++i)
+//!
+//! \brief Wait for count posts of the semaphore while the processes run
+//!
+//! None of the processes exits before its post is received in a successful run, so a process that exits first, such
+//! as one that aborted, fails the wait instead of blocking it forever.
+//!
+//! \return False with the process and its status in exited and status if one of the processes exited before
+//!
+bool waitWhileRunning(Semaphore& semaphore, int32_t count, const std::vector<pid_t>& processes, pid_t& exited,
+    int& status)
+{
+    constexpr int kPOLL_MS{100};
+    while (count)
     {
-        pid = fork();
-        // Children should not create additional processes.
-        if (pid == 0)
+        if (semaphore.waitFor(kPOLL_MS))
         {
-            break;
+            --count;
+            continue;
         }
-        else if (pid == -1)
+        for (const auto pid : processes)
         {
-            throw std::runtime_error("Could not create child process");
+            if (waitpid(pid, &status, WNOHANG) == pid)
+            {
+                exited = pid;
+                return false;
+            }
         }
     }
-    // Every process needs to know if it's a child or not.
-    bool isParentProcess = (pid != 0);
-
-    SharedMemory shm("/sampleMovieLens.modelStream");
+    return true;
+}
 
-    if (isParentProcess)
+//! Build the engine in a process of its own, so that the parent never initializes CUDA and can fork again
+std::unique_ptr<samplesCommon::SharedPlan> buildPlan(
+    Args& args, const samplesCommon::SharedPlanRegistry& registry, Semaphore& built, Semaphore& attached)
+{
+    const pid_t builder = fork();
+    if (builder == -1)
     {
-        // Parent process should build an engine and write it to the shared buffer.
-        Dims inputIndices;
-        inputIndices.nbDims = 3;
-        inputIndices.d[0] = args.numMoviesPerUser;
-        inputIndices.d[1] = 1;
-        inputIndices.d[2] = 1;
+        throw std::runtime_error("Could not create the builder process");
+    }
+    if (builder == 0)
+    {
+        bool pass{false};
+        try
+        {
+            auto parser = SampleUniquePtr<nvuffparser::IUffParser>(nvuffparser::createUffParser());
+            Dims inputIndices;
+            inputIndices.nbDims = 3;
+            inputIndices.d[0] = args.numMoviesPerUser;
+            inputIndices.d[1] = 1;
+            inputIndices.d[2] = 1;
+
+            parser->registerInput(USER_BLOB_NAME, inputIndices, UffInputOrder::kNCHW);
+            parser->registerInput(ITEM_BLOB_NAME, inputIndices, UffInputOrder::kNCHW);
+            parser->registerOutput(UFF_OUTPUT_NODE);
+
+            auto engine = loadModelAndCreateEngine(args.uffFile.c_str(), parser.get(), args);
+            if (engine)
+            {
+                auto modelStream = samplesCommon::infer_object(engine->serialize());
+                // The plan stays published until the parent holds its own reference
+                auto sharedPlan = registry.publish("modelStream", *modelStream);
+                built.post();
+                attached.wait();
+                pass = true;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            gLogError << e.what() << std::endl;
+        }
+        if (!pass)
+        {
+            built.post();
+        }
+        exit(pass ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
 
-        parser->registerInput(USER_BLOB_NAME, inputIndices, UffInputOrder::kNCHW);
-        parser->registerInput(ITEM_BLOB_NAME, inputIndices, UffInputOrder::kNCHW);
-        parser->registerOutput(UFF_OUTPUT_NODE);
+    pid_t exited{0};
+    int status{0};
+    if (!waitWhileRunning(built, 1, {builder}, exited, status))
+    {
+        throw std::runtime_error("The builder process exited before the engine was built.");
+    }
+    auto sharedPlan = registry.attach("modelStream", 0);
+    attached.post();
+    waitpid(builder, &status, 0);
+    if (!sharedPlan || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create engine.");
+    }
+    return sharedPlan;
+}
 
-        auto engine = loadModelAndCreateEngine(args.uffFile.c_str(), parser.get(), args);
-        if (engine.get() == nullptr)
+//! Run one configuration of the sweep, false if a process failed
+bool runConfiguration(Args& args, const samplesCommon::SharedPlanRegistry& registry, int32_t processes,
+    int32_t smPercent, SweepResult& sweepResult)
+{
+    SharedResults results(processes, args.iterations);
+    Semaphore ready("/movielens_ready");
+    Semaphore start("/movielens_start");
+    ready.open();
+    start.open();
+
+    std::vector<pid_t> children;
+    for (int32_t p = 0; p < processes; ++p)
+    {
+        const pid_t pid = fork();
+        if (pid == -1)
         {
-            throw std::runtime_error("Failed to create engine.");
+            throw std::runtime_error("Could not create child process");
         }
+        if (pid == 0)
+        {
+            // MPS reads the limit when the process creates its CUDA context
+            if (smPercent)
+            {
+                setenv("CUDA_MPS_ACTIVE_THREAD_PERCENTAGE", std::to_string(smPercent).c_str(), 1);
+            }
 
-        auto modelStream = samplesCommon::infer_object(engine->serialize());
+            // Allocate input and output buffers on host.
+            std::vector<uint32_t> userInput(args.numUsers * args.numMoviesPerUser * sizeof(float));
+            std::vector<uint32_t> itemInput(args.numUsers * args.numMoviesPerUser * sizeof(float));
 
-        size_t modelStreamSize = modelStream->size();
-        // Create a shared buffer for the modelStream.
-        int fd = shm.open_rw();
+            for (int i = 0; i < args.numUsers; ++i)
+            {
+                for (int k = 0; k < args.numMoviesPerUser; ++k)
+                {
+                    int idx = i * args.numMoviesPerUser + k;
+                    userInput[idx] = args.pargsVec[i].userId;
+                    itemInput[idx] = args.pargsVec[i].allItems.at(k);
+                }
+            }
 
-        fallocate(fd, 0, 0, modelStreamSize);
-        void* modelStreamData = mmap(NULL, modelStreamSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-        // Copy modelStream to the shared buffer.
-        std::memcpy(modelStreamData, modelStream->data(), modelStreamSize);
-        // Clean up.
-        close(fd);
+            bool pass{false};
+            try
+            {
+                auto sharedPlan = registry.attach("modelStream", 0);
+                if (!sharedPlan)
+                {
+                    throw std::runtime_error("Failed to fetch model stream from shared memory buffer.");
+                }
+                pass = doInference(*sharedPlan, userInput.data(), itemInput.data(), args, results, p, ready, start);
+            }
+            catch (const std::exception& e)
+            {
+                gLogError << e.what() << std::endl;
+                // The parent waits for every process to be ready
+                ready.post();
+            }
+            // The exit status carries the result, the address space of the parent is not shared
+            exit(pass ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        children.push_back(pid);
     }
-    else
-    {
-        // Allocate input and output buffers on host.
-        std::vector<uint32_t> userInput(args.numUsers * args.numMoviesPerUser * sizeof(float));
-        std::vector<uint32_t> itemInput(args.numUsers * args.numMoviesPerUser * sizeof(float));
 
-        for (int i = 0; i < args.numUsers; ++i)
+    // Start the timed inferences once all the processes are set up
+    pid_t exited{0};
+    int exitStatus{0};
+    if (!waitWhileRunning(ready, processes, children, exited, exitStatus))
+    {
+        gLogError << "Process " << exited << " exited before it was ready, "
+                  << (WIFSIGNALED(exitStatus) ? "signal " + std::to_string(WTERMSIG(exitStatus))
+                                              : "status " + std::to_string(WEXITSTATUS(exitStatus)))
+                  << ", stopping the configuration" << std::endl;
+        for (const auto pid : children)
         {
-            for (int k = 0; k < args.numMoviesPerUser; ++k)
+            if (pid != exited)
             {
-                int idx = i * args.numMoviesPerUser + k;
-                userInput[idx] = args.pargsVec[i].userId;
-                itemInput[idx] = args.pargsVec[i].allItems.at(k);
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
             }
         }
+        sweepResult.processes = processes;
+        sweepResult.smPercent = smPercent;
+        return false;
+    }
+    for (int32_t p = 0; p < processes; ++p)
+    {
+        start.post();
+    }
+    bool pass{true};
+    for (const auto pid : children)
+    {
+        int status{0};
+        waitpid(pid, &status, 0);
+        pass &= WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    }
 
-        // Now wait for parent to construct engine and write the modelstream to the shared buffer.
-        sem.wait();
-
-        // Open a file descriptor for the shared buffer.
-        int fd = shm.open_ro();
-
-        // Get size of shared memory buffer.
-        struct stat sb;
-        fstat(fd, &sb);
-        int modelStreamSize = sb.st_size;
-        if (modelStreamSize <= 0)
+    double first{0};
+    double last{0};
+    double totalMs{0};
+    int64_t inferences{0};
+    float worstP99{0};
+    for (int32_t p = 0; p < processes; ++p)
+    {
+        const ProcessResult& result = results.result(p);
+        if (!result.completed)
         {
-            throw std::runtime_error("Failed to fetch model stream from shared memory buffer.");
+            continue;
         }
+        const std::vector<float> latencies(results.latencies(p), results.latencies(p) + result.completed);
+        const float p99 = percentile(latencies, 99.F);
+        gLogVerbose << "Process " << p << ": " << result.completed << " inferences, p99 latency " << p99 << " ms"
+                    << std::endl;
+        first = inferences ? std::min(first, result.startMs) : result.startMs;
+        last = std::max(last, result.endMs);
+        totalMs = std::accumulate(latencies.begin(), latencies.end(), totalMs);
+        inferences += result.completed;
+        worstP99 = std::max(worstP99, p99);
+    }
 
-        // Retrieve the modelStream and close the file descriptor.
-        void* modelStreamData = mmap(NULL, modelStreamSize, PROT_READ, MAP_SHARED, fd, 0);
-        close(fd);
+    sweepResult.processes = processes;
+    sweepResult.smPercent = smPercent;
+    sweepResult.usersPerSecond
+        = last > first ? static_cast<float>(inferences * args.numUsers * 1000 / (last - first)) : 0.F;
+    sweepResult.meanMs = inferences ? static_cast<float>(totalMs / inferences) : 0.F;
+    sweepResult.worstP99Ms = worstP99;
+    gLogInfo << "Processes: " << processes << ", SM percentage: " << (smPercent ? std::to_string(smPercent) : "default")
+             << ", throughput: " << sweepResult.usersPerSecond << " users/s, mean latency: " << sweepResult.meanMs
+             << " ms, worst client p99: " << worstP99 << " ms" << std::endl;
+    return pass;
+}
 
-        // All child processes will do inference and then exit.
-        bool pass = doInference(modelStreamData, modelStreamSize, userInput.data(), itemInput.data(), args);
-        if (!pass)
-            args.failCount++;
+int mainMovieLensMPS(Args& args, OutputArgs& pargs)
+{
+    // Parse the ratings file and populate ground truth data
+    args.ratingInputFile = locateFile(args.ratingInputFile, directories);
+    gLogInfo << args.ratingInputFile << std::endl;
 
-        exit(0);
-    }
+    // Parse ground truth data and inputs, common to all processes (if using MPS)
+    parseMovieLensData(args);
+
+    args.uffFile = locateFile(args.uffFile, directories);
+
+    // The parent waits until the builder process is done building the engine.
+    samplesCommon::SharedPlanRegistry registry("sampleMovieLens");
+    Semaphore built("/engine_built");
+    Semaphore attached("/engine_attached");
+    built.open();
+    attached.open();
+    auto sharedPlan = buildPlan(args, registry, built, attached);
 
-    // Let children processes continue
-    for (int j = 0; j < args.nbProcesses; ++j)
+    const std::vector<int32_t> processCounts
+        = args.sweepProcesses.empty() ? std::vector<int32_t>{args.nbProcesses} : args.sweepProcesses;
+    const std::vector<int32_t> smPercents
+        = args.sweepSmPercents.empty() ? std::vector<int32_t>{0} : args.sweepSmPercents;
+
+    bool pass{true};
+    std::vector<SweepResult> sweep;
+    for (const auto processes : processCounts)
     {
-        sem.post();
+        for (const auto smPercent : smPercents)
+        {
+            samplesCommon::PreciseCpuTimer timer{};
+            timer.start();
+            sweep.emplace_back();
+            pass &= runConfiguration(args, registry, processes, smPercent, sweep.back());
+            timer.stop();
+            gLogInfo << "Number of processes executed : " << processes
+                     << ". Total MPS Run Duration : " << timer.milliseconds() << " milliseconds." << std::endl;
+        }
     }
 
-    // Then time them.
+    if (sweep.size() > 1)
     {
-        samplesCommon::PreciseCpuTimer timer{};
-        timer.start();
-        int status;
-        // Parent should wait for child processes.
-        for (int i = 0; i < args.nbProcesses; ++i)
+        gLogInfo << "|-----------|-------|-------------|-------------------|-----------------------|" << std::endl;
+        gLogInfo << "| Processes | SM %  |   Users/s   | Mean latency (ms) | Worst client p99 (ms) |" << std::endl;
+        gLogInfo << "|-----------|-------|-------------|-------------------|-----------------------|" << std::endl;
+        for (const auto& r : sweep)
         {
-            wait(&status);
+            gLogInfo << "|" << std::setw(10) << r.processes << " | " << std::setw(5)
+                     << (r.smPercent ? std::to_string(r.smPercent) : "-") << " | " << std::setw(11) << r.usersPerSecond
+                     << " | " << std::setw(17) << r.meanMs << " | " << std::setw(21) << r.worstP99Ms << " |"
+                     << std::endl;
         }
-        timer.stop();
-        gLogInfo << "Number of processes executed : " << args.nbProcesses
-                 << ". Total MPS Run Duration : " << timer.milliseconds() << " milliseconds." << std::endl;
     }
 
-    bool pass = !args.failCount;
     return pass;
 }
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "asyncDataWriter.h"
+
+#include <sstream>
+
+namespace nmtSample
+{
+AsyncDataWriter::AsyncDataWriter(DataWriter::ptr originalDataWriter)
+    : mOriginalDataWriter(originalDataWriter)
+    , mDone(false)
+{
+}
+
+void AsyncDataWriter::write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength)
+{
+    Sequence sequence{
+        std::vector<int>(hOutputData, hOutputData + actualOutputSequenceLength), actualInputSequenceLength};
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSequences.push_back(std::move(sequence));
+    }
+    mCondition.notify_one();
+}
+
+void AsyncDataWriter::initialize()
+{
+    mOriginalDataWriter->initialize();
+    mDone = false;
+    mWorker = std::thread(&AsyncDataWriter::run, this);
+}
+
+void AsyncDataWriter::finalize()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDone = true;
+    }
+    mCondition.notify_one();
+    mWorker.join();
+    mOriginalDataWriter->finalize();
+}
+
+void AsyncDataWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this]() { return mDone || !mSequences.empty(); });
+        if (mSequences.empty())
+            break;
+        Sequence sequence = std::move(mSequences.front());
+        mSequences.pop_front();
+
+        // The original writer runs without the lock, so the inference thread is never held up by it
+        lock.unlock();
+        mOriginalDataWriter->write(sequence.outputData.data(), static_cast<int>(sequence.outputData.size()),
+            sequence.actualInputSequenceLength);
+        lock.lock();
+    }
+}
+
+std::string AsyncDataWriter::getInfo()
+{
+    std::stringstream ss;
+    ss << "Async Data Writer, original data writer = " << mOriginalDataWriter->getInfo();
+    return ss.str();
+}
+
+AsyncDataWriter::~AsyncDataWriter()
+{
+    if (mWorker.joinable())
+        finalize();
+}
+} // namespace nmtSample
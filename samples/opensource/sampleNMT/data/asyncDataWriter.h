@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SAMPLE_NMT_ASYNC_DATA_WRITER_
+#define SAMPLE_NMT_ASYNC_DATA_WRITER_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dataWriter.h"
+
+namespace nmtSample
+{
+/** \class AsyncDataWriter
+ *
+ * \brief wraps another data writer and runs it on a worker thread
+ *
+ * write only queues a copy of the sequence, so detokenization and scoring of a batch overlap with inference of the
+ * next one. The sequences reach the wrapped writer in the order they are written.
+ *
+ */
+class AsyncDataWriter : public DataWriter
+{
+public:
+    AsyncDataWriter(DataWriter::ptr originalDataWriter);
+
+    void write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength) override;
+
+    void initialize() override;
+
+    void finalize() override;
+
+    std::string getInfo() override;
+
+    ~AsyncDataWriter() override;
+
+private:
+    struct Sequence
+    {
+        std::vector<int> outputData;
+        int actualInputSequenceLength;
+    };
+
+    void run();
+
+    DataWriter::ptr mOriginalDataWriter;
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Sequence> mSequences;
+    bool mDone;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_ASYNC_DATA_WRITER_
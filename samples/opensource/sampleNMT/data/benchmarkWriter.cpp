@@ -26,6 +26,8 @@ BenchmarkWriter::BenchmarkWriter()
     , mInputTokenCount(0)
     , mOutputTokenCount(0)
     , mStartTS(std::chrono::high_resolution_clock::now())
+    , mEncoderTime(0.0F)
+    , mOverlappedEncoderTime(0.0F)
 {
 }
 
@@ -49,6 +51,17 @@ void BenchmarkWriter::finalize()
              << (mSampleCount / sec.count()) << " samples/sec" << std::endl;
     gLogInfo << totalTokenCount << " tokens processed (source and destination), " << (totalTokenCount / sec.count())
              << " tokens/sec" << std::endl;
+    if (mEncoderTime > 0.0F)
+    {
+        gLogInfo << mOverlappedEncoderTime << " ms of " << mEncoderTime << " ms encoder time overlapped with decoding ("
+                 << (100.0F * mOverlappedEncoderTime / mEncoderTime) << "%)" << std::endl;
+    }
+}
+
+void BenchmarkWriter::setEncoderOverlap(float encoderTime, float overlappedEncoderTime)
+{
+    mEncoderTime = encoderTime;
+    mOverlappedEncoderTime = overlappedEncoderTime;
 }
 
 std::string BenchmarkWriter::getInfo()
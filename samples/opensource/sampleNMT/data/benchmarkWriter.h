@@ -41,6 +41,11 @@ public:
 
     std::string getInfo() override;
 
+    /**
+     * \brief sets the encoder time and the part of it spent while the previous batch was decoding
+     */
+    void setEncoderOverlap(float encoderTime, float overlappedEncoderTime);
+
     ~BenchmarkWriter() override = default;
 
 private:
@@ -48,6 +53,8 @@ private:
     int mInputTokenCount;
     int mOutputTokenCount;
     std::chrono::high_resolution_clock::time_point mStartTS;
+    float mEncoderTime;
+    float mOverlappedEncoderTime;
 };
 } // namespace nmtSample
 
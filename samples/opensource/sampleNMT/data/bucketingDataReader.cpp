@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "bucketingDataReader.h"
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+namespace nmtSample
+{
+BucketingDataReader::BucketingDataReader(int windowSize, DataReader::ptr originalDataReader)
+    : mWindowSize(windowSize)
+    , mOriginalDataReader(originalDataReader)
+    , mWindowPosition(0)
+    , mWindowStart(0)
+{
+}
+
+int BucketingDataReader::read(
+    int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths)
+{
+    if (mWindowPosition == static_cast<int>(mWindowOrder.size()))
+        readWindow(samplesToRead, maxInputSequenceLength);
+
+    const int samplesRead = std::min(samplesToRead, static_cast<int>(mWindowOrder.size()) - mWindowPosition);
+    std::lock_guard<std::mutex> lock(mOriginalPositionsMutex);
+    for (int i = 0; i < samplesRead; ++i)
+    {
+        const int sample = mWindowOrder[mWindowPosition++];
+        std::copy_n(&mWindowInputData[sample * maxInputSequenceLength], maxInputSequenceLength,
+            hInputData + i * maxInputSequenceLength);
+        hActualInputSequenceLengths[i] = mWindowSequenceLengths[sample];
+        mOriginalPositions.push_back(mWindowStart + sample);
+    }
+    return samplesRead;
+}
+
+void BucketingDataReader::readWindow(int samplesToRead, int maxInputSequenceLength)
+{
+    mWindowStart += static_cast<int>(mWindowOrder.size());
+    const int windowSize = std::max(mWindowSize, samplesToRead);
+    mWindowInputData.resize(static_cast<size_t>(windowSize) * maxInputSequenceLength);
+    mWindowSequenceLengths.resize(windowSize);
+
+    int windowSamples = 0;
+    while (windowSamples < windowSize)
+    {
+        const int samplesRead = mOriginalDataReader->read(std::min(samplesToRead, windowSize - windowSamples),
+            maxInputSequenceLength, &mWindowInputData[windowSamples * maxInputSequenceLength],
+            &mWindowSequenceLengths[windowSamples]);
+        if (samplesRead == 0)
+            break;
+        windowSamples += samplesRead;
+    }
+
+    // Stable, so sentences of the same length keep their order
+    mWindowOrder.resize(windowSamples);
+    std::iota(mWindowOrder.begin(), mWindowOrder.end(), 0);
+    std::stable_sort(mWindowOrder.begin(), mWindowOrder.end(),
+        [this](int a, int b) { return mWindowSequenceLengths[a] > mWindowSequenceLengths[b]; });
+    mWindowPosition = 0;
+}
+
+void BucketingDataReader::reset()
+{
+    mOriginalDataReader->reset();
+    mWindowOrder.clear();
+    mWindowPosition = 0;
+    mWindowStart = 0;
+    std::lock_guard<std::mutex> lock(mOriginalPositionsMutex);
+    mOriginalPositions.clear();
+}
+
+int BucketingDataReader::takeOriginalPosition()
+{
+    std::lock_guard<std::mutex> lock(mOriginalPositionsMutex);
+    if (mOriginalPositions.empty())
+        return -1;
+    const int position = mOriginalPositions.front();
+    mOriginalPositions.pop_front();
+    return position;
+}
+
+std::string BucketingDataReader::getInfo()
+{
+    std::stringstream ss;
+    ss << "Bucketing Data Reader, window size = " << mWindowSize
+       << ", original reader info: " << mOriginalDataReader->getInfo();
+    return ss.str();
+}
+} // namespace nmtSample
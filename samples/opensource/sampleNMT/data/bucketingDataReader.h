@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SAMPLE_NMT_BUCKETING_DATA_READER_
+#define SAMPLE_NMT_BUCKETING_DATA_READER_
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "dataReader.h"
+
+namespace nmtSample
+{
+/** \class BucketingDataReader
+ *
+ * \brief wraps another data reader and returns the sentences of each window of it sorted by length
+ *
+ * Batches read in file order run to their longest sentence, the encoder and the decoder loop pad all the others to
+ * it. The reader reads windowSize sentences at a time and returns them longest first, so the sentences of a batch
+ * have close lengths and the last partial batch of a window holds its shortest ones. The position of each sentence
+ * in the original order is kept for ReorderingDataWriter to write the outputs in that order again.
+ *
+ */
+class BucketingDataReader : public DataReader
+{
+public:
+    typedef std::shared_ptr<BucketingDataReader> ptr;
+
+    BucketingDataReader(int windowSize, DataReader::ptr originalDataReader);
+
+    int read(int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths) override;
+
+    void reset() override;
+
+    std::string getInfo() override;
+
+    /**
+     * \brief the position in the original order of the oldest sample read and not taken yet
+     *
+     * Safe to call while another thread reads.
+     *
+     * \return -1 if all the samples read were taken
+     */
+    int takeOriginalPosition();
+
+private:
+    void readWindow(int samplesToRead, int maxInputSequenceLength);
+
+    int mWindowSize;
+    DataReader::ptr mOriginalDataReader;
+    std::vector<int> mWindowInputData;
+    std::vector<int> mWindowSequenceLengths;
+    std::vector<int> mWindowOrder; //!< Samples of the window, longest first
+    int mWindowPosition;           //!< Next sample of mWindowOrder to return
+    int mWindowStart;              //!< Original position of the first sample of the window
+    std::mutex mOriginalPositionsMutex; //!< The next batch is read while the writer takes the positions of this one
+    std::deque<int> mOriginalPositions; //!< Of the samples returned, in the order they were returned
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_BUCKETING_DATA_READER_
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "reorderingDataWriter.h"
+
+#include <cassert>
+#include <sstream>
+
+namespace nmtSample
+{
+ReorderingDataWriter::ReorderingDataWriter(DataWriter::ptr originalDataWriter, BucketingDataReader::ptr dataReader)
+    : mOriginalDataWriter(originalDataWriter)
+    , mDataReader(dataReader)
+    , mNextPosition(0)
+{
+}
+
+void ReorderingDataWriter::write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength)
+{
+    const int position = mDataReader->takeOriginalPosition();
+    assert(position >= mNextPosition);
+    if (position != mNextPosition)
+    {
+        mPendingSequences[position] = Sequence{
+            std::vector<int>(hOutputData, hOutputData + actualOutputSequenceLength), actualInputSequenceLength};
+        return;
+    }
+
+    mOriginalDataWriter->write(hOutputData, actualOutputSequenceLength, actualInputSequenceLength);
+    ++mNextPosition;
+    for (auto it = mPendingSequences.begin(); it != mPendingSequences.end() && it->first == mNextPosition;
+         it = mPendingSequences.erase(it))
+    {
+        mOriginalDataWriter->write(it->second.outputData.data(), static_cast<int>(it->second.outputData.size()),
+            it->second.actualInputSequenceLength);
+        ++mNextPosition;
+    }
+}
+
+void ReorderingDataWriter::initialize()
+{
+    mOriginalDataWriter->initialize();
+    mPendingSequences.clear();
+    mNextPosition = 0;
+}
+
+void ReorderingDataWriter::finalize()
+{
+    // The sequences of all the samples read were written
+    assert(mPendingSequences.empty());
+    mOriginalDataWriter->finalize();
+}
+
+std::string ReorderingDataWriter::getInfo()
+{
+    std::stringstream ss;
+    ss << "Reordering Data Writer, original data writer = " << mOriginalDataWriter->getInfo();
+    return ss.str();
+}
+} // namespace nmtSample
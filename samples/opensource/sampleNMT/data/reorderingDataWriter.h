@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SAMPLE_NMT_REORDERING_DATA_WRITER_
+#define SAMPLE_NMT_REORDERING_DATA_WRITER_
+
+#include <map>
+#include <vector>
+
+#include "bucketingDataReader.h"
+#include "dataWriter.h"
+
+namespace nmtSample
+{
+/** \class ReorderingDataWriter
+ *
+ * \brief wraps another data writer and writes the sequences in the original order of the samples of a bucketing
+ * reader
+ *
+ * The sequences must be written in the order the reader returned their samples, while the reader may already read the
+ * next batch on another thread. Each one is held until the sequences of all the samples before it in the original
+ * order are written.
+ *
+ */
+class ReorderingDataWriter : public DataWriter
+{
+public:
+    ReorderingDataWriter(DataWriter::ptr originalDataWriter, BucketingDataReader::ptr dataReader);
+
+    void write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength) override;
+
+    void initialize() override;
+
+    void finalize() override;
+
+    std::string getInfo() override;
+
+    ~ReorderingDataWriter() override = default;
+
+private:
+    struct Sequence
+    {
+        std::vector<int> outputData;
+        int actualInputSequenceLength;
+    };
+
+    DataWriter::ptr mOriginalDataWriter;
+    BucketingDataReader::ptr mDataReader;
+    std::map<int, Sequence> mPendingSequences; //!< By original position
+    int mNextPosition;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_REORDERING_DATA_WRITER_
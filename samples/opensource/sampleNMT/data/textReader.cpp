@@ -37,14 +37,9 @@ int TextReader::read(int samplesToRead, int maxInputSequenceLength, int* hInputD
     int lineCounter = 0;
     while (lineCounter < samplesToRead && std::getline(*mInput, line))
     {
-        std::istringstream ss(line);
-        std::string token;
-        int tokenCounter = 0;
-        while ((ss >> token) && (tokenCounter < maxInputSequenceLength))
-        {
-            hInputData[maxInputSequenceLength * lineCounter + tokenCounter] = mVocabulary->getId(token);
-            tokenCounter++;
-        }
+        // The line buffer is reused and the tokens are looked up in place, nothing is allocated per token
+        const int tokenCounter = mVocabulary->tokenize(
+            line.data(), line.size(), hInputData + maxInputSequenceLength * lineCounter, maxInputSequenceLength);
 
         hActualInputSequenceLengths[lineCounter] = tokenCounter;
 
@@ -29,8 +29,11 @@ TextWriter::TextWriter(std::shared_ptr<std::ostream> textOnput, Vocabulary::ptr
 
 void TextWriter::write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength)
 {
-    // if clean and handle BPE outputs is required
-    *mOutput << DataWriter::generateText(actualOutputSequenceLength, hOutputData, mVocabulary) << "\n";
+    // The sentence buffer keeps its capacity from one write to the next
+    mSentence.clear();
+    mVocabulary->detokenize(hOutputData, actualOutputSequenceLength, mSentence);
+    mSentence.push_back('\n');
+    mOutput->write(mSentence.data(), mSentence.size());
 }
 
 void TextWriter::initialize() {}
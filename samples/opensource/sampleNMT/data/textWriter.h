@@ -48,6 +48,7 @@ public:
 private:
     std::shared_ptr<std::ostream> mOutput;
     Vocabulary::ptr mVocabulary;
+    std::string mSentence; // Reused by each write
 };
 } // namespace nmtSample
 
@@ -16,41 +16,169 @@
 
 #include "vocabulary.h"
 #include <assert.h>
+#include <cctype>
 #include <clocale>
+#include <cstring>
 #include <iostream>
 #include <istream>
 
 namespace nmtSample
 {
+namespace
+{
+// FNV-1a
+uint64_t hashToken(TokenRef token)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < token.size; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(token.data[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool isSpace(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+TokenRef toRef(const std::string& token)
+{
+    return TokenRef{token.data(), token.size()};
+}
+} // namespace
+
 const std::string Vocabulary::mSosStr = "<s>";
 const std::string Vocabulary::mEosStr = "</s>";
 const std::string Vocabulary::mUnkStr = "<unk>";
 
 Vocabulary::Vocabulary()
-    : mNumTokens(0)
+    : mOffsets(1, 0)
+    , mTable(16, -1)
+    , mNumTokens(0)
 {
 }
 
+size_t Vocabulary::findSlot(TokenRef token) const
+{
+    const size_t mask = mTable.size() - 1;
+    for (size_t slot = hashToken(token) & mask;; slot = (slot + 1) & mask)
+    {
+        const int id = mTable[slot];
+        if (id < 0)
+        {
+            return slot;
+        }
+        const TokenRef other = getTokenRef(id);
+        if (other.size == token.size && std::memcmp(other.data, token.data, token.size) == 0)
+        {
+            return slot;
+        }
+    }
+}
+
+void Vocabulary::growTable()
+{
+    mTable.assign(mTable.size() * 2, -1);
+    for (int id = 0; id < mNumTokens; ++id)
+    {
+        mTable[findSlot(getTokenRef(id))] = id;
+    }
+}
+
 void Vocabulary::add(const std::string& token)
 {
-    assert(mTokenToId.find(token) == mTokenToId.end());
-    mTokenToId[token] = mNumTokens;
-    mIdToToken.push_back(token);
+    // At most half of the slots are taken, which keeps the probe sequences short
+    if (2 * (mNumTokens + 1) > static_cast<int>(mTable.size()))
+    {
+        growTable();
+    }
+    const size_t slot = findSlot(toRef(token));
+    assert(mTable[slot] < 0);
+    mArena.insert(mArena.end(), token.begin(), token.end());
+    mOffsets.push_back(static_cast<uint32_t>(mArena.size()));
+    mTable[slot] = mNumTokens;
     mNumTokens++;
 }
 
 int Vocabulary::getId(const std::string& token) const
 {
-    auto it = mTokenToId.find(token);
-    if (it != mTokenToId.end())
-        return it->second;
-    return mUnkId;
+    return getId(toRef(token));
+}
+
+int Vocabulary::getId(TokenRef token) const
+{
+    const int id = mTable[findSlot(token)];
+    return id < 0 ? mUnkId : id;
 }
 
 std::string Vocabulary::getToken(int id) const
+{
+    const TokenRef token = getTokenRef(id);
+    return std::string(token.data, token.size);
+}
+
+TokenRef Vocabulary::getTokenRef(int id) const
 {
     assert(id < mNumTokens);
-    return mIdToToken[id];
+    return TokenRef{mArena.data() + mOffsets[id], mOffsets[id + 1] - mOffsets[id]};
+}
+
+int Vocabulary::tokenize(const char* text, size_t length, int* ids, int maxIds) const
+{
+    int count = 0;
+    size_t i = 0;
+    while (count < maxIds)
+    {
+        while (i < length && isSpace(text[i]))
+        {
+            ++i;
+        }
+        if (i == length)
+        {
+            break;
+        }
+        const size_t start = i;
+        while (i < length && !isSpace(text[i]))
+        {
+            ++i;
+        }
+        ids[count++] = getId(TokenRef{text + start, i - start});
+    }
+    return count;
+}
+
+void Vocabulary::detokenize(const int* ids, int count, std::string& text) const
+{
+    // if clean and handle BPE outputs is required
+    static const char delimiter[] = "@@";
+    const size_t delimiterSize = sizeof(delimiter) - 1;
+    const size_t sentenceStart = text.size();
+    size_t wordStart = text.size();
+    bool continued = false;
+    for (int i = 0; i < count; ++i)
+    {
+        if (ids[i] == mEosId)
+        {
+            continue;
+        }
+        TokenRef token = getTokenRef(ids[i]);
+        if (!continued)
+        {
+            wordStart = text.size();
+            if (wordStart != sentenceStart)
+            {
+                text.push_back(' ');
+            }
+        }
+        continued = token.size >= delimiterSize
+            && std::memcmp(token.data + token.size - delimiterSize, delimiter, delimiterSize) == 0;
+        text.append(token.data, continued ? token.size - delimiterSize : token.size);
+    }
+    if (continued)
+    {
+        text.resize(wordStart);
+    }
 }
 
 int Vocabulary::getSize() const
@@ -69,23 +197,12 @@ std::istream& operator>>(std::istream& input, Vocabulary& value)
         value.add(word);
     }
 
-    {
-        auto it = value.mTokenToId.find(Vocabulary::mSosStr);
-        assert(it != value.mTokenToId.end());
-        value.mSosId = it->second;
-    }
-
-    {
-        auto it = value.mTokenToId.find(Vocabulary::mEosStr);
-        assert(it != value.mTokenToId.end());
-        value.mEosId = it->second;
-    }
-
-    {
-        auto it = value.mTokenToId.find(Vocabulary::mUnkStr);
-        assert(it != value.mTokenToId.end());
-        value.mUnkId = it->second;
-    }
+    value.mSosId = value.mTable[value.findSlot(toRef(Vocabulary::mSosStr))];
+    assert(value.mSosId >= 0);
+    value.mEosId = value.mTable[value.findSlot(toRef(Vocabulary::mEosStr))];
+    assert(value.mEosId >= 0);
+    value.mUnkId = value.mTable[value.findSlot(toRef(Vocabulary::mUnkStr))];
+    assert(value.mUnkId >= 0);
 
     return input;
 }
@@ -99,4 +216,4 @@ int Vocabulary::getEndSequenceId()
 {
     return mEosId;
 }
-} // namespace nmtSample
\ No newline at end of file
+} // namespace nmtSample
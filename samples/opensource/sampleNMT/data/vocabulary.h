@@ -17,7 +17,8 @@
 #ifndef SAMPLE_NMT_VOCABULARY_
 #define SAMPLE_NMT_VOCABULARY_
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -26,10 +27,20 @@
 
 namespace nmtSample
 {
+//! A token in a buffer owned by someone else, such as the arena of the vocabulary or a line of input
+struct TokenRef
+{
+    const char* data;
+    size_t size;
+};
+
 /** \class Vocabulary
  *
  * \brief String<->Id bijection storage
  *
+ * The tokens are stored back to back in one arena and looked up through an open addressing table of IDs, so that
+ * neither direction allocates per token.
+ *
  */
 class Vocabulary : public SequenceProperties
 {
@@ -46,15 +57,35 @@ public:
     void add(const std::string& token);
 
     /**
-     * \brief get the ID of the token
+     * \brief get the ID of the token, the ID of "<unk>" if it is not in the vocabulary
      */
     int getId(const std::string& token) const;
 
+    int getId(TokenRef token) const;
+
     /**
      * \brief get token by ID
      */
     std::string getToken(int id) const;
 
+    //! The token in the arena of the vocabulary
+    TokenRef getTokenRef(int id) const;
+
+    /**
+     * \brief split the text on white space and write the IDs of its first maxIds tokens
+     *
+     * \return the number of IDs written
+     */
+    int tokenize(const char* text, size_t length, int* ids, int maxIds) const;
+
+    /**
+     * \brief append the words of a sequence of IDs to text, separated by spaces
+     *
+     * The end of sequence IDs are skipped. Tokens ending with the BPE delimiter "@@" are joined with the next one, a
+     * word left unfinished at the end of the sequence is dropped.
+     */
+    void detokenize(const int* ids, int count, std::string& text) const;
+
     /**
      * \brief get the number of elements in the vocabulary
      */
@@ -69,8 +100,14 @@ private:
     static const std::string mUnkStr;
     static const std::string mEosStr;
 
-    std::map<std::string, int> mTokenToId;
-    std::vector<std::string> mIdToToken;
+    //! Slot of the token in mTable, either holding its ID or empty
+    size_t findSlot(TokenRef token) const;
+
+    void growTable();
+
+    std::vector<char> mArena;
+    std::vector<uint32_t> mOffsets; // Start of each token in mArena, followed by the end of the last one
+    std::vector<int> mTable;        // Power of two number of slots, -1 for empty ones
     int mNumTokens;
 
     int mSosId;
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../cudaError.h"
+#include "beamSearchKernels.h"
+
+namespace nmtSample
+{
+namespace
+{
+const int kThreadsPerBlock = 128;
+
+__global__ void beamSearchInitializeKernel(BeamSearchDeviceState state)
+{
+    const int sampleId = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sampleId < state.sampleCount)
+    {
+        state.validSamples[sampleId] = 1;
+        state.candidateLikelihoods[sampleId] = state.smallerThanMinimalLikelihood;
+    }
+}
+
+// One thread per sample, the options of a sample come sorted by decreasing likelihood, same as on the host
+__global__ void beamSearchTimestepKernel(BeamSearchDeviceState state, int timestepId, int validSampleCount,
+    const float* combinedLikelihoods, const int* vocabularyIndices, const int* rayOptionIndices,
+    int* sourceRayIndices, float* sourceLikelihoods)
+{
+    const int sampleId = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sampleId >= validSampleCount)
+        return;
+
+    const int beamWidth = state.beamWidth;
+    const int base = sampleId * beamWidth;
+    int* table = state.beamSearchTable + ((timestepId - 1) * state.sampleCount + sampleId) * beamWidth * 2;
+
+    int rayId = 0;
+    if (state.validSamples[sampleId])
+    {
+        for (; rayId < beamWidth; ++rayId)
+        {
+            const float optionCombinedLikelihood = combinedLikelihoods[base + rayId];
+
+            // Check if the current candidate is already better than this option
+            if (optionCombinedLikelihood <= state.candidateLikelihoods[sampleId])
+                break; // The remaining options are even worse
+
+            const int optionOriginalRayId = rayOptionIndices[base + rayId] / beamWidth;
+            const int optionVocabularyId = vocabularyIndices[base + rayId];
+
+            if ((optionVocabularyId == state.endSequenceId)
+                || (timestepId >= state.maxOutputSequenceLengths[sampleId]))
+            {
+                // We have a new candidate output sequence for the sample, it is backtracked once decoding is done
+                state.candidateLikelihoods[sampleId] = optionCombinedLikelihood;
+                state.candidates[sampleId * 3] = timestepId;
+                state.candidates[sampleId * 3 + 1] = optionOriginalRayId;
+                state.candidates[sampleId * 3 + 2] = optionVocabularyId;
+                break;
+            }
+
+            sourceRayIndices[base + rayId] = optionOriginalRayId;
+            sourceLikelihoods[base + rayId] = optionCombinedLikelihood;
+            table[rayId * 2] = optionVocabularyId;
+            table[rayId * 2 + 1] = optionOriginalRayId;
+        }
+
+        // No valid rays left for the sample
+        if (rayId == 0)
+            state.validSamples[sampleId] = 0;
+        else
+            atomicMax(state.tail, sampleId + 1);
+    }
+
+    // Mark the remaining rays as invalid ones
+    for (; rayId < beamWidth; ++rayId)
+    {
+        sourceRayIndices[base + rayId] = 0;
+        sourceLikelihoods[base + rayId] = state.smallerThanMinimalLikelihood;
+        table[rayId * 2] = state.endSequenceId;
+        table[rayId * 2 + 1] = 0;
+    }
+}
+} // namespace
+
+void beamSearchInitialize(const BeamSearchDeviceState& state, cudaStream_t stream)
+{
+    const int blocks = (state.sampleCount + kThreadsPerBlock - 1) / kThreadsPerBlock;
+    beamSearchInitializeKernel<<<blocks, kThreadsPerBlock, 0, stream>>>(state);
+    CUDA_CHECK(cudaGetLastError());
+}
+
+void beamSearchTimestep(const BeamSearchDeviceState& state, int timestepId, int validSampleCount,
+    const float* dCombinedLikelihoods, const int* dVocabularyIndices, const int* dRayOptionIndices,
+    int* dSourceRayIndices, float* dSourceLikelihoods, cudaStream_t stream)
+{
+    CUDA_CHECK(cudaMemsetAsync(state.tail, 0, sizeof(int), stream));
+    const int blocks = (validSampleCount + kThreadsPerBlock - 1) / kThreadsPerBlock;
+    beamSearchTimestepKernel<<<blocks, kThreadsPerBlock, 0, stream>>>(state, timestepId, validSampleCount,
+        dCombinedLikelihoods, dVocabularyIndices, dRayOptionIndices, dSourceRayIndices, dSourceLikelihoods);
+    CUDA_CHECK(cudaGetLastError());
+}
+} // namespace nmtSample
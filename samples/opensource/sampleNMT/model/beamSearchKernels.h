@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_BEAM_SEARCH_KERNELS_
+#define SAMPLE_NMT_BEAM_SEARCH_KERNELS_
+
+#include <cuda_runtime_api.h>
+
+namespace nmtSample
+{
+/** \struct BeamSearchDeviceState
+ *
+ * \brief device buffers holding the beam search state of a batch
+ *
+ */
+struct BeamSearchDeviceState
+{
+    int sampleCount;
+    int beamWidth;
+    int endSequenceId;
+    float smallerThanMinimalLikelihood;
+    const int* maxOutputSequenceLengths; // [sampleCount]
+    int* validSamples;                   // [sampleCount]
+    float* candidateLikelihoods;         // [sampleCount]
+    int* candidates;      // [sampleCount][3]: last timestep, ray to backtrack from, last vocabulary id
+    int* beamSearchTable; // [timestep][sampleCount][beamWidth][2]: vocabulary id, backtrack id
+    int* tail;            // Number of samples up to the last one with rays left
+};
+
+void beamSearchInitialize(const BeamSearchDeviceState& state, cudaStream_t stream);
+
+void beamSearchTimestep(const BeamSearchDeviceState& state, int timestepId, int validSampleCount,
+    const float* dCombinedLikelihoods, const int* dVocabularyIndices, const int* dRayOptionIndices,
+    int* dSourceRayIndices, float* dSourceLikelihoods, cudaStream_t stream);
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_BEAM_SEARCH_KERNELS_
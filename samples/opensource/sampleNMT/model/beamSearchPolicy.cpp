@@ -49,6 +49,7 @@ void BeamSearchPolicy::initialize(int sampleCount, int* maxOutputSequenceLengths
     mBeamSearchTable.clear();
 
     mTimestepId = 0;
+    mSampleTimestepIds.assign(mSampleCount, 0);
 
     mCandidates.resize(mSampleCount);
     mCandidateLikelihoods.resize(mSampleCount);
@@ -60,18 +61,22 @@ void BeamSearchPolicy::processTimestep(int validSampleCount, const float* hCombi
     const int* hVocabularyIndices, const int* hRayOptionIndices, int* hSourceRayIndices, float* hSourceLikelihoods)
 {
     ++mTimestepId;
-    mBeamSearchTable.resize(mTimestepId * mSampleCount * mBeamWidth);
-    auto baseBeamSearchTable = mBeamSearchTable.begin() + (mTimestepId - 1) * mSampleCount * mBeamWidth;
 
     for (int sampleId = 0; sampleId < validSampleCount; ++sampleId)
     {
         auto currentSourceRayIndices = hSourceRayIndices + sampleId * mBeamWidth;
         auto currentLikelihoods = hSourceLikelihoods + sampleId * mBeamWidth;
-        auto currentBeamSearchTable = baseBeamSearchTable + sampleId * mBeamWidth;
 
         int rayId = 0;
+        Ray* currentBeamSearchTable = nullptr;
         if (mValidSamples[sampleId])
         {
+            // Samples started by startSample are behind the batch, each one has its own timestep
+            const int timestepId = ++mSampleTimestepIds[sampleId];
+            if (static_cast<int>(mBeamSearchTable.size()) < timestepId * mSampleCount * mBeamWidth)
+                mBeamSearchTable.resize(timestepId * mSampleCount * mBeamWidth);
+            currentBeamSearchTable = &mBeamSearchTable[((timestepId - 1) * mSampleCount + sampleId) * mBeamWidth];
+
             for (; rayId < mBeamWidth; ++rayId)
             {
                 float optionCombinedLikelihood = hCombinedLikelihoods[sampleId * mBeamWidth + rayId];
@@ -83,14 +88,14 @@ void BeamSearchPolicy::processTimestep(int validSampleCount, const float* hCombi
                 int optionOriginalRayId = hRayOptionIndices[sampleId * mBeamWidth + rayId] / mBeamWidth;
                 int optionVocabularyId = hVocabularyIndices[sampleId * mBeamWidth + rayId];
 
-                if ((optionVocabularyId == mEndSequenceId) || (mTimestepId >= mMaxOutputSequenceLengths[sampleId]))
+                if ((optionVocabularyId == mEndSequenceId) || (timestepId >= mMaxOutputSequenceLengths[sampleId]))
                 {
                     // We have a new candidate output sequence for the sample
                     mCandidateLikelihoods[sampleId] = optionCombinedLikelihood;
                     auto& candidate = mCandidates[sampleId];
-                    candidate.resize(mTimestepId);
-                    backtrack(mTimestepId - 2, sampleId, optionOriginalRayId, &candidate[0], mTimestepId - 2);
-                    candidate[mTimestepId - 1] = optionVocabularyId;
+                    candidate.resize(timestepId);
+                    backtrack(timestepId - 2, sampleId, optionOriginalRayId, &candidate[0], timestepId - 2);
+                    candidate[timestepId - 1] = optionVocabularyId;
                     break;
                 }
 
@@ -105,13 +110,16 @@ void BeamSearchPolicy::processTimestep(int validSampleCount, const float* hCombi
                 mValidSamples[sampleId] = false;
         }
 
-        // Mark the remaining rays as invalid ones
+        // Mark the remaining rays as invalid ones, finished samples are never backtracked through this timestep
         for (; rayId < mBeamWidth; ++rayId)
         {
             *(currentSourceRayIndices + rayId) = 0;
             *(currentLikelihoods + rayId) = mLikelihoodCombinationOperator->smallerThanMinimalLikelihood();
-            (currentBeamSearchTable + rayId)->vocabularyId = mEndSequenceId;
-            (currentBeamSearchTable + rayId)->backtrackId = 0;
+            if (currentBeamSearchTable)
+            {
+                (currentBeamSearchTable + rayId)->vocabularyId = mEndSequenceId;
+                (currentBeamSearchTable + rayId)->backtrackId = 0;
+            }
         }
     }
 }
@@ -131,22 +139,49 @@ void BeamSearchPolicy::readGeneratedResult(
 {
     for (int sampleId = 0; sampleId < sampleCount; ++sampleId)
     {
-        if (mCandidateLikelihoods[sampleId] > mLikelihoodCombinationOperator->smallerThanMinimalLikelihood())
-        {
-            // We have a candidate (finished sequence)
-            std::copy_n(mCandidates[sampleId].begin(),
-                std::min(static_cast<int>(mCandidates[sampleId].size()), maxOutputSequenceLength),
-                hOutputData + sampleId * maxOutputSequenceLength);
-            hActualOutputSequenceLengths[sampleId] = mCandidates[sampleId].size();
-        }
-        else
-        {
-            // We don't have a finished sequence generated, will output the unfinished one with the highest likelihood
-            assert(mValidSamples[sampleId]);
-            backtrack(mTimestepId - 1, sampleId, 0, hOutputData + sampleId * maxOutputSequenceLength,
-                maxOutputSequenceLength - 1);
-            hActualOutputSequenceLengths[sampleId] = mTimestepId;
-        }
+        readSampleResult(sampleId, maxOutputSequenceLength, hOutputData + sampleId * maxOutputSequenceLength,
+            hActualOutputSequenceLengths + sampleId);
+    }
+}
+
+void BeamSearchPolicy::initializeSlots(int slotCount)
+{
+    std::vector<int> maxOutputSequenceLengths(slotCount, 0);
+    initialize(slotCount, &maxOutputSequenceLengths[0]);
+    std::fill(mValidSamples.begin(), mValidSamples.end(), false);
+}
+
+void BeamSearchPolicy::startSample(int sampleId, int maxOutputSequenceLength)
+{
+    mMaxOutputSequenceLengths[sampleId] = maxOutputSequenceLength;
+    mValidSamples[sampleId] = true;
+    mSampleTimestepIds[sampleId] = 0;
+    mCandidates[sampleId].clear();
+    mCandidateLikelihoods[sampleId] = mLikelihoodCombinationOperator->smallerThanMinimalLikelihood();
+}
+
+bool BeamSearchPolicy::isSampleFinished(int sampleId) const
+{
+    return !mValidSamples[sampleId];
+}
+
+void BeamSearchPolicy::readSampleResult(
+    int sampleId, int maxOutputSequenceLength, int* hOutputData, int* hActualOutputSequenceLength)
+{
+    if (mCandidateLikelihoods[sampleId] > mLikelihoodCombinationOperator->smallerThanMinimalLikelihood())
+    {
+        // We have a candidate (finished sequence)
+        std::copy_n(mCandidates[sampleId].begin(),
+            std::min(static_cast<int>(mCandidates[sampleId].size()), maxOutputSequenceLength), hOutputData);
+        *hActualOutputSequenceLength = mCandidates[sampleId].size();
+    }
+    else
+    {
+        // We don't have a finished sequence generated, will output the unfinished one with the highest likelihood
+        assert(mValidSamples[sampleId]);
+        const int timestepId = mSampleTimestepIds[sampleId];
+        backtrack(timestepId - 1, sampleId, 0, hOutputData, maxOutputSequenceLength - 1);
+        *hActualOutputSequenceLength = timestepId;
     }
 }
 
@@ -38,16 +38,34 @@ public:
     BeamSearchPolicy(
         int endSequenceId, LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, int beamWidth);
 
-    void initialize(int sampleCount, int* maxOutputSequenceLengths);
+    virtual void initialize(int sampleCount, int* maxOutputSequenceLengths);
 
-    void processTimestep(int validSampleCount, const float* hCombinedLikelihoods, const int* hVocabularyIndices,
-        const int* hRayOptionIndices, int* hSourceRayIndices, float* hSourceLikelihoods);
+    virtual void processTimestep(int validSampleCount, const float* hCombinedLikelihoods,
+        const int* hVocabularyIndices, const int* hRayOptionIndices, int* hSourceRayIndices,
+        float* hSourceLikelihoods);
 
-    int getTailWithNoWorkRemaining();
+    virtual int getTailWithNoWorkRemaining();
 
-    void readGeneratedResult(
+    virtual void readGeneratedResult(
         int sampleCount, int maxOutputSequenceLength, int* hOutputData, int* hActualOutputSequenceLengths);
 
+    /**
+     * \brief sets up slotCount empty slots for continuous batching, instead of initialize
+     */
+    void initializeSlots(int slotCount);
+
+    /**
+     * \brief starts generating a new sample in an empty slot or in the slot of a finished sample
+     *
+     * The sample is generated from the next timestep on, independently of the timesteps of the other samples.
+     */
+    void startSample(int sampleId, int maxOutputSequenceLength);
+
+    bool isSampleFinished(int sampleId) const;
+
+    void readSampleResult(
+        int sampleId, int maxOutputSequenceLength, int* hOutputData, int* hActualOutputSequenceLength);
+
     std::string getInfo() override;
 
     ~BeamSearchPolicy() override = default;
@@ -72,6 +90,7 @@ protected:
     int mSampleCount;
     std::vector<int> mMaxOutputSequenceLengths;
     int mTimestepId;
+    std::vector<int> mSampleTimestepIds; // Timesteps generated for each sample since it was started
 
     std::vector<std::vector<int>> mCandidates;
     std::vector<float> mCandidateLikelihoods;
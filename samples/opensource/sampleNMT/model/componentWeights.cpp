@@ -14,14 +14,138 @@
  * limitations under the License.
  */
 #include "componentWeights.h"
+#include "NvInfer.h"
+#include "half.h"
 #include <cassert>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace nmtSample
 {
+namespace
+{
+const std::string kFooterString("trtsamplenmt");
+} // namespace
+
+ComponentWeights::~ComponentWeights()
+{
+#ifndef _MSC_VER
+    if (mMapping)
+    {
+        munmap(mMapping, mMappingSize);
+    }
+#endif
+}
+
+size_t ComponentWeights::parseFooter(const char* file, size_t fileSize)
+{
+    const size_t footerSize = sizeof(int32_t) + kFooterString.size();
+    if (fileSize < footerSize
+        || kFooterString.compare(0, kFooterString.size(), file + fileSize - kFooterString.size(), kFooterString.size()))
+    {
+        throw std::runtime_error("Invalid NMT weights file");
+    }
+    int32_t metaDataCount{0};
+    std::memcpy(&metaDataCount, file + fileSize - footerSize, sizeof(metaDataCount));
+    const size_t metaSize = metaDataCount * sizeof(int32_t);
+    if (metaDataCount < 0 || footerSize + metaSize > fileSize)
+    {
+        throw std::runtime_error("Invalid NMT weights file");
+    }
+    mMetaData.resize(metaDataCount);
+    std::memcpy(mMetaData.data(), file + fileSize - footerSize - metaSize, metaSize);
+    return fileSize - footerSize - metaSize;
+}
+
+ComponentWeights::ptr ComponentWeights::map(const std::string& fileName)
+{
+    // Components of the same file share its mapping for as long as one of them holds it
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<ComponentWeights>> mapped;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto weights = mapped[fileName].lock())
+    {
+        return weights;
+    }
+
+    ptr weights(new ComponentWeights);
+#ifndef _MSC_VER
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open NMT weights file " + fileName);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            weights->mMapping = mapping;
+            weights->mMappingSize = st.st_size;
+        }
+    }
+    close(fd);
+    if (weights->mMapping)
+    {
+        weights->mData = static_cast<const char*>(weights->mMapping);
+        weights->mDataSize = weights->parseFooter(weights->mData, weights->mMappingSize);
+        mapped[fileName] = weights;
+        return weights;
+    }
+#endif
+    std::ifstream input(fileName, std::ios::binary);
+    if (!input)
+    {
+        throw std::runtime_error("Cannot open NMT weights file " + fileName);
+    }
+    input >> *weights;
+    mapped[fileName] = weights;
+    return weights;
+}
+
+void ComponentWeights::convertToHalf()
+{
+    assert(!mMetaData.empty());
+    if (mMetaData[0] != static_cast<int>(nvinfer1::DataType::kFLOAT))
+    {
+        return;
+    }
+    const auto* src = reinterpret_cast<const float*>(data());
+    const size_t count = size() / sizeof(float);
+    std::vector<char> converted(count * sizeof(half_float::half));
+    auto* dst = reinterpret_cast<half_float::half*>(converted.data());
+    for (size_t i = 0; i < count; ++i)
+    {
+        dst[i] = half_float::half(src[i]);
+    }
+    mWeights.swap(converted);
+#ifndef _MSC_VER
+    if (mMapping)
+    {
+        munmap(mMapping, mMappingSize);
+    }
+#endif
+    mMapping = nullptr;
+    mMappingSize = 0;
+    mData = nullptr;
+    mDataSize = 0;
+    mMetaData[0] = static_cast<int>(nvinfer1::DataType::kHALF);
+}
+
 std::istream& operator>>(std::istream& input, ComponentWeights& value)
 {
-    std::string footerString("trtsamplenmt");
+    const std::string& footerString = kFooterString;
     size_t footerSize = sizeof(int32_t) + footerString.size();
     char* footer = (char*) malloc(footerSize);
 
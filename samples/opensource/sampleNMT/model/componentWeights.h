@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace nmtSample
@@ -26,6 +27,9 @@ namespace nmtSample
  *
  * \brief weights storage
  *
+ * The weights are either read into memory from a stream, or mapped from their file with map(), in which case the
+ * nvinfer1::Weights built by the components point into the mapping and the file is never copied into host memory.
+ *
  */
 class ComponentWeights
 {
@@ -34,11 +38,50 @@ public:
 
     ComponentWeights() = default;
 
+    ~ComponentWeights();
+
+    ComponentWeights(const ComponentWeights&) = delete;
+    ComponentWeights& operator=(const ComponentWeights&) = delete;
+
+    /**
+     * \brief Map a weights file, the components built from the same file share one mapping
+     *
+     * Without mmap the file is read into memory.
+     */
+    static ptr map(const std::string& fileName);
+
+    //! The weights, without the metadata and the footer of the file
+    const char* data() const
+    {
+        return mData ? mData : mWeights.data();
+    }
+
+    size_t size() const
+    {
+        return mData ? mDataSize : mWeights.size();
+    }
+
+    /**
+     * \brief Convert FP32 weights to FP16 in memory, once for all the components sharing them
+     *
+     * The mapping of the file, if any, is released. Weights already in FP16 are left alone.
+     */
+    void convertToHalf();
+
     friend std::istream& operator>>(std::istream& input, ComponentWeights& value);
 
 public:
     std::vector<int> mMetaData;
     std::vector<char> mWeights;
+
+private:
+    //! Read the metadata from the end of the file contents, \return the size of the weights in front of it
+    size_t parseFooter(const char* file, size_t fileSize);
+
+    void* mMapping{nullptr};
+    size_t mMappingSize{0};
+    const char* mData{nullptr};
+    size_t mDataSize{0};
 };
 } // namespace nmtSample
 
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "deviceBeamSearchPolicy.h"
+#ifdef _MSC_VER
+// Macro definition needed to avoid name collision with std::min/max and Windows.h min/max
+#define NOMINMAX
+#endif
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <vector>
+
+namespace nmtSample
+{
+DeviceBeamSearchPolicy::DeviceBeamSearchPolicy(int endSequenceId,
+    LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, int beamWidth, int maxSampleCount,
+    int maxOutputSequenceLength, cudaStream_t stream)
+    : BeamSearchPolicy(endSequenceId, likelihoodCombinationOperator, beamWidth)
+    , mMaxSampleCount(maxSampleCount)
+    , mMaxOutputSequenceLength(maxOutputSequenceLength)
+    , mStream(stream)
+    , mMaxOutputSequenceLengthsDevice(maxSampleCount)
+    , mValidSamplesDevice(maxSampleCount)
+    , mCandidateLikelihoodsDevice(maxSampleCount)
+    , mCandidatesDevice(maxSampleCount * 3)
+    , mBeamSearchTableDevice(static_cast<size_t>(maxOutputSequenceLength) * maxSampleCount * beamWidth * 2)
+    , mTailDevice(1)
+    , mTailHost(kTimestepsInFlight)
+{
+    static_assert(sizeof(Ray) == 2 * sizeof(int), "The device table is copied into mBeamSearchTable as is");
+    for (auto& event : mTailEvents)
+        CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+
+    mState.beamWidth = mBeamWidth;
+    mState.endSequenceId = mEndSequenceId;
+    mState.smallerThanMinimalLikelihood = mLikelihoodCombinationOperator->smallerThanMinimalLikelihood();
+    mState.maxOutputSequenceLengths = mMaxOutputSequenceLengthsDevice;
+    mState.validSamples = mValidSamplesDevice;
+    mState.candidateLikelihoods = mCandidateLikelihoodsDevice;
+    mState.candidates = mCandidatesDevice;
+    mState.beamSearchTable = mBeamSearchTableDevice;
+    mState.tail = mTailDevice;
+}
+
+DeviceBeamSearchPolicy::~DeviceBeamSearchPolicy()
+{
+    for (auto& event : mTailEvents)
+        cudaEventDestroy(event);
+}
+
+void DeviceBeamSearchPolicy::initialize(int sampleCount, int* maxOutputSequenceLengths)
+{
+    assert(sampleCount <= mMaxSampleCount);
+    assert(*std::max_element(maxOutputSequenceLengths, maxOutputSequenceLengths + sampleCount)
+        <= mMaxOutputSequenceLength);
+    BeamSearchPolicy::initialize(sampleCount, maxOutputSequenceLengths);
+
+    mState.sampleCount = sampleCount;
+    CUDA_CHECK(cudaMemcpyAsync(mMaxOutputSequenceLengthsDevice, maxOutputSequenceLengths, sampleCount * sizeof(int),
+        cudaMemcpyHostToDevice, mStream));
+    beamSearchInitialize(mState, mStream);
+}
+
+void DeviceBeamSearchPolicy::processTimestep(int validSampleCount, const float* dCombinedLikelihoods,
+    const int* dVocabularyIndices, const int* dRayOptionIndices, int* dSourceRayIndices, float* dSourceLikelihoods)
+{
+    ++mTimestepId;
+    beamSearchTimestep(mState, mTimestepId, validSampleCount, dCombinedLikelihoods, dVocabularyIndices,
+        dRayOptionIndices, dSourceRayIndices, dSourceLikelihoods, mStream);
+
+    const int slot = mTimestepId % kTimestepsInFlight;
+    CUDA_CHECK(cudaMemcpyAsync(
+        static_cast<int*>(mTailHost) + slot, mTailDevice, sizeof(int), cudaMemcpyDeviceToHost, mStream));
+    CUDA_CHECK(cudaEventRecord(mTailEvents[slot], mStream));
+}
+
+int DeviceBeamSearchPolicy::getTailWithNoWorkRemaining()
+{
+    if (mTimestepId == 0)
+        return mSampleCount;
+
+    // Wait for the oldest timestep in flight only, the latest one keeps the device busy while the host goes on
+    const int timestepId = std::max(1, mTimestepId - kTimestepsInFlight + 1);
+    const int slot = timestepId % kTimestepsInFlight;
+    CUDA_CHECK(cudaEventSynchronize(mTailEvents[slot]));
+    return static_cast<const int*>(mTailHost)[slot];
+}
+
+void DeviceBeamSearchPolicy::readGeneratedResult(
+    int sampleCount, int maxOutputSequenceLength, int* hOutputData, int* hActualOutputSequenceLengths)
+{
+    CUDA_CHECK(cudaStreamSynchronize(mStream));
+
+    // Bring the search state back into the host policy, which backtracks the same way as for a host search
+    mBeamSearchTable.resize(mTimestepId * mSampleCount * mBeamWidth);
+    if (!mBeamSearchTable.empty())
+    {
+        CUDA_CHECK(cudaMemcpy(&mBeamSearchTable[0], mBeamSearchTableDevice, mBeamSearchTable.size() * sizeof(Ray),
+            cudaMemcpyDeviceToHost));
+    }
+    std::vector<int> validSamples(mSampleCount);
+    std::vector<int> candidates(mSampleCount * 3);
+    CUDA_CHECK(
+        cudaMemcpy(&validSamples[0], mValidSamplesDevice, mSampleCount * sizeof(int), cudaMemcpyDeviceToHost));
+    CUDA_CHECK(cudaMemcpy(&mCandidateLikelihoods[0], mCandidateLikelihoodsDevice, mSampleCount * sizeof(float),
+        cudaMemcpyDeviceToHost));
+    CUDA_CHECK(cudaMemcpy(&candidates[0], mCandidatesDevice, candidates.size() * sizeof(int), cudaMemcpyDeviceToHost));
+
+    // The device search runs all the samples of the batch from the first timestep
+    std::fill(mSampleTimestepIds.begin(), mSampleTimestepIds.end(), mTimestepId);
+    for (int sampleId = 0; sampleId < mSampleCount; ++sampleId)
+    {
+        mValidSamples[sampleId] = validSamples[sampleId] != 0;
+        if (mCandidateLikelihoods[sampleId] > mLikelihoodCombinationOperator->smallerThanMinimalLikelihood())
+        {
+            const int timestepId = candidates[sampleId * 3];
+            auto& candidate = mCandidates[sampleId];
+            candidate.resize(timestepId);
+            backtrack(timestepId - 2, sampleId, candidates[sampleId * 3 + 1], &candidate[0], timestepId - 2);
+            candidate[timestepId - 1] = candidates[sampleId * 3 + 2];
+        }
+    }
+
+    BeamSearchPolicy::readGeneratedResult(
+        sampleCount, maxOutputSequenceLength, hOutputData, hActualOutputSequenceLengths);
+}
+
+std::string DeviceBeamSearchPolicy::getInfo()
+{
+    std::stringstream ss;
+    ss << "Device Beam Search Policy, beam = " << mBeamWidth;
+    return ss.str();
+}
+} // namespace nmtSample
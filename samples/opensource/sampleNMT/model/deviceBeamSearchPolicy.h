@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_DEVICE_BEAM_SEARCH_POLICY_
+#define SAMPLE_NMT_DEVICE_BEAM_SEARCH_POLICY_
+
+#include "../deviceBuffer.h"
+#include "../pinnedHostBuffer.h"
+#include "beamSearchKernels.h"
+#include "beamSearchPolicy.h"
+
+#include <cuda_runtime_api.h>
+
+namespace nmtSample
+{
+/** \class DeviceBeamSearchPolicy
+ *
+ * \brief beam search policy keeping the search state and the backtracking table on the device
+ *
+ * processTimestep takes device pointers and only enqueues work on the stream, the generator outputs of a timestep are
+ * never copied to the host. The backtracking table is copied to the host once, in readGeneratedResult.
+ * getTailWithNoWorkRemaining waits for the previous timestep only, so the count it returns may be larger than the
+ * actual one by the samples that finished in the last timestep, which the next timestep then skips.
+ *
+ */
+class DeviceBeamSearchPolicy : public BeamSearchPolicy
+{
+public:
+    DeviceBeamSearchPolicy(int endSequenceId, LikelihoodCombinationOperator::ptr likelihoodCombinationOperator,
+        int beamWidth, int maxSampleCount, int maxOutputSequenceLength, cudaStream_t stream);
+
+    void initialize(int sampleCount, int* maxOutputSequenceLengths) override;
+
+    void processTimestep(int validSampleCount, const float* dCombinedLikelihoods, const int* dVocabularyIndices,
+        const int* dRayOptionIndices, int* dSourceRayIndices, float* dSourceLikelihoods) override;
+
+    int getTailWithNoWorkRemaining() override;
+
+    void readGeneratedResult(
+        int sampleCount, int maxOutputSequenceLength, int* hOutputData, int* hActualOutputSequenceLengths) override;
+
+    std::string getInfo() override;
+
+    ~DeviceBeamSearchPolicy() override;
+
+private:
+    // Timesteps whose tail can still be in flight when the host reads it
+    static const int kTimestepsInFlight = 2;
+
+    int mMaxSampleCount;
+    int mMaxOutputSequenceLength;
+    cudaStream_t mStream;
+    BeamSearchDeviceState mState;
+
+    DeviceBuffer<int> mMaxOutputSequenceLengthsDevice;
+    DeviceBuffer<int> mValidSamplesDevice;
+    DeviceBuffer<float> mCandidateLikelihoodsDevice;
+    DeviceBuffer<int> mCandidatesDevice;
+    DeviceBuffer<int> mBeamSearchTableDevice;
+    DeviceBuffer<int> mTailDevice;
+    PinnedHostBuffer<int> mTailHost;
+    cudaEvent_t mTailEvents[kTimestepsInFlight];
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_DEVICE_BEAM_SEARCH_POLICY_
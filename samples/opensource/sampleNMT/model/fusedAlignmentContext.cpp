@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fusedAlignmentContext.h"
+
+#include <cassert>
+
+namespace nmtSample
+{
+void FusedAlignmentContext::addToModel(nvinfer1::INetworkDefinition* network,
+    nvinfer1::ITensor* actualInputSequenceLengths, nvinfer1::ITensor* memoryStates, nvinfer1::ITensor* attentionKeys,
+    nvinfer1::ITensor* queryStates, nvinfer1::ITensor** contextOutput)
+{
+    nvinfer1::ITensor* inputs[] = {attentionKeys, queryStates, memoryStates, actualInputSequenceLengths};
+    auto pluginLayer = network->addPluginV2(inputs, 4, mPlugin);
+    assert(pluginLayer != nullptr);
+    pluginLayer->setName("Fused alignment, ragged softmax and context");
+    *contextOutput = pluginLayer->getOutput(0);
+    assert(*contextOutput != nullptr);
+}
+
+std::string FusedAlignmentContext::getInfo()
+{
+    return "Fused dot product alignment + ragged softmax + context plugin";
+}
+} // namespace nmtSample
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_FUSED_ALIGNMENT_CONTEXT_
+#define SAMPLE_NMT_FUSED_ALIGNMENT_CONTEXT_
+
+#include <memory>
+
+#include "../component.h"
+#include "NvInfer.h"
+#include "fusedContextPlugin.h"
+
+namespace nmtSample
+{
+/** \class FusedAlignmentContext
+ *
+ * \brief calculates context vector from attention keys, query states and memory states with a single plugin layer
+ *
+ * It stands for the multiplicative alignment scores and the context together.
+ *
+ */
+class FusedAlignmentContext : public Component
+{
+public:
+    typedef std::shared_ptr<FusedAlignmentContext> ptr;
+
+    FusedAlignmentContext() = default;
+
+    /**
+     * \brief add the alignment scores and the context vector calculation to the network
+     */
+    void addToModel(nvinfer1::INetworkDefinition* network, nvinfer1::ITensor* actualInputSequenceLengths,
+        nvinfer1::ITensor* memoryStates, nvinfer1::ITensor* attentionKeys, nvinfer1::ITensor* queryStates,
+        nvinfer1::ITensor** contextOutput);
+
+    std::string getInfo() override;
+
+    ~FusedAlignmentContext() override = default;
+
+private:
+    // The network only references the plugin, it has to outlive the engine build
+    FusedContextPlugin mPlugin;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_FUSED_ALIGNMENT_CONTEXT_
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../cudaError.h"
+#include "fusedContextKernels.h"
+
+#include <cuda_fp16.h>
+
+namespace nmtSample
+{
+namespace
+{
+const int kThreadsPerBlock = 128;
+const int kWarpSize = 32;
+
+__device__ __forceinline__ float toFloat(float x)
+{
+    return x;
+}
+
+__device__ __forceinline__ float toFloat(__half x)
+{
+    return __half2float(x);
+}
+
+template <typename T>
+__device__ __forceinline__ T fromFloat(float x);
+
+template <>
+__device__ __forceinline__ float fromFloat<float>(float x)
+{
+    return x;
+}
+
+template <>
+__device__ __forceinline__ __half fromFloat<__half>(float x)
+{
+    return __float2half(x);
+}
+
+__device__ __forceinline__ float warpSum(float x)
+{
+    for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+        x += __shfl_xor_sync(0xffffffff, x, offset);
+    return x;
+}
+
+__device__ __forceinline__ float warpMax(float x)
+{
+    for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+        x = fmaxf(x, __shfl_xor_sync(0xffffffff, x, offset));
+    return x;
+}
+
+// Reduces across the block, every thread gets the result
+template <bool isMax>
+__device__ float blockReduce(float x, float* scratch)
+{
+    const int lane = threadIdx.x % kWarpSize;
+    const int warp = threadIdx.x / kWarpSize;
+    x = isMax ? warpMax(x) : warpSum(x);
+    if (lane == 0)
+        scratch[warp] = x;
+    __syncthreads();
+    x = scratch[0];
+    for (int i = 1; i < blockDim.x / kWarpSize; ++i)
+        x = isMax ? fmaxf(x, scratch[i]) : x + scratch[i];
+    __syncthreads();
+    return x;
+}
+
+// One block per ray: the query and the scores of the ray stay in shared memory from the alignment to the context
+template <typename T>
+__global__ void fusedContextKernel(int beamWidth, int maxInputSequenceLength, int keySize, int memoryStatesSize,
+    const T* keys, const T* queries, const T* memoryStates, const int* actualInputSequenceLengths, T* context)
+{
+    extern __shared__ float shared[];
+    float* scratch = shared;                               // [kThreadsPerBlock / kWarpSize]
+    float* query = scratch + kThreadsPerBlock / kWarpSize; // [keySize]
+    float* scores = query + keySize;                       // [maxInputSequenceLength]
+
+    const int rayId = blockIdx.x;
+    const int sampleId = rayId / beamWidth;
+    const int lane = threadIdx.x % kWarpSize;
+    const int warp = threadIdx.x / kWarpSize;
+    const int warpCount = blockDim.x / kWarpSize;
+    const int sequenceLength = min(max(actualInputSequenceLengths[rayId], 0), maxInputSequenceLength);
+    keys += static_cast<size_t>(sampleId) * maxInputSequenceLength * keySize;
+    memoryStates += static_cast<size_t>(sampleId) * maxInputSequenceLength * memoryStatesSize;
+    context += static_cast<size_t>(rayId) * memoryStatesSize;
+
+    for (int i = threadIdx.x; i < keySize; i += blockDim.x)
+        query[i] = toFloat(queries[static_cast<size_t>(rayId) * keySize + i]);
+    __syncthreads();
+
+    // Alignment scores, a warp per input position
+    for (int t = warp; t < sequenceLength; t += warpCount)
+    {
+        float score = 0.0F;
+        for (int i = lane; i < keySize; i += kWarpSize)
+            score += query[i] * toFloat(keys[t * keySize + i]);
+        score = warpSum(score);
+        if (lane == 0)
+            scores[t] = score;
+    }
+    __syncthreads();
+
+    // Softmax over the actual input sequence only
+    float maxScore = -INFINITY;
+    for (int t = threadIdx.x; t < sequenceLength; t += blockDim.x)
+        maxScore = fmaxf(maxScore, scores[t]);
+    maxScore = blockReduce<true>(maxScore, scratch);
+    float sum = 0.0F;
+    for (int t = threadIdx.x; t < sequenceLength; t += blockDim.x)
+    {
+        const float e = __expf(scores[t] - maxScore);
+        scores[t] = e;
+        sum += e;
+    }
+    sum = blockReduce<false>(sum, scratch);
+    const float scale = sum > 0.0F ? 1.0F / sum : 0.0F;
+
+    // Context vector, consecutive threads read consecutive memory states
+    for (int i = threadIdx.x; i < memoryStatesSize; i += blockDim.x)
+    {
+        float c = 0.0F;
+        for (int t = 0; t < sequenceLength; ++t)
+            c += scores[t] * toFloat(memoryStates[t * memoryStatesSize + i]);
+        context[i] = fromFloat<T>(c * scale);
+    }
+}
+
+template <typename T>
+void launchFusedContext(int sampleCount, int beamWidth, int maxInputSequenceLength, int keySize, int memoryStatesSize,
+    const void* keys, const void* queries, const void* memoryStates, const int* actualInputSequenceLengths,
+    void* context, cudaStream_t stream)
+{
+    const size_t sharedMemorySize = fusedContextSharedMemorySize(maxInputSequenceLength, keySize);
+    fusedContextKernel<T><<<sampleCount * beamWidth, kThreadsPerBlock, sharedMemorySize, stream>>>(beamWidth,
+        maxInputSequenceLength, keySize, memoryStatesSize, static_cast<const T*>(keys), static_cast<const T*>(queries),
+        static_cast<const T*>(memoryStates), actualInputSequenceLengths, static_cast<T*>(context));
+}
+} // namespace
+
+size_t fusedContextSharedMemorySize(int maxInputSequenceLength, int keySize)
+{
+    return (kThreadsPerBlock / kWarpSize + keySize + maxInputSequenceLength) * sizeof(float);
+}
+
+void fusedContext(nvinfer1::DataType dataType, int sampleCount, int beamWidth, int maxInputSequenceLength, int keySize,
+    int memoryStatesSize, const void* keys, const void* queries, const void* memoryStates,
+    const int* actualInputSequenceLengths, void* context, cudaStream_t stream)
+{
+    if (dataType == nvinfer1::DataType::kHALF)
+        launchFusedContext<__half>(sampleCount, beamWidth, maxInputSequenceLength, keySize, memoryStatesSize, keys,
+            queries, memoryStates, actualInputSequenceLengths, context, stream);
+    else
+        launchFusedContext<float>(sampleCount, beamWidth, maxInputSequenceLength, keySize, memoryStatesSize, keys,
+            queries, memoryStates, actualInputSequenceLengths, context, stream);
+    CUDA_CHECK(cudaGetLastError());
+}
+} // namespace nmtSample
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_FUSED_CONTEXT_KERNELS_
+#define SAMPLE_NMT_FUSED_CONTEXT_KERNELS_
+
+#include "NvInfer.h"
+#include <cuda_runtime_api.h>
+
+namespace nmtSample
+{
+/**
+ * \brief shared memory the fused context kernel needs
+ */
+size_t fusedContextSharedMemorySize(int maxInputSequenceLength, int keySize);
+
+/**
+ * \brief computes the context vectors of all the rays in a single launch
+ *
+ * For each ray the alignment scores are the dot products of its query with the attention keys of its sample, the
+ * scores are softmaxed over the actual input sequence length and weight the memory states. keys, queries, memoryStates
+ * and context are all of dataType, kFLOAT or kHALF.
+ */
+void fusedContext(nvinfer1::DataType dataType, int sampleCount, int beamWidth, int maxInputSequenceLength, int keySize,
+    int memoryStatesSize, const void* keys, const void* queries, const void* memoryStates,
+    const int* actualInputSequenceLengths, void* context, cudaStream_t stream);
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_FUSED_CONTEXT_KERNELS_
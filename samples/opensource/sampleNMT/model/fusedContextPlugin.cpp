@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fusedContextPlugin.h"
+#include "fusedContextKernels.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace nmtSample
+{
+namespace
+{
+const char* kFusedContextPluginType{"NMTFusedContext"};
+const char* kFusedContextPluginVersion{"1"};
+
+template <typename T>
+void write(char*& buffer, const T& val)
+{
+    std::memcpy(buffer, &val, sizeof(T));
+    buffer += sizeof(T);
+}
+
+template <typename T>
+T read(const char*& buffer)
+{
+    T val;
+    std::memcpy(&val, buffer, sizeof(T));
+    buffer += sizeof(T);
+    return val;
+}
+} // namespace
+
+FusedContextPlugin::FusedContextPlugin(const void* data, size_t length)
+{
+    const char* d = static_cast<const char*>(data);
+    const char* const a = d;
+    mDataType = static_cast<nvinfer1::DataType>(read<int>(d));
+    mBeamWidth = read<int>(d);
+    mMaxInputSequenceLength = read<int>(d);
+    mKeySize = read<int>(d);
+    mMemoryStatesSize = read<int>(d);
+    assert(d == a + length);
+}
+
+int FusedContextPlugin::getNbOutputs() const
+{
+    return 1;
+}
+
+nvinfer1::Dims FusedContextPlugin::getOutputDimensions(int index, const nvinfer1::Dims* inputs, int nbInputDims)
+{
+    assert(index == 0 && nbInputDims == 4);
+    assert(inputs[0].nbDims == 2 && inputs[1].nbDims == 2 && inputs[2].nbDims == 2);
+    assert(inputs[0].d[0] == inputs[2].d[0] && inputs[0].d[1] == inputs[1].d[1]);
+    return nvinfer1::Dims{
+        2, {inputs[1].d[0], inputs[2].d[1]}, {nvinfer1::DimensionType::kINDEX, nvinfer1::DimensionType::kCHANNEL}};
+}
+
+int FusedContextPlugin::initialize()
+{
+    return 0;
+}
+
+void FusedContextPlugin::terminate()
+{
+}
+
+size_t FusedContextPlugin::getWorkspaceSize(int maxBatchSize) const
+{
+    return 0;
+}
+
+int FusedContextPlugin::enqueue(
+    int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
+{
+    fusedContext(mDataType, batchSize, mBeamWidth, mMaxInputSequenceLength, mKeySize, mMemoryStatesSize, inputs[0],
+        inputs[1], inputs[2], static_cast<const int*>(inputs[3]), outputs[0], stream);
+    return 0;
+}
+
+size_t FusedContextPlugin::getSerializationSize() const
+{
+    return 5 * sizeof(int);
+}
+
+void FusedContextPlugin::serialize(void* buffer) const
+{
+    char* d = static_cast<char*>(buffer);
+    const char* const a = d;
+    write(d, static_cast<int>(mDataType));
+    write(d, mBeamWidth);
+    write(d, mMaxInputSequenceLength);
+    write(d, mKeySize);
+    write(d, mMemoryStatesSize);
+    assert(d == a + getSerializationSize());
+}
+
+void FusedContextPlugin::configurePlugin(
+    const nvinfer1::PluginTensorDesc* in, int nbInput, const nvinfer1::PluginTensorDesc* out, int nbOutput)
+{
+    assert(in && nbInput == 4);
+    assert(out && nbOutput == 1);
+    assert(in[0].type == in[1].type && in[0].type == in[2].type && in[0].type == out[0].type);
+    assert(in[3].type == nvinfer1::DataType::kINT32);
+
+    mDataType = in[0].type;
+    mMaxInputSequenceLength = in[0].dims.d[0];
+    mKeySize = in[0].dims.d[1];
+    mBeamWidth = in[1].dims.d[0];
+    mMemoryStatesSize = in[2].dims.d[1];
+}
+
+//! The keys, queries, memory states and context share kFLOAT or kHALF, the sequence lengths are kINT32, all kLINEAR.
+bool FusedContextPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
+{
+    assert(nbInputs == 4 && nbOutputs == 1 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != nvinfer1::TensorFormat::kLINEAR)
+        return false;
+    if (pos == 3)
+        return inOut[pos].type == nvinfer1::DataType::kINT32;
+    if (pos == 0)
+        return inOut[pos].type == nvinfer1::DataType::kFLOAT || inOut[pos].type == nvinfer1::DataType::kHALF;
+    return inOut[pos].type == inOut[0].type;
+}
+
+nvinfer1::DataType FusedContextPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    assert(index == 0 && inputTypes && nbInputs == 4);
+    return inputTypes[0];
+}
+
+const char* FusedContextPlugin::getPluginType() const
+{
+    return kFusedContextPluginType;
+}
+
+const char* FusedContextPlugin::getPluginVersion() const
+{
+    return kFusedContextPluginVersion;
+}
+
+void FusedContextPlugin::destroy()
+{
+    delete this;
+}
+
+nvinfer1::IPluginV2Ext* FusedContextPlugin::clone() const
+{
+    return new FusedContextPlugin(*this);
+}
+
+void FusedContextPlugin::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* FusedContextPlugin::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+bool FusedContextPlugin::isOutputBroadcastAcrossBatch(
+    int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+{
+    return false;
+}
+
+bool FusedContextPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+{
+    return false;
+}
+} // namespace nmtSample
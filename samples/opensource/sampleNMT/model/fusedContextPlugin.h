@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_FUSED_CONTEXT_PLUGIN_
+#define SAMPLE_NMT_FUSED_CONTEXT_PLUGIN_
+
+#include <string>
+
+#include "NvInfer.h"
+
+namespace nmtSample
+{
+/** \class FusedContextPlugin
+ *
+ * \brief computes the context vectors from the attention keys, the queries and the memory states in one kernel
+ *
+ * Inputs are the attention keys [maxInputSequenceLength, keySize], the queries [beamWidth, keySize], the memory
+ * states [maxInputSequenceLength, memoryStatesSize] and the actual input sequence lengths [beamWidth, 1], the output
+ * is the context [beamWidth, memoryStatesSize]. It replaces the alignment matrix multiply, the ragged softmax and the
+ * context matrix multiply, which each launch their own kernels for only gBeamWidth rows per sample.
+ *
+ */
+class FusedContextPlugin : public nvinfer1::IPluginV2IOExt
+{
+public:
+    FusedContextPlugin() = default;
+
+    FusedContextPlugin(const void* data, size_t length);
+
+    int getNbOutputs() const override;
+
+    nvinfer1::Dims getOutputDimensions(int index, const nvinfer1::Dims* inputs, int nbInputDims) override;
+
+    int initialize() override;
+
+    void terminate() override;
+
+    size_t getWorkspaceSize(int maxBatchSize) const override;
+
+    int enqueue(
+        int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream) override;
+
+    size_t getSerializationSize() const override;
+
+    void serialize(void* buffer) const override;
+
+    void configurePlugin(const nvinfer1::PluginTensorDesc* in, int nbInput, const nvinfer1::PluginTensorDesc* out,
+        int nbOutput) override;
+
+    bool supportsFormatCombination(
+        int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const override;
+
+    nvinfer1::DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+    const char* getPluginType() const override;
+
+    const char* getPluginVersion() const override;
+
+    void destroy() override;
+
+    nvinfer1::IPluginV2Ext* clone() const override;
+
+    void setPluginNamespace(const char* libNamespace) override;
+
+    const char* getPluginNamespace() const override;
+
+    bool isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const override;
+
+    bool canBroadcastInputAcrossBatch(int inputIndex) const override;
+
+private:
+    nvinfer1::DataType mDataType{nvinfer1::DataType::kFLOAT};
+    int mBeamWidth{0};
+    int mMaxInputSequenceLength{0};
+    int mKeySize{0};
+    int mMemoryStatesSize{0};
+    std::string mNamespace;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_FUSED_CONTEXT_PLUGIN_
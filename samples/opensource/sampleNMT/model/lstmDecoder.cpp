@@ -32,7 +32,7 @@ LSTMDecoder::LSTMDecoder(ComponentWeights::ptr weights)
     // please refer to chpt_to_bin.py for the details on the format
     assert(mWeights->mMetaData.size() >= 4);
     nvinfer1::DataType dataType = static_cast<nvinfer1::DataType>(mWeights->mMetaData[0]);
-    assert(dataType == nvinfer1::DataType::kFLOAT);
+    assert(dataType == nvinfer1::DataType::kFLOAT || dataType == nvinfer1::DataType::kHALF);
     mRNNKind = mWeights->mMetaData[1];
     mNumLayers = mWeights->mMetaData[2];
     mNumUnits = mWeights->mMetaData[3];
@@ -50,15 +50,15 @@ LSTMDecoder::LSTMDecoder(ComponentWeights::ptr weights)
         {
             // encoder input size == mNumUnits
             int64_t inputSize = ((layerIndex == 0) && (gateIndex < 4)) ? dataSize : mNumUnits;
-            nvinfer1::Weights gateKernelWeights{dataType, &mWeights->mWeights[0] + kernelOffset, inputSize * mNumUnits};
-            nvinfer1::Weights gateBiasWeights{dataType, &mWeights->mWeights[0] + biasOffset, mNumUnits};
+            nvinfer1::Weights gateKernelWeights{dataType, mWeights->data() + kernelOffset, inputSize * mNumUnits};
+            nvinfer1::Weights gateBiasWeights{dataType, mWeights->data() + biasOffset, mNumUnits};
             mGateKernelWeights.push_back(std::move(gateKernelWeights));
             mGateBiasWeights.push_back(std::move(gateBiasWeights));
             kernelOffset = kernelOffset + inputSize * mNumUnits * elementSize;
             biasOffset = biasOffset + mNumUnits * elementSize;
         }
     }
-    assert(kernelOffset + biasOffset - biasStartOffset == mWeights->mWeights.size());
+    assert(kernelOffset + biasOffset - biasStartOffset == mWeights->size());
 }
 
 void LSTMDecoder::addToModel(nvinfer1::INetworkDefinition* network, nvinfer1::ITensor* inputEmbeddedData,
@@ -90,6 +90,8 @@ void LSTMDecoder::addToModel(nvinfer1::INetworkDefinition* network, nvinfer1::IT
     auto decoderLayer = network->addRNNv2(*shuffledInput, mNumLayers, mNumUnits, 1, nvinfer1::RNNOperation::kLSTM);
     assert(decoderLayer != nullptr);
     decoderLayer->setName("LSTM decoder");
+    // FP16 weights run the layer in FP16
+    decoderLayer->setPrecision(mGateKernelWeights.front().type);
 
     decoderLayer->setInputMode(nvinfer1::RNNInputMode::kLINEAR);
     decoderLayer->setDirection(nvinfer1::RNNDirection::kUNIDIRECTION);
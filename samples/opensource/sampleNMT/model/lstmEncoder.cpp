@@ -29,7 +29,7 @@ LSTMEncoder::LSTMEncoder(ComponentWeights::ptr weights)
     // please refer to chpt_to_bin.py for the details on the format
     assert(mWeights->mMetaData.size() >= 4);
     const nvinfer1::DataType dataType = static_cast<nvinfer1::DataType>(mWeights->mMetaData[0]);
-    assert(dataType == nvinfer1::DataType::kFLOAT);
+    assert(dataType == nvinfer1::DataType::kFLOAT || dataType == nvinfer1::DataType::kHALF);
     mRNNKind = mWeights->mMetaData[1];
     mNumLayers = mWeights->mMetaData[2];
     mNumUnits = mWeights->mMetaData[3];
@@ -46,15 +46,15 @@ LSTMEncoder::LSTMEncoder(ComponentWeights::ptr weights)
         {
             // encoder input size == mNumUnits
             int64_t inputSize = ((layerIndex == 0) && (gateIndex < 4)) ? mNumUnits : mNumUnits;
-            nvinfer1::Weights gateKernelWeights{dataType, &mWeights->mWeights[0] + kernelOffset, inputSize * mNumUnits};
-            nvinfer1::Weights gateBiasWeights{dataType, &mWeights->mWeights[0] + biasOffset, mNumUnits};
+            nvinfer1::Weights gateKernelWeights{dataType, mWeights->data() + kernelOffset, inputSize * mNumUnits};
+            nvinfer1::Weights gateBiasWeights{dataType, mWeights->data() + biasOffset, mNumUnits};
             mGateKernelWeights.push_back(std::move(gateKernelWeights));
             mGateBiasWeights.push_back(std::move(gateBiasWeights));
             kernelOffset = kernelOffset + inputSize * mNumUnits * elementSize;
             biasOffset = biasOffset + mNumUnits * elementSize;
         }
     }
-    assert(kernelOffset + biasOffset - biasStartOffset == mWeights->mWeights.size());
+    assert(kernelOffset + biasOffset - biasStartOffset == mWeights->size());
 }
 
 void LSTMEncoder::addToModel(nvinfer1::INetworkDefinition* network, int maxInputSequenceLength,
@@ -65,6 +65,8 @@ void LSTMEncoder::addToModel(nvinfer1::INetworkDefinition* network, int maxInput
         *inputEmbeddedData, mNumLayers, mNumUnits, maxInputSequenceLength, nvinfer1::RNNOperation::kLSTM);
     assert(encoderLayer != nullptr);
     encoderLayer->setName("LSTM encoder");
+    // FP16 weights run the layer in FP16
+    encoderLayer->setPrecision(mGateKernelWeights.front().type);
 
     encoderLayer->setSequenceLengths(*actualInputSequenceLengths);
     encoderLayer->setInputMode(nvinfer1::RNNInputMode::kLINEAR);
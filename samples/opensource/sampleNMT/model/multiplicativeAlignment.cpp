@@ -27,11 +27,11 @@ MultiplicativeAlignment::MultiplicativeAlignment(ComponentWeights::ptr weights)
     // please refer to chpt_to_bin.py for the details on the format
     assert(mWeights->mMetaData.size() >= 3);
     mKernelWeights.type = static_cast<nvinfer1::DataType>(mWeights->mMetaData[0]);
-    assert(mKernelWeights.type == nvinfer1::DataType::kFLOAT);
+    assert(mKernelWeights.type == nvinfer1::DataType::kFLOAT || mKernelWeights.type == nvinfer1::DataType::kHALF);
     mInputChannelCount = mWeights->mMetaData[1];
     mOutputChannelCount = mWeights->mMetaData[2];
 
-    mKernelWeights.values = (void*) (&mWeights->mWeights[0]);
+    mKernelWeights.values = mWeights->data();
     mKernelWeights.count = mInputChannelCount * mOutputChannelCount;
 }
 
@@ -41,6 +41,7 @@ void MultiplicativeAlignment::addToModel(nvinfer1::INetworkDefinition* network,
     auto mmLayer = network->addMatrixMultiply(*queryStates, false, *attentionKeys, true);
     assert(mmLayer != nullptr);
     mmLayer->setName("Raw Alignment Scores MM (Queries x Keys) in multiplicative attention");
+    mmLayer->setPrecision(mKernelWeights.type);
     *alignmentScores = mmLayer->getOutput(0);
     assert(*alignmentScores != nullptr);
 }
@@ -59,6 +60,7 @@ void MultiplicativeAlignment::addAttentionKeys(
     auto mmLayer = network->addMatrixMultiply(*memoryStates, false, *weights, false);
     assert(mmLayer != nullptr);
     mmLayer->setName("Attention Keys MM in multiplicative attention");
+    mmLayer->setPrecision(mKernelWeights.type);
     *attentionKeys = mmLayer->getOutput(0);
     assert(*attentionKeys != nullptr);
 }
@@ -27,11 +27,11 @@ SLPAttention::SLPAttention(ComponentWeights::ptr weights)
     // please refer to chpt_to_bin.py for the details on the format
     assert(mWeights->mMetaData.size() >= 3);
     mKernelWeights.type = static_cast<nvinfer1::DataType>(mWeights->mMetaData[0]);
-    assert(mKernelWeights.type == nvinfer1::DataType::kFLOAT);
+    assert(mKernelWeights.type == nvinfer1::DataType::kFLOAT || mKernelWeights.type == nvinfer1::DataType::kHALF);
     mInputChannelCount = mWeights->mMetaData[1];
     mOutputChannelCount = mWeights->mMetaData[2];
 
-    mKernelWeights.values = (void*) (&mWeights->mWeights[0]);
+    mKernelWeights.values = mWeights->data();
     mKernelWeights.count = mInputChannelCount * mOutputChannelCount;
 }
 
@@ -57,6 +57,7 @@ void SLPAttention::addToModel(nvinfer1::INetworkDefinition* network, nvinfer1::I
     auto mmLayer = network->addMatrixMultiply(*concatinatedTensor, false, *weights, false);
     assert(mmLayer != nullptr);
     mmLayer->setName("Attention Matrix Multiply");
+    mmLayer->setPrecision(mKernelWeights.type);
 
     auto actLayer = network->addActivation(*mmLayer->getOutput(0), nvinfer1::ActivationType::kTANH);
     assert(actLayer != nullptr);
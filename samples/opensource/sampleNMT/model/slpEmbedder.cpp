@@ -32,8 +32,8 @@ SLPEmbedder::SLPEmbedder(ComponentWeights::ptr weights)
     // Resize dimensions to be multiples of gPadMultiple for performance
     mNumInputs = samplesCommon::roundUp(mWeights->mMetaData[1], gPadMultiple);  // matches projection output channels
     mNumOutputs = samplesCommon::roundUp(mWeights->mMetaData[2], gPadMultiple); // matches projection input channels
-    mResizedKernelWeights = resizeWeights(
-        mWeights->mMetaData[1], mWeights->mMetaData[2], mNumInputs, mNumOutputs, (const float*) &mWeights->mWeights[0]);
+    mResizedKernelWeights = resizeWeights(mWeights->mMetaData[1], mWeights->mMetaData[2], mNumInputs, mNumOutputs,
+        mWeights->data(), inferTypeToBytes(mKernelWeights.type));
     mKernelWeights.values = mResizedKernelWeights.data();
     mKernelWeights.count = mNumInputs * mNumOutputs;
 }
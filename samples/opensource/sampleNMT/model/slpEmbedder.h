@@ -52,7 +52,7 @@ protected:
     nvinfer1::Weights mKernelWeights;
     int mNumInputs;
     int mNumOutputs;
-    std::vector<float> mResizedKernelWeights;
+    std::vector<char> mResizedKernelWeights;
 };
 } // namespace nmtSample
 
@@ -28,12 +28,12 @@ SLPProjection::SLPProjection(ComponentWeights::ptr weights)
     // please refer to chpt_to_bin.py for the details on the format
     assert(mWeights->mMetaData.size() >= 3);
     mKernelWeights.type = static_cast<nvinfer1::DataType>(mWeights->mMetaData[0]);
-    assert(mKernelWeights.type == nvinfer1::DataType::kFLOAT);
+    assert(mKernelWeights.type == nvinfer1::DataType::kFLOAT || mKernelWeights.type == nvinfer1::DataType::kHALF);
     // Resize dimensions to be multiples of gPadMultiple for performance
     mInputChannelCount = samplesCommon::roundUp(mWeights->mMetaData[1], gPadMultiple);  // matches embedder outputs
     mOutputChannelCount = samplesCommon::roundUp(mWeights->mMetaData[2], gPadMultiple); // matches embedder inputs
     mResizedKernelWeights = resizeWeights(mWeights->mMetaData[1], mWeights->mMetaData[2], mInputChannelCount,
-        mOutputChannelCount, (const float*) &mWeights->mWeights[0]);
+        mOutputChannelCount, mWeights->data(), inferTypeToBytes(mKernelWeights.type));
     mKernelWeights.values = mResizedKernelWeights.data();
     mKernelWeights.count = mInputChannelCount * mOutputChannelCount;
 }
@@ -52,6 +52,7 @@ void SLPProjection::addToModel(
     auto mmLayer = network->addMatrixMultiply(*input, false, *weights, false);
     assert(mmLayer != nullptr);
     mmLayer->setName("Projection Matrix Multiply");
+    mmLayer->setPrecision(mKernelWeights.type);
     *outputLogits = mmLayer->getOutput(0);
     assert(*outputLogits != nullptr);
 }
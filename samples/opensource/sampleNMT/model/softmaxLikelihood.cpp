@@ -22,29 +22,53 @@
 
 namespace nmtSample
 {
+SoftmaxLikelihood::SoftmaxLikelihood(bool fusedTopK)
+    : mFusedTopK(fusedTopK)
+{
+}
+
 void SoftmaxLikelihood::addToModel(nvinfer1::INetworkDefinition* network, int beamWidth, nvinfer1::ITensor* inputLogits,
     nvinfer1::ITensor* inputLikelihoods, nvinfer1::ITensor** newCombinedLikelihoods,
     nvinfer1::ITensor** newRayOptionIndices, nvinfer1::ITensor** newVocabularyIndices)
 {
-    auto softmaxLayer = network->addSoftMax(*inputLogits);
-    assert(softmaxLayer != nullptr);
-    softmaxLayer->setName("Softmax in likelihood calculation");
-    softmaxLayer->setAxes(2);
-    auto softmaxTensor = softmaxLayer->getOutput(0);
-    assert(softmaxTensor != nullptr);
-
-    auto topKLayer = network->addTopK(*softmaxTensor, nvinfer1::TopKOperation::kMAX, beamWidth, 2);
-    assert(topKLayer != nullptr);
-    topKLayer->setName("TopK 1st in likelihood calculation");
-    auto newLikelihoods = topKLayer->getOutput(0);
-    assert(newLikelihoods != nullptr);
-    auto vocabularyIndices = topKLayer->getOutput(1);
-    assert(vocabularyIndices != nullptr);
+    nvinfer1::ITensor* newLikelihoods;
+    nvinfer1::ITensor* vocabularyIndices;
+    if (mFusedTopK)
+    {
+        mSoftmaxTopKPlugin.reset(new SoftmaxTopKPlugin(beamWidth));
+        auto softmaxTopKLayer = network->addPluginV2(&inputLogits, 1, *mSoftmaxTopKPlugin);
+        assert(softmaxTopKLayer != nullptr);
+        softmaxTopKLayer->setName("Fused Softmax and TopK 1st in likelihood calculation");
+        newLikelihoods = softmaxTopKLayer->getOutput(0);
+        assert(newLikelihoods != nullptr);
+        vocabularyIndices = softmaxTopKLayer->getOutput(1);
+        assert(vocabularyIndices != nullptr);
+    }
+    else
+    {
+        auto softmaxLayer = network->addSoftMax(*inputLogits);
+        assert(softmaxLayer != nullptr);
+        softmaxLayer->setName("Softmax in likelihood calculation");
+        softmaxLayer->setAxes(2);
+        auto softmaxTensor = softmaxLayer->getOutput(0);
+        assert(softmaxTensor != nullptr);
+
+        auto topKLayer = network->addTopK(*softmaxTensor, nvinfer1::TopKOperation::kMAX, beamWidth, 2);
+        assert(topKLayer != nullptr);
+        topKLayer->setName("TopK 1st in likelihood calculation");
+        newLikelihoods = topKLayer->getOutput(0);
+        assert(newLikelihoods != nullptr);
+        vocabularyIndices = topKLayer->getOutput(1);
+        assert(vocabularyIndices != nullptr);
+    }
 
     auto eltWiseLayer
         = network->addElementWise(*newLikelihoods, *inputLikelihoods, nvinfer1::ElementWiseOperation::kPROD);
     assert(eltWiseLayer != nullptr);
     eltWiseLayer->setName("EltWise multiplication in likelihood calculation");
+    // The likelihoods of the beams accumulate over the steps, they stay in FP32 with FP16 logits for stable ranking
+    eltWiseLayer->setPrecision(nvinfer1::DataType::kFLOAT);
+    eltWiseLayer->setOutputType(0, nvinfer1::DataType::kFLOAT);
     auto combinedLikelihoods = eltWiseLayer->getOutput(0);
     assert(combinedLikelihoods != nullptr);
 
@@ -59,6 +83,8 @@ void SoftmaxLikelihood::addToModel(nvinfer1::INetworkDefinition* network, int be
     auto topKLayer2 = network->addTopK(*reshapedCombinedLikelihoods, nvinfer1::TopKOperation::kMAX, beamWidth, 1);
     assert(topKLayer2 != nullptr);
     topKLayer2->setName("TopK 2nd in likelihood calculation");
+    topKLayer2->setPrecision(nvinfer1::DataType::kFLOAT);
+    topKLayer2->setOutputType(0, nvinfer1::DataType::kFLOAT);
     *newCombinedLikelihoods = topKLayer2->getOutput(0);
     assert(*newCombinedLikelihoods != nullptr);
     *newRayOptionIndices = topKLayer2->getOutput(1);
@@ -102,6 +128,6 @@ LikelihoodCombinationOperator::ptr SoftmaxLikelihood::getLikelihoodCombinationOp
 
 std::string SoftmaxLikelihood::getInfo()
 {
-    return "Softmax Likelihood";
+    return mFusedTopK ? "Softmax Likelihood, fused softmax and TopK" : "Softmax Likelihood";
 }
 } // namespace nmtSample
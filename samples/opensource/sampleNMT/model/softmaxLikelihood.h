@@ -17,8 +17,11 @@
 #ifndef SAMPLE_NMT_SOFTMAX_LIKELIHOOD_
 #define SAMPLE_NMT_SOFTMAX_LIKELIHOOD_
 
+#include <memory>
+
 #include "NvInfer.h"
 #include "likelihood.h"
+#include "softmaxTopKPlugin.h"
 
 namespace nmtSample
 {
@@ -45,7 +48,10 @@ private:
     };
 
 public:
-    SoftmaxLikelihood() = default;
+    /**
+     * \brief with fusedTopK the softmax and the first TopK run as a single plugin layer
+     */
+    explicit SoftmaxLikelihood(bool fusedTopK = false);
 
     LikelihoodCombinationOperator::ptr getLikelihoodCombinationOperator() const override;
 
@@ -56,6 +62,11 @@ public:
     std::string getInfo() override;
 
     ~SoftmaxLikelihood() override = default;
+
+private:
+    bool mFusedTopK;
+    // The network only references the plugin, it has to outlive the engine build
+    std::unique_ptr<SoftmaxTopKPlugin> mSoftmaxTopKPlugin;
 };
 } // namespace nmtSample
 
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../cudaError.h"
+#include "softmaxTopKKernels.h"
+
+#include <cuda_fp16.h>
+
+namespace nmtSample
+{
+namespace
+{
+const int kThreadsPerBlock = 128;
+const int kWarpSize = 32;
+
+__device__ __forceinline__ float toFloat(float x)
+{
+    return x;
+}
+
+__device__ __forceinline__ float toFloat(__half x)
+{
+    return __half2float(x);
+}
+
+template <typename T>
+__device__ __forceinline__ T fromFloat(float x);
+
+template <>
+__device__ __forceinline__ float fromFloat<float>(float x)
+{
+    return x;
+}
+
+template <>
+__device__ __forceinline__ __half fromFloat<__half>(float x)
+{
+    return __float2half(x);
+}
+
+// Larger value first, lower index first among equal values
+__device__ __forceinline__ bool isBetter(float value, int index, float otherValue, int otherIndex)
+{
+    return value > otherValue || (value == otherValue && index < otherIndex);
+}
+
+// Running softmax normalizer: sum of exp(x - max) over the values seen so far
+__device__ __forceinline__ void mergeNormalizer(float& max, float& sum, float otherMax, float otherSum)
+{
+    const float newMax = fmaxf(max, otherMax);
+    if (newMax == -INFINITY)
+        return;
+    sum = sum * __expf(max - newMax) + otherSum * __expf(otherMax - newMax);
+    max = newMax;
+}
+
+// One block per row. Every thread selects the top k of its strided part of the row, then k rounds of a block argmax
+// over the heads of the per-thread lists give the top k of the row.
+template <typename T>
+__global__ void softmaxTopKKernel(int rowSize, int k, const T* logits, T* probabilities, int* indices)
+{
+    __shared__ float candidateValues[kThreadsPerBlock * kMaxSoftmaxTopK];
+    __shared__ int candidateIndices[kThreadsPerBlock * kMaxSoftmaxTopK];
+    __shared__ float warpValues[kThreadsPerBlock / kWarpSize];
+    __shared__ int warpPositions[kThreadsPerBlock / kWarpSize];
+    __shared__ int warpIndices[kThreadsPerBlock / kWarpSize];
+    __shared__ float warpMaxes[kThreadsPerBlock / kWarpSize];
+    __shared__ float warpSums[kThreadsPerBlock / kWarpSize];
+
+    const int lane = threadIdx.x % kWarpSize;
+    const int warp = threadIdx.x / kWarpSize;
+    logits += static_cast<size_t>(blockIdx.x) * rowSize;
+    probabilities += static_cast<size_t>(blockIdx.x) * k;
+    indices += static_cast<size_t>(blockIdx.x) * k;
+
+    // The list of each thread is kept sorted in shared memory, insertion is cheap for the small k of a beam
+    float* values = candidateValues + threadIdx.x * kMaxSoftmaxTopK;
+    int* valueIndices = candidateIndices + threadIdx.x * kMaxSoftmaxTopK;
+    for (int i = 0; i < k; ++i)
+    {
+        values[i] = -INFINITY;
+        valueIndices[i] = rowSize;
+    }
+    float max = -INFINITY;
+    float sum = 0.0F;
+    for (int i = threadIdx.x; i < rowSize; i += blockDim.x)
+    {
+        const float x = toFloat(logits[i]);
+        mergeNormalizer(max, sum, x, 1.0F);
+        if (isBetter(x, i, values[k - 1], valueIndices[k - 1]))
+        {
+            int position = k - 1;
+            for (; position > 0 && isBetter(x, i, values[position - 1], valueIndices[position - 1]); --position)
+            {
+                values[position] = values[position - 1];
+                valueIndices[position] = valueIndices[position - 1];
+            }
+            values[position] = x;
+            valueIndices[position] = i;
+        }
+    }
+
+    // Normalizer of the whole row
+    for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+    {
+        const float otherMax = __shfl_xor_sync(0xffffffff, max, offset);
+        const float otherSum = __shfl_xor_sync(0xffffffff, sum, offset);
+        mergeNormalizer(max, sum, otherMax, otherSum);
+    }
+    if (lane == 0)
+    {
+        warpMaxes[warp] = max;
+        warpSums[warp] = sum;
+    }
+    __syncthreads();
+    max = warpMaxes[0];
+    sum = warpSums[0];
+    for (int i = 1; i < blockDim.x / kWarpSize; ++i)
+        mergeNormalizer(max, sum, warpMaxes[i], warpSums[i]);
+
+    int head = 0;
+    for (int round = 0; round < k; ++round)
+    {
+        // Block argmax over the heads, positions address the candidates in shared memory
+        float value = head < k ? values[head] : -INFINITY;
+        int position = threadIdx.x * kMaxSoftmaxTopK + head;
+        int index = head < k ? valueIndices[head] : rowSize;
+        for (int offset = kWarpSize / 2; offset > 0; offset /= 2)
+        {
+            const float otherValue = __shfl_xor_sync(0xffffffff, value, offset);
+            const int otherPosition = __shfl_xor_sync(0xffffffff, position, offset);
+            const int otherIndex = __shfl_xor_sync(0xffffffff, index, offset);
+            if (isBetter(otherValue, otherIndex, value, index))
+            {
+                value = otherValue;
+                position = otherPosition;
+                index = otherIndex;
+            }
+        }
+        if (lane == 0)
+        {
+            warpValues[warp] = value;
+            warpPositions[warp] = position;
+            warpIndices[warp] = index;
+        }
+        __syncthreads();
+        int best = 0;
+        for (int i = 1; i < blockDim.x / kWarpSize; ++i)
+        {
+            if (isBetter(warpValues[i], warpIndices[i], warpValues[best], warpIndices[best]))
+                best = i;
+        }
+        const int bestPosition = warpPositions[best];
+        if (threadIdx.x == 0)
+        {
+            const float probability = sum > 0.0F ? __expf(warpValues[best] - max) / sum : 0.0F;
+            probabilities[round] = fromFloat<T>(probability);
+            indices[round] = min(warpIndices[best], rowSize - 1);
+        }
+        if (bestPosition / kMaxSoftmaxTopK == threadIdx.x)
+            ++head;
+        __syncthreads();
+    }
+}
+
+template <typename T>
+void launchSoftmaxTopK(
+    int rowCount, int rowSize, int k, const void* logits, void* probabilities, int* indices, cudaStream_t stream)
+{
+    softmaxTopKKernel<T><<<rowCount, kThreadsPerBlock, 0, stream>>>(
+        rowSize, k, static_cast<const T*>(logits), static_cast<T*>(probabilities), indices);
+}
+} // namespace
+
+void softmaxTopK(nvinfer1::DataType dataType, int rowCount, int rowSize, int k, const void* logits,
+    void* probabilities, int* indices, cudaStream_t stream)
+{
+    if (dataType == nvinfer1::DataType::kHALF)
+        launchSoftmaxTopK<__half>(rowCount, rowSize, k, logits, probabilities, indices, stream);
+    else
+        launchSoftmaxTopK<float>(rowCount, rowSize, k, logits, probabilities, indices, stream);
+    CUDA_CHECK(cudaGetLastError());
+}
+} // namespace nmtSample
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_SOFTMAX_TOPK_KERNELS_
+#define SAMPLE_NMT_SOFTMAX_TOPK_KERNELS_
+
+#include "NvInfer.h"
+#include <cuda_runtime_api.h>
+
+namespace nmtSample
+{
+//! Largest K the fused softmax top-K supports
+const int kMaxSoftmaxTopK = 16;
+
+/**
+ * \brief writes the K largest softmax probabilities of every row of logits and their indices
+ *
+ * Each row is read once: the softmax normalizer is accumulated online while the top K logits are selected, so the
+ * probabilities of the whole row are never written. logits and probabilities are of dataType, kFLOAT or kHALF.
+ */
+void softmaxTopK(nvinfer1::DataType dataType, int rowCount, int rowSize, int k, const void* logits,
+    void* probabilities, int* indices, cudaStream_t stream);
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_SOFTMAX_TOPK_KERNELS_
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "softmaxTopKPlugin.h"
+#include "softmaxTopKKernels.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace nmtSample
+{
+namespace
+{
+const char* kSoftmaxTopKPluginType{"NMTSoftmaxTopK"};
+const char* kSoftmaxTopKPluginVersion{"1"};
+
+template <typename T>
+void write(char*& buffer, const T& val)
+{
+    std::memcpy(buffer, &val, sizeof(T));
+    buffer += sizeof(T);
+}
+
+template <typename T>
+T read(const char*& buffer)
+{
+    T val;
+    std::memcpy(&val, buffer, sizeof(T));
+    buffer += sizeof(T);
+    return val;
+}
+} // namespace
+
+SoftmaxTopKPlugin::SoftmaxTopKPlugin(int k)
+    : mK(k)
+{
+    assert(mK > 0 && mK <= kMaxSoftmaxTopK);
+}
+
+SoftmaxTopKPlugin::SoftmaxTopKPlugin(const void* data, size_t length)
+{
+    const char* d = static_cast<const char*>(data);
+    const char* const a = d;
+    mDataType = static_cast<nvinfer1::DataType>(read<int>(d));
+    mK = read<int>(d);
+    mRowCount = read<int>(d);
+    mRowSize = read<int>(d);
+    assert(d == a + length);
+}
+
+int SoftmaxTopKPlugin::getNbOutputs() const
+{
+    return 2;
+}
+
+nvinfer1::Dims SoftmaxTopKPlugin::getOutputDimensions(int index, const nvinfer1::Dims* inputs, int nbInputDims)
+{
+    assert(index < 2 && nbInputDims == 1 && inputs[0].nbDims == 2 && inputs[0].d[1] >= mK);
+    return nvinfer1::Dims{
+        2, {inputs[0].d[0], mK}, {nvinfer1::DimensionType::kINDEX, nvinfer1::DimensionType::kCHANNEL}};
+}
+
+int SoftmaxTopKPlugin::initialize()
+{
+    return 0;
+}
+
+void SoftmaxTopKPlugin::terminate()
+{
+}
+
+size_t SoftmaxTopKPlugin::getWorkspaceSize(int maxBatchSize) const
+{
+    return 0;
+}
+
+int SoftmaxTopKPlugin::enqueue(
+    int batchSize, const void* const* inputs, void** outputs, void* workspace, cudaStream_t stream)
+{
+    softmaxTopK(
+        mDataType, batchSize * mRowCount, mRowSize, mK, inputs[0], outputs[0], static_cast<int*>(outputs[1]), stream);
+    return 0;
+}
+
+size_t SoftmaxTopKPlugin::getSerializationSize() const
+{
+    return 4 * sizeof(int);
+}
+
+void SoftmaxTopKPlugin::serialize(void* buffer) const
+{
+    char* d = static_cast<char*>(buffer);
+    const char* const a = d;
+    write(d, static_cast<int>(mDataType));
+    write(d, mK);
+    write(d, mRowCount);
+    write(d, mRowSize);
+    assert(d == a + getSerializationSize());
+}
+
+void SoftmaxTopKPlugin::configurePlugin(
+    const nvinfer1::PluginTensorDesc* in, int nbInput, const nvinfer1::PluginTensorDesc* out, int nbOutput)
+{
+    assert(in && nbInput == 1);
+    assert(out && nbOutput == 2);
+    assert(in[0].type == out[0].type && out[1].type == nvinfer1::DataType::kINT32);
+
+    mDataType = in[0].type;
+    mRowCount = in[0].dims.d[0];
+    mRowSize = in[0].dims.d[1];
+}
+
+//! The logits and the likelihoods share kFLOAT or kHALF, the indices are kINT32, all kLINEAR.
+bool SoftmaxTopKPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) const
+{
+    assert(nbInputs == 1 && nbOutputs == 2 && pos < nbInputs + nbOutputs);
+    if (inOut[pos].format != nvinfer1::TensorFormat::kLINEAR)
+        return false;
+    if (pos == 2)
+        return inOut[pos].type == nvinfer1::DataType::kINT32;
+    if (pos == 0)
+        return inOut[pos].type == nvinfer1::DataType::kFLOAT || inOut[pos].type == nvinfer1::DataType::kHALF;
+    return inOut[pos].type == inOut[0].type;
+}
+
+nvinfer1::DataType SoftmaxTopKPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+{
+    assert(index < 2 && inputTypes && nbInputs == 1);
+    return index == 0 ? inputTypes[0] : nvinfer1::DataType::kINT32;
+}
+
+const char* SoftmaxTopKPlugin::getPluginType() const
+{
+    return kSoftmaxTopKPluginType;
+}
+
+const char* SoftmaxTopKPlugin::getPluginVersion() const
+{
+    return kSoftmaxTopKPluginVersion;
+}
+
+void SoftmaxTopKPlugin::destroy()
+{
+    delete this;
+}
+
+nvinfer1::IPluginV2Ext* SoftmaxTopKPlugin::clone() const
+{
+    return new SoftmaxTopKPlugin(*this);
+}
+
+void SoftmaxTopKPlugin::setPluginNamespace(const char* libNamespace)
+{
+    mNamespace = libNamespace;
+}
+
+const char* SoftmaxTopKPlugin::getPluginNamespace() const
+{
+    return mNamespace.c_str();
+}
+
+bool SoftmaxTopKPlugin::isOutputBroadcastAcrossBatch(
+    int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+{
+    return false;
+}
+
+bool SoftmaxTopKPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+{
+    return false;
+}
+} // namespace nmtSample
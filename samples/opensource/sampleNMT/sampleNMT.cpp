@@ -33,11 +33,14 @@
 #include "NvInfer.h"
 #include "argsParser.h"
 #include "common.h"
+#include "data/asyncDataWriter.h"
 #include "data/benchmarkWriter.h"
 #include "data/bleuScoreWriter.h"
+#include "data/bucketingDataReader.h"
 #include "data/dataReader.h"
 #include "data/dataWriter.h"
 #include "data/limitedSamplesDataReader.h"
+#include "data/reorderingDataWriter.h"
 #include "data/sequenceProperties.h"
 #include "data/textReader.h"
 #include "data/textWriter.h"
@@ -51,7 +54,9 @@
 #include "model/contextNMT.h"
 #include "model/debugUtil.h"
 #include "model/decoder.h"
+#include "model/deviceBeamSearchPolicy.h"
 #include "model/embedder.h"
+#include "model/fusedAlignmentContext.h"
 #include "model/encoder.h"
 #include "model/likelihood.h"
 #include "model/lstmDecoder.h"
@@ -74,6 +79,7 @@ int gBeamWidth = 5;
 int gMaxInputSequenceLength = 150;
 int gMaxOutputSequenceLength = -1;
 int gMaxInferenceSamples = -1;
+int gBucketWindow = 0;
 std::string gDataWriterStr = "bleu";
 std::string gOutputTextFileName("translation_output.txt");
 int gMaxWorkspaceSize = 256_MiB;
@@ -83,6 +89,11 @@ bool gAggregateProfiling = false;
 bool gFp16 = false;
 bool gVerbose = false;
 bool gInt8 = false;
+bool gHostBeamSearch = false;
+bool gContinuousBatching = false;
+bool gPipelineEncoder = false;
+bool gFusedContext = false;
+bool gFusedSoftmaxTopK = false;
 int gUseDLACore{-1};
 int gPadMultiple = 1;
 
@@ -122,21 +133,25 @@ nmtSample::DataReader::ptr getDataReader()
     auto vocabulary = std::make_shared<nmtSample::Vocabulary>();
     *vocabInput >> *vocabulary;
 
-    auto reader = std::make_shared<nmtSample::TextReader>(textInput, vocabulary);
+    nmtSample::DataReader::ptr reader = std::make_shared<nmtSample::TextReader>(textInput, vocabulary);
 
     if (gMaxInferenceSamples >= 0)
-        return std::make_shared<nmtSample::LimitedSamplesDataReader>(gMaxInferenceSamples, reader);
-    else
-        return reader;
+        reader = std::make_shared<nmtSample::LimitedSamplesDataReader>(gMaxInferenceSamples, reader);
+    if (gBucketWindow > 0)
+        reader = std::make_shared<nmtSample::BucketingDataReader>(gBucketWindow, reader);
+    return reader;
 }
 
+//! The weights of the components marked half are converted to FP16 with --fp16, and their layers run in FP16
 template <typename Component>
-std::shared_ptr<Component> buildNMTComponentFromWeightsFile(const std::string& filename)
+std::shared_ptr<Component> buildNMTComponentFromWeightsFile(const std::string& filename, bool half = false)
 {
-    auto weights = std::make_shared<nmtSample::ComponentWeights>();
-    std::ifstream input(locateNMTFile(filename), std::ios::binary);
-    assert(input.good());
-    input >> *weights;
+    // The weights stay in the mapping of the file, the builder reads them from there
+    auto weights = nmtSample::ComponentWeights::map(locateNMTFile(filename));
+    if (half && gFp16)
+    {
+        weights->convertToHalf();
+    }
 
     return std::make_shared<Component>(weights);
 }
@@ -153,12 +168,12 @@ nmtSample::Embedder::ptr getOutputEmbedder()
 
 nmtSample::Encoder::ptr getEncoder()
 {
-    return buildNMTComponentFromWeightsFile<nmtSample::LSTMEncoder>(gEncRnnFileName);
+    return buildNMTComponentFromWeightsFile<nmtSample::LSTMEncoder>(gEncRnnFileName, true);
 }
 
 nmtSample::Alignment::ptr getAlignment()
 {
-    return buildNMTComponentFromWeightsFile<nmtSample::MultiplicativeAlignment>(gDecMemFileName);
+    return buildNMTComponentFromWeightsFile<nmtSample::MultiplicativeAlignment>(gDecMemFileName, true);
 }
 
 nmtSample::Context::ptr getContext()
@@ -166,30 +181,54 @@ nmtSample::Context::ptr getContext()
     return std::make_shared<nmtSample::Context>();
 }
 
+nmtSample::FusedAlignmentContext::ptr getFusedAlignmentContext()
+{
+    if (gFusedContext)
+        return std::make_shared<nmtSample::FusedAlignmentContext>();
+    return nmtSample::FusedAlignmentContext::ptr();
+}
+
 nmtSample::Decoder::ptr getDecoder()
 {
-    return buildNMTComponentFromWeightsFile<nmtSample::LSTMDecoder>(gDecRnnFileName);
+    return buildNMTComponentFromWeightsFile<nmtSample::LSTMDecoder>(gDecRnnFileName, true);
 }
 
 nmtSample::Attention::ptr getAttention()
 {
-    return buildNMTComponentFromWeightsFile<nmtSample::SLPAttention>(gDecAttFileName);
+    return buildNMTComponentFromWeightsFile<nmtSample::SLPAttention>(gDecAttFileName, true);
 }
 
 nmtSample::Projection::ptr getProjection()
 {
-    return buildNMTComponentFromWeightsFile<nmtSample::SLPProjection>(gDecProjFileName);
+    return buildNMTComponentFromWeightsFile<nmtSample::SLPProjection>(gDecProjFileName, true);
 }
 
 nmtSample::Likelihood::ptr getLikelihood()
 {
-    return std::make_shared<nmtSample::SoftmaxLikelihood>();
+    return std::make_shared<nmtSample::SoftmaxLikelihood>(gFusedSoftmaxTopK);
 }
 
-nmtSample::BeamSearchPolicy::ptr getSearchPolicy(
-    int endSequenceId, nmtSample::LikelihoodCombinationOperator::ptr likelihoodCombinationOperator)
+// Limit output sequences length to input_sequence_length * 2
+int getMaxOutputSequenceLength(int inputSequenceLength)
 {
-    return std::make_shared<nmtSample::BeamSearchPolicy>(endSequenceId, likelihoodCombinationOperator, gBeamWidth);
+    int r = inputSequenceLength * 2;
+    if (gMaxOutputSequenceLength >= 0)
+        r = std::min(r, gMaxOutputSequenceLength);
+    return r;
+}
+
+nmtSample::BeamSearchPolicy::ptr getSearchPolicy(int endSequenceId,
+    nmtSample::LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, cudaStream_t stream)
+{
+    if (gHostBeamSearch || gContinuousBatching)
+        return std::make_shared<nmtSample::BeamSearchPolicy>(endSequenceId, likelihoodCombinationOperator, gBeamWidth);
+
+    // Output sequences are at most twice as long as the input ones
+    int maxOutputSequenceLength = gMaxInputSequenceLength * 2;
+    if (gMaxOutputSequenceLength >= 0)
+        maxOutputSequenceLength = std::min(maxOutputSequenceLength, gMaxOutputSequenceLength);
+    return std::make_shared<nmtSample::DeviceBeamSearchPolicy>(endSequenceId, likelihoodCombinationOperator,
+        gBeamWidth, gMaxBatchSize, maxOutputSequenceLength, stream);
 }
 
 nmtSample::DataWriter::ptr getDataWriter()
@@ -286,6 +325,10 @@ void printUsage()
         "  --max_inference_samples=<N>          Maximum sample count to run inference for, negative values indicates "
         "no limit is set (default = %d)\n",
         gMaxInferenceSamples);
+    printf(
+        "  --bucket_window=<N>                  Sort each window of N sentences by length into batches, the output is "
+        "written in the input order (default = %d, disabled)\n",
+        gBucketWindow);
     printf("  --verbose                            Output verbose-level messages by TensorRT\n");
     printf("  --max_workspace_size=<N>             Maximum workspace size (default = %d)\n", gMaxWorkspaceSize);
     printf(
@@ -296,8 +339,24 @@ void printUsage()
         "  --profile                            Profile TensorRT execution layer by layer. Use benchmark data_writer "
         "when profiling on, disregard benchmark results\n");
     printf("  --aggregate_profile                  Merge profiles from multiple TensorRT engines\n");
-    printf("  --fp16                               Switch on fp16 math\n");
+    printf("  --fp16                               Switch on fp16 math, with the weights of the components converted "
+           "to fp16 and the beam likelihoods in fp32\n");
     printf("  --int8                               Switch on int8 math\n");
+    printf(
+        "  --host_beam_search                   Run the beam search on the host, copying the generator outputs back "
+        "at every timestep\n");
+    printf(
+        "  --continuous_batching                Start translating new sentences in the slots of finished ones between "
+        "timesteps, implies host_beam_search\n");
+    printf(
+        "  --pipeline_encoder                   Encode the next batch on a second stream while the current one "
+        "decodes, and write the output on a worker thread\n");
+    printf(
+        "  --fused_context                      Compute the alignment scores, the ragged softmax and the context in a "
+        "single plugin layer\n");
+    printf(
+        "  --fused_softmax_topk                 Select the top options of each ray in the same pass as the softmax, "
+        "without writing the likelihoods of the whole vocabulary\n");
     printf(
         "  --useDLACore=N                       Specify a DLA engine for layers that support DLA. Value can range from "
         "0 to n-1, where n is the number of DLA engines on the platform.\n");
@@ -332,6 +391,8 @@ bool parseNMTArgs(samplesCommon::Args& args, int argc, char* argv[])
             continue;
         if (parseInt(argv[j], "max_inference_samples", gMaxInferenceSamples))
             continue;
+        if (parseInt(argv[j], "bucket_window", gBucketWindow))
+            continue;
         if (parseBool(argv[j], "verbose", gVerbose))
             continue;
         if (parseInt(argv[j], "max_workspace_size", gMaxWorkspaceSize))
@@ -346,6 +407,16 @@ bool parseNMTArgs(samplesCommon::Args& args, int argc, char* argv[])
             continue;
         if (parseBool(argv[j], "int8", gInt8))
             continue;
+        if (parseBool(argv[j], "host_beam_search", gHostBeamSearch))
+            continue;
+        if (parseBool(argv[j], "continuous_batching", gContinuousBatching))
+            continue;
+        if (parseBool(argv[j], "pipeline_encoder", gPipelineEncoder))
+            continue;
+        if (parseBool(argv[j], "fused_context", gFusedContext))
+            continue;
+        if (parseBool(argv[j], "fused_softmax_topk", gFusedSoftmaxTopK))
+            continue;
         if (parseInt(argv[j], "useDLACore", gUseDLACore))
             continue;
         if (parseInt(argv[j], "padMultiple", gPadMultiple))
@@ -373,6 +444,7 @@ nvinfer1::ICudaEngine* getEncoderEngine(
     if (gFp16)
     {
         encoderConfig->setFlag(BuilderFlag::kFP16);
+        encoderConfig->setFlag(BuilderFlag::kSTRICT_TYPES);
     }
     if (gInt8)
     {
@@ -509,7 +581,8 @@ nvinfer1::ICudaEngine* getEncoderEngine(
 }
 
 nvinfer1::ICudaEngine* getGeneratorEngine(nmtSample::Embedder::ptr outputEmbedder, nmtSample::Decoder::ptr decoder,
-    nmtSample::Alignment::ptr alignment, nmtSample::Context::ptr context, nmtSample::Attention::ptr attention,
+    nmtSample::Alignment::ptr alignment, nmtSample::Context::ptr context,
+    nmtSample::FusedAlignmentContext::ptr fusedAlignmentContext, nmtSample::Attention::ptr attention,
     nmtSample::Projection::ptr projection, nmtSample::Likelihood::ptr likelihood)
 {
     nvinfer1::IBuilder* generatorBuilder = nvinfer1::createInferBuilder(gLogger.getTRTLogger());
@@ -520,6 +593,7 @@ nvinfer1::ICudaEngine* getGeneratorEngine(nmtSample::Embedder::ptr outputEmbedde
     if (gFp16)
     {
         generatorConfig->setFlag(BuilderFlag::kFP16);
+        generatorConfig->setFlag(BuilderFlag::kSTRICT_TYPES);
     }
     if (gInt8)
     {
@@ -625,16 +699,26 @@ nvinfer1::ICudaEngine* getGeneratorEngine(nmtSample::Embedder::ptr outputEmbedde
         decoderOutputStatesTensors[i]->setType(gFp16 ? nvinfer1::DataType::kHALF : nvinfer1::DataType::kFLOAT);
     }
 
-    // Add alignment scores
-    nvinfer1::ITensor* alignmentScoresTensor;
-    alignment->addToModel(generatorNetwork,
-        (alignment->getAttentionKeySize() > 0) ? attentionKeysTensor : memoryStatesTensor, outputDecoderDataTensor,
-        &alignmentScoresTensor);
-
-    // Add context
     nvinfer1::ITensor* contextTensor;
-    context->addToModel(generatorNetwork, actualInputSequenceLengthsReplicatedTensor, memoryStatesTensor,
-        alignmentScoresTensor, &contextTensor);
+    if (fusedAlignmentContext)
+    {
+        // Add alignment scores and context in one layer
+        fusedAlignmentContext->addToModel(generatorNetwork, actualInputSequenceLengthsReplicatedTensor,
+            memoryStatesTensor, (alignment->getAttentionKeySize() > 0) ? attentionKeysTensor : memoryStatesTensor,
+            outputDecoderDataTensor, &contextTensor);
+    }
+    else
+    {
+        // Add alignment scores
+        nvinfer1::ITensor* alignmentScoresTensor;
+        alignment->addToModel(generatorNetwork,
+            (alignment->getAttentionKeySize() > 0) ? attentionKeysTensor : memoryStatesTensor,
+            outputDecoderDataTensor, &alignmentScoresTensor);
+
+        // Add context
+        context->addToModel(generatorNetwork, actualInputSequenceLengthsReplicatedTensor, memoryStatesTensor,
+            alignmentScoresTensor, &contextTensor);
+    }
 
     // Add attention
     nvinfer1::ITensor* attentionTensor;
@@ -692,6 +776,7 @@ nvinfer1::ICudaEngine* getGeneratorShuffleEngine(
     if (gFp16)
     {
         shuffleConfig->setFlag(BuilderFlag::kFP16);
+        shuffleConfig->setFlag(BuilderFlag::kSTRICT_TYPES);
     }
     if (gInt8)
     {
@@ -836,12 +921,20 @@ int main(int argc, char** argv)
     auto decoder = getDecoder();
     auto alignment = getAlignment();
     auto context = getContext();
+    auto fusedAlignmentContext = getFusedAlignmentContext();
     auto attention = getAttention();
     auto projection = getProjection();
     auto likelihood = getLikelihood();
     auto searchPolicy
-        = getSearchPolicy(outputSequenceProperties->getEndSequenceId(), likelihood->getLikelihoodCombinationOperator());
+        = getSearchPolicy(outputSequenceProperties->getEndSequenceId(), likelihood->getLikelihoodCombinationOperator(),
+            stream);
     auto dataWriter = getDataWriter();
+    // Detokenization and scoring run on a worker thread when pipelining
+    nmtSample::DataWriter::ptr resultWriter
+        = gPipelineEncoder ? std::make_shared<nmtSample::AsyncDataWriter>(dataWriter) : dataWriter;
+    // Outputs of bucketed sentences are put back in the input order on the inference thread, before the worker
+    if (auto bucketingReader = std::dynamic_pointer_cast<nmtSample::BucketingDataReader>(dataReader))
+        resultWriter = std::make_shared<nmtSample::ReorderingDataWriter>(resultWriter, bucketingReader);
 
     if (gPrintComponentInfo)
     {
@@ -852,7 +945,8 @@ int main(int argc, char** argv)
         gLogInfo << "- Encoder: " << encoder->getInfo() << std::endl;
         gLogInfo << "- Decoder: " << decoder->getInfo() << std::endl;
         gLogInfo << "- Alignment: " << alignment->getInfo() << std::endl;
-        gLogInfo << "- Context: " << context->getInfo() << std::endl;
+        gLogInfo << "- Context: " << (fusedAlignmentContext ? fusedAlignmentContext->getInfo() : context->getInfo())
+                 << std::endl;
         gLogInfo << "- Attention: " << attention->getInfo() << std::endl;
         gLogInfo << "- Projection: " << projection->getInfo() << std::endl;
         gLogInfo << "- Likelihood: " << likelihood->getInfo() << std::endl;
@@ -990,7 +1084,8 @@ int main(int argc, char** argv)
     // Create TensorRT engines
     nvinfer1::ICudaEngine* encoderEngine = getEncoderEngine(inputEmbedder, encoder, alignment);
     nvinfer1::ICudaEngine* generatorEngine
-        = getGeneratorEngine(outputEmbedder, decoder, alignment, context, attention, projection, likelihood);
+        = getGeneratorEngine(outputEmbedder, decoder, alignment, context, fusedAlignmentContext, attention, projection,
+            likelihood);
     nvinfer1::ICudaEngine* generatorShuffleEngine
         = getGeneratorShuffleEngine(decoder->getStateSizes(), attention->getAttentionSize());
 
@@ -1098,6 +1193,83 @@ int main(int argc, char** argv)
     }
     processBindings(generatorShuffleBindings, genShuffleBindingMap, generatorShuffleEngine);
 
+    // With pipelining the encoder writes the next batch while the current one decodes, so the encoder outputs read by
+    // the generator and the host buffers of a batch come once per stage
+    const int stageCount = gPipelineEncoder ? 2 : 1;
+    std::vector<nmtSample::PinnedHostBuffer<int>::ptr> stageInputHostBuffers{inputHostBuffer};
+    std::vector<nmtSample::PinnedHostBuffer<int>::ptr> stageInputSequenceLengthsHostBuffers{
+        inputSequenceLengthsHostBuffer};
+    std::vector<std::vector<void*>> stageEncoderBindings{encoderBindings};
+    std::vector<std::vector<void*>> stageGeneratorBindings{generatorBindings};
+    std::vector<std::vector<void*>> stageGeneratorBindingsFirstStep{generatorBindingsFirstStep};
+    std::vector<nmtSample::DeviceBuffer<int>::ptr> stageIntDeviceBuffers;
+    std::vector<nmtSample::DeviceBuffer<float>::ptr> stageFloatDeviceBuffers;
+    for (int stage = 0; gPipelineEncoder && stage < stageCount; ++stage)
+    {
+        std::unordered_map<std::string, void*> encStageBindingMap;
+        std::unordered_map<std::string, void*> genStageBindingMap;
+        if (stage > 0)
+        {
+            stageInputHostBuffers.push_back(
+                std::make_shared<nmtSample::PinnedHostBuffer<int>>(gMaxBatchSize * gMaxInputSequenceLength));
+            stageInputSequenceLengthsHostBuffers.push_back(
+                std::make_shared<nmtSample::PinnedHostBuffer<int>>(gMaxBatchSize));
+
+            stageIntDeviceBuffers.push_back(std::make_shared<nmtSample::DeviceBuffer<int>>(gMaxBatchSize * gBeamWidth));
+            encStageBindingMap["actual_input_sequence_lengths_replicated"] = *stageIntDeviceBuffers.back();
+            genStageBindingMap["actual_input_sequence_lengths_replicated"] = *stageIntDeviceBuffers.back();
+            stageFloatDeviceBuffers.push_back(std::make_shared<nmtSample::DeviceBuffer<float>>(
+                gMaxBatchSize * gMaxInputSequenceLength * encoder->getMemoryStatesSize()));
+            encStageBindingMap["memory_states"] = *stageFloatDeviceBuffers.back();
+            genStageBindingMap["memory_states"] = *stageFloatDeviceBuffers.back();
+            if (alignment->getAttentionKeySize() > 0)
+            {
+                stageFloatDeviceBuffers.push_back(std::make_shared<nmtSample::DeviceBuffer<float>>(
+                    gMaxBatchSize * gMaxInputSequenceLength * alignment->getAttentionKeySize()));
+                encStageBindingMap["attention_keys"] = *stageFloatDeviceBuffers.back();
+                genStageBindingMap["attention_keys"] = *stageFloatDeviceBuffers.back();
+            }
+
+            stageEncoderBindings.push_back(encoderBindings);
+            stageGeneratorBindings.push_back(generatorBindings);
+            stageGeneratorBindingsFirstStep.push_back(generatorBindingsFirstStep);
+        }
+
+        // The generator keeps its decoder states across timesteps, the encoder writes the initial ones aside
+        std::unordered_map<std::string, void*> genStageBindingFirstStepMap = genStageBindingMap;
+        if (gInitializeDecoderFromEncoderHiddenStates)
+        {
+            for (int i = 0; i < static_cast<int>(stateSizes.size()); ++i)
+            {
+                stageFloatDeviceBuffers.push_back(std::make_shared<nmtSample::DeviceBuffer<float>>(
+                    gMaxBatchSize * gBeamWidth * nmtSample::getVolume(stateSizes[i])));
+                std::stringstream ss;
+                ss << "input_decoder_states_" << i;
+                encStageBindingMap[ss.str()] = *stageFloatDeviceBuffers.back();
+                genStageBindingFirstStepMap[ss.str()] = *stageFloatDeviceBuffers.back();
+            }
+        }
+        processBindings(stageEncoderBindings[stage], encStageBindingMap, encoderEngine);
+        processBindings(stageGeneratorBindings[stage], genStageBindingMap, generatorEngine);
+        processBindings(stageGeneratorBindingsFirstStep[stage], genStageBindingFirstStepMap, generatorEngine);
+    }
+
+    // The encoder of the next batch waits for the decoding that last used its stage, and the other way round
+    cudaStream_t encoderStream = stream;
+    if (gPipelineEncoder)
+        CUDA_CHECK(cudaStreamCreate(&encoderStream));
+    std::vector<cudaEvent_t> encodeStartEvents(stageCount);
+    std::vector<cudaEvent_t> encodeEndEvents(stageCount);
+    std::vector<cudaEvent_t> decodeStartEvents(stageCount);
+    std::vector<cudaEvent_t> decodeEndEvents(stageCount);
+    for (int stage = 0; stage < stageCount; ++stage)
+    {
+        CUDA_CHECK(cudaEventCreate(&encodeStartEvents[stage]));
+        CUDA_CHECK(cudaEventCreate(&encodeEndEvents[stage]));
+        CUDA_CHECK(cudaEventCreate(&decodeStartEvents[stage]));
+        CUDA_CHECK(cudaEventCreate(&decodeEndEvents[stage]));
+    }
+
     // Create Tensor RT contexts
     nvinfer1::IExecutionContext* encoderContext = encoderEngine->createExecutionContext();
     nvinfer1::IExecutionContext* generatorContext = generatorEngine->createExecutionContext();
@@ -1117,7 +1289,7 @@ int main(int argc, char** argv)
 
     CUDA_CHECK(cudaStreamSynchronize(stream));
 
-    dataWriter->initialize();
+    resultWriter->initialize();
 
     std::vector<int> outputHostBuffer;
     auto startDataRead = std::chrono::high_resolution_clock::now();
@@ -1130,29 +1302,239 @@ int main(int argc, char** argv)
     // Outer loop over batches of samples
     auto startLatency = std::chrono::high_resolution_clock::now();
     int batchCount = 0;
-    while (inputSamplesRead > 0)
+    if (gContinuousBatching)
     {
-        ++batchCount;
+        // The encoder writes new sentences to staging buffers, they are then copied to the slots they are decoded in
+        const size_t elementSize = gFp16 ? sizeof(float) / 2 : sizeof(float);
+        const size_t memoryStatesSlotSize = gMaxInputSequenceLength * encoder->getMemoryStatesSize() * elementSize;
+        const size_t attentionKeysSlotSize = gMaxInputSequenceLength * alignment->getAttentionKeySize() * elementSize;
+        const size_t attentionSlotSize = gBeamWidth * attention->getAttentionSize() * elementSize;
+        auto memoryStatesStagingDeviceBuffer = std::make_shared<nmtSample::DeviceBuffer<float>>(
+            gMaxBatchSize * gMaxInputSequenceLength * encoder->getMemoryStatesSize());
+        auto attentionKeysStagingDeviceBuffer = std::make_shared<nmtSample::DeviceBuffer<float>>(
+            gMaxBatchSize * gMaxInputSequenceLength * alignment->getAttentionKeySize());
+        auto inputSequenceLengthsReplicatedStagingDeviceBuffer
+            = std::make_shared<nmtSample::DeviceBuffer<int>>(gMaxBatchSize * gBeamWidth);
+        std::vector<nmtSample::DeviceBuffer<float>::ptr> inputDecoderStatesStagingDeviceBuffers;
+        for (auto stateSize : stateSizes)
+            inputDecoderStatesStagingDeviceBuffers.push_back(std::make_shared<nmtSample::DeviceBuffer<float>>(
+                gMaxBatchSize * gBeamWidth * nmtSample::getVolume(stateSize)));
+
+        std::vector<void*> encoderStagingBindings(encoderEngine->getNbBindings());
+        std::unordered_map<std::string, void*> encStagingBindingMap = encBindingMap;
+        encStagingBindingMap["memory_states"] = *memoryStatesStagingDeviceBuffer;
+        if (alignment->getAttentionKeySize() > 0)
+        {
+            encStagingBindingMap["attention_keys"] = *attentionKeysStagingDeviceBuffer;
+        }
+        encStagingBindingMap["actual_input_sequence_lengths_replicated"]
+            = *inputSequenceLengthsReplicatedStagingDeviceBuffer;
+        if (gInitializeDecoderFromEncoderHiddenStates)
+        {
+            for (int i = 0; i < static_cast<int>(stateSizes.size()); ++i)
+            {
+                std::stringstream ss;
+                ss << "input_decoder_states_" << i;
+                encStagingBindingMap[ss.str()] = *inputDecoderStatesStagingDeviceBuffers[i];
+            }
+        }
+        processBindings(encoderStagingBindings, encStagingBindingMap, encoderEngine);
+        // Slots are addressed in bytes, the buffers hold halves in FP16 mode
+        auto bytes = [](nmtSample::DeviceBuffer<float>& buffer) { return reinterpret_cast<char*>((float*) buffer); };
+
+        // The shuffle engine must not gather out of the beams before every used slot has been through a timestep
+        CUDA_CHECK(cudaMemsetAsync(*sourceRayIndicesDeviceBuffer, 0, gMaxBatchSize * gBeamWidth * sizeof(int), stream));
+
+        const int maxOutputSequenceLength = getMaxOutputSequenceLength(gMaxInputSequenceLength);
+        std::vector<int> outputSequence(maxOutputSequenceLength);
+        std::vector<int> slotSentenceIds(gMaxBatchSize, -1);
+        std::vector<int> slotInputSequenceLengths(gMaxBatchSize);
+        std::map<int, std::pair<std::vector<int>, int>> finishedSentences;
+        int nextSentenceId = 0;
+        int nextSentenceToWrite = 0;
+        int nextInputPosition = 0;
+        long long usedSlotTimesteps = 0;
+        int timestepCount = 0;
+
+        searchPolicy->initializeSlots(gMaxBatchSize);
+        while (true)
+        {
+            // Finished sentences free their slots, and are written in the order they were read
+            for (int slotId = 0; slotId < gMaxBatchSize; ++slotId)
+            {
+                if (slotSentenceIds[slotId] < 0 || !searchPolicy->isSampleFinished(slotId))
+                    continue;
+                int outputSequenceLength;
+                searchPolicy->readSampleResult(
+                    slotId, maxOutputSequenceLength, &outputSequence[0], &outputSequenceLength);
+                finishedSentences[slotSentenceIds[slotId]] = std::make_pair(
+                    std::vector<int>(outputSequence.begin(),
+                        outputSequence.begin() + std::min(outputSequenceLength, maxOutputSequenceLength)),
+                    slotInputSequenceLengths[slotId]);
+                slotSentenceIds[slotId] = -1;
+            }
+            for (auto it = finishedSentences.begin();
+                 it != finishedSentences.end() && it->first == nextSentenceToWrite; it = finishedSentences.erase(it))
+            {
+                resultWriter->write(
+                    it->second.first.data(), static_cast<int>(it->second.first.size()), it->second.second);
+                ++nextSentenceToWrite;
+            }
+
+            // Encode new sentences into the free slots
+            std::vector<int> newSlotIds;
+            for (int slotId = 0; slotId < gMaxBatchSize; ++slotId)
+            {
+                if (slotSentenceIds[slotId] >= 0)
+                    continue;
+                if (nextInputPosition == inputSamplesRead)
+                {
+                    if (inputSamplesRead == 0)
+                        break;
+                    inputSamplesRead = dataReader->read(gMaxBatchSize, gMaxInputSequenceLength,
+                        *inputOriginalHostBuffer, *inputOriginalSequenceLengthsHostBuffer);
+                    nextInputPosition = 0;
+                    if (inputSamplesRead == 0)
+                        break;
+                }
+                const int position = static_cast<int>(newSlotIds.size());
+                std::copy_n(((const int*) *inputOriginalHostBuffer) + nextInputPosition * gMaxInputSequenceLength,
+                    gMaxInputSequenceLength, ((int*) *inputHostBuffer) + position * gMaxInputSequenceLength);
+                const int inputSequenceLength
+                    = ((const int*) *inputOriginalSequenceLengthsHostBuffer)[nextInputPosition];
+                ((int*) *inputSequenceLengthsHostBuffer)[position] = inputSequenceLength;
+                ++nextInputPosition;
+
+                slotSentenceIds[slotId] = nextSentenceId++;
+                slotInputSequenceLengths[slotId] = inputSequenceLength;
+                searchPolicy->startSample(slotId, getMaxOutputSequenceLength(inputSequenceLength));
+                newSlotIds.push_back(slotId);
+            }
+            if (!newSlotIds.empty())
+            {
+                const int newCount = static_cast<int>(newSlotIds.size());
+                CUDA_CHECK(cudaMemcpyAsync(*inputEncoderDeviceBuffer, *inputHostBuffer,
+                    newCount * gMaxInputSequenceLength * sizeof(int), cudaMemcpyHostToDevice, stream));
+                CUDA_CHECK(cudaMemcpyAsync(*inputSequenceLengthsDeviceBuffer, *inputSequenceLengthsHostBuffer,
+                    newCount * sizeof(int), cudaMemcpyHostToDevice, stream));
+                encoderContext->enqueue(newCount, &encoderStagingBindings[0], stream, nullptr);
+                for (int position = 0; position < newCount; ++position)
+                {
+                    const int slotId = newSlotIds[position];
+                    CUDA_CHECK(cudaMemcpyAsync(bytes(*memoryStatesDeviceBuffer) + slotId * memoryStatesSlotSize,
+                        bytes(*memoryStatesStagingDeviceBuffer) + position * memoryStatesSlotSize,
+                        memoryStatesSlotSize, cudaMemcpyDeviceToDevice, stream));
+                    if (alignment->getAttentionKeySize() > 0)
+                    {
+                        CUDA_CHECK(cudaMemcpyAsync(
+                            bytes(*attentionKeysDeviceBuffer) + slotId * attentionKeysSlotSize,
+                            bytes(*attentionKeysStagingDeviceBuffer) + position * attentionKeysSlotSize,
+                            attentionKeysSlotSize, cudaMemcpyDeviceToDevice, stream));
+                    }
+                    CUDA_CHECK(cudaMemcpyAsync((int*) *inputSequenceLengthsReplicatedDeviceBuffer + slotId * gBeamWidth,
+                        (int*) *inputSequenceLengthsReplicatedStagingDeviceBuffer + position * gBeamWidth,
+                        gBeamWidth * sizeof(int), cudaMemcpyDeviceToDevice, stream));
+                }
+            }
+
+            int validSampleCount = 0;
+            for (int slotId = 0; slotId < gMaxBatchSize; ++slotId)
+                if (slotSentenceIds[slotId] >= 0)
+                    validSampleCount = slotId + 1;
+            if (validSampleCount == 0)
+                break;
 
+            if (timestepCount > 0)
+                generatorShuffleContext->enqueue(validSampleCount, &generatorShuffleBindings[0], stream, nullptr);
+
+            // New slots start from the same inputs as the first timestep of a batch
+            for (int position = 0; position < static_cast<int>(newSlotIds.size()); ++position)
+            {
+                const int slotId = newSlotIds[position];
+                for (int i = 0; i < static_cast<int>(stateSizes.size()); ++i)
+                {
+                    const size_t statesSlotSize = gBeamWidth * nmtSample::getVolume(stateSizes[i]) * elementSize;
+                    char* slotStates = bytes(*inputDecoderStatesDeviceBuffers[i]) + slotId * statesSlotSize;
+                    if (gInitializeDecoderFromEncoderHiddenStates)
+                    {
+                        CUDA_CHECK(cudaMemcpyAsync(slotStates,
+                            bytes(*inputDecoderStatesStagingDeviceBuffers[i]) + position * statesSlotSize,
+                            statesSlotSize, cudaMemcpyDeviceToDevice, stream));
+                    }
+                    else
+                    {
+                        CUDA_CHECK(cudaMemsetAsync(slotStates, 0, statesSlotSize, stream));
+                    }
+                }
+                if (gFeedAttentionToInput)
+                {
+                    CUDA_CHECK(cudaMemsetAsync(
+                        bytes(*inputAttentionDeviceBuffer) + slotId * attentionSlotSize, 0, attentionSlotSize, stream));
+                }
+                CUDA_CHECK(cudaMemcpyAsync((int*) *inputDecoderDeviceBuffer + slotId * gBeamWidth,
+                    (int*) *startSeqInputDecoderDeviceBuffer + slotId * gBeamWidth, gBeamWidth * sizeof(int),
+                    cudaMemcpyDeviceToDevice, stream));
+                CUDA_CHECK(cudaMemcpyAsync((float*) *inputLikelihoodsDeviceBuffer + slotId * gBeamWidth,
+                    (float*) *initialInputLikelihoodsDeviceBuffer + slotId * gBeamWidth, gBeamWidth * sizeof(float),
+                    cudaMemcpyDeviceToDevice, stream));
+            }
+
+            generatorContext->enqueue(validSampleCount, &generatorBindings[0], stream, nullptr);
+
+            CUDA_CHECK(cudaMemcpyAsync(*outputCombinedLikelihoodHostBuffer, *outputCombinedLikelihoodDeviceBuffer,
+                validSampleCount * gBeamWidth * sizeof(float), cudaMemcpyDeviceToHost, stream));
+            CUDA_CHECK(cudaMemcpyAsync(*outputVocabularyIndicesHostBuffer, *inputDecoderDeviceBuffer,
+                validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyDeviceToHost, stream));
+            CUDA_CHECK(cudaMemcpyAsync(*outputRayOptionIndicesHostBuffer, *outputRayOptionIndicesDeviceBuffer,
+                validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyDeviceToHost, stream));
+            CUDA_CHECK(cudaStreamSynchronize(stream));
+
+            searchPolicy->processTimestep(validSampleCount, *outputCombinedLikelihoodHostBuffer,
+                *outputVocabularyIndicesHostBuffer, *outputRayOptionIndicesHostBuffer, *sourceRayIndicesHostBuffer,
+                *sourceLikelihoodsHostBuffer);
+
+            CUDA_CHECK(cudaMemcpyAsync(*sourceRayIndicesDeviceBuffer, *sourceRayIndicesHostBuffer,
+                validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyHostToDevice, stream));
+            CUDA_CHECK(cudaMemcpyAsync(*inputLikelihoodsDeviceBuffer, *sourceLikelihoodsHostBuffer,
+                validSampleCount * gBeamWidth * sizeof(float), cudaMemcpyHostToDevice, stream));
+
+            usedSlotTimesteps += std::count_if(
+                slotSentenceIds.begin(), slotSentenceIds.end(), [](int sentenceId) { return sentenceId >= 0; });
+            ++timestepCount;
+        }
+        CUDA_CHECK(cudaStreamSynchronize(stream));
+
+        // Report latencies per gMaxBatchSize sentences, as for batches
+        batchCount = (nextSentenceId + gMaxBatchSize - 1) / gMaxBatchSize;
+        const float occupancy
+            = timestepCount ? 100.0F * usedSlotTimesteps / (static_cast<float>(timestepCount) * gMaxBatchSize) : 0.0F;
+        gLogInfo << "Continuous batching: " << nextSentenceId << " sentences in " << timestepCount
+                 << " timesteps, average slot occupancy " << occupancy << "%" << std::endl;
+    }
+    std::future<int> nextInputSamplesReadFuture;
+    std::vector<std::vector<int>> stageSamplePositions(stageCount);
+    auto encodeBatch = [&](int stage, int sampleCount) {
         // Sort input sequences in the batch in the order of decreasing length
         // The idea is that shorter input sequences gets translated faster so we can reduce batch size quickly for the
         // generator
         auto startBatchSort = std::chrono::high_resolution_clock::now();
-        std::vector<int> samplePositions(inputSamplesRead);
+        std::vector<int>& samplePositions = stageSamplePositions[stage];
+        samplePositions.resize(sampleCount);
         {
-            std::vector<std::pair<int, int>> sequenceSampleIdAndLength(inputSamplesRead);
-            for (int sampleId = 0; sampleId < inputSamplesRead; ++sampleId)
+            std::vector<std::pair<int, int>> sequenceSampleIdAndLength(sampleCount);
+            for (int sampleId = 0; sampleId < sampleCount; ++sampleId)
                 sequenceSampleIdAndLength[sampleId]
                     = std::make_pair(sampleId, ((const int*) *inputOriginalSequenceLengthsHostBuffer)[sampleId]);
             std::sort(sequenceSampleIdAndLength.begin(), sequenceSampleIdAndLength.end(),
                 [](const std::pair<int, int>& a, const std::pair<int, int>& b) -> bool { return a.second > b.second; });
-            for (int position = 0; position < inputSamplesRead; ++position)
+            for (int position = 0; position < sampleCount; ++position)
             {
                 int sampleId = sequenceSampleIdAndLength[position].first;
-                ((int*) *inputSequenceLengthsHostBuffer)[position]
+                ((int*) *stageInputSequenceLengthsHostBuffers[stage])[position]
                     = ((const int*) *inputOriginalSequenceLengthsHostBuffer)[sampleId];
                 std::copy_n(((const int*) *inputOriginalHostBuffer) + sampleId * gMaxInputSequenceLength,
-                    gMaxInputSequenceLength, ((int*) *inputHostBuffer) + position * gMaxInputSequenceLength);
+                    gMaxInputSequenceLength,
+                    ((int*) *stageInputHostBuffers[stage]) + position * gMaxInputSequenceLength);
                 samplePositions[sampleId] = position;
             }
         }
@@ -1161,31 +1543,60 @@ int main(int argc, char** argv)
                 std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startBatchSort)
                     .count());
 
-        CUDA_CHECK(cudaMemcpyAsync(*inputEncoderDeviceBuffer, *inputHostBuffer,
-            inputSamplesRead * gMaxInputSequenceLength * sizeof(int), cudaMemcpyHostToDevice, stream));
-        CUDA_CHECK(cudaMemcpyAsync(*inputSequenceLengthsDeviceBuffer, *inputSequenceLengthsHostBuffer,
-            inputSamplesRead * sizeof(int), cudaMemcpyHostToDevice, stream));
+        CUDA_CHECK(cudaStreamWaitEvent(encoderStream, decodeEndEvents[stage], 0));
+        CUDA_CHECK(cudaEventRecord(encodeStartEvents[stage], encoderStream));
+        CUDA_CHECK(cudaMemcpyAsync(*inputEncoderDeviceBuffer, *stageInputHostBuffers[stage],
+            sampleCount * gMaxInputSequenceLength * sizeof(int), cudaMemcpyHostToDevice, encoderStream));
+        CUDA_CHECK(cudaMemcpyAsync(*inputSequenceLengthsDeviceBuffer, *stageInputSequenceLengthsHostBuffers[stage],
+            sampleCount * sizeof(int), cudaMemcpyHostToDevice, encoderStream));
 
         // Overlap host and device: Read data for the next batch while encode for this one is running
-        std::future<int> nextInputSamplesReadFuture = std::async(std::launch::async, [&]() {
+        nextInputSamplesReadFuture = std::async(std::launch::async, [&]() {
             return dataReader->read(gMaxBatchSize, gMaxInputSequenceLength, *inputOriginalHostBuffer,
                 *inputOriginalSequenceLengthsHostBuffer);
         });
 
-        encoderContext->enqueue(inputSamplesRead, &encoderBindings[0], stream, nullptr);
-
-        // Limit output sequences length to input_sequence_length * 2
-        std::transform((const int*) *inputSequenceLengthsHostBuffer,
-            (const int*) *inputSequenceLengthsHostBuffer + inputSamplesRead, (int*) *maxOutputSequenceLengthsHostBuffer,
-            [](int i) {
-                int r = i * 2;
-                if (gMaxOutputSequenceLength >= 0)
-                    r = std::min(r, gMaxOutputSequenceLength);
-                return r;
-            });
-        searchPolicy->initialize(inputSamplesRead, *maxOutputSequenceLengthsHostBuffer);
+        encoderContext->enqueue(sampleCount, &stageEncoderBindings[stage][0], encoderStream, nullptr);
+        CUDA_CHECK(cudaEventRecord(encodeEndEvents[stage], encoderStream));
+    };
+    auto readNextBatch = [&]() {
+        auto startDataRead = std::chrono::high_resolution_clock::now();
+        int samplesRead = nextInputSamplesReadFuture.get();
+        if (gEnableProfiling)
+            profilers[0].reportLayerTime("Data Read",
+                std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startDataRead)
+                    .count());
+        return samplesRead;
+    };
+
+    float encoderTime = 0.0F;
+    float overlappedEncoderTime = 0.0F;
+    int stage = 0;
+    if (inputSamplesRead > 0)
+        encodeBatch(stage, inputSamplesRead);
+    while (inputSamplesRead > 0)
+    {
+        ++batchCount;
+        const int batchSampleCount = inputSamplesRead;
+        const int nextStage = (stage + 1) % stageCount;
+
+        // Encode the next batch on its own stream while this one decodes
+        if (gPipelineEncoder)
+        {
+            inputSamplesRead = readNextBatch();
+            if (inputSamplesRead > 0)
+                encodeBatch(nextStage, inputSamplesRead);
+        }
+
+        CUDA_CHECK(cudaStreamWaitEvent(stream, encodeEndEvents[stage], 0));
+        CUDA_CHECK(cudaEventRecord(decodeStartEvents[stage], stream));
+
+        const int* inputSequenceLengths = *stageInputSequenceLengthsHostBuffers[stage];
+        std::transform(inputSequenceLengths, inputSequenceLengths + batchSampleCount,
+            (int*) *maxOutputSequenceLengthsHostBuffer, getMaxOutputSequenceLength);
+        searchPolicy->initialize(batchSampleCount, *maxOutputSequenceLengthsHostBuffer);
         int batchMaxOutputSequenceLength = *std::max_element(
-            (int*) *maxOutputSequenceLengthsHostBuffer, (int*) *maxOutputSequenceLengthsHostBuffer + inputSamplesRead);
+            (int*) *maxOutputSequenceLengthsHostBuffer, (int*) *maxOutputSequenceLengthsHostBuffer + batchSampleCount);
         outputHostBuffer.resize(gMaxBatchSize * batchMaxOutputSequenceLength);
 
         // Inner loop over generator timesteps
@@ -1196,73 +1607,103 @@ int main(int argc, char** argv)
             // Generator initialization and beam shuffling
             if (outputTimestep == 0)
             {
-                generatorContext->enqueue(validSampleCount, &generatorBindingsFirstStep[0], stream, nullptr);
+                generatorContext->enqueue(
+                    validSampleCount, &stageGeneratorBindingsFirstStep[stage][0], stream, nullptr);
             }
             else
             {
                 generatorShuffleContext->enqueue(validSampleCount, &generatorShuffleBindings[0], stream, nullptr);
-                generatorContext->enqueue(validSampleCount, &generatorBindings[0], stream, nullptr);
+                generatorContext->enqueue(validSampleCount, &stageGeneratorBindings[stage][0], stream, nullptr);
+            }
+            if (gHostBeamSearch)
+            {
+                CUDA_CHECK(cudaMemcpyAsync(*outputCombinedLikelihoodHostBuffer, *outputCombinedLikelihoodDeviceBuffer,
+                    validSampleCount * gBeamWidth * sizeof(float), cudaMemcpyDeviceToHost, stream));
+                CUDA_CHECK(cudaMemcpyAsync(*outputVocabularyIndicesHostBuffer, *inputDecoderDeviceBuffer,
+                    validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyDeviceToHost, stream));
+                CUDA_CHECK(cudaMemcpyAsync(*outputRayOptionIndicesHostBuffer, *outputRayOptionIndicesDeviceBuffer,
+                    validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyDeviceToHost, stream));
+
+                CUDA_CHECK(cudaStreamSynchronize(stream));
+
+                auto startBeamSearch = std::chrono::high_resolution_clock::now();
+                searchPolicy->processTimestep(validSampleCount, *outputCombinedLikelihoodHostBuffer,
+                    *outputVocabularyIndicesHostBuffer, *outputRayOptionIndicesHostBuffer, *sourceRayIndicesHostBuffer,
+                    *sourceLikelihoodsHostBuffer);
+                if (gEnableProfiling)
+                    profilers[0].reportLayerTime("Beam Search",
+                        std::chrono::duration<float, std::milli>(
+                            std::chrono::high_resolution_clock::now() - startBeamSearch)
+                            .count());
+
+                CUDA_CHECK(cudaMemcpyAsync(*sourceRayIndicesDeviceBuffer, *sourceRayIndicesHostBuffer,
+                    validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyHostToDevice, stream));
+                CUDA_CHECK(cudaMemcpyAsync(*inputLikelihoodsDeviceBuffer, *sourceLikelihoodsHostBuffer,
+                    validSampleCount * gBeamWidth * sizeof(float), cudaMemcpyHostToDevice, stream));
+            }
+            else
+            {
+                // The search reads the generator outputs and writes the inputs of the next timestep in place
+                searchPolicy->processTimestep(validSampleCount, *outputCombinedLikelihoodDeviceBuffer,
+                    *inputDecoderDeviceBuffer, *outputRayOptionIndicesDeviceBuffer, *sourceRayIndicesDeviceBuffer,
+                    *inputLikelihoodsDeviceBuffer);
             }
-
-            CUDA_CHECK(cudaMemcpyAsync(*outputCombinedLikelihoodHostBuffer, *outputCombinedLikelihoodDeviceBuffer,
-                validSampleCount * gBeamWidth * sizeof(float), cudaMemcpyDeviceToHost, stream));
-            CUDA_CHECK(cudaMemcpyAsync(*outputVocabularyIndicesHostBuffer, *inputDecoderDeviceBuffer,
-                validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyDeviceToHost, stream));
-            CUDA_CHECK(cudaMemcpyAsync(*outputRayOptionIndicesHostBuffer, *outputRayOptionIndicesDeviceBuffer,
-                validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyDeviceToHost, stream));
-
-            CUDA_CHECK(cudaStreamSynchronize(stream));
-
-            auto startBeamSearch = std::chrono::high_resolution_clock::now();
-            searchPolicy->processTimestep(validSampleCount, *outputCombinedLikelihoodHostBuffer,
-                *outputVocabularyIndicesHostBuffer, *outputRayOptionIndicesHostBuffer, *sourceRayIndicesHostBuffer,
-                *sourceLikelihoodsHostBuffer);
-            if (gEnableProfiling)
-                profilers[0].reportLayerTime("Beam Search",
-                    std::chrono::duration<float, std::milli>(
-                        std::chrono::high_resolution_clock::now() - startBeamSearch)
-                        .count());
-
-            CUDA_CHECK(cudaMemcpyAsync(*sourceRayIndicesDeviceBuffer, *sourceRayIndicesHostBuffer,
-                validSampleCount * gBeamWidth * sizeof(int), cudaMemcpyHostToDevice, stream));
-            CUDA_CHECK(cudaMemcpyAsync(*inputLikelihoodsDeviceBuffer, *sourceLikelihoodsHostBuffer,
-                validSampleCount * gBeamWidth * sizeof(float), cudaMemcpyHostToDevice, stream));
 
             validSampleCount = searchPolicy->getTailWithNoWorkRemaining();
         } // for(int outputTimestep
 
+        CUDA_CHECK(cudaEventRecord(decodeEndEvents[stage], stream));
+
         auto startBacktrack = std::chrono::high_resolution_clock::now();
         searchPolicy->readGeneratedResult(
-            inputSamplesRead, batchMaxOutputSequenceLength, &outputHostBuffer[0], *outputSequenceLengthsHostBuffer);
+            batchSampleCount, batchMaxOutputSequenceLength, &outputHostBuffer[0], *outputSequenceLengthsHostBuffer);
         if (gEnableProfiling)
             profilers[0].reportLayerTime("Read Result",
                 std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startBacktrack)
                     .count());
 
         auto startDataWrite = std::chrono::high_resolution_clock::now();
-        for (int sampleId = 0; sampleId < inputSamplesRead; ++sampleId)
+        for (int sampleId = 0; sampleId < batchSampleCount; ++sampleId)
         {
-            int position = samplePositions[sampleId];
-            dataWriter->write(&outputHostBuffer[0] + position * batchMaxOutputSequenceLength,
-                ((const int*) *outputSequenceLengthsHostBuffer)[position],
-                ((const int*) *inputSequenceLengthsHostBuffer)[position]);
+            int position = stageSamplePositions[stage][sampleId];
+            resultWriter->write(&outputHostBuffer[0] + position * batchMaxOutputSequenceLength,
+                ((const int*) *outputSequenceLengthsHostBuffer)[position], inputSequenceLengths[position]);
         }
         if (gEnableProfiling)
             profilers[0].reportLayerTime("Data Write",
                 std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startDataWrite)
                     .count());
 
-        auto startDataRead = std::chrono::high_resolution_clock::now();
-        inputSamplesRead = nextInputSamplesReadFuture.get();
-        if (gEnableProfiling)
-            profilers[0].reportLayerTime("Data Read",
-                std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startDataRead)
-                    .count());
+        if (gPipelineEncoder)
+        {
+            // This batch was encoded while the previous one decoded, if there was one
+            CUDA_CHECK(cudaEventSynchronize(decodeEndEvents[stage]));
+            float encodeStart, encodeEnd, decodeEnd;
+            CUDA_CHECK(cudaEventElapsedTime(&encodeEnd, encodeStartEvents[stage], encodeEndEvents[stage]));
+            encoderTime += encodeEnd;
+            if (batchCount > 1)
+            {
+                CUDA_CHECK(cudaEventElapsedTime(&encodeStart, decodeStartEvents[nextStage], encodeStartEvents[stage]));
+                CUDA_CHECK(cudaEventElapsedTime(&encodeEnd, decodeStartEvents[nextStage], encodeEndEvents[stage]));
+                CUDA_CHECK(cudaEventElapsedTime(&decodeEnd, decodeStartEvents[nextStage], decodeEndEvents[nextStage]));
+                overlappedEncoderTime += std::max(0.0F, std::min(encodeEnd, decodeEnd) - std::max(encodeStart, 0.0F));
+            }
+        }
+        else
+        {
+            inputSamplesRead = readNextBatch();
+            if (inputSamplesRead > 0)
+                encodeBatch(nextStage, inputSamplesRead);
+        }
+        stage = nextStage;
     }
     float totalLatency
         = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startLatency).count();
 
-    dataWriter->finalize();
+    if (gPipelineEncoder && gDataWriterStr == "benchmark")
+        static_cast<nmtSample::BenchmarkWriter*>(dataWriter.get())
+            ->setEncoderOverlap(encoderTime, overlappedEncoderTime);
+    resultWriter->finalize();
     float score
         = gDataWriterStr == "bleu" ? static_cast<nmtSample::BLEUScoreWriter*>(dataWriter.get())->getScore() : -1.0f;
 
@@ -1294,6 +1735,15 @@ int main(int argc, char** argv)
     generatorEngine->destroy();
     generatorShuffleEngine->destroy();
 
+    for (int stage = 0; stage < stageCount; ++stage)
+    {
+        cudaEventDestroy(encodeStartEvents[stage]);
+        cudaEventDestroy(encodeEndEvents[stage]);
+        cudaEventDestroy(decodeStartEvents[stage]);
+        cudaEventDestroy(decodeEndEvents[stage]);
+    }
+    if (gPipelineEncoder)
+        cudaStreamDestroy(encoderStream);
     cudaStreamDestroy(stream);
 
     bool pass = gDataWriterStr != "bleu" || score >= 25.0f;
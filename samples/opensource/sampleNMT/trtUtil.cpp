@@ -16,6 +16,7 @@
 
 #include "trtUtil.h"
 
+#include <algorithm>
 #include <cassert>
 #include <functional>
 #include <numeric>
@@ -38,15 +39,14 @@ int getVolume(nvinfer1::Dims dims)
     return std::accumulate(dims.d, dims.d + dims.nbDims, 1, std::multiplies<int>());
 }
 
-std::vector<float> resizeWeights(int rows, int cols, int rowsNew, int colsNew, const float* memory)
+std::vector<char> resizeWeights(int rows, int cols, int rowsNew, int colsNew, const char* memory, int elementSize)
 {
-    std::vector<float> result(rowsNew * colsNew);
+    std::vector<char> result(static_cast<size_t>(rowsNew) * colsNew * elementSize);
     for (int row = 0; row < rows; row++)
     {
-        for (int col = 0; col < cols; col++)
-        {
-            result[row * colsNew + col] = memory[row * cols + col];
-        }
+        std::copy(memory + static_cast<size_t>(row) * cols * elementSize,
+            memory + static_cast<size_t>(row + 1) * cols * elementSize,
+            result.begin() + static_cast<size_t>(row) * colsNew * elementSize);
     }
     return result;
 }
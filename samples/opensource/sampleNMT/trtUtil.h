@@ -25,8 +25,8 @@ int inferTypeToBytes(nvinfer1::DataType t);
 
 int getVolume(nvinfer1::Dims dims);
 
-// Resize weights matrix to larger size
-std::vector<float> resizeWeights(int rows, int cols, int rowsNew, int colsNew, const float* memory);
+// Resize weights matrix of elementSize bytes per element to larger size, padding with zeros
+std::vector<char> resizeWeights(int rows, int cols, int rowsNew, int colsNew, const char* memory, int elementSize);
 
 } // namespace nmtSample
 
@@ -27,6 +27,7 @@
 #include "buffers.h"
 #include "common.h"
 #include "half.h"
+#include "HostReformat.h"
 #include "logger.h"
 
 #include "NvCaffeParser.h"
@@ -498,24 +499,6 @@ bool SampleReformatFreeIO::verifyOutput(SampleBuffer& outputBuf, int groundTruth
     return (idx == groundTruthDigit && val > 0.9f);
 }
 
-int calcIndex(SampleBuffer& buffer, int c, int h, int w)
-{
-    int index;
-
-    if (!buffer.desc.channelPivot)
-    {
-        index = c / buffer.desc.dims[3] * buffer.desc.dims[1] * buffer.desc.dims[2] * buffer.desc.dims[3]
-            + h * buffer.desc.dims[2] * buffer.desc.dims[3] + w * buffer.desc.dims[3] + c % buffer.desc.dims[3];
-    }
-    else
-    {
-        index = h * buffer.desc.dims[2] * buffer.desc.dims[1] + w * buffer.desc.dims[2]
-            + c / buffer.desc.scalarPerVector * buffer.desc.scalarPerVector + c % buffer.desc.scalarPerVector;
-    }
-
-    return index;
-}
-
 //!
 //! \brief Reformats the buffer. Src and dst buffers should be of same datatype and dims.
 //!
@@ -528,46 +511,42 @@ void reformat(SampleBuffer& src, SampleBuffer& dst)
         return;
     }
 
-    int srcIndex, dstIndex;
-
-    T* srcBuf = reinterpret_cast<T*>(src.buffer);
+    const T* srcBuf = reinterpret_cast<const T*>(src.buffer);
     T* dstBuf = reinterpret_cast<T*>(dst.buffer);
-
-    for (int c = 0; c < src.dims.d[0]; c++)
+    if (src.format == TensorFormat::kLINEAR)
     {
-        for (int h = 0; h < src.dims.d[1]; h++)
-        {
-            for (int w = 0; w < src.dims.d[2]; w++)
-            {
-                srcIndex = calcIndex(src, c, h, w);
-                dstIndex = calcIndex(dst, c, h, w);
-                dstBuf[dstIndex] = srcBuf[srcIndex];
-            }
-        }
+        samplesCommon::packHost(
+            srcBuf, dstBuf, samplesCommon::hostTensorLayout(dst.dims, dst.format), samplesCommon::CopyValues{});
+    }
+    else
+    {
+        samplesCommon::unpackHost(
+            srcBuf, dstBuf, samplesCommon::hostTensorLayout(src.dims, src.format), samplesCommon::CopyValues{});
     }
 }
 
+//!
+//! \brief Converts the linear FP32 golden input to the data type and format of dstInput in one pass
+//!
+//! INT8 inputs are the golden values less 128, with the scale of 1 the network sets.
+//!
 template <typename T>
-void convertGoldenData(SampleBuffer& goldenInput, SampleBuffer& dstInput)
-{
-    SampleBuffer tmpBuf(goldenInput.dims, sizeof(T), goldenInput.format);
-
-    float* golden = reinterpret_cast<float*>(goldenInput.buffer);
-    T* tmp = reinterpret_cast<T*>(tmpBuf.buffer);
+void convertGoldenData(SampleBuffer& goldenInput, SampleBuffer& dstInput);
 
-    for (int i = 0; i < goldenInput.desc.getElememtSize(); i++)
-    {
-        if (std::is_same<T, int8_t>::value)
-        {
-            tmp[i] = static_cast<T>(golden[i] - 128);
-        }
-        else
-        {
-            tmp[i] = static_cast<T>(golden[i]);
-        }
-    }
+template <>
+void convertGoldenData<int8_t>(SampleBuffer& goldenInput, SampleBuffer& dstInput)
+{
+    samplesCommon::packHost(reinterpret_cast<const float*>(goldenInput.buffer),
+        reinterpret_cast<int8_t*>(dstInput.buffer), samplesCommon::hostTensorLayout(dstInput.dims, dstInput.format),
+        samplesCommon::FloatToInt8(1.F, -128.F));
+}
 
-    reformat<T>(tmpBuf, dstInput);
+template <>
+void convertGoldenData<half_float::half>(SampleBuffer& goldenInput, SampleBuffer& dstInput)
+{
+    samplesCommon::packHost(reinterpret_cast<const float*>(goldenInput.buffer),
+        reinterpret_cast<half_float::half*>(dstInput.buffer),
+        samplesCommon::hostTensorLayout(dstInput.dims, dstInput.format), samplesCommon::FloatToHalf{});
 }
 
 //!
@@ -109,6 +109,11 @@ private:
     //! \brief Filters output detections and verify results
     //!
     bool verifyOutput(const samplesCommon::BufferManager& buffers);
+
+    //!
+    //! \brief Packs the calibration batch files into one dataset file beside them, unless it exists
+    //!
+    std::string packCalibrationBatches() const;
 };
 
 //!
@@ -194,10 +199,22 @@ bool SampleSSD::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
     if (mParams.int8)
     {
         gLogInfo << "Using Entropy Calibrator 2" << std::endl;
-        BatchStream calibrationStream(
-            mParams.batchSize, mParams.nbCalBatches, mParams.calibrationBatches, mParams.dataDirs);
-        calibrator.reset(
-            new Int8EntropyCalibrator2<BatchStream>(calibrationStream, 0, "SSD", mParams.inputTensorNames[0].c_str()));
+        const std::string modelHash = samplesCommon::hashModelFiles({locateFile(mParams.weightsFileName, mParams.dataDirs),
+            locateFile(mParams.prototxtFileName, mParams.dataDirs)});
+        const std::string packedFile = packCalibrationBatches();
+        if (!packedFile.empty())
+        {
+            PackedBatchStream calibrationStream(mParams.batchSize, mParams.nbCalBatches, packedFile);
+            calibrator.reset(new Int8EntropyCalibrator2<PackedBatchStream>(
+                calibrationStream, 0, "SSD", mParams.inputTensorNames[0].c_str(), true, modelHash));
+        }
+        else
+        {
+            BatchStream calibrationStream(
+                mParams.batchSize, mParams.nbCalBatches, mParams.calibrationBatches, mParams.dataDirs);
+            calibrator.reset(new Int8EntropyCalibrator2<BatchStream>(
+                calibrationStream, 0, "SSD", mParams.inputTensorNames[0].c_str(), true, modelHash));
+        }
         config->setFlag(BuilderFlag::kINT8);
         config->setInt8Calibrator(calibrator.get());
     }
@@ -213,6 +230,38 @@ bool SampleSSD::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder,
     return true;
 }
 
+//!
+//! \brief Packs the calibration batch files into one dataset file beside them, unless it exists
+//!
+//! \details The calibrator then reads adjacent images in place from the mapped file instead of parsing a batch file
+//!          per batch, on this build and the next ones.
+//!
+//! \return The packed dataset file, empty if it cannot be written, in which case the batch files are read
+//!
+std::string SampleSSD::packCalibrationBatches() const
+{
+    const std::string suffix{".batch"};
+    const std::string firstBatch = locateFile(mParams.calibrationBatches + "0" + suffix, mParams.dataDirs);
+    const std::string prefix = firstBatch.substr(0, firstBatch.size() - std::string("0").size() - suffix.size());
+    const std::string packedFile = prefix + ".packed";
+    if (std::ifstream(packedFile).good())
+    {
+        return packedFile;
+    }
+    try
+    {
+        const size_t samples = samplesCommon::packBatchFiles(prefix, suffix, packedFile);
+        gLogInfo << "Packed " << samples << " calibration images into " << packedFile << std::endl;
+        return packedFile;
+    }
+    catch (const std::exception& e)
+    {
+        gLogWarning << e.what() << ", calibrating from the batch files" << std::endl;
+        std::remove(packedFile.c_str());
+        return std::string{};
+    }
+}
+
 //!
 //! \brief Runs the TensorRT inference engine for this sample
 //!
@@ -38,6 +38,7 @@
 #include "buffers.h"
 #include "common.h"
 #include "logger.h"
+#include "maskPostprocessor.h"
 
 // max
 #include <algorithm>
@@ -54,18 +55,14 @@ struct RawDetection
     float y1, x1, y2, x2, class_id, score;
 };
 
-struct Mask
-{
-    float raw[MaskRCNNConfig::MASK_POOL_SIZE * 2 * MaskRCNNConfig::MASK_POOL_SIZE * 2];
-};
-
 struct BBoxInfo
 {
     samplesCommon::BBox box;
     int label = -1;
     float prob = 0.0f;
 
-    Mask* mask = nullptr;
+    //! Index of the mask of the detection and its label among the masks of the batch
+    int mask = -1;
 };
 
 template <typename T>
@@ -187,87 +184,34 @@ void preprocessPPM(PPM<uint8_t>& src, PPM<uint8_t>& dst, int target_h, int targe
     padPPM(resized_ppm, dst, y_offset, input_dim - resize_h - y_offset, x_offset, input_dim - resize_w - x_offset);
 }
 
-PPM<uint8_t> resizeMask(const BBoxInfo& box, const float mask_threshold)
+//!
+//! \brief Blends the color of the detection covering each pixel, from the instance map of the image
+//!
+void maskPPM(PPM<uint8_t>& image, const int16_t* instances, const std::vector<std::vector<int>>& colors)
 {
-    PPM<uint8_t> result;
-    if (!box.mask)
+    const float alpha = 0.6f;
+    for (int i = 0; i < image.h * image.w; ++i)
     {
-        assert(result.buffer.size() == 0);
-        return result;
-    }
-
-    const int h = box.box.y2 - box.box.y1;
-    const int w = box.box.x2 - box.box.x1;
-
-    PPM<float> raw_mask;
-    raw_mask.h = MaskRCNNConfig::MASK_POOL_SIZE * 2;
-    raw_mask.w = MaskRCNNConfig::MASK_POOL_SIZE * 2;
-    raw_mask.buffer.resize(raw_mask.h * raw_mask.w, 0);
-    for (int i = 0; i < raw_mask.h * raw_mask.w; i++)
-        raw_mask.buffer[i] = box.mask->raw[i];
-
-    PPM<float> resized_mask;
-    resized_mask.h = h;
-    resized_mask.w = w;
-    resized_mask.buffer.resize(h * w, 0);
-    resizePPM<float>(raw_mask, resized_mask, h, w, 1);
-
-    result.h = h;
-    result.w = w;
-    result.buffer.resize(result.h * result.w, 0);
-    for (int i = 0; i < h * w; i++)
-    {
-        if (resized_mask.buffer[i] > mask_threshold)
+        if (instances[i] < 0)
         {
-            result.buffer[i] = 1;
+            continue;
         }
-    }
-
-    return result;
-}
-
-void maskPPM(
-    PPM<uint8_t>& image, const PPM<uint8_t>& mask, const int start_x, const int start_y, const std::vector<int>& color)
-{
-
-    float alpha = 0.6f;
-
-    for (int y = 0; y < mask.h; ++y)
-    {
-        for (int x = 0; x < mask.w; ++x)
+        const std::vector<int>& color = colors[instances[i]];
+        for (int c = 0; c < 3; ++c)
         {
-            uint8_t mask_pixel = mask.buffer[y * mask.w + x];
-            if (mask_pixel == 1)
-            {
-                assert(0 <= start_y + y && start_y + y < image.h);
-                assert(0 <= start_x + x && start_x + x < image.w);
-
-                int cur_y = start_y + y;
-                int cur_x = start_x + x;
-
-                float p_r = static_cast<float>(image.buffer[(cur_y * image.w + cur_x) * 3]);
-                float p_g = static_cast<float>(image.buffer[(cur_y * image.w + cur_x) * 3 + 1]);
-                float p_b = static_cast<float>(image.buffer[(cur_y * image.w + cur_x) * 3 + 2]);
-
-                image.buffer[(cur_y * image.w + cur_x) * 3]
-                    = static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, p_r * (1 - alpha) + color[0] * alpha)));
-                image.buffer[(cur_y * image.w + cur_x) * 3 + 1]
-                    = static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, p_g * (1 - alpha) + color[1] * alpha)));
-                image.buffer[(cur_y * image.w + cur_x) * 3 + 2]
-                    = static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, p_b * (1 - alpha) + color[2] * alpha)));
-            }
-            else
-                assert(mask_pixel == 0);
+            const float p = static_cast<float>(image.buffer[i * 3 + c]);
+            image.buffer[i * 3 + c]
+                = static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, p * (1 - alpha) + color[c] * alpha)));
         }
     }
 }
-void addBBoxPPM(PPM<uint8_t>& ppm, const BBoxInfo& box, const PPM<uint8_t>& resized_mask)
+
+void addBBoxPPM(PPM<uint8_t>& ppm, const BBoxInfo& box, const std::vector<int>& color)
 {
     const int x1 = box.box.x1;
     const int y1 = box.box.y1;
     const int x2 = box.box.x2;
     const int y2 = box.box.y2;
-    std::vector<int> color = {rand() % 256, rand() % 256, rand() % 256};
 
     for (int x = x1; x <= x2; x++)
     {
@@ -292,11 +236,6 @@ void addBBoxPPM(PPM<uint8_t>& ppm, const BBoxInfo& box, const PPM<uint8_t>& resi
         ppm.buffer[(y * ppm.w + x2) * 3 + 1] = color[1];
         ppm.buffer[(y * ppm.w + x2) * 3 + 2] = color[2];
     }
-
-    if (resized_mask.buffer.size() != 0)
-    {
-        maskPPM(ppm, resized_mask, x1, y1, color);
-    }
 }
 } // namespace MaskRCNNUtils
 
@@ -345,7 +284,7 @@ private:
 
     bool verifyOutput(const samplesCommon::BufferManager& buffers);
 
-    vector<MaskRCNNUtils::BBoxInfo> decodeOutput(const int imageIdx, void* detectionsHost, void* masksHost);
+    vector<MaskRCNNUtils::BBoxInfo> decodeOutput(const int imageIdx, void* detectionsHost);
 };
 
 bool SampleMaskRCNN::build()
@@ -455,8 +394,10 @@ bool SampleMaskRCNN::infer()
         return false;
     }
 
-    // Memcpy from device output buffers to host output buffers
-    buffers.copyOutputToHost();
+    // Only the detections are copied back, the masks are pasted on the device by verifyOutput
+    const std::string& detections = mParams.outputTensorNames[0];
+    CHECK(cudaMemcpy(buffers.getHostBuffer(detections), buffers.getDeviceBuffer(detections), buffers.size(detections),
+        cudaMemcpyDeviceToHost));
 
     // Post-process detections and verify results
     if (!verifyOutput(buffers))
@@ -518,7 +459,7 @@ bool SampleMaskRCNN::processInput(const samplesCommon::BufferManager& buffers)
     return true;
 }
 
-vector<MaskRCNNUtils::BBoxInfo> SampleMaskRCNN::decodeOutput(const int imageIdx, void* detectionsHost, void* masksHost)
+vector<MaskRCNNUtils::BBoxInfo> SampleMaskRCNN::decodeOutput(const int imageIdx, void* detectionsHost)
 {
     int input_dim_h = MaskRCNNConfig::IMAGE_SHAPE.d[1], input_dim_w = MaskRCNNConfig::IMAGE_SHAPE.d[2];
     assert(input_dim_h == input_dim_w);
@@ -540,11 +481,9 @@ vector<MaskRCNNUtils::BBoxInfo> SampleMaskRCNN::decodeOutput(const int imageIdx,
     std::vector<MaskRCNNUtils::BBoxInfo> binfo;
 
     int detectionOffset = samplesCommon::volume(MaskRCNNConfig::MODEL_DETECTION_SHAPE); // (100,6)
-    int maskOffset = samplesCommon::volume(MaskRCNNConfig::MODEL_MASK_SHAPE);           // (100, 81, 28, 28)
 
     MaskRCNNUtils::RawDetection* detections
         = reinterpret_cast<MaskRCNNUtils::RawDetection*>((float*) detectionsHost + imageIdx * detectionOffset);
-    MaskRCNNUtils::Mask* masks = reinterpret_cast<MaskRCNNUtils::Mask*>((float*) masksHost + imageIdx * maskOffset);
     for (int det_id = 0; det_id < MaskRCNNConfig::DETECTION_MAX_INSTANCES; det_id++)
     {
         MaskRCNNUtils::RawDetection cur_det = detections[det_id];
@@ -564,7 +503,8 @@ vector<MaskRCNNUtils::BBoxInfo> SampleMaskRCNN::decodeOutput(const int imageIdx,
         if (det.box.x2 <= det.box.x1 || det.box.y2 <= det.box.y1)
             continue;
 
-        det.mask = masks + det_id * MaskRCNNConfig::NUM_CLASSES + label;
+        // The masks are (100, 81, 28, 28) per image
+        det.mask = (imageIdx * MaskRCNNConfig::DETECTION_MAX_INSTANCES + det_id) * MaskRCNNConfig::NUM_CLASSES + label;
 
         binfo.push_back(det);
     }
@@ -575,17 +515,50 @@ vector<MaskRCNNUtils::BBoxInfo> SampleMaskRCNN::decodeOutput(const int imageIdx,
 bool SampleMaskRCNN::verifyOutput(const samplesCommon::BufferManager& buffers)
 {
     void* detectionsHost = buffers.getHostBuffer(mParams.outputTensorNames[0]);
-    void* masksHost = buffers.getHostBuffer(mParams.outputTensorNames[1]);
+    const float* masksDevice = static_cast<const float*>(buffers.getDeviceBuffer(mParams.outputTensorNames[1]));
 
     bool pass = true;
 
+    std::vector<vector<MaskRCNNUtils::BBoxInfo>> binfos;
+    std::vector<std::pair<int, int>> sizes;
+    std::vector<std::vector<samplesCommon::MaskBox>> boxes;
+    size_t pixels = 0;
+    for (int p = 0; p < mParams.batchSize; ++p)
+    {
+        binfos.push_back(decodeOutput(p, detectionsHost));
+        sizes.emplace_back(mOriginalPPMs[p].h, mOriginalPPMs[p].w);
+        boxes.emplace_back();
+        for (const auto& b : binfos.back())
+        {
+            boxes.back().push_back(samplesCommon::MaskBox{b.box.x1, b.box.y1, b.box.x2, b.box.y2, b.mask});
+        }
+        pixels += static_cast<size_t>(mOriginalPPMs[p].h) * mOriginalPPMs[p].w;
+    }
+
+    // Threshold, resize and paste the masks of all the detections of the batch in one launch
+    const int maskSize = MaskRCNNConfig::MASK_POOL_SIZE * 2;
+    samplesCommon::MaskPostprocessor postprocessor(maskSize, maskSize, mParams.maskThreshold, mParams.batchSize,
+        mParams.batchSize * MaskRCNNConfig::DETECTION_MAX_INSTANCES, pixels);
+    auto tStart = std::chrono::high_resolution_clock::now();
+    postprocessor.enqueue(sizes, boxes, masksDevice, 0);
+    CHECK(cudaStreamSynchronize(0));
+    auto tEnd = std::chrono::high_resolution_clock::now();
+    gLogInfo << "Mask post-processing time is "
+             << std::chrono::duration<float, std::milli>(tEnd - tStart).count() / mParams.batchSize << " ms/frame"
+             << std::endl;
+
     for (int p = 0; p < mParams.batchSize; ++p)
     {
-        vector<MaskRCNNUtils::BBoxInfo> binfo = decodeOutput(p, detectionsHost, masksHost);
+        const vector<MaskRCNNUtils::BBoxInfo>& binfo = binfos[p];
+        std::vector<std::vector<int>> colors;
+        for (size_t roi_id = 0; roi_id < binfo.size(); roi_id++)
+        {
+            colors.push_back({rand() % 256, rand() % 256, rand() % 256});
+        }
+        MaskRCNNUtils::maskPPM(mOriginalPPMs[p], postprocessor.instances(p), colors);
         for (size_t roi_id = 0; roi_id < binfo.size(); roi_id++)
         {
-            const auto resized_mask = MaskRCNNUtils::resizeMask(binfo[roi_id], mParams.maskThreshold); // mask threshold
-            MaskRCNNUtils::addBBoxPPM(mOriginalPPMs[p], binfo[roi_id], resized_mask);
+            MaskRCNNUtils::addBBoxPPM(mOriginalPPMs[p], binfo[roi_id], colors[roi_id]);
 
             gLogInfo << "Detected " << MaskRCNNConfig::CLASS_NAMES[binfo[roi_id].label] << " in"
                      << mOriginalPPMs[p].fileName << " with confidence " << binfo[roi_id].prob * 100.f
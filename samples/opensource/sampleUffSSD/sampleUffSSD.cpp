@@ -206,8 +206,10 @@ bool SampleUffSSD::constructNetwork(SampleUniquePtr<nvinfer1::IBuilder>& builder
         imageDims = nvinfer1::DimsNCHW{mParams.calBatchSize, imageC, imageH, imageW};
         BatchStream calibrationStream(
             mParams.calBatchSize, mParams.nbCalBatches, imageDims, listFileName, mParams.dataDirs);
+        const std::string modelHash
+            = samplesCommon::hashModelFiles({locateFile(mParams.uffFileName, mParams.dataDirs)});
         calibrator.reset(new Int8EntropyCalibrator2<BatchStream>(
-            calibrationStream, 0, "UffSSD", mParams.inputTensorNames[0].c_str()));
+            calibrationStream, 0, "UffSSD", mParams.inputTensorNames[0].c_str(), true, modelHash));
         config->setFlag(BuilderFlag::kINT8);
         config->setInt8Calibrator(calibrator.get());
     }
@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2019, NVIDIA CORPORATION. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+'''
+Run a performance regression suite and compare its results
+
+The "run" command runs the entries of a JSON suite and appends one JSON
+record per entry to the results file. The trtexec entries run with the
+warmup, iteration and duration of the suite, and their record is the
+--exportSummary of trtexec: latency and throughput percentiles, build time
+and device memory. The sample entries record their wall time, and the peak
+host memory of the process.
+
+The "compare" command diffs two results files by entry name, and fails if
+a metric regressed by more than the threshold.
+
+Suite format:
+{ "warmUp" : ms, "iterations" : count, "duration" : s,
+  "runs" : [ { "name" : string, "trtexec" : [ arg, ... ] }, { "name" : string, "sample" : [ exe, arg, ... ] } ] }
+The arguments may use ${BIN_DIR} and ${DATA_DIR}.
+'''
+
+from __future__ import print_function
+
+import os
+import sys
+import json
+import time
+import argparse
+import resource
+import subprocess
+import tempfile
+
+
+# Metric, and whether higher is better
+compared_metrics = [('throughputQps', True), ('hostLatencyMs.median', False), ('hostLatencyMs.p99', False),
+                    ('gpuComputeMs.median', False), ('buildMs', False), ('deviceMemoryMiB', False),
+                    ('walltimeMs', False), ('peakHostMemoryMiB', False)]
+
+
+
+def expand(args, variables):
+    ''' Expand the variables in the arguments of a run '''
+
+    expanded = []
+    for a in args:
+        for name, value in variables.items():
+            a = a.replace('${' + name + '}', value)
+        expanded.append(a)
+    return expanded
+
+
+
+def run_entry(entry, suite, variables):
+    ''' Run one entry of the suite and return its record '''
+
+    record = {'name': entry['name']}
+    summary = None
+
+    if 'trtexec' in entry:
+        handle, summary = tempfile.mkstemp(suffix='.json')
+        os.close(handle)
+        command = [os.path.join(variables['BIN_DIR'], 'trtexec')] + expand(entry['trtexec'], variables)
+        command += ['--warmUp=' + str(suite.get('warmUp', 200)), '--iterations=' + str(suite.get('iterations', 10)),
+                    '--duration=' + str(suite.get('duration', 3)), '--exportSummary=' + summary]
+    else:
+        command = expand(entry['sample'], variables)
+        command[0] = os.path.join(variables['BIN_DIR'], command[0])
+
+    before = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    start = time.time()
+    try:
+        with open(os.devnull, 'w') as devnull:
+            status = subprocess.call(command, stdout=devnull)
+    except OSError as e:
+        print('{}: {}'.format(command[0], e.strerror), file=sys.stderr)
+        status = 127
+    record['returnCode'] = status
+    if 'sample' in entry:
+        record['walltimeMs'] = (time.time() - start) * 1000
+    # The high-water mark of the children only grows, so it is only known when this run sets it
+    peak = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    if status == 0 and peak > before:
+        record['peakHostMemoryMiB'] = peak / 1024.0
+
+    if summary is not None:
+        if status == 0:
+            with open(summary) as f:
+                record.update(json.load(f))
+        os.remove(summary)
+
+    return record
+
+
+
+def run(args):
+    ''' Run the suite '''
+
+    with open(args.suite) as f:
+        suite = json.load(f)
+
+    variables = {'BIN_DIR': args.bin_dir, 'DATA_DIR': args.data_dir}
+    failed = 0
+    with open(args.output, 'a') as output:
+        for entry in suite['runs']:
+            if args.only and entry['name'] not in args.only.split(','):
+                continue
+            record = run_entry(entry, suite, variables)
+            if args.tag:
+                record['tag'] = args.tag
+            output.write(json.dumps(record) + '\n')
+            output.flush()
+            print('{}: {}'.format(entry['name'], 'FAILED' if record['returnCode'] else 'done'))
+            failed += record['returnCode'] != 0
+
+    return 1 if failed else 0
+
+
+
+def metric(record, name):
+    ''' Get a possibly nested metric of a record '''
+
+    value = record
+    for key in name.split('.'):
+        if not isinstance(value, dict) or key not in value:
+            return None
+        value = value[key]
+    return value
+
+
+
+def load(name):
+    ''' Load a results file, keeping the last record of each entry '''
+
+    records = {}
+    with open(name) as f:
+        for line in f:
+            if line.strip():
+                record = json.loads(line)
+                records[record['name']] = record
+    return records
+
+
+
+def compare(args):
+    ''' Compare two results files '''
+
+    base = load(args.base)
+    new = load(args.new)
+    regressions = 0
+
+    print('name, metric, base, new, change %')
+    for name in sorted(base):
+        if name not in new:
+            print('{}, missing'.format(name))
+            regressions += 1
+            continue
+        for m, higher_is_better in compared_metrics:
+            b = metric(base[name], m)
+            n = metric(new[name], m)
+            if b is None or n is None or b == 0:
+                continue
+            change = (n - b) / b * 100
+            regressed = -change if higher_is_better else change
+            flag = ' REGRESSION' if regressed > args.threshold else ''
+            print('{}, {}, {:.3f}, {:.3f}, {:+.1f}{}'.format(name, m, b, n, change, flag))
+            regressions += regressed > args.threshold
+
+    return 1 if regressions else 0
+
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command')
+
+    run_parser = commands.add_parser('run', help='Run a suite.')
+    run_parser.add_argument('suite', help='JSON suite file.')
+    run_parser.add_argument('--output', default='results.jsonl', help='Results file, one JSON record per line.')
+    run_parser.add_argument('--bin-dir', default='.', help='Directory of trtexec and of the samples.')
+    run_parser.add_argument('--data-dir', default='data', help='Directory of the models and data files.')
+    run_parser.add_argument('--only', metavar='N[,N]*', help='Comma separated list of the entries to run.')
+    run_parser.add_argument('--tag', help='Tag added to the records, such as the TensorRT version.')
+
+    compare_parser = commands.add_parser('compare', help='Compare two results files.')
+    compare_parser.add_argument('base', help='Results of the baseline.')
+    compare_parser.add_argument('new', help='Results to compare to the baseline.')
+    compare_parser.add_argument('--threshold', metavar='P', type=float, default=5,
+                                help='Regression threshold in percent.')
+
+    args = parser.parse_args()
+    if args.command == 'run':
+        return run(args)
+    if args.command == 'compare':
+        return compare(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
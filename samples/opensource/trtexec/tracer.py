@@ -34,16 +34,16 @@ import argparse
 import prn_utils
 
 
-timestamps = ['startInMs', 'endInMs', 'startComputeMs', 'endComputeMs', 'startOutMs', 'endOutMs']
+timestamps = ['arrivalMs', 'startInMs', 'endInMs', 'startComputeMs', 'endComputeMs', 'startOutMs', 'endOutMs']
 
-intervals = ['inMs', 'computeMs', 'outMs', 'latencyMs', 'endToEndMs']
+intervals = ['queueMs', 'inMs', 'computeMs', 'outMs', 'latencyMs', 'endToEndMs']
 
 all_metrics = timestamps + intervals
 
 default_metrics = ",".join(all_metrics)
 
-descriptions = ['start input', 'end input', 'start compute', 'end compute', 'start output',
-                'end output', 'input', 'compute', 'output', 'latency', 'end to end latency']
+descriptions = ['request arrival', 'start input', 'end input', 'start compute', 'end compute', 'start output',
+                'end output', 'queueing', 'input', 'compute', 'output', 'latency', 'end to end latency']
 
 metrics_description = prn_utils.combine_descriptions('Possible metrics (all in ms) are:',
                                                      all_metrics, descriptions)
@@ -21,8 +21,12 @@
 #include <cuda_runtime_api.h>
 #include <fstream>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <map>
+#include <numeric>
 #include <sstream>
 #include <string.h>
 #include <sys/stat.h>
@@ -38,16 +42,1403 @@
 #include "logger.h"
 #include "sampleOptions.h"
 #include "sampleEngines.h"
+#include "sampleEngineLoader.h"
+#include "sampleCascade.h"
+#include "sampleCluster.h"
 #include "sampleInference.h"
+#include "sampleProfiles.h"
 #include "sampleReporting.h"
+#include "sampleRoofline.h"
+#include "sampleServer.h"
+#include "sampleStagePipeline.h"
+#include "sampleTelemetry.h"
 
 using namespace nvinfer1;
 using namespace sample;
 
+namespace
+{
+
+//! Collects the reports of the plugin library, which takes a plain function
+PluginEnqueueProfiler gPluginEnqueueProfiler;
+
+void reportPluginEnqueue(const char* pluginType, const char* layerName, float microseconds)
+{
+    gPluginEnqueueProfiler.report(pluginType, layerName, microseconds);
+}
+
+//!
+//! \brief Build the engines of the build matrix, then measure them one at a time on their devices and print a summary
+//!
+//! \return boolean Return true if all the variants were built and measured
+//!
+bool runBuildMatrix(const AllOptions& options)
+{
+    const auto& devices = options.system.devices;
+    auto variants = makeBuildVariants(options.build, devices.empty() ? std::vector<int>{options.system.device} : devices);
+    bool passed = buildEngineMatrix(options.model, options.system, options.build.buildJobs, variants, gLogError);
+
+    // Builds ran concurrently, measurements run alone so that they do not disturb each other
+    struct Measurement
+    {
+        float latencyMs{0};
+        float computeMs{0};
+        float throughput{0};
+    };
+    std::vector<Measurement> measurements(variants.size());
+    for (size_t i = 0; i < variants.size() && !options.inference.skip; ++i)
+    {
+        const auto& v = variants[i];
+        if (!v.built)
+        {
+            continue;
+        }
+        cudaSetDevice(v.device);
+        InferenceOptions inference = options.inference;
+        if (v.batch && inference.batch)
+        {
+            inference.batch = v.batch;
+        }
+        else if (v.batch)
+        {
+            for (auto& shapes : inference.shapes)
+            {
+                for (auto& input : shapes)
+                {
+                    input.second.d[0] = v.batch;
+                }
+            }
+        }
+        InferenceEnvironment iEnv;
+        iEnv.engine.reset(loadEngine(v.plan, options.system.DLACore, gLogError));
+        if (!iEnv.engine || !setUpInference(iEnv, inference))
+        {
+            gLogError << "Inference set up of " << v.name << " failed" << std::endl;
+            passed = false;
+            continue;
+        }
+        std::vector<InferenceTrace> trace;
+        runInference(inference, iEnv, trace);
+
+        const float warmupMs = static_cast<float>(inference.warmup);
+        const int queries = v.batch ? v.batch : std::max(inference.batch, 1);
+        InferenceTime total;
+        int count{0};
+        float start{0};
+        float end{0};
+        for (const auto& t : trace)
+        {
+            if (t.computeStart < warmupMs)
+            {
+                continue;
+            }
+            start = count ? std::min(start, t.inStart) : t.inStart;
+            end = std::max(end, t.outEnd);
+            total += traceToTiming(t);
+            ++count;
+        }
+        auto& m = measurements[i];
+        m.latencyMs = count ? total.latency() / count : 0;
+        m.computeMs = count ? total.compute / count : 0;
+        m.throughput = end > start ? count * queries / (end - start) * 1000 : 0;
+    }
+    cudaSetDevice(options.system.device);
+
+    gLogInfo << "=== Build matrix ===" << std::endl;
+    for (size_t i = 0; i < variants.size(); ++i)
+    {
+        const auto& v = variants[i];
+        const auto& m = measurements[i];
+        if (!v.built)
+        {
+            gLogInfo << v.name << " (device " << v.device << "): build failed" << std::endl;
+            continue;
+        }
+// clang-format off
+        gLogInfo << v.name          << " (device " << v.device << "): "
+                    "build "        << v.buildMs / 1000                        << " s, "
+                    "plan "         << v.planSize / (1 << 20) << " MiB " << v.plan << ", "
+                    "host latency " << m.latencyMs                             << " ms, "
+                    "GPU compute "  << m.computeMs                             << " ms, "
+                    "throughput "   << m.throughput                            << " qps" << std::endl;
+// clang-format on
+    }
+    return passed;
+}
+
+//!
+//! \brief Print the inferences served across a swap of environments
+//!
+void printSwapTiming(const SwapTiming& timing, const char* prepared)
+{
+// clang-format off
+    gLogInfo << "Swap: "                         << prepared              << " ready after "
+                                                 << timing.prepareMs      << " ms, "
+                "served "                       << timing.before         << " inferences before and "
+                                                << timing.after          << " after, "
+                "time between inferences mean " << timing.meanGapMs      << " ms, "
+                "max "                          << timing.maxGapMs       << " ms, "
+                "at the swap "                  << timing.swapGapMs      << " ms" << std::endl;
+    gLogInfo << "Swap latency: mean before "    << timing.meanLatencyMs  << " ms, "
+                "first after "                  << timing.firstLatencyMs << " ms, "
+                "max "                          << timing.maxLatencyMs   << " ms, "
+                "drained in "                   << timing.drainMs        << " ms";
+// clang-format on
+    if (timing.retireMs > 0)
+    {
+        gLogInfo << ", old engine released in " << timing.retireMs << " ms";
+    }
+    gLogInfo << std::endl;
+}
+
+//!
+//! \brief Refit the loaded engine with the weights of the model and save it
+//!
+//! Unless inference is skipped, a copy of the engine is refitted while the loaded one serves inference, and replaces
+//! it once it is set up, so that serving does not stop for the refit.
+//!
+bool runRefit(const AllOptions& options, InferenceEnvironment& live)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    float refitMs{0};
+    const auto refit = [&options, &refitMs](ICudaEngine& engine)
+    {
+        const auto refitStart = clock::now();
+        const bool refitted = refitEngine(engine, options.model, gLogError);
+        refitMs = std::chrono::duration<float, std::milli>(clock::now() - refitStart).count();
+        return refitted;
+    };
+
+    ICudaEngine* refitted{nullptr};
+    InferenceEnvironment next;
+    if (options.inference.skip)
+    {
+        refitted = refit(*live.engine) ? live.engine.get() : nullptr;
+    }
+    else
+    {
+        if (!setUpInference(live, options.inference))
+        {
+            gLogError << "Inference set up failed" << std::endl;
+            return false;
+        }
+        const auto prepare = [&]() -> InferenceEnvironment*
+        {
+            auto engines = replicateEngine(*live.engine, {options.system.device}, gLogError);
+            if (engines.empty() || !refit(*engines.front()))
+            {
+                return nullptr;
+            }
+            next.engine = std::move(engines.front());
+            return setUpInference(next, options.inference) ? &next : nullptr;
+        };
+        SwapTiming timing;
+        if (runSwap(options.inference, live, prepare, timing))
+        {
+            refitted = next.engine.get();
+        }
+        printSwapTiming(timing, "refitted copy");
+    }
+    if (!refitted)
+    {
+        gLogError << "Refit failed" << std::endl;
+        return false;
+    }
+    gLogInfo << "Engine refitted in " << refitMs << " ms" << std::endl;
+    return saveEngine(*refitted, options.build.refit, gLogError, options.build.compression);
+}
+
+//!
+//! \brief Serve inference with the engine while the engine of --swapEngine is loaded and set up, then swap it in
+//!
+//! The old engine, its contexts and its bindings are released once its last inference completes, while the new engine
+//! serves, so that a serving process does not hold both past the swap.
+//!
+bool runHotSwap(const AllOptions& options, InferenceEnvironment& live, IGpuAllocator* allocator)
+{
+    if (!setUpInference(live, options.inference))
+    {
+        gLogError << "Inference set up failed" << std::endl;
+        return false;
+    }
+    InferenceEnvironment next;
+    const auto prepare = [&]() -> InferenceEnvironment*
+    {
+        next.engine.reset(
+            loadEngine(options.inference.swapEngine, options.system.DLACore, gLogError, allocator, &next.startup));
+        return next.engine && setUpInference(next, options.inference) ? &next : nullptr;
+    };
+    const auto retire = [&live]()
+    {
+        live.slotBindings.clear();
+        live.bindings.clear();
+        live.context.clear();
+        live.engine.reset();
+    };
+    SwapTiming timing;
+    if (!runSwap(options.inference, live, prepare, timing, retire))
+    {
+        gLogError << "Engine swap failed, " << options.inference.swapEngine << " could not be set up" << std::endl;
+        return false;
+    }
+    printSwapTiming(timing, options.inference.swapEngine.c_str());
+    const auto& startup = next.startup;
+    gLogInfo << "Swap preparation: read " << startup.readMs << " ms, decompress " << startup.decompressMs
+             << " ms, deserialize " << startup.deserializeMs << " ms, contexts " << startup.contextsMs
+             << " ms, bindings " << startup.bindingsMs << " ms" << std::endl;
+    return true;
+}
+
+struct ClosedLoopStats
+{
+    float throughput{0};
+    float latencyMs{0};
+    float computeMs{0};
+};
+
+//!
+//! \brief Summarize the trace of a closed loop run past its warm up, with the host latency at the percentile
+//!
+//! \return boolean Return false if no inference completed past the warm up
+//!
+bool closedLoopStats(const std::vector<InferenceTrace>& trace, float warmupMs, int batch, float percentile,
+    ClosedLoopStats& stats)
+{
+    std::vector<float> latencies;
+    float computeMs{0};
+    float start{0};
+    float end{0};
+    for (const auto& t : trace)
+    {
+        if (t.computeStart < warmupMs)
+        {
+            continue;
+        }
+        start = latencies.empty() ? t.inStart : std::min(start, t.inStart);
+        end = std::max(end, t.outEnd);
+        const InferenceTime timing = traceToTiming(t);
+        latencies.push_back(timing.latency());
+        computeMs += timing.compute;
+    }
+    if (latencies.empty())
+    {
+        return false;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto exclude = static_cast<size_t>((1 - percentile / 100) * latencies.size());
+    stats.latencyMs = latencies[latencies.size() - 1 - std::min(exclude, latencies.size() - 1)];
+    stats.computeMs = computeMs / latencies.size();
+    stats.throughput = end > start ? latencies.size() * batch / (end - start) * 1000 : 0;
+    return true;
+}
+
+//!
+//! \brief Run the engine for every configuration of the sweep and print their throughput and latency
+//!
+//! Each configuration sets up its own contexts and bindings for the engine and runs closed loop with the warm up and
+//! duration of the inference options. The configurations that no other one beats on both throughput and latency
+//! form the Pareto frontier.
+//!
+//! \return boolean Return true if all the configurations were set up and measured
+//!
+bool runSweep(const AllOptions& options, InferenceEnvironment& iEnv)
+{
+    struct Point
+    {
+        InferenceOptions inference;
+        int batch{0};
+        float throughput{0};
+        float latencyMs{0};
+        float computeMs{0};
+        bool frontier{false};
+    };
+
+    const auto& base = options.inference;
+    const auto streams = base.sweepStreams.empty() ? std::vector<int>{base.streams} : base.sweepStreams;
+    const auto batches = base.sweepBatches.empty() ? std::vector<int>{0} : base.sweepBatches;
+    const auto switches = [](bool swept, bool value)
+    {
+        return swept ? std::vector<bool>{false, true} : std::vector<bool>{value};
+    };
+    std::vector<Point> points;
+    for (const auto s : streams)
+    {
+        for (const auto b : batches)
+        {
+            for (const bool threads : switches(base.sweepThreads, base.threads))
+            {
+                // Threads make a difference with several streams only
+                if (threads && s == 1 && base.sweepThreads)
+                {
+                    continue;
+                }
+                for (const bool graph : switches(base.sweepGraph, base.graph))
+                {
+                    for (const bool spin : switches(base.sweepSpin, base.spin))
+                    {
+                        Point p;
+                        p.inference = base;
+                        p.inference.streams = s;
+                        p.inference.threads = threads;
+                        p.inference.graph = graph;
+                        p.inference.spin = spin;
+                        if (b && base.batch)
+                        {
+                            p.inference.batch = b;
+                        }
+                        else if (b)
+                        {
+                            for (auto& shapes : p.inference.shapes)
+                            {
+                                for (auto& input : shapes)
+                                {
+                                    input.second.d[0] = b;
+                                }
+                            }
+                        }
+                        p.batch = b ? b : std::max(base.batch, 1);
+                        points.push_back(p);
+                    }
+                }
+            }
+        }
+    }
+
+    bool passed{true};
+    for (auto& p : points)
+    {
+        // The configuration runs the engine of the environment with contexts and bindings of its own
+        InferenceEnvironment point;
+        point.engine = std::move(iEnv.engine);
+        const bool setUp = setUpInference(point, p.inference);
+        std::vector<InferenceTrace> trace;
+        if (setUp)
+        {
+            runInference(p.inference, point, trace);
+        }
+        iEnv.engine = std::move(point.engine);
+        if (!setUp)
+        {
+            gLogError << "Inference set up of sweep configuration with " << p.inference.streams << " streams and batch "
+                      << p.batch << " failed" << std::endl;
+            passed = false;
+            continue;
+        }
+
+        ClosedLoopStats stats;
+        const float warmupMs = static_cast<float>(p.inference.warmup);
+        if (closedLoopStats(trace, warmupMs, p.batch, options.reporting.percentile, stats))
+        {
+            p.throughput = stats.throughput;
+            p.latencyMs = stats.latencyMs;
+            p.computeMs = stats.computeMs;
+        }
+    }
+
+    const Point* best{nullptr};
+    for (auto& p : points)
+    {
+        const auto dominates = [&p](const Point& q)
+        {
+            return q.throughput >= p.throughput && q.latencyMs <= p.latencyMs
+                && (q.throughput > p.throughput || q.latencyMs < p.latencyMs);
+        };
+        p.frontier = p.throughput > 0 && std::none_of(points.begin(), points.end(), dominates);
+        if (p.throughput > 0 && (!base.latencyTarget || p.latencyMs <= base.latencyTarget)
+            && (!best || p.throughput > best->throughput))
+        {
+            best = &p;
+        }
+    }
+
+    const auto describe = [](const Point& p)
+    {
+        std::ostringstream os;
+        os << "streams " << p.inference.streams << ", batch " << p.batch << ", threads "
+           << (p.inference.threads ? "on" : "off") << ", graph " << (p.inference.graph ? "on" : "off") << ", spin "
+           << (p.inference.spin ? "on" : "off");
+        return os.str();
+    };
+    gLogInfo << "=== Sweep ===" << std::endl;
+    for (const auto& p : points)
+    {
+// clang-format off
+        gLogInfo << (p.frontier ? "* " : "  ") << describe(p) << ": "
+                    "throughput "   << p.throughput                                        << " qps, "
+                    "host latency " << p.latencyMs << " ms at " << options.reporting.percentile << "%, "
+                    "GPU compute "  << p.computeMs                                         << " ms" << std::endl;
+// clang-format on
+    }
+    gLogInfo << "* Pareto frontier of throughput and latency" << std::endl;
+    if (best)
+    {
+        gLogInfo << "Best throughput";
+        if (base.latencyTarget)
+        {
+            gLogInfo << " under " << base.latencyTarget << " ms at " << options.reporting.percentile << "%";
+        }
+        gLogInfo << ": " << describe(*best) << std::endl;
+    }
+    else if (base.latencyTarget)
+    {
+        gLogInfo << "No configuration meets " << base.latencyTarget << " ms at " << options.reporting.percentile << "%"
+                 << std::endl;
+    }
+    return passed;
+}
+
+//!
+//! \brief Add a stream, and its context, at a time until the device runs out of memory or the throughput stops scaling
+//!
+//! Each step sets up the contexts and bindings of all its streams for the engine and runs closed loop with the warm up
+//! and duration of the inference options, like a sweep. The throughput stops scaling when two steps in a row improve
+//! on the best one by less than --capacityGain. The device memory used is read once the step is set up.
+//!
+//! \return boolean Return true if at least one step was set up and measured
+//!
+bool runCapacity(const AllOptions& options, InferenceEnvironment& iEnv)
+{
+    struct Step
+    {
+        int streams{0};
+        ClosedLoopStats stats;
+        size_t usedBytes{0};
+        size_t freeBytes{0};
+    };
+    const auto deviceMemory = [](size_t& used, size_t& free)
+    {
+        size_t total{0};
+        cudaCheck(cudaMemGetInfo(&free, &total));
+        used = total - free;
+    };
+
+    const auto& base = options.inference;
+    const int batch = std::max(base.batch, 1);
+    const float gain = 1 + base.capacityGain / 100;
+    size_t baseUsed{0};
+    size_t baseFree{0};
+    deviceMemory(baseUsed, baseFree);
+
+    std::vector<Step> steps;
+    const Step* best{nullptr};
+    float bestThroughput{0};
+    int flatSteps{0};
+    std::string stop{"the stream limit is reached"};
+    for (int s = 1; s <= base.capacity; ++s)
+    {
+        InferenceEnvironment step;
+        step.engine = std::move(iEnv.engine);
+        InferenceOptions inference = base;
+        inference.streams = s;
+        const bool setUp = setUpInference(step, inference);
+        Step measured;
+        measured.streams = s;
+        deviceMemory(measured.usedBytes, measured.freeBytes);
+        std::vector<InferenceTrace> trace;
+        if (setUp)
+        {
+            runInference(inference, step, trace);
+        }
+        iEnv.engine = std::move(step.engine);
+        // A set up failure past the first step is the device running out of memory
+        if (!setUp)
+        {
+            stop = "the set up of " + std::to_string(s) + " streams failed";
+            break;
+        }
+        if (!closedLoopStats(trace, static_cast<float>(inference.warmup), batch, options.reporting.percentile,
+                measured.stats))
+        {
+            stop = "no inference of " + std::to_string(s) + " streams completed";
+            break;
+        }
+        steps.push_back(measured);
+
+        const auto& stats = steps.back().stats;
+        flatSteps = stats.throughput > bestThroughput * gain ? 0 : flatSteps + 1;
+        bestThroughput = std::max(bestThroughput, stats.throughput);
+        if (flatSteps == 2)
+        {
+            stop = "the throughput stopped scaling";
+            break;
+        }
+    }
+    for (const auto& st : steps)
+    {
+        if ((!base.latencyTarget || st.stats.latencyMs <= base.latencyTarget)
+            && (!best || st.stats.throughput > best->stats.throughput))
+        {
+            best = &st;
+        }
+    }
+
+    const auto mib = [](size_t bytes) { return bytes / 1048576.0; };
+    gLogInfo << "=== Capacity ===" << std::endl;
+    gLogInfo << "Device memory used before set up: " << mib(baseUsed) << " MiB" << std::endl;
+    for (const auto& st : steps)
+    {
+// clang-format off
+        gLogInfo << (&st == best ? "* " : "  ") << "streams " << st.streams << ": "
+                    "throughput "    << st.stats.throughput                                      << " qps, "
+                    "host latency "  << st.stats.latencyMs << " ms at " << options.reporting.percentile << "%, "
+                    "device memory " << mib(st.usedBytes) << " MiB (+" << mib(st.usedBytes - baseUsed)
+                                     << " MiB), free "  << mib(st.freeBytes)                   << " MiB" << std::endl;
+// clang-format on
+    }
+    gLogInfo << "Stopped after " << steps.size() << " steps: " << stop << std::endl;
+    if (steps.empty())
+    {
+        gLogError << "Inference set up of a single stream failed" << std::endl;
+        return false;
+    }
+    if (!best)
+    {
+        gLogInfo << "No step meets " << base.latencyTarget << " ms at " << options.reporting.percentile << "%"
+                 << std::endl;
+        return true;
+    }
+
+    // The memory of each stream, from the step before the best one, bounds how many more would fit
+    const size_t perStream = best->streams > 1 ? (best->usedBytes - steps[best->streams - 2].usedBytes)
+                                               : best->usedBytes - baseUsed;
+    gLogInfo << "* Best operating point: " << best->streams << " streams, " << best->stats.throughput << " qps";
+    if (base.latencyTarget)
+    {
+        gLogInfo << " under " << base.latencyTarget << " ms at " << options.reporting.percentile << "%";
+    }
+    gLogInfo << std::endl;
+    gLogInfo << "Memory headroom at the best operating point: " << mib(best->freeBytes) << " MiB, "
+             << mib(perStream) << " MiB per stream";
+    if (perStream)
+    {
+        gLogInfo << ", room for about " << best->freeBytes / perStream << " more";
+    }
+    gLogInfo << std::endl;
+    return true;
+}
+
+//!
+//! \brief Run the engine at the default power limit and clocks of the device, then at each setting of the power sweep,
+//!        and print their throughput, latency, power and inferences per joule
+//!
+//! Each setting is applied with NVML before its own contexts and bindings run closed loop with the warm up and
+//! duration of the inference options, like a sweep, and the device goes back to its defaults before the next one.
+//! The power is the mean of the NVML samples past the warm up. A setting that cannot be applied, for lack of
+//! permissions or of support, is reported and skipped.
+//!
+//! \return boolean Return true if the default settings were measured
+//!
+bool runPowerSweep(const AllOptions& options, InferenceEnvironment& iEnv)
+{
+    struct Point
+    {
+        PowerSetting setting; // Neither a limit nor a clock for the default settings
+        bool measured{false};
+        ClosedLoopStats stats;
+        float power{0};      // W
+        float smClock{0};    // MHz
+        float efficiency{0}; // Inferences per joule
+    };
+
+    NvmlControl control(options.system.device);
+    std::ostringstream err;
+    if (!control.open(err))
+    {
+        gLogError << err.str() << "The power sweep requires NVML" << std::endl;
+        return false;
+    }
+
+    InferenceOptions inference = options.inference;
+    if (!inference.telemetry)
+    {
+        inference.telemetry = defaultPowerSweepTelemetry;
+    }
+    const int batch = std::max(inference.batch, 1);
+    const float warmupMs = static_cast<float>(inference.warmup);
+    std::vector<Point> points(1);
+    for (const auto& setting : inference.powerSweep)
+    {
+        Point p;
+        p.setting = setting;
+        points.push_back(p);
+    }
+
+    for (auto& p : points)
+    {
+        control.restore();
+        std::ostringstream reason;
+        const auto& setting = p.setting;
+        const bool applied = setting.smClock ? control.lockSmClock(setting.smClock, reason)
+                                             : !setting.powerLimit || control.setPowerLimit(setting.powerLimit, reason);
+        if (!applied)
+        {
+            gLogWarning << reason.str() << "Skipping the setting" << std::endl;
+            continue;
+        }
+
+        InferenceEnvironment point;
+        point.engine = std::move(iEnv.engine);
+        const bool setUp = setUpInference(point, inference);
+        std::vector<InferenceTrace> trace;
+        if (setUp)
+        {
+            runInference(inference, point, trace);
+        }
+        iEnv.engine = std::move(point.engine);
+        if (!setUp)
+        {
+            gLogError << "Inference set up of the power sweep failed" << std::endl;
+            return false;
+        }
+        if (!closedLoopStats(trace, warmupMs, batch, options.reporting.percentile, p.stats))
+        {
+            continue;
+        }
+        p.measured = true;
+
+        int samples{0};
+        for (const auto& s : point.telemetry)
+        {
+            if (s.timeMs >= warmupMs)
+            {
+                p.power += s.power;
+                p.smClock += s.smClock;
+                ++samples;
+            }
+        }
+        if (samples)
+        {
+            p.power /= samples;
+            p.smClock /= samples;
+        }
+        p.efficiency = p.power > 0 ? p.stats.throughput / p.power : 0;
+    }
+    control.restore();
+
+    const auto& base = options.inference;
+    const Point* best{nullptr};
+    for (const auto& p : points)
+    {
+        if (p.efficiency > 0 && (!base.latencyTarget || p.stats.latencyMs <= base.latencyTarget)
+            && p.stats.throughput >= base.throughputTarget && (!best || p.efficiency > best->efficiency))
+        {
+            best = &p;
+        }
+    }
+
+    const auto describe = [](const Point& p)
+    {
+        std::ostringstream os;
+        if (p.setting.smClock)
+        {
+            os << "SM clock " << p.setting.smClock << " MHz";
+        }
+        else if (p.setting.powerLimit)
+        {
+            os << "power limit " << p.setting.powerLimit << " W";
+        }
+        else
+        {
+            os << "default";
+        }
+        return os.str();
+    };
+    gLogInfo << "=== Power Sweep ===" << std::endl;
+    gLogInfo << "Default power limit of device " << options.system.device << ": " << control.getPowerLimit() << " W"
+             << std::endl;
+    for (const auto& p : points)
+    {
+        gLogInfo << (&p == best ? "* " : "  ") << describe(p) << ": ";
+        if (!p.measured)
+        {
+            gLogInfo << "not measured" << std::endl;
+            continue;
+        }
+// clang-format off
+        gLogInfo << "throughput "   << p.stats.throughput                                        << " qps, "
+                    "host latency " << p.stats.latencyMs << " ms at " << options.reporting.percentile << "%, "
+                    "power "        << p.power                                                   << " W, "
+                    "SM clock "     << p.smClock                                                 << " MHz, "
+                                    << p.efficiency                             << " inferences per joule" << std::endl;
+// clang-format on
+    }
+    if (!points.front().measured)
+    {
+        gLogError << "No inference at the default settings completed" << std::endl;
+        return false;
+    }
+
+    std::ostringstream targets;
+    if (base.throughputTarget)
+    {
+        targets << " with at least " << base.throughputTarget << " qps";
+    }
+    if (base.latencyTarget)
+    {
+        targets << (base.throughputTarget ? " and" : "") << " under " << base.latencyTarget << " ms at "
+                << options.reporting.percentile << "%";
+    }
+    if (!best)
+    {
+        const bool readings = std::any_of(points.begin(), points.end(), [](const Point& p) { return p.power > 0; });
+        gLogInfo << (readings ? "No setting meets the targets" : "NVML reported no power readings") << std::endl;
+        return true;
+    }
+    const Point& reference = points.front();
+    gLogInfo << "* Most efficient setting" << targets.str() << ": " << describe(*best) << ", " << best->efficiency
+             << " inferences per joule";
+    if (reference.efficiency > 0)
+    {
+        gLogInfo << ", " << reference.efficiency / best->efficiency * 100 << "% of the default energy per inference "
+                 << "at " << best->stats.throughput / reference.stats.throughput * 100 << "% of its throughput";
+    }
+    gLogInfo << std::endl;
+    return true;
+}
+
+void printSharedMemory(const InferenceEnvironment& iEnv)
+{
+    if (iEnv.sharedMemory)
+    {
+        const auto& memory = *iEnv.sharedMemory;
+        gLogInfo << "Shared device memory: " << memory.size() / 1048576.0 << " MiB instead of "
+                 << memory.separateSize() / 1048576.0 << " MiB for separate contexts" << std::endl;
+    }
+}
+
+//!
+//! \brief Run the GPU engine and an engine on each DLA core at once, with the requests split by their throughput
+//!
+//! The engines of the DLA cores are built with the options of the GPU one, and saved next to it with a .dla<N> suffix.
+//! A one second closed loop run of all the engines measures their throughput, which weights the share of the offered
+//! request rate each engine serves in the timed run.
+//!
+bool runHeterogeneous(const AllOptions& options, InferenceEnvironment& iEnv, IGpuAllocator* allocator)
+{
+    std::vector<std::unique_ptr<InferenceEnvironment>> dlaEnvs;
+    std::vector<InferenceEnvironment*> iEnvs{&iEnv};
+    std::vector<std::string> names{"GPU"};
+    for (const auto core : options.system.DLACores)
+    {
+        SystemOptions sys = options.system;
+        sys.DLACore = core;
+        BuildOptions build = options.build;
+        build.engine += ".dla" + std::to_string(core);
+        dlaEnvs.emplace_back(new InferenceEnvironment);
+        dlaEnvs.back()->engine = getEngine(options.model, build, sys, gLogError, allocator);
+        if (!dlaEnvs.back()->engine)
+        {
+            gLogError << "Engine set up on DLA core " << core << " failed" << std::endl;
+            return false;
+        }
+        iEnvs.push_back(dlaEnvs.back().get());
+        names.push_back("DLA " + std::to_string(core));
+    }
+    for (size_t e = 0; e < iEnvs.size(); ++e)
+    {
+        if (!setUpInference(*iEnvs[e], options.inference))
+        {
+            gLogError << "Inference set up of the " << names[e] << " engine failed" << std::endl;
+            return false;
+        }
+    }
+
+    InferenceOptions probe = options.inference;
+    probe.qps = 0;
+    probe.warmup = 0;
+    probe.duration = 1;
+    probe.telemetry = 0;
+    std::vector<InferenceTrace> trace;
+    runHeterogeneous(probe, iEnvs, std::vector<float>(iEnvs.size(), 1.0F), trace);
+    std::vector<float> weights(iEnvs.size(), 0.0F);
+    for (const auto& t : trace)
+    {
+        weights[t.device] += t.batch ? t.batch : std::max(options.inference.batch, 1);
+    }
+    const float total = std::max(std::accumulate(weights.begin(), weights.end(), 0.0F), 1.0F);
+    gLogInfo << "Request split:";
+    for (size_t e = 0; e < iEnvs.size(); ++e)
+    {
+        // An engine too slow to complete an inference in the probe still serves a minimal share
+        weights[e] = std::max(weights[e], total * 0.01F);
+        gLogInfo << " " << names[e] << " " << weights[e] / total * 100 << "%";
+    }
+    gLogInfo << std::endl;
+
+    runHeterogeneous(options.inference, iEnvs, weights, trace);
+    const float warmupMs = static_cast<float>(options.inference.warmup);
+    const int queries = options.inference.batch;
+    printPerformanceReport(trace, options.reporting, warmupMs, queries, options.inference.qps, gLogInfo);
+    printHeterogeneousReport(trace, names, options.reporting, warmupMs, queries, gLogInfo);
+    printTelemetryReport(iEnv.telemetry, warmupMs, gLogInfo);
+    return true;
+}
+
+//!
+//! \brief Run the main engine and the --coEngine ones at once on the device, and report the latency of each
+//!
+//! Each engine runs its own streams, request rate and stream priority, with the other inference options of the main
+//! one. The engines compete for the device, the report shows what the priorities keep of the latency of each.
+//!
+bool runCoEngines(const AllOptions& options, InferenceEnvironment& iEnv, IGpuAllocator* allocator)
+{
+    int leastPriority{0};
+    int greatestPriority{0};
+    cudaCheck(cudaDeviceGetStreamPriorityRange(&leastPriority, &greatestPriority));
+    gLogInfo << "Stream priorities of the device: " << greatestPriority << " (highest) to " << leastPriority
+             << " (lowest)" << std::endl;
+
+    std::vector<std::unique_ptr<InferenceEnvironment>> coEnvs;
+    std::vector<InferenceEnvironment*> iEnvs{&iEnv};
+    std::vector<InferenceOptions> inferences{options.inference};
+    std::vector<std::string> names{options.build.engine.empty() ? "Main engine" : options.build.engine};
+    std::vector<EngineLoad> loads(options.inference.coEngines.size());
+    for (size_t e = 0; e < loads.size(); ++e)
+    {
+        loads[e].file = options.inference.coEngines[e].engine;
+        loads[e].device = options.system.device;
+        // Contexts sharing their device memory are created by setUpInference
+        loads[e].contexts = options.inference.shareMemory ? 0 : options.inference.coEngines[e].streams;
+    }
+    EngineLoadStats loadStats;
+    if (!loadEngines(loads, options.system.DLACore, options.inference.loadThreads, loadStats, gLogError, allocator))
+    {
+        gLogError << "Loading of the concurrent engines failed" << std::endl;
+        return false;
+    }
+    printEngineLoadReport(loads, loadStats, gLogInfo);
+    for (size_t e = 0; e < loads.size(); ++e)
+    {
+        const auto& co = options.inference.coEngines[e];
+        coEnvs.emplace_back(new InferenceEnvironment);
+        coEnvs.back()->engine = std::move(loads[e].engine);
+        coEnvs.back()->context = std::move(loads[e].context);
+        iEnvs.push_back(coEnvs.back().get());
+        inferences.push_back(options.inference);
+        inferences.back().streams = co.streams;
+        inferences.back().qps = co.qps;
+        inferences.back().priority = co.priority;
+        names.push_back(co.engine);
+    }
+    for (size_t e = 0; e < iEnvs.size(); ++e)
+    {
+        if (!setUpInference(*iEnvs[e], inferences[e]))
+        {
+            gLogError << "Inference set up of " << names[e] << " failed" << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<InferenceTrace> trace;
+    runConcurrent(inferences, iEnvs, trace);
+    const float warmupMs = static_cast<float>(options.inference.warmup);
+    const int queries = options.inference.batch;
+    printHeterogeneousReport(trace, names, options.reporting, warmupMs, queries, gLogInfo);
+    for (size_t e = 0; e < iEnvs.size(); ++e)
+    {
+        std::vector<InferenceTrace> engineTrace;
+        std::copy_if(trace.begin(), trace.end(), std::back_inserter(engineTrace),
+            [e](const InferenceTrace& t) { return t.device == static_cast<int>(e); });
+        gLogInfo << "=== " << names[e] << " (" << inferences[e].streams << " streams, priority "
+                 << inferences[e].priority << ") ===" << std::endl;
+        printPerformanceReport(engineTrace, options.reporting, warmupMs, queries, inferences[e].qps, gLogInfo);
+    }
+    printTelemetryReport(iEnv.telemetry, warmupMs, gLogInfo);
+    return true;
+}
+
+//!
+//! \brief Run the main engine and the --pipelineStage engines, each on its own device, as a pipeline of micro-batches
+//!
+//! The main engine is the first stage, on --device. The report covers the queries through the whole pipeline, then
+//! the compute and transfer time of each stage and the stage that bounds the throughput.
+//!
+bool runStagePipeline(const AllOptions& options, InferenceEnvironment& iEnv)
+{
+    std::vector<StagePipeline::Stage> stages{{iEnv.engine.get(), options.system.device}};
+    std::vector<std::string> names{options.build.engine.empty() ? "Main engine" : options.build.engine};
+    std::vector<int> devices{options.system.device};
+    // The stages create their context on their device when the pipeline is set up
+    std::vector<EngineLoad> loads(options.inference.pipelineStages.size());
+    for (size_t s = 0; s < loads.size(); ++s)
+    {
+        loads[s].file = options.inference.pipelineStages[s].engine;
+        loads[s].device = options.inference.pipelineStages[s].device;
+    }
+    EngineLoadStats loadStats;
+    if (!loadEngines(loads, options.system.DLACore, options.inference.loadThreads, loadStats, gLogError))
+    {
+        gLogError << "Loading of the pipeline stages failed" << std::endl;
+        return false;
+    }
+    printEngineLoadReport(loads, loadStats, gLogInfo);
+    for (const auto& load : loads)
+    {
+        stages.push_back({load.engine.get(), load.device});
+        names.push_back(load.file);
+        devices.push_back(load.device);
+    }
+
+    StagePipeline pipeline;
+    const bool setUp = pipeline.setUp(stages, options.inference, gLogError);
+    cudaCheck(cudaSetDevice(options.system.device));
+    if (!setUp)
+    {
+        gLogError << "Pipeline set up failed" << std::endl;
+        return false;
+    }
+
+    std::vector<InferenceTrace> trace;
+    std::vector<StageTrace> stageTrace;
+    pipeline.run(options.inference, trace, stageTrace);
+    const float warmupMs = static_cast<float>(options.inference.warmup);
+    printPerformanceReport(trace, options.reporting, warmupMs, options.inference.batch, 0, gLogInfo);
+    printPipelineReport(stageTrace, names, devices, pipeline.getPeerAccess(), warmupMs, gLogInfo);
+    if (!options.reporting.exportTimes.empty())
+    {
+        exportJSONTrace(trace, options.reporting.exportTimes);
+        exportJSONStageTrace(stageTrace, options.reporting.exportTimes + ".stages.json");
+    }
+    return true;
+}
+
+//!
+//! \brief Run the main engine on every item of a batch and the --cascade engine on the items it selects
+//!
+//! The report covers the batches through both stages, then the positives and the time of each stage.
+//!
+bool runCascade(const AllOptions& options, InferenceEnvironment& iEnv, IGpuAllocator* allocator)
+{
+    TrtUniquePtr<ICudaEngine> second{
+        loadEngine(options.inference.cascade.engine, options.system.DLACore, gLogError, allocator)};
+    if (!second)
+    {
+        gLogError << "Loading of the cascade engine failed" << std::endl;
+        return false;
+    }
+    Cascade cascade;
+    if (!cascade.setUp(*iEnv.engine, *second, options.inference, gLogError))
+    {
+        gLogError << "Cascade set up failed" << std::endl;
+        return false;
+    }
+
+    std::vector<InferenceTrace> trace;
+    std::vector<CascadeTrace> cascadeTrace;
+    cascade.run(options.inference, trace, cascadeTrace);
+    const float warmupMs = static_cast<float>(options.inference.warmup);
+    printPerformanceReport(trace, options.reporting, warmupMs, cascade.getItems(), 0, gLogInfo);
+    printCascadeReport(cascadeTrace, cascade.getItems(), warmupMs, gLogInfo);
+    if (!options.reporting.exportTimes.empty())
+    {
+        exportJSONTrace(trace, options.reporting.exportTimes);
+    }
+    return true;
+}
+
+//!
+//! \brief Search the layers that can run in a lower precision with the outputs within tolerance of a reference
+//!
+//! The search starts from the model with every layer in fp32, layers of --layerPrecisions keep their precision. The
+//! layers of the engine are tried in order of decreasing profiled time, those taking less than 1% of it are left in
+//! fp32. The network layers fused into an engine layer move together, to int8 with --int8, falling back to fp16 with
+//! --fp16, and each move is kept if the outputs of the rebuilt engine stay within tolerance.
+//!
+//! \return boolean Return true if the fp32 engine matches the reference and the precisions were exported
+//!
+bool runPrecisionSearch(const AllOptions& options, IGpuAllocator* allocator)
+{
+    OutputValues reference;
+    std::vector<std::string> names;
+    if (!importJSONOutput(options.build.precisionSearch, reference, gLogError)
+        || !getLayerNames(options.model, options.build, names, gLogError))
+    {
+        return false;
+    }
+
+    struct Evaluation
+    {
+        float error{std::numeric_limits<float>::infinity()};
+        float computeMs{0};
+        std::vector<LayerProfile> layers;
+    };
+    BuildOptions build = options.build;
+    build.save = false;
+    const auto evaluate = [&](Evaluation& evaluation)
+    {
+        InferenceEnvironment iEnv;
+        iEnv.engine = getEngine(options.model, build, options.system, gLogError, allocator);
+        iEnv.profiler.reset(new Profiler);
+        if (!iEnv.engine || !setUpInference(iEnv, options.inference))
+        {
+            return false;
+        }
+        std::vector<InferenceTrace> trace;
+        runInference(options.inference, iEnv, trace);
+        evaluation.error = outputError(getOutputValues(*iEnv.bindings.front()), reference);
+        evaluation.layers = iEnv.profiler->getContextLayers(0);
+        int count{0};
+        for (const auto& t : trace)
+        {
+            if (t.computeStart >= options.inference.warmup)
+            {
+                evaluation.computeMs += traceToTiming(t).compute;
+                ++count;
+            }
+        }
+        evaluation.computeMs /= std::max(count, 1);
+        return true;
+    };
+
+    for (const auto& name : names)
+    {
+        build.layerPrecisions.emplace(name, DataType::kFLOAT);
+    }
+    Evaluation base;
+    if (!evaluate(base))
+    {
+        gLogError << "The fp32 engine of the precision search could not be built or run" << std::endl;
+        return false;
+    }
+    const float tolerance = options.build.precisionTolerance;
+    gLogInfo << "Precision search: fp32 engine error " << base.error << ", GPU compute " << base.computeMs << " ms"
+             << std::endl;
+    if (!(base.error <= tolerance))
+    {
+        gLogError << "The fp32 engine is beyond tolerance " << tolerance << " of the reference outputs" << std::endl;
+        return false;
+    }
+
+    // Engine layers are named after the network layers fused into them
+    std::vector<LayerProfile> candidates = base.layers;
+    std::sort(candidates.begin(), candidates.end(),
+        [](const LayerProfile& a, const LayerProfile& b) { return a.timeMs > b.timeMs; });
+    const float totalMs = std::accumulate(candidates.begin(), candidates.end(), 0.F,
+        [](float total, const LayerProfile& l) { return total + l.timeMs; });
+    std::vector<DataType> lowered;
+    if (options.build.int8)
+    {
+        lowered.push_back(DataType::kINT8);
+    }
+    if (options.build.fp16)
+    {
+        lowered.push_back(DataType::kHALF);
+    }
+    Evaluation best = base;
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.timeMs < 0.01F * totalMs)
+        {
+            break;
+        }
+        std::vector<std::string> group;
+        std::istringstream fusedNames(candidate.name);
+        std::string name;
+        while (std::getline(fusedNames, name, '+'))
+        {
+            name.erase(0, name.find_first_not_of(' '));
+            name.erase(name.find_last_not_of(' ') + 1);
+            const auto precision = build.layerPrecisions.find(name);
+            // Layers pinned by --layerPrecisions are not searched
+            if (precision != build.layerPrecisions.end() && !options.build.layerPrecisions.count(name))
+            {
+                group.push_back(name);
+            }
+        }
+        if (group.empty())
+        {
+            continue;
+        }
+        for (const auto precision : lowered)
+        {
+            for (const auto& name : group)
+            {
+                build.layerPrecisions[name] = precision;
+            }
+            Evaluation evaluation;
+            const bool accepted = evaluate(evaluation) && evaluation.error <= tolerance;
+            gLogInfo << "Precision search: " << candidate.name << " in " << precision << ", error " << evaluation.error
+                     << (accepted ? ", kept" : ", rejected") << std::endl;
+            if (accepted)
+            {
+                best = evaluation;
+                break;
+            }
+            for (const auto& name : group)
+            {
+                build.layerPrecisions[name] = DataType::kFLOAT;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, DataType>> precisions;
+    std::map<DataType, int> counts;
+    for (const auto& name : names)
+    {
+        precisions.emplace_back(name, build.layerPrecisions[name]);
+        ++counts[precisions.back().second];
+    }
+    gLogInfo << "Precision search: GPU compute " << best.computeMs << " ms, from " << base.computeMs << " ms in fp32, "
+             << "error " << best.error << ", layers";
+    for (const auto& c : counts)
+    {
+        gLogInfo << " " << c.first << " " << c.second;
+    }
+    gLogInfo << std::endl;
+    return options.build.exportLayerPrecisions.empty()
+        || saveLayerPrecisions(precisions, options.build.exportLayerPrecisions, gLogError);
+}
+
+//!
+//! \brief Search the I/O formats with the lowest end to end latency, host conversions from and to linear fp32 included
+//!
+//! Each format of the enabled precisions is tried on all the inputs that can take it, with the outputs in linear fp32,
+//! then on the outputs with the fastest inputs. The end to end latency of a configuration is its mean latency,
+//! transfers included, plus the time the host takes to convert linear fp32 data to the formats of the inputs and back
+//! from the formats of the outputs. The fastest engine is saved with --saveEngine.
+//!
+//! \return boolean Return true if the linear fp32 engine was built and run, and the fastest engine saved
+//!
+bool runFormatSearch(const AllOptions& options, IGpuAllocator* allocator)
+{
+    NetworkDescription network;
+    if (!describeNetwork(options.model, options.build, network, gLogError))
+    {
+        return false;
+    }
+    std::vector<IOFormat> candidates;
+    const auto format = [](DataType type, TensorFormat f) { return IOFormat{type, 1U << static_cast<int>(f)}; };
+    if (options.build.fp16)
+    {
+        candidates.push_back(format(DataType::kHALF, TensorFormat::kCHW2));
+        candidates.push_back(format(DataType::kHALF, TensorFormat::kHWC8));
+    }
+    if (options.build.int8)
+    {
+        candidates.push_back(format(DataType::kINT8, TensorFormat::kCHW4));
+        candidates.push_back(format(DataType::kINT8, TensorFormat::kCHW32));
+    }
+    // Tensors that cannot take a candidate stay in their type, linear
+    const auto assign = [&network, &format](const std::vector<NetworkTensor>& tensors, const IOFormat* candidate)
+    {
+        std::vector<IOFormat> formats;
+        for (const auto& t : tensors)
+        {
+            const bool fits = candidate && formatFits(t, network.implicitBatch, *candidate);
+            formats.push_back(fits ? *candidate : format(t.type, TensorFormat::kLINEAR));
+        }
+        return formats;
+    };
+    const auto describe = [](const std::vector<IOFormat>& formats)
+    {
+        std::ostringstream list;
+        for (size_t f = 0; f < formats.size(); ++f)
+        {
+            list << (f ? "," : "") << formats[f];
+        }
+        return list.str();
+    };
+
+    struct Evaluation
+    {
+        std::vector<IOFormat> inputs;
+        std::vector<IOFormat> outputs;
+        float latencyMs{std::numeric_limits<float>::infinity()};
+        float conversionMs{0};
+        TrtUniquePtr<ICudaEngine> engine;
+
+        float endToEndMs() const
+        {
+            return latencyMs + conversionMs;
+        }
+    };
+    BuildOptions build = options.build;
+    build.save = false;
+    const auto evaluate = [&](Evaluation& evaluation)
+    {
+        build.inputFormats = evaluation.inputs;
+        build.outputFormats = evaluation.outputs;
+        InferenceEnvironment iEnv;
+        iEnv.engine = getEngine(options.model, build, options.system, gLogError, allocator);
+        if (!iEnv.engine || !setUpInference(iEnv, options.inference))
+        {
+            gLogInfo << "I/O format search: inputs " << describe(evaluation.inputs) << ", outputs "
+                     << describe(evaluation.outputs) << " could not be built or run" << std::endl;
+            return false;
+        }
+        std::vector<InferenceTrace> trace;
+        runInference(options.inference, iEnv, trace);
+        float latencyMs{0};
+        int count{0};
+        for (const auto& t : trace)
+        {
+            if (t.computeStart >= options.inference.warmup)
+            {
+                latencyMs += traceToTiming(t).latency();
+                ++count;
+            }
+        }
+        evaluation.latencyMs = count ? latencyMs / count : std::numeric_limits<float>::infinity();
+
+        const auto& engine = *iEnv.engine;
+        const auto& context = *iEnv.context.front();
+        const int batch = engine.hasImplicitBatchDimension() ? std::max(options.inference.batch, 1) : 1;
+        const int bindingsInProfile = engine.getNbBindings() / std::max(engine.getNbOptimizationProfiles(), 1);
+        evaluation.conversionMs = 0;
+        for (int b = 0; b < bindingsInProfile; ++b)
+        {
+            const bool input = engine.bindingIsInput(b);
+            const auto& tensors = input ? network.inputs : network.outputs;
+            const auto& formats = input ? evaluation.inputs : evaluation.outputs;
+            const std::string name = engine.getBindingName(b);
+            for (size_t t = 0; t < tensors.size(); ++t)
+            {
+                if (tensors[t].name == name)
+                {
+                    evaluation.conversionMs
+                        += hostConversionMs(context.getBindingDimensions(b), batch, formats[t], input);
+                }
+            }
+        }
+        gLogInfo << "I/O format search: inputs " << describe(evaluation.inputs) << ", outputs "
+                 << describe(evaluation.outputs) << ": latency " << evaluation.latencyMs << " ms + host conversion "
+                 << evaluation.conversionMs << " ms = " << evaluation.endToEndMs() << " ms" << std::endl;
+        evaluation.engine = std::move(iEnv.engine);
+        return true;
+    };
+
+    Evaluation best;
+    best.inputs = assign(network.inputs, nullptr);
+    best.outputs = assign(network.outputs, nullptr);
+    if (!evaluate(best))
+    {
+        gLogError << "The linear fp32 engine of the I/O format search could not be built or run" << std::endl;
+        return false;
+    }
+    const float baseMs = best.endToEndMs();
+    for (const bool inputs : {true, false})
+    {
+        for (const auto& candidate : candidates)
+        {
+            Evaluation evaluation;
+            evaluation.inputs = inputs ? assign(network.inputs, &candidate) : best.inputs;
+            evaluation.outputs = inputs ? best.outputs : assign(network.outputs, &candidate);
+            // Candidates no tensor can take are the configuration already measured
+            if (evaluation.inputs == best.inputs && evaluation.outputs == best.outputs)
+            {
+                continue;
+            }
+            if (evaluate(evaluation) && evaluation.endToEndMs() < best.endToEndMs())
+            {
+                best = std::move(evaluation);
+            }
+        }
+    }
+
+    gLogInfo << "I/O format search: fastest --inputIOFormats=" << describe(best.inputs)
+             << " --outputIOFormats=" << describe(best.outputs) << ", " << best.endToEndMs() << " ms end to end, from "
+             << baseMs << " ms in linear fp32" << std::endl;
+    return !options.build.save || saveEngine(*best.engine, options.build.engine, gLogError, options.build.compression);
+}
+
+//!
+//! \brief Search the smallest builder workspace whose engine stays within a latency tolerance of the given workspace
+//!
+//! The model is built with --workspace, then with half the workspace at a time down to 0 MB, and each engine is run
+//! with the inference options. The search stops at the first workspace whose mean latency exceeds the latency with
+//! --workspace by more than the tolerance: tactics that fit in a workspace fit in any larger one, so smaller ones are
+//! not faster. The latency and the device memory of each size are reported, and the engine of the smallest workspace
+//! within the tolerance saved with --saveEngine. With --engineCache, the engines of a repeated search are reused.
+//!
+//! \return boolean Return true if the engine with --workspace was built and run, and the smallest engine saved
+//!
+bool runWorkspaceSearch(const AllOptions& options, IGpuAllocator* allocator)
+{
+    struct Evaluation
+    {
+        int workspace{0};
+        float latencyMs{std::numeric_limits<float>::infinity()};
+        size_t deviceMemory{0};
+        TrtUniquePtr<ICudaEngine> engine;
+    };
+    BuildOptions build = options.build;
+    build.save = false;
+    const auto evaluate = [&](Evaluation& evaluation)
+    {
+        build.workspace = evaluation.workspace;
+        InferenceEnvironment iEnv;
+        iEnv.engine = getEngine(options.model, build, options.system, gLogError, allocator);
+        if (!iEnv.engine || !setUpInference(iEnv, options.inference))
+        {
+            gLogInfo << "Workspace search: " << evaluation.workspace << " MB could not be built or run" << std::endl;
+            return false;
+        }
+        std::vector<InferenceTrace> trace;
+        runInference(options.inference, iEnv, trace);
+        float latencyMs{0};
+        int count{0};
+        for (const auto& t : trace)
+        {
+            if (t.computeStart >= options.inference.warmup)
+            {
+                latencyMs += traceToTiming(t).latency();
+                ++count;
+            }
+        }
+        evaluation.latencyMs = count ? latencyMs / count : std::numeric_limits<float>::infinity();
+        evaluation.deviceMemory = iEnv.engine->getDeviceMemorySize();
+        evaluation.engine = std::move(iEnv.engine);
+        return true;
+    };
+
+    Evaluation best;
+    best.workspace = options.build.workspace;
+    if (!evaluate(best))
+    {
+        gLogError << "The engine with the workspace of " << best.workspace << " MB could not be built or run"
+                  << std::endl;
+        return false;
+    }
+    const float baseMs = best.latencyMs;
+    const float limitMs = baseMs * (1 + options.build.workspaceSearch / 100);
+    const auto report = [baseMs](const Evaluation& evaluation)
+    {
+        gLogInfo << "Workspace search: " << std::setw(6) << evaluation.workspace << " MB, device memory "
+                 << std::setw(8) << (evaluation.deviceMemory >> 20) << " MB, latency " << evaluation.latencyMs
+                 << " ms (" << std::showpos << 100 * (evaluation.latencyMs / baseMs - 1) << std::noshowpos << "%)"
+                 << std::endl;
+    };
+    report(best);
+    for (int workspace = best.workspace / 2; best.workspace > 0; workspace /= 2)
+    {
+        Evaluation evaluation;
+        evaluation.workspace = workspace;
+        if (!evaluate(evaluation))
+        {
+            break;
+        }
+        report(evaluation);
+        if (evaluation.latencyMs > limitMs)
+        {
+            break;
+        }
+        best = std::move(evaluation);
+    }
+
+    gLogInfo << "Workspace search: smallest --workspace=" << best.workspace << " within "
+             << options.build.workspaceSearch << "%, " << best.latencyMs << " ms from " << baseMs << " ms with "
+             << options.build.workspace << " MB" << std::endl;
+    return !options.build.save || saveEngine(*best.engine, options.build.engine, gLogError, options.build.compression);
+}
+
+} // namespace
+
 int main(int argc, char** argv)
 {
+    using clock = std::chrono::high_resolution_clock;
+    const auto mainStart = clock::now();
     const std::string sampleName = "TensorRT.trtexec";
-    const std::string supportNote{"Note: CUDA graphs is not supported in this version."};
 
     auto sampleTest = gLogger.defineTest(sampleName, argc, argv);
 
@@ -67,7 +1458,7 @@ int main(int argc, char** argv)
             {
                 for (const auto& arg : args)
                 {
-                    gLogError << "Unknown option: " << arg.first << " " << arg.second << std::endl;
+                    gLogError << "Unknown option: " << arg.first << " " << arg.second.first << std::endl;
                 }
                 failed = true;
             }
@@ -81,7 +1472,6 @@ int main(int argc, char** argv)
         if (failed)
         {
             AllOptions::help(std::cout);
-            std::cout << supportNote << std::endl;
             return gLogger.reportFail(sampleTest);
         }
     }
@@ -93,7 +1483,25 @@ int main(int argc, char** argv)
     if (options.helps)
     {
         AllOptions::help(std::cout);
-        std::cout << supportNote << std::endl;
+        return gLogger.reportPass(sampleTest);
+    }
+
+    if (!options.reporting.mergeHistograms.empty())
+    {
+        LatencyHistograms merged;
+        for (const auto& file : options.reporting.mergeHistograms)
+        {
+            if (!importHistograms(file, merged))
+            {
+                gLogError << "Could not read histograms from " << file << std::endl;
+                return gLogger.reportFail(sampleTest);
+            }
+        }
+        printHistograms(merged, gLogInfo);
+        if (!options.reporting.exportHistograms.empty())
+        {
+            exportHistograms(merged, options.reporting.exportHistograms);
+        }
         return gLogger.reportPass(sampleTest);
     }
 
@@ -103,7 +1511,50 @@ int main(int argc, char** argv)
         setReportableSeverity(Severity::kVERBOSE);
     }
 
+    if (options.inference.driverAffinity)
+    {
+        // The driver threads start with the contexts, which are created before anything else runs on the devices
+        const auto& devices = options.system.devices;
+        for (const auto device : devices.empty() ? std::vector<int>{options.system.device} : devices)
+        {
+            const auto cpus = options.inference.numaAffinity ? deviceLocalCpus(device) : options.inference.affinity;
+            if (!createPinnedContext(device, cpus))
+            {
+                gLogWarning << "Could not pin the driver threads of device " << device << std::endl;
+            }
+        }
+    }
     cudaSetDevice(options.system.device);
+    if (options.reporting.startup)
+    {
+        // The context is otherwise created by the first CUDA call that needs it, inside one of the later phases
+        cudaFree(nullptr);
+    }
+    const auto cudaEnd = clock::now();
+
+    // The pool outlives the engine and the plugins which release memory into it
+    std::unique_ptr<TrtCudaMemoryPool> memPool;
+    if (options.system.memPool)
+    {
+        memPool.reset(new TrtCudaMemoryPool);
+        setLibNvInferPluginsGpuAllocator(memPool.get());
+    }
+    // The account forwards to the pool, TensorRT and the plugins each allocate through an allocator of their own
+    std::unique_ptr<TrtCudaMemoryAccount> memAccount;
+    IGpuAllocator* allocator = memPool.get();
+    if (options.reporting.memory)
+    {
+        memAccount.reset(new TrtCudaMemoryAccount(memPool.get()));
+        allocator = memAccount->getAllocator(TrtCudaMemoryAccount::Owner::kTENSORRT);
+        setLibNvInferPluginsGpuAllocator(memAccount->getAllocator(TrtCudaMemoryAccount::Owner::kPLUGINS));
+        memAccount->beginPhase("Plugins");
+    }
+    std::unique_ptr<TrtPinnedHostPool> hostPool;
+    if (options.system.hostPool)
+    {
+        hostPool.reset(new TrtPinnedHostPool(options.system.device));
+        hostPool->install();
+    }
 
     initLibNvInferPlugins(&gLogger.getTRTLogger(), "");
 
@@ -112,18 +1563,98 @@ int main(int argc, char** argv)
         gLogInfo << "Loading supplied plugin library: " << pluginPath << std::endl;
         samplesCommon::loadLibrary(pluginPath);
     }
+    const auto pluginsEnd = clock::now();
+
+    const char* gemmAlgoCache = options.build.gemmAlgoCache.c_str();
+    if (!options.build.gemmAlgoCache.empty() && !loadLibNvInferPluginsGemmAlgoCache(gemmAlgoCache))
+    {
+        gLogWarning << "Could not read GEMM algorithm cache " << gemmAlgoCache << ", starting an empty one" << std::endl;
+    }
+
+    if (!options.build.matrixPrecisions.empty())
+    {
+        return runBuildMatrix(options) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (!options.build.precisionSearch.empty())
+    {
+        return runPrecisionSearch(options, allocator) ? gLogger.reportPass(sampleTest)
+                                                      : gLogger.reportFail(sampleTest);
+    }
+    if (options.build.formatSearch)
+    {
+        return runFormatSearch(options, allocator) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (options.build.workspaceSearch > 0)
+    {
+        return runWorkspaceSearch(options, allocator) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
 
     InferenceEnvironment iEnv;
-    iEnv.engine = getEngine(options.model, options.build, options.system, gLogError);
+    const std::chrono::duration<float, std::milli> cudaTime = cudaEnd - mainStart;
+    const std::chrono::duration<float, std::milli> pluginsTime = pluginsEnd - cudaEnd;
+    iEnv.startup.cudaMs = cudaTime.count();
+    iEnv.startup.pluginsMs = pluginsTime.count();
+    if (memAccount)
+    {
+        memAccount->beginPhase("Engine");
+        iEnv.memoryAccount = memAccount.get();
+    }
+    iEnv.engine = getEngine(options.model, options.build, options.system, gLogError, allocator, &iEnv.startup);
     if (!iEnv.engine)
     {
         gLogError << "Engine set up failed" << std::endl;
         return gLogger.reportFail(sampleTest);
     }
+    if (!options.build.gemmAlgoCache.empty() && !saveLibNvInferPluginsGemmAlgoCache(gemmAlgoCache))
+    {
+        gLogWarning << "Could not write GEMM algorithm cache " << gemmAlgoCache << std::endl;
+    }
+    if (!options.build.histogram.empty())
+    {
+        printProfileRouting(ProfileRouter(*iEnv.engine), options.build.histogram, gLogInfo);
+    }
+    if (!options.build.refit.empty())
+    {
+        return runRefit(options, iEnv) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
     if (options.inference.skip)
     {
         return gLogger.reportPass(sampleTest);
     }
+    if (!options.inference.swapEngine.empty())
+    {
+        return runHotSwap(options, iEnv, allocator) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (options.inference.sweep)
+    {
+        return runSweep(options, iEnv) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (options.inference.capacity)
+    {
+        return runCapacity(options, iEnv) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (!options.inference.powerSweep.empty())
+    {
+        return runPowerSweep(options, iEnv) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (!options.system.DLACores.empty())
+    {
+        return runHeterogeneous(options, iEnv, allocator) ? gLogger.reportPass(sampleTest)
+                                                           : gLogger.reportFail(sampleTest);
+    }
+    if (!options.inference.coEngines.empty())
+    {
+        return runCoEngines(options, iEnv, allocator) ? gLogger.reportPass(sampleTest)
+                                                       : gLogger.reportFail(sampleTest);
+    }
+    if (!options.inference.pipelineStages.empty())
+    {
+        return runStagePipeline(options, iEnv) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
+    if (!options.inference.cascade.engine.empty())
+    {
+        return runCascade(options, iEnv, allocator) ? gLogger.reportPass(sampleTest) : gLogger.reportFail(sampleTest);
+    }
 
     if (options.build.safe && options.system.DLACore >= 0)
     {
@@ -138,31 +1669,351 @@ int main(int argc, char** argv)
         iEnv.profiler.reset(new Profiler);
     }
 
-    setUpInference(iEnv, options.inference);
+    if (!setUpInference(iEnv, options.inference))
+    {
+        gLogError << "Inference set up failed" << std::endl;
+        return gLogger.reportFail(sampleTest);
+    }
+    if (options.inference.compareEngine.empty())
+    {
+        printSharedMemory(iEnv);
+    }
+
+    if (!options.inference.serve.empty())
+    {
+        return serveInference(iEnv, options.inference) ? gLogger.reportPass(sampleTest)
+                                                       : gLogger.reportFail(sampleTest);
+    }
+
+    // The other devices run copies of the engine, with the inputs in the host buffers of the first device
+    const auto& devices = options.system.devices;
+    std::vector<std::unique_ptr<InferenceEnvironment>> deviceEnvs;
+    std::vector<InferenceEnvironment*> iEnvs{&iEnv};
+    if (devices.size() > 1)
+    {
+        auto engines = replicateEngine(*iEnv.engine, std::vector<int>(devices.begin() + 1, devices.end()), gLogError);
+        for (size_t d = 0; d < engines.size(); ++d)
+        {
+            cudaSetDevice(devices[d + 1]);
+            deviceEnvs.emplace_back(new InferenceEnvironment);
+            deviceEnvs.back()->engine = std::move(engines[d]);
+            if (!setUpInference(*deviceEnvs.back(), options.inference))
+            {
+                gLogError << "Inference set up on device " << devices[d + 1] << " failed" << std::endl;
+                return gLogger.reportFail(sampleTest);
+            }
+            shareInputs(iEnv, *deviceEnvs.back());
+            iEnvs.push_back(deviceEnvs.back().get());
+        }
+        cudaSetDevice(options.system.device);
+        if (deviceEnvs.size() + 1 != devices.size())
+        {
+            return gLogger.reportFail(sampleTest);
+        }
+    }
+
+    if (!options.inference.compareEngine.empty())
+    {
+        InferenceEnvironment iEnvB;
+        iEnvB.engine.reset(loadEngine(options.inference.compareEngine, options.system.DLACore, gLogError, allocator));
+        if (!iEnvB.engine)
+        {
+            gLogError << "Compare engine set up failed" << std::endl;
+            return gLogger.reportFail(sampleTest);
+        }
+        if (iEnv.profiler)
+        {
+            iEnvB.profiler.reset(new Profiler);
+        }
+        // The engines run their rounds in turn, so their contexts can share the activations of the largest
+        iEnvB.sharedMemory = iEnv.sharedMemory;
+        iEnvB.copyStreams = iEnv.copyStreams;
+        if (!setUpInference(iEnvB, options.inference))
+        {
+            gLogError << "Inference set up of the compare engine failed" << std::endl;
+            return gLogger.reportFail(sampleTest);
+        }
+        printSharedMemory(iEnv);
+
+        std::vector<InferenceTrace> traceA;
+        std::vector<InferenceTrace> traceB;
+        runComparison(options.inference, iEnv, iEnvB, traceA, traceB);
+
+        // The traces hold complete rounds after the warm up only
+        gLogInfo << "=== Engine (A) ===" << std::endl;
+        printPerformanceReport(traceA, options.reporting, 0, options.inference.batch, 0, gLogInfo);
+        gLogInfo << "=== Compare engine (B) ===" << std::endl;
+        printPerformanceReport(traceB, options.reporting, 0, options.inference.batch, 0, gLogInfo);
+        printComparisonReport(traceA, traceB, options.inference.batch, options.inference.streams, gLogInfo);
+        if (options.reporting.profile)
+        {
+            Profiler::printComparison(*iEnv.profiler, *iEnvB.profiler, gLogInfo);
+        }
+        return gLogger.reportPass(sampleTest);
+    }
+
+    if (!options.reporting.recordOutputs.empty())
+    {
+        const size_t queueBytes = static_cast<size_t>(options.reporting.recordQueue) << 20;
+        const std::shared_ptr<OutputRecorder> recorder(new OutputRecorder(options.reporting.recordOutputs, queueBytes));
+        for (auto* env : iEnvs)
+        {
+            env->recorder = recorder;
+        }
+    }
+    if (!options.inference.validateOutputs.empty())
+    {
+        OutputValues reference;
+        if (!importJSONOutput(options.inference.validateOutputs, reference, gLogError))
+        {
+            return gLogger.reportFail(sampleTest);
+        }
+        iEnv.validator.reset(new OutputValidator(
+            reference, options.inference.validateTolerance, options.inference.validateEvery));
+        if (!iEnv.validator->matches(*iEnv.bindings.front(), gLogError))
+        {
+            gLogError << "Reference outputs " << options.inference.validateOutputs << " do not match the engine"
+                      << std::endl;
+            return gLogger.reportFail(sampleTest);
+        }
+    }
+
+    std::unique_ptr<ClusterNode> cluster;
+    if (options.inference.clusterNodes || !options.inference.joinCluster.empty())
+    {
+        cluster.reset(new ClusterNode(options.inference));
+        if (!cluster->synchronize())
+        {
+            return gLogger.reportFail(sampleTest);
+        }
+    }
+
     std::vector<InferenceTrace> trace;
-    runInference(options.inference, iEnv, trace);
+    for (auto* env : iEnvs)
+    {
+        env->keepTrace = !options.reporting.histogramsOnly;
+    }
+    // Only the enqueues of the inferences, not those of the builder timing the plugins
+    if (options.reporting.pluginEnqueue)
+    {
+        setLibNvInferPluginsEnqueueTimer(reportPluginEnqueue);
+    }
+    if (devices.size() > 1)
+    {
+        runInference(options.inference, iEnvs, devices, trace);
+    }
+    else
+    {
+        runInference(options.inference, iEnv, trace);
+    }
+    setLibNvInferPluginsEnqueueTimer(nullptr);
+    if (iEnv.recorder)
+    {
+        gLogInfo << "Recorded the outputs of " << iEnv.recorder->getRecorded() << " inferences to "
+                 << options.reporting.recordOutputs << ".bin, " << iEnv.recorder->getDropped() << " dropped"
+                 << std::endl;
+        // The last environment releasing the recorder waits for the writer to finish
+        for (auto* env : iEnvs)
+        {
+            env->recorder.reset();
+        }
+    }
 
-    printPerformanceReport(trace, options.reporting, static_cast<float>(options.inference.warmup), options.inference.batch, gLogInfo);
+    // With --steadyState the warm up ends when the run is steady, the reports leave out the queries until then
+    const float warmupMs = options.inference.steadyState || options.inference.confidence
+        ? iEnv.convergence.warmupMs
+        : static_cast<float>(options.inference.warmup);
+    if (!options.reporting.histogramsOnly)
+    {
+        printPerformanceReport(
+            trace, options.reporting, warmupMs, options.inference.batch, options.inference.qps, gLogInfo);
+        if (devices.size() > 1)
+        {
+            printDeviceReport(trace, options.reporting, warmupMs, options.inference.batch, gLogInfo);
+        }
+    }
+    LatencyHistograms histograms;
+    for (const auto* env : iEnvs)
+    {
+        histograms.merge(env->histograms);
+    }
+    printHistograms(histograms, gLogInfo);
+    if (cluster && !cluster->report(trace, warmupMs, options.inference.batch, gLogInfo))
+    {
+        return gLogger.reportFail(sampleTest);
+    }
+    if (!options.reporting.histogramsOnly)
+    {
+        printStageReport(trace, warmupMs, options.inference.depth, gLogInfo);
+    }
+    if (!options.reporting.histogramsOnly && (options.reporting.copies || options.inference.sharedCopyStreams))
+    {
+        printCopyReport(trace, warmupMs, gLogInfo);
+    }
+    if (options.reporting.startup && !trace.empty())
+    {
+        // The trace is in start order, its first entry is the first inference, warm up included
+        iEnv.startup.firstInferenceMs = trace.front().outEnd - trace.front().inStart;
+        printStartupReport(iEnv.startup, gLogInfo);
+    }
+    std::vector<TelemetrySample> telemetry;
+    for (const auto* env : iEnvs)
+    {
+        telemetry.insert(telemetry.end(), env->telemetry.begin(), env->telemetry.end());
+    }
+    printTelemetryReport(telemetry, warmupMs, gLogInfo);
+    WaitStats waits;
+    for (const auto* env : iEnvs)
+    {
+        waits.waits += env->waitStats.waits;
+        waits.spunWaits += env->waitStats.spunWaits;
+        waits.waitMs += env->waitStats.waitMs;
+        waits.cpuMs += env->waitStats.cpuMs;
+        waits.wallMs = std::max(waits.wallMs, env->waitStats.wallMs);
+    }
+    const auto& inference = options.inference;
+    printWaitReport(waits, inference.hybridWait ? "hybrid" : inference.spin ? "spin" : "blocking", gLogInfo);
+    DeadlineStats deadlines;
+    for (const auto* env : iEnvs)
+    {
+        deadlines.merge(env->deadlineStats);
+    }
+    printDeadlineReport(deadlines, gLogInfo);
+    printConvergenceReport(iEnv.convergence, gLogInfo);
+    if (options.inference.dynamicBatching)
+    {
+        printBatchingReport(trace, warmupMs, iEnv.maxBatch, gLogInfo);
+    }
+    if (!options.inference.shapeChurn.empty())
+    {
+        printShapeChurnReport(
+            trace, ShapeSampler::bucketNames(options.inference), warmupMs, options.reporting.percentile, gLogInfo);
+    }
+    if (!options.inference.replay.empty())
+    {
+        printReplayReport(trace, static_cast<float>(options.inference.replayWindow), options.reporting.percentile,
+            gLogInfo);
+    }
+    if (options.inference.graph)
+    {
+        for (const auto* env : iEnvs)
+        {
+            gLogInfo << "CUDA graph cache: " << env->graphCacheHits << " hits, " << env->graphCacheMisses << " misses, "
+                     << env->graphCacheEvictions << " evictions" << std::endl;
+        }
+    }
 
+    if (options.reporting.input)
+    {
+        dumpInputs(*iEnv.context.front(), *iEnv.bindings.front(), gLogInfo);
+    }
     if (options.reporting.output)
     {
-        dumpOutputs(*iEnv.context.front(), *iEnv.bindings.front(), gLogInfo);
+        if (iEnv.tilings.empty())
+        {
+            dumpOutputs(*iEnv.context.front(), *iEnv.bindings.front(), gLogInfo);
+        }
+        else
+        {
+            dumpOutputs(*iEnv.tilings.front(), gLogInfo);
+        }
+    }
+    if (iEnv.validator)
+    {
+        printValidationReport(*iEnv.validator, gLogInfo);
     }
     if (!options.reporting.exportOutput.empty())
     {
-        exportJSONOutput(*iEnv.context.front(), *iEnv.bindings.front(), options.reporting.exportOutput);
+        if (iEnv.tilings.empty())
+        {
+            exportJSONOutput(*iEnv.context.front(), *iEnv.bindings.front(), options.reporting.exportOutput);
+        }
+        else
+        {
+            exportJSONOutput(*iEnv.tilings.front(), options.reporting.exportOutput);
+        }
     }
     if (!options.reporting.exportTimes.empty())
     {
         exportJSONTrace(trace, options.reporting.exportTimes);
     }
+    if (!options.reporting.exportHistograms.empty())
+    {
+        exportHistograms(histograms, options.reporting.exportHistograms);
+    }
+    if (!options.reporting.exportTelemetry.empty())
+    {
+        exportJSONTelemetry(telemetry, options.reporting.exportTelemetry);
+    }
+    if (!options.reporting.exportSummary.empty())
+    {
+        size_t free{0};
+        size_t total{0};
+        cudaCheck(cudaMemGetInfo(&free, &total));
+        const std::string& model = options.build.load ? options.build.engine : options.model.baseModel.model;
+        exportJSONSummary(model, trace, warmupMs, options.inference.batch, iEnv.startup, total - free,
+            options.reporting.exportSummary);
+    }
+    if (!options.reporting.exportChromeTrace.empty())
+    {
+        exportChromeTrace(trace, iEnv.profiler.get(), options.reporting.exportChromeTrace, telemetry);
+    }
     if (options.reporting.profile)
     {
-        iEnv.profiler->print(gLogInfo);
+        iEnv.profiler->print(gLogInfo, trace);
+    }
+    if (options.reporting.pluginEnqueue)
+    {
+        gPluginEnqueueProfiler.print(gLogInfo, iEnv.profiler.get());
+    }
+    if (options.reporting.roofline)
+    {
+        // Explicit batch networks take their dynamic batch from the first inference shape
+        int batch{options.inference.batch};
+        const auto& shapes = options.inference.shapes;
+        if (!batch)
+        {
+            batch = shapes.empty() || shapes.front().empty() ? 1 : shapes.front().begin()->second.d[0];
+        }
+        LayerCosts costs;
+        if (getLayerCosts(options.model, options.build, batch, costs, gLogError))
+        {
+            const DataType precision = options.build.int8 ? DataType::kINT8
+                : options.build.fp16 ? DataType::kHALF : DataType::kFLOAT;
+            printRoofline(*iEnv.profiler, costs, getDevicePeaks(options.system.device, precision), gLogInfo);
+        }
+    }
+    if (options.reporting.reformats)
+    {
+        NetworkDescription network;
+        const bool described = options.model.baseModel.format != ModelFormat::kANY
+            && describeNetwork(options.model, options.build, network, gLogError);
+        printReformatReport(*iEnv.profiler, described ? &network : nullptr, gLogInfo);
     }
     if (!options.reporting.exportProfile.empty())
     {
-        iEnv.profiler->exportJSONProfile(options.reporting.exportProfile);
+        iEnv.profiler->exportJSONProfile(options.reporting.exportProfile, trace);
+    }
+    if (memAccount)
+    {
+        memAccount->endPhase();
+        memAccount->print(gLogInfo);
+        gLogInfo << "Activations: " << iEnv.engine->getDeviceMemorySize() / 1048576.0 << " MiB per context, "
+                 << iEnv.context.size() << " contexts" << (iEnv.sharedMemory ? " sharing one" : "") << std::endl;
+    }
+    if (memPool)
+    {
+        memPool->print(gLogInfo);
+    }
+    if (hostPool)
+    {
+        hostPool->print(gLogInfo);
+    }
+    if (iEnv.validator && iEnv.validator->getStats().failedChecks)
+    {
+        gLogError << "Outputs mismatched their reference in " << iEnv.validator->getStats().failedChecks
+                  << " checks" << std::endl;
+        return gLogger.reportFail(sampleTest);
     }
 
     return gLogger.reportPass(sampleTest);